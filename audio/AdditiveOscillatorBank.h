@@ -0,0 +1,108 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "audio/utils/float4.h"
+
+// `PARTIALS` sine oscillators summed together, for additive synthesis. Each partial is a quadrature oscillator: its
+// (cos, sin) state is rotated by its phase increment every sample, so a partial costs 4 multiplications instead of
+// a sine, and 4 partials are rotated at once in the SIMD registers.
+//
+// The frequencies and amplitudes are set at control rate with `setPartial()`, then `ramp(frames)` slides the
+// amplitudes to their new values over the next `frames` samples, so they never click. Partials above the Nyquist
+// frequency fade out, and the groups of 4 partials all silent are not computed.
+template <int PARTIALS>
+class AdditiveOscillatorBank {
+    static_assert(PARTIALS % 4 == 0, "AdditiveOscillatorBank partials must be a multiple of 4");
+
+protected:
+    alignas(16) float re[PARTIALS] = {};
+    alignas(16) float im[PARTIALS] = {};
+    alignas(16) float rotRe[PARTIALS] = {};
+    alignas(16) float rotIm[PARTIALS] = {};
+    alignas(16) float amp[PARTIALS] = {};
+    alignas(16) float ampStep[PARTIALS] = {};
+    float target[PARTIALS] = {};
+    float freqs[PARTIALS] = {};
+
+    float sampleRate;
+    // Samples left before the amplitudes reach their target
+    uint32_t rampLeft = 0;
+    // Partials computed, up to the last one not silent, rounded to a group of 4
+    int active = 0;
+
+public:
+    AdditiveOscillatorBank(float sampleRate)
+        : sampleRate(sampleRate)
+    {
+        for (int p = 0; p < PARTIALS; p++) {
+            re[p] = 1.0f;
+            rotRe[p] = 1.0f;
+        }
+    }
+
+    // Frequency in Hz and amplitude of the partial, applied by the next `ramp()`
+    void setPartial(int p, float freq, float amplitude)
+    {
+        if (freq != freqs[p]) {
+            freqs[p] = freq;
+            float w = 2.0f * M_PI * freq / sampleRate;
+            rotRe[p] = cosf(w);
+            rotIm[p] = sinf(w);
+        }
+        // Culled above the Nyquist frequency, where it would alias
+        target[p] = freq < sampleRate * 0.5f ? amplitude : 0.0f;
+    }
+
+    // Phase of the partial, in periods
+    void setPhase(int p, float phase)
+    {
+        re[p] = cosf(2.0f * M_PI * phase);
+        im[p] = sinf(2.0f * M_PI * phase);
+    }
+
+    // Slide the amplitudes to the targets set by `setPartial()` over `frames` samples
+    void ramp(uint32_t frames)
+    {
+        rampLeft = frames > 0 ? frames : 1;
+        active = 0;
+        for (int p = 0; p < PARTIALS; p++) {
+            ampStep[p] = (target[p] - amp[p]) / rampLeft;
+            if (target[p] != 0.0f || amp[p] != 0.0f) {
+                active = (p / 4 + 1) * 4;
+            }
+            // The rotation slowly changes the magnitude of the state, brought back to 1 (one Newton step)
+            float g = 1.5f - 0.5f * (re[p] * re[p] + im[p] * im[p]);
+            re[p] *= g;
+            im[p] *= g;
+        }
+    }
+
+    // Sum of the partials for the next sample
+    float next()
+    {
+        if (rampLeft > 0 && --rampLeft == 0) {
+            // Exactly on the targets, until the next ramp
+            for (int p = 0; p < active; p++) {
+                amp[p] = target[p];
+                ampStep[p] = 0.0f;
+            }
+        }
+
+        using namespace float4;
+        v4 mix = set(0.0f);
+        for (int p = 0; p < active; p += WIDTH) {
+            v4 r = load(re + p);
+            v4 i = load(im + p);
+            v4 cr = load(rotRe + p);
+            v4 ci = load(rotIm + p);
+            v4 a = load(amp + p);
+            mix = add(mix, mul(i, a));
+            store(re + p, sub(mul(r, cr), mul(i, ci)));
+            store(im + p, add(mul(i, cr), mul(r, ci)));
+            store(amp + p, add(a, load(ampStep + p)));
+        }
+        return sum(mix);
+    }
+};
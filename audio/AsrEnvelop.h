@@ -22,6 +22,8 @@ sha: 0c8d2263ff83b561d6ba0fdd0a2c98598b9cdb6b7903205cb3a4335c4830bb54
 */
 #pragma once
 
+#include <algorithm>
+#include <cstdint>
 #include <functional>
 
 class AsrEnvelop {
@@ -89,6 +91,35 @@ public:
         nextFn = &AsrEnvelop::envelopRelease;
     }
 
+    // `frames` values of `next()` at once: the ramps are filled without branch up to the sample before they reach 1 or
+    // 0, `next()` only stepping over the ends. Once released down to 0, `onFinish` is called for each sample as before.
+    void render(float* out, uint32_t frames)
+    {
+        uint32_t n = 0;
+        while (n < frames) {
+            bool attacking = nextFn == &AsrEnvelop::envelopAttack;
+            bool releasing = nextFn == &AsrEnvelop::envelopRelease;
+            if (!attacking && !(releasing && (env > 0.0f || onFinish))) {
+                for (; n < frames; n++) {
+                    out[n] = env;
+                }
+                return;
+            }
+            float step = attacking ? *attackStep : -*releaseStep;
+            float remaining = ((attacking ? 1.0f : 0.0f) - env) / step;
+            uint32_t run = remaining > 1.0f ? (uint32_t)std::min(remaining - 1.0f, (float)(frames - n)) : 0;
+            float from = env;
+            for (uint32_t k = 0; k < run; k++) {
+                out[n + k] = from + step * (k + 1);
+            }
+            env = from + step * run;
+            n += run;
+            if (n < frames) {
+                out[n++] = next();
+            }
+        }
+    }
+
     bool isRelease()
     {
         return nextFn == &AsrEnvelop::envelopRelease;
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "audio/utils/float4.h"
+
+// Coefficients of a biquad section, normalized by a0, from the RBJ audio EQ cookbook. The default is a pass through.
+struct BiquadCoeffs {
+    float b0 = 1.0f, b1 = 0.0f, b2 = 0.0f, a1 = 0.0f, a2 = 0.0f;
+
+    static constexpr float BUTTERWORTH_Q = 0.70710678f;
+
+    static BiquadCoeffs lowpass(float freq, float q, float sampleRate)
+    {
+        float cosw0, alpha;
+        prepare(freq, q, sampleRate, cosw0, alpha);
+        return normalize((1.0f - cosw0) * 0.5f, 1.0f - cosw0, (1.0f - cosw0) * 0.5f, 1.0f + alpha, -2.0f * cosw0, 1.0f - alpha);
+    }
+
+    static BiquadCoeffs highpass(float freq, float q, float sampleRate)
+    {
+        float cosw0, alpha;
+        prepare(freq, q, sampleRate, cosw0, alpha);
+        return normalize((1.0f + cosw0) * 0.5f, -(1.0f + cosw0), (1.0f + cosw0) * 0.5f, 1.0f + alpha, -2.0f * cosw0, 1.0f - alpha);
+    }
+
+    // Constant 0dB peak gain
+    static BiquadCoeffs bandpass(float freq, float q, float sampleRate)
+    {
+        float cosw0, alpha;
+        prepare(freq, q, sampleRate, cosw0, alpha);
+        return normalize(alpha, 0.0f, -alpha, 1.0f + alpha, -2.0f * cosw0, 1.0f - alpha);
+    }
+
+    static BiquadCoeffs allpass(float freq, float q, float sampleRate)
+    {
+        float cosw0, alpha;
+        prepare(freq, q, sampleRate, cosw0, alpha);
+        return normalize(1.0f - alpha, -2.0f * cosw0, 1.0f + alpha, 1.0f + alpha, -2.0f * cosw0, 1.0f - alpha);
+    }
+
+    static BiquadCoeffs peak(float freq, float q, float gainDb, float sampleRate)
+    {
+        float cosw0, alpha;
+        prepare(freq, q, sampleRate, cosw0, alpha);
+        float a = powf(10.0f, gainDb / 40.0f);
+        return normalize(1.0f + alpha * a, -2.0f * cosw0, 1.0f - alpha * a, 1.0f + alpha / a, -2.0f * cosw0, 1.0f - alpha / a);
+    }
+
+    // Shelves with a slope of 1, the steepest without overshoot
+    static BiquadCoeffs lowShelf(float freq, float gainDb, float sampleRate)
+    {
+        float cosw0, alpha;
+        float a = powf(10.0f, gainDb / 40.0f);
+        prepare(freq, shelfQ(a), sampleRate, cosw0, alpha);
+        float sqrtA2 = 2.0f * sqrtf(a) * alpha;
+        return normalize(a * ((a + 1.0f) - (a - 1.0f) * cosw0 + sqrtA2), 2.0f * a * ((a - 1.0f) - (a + 1.0f) * cosw0),
+            a * ((a + 1.0f) - (a - 1.0f) * cosw0 - sqrtA2), (a + 1.0f) + (a - 1.0f) * cosw0 + sqrtA2,
+            -2.0f * ((a - 1.0f) + (a + 1.0f) * cosw0), (a + 1.0f) + (a - 1.0f) * cosw0 - sqrtA2);
+    }
+
+    static BiquadCoeffs highShelf(float freq, float gainDb, float sampleRate)
+    {
+        float cosw0, alpha;
+        float a = powf(10.0f, gainDb / 40.0f);
+        prepare(freq, shelfQ(a), sampleRate, cosw0, alpha);
+        float sqrtA2 = 2.0f * sqrtf(a) * alpha;
+        return normalize(a * ((a + 1.0f) + (a - 1.0f) * cosw0 + sqrtA2), -2.0f * a * ((a - 1.0f) + (a + 1.0f) * cosw0),
+            a * ((a + 1.0f) + (a - 1.0f) * cosw0 - sqrtA2), (a + 1.0f) - (a - 1.0f) * cosw0 + sqrtA2,
+            2.0f * ((a - 1.0f) - (a + 1.0f) * cosw0), (a + 1.0f) - (a - 1.0f) * cosw0 - sqrtA2);
+    }
+
+protected:
+    static void prepare(float freq, float q, float sampleRate, float& cosw0, float& alpha)
+    {
+        float w0 = 2.0f * M_PI * std::clamp(freq, 1.0f, sampleRate * 0.49f) / sampleRate;
+        cosw0 = cosf(w0);
+        alpha = sinf(w0) / (2.0f * std::max(q, 0.01f));
+    }
+
+    static float shelfQ(float a)
+    {
+        return 1.0f / sqrtf((a + 1.0f / a) + 2.0f);
+    }
+
+    static BiquadCoeffs normalize(float b0, float b1, float b2, float a0, float a1, float a2)
+    {
+        BiquadCoeffs c;
+        c.b0 = b0 / a0;
+        c.b1 = b1 / a0;
+        c.b2 = b2 / a0;
+        c.a1 = a1 / a0;
+        c.a2 = a2 / a0;
+        return c;
+    }
+};
+
+// Serial biquad sections in transposed direct form II.
+//
+// Per sample, the sections are processed one after the other. A block is processed with one section per SIMD lane,
+// as a wavefront: at each step, section `s` processes the sample that section `s - 1` processed at the previous
+// step, so all the sections run in parallel without adding any latency, only the first and last steps of a block
+// masking the lanes that have no sample yet.
+//
+// Coefficients are only copied by `setSection()`, the design being done once by the caller, see `BiquadCoeffs`.
+// Sections that are not set pass the signal through.
+template <uint8_t SECTIONS>
+class BiquadCascade {
+protected:
+    static const uint8_t LANES = (SECTIONS + 3) / 4 * 4;
+
+    // One array per coefficient, so a group of 4 sections is a single load; unused lanes pass through
+    alignas(16) float b0[LANES];
+    alignas(16) float b1[LANES] = {};
+    alignas(16) float b2[LANES] = {};
+    alignas(16) float a1[LANES] = {};
+    alignas(16) float a2[LANES] = {};
+    alignas(16) float s1[LANES] = {};
+    alignas(16) float s2[LANES] = {};
+
+#if defined(FLOAT4)
+    static const uint8_t GROUPS = LANES / 4;
+
+    // One step of the wavefront: lane `s` processes the sample `t - s`. Groups are processed from the last one, so
+    // each one takes the previous output of the group before it. With `masked`, lanes out of the block keep their state.
+    template <bool masked>
+    inline void step(uint32_t t, float x, float* buf, uint32_t stride, uint32_t frames, float4::v4* y, float4::v4* z1, float4::v4* z2, const float4::v4* c)
+    {
+        using namespace float4;
+        for (int g = GROUPS - 1; g >= 0; g--) {
+            v4 in = shiftIn(y[g], g == 0 ? x : last(y[g - 1]));
+            const v4* k = c + g * 5;
+            v4 out = add(mul(k[0], in), z1[g]);
+            v4 n1 = add(sub(mul(k[1], in), mul(k[3], out)), z2[g]);
+            v4 n2 = sub(mul(k[2], in), mul(k[4], out));
+            if (masked) {
+                alignas(16) float m[4];
+                for (int l = 0; l < 4; l++) {
+                    uint32_t s = g * 4 + l;
+                    m[l] = t >= s && t - s < frames ? 1.0f : 0.0f;
+                }
+                v4 mask = load(m);
+                n1 = add(z1[g], mul(mask, sub(n1, z1[g])));
+                n2 = add(z2[g], mul(mask, sub(n2, z2[g])));
+            }
+            z1[g] = n1;
+            z2[g] = n2;
+            y[g] = out;
+        }
+        if (t >= LANES - 1) {
+            buf[(t - (LANES - 1)) * stride] = last(y[GROUPS - 1]);
+        }
+    }
+
+    void processWavefront(float* buf, uint32_t stride, uint32_t frames)
+    {
+        using namespace float4;
+        v4 c[GROUPS * 5];
+        v4 y[GROUPS], z1[GROUPS], z2[GROUPS];
+        for (uint8_t g = 0; g < GROUPS; g++) {
+            c[g * 5] = load(b0 + g * 4);
+            c[g * 5 + 1] = load(b1 + g * 4);
+            c[g * 5 + 2] = load(b2 + g * 4);
+            c[g * 5 + 3] = load(a1 + g * 4);
+            c[g * 5 + 4] = load(a2 + g * 4);
+            y[g] = set(0.0f);
+            z1[g] = load(s1 + g * 4);
+            z2[g] = load(s2 + g * 4);
+        }
+        const uint32_t edge = LANES - 1;
+        uint32_t t = 0;
+        for (; t < std::min(edge, frames); t++) {
+            step<true>(t, buf[t * stride], buf, stride, frames, y, z1, z2, c);
+        }
+        for (; t < frames; t++) {
+            step<false>(t, buf[t * stride], buf, stride, frames, y, z1, z2, c);
+        }
+        for (; t < frames + edge; t++) {
+            step<true>(t, 0.0f, buf, stride, frames, y, z1, z2, c);
+        }
+        for (uint8_t g = 0; g < GROUPS; g++) {
+            store(s1 + g * 4, z1[g]);
+            store(s2 + g * 4, z2[g]);
+        }
+    }
+#endif
+
+public:
+    BiquadCascade()
+    {
+        std::fill(b0, b0 + LANES, 1.0f);
+    }
+
+    void setSection(uint8_t i, const BiquadCoeffs& c)
+    {
+        b0[i] = c.b0;
+        b1[i] = c.b1;
+        b2[i] = c.b2;
+        a1[i] = c.a1;
+        a2[i] = c.a2;
+    }
+
+    void reset()
+    {
+        std::fill(s1, s1 + LANES, 0.0f);
+        std::fill(s2, s2 + LANES, 0.0f);
+    }
+
+    float process(float x)
+    {
+        for (uint8_t i = 0; i < SECTIONS; i++) {
+            float y = b0[i] * x + s1[i];
+            s1[i] = b1[i] * x - a1[i] * y + s2[i];
+            s2[i] = b2[i] * x - a2[i] * y;
+            x = y;
+        }
+        return x;
+    }
+
+    // Filter `frames` samples of `buf` in place, `stride` apart
+    void processBlock(float* buf, uint32_t stride, uint32_t frames)
+    {
+#if defined(FLOAT4)
+        processWavefront(buf, stride, frames);
+#else
+        for (uint8_t i = 0; i < SECTIONS; i++) {
+            float c0 = b0[i], c1 = b1[i], c2 = b2[i], d1 = a1[i], d2 = a2[i];
+            float z1 = s1[i], z2 = s2[i];
+            for (uint32_t f = 0; f < frames; f++) {
+                float x = buf[f * stride];
+                float y = c0 * x + z1;
+                z1 = c1 * x - d1 * y + z2;
+                z2 = c2 * x - d2 * y;
+                buf[f * stride] = y;
+            }
+            s1[i] = z1;
+            s2[i] = z2;
+        }
+#endif
+    }
+};
@@ -0,0 +1,211 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#include "audio/utils/float4.h"
+
+// PolyBLEP and PolyBLAMP residuals, to subtract the aliasing of the naive saw, square and triangle: the jumps (and
+// the slope changes of the triangle) are smoothed over the sample before and the sample after them. `t` is the
+// phase in [0, 1[ and `dt` the phase increment per sample, below 0.5. Written without branches, so the same
+// formulas run on 4 lanes at once.
+inline float polyBlep(float t, float invDt)
+{
+    float a = 1.0f - fminf(t * invDt, 1.0f);
+    float b = 1.0f + fmaxf((t - 1.0f) * invDt, -1.0f);
+    return b * b - a * a;
+}
+
+inline float polyBlamp(float t, float invDt)
+{
+    float a = 1.0f - fminf(t * invDt, 1.0f);
+    float b = 1.0f + fmaxf((t - 1.0f) * invDt, -1.0f);
+    return (a * a * a + b * b * b) * (1.0f / 3.0f);
+}
+
+inline float wrapPhase(float t)
+{
+    return t - floorf(t);
+}
+
+#if defined(FLOAT4)
+inline float4::v4 polyBlep(float4::v4 t, float4::v4 invDt)
+{
+    using namespace float4;
+    v4 one = set(1.0f);
+    v4 a = sub(one, min(mul(t, invDt), one));
+    v4 b = add(one, max(mul(sub(t, one), invDt), set(-1.0f)));
+    return sub(mul(b, b), mul(a, a));
+}
+
+inline float4::v4 polyBlamp(float4::v4 t, float4::v4 invDt)
+{
+    using namespace float4;
+    v4 one = set(1.0f);
+    v4 a = sub(one, min(mul(t, invDt), one));
+    v4 b = add(one, max(mul(sub(t, one), invDt), set(-1.0f)));
+    return mul(add(mul(mul(a, a), a), mul(mul(b, b), b)), set(1.0f / 3.0f));
+}
+
+inline float4::v4 wrapPhase(float4::v4 t)
+{
+    return float4::sub(t, float4::floor(t));
+}
+#endif
+
+// `LANES` band-limited oscillators of the same waveform, each with its own frequency, phase and gain, mixed into a
+// single output, e.g. the detuned voices of a unison. The lanes are processed 4 at a time in the SIMD registers,
+// the remaining ones one by one, so a bank of 1 lane is a plain band-limited oscillator.
+template <int LANES>
+class BlepOscillatorBank {
+public:
+    enum Type {
+        SAWTOOTH,
+        REVERSE_SAWTOOTH,
+        SQUARE,
+        TRIANGLE,
+    };
+
+protected:
+    alignas(16) float phase[LANES] = {};
+    alignas(16) float inc[LANES] = {};
+    alignas(16) float invInc[LANES] = {};
+    alignas(16) float gain[LANES] = {};
+
+    float invSampleRate;
+    Type type = SAWTOOTH;
+    // Fraction of the period where the square is high
+    float pulseWidth = 0.5f;
+
+    float lane(int l)
+    {
+        float t = phase[l];
+        float d = invInc[l];
+        float out;
+        switch (type) {
+        case SAWTOOTH:
+            out = 2.0f * t - 1.0f - polyBlep(t, d);
+            break;
+        case REVERSE_SAWTOOTH:
+            out = 1.0f - 2.0f * t + polyBlep(t, d);
+            break;
+        case SQUARE: {
+            float fall = wrapPhase(t - pulseWidth + 1.0f);
+            out = (t < pulseWidth ? 1.0f : -1.0f) + polyBlep(t, d) - polyBlep(fall, d);
+            break;
+        }
+        default: {
+            float half = wrapPhase(t + 0.5f);
+            // The slope changes by 8 * inc per sample at the corners, the residual being scaled for a change of 2
+            out = 1.0f - 4.0f * fabsf(t - 0.5f) + 4.0f * inc[l] * (polyBlamp(t, d) - polyBlamp(half, d));
+            break;
+        }
+        }
+        phase[l] = wrapPhase(t + inc[l]);
+        return out * gain[l];
+    }
+
+public:
+    BlepOscillatorBank(float sampleRate, Type type = SAWTOOTH)
+        : invSampleRate(1.0f / sampleRate)
+        , type(type)
+    {
+        for (int l = 0; l < LANES; l++) {
+            gain[l] = 1.0f;
+            setIncrement(l, 0.01f);
+        }
+    }
+
+    void setType(Type _type)
+    {
+        type = _type;
+    }
+
+    Type getType()
+    {
+        return type;
+    }
+
+    // Pulse width of the square, from 0.01 to 0.99
+    void setPulseWidth(float width)
+    {
+        pulseWidth = fminf(fmaxf(width, 0.01f), 0.99f);
+    }
+
+    void setFrequency(int l, float freq)
+    {
+        setIncrement(l, freq * invSampleRate);
+    }
+
+    // Phase increment per sample, limited below half a period, where the residuals would overlap
+    void setIncrement(int l, float _inc)
+    {
+        inc[l] = fminf(fmaxf(_inc, 1e-6f), 0.49f);
+        invInc[l] = 1.0f / inc[l];
+    }
+
+    void setPhase(int l, float _phase)
+    {
+        phase[l] = wrapPhase(_phase);
+    }
+
+    // Gain of the lane in the mix, 0 to mute it
+    void setGain(int l, float _gain)
+    {
+        gain[l] = _gain;
+    }
+
+    // Mix of all the lanes for the next sample
+    float next()
+    {
+        int l = 0;
+        float out = 0.0f;
+#if defined(FLOAT4)
+        using namespace float4;
+        v4 mix = set(0.0f);
+        for (; l + 4 <= LANES; l += 4) {
+            v4 t = load(phase + l);
+            v4 dt = load(inc + l);
+            v4 d = load(invInc + l);
+            v4 o;
+            switch (type) {
+            case SAWTOOTH:
+                o = sub(sub(mul(set(2.0f), t), set(1.0f)), polyBlep(t, d));
+                break;
+            case REVERSE_SAWTOOTH:
+                o = add(sub(set(1.0f), mul(set(2.0f), t)), polyBlep(t, d));
+                break;
+            case SQUARE: {
+                v4 shifted = add(sub(t, set(pulseWidth)), set(1.0f));
+                // 1 before the pulse width, -1 after
+                v4 naive = sub(set(1.0f), mul(set(2.0f), floor(shifted)));
+                o = sub(add(naive, polyBlep(t, d)), polyBlep(wrapPhase(shifted), d));
+                break;
+            }
+            default: {
+                v4 centered = sub(t, set(0.5f));
+                v4 dist = max(centered, sub(set(0.0f), centered));
+                v4 blamp = sub(polyBlamp(t, d), polyBlamp(wrapPhase(add(t, set(0.5f))), d));
+                o = add(sub(set(1.0f), mul(set(4.0f), dist)), mul(mul(set(4.0f), dt), blamp));
+                break;
+            }
+            }
+            mix = add(mix, mul(o, load(gain + l)));
+            store(phase + l, wrapPhase(add(t, dt)));
+        }
+        out = sum(mix);
+#endif
+        for (; l < LANES; l++) {
+            out += lane(l);
+        }
+        return out;
+    }
+
+    // Write `frames` samples of the mix in `out`, `stride` being the distance between two frames
+    void render(float* out, uint32_t stride, uint32_t frames)
+    {
+        for (uint32_t f = 0; f < frames; f++) {
+            out[f * stride] = next();
+        }
+    }
+};
@@ -23,12 +23,17 @@ sha: 5192956bb17ac61171c0ecc76d050ffeedde1b8c53d2b6109b104d03007add5c
 
 class Clock {
 protected:
+    // Frames are counted in 32.32 fixed point, so the fractional part of the tick duration is carried over
+    // from a tick to the next one instead of being truncated, and the tempo doesn't drift.
+    static const uint64_t ONE_FRAME = 1ULL << 32;
+
     int sampleRate;
 
-    uint8_t bpm = 120;
+    float bpm = 120.0f;
 
-    uint32_t sampleCounter = 0;
-    uint32_t sampleCountTarget = 0;
+    // Duration of a tick and position within the current tick, in fixed point frames
+    uint64_t tickDuration = 0;
+    uint64_t phase = 0;
 
     uint32_t clockCounter = 0;
 
@@ -47,29 +52,89 @@ public:
     void setBpm(float value)
     {
         bpm = CLAMP(value, 50.0f, 250.0f);
-        sampleCountTarget = (uint32_t)(((float)sampleRate * 60.0f / bpm) / 24.0f);
-        // logDebug("Tempo: %d bpm (sample rate: %d, sample count: %d)", (int)bpm, sampleRate, sampleCountTarget);
+        setTickFrames((double)sampleRate * 60.0 / bpm / 24.0);
+        // logDebug("Tempo: %d bpm (sample rate: %d, tick: %f frames)", (int)bpm, sampleRate, getTickFrames());
+    }
+
+    float getBpm() { return bpm; }
+
+    void setTickFrames(double frames)
+    {
+        tickDuration = (uint64_t)(frames * ONE_FRAME);
     }
 
-    uint8_t getBpm() { return bpm; }
+    double getTickFrames() { return (double)tickDuration / ONE_FRAME; }
 
     // At 250 BPM: increments per second = 250 * 24 / 60 = 100 clock ticks/sec
     // with uint32_t max = 4,294,967,295
     // lasts ~1.36 years of continuous run at 250 BPM.
     uint32_t getClock()
     {
-        sampleCounter++;
-        if (sampleCounter >= sampleCountTarget) {
-            sampleCounter = 0;
+        phase += ONE_FRAME;
+        if (phase >= tickDuration) {
+            phase -= tickDuration;
             clockCounter++;
             return clockCounter;
         }
         return 0;
     }
 
+    // Frames left before the next tick, 1 if it is the next call to `getClock()`
+    uint32_t framesToTick()
+    {
+        if (phase + ONE_FRAME >= tickDuration) {
+            return 1;
+        }
+        return (tickDuration - phase + ONE_FRAME - 1) / ONE_FRAME;
+    }
+
+    // Write a block of clock values in a lane: 0 except on the frames where a tick is due
+    void getClockBlock(float* lane, uint32_t stride, uint32_t frames)
+    {
+        uint32_t f = 0;
+        while (f < frames) {
+            uint32_t next = f + framesToTick() - 1;
+            if (next >= frames) {
+                phase += (uint64_t)(frames - f) * ONE_FRAME;
+                for (; f < frames; f++) {
+                    lane[f * stride] = 0.0f;
+                }
+                return;
+            }
+            phase += (uint64_t)(next - f) * ONE_FRAME;
+            for (; f < next; f++) {
+                lane[f * stride] = 0.0f;
+            }
+            lane[f * stride] = getClock();
+            f++;
+        }
+    }
+
+    // Emit a tick now, when the clock is driven by an external source, see ClockSync
+    uint32_t tick()
+    {
+        phase = 0;
+        clockCounter++;
+        return clockCounter;
+    }
+
+    // Position in ticks, the last tick emitted plus the elapsed part of the current one
+    double position()
+    {
+        return clockCounter + (double)phase / tickDuration;
+    }
+
+    // Jump to a position in ticks, e.g. to follow a session shared with other units, see NetSync
+    void setPosition(double ticks)
+    {
+        ticks = ticks < 0.0 ? 0.0 : ticks;
+        clockCounter = (uint32_t)ticks;
+        phase = (uint64_t)((ticks - clockCounter) * tickDuration);
+    }
+
     void reset()
     {
-        sampleCounter = 0;
+        phase = 0;
         clockCounter = 0;
     }
-};
\ No newline at end of file
+};
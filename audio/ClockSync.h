@@ -0,0 +1,84 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+// Follow an external clock, e.g. MIDI clock at 24 pulses per quarter note, from the frame its ticks are received.
+//
+// The receive time of the ticks is jittery (USB polling, midi thread wake up), so they are filtered with a second
+// order delay locked loop, smoothing both the tick period and its phase. See F. Adriaensen, "Using a DLL to filter
+// time". The loop bandwidth sets the trade-off: lower follows tempo changes slower but rejects more jitter.
+class ClockSync {
+protected:
+    uint32_t sampleRate;
+    float bandwidth;
+    uint64_t lastFrame = 0;
+    // Predicted frame of the next tick
+    double nextFrame = 0.0;
+
+public:
+    // Filtered number of frames between two ticks, once locked
+    double period = 0.0;
+    // Ticks received since the lock started
+    uint32_t received = 0;
+
+    ClockSync(uint32_t sampleRate, float bandwidth = 1.0f)
+        : sampleRate(sampleRate)
+        , bandwidth(bandwidth)
+    {
+    }
+
+    void setBandwidth(float hz)
+    {
+        bandwidth = hz;
+    }
+
+    // The period is known after 2 ticks
+    bool isLocked()
+    {
+        return received >= 2;
+    }
+
+    void reset()
+    {
+        received = 0;
+        period = 0.0;
+    }
+
+    // No tick received for a while: the external clock stopped, or is too far for the loop to catch up
+    bool isLost(uint64_t frame)
+    {
+        return isLocked() && frame > lastFrame + 4 * period;
+    }
+
+    // Frame at which tick `index` is expected, counted like `received`
+    double tickFrame(uint32_t index)
+    {
+        return nextFrame + ((double)index - received) * period;
+    }
+
+    void tick(uint64_t frame)
+    {
+        if (isLost(frame)) {
+            reset();
+        }
+        if (received == 0) {
+            nextFrame = frame;
+        } else if (received == 1) {
+            period = frame - lastFrame;
+            nextFrame = frame + period;
+        } else {
+            double omega = 2.0 * M_PI * bandwidth * period / sampleRate;
+            double error = frame - nextFrame;
+            nextFrame += period + M_SQRT2 * omega * error;
+            period += omega * omega * error;
+        }
+        lastFrame = frame;
+        received++;
+    }
+
+    float getBpm()
+    {
+        return period > 0.0 ? sampleRate * 60.0 / (period * 24.0) : 0.0f;
+    }
+};
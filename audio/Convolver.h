@@ -0,0 +1,379 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <memory>
+#include <sys/resource.h>
+#include <sys/syscall.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "audio/utils/fft.h"
+#include "audio/utils/float4.h"
+
+// Zero latency convolution of a mono signal with a long impulse response, e.g. a reverb or a speaker cabinet.
+//
+// The impulse response is cut in partitions growing with their position, each stage convolving its partitions in
+// the frequency domain (uniformly partitioned overlap-save with a delay line of input spectra):
+// - taps [0, 64) are a direct FIR, so the first sample of the response is played right away,
+// - taps [64, 1024) are partitions of 64 samples, computed in the audio thread every 64 samples,
+// - taps [1024, 8192) are partitions of 512 samples and the rest partitions of 4096 samples, each computed by its
+//   own worker thread.
+//
+// A stage starting at twice its block size has a whole block to compute it: block `k` is known once its last sample
+// is received and is only played 2 blocks later. So the audio thread only does the cheap part, the long tail being
+// spread over the other cores with enough slack not to need a real-time priority. If a worker is late anyway, its
+// part of the tail is muted for that block and counted in `misses`.
+//
+// Impulse responses are set with `setKernel()`, outside of the audio thread. The kernel is swapped atomically, each
+// stage publishing the one it is using, so the old one is only freed once no stage reads it anymore.
+class Convolver {
+public:
+    static const uint32_t HEAD = 64;
+    static const uint32_t STAGES = 3;
+    static constexpr uint32_t STAGE_BLOCKS[STAGES] = { 64, 512, 4096 };
+    static constexpr uint32_t STAGE_OFFSETS[STAGES] = { HEAD, 1024, 8192 };
+
+    struct Kernel {
+        uint32_t length = 0;
+        // Head taps in reverse order, to be multiplied with the last HEAD samples in order
+        alignas(16) float head[HEAD] = {};
+        struct Partitions {
+            uint32_t count = 0;
+            // `count` spectrums of `binStride` bins each
+            std::vector<float> re;
+            std::vector<float> im;
+        };
+        Partitions stages[STAGES];
+    };
+
+protected:
+    struct Stage {
+        uint32_t block;
+        uint32_t offset;
+        uint32_t maxPartitions;
+        uint32_t bins;
+        // Bins rounded up to a multiple of 4, for the SIMD complex multiply-add
+        uint32_t binStride;
+
+        RealFft fft;
+        std::vector<float> frame;
+        std::vector<std::complex<float>> spectrum;
+        std::vector<float> result;
+        // Frequency domain delay line: one input spectrum per partition, `fdlPos` being the most recent one
+        std::vector<float> fdlRe;
+        std::vector<float> fdlIm;
+        uint32_t fdlPos = 0;
+        std::vector<float> accRe;
+        std::vector<float> accIm;
+
+        // Kernel read by this stage, so it is not freed under its feet
+        std::atomic<const Kernel*> inUse { NULL };
+
+        // Workers only: output of the last OUTPUT_SLOTS blocks, and number of blocks computed
+        std::vector<float> output;
+        std::atomic<uint64_t> done { 0 };
+        uint64_t next = 0;
+        std::thread worker;
+
+        Stage(uint32_t block, uint32_t offset, uint32_t end)
+            : block(block)
+            , offset(offset)
+            , maxPartitions(end > offset ? (end - offset + block - 1) / block : 0)
+            , bins(block + 1)
+            , binStride((block + 1 + 3) & ~3u)
+            , fft(2 * block)
+        {
+            frame.assign(2 * block, 0.0f);
+            spectrum.assign(bins, 0.0f);
+            result.assign(2 * block, 0.0f);
+            fdlRe.assign(std::max(maxPartitions, 1u) * binStride, 0.0f);
+            fdlIm.assign(std::max(maxPartitions, 1u) * binStride, 0.0f);
+            accRe.assign(binStride, 0.0f);
+            accIm.assign(binStride, 0.0f);
+        }
+
+        // Convolve `frame`, the last 2 blocks of input, with the partitions, `block` samples being written to `dst`
+        void compute(const Kernel::Partitions* partitions, float* dst)
+        {
+            if (maxPartitions == 0) {
+                std::fill(dst, dst + block, 0.0f);
+                return;
+            }
+            // The spectrum is always added to the delay line, so a longer kernel set later has its history
+            fft.forward(frame.data(), spectrum.data());
+            fdlPos = (fdlPos + 1) % maxPartitions;
+            float* xr = fdlRe.data() + fdlPos * binStride;
+            float* xi = fdlIm.data() + fdlPos * binStride;
+            for (uint32_t k = 0; k < bins; k++) {
+                xr[k] = spectrum[k].real();
+                xi[k] = spectrum[k].imag();
+            }
+
+            uint32_t count = partitions ? std::min(partitions->count, maxPartitions) : 0;
+            if (count == 0) {
+                std::fill(dst, dst + block, 0.0f);
+                return;
+            }
+            std::fill(accRe.begin(), accRe.end(), 0.0f);
+            std::fill(accIm.begin(), accIm.end(), 0.0f);
+            for (uint32_t p = 0; p < count; p++) {
+                uint32_t slot = (fdlPos + maxPartitions - p) % maxPartitions;
+                const float* ar = fdlRe.data() + slot * binStride;
+                const float* ai = fdlIm.data() + slot * binStride;
+                const float* hr = partitions->re.data() + p * binStride;
+                const float* hi = partitions->im.data() + p * binStride;
+                float* yr = accRe.data();
+                float* yi = accIm.data();
+                uint32_t k = 0;
+#if defined(FLOAT4)
+                using namespace float4;
+                for (; k < binStride; k += 4) {
+                    v4 a = load(ar + k);
+                    v4 b = load(ai + k);
+                    v4 c = load(hr + k);
+                    v4 d = load(hi + k);
+                    store(yr + k, add(load(yr + k), sub(mul(a, c), mul(b, d))));
+                    store(yi + k, add(load(yi + k), add(mul(a, d), mul(b, c))));
+                }
+#endif
+                for (; k < bins; k++) {
+                    yr[k] += ar[k] * hr[k] - ai[k] * hi[k];
+                    yi[k] += ar[k] * hi[k] + ai[k] * hr[k];
+                }
+            }
+            for (uint32_t k = 0; k < bins; k++) {
+                spectrum[k] = { accRe[k], accIm[k] };
+            }
+            fft.inverse(spectrum.data(), result.data());
+            // Overlap-save: only the second half is free of the circular wrap
+            float gain = 1.0f / (2 * block);
+            for (uint32_t n = 0; n < block; n++) {
+                dst[n] = result[block + n] * gain;
+            }
+        }
+    };
+
+    static const uint32_t OUTPUT_SLOTS = 4;
+
+    std::atomic<const Kernel*> active { NULL };
+    std::unique_ptr<Stage> stages[STAGES];
+    std::atomic<bool> running = true;
+
+    // Input of the last samples, read by the stages to build their frames
+    std::vector<float> ring;
+    uint64_t ringMask;
+    std::atomic<uint64_t> written = 0;
+
+    // Audio thread state
+    const Kernel* current = NULL;
+    alignas(16) float delay[2 * HEAD] = {};
+    uint32_t delayPos = 0;
+    std::vector<float> firstOutput;
+    uint32_t blockPos = 0;
+
+    const Kernel* acquire(Stage& stage)
+    {
+        const Kernel* kernel = active.load();
+        while (true) {
+            stage.inUse.store(kernel);
+            const Kernel* check = active.load();
+            if (check == kernel) {
+                return kernel;
+            }
+            kernel = check;
+        }
+    }
+
+    void fillFrame(Stage& stage, uint64_t end)
+    {
+        uint64_t start = end - 2 * stage.block;
+        for (uint32_t n = 0; n < 2 * stage.block; n++) {
+            stage.frame[n] = ring[(start + n) & ringMask];
+        }
+    }
+
+    void workerLoop(uint8_t s)
+    {
+        Stage& stage = *stages[s];
+        // Shortest deadline first: the longer the block, the nicer the thread
+        setpriority(PRIO_PROCESS, syscall(SYS_gettid), 2 * s);
+        uint64_t blockUs = (uint64_t)stage.block * 1000000 / sampleRate;
+        auto interval = std::chrono::microseconds(std::max(blockUs / 4, (uint64_t)1000));
+        while (running.load(std::memory_order_relaxed)) {
+            uint64_t end = written.load(std::memory_order_acquire);
+            uint64_t available = end / stage.block;
+            // Too late for the input already overwritten, skip to the last block received, the blocks skipped
+            // being muted
+            if (available > stage.next + OUTPUT_SLOTS - 2) {
+                std::fill(stage.output.begin(), stage.output.end(), 0.0f);
+                stage.next = available - 1;
+                stage.done.store(stage.next, std::memory_order_release);
+            }
+            while (stage.next < available) {
+                fillFrame(stage, (stage.next + 1) * stage.block);
+                const Kernel* kernel = acquire(stage);
+                stage.compute(kernel ? &kernel->stages[s] : NULL, stage.output.data() + (stage.next % OUTPUT_SLOTS) * stage.block);
+                stage.inUse.store(NULL);
+                stage.next++;
+                stage.done.store(stage.next, std::memory_order_release);
+            }
+            std::this_thread::sleep_for(interval);
+        }
+    }
+
+public:
+    uint32_t sampleRate;
+    uint32_t maxLength;
+    // Blocks of the tail that were not computed in time
+    std::atomic<uint32_t> misses = 0;
+
+    // `maxLength` taps of the longest impulse response
+    Convolver(uint32_t sampleRate, uint32_t maxLength)
+        : sampleRate(sampleRate)
+        , maxLength(maxLength)
+    {
+        for (uint8_t s = 0; s < STAGES; s++) {
+            uint32_t end = s + 1 < STAGES ? std::min(STAGE_OFFSETS[s + 1], maxLength) : maxLength;
+            stages[s] = std::make_unique<Stage>(STAGE_BLOCKS[s], STAGE_OFFSETS[s], end);
+        }
+        uint64_t ringSize = 1;
+        while (ringSize < OUTPUT_SLOTS * STAGE_BLOCKS[STAGES - 1]) {
+            ringSize <<= 1;
+        }
+        ring.assign(ringSize, 0.0f);
+        ringMask = ringSize - 1;
+        firstOutput.assign(STAGE_BLOCKS[0], 0.0f);
+
+        for (uint8_t s = 1; s < STAGES; s++) {
+            if (stages[s]->maxPartitions == 0) {
+                continue;
+            }
+            stages[s]->output.assign(OUTPUT_SLOTS * stages[s]->block, 0.0f);
+            stages[s]->worker = std::thread([this, s] { workerLoop(s); });
+            pthread_setname_np(stages[s]->worker.native_handle(), s == 1 ? "convolver" : "convolver_tail");
+        }
+    }
+
+    // Stop the workers, before the owner stops calling `process()`
+    void stop()
+    {
+        running = false;
+        for (uint8_t s = 1; s < STAGES; s++) {
+            if (stages[s]->worker.joinable()) {
+                stages[s]->worker.join();
+            }
+        }
+    }
+
+    ~Convolver()
+    {
+        stop();
+        delete active.load();
+    }
+
+    // Kernel of the impulse response `ir`, to be built outside of the audio thread
+    std::unique_ptr<Kernel> buildKernel(const float* ir, uint32_t length)
+    {
+        std::unique_ptr<Kernel> kernel = std::make_unique<Kernel>();
+        length = std::min(length, maxLength);
+        kernel->length = length;
+        for (uint32_t i = 0; i < HEAD && i < length; i++) {
+            kernel->head[HEAD - 1 - i] = ir[i];
+        }
+        for (uint8_t s = 0; s < STAGES; s++) {
+            Stage& stage = *stages[s];
+            Kernel::Partitions& partitions = kernel->stages[s];
+            if (length <= stage.offset || stage.maxPartitions == 0) {
+                continue;
+            }
+            partitions.count = std::min((length - stage.offset + stage.block - 1) / stage.block, stage.maxPartitions);
+            partitions.re.assign(partitions.count * stage.binStride, 0.0f);
+            partitions.im.assign(partitions.count * stage.binStride, 0.0f);
+            RealFft fft(2 * stage.block);
+            std::vector<float> segment(2 * stage.block);
+            std::vector<std::complex<float>> spectrum(stage.bins);
+            for (uint32_t p = 0; p < partitions.count; p++) {
+                std::fill(segment.begin(), segment.end(), 0.0f);
+                uint32_t start = stage.offset + p * stage.block;
+                for (uint32_t n = 0; n < stage.block && start + n < length; n++) {
+                    segment[n] = ir[start + n];
+                }
+                fft.forward(segment.data(), spectrum.data());
+                for (uint32_t k = 0; k < stage.bins; k++) {
+                    partitions.re[p * stage.binStride + k] = spectrum[k].real();
+                    partitions.im[p * stage.binStride + k] = spectrum[k].imag();
+                }
+            }
+        }
+        return kernel;
+    }
+
+    // Swap the kernel, NULL to mute, waiting for the stages to release the previous one before freeing it, so it
+    // must be called while the audio runs, or once `stop()` was called
+    void setKernel(std::unique_ptr<Kernel> kernel)
+    {
+        const Kernel* old = active.exchange(kernel.release());
+        if (!old) {
+            return;
+        }
+        while (running.load()) {
+            bool used = false;
+            for (uint8_t s = 0; s < STAGES; s++) {
+                used = used || stages[s]->inUse.load() == old;
+            }
+            if (!used) {
+                break;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        delete old;
+    }
+
+    float process(float in)
+    {
+        Stage& first = *stages[0];
+        if (blockPos == 0) {
+            current = acquire(first);
+        }
+
+        // Taps played without latency
+        delay[delayPos] = in;
+        delay[delayPos + HEAD] = in;
+        delayPos = (delayPos + 1) % HEAD;
+        float out = current ? float4::dot(delay + delayPos, current->head, HEAD) : 0.0f;
+        out += firstOutput[blockPos];
+
+        uint64_t t = written.load(std::memory_order_relaxed);
+        ring[t & ringMask] = in;
+        for (uint8_t s = 1; s < STAGES; s++) {
+            Stage& stage = *stages[s];
+            if (stage.maxPartitions == 0) {
+                continue;
+            }
+            // Played 2 blocks after the block it was computed from
+            uint64_t block = t / stage.block;
+            if (block < 2) {
+                continue;
+            }
+            if (stage.done.load(std::memory_order_acquire) > block - 2) {
+                out += stage.output[((block - 2) % OUTPUT_SLOTS) * stage.block + t % stage.block];
+            } else if (t % stage.block == 0) {
+                misses++;
+            }
+        }
+        written.store(t + 1, std::memory_order_release);
+
+        if (++blockPos == first.block) {
+            blockPos = 0;
+            fillFrame(first, t + 1);
+            first.compute(current ? &current->stages[0] : NULL, firstOutput.data());
+        }
+        return out;
+    }
+};
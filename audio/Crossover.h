@@ -0,0 +1,106 @@
+#pragma once
+
+#include "audio/Biquad.h"
+
+// Linkwitz-Riley crossover splitting a signal into `BANDS` bands, e.g. for multiband processing.
+//
+// Each split is a 4th order low pass and high pass (2 Butterworth sections each), the high pass being split again
+// by the next, higher, frequency. The lower bands also go through the allpass of the splits above them, so all the
+// bands stay in phase and their sum is flat.
+template <uint8_t BANDS>
+class Crossover {
+public:
+    static_assert(BANDS >= 2, "a crossover needs at least 2 bands");
+    static const uint8_t SPLITS = BANDS - 1;
+
+protected:
+    float sampleRate;
+    float frequencies[SPLITS];
+    // Low pass of each split followed by the allpass of the splits above
+    BiquadCascade<BANDS> lows[SPLITS];
+    BiquadCascade<2> highs[SPLITS];
+
+    void update()
+    {
+        for (uint8_t i = 0; i < SPLITS; i++) {
+            BiquadCoeffs lp = BiquadCoeffs::lowpass(frequencies[i], BiquadCoeffs::BUTTERWORTH_Q, sampleRate);
+            BiquadCoeffs hp = BiquadCoeffs::highpass(frequencies[i], BiquadCoeffs::BUTTERWORTH_Q, sampleRate);
+            lows[i].setSection(0, lp);
+            lows[i].setSection(1, lp);
+            highs[i].setSection(0, hp);
+            highs[i].setSection(1, hp);
+            for (uint8_t j = i + 1; j < SPLITS; j++) {
+                lows[i].setSection(j - i + 1, BiquadCoeffs::allpass(frequencies[j], BiquadCoeffs::BUTTERWORTH_Q, sampleRate));
+            }
+        }
+    }
+
+public:
+    Crossover(float sampleRate)
+        : sampleRate(sampleRate)
+    {
+        for (uint8_t i = 0; i < SPLITS; i++) {
+            frequencies[i] = 250.0f * powf(8.0f, i);
+        }
+        update();
+    }
+
+    // Set all the split frequencies at once, in increasing order, so the filters are only designed once
+    void setFrequencies(const float* hz)
+    {
+        for (uint8_t i = 0; i < SPLITS; i++) {
+            frequencies[i] = std::clamp(hz[i], i > 0 ? frequencies[i - 1] : 10.0f, sampleRate * 0.45f);
+        }
+        update();
+    }
+
+    void setFrequency(uint8_t split, float hz)
+    {
+        float hzs[SPLITS];
+        std::copy(frequencies, frequencies + SPLITS, hzs);
+        hzs[split] = hz;
+        setFrequencies(hzs);
+    }
+
+    float getFrequency(uint8_t split)
+    {
+        return frequencies[split];
+    }
+
+    void reset()
+    {
+        for (uint8_t i = 0; i < SPLITS; i++) {
+            lows[i].reset();
+            highs[i].reset();
+        }
+    }
+
+    // Split `x` into `out[0]` (lowest) to `out[BANDS - 1]` (highest)
+    void process(float x, float* out)
+    {
+        for (uint8_t i = 0; i < SPLITS; i++) {
+            out[i] = lows[i].process(x);
+            x = highs[i].process(x);
+        }
+        out[SPLITS] = x;
+    }
+
+    // Split `frames` samples of `in` into the `bands` buffers, all `stride` apart. `in` can be the buffer of the
+    // highest band.
+    void processBlock(const float* in, float** bands, uint32_t stride, uint32_t frames)
+    {
+        float* high = bands[SPLITS];
+        if (in != high) {
+            for (uint32_t f = 0; f < frames; f++) {
+                high[f * stride] = in[f * stride];
+            }
+        }
+        for (uint8_t i = 0; i < SPLITS; i++) {
+            for (uint32_t f = 0; f < frames; f++) {
+                bands[i][f * stride] = high[f * stride];
+            }
+            lows[i].processBlock(bands[i], stride, frames);
+            highs[i].processBlock(high, stride, frames);
+        }
+    }
+};
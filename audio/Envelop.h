@@ -21,6 +21,7 @@ sha: 2738f0f5c9f148e15e10c8124d7383433c1e8ae73ed394884e8c4d6cc7dd714f
 */
 #pragma once
 
+#include <algorithm>
 #include <vector>
 
 class Envelop {
@@ -91,6 +92,41 @@ public:
         return next(sampleCount, index);
     }
 
+    // `frames` values of `next()` at once: the samples of a segment before its last one are a straight line, filled
+    // without branch, `next()` only stepping over the segment boundaries.
+    void render(float* out, unsigned int frames, unsigned int& sampleCountRef, unsigned int& indexRef)
+    {
+        unsigned int n = 0;
+        while (n < frames) {
+            if (indexRef >= data.size() - 1 || isSustain(indexRef)) {
+                float value = indexRef >= data.size() - 1 ? 0.0f : data[indexRef].modulation;
+                sampleCountRef += frames - n;
+                for (; n < frames; n++) {
+                    out[n] = value;
+                }
+                return;
+            }
+            unsigned int count = data[indexRef].sampleCount;
+            unsigned int run = sampleCountRef + 1 < count ? std::min(frames - n, count - 1 - sampleCountRef) : 0;
+            float from = data[indexRef].modulation;
+            float slope = (data[indexRef + 1].modulation - from) / (float)count;
+            float start = (float)sampleCountRef;
+            for (unsigned int k = 0; k < run; k++) {
+                out[n + k] = from + slope * (start + 1 + k);
+            }
+            sampleCountRef += run;
+            n += run;
+            if (n < frames) {
+                out[n++] = next(sampleCountRef, indexRef);
+            }
+        }
+    }
+
+    void render(float* out, unsigned int frames)
+    {
+        render(out, frames, sampleCount, index);
+    }
+
     void release()
     {
         release(sampleCount, index);
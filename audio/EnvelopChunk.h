@@ -0,0 +1,39 @@
+#pragma once
+
+#include <cstdint>
+
+// Values of an envelope rendered ahead by chunks, for the engines stepping it once per sample: each chunk is a single
+// `render()` of the envelope, its segments being filled without branch, and `next()` only reads the chunk.
+//
+// The envelope is `SIZE` samples ahead of the engine: call `reset()` whenever the envelope is reset (e.g. on note on),
+// to drop the values rendered for the previous note. A change of its shape (e.g. a morph) is heard on the next chunk.
+template <typename Env, uint32_t SIZE = 32>
+class EnvelopChunk {
+protected:
+    Env& env;
+    float values[SIZE];
+    uint32_t pos = 0;
+    uint32_t count = 0;
+
+public:
+    EnvelopChunk(Env& env)
+        : env(env)
+    {
+    }
+
+    void reset()
+    {
+        pos = 0;
+        count = 0;
+    }
+
+    float next()
+    {
+        if (pos == count) {
+            env.render(values, SIZE);
+            count = SIZE;
+            pos = 0;
+        }
+        return values[pos++];
+    }
+};
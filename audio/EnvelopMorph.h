@@ -66,6 +66,28 @@ public:
         return scaleOutput(evaluateShape(transformTime(t)));
     }
 
+    // `frames` values of `next()` at once: the two shapes of the morph are picked once for the whole block, and the
+    // values after the end are 0.
+    void render(float* out, int frames) {
+        int n = 0;
+        if (shapeFuncs && shapeCount > 0) {
+            float pos = morphValue * (shapeCount - 1);
+            int idx = static_cast<int>(pos);
+            float frac = pos - idx;
+            EnvelopeShapeFunc shapeA = shapeFuncs[std::min(idx, shapeCount - 1)];
+            EnvelopeShapeFunc shapeB = shapeFuncs[std::min(idx + 1, shapeCount - 1)];
+            float inv = 1.0f / sampleCount;
+            for (; n < frames && currentSample < sampleCount; n++) {
+                float t = transformTime(currentSample++ * inv);
+                float a = shapeA(t);
+                out[n] = scaleOutput(a + (shapeB(t) - a) * frac);
+            }
+        }
+        for (; n < frames; n++) {
+            out[n] = next();
+        }
+    }
+
 protected:
     int sampleCount;
     int currentSample;
@@ -16,6 +16,7 @@ sha: 6d199b78fd15c904f43127ec11597021a78eb74258ddefd8348e0b68bae6eb02
 */
 #pragma once
 
+#include <algorithm>
 #include <sstream>
 #include <stdio.h>
 #include <vector>
@@ -76,6 +77,34 @@ public:
         return currentModulation;
     }
 
+    // `frames` values of `next()` at once: within a segment, the values up to the one before reaching its target are
+    // `currentModulation + k * incRatio`, filled without branch, `next()` only stepping over the segment boundaries.
+    void render(float* out, uint32_t frames)
+    {
+        uint32_t n = 0;
+        while (n < frames) {
+            if (index > data.size() - 1 || data[index].incRatio == 0.0f) {
+                float value = index > data.size() - 1 ? 0.0f : currentModulation;
+                for (; n < frames; n++) {
+                    out[n] = value;
+                }
+                return;
+            }
+            float inc = data[index].incRatio;
+            float remaining = (data[index + 1].modulation - currentModulation) / inc;
+            uint32_t run = remaining > 1.0f ? (uint32_t)std::min(remaining - 1.0f, (float)(frames - n)) : 0;
+            float from = currentModulation;
+            for (uint32_t k = 0; k < run; k++) {
+                out[n + k] = from + inc * (k + 1);
+            }
+            currentModulation = from + inc * run;
+            n += run;
+            if (n < frames) {
+                out[n++] = next();
+            }
+        }
+    }
+
     void reset(float totalSamples)
     {
         index = 0;
@@ -7,19 +7,19 @@ The generator provides significant creative control:
 1.  **Type Selection:** It includes 21 distinct, named envelope types, ranging from simple fades (`ExpoDecay`, `SmoothSlope`) to complex, percussive sounds (`BassPluck`, `LongBoom`). Each type utilizes a different mathematical formula to create its unique sonic characteristic.
 2.  **Morph Control:** Users can further adjust the selected shape using a "Morph" parameter. This control (ranging from 0% to 100%) subtly or dramatically alters the underlying math of the curve, allowing sound designers to fine-tune aspects like decay speed, sharpness, or curvature.
 
-Whenever the type or morph setting changes, the generator immediately recalculates and updates its internal table. During playback, the audio engine efficiently reads these stored values, using a technique called "linear interpolation" to smoothly blend between the numerical points. This process ensures the resulting sound envelope is continuous, precise, and artifact-free.
+Whenever the type or morph setting changes, the table is recalculated on a background worker and swapped in at the start of the next block, so sweeping the morph never glitches the sound. During playback, the audio engine efficiently reads these stored values, using a technique called "linear interpolation" to smoothly blend between the numerical points. This process ensures the resulting sound envelope is continuous, precise, and artifact-free.
 
 sha: 63a0cfa30e4cb67db298f1b61d2f7ad0daca766279b3443d4b103044c1f459ad 
 */
 #pragma once
 
+#include <atomic>
 #include <cmath>
 
 #include "helpers/clamp.h"
-#include "audio/WavetableInterface.h"
-#include "audio/lookupTable.h"
+#include "audio/TableBuilder.h"
 
-class EnvelopeTableGenerator : public WavetableInterface {
+class EnvelopeTableGenerator : public TableGenerator {
 public:
     enum class Type {
         ExpoDecay,
@@ -45,27 +45,26 @@ public:
     };
 
     EnvelopeTableGenerator(LookupTable* sharedLut)
-        : WavetableInterface(LOOKUP_TABLE_SIZE)
-        , sharedLut(sharedLut)
+        : sharedLut(sharedLut)
     {
-        setType(Type::ExpoDecay);
+        init();
+    }
+
+    ~EnvelopeTableGenerator()
+    {
+        cancelUpdate();
     }
 
     void setType(Type t)
     {
         type = t;
-        updateTable();
+        requestUpdate();
     }
 
     void setMorph(float m)
     {
         morph = CLAMP(m, 0.0f, 1.0f);
-        updateTable();
-    }
-
-    float next(float index)
-    {
-        return linearInterpolation(index, sampleCount, lut);
+        requestUpdate();
     }
 
     float sample(float* index, float freq) override
@@ -83,35 +82,26 @@ public:
         return &lut[(uint16_t)(*index * sampleCount)];
     }
 
-    float* samples() override
-    {
-        return lut;
-    }
-
 private:
     LookupTable* sharedLut;
-    Type type = Type::ExpoDecay;
-    float morph = 0.0f;
-    float lut[LOOKUP_TABLE_SIZE];
-
-    static float linearInterpolation(float index, uint64_t size, const float* table)
-    {
-        float fIndex = index * size;
-        int i0 = static_cast<int>(fIndex) % size;
-        int i1 = (i0 + 1) % size;
-        float frac = fIndex - static_cast<float>(i0);
-        return table[i0] * (1.0f - frac) + table[i1] * frac;
-    }
+    // Read by the worker while building the table
+    std::atomic<Type> type = Type::ExpoDecay;
+    std::atomic<float> morph = 0.0f;
 
-    void updateTable()
+    TableCache::Fill recipe(uint64_t& key) override
     {
-        for (uint64_t i = 0; i < sampleCount; ++i) {
-            float x = static_cast<float>(i) / (float)sampleCount;
-            lut[i] = generateEnvelopeValue(x);
-        }
+        Type t = type;
+        float m = morph;
+        key = TableCache::key("Envelope", { (float)t, m });
+        return [this, t, m](float* table) {
+            for (uint64_t i = 0; i < sampleCount; ++i) {
+                float x = static_cast<float>(i) / (float)sampleCount;
+                table[i] = generateEnvelopeValue(x, t, m);
+            }
+        };
     }
 
-    float generateEnvelopeValue(float x) const
+    static float generateEnvelopeValue(float x, Type type, float morph)
     {
         switch (type) {
         case Type::ExpoDecay: {
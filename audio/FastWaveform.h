@@ -19,7 +19,7 @@ This tool can create several fundamental shapes:
 
 **Control and Operation**
 
-You initialize the generator by providing the system's **Sample Rate** (how often values are calculated) and the desired **Rate** (the frequency of the waveform). The system uses an internal mechanism to efficiently select and run the correct mathematical formula for the chosen waveform type, allowing instantaneous switching between shapes without code clutter. The `process()` function is then called repeatedly to get the next calculated value in the sequence.
+You initialize the generator by providing the system's **Sample Rate** (how often values are calculated) and the desired **Rate** (the frequency of the waveform). The system uses an internal mechanism to efficiently select and run the correct mathematical formula for the chosen waveform type, allowing instantaneous switching between shapes without code clutter. The `process()` function is then called repeatedly to get the next calculated value in the sequence. Square, sawtooth and triangle are band-limited with PolyBLEP/PolyBLAMP, so they can also be used as audio rate oscillators without aliasing.
 
 sha: f46c696ceec108fa1f59485cbb1aca71bfd0862e1529310f9d47c685fb556712 
 */
@@ -28,6 +28,8 @@ sha: f46c696ceec108fa1f59485cbb1aca71bfd0862e1529310f9d47c685fb556712
 #include <cstdint>
 #include <stdlib.h>
 
+#include "audio/BlepOscillatorBank.h"
+
 class FastWaveform {
 public:
     enum Type {
@@ -53,6 +55,8 @@ public:
     {
         rate = r;
         phaseIncrement = rate / sampleRate;
+        // Residuals limited to half a period, as for BlepOscillatorBank
+        invIncrement = 1.0f / fminf(fmaxf(phaseIncrement, 1e-6f), 0.49f);
     }
 
     void setType(Type wave)
@@ -132,11 +136,13 @@ private:
     Type type;
     float phase = 0.0f;
     float phaseIncrement;
+    float invIncrement;
     float (FastWaveform::*processFunc)() = nullptr;
 
     float processSquare()
     {
         float value = (phase < 0.5f) ? 1.0f : -1.0f;
+        value += polyBlep(phase, invIncrement) - polyBlep(wrapPhase(phase + 0.5f), invIncrement);
         phase += phaseIncrement;
         if (phase >= 1.0f)
             phase -= 1.0f;
@@ -147,6 +153,7 @@ private:
     {
         // float value = 2.0f * fabs(2.0f * phase - 1.0f) - 1.0f;
         float value = (phase < 0.5f) ? (4.0f * phase - 1.0f) : (3.0f - 4.0f * phase); // Alternate formula to fabs for efficiency
+        value += 4.0f * phaseIncrement * (polyBlamp(phase, invIncrement) - polyBlamp(wrapPhase(phase + 0.5f), invIncrement));
         phase += phaseIncrement;
         if (phase >= 1.0f)
             phase -= 1.0f;
@@ -155,7 +162,7 @@ private:
 
     float processSawtooth()
     {
-        float value = 2.0f * phase - 1.0f;
+        float value = 2.0f * phase - 1.0f - polyBlep(phase, invIncrement);
         phase += phaseIncrement;
         if (phase >= 1.0f)
             phase -= 1.0f;
@@ -164,7 +171,7 @@ private:
 
     float processReverseSawtooth()
     {
-        float value = 1.0f - 2.0f * phase;
+        float value = 1.0f - 2.0f * phase + polyBlep(phase, invIncrement);
         phase += phaseIncrement;
         if (phase >= 1.0f)
             phase -= 1.0f;
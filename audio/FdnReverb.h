@@ -0,0 +1,256 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <mutex>
+
+#include "audio/utils/float4.h"
+#include "plugins/audio/utils/PluginArena.h"
+
+#ifndef FDN_REVERB_SLOTS
+#define FDN_REVERB_SLOTS 8
+#endif
+
+// Delay memory of the FDN reverbs, shared by all the plugins of the process.
+//
+// The memory of FDN_REVERB_SLOTS reverbs is allocated once, the first time a reverb is created, and a reverb only
+// takes a slot while it is active. Taking and giving back a slot never locks nor allocates, so it can be done by
+// the audio thread when an effect is selected.
+class FdnReverbPool {
+protected:
+    std::mutex mtx;
+    float* memory = NULL;
+    uint32_t slotSize = 0;
+    std::atomic<bool> used[FDN_REVERB_SLOTS] = {};
+
+public:
+    static FdnReverbPool& get()
+    {
+        static FdnReverbPool pool;
+        return pool;
+    }
+
+    ~FdnReverbPool()
+    {
+        free(memory);
+    }
+
+    // Allocate the slots of `size` floats, if not already done. Must be called outside of the audio thread.
+    void init(uint32_t size)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        if (!memory) {
+            memory = (float*)PluginArena::heapAllocate((size_t)size * FDN_REVERB_SLOTS * sizeof(float));
+            slotSize = memory ? size : 0;
+        }
+    }
+
+    uint32_t size()
+    {
+        return slotSize;
+    }
+
+    // Index of a free slot, or -1 if they are all used
+    int acquire()
+    {
+        for (int i = 0; i < FDN_REVERB_SLOTS && memory; i++) {
+            bool expected = false;
+            if (used[i].compare_exchange_strong(expected, true)) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    void release(int slot)
+    {
+        if (slot >= 0 && slot < FDN_REVERB_SLOTS) {
+            used[slot].store(false);
+        }
+    }
+
+    float* data(int slot)
+    {
+        return memory + (size_t)slot * slotSize;
+    }
+};
+
+// Feedback delay network reverb: 8 delay lines of mutually prime lengths, mixed back into each other by a
+// Householder matrix, each line having its own damping low pass and a feedback gain matching the decay time.
+//
+// The 8 lines are processed 4 at a time in the SIMD registers. The Householder matrix being `I - 2/8` for all the
+// lines, mixing them only costs a sum. The output is taken from the lines with orthogonal sign patterns, so the
+// left and right channels are decorrelated from a mono input.
+//
+// The delay memory is only held while the reverb is active, see `activate()` and `FdnReverbPool`.
+class FdnReverb {
+public:
+    static const uint8_t LINES = 8;
+
+protected:
+    // Longest lengths of the lines at 48kHz, for a size of 100%
+    static constexpr uint32_t MAX_LENGTHS[LINES] = { 1433, 1601, 1867, 2053, 2251, 2399, 2617, 2797 };
+
+    uint32_t sampleRate;
+    int slot = -1;
+    float* lines[LINES] = {};
+    uint32_t maxLength[LINES];
+    uint32_t length[LINES];
+    uint32_t position[LINES] = {};
+
+    alignas(16) float gain[LINES];
+    alignas(16) float lowpass[LINES] = {};
+    alignas(16) float inputSigns[LINES] = { 1.0f, 1.0f, 1.0f, 1.0f, -1.0f, -1.0f, -1.0f, -1.0f };
+    alignas(16) float leftSigns[LINES] = { 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f, 1.0f, -1.0f };
+    alignas(16) float rightSigns[LINES] = { 1.0f, 1.0f, -1.0f, -1.0f, 1.0f, 1.0f, -1.0f, -1.0f };
+
+    float decay = 2.0f;
+    float damping = 0.3f;
+    float size = 1.0f;
+
+    void updateGains()
+    {
+        for (uint8_t i = 0; i < LINES; i++) {
+            // -60dB after `decay` seconds
+            gain[i] = powf(10.0f, -3.0f * length[i] / (decay * sampleRate));
+        }
+    }
+
+public:
+    FdnReverb(uint32_t sampleRate)
+        : sampleRate(sampleRate)
+    {
+        uint32_t total = 0;
+        for (uint8_t i = 0; i < LINES; i++) {
+            maxLength[i] = std::max((uint32_t)(MAX_LENGTHS[i] * (uint64_t)sampleRate / 48000), (uint32_t)1);
+            length[i] = maxLength[i];
+            total += maxLength[i];
+        }
+        FdnReverbPool::get().init(total);
+        updateGains();
+    }
+
+    ~FdnReverb()
+    {
+        deactivate();
+    }
+
+    // Take a slot of the pool, return false if none is left, in which case the reverb passes the signal through
+    bool activate()
+    {
+        if (slot == -1) {
+            FdnReverbPool& pool = FdnReverbPool::get();
+            uint32_t total = 0;
+            for (uint8_t i = 0; i < LINES; i++) {
+                total += maxLength[i];
+            }
+            // The pool was sized by a reverb running at another sample rate
+            if (total > pool.size()) {
+                return false;
+            }
+            slot = pool.acquire();
+            if (slot == -1) {
+                return false;
+            }
+            float* data = pool.data(slot);
+            memset(data, 0, total * sizeof(float));
+            for (uint8_t i = 0; i < LINES; i++) {
+                lines[i] = data;
+                data += maxLength[i];
+                position[i] = 0;
+                lowpass[i] = 0.0f;
+            }
+        }
+        return true;
+    }
+
+    void deactivate()
+    {
+        if (slot != -1) {
+            FdnReverbPool::get().release(slot);
+            slot = -1;
+        }
+    }
+
+    bool isActive()
+    {
+        return slot != -1;
+    }
+
+    // Time for the tail to decay by 60dB, in seconds
+    void setDecay(float seconds)
+    {
+        decay = std::max(seconds, 0.05f);
+        updateGains();
+    }
+
+    // From 0 (bright) to 1 (dark)
+    void setDamping(float value)
+    {
+        damping = std::clamp(value, 0.0f, 1.0f);
+    }
+
+    // From 0.1 to 1, scaling the length of the lines
+    void setSize(float value)
+    {
+        size = std::clamp(value, 0.1f, 1.0f);
+        for (uint8_t i = 0; i < LINES; i++) {
+            length[i] = std::max((uint32_t)(maxLength[i] * size), (uint32_t)1);
+            position[i] %= length[i];
+        }
+        updateGains();
+    }
+
+    // Wet signal only, mono input
+    void process(float in, float& left, float& right)
+    {
+        if (slot == -1) {
+            left = in;
+            right = in;
+            return;
+        }
+        using namespace float4;
+        alignas(16) float x[LINES];
+        for (uint8_t i = 0; i < LINES; i++) {
+            x[i] = lines[i][position[i]];
+        }
+        v4 lp = set(1.0f - damping * 0.9f);
+        v4 l = set(0.0f);
+        v4 r = set(0.0f);
+        v4 total = set(0.0f);
+        for (uint8_t i = 0; i < LINES; i += WIDTH) {
+            v4 state = load(lowpass + i);
+            state = add(state, mul(lp, sub(load(x + i), state)));
+            store(lowpass + i, state);
+            l = add(l, mul(state, load(leftSigns + i)));
+            r = add(r, mul(state, load(rightSigns + i)));
+            total = add(total, state);
+        }
+        // Householder matrix
+        v4 householder = set(sum(total) * (2.0f / LINES));
+        v4 input = set(in * 0.35f);
+        for (uint8_t i = 0; i < LINES; i += WIDTH) {
+            v4 y = mul(sub(load(lowpass + i), householder), load(gain + i));
+            store(x + i, add(y, mul(input, load(inputSigns + i))));
+        }
+        for (uint8_t i = 0; i < LINES; i++) {
+            lines[i][position[i]] = x[i];
+            if (++position[i] >= length[i]) {
+                position[i] = 0;
+            }
+        }
+        left = sum(l) * 0.35f;
+        right = sum(r) * 0.35f;
+    }
+
+    // Wet signal only, mono input and output
+    float process(float in)
+    {
+        float left, right;
+        process(in, left, right);
+        return (left + right) * 0.5f;
+    }
+};
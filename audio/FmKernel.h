@@ -0,0 +1,172 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <utility>
+
+#include "audio/utils/float4.h"
+
+// Four FM operators rendered by chunks, one operator at a time over the whole chunk instead of the four operators
+// for each sample: an operator only modulates the operators after it, so once an operator is rendered, the
+// modulation of the next ones is known for the whole chunk.
+//
+// Each algorithm is a template instance: the connections of the table are resolved at compile time, the routing and
+// the mix being straight-line loops over the chunk. For each operator, only the phase accumulation is serial, the
+// lookup, the envelope, the routing and the mix running on 4 frames at once with SSE2 or NEON (see float4.h).
+namespace FmKernel {
+
+static const int OPS = 4;
+static const uint32_t CHUNK = 64;
+
+// Operator `i` modulates operator `j + 1` when `ALGORITHMS[a][i][j]` is set, the last operator is always a carrier.
+// An operator modulating itself or an operator before it has no effect, but is not a carrier either.
+constexpr bool ALGORITHMS[12][OPS - 1][OPS - 1] = {
+    { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+    { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
+    { { 0, 0, 1 }, { 0, 1, 0 }, { 0, 0, 1 } },
+    { { 1, 1, 0 }, { 0, 0, 1 }, { 0, 0, 1 } },
+    { { 1, 0, 0 }, { 0, 1, 1 }, { 0, 0, 0 } },
+    { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 0 } },
+    { { 0, 0, 1 }, { 0, 0, 1 }, { 0, 0, 1 } },
+    { { 1, 0, 0 }, { 0, 0, 0 }, { 0, 0, 1 } },
+    { { 1, 1, 1 }, { 0, 0, 0 }, { 0, 0, 0 } },
+    { { 1, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } },
+    { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } },
+    { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 0 } },
+};
+constexpr int ALGORITHM_COUNT = sizeof(ALGORITHMS) / sizeof(ALGORITHMS[0]);
+
+constexpr bool modulates(int algo, int from, int to)
+{
+    return from < OPS - 1 && to > from && ALGORITHMS[algo][from][to - 1];
+}
+
+constexpr bool isCarrier(int algo, int op)
+{
+    return op == OPS - 1 || !(ALGORITHMS[algo][op][0] || ALGORITHMS[algo][op][1] || ALGORITHMS[algo][op][2]);
+}
+
+struct Operator {
+    // Phase in the sine table
+    float index = 0.0f;
+    // Table steps per sample without modulation
+    float step = 0.0f;
+};
+
+// Buffers of a chunk: the envelope of each operator is filled by the caller, e.g. with `Envelop::render()`
+struct Chunk {
+    alignas(16) float env[OPS][CHUNK];
+    alignas(16) float mod[OPS][CHUNK];
+    alignas(16) float phase[CHUNK];
+    alignas(16) float value[CHUNK];
+    alignas(16) float sum[CHUNK];
+    alignas(16) float carriers[CHUNK];
+};
+
+template <int ALGO, int I>
+inline void renderOperator(Operator& op, Chunk& c, const float* sine, uint32_t size, uint32_t frames)
+{
+    // An operator is only silent while its envelope is 0, its phase not moving meanwhile
+    float index = op.index;
+    for (uint32_t f = 0; f < frames; f++) {
+        if (c.env[I][f] > 0.0f) {
+            if constexpr (I == 0) {
+                index += op.step;
+            } else {
+                index += op.step * (1.0f + c.mod[I][f]);
+            }
+            while (index >= size) {
+                index -= size;
+            }
+            // A modulation below -1 runs the phase backward
+            while (index < 0.0f) {
+                index += size;
+            }
+        }
+        c.phase[f] = index;
+    }
+    op.index = index;
+
+    uint32_t f = 0;
+    int32_t idx[float4::WIDTH];
+    float a[float4::WIDTH], b[float4::WIDTH];
+    for (; f + float4::WIDTH <= frames; f += float4::WIDTH) {
+        float4::v4 phase = float4::load(c.phase + f);
+        float4::v4 floor = float4::floor(phase);
+        float4::toIndex(floor, idx);
+        for (int k = 0; k < float4::WIDTH; k++) {
+            int32_t next = idx[k] + 1;
+            a[k] = sine[idx[k]];
+            b[k] = sine[next == (int32_t)size ? 0 : next];
+        }
+        float4::v4 va = float4::load(a);
+        float4::v4 s = float4::add(va, float4::mul(float4::sub(phase, floor), float4::sub(float4::load(b), va)));
+        float4::store(c.value + f, float4::mul(s, float4::load(c.env[I] + f)));
+    }
+    for (; f < frames; f++) {
+        int32_t i = (int32_t)c.phase[f];
+        int32_t next = i + 1 == (int32_t)size ? 0 : i + 1;
+        float t = c.phase[f] - i;
+        c.value[f] = (sine[i] * (1.0f - t) + sine[next] * t) * c.env[I][f];
+    }
+
+    // Silent operators output 0, so they add nothing to the modulation and the mix, but they don't count as carriers
+    for (uint32_t f = 0; f < frames; f++) {
+        if constexpr (modulates(ALGO, I, 1)) {
+            c.mod[1][f] += c.value[f];
+        }
+        if constexpr (modulates(ALGO, I, 2)) {
+            c.mod[2][f] += c.value[f];
+        }
+        if constexpr (modulates(ALGO, I, 3)) {
+            c.mod[3][f] += c.value[f];
+        }
+        if constexpr (isCarrier(ALGO, I)) {
+            c.sum[f] += c.value[f];
+            c.carriers[f] += c.env[I][f] > 0.0f ? 1.0f : 0.0f;
+        }
+    }
+}
+
+template <int ALGO, int... I>
+inline void renderOperators(Operator* ops, Chunk& c, const float* sine, uint32_t size, uint32_t frames, std::integer_sequence<int, I...>)
+{
+    (renderOperator<ALGO, I>(ops[I], c, sine, size, frames), ...);
+}
+
+// Render `frames` (up to `CHUNK`) frames of the voice. Like the per sample engine it replaces, the carriers are
+// averaged while the last operator plays, and summed once it is silent.
+template <int ALGO>
+void render(Operator* ops, Chunk& c, const float* sine, uint32_t size, float* out, uint32_t frames)
+{
+    for (int i = 0; i < OPS; i++) {
+        for (uint32_t f = 0; f < frames; f++) {
+            c.mod[i][f] = 0.0f;
+        }
+    }
+    for (uint32_t f = 0; f < frames; f++) {
+        c.sum[f] = 0.0f;
+        c.carriers[f] = 0.0f;
+    }
+    renderOperators<ALGO>(ops, c, sine, size, frames, std::make_integer_sequence<int, OPS> {});
+    for (uint32_t f = 0; f < frames; f++) {
+        out[f] = c.env[OPS - 1][f] > 0.0f ? c.sum[f] / c.carriers[f] : c.sum[f];
+    }
+}
+
+typedef void (*RenderFn)(Operator* ops, Chunk& c, const float* sine, uint32_t size, float* out, uint32_t frames);
+
+template <int... A>
+constexpr std::array<RenderFn, sizeof...(A)> renderTable(std::integer_sequence<int, A...>)
+{
+    return { &render<A>... };
+}
+
+// Renderer of each algorithm, `algorithm - 1` for the `ALGO` value of the plugins
+inline RenderFn getRender(int algo)
+{
+    static constexpr std::array<RenderFn, ALGORITHM_COUNT> table = renderTable(std::make_integer_sequence<int, ALGORITHM_COUNT> {});
+    return table[algo < 0 ? 0 : algo >= ALGORITHM_COUNT ? ALGORITHM_COUNT - 1 : algo];
+}
+
+} // namespace FmKernel
@@ -0,0 +1,134 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "audio/utils/float4.h"
+
+// State of `MAX` grains stored per field (structure of arrays), each grain reading `data` from its position with its
+// own increment, gain and trapezoid envelope.
+//
+// Grains are rendered one at a time over a span of frames, 4 frames per SIMD iteration: the span stops on the
+// frame where the grain ends or leaves the buffer, so the owner restarts it right there, at its frame offset in the
+// block, instead of checking every grain on every sample.
+template <int MAX>
+class GrainPool {
+public:
+    alignas(16) float position[MAX] = {};
+    alignas(16) float increment[MAX] = {};
+    alignas(16) float gain[MAX] = {};
+    // Envelope position in [0, 1] over the grain duration
+    alignas(16) float envPhase[MAX] = {};
+    alignas(16) float envIncrement[MAX] = {};
+    // Frames left before the end of the grain
+    uint32_t remaining[MAX] = {};
+
+protected:
+    // Fraction of the grain fading in, and out, 0 for no envelope
+    float fade = 0.0f;
+    float invFade = 0.0f;
+
+    // Frames before the grain position leaves [0, last]
+    uint32_t framesInBounds(int g, float last)
+    {
+        float pos = position[g];
+        float inc = increment[g];
+        if (pos < 0.0f || pos > last) {
+            return 0;
+        }
+        if (inc == 0.0f) {
+            return UINT32_MAX;
+        }
+        float frames = inc > 0.0f ? (last - pos) / inc : pos / -inc;
+        return frames >= UINT32_MAX - 1 ? UINT32_MAX : (uint32_t)frames + 1;
+    }
+
+public:
+    // Trapezoid envelope, `value` being the fraction of the grain fading in and the fraction fading out, till 0.5
+    void setFade(float value)
+    {
+        fade = std::clamp(value, 0.0f, 0.5f);
+        invFade = fade > 0.0f ? 1.0f / fade : 0.0f;
+    }
+
+    void start(int g, float pos, float inc, uint32_t duration, float _gain = 1.0f)
+    {
+        position[g] = pos;
+        increment[g] = inc;
+        gain[g] = _gain;
+        remaining[g] = duration;
+        envPhase[g] = 0.0f;
+        envIncrement[g] = duration > 0 ? 1.0f / duration : 0.0f;
+    }
+
+    // Add up to `frames` samples of the grain `g` to `out`, reading `data` of `size` samples, and return the number
+    // of frames added: less than `frames` when the grain ends or reaches the edge of the buffer. With `wrap`, the
+    // buffer is circular and the grain only ends with its duration.
+    uint32_t render(int g, float* out, uint32_t frames, const float* data, uint64_t size, bool wrap = false)
+    {
+        if (size < 2) {
+            return 0;
+        }
+        const float last = size - 1;
+        const int32_t lastIndex = size - 1;
+        uint32_t done = 0;
+        while (done < frames && remaining[g] > 0) {
+            uint32_t span = std::min(frames - done, remaining[g]);
+            uint32_t bounded = framesInBounds(g, last);
+            if (bounded == 0) {
+                if (!wrap) {
+                    break;
+                }
+                // On the circular buffer, continue on the other side
+                position[g] = position[g] >= size ? position[g] - size : position[g] + size;
+                bounded = framesInBounds(g, last);
+                if (bounded == 0) {
+                    // Between the last and the first sample
+                    position[g] = increment[g] > 0.0f ? 0.0f : last;
+                    continue;
+                }
+            }
+            span = std::min(span, bounded);
+
+            float pos = position[g];
+            float inc = increment[g];
+            float env = envPhase[g];
+            float envInc = envIncrement[g];
+            float amp = gain[g];
+            float* o = out + done;
+            uint32_t f = 0;
+#if defined(FLOAT4)
+            using namespace float4;
+            const float steps[4] = { 0.0f, 1.0f, 2.0f, 3.0f };
+            v4 offsets = load(steps);
+            for (; f + 4 <= span; f += 4) {
+                v4 p = add(set(pos + f * inc), mul(offsets, set(inc)));
+                v4 s = mul(lerp(data, clamp(p, 0.0f, last), lastIndex), set(amp));
+                if (fade > 0.0f) {
+                    v4 e = add(set(env + f * envInc), mul(offsets, set(envInc)));
+                    v4 shape = min(min(mul(e, set(invFade)), mul(sub(set(1.0f), e), set(invFade))), set(1.0f));
+                    s = mul(s, max(shape, set(0.0f)));
+                }
+                store(o + f, add(load(o + f), s));
+            }
+#endif
+            for (; f < span; f++) {
+                float p = std::clamp(pos + f * inc, 0.0f, last);
+                int32_t i = std::min((int32_t)p, lastIndex - 1);
+                float s = (data[i] + (data[i + 1] - data[i]) * (p - i)) * amp;
+                if (fade > 0.0f) {
+                    float e = env + f * envInc;
+                    s *= std::max(std::min({ e * invFade, (1.0f - e) * invFade, 1.0f }), 0.0f);
+                }
+                o[f] += s;
+            }
+
+            position[g] = pos + span * inc;
+            envPhase[g] = env + span * envInc;
+            remaining[g] -= span;
+            done += span;
+        }
+        return done;
+    }
+};
@@ -1,11 +1,11 @@
 /** Description:
 This file defines a sophisticated audio processing mechanism called `Grains`, which implements a technique known as granular synthesis. This method generates complex sounds by simultaneously playing numerous tiny fragments of source audio, known as "grains."
 
-The system manages a set of individual playback units, up to a maximum of 16. It relies on external components: a source of raw audio data and a table used to generate random values for randomization effects.
+The system manages a set of individual playback units, up to a maximum of 64. It relies on external components: a source of raw audio data and a table used to generate random values for randomization effects.
 
 **How it Works:**
 
-The `Grains` mechanism constantly runs through all active playback units. For each unit, it determines the current position within the source audio. If a grain reaches the end of its set duration, it is instantly restarted.
+The `Grains` mechanism renders the grains a small block ahead, through a pool storing the grain state per field so each grain is interpolated 4 frames at a time. If a grain reaches the end of its set duration, it is restarted on that exact frame of the block.
 
 When a grain starts, its properties are calculated based on user settings:
 1.  **Density:** Controls how many grains are active at once. The output volume is automatically adjusted to maintain a natural loudness level as density increases.
@@ -20,17 +20,19 @@ sha: 9c8aaddb6bb9547522139decfcda04f8c444b1f2f95fb42b6b46b40c01000130
 
 #include <cmath>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 
 #include "helpers/clamp.h"
+#include "audio/GrainPool.h"
 #include "audio/lookupTable.h"
 
-#define MAX_GRAINS 16
+#define MAX_GRAINS 64
 
 class Grains {
 protected:
     LookupTable* lookupTable;
-    std::function<float(uint64_t)> sampleCallback;
+    std::function<const float*()> dataCallback;
 
     uint64_t grainDuration = 0;
     uint64_t grainDelay = 0;
@@ -41,17 +43,16 @@ protected:
     float detune = 0.0f;
     uint8_t density = 1;
 
-    struct Grain {
-        uint64_t index = 0;
-        float position = 0.0f;
-        float positionIncrement = 1.0f;
-    } grains[MAX_GRAINS];
+    GrainPool<MAX_GRAINS> pool;
 
-    void initGrain(uint8_t densityIndex, uint64_t sampleIndex, float stepIncrement, uint64_t sampleCount)
+    // Output rendered ahead, returned sample by sample by `getGrainSample()`
+    static const uint32_t BLOCK = 32;
+    float block[BLOCK];
+    uint32_t blockPos = BLOCK;
+
+    void initGrain(uint8_t densityIndex, float sampleIndex, float stepIncrement, uint64_t sampleCount)
     {
-        Grain& grain = grains[densityIndex];
-        grain.index = 0;
-        grain.position = CLAMP(sampleIndex + densityIndex * grainDelay + grainDelay * getRand() * delayRandomize, 0.0f, sampleCount - 1.0f);
+        float position = CLAMP(sampleIndex + densityIndex * grainDelay + grainDelay * getRand() * delayRandomize, 0.0f, sampleCount - 1.0f);
 
         float dir = direction == FORWARD ? 1.0f : (direction == BACKWARD ? -1.0f : getRand());
 
@@ -75,7 +76,32 @@ protected:
             }
         }
 
-        grain.positionIncrement = stepIncrement * pitchRand * pitchDetune * dir;
+        pool.start(densityIndex, position, stepIncrement * pitchRand * pitchDetune * dir, grainDuration);
+    }
+
+    // Render the next `BLOCK` frames, the playhead moving by `stepIncrement` per frame from `sampleIndex`
+    void renderBlock(float stepIncrement, uint64_t sampleIndex, uint64_t sampleCount)
+    {
+        memset(block, 0, sizeof(block));
+        const float* data = dataCallback();
+        if (!data || sampleCount < 2) {
+            return;
+        }
+        for (uint8_t i = 0; i < density; i++) {
+            uint32_t done = pool.render(i, block, BLOCK, data, sampleCount);
+            while (done < BLOCK) {
+                // Restarted on the frame it ended, from the playhead at that frame
+                initGrain(i, sampleIndex + done * stepIncrement, stepIncrement, sampleCount);
+                uint32_t count = pool.render(i, block + done, BLOCK - done, data, sampleCount);
+                if (count == 0) {
+                    break;
+                }
+                done += count;
+            }
+        }
+        for (uint32_t f = 0; f < BLOCK; f++) {
+            block[f] *= densityDivider;
+        }
     }
 
     float getRand()
@@ -98,29 +124,22 @@ public:
     } detuneMode
         = POSITIVE;
 
-    Grains(LookupTable* lookupTable, std::function<float(uint64_t)> sampleCallback)
+    // `dataCallback` returns the samples the grains are reading
+    Grains(LookupTable* lookupTable, std::function<const float*()> dataCallback)
         : lookupTable(lookupTable)
-        , sampleCallback(sampleCallback)
+        , dataCallback(dataCallback)
     {
     }
 
+    // Next sample of the grains, rendered by blocks: the settings and the playhead are taken into account at the
+    // start of each block
     float getGrainSample(float stepIncrement, uint64_t sampleIndex, uint64_t sampleCount)
     {
-        float out = 0.0f;
-        for (uint8_t i = 0; i < density; i++) {
-            Grain& grain = grains[i];
-            if (grain.index++ < grainDuration) {
-                grain.position += grain.positionIncrement;
-                if (grain.position <= 0 || grain.position >= sampleCount) {
-                    initGrain(i, sampleIndex, stepIncrement, sampleCount);
-                }
-            } else {
-                initGrain(i, sampleIndex, stepIncrement, sampleCount);
-            }
-            out += sampleCallback((uint64_t)grain.position);
+        if (blockPos == BLOCK) {
+            renderBlock(stepIncrement, sampleIndex, sampleCount);
+            blockPos = 0;
         }
-        out = out * densityDivider;
-        return out;
+        return block[blockPos++];
     }
 
     void setDelayRandomize(float value) { delayRandomize = value; } // [0.0, 1.0f]
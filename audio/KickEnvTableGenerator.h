@@ -18,32 +18,31 @@ sha: 56c1342cab0ad8632e086dedfbeb8769be68d5ed8869b2cf7b00f5c92d64455b
 #pragma once
 
 #include "helpers/clamp.h"
-#include "audio/WavetableInterface.h"
-#include "audio/lookupTable.h"
+#include "audio/TableBuilder.h"
+#include <atomic>
 #include <cmath>
 
-class KickEnvTableGenerator : public WavetableInterface {
+class KickEnvTableGenerator : public TableGenerator {
 public:
     KickEnvTableGenerator()
-        : WavetableInterface(LOOKUP_TABLE_SIZE)
     {
-        setMorph(0.0f);
+        init();
+    }
+
+    ~KickEnvTableGenerator()
+    {
+        cancelUpdate();
     }
 
     // Morph is normalized 0.0 → 1.0
     void setMorph(float m)
     {
         morph = CLAMP(m, 0.0f, 0.9999f);
-        updateTable();
+        requestUpdate();
     }
 
     float getMorph() const { return morph; }
 
-    float next(float index)
-    {
-        return linearInterpolation(index, sampleCount, lut);
-    }
-
     float sample(float* index, float freq) override
     {
         float phaseIncrement = freq / static_cast<float>(sampleCount);
@@ -58,23 +57,9 @@ public:
         return &lut[static_cast<uint16_t>(*index * sampleCount)];
     }
 
-    float* samples() override
-    {
-        return lut;
-    }
-
 private:
-    float morph = 0.0f;
-    float lut[LOOKUP_TABLE_SIZE];
-
-    static float linearInterpolation(float index, uint64_t size, const float* table)
-    {
-        float fIndex = index * size;
-        int i0 = static_cast<int>(fIndex) % size;
-        int i1 = (i0 + 1) % size;
-        float frac = fIndex - static_cast<float>(i0);
-        return table[i0] * (1.0f - frac) + table[i1] * frac;
-    }
+    // Read by the worker while building the table
+    std::atomic<float> morph = 0.0f;
 
     // --- Envelope shape helpers ---
     inline float shapeExp(float x, float sharp) const { return std::exp(-sharp * x); }
@@ -104,15 +89,19 @@ private:
         return t * t * (3.0f - 2.0f * t);
     }
 
-    void updateTable()
+    TableCache::Fill recipe(uint64_t& key) override
     {
-        for (uint64_t i = 0; i < sampleCount; ++i) {
-            float x = static_cast<float>(i) / static_cast<float>(sampleCount);
-            lut[i] = generateEnvelopeValue(x);
-        }
+        float m = morph;
+        key = TableCache::key("KickEnv", { m });
+        return [this, m](float* table) {
+            for (uint64_t i = 0; i < sampleCount; ++i) {
+                float x = static_cast<float>(i) / static_cast<float>(sampleCount);
+                table[i] = generateEnvelopeValue(x, m);
+            }
+        };
     }
 
-    float generateEnvelopeValue(float x) const
+    float generateEnvelopeValue(float x, float morph) const
     {
         // non-linear morph curve for expressive control
         float m = std::pow(morph, 1.2f);
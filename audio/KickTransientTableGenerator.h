@@ -5,7 +5,7 @@ The class operates as an audio generator (a Wavetable Interface) that pre-calcul
 
 The core feature is a parameter called "morph," which controls the exact characteristics of the kick sound. This morph value ranges from 0.0 to 1.0 and allows for smooth blending between 13 different internal mathematical formulas. These formulas describe various acoustic behaviors, ranging from sharp, noisy attacks to deep, exponentially decaying tones.
 
-When the morph value is adjusted, the class instantly updates its entire Look-Up Table by performing interpolation—it mixes the output of two adjacent sound formulas according to the morph position. This technique provides a continuous spectrum of unique kick sounds, rather than just 13 fixed options.
+When the morph value is adjusted, the class rebuilds its entire Look-Up Table by performing interpolation—it mixes the output of two adjacent sound formulas according to the morph position. This technique provides a continuous spectrum of unique kick sounds, rather than just 13 fixed options. The table is built on a background worker and swapped in at the start of the next block, so the sound never glitches while the knob turns.
 
 An audio engine retrieves samples from this generator using methods that ensure smooth playback, typically by employing linear interpolation to read samples precisely, even when reading between stored index points in the table. This results in a highly flexible and efficient tool for crafting complex percussive sounds.
 
@@ -14,34 +14,33 @@ sha: ff5e042c4864a299f3e35c2ee3b42b85835437e8416d5c8c72d8dc40e838295b
 #pragma once
 
 #include "helpers/clamp.h"
-#include "audio/WavetableInterface.h"
-#include "audio/lookupTable.h"
+#include "audio/TableBuilder.h"
 
 #include <array>
+#include <atomic>
 #include <cmath>
 #include <cstdlib>
 
-class KickTransientTableGenerator : public WavetableInterface {
+class KickTransientTableGenerator : public TableGenerator {
 public:
     KickTransientTableGenerator()
-        : WavetableInterface(LOOKUP_TABLE_SIZE)
     {
-        setMorph(0.0f);
+        init();
+    }
+
+    ~KickTransientTableGenerator()
+    {
+        cancelUpdate();
     }
 
     void setMorph(float m)
     {
         morph = CLAMP(m, 0.0f, 1.0f);
-        updateTable();
+        requestUpdate();
     }
 
     float getMorph() const { return morph; }
 
-    float next(float index)
-    {
-        return linearInterpolation(index, sampleCount, lut);
-    }
-
     float sample(float* index, float /*freq*/) override
     {
         *index += 1.0f / static_cast<float>(sampleCount);
@@ -55,30 +54,20 @@ public:
         return &lut[static_cast<uint64_t>(*index * sampleCount)];
     }
 
-    float* samples() override
-    {
-        return lut;
-    }
-
 private:
-    float morph = 0.0f;
-    float lut[LOOKUP_TABLE_SIZE];
-
-    static float linearInterpolation(float index, uint64_t size, const float* table)
-    {
-        float fIndex = index * size;
-        int i0 = static_cast<int>(fIndex) % size;
-        int i1 = (i0 + 1) % size;
-        float frac = fIndex - static_cast<float>(i0);
-        return table[i0] * (1.0f - frac) + table[i1] * frac;
-    }
+    // Read by the worker while building the table
+    std::atomic<float> morph = 0.0f;
 
-    void updateTable()
+    TableCache::Fill recipe(uint64_t& key) override
     {
-        for (uint64_t i = 0; i < sampleCount; ++i) {
-            float x = static_cast<float>(i) / static_cast<float>(sampleCount);
-            lut[i] = generateTransient(x, morph);
-        }
+        float m = morph;
+        key = TableCache::key("KickTransient", { m });
+        return [this, m](float* table) {
+            for (uint64_t i = 0; i < sampleCount; ++i) {
+                float x = static_cast<float>(i) / static_cast<float>(sampleCount);
+                table[i] = generateTransient(x, m);
+            }
+        };
     }
 
     static float generateTransient(float x, float morph)
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+
+#include "audio/utils/fastTanh.h"
+#include "audio/utils/float4.h"
+
+// Zero delay feedback model of the 4 pole transistor ladder, each stage being a trapezoidal one pole with a tanh
+// on its input and on its output, and the output fed back to the input.
+//
+// The loop has no unit delay, so each sample solves an implicit equation. Each iteration replaces the tanh of
+// every node by its slope `tanh(v) / v` around the current estimate, the 4 stages being evaluated at once in the
+// SIMD registers; the ladder is then linear, so its output and the feedback are solved exactly. The first guess
+// being the previous sample, 2 iterations are enough, even at self oscillation.
+//
+// The cutoff coefficient is only computed when the cutoff changes, and moves linearly to it over the next block.
+class LadderFilter {
+public:
+    static const uint8_t ITERATIONS = 2;
+
+protected:
+    float sampleRate;
+    float g = 0.1f;
+    float gTarget = 0.1f;
+    float k = 0.0f;
+
+    alignas(16) float state[4] = {};
+    // Stage outputs and input of the last sample, the first guess of the next one
+    alignas(16) float y[4] = {};
+    float u = 0.0f;
+
+public:
+    LadderFilter(float sampleRate)
+        : sampleRate(sampleRate)
+    {
+    }
+
+    void setCutoff(float hz)
+    {
+        hz = std::clamp(hz, 10.0f, sampleRate * 0.45f);
+        gTarget = tanf(M_PI * hz / sampleRate);
+    }
+
+    // From 0 to 1, self oscillating close to 1
+    void setResonance(float value)
+    {
+        k = std::clamp(value, 0.0f, 1.0f) * 4.4f;
+    }
+
+    void reset()
+    {
+        std::fill(state, state + 4, 0.0f);
+        std::fill(y, y + 4, 0.0f);
+        u = 0.0f;
+    }
+
+protected:
+    float tick(float x, float& input)
+    {
+        alignas(16) float outSlopes[4];
+        alignas(16) float inSlopes[4];
+        alignas(16) float a[4];
+        alignas(16) float b[4];
+        for (uint8_t it = 0; it < ITERATIONS; it++) {
+            using namespace float4;
+            for (uint8_t i = 0; i < 4; i += WIDTH) {
+                store(outSlopes + i, float4::tanhSlope(load(y + i)));
+            }
+            // The input of a stage is the output of the previous one
+            inSlopes[0] = ::tanhSlope(u);
+            inSlopes[1] = outSlopes[0];
+            inSlopes[2] = outSlopes[1];
+            inSlopes[3] = outSlopes[2];
+            // y[i] = a[i] * stage input + b[i], from y = s + g * (tanh(in) - tanh(y))
+            v4 gv = set(g);
+            for (uint8_t i = 0; i < 4; i += WIDTH) {
+                v4 inv = div(set(1.0f), add(set(1.0f), mul(gv, load(outSlopes + i))));
+                store(a + i, mul(mul(gv, load(inSlopes + i)), inv));
+                store(b + i, mul(load(state + i), inv));
+            }
+            // Output as a function of the input, then the feedback loop solved for the input
+            float gain = a[0] * a[1] * a[2] * a[3];
+            float offset = ((b[0] * a[1] + b[1]) * a[2] + b[2]) * a[3] + b[3];
+            u = (x - k * offset) / (1.0f + k * gain);
+            y[0] = a[0] * u + b[0];
+            y[1] = a[1] * y[0] + b[1];
+            y[2] = a[2] * y[1] + b[2];
+            y[3] = a[3] * y[2] + b[3];
+        }
+        for (uint8_t i = 0; i < 4; i++) {
+            state[i] = 2.0f * y[i] - state[i];
+        }
+        input = u;
+        return y[3];
+    }
+
+public:
+    // Low pass output of the ladder for the input `x`, `input` being set to the input of the first stage (the
+    // signal minus the feedback)
+    float process(float x, float& input)
+    {
+        g = gTarget;
+        return tick(x, input);
+    }
+
+    // Low pass and high pass crossfaded by `mix` (0 for low pass, 1 for high pass), on `frames` samples of `buf`
+    void processBlock(float* buf, uint32_t stride, uint32_t frames, float mix)
+    {
+        float step = frames > 0 ? (gTarget - g) / frames : 0.0f;
+        for (uint32_t f = 0; f < frames; f++) {
+            g += step;
+            float input;
+            float lp = tick(buf[f * stride], input);
+            buf[f * stride] = lp * (1.0f - mix) + (input - lp) * mix;
+        }
+        g = gTarget;
+    }
+};
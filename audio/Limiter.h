@@ -0,0 +1,158 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "audio/utils/dbTable.h"
+
+// Lookahead compressor / limiter, the channels being linked.
+//
+// The signal is delayed by the lookahead, so the gain can be lowered before a peak reaches the output:
+// - the peak of the last `lookahead + 1` frames is tracked by a running max (monotonic deque, O(1) per frame)
+// - the gain reduction is computed in dB from that peak, only when it is above the threshold
+// - a moving average over the same window turns the steps of the reduction into ramps, reaching the reduction of a
+//   peak exactly when the peak leaves the delay, so with an infinite ratio the output never goes over the threshold
+// - the release is a one pole on the reduction going back up.
+class Limiter {
+protected:
+    DbTable& db;
+    float sampleRate;
+    uint32_t lookahead;
+    uint32_t window;
+    float invWindow;
+
+    // Delayed input, power of 2 so wrapping is a mask
+    std::vector<float> delay[2];
+    uint32_t delayMask;
+    uint64_t frame = 0;
+
+    // Running max: peaks in decreasing order, with the frame they were seen at
+    std::vector<float> peaks;
+    std::vector<uint64_t> peakFrames;
+    uint32_t peakMask;
+    uint32_t head = 0; // oldest
+    uint32_t tail = 0; // next free
+
+    // Moving average of the reduction
+    std::vector<float> reductions;
+    uint32_t reductionPos = 0;
+    double reductionSum = 0.0;
+
+    float thresholdDb = -1.0f;
+    float threshold = 0.0f;
+    float slope = 1.0f;
+    float releaseCoef = 0.0f;
+    float envelope = 0.0f;
+
+    static uint32_t powerOf2(uint32_t n)
+    {
+        uint32_t size = 1;
+        while (size < n) {
+            size <<= 1;
+        }
+        return size;
+    }
+
+    float gainFor(float peak)
+    {
+        // Smaller peaks can not be the max anymore, so the front is the max of the window
+        while (tail != head && peaks[(tail - 1) & peakMask] <= peak) {
+            tail--;
+        }
+        peaks[tail & peakMask] = peak;
+        peakFrames[tail & peakMask] = frame;
+        tail++;
+        while (peakFrames[head & peakMask] + window <= frame) {
+            head++;
+        }
+        float max = peaks[head & peakMask];
+
+        float reduction = 0.0f;
+        if (max > threshold) {
+            reduction = (thresholdDb - db.toDb(max)) * slope;
+        }
+        reductionSum += reduction - reductions[reductionPos];
+        reductions[reductionPos] = reduction;
+        reductionPos = reductionPos + 1 == window ? 0 : reductionPos + 1;
+        float target = reductionSum * invWindow;
+
+        // Down right away, as the ramp already started a lookahead earlier, up at the release speed
+        envelope = target < envelope ? target : envelope + (target - envelope) * releaseCoef;
+        return envelope > -1e-4f ? 1.0f : db.toGain(envelope);
+    }
+
+public:
+    Limiter(float sampleRate, uint32_t lookahead)
+        : db(DbTable::get())
+        , sampleRate(sampleRate)
+        , lookahead(lookahead)
+        , window(lookahead + 1)
+        , invWindow(1.0 / (lookahead + 1))
+    {
+        uint32_t size = powerOf2(lookahead + 1);
+        delayMask = size - 1;
+        delay[0].resize(size, 0.0f);
+        delay[1].resize(size, 0.0f);
+        uint32_t peakSize = powerOf2(window + 1);
+        peakMask = peakSize - 1;
+        peaks.resize(peakSize, 0.0f);
+        peakFrames.resize(peakSize, 0);
+        reductions.resize(window, 0.0f);
+        setThreshold(thresholdDb);
+        setRelease(0.1f);
+    }
+
+    // Frames the output is late compared to the input
+    uint32_t latency()
+    {
+        return lookahead;
+    }
+
+    void setThreshold(float value)
+    {
+        thresholdDb = value;
+        threshold = db.toGain(value);
+    }
+
+    // 1 for no compression, 0 or infinity for a limiter
+    void setRatio(float ratio)
+    {
+        slope = ratio <= 0.0f || std::isinf(ratio) ? 1.0f : 1.0f - 1.0f / std::max(ratio, 1.0f);
+    }
+
+    void setRelease(float seconds)
+    {
+        releaseCoef = 1.0f - expf(-1.0f / (std::max(seconds, 0.001f) * sampleRate));
+    }
+
+    // Current gain reduction in dB, 0 or below
+    float getReduction()
+    {
+        return envelope;
+    }
+
+    // Process `frames` frames in place, `stride` apart, `right` being NULL for a mono signal. `inputGain` is applied
+    // before the detection, e.g. to push the signal into the limiter.
+    void process(float* left, float* right, uint32_t stride, uint32_t frames, float inputGain = 1.0f)
+    {
+        float* delayL = delay[0].data();
+        float* delayR = delay[1].data();
+        for (uint32_t f = 0; f < frames; f++) {
+            float l = left[f * stride] * inputGain;
+            float r = right ? right[f * stride] * inputGain : 0.0f;
+            float gain = gainFor(std::max(fabsf(l), fabsf(r)));
+
+            uint32_t write = frame & delayMask;
+            uint32_t read = (frame - lookahead) & delayMask;
+            delayL[write] = l;
+            delayR[write] = r;
+            left[f * stride] = delayL[read] * gain;
+            if (right) {
+                right[f * stride] = delayR[read] * gain;
+            }
+            frame++;
+        }
+    }
+};
@@ -0,0 +1,115 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+
+#include "audio/BlepOscillatorBank.h"
+#include "audio/filterBank.h"
+
+// Metallic source of the analog hi-hats and cymbals: 6 band-limited squares at inharmonic ratios of a base frequency
+// (the ratios of the TR-808 metal oscillators), mixed together, then 2 band-pass filters in parallel, the body band
+// and the sizzle band, balanced by `setTone()`.
+//
+// The squares are the lanes of a BlepOscillatorBank, the 2 bands the lanes of an EffectFilterBank, so both run 4
+// lanes at a time in the SIMD registers. The source is rendered by chunks: `render()` for a whole block, or `next()`
+// for the engines stepping once per sample, reading the chunk rendered ahead, one or the other for a given hit.
+class MetalOscillatorBank {
+public:
+    static const int OSCILLATORS = 6;
+    static const uint32_t CHUNK = 32;
+
+protected:
+    // 2 groups of 4 lanes, the 2 lanes after the oscillators being muted
+    static const int LANES = 8;
+    static constexpr float RATIOS[OSCILLATORS] = { 1.0f, 1.4826f, 1.8002f, 2.5459f, 2.6303f, 3.8967f };
+    // The bands keep a small part of the squares, brought back around the level of a sine
+    static constexpr float GAIN = 8.0f;
+
+    BlepOscillatorBank<LANES> squares;
+    EffectFilterBank<4> bands;
+    float tone = 0.5f;
+
+    alignas(16) float body[CHUNK];
+    alignas(16) float sizzle[CHUNK];
+    float ahead[CHUNK];
+    uint32_t pos = 0;
+    uint32_t count = 0;
+
+    void renderChunk(float* out, uint32_t stride, uint32_t frames)
+    {
+        squares.render(body, 1, frames);
+        for (uint32_t f = 0; f < frames; f++) {
+            sizzle[f] = body[f];
+        }
+        float* lanes[4] = { body, sizzle, NULL, NULL };
+        bands.process(lanes, 1, frames);
+        for (uint32_t f = 0; f < frames; f++) {
+            out[f * stride] = body[f] + tone * (sizzle[f] - body[f]);
+        }
+    }
+
+public:
+    MetalOscillatorBank(float sampleRate)
+        : squares(sampleRate, BlepOscillatorBank<LANES>::SQUARE)
+    {
+        for (int l = 0; l < LANES; l++) {
+            squares.setGain(l, l < OSCILLATORS ? GAIN / OSCILLATORS : 0.0f);
+        }
+        bands.setType(0, EffectFilterData::BP);
+        bands.setType(1, EffectFilterData::BP);
+        setFrequency(205.3f);
+        setBands(0.5f, 0.3f);
+    }
+
+    // Frequency of the lowest square, the others following the ratios
+    void setFrequency(float freq)
+    {
+        for (int l = 0; l < OSCILLATORS; l++) {
+            squares.setFrequency(l, freq * RATIOS[l]);
+        }
+    }
+
+    // Center of the body band from 0 to 1, the sizzle band being above it, and resonance of both
+    void setBands(float center, float resonance)
+    {
+        bands.set(0, center * 0.7f, resonance);
+        bands.set(1, center * 0.3f + 0.7f, resonance);
+    }
+
+    // Balance between the body band (0) and the sizzle band (1)
+    void setTone(float value)
+    {
+        tone = value;
+    }
+
+    // Start a hit: the phases and the filters are reset, so the same hit always renders the same
+    void reset()
+    {
+        for (int l = 0; l < LANES; l++) {
+            squares.setPhase(l, 0.0f);
+        }
+        bands.reset(0);
+        bands.reset(1);
+        pos = 0;
+        count = 0;
+    }
+
+    // Write `frames` samples in `out`, `stride` being the distance between two frames
+    void render(float* out, uint32_t stride, uint32_t frames)
+    {
+        for (uint32_t f = 0; f < frames; f += CHUNK) {
+            renderChunk(out + f * stride, stride, std::min(CHUNK, frames - f));
+        }
+    }
+
+    // Next sample, from the chunk rendered ahead. A change of the frequency or the bands is heard on the next chunk.
+    float next()
+    {
+        if (pos == count) {
+            renderChunk(ahead, 1, CHUNK);
+            count = CHUNK;
+            pos = 0;
+        }
+        return ahead[pos++];
+    }
+};
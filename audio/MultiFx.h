@@ -13,12 +13,12 @@ A key architectural feature is its speed optimization. Instead of using complex
 
 The class supports a wide palette of sound modifications, categorized as:
 
-1.  **Time-Based Effects:** Various types of Reverb (including complex Shimmer variations) and multiple Delay implementations, which use internal buffers to store and manipulate delayed audio samples.
+1.  **Time-Based Effects:** Various types of Reverb (including complex Shimmer variations) and multiple Delay implementations, which use internal buffers to store and manipulate delayed audio samples. A feedback delay network reverb takes its delay lines from a pool shared by all the plugins, only while it is selected.
 2.  **Dynamics and Distortion:** Includes effects like signal **Boost**, **Drive** (overdrive/distortion), **Clipping**, and **Compression**.
 3.  **Digital/Lo-Fi Effects:** Specialized effects that mimic digital degradation, such as **Sample Reducer**, **Bitcrusher**, and **Decimator**.
 4.  **Modulation and Filters:** Effects that manipulate the signal wave over time, like **Tremolo** and **Ring Modulation**, alongside various **Low Pass** and **High Pass Filters** to shape the tone.
 
-Essentially, `MultiFx` provides a single, high-speed interface to switch between and apply twenty-five distinct ways to alter sound digitally.
+Essentially, `MultiFx` provides a single, high-speed interface to switch between and apply twenty-six distinct ways to alter sound digitally.
 
 sha: 0c3075cbe0625431dd9dd3f0920f7c1567f8625b6e66bd48a47304b6c1e2c93e 
 */
@@ -26,6 +26,7 @@ sha: 0c3075cbe0625431dd9dd3f0920f7c1567f8625b6e66bd48a47304b6c1e2c93e
 
 #include "plugins/audio/mapping.h"
 #include "audio/effects/applyBoost.h"
+#include "audio/effects/applyClipping.h"
 #include "audio/effects/applyCompression.h"
 #include "audio/effects/applyDrive.h"
 #include "audio/effects/applyReverb.h"
@@ -35,6 +36,8 @@ sha: 0c3075cbe0625431dd9dd3f0920f7c1567f8625b6e66bd48a47304b6c1e2c93e
 #include "audio/effects/applyBitcrusher.h"
 #include "audio/effects/applyTremolo.h"
 #include "audio/effects/applyWaveshape.h"
+#include "audio/FdnReverb.h"
+#include "audio/filter.h"
 #include "audio/lookupTable.h"
 #include "audio/utils/linearInterpolation.h"
 
@@ -46,9 +49,32 @@ protected:
     typedef float (MultiFx::*FnPtr)(float, float);
     FnPtr fxFn = &MultiFx::fxOff;
 
+    // Process `frames` samples of a lane, `stride` being the distance between two frames
+    typedef void (MultiFx::*BlockFnPtr)(float*, uint32_t, uint32_t, float);
+    BlockFnPtr blockFn = &MultiFx::blockOff;
+
+    // Block kernel of any effect: the effect being a template parameter, it is inlined in the loop instead of
+    // being called through a pointer for each sample.
+    template <FnPtr Fn>
+    void blockOf(float* buf, uint32_t stride, uint32_t frames, float amount)
+    {
+        for (uint32_t f = 0; f < frames; f++) {
+            float& sample = buf[f * stride];
+            sample = (this->*Fn)(sample, amount);
+        }
+    }
+
+    template <FnPtr Fn>
+    void setFn(BlockFnPtr block = &MultiFx::blockOf<Fn>)
+    {
+        fxFn = Fn;
+        blockFn = block;
+    }
+
     float fxOff(float input, float) { return input; }
+    void blockOff(float*, uint32_t, uint32_t, float) { }
 
-    DELAY_BUFFER
+    ArenaArray<float> buffer;
 
     int bufferIndex = 0;
     float fxReverb(float signal, float amount)
@@ -78,6 +104,19 @@ protected:
         return applyReverb3(signal, amount, buffer, bufferIndex);
     }
 
+    // Delay lines taken from the shared pool only while selected
+    FdnReverb fdnReverb;
+    float fdnAmount = -1.0f;
+    float fxFdnReverb(float input, float amount)
+    {
+        if (amount != fdnAmount) {
+            fdnAmount = amount;
+            fdnReverb.setDecay(0.3f + amount * amount * 6.0f);
+        }
+        float mix = amount * 0.5f;
+        return input * (1.0f - mix) + fdnReverb.process(input) * mix;
+    }
+
     float fxDelay(float input, float amount)
     {
         return applyDelay(input, amount, buffer, bufferIndex);
@@ -95,9 +134,7 @@ protected:
 
     float tanhLookup(float x)
     {
-        x = CLAMP(x, -1.0f, 1.0f);
-        int index = static_cast<int>((x + 1.0f) * 0.5f * (lookupTable->size - 1));
-        return lookupTable->tanh[index];
+        return lookupTable->getTanh(x);
     }
 
     float sineLookupInterpolated(float x)
@@ -112,11 +149,19 @@ protected:
     {
         return applyBoost(input, amount, prevInput, prevOutput);
     }
+    void blockBoost(float* buf, uint32_t stride, uint32_t frames, float amount)
+    {
+        applyBoostBlock(buf, stride, frames, amount, prevInput, prevOutput);
+    }
 
     float fxDrive(float input, float amount)
     {
         return applyDrive(input, amount, lookupTable);
     }
+    void blockDrive(float* buf, uint32_t stride, uint32_t frames, float amount)
+    {
+        applyDriveBlock(buf, stride, frames, amount, lookupTable);
+    }
 
     float fxCompressor(float input, float amount)
     {
@@ -127,19 +172,27 @@ protected:
     {
         return applyWaveshape(input, amount);
     }
+    void blockWaveshaper(float* buf, uint32_t stride, uint32_t frames, float amount)
+    {
+        applyWaveshapeBlock(buf, stride, frames, amount);
+    }
 
     float fxWaveshaper2(float input, float amount)
     {
         return applyWaveshapeLut(input, amount, lookupTable);
     }
+    void blockWaveshaper2(float* buf, uint32_t stride, uint32_t frames, float amount)
+    {
+        applyWaveshapeLutBlock(buf, stride, frames, amount, lookupTable);
+    }
 
     float fxClipping(float input, float amount)
     {
-        if (amount == 0.0f) {
-            return input;
-        }
-        float scaledClipping = amount * amount * 20;
-        return CLAMP(input + input * scaledClipping, -1.0f, 1.0f);
+        return applyClipping(input, amount * amount * 20);
+    }
+    void blockClipping(float* buf, uint32_t stride, uint32_t frames, float amount)
+    {
+        applyClippingBlock(buf, stride, frames, amount * amount * 20);
     }
 
     float sampleSqueeze;
@@ -234,10 +287,7 @@ protected:
     float bp = 0.0;
     void setSampleData(float inputValue, float cutoff, float& _buf, float& _hp, float& _bp, float& _lp)
     {
-        _hp = inputValue - _buf;
-        _bp = _buf - _lp;
-        _buf = _buf + cutoff * _hp;
-        _lp = _lp + cutoff * (_buf - _lp);
+        EffectFilterData::svf(inputValue, cutoff, 0.0f, _buf, _hp, _bp, _lp);
     }
 
     float fxLowPass(float input, float amount)
@@ -289,94 +339,104 @@ public:
         LPF,
         HPF,
         HPF_DIST,
+        FDN_REVERB,
         FX_COUNT
     };
     Val::CallbackFn setFxType = [&](auto p)
     {
         p.val.setFloat(p.value);
         MultiFx::FXType type = (MultiFx::FXType)p.value;
+        if (type != MultiFx::FXType::FDN_REVERB) {
+            fdnReverb.deactivate();
+        }
         if (type == MultiFx::FXType::FX_OFF) {
             p.val.setString("OFF");
-            fxFn = &MultiFx::fxOff;
+            setFn<&MultiFx::fxOff>(&MultiFx::blockOff);
         } else if (type == MultiFx::FXType::REVERB) {
             p.val.setString("Reverb");
-            fxFn = &MultiFx::fxReverb;
+            setFn<&MultiFx::fxReverb>();
         } else if (type == MultiFx::FXType::REVERB2) {
             p.val.setString("Reverb2");
-            fxFn = &MultiFx::fxReverb2;
+            setFn<&MultiFx::fxReverb2>();
         } else if (type == MultiFx::FXType::REVERB3) {
             p.val.setString("Reverb3");
-            fxFn = &MultiFx::fxReverb3;
+            setFn<&MultiFx::fxReverb3>();
         } else if (type == MultiFx::FXType::DELAY) {
             p.val.setString("Delay");
-            fxFn = &MultiFx::fxDelay;
+            setFn<&MultiFx::fxDelay>();
         } else if (type == MultiFx::FXType::DELAY2) {
             p.val.setString("Delay2");
-            fxFn = &MultiFx::fxDelay2;
+            setFn<&MultiFx::fxDelay2>();
         } else if (type == MultiFx::FXType::DELAY3) {
             p.val.setString("Delay3");
-            fxFn = &MultiFx::fxDelay3;
+            setFn<&MultiFx::fxDelay3>();
         } else if (type == MultiFx::FXType::BASS_BOOST) {
             p.val.setString("Bass boost");
-            fxFn = &MultiFx::fxBoost;
+            setFn<&MultiFx::fxBoost>(&MultiFx::blockBoost);
         } else if (type == MultiFx::FXType::DRIVE) {
             p.val.setString("Drive");
-            fxFn = &MultiFx::fxDrive;
+            setFn<&MultiFx::fxDrive>(&MultiFx::blockDrive);
         } else if (type == MultiFx::FXType::COMPRESSION) {
             p.val.setString("Compressor");
-            fxFn = &MultiFx::fxCompressor;
+            setFn<&MultiFx::fxCompressor>();
         } else if (type == MultiFx::FXType::WAVESHAPER) {
             p.val.setString("Waveshap.");
-            fxFn = &MultiFx::fxWaveshaper;
+            setFn<&MultiFx::fxWaveshaper>(&MultiFx::blockWaveshaper);
         } else if (type == MultiFx::FXType::WAVESHAPER2) {
             p.val.setString("Waveshap2");
-            fxFn = &MultiFx::fxWaveshaper2;
+            setFn<&MultiFx::fxWaveshaper2>(&MultiFx::blockWaveshaper2);
         } else if (type == MultiFx::FXType::CLIPPING) {
             p.val.setString("Clipping");
-            fxFn = &MultiFx::fxClipping;
+            setFn<&MultiFx::fxClipping>(&MultiFx::blockClipping);
         } else if (type == MultiFx::FXType::SAMPLE_REDUCER) {
             p.val.setString("Sample red.");
-            fxFn = &MultiFx::fxSampleReducer;
+            setFn<&MultiFx::fxSampleReducer>();
         } else if (type == MultiFx::FXType::BITCRUSHER) {
             p.val.setString("Bitcrusher");
-            fxFn = &MultiFx::fxBitcrusher;
+            setFn<&MultiFx::fxBitcrusher>();
         } else if (type == MultiFx::FXType::INVERTER) {
             p.val.setString("Inverter");
-            fxFn = &MultiFx::fxInverter;
+            setFn<&MultiFx::fxInverter>();
         } else if (type == MultiFx::FXType::TREMOLO) {
             p.val.setString("Tremolo");
-            fxFn = &MultiFx::fxTremolo;
+            setFn<&MultiFx::fxTremolo>();
         } else if (type == MultiFx::FXType::RING_MOD) {
             p.val.setString("Ring mod.");
-            fxFn = &MultiFx::fxRingMod;
+            setFn<&MultiFx::fxRingMod>();
         } else if (type == MultiFx::FXType::FX_SHIMMER_REVERB) {
             p.val.setString("Shimmer");
-            fxFn = &MultiFx::fxShimmerReverb;
+            setFn<&MultiFx::fxShimmerReverb>();
         } else if (type == MultiFx::FXType::FX_SHIMMER2_REVERB) {
             p.val.setString("Shimmer2");
-            fxFn = &MultiFx::fxShimmer2Reverb;
+            setFn<&MultiFx::fxShimmer2Reverb>();
         } else if (type == MultiFx::FXType::FX_FEEDBACK) {
             p.val.setString("Feedback");
-            fxFn = &MultiFx::fxFeedback;
+            setFn<&MultiFx::fxFeedback>();
         } else if (type == MultiFx::FXType::DECIMATOR) {
             p.val.setString("Decimator");
-            fxFn = &MultiFx::fxDecimator;
+            setFn<&MultiFx::fxDecimator>();
         } else if (type == MultiFx::FXType::LPF) {
             p.val.setString("LPF");
-            fxFn = &MultiFx::fxLowPass;
+            setFn<&MultiFx::fxLowPass>();
         } else if (type == MultiFx::FXType::HPF) {
             p.val.setString("HPF");
-            fxFn = &MultiFx::fxHighPass;
+            setFn<&MultiFx::fxHighPass>();
         } else if (type == MultiFx::FXType::HPF_DIST) {
             p.val.setString("HPF dist.");
-            fxFn = &MultiFx::fxHighPassFilterDistorted;
+            setFn<&MultiFx::fxHighPassFilterDistorted>();
+        } else if (type == MultiFx::FXType::FDN_REVERB) {
+            p.val.setString("FDN reverb");
+            fdnReverb.activate();
+            setFn<&MultiFx::fxFdnReverb>();
         }
         // TODO: add fx sample reducer
     };
 
-    MultiFx(uint64_t sampleRate, LookupTable* lookupTable)
+    MultiFx(uint64_t sampleRate, LookupTable* lookupTable, PluginArena* arena = NULL)
         : sampleRate(sampleRate)
         , lookupTable(lookupTable)
+        , buffer(arena, DELAY_BUFFER_SIZE)
+        , fdnReverb(sampleRate)
     {
     }
 
@@ -384,4 +444,11 @@ public:
     {
         return (this->*fxFn)(in, amount);
     }
+
+    // Apply the effect on `frames` samples of `buf`, `stride` being the distance between two frames, e.g.
+    // `applyBlock(trackLane(buf, track), props.frameStride, frames, amount)`
+    void applyBlock(float* buf, uint32_t stride, uint32_t frames, float amount)
+    {
+        (this->*blockFn)(buf, stride, frames, amount);
+    }
 };
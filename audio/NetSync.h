@@ -0,0 +1,406 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "helpers/MpscQueue.h"
+#include "log.h"
+#include "plugins/audio/utils/StateSnapshot.h"
+
+// Tempo and transport shared by the units of a local network, in the spirit of Ableton Link: all the units follow a
+// single session timeline, the beat at any time being `(time - origin) * bpm / 60`, and the transport state, so their
+// beats, bars and start/stop stay phase-locked.
+//
+// Each unit multicasts the timeline it follows a few times per second, in its own clock, from its own unicast socket
+// which the peers ping, so several units can run on the same host. The clock of each peer is
+// estimated with NTP-like round trips: the offset of the round trip with the shortest time over the last few seconds
+// is kept, the shorter the round trip the more symmetric, so the timeline of a peer is converted to the local clock.
+// A timeline replaces the current one when it is more recent: each change of tempo or transport on a unit starts a
+// new version, the unit id breaking ties.
+//
+// The network is handled by its own thread. The audio thread reads the session from a snapshot, and sends its own
+// changes through a queue, so it never waits on the network.
+class NetSync {
+public:
+    enum Transport : uint8_t {
+        STOPPED,
+        PLAYING,
+        PAUSED,
+    };
+
+    // In the local clock, microseconds of the steady clock
+    struct Session {
+        bool valid = false;
+        double bpm = 120.0;
+        int64_t originUs = 0;
+        // Beat at which the clock counter was 0, when playing
+        double startBeat = 0.0;
+        Transport transport = STOPPED;
+        uint32_t version = 0;
+        uint64_t owner = 0;
+
+        double beat(int64_t timeUs) const
+        {
+            return (timeUs - originUs) * bpm / 60000000.0;
+        }
+    };
+
+    // Change made on this unit at `timeUs`: its tempo if `bpm` is set, else its transport
+    struct Change {
+        double bpm;
+        Transport transport;
+        // Clock position in beats when the transport changed
+        double position;
+        int64_t timeUs;
+    };
+
+    static int64_t nowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+protected:
+    static const int64_t STATE_INTERVAL_US = 250000;
+    static const int64_t PEER_TIMEOUT_US = 3000000;
+    static const int SAMPLES = 16;
+
+    enum PacketType : uint8_t {
+        STATE,
+        PING,
+        PONG,
+    };
+
+    // Host byte order, all the targets being little endian
+    struct Packet {
+        char magic[4];
+        uint8_t type;
+        uint8_t transport;
+        uint16_t reserved;
+        uint32_t version;
+        uint64_t node;
+        uint64_t owner;
+        double bpm;
+        int64_t originUs;
+        double startBeat;
+        // Round trip: sent by the pinging unit, received and sent back by the peer
+        int64_t t0, t1, t2;
+    };
+
+    struct Peer {
+        struct sockaddr_in addr;
+        int64_t lastSeen = 0;
+        struct {
+            int64_t rtt;
+            int64_t offset;
+        } samples[SAMPLES];
+        int count = 0;
+        // Peer clock minus local clock, valid once a round trip returned
+        int64_t offset = 0;
+
+        void addSample(int64_t rtt, int64_t sampleOffset)
+        {
+            samples[count % SAMPLES] = { rtt, sampleOffset };
+            count++;
+            int n = count < SAMPLES ? count : SAMPLES;
+            int best = 0;
+            for (int i = 1; i < n; i++) {
+                if (samples[i].rtt < samples[best].rtt) {
+                    best = i;
+                }
+            }
+            offset = samples[best].offset;
+        }
+    };
+
+    uint64_t node;
+    std::function<void(Transport transport)> onTransport;
+    struct sockaddr_in group = {};
+    // Multicast group, shared by the units of the host, and unicast socket of this unit
+    int fd = -1;
+    int unicastFd = -1;
+    int epollFd = -1;
+    int stopFd = -1;
+    std::thread thread;
+
+    std::unordered_map<uint64_t, Peer> peers;
+    // Timeline in the clock of its sender, kept to convert it again when the offset estimate changes
+    Packet followed = {};
+    uint64_t followedFrom = 0;
+    Session current;
+    int64_t lastState = 0;
+
+    StateSnapshot<Session> snapshot;
+    MpscQueue<Change, 32> changes;
+
+    void publish()
+    {
+        snapshot.back() = current;
+        snapshot.publish();
+    }
+
+    Packet packet(PacketType type)
+    {
+        Packet p = {};
+        memcpy(p.magic, "ZSYN", 4);
+        p.type = type;
+        p.node = node;
+        return p;
+    }
+
+    void send(const Packet& p, const struct sockaddr_in& addr)
+    {
+        sendto(unicastFd, &p, sizeof(p), 0, (const struct sockaddr*)&addr, sizeof(addr));
+    }
+
+    void sendState(int64_t now)
+    {
+        Packet p = packet(STATE);
+        p.transport = current.transport;
+        p.version = current.version;
+        p.owner = current.owner;
+        p.bpm = current.bpm;
+        p.originUs = current.originUs;
+        p.startBeat = current.startBeat;
+        send(p, group);
+        for (auto& [id, peer] : peers) {
+            Packet ping = packet(PING);
+            ping.t0 = nowUs();
+            send(ping, peer.addr);
+        }
+        lastState = now;
+    }
+
+    bool newer(uint32_t version, uint64_t owner)
+    {
+        return version > current.version || (version == current.version && owner > current.owner);
+    }
+
+    // Follow the timeline of `from`, in its clock
+    void follow(const Packet& p, uint64_t from)
+    {
+        Peer& peer = peers[from];
+        Transport previous = current.transport;
+        current.valid = true;
+        current.bpm = p.bpm;
+        current.originUs = p.originUs - peer.offset;
+        current.startBeat = p.startBeat;
+        current.transport = (Transport)p.transport;
+        current.version = p.version;
+        current.owner = p.owner;
+        followed = p;
+        followedFrom = from;
+        publish();
+        if (current.transport != previous && onTransport) {
+            onTransport(current.transport);
+        }
+    }
+
+    void apply(const Change& change)
+    {
+        // Beat unchanged at the time of the change, whatever the tempo
+        double beat = current.beat(change.timeUs);
+        if (change.bpm) {
+            current.bpm = change.bpm;
+            current.originUs = change.timeUs - (int64_t)(beat * 60000000.0 / current.bpm);
+        } else {
+            current.transport = change.transport;
+            if (change.transport == PLAYING) {
+                current.startBeat = beat - change.position;
+            }
+        }
+        current.valid = true;
+        current.version++;
+        current.owner = node;
+        followedFrom = 0;
+        publish();
+        sendState(nowUs());
+    }
+
+    void receive(int from)
+    {
+        Packet p;
+        struct sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        ssize_t size;
+        while ((size = recvfrom(from, &p, sizeof(p), 0, (struct sockaddr*)&addr, &len)) >= 0) {
+            int64_t now = nowUs();
+            if (size != sizeof(p) || memcmp(p.magic, "ZSYN", 4) != 0 || p.node == node) {
+                continue;
+            }
+            Peer& peer = peers[p.node];
+            peer.addr = addr;
+            peer.lastSeen = now;
+            if (p.type == PING) {
+                Packet pong = packet(PONG);
+                pong.t0 = p.t0;
+                pong.t1 = now;
+                pong.t2 = nowUs();
+                send(pong, addr);
+            } else if (p.type == PONG) {
+                int64_t rtt = (now - p.t0) - (p.t2 - p.t1);
+                peer.addSample(rtt, ((p.t1 - p.t0) + (p.t2 - now)) / 2);
+                // The followed timeline moves with the new estimate of the clock of its sender
+                if (followedFrom == p.node) {
+                    int64_t originUs = followed.originUs - peer.offset;
+                    if (originUs != current.originUs) {
+                        current.originUs = originUs;
+                        publish();
+                    }
+                }
+            } else if (p.type == STATE && peer.count > 0) {
+                // Only once the clock of the peer is known
+                if (newer(p.version, p.owner) || (followedFrom == p.node && p.version == current.version && p.owner == current.owner)) {
+                    follow(p, p.node);
+                }
+            }
+            len = sizeof(addr);
+        }
+    }
+
+    void loop()
+    {
+        struct epoll_event events[3];
+        while (true) {
+            // Changes of the audio thread are sent within 10ms
+            int count = epoll_wait(epollFd, events, 3, 10);
+            for (int i = 0; i < count; i++) {
+                if (events[i].data.fd == stopFd) {
+                    return;
+                }
+                receive(events[i].data.fd);
+            }
+            Change* change;
+            while ((change = changes.front()) != NULL) {
+                apply(*change);
+                changes.pop();
+            }
+            int64_t now = nowUs();
+            for (auto it = peers.begin(); it != peers.end();) {
+                if (now - it->second.lastSeen > PEER_TIMEOUT_US) {
+                    logInfo("Net sync: peer %llx left", (unsigned long long)it->first);
+                    if (followedFrom == it->first) {
+                        // Keep following the timeline, now as ours
+                        followedFrom = 0;
+                    }
+                    it = peers.erase(it);
+                } else {
+                    ++it;
+                }
+            }
+            if (now - lastState >= STATE_INTERVAL_US) {
+                sendState(now);
+            }
+        }
+    }
+
+public:
+    NetSync()
+    {
+        // Unique enough on a local network
+        node = ((uint64_t)nowUs() << 16) ^ ((uint64_t)getpid() << 40) ^ (uint64_t)(uintptr_t)this;
+    }
+
+    ~NetSync()
+    {
+        stop();
+    }
+
+    // Join the multicast `groupAddress`, `onTransport` being called from the network thread when another unit
+    // started or stopped the session
+    bool start(double bpm, const std::string& groupAddress, uint16_t port, std::function<void(Transport transport)> transport)
+    {
+        onTransport = transport;
+        current.bpm = bpm;
+        current.originUs = nowUs();
+        current.owner = node;
+        current.valid = true;
+        publish();
+
+        group.sin_family = AF_INET;
+        group.sin_port = htons(port);
+        if (inet_pton(AF_INET, groupAddress.c_str(), &group.sin_addr) != 1) {
+            logWarn("Net sync: invalid group %s", groupAddress.c_str());
+            return false;
+        }
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        struct ip_mreq mreq = {};
+        mreq.imr_multiaddr = group.sin_addr;
+        mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+        unicastFd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        struct sockaddr_in unicastAddr = {};
+        unicastAddr.sin_family = AF_INET;
+        unicastAddr.sin_addr.s_addr = htonl(INADDR_ANY);
+        unsigned char ttl = 1;
+        if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0
+            || setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0
+            || unicastFd < 0 || bind(unicastFd, (struct sockaddr*)&unicastAddr, sizeof(unicastAddr)) < 0
+            || setsockopt(unicastFd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl)) < 0) {
+            logWarn("Net sync on %s:%d: %s", groupAddress.c_str(), port, strerror(errno));
+            stop();
+            return false;
+        }
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        for (int watched : { fd, unicastFd, stopFd }) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = watched;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, watched, &event);
+        }
+        thread = std::thread([this] { loop(); });
+        pthread_setname_np(thread.native_handle(), "netSync");
+        logInfo("Net sync on %s:%d", groupAddress.c_str(), port);
+        return true;
+    }
+
+    void stop()
+    {
+        if (thread.joinable()) {
+            uint64_t value = 1;
+            if (write(stopFd, &value, sizeof(value)) == sizeof(value)) {
+                thread.join();
+            } else {
+                thread.detach();
+            }
+        }
+        for (int* watched : { &fd, &unicastFd, &stopFd, &epollFd }) {
+            if (*watched >= 0) {
+                close(*watched);
+                *watched = -1;
+            }
+        }
+    }
+
+    // Audio thread
+    const Session& session()
+    {
+        return snapshot.acquire();
+    }
+
+    // From any thread, only the audio thread sending the transport changes
+    void change(const Change& change)
+    {
+        if (!changes.push(change)) {
+            logWarn("Net sync: change queue full");
+        }
+    }
+};
@@ -0,0 +1,428 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <filesystem>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <sndfile.h>
+#include <string>
+#include <vector>
+
+#include "log.h"
+
+#include "audio/utils/applySampleGain.h"
+#include "audio/utils/fft.h"
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+
+// Analysis of a sample for time stretching, computed once so playback only has to overlap-add.
+//
+// The sample is cut in frames of `FFT_SIZE` samples every `HOP` samples, frame `f` being centered on sample
+// `f * HOP`. Each frame keeps its spectrum, for the phase vocoder, and its period, for WSOLA to align the grains
+// on the waveform without searching for the best overlap while playing. Transients are the onsets found in the
+// spectral flux: they are played as they are instead of being smeared or repeated.
+struct StretchAnalysis {
+    static const uint32_t FFT_SIZE = 1024;
+    static const uint32_t HOP = FFT_SIZE / 4;
+    static const uint32_t BINS = FFT_SIZE / 2 + 1;
+    // Lags searched for the period, about 1200Hz to 94Hz at 48000Hz
+    static const uint32_t MIN_LAG = 40;
+    static const uint32_t MAX_LAG = FFT_SIZE / 2;
+
+    std::string path;
+    // Samples read from the file and distance between two samples of the analysed channel
+    uint64_t count = 0;
+    uint32_t stride = 1;
+    // Samples of the analysed channel
+    uint32_t length = 0;
+
+    uint32_t frames = 0;
+    std::vector<float> magnitudes;
+    std::vector<float> phases;
+    // Period of each frame in samples, 0 when the frame is not periodic
+    std::vector<float> periods;
+    // Sorted sample positions of the onsets
+    std::vector<uint32_t> transients;
+    // Sustained and pitched material, better stretched by the phase vocoder than by WSOLA
+    bool tonal = false;
+
+    const float* magnitude(uint32_t f) const
+    {
+        return magnitudes.data() + std::min(f, frames - 1) * BINS;
+    }
+
+    const float* phase(uint32_t f) const
+    {
+        return phases.data() + std::min(f, frames - 1) * BINS;
+    }
+
+    float period(float position) const
+    {
+        int32_t f = position / HOP + 0.5f;
+        return periods[std::clamp(f, 0, (int32_t)frames - 1)];
+    }
+
+    // First onset after `position`, UINT32_MAX if none
+    uint32_t nextTransient(float position) const
+    {
+        auto it = std::upper_bound(transients.begin(), transients.end(), position,
+            [](float p, uint32_t t) { return p < t; });
+        return it != transients.end() ? *it : UINT32_MAX;
+    }
+};
+
+// Stretch analyses shared by all the plugins, built in the background when a sample is loaded, and cached next to
+// the sample in a hidden `.<file>.stretch` file, so the next loads only read it back.
+//
+// Same model as WavetableBank: `request()` only queues the analysis, the worker hands it over through an atomic
+// pointer, and analyses are never freed before the bank.
+class StretchAnalysisBank {
+protected:
+    static const uint32_t CACHE_MAGIC = 0x5254535a; // "ZSTR"
+    static const uint32_t CACHE_VERSION = 1;
+    // Samples are loaded at 48000Hz no matter the sample rate, see SynthMultiSample
+    static const uint32_t LOADED_SAMPLE_RATE = 48000;
+
+    std::mutex mtx;
+    std::vector<std::unique_ptr<StretchAnalysis>> analyses;
+
+    struct Request {
+        std::string path;
+        uint64_t count;
+        uint32_t stride;
+        std::atomic<const StretchAnalysis*>* target;
+    };
+    std::deque<Request> queue;
+    Worker worker { mtx, "stretch", [this] { workerLoop(); } };
+
+    const StretchAnalysis* find(const Request& request)
+    {
+        for (auto& analysis : analyses) {
+            if (analysis->path == request.path && analysis->count == request.count && analysis->stride == request.stride) {
+                return analysis.get();
+            }
+        }
+        return NULL;
+    }
+
+    static std::string cachePath(std::string path)
+    {
+        std::filesystem::path file(path);
+        return (file.parent_path() / ("." + file.filename().string() + ".stretch")).string();
+    }
+
+    // The same samples as SynthMultiSample plays: `count` samples, normalized, one every `stride`
+    static bool readSignal(const Request& request, std::vector<float>& signal)
+    {
+        SF_INFO sfinfo;
+        memset(&sfinfo, 0, sizeof(sfinfo));
+        SNDFILE* file = sf_open(request.path.c_str(), SFM_READ, &sfinfo);
+        if (!file) {
+            logError("Error: could not open file %s\n", request.path.c_str());
+            return false;
+        }
+        std::vector<float> samples(request.count);
+        uint64_t count = sf_read_float(file, samples.data(), samples.size());
+        sf_close(file);
+        if (count != request.count) {
+            logError("Error: sample %s changed while loading\n", request.path.c_str());
+            return false;
+        }
+        applySampleGain(samples.data(), count);
+        signal.resize(count / request.stride);
+        for (uint32_t i = 0; i < signal.size(); i++) {
+            signal[i] = samples[i * request.stride];
+        }
+        return true;
+    }
+
+    // Normalized autocorrelation of the frame from its spectrum, and the shortest strong period
+    static float findPeriod(RealFft& fft, std::vector<std::complex<float>>& bins, std::vector<float>& frame,
+        const std::vector<float>& windowCorrelation)
+    {
+        for (auto& bin : bins) {
+            bin = std::norm(bin);
+        }
+        fft.inverse(bins.data(), frame.data());
+        float energy = frame[0];
+        if (energy <= 1e-9f) {
+            return 0.0f;
+        }
+        // The compensation of the window overshoots on long lags, a period can't correlate more than the frame
+        auto correlation = [&](uint32_t lag) {
+            return std::min(frame[lag] / energy / windowCorrelation[lag], 1.0f);
+        };
+
+        float best = 0.0f;
+        for (uint32_t lag = StretchAnalysis::MIN_LAG; lag <= StretchAnalysis::MAX_LAG; lag++) {
+            best = std::max(best, correlation(lag));
+        }
+        // Below 0.5 the frame is noise, or too many notes at once
+        if (best < 0.5f) {
+            return 0.0f;
+        }
+        // The first peak close to the best one, so the period is not a multiple of the real one
+        for (uint32_t lag = StretchAnalysis::MIN_LAG + 1; lag < StretchAnalysis::MAX_LAG; lag++) {
+            float c = correlation(lag);
+            float before = correlation(lag - 1);
+            float after = correlation(lag + 1);
+            if (c >= 0.85f * best && c >= before && c >= after) {
+                float curve = before - 2.0f * c + after;
+                return lag + (curve < 0.0f ? 0.5f * (before - after) / curve : 0.0f);
+            }
+        }
+        return 0.0f;
+    }
+
+    static std::unique_ptr<StretchAnalysis> analyse(const Request& request, const std::vector<float>& signal)
+    {
+        const uint32_t N = StretchAnalysis::FFT_SIZE;
+        const uint32_t H = StretchAnalysis::HOP;
+        const uint32_t BINS = StretchAnalysis::BINS;
+
+        std::unique_ptr<StretchAnalysis> analysis = std::make_unique<StretchAnalysis>();
+        analysis->path = request.path;
+        analysis->count = request.count;
+        analysis->stride = request.stride;
+        analysis->length = signal.size();
+        analysis->frames = signal.size() / H + 1;
+        analysis->magnitudes.resize(analysis->frames * BINS);
+        analysis->phases.resize(analysis->frames * BINS);
+        analysis->periods.resize(analysis->frames);
+
+        std::vector<float> window(N);
+        for (uint32_t n = 0; n < N; n++) {
+            window[n] = 0.5f - 0.5f * cosf(2.0f * M_PI * n / N);
+        }
+        // The window shortens the autocorrelation of long lags, compensated to compare them
+        std::vector<float> windowCorrelation(N / 2 + 2);
+        float windowEnergy = 0.0f;
+        for (uint32_t n = 0; n < N; n++) {
+            windowEnergy += window[n] * window[n];
+        }
+        for (uint32_t lag = 0; lag < windowCorrelation.size(); lag++) {
+            float sum = 0.0f;
+            for (uint32_t n = 0; n + lag < N; n++) {
+                sum += window[n] * window[n + lag];
+            }
+            windowCorrelation[lag] = sum / windowEnergy;
+        }
+
+        RealFft fft(N);
+        std::vector<std::complex<float>> bins(BINS);
+        std::vector<float> frame(N);
+        std::vector<float> flux(analysis->frames);
+        std::vector<float> energy(analysis->frames);
+        std::vector<float> previous(BINS, 0.0f);
+        for (uint32_t f = 0; f < analysis->frames; f++) {
+            int64_t first = (int64_t)f * H - N / 2;
+            for (uint32_t n = 0; n < N; n++) {
+                int64_t i = first + n;
+                frame[n] = i >= 0 && i < signal.size() ? signal[i] * window[n] : 0.0f;
+            }
+            fft.forward(frame.data(), bins.data());
+
+            float* magnitude = analysis->magnitudes.data() + f * BINS;
+            float* phase = analysis->phases.data() + f * BINS;
+            for (uint32_t k = 0; k < BINS; k++) {
+                magnitude[k] = std::abs(bins[k]);
+                phase[k] = std::arg(bins[k]);
+                flux[f] += std::max(logf(1.0f + magnitude[k]) - logf(1.0f + previous[k]), 0.0f);
+                energy[f] += magnitude[k] * magnitude[k];
+                previous[k] = magnitude[k];
+            }
+            analysis->periods[f] = findPeriod(fft, bins, frame, windowCorrelation);
+        }
+
+        // Onsets are the peaks of the flux well above its neighbourhood, at least 4 frames apart
+        float maxEnergy = *std::max_element(energy.begin(), energy.end());
+        float tonalEnergy = 0.0f;
+        float totalEnergy = 0.0f;
+        for (uint32_t f = 1; f + 1 < analysis->frames; f++) {
+            float mean = 0.0f;
+            uint32_t from = f > 8 ? f - 8 : 0;
+            uint32_t to = std::min(f + 8, analysis->frames - 1);
+            for (uint32_t i = from; i <= to; i++) {
+                mean += flux[i];
+            }
+            mean /= to - from + 1;
+            bool peak = flux[f] > flux[f - 1] && flux[f] >= flux[f + 1];
+            bool loud = energy[f] > maxEnergy * 0.001f;
+            bool apart = analysis->transients.empty() || f * H >= analysis->transients.back() + 4 * H;
+            if (peak && loud && apart && flux[f] > 1.5f * mean + 1.0f) {
+                analysis->transients.push_back(f * H);
+            }
+            totalEnergy += energy[f];
+            if (analysis->periods[f] > 0.0f) {
+                tonalEnergy += energy[f];
+            }
+        }
+        float seconds = signal.size() / (float)LOADED_SAMPLE_RATE;
+        float onsetsPerSecond = seconds > 0.0f ? analysis->transients.size() / seconds : 0.0f;
+        analysis->tonal = totalEnergy > 0.0f && tonalEnergy > 0.6f * totalEnergy && onsetsPerSecond < 3.0f;
+        return analysis;
+    }
+
+    template <typename T>
+    static void write(std::ofstream& file, const T* data, size_t count)
+    {
+        file.write((const char*)data, count * sizeof(T));
+    }
+
+    template <typename T>
+    static bool read(std::ifstream& file, T* data, size_t count)
+    {
+        return (bool)file.read((char*)data, count * sizeof(T));
+    }
+
+    static void saveCache(const StretchAnalysis& analysis)
+    {
+        std::ofstream file(cachePath(analysis.path), std::ios::binary);
+        if (!file) {
+            return;
+        }
+        uint32_t header[] = { CACHE_MAGIC, CACHE_VERSION, analysis.stride, analysis.length, analysis.frames,
+            (uint32_t)analysis.transients.size(), analysis.tonal };
+        write(file, header, 7);
+        write(file, &analysis.count, 1);
+        write(file, analysis.magnitudes.data(), analysis.magnitudes.size());
+        write(file, analysis.phases.data(), analysis.phases.size());
+        write(file, analysis.periods.data(), analysis.periods.size());
+        write(file, analysis.transients.data(), analysis.transients.size());
+    }
+
+    // NULL if there is no cache, or if it is older than the sample or doesn't match the request
+    static std::unique_ptr<StretchAnalysis> loadCache(const Request& request)
+    {
+        std::string path = cachePath(request.path);
+        std::error_code error;
+        if (!std::filesystem::exists(path, error)
+            || std::filesystem::last_write_time(path, error) < std::filesystem::last_write_time(request.path, error)) {
+            return NULL;
+        }
+        std::ifstream file(path, std::ios::binary);
+        uint32_t header[7];
+        uint64_t count;
+        if (!read(file, header, 7) || !read(file, &count, 1) || header[0] != CACHE_MAGIC || header[1] != CACHE_VERSION
+            || header[2] != request.stride || count != request.count || header[4] != header[3] / StretchAnalysis::HOP + 1) {
+            return NULL;
+        }
+
+        std::unique_ptr<StretchAnalysis> analysis = std::make_unique<StretchAnalysis>();
+        analysis->path = request.path;
+        analysis->count = count;
+        analysis->stride = header[2];
+        analysis->length = header[3];
+        analysis->frames = header[4];
+        analysis->transients.resize(header[5]);
+        analysis->tonal = header[6];
+        analysis->magnitudes.resize(analysis->frames * StretchAnalysis::BINS);
+        analysis->phases.resize(analysis->frames * StretchAnalysis::BINS);
+        analysis->periods.resize(analysis->frames);
+        if (!read(file, analysis->magnitudes.data(), analysis->magnitudes.size())
+            || !read(file, analysis->phases.data(), analysis->phases.size())
+            || !read(file, analysis->periods.data(), analysis->periods.size())
+            || !read(file, analysis->transients.data(), analysis->transients.size())) {
+            return NULL;
+        }
+        return analysis;
+    }
+
+    // Read the cache, or analyse the sample and cache it, without the lock
+    static std::unique_ptr<StretchAnalysis> build(const Request& request)
+    {
+        std::unique_ptr<StretchAnalysis> analysis = loadCache(request);
+        if (analysis) {
+            return analysis;
+        }
+        std::vector<float> signal;
+        if (!readSignal(request, signal) || signal.empty()) {
+            return NULL;
+        }
+        analysis = analyse(request, signal);
+        saveCache(*analysis);
+        logDebug("Stretch analysis of %s: %d frames, %d onsets, %s", request.path.c_str(), analysis->frames,
+            (int)analysis->transients.size(), analysis->tonal ? "tonal" : "percussive");
+        return analysis;
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            worker.cv.wait(lock, [&] { return !worker.isRunning() || !queue.empty(); });
+            if (!worker.isRunning()) {
+                return;
+            }
+            Request request = queue.front();
+            const StretchAnalysis* analysis = find(request);
+            if (!analysis) {
+                lock.unlock();
+                std::unique_ptr<StretchAnalysis> built = build(request);
+                lock.lock();
+                if (built) {
+                    analysis = built.get();
+                    analyses.push_back(std::move(built));
+                }
+            }
+            // The front request stays in the queue while building, its target being cleared if cancelled
+            std::atomic<const StretchAnalysis*>* target = queue.front().target;
+            queue.pop_front();
+            if (target && analysis) {
+                target->store(analysis, std::memory_order_release);
+            }
+        }
+    }
+
+    // Must be called with the lock held, see WavetableBank::cancelLocked()
+    void cancelLocked(std::atomic<const StretchAnalysis*>* target)
+    {
+        for (size_t i = 0; i < queue.size();) {
+            if (queue[i].target == target) {
+                if (i == 0) {
+                    queue[0].target = NULL;
+                    i++;
+                } else {
+                    queue.erase(queue.begin() + i);
+                }
+            } else {
+                i++;
+            }
+        }
+    }
+
+public:
+    static StretchAnalysisBank& get()
+    {
+        return processSingleton<StretchAnalysisBank>();
+    }
+
+    // Store the analysis of the first `count` samples of the file in `target` once ready, right away if it was
+    // already built. `target` is cleared until then, a previous request of the same target being replaced.
+    void request(std::string path, uint64_t count, uint32_t stride, std::atomic<const StretchAnalysis*>* target)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        cancelLocked(target);
+        Request request = { path, count, std::max(stride, (uint32_t)1), target };
+        const StretchAnalysis* analysis = find(request);
+        target->store(analysis, std::memory_order_release);
+        if (!analysis) {
+            queue.push_back(request);
+            worker.wake();
+        }
+    }
+
+    // Forget the pending requests of `target`, e.g. before it is destroyed
+    void cancel(std::atomic<const StretchAnalysis*>* target)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        cancelLocked(target);
+    }
+};
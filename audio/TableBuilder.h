@@ -0,0 +1,171 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+
+#include "audio/TableCache.h"
+#include "audio/WavetableInterface.h"
+#include "audio/lookupTable.h"
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+
+// Worker thread rebuilding the lookup tables of the generators when one of their parameters changes, so turning a
+// morph knob never computes a whole table on the thread turning it.
+class TableBuilder {
+public:
+    class Job {
+    public:
+        virtual void build() = 0;
+    };
+
+protected:
+    std::mutex mtx;
+    std::deque<Job*> queue;
+    // Signaled each time a job is done, for `cancel()` to wait on the one being built
+    std::condition_variable doneCv;
+    Job* building = NULL;
+    Worker worker { mtx, "tables", [this] { workerLoop(); } };
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            worker.cv.wait(lock, [&] { return !worker.isRunning() || !queue.empty(); });
+            if (!worker.isRunning()) {
+                return;
+            }
+            building = queue.front();
+            queue.pop_front();
+            lock.unlock();
+            building->build();
+            lock.lock();
+            building = NULL;
+            doneCv.notify_all();
+        }
+    }
+
+public:
+    static TableBuilder& get()
+    {
+        return processSingleton<TableBuilder>();
+    }
+
+    // Build the job once the worker is free. A job already queued is not queued twice: it reads its parameters when
+    // it runs, so a knob sweep only builds the latest table.
+    void request(Job* job)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        if (std::find(queue.begin(), queue.end(), job) != queue.end()) {
+            return;
+        }
+        queue.push_back(job);
+        worker.wake();
+    }
+
+    // Wait for all the queued jobs to be built, for the threads rendering ahead of time (never the audio thread)
+    void wait()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        doneCv.wait(lock, [&] { return queue.empty() && building == NULL; });
+    }
+
+    // Forget the job and wait for it to be done if it is being built, e.g. before it is destroyed
+    void cancel(Job* job)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        queue.erase(std::remove(queue.begin(), queue.end(), job), queue.end());
+        doneCv.wait(lock, [&] { return building != job; });
+    }
+};
+
+// Lookup table generator with 3 tables: the one played by the audio thread, the one built by the worker and the
+// latest one built, waiting to be played. The worker never writes the played table, so the audio thread only
+// switches to a new table in `update()`, ideally at the start of a block, and never hears a half built one.
+//
+// The tables come from the TableCache, so the generators with the same parameters share the same table, only built
+// by the first one. A table is only released by the worker, when it takes the slot of a table no longer played.
+class TableGenerator : public WavetableInterface, protected TableBuilder::Job {
+protected:
+    static const uint8_t FRESH = 4;
+
+    TableCache::Ref tables[3];
+    float* lut = NULL;
+    uint8_t front = 0;
+    uint8_t back = 1;
+    // Index of the latest table built, with the FRESH flag until the audio thread takes it
+    std::atomic<uint8_t> middle = 2;
+
+    // Key of the table for the current parameters, see `TableCache::key()`, and how to fill it. The parameters are
+    // read once, here, as they may change while the table is being filled.
+    virtual TableCache::Fill recipe(uint64_t& key) = 0;
+
+    TableCache::Ref acquire()
+    {
+        uint64_t key;
+        TableCache::Fill fill = recipe(key);
+        return TableCache::get().acquire(key, sampleCount, fill);
+    }
+
+    void build() override
+    {
+        tables[back] = acquire();
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & 3;
+    }
+
+    // To be called by the constructor of the generator, the first table being taken right away
+    void init()
+    {
+        tables[front] = acquire();
+        lut = tables[front]->data();
+    }
+
+    // Rebuild the table in the background after a parameter changed
+    void requestUpdate()
+    {
+        TableBuilder::get().request(this);
+    }
+
+    // To be called by the destructor of the generator, before its members used by `fill()` are destroyed
+    void cancelUpdate()
+    {
+        TableBuilder::get().cancel(this);
+    }
+
+    static float linearInterpolation(float index, uint64_t size, const float* table)
+    {
+        float fIndex = index * size;
+        int i0 = static_cast<int>(fIndex) % size;
+        int i1 = (i0 + 1) % size;
+        float frac = fIndex - static_cast<float>(i0);
+        return table[i0] * (1.0f - frac) + table[i1] * frac;
+    }
+
+public:
+    TableGenerator(uint64_t size = LOOKUP_TABLE_SIZE)
+        : WavetableInterface(size)
+    {
+    }
+
+    // Play the latest table built, if any. Must be called from the audio thread.
+    void update()
+    {
+        if (middle.load(std::memory_order_relaxed) & FRESH) {
+            front = middle.exchange(front, std::memory_order_acq_rel) & 3;
+            lut = tables[front]->data();
+        }
+    }
+
+    float next(float index)
+    {
+        return linearInterpolation(index, sampleCount, lut);
+    }
+
+    float* samples() override
+    {
+        return lut;
+    }
+};
@@ -0,0 +1,120 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <initializer_list>
+#include <memory>
+#include <mutex>
+#include <unordered_map>
+#include <vector>
+
+#include "helpers/processSingleton.h"
+#include "plugins/audio/utils/MemoryBudget.h"
+
+// Lookup tables of the generators shared by all the plugins and tracks of the process, so the generators using the
+// same settings, e.g. every kick with the default transient, hold the same table instead of each building its own.
+//
+// A table is identified by a key hashing the generator and the parameters it is built from (see `key()`), as it is
+// never modified once built. `acquire()` hands out a reference counted table, built by the calling thread if nobody
+// holds it yet, and dropped once the last generator holding it let it go. The tables are accounted in the
+// MemoryBudget, but never evicted, as they only live while used.
+class TableCache {
+public:
+    typedef std::shared_ptr<std::vector<float>> Ref;
+    typedef std::function<void(float* table)> Fill;
+
+protected:
+    std::mutex mtx;
+    std::unordered_map<uint64_t, std::weak_ptr<std::vector<float>>> tables;
+
+    // Must be called with the lock held
+    void prune()
+    {
+        for (auto it = tables.begin(); it != tables.end();) {
+            it = it->second.expired() ? tables.erase(it) : std::next(it);
+        }
+    }
+
+    int budgetId = -1;
+
+    size_t memory()
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        size_t bytes = 0;
+        for (auto& table : tables) {
+            Ref held = table.second.lock();
+            bytes += held ? held->size() * sizeof(float) : 0;
+        }
+        return bytes;
+    }
+
+    friend TableCache& processSingleton<TableCache>();
+
+    // The memory budget is created first so it is destroyed last, the cache unregistering from it
+    TableCache()
+        : budgetId(MemoryBudget::get().add("tables", MemoryBudget::HIGH, [this] { return memory(); }))
+    {
+    }
+
+public:
+    static TableCache& get()
+    {
+        return processSingleton<TableCache>();
+    }
+
+    ~TableCache()
+    {
+        MemoryBudget::get().remove(budgetId);
+    }
+
+    // FNV-1a of the name of the generator and of the exact values of its parameters
+    static uint64_t key(const char* generator, std::initializer_list<float> params)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        auto mix = [&](const void* data, size_t size) {
+            for (size_t i = 0; i < size; i++) {
+                hash = (hash ^ ((const uint8_t*)data)[i]) * 0x100000001b3ull;
+            }
+        };
+        mix(generator, strlen(generator) + 1);
+        for (float param : params) {
+            mix(&param, sizeof(param));
+        }
+        return hash;
+    }
+
+    // Table of `size` values for `key`, filled by `fill` if it is not held by any generator yet. The table must not
+    // be modified, other generators may be playing it.
+    Ref acquire(uint64_t key, size_t size, Fill fill)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            auto it = tables.find(key);
+            if (it != tables.end()) {
+                Ref table = it->second.lock();
+                if (table && table->size() == size) {
+                    return table;
+                }
+            }
+        }
+
+        // Built without holding the lock, so other tables are still served meanwhile
+        Ref table = std::make_shared<std::vector<float>>(size);
+        fill(table->data());
+
+        std::lock_guard<std::mutex> guard(mtx);
+        // Built at the same time by another thread, keep the first one
+        auto it = tables.find(key);
+        if (it != tables.end()) {
+            Ref first = it->second.lock();
+            if (first && first->size() == size) {
+                return first;
+            }
+        }
+        prune();
+        tables[key] = table;
+        MemoryBudget::get().changed();
+        return table;
+    }
+};
@@ -25,13 +25,16 @@ sha: 9f3327bdf445a10a4012eb8094aaabfa86dc87789a239ff858ce7ea7449e796d
 #pragma once
 
 #include "helpers/clamp.h"
-#include "audio/WavetableInterface.h"
-#include "audio/utils/linearInterpolation.h"
+#include "audio/TableBuilder.h"
 
+#include <atomic>
 #include <cmath>
 #include <string>
 
-class TransientGenerator : public WavetableInterface {
+// The tables are shared with the generators of the same duration, type and morph, see TableCache, and rebuilt by the
+// TableBuilder worker when one of them changes: `update()` must be called by the audio thread, e.g. at the start of
+// each block, to play the latest one.
+class TransientGenerator : public TableGenerator {
 public:
     enum class Type {
         Click,
@@ -76,22 +79,27 @@ public:
     }
 
     TransientGenerator(uint64_t sampleRate, float durationMs = 200.0f)
-        : WavetableInterface(static_cast<uint64_t>((sampleRate * durationMs) / 1000.0f))
+        : TableGenerator(static_cast<uint64_t>((sampleRate * durationMs) / 1000.0f))
         , sampleRate(sampleRate)
     {
-        setType(Type::Click);
+        init();
+    }
+
+    ~TransientGenerator()
+    {
+        cancelUpdate();
     }
 
     void setType(Type t)
     {
         type = t;
-        updateTable();
+        requestUpdate();
     }
 
     void setMorph(float m)
     {
         morph = CLAMP(m, 0.0f, 1.0f);
-        updateTable();
+        requestUpdate();
     }
 
     float getMorph() { return morph; }
@@ -104,7 +112,7 @@ public:
         int typeIndex = static_cast<int>(scaled);
         type = static_cast<Type>(typeIndex);
         morph = scaled - static_cast<float>(typeIndex);
-        updateTable();
+        requestUpdate();
     }
 
     float next(float* index)
@@ -126,16 +134,11 @@ public:
         return &lut[static_cast<uint64_t>(*index * sampleCount)];
     }
 
-    float* samples() override
-    {
-        return lut;
-    }
-
 private:
     uint64_t sampleRate;
-    Type type = Type::Click;
-    float morph = 0.0f;
-    float* lut = new float[sampleCount]; // you might prefer static allocation
+    // Read by the worker while building the table
+    std::atomic<Type> type = Type::Click;
+    std::atomic<float> morph = 0.0f;
 
     // static float linearInterpolation(float index, uint64_t size, const float* table)
     // {
@@ -146,12 +149,17 @@ private:
     //     return table[i0] * (1.0f - frac) + table[i1] * frac;
     // }
 
-    void updateTable()
+    TableCache::Fill recipe(uint64_t& key) override
     {
-        for (uint64_t i = 0; i < sampleCount; ++i) {
-            float x = static_cast<float>(i) / sampleCount;
-            lut[i] = generateSample(type, x, morph);
-        }
+        Type t = type;
+        float m = morph;
+        key = TableCache::key("Transient", { (float)sampleCount, (float)t, m });
+        return [this, t, m](float* lut) {
+            for (uint64_t i = 0; i < sampleCount; ++i) {
+                float x = static_cast<float>(i) / sampleCount;
+                lut[i] = generateSample(t, x, m);
+            }
+        };
     }
 
     static float generateSample(Type t, float x, float shapeMorph)
@@ -0,0 +1,205 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include "audio/utils/float4.h"
+
+// Plucked strings (Karplus-Strong): a delay line closed by a loss filter, the sound being the excitation going
+// around the loop. `STRINGS` strings are processed together, 4 at a time in SIMD lanes, e.g. for the notes of a chord,
+// the remaining ones one by one.
+//
+// The loop of each string is:
+// - the delay line, read an integer number of frames back
+// - a first order allpass for the fractional part of the length, so the string is in tune at any pitch
+// - the stretch, mixing in the previous frame (0.5 being the 2 points average of the original algorithm)
+// - a one pole lowpass for the tone, and the feedback for the decay.
+// The delay of the filters at the fundamental is removed from the length of the line, see `setFrequency()`.
+template <uint8_t STRINGS>
+class Waveguide {
+protected:
+    static const uint8_t GROUPS = float4::WIDTH == 4 ? STRINGS / 4 : 0;
+
+    float sampleRate;
+    uint32_t size;
+    uint32_t mask;
+    // One line of `size` frames per lane, sharing the write position
+    std::vector<float> lines;
+    uint32_t writePos = 0;
+
+    int32_t length[STRINGS];
+    float loopDelay[STRINGS];
+    float filterDelay[STRINGS];
+
+    float apCoef[STRINGS];
+    float apIn[STRINGS];
+    float apOut[STRINGS];
+    float stretch[STRINGS];
+    float lpCoef[STRINGS];
+    float lpState[STRINGS];
+    float feedback[STRINGS];
+
+    // Phase delay in frames of `b0 + b1 z^-1` over `1 + a1 z^-1` at the frequency `w` (radians per frame)
+    static float phaseDelay(float b0, float b1, float a1, float w)
+    {
+        float num = atan2f(b1 * sinf(w), b0 + b1 * cosf(w));
+        float den = atan2f(a1 * sinf(w), 1.0f + a1 * cosf(w));
+        return (num - den) / w;
+    }
+
+    // Split the length of the line into its integer part and the allpass, kept within [0.5, 1.5[ frames. The
+    // allpass coefficient gives the exact fractional delay at the fundamental, not only at low frequencies.
+    void tune(uint8_t i, float delay)
+    {
+        float d = std::clamp(delay - filterDelay[i], 1.5f, (float)(size - 2));
+        length[i] = (int32_t)(d - 0.5f);
+        float frac = d - length[i];
+        float halfW = (float)M_PI / delay;
+        apCoef[i] = sinf((1.0f - frac) * halfW) / sinf((1.0f + frac) * halfW);
+    }
+
+    // Next frame of the loop of the string `s`, returning its output
+    inline float step(uint8_t s, float input)
+    {
+        float* line = lines.data() + s * size;
+        float x = line[(writePos - length[s]) & mask];
+        float y = apCoef[s] * (x - apOut[s]) + apIn[s];
+        float stretched = y + stretch[s] * (apOut[s] - y);
+        apIn[s] = x;
+        apOut[s] = y;
+        lpState[s] += lpCoef[s] * (stretched - lpState[s]);
+        line[writePos] = lpState[s] * feedback[s] + input;
+        return lpState[s];
+    }
+
+#if defined(FLOAT4)
+    // The 4 strings of the group `g` at once, only the reads and writes of the lines being done one by one
+    inline float4::v4 stepGroup(uint8_t g, float input)
+    {
+        using namespace float4;
+        uint8_t s = g * 4;
+        float read[4];
+        for (int j = 0; j < 4; j++) {
+            read[j] = lines[(s + j) * size + ((writePos - length[s + j]) & mask)];
+        }
+        v4 x = load(read);
+        v4 prev = load(apOut + s);
+        v4 y = add(mul(load(apCoef + s), sub(x, prev)), load(apIn + s));
+        v4 stretched = add(y, mul(load(stretch + s), sub(prev, y)));
+        store(apIn + s, x);
+        store(apOut + s, y);
+        v4 lp = load(lpState + s);
+        lp = add(lp, mul(load(lpCoef + s), sub(stretched, lp)));
+        store(lpState + s, lp);
+        float write[4];
+        store(write, add(mul(lp, load(feedback + s)), set(input)));
+        for (int j = 0; j < 4; j++) {
+            lines[(s + j) * size + writePos] = write[j];
+        }
+        return lp;
+    }
+#endif
+
+public:
+    // `minFrequency` being the lowest note, setting the size of the lines
+    Waveguide(float sampleRate, float minFrequency = 20.0f)
+        : sampleRate(sampleRate)
+    {
+        size = 1;
+        while (size < sampleRate / minFrequency + 4) {
+            size <<= 1;
+        }
+        mask = size - 1;
+        lines.assign(size * STRINGS, 0.0f);
+        for (uint8_t i = 0; i < STRINGS; i++) {
+            apIn[i] = apOut[i] = lpState[i] = 0.0f;
+            filterDelay[i] = 0.0f;
+            stretch[i] = 0.5f;
+            lpCoef[i] = 1.0f;
+            feedback[i] = 0.99f;
+            loopDelay[i] = sampleRate / 220.0f;
+            tune(i, loopDelay[i]);
+        }
+    }
+
+    // Set the filters of the loop: `lowpass` the one pole coefficient (1 being no filtering), `feedback` below 1
+    // for the string to decay and `stretchAmount` from 0 to 0.5. The string is retuned, so it keeps its pitch.
+    void setLoss(uint8_t s, float lowpass, float feedbackAmount, float stretchAmount = 0.5f)
+    {
+        lpCoef[s] = std::clamp(lowpass, 0.0001f, 1.0f);
+        feedback[s] = feedbackAmount;
+        stretch[s] = std::clamp(stretchAmount, 0.0f, 0.5f);
+        float w = 2.0f * (float)M_PI / std::max(loopDelay[s], 2.0f);
+        filterDelay[s] = phaseDelay(1.0f - stretch[s], stretch[s], 0.0f, w) + phaseDelay(lpCoef[s], 0.0f, lpCoef[s] - 1.0f, w);
+        tune(s, loopDelay[s]);
+    }
+
+    void setFrequency(uint8_t s, float hz)
+    {
+        loopDelay[s] = sampleRate / std::clamp(hz, 1.0f, sampleRate * 0.45f);
+        setLoss(s, lpCoef[s], feedback[s], stretch[s]);
+    }
+
+    // Change the pitch by `ratio` without recomputing the filter delays, cheap enough to be called every frame,
+    // e.g. for vibrato
+    void detune(uint8_t s, float ratio)
+    {
+        tune(s, loopDelay[s] / ratio);
+    }
+
+    // Frames read by the loop before it comes back to the first one, the period of the excitation
+    uint32_t delayLength(uint8_t s)
+    {
+        return length[s];
+    }
+
+    // Fill the next `delayLength()` frames the string reads with `excitation(j, length)`, e.g. noise for a pluck
+    template <typename Fn>
+    void excite(uint8_t s, Fn excitation)
+    {
+        float* line = lines.data() + s * size;
+        uint32_t n = length[s];
+        for (uint32_t j = 0; j < n; j++) {
+            line[(writePos + j - n) & mask] = excitation(j, n);
+        }
+        apIn[s] = apOut[s] = lpState[s] = 0.0f;
+    }
+
+    void reset()
+    {
+        std::fill(lines.begin(), lines.end(), 0.0f);
+        for (uint8_t i = 0; i < STRINGS; i++) {
+            apIn[i] = apOut[i] = lpState[i] = 0.0f;
+        }
+    }
+
+    // Next frame of all the strings summed, `input` being fed into each loop (e.g. a bow noise)
+    float process(float input = 0.0f)
+    {
+        float out = 0.0f;
+#if defined(FLOAT4)
+        if (GROUPS > 0) {
+            float4::v4 total = float4::set(0.0f);
+            for (uint8_t g = 0; g < GROUPS; g++) {
+                total = float4::add(total, stepGroup(g, input));
+            }
+            out = float4::sum(total);
+        }
+#endif
+        for (uint8_t s = GROUPS * 4; s < STRINGS; s++) {
+            out += step(s, input);
+        }
+        writePos = (writePos + 1) & mask;
+        return out;
+    }
+
+    // Render `frames` frames of the strings summed to `out`, `stride` apart
+    void processBlock(float* out, uint32_t stride, uint32_t frames)
+    {
+        for (uint32_t f = 0; f < frames; f++) {
+            out[f * stride] = process();
+        }
+    }
+};
@@ -15,32 +15,61 @@ sha: e06e62e5ef520c78f65a0a88da9371d38c1f0e3a82a343d2cc11ff91e4011cbd
 */
 #pragma once
 
-#include <sndfile.h>
-#include <string.h>
+#include <atomic>
 #include <string>
 
-#include "log.h"
-
 #include "audio/fileBrowser.h"
+#include "audio/WavetableBank.h"
 #include "audio/WavetableInterface.h"
 #include "audio/utils/linearInterpolation.h"
+#include "helpers/clamp.h"
 #include "host/constants.h"
 
-#define ZIC_WAVETABLE_WAVEFORMS_COUNT 64
-
+// Wavetable file of 64 waveforms, shared through the WavetableBank: opening another file while playing only
+// requests it, the current table being played until the new one is ready. Playback reads the mipmap level
+// matching the phase increment, so high notes don't alias.
 class Wavetable : public WavetableInterface {
 protected:
-    SF_INFO sfinfo;
-    SNDFILE* file = NULL;
+    // Table being played, replaced by `pending` once the bank built the requested one
+    std::atomic<const WavetableBank::Table*> table = NULL;
+    std::atomic<const WavetableBank::Table*> pending = NULL;
+    std::atomic<int> waveformIndex = 0;
+
+    static const float* silence()
+    {
+        static const float samples[2] = { 0.0f, 0.0f };
+        return samples;
+    }
 
-    // Buffer size: 64 waveforms × 8256 samples max per waveform = 528384 samples
-    // This handles files up to ~2.1MB (covers all standard wavetable formats)
-    static const uint64_t bufferSize = ZIC_WAVETABLE_WAVEFORMS_COUNT * 8256;
-    uint64_t bufferSampleCount = 0;
-    uint64_t maxSampleStart = -1;
-    float bufferSamples[bufferSize];
+    void use(const WavetableBank::Table* newTable)
+    {
+        table.store(newTable, std::memory_order_release);
+        sampleCount = newTable->waveformSize;
+    }
+
+    // Switch to the requested table, from the thread playing the wavetable
+    const WavetableBank::Table* current()
+    {
+        if (pending.load(std::memory_order_relaxed)) {
+            const WavetableBank::Table* ready = pending.exchange(NULL, std::memory_order_acquire);
+            if (ready) {
+                use(ready);
+            }
+        }
+        return table.load(std::memory_order_acquire);
+    }
 
-    uint64_t sampleStart = 0;
+    float play(const WavetableBank::Table* t, float* index, float sampleInc, int waveform)
+    {
+        (*index) += sampleInc;
+        while ((*index) >= sampleCount) {
+            (*index) -= sampleCount;
+        }
+        uint8_t level = t->levelFor(sampleInc);
+        const WavetableBank::Table::Level& l = t->levels[level];
+        float levelIndex = *index * l.size / t->waveformSize;
+        return linearInterpolationAbsolute(levelIndex, l.size, t->waveform(level, waveform));
+    }
 
 public:
     float sampleIndex = 0.0f;
@@ -49,61 +78,63 @@ public:
     Wavetable()
         : WavetableInterface(2048)
     {
-        memset(&sfinfo, 0, sizeof(sfinfo));
         open(0, true);
     }
 
+    ~Wavetable()
+    {
+        WavetableBank::get().cancel(&pending);
+    }
+
+    // Current waveform at the full resolution
     float* samples()
     {
-        return bufferSamples + sampleStart;
+        const WavetableBank::Table* t = table.load(std::memory_order_acquire);
+        return t ? (float*)t->waveform(0, waveformIndex) : (float*)silence();
     }
 
     float* sample(float* index) override
     {
-        return &bufferSamples[(uint16_t)(*index * sampleCount) + sampleStart];
+        const WavetableBank::Table* t = table.load(std::memory_order_acquire);
+        if (!t) {
+            return (float*)silence();
+        }
+        return (float*)t->waveform(0, waveformIndex) + (uint16_t)(*index * t->waveformSize);
     }
 
     float sample(float* index, float sampleInc) override
     {
-        (*index) += sampleInc;
-        while ((*index) >= sampleCount) {
-            (*index) -= sampleCount;
-        }
-        // return bufferSamples[(uint16_t)(*index) + sampleStart];
-        return linearInterpolationAbsolute(*index, sampleCount, bufferSamples + sampleStart);
+        const WavetableBank::Table* t = current();
+        return t ? play(t, index, sampleInc, waveformIndex) : 0.0f;
     }
 
     float sample(float* index, float sampleInc, float lfo)
     {
-        (*index) += sampleInc;
-        while ((*index) >= sampleCount) {
-            (*index) -= sampleCount;
+        const WavetableBank::Table* t = current();
+        if (!t) {
+            return 0.0f;
         }
-        // int pos = CLAMP(sampleStart + lfo * bufferSampleCount, 0, bufferSampleCount - sampleCount);
         int p = ZIC_WAVETABLE_WAVEFORMS_COUNT * lfo;
-        int pos = CLAMP(sampleStart + p * sampleCount, 0, bufferSampleCount - sampleCount);;
-        return linearInterpolationAbsolute(*index, sampleCount, bufferSamples + pos);
+        return play(t, index, sampleInc, CLAMP(waveformIndex + p, 0, t->waveformCount - 1));
     }
 
     void close()
     {
-        if (file) {
-            sf_close(file);
-        }
+        WavetableBank::get().cancel(&pending);
     }
 
+    // Load the file, waiting for it when nothing is played yet, e.g. when the plugin is created
     void open(std::string filename)
     {
-        close();
-
-        if (!(file = sf_open(filename.c_str(), SFM_READ, &sfinfo))) {
-            logError("Error: could not open file %s\n", filename.c_str());
+        WavetableBank& bank = WavetableBank::get();
+        if (table.load() == NULL) {
+            const WavetableBank::Table* loaded = bank.load(filename);
+            if (loaded) {
+                use(loaded);
+            }
+            return;
         }
-        logTrace("Audio file %s sampleCount %ld sampleRate %d\n", filename.c_str(), (long)sfinfo.frames, sfinfo.samplerate);
-
-        bufferSampleCount = sf_read_float(file, bufferSamples, bufferSize);
-        sampleCount = bufferSampleCount / (float)ZIC_WAVETABLE_WAVEFORMS_COUNT;
-        maxSampleStart = bufferSampleCount / ZIC_WAVETABLE_WAVEFORMS_COUNT * (ZIC_WAVETABLE_WAVEFORMS_COUNT - 1);
+        bank.request(filename, &pending);
     }
 
     void open(int position, bool force)
@@ -115,21 +146,21 @@ public:
         }
     }
 
+    // Load all the wavetables of the folder in the background
+    void preload()
+    {
+        WavetableBank::get().preload(AUDIO_FOLDER + "/wavetables");
+    }
+
     void morph(float pct)
     {
-        sampleStart = pct * bufferSampleCount;
-        if (sampleStart > maxSampleStart) {
-            sampleStart = maxSampleStart;
-        }
+        morph((int)(pct * ZIC_WAVETABLE_WAVEFORMS_COUNT));
     }
 
     void morph(int index)
     {
-        sampleStart = index * sampleCount;
-        if (sampleStart > maxSampleStart) {
-            sampleStart = maxSampleStart;
-        }
+        waveformIndex = CLAMP(index, 0, ZIC_WAVETABLE_WAVEFORMS_COUNT - 1);
     }
 
-    int getIndex() { return sampleStart / sampleCount; }
+    int getIndex() { return waveformIndex; }
 };
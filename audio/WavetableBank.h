@@ -0,0 +1,271 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <cstring>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <sndfile.h>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "log.h"
+
+#include "audio/fileBrowser.h"
+#include "audio/utils/fft.h"
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+
+#define ZIC_WAVETABLE_WAVEFORMS_COUNT 64
+
+// Wavetable files loaded once per process and shared by all the plugins using them, with band-limited mipmaps so
+// high notes don't alias.
+//
+// Each level of a table keeps half the harmonics of the previous one, level `k` being used for a phase increment
+// up to `2^k` samples of the original waveform per output sample. The levels are band-limited in the frequency
+// domain and stored with at least 4 samples per harmonic, so the linear interpolation stays clean.
+//
+// Loading a file and building its mipmaps is too slow for the threads turning the knobs, so `request()` only
+// queues it: the bank worker builds the table and hands it over through an atomic pointer. Tables are never freed
+// before the bank, so a table stays valid for the audio thread even once another one replaced it.
+class WavetableBank {
+public:
+    struct Table {
+        std::string path;
+        uint8_t waveformCount = ZIC_WAVETABLE_WAVEFORMS_COUNT;
+        // Samples of each waveform of the original file
+        uint32_t waveformSize = 0;
+
+        struct Level {
+            uint32_t size;
+            // `waveformCount` waveforms of `size` samples
+            std::vector<float> samples;
+        };
+        std::vector<Level> levels;
+
+        // Mipmap level for a phase increment of `inc` samples of the original waveform per output sample
+        uint8_t levelFor(float inc) const
+        {
+            uint8_t level = 0;
+            while (inc > 1.0f && level + 1 < levels.size()) {
+                inc *= 0.5f;
+                level++;
+            }
+            return level;
+        }
+
+        const float* waveform(uint8_t level, uint8_t index) const
+        {
+            const Level& l = levels[level];
+            return l.samples.data() + index * l.size;
+        }
+    };
+
+protected:
+    std::mutex mtx;
+    std::unordered_map<std::string, std::unique_ptr<Table>> tables;
+
+    struct Request {
+        std::string path;
+        std::atomic<const Table*>* target;
+    };
+    std::deque<Request> queue;
+    Worker worker { mtx, "wavetables", [this] { workerLoop(); } };
+
+    static bool isPowerOfTwo(uint32_t n)
+    {
+        return n && !(n & (n - 1));
+    }
+
+    static void buildMipmaps(Table& table, std::vector<float>& samples)
+    {
+        uint32_t size = table.waveformSize;
+        table.levels.push_back({ size, std::move(samples) });
+        // Only power of two waveforms go through the FFT, the others are played without mipmaps
+        if (!isPowerOfTwo(size) || size < 8 || size > RealFft::MAX_SIZE) {
+            return;
+        }
+
+        RealFft fft(size);
+        std::vector<std::vector<std::complex<float>>> spectrums(table.waveformCount);
+        for (uint8_t w = 0; w < table.waveformCount; w++) {
+            spectrums[w].resize(fft.bins());
+            fft.forward(table.waveform(0, w), spectrums[w].data());
+        }
+
+        for (uint32_t harmonics = size / 4; harmonics >= 1; harmonics /= 2) {
+            uint32_t levelSize = std::min(size, std::max(8 * harmonics, (uint32_t)8));
+            Table::Level level = { levelSize, std::vector<float>(levelSize * table.waveformCount) };
+            RealFft levelFft(levelSize);
+            std::vector<std::complex<float>> bins(levelFft.bins());
+            for (uint8_t w = 0; w < table.waveformCount; w++) {
+                std::fill(bins.begin(), bins.end(), 0.0f);
+                for (uint32_t h = 0; h <= harmonics && h < levelSize / 2; h++) {
+                    bins[h] = spectrums[w][h];
+                }
+                float* out = level.samples.data() + w * levelSize;
+                levelFft.inverse(bins.data(), out);
+                for (uint32_t i = 0; i < levelSize; i++) {
+                    out[i] /= size;
+                }
+            }
+            table.levels.push_back(std::move(level));
+        }
+    }
+
+    // Read the file and build its mipmaps, without the lock
+    static std::unique_ptr<Table> build(std::string path)
+    {
+        SF_INFO sfinfo;
+        memset(&sfinfo, 0, sizeof(sfinfo));
+        SNDFILE* file = sf_open(path.c_str(), SFM_READ, &sfinfo);
+        if (!file) {
+            logError("Error: could not open file %s\n", path.c_str());
+            return NULL;
+        }
+        logTrace("Audio file %s sampleCount %ld sampleRate %d\n", path.c_str(), (long)sfinfo.frames, sfinfo.samplerate);
+
+        std::unique_ptr<Table> table = std::make_unique<Table>();
+        table->path = path;
+        // Up to 64 waveforms of 8256 samples, covering the standard wavetable formats
+        uint64_t maxSamples = ZIC_WAVETABLE_WAVEFORMS_COUNT * 8256;
+        std::vector<float> samples(std::min<uint64_t>(sfinfo.frames * sfinfo.channels, maxSamples));
+        uint64_t count = sf_read_float(file, samples.data(), samples.size());
+        sf_close(file);
+
+        table->waveformSize = count / ZIC_WAVETABLE_WAVEFORMS_COUNT;
+        if (table->waveformSize == 0) {
+            logError("Error: wavetable %s is too short\n", path.c_str());
+            return NULL;
+        }
+        samples.resize(table->waveformSize * ZIC_WAVETABLE_WAVEFORMS_COUNT);
+        buildMipmaps(*table, samples);
+        return table;
+    }
+
+    // Keep the first table built for a path, as it may already be used
+    const Table* insert(std::unique_ptr<Table> table)
+    {
+        auto it = tables.find(table->path);
+        if (it != tables.end()) {
+            return it->second.get();
+        }
+        const Table* result = table.get();
+        tables[table->path] = std::move(table);
+        return result;
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            worker.cv.wait(lock, [&] { return !worker.isRunning() || !queue.empty(); });
+            if (!worker.isRunning()) {
+                return;
+            }
+            std::string path = queue.front().path;
+            auto it = tables.find(path);
+            const Table* table = it != tables.end() ? it->second.get() : NULL;
+            if (!table) {
+                lock.unlock();
+                std::unique_ptr<Table> built = build(path);
+                lock.lock();
+                table = built ? insert(std::move(built)) : NULL;
+            }
+            // The front request stays in the queue while building, its target being cleared if cancelled
+            std::atomic<const Table*>* target = queue.front().target;
+            queue.pop_front();
+            if (target && table) {
+                target->store(table, std::memory_order_release);
+            }
+        }
+    }
+
+public:
+    static WavetableBank& get()
+    {
+        return processSingleton<WavetableBank>();
+    }
+
+    // Table of the file, built on the calling thread if needed. NULL if the file can't be read.
+    const Table* load(std::string path)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            auto it = tables.find(path);
+            if (it != tables.end()) {
+                return it->second.get();
+            }
+        }
+        std::unique_ptr<Table> table = build(path);
+        if (!table) {
+            return NULL;
+        }
+        std::lock_guard<std::mutex> guard(mtx);
+        return insert(std::move(table));
+    }
+
+    // Store the table of the file in `target` once ready, right away if it is already loaded. Never waits for the
+    // file to be read, a previous request of the same target being replaced.
+    void request(std::string path, std::atomic<const Table*>* target)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        auto it = tables.find(path);
+        if (it != tables.end()) {
+            cancelLocked(target);
+            target->store(it->second.get(), std::memory_order_release);
+            return;
+        }
+        cancelLocked(target);
+        queue.push_back({ path, target });
+        worker.wake();
+    }
+
+    // Forget the pending requests of `target`, e.g. before it is destroyed
+    void cancel(std::atomic<const Table*>* target)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        cancelLocked(target);
+    }
+
+    // Load all the wavetables of the folder in the background, so switching between them is instant
+    void preload(std::string folder)
+    {
+        FileBrowser browser(folder);
+        std::lock_guard<std::mutex> guard(mtx);
+        for (uint16_t i = 1; i <= browser.count; i++) {
+            std::string path = browser.getFilePath(i);
+            if (tables.find(path) == tables.end()) {
+                queue.push_back({ path, NULL });
+            }
+        }
+        worker.wake();
+    }
+
+protected:
+    // Must be called with the lock held. The request being built is the front one: it is kept with a NULL target,
+    // so the worker still inserts its table but doesn't hand it over.
+    void cancelLocked(std::atomic<const Table*>* target)
+    {
+        if (!target) {
+            return;
+        }
+        for (size_t i = 0; i < queue.size();) {
+            if (queue[i].target == target) {
+                if (i == 0) {
+                    queue[0].target = NULL;
+                    i++;
+                } else {
+                    queue.erase(queue.begin() + i);
+                }
+            } else {
+                i++;
+            }
+        }
+    }
+};
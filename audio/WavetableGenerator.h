@@ -23,12 +23,15 @@ sha: 0b8ff8a9894621df7e9f9639907068a8f85567cc0350a1a58450c995649dfe70
 
 #include "helpers/clamp.h"
 #include "audio/lookupTable.h"
-#include "audio/WavetableInterface.h"
-#include "audio/utils/linearInterpolation.h"
+#include "audio/TableBuilder.h"
 
+#include <atomic>
 #include <cstdint>
 
-class WavetableGenerator : public WavetableInterface {
+// The tables are shared with the generators of the same type, shape and macro, see TableCache, and rebuilt by the
+// TableBuilder worker when one of them changes: `update()` must be called by the audio thread, e.g. at the start of
+// each block, to play the latest one.
+class WavetableGenerator : public TableGenerator {
 public:
     enum Type {
         Sine,
@@ -44,13 +47,12 @@ protected:
     LookupTable* sharedLut;
     uint64_t sampleRate;
 
-    float lut[LOOKUP_TABLE_SIZE];
-
-    Type selectedType = Type::Sine;
+    // Read by the worker while building the table
+    std::atomic<Type> selectedType = Type::Sine;
 
     // Use shape to introduce harmonic components (second and third harmonics).
     // Use macro to adjust the balance between the second and third harmonics for creative wave shaping.
-    void loadSineType()
+    void loadSineType(float* lut, float shape, float macro)
     {
         float maxAmplitude = 1.0f; // To track maximum amplitude for normalization
 
@@ -74,7 +76,7 @@ protected:
         }
     }
 
-    void loadSawtoothType()
+    void loadSawtoothType(float* lut, float shape, float macro)
     {
         for (uint16_t i = 0; i < sampleCount; i++) {
             float phase = i / (float)sampleCount; // Normalized phase [0, 1)
@@ -112,7 +114,7 @@ protected:
         }
     }
 
-    void loadTriangleType()
+    void loadTriangleType(float* lut, float shape, float macro)
     {
         float pulse = CLAMP(macro, 0.05f, 1.0f);
         for (uint16_t i = 0; i < sampleCount; i++) {
@@ -136,7 +138,7 @@ protected:
         }
     }
 
-    void loadPulseType()
+    void loadPulseType(float* lut, float shape, float macro)
     {
         float pulse = CLAMP(macro, 0.1f, 0.9f);
         for (uint16_t i = 0; i < sampleCount; i++) {
@@ -183,7 +185,7 @@ protected:
         }
     }
 
-    void loadSquareType()
+    void loadSquareType(float* lut, float shape, float macro)
     {
         for (uint16_t i = 0; i < sampleCount; i++) {
             float phase = i / (float)sampleCount; // Normalized phase [0, 1)
@@ -216,7 +218,7 @@ protected:
         }
     }
 
-    void loadFmSquareType()
+    void loadFmSquareType(float* lut, float shape, float macro)
     {
         // FM parameters
         float carrierFreq = 1.0f; // Base frequency for the carrier
@@ -245,7 +247,7 @@ protected:
         }
     }
 
-    void loadFmType()
+    void loadFmType(float* lut, float shape, float macro)
     {
         // FM parameters
         float carrierFreq = 1.0f; // Base frequency for the carrier
@@ -295,15 +297,20 @@ protected:
     }
 
 public:
-    float shape = 0.5f;
-    float macro = 0.5f;
+    std::atomic<float> shape = 0.5f;
+    std::atomic<float> macro = 0.5f;
 
     WavetableGenerator(LookupTable* sharedLut, uint64_t sampleRate)
-        : WavetableInterface(LOOKUP_TABLE_SIZE)
-        , sharedLut(sharedLut)
+        : sharedLut(sharedLut)
         , sampleRate(sampleRate)
     {
-        setType(Type::Sine);
+        selectType(Type::Sine, true);
+        init();
+    }
+
+    ~WavetableGenerator()
+    {
+        cancelUpdate();
     }
 
     float sample(float* index, float freq) override
@@ -324,12 +331,26 @@ public:
         return &lut[(uint16_t)(*index * sampleCount)];
     }
 
-    float* samples() override
+    void setType(Type wavetableGeneratorType, bool reset = true)
     {
-        return lut;
+        selectType(wavetableGeneratorType, reset);
+        requestUpdate();
     }
 
-    void setType(Type wavetableGeneratorType, bool reset = true)
+    void setShape(float value)
+    {
+        shape = CLAMP(value, 0.0f, 1.0f);
+        requestUpdate();
+    }
+
+    void setMacro(float value)
+    {
+        macro = CLAMP(value, 0.0f, 1.0f);
+        requestUpdate();
+    }
+
+protected:
+    void selectType(Type wavetableGeneratorType, bool reset)
     {
         selectedType = wavetableGeneratorType;
         switch (wavetableGeneratorType) {
@@ -338,7 +359,6 @@ public:
                 shape = 0.0f;
                 macro = 0.0f;
             }
-            loadSineType();
             break;
         }
         case Type::Sawtooth: {
@@ -346,7 +366,6 @@ public:
                 shape = 0.0f; // sawtooth
                 macro = 0.0f;
             }
-            loadSawtoothType();
             break;
         }
         case Type::Triangle: {
@@ -354,7 +373,6 @@ public:
                 shape = 0.5f; // triangle
                 macro = 1.0f; // no pulse
             }
-            loadTriangleType();
             break;
         }
         case Type::Square: {
@@ -362,7 +380,6 @@ public:
                 shape = 0.0f; // square
                 macro = 0.0f;
             }
-            loadSquareType();
             break;
         }
         case Type::Pulse: {
@@ -370,7 +387,6 @@ public:
                 shape = 0.0f; // square
                 macro = 0.5f; // centered
             }
-            loadPulseType();
             break;
         }
         case Type::Fm: {
@@ -378,7 +394,6 @@ public:
                 shape = 0.25f;
                 macro = 1.0f;
             }
-            loadFmType();
             break;
         }
         case Type::FmSquare: {
@@ -387,21 +402,41 @@ public:
                 macro = 1.00f;
                 // printf("FmSquare reset to shape: %f, macro: %f\n", shape, macro);
             }
-            loadFmSquareType();
             break;
         }
         }
     }
 
-    void setShape(float value)
-    {
-        shape = CLAMP(value, 0.0f, 1.0f);
-        setType(selectedType, false);
-    }
-
-    void setMacro(float value)
+    TableCache::Fill recipe(uint64_t& key) override
     {
-        macro = CLAMP(value, 0.0f, 1.0f);
-        setType(selectedType, false);
+        Type type = selectedType;
+        float shapeValue = shape;
+        float macroValue = macro;
+        key = TableCache::key("Wavetable", { (float)type, shapeValue, macroValue });
+        return [this, type, shapeValue, macroValue](float* lut) {
+            switch (type) {
+            case Type::Sine:
+                loadSineType(lut, shapeValue, macroValue);
+                break;
+            case Type::Sawtooth:
+                loadSawtoothType(lut, shapeValue, macroValue);
+                break;
+            case Type::Triangle:
+                loadTriangleType(lut, shapeValue, macroValue);
+                break;
+            case Type::Square:
+                loadSquareType(lut, shapeValue, macroValue);
+                break;
+            case Type::Pulse:
+                loadPulseType(lut, shapeValue, macroValue);
+                break;
+            case Type::Fm:
+                loadFmType(lut, shapeValue, macroValue);
+                break;
+            case Type::FmSquare:
+                loadFmSquareType(lut, shapeValue, macroValue);
+                break;
+            }
+        };
     }
 };
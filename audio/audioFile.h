@@ -17,9 +17,11 @@ sha: e42331bd66c3faad0ad0800bbde68f53c02f14ef3209de83241a8daaa0d35ff3
 */
 #pragma once
 
+#include <algorithm>
 #include <iostream>
 #include <sndfile.h>
 #include <string>
+#include <vector>
 
 #include "log.h"
 
@@ -50,14 +52,15 @@ bool copyPartialAudioFile(const std::string& src, const std::string& dest, sf_co
         sf_close(infile);
         return false;
     }
+    // Frames, so files with several channels are copied entirely
     const size_t bufferSize = 1024;
-    float buffer[bufferSize];
+    std::vector<float> buffer(bufferSize * std::max(sfinfo.channels, 1));
     while (frames > 0) {
-        sf_count_t count = sf_read_float(infile, buffer, bufferSize);
+        sf_count_t count = sf_readf_float(infile, buffer.data(), std::min<sf_count_t>(bufferSize, frames));
         if (count <= 0) {
             break;
         }
-        sf_write_float(outfile, buffer, count);
+        sf_writef_float(outfile, buffer.data(), count);
         frames -= count;
     }
 
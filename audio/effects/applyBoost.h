@@ -1,5 +1,7 @@
 #pragma once
 
+#include <cstdint>
+
 float applyBoost(float input, float bassBoostAmount, float& prevInput, float& prevOutput)
 {
     if (bassBoostAmount == 0.0f) {
@@ -13,3 +15,24 @@ float applyBoost(float input, float bassBoostAmount, float& prevInput, float& pr
 
     return bassBoosted;
 }
+
+// Apply bass boost on `frames` samples of `buf`, `stride` being the distance between two frames. Each output
+// depends on the previous one, so unlike the other shapers this one stays scalar, only the coefficients are hoisted.
+void applyBoostBlock(float* buf, uint32_t stride, uint32_t frames, float bassBoostAmount, float& prevInput, float& prevOutput)
+{
+    if (bassBoostAmount == 0.0f) {
+        return;
+    }
+    float bassFreq = 0.2f + 0.8f * bassBoostAmount;
+    float gain = 1.0f + bassBoostAmount * 2.0f;
+    float in = prevInput;
+    float out = prevOutput;
+    for (uint32_t f = 0; f < frames; f++) {
+        float& sample = buf[f * stride];
+        out = (1.0f - bassFreq) * out + bassFreq * (sample + in) * 0.5f;
+        in = sample;
+        sample = out * gain;
+    }
+    prevInput = in;
+    prevOutput = out;
+}
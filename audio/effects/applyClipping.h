@@ -18,6 +18,7 @@ sha: 9e6e4daa0452774df195eb622b80153f56fbfa3b65764163dc2db5b82e49b5b2
 #pragma once
 
 #include "helpers/clamp.h"
+#include "audio/utils/float4.h"
 
 float applyClipping(float input, float scaledClipping)
 {
@@ -26,3 +27,16 @@ float applyClipping(float input, float scaledClipping)
     }
     return CLAMP(input + input * scaledClipping, -1.0f, 1.0f);
 }
+
+// Apply clipping on `frames` samples of `buf`, `stride` being the distance between two frames
+void applyClippingBlock(float* buf, uint32_t stride, uint32_t frames, float scaledClipping)
+{
+    if (scaledClipping == 0.0f) {
+        return;
+    }
+    float4::v4 scaled = float4::set(scaledClipping);
+    float4::map(
+        buf, stride, frames,
+        [&](float4::v4 x) { return float4::clamp(float4::add(x, float4::mul(x, scaled)), -1.0f, 1.0f); },
+        [&](float x) { return applyClipping(x, scaledClipping); });
+}
@@ -25,3 +25,17 @@ float applyDrive(float input, float driveAmount, LookupTable* lookupTable)
     }
     return tanhLookup(input * (1.0f + driveAmount * 5.0f), lookupTable);
 }
+
+// Apply drive on `frames` samples of `buf`, `stride` being the distance between two frames
+void applyDriveBlock(float* buf, uint32_t stride, uint32_t frames, float driveAmount, LookupTable* lookupTable)
+{
+    if (driveAmount == 0.0f) {
+        return;
+    }
+    float gain = 1.0f + driveAmount * 5.0f;
+    float4::v4 gain4 = float4::set(gain);
+    float4::map(
+        buf, stride, frames,
+        [&](float4::v4 x) { return tanhLookup4(float4::mul(x, gain4), lookupTable); },
+        [&](float x) { return tanhLookup(x * gain, lookupTable); });
+}
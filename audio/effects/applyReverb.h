@@ -23,11 +23,14 @@ sha: 4ee19efbf871b8ad50cc31e9503ac92d09fd8f53a6687e7f411d4c5ffa28176f
 #include <cmath>
 #include <cstdint>
 
+#include "plugins/audio/utils/PluginArena.h"
+
 constexpr int REVERB_BUFFER_SIZE = 48000; // 1 second buffer at 48kHz
 constexpr int DELAY_BUFFER_SIZE = REVERB_BUFFER_SIZE * 3; // 3 second
 
-#define REVERB_BUFFER float buffer[REVERB_BUFFER_SIZE] = { 0.0f };
-#define DELAY_BUFFER float buffer[DELAY_BUFFER_SIZE] = { 0.0f };
+// Buffers allocated in the plugin arena, to be used in a plugin (or engine) class
+#define REVERB_BUFFER ArenaArray<float> buffer = ArenaArray<float>(props.arena, REVERB_BUFFER_SIZE);
+#define DELAY_BUFFER ArenaArray<float> buffer = ArenaArray<float>(props.arena, DELAY_BUFFER_SIZE);
 
 float applyReverb(float signal, float reverbAmount, float* reverbBuffer, int& reverbIndex)
 {
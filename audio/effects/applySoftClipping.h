@@ -21,3 +21,12 @@ float applySoftClipping(float input, LookupTable* lookupTable)
 {
     return tanhLookup(input, lookupTable);
 }
+
+// Apply soft clipping on `frames` samples of `buf`, `stride` being the distance between two frames
+void applySoftClippingBlock(float* buf, uint32_t stride, uint32_t frames, LookupTable* lookupTable)
+{
+    float4::map(
+        buf, stride, frames,
+        [&](float4::v4 x) { return tanhLookup4(x, lookupTable); },
+        [&](float x) { return tanhLookup(x, lookupTable); });
+}
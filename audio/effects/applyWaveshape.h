@@ -22,6 +22,7 @@ sha: 9a39e2a1ec29867cbae4b7324499f29a0d37ce7095485738a421ac485604aa71
 #include <math.h>
 
 #include "audio/lookupTable.h"
+#include "audio/utils/float4.h"
 #include "audio/utils/linearInterpolation.h"
 
 // apply waveshape using lookup table
@@ -50,3 +51,34 @@ float applyWaveshape(float input, float waveshapeAmount, LookupTable* lookupTabl
     }
     return input;
 }
+
+// Block versions, applied on `frames` samples of `buf`, `stride` being the distance between two frames
+void applyWaveshapeLutBlock(float* buf, uint32_t stride, uint32_t frames, float waveshapeAmount, LookupTable* lookupTable)
+{
+    float4::v4 amount = float4::set(waveshapeAmount * 2);
+    float4::map(
+        buf, stride, frames,
+        [&](float4::v4 x) {
+            float4::v4 i = float4::mul(float4::sub(x, float4::floor(x)), float4::set(lookupTable->size - 1));
+            return float4::add(x, float4::mul(amount, float4::lerp(lookupTable->sine, i, lookupTable->size - 1)));
+        },
+        [&](float x) { return applyWaveshapeLut(x, waveshapeAmount, lookupTable); });
+}
+
+void applyWaveshapeBlock(float* buf, uint32_t stride, uint32_t frames, float waveshapeAmount)
+{
+    float4::v4 amount = float4::set(waveshapeAmount * 2);
+    float4::map(
+        buf, stride, frames,
+        [&](float4::v4 x) { return float4::add(x, float4::mul(amount, float4::sin(x))); },
+        [&](float x) { return applyWaveshape(x, waveshapeAmount); });
+}
+
+void applyWaveshapeBlock(float* buf, uint32_t stride, uint32_t frames, float waveshapeAmount, LookupTable* lookupTable)
+{
+    if (waveshapeAmount > 0.0f) {
+        applyWaveshapeBlock(buf, stride, frames, waveshapeAmount);
+    } else if (waveshapeAmount < 0.0f) {
+        applyWaveshapeLutBlock(buf, stride, frames, -waveshapeAmount, lookupTable);
+    }
+}
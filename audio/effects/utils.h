@@ -17,10 +17,16 @@ sha: e3ae553db27eeea3b5407b40920f8a783f157cb70c644b6a711d7506a42374d7
 
 #include "helpers/clamp.h"
 #include "audio/lookupTable.h"
+#include "audio/utils/float4.h"
 
 float tanhLookup(float x, LookupTable* lookupTable)
 {
-    x = CLAMP(x, -1.0f, 1.0f);
-    int index = static_cast<int>((x + 1.0f) * 0.5f * (lookupTable->size - 1));
-    return lookupTable->tanh[index];
-}
\ No newline at end of file
+    return lookupTable->getTanh(x);
+}
+
+// Same as tanhLookup for 4 samples
+float4::v4 tanhLookup4(float4::v4 x, LookupTable* lookupTable)
+{
+    float4::v4 i = float4::mul(float4::add(x, float4::set(1.0f)), float4::set(0.5f * (lookupTable->size - 1)));
+    return float4::lerp(lookupTable->tanh, float4::clamp(i, 0.0f, lookupTable->size - 1), lookupTable->size - 1);
+}
@@ -29,6 +29,7 @@ sha: 65a0349e31bcbaf6bee83d439fa4624c88dc66b25b2615028445c3ae812cdf3a
 #pragma once
 
 #include "audio/EnvelopDrumAmp.h"
+#include "audio/MetalOscillatorBank.h"
 #include "audio/effects/tinyReverb.h"
 #include "audio/engines/Engine.h"
 #include "audio/lookupTable.h"
@@ -41,6 +42,7 @@ protected:
     int sampleRate;
     LookupTable& lookupTable;
     float* tinyReverbBuffer;
+    MetalOscillatorBank metalBank;
 
     float resonatorState = 0.0f;
     float applyResonator(float input)
@@ -83,6 +85,8 @@ public:
     float fmFreq = 1.0f; // 1 to 500
     float envMod = 0.0f; // 0.00 to 1.00
     float reverb = 0.5f; // 0.0 to 1.0
+    float metal = 0.0f; // 0.00 to 1.00
+    float metalTone = 0.5f; // 0.00 to 1.00
 
     void hydrate(const std::vector<KeyValue>& values) override
     {
@@ -95,6 +99,8 @@ public:
             else if (kv.key == "fmFreq") fmFreq = std::get<float>(kv.value);
             else if (kv.key == "envMod") envMod = std::get<float>(kv.value);
             else if (kv.key == "reverb") reverb = std::get<float>(kv.value);
+            else if (kv.key == "metal") setMetal(std::get<float>(kv.value));
+            else if (kv.key == "metalTone") setMetalTone(std::get<float>(kv.value));
         }
     }
     std::vector<KeyValue> serialize() const override
@@ -108,6 +114,8 @@ public:
             { "fmFreq", fmFreq },
             { "envMod", envMod },
             { "reverb", reverb },
+            { "metal", metal },
+            { "metalTone", metalTone },
         };
     }
 
@@ -116,6 +124,7 @@ public:
         , sampleRate(sampleRate)
         , lookupTable(lookupTable)
         , tinyReverbBuffer(tinyReverbBuffer)
+        , metalBank(sampleRate)
     {
         phaseIncrement = 1.0f / sampleRate;
     }
@@ -132,6 +141,14 @@ public:
     void setFmFreq(float value) { fmFreq = CLAMP(value, 1.0f, 500.0f); }
     void setEnvMod(float value) { envMod = CLAMP(value, 0.0f, 1.0f); }
     void setReverb(float value) { reverb = CLAMP(value, 0.0f, 1.0f); }
+    // Mix of the inharmonic squares with the tone, see MetalOscillatorBank
+    void setMetal(float value) { metal = CLAMP(value, 0.0f, 1.0f); }
+    void setMetalTone(float value)
+    {
+        metalTone = CLAMP(value, 0.0f, 1.0f);
+        metalBank.setBands(metalTone, 0.3f);
+        metalBank.setTone(metalTone);
+    }
 
     const uint8_t baseNote = 60;
     void noteOn(uint8_t note) override
@@ -146,6 +163,8 @@ public:
         phase = 0.0f;
         resonatorState = 0.0f;
         envValue = 1.0f;
+        metalBank.setFrequency(noteFreq * 0.4666f);
+        metalBank.reset();
     }
 
 protected:
@@ -199,6 +218,10 @@ public:
 #endif
             }
 
+            if (metal > 0.0f) {
+                tone += metal * (metalBank.next() - tone);
+            }
+
             tone *= envAmp;
             tone = tinyReverb(tone, reverb, reverbPos, tinyReverbBuffer);
             return tone;
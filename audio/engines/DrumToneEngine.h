@@ -140,6 +140,9 @@ public:
 
     void noteOn(uint8_t note) override
     {
+        // Engines have no block, the tables rebuilt in the background are swapped in with each note
+        envelopFreq.update();
+        transient.update();
         freq = pow(2, ((note - baseNote + pitch) / 12.0));
         envelopAmp.reset(totalSamples);
         sampleCounter = 0;
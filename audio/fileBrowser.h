@@ -7,7 +7,8 @@ This code defines a specialized utility class named `FileBrowser`. Its primary f
 2.  **Directory Reading:** By default, when it scans the folder, it intelligently skips over any sub-folders and hidden files, creating a clean, internal list of only the usable files. It also tracks the total number of files found.
 3.  **Safe Access:** The class ensures safe access to the file list. If you request the file at position 10, but the folder only contains 5 files, the system automatically adjusts the request to prevent errors.
 4.  **Retrieval Functions:** You can easily retrieve files based on their numbered position in the list. Available options include getting the full file path, just the filename, or the filename stripped of its extension (like removing `.png` or `.txt`).
-5.  **Navigation:** The browser includes search capabilities to locate a file by its name and return its exact list position. It can also calculate the position of the file immediately before or after a currently selected file, making it useful for simple sequence navigation in applications like media players or asset loaders.
+5.  **Indexed Listing:** Instead of scanning, the list can be given by the sample index (`setFiles`), so browsing a large sample library doesn't read the folder.
+6.  **Navigation:** The browser includes search capabilities to locate a file by its name and return its exact list position. It can also calculate the position of the file immediately before or after a currently selected file, making it useful for simple sequence navigation in applications like media players or asset loaders.
 
 In essence, the `FileBrowser` acts as a robust and efficient index card system for a directory, allowing programs to interact with file lists predictably and safely.
 
@@ -49,6 +50,14 @@ public:
         count = files.size();
     }
 
+    // Files of `folder` listed by the caller, e.g. from the `SampleIndex`, so the folder is not read
+    void setFiles(std::string _folder, std::vector<std::filesystem::path> _files)
+    {
+        folder = _folder;
+        files = _files;
+        count = files.size();
+    }
+
     std::string getFilePath(uint16_t pos)
     {
         return get(pos);
@@ -68,9 +68,9 @@ public:
     typedef float (EffectFilterData::*ProcessFnPtr)(float);
     ProcessFnPtr processFn;
 
-    float getLp(float _cutoff) { return 0.90 - (0.90 * _cutoff) + 0.1; }
-    float getHp(float _cutoff) { return (0.80 * _cutoff) + 0.00707; }
-    float getBp(float _cutoff) { return 0.95 * _cutoff + 0.1; }
+    static float getLp(float _cutoff) { return 0.90 - (0.90 * _cutoff) + 0.1; }
+    static float getHp(float _cutoff) { return (0.80 * _cutoff) + 0.00707; }
+    static float getBp(float _cutoff) { return 0.95 * _cutoff + 0.1; }
     void setLp(float _cutoff, float _resonance) { setRawCutoff(getLp(_cutoff), _resonance); }
     void setHp(float _cutoff, float _resonance) { setRawCutoff(getHp(_cutoff), _resonance); }
     void setBp(float _cutoff, float _resonance) { setRawCutoff(getBp(_cutoff), _resonance); }
@@ -147,7 +147,7 @@ public:
         return getFeedback(cutoff, resonance);
     }
 
-    float getFeedback(float _cutoff, float _resonance)
+    static float getFeedback(float _cutoff, float _resonance)
     {
         if (_resonance == 0.0f) {
             return 0.0;
@@ -174,11 +174,18 @@ public:
     }
 
     void setSampleData(float inputValue, float& _buf, float& _hp, float& _bp, float& _lp)
+    {
+        svf(inputValue, cutoff, feedback, _buf, _hp, _bp, _lp);
+    }
+
+    // One sample of the state variable filter, shared with the filters keeping their own state,
+    // see also EffectFilterBank for many filters at once.
+    static inline void svf(float inputValue, float _cutoff, float _feedback, float& _buf, float& _hp, float& _bp, float& _lp)
     {
         _hp = inputValue - _buf;
         _bp = _buf - _lp;
-        _buf = _buf + cutoff * (_hp + feedback * _bp);
-        _lp = _lp + cutoff * (_buf - _lp);
+        _buf = _buf + _cutoff * (_hp + _feedback * _bp);
+        _lp = _lp + _cutoff * (_buf - _lp);
     }
 
     float processLp(float inputValue)
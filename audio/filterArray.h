@@ -33,6 +33,8 @@ sha: 102bab4291f14c37ff597e91aa763d63ac4e0434632ac1dfffa2c2353c645dc0
 
 #include <math.h> // fabs
 
+#include "filter.h"
+
 template <int SIZE>
 class EffectFilterArray {
 public:
@@ -68,9 +70,6 @@ public:
 
     void setSampleData(float inputValue, int index)
     {
-        hp[index] = inputValue - buf[index];
-        bp[index] = buf[index] - lp[index];
-        buf[index] = buf[index] + cutoff * (hp[index] + feedback * bp[index]);
-        lp[index] = lp[index] + cutoff * (buf[index] - lp[index]);
+        EffectFilterData::svf(inputValue, cutoff, feedback, buf[index], hp[index], bp[index], lp[index]);
     }
 };
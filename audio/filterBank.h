@@ -0,0 +1,110 @@
+#pragma once
+
+#include <cstdint>
+
+#include "audio/filter.h"
+#include "audio/utils/float4.h"
+
+// `LANES` independent state variable filters processed in lockstep, e.g. one per voice or per track, each with its
+// own cutoff, resonance and type. The state is stored per lane (structure of arrays), so 4 filters run in the SIMD
+// registers at once; with 8 lanes, the 2 groups of 4 are processed one after the other.
+// Same filter as EffectFilterData, the cutoff and resonance being mapped the same way.
+template <int LANES>
+class EffectFilterBank {
+    static_assert(LANES % 4 == 0, "EffectFilterBank lanes must be a multiple of 4");
+
+protected:
+    alignas(16) float cutoff[LANES] = {};
+    alignas(16) float feedback[LANES] = {};
+    alignas(16) float buf[LANES] = {};
+    alignas(16) float lp[LANES] = {};
+    alignas(16) float hp[LANES] = {};
+    alignas(16) float bp[LANES] = {};
+    // Output of each lane, as a mix of its low, high and band pass, so the lanes can have different types
+    alignas(16) float lpMix[LANES] = {};
+    alignas(16) float hpMix[LANES] = {};
+    alignas(16) float bpMix[LANES] = {};
+    EffectFilterData::Type types[LANES] = {};
+
+public:
+    EffectFilterBank()
+    {
+        for (int l = 0; l < LANES; l++) {
+            setType(l, EffectFilterData::LP);
+        }
+    }
+
+    void setType(int lane, EffectFilterData::Type type)
+    {
+        types[lane] = type;
+        lpMix[lane] = type == EffectFilterData::LP ? 1.0f : 0.0f;
+        hpMix[lane] = type == EffectFilterData::HP ? 1.0f : 0.0f;
+        bpMix[lane] = type == EffectFilterData::BP ? 1.0f : 0.0f;
+    }
+
+    // Same as EffectFilterData::set(), `_cutoff` being mapped according to the type of the lane
+    void set(int lane, float _cutoff, float _resonance)
+    {
+        EffectFilterData::Type type = types[lane];
+        float raw = type == EffectFilterData::LP ? EffectFilterData::getLp(_cutoff)
+            : type == EffectFilterData::HP       ? EffectFilterData::getHp(_cutoff)
+                                                 : EffectFilterData::getBp(_cutoff);
+        setRawCutoff(lane, raw, _resonance);
+    }
+
+    void setRawCutoff(int lane, float _cutoff, float _resonance)
+    {
+        cutoff[lane] = _cutoff;
+        feedback[lane] = EffectFilterData::getFeedback(_cutoff, _resonance);
+    }
+
+    void reset(int lane)
+    {
+        buf[lane] = lp[lane] = hp[lane] = bp[lane] = 0.0f;
+    }
+
+    // Filter in place `frames` samples of each lane, `lanes[l][f * stride]` being the sample `f` of the lane `l`.
+    // Lanes set to NULL are not processed, their filter getting silence.
+    void process(float* const* lanes, uint32_t stride, uint32_t frames)
+    {
+        using namespace float4;
+        for (int g = 0; g < LANES; g += WIDTH) {
+            v4 c = load(cutoff + g);
+            v4 fb = load(feedback + g);
+            v4 b = load(buf + g);
+            v4 l = load(lp + g);
+            v4 h = load(hp + g);
+            v4 p = load(bp + g);
+            v4 wl = load(lpMix + g);
+            v4 wh = load(hpMix + g);
+            v4 wb = load(bpMix + g);
+            float* const* in = lanes + g;
+            alignas(16) float x[WIDTH];
+            for (uint32_t f = 0; f < frames; f++) {
+                uint32_t offset = f * stride;
+                for (int j = 0; j < WIDTH; j++) {
+                    x[j] = in[j] ? in[j][offset] : 0.0f;
+                }
+                v4 input = load(x);
+                h = sub(input, b);
+                p = sub(b, l);
+                b = add(b, mul(c, add(h, mul(fb, p))));
+                l = add(l, mul(c, sub(b, l)));
+                store(x, add(add(mul(l, wl), mul(h, wh)), mul(p, wb)));
+                for (int j = 0; j < WIDTH; j++) {
+                    if (in[j]) {
+                        in[j][offset] = x[j];
+                    }
+                }
+            }
+            store(buf + g, b);
+            store(lp + g, l);
+            store(hp + g, h);
+            store(bp + g, p);
+        }
+    }
+
+    float getLp(int lane) { return lp[lane]; }
+    float getHp(int lane) { return hp[lane]; }
+    float getBp(int lane) { return bp[lane]; }
+};
@@ -24,34 +24,127 @@ sha: e7941b1253259e2739a4e89b0528d45cadffabc6582b3e5f90f9476df6dfce54
 */
 #pragma once
 
+#include <cmath>
+#include <cstdlib>
 #include <math.h>
+#include <stdint.h>
 
 // #define LOOKUP_TABLE_SIZE 4096
 #define LOOKUP_TABLE_SIZE 8192
 // #define LOOKUP_TABLE_SIZE 16384
 
-class LookupTable {
+// Xorshift noise in [-1.0, 1.0], owned by a plugin or a voice, so streams are never shared between threads.
+class NoiseStream {
 protected:
-    int noiseIndex = 0;
+    uint32_t state;
 
 public:
-    const static int size = LOOKUP_TABLE_SIZE;
-    float sine[size];
-    float tanh[size];
-    float noise[size];
+    NoiseStream(uint32_t seed = 2463534242u)
+        : state(seed ? seed : 2463534242u)
+    {
+    }
+
+    inline float next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        // Top 24 bits as a float in [0, 2), shifted to [-1, 1)
+        return (float)(state >> 8) * (2.0f / 16777216.0f) - 1.0f;
+    }
 
-    LookupTable()
+    void fill(float* out, uint32_t n)
     {
-        for (int i = 0; i < size; i++) {
-            float normalizedX = (float)i / (float)(size - 1) * 2.0f - 1.0f; // Map index to [-1.0, 1.0]
-            sine[i] = sinf(normalizedX * M_PI);
-            tanh[i] = std::tanh(normalizedX); // Precompute tanh
-            noise[i] = 2.0f * ((float)rand() / (float)RAND_MAX) - 1.0f; // Random noise [-1.0, 1.0]
+        for (uint32_t i = 0; i < n; i++) {
+            out[i] = next();
         }
     }
+};
+
+// Table values computed at compile time, so the tables are in the read-only data of the binaries instead of
+// being computed at startup, and the noise is the same on every run.
+namespace LookupTableGenerator {
+    constexpr double PI = 3.14159265358979323846;
+
+    // sin(x) for x in [-PI, PI], Taylor series up to x^25 (error < 1e-9)
+    constexpr double sin(double x)
+    {
+        double term = x;
+        double sum = x;
+        for (int n = 1; n <= 12; n++) {
+            term *= -x * x / ((2 * n) * (2 * n + 1));
+            sum += term;
+        }
+        return sum;
+    }
+
+    // exp(x) for x in [-2, 2], Taylor series up to x^30
+    constexpr double exp(double x)
+    {
+        double term = 1.0;
+        double sum = 1.0;
+        for (int n = 1; n <= 30; n++) {
+            term *= x / n;
+            sum += term;
+        }
+        return sum;
+    }
+
+    constexpr double tanh(double x)
+    {
+        double e = exp(2.0 * x);
+        return (e - 1.0) / (e + 1.0);
+    }
+
+    struct Tables {
+        float sine[LOOKUP_TABLE_SIZE];
+        float tanh[LOOKUP_TABLE_SIZE];
+        float noise[LOOKUP_TABLE_SIZE];
+    };
+
+    constexpr Tables generate()
+    {
+        Tables tables = {};
+        uint32_t state = 2463534242u;
+        for (int i = 0; i < LOOKUP_TABLE_SIZE; i++) {
+            double normalizedX = (double)i / (double)(LOOKUP_TABLE_SIZE - 1) * 2.0 - 1.0; // Map index to [-1.0, 1.0]
+            tables.sine[i] = sin(normalizedX * PI);
+            tables.tanh[i] = tanh(normalizedX);
+            // Xorshift noise [-1.0, 1.0]
+            state ^= state << 13;
+            state ^= state >> 17;
+            state ^= state << 5;
+            tables.noise[i] = (float)(state >> 8) * (2.0f / 16777216.0f) - 1.0f;
+        }
+        return tables;
+    }
+
+    // Inline variable: each plugin library has a definition, the dynamic linker binds them all to a single one
+    inline constexpr Tables tables = generate();
+}
+
+class LookupTable {
+protected:
+    // Period of the sine in table entries, the last entry being the first one
+    static constexpr float sinePeriod = LOOKUP_TABLE_SIZE - 1;
+
+    static inline float lerp(const float* table, float x)
+    {
+        int i = (int)x;
+        float frac = x - i;
+        return table[i] + (table[i + 1] - table[i]) * frac;
+    }
+
+public:
+    const static int size = LOOKUP_TABLE_SIZE;
+    static constexpr const float* sine = LookupTableGenerator::tables.sine;
+    static constexpr const float* tanh = LookupTableGenerator::tables.tanh;
+    static constexpr const float* noise = LookupTableGenerator::tables.noise;
 
+    // Each thread walks the noise table with its own index, the table being shared by all the tracks
     float getNoise()
     {
+        static thread_local int noiseIndex = 0;
         if (noiseIndex >= size) {
             noiseIndex = 0;
         }
@@ -73,4 +166,53 @@ public:
         int idx = (int)(phase * (size - 1));
         return sine[idx];
     }
+
+    // Linearly interpolated version of `getSin2()`, for any phase
+    inline float getSinLerp(float phase)
+    {
+        float x = (phase - floorf(phase)) * sinePeriod;
+        return lerp(sine, x < sinePeriod ? x : 0.0f);
+    }
+
+    // `getSinLerp()` of `n` phases
+    void getSinBlock(const float* phases, float* out, uint32_t n)
+    {
+        for (uint32_t i = 0; i < n; i++) {
+            out[i] = getSinLerp(phases[i]);
+        }
+    }
+
+    // `n` interpolated values of an oscillator starting at `phase`, incremented by `inc` per value, `phase` being
+    // updated for the next block (wrapped in [0, 1)).
+    void getSinBlock(float& phase, float inc, float* out, uint32_t n)
+    {
+        float p = phase - floorf(phase);
+        inc -= floorf(inc);
+        for (uint32_t i = 0; i < n; i++) {
+            float x = p * sinePeriod;
+            out[i] = lerp(sine, x < sinePeriod ? x : 0.0f);
+            p += inc;
+            if (p >= 1.0f) {
+                p -= 1.0f;
+            }
+        }
+        phase = p;
+    }
+
+    // Interpolated tanh of `x`, clamped to [-1.0, 1.0] like the table
+    inline float getTanh(float x)
+    {
+        float i = (x + 1.0f) * 0.5f * (size - 1);
+        if (i <= 0.0f) {
+            return tanh[0];
+        }
+        return i < size - 1 ? lerp(tanh, i) : tanh[size - 1];
+    }
+
+    void getTanhBlock(const float* in, float* out, uint32_t n)
+    {
+        for (uint32_t i = 0; i < n; i++) {
+            out[i] = getTanh(in[i]);
+        }
+    }
 };
@@ -0,0 +1,69 @@
+#pragma once
+
+#include <string>
+
+#if defined(__x86_64__) || defined(__i386__)
+#define CPU_FEATURES_X86
+#elif defined(__aarch64__) && defined(__linux__)
+#include <sys/auxv.h>
+#define CPU_FEATURES_ARM64
+#ifndef HWCAP_ASIMD
+#define HWCAP_ASIMD (1 << 1)
+#endif
+#ifndef HWCAP_ASIMDHP
+#define HWCAP_ASIMDHP (1 << 10)
+#endif
+#ifndef HWCAP_ASIMDDP
+#define HWCAP_ASIMDDP (1 << 20)
+#endif
+#endif
+
+// Instruction sets of the CPU running the binary, detected once at startup: with CPUID on x86, with
+// `getauxval(AT_HWCAP)` on arm64. The binaries are built for the lowest common denominator (SSE2 on x86_64, NEON on
+// armv8, see float4.h), the kernels having a better variant compile it with a target attribute and pick it at run
+// time from these features, see SimdDispatch.h.
+struct CpuFeatures {
+    bool sse2 = false;
+    bool avx2 = false;
+    bool fma = false;
+    bool neon = false;
+    // Armv8.2, e.g. the Cortex-A76 of the Pi 5, not the A53 of the Pi Zero 2W nor the A72 of the Pi 4
+    bool fp16 = false;
+    bool dotprod = false;
+
+    static const CpuFeatures& get()
+    {
+        static CpuFeatures features = detect();
+        return features;
+    }
+
+    static CpuFeatures detect()
+    {
+        CpuFeatures features;
+#if defined(CPU_FEATURES_X86)
+        __builtin_cpu_init();
+        features.sse2 = __builtin_cpu_supports("sse2");
+        features.avx2 = __builtin_cpu_supports("avx2");
+        features.fma = __builtin_cpu_supports("fma");
+#elif defined(CPU_FEATURES_ARM64)
+        unsigned long hwcap = getauxval(AT_HWCAP);
+        features.neon = hwcap & HWCAP_ASIMD;
+        features.fp16 = hwcap & HWCAP_ASIMDHP;
+        features.dotprod = hwcap & HWCAP_ASIMDDP;
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+        features.neon = true;
+#endif
+        return features;
+    }
+
+    std::string describe() const
+    {
+        std::string names;
+        for (auto [has, name] : { std::pair { sse2, "sse2" }, { avx2, "avx2" }, { fma, "fma" }, { neon, "neon" }, { fp16, "fp16" }, { dotprod, "dotprod" } }) {
+            if (has) {
+                names += (names.empty() ? "" : " ") + std::string(name);
+            }
+        }
+        return names.empty() ? "scalar" : names;
+    }
+};
@@ -0,0 +1,121 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+#include "audio/utils/float4.h"
+#include "helpers/clamp.h"
+
+// Conversion of the float samples to interleaved int16, for the sound cards only accepting S16.
+//
+// Clamping, scaling, dither and packing are done in one pass, 4 frames at a time, straight into the device buffer:
+// - NONE rounds to the nearest value, the error following the signal (distortion on quiet tails)
+// - TPDF adds a triangular dither of +/-1 LSB, the sum of 2 uniform values taken from one xorshift, turning the
+//   error into a constant white noise floor
+// - SHAPED feeds the error of TPDF back (first order), pushing the noise floor up in frequency where it is less
+//   audible. The error of a frame depends on the previous one, so it is not vectorized.
+class Int16Converter {
+public:
+    enum Dither {
+        NONE,
+        TPDF,
+        SHAPED,
+    };
+
+    static Dither getDither(std::string name)
+    {
+        if (name == "none") {
+            return NONE;
+        }
+        if (name == "shaped") {
+            return SHAPED;
+        }
+        return TPDF;
+    }
+
+protected:
+    static constexpr float SCALE = 32767.0f;
+
+    Dither dither = TPDF;
+    uint32_t seed = 0x9e3779b9;
+    float error[2] = { 0.0f, 0.0f };
+
+    inline float tpdf()
+    {
+        seed ^= seed << 13;
+        seed ^= seed >> 17;
+        seed ^= seed << 5;
+        return ((seed & 0xffff) + (seed >> 16)) * (1.0f / 65536.0f) - 1.0f;
+    }
+
+    inline float4::v4 tpdf4()
+    {
+#if defined(FLOAT4)
+        float noise[4] = { tpdf(), tpdf(), tpdf(), tpdf() };
+        return float4::load(noise);
+#else
+        return tpdf();
+#endif
+    }
+
+    inline int16_t convert(float x, uint8_t channel)
+    {
+        float wanted = CLAMP(x, -1.0f, 1.0f) * SCALE;
+        if (dither == NONE) {
+            return (int16_t)lrintf(wanted);
+        }
+        if (dither == SHAPED) {
+            wanted -= error[channel];
+        }
+        float q = CLAMP(rintf(wanted + tpdf()), -32768.0f, 32767.0f);
+        if (dither == SHAPED) {
+            // Bounded, so a clipped signal doesn't wind the feedback up
+            error[channel] = CLAMP(q - wanted, -2.0f, 2.0f);
+        }
+        return (int16_t)q;
+    }
+
+public:
+    void setDither(Dither value)
+    {
+        dither = value;
+        error[0] = error[1] = 0.0f;
+    }
+
+    // Convert `frames` frames, `stride` apart, to `channels` interleaved int16 in `out`, `right` only being read
+    // for 2 channels.
+    void process(const float* left, const float* right, uint32_t stride, uint32_t frames, int16_t* out, uint8_t channels)
+    {
+        using namespace float4;
+        bool stereo = channels == 2;
+        uint32_t f = 0;
+#if defined(FLOAT4)
+        if (dither != SHAPED) {
+            v4 scale = set(SCALE);
+            for (; f + 4 <= frames; f += 4) {
+                v4 l = mul(clamp(load(left + f * stride, stride), -1.0f, 1.0f), scale);
+                if (dither == TPDF) {
+                    l = add(l, tpdf4());
+                }
+                if (stereo) {
+                    v4 r = mul(clamp(load(right + f * stride, stride), -1.0f, 1.0f), scale);
+                    if (dither == TPDF) {
+                        r = add(r, tpdf4());
+                    }
+                    toInt16(l, r, out + f * 2);
+                } else {
+                    toInt16(l, out + f);
+                }
+            }
+        }
+#endif
+        for (; f < frames; f++) {
+            if (stereo) {
+                out[f * 2] = convert(left[f * stride], 0);
+                out[f * 2 + 1] = convert(right[f * stride], 1);
+            } else {
+                out[f] = convert(left[f * stride], 0);
+            }
+        }
+    }
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "audio/utils/float4.h"
+
+// Run a nonlinear kernel at 2x, 4x or 8x the sample rate, so the harmonics it creates above the Nyquist frequency
+// are filtered out instead of folding back as aliasing. Only the plugins using it pay for the higher rate.
+//
+// Each 2x stage is a linear phase half-band filter: half of its taps are zero and the center tap is 0.5, so the
+// up and down sampling are split in two polyphase branches, one being a plain delay. The stage closest to the
+// engine rate has the steepest filter, the next ones only have to remove the images of the first one.
+class Oversampler {
+protected:
+    class HalfBand {
+    protected:
+        // Non-zero taps of the half-band filter, the even ones, symmetric
+        std::vector<float> coefs;
+        uint32_t taps = 0;
+        std::vector<float> upHistory;
+        std::vector<float> evenHistory;
+        std::vector<float> oddHistory;
+        // Extra input sample of delay, so the latency of the stage is a whole number of frames at the engine rate
+        bool pad = false;
+        float padSample = 0.0f;
+
+    public:
+        // `half` is the number of taps on each side of the center, the filter having 4 * half - 1 taps
+        HalfBand(uint32_t half, uint32_t maxFrames, bool pad)
+            : taps(2 * half)
+            , pad(pad)
+        {
+            uint32_t length = 4 * half - 1;
+            int32_t center = 2 * half - 1;
+            coefs.resize(taps);
+            float sum = 0.0f;
+            for (uint32_t t = 0; t < taps; t++) {
+                int32_t k = 2 * t - center;
+                float x = M_PI * k / 2.0f;
+                // Blackman window over the filter length
+                float w = 0.42f - 0.5f * cosf(2.0f * M_PI * (2 * t + 1) / (length + 1)) + 0.08f * cosf(4.0f * M_PI * (2 * t + 1) / (length + 1));
+                coefs[t] = 0.5f * sinf(x) / x * w;
+                sum += coefs[t];
+            }
+            // Even taps summing to 0.5 like the center tap, so the gain is 1 at DC
+            for (float& c : coefs) {
+                c *= 0.5f / sum;
+            }
+            upHistory.assign(taps - 1 + maxFrames, 0.0f);
+            evenHistory.assign(taps - 1 + maxFrames, 0.0f);
+            oddHistory.assign(half + maxFrames, 0.0f);
+        }
+
+        // Delay of the up and down sampling together, in frames at the lower rate
+        float latency()
+        {
+            return taps - 1 + pad;
+        }
+
+        void reset()
+        {
+            std::fill(upHistory.begin(), upHistory.end(), 0.0f);
+            std::fill(evenHistory.begin(), evenHistory.end(), 0.0f);
+            std::fill(oddHistory.begin(), oddHistory.end(), 0.0f);
+            padSample = 0.0f;
+        }
+
+        // `frames` samples of `in` to 2 * `frames` samples of `out`
+        void up(const float* in, uint32_t frames, float* out)
+        {
+            uint32_t past = taps - 1;
+            float* history = upHistory.data();
+            if (pad) {
+                history[past] = padSample;
+                memcpy(history + past + 1, in, (frames - 1) * sizeof(float));
+                padSample = in[frames - 1];
+            } else {
+                memcpy(history + past, in, frames * sizeof(float));
+            }
+            for (uint32_t n = 0; n < frames; n++) {
+                // The zero stuffed input has half the energy, the gain of 2 is restored here
+                out[2 * n] = 2.0f * float4::dot(history + n, coefs.data(), taps);
+                out[2 * n + 1] = history[n + taps / 2];
+            }
+            memmove(history, history + frames, past * sizeof(float));
+        }
+
+        // 2 * `frames` samples of `in` to `frames` samples of `out`
+        void down(const float* in, uint32_t frames, float* out)
+        {
+            uint32_t past = taps - 1;
+            uint32_t half = taps / 2;
+            float* even = evenHistory.data();
+            float* odd = oddHistory.data();
+            for (uint32_t n = 0; n < frames; n++) {
+                even[past + n] = in[2 * n];
+                odd[half + n] = in[2 * n + 1];
+            }
+            for (uint32_t n = 0; n < frames; n++) {
+                out[n] = float4::dot(even + n, coefs.data(), taps) + 0.5f * odd[n];
+            }
+            memmove(even, even + frames, past * sizeof(float));
+            memmove(odd, odd + frames, half * sizeof(float));
+        }
+    };
+
+    // Frames at the engine rate processed at once
+    static const uint32_t CHUNK = 64;
+
+    uint8_t factor = 1;
+    std::vector<HalfBand> stages;
+    std::vector<float> ping;
+    std::vector<float> pong;
+    // Stages run, the following ones being bypassed by `limitFactor()` and replaced by a delay of their latency
+    uint8_t activeStages = 0;
+    uint32_t bypassDelay = 0;
+    std::vector<float> delayLine;
+
+    uint32_t stagesLatency(uint8_t count)
+    {
+        float frames = 0.0f;
+        float rate = 1.0f;
+        for (uint8_t s = 0; s < count; s++) {
+            frames += stages[s].latency() / rate;
+            rate *= 2.0f;
+        }
+        return frames;
+    }
+
+public:
+    static const uint8_t MAX_FACTOR = 8;
+
+    // 1, 2, 4 or 8, anything else being rounded down
+    Oversampler(uint8_t _factor = 1)
+    {
+        setFactor(_factor);
+    }
+
+    // Not realtime safe: to be called when the plugin is created, as the latency of the track depends on it
+    void setFactor(uint8_t _factor)
+    {
+        factor = _factor >= 8 ? 8 : _factor >= 4 ? 4 : _factor >= 2 ? 2 : 1;
+        stages.clear();
+        uint32_t frames = CHUNK;
+        for (uint8_t f = 1; f < factor; f *= 2) {
+            stages.push_back(HalfBand(f == 1 ? 8 : 4, frames, f > 1));
+            frames *= 2;
+        }
+        ping.assign(CHUNK * factor, 0.0f);
+        pong.assign(CHUNK * factor, 0.0f);
+        activeStages = stages.size();
+        bypassDelay = 0;
+        delayLine.assign(CHUNK + latencyFrames(), 0.0f);
+    }
+
+    // Run at most at `max` times the sample rate, e.g. to save CPU (see AudioPlugin::setQualityLevel()), without
+    // changing the latency: the stages bypassed are replaced by a plain delay. Realtime safe.
+    void limitFactor(uint8_t max)
+    {
+        uint8_t count = 0;
+        for (uint8_t f = 1; f < factor && f * 2 <= max; f *= 2) {
+            count++;
+        }
+        if (count == activeStages) {
+            return;
+        }
+        activeStages = count;
+        bypassDelay = latencyFrames() - stagesLatency(count);
+        reset();
+    }
+
+    uint8_t getFactor()
+    {
+        return factor;
+    }
+
+    // Delay added to the signal, in frames at the engine rate, see AudioPlugin::latencyFrames()
+    uint32_t latencyFrames()
+    {
+        return stagesLatency(stages.size());
+    }
+
+    void reset()
+    {
+        for (HalfBand& stage : stages) {
+            stage.reset();
+        }
+        std::fill(delayLine.begin(), delayLine.end(), 0.0f);
+    }
+
+    // Replace `frames` samples of `buf`, `stride` being the distance between two frames, by the output of
+    // `kernel(float* samples, uint32_t count)` run in place at the oversampled rate.
+    template <typename F>
+    void process(float* buf, uint32_t stride, uint32_t frames, F kernel)
+    {
+        for (uint32_t start = 0; start < frames; start += CHUNK) {
+            uint32_t count = std::min(CHUNK, frames - start);
+            float* chunk = buf + start * stride;
+            float* a = ping.data();
+            float* b = pong.data();
+            if (bypassDelay > 0) {
+                // The input follows the delayed samples kept from the previous chunk
+                float* delayed = delayLine.data();
+                for (uint32_t f = 0; f < count; f++) {
+                    delayed[bypassDelay + f] = chunk[f * stride];
+                }
+                memcpy(a, delayed, count * sizeof(float));
+                memmove(delayed, delayed + count, bypassDelay * sizeof(float));
+            } else {
+                for (uint32_t f = 0; f < count; f++) {
+                    a[f] = chunk[f * stride];
+                }
+            }
+
+            uint32_t n = count;
+            for (uint8_t s = 0; s < activeStages; s++) {
+                stages[s].up(a, n, b);
+                std::swap(a, b);
+                n *= 2;
+            }
+            kernel(a, n);
+            for (int s = activeStages - 1; s >= 0; s--) {
+                n /= 2;
+                stages[s].down(a, n, b);
+                std::swap(a, b);
+            }
+
+            for (uint32_t f = 0; f < count; f++) {
+                chunk[f * stride] = a[f];
+            }
+        }
+    }
+};
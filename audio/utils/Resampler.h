@@ -0,0 +1,227 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <xmmintrin.h>
+#define RESAMPLER_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RESAMPLER_NEON
+#endif
+
+// Polyphase windowed sinc sample rate converter, for audio devices running at another rate than the engine and for
+// sample files recorded at another rate.
+//
+// Each output frame is the dot product of `taps` input frames with the filter phase closest to its fractional
+// position, linearly interpolated with the next phase, so any ratio is supported. When downsampling, the cutoff
+// follows the output rate to avoid aliasing. The number of taps sets the quality and the CPU cost.
+class Resampler {
+public:
+    enum Quality {
+        LOW, // 8 taps
+        MEDIUM, // 16 taps
+        HIGH, // 32 taps
+    };
+
+    static Quality getQuality(std::string name, Quality fallback = MEDIUM)
+    {
+        return name == "low" ? LOW : name == "medium" ? MEDIUM : name == "high" ? HIGH : fallback;
+    }
+
+    static const uint8_t MAX_CHANNELS = 2;
+
+protected:
+    static const uint32_t PHASES = 256;
+
+    uint32_t taps = 16;
+    // Input frames per output frame
+    double step = 1.0;
+    // (PHASES + 1) * taps coefficients, the last phase being the first one shifted by one frame
+    std::vector<float> table;
+
+    // Input frames kept between two calls, `time` being the position of the next output frame in them
+    std::vector<float> history[MAX_CHANNELS];
+    uint32_t historyFrames = 0;
+    double time = 0.0;
+
+    static float dot(const float* a, const float* b, uint32_t n)
+    {
+#if defined(RESAMPLER_SSE)
+        __m128 sum = _mm_setzero_ps();
+        for (uint32_t i = 0; i < n; i += 4) {
+            sum = _mm_add_ps(sum, _mm_mul_ps(_mm_loadu_ps(a + i), _mm_loadu_ps(b + i)));
+        }
+        float out[4];
+        _mm_storeu_ps(out, sum);
+        return out[0] + out[1] + out[2] + out[3];
+#elif defined(RESAMPLER_NEON)
+        float32x4_t sum = vdupq_n_f32(0.0f);
+        for (uint32_t i = 0; i < n; i += 4) {
+            sum = vmlaq_f32(sum, vld1q_f32(a + i), vld1q_f32(b + i));
+        }
+        float out[4];
+        vst1q_f32(out, sum);
+        return out[0] + out[1] + out[2] + out[3];
+#else
+        float sum = 0.0f;
+        for (uint32_t i = 0; i < n; i++) {
+            sum += a[i] * b[i];
+        }
+        return sum;
+#endif
+    }
+
+    // Output frame at `t`, in frames of `in`, requiring `in[floor(t) - taps / 2 + 1]` to `in[floor(t) + taps / 2]`
+    float at(const float* in, double t)
+    {
+        int64_t base = (int64_t)t;
+        float phase = (t - base) * PHASES;
+        uint32_t p = (uint32_t)phase;
+        float frac = phase - p;
+        const float* x = in + base - taps / 2 + 1;
+        const float* coefs = table.data() + p * taps;
+        float a = dot(x, coefs, taps);
+        float b = dot(x, coefs + taps, taps);
+        return a + (b - a) * frac;
+    }
+
+    void buildTable(Quality quality)
+    {
+        taps = quality == LOW ? 8 : quality == MEDIUM ? 16 : 32;
+        float cutoff = (quality == LOW ? 0.85f : quality == MEDIUM ? 0.91f : 0.95f) * std::min(1.0, 1.0 / step);
+        table.resize((PHASES + 1) * taps);
+        float half = taps / 2;
+        for (uint32_t p = 0; p <= PHASES; p++) {
+            float phase = (float)p / PHASES;
+            for (uint32_t j = 0; j < taps; j++) {
+                // Distance from the input frame to the output frame
+                float d = j - (half - 1) - phase;
+                float x = M_PI * cutoff * d;
+                float sinc = d == 0.0f ? 1.0f : sinf(x) / x;
+                // Blackman window over [-half, half]
+                float w = 0.42f + 0.5f * cosf(M_PI * d / half) + 0.08f * cosf(2.0f * M_PI * d / half);
+                table[p * taps + j] = fabsf(d) >= half ? 0.0f : cutoff * sinc * w;
+            }
+        }
+        // Unity gain for each phase, so a constant input stays constant
+        for (uint32_t p = 0; p <= PHASES; p++) {
+            float sum = 0.0f;
+            for (uint32_t j = 0; j < taps; j++) {
+                sum += table[p * taps + j];
+            }
+            for (uint32_t j = 0; j < taps; j++) {
+                table[p * taps + j] /= sum;
+            }
+        }
+    }
+
+public:
+    Resampler(uint32_t inRate = 48000, uint32_t outRate = 48000, Quality quality = MEDIUM)
+    {
+        set(inRate, outRate, quality);
+    }
+
+    void set(uint32_t inRate, uint32_t outRate, Quality quality = MEDIUM)
+    {
+        step = (double)inRate / outRate;
+        buildTable(quality);
+        reset();
+    }
+
+    void reset()
+    {
+        // Start with the first input frame centered on the first output frame
+        historyFrames = taps / 2 - 1;
+        time = historyFrames;
+        for (std::vector<float>& h : history) {
+            h.assign(historyFrames, 0.0f);
+        }
+    }
+
+    bool isBypassed()
+    {
+        return step == 1.0;
+    }
+
+    // Maximum number of output frames for `frames` input frames
+    uint32_t maxOutputFrames(uint32_t frames)
+    {
+        return (uint32_t)ceil(frames / step) + 1;
+    }
+
+    // Convert `frames` of the `channels` input lanes (with `stride` between frames) to the output lanes, return
+    // the number of output frames written. Safe for the audio thread once `reserve()` was called.
+    uint32_t process(const float* const* in, uint32_t stride, uint32_t frames, float* const* out, uint8_t channels)
+    {
+        for (uint8_t c = 0; c < channels; c++) {
+            std::vector<float>& h = history[c];
+            h.resize(historyFrames + frames);
+            for (uint32_t f = 0; f < frames; f++) {
+                h[historyFrames + f] = in[c][f * stride];
+            }
+        }
+        historyFrames += frames;
+
+        uint32_t count = 0;
+        while ((int64_t)time + taps / 2 < historyFrames) {
+            for (uint8_t c = 0; c < channels; c++) {
+                out[c][count] = at(history[c].data(), time);
+            }
+            count++;
+            time += step;
+        }
+
+        // Keep the frames needed by the next output frame
+        uint32_t drop = std::min<int64_t>(std::max<int64_t>((int64_t)time - taps / 2 + 1, 0), historyFrames);
+        for (uint8_t c = 0; c < channels; c++) {
+            std::vector<float>& h = history[c];
+            memmove(h.data(), h.data() + drop, (historyFrames - drop) * sizeof(float));
+        }
+        historyFrames -= drop;
+        time -= drop;
+        return count;
+    }
+
+    // Allocate the history for blocks of up to `frames`, so `process()` never allocates
+    void reserve(uint32_t frames)
+    {
+        for (std::vector<float>& h : history) {
+            h.reserve(frames + taps + 1);
+        }
+    }
+
+    // Convert interleaved samples in place, e.g. a sample file once loaded, return the new number of samples,
+    // truncated to `capacity`.
+    static uint64_t convert(float* data, uint64_t samples, uint8_t channels, uint32_t inRate, uint32_t outRate,
+        uint64_t capacity, Quality quality = HIGH)
+    {
+        if (inRate == outRate || inRate == 0 || channels == 0) {
+            return samples;
+        }
+        Resampler resampler(inRate, outRate, quality);
+        uint64_t frames = samples / channels;
+        uint32_t pad = resampler.taps;
+        uint64_t outFrames = std::min<uint64_t>(frames * outRate / inRate, capacity / channels);
+
+        // Deinterleave with silence around, so every output frame has all its taps
+        std::vector<float> lane(frames + 2 * pad);
+        std::vector<float> out(outFrames * channels);
+        for (uint8_t c = 0; c < channels; c++) {
+            std::fill(lane.begin(), lane.end(), 0.0f);
+            for (uint64_t f = 0; f < frames; f++) {
+                lane[pad + f] = data[f * channels + c];
+            }
+            for (uint64_t f = 0; f < outFrames; f++) {
+                out[f * channels + c] = resampler.at(lane.data(), pad + f * resampler.step);
+            }
+        }
+        memcpy(data, out.data(), out.size() * sizeof(float));
+        return out.size();
+    }
+};
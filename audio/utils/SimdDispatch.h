@@ -0,0 +1,34 @@
+#pragma once
+
+#include <string>
+
+#include "audio/utils/CpuFeatures.h"
+#include "audio/utils/float4.h"
+#include "audio/utils/mixLane.h"
+
+// Variant of each family of kernels running on this CPU, e.g. logged by the host at startup. The families with a
+// variant per instruction set pick it once from CpuFeatures (see mixLane.h), the others are built for the baseline
+// of the binary with float4.h.
+namespace SimdDispatch {
+
+inline const char* baseline()
+{
+#if defined(FLOAT4_SSE)
+    return "sse2";
+#elif defined(FLOAT4_NEON)
+    return "neon";
+#else
+    return "scalar";
+#endif
+}
+
+inline std::string describe()
+{
+    return "mixer " + std::string(MixLane::variant.name)
+        + ", filter bank " + baseline()
+        + ", interpolation " + baseline()
+        + ", conversion " + baseline()
+        + ", fft scalar";
+}
+
+} // namespace SimdDispatch
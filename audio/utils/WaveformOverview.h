@@ -0,0 +1,189 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+// Peaks of a sample at several resolutions, so a waveform is drawn in the same time whatever the length of the
+// sample: each pixel merges a few buckets of the level matching its width instead of reading the samples.
+//
+// Level 0 has a bucket every `BASE` samples, each next level merges `FACTOR` buckets of the previous one. The
+// overview is built once when the sample is loaded and can be saved next to the file, see `SamplePool`.
+class WaveformOverview {
+public:
+    struct Peak {
+        float min;
+        float max;
+        float rms;
+    };
+
+    static const uint32_t BASE = 64;
+    static const uint32_t FACTOR = 4;
+
+protected:
+    static const uint32_t MAGIC = 0x5a50454b; // ZPEK
+    static const uint32_t VERSION = 1;
+
+    uint64_t count = 0;
+    std::vector<std::vector<Peak>> levels;
+
+    static Peak merge(const Peak* peaks, uint32_t n, const uint32_t* sizes, uint64_t total)
+    {
+        Peak out = peaks[0];
+        double energy = 0.0;
+        for (uint32_t i = 0; i < n; i++) {
+            out.min = std::min(out.min, peaks[i].min);
+            out.max = std::max(out.max, peaks[i].max);
+            energy += (double)peaks[i].rms * peaks[i].rms * sizes[i];
+        }
+        out.rms = sqrt(energy / total);
+        return out;
+    }
+
+    uint64_t bucketSize(uint8_t level) const
+    {
+        uint64_t size = BASE;
+        for (uint8_t l = 0; l < level; l++) {
+            size *= FACTOR;
+        }
+        return size;
+    }
+
+public:
+    // Summarize `count` samples, interleaved channels being summarized together as the waveform draws them
+    void build(const float* data, uint64_t samples)
+    {
+        count = samples;
+        levels.clear();
+        if (!data || samples == 0) {
+            return;
+        }
+
+        std::vector<Peak> level((samples + BASE - 1) / BASE);
+        for (uint64_t b = 0; b < level.size(); b++) {
+            uint64_t start = b * BASE;
+            uint64_t end = std::min(start + BASE, samples);
+            Peak peak = { data[start], data[start], 0.0f };
+            double energy = 0.0;
+            for (uint64_t i = start; i < end; i++) {
+                peak.min = std::min(peak.min, data[i]);
+                peak.max = std::max(peak.max, data[i]);
+                energy += (double)data[i] * data[i];
+            }
+            peak.rms = sqrt(energy / (end - start));
+            level[b] = peak;
+        }
+        levels.push_back(level);
+
+        uint64_t size = BASE;
+        while (levels.back().size() > 1) {
+            const std::vector<Peak>& prev = levels.back();
+            std::vector<Peak> next((prev.size() + FACTOR - 1) / FACTOR);
+            for (uint64_t b = 0; b < next.size(); b++) {
+                uint32_t n = std::min<uint64_t>(FACTOR, prev.size() - b * FACTOR);
+                uint32_t sizes[FACTOR];
+                uint64_t total = 0;
+                for (uint32_t i = 0; i < n; i++) {
+                    uint64_t start = (b * FACTOR + i) * size;
+                    sizes[i] = std::min(start + size, samples) - start;
+                    total += sizes[i];
+                }
+                next[b] = merge(&prev[b * FACTOR], n, sizes, total);
+            }
+            size *= FACTOR;
+            levels.push_back(next);
+        }
+    }
+
+    // Number of samples summarized
+    uint64_t samples() const
+    {
+        return count;
+    }
+
+    // Level to draw `samplesPerPixel` samples per pixel, the coarsest one still finer than a pixel, -1 when
+    // pixels are smaller than the buckets and the samples should be read instead
+    int8_t levelFor(float samplesPerPixel) const
+    {
+        int8_t level = -1;
+        uint64_t size = BASE;
+        while (level + 1 < (int)levels.size() && size <= samplesPerPixel) {
+            level++;
+            size *= FACTOR;
+        }
+        return level;
+    }
+
+    // Peak of the samples `from` to `to` (excluded), from the buckets of `level` they overlap
+    Peak range(int8_t level, uint64_t from, uint64_t to) const
+    {
+        const std::vector<Peak>& peaks = levels[level];
+        uint64_t size = bucketSize(level);
+        uint64_t first = std::min<uint64_t>(from / size, peaks.size() - 1);
+        uint64_t last = std::clamp<uint64_t>((to + size - 1) / size, first + 1, peaks.size());
+        Peak out = peaks[first];
+        double energy = 0.0;
+        for (uint64_t b = first; b < last; b++) {
+            out.min = std::min(out.min, peaks[b].min);
+            out.max = std::max(out.max, peaks[b].max);
+            energy += (double)peaks[b].rms * peaks[b].rms;
+        }
+        out.rms = sqrt(energy / (last - first));
+        return out;
+    }
+
+    // Save the overview to `path`, `key` identifying the samples it was built from
+    bool save(std::string path, uint64_t key)
+    {
+        FILE* file = fopen(path.c_str(), "wb");
+        if (!file) {
+            return false;
+        }
+        uint32_t header[3] = { MAGIC, VERSION, (uint32_t)levels.size() };
+        bool ok = fwrite(header, sizeof(header), 1, file) == 1
+            && fwrite(&key, sizeof(key), 1, file) == 1
+            && fwrite(&count, sizeof(count), 1, file) == 1;
+        for (std::vector<Peak>& level : levels) {
+            uint64_t size = level.size();
+            ok = ok && fwrite(&size, sizeof(size), 1, file) == 1
+                && fwrite(level.data(), sizeof(Peak), size, file) == size;
+        }
+        fclose(file);
+        return ok;
+    }
+
+    // Load an overview saved for the same `key` and number of samples, return false if there is none
+    bool load(std::string path, uint64_t key, uint64_t samples)
+    {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        uint32_t header[3];
+        uint64_t savedKey;
+        uint64_t savedCount;
+        bool ok = fread(header, sizeof(header), 1, file) == 1
+            && header[0] == MAGIC && header[1] == VERSION && header[2] < 64
+            && fread(&savedKey, sizeof(savedKey), 1, file) == 1 && savedKey == key
+            && fread(&savedCount, sizeof(savedCount), 1, file) == 1 && savedCount == samples;
+        levels.clear();
+        for (uint32_t l = 0; ok && l < header[2]; l++) {
+            uint64_t size;
+            ok = fread(&size, sizeof(size), 1, file) == 1 && size <= samples / BASE + 1;
+            if (ok) {
+                levels.emplace_back(size);
+                ok = fread(levels.back().data(), sizeof(Peak), size, file) == size;
+            }
+        }
+        fclose(file);
+        if (!ok) {
+            levels.clear();
+            return false;
+        }
+        count = samples;
+        return true;
+    }
+};
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+// Conversions between linear gain and decibels, for the gain computers running on every sample.
+//
+// The exponent of the float is read from its bits, so only the log2 / exp2 of the fractional part comes from a
+// table of 256 entries, linearly interpolated (error below 1e-4dB). Call `DbTable::get()` once outside of the audio
+// thread, e.g. in the constructor of the plugin, so the tables are built before the first block.
+class DbTable {
+protected:
+    static const int SIZE = 256;
+    static constexpr float DB_PER_OCTAVE = 6.02059991f; // 20 * log10(2)
+
+    float log2Table[SIZE + 1];
+    float exp2Table[SIZE + 1];
+
+    DbTable()
+    {
+        for (int i = 0; i <= SIZE; i++) {
+            log2Table[i] = log2f(1.0f + (float)i / SIZE);
+            exp2Table[i] = exp2f((float)i / SIZE);
+        }
+    }
+
+public:
+    static constexpr float MIN_DB = -200.0f;
+
+    static DbTable& get()
+    {
+        static DbTable table;
+        return table;
+    }
+
+    // Gain to dB, MIN_DB for a gain of 0
+    inline float toDb(float gain)
+    {
+        gain = fabsf(gain);
+        if (gain < 1e-10f) {
+            return MIN_DB;
+        }
+        uint32_t bits;
+        memcpy(&bits, &gain, sizeof(bits));
+        int exponent = (int)(bits >> 23) - 127;
+        // 8 bits of mantissa for the index, the 15 others for the interpolation
+        uint32_t index = (bits >> 15) & 0xff;
+        float frac = (float)(bits & 0x7fff) * (1.0f / 32768.0f);
+        float log2 = exponent + log2Table[index] + (log2Table[index + 1] - log2Table[index]) * frac;
+        return log2 * DB_PER_OCTAVE;
+    }
+
+    // dB to gain, 0 below MIN_DB
+    inline float toGain(float db)
+    {
+        if (db <= MIN_DB) {
+            return 0.0f;
+        }
+        float octaves = db * (1.0f / DB_PER_OCTAVE);
+        float whole = floorf(octaves);
+        float position = (octaves - whole) * SIZE;
+        // Rounding can land exactly on the next octave
+        int index = std::min((int)position, SIZE - 1);
+        float frac = exp2Table[index] + (exp2Table[index + 1] - exp2Table[index]) * (position - index);
+        // 2^whole built from its exponent bits, whole being within [-67, 127] with MIN_DB and a float input
+        int exponent = std::min((int)whole, 127) + 127;
+        uint32_t bits = (uint32_t)exponent << 23;
+        float scale;
+        memcpy(&scale, &bits, sizeof(scale));
+        return frac * scale;
+    }
+};
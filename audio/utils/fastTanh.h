@@ -0,0 +1,68 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+
+#include "audio/utils/float4.h"
+
+// Rational approximations of tanh, for the saturating stages evaluated several times per sample, where std::tanh is
+// too slow and the lookup table too coarse. Both are odd, monotonic, and reach exactly +/-1 where they are clamped,
+// so the curve stays continuous.
+//
+// - `tanhPade`: Pade [3/2], clamped to [-3, 3], error below 2.4e-2. One division, for soft clipping.
+// - `tanhRational`: Lambert continued fraction [7/6], clamped to [-4.97, 4.97], error below 1e-4, for filters.
+//
+// `tanhSlope(x)` is `tanh(x) / x`, 1 at 0, the gain of the saturation around `x`, without dividing by `x`.
+
+inline float tanhPade(float x)
+{
+    x = std::clamp(x, -3.0f, 3.0f);
+    float x2 = x * x;
+    return x * (27.0f + x2) / (27.0f + 9.0f * x2);
+}
+
+static constexpr float TANH_RATIONAL_LIMIT = 4.97f;
+
+inline float tanhSlope(float x)
+{
+    float c = std::clamp(x, -TANH_RATIONAL_LIMIT, TANH_RATIONAL_LIMIT);
+    float x2 = c * c;
+    float ratio = (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2))) / (135135.0f + x2 * (62370.0f + x2 * (3150.0f + 28.0f * x2)));
+    // Past the clamp, tanh is 1 so the slope is 1 / |x|
+    return ratio * TANH_RATIONAL_LIMIT / std::max(std::fabs(x), TANH_RATIONAL_LIMIT);
+}
+
+inline float tanhRational(float x)
+{
+    float c = std::clamp(x, -TANH_RATIONAL_LIMIT, TANH_RATIONAL_LIMIT);
+    float x2 = c * c;
+    return c * (135135.0f + x2 * (17325.0f + x2 * (378.0f + x2))) / (135135.0f + x2 * (62370.0f + x2 * (3150.0f + 28.0f * x2)));
+}
+
+namespace float4 {
+inline v4 tanhPade(v4 x)
+{
+    x = clamp(x, -3.0f, 3.0f);
+    v4 x2 = mul(x, x);
+    return div(mul(x, add(set(27.0f), x2)), add(set(27.0f), mul(set(9.0f), x2)));
+}
+
+inline v4 tanhSlope(v4 x)
+{
+    v4 c = clamp(x, -TANH_RATIONAL_LIMIT, TANH_RATIONAL_LIMIT);
+    v4 x2 = mul(c, c);
+    v4 num = add(set(135135.0f), mul(x2, add(set(17325.0f), mul(x2, add(set(378.0f), x2)))));
+    v4 den = add(set(135135.0f), mul(x2, add(set(62370.0f), mul(x2, add(set(3150.0f), mul(set(28.0f), x2))))));
+    v4 abs = max(x, sub(set(0.0f), x));
+    return div(mul(num, set(TANH_RATIONAL_LIMIT)), mul(den, max(abs, set(TANH_RATIONAL_LIMIT))));
+}
+
+inline v4 tanhRational(v4 x)
+{
+    v4 c = clamp(x, -TANH_RATIONAL_LIMIT, TANH_RATIONAL_LIMIT);
+    v4 x2 = mul(c, c);
+    v4 num = add(set(135135.0f), mul(x2, add(set(17325.0f), mul(x2, add(set(378.0f), x2)))));
+    v4 den = add(set(135135.0f), mul(x2, add(set(62370.0f), mul(x2, add(set(3150.0f), mul(set(28.0f), x2))))));
+    return div(mul(c, num), den);
+}
+}
@@ -0,0 +1,168 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <complex>
+#include <cstdint>
+#include <vector>
+
+#include "audio/utils/float4.h"
+
+// FFT of real signals, for power of two sizes up to 8192, 64 and more being the sizes it is made for.
+//
+// The `size` real samples are packed as `size / 2` complex samples, transformed by a radix-2 complex FFT and
+// split back into the `size / 2 + 1` bins of the real spectrum, so it costs half a complex FFT. The twiddles and
+// the bit reversal are computed once in the constructor; the real and imaginary parts are stored apart, so the
+// butterflies run 4 at a time in the SIMD registers.
+//
+// The inverse is not normalized: divide the result by the size to get the original signal back. Nothing is
+// allocated once created, so it can run on the audio thread, but an instance has its own work buffers: it must
+// not be shared between threads.
+class RealFft {
+public:
+    static const uint32_t MAX_SIZE = 8192;
+
+protected:
+    uint32_t n;
+    uint32_t half;
+    std::vector<uint32_t> reversed;
+    // Twiddles of each stage, the stage of butterflies `h` samples apart starting at `h - 1`
+    std::vector<float> twiddleRe;
+    std::vector<float> twiddleIm;
+    // e^(-2 i pi k / n), to split the packed spectrum
+    std::vector<float> splitRe;
+    std::vector<float> splitIm;
+    std::vector<float> re;
+    std::vector<float> im;
+
+    void transform()
+    {
+        for (uint32_t h = 1; h < half; h <<= 1) {
+            const float* wr = twiddleRe.data() + h - 1;
+            const float* wi = twiddleIm.data() + h - 1;
+            for (uint32_t i = 0; i < half; i += 2 * h) {
+                float* ar = re.data() + i;
+                float* ai = im.data() + i;
+                float* br = ar + h;
+                float* bi = ai + h;
+                uint32_t k = 0;
+#if defined(FLOAT4)
+                using namespace float4;
+                for (; k + 4 <= h; k += 4) {
+                    v4 xr = load(br + k);
+                    v4 xi = load(bi + k);
+                    v4 cr = load(wr + k);
+                    v4 ci = load(wi + k);
+                    v4 tr = sub(mul(xr, cr), mul(xi, ci));
+                    v4 ti = add(mul(xr, ci), mul(xi, cr));
+                    v4 yr = load(ar + k);
+                    v4 yi = load(ai + k);
+                    store(ar + k, add(yr, tr));
+                    store(ai + k, add(yi, ti));
+                    store(br + k, sub(yr, tr));
+                    store(bi + k, sub(yi, ti));
+                }
+#endif
+                for (; k < h; k++) {
+                    float tr = br[k] * wr[k] - bi[k] * wi[k];
+                    float ti = br[k] * wi[k] + bi[k] * wr[k];
+                    br[k] = ar[k] - tr;
+                    bi[k] = ai[k] - ti;
+                    ar[k] += tr;
+                    ai[k] += ti;
+                }
+            }
+        }
+    }
+
+public:
+    // `size` is rounded to a power of two, from 4 to MAX_SIZE
+    RealFft(uint32_t size)
+    {
+        n = 4;
+        while (n < size && n < MAX_SIZE) {
+            n <<= 1;
+        }
+        half = n / 2;
+
+        uint32_t bits = 0;
+        while ((1u << bits) < half) {
+            bits++;
+        }
+        reversed.resize(half);
+        for (uint32_t i = 0; i < half; i++) {
+            uint32_t r = 0;
+            for (uint32_t b = 0; b < bits; b++) {
+                r |= ((i >> b) & 1) << (bits - 1 - b);
+            }
+            reversed[i] = r;
+        }
+
+        for (uint32_t h = 1; h < half; h <<= 1) {
+            for (uint32_t k = 0; k < h; k++) {
+                double angle = -M_PI * k / h;
+                twiddleRe.push_back(cos(angle));
+                twiddleIm.push_back(sin(angle));
+            }
+        }
+        for (uint32_t k = 0; k <= half; k++) {
+            double angle = -2.0 * M_PI * k / n;
+            splitRe.push_back(cos(angle));
+            splitIm.push_back(sin(angle));
+        }
+        re.resize(half);
+        im.resize(half);
+    }
+
+    uint32_t size() const
+    {
+        return n;
+    }
+
+    // Bins of the spectrum, from 0 to the Nyquist frequency
+    uint32_t bins() const
+    {
+        return half + 1;
+    }
+
+    // `size()` samples of `in` to the `bins()` bins of `out`
+    void forward(const float* in, std::complex<float>* out)
+    {
+        for (uint32_t m = 0; m < half; m++) {
+            re[reversed[m]] = in[2 * m];
+            im[reversed[m]] = in[2 * m + 1];
+        }
+        transform();
+        for (uint32_t k = 0; k <= half; k++) {
+            uint32_t a = k < half ? k : 0;
+            uint32_t b = k > 0 ? half - k : 0;
+            // Spectrums of the even samples and of the odd samples
+            float er = 0.5f * (re[a] + re[b]);
+            float ei = 0.5f * (im[a] - im[b]);
+            float or_ = 0.5f * (im[a] + im[b]);
+            float oi = -0.5f * (re[a] - re[b]);
+            float r = or_ * splitRe[k] - oi * splitIm[k];
+            float i = or_ * splitIm[k] + oi * splitRe[k];
+            out[k] = { er + r, ei + i };
+        }
+    }
+
+    // `bins()` bins of `in` to `size()` samples of `out`, times `size()`
+    void inverse(const std::complex<float>* in, float* out)
+    {
+        for (uint32_t k = 0; k < half; k++) {
+            std::complex<float> a = in[k];
+            std::complex<float> b = std::conj(in[half - k]);
+            std::complex<float> e = a + b;
+            std::complex<float> o = (a - b) * std::complex<float>(splitRe[k], -splitIm[k]);
+            // Packed spectrum conjugated, so the forward transform computes the inverse one
+            re[reversed[k]] = e.real() - o.imag();
+            im[reversed[k]] = -(e.imag() + o.real());
+        }
+        transform();
+        for (uint32_t m = 0; m < half; m++) {
+            out[2 * m] = re[m];
+            out[2 * m + 1] = -im[m];
+        }
+    }
+};
@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define FLOAT4_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define FLOAT4_NEON
+#endif
+
+// Minimal 4 lane float vector for the block kernels of the effects, mapping to SSE2 or NEON. Without them, `v4` is a
+// plain float so the kernels still compile, `map()` only running their scalar version.
+namespace float4 {
+#if defined(FLOAT4_SSE)
+typedef __m128 v4;
+
+inline v4 load(const float* p) { return _mm_loadu_ps(p); }
+inline void store(float* p, v4 a) { _mm_storeu_ps(p, a); }
+inline v4 set(float a) { return _mm_set1_ps(a); }
+inline v4 add(v4 a, v4 b) { return _mm_add_ps(a, b); }
+inline v4 sub(v4 a, v4 b) { return _mm_sub_ps(a, b); }
+inline v4 mul(v4 a, v4 b) { return _mm_mul_ps(a, b); }
+inline v4 div(v4 a, v4 b) { return _mm_div_ps(a, b); }
+inline v4 min(v4 a, v4 b) { return _mm_min_ps(a, b); }
+inline v4 max(v4 a, v4 b) { return _mm_max_ps(a, b); }
+// Round to the nearest integer, the default rounding mode
+inline v4 round(v4 a) { return _mm_cvtepi32_ps(_mm_cvtps_epi32(a)); }
+inline v4 floor(v4 a)
+{
+    v4 t = _mm_cvtepi32_ps(_mm_cvttps_epi32(a));
+    return _mm_sub_ps(t, _mm_and_ps(_mm_cmpgt_ps(t, a), _mm_set1_ps(1.0f)));
+}
+// Flip the sign of the lanes where the integer `k` is odd
+inline v4 flipOdd(v4 a, v4 k)
+{
+    __m128i odd = _mm_slli_epi32(_mm_cvtps_epi32(k), 31);
+    return _mm_xor_ps(a, _mm_castsi128_ps(odd));
+}
+inline void toIndex(v4 a, int32_t* out) { _mm_storeu_si128((__m128i*)out, _mm_cvttps_epi32(a)); }
+// Round to the nearest int16, saturating, `out` receiving 4 values, or 8 interleaved for `l` and `r`
+inline void toInt16(v4 a, int16_t* out)
+{
+    __m128i i = _mm_cvtps_epi32(a);
+    _mm_storel_epi64((__m128i*)out, _mm_packs_epi32(i, i));
+}
+inline void toInt16(v4 l, v4 r, int16_t* out)
+{
+    __m128i i = _mm_packs_epi32(_mm_cvtps_epi32(l), _mm_cvtps_epi32(r));
+    _mm_storeu_si128((__m128i*)out, _mm_unpacklo_epi16(i, _mm_srli_si128(i, 8)));
+}
+// Lanes moved up by one, `x` entering lane 0 and lane 3 being dropped
+inline v4 shiftIn(v4 a, float x) { return _mm_move_ss(_mm_shuffle_ps(a, a, _MM_SHUFFLE(2, 1, 0, 0)), _mm_set_ss(x)); }
+inline float last(v4 a) { return _mm_cvtss_f32(_mm_shuffle_ps(a, a, _MM_SHUFFLE(3, 3, 3, 3))); }
+// Transpose 4 frames of 4 channels, frame `i` being stored at `out + i * stride` as `a[i] b[i] c[i] d[i]`
+inline void interleave(v4 a, v4 b, v4 c, v4 d, float* out, uint32_t stride)
+{
+    _MM_TRANSPOSE4_PS(a, b, c, d);
+    _mm_storeu_ps(out, a);
+    _mm_storeu_ps(out + stride, b);
+    _mm_storeu_ps(out + 2 * stride, c);
+    _mm_storeu_ps(out + 3 * stride, d);
+}
+#elif defined(FLOAT4_NEON)
+typedef float32x4_t v4;
+
+inline v4 load(const float* p) { return vld1q_f32(p); }
+inline void store(float* p, v4 a) { vst1q_f32(p, a); }
+inline v4 set(float a) { return vdupq_n_f32(a); }
+inline v4 add(v4 a, v4 b) { return vaddq_f32(a, b); }
+inline v4 sub(v4 a, v4 b) { return vsubq_f32(a, b); }
+inline v4 mul(v4 a, v4 b) { return vmulq_f32(a, b); }
+#if defined(__aarch64__)
+inline v4 div(v4 a, v4 b) { return vdivq_f32(a, b); }
+#else
+// No division on ARMv7: reciprocal estimate refined by 2 Newton steps (relative error below 1e-6)
+inline v4 div(v4 a, v4 b)
+{
+    v4 r = vrecpeq_f32(b);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    r = vmulq_f32(vrecpsq_f32(b, r), r);
+    return vmulq_f32(a, r);
+}
+#endif
+inline v4 min(v4 a, v4 b) { return vminq_f32(a, b); }
+inline v4 max(v4 a, v4 b) { return vmaxq_f32(a, b); }
+inline v4 floor(v4 a)
+{
+    v4 t = vcvtq_f32_s32(vcvtq_s32_f32(a));
+    return vsubq_f32(t, vreinterpretq_f32_u32(vandq_u32(vcgtq_f32(t, a), vreinterpretq_u32_f32(vdupq_n_f32(1.0f)))));
+}
+inline v4 round(v4 a) { return floor(vaddq_f32(a, vdupq_n_f32(0.5f))); }
+inline v4 flipOdd(v4 a, v4 k)
+{
+    uint32x4_t odd = vshlq_n_u32(vreinterpretq_u32_s32(vcvtq_s32_f32(k)), 31);
+    return vreinterpretq_f32_u32(veorq_u32(vreinterpretq_u32_f32(a), odd));
+}
+inline void toIndex(v4 a, int32_t* out) { vst1q_s32(out, vcvtq_s32_f32(a)); }
+inline void toInt16(v4 a, int16_t* out) { vst1_s16(out, vqmovn_s32(vcvtq_s32_f32(round(a)))); }
+inline void toInt16(v4 l, v4 r, int16_t* out)
+{
+    int16x4x2_t i = { { vqmovn_s32(vcvtq_s32_f32(round(l))), vqmovn_s32(vcvtq_s32_f32(round(r))) } };
+    vst2_s16(out, i);
+}
+inline v4 shiftIn(v4 a, float x) { return vextq_f32(vdupq_n_f32(x), a, 3); }
+inline float last(v4 a) { return vgetq_lane_f32(a, 3); }
+inline void interleave(v4 a, v4 b, v4 c, v4 d, float* out, uint32_t stride)
+{
+    float32x4x2_t ab = vtrnq_f32(a, b);
+    float32x4x2_t cd = vtrnq_f32(c, d);
+    vst1q_f32(out, vcombine_f32(vget_low_f32(ab.val[0]), vget_low_f32(cd.val[0])));
+    vst1q_f32(out + stride, vcombine_f32(vget_low_f32(ab.val[1]), vget_low_f32(cd.val[1])));
+    vst1q_f32(out + 2 * stride, vcombine_f32(vget_high_f32(ab.val[0]), vget_high_f32(cd.val[0])));
+    vst1q_f32(out + 3 * stride, vcombine_f32(vget_high_f32(ab.val[1]), vget_high_f32(cd.val[1])));
+}
+#else
+typedef float v4;
+
+inline v4 load(const float* p) { return *p; }
+inline void store(float* p, v4 a) { *p = a; }
+inline v4 set(float a) { return a; }
+inline v4 add(v4 a, v4 b) { return a + b; }
+inline v4 sub(v4 a, v4 b) { return a - b; }
+inline v4 mul(v4 a, v4 b) { return a * b; }
+inline v4 div(v4 a, v4 b) { return a / b; }
+inline v4 min(v4 a, v4 b) { return a < b ? a : b; }
+inline v4 max(v4 a, v4 b) { return a > b ? a : b; }
+inline v4 floor(v4 a) { return ::floorf(a); }
+inline v4 round(v4 a) { return ::roundf(a); }
+inline v4 flipOdd(v4 a, v4 k) { return (int32_t)k & 1 ? -a : a; }
+inline void toIndex(v4 a, int32_t* out) { *out = (int32_t)a; }
+inline void toInt16(v4 a, int16_t* out) { *out = (int16_t)::lrintf(a < -32768.0f ? -32768.0f : a > 32767.0f ? 32767.0f : a); }
+inline void toInt16(v4 l, v4 r, int16_t* out)
+{
+    toInt16(l, out);
+    toInt16(r, out + 1);
+}
+inline v4 shiftIn(v4 a, float x) { return x; }
+inline float last(v4 a) { return a; }
+inline void interleave(v4 a, v4 b, v4 c, v4 d, float* out, uint32_t stride)
+{
+    out[0] = a;
+    out[1] = b;
+    out[2] = c;
+    out[3] = d;
+}
+#endif
+
+#if defined(FLOAT4_SSE) || defined(FLOAT4_NEON)
+#define FLOAT4
+const int WIDTH = 4;
+#else
+const int WIDTH = 1;
+#endif
+
+// Lanes of a track buffer are interleaved by default, so the 4 frames are gathered when `stride` is not 1
+inline v4 load(const float* p, uint32_t stride)
+{
+#if defined(FLOAT4)
+    if (stride != 1) {
+        float t[4] = { p[0], p[stride], p[2 * stride], p[3 * stride] };
+        return load(t);
+    }
+#endif
+    return load(p);
+}
+
+inline void store(float* p, uint32_t stride, v4 a)
+{
+#if defined(FLOAT4)
+    if (stride != 1) {
+        float t[4];
+        store(t, a);
+        p[0] = t[0];
+        p[stride] = t[1];
+        p[2 * stride] = t[2];
+        p[3 * stride] = t[3];
+        return;
+    }
+#endif
+    store(p, a);
+}
+
+// Sum of the lanes
+inline float sum(v4 a)
+{
+    float t[WIDTH];
+    store(t, a);
+    float total = 0.0f;
+    for (int i = 0; i < WIDTH; i++) {
+        total += t[i];
+    }
+    return total;
+}
+
+// Dot product of `n` floats, `n` being a multiple of 4
+inline float dot(const float* a, const float* b, uint32_t n)
+{
+    v4 total = set(0.0f);
+    for (uint32_t i = 0; i < n; i += WIDTH) {
+        total = add(total, mul(load(a + i), load(b + i)));
+    }
+    return sum(total);
+}
+
+inline v4 clamp(v4 a, float lo, float hi) { return min(max(a, set(lo)), set(hi)); }
+
+// sinf(x) for |x| below ~1e5: reduced to [-pi/2, pi/2] around the nearest multiple of pi, then an odd polynomial
+// (error below 1e-6).
+inline v4 sin(v4 x)
+{
+    v4 k = round(mul(x, set(0.318309886f)));
+    // Cody-Waite reduction, pi split in two so k * pi stays exact
+    v4 r = sub(sub(x, mul(k, set(3.140625f))), mul(k, set(9.67653590e-4f)));
+    v4 r2 = mul(r, r);
+    v4 p = set(-2.50521084e-8f);
+    p = add(mul(p, r2), set(2.75573192e-6f));
+    p = add(mul(p, r2), set(-1.98412698e-4f));
+    p = add(mul(p, r2), set(8.33333333e-3f));
+    p = add(mul(p, r2), set(-1.66666667e-1f));
+    p = add(mul(mul(p, r2), r), r);
+    return flipOdd(p, k);
+}
+
+// Linear interpolation in `lut` at the positions `i`, already clamped to [0, last], `last` being the last entry.
+// There is no gather instruction, so only the entries are read one by one.
+inline v4 lerp(const float* lut, v4 i, int32_t last)
+{
+#if !defined(FLOAT4)
+    int32_t idx = (int32_t)min(i, last - 1);
+    return lut[idx] + (lut[idx + 1] - lut[idx]) * (i - idx);
+#else
+    int32_t idx[4];
+    toIndex(min(i, set(last - 1)), idx);
+    float a[4], b[4];
+    for (int j = 0; j < 4; j++) {
+        a[j] = lut[idx[j]];
+        b[j] = lut[idx[j] + 1];
+    }
+    float base[4] = { (float)idx[0], (float)idx[1], (float)idx[2], (float)idx[3] };
+    v4 va = load(a);
+    return add(va, mul(sub(load(b), va), sub(i, load(base))));
+#endif
+}
+
+// Replace each of the `frames` samples of `buf` by `vec(x)`, 4 at a time, the remaining ones by `scalar(x)`
+template <typename V, typename S>
+inline void map(float* buf, uint32_t stride, uint32_t frames, V vec, S scalar)
+{
+    uint32_t f = 0;
+#if defined(FLOAT4)
+    for (; f + 4 <= frames; f += 4) {
+        float* p = buf + f * stride;
+        store(p, stride, vec(load(p, stride)));
+    }
+#endif
+    for (; f < frames; f++) {
+        buf[f * stride] = scalar(buf[f * stride]);
+    }
+}
+}
@@ -17,7 +17,7 @@ sha: 3b02b25051c8c74b6d90ac5d5475b4bf246201bf2b80a2fc794eb7f7c956490b
 
 #include <cstdint>
 
-float linearInterpolationAbsolute(float index, uint16_t lutSize, float* lut)
+float linearInterpolationAbsolute(float index, uint16_t lutSize, const float* lut)
 {
     uint16_t index1 = static_cast<uint16_t>(index);
     uint16_t index2 = (index1 + 1) % lutSize;
@@ -28,7 +28,7 @@ float linearInterpolationAbsolute(float index, uint16_t lutSize, float* lut)
 }
 
 // Linear interpolation relative where index is between 0.0f and 1.0f
-float linearInterpolation(float index, uint16_t lutSize, float* lut)
+float linearInterpolation(float index, uint16_t lutSize, const float* lut)
 {
     return linearInterpolationAbsolute(index * (lutSize - 1), lutSize, lut);
 }
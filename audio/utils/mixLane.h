@@ -0,0 +1,102 @@
+#pragma once
+
+#include <cstdint>
+
+#include "audio/utils/CpuFeatures.h"
+
+#if defined(__SSE__) || defined(__x86_64__)
+#include <immintrin.h>
+#define MIX_LANE_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define MIX_LANE_NEON
+#endif
+
+// Add `in` to `out` with a gain linearly ramping from `gain` by `step` per frame: `out[f] += (gain + f * step) * in[f]`.
+// When `overwrite` is set, `out` is written instead of accumulated, to skip clearing it first.
+// Lanes with a stride of 1 (planar layout) are processed 4 frames at a time, or 8 with AVX2, the variant being picked
+// once from the CPU features, see SimdDispatch.h.
+namespace MixLane {
+typedef void (*Fn)(float* out, const float* in, uint32_t stride, uint32_t frames, float gain, float step, bool overwrite);
+
+inline void scalar(float* out, const float* in, uint32_t stride, uint32_t f, uint32_t frames, float gain, float step, bool overwrite)
+{
+    for (; f < frames; f++) {
+        float v = (gain + f * step) * in[f * stride];
+        out[f * stride] = overwrite ? v : out[f * stride] + v;
+    }
+}
+
+inline void baseline(float* out, const float* in, uint32_t stride, uint32_t frames, float gain, float step, bool overwrite)
+{
+    uint32_t f = 0;
+    if (stride == 1) {
+#if defined(MIX_LANE_SSE)
+        __m128 g = _mm_setr_ps(gain, gain + step, gain + 2 * step, gain + 3 * step);
+        __m128 s = _mm_set1_ps(4 * step);
+        for (; f + 4 <= frames; f += 4) {
+            __m128 v = _mm_mul_ps(g, _mm_loadu_ps(in + f));
+            _mm_storeu_ps(out + f, overwrite ? v : _mm_add_ps(_mm_loadu_ps(out + f), v));
+            g = _mm_add_ps(g, s);
+        }
+#elif defined(MIX_LANE_NEON)
+        float start[4] = { gain, gain + step, gain + 2 * step, gain + 3 * step };
+        float32x4_t g = vld1q_f32(start);
+        float32x4_t s = vdupq_n_f32(4 * step);
+        for (; f + 4 <= frames; f += 4) {
+            float32x4_t x = vld1q_f32(in + f);
+#if defined(__aarch64__)
+            vst1q_f32(out + f, overwrite ? vmulq_f32(g, x) : vfmaq_f32(vld1q_f32(out + f), g, x));
+#else
+            vst1q_f32(out + f, overwrite ? vmulq_f32(g, x) : vaddq_f32(vld1q_f32(out + f), vmulq_f32(g, x)));
+#endif
+            g = vaddq_f32(g, s);
+        }
+#endif
+    }
+    scalar(out, in, stride, f, frames, gain, step, overwrite);
+}
+
+#if defined(MIX_LANE_SSE)
+__attribute__((target("avx2,fma"))) inline void avx2(float* out, const float* in, uint32_t stride, uint32_t frames, float gain, float step, bool overwrite)
+{
+    uint32_t f = 0;
+    if (stride == 1) {
+        __m256 g = _mm256_add_ps(_mm256_set1_ps(gain), _mm256_mul_ps(_mm256_setr_ps(0, 1, 2, 3, 4, 5, 6, 7), _mm256_set1_ps(step)));
+        __m256 s = _mm256_set1_ps(8 * step);
+        for (; f + 8 <= frames; f += 8) {
+            __m256 x = _mm256_loadu_ps(in + f);
+            _mm256_storeu_ps(out + f, overwrite ? _mm256_mul_ps(g, x) : _mm256_fmadd_ps(g, x, _mm256_loadu_ps(out + f)));
+            g = _mm256_add_ps(g, s);
+        }
+    }
+    scalar(out, in, stride, f, frames, gain, step, overwrite);
+}
+#endif
+
+struct Variant {
+    const char* name;
+    Fn fn;
+};
+
+inline Variant select()
+{
+#if defined(MIX_LANE_SSE)
+    if (CpuFeatures::get().avx2 && CpuFeatures::get().fma) {
+        return { "avx2", avx2 };
+    }
+    return { "sse2", baseline };
+#elif defined(MIX_LANE_NEON)
+    return { "neon", baseline };
+#else
+    return { "scalar", baseline };
+#endif
+}
+
+inline const Variant variant = select();
+} // namespace MixLane
+
+inline void mixLane(float* out, const float* in, uint32_t stride, uint32_t frames, float gain, float step, bool overwrite)
+{
+    MixLane::variant.fn(out, in, stride, frames, gain, step, overwrite);
+}
@@ -7,13 +7,15 @@ The file defines a function responsible for reading configuration parameters fro
 
 ### Basic Idea of Operation
 
-1.  **File Loading:** The system is directed to a specific path where the configuration file resides. It securely attempts to open and read this file, logging the progress.
+1.  **File Loading:** The system is directed to a specific path where the configuration file resides. It securely attempts to open and read this file, logging the progress. The parsed configuration is cached in a compact binary file next to it (`ConfigCache`), so the next startups skip parsing the JSON as long as it didn't change.
 2.  **Data Interpretation:** The contents of the file, which are written in the structured JSON format, are translated into instructions the program can understand.
 3.  **Distribution of Settings:** The settings are strategically distributed to specific functional systems within the application:
     *   It initializes the **audio host**, ensuring sound processing capabilities are ready.
     *   It configures the various **controllers** that manage the application’s logic, behavior, and input handling.
     *   It sets up the **View Manager**, which is the primary system governing the layout, drawing, and interaction of the entire user interface.
 
+    The audio and the user interface are loaded in two stages, so the application can start playing before the views are built.
+
 Robust error handling is included (using a "try-catch" mechanism), meaning if the configuration file is missing or corrupted, the system logs the exact issue rather than causing the program to crash. This ensures a more reliable startup process.
 
 sha: b29bdb4c9d4f9eaf2e10a9a0e7e0221422afca1fabc070c894388693086e3d7d 
@@ -21,6 +23,7 @@ sha: b29bdb4c9d4f9eaf2e10a9a0e7e0221422afca1fabc070c894388693086e3d7d
 #pragma once
 
 #include "controllers.h"
+#include "helpers/configCache.h"
 #include "host.h"
 #include "log.h"
 #include "plugins/components/drawInterface.h"
@@ -29,31 +32,122 @@ sha: b29bdb4c9d4f9eaf2e10a9a0e7e0221422afca1fabc070c894388693086e3d7d
 
 #include "plugins/components/utils/color.h"
 
+#include <filesystem>
 #include <fstream>
 
-void loadJsonConfig(std::string configPath)
+// Config as loaded, to find out what changed when the file is reloaded
+nlohmann::json loadedConfig;
+
+// Read the config, from the binary cache when the JSON didn't change since it was compiled. Empty if it cannot be read.
+nlohmann::json readJsonConfig(std::string configPath)
 {
     try {
-        std::ifstream configFile(configPath);
         logInfo("load json config: %s", configPath.c_str());
-        if (configFile.is_open()) {
-            nlohmann::json config = nlohmann::json::parse(configFile);
-            configFile.close();
-            if (config.contains("audio")) {
-                logInfo("----------- init audio -------------");
-                hostConfig(config["audio"]);
-            }
-            logInfo("----------- init controllers -------------");
-            lastPluginControllerInstance->config(config); // <--- not very nice!!!!
-            if (config.contains("controllers")) {
+        if (std::filesystem::exists(configPath)) {
+            loadedConfig = ConfigCache::load(configPath);
+            return loadedConfig;
+        }
+    } catch (const std::exception& e) {
+        logError("load json config: %s", e.what());
+    }
+    return nlohmann::json();
+}
 
-                // TODO to be implemented...
-            }
+// First stage of the startup (see zic.cpp): the audio tracks, so the host thread can start playing before the UI is
+// loaded.
+void loadAudioConfig(nlohmann::json& config)
+{
+    try {
+        if (config.contains("audio")) {
+            logInfo("----------- init audio -------------");
+            hostConfig(config["audio"]);
+        }
+    } catch (const std::exception& e) {
+        logError("load audio config: %s", e.what());
+    }
+}
+
+// Second stage of the startup: the controllers and the views, their components binding to the plugins already loaded
+void loadUiConfig(nlohmann::json& config)
+{
+    if (config.is_null()) {
+        return;
+    }
+    try {
+        logInfo("----------- init controllers -------------");
+        lastPluginControllerInstance->config(config); // <--- not very nice!!!!
+        if (config.contains("controllers")) {
 
-            ViewManager::get().config(config);
+            // TODO to be implemented...
         }
+
+        ViewManager::get().config(config);
         logInfo("----------- config done -------------");
     } catch (const std::exception& e) {
         logError("load json config: %s", e.what());
     }
-}
\ No newline at end of file
+}
+
+void loadJsonConfig(std::string configPath)
+{
+    nlohmann::json config = readJsonConfig(configPath);
+    loadAudioConfig(config);
+    loadUiConfig(config);
+}
+
+// Part of the config that can only be applied with a restart: everything but the audio tracks and the views
+nlohmann::json configWithoutReloadable(nlohmann::json config)
+{
+    config.erase("views");
+    if (config.contains("audio")) {
+        config["audio"].erase("tracks");
+    }
+    return config;
+}
+
+nlohmann::json configTracks(nlohmann::json& config)
+{
+    if (config.contains("audio") && config["audio"].contains("tracks")) {
+        return config["audio"]["tracks"];
+    }
+    return nlohmann::json();
+}
+
+// Apply the changes of the config file without restarting, when only the audio tracks and the views changed.
+// Return false if the app must restart.
+bool reloadJsonConfig(std::string configPath)
+{
+    nlohmann::json config;
+    try {
+        config = ConfigCache::load(configPath);
+    } catch (const std::exception& e) {
+        // The file might be half written, wait for the next change
+        logError("reload json config: %s", e.what());
+        return true;
+    }
+
+    if (configWithoutReloadable(config) != configWithoutReloadable(loadedConfig)) {
+        return false;
+    }
+    bool tracksChanged = configTracks(config) != configTracks(loadedConfig);
+    bool viewsChanged = config.value("views", nlohmann::json()) != loadedConfig.value("views", nlohmann::json());
+    if (tracksChanged) {
+        logInfo("----------- reload audio tracks -------------");
+        try {
+            if (!hostReloadTracks(config["audio"])) {
+                return false;
+            }
+        } catch (const std::exception& e) {
+            logError("reload audio tracks: %s", e.what());
+            return false;
+        }
+    }
+    // Views are re-created as well when tracks changed, so components are bound to the new plugins
+    if (tracksChanged || viewsChanged) {
+        logInfo("----------- reload views -------------");
+        ViewManager::get().reloadViews(config);
+    }
+    loadedConfig = config;
+    logInfo("----------- reload done -------------");
+    return true;
+}
@@ -37,4 +37,6 @@ export const Preset = getJsonComponent<{
     fontSize?: number;
     font?: string;
     encoderId?: number;
+    morphEncoderId?: number;
+    prefetch?: number;
 }>('Preset');
@@ -3,7 +3,7 @@ This code serves as the core management system for handling physical hardware in
 
 The main purpose of this header is managing dynamic system functionality. It allows the core program to load and use specialized "controller" modules without needing to be recompiled every time a new device is supported.
 
-Two essential functions (`encoderHandler` and `keyHandler`) are defined to standardize input processing. When a physical action occurs (a knob is turned or a button is pressed), these functions capture the event and immediately pass it along to the currently displayed screen, ensuring the user interface responds instantly.
+Two essential functions (`encoderHandler` and `keyHandler`) are defined to standardize input processing. When a physical action occurs (a knob is turned or a button is pressed), these functions queue the event for the UI thread, which hands it to the currently displayed screen before its next frame, so a controller never waits for the screen to be drawn.
 
 The crucial process, `loadPluginController`, handles system expansion. This function dynamically loads an external plugin file, verifies its integrity, initializes the new controller component with a unique ID, and provides it with the standard input communication channels. This architectural design makes the system highly modular, allowing diverse hardware controllers to be swapped in or out easily while logging any errors transparently.
 
@@ -24,12 +24,12 @@ ControllerInterface* lastPluginControllerInstance = NULL;
 
 void encoderHandler(int8_t id, int8_t direction, uint32_t tick)
 {
-    ViewManager::get().view->onEncoder(id, direction, tick);
+    ViewManager::get().pushEncoder(id, direction, tick);
 }
 
 void keyHandler(uint16_t id, int key, int8_t state)
 {
-    ViewManager::get().view->onKey(id, key, state);
+    ViewManager::get().pushKey(id, key, state);
 }
 
 uint16_t controllerId = 1;
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "plugins/components/drawInterface.h"
+
+// A primitive drawn by a component, recorded to be rasterized later, see DisplayList
+struct DrawCommand {
+    enum Type : uint8_t {
+        CLEAR,
+        PIXEL,
+        FILLED_RECT,
+        LINE,
+        LINES,
+        POLYGON,
+        GLYPH,
+        SHAPE,
+        SAVE_LAYER,
+        RESTORE_LAYER,
+    } type;
+    // Rows of the screen the primitive can write, to bin it in the bands
+    int top;
+    int bottom;
+    DrawOptions options;
+    Point position;
+    // End of a line, or size of a rectangle or a layer
+    Point end;
+    Size size;
+    // Region of a layer restored, in the layer coordinates
+    Rect region;
+    // Points of the lines and polygons, in the points of the display list
+    uint32_t first;
+    uint32_t count;
+    // Glyph, shape or layer, kept by the renderer until the display list is rasterized
+    void* data;
+};
+
+// Drawing recorded during a frame and rasterized at once when it is flushed, in parallel, instead of the UI thread
+// drawing each primitive when the component asks for it:
+// - the commands are binned by the bands of `BAND_ROWS` rows they write, so a band only replays the commands
+//   touching it, clipped to its rows, in the order they were recorded.
+// - the bands are shared between `threads` workers and the UI thread, which waits for all of them. A band being a
+//   row of dirty tiles, each thread marks its own tiles.
+// - the commands, the points and the bins are kept from frame to frame, so recording does not allocate once they
+//   are large enough.
+// Only the larger screens gain from it, e.g. a desktop or HDMI layout in full HD, a small display drawing faster
+// than the workers are woken.
+class DisplayList {
+public:
+    static const int BAND_ROWS = 16;
+
+    typedef std::function<void(int top, int bottom, const std::vector<uint32_t>& commands)> Rasterize;
+
+    std::vector<DrawCommand> commands;
+    std::vector<Point> points;
+
+protected:
+    std::vector<std::vector<uint32_t>> bands;
+    int bandCount = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::condition_variable doneCv;
+    uint32_t generation = 0;
+    bool stopping = false;
+    Rasterize* job = NULL;
+    std::atomic<int> nextBand = 0;
+    int bandsDone = 0;
+    // Workers holding the job, the next one only starting once they all let it go
+    int busy = 0;
+
+    // Rasterize the bands left, return how many
+    int work(Rasterize& rasterize)
+    {
+        int done = 0;
+        for (int band = nextBand.fetch_add(1); band < bandCount; band = nextBand.fetch_add(1)) {
+            if (!bands[band].empty()) {
+                rasterize(band * BAND_ROWS, (band + 1) * BAND_ROWS, bands[band]);
+            }
+            done++;
+        }
+        return done;
+    }
+
+    void worker()
+    {
+        uint32_t seen = 0;
+        while (true) {
+            Rasterize* rasterize;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [&] { return stopping || generation != seen; });
+                if (stopping) {
+                    return;
+                }
+                seen = generation;
+                rasterize = job;
+                if (!rasterize) {
+                    continue;
+                }
+                busy++;
+            }
+            int done = work(*rasterize);
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                bandsDone += done;
+                busy--;
+                if (bandsDone == bandCount && !busy) {
+                    doneCv.notify_one();
+                }
+            }
+        }
+    }
+
+public:
+    DisplayList(int threads)
+    {
+        for (int i = 0; i < threads; i++) {
+            workers.emplace_back([this] { worker(); });
+        }
+    }
+
+    ~DisplayList()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    bool empty() { return commands.empty(); }
+
+    DrawCommand& add(DrawCommand::Type type, int top, int bottom)
+    {
+        commands.push_back({ type, top, bottom });
+        return commands.back();
+    }
+
+    // Rasterize the commands recorded for the `rows` of the screen, then start a new list
+    void rasterize(int rows, Rasterize rasterize)
+    {
+        bandCount = (rows + BAND_ROWS - 1) / BAND_ROWS;
+        if (bands.size() < (size_t)bandCount) {
+            bands.resize(bandCount);
+        }
+        for (int band = 0; band < bandCount; band++) {
+            bands[band].clear();
+        }
+        for (uint32_t i = 0; i < commands.size(); i++) {
+            DrawCommand& command = commands[i];
+            int from = std::max(command.top, 0) / BAND_ROWS;
+            int to = std::min(command.bottom, rows - 1);
+            for (int band = from; band * BAND_ROWS <= to; band++) {
+                bands[band].push_back(i);
+            }
+        }
+
+        nextBand = 0;
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            bandsDone = 0;
+            job = &rasterize;
+            generation++;
+        }
+        cv.notify_all();
+        int done = work(rasterize);
+        {
+            std::unique_lock<std::mutex> lock(mtx);
+            bandsDone += done;
+            doneCv.wait(lock, [&] { return bandsDone == bandCount && !busy; });
+            job = NULL;
+        }
+
+        commands.clear();
+        points.clear();
+    }
+};
@@ -8,25 +8,34 @@ Instead of drawing directly to a physical screen, this engine uses a large inter
 The class provides a comprehensive set of functions to create shapes and text:
 1.  **Lines and Shapes:** It can draw horizontal, vertical, and diagonal lines, handling various thicknesses. It supports complex shapes like filled and outlined rectangles (with or without rounded corners), full circles, and partial circles (arcs and pies).
 2.  **Polygons:** It can draw and fill complex, multi-sided shapes, automatically calculating which internal pixels to color in.
-3.  **Text Rendering:** It integrates font handling, allowing text to be drawn at specified sizes and positions, with alignment options (left, center, right). It also incorporates anti-aliasing techniques to ensure smooth edges on lines and text.
+3.  **Text Rendering:** It integrates font handling, allowing text to be drawn at specified sizes and positions, with alignment options (left, center, right). It also incorporates anti-aliasing techniques to ensure smooth edges on lines and text. The glyphs of the compiled fonts are rasterized once per size, so drawing text only blends their visible pixels.
 
 **Utility and Management:**
-The engine manages the current screen dimensions and calculates scaling factors, ensuring content looks correct even if the display size changes. It handles color by allowing users to specify exact values or use predefined names ("primary," "background"). It also manages transparency, blending new colors with existing ones on the buffer. This structure allows the application to queue up many drawing commands efficiently before refreshing the screen in a single update cycle.
+The engine manages the current screen dimensions and calculates scaling factors, ensuring content looks correct even if the display size changes. It handles color by allowing users to specify exact values or use predefined names ("primary," "background"). It also manages transparency, blending new colors with existing ones on the buffer. This structure allows the application to queue up many drawing commands efficiently before refreshing the screen in a single update cycle. The buffer is split in tiles, each marked as dirty when one of its pixels actually changes, so the renderers only flush the tiles changed since the last update. The filled rectangles, the glyphs and the shapes are blended span by span, a whole row being clipped once and blended 4 or 8 pixels at a time with SSE2 or NEON (see draw/span.h).
 
 sha: a2f584bdca85e7c5714fba25d6052ae9ac6d7a102ce0e9731bc3b270de454d1a 
 */
 #pragma once
 
+#include "displayList.h"
 #include "fonts/fonts.h"
+#include "glyphCache.h"
+#include "shapeCache.h"
+#include "span.h"
 #include "helpers/clamp.h"
+#include "helpers/trace.h"
 #include "log.h"
 #include "plugins/components/drawInterface.h"
 #include "plugins/components/utils/color.h"
 
+#include <algorithm>
 #include <cmath>
+#include <memory>
 #include <stdexcept>
 #include <string.h>
 #include <string>
+#include <unordered_map>
+#include <vector>
 
 // Let's make a buffer bigger than necessary so we are sure any screen size can fit
 // #define SCREEN_BUFFER_ROWS 2048
@@ -47,12 +56,301 @@ public:
 
     void setScreenSize(Size newSize)
     {
+        flushDisplayList();
         screenSize = newSize;
     }
 
 protected:
     bool needRendering = false;
 
+    GlyphCache glyphs;
+    ShapeCache shapes;
+
+    struct Layer {
+        Rect rect;
+        uint32_t version;
+        std::vector<Color> pixels;
+    };
+    std::unordered_map<void*, Layer> layers;
+
+    // Intersections of the scan line, kept between the polygons so filling them does not allocate, one buffer per
+    // thread rasterizing
+    static inline thread_local std::vector<int> polygonIntersections;
+
+    // Set with `"rasterThreads"`, the primitives are recorded and rasterized when the frame is flushed, see
+    // draw/displayList.h
+    std::unique_ptr<DisplayList> displayList;
+    // Set while a mask is recorded, drawn right away in its corner of the buffer
+    bool drawingMask = false;
+    // Shapes recorded since the display list was rasterized, the list being rasterized before the cache could drop
+    // one of them
+    uint16_t recordedShapes = 0;
+    std::vector<uint64_t> bandPixels;
+
+    // Rows drawn by the current thread, a band of the screen while a display list is rasterized, the whole buffer
+    // else
+    struct Band {
+        int top;
+        int bottom;
+        uint64_t* pixels;
+        bool rasterizing;
+    };
+    static constexpr Band WHOLE_BUFFER = { 0, SCREEN_BUFFER_ROWS, NULL, false };
+    static inline thread_local Band band = WHOLE_BUFFER;
+
+    bool recording()
+    {
+        return displayList && !band.rasterizing && !drawingMask;
+    }
+
+    void execute(DrawCommand& command)
+    {
+        switch (command.type) {
+        case DrawCommand::CLEAR:
+            Draw::clear();
+            break;
+        case DrawCommand::PIXEL:
+            Draw::pixel(command.position, command.options);
+            break;
+        case DrawCommand::FILLED_RECT:
+            Draw::filledRect(command.position, command.size, command.options);
+            break;
+        case DrawCommand::LINE:
+            Draw::line(command.position, command.end, command.options);
+            break;
+        case DrawCommand::LINES:
+            Draw::lines(&displayList->points[command.first], command.count, command.options);
+            break;
+        case DrawCommand::POLYGON:
+            Draw::filledPolygon(&displayList->points[command.first], command.count, command.options);
+            break;
+        case DrawCommand::GLYPH:
+            drawChar(command.position, *(GlyphCache::Glyph*)command.data, command.options.color);
+            break;
+        case DrawCommand::SHAPE:
+            drawShape(command.position, *(ShapeCache::Shape*)command.data, command.options.color);
+            break;
+        case DrawCommand::SAVE_LAYER:
+            copyToLayer(*(Layer*)command.data, command.position, command.size);
+            break;
+        case DrawCommand::RESTORE_LAYER:
+            copyFromLayer(*(Layer*)command.data, command.position, command.size, command.region);
+            break;
+        }
+    }
+
+    // Record the points of lines or a polygon, and the rows they cover
+    DrawCommand& recordPoints(DrawCommand::Type type, const Point* points, int count, int margin)
+    {
+        int top = points[0].y, bottom = points[0].y;
+        for (int i = 1; i < count; i++) {
+            top = std::min(top, points[i].y);
+            bottom = std::max(bottom, points[i].y);
+        }
+        DrawCommand& command = displayList->add(type, top - margin, bottom + margin);
+        command.first = displayList->points.size();
+        command.count = count;
+        displayList->points.insert(displayList->points.end(), points, points + count);
+        return command;
+    }
+
+    // Rows of the layer copied from the screen, `position` and `size` being clipped to the screen
+    void copyToLayer(Layer& layer, Point position, Size size)
+    {
+        int fromY = std::max(band.top - position.y, 0);
+        int toY = std::min(band.bottom - position.y, (int)size.h);
+        for (int y = fromY; y < toY; y++) {
+            memcpy(&layer.pixels[y * size.w], &screenBuffer[position.y + y][position.x], size.w * sizeof(Color));
+        }
+    }
+
+    // Part `region` of the layer copied back to the screen, in the layer coordinates
+    void copyFromLayer(Layer& layer, Point position, Size size, Rect region)
+    {
+        int fromX = region.position.x, toX = region.position.x + region.size.w;
+        int fromY = std::max(region.position.y, band.top - position.y);
+        int toY = std::min(region.position.y + region.size.h, band.bottom - position.y);
+        for (int y = fromY; y < toY; y++) {
+            const Color* pixels = &layer.pixels[y * size.w];
+            Color* row = &screenBuffer[position.y + y][position.x];
+            // Only the pixels actually changing need to be flushed
+            if (fromX >= toX || memcmp(row + fromX, pixels + fromX, (toX - fromX) * sizeof(Color)) == 0) {
+                continue;
+            }
+            for (int x = fromX; x < toX; x++) {
+                if (!sameColor(row[x], pixels[x])) {
+                    row[x] = pixels[x];
+                    markDirty(position.x + x, position.y + y);
+                }
+            }
+        }
+    }
+
+    // Region clipped to the screen
+    bool clipLayer(Point& position, Size& size)
+    {
+        int x = std::max(position.x, 0);
+        int y = std::max(position.y, 0);
+        size.w = std::min(position.x + size.w, (int)screenSize.w) - x;
+        size.h = std::min(position.y + size.h, (int)screenSize.h) - y;
+        position = { x, y };
+        return size.w > 0 && size.h > 0;
+    }
+
+    // Tiles of `DIRTY_TILE` pixels square changed since the last flush, one bit per tile, so the renderers only
+    // flush what changed: redrawing a component with the same content doesn't mark anything.
+    static const int DIRTY_TILE = 16;
+    static const int DIRTY_TILE_ROWS = SCREEN_BUFFER_ROWS / DIRTY_TILE;
+    static const int DIRTY_TILE_WORDS = SCREEN_BUFFER_COLS / DIRTY_TILE / 64;
+    uint64_t dirtyTiles[DIRTY_TILE_ROWS][DIRTY_TILE_WORDS] = {};
+    // Tiles flushed since the last `forEachStreamTile()`, while `keepStreamTiles` is set
+    uint64_t streamTiles[DIRTY_TILE_ROWS][DIRTY_TILE_WORDS] = {};
+
+    // Count the `pixels` changed in the tile of (x, y)
+    void markDirty(int x, int y, uint32_t pixels = 1)
+    {
+        if (band.pixels) {
+            *band.pixels += pixels;
+        } else {
+            pixelsChanged += pixels;
+        }
+        int tile = x / DIRTY_TILE;
+        dirtyTiles[y / DIRTY_TILE][tile / 64] |= (uint64_t)1 << (tile % 64);
+    }
+
+    // Mark the pixels written to `screenBuffer` without `pixel()`
+    void markDirty(Point position, Size size)
+    {
+        pixelsChanged += (uint64_t)std::max(size.w, 0) * std::max(size.h, 0);
+        int xEnd = std::min(position.x + size.w, SCREEN_BUFFER_COLS);
+        int yEnd = std::min(position.y + size.h, SCREEN_BUFFER_ROWS);
+        for (int tileY = std::max(position.y, 0) / DIRTY_TILE; tileY * DIRTY_TILE < yEnd; tileY++) {
+            for (int tileX = std::max(position.x, 0) / DIRTY_TILE; tileX * DIRTY_TILE < xEnd; tileX++) {
+                dirtyTiles[tileY][tileX / 64] |= (uint64_t)1 << (tileX % 64);
+            }
+        }
+    }
+
+    bool isDirty(int tileX, int tileY)
+    {
+        return (dirtyTiles[tileY][tileX / 64] >> (tileX % 64)) & 1;
+    }
+
+    // Call `flush(x, y, w, h)` for each run of dirty tiles on a row of tiles, clipped to the screen, and mark them
+    // clean
+    template <typename Flush>
+    void flushDirty(Flush flush)
+    {
+        int tileCols = (screenSize.w + DIRTY_TILE - 1) / DIRTY_TILE;
+        int tileRows = std::min((screenSize.h + DIRTY_TILE - 1) / DIRTY_TILE, DIRTY_TILE_ROWS);
+        for (int tileY = 0; tileY < tileRows; tileY++) {
+            int y = tileY * DIRTY_TILE;
+            int h = std::min(DIRTY_TILE, screenSize.h - y);
+            for (int tileX = 0; tileX < tileCols; tileX++) {
+                if (!isDirty(tileX, tileY)) {
+                    continue;
+                }
+                int start = tileX;
+                while (tileX + 1 < tileCols && isDirty(tileX + 1, tileY)) {
+                    tileX++;
+                }
+                int x = start * DIRTY_TILE;
+                flush(x, y, std::min((tileX + 1) * DIRTY_TILE, screenSize.w) - x, h);
+            }
+            if (keepStreamTiles) {
+                for (int word = 0; word < DIRTY_TILE_WORDS; word++) {
+                    streamTiles[tileY][word] |= dirtyTiles[tileY][word];
+                }
+            }
+            memset(dirtyTiles[tileY], 0, sizeof(dirtyTiles[tileY]));
+        }
+    }
+
+public:
+    // Set by the remote UI (see helpers/frameStreamServer.h) while a client is connected
+    bool keepStreamTiles = false;
+
+    // Pixels changed since the start, the regions written at once counting all their pixels, e.g. for the UI benchmark
+    uint64_t pixelsChanged = 0;
+
+    // Call `fn(x, y, w, h)` for each tile flushed or still dirty since the last call, every tile if `all`, clipped to
+    // the screen. The desktop renderers redraw the whole screen and never clear the dirty tiles, the remote UI compares
+    // them to the last frame it sent anyway.
+    template <typename Fn>
+    void forEachStreamTile(bool all, Fn fn)
+    {
+        int tileCols = (screenSize.w + DIRTY_TILE - 1) / DIRTY_TILE;
+        int tileRows = std::min((screenSize.h + DIRTY_TILE - 1) / DIRTY_TILE, DIRTY_TILE_ROWS);
+        for (int tileY = 0; tileY < tileRows; tileY++) {
+            for (int tileX = 0; tileX < tileCols; tileX++) {
+                uint64_t bit = (uint64_t)1 << (tileX % 64);
+                if (all || ((streamTiles[tileY][tileX / 64] | dirtyTiles[tileY][tileX / 64]) & bit)) {
+                    int x = tileX * DIRTY_TILE, y = tileY * DIRTY_TILE;
+                    fn(x, y, std::min(DIRTY_TILE, screenSize.w - x), std::min(DIRTY_TILE, screenSize.h - y));
+                }
+            }
+            memset(streamTiles[tileY], 0, sizeof(streamTiles[tileY]));
+        }
+    }
+
+protected:
+    static bool sameColor(const Color& a, const Color& b)
+    {
+        return samePixel(a, b);
+    }
+
+    // Clip the pixels `x0` to `x1` included of the row `y` to the screen and the band, false if none is left
+    bool clipSpan(int y, int& x0, int& x1)
+    {
+        if (y < std::max(band.top, 0) || y >= std::min((int)screenSize.h, band.bottom)) {
+            return false;
+        }
+        x0 = std::max(x0, 0);
+        x1 = std::min(x1, screenSize.w - 1);
+        return x0 <= x1;
+    }
+
+    // Draw `color` over the pixels `x0` to `x1` included of the row `y`, a tile at a time, so each tile changed is
+    // marked once
+    void drawSpan(int y, int x0, int x1, Color color)
+    {
+        if (!clipSpan(y, x0, x1)) {
+            return;
+        }
+        Color* row = screenBuffer[y];
+        for (int x = x0; x <= x1;) {
+            int end = std::min((x / DIRTY_TILE + 1) * DIRTY_TILE, x1 + 1);
+            int changed = color.a == 255 ? fillSpan(row + x, end - x, color) : blendSpan(row + x, end - x, color);
+            if (changed) {
+                markDirty(x, y, changed);
+            }
+            x = end;
+        }
+    }
+
+    // Blend `color` over the `count` pixels of the row `y` from `x`, `alpha(i)` giving the alpha of the pixel `i`
+    template <typename Alpha>
+    void drawMaskSpan(int y, int x, int count, Color color, Alpha alpha)
+    {
+        int x0 = x, x1 = x + count - 1;
+        if (!clipSpan(y, x0, x1)) {
+            return;
+        }
+        Color* row = screenBuffer[y];
+        uint8_t alphas[DIRTY_TILE];
+        for (int from = x0; from <= x1;) {
+            int end = std::min((from / DIRTY_TILE + 1) * DIRTY_TILE, x1 + 1);
+            for (int i = from; i < end; i++) {
+                alphas[i - from] = alpha(i - x);
+            }
+            int changed = blitAlphaMask(row + from, alphas, end - from, color);
+            if (changed) {
+                markDirty(from, y, changed);
+            }
+            from = end;
+        }
+    }
+
     void line1px(Point start, Point end, DrawOptions options = {})
     {
         if (start.x == end.x) {
@@ -75,16 +373,16 @@ protected:
         }
     }
 
-    void lines1px(std::vector<Point> points, DrawOptions options = {})
+    void lines1px(const Point* points, int count, DrawOptions options = {})
     {
-        for (int i = 0; i < points.size() - 1; i++) {
+        for (int i = 0; i < count - 1; i++) {
             line1px(points[i], points[i + 1], options);
         }
     }
 
-    void linesWithThickness(std::vector<Point> points, DrawOptions options = {})
+    void linesWithThickness(const Point* points, int count, DrawOptions options = {})
     {
-        for (int i = 0; i < points.size() - 1; i++) {
+        for (int i = 0; i < count - 1; i++) {
             lineWithThickness(points[i], points[i + 1], options);
         }
     }
@@ -129,9 +427,7 @@ protected:
             x = end.x;
             len = start.x;
         }
-        for (; x <= len; x++) {
-            pixel({ x, start.y }, options);
-        }
+        drawSpan(start.y, x, len, options.color);
     }
 
     void lineDiagonal(Point start, Point end, DrawOptions options = {})
@@ -293,7 +589,90 @@ protected:
         return width * scale;
     }
 
-    int getTextWidth(std::string text, const uint8_t** font, int spacing)
+    // Blend the pixels of a rasterized glyph, span by span
+    int drawChar(Point pos, GlyphCache::Glyph& glyph, Color color)
+    {
+        if (recording()) {
+            if (!glyph.spans.empty()) {
+                DrawCommand& command = displayList->add(DrawCommand::GLYPH, pos.y + glyph.spans.front().y, pos.y + glyph.spans.back().y);
+                command.position = pos;
+                command.options.color = color;
+                command.data = &glyph;
+            }
+            return glyph.advance;
+        }
+        for (GlyphCache::Span& span : glyph.spans) {
+            const uint16_t* coverage = glyph.coverage.data() + span.offset;
+            drawMaskSpan(pos.y + span.y, pos.x + span.x, span.len, color,
+                [&](int i) { return (uint8_t)std::min(coverage[i] * color.a / 255, 255); });
+        }
+        return glyph.advance;
+    }
+
+    // Blend the pixels of a rasterized shape centered on `pos`, span by span
+    void drawShape(Point pos, ShapeCache::Shape& shape, Color color)
+    {
+        if (recording()) {
+            if (!shape.spans.empty()) {
+                DrawCommand& command = displayList->add(DrawCommand::SHAPE, pos.y + shape.spans.front().y, pos.y + shape.spans.back().y);
+                command.position = pos;
+                command.options.color = color;
+                command.data = &shape;
+                if (++recordedShapes >= ShapeCache::MAX_SHAPES / 2) {
+                    flushDisplayList();
+                }
+            }
+            return;
+        }
+        for (ShapeCache::Span& span : shape.spans) {
+            const uint16_t* coverage = shape.coverage.data() + span.offset;
+            drawMaskSpan(pos.y + span.y, pos.x + span.x, span.len, color,
+                [&](int i) { return (uint8_t)((coverage[i] * color.a) >> 8); });
+        }
+    }
+
+    // Mask of what `render` draws within `bounds`, recorded in a corner of the buffer out of the screen, in white over
+    // black, so the red of each pixel is its coverage, the same as if it was drawn in any other color. NULL if the
+    // corner is on the screen.
+    ShapeCache::Shape* recordMask(uint64_t key, Rect bounds, std::function<void(Point, Color)>& render)
+    {
+        int x0 = SCREEN_BUFFER_COLS - bounds.size.w;
+        int y0 = SCREEN_BUFFER_ROWS - bounds.size.h;
+        if (x0 < 0 || y0 < 0 || (x0 < screenSize.w && y0 < screenSize.h)) {
+            return NULL;
+        }
+        for (int y = y0; y < SCREEN_BUFFER_ROWS; y++) {
+            std::fill(screenBuffer[y] + x0, screenBuffer[y] + SCREEN_BUFFER_COLS, Color { 0, 0, 0, 255 });
+        }
+        Size visible = screenSize;
+        screenSize = { SCREEN_BUFFER_COLS, SCREEN_BUFFER_ROWS };
+        Point origin = { x0 - bounds.position.x, y0 - bounds.position.y };
+        drawingMask = true;
+        render(origin, { 255, 255, 255, 255 });
+        drawingMask = false;
+        screenSize = visible;
+
+        ShapeCache::Shape& shape = shapes.addMask(key);
+        for (int y = y0; y < SCREEN_BUFFER_ROWS; y++) {
+            ShapeCache::Span* span = NULL;
+            for (int x = x0; x < SCREEN_BUFFER_COLS; x++) {
+                uint8_t r = screenBuffer[y][x].r;
+                if (!r) {
+                    span = NULL;
+                    continue;
+                }
+                if (!span) {
+                    shape.spans.push_back({ (int16_t)(x - origin.x), (int16_t)(y - origin.y), 0, (uint32_t)shape.coverage.size() });
+                    span = &shape.spans.back();
+                }
+                span->len++;
+                shape.coverage.push_back(r + (r >> 7));
+            }
+        }
+        return &shape;
+    }
+
+    int getTextWidth(const std::string& text, const uint8_t** font, int spacing)
     {
         int width = 0;
         for (uint16_t i = 0; i < text.length(); i++) {
@@ -349,6 +728,35 @@ public:
     {
     }
 
+    // Rasterize the primitives recorded since the last time, before the dirty tiles are flushed
+    void flushDisplayList()
+    {
+        if (!displayList || displayList->empty()) {
+            return;
+        }
+        TraceSpan span("raster");
+        static_assert(DisplayList::BAND_ROWS == DIRTY_TILE, "A band of the display list must be a row of dirty tiles");
+        bandPixels.assign((screenSize.h + DisplayList::BAND_ROWS - 1) / DisplayList::BAND_ROWS, 0);
+        displayList->rasterize(screenSize.h, [this](int top, int bottom, const std::vector<uint32_t>& commands) {
+            band = { top, bottom, &bandPixels[top / DisplayList::BAND_ROWS], true };
+            for (uint32_t index : commands) {
+                execute(displayList->commands[index]);
+            }
+            band = WHOLE_BUFFER;
+        });
+        for (uint64_t pixels : bandPixels) {
+            pixelsChanged += pixels;
+        }
+        recordedShapes = 0;
+    }
+
+    // Record the drawing in a display list rasterized by `threads` workers and the UI thread, or draw right away if 0
+    void setRasterThreads(int threads)
+    {
+        flushDisplayList();
+        displayList.reset(threads > 0 ? new DisplayList(threads) : NULL);
+    }
+
     void init() override
     {
         logWarn("Initializing draw without Renderer");
@@ -361,7 +769,9 @@ public:
 
     void triggerRendering() override
     {
+        flushDisplayList();
         if (needRendering) {
+            TraceSpan span("flush");
             render();
             needRendering = false;
         }
@@ -375,23 +785,114 @@ public:
 
     void clear() override
     {
+        if (recording()) {
+            displayList->add(DrawCommand::CLEAR, 0, screenSize.h - 1);
+            return;
+        }
         // Init buffer with background color
         // Buffer is [row][col] = [y][x], so iterate y (height) then x (width)
-        for (int y = 0; y < screenSize.h; y++) {
+        for (int y = std::max(band.top, 0); y < std::min((int)screenSize.h, band.bottom); y++) {
             for (int x = 0; x < screenSize.w; x++) {
-                screenBuffer[y][x] = styles.colors.background;
+                if (!sameColor(screenBuffer[y][x], styles.colors.background)) {
+                    screenBuffer[y][x] = styles.colors.background;
+                    markDirty(x, y);
+                }
             }
         }
     }
 
     void fullClear()
     {
+        flushDisplayList();
         // Init buffer with background color
         for (int i = 0; i < SCREEN_BUFFER_ROWS; i++) { // here we can do the whole buffer even if it is out of bound
             for (int j = 0; j < SCREEN_BUFFER_COLS; j++) {
                 screenBuffer[i][j] = styles.colors.background;
             }
         }
+        markDirty({ 0, 0 }, { SCREEN_BUFFER_COLS, SCREEN_BUFFER_ROWS });
+    }
+
+    void saveLayer(void* owner, Point position, Size size, uint32_t version = 0) override
+    {
+        Layer& layer = layers[owner];
+        layer.rect = { position, size };
+        layer.version = version;
+        if (!clipLayer(position, size)) {
+            layer.pixels.clear();
+            return;
+        }
+        // Kept if the size is the same, a restore recorded before in the display list still reading them
+        layer.pixels.resize(size.w * size.h);
+        if (recording()) {
+            DrawCommand& command = displayList->add(DrawCommand::SAVE_LAYER, position.y, position.y + size.h - 1);
+            command.position = position;
+            command.size = size;
+            command.data = &layer;
+            return;
+        }
+        copyToLayer(layer, position, size);
+    }
+
+    bool restoreLayer(void* owner, Point position, Size size, uint32_t version = 0, Rect* region = NULL) override
+    {
+        auto it = layers.find(owner);
+        if (it == layers.end()) {
+            return false;
+        }
+        Layer& layer = it->second;
+        if (layer.version != version || layer.rect.position.x != position.x || layer.rect.position.y != position.y
+            || layer.rect.size.w != size.w || layer.rect.size.h != size.h) {
+            return false;
+        }
+        if (!clipLayer(position, size)) {
+            return true;
+        }
+        // Saved for another screen size, e.g. before a resize
+        if (layer.pixels.size() != (size_t)(size.w * size.h)) {
+            return false;
+        }
+        // Part of the layer restored, in the layer coordinates
+        int fromX = 0, fromY = 0, toX = size.w, toY = size.h;
+        if (region) {
+            fromX = std::max(region->position.x - position.x, 0);
+            fromY = std::max(region->position.y - position.y, 0);
+            toX = std::min(region->position.x + region->size.w - position.x, (int)size.w);
+            toY = std::min(region->position.y + region->size.h - position.y, (int)size.h);
+        }
+        Rect part = { { fromX, fromY }, { toX - fromX, toY - fromY } };
+        if (recording()) {
+            if (part.size.w > 0 && part.size.h > 0) {
+                DrawCommand& command = displayList->add(DrawCommand::RESTORE_LAYER, position.y + fromY, position.y + toY - 1);
+                command.position = position;
+                command.size = size;
+                command.region = part;
+                command.data = &layer;
+            }
+            return true;
+        }
+        copyFromLayer(layer, position, size, part);
+        return true;
+    }
+
+    void releaseLayer(void* owner) override
+    {
+        // Not while a command recorded still uses it
+        flushDisplayList();
+        layers.erase(owner);
+    }
+
+    void drawMask(uint64_t key, Point position, Rect bounds, Color color, std::function<void(Point, Color)> render) override
+    {
+        ShapeCache::Shape* shape = shapes.findMask(key);
+        if (!shape) {
+            shape = recordMask(key, bounds, render);
+        }
+        if (shape) {
+            drawShape(position, *shape, color);
+        } else {
+            render(position, color);
+        }
     }
 
     void* getFont(std::string name = NULL, int size = -1) override
@@ -418,7 +919,7 @@ public:
         if (options.font) {
             return (const uint8_t**)((Font*)options.font)->data;
         }
-        return (const uint8_t**)DEFAULT_FONT.data;
+        return (const uint8_t**)getDefaultFont()->data;
     }
 
     int text(Point position, std::string text, uint32_t size, DrawTextOptions options = {}) override
@@ -446,15 +947,11 @@ public:
         int heightRatio = options.fontHeight == 0 ? 1 : (options.fontHeight / height);
         int y = position.y;
         for (uint16_t i = 0; i < len && x < maxX; i++) {
-            char c = text[i];
-            const uint8_t* charPtr = font[1 + (c - ' ')]; // Get the glyph data for the character
-            uint8_t width = charPtr[0];
-            uint8_t marginTop = charPtr[1] * scale;
-            uint8_t rows = charPtr[2];
-            if (x + width * scale > maxX) {
+            GlyphCache::Glyph& glyph = glyphs.get(font, size, text[i]);
+            if (x + glyph.width > maxX) {
                 break;
             }
-            x += drawChar({ (int)x, y }, (uint8_t*)charPtr + 3, width, marginTop, rows, options.color, scale) + options.fontSpacing;
+            x += drawChar({ (int)x, y }, glyph, options.color) + options.fontSpacing;
         }
         return x;
     }
@@ -496,12 +993,7 @@ public:
         // How to handle maxWidth?
 
         for (uint16_t i = 0; i < len; i++) {
-            char c = text[i];
-            const uint8_t* charPtr = font[1 + (c - ' ')]; // Get the glyph data for the character
-            uint8_t width = charPtr[0];
-            uint8_t marginTop = charPtr[1] * scale;
-            uint8_t rows = charPtr[2];
-            x += drawChar({ (int)x, y }, (uint8_t*)charPtr + 3, width, marginTop, rows, options.color, scale) + options.fontSpacing;
+            x += drawChar({ (int)x, y }, glyphs.get(font, size, text[i]), options.color) + options.fontSpacing;
         }
         return x;
     }
@@ -536,13 +1028,9 @@ public:
         int y = position.y;
 
         for (uint16_t i = 0; i < len; i++) {
-            char c = text[len - i - 1];
-            const uint8_t* charPtr = font[1 + (c - ' ')]; // Get the glyph data for the character
-            uint8_t width = charPtr[0];
-            uint8_t marginTop = charPtr[1] * scale;
-            uint8_t rows = charPtr[2];
-            x -= width * scale;
-            drawChar({ (int)x, y }, (uint8_t*)charPtr + 3, width, marginTop, rows, options.color, scale);
+            GlyphCache::Glyph& glyph = glyphs.get(font, size, text[len - i - 1]);
+            x -= glyph.width;
+            drawChar({ (int)x, y }, glyph, options.color);
             x -= options.fontSpacing;
         }
 
@@ -565,8 +1053,15 @@ public:
 
     void filledRect(Point position, Size size, DrawOptions options = {}) override
     {
-        for (int y = position.y; y < position.y + size.h; y++) {
-            lineHorizontal1px({ position.x, y }, { position.x + size.w, y }, options);
+        if (recording()) {
+            DrawCommand& command = displayList->add(DrawCommand::FILLED_RECT, position.y, position.y + size.h - 1);
+            command.position = position;
+            command.size = size;
+            command.options = options;
+            return;
+        }
+        for (int y = std::max(position.y, band.top); y < std::min(position.y + size.h, band.bottom); y++) {
+            drawSpan(y, position.x, position.x + size.w, options.color);
         }
     }
 
@@ -608,104 +1103,13 @@ public:
 
     void filledPie(Point position, int radius, int startAngle, int endAngle, DrawOptions options = {}) override
     {
-        int xi, yi;
-        double s, v, x, y, dx, dy;
-
         // Normalize angles to range [0, 360)
         startAngle = (startAngle % 360 + 360) % 360;
         endAngle = (endAngle % 360 + 360) % 360;
+        drawShape(position, shapes.filledPie(radius, startAngle, endAngle), options.color);
 
-        // Convert angles to radians for comparison
         double startRad = startAngle * M_PI / 180.0;
         double endRad = endAngle * M_PI / 180.0;
-
-        // Ensure angles are in counterclockwise order
-        bool wrapAround = (endRad < startRad);
-
-        int n = radius + 1;
-        for (yi = position.y - n - 1; yi <= position.y + n + 1; yi++) {
-            if (yi < (position.y - 0.5))
-                y = yi;
-            else
-                y = yi + 1;
-            s = (y - position.y) / radius;
-            s = s * s;
-            x = 0.5;
-            if (s < 1.0) {
-                x = radius * sqrt(1.0 - s);
-                if (x >= 0.5) {
-                    // Draw only the visible part of the pie within the angle range
-                    for (xi = (int)(position.x - x + 1); xi <= (int)(position.x + x - 1); xi++) {
-                        // Convert (xi, yi) to polar coordinates (r, theta)
-                        double dx = xi - position.x;
-                        double dy = yi - position.y;
-                        double angle = atan2(dy, dx);
-                        if (angle < 0)
-                            angle += 2 * M_PI; // Normalize to [0, 2π]
-
-                        // Check if angle is within the start and end angles
-                        if ((wrapAround && (angle >= startRad || angle <= endRad)) || (!wrapAround && angle >= startRad && angle <= endRad)) {
-                            pixel({ xi, yi }, { options.color });
-                        }
-                    }
-                }
-            }
-            s = 8 * radius * radius;
-            dy = fabs(y - position.y) - 1.0;
-            xi = position.x - x; // left
-            while (1) {
-                dx = (position.x - xi - 1);
-                v = s - 4 * (dx - dy) * (dx - dy);
-                if (v < 0)
-                    break;
-                v = (sqrt(v) - 2 * (dx + dy)) / 4;
-                if (v < 0)
-                    break;
-                if (v > 1.0)
-                    v = 1.0;
-
-                // Convert (xi, yi) to polar coordinates (r, theta)
-                double dx = xi - position.x;
-                double dy = yi - position.y;
-                double angle = atan2(dy, dx);
-                if (angle < 0)
-                    angle += 2 * M_PI; // Normalize to [0, 2π]
-
-                // Check if angle is within the start and end angles
-                if ((wrapAround && (angle >= startRad || angle <= endRad)) || (!wrapAround && angle >= startRad && angle <= endRad)) {
-                    pixel({ xi, yi }, { { options.color.r, options.color.g, options.color.b, (uint8_t)(options.color.a * v) } });
-                }
-
-                xi -= 1;
-            }
-            xi = position.x + x; // right
-            while (1) {
-                dx = (xi - position.x);
-                v = s - 4 * (dx - dy) * (dx - dy);
-                if (v < 0)
-                    break;
-                v = (sqrt(v) - 2 * (dx + dy)) / 4;
-                if (v < 0)
-                    break;
-                if (v > 1.0)
-                    v = 1.0;
-
-                // Convert (xi, yi) to polar coordinates (r, theta)
-                double dx = xi - position.x;
-                double dy = yi - position.y;
-                double angle = atan2(dy, dx);
-                if (angle < 0)
-                    angle += 2 * M_PI; // Normalize to [0, 2π]
-
-                // Check if angle is within the start and end angles
-                if ((wrapAround && (angle >= startRad || angle <= endRad)) || (!wrapAround && angle >= startRad && angle <= endRad)) {
-                    pixel({ xi, yi }, { { options.color.r, options.color.g, options.color.b, (uint8_t)(options.color.a * v) } });
-                }
-
-                xi += 1;
-            }
-        }
-
         // Draw smooth radius lines for the start and end angles
         int r = radius - 1;
         int startX = position.x + (int)(r * cos(startRad));
@@ -718,147 +1122,10 @@ public:
 
     void arc(Point position, int radius, int startAngle, int endAngle, DrawOptions options = {}) override
     {
-        int xi, yi;
-        double s, v, x, y, dx, dy;
-
         // Normalize angles to range [0, 360)
         startAngle = (startAngle % 360 + 360) % 360;
         endAngle = (endAngle % 360 + 360) % 360;
-
-        // Convert angles to radians
-        double startRad = startAngle * M_PI / 180.0;
-        double endRad = endAngle * M_PI / 180.0;
-
-        // Handle angle wrapping
-        bool wrapAround = (endRad < startRad);
-
-        // Calculate inner and outer radii
-        double innerRadius = radius - options.thickness / 2.0;
-        double outerRadius = radius + options.thickness / 2.0;
-
-        int n = outerRadius + 1;
-        for (yi = position.y - n - 1; yi <= position.y + n + 1; yi++) {
-            if (yi < (position.y - 0.5))
-                y = yi;
-            else
-                y = yi + 1;
-            s = (y - position.y) / outerRadius;
-            s = s * s;
-            x = 0.5;
-            if (s < 1.0) {
-                x = outerRadius * sqrt(1.0 - s);
-                if (x >= 0.5) {
-                    for (xi = (int)(position.x - x + 1); xi <= (int)(position.x + x - 1); xi++) {
-                        // Calculate distance to the center
-                        double dx = xi - position.x;
-                        double dy = yi - position.y;
-                        double distance = sqrt(dx * dx + dy * dy);
-
-                        // Determine if within the angle and thickness range
-                        if (distance >= innerRadius && distance <= outerRadius) {
-                            // Convert (xi, yi) to polar coordinates
-                            double angle = atan2(dy, dx);
-                            if (angle < 0)
-                                angle += 2 * M_PI; // Normalize to [0, 2π]
-
-                            // Check angle constraints
-                            if ((wrapAround && (angle >= startRad || angle <= endRad)) || (!wrapAround && angle >= startRad && angle <= endRad)) {
-                                // Anti-aliasing based on distance to inner and outer radii
-                                double alpha = 1.0;
-                                if (distance < innerRadius + 1.0) {
-                                    alpha = distance - innerRadius;
-                                } else if (distance > outerRadius - 1.0) {
-                                    alpha = outerRadius - distance;
-                                }
-                                if (alpha > 0) {
-                                    pixel({ xi, yi }, { { options.color.r, options.color.g, options.color.b, (uint8_t)(options.color.a * alpha) } });
-                                }
-                            }
-                        }
-                    }
-                }
-            }
-            s = 8 * outerRadius * outerRadius;
-            dy = fabs(y - position.y) - 1.0;
-            xi = position.x - x; // left
-            while (1) {
-                dx = (position.x - xi - 1);
-                v = s - 4 * (dx - dy) * (dx - dy);
-                if (v < 0)
-                    break;
-                v = (sqrt(v) - 2 * (dx + dy)) / 4;
-                if (v < 0)
-                    break;
-                if (v > 1.0)
-                    v = 1.0;
-
-                // Calculate distance to the center
-                double dx = xi - position.x;
-                double dy = yi - position.y;
-                double distance = sqrt(dx * dx + dy * dy);
-
-                // Determine if within the angle and thickness range
-                if (distance >= innerRadius && distance <= outerRadius) {
-                    double angle = atan2(dy, dx);
-                    if (angle < 0)
-                        angle += 2 * M_PI; // Normalize to [0, 2π]
-
-                    // Check angle constraints
-                    if ((wrapAround && (angle >= startRad || angle <= endRad)) || (!wrapAround && angle >= startRad && angle <= endRad)) {
-                        double alpha = 1.0;
-                        if (distance < innerRadius + 1.0) {
-                            alpha = distance - innerRadius;
-                        } else if (distance > outerRadius - 1.0) {
-                            alpha = outerRadius - distance;
-                        }
-                        if (alpha > 0) {
-                            pixel({ xi, yi }, { { options.color.r, options.color.g, options.color.b, (uint8_t)(options.color.a * v * alpha) } });
-                        }
-                    }
-                }
-
-                xi -= 1;
-            }
-            xi = position.x + x; // right
-            while (1) {
-                dx = (xi - position.x);
-                v = s - 4 * (dx - dy) * (dx - dy);
-                if (v < 0)
-                    break;
-                v = (sqrt(v) - 2 * (dx + dy)) / 4;
-                if (v < 0)
-                    break;
-                if (v > 1.0)
-                    v = 1.0;
-
-                // Calculate distance to the center
-                double dx = xi - position.x;
-                double dy = yi - position.y;
-                double distance = sqrt(dx * dx + dy * dy);
-
-                // Determine if within the angle and thickness range
-                if (distance >= innerRadius && distance <= outerRadius) {
-                    double angle = atan2(dy, dx);
-                    if (angle < 0)
-                        angle += 2 * M_PI; // Normalize to [0, 2π]
-
-                    // Check angle constraints
-                    if ((wrapAround && (angle >= startRad || angle <= endRad)) || (!wrapAround && angle >= startRad && angle <= endRad)) {
-                        double alpha = 1.0;
-                        if (distance < innerRadius + 1.0) {
-                            alpha = distance - innerRadius;
-                        } else if (distance > outerRadius - 1.0) {
-                            alpha = outerRadius - distance;
-                        }
-                        if (alpha > 0) {
-                            pixel({ xi, yi }, { { options.color.r, options.color.g, options.color.b, (uint8_t)(options.color.a * v * alpha) } });
-                        }
-                    }
-                }
-
-                xi += 1;
-            }
-        }
+        drawShape(position, shapes.arc(radius, options.thickness, startAngle, endAngle), options.color);
     }
 
     void circle(Point position, int radius, DrawOptions options = {}) override
@@ -868,59 +1135,20 @@ public:
 
     void filledCircle(Point position, int radius, DrawOptions options = {})
     {
-        int xi, yi;
-        double s, v, x, y, dx, dy;
-
-        int n = radius + 1;
-        for (yi = position.y - n - 1; yi <= position.y + n + 1; yi++) {
-            if (yi < (position.y - 0.5))
-                y = yi;
-            else
-                y = yi + 1;
-            s = (y - position.y) / radius;
-            s = s * s;
-            x = 0.5;
-            if (s < 1.0) {
-                x = radius * sqrt(1.0 - s);
-                if (x >= 0.5) {
-                    line1px({ (int)(position.x - x + 1), yi }, { (int)(position.x + x - 1), yi }, options);
-                }
-            }
-            s = 8 * radius * radius;
-            dy = fabs(y - position.y) - 1.0;
-            xi = position.x - x; // left
-            while (1) {
-                dx = (position.x - xi - 1);
-                v = s - 4 * (dx - dy) * (dx - dy);
-                if (v < 0)
-                    break;
-                v = (sqrt(v) - 2 * (dx + dy)) / 4;
-                if (v < 0)
-                    break;
-                if (v > 1.0)
-                    v = 1.0;
-                pixel({ xi, yi }, { { options.color.r, options.color.g, options.color.b, (uint8_t)(options.color.a * v) } });
-                xi -= 1;
-            }
-            xi = position.x + x; // right
-            while (1) {
-                dx = (xi - position.x);
-                v = s - 4 * (dx - dy) * (dx - dy);
-                if (v < 0)
-                    break;
-                v = (sqrt(v) - 2 * (dx + dy)) / 4;
-                if (v < 0)
-                    break;
-                if (v > 1.0)
-                    v = 1.0;
-                pixel({ xi, yi }, { { options.color.r, options.color.g, options.color.b, (uint8_t)(options.color.a * v) } });
-                xi += 1;
-            }
-        }
+        drawShape(position, shapes.filledCircle(radius), options.color);
     }
 
     void line(Point start, Point end, DrawOptions options = {}) override
     {
+        if (recording()) {
+            // The anti-aliased lines write the row below
+            int margin = options.thickness + 1;
+            DrawCommand& command = displayList->add(DrawCommand::LINE, std::min(start.y, end.y) - margin, std::max(start.y, end.y) + margin);
+            command.position = start;
+            command.end = end;
+            command.options = options;
+            return;
+        }
         if (options.thickness == 1) {
             line1px(start, end, options);
         } else {
@@ -928,38 +1156,53 @@ public:
         }
     }
 
-    void lines(std::vector<Point> points, DrawOptions options = {}) override
+    using DrawInterface::filledPolygon;
+    using DrawInterface::lines;
+
+    void lines(const Point* points, int count, DrawOptions options = {}) override
     {
+        if (recording()) {
+            if (count > 1) {
+                recordPoints(DrawCommand::LINES, points, count, options.thickness + 1).options = options;
+            }
+            return;
+        }
         if (options.thickness == 1) {
-            lines1px(points, options);
+            lines1px(points, count, options);
         } else {
-            linesWithThickness(points, options);
+            linesWithThickness(points, count, options);
         }
     }
 
-    void filledPolygon(std::vector<Point> points, DrawOptions options = {}) override
+    void filledPolygon(const Point* points, int count, DrawOptions options = {}) override
     {
-        if (points.size() < 3)
+        if (count < 3)
             return; // A polygon must have at least 3 points
 
-        lines1px(points, options);
-        line1px(points[0], points[points.size() - 1], options);
+        if (recording()) {
+            recordPoints(DrawCommand::POLYGON, points, count, 1).options = options;
+            return;
+        }
+
+        lines1px(points, count, options);
+        line1px(points[0], points[count - 1], options);
 
         // Compute the bounding box of the polygon
         int minY = points[0].y, maxY = points[0].y;
-        for (const auto& p : points) {
-            minY = std::min(minY, p.y);
-            maxY = std::max(maxY, p.y);
+        for (int i = 0; i < count; i++) {
+            minY = std::min(minY, points[i].y);
+            maxY = std::max(maxY, points[i].y);
         }
 
         // Use a scan-line approach to fill the polygon
+        std::vector<int>& intersections = polygonIntersections;
         for (int y = minY; y <= maxY; ++y) {
-            std::vector<int> intersections;
+            intersections.clear();
 
             // Find intersections of the polygon with the current scan line
-            for (size_t i = 0; i < points.size(); ++i) {
+            for (int i = 0; i < count; ++i) {
                 Point p1 = points[i];
-                Point p2 = points[(i + 1) % points.size()]; // Wrap around to the first point
+                Point p2 = points[(i + 1) % count]; // Wrap around to the first point
 
                 // Check if the scan line crosses the edge
                 if ((p1.y <= y && p2.y > y) || (p2.y <= y && p1.y > y)) {
@@ -989,14 +1232,25 @@ public:
 
     void pixel(Point position, DrawOptions options = {}) override
     {
-        if (position.x < 0 || position.x >= screenSize.w || position.y < 0 || position.y >= screenSize.h) {
+        if (recording()) {
+            DrawCommand& command = displayList->add(DrawCommand::PIXEL, position.y, position.y);
+            command.position = position;
+            command.options = options;
             return;
         }
-        if (options.color.a != 255) {
-            screenBuffer[position.y][position.x] = applyAlphaColor(screenBuffer[position.y][position.x], options.color);
-            screenBuffer[position.y][position.x].a = 255;
-        } else {
-            screenBuffer[position.y][position.x] = options.color;
+        if (position.x < 0 || position.x >= screenSize.w || position.y < 0 || position.y >= screenSize.h
+            || position.y < band.top || position.y >= band.bottom) {
+            return;
+        }
+        Color& current = screenBuffer[position.y][position.x];
+        Color color = options.color;
+        if (color.a != 255) {
+            color = blendPixel(current, color, color.a);
+        }
+        // Only the pixels actually changing need to be flushed
+        if (!sameColor(current, color)) {
+            current = color;
+            markDirty(position.x, position.y);
         }
     }
 
@@ -1026,6 +1280,9 @@ public:
 
     void config(nlohmann::json& config) override
     {
+        // The masks recorded with the previous theme are dropped, e.g. for another screen size
+        flushDisplayList();
+        shapes.clearMasks();
         try {
             if (config.contains("colors") && config["colors"].is_array()) {
                 for (auto& color : config["colors"]) {
@@ -1039,6 +1296,12 @@ public:
                     }
                 }
             }
+            // Number of threads rasterizing the frames with the UI thread, the drawing of the components being recorded
+            // in a display list first, e.g. `"rasterThreads": 3` for a full HD screen on a 4 cores CPU. Default is 0,
+            // the UI thread drawing each primitive right away.
+            if (config.contains("rasterThreads")) {
+                setRasterThreads(config["rasterThreads"].get<int>());
+            }
             if (config.contains("screenSize")) {
                 styles.screen.w = config["screenSize"]["width"].get<int>();
                 styles.screen.h = config["screenSize"]["height"].get<int>();
@@ -0,0 +1,30 @@
+#pragma once
+
+#include "./draw.h"
+
+// Renderer without display, e.g. for the UI benchmark: the frames are drawn in the buffer as usual, and flushing
+// them only counts the bytes a display would have been sent, `bytesPerPixel` per pixel of the dirty tiles (2 for the
+// RGB565 of the framebuffer and the ST7789).
+class DrawNull : public Draw {
+public:
+    uint8_t bytesPerPixel = 2;
+    uint64_t bytesFlushed = 0;
+    uint32_t flushes = 0;
+
+    DrawNull(Styles& styles)
+        : Draw(styles)
+    {
+    }
+
+    void init() override
+    {
+    }
+
+    void render() override
+    {
+        flushDirty([&](int x, int y, int w, int h) {
+            bytesFlushed += (uint64_t)w * h * bytesPerPixel;
+        });
+        flushes++;
+    }
+};
@@ -6,7 +6,7 @@ This C++ class, `DrawWithFB`, is a specialized tool designed for low-level graph
 The core mechanism involves accessing the Linux **Framebuffer** device. The framebuffer is the designated region of memory that holds the picture currently displayed on the screen.
 
 1.  **Initialization:** The class starts by opening the connection to the physical screen hardware, typically found at a system location like `/dev/fb0`. It queries the system to determine crucial details, such as the screen’s exact resolution and how many bits are used for each color pixel. Most importantly, it uses a technique called *memory mapping* to create a direct, shared link between the program's internal variables and the physical memory of the display hardware.
-2.  **Drawing:** The class holds the image data it wants to display in an internal buffer. The `render` function then efficiently copies this internal image data straight into the linked framebuffer memory. This instant transfer bypasses typical operating system overhead, resulting in very fast updates. The system also handles the necessary translation of standard colors into the specific color format required by the screen hardware.
+2.  **Drawing:** The class holds the image data it wants to display in an internal buffer. The `render` function then efficiently copies this internal image data straight into the linked framebuffer memory, only the tiles changed since the last render, row by row, converted to the 16 bits colors of the screen 8 pixels at a time. When the framebuffer has room for two pages, it writes the page not displayed and flips to it on the vertical sync, so the screen never shows a half drawn frame. This instant transfer bypasses typical operating system overhead, resulting in very fast updates. The system also handles the necessary translation of standard colors into the specific color format required by the screen hardware.
 3.  **Cleanup:** When the drawing operations are complete and the program closes, it safely disconnects the direct memory link and closes the hardware connection, ensuring system stability.
 
 In summary, this class offers a fast, direct-access method for rendering graphics, making it suitable for specialized or embedded applications where performance and minimal software layers are essential.
@@ -19,6 +19,7 @@ sha: 20d443dd0a4ca2e54ada04a895b44a7504830822308fdfe7ee180928595a78cb
 // sudo sh -c 'setterm --cursor off --blank force --clear > /dev/tty1'
 
 #include "./draw.h"
+#include "./rgb565.h"
 
 #include <fcntl.h>
 #include <linux/fb.h>
@@ -28,6 +29,7 @@ sha: 20d443dd0a4ca2e54ada04a895b44a7504830822308fdfe7ee180928595a78cb
 #include <sys/ioctl.h>
 #include <sys/mman.h>
 #include <unistd.h>
+#include <vector>
 
 #include <arpa/inet.h> // htons
 
@@ -41,6 +43,49 @@ protected:
     int width = 0;
     int height = 0;
 
+    // Double buffering: the page displayed, 0 or 1, and the runs of tiles flushed to it, the other page missing them
+    int pages = 1;
+    int displayedPage = 0;
+    struct Run {
+        int x, y, w, h;
+    };
+    std::vector<Run> previousRuns;
+    std::vector<Run> runs;
+
+    void write(uint8_t* page, Run& run)
+    {
+        int w = std::min(run.w, width - run.x);
+        int h = std::min(run.h, height - run.y);
+        for (int row = run.y; row < run.y + h; row++) {
+            toRgb565(&screenBuffer[row][run.x], (uint16_t*)(page + row * finfo.line_length) + run.x, w);
+        }
+    }
+
+    // Two pages in the virtual resolution, to draw one while the other is displayed
+    void initPages()
+    {
+        if (vinfo.yres_virtual < vinfo.yres * 2) {
+            struct fb_var_screeninfo wanted = vinfo;
+            wanted.yres_virtual = vinfo.yres * 2;
+            wanted.yoffset = 0;
+            if (ioctl(fb, FBIOPUT_VSCREENINFO, &wanted) == 0) {
+                ioctl(fb, FBIOGET_VSCREENINFO, &vinfo);
+                ioctl(fb, FBIOGET_FSCREENINFO, &finfo);
+            }
+        }
+        pages = vinfo.yres_virtual >= vinfo.yres * 2 ? 2 : 1;
+        displayedPage = vinfo.yoffset >= vinfo.yres && pages == 2 ? 1 : 0;
+    }
+
+    bool flip(int page)
+    {
+        uint32_t screen = 0;
+        // Not all drivers support waiting, panning still avoids most of the tearing then
+        ioctl(fb, FBIO_WAITFORVSYNC, &screen);
+        vinfo.yoffset = page * vinfo.yres;
+        return ioctl(fb, FBIOPAN_DISPLAY, &vinfo) == 0;
+    }
+
 public:
     DrawWithFB(Styles& styles)
         : Draw(styles)
@@ -70,6 +115,7 @@ public:
 
         ioctl(fb, FBIOGET_FSCREENINFO, &finfo);
         ioctl(fb, FBIOGET_VSCREENINFO, &vinfo);
+        initPages();
 
         screensize = vinfo.yres_virtual * finfo.line_length;
 
@@ -83,20 +129,46 @@ public:
         width = vinfo.xres < styles.screen.w ? vinfo.xres : styles.screen.w;
         height = vinfo.yres < styles.screen.h ? vinfo.yres : styles.screen.h;
 
-        logDebug("Framebuffer size: %dx%d buffer size: %dx%d", vinfo.xres, vinfo.yres, width, height);
+        logDebug("Framebuffer size: %dx%d buffer size: %dx%d pages: %d", vinfo.xres, vinfo.yres, width, height, pages);
     }
 
     void render() override
     {
-        for (int y = 0; y < height; y++) {
-            for (int x = 0; x < width; x++) {
-                int location = y * finfo.line_length + x * (vinfo.bits_per_pixel / 8);
-
-                Color color = screenBuffer[y][x];
-                uint16_t rgb565 = ((color.r & 0xF8) << 8) | ((color.g & 0xFC) << 3) | (color.b >> 3);
-                *((uint16_t*)(fbp + location)) = rgb565;
+        if (!fbp) {
+            return;
+        }
+        runs.clear();
+        flushDirty([&](int x, int y, int w, int h) { runs.push_back({ x, y, w, h }); });
+        if (runs.empty()) {
+            return;
+        }
+        if (pages == 1) {
+            for (Run& run : runs) {
+                write(fbp, run);
             }
+            return;
+        }
+
+        // The page drawn missed the runs of the previous frame, drawn on the other page
+        int page = 1 - displayedPage;
+        uint8_t* pagePtr = fbp + page * vinfo.yres * finfo.line_length;
+        for (Run& run : previousRuns) {
+            write(pagePtr, run);
+        }
+        for (Run& run : runs) {
+            write(pagePtr, run);
+        }
+        if (flip(page)) {
+            displayedPage = page;
+            std::swap(previousRuns, runs);
+            return;
         }
+        logWarn("Framebuffer panning not supported, drawing a single page");
+        pages = 1;
+        vinfo.yoffset = 0;
+        ioctl(fb, FBIOPAN_DISPLAY, &vinfo);
+        markDirty({ 0, 0 }, { width, height });
+        renderNext();
     }
 
     // void config(nlohmann::json& config) override
@@ -7,7 +7,7 @@ This component, named `DrawWithSFML`, acts as a specific "driver" for displaying
 
 1.  **Window Management:** The component first initializes itself, reading environment settings to determine the window's starting size and position. It then creates the main graphical window, complete with a title bar and controls for minimizing or closing.
 
-2.  **Displaying Content:** Instead of drawing directly, the class prepares a digital canvas, known as a "texture." The application's internal image data is regularly copied onto this texture. The `render` function then displays this texture in the window, effectively refreshing the screen. It also handles dynamic window resizing, ensuring the content scales correctly if the user adjusts the window size.
+2.  **Displaying Content:** Instead of drawing directly, the class prepares a digital canvas, known as a "texture." Only the parts of the application's internal image that changed are copied onto this texture, each changed rectangle being gathered in a staging buffer and uploaded at once. The `render` function then displays this texture in the window, effectively refreshing the screen, and does nothing when nothing changed. Presenting can be synchronized with the monitor refresh (`"vsync": true` in the screen config). It also handles dynamic window resizing, ensuring the content scales correctly if the user adjusts the window size.
 
 3.  **Handling Input:** The most complex task is managing user input. The component continuously monitors the window for events, including:
     *   Closing or resizing the window.
@@ -22,6 +22,8 @@ sha: 242430e8d20f30d47724366d1f4a2c77a6aa89ada582c8c73abcc71efdec32f9
 #pragma once
 
 #include <SFML/Graphics.hpp>
+#include <cstring>
+#include <vector>
 
 #include "draw/drawDesktop.h"
 #include "helpers/environment.h"
@@ -35,6 +37,12 @@ protected:
     sf::Texture texture;
     sf::Sprite sprite;
 
+    // Pixels of a changed rectangle, its rows made contiguous for a single upload, in the RGBA layout of the texture
+    std::vector<Color> staging;
+    bool vsync = false;
+    // The window must be presented again even if no pixel changed, e.g. after a resize
+    bool needPresent = true;
+
 public:
     DrawWithSFML(Styles& styles)
         : DrawDesktop(styles)
@@ -63,6 +71,7 @@ public:
         // texture.create(screenSize.w, screenSize.h);
         texture.create(SCREEN_BUFFER_ROWS, SCREEN_BUFFER_COLS);
         sprite.setTexture(texture);
+        window.setVerticalSyncEnabled(vsync);
 
         logDebug("SFML initialized with window %dx%d at position %dx%d", screenSize.w, screenSize.h, windowX, windowY);
     }
@@ -87,15 +96,30 @@ public:
         return { (int)size.x, (int)size.y };
     }
 
+    void config(nlohmann::json& config) override
+    {
+        vsync = config.value("vsync", vsync);
+        DrawDesktop::config(config);
+    }
+
     void render() override
     {
-        for (int y = 0; y < screenSize.h; ++y) {
-            texture.update(
-                reinterpret_cast<const sf::Uint8*>(&screenBuffer[y][0]),
-                screenSize.w,
-                1,
-                0, y);
+        static_assert(sizeof(Color) == 4, "Color must have the RGBA layout of the texture");
+        // Only the tiles changed, the rows of each run being copied together as the rows of the buffer are not contiguous
+        flushDirty([&](int x, int y, int w, int h) {
+            if (staging.size() < (size_t)(w * h)) {
+                staging.resize(w * h);
+            }
+            for (int row = 0; row < h; ++row) {
+                memcpy(&staging[row * w], &screenBuffer[y + row][x], w * sizeof(Color));
+            }
+            texture.update(reinterpret_cast<const sf::Uint8*>(staging.data()), w, h, x, y);
+            needPresent = true;
+        });
+        if (!needPresent) {
+            return;
         }
+        needPresent = false;
 
         window.clear(sf::Color::Black);
         window.draw(sprite);
@@ -137,6 +161,7 @@ public:
                 prevSize = getScreenSize();
                 setScreenSize({ (int)event.size.width, (int)event.size.height });
                 needResize = getTicks();
+                needPresent = true;
 
                 return true;
             }
@@ -1,182 +1,260 @@
-/** Description:
-This software component serves as a specialized driver for an ST7789 type color display, commonly used in embedded projects. Its main function is to translate abstract drawing instructions into the specific electronic signals the screen hardware understands.
-
-The communication backbone is the high-speed Serial Peripheral Interface (SPI) protocol. The component manages specific General Purpose Input/Output (GPIO) pins on the host system (like a Raspberry Pi) to control the display, for instance, designating one pin to switch between sending system commands and actual image data (pixels).
-
-A core feature is its optimized rendering process. The class utilizes two main internal memory areas: one holding the currently desired image content, and a secondary "cache" that holds the image data last sent to the physical screen. When updating the display, the system compares these two buffers line by line. If a row of pixels is identical to the previous frame, the system skips sending that data, resulting in extremely fast updates and minimal use of the communication bandwidth.
-
-During startup, the driver initializes the required hardware pins, establishes the SPI connection—sometimes adjusting the low-level communication method based on system permissions—and configures the ST7789 display controller with the correct speed and orientation settings. The system also supports dynamic configuration, allowing users to adjust display behavior (like color inversion or reset pin assignment) after the program has started.
-
-sha: 5a503593a6cbc69cb8f99fea43eaf870523966d54f596160c73abaf2c4baed77 
-*/
-#pragma once
-
-#include "helpers/gpio.h"
-#include "helpers/st7789.h"
-#include "plugins/components/utils/color.h"
-
-// #define USE_SPI_DEV_MEM
-#ifdef USE_SPI_DEV_MEM
-// sudo apt-get install libraspberradiusYpi-dev raspberradiusYpi-kernel-headers
-// sudo chown 0:0 test2
-// sudo chmod u+s test2
-// see:
-// https://raspberradiusYpi.stackexchange.com/questions/40105/access-gpio-pins-without-root-no-access-to-dev-mem-tradiusY-running-as-root
-#include "helpers/SpiDevMem.h"
-#else
-#include "helpers/SpiDevSpi.h"
-#endif
-
-#include "draw.h"
-
-// Old one
-// #define GPIO_TFT_DATA_CONTROL 17
-// new one
-#define GPIO_TFT_DATA_CONTROL 3
-
-// BLK go to pin 13 (should be optional or can be connected directly to 3.3v)
-// #define GPIO_TFT_BACKLIGHT 27
-
-class DrawWithST7789 : public Draw {
-public:
-    uint16_t cacheBuffer[SCREEN_BUFFER_ROWS][SCREEN_BUFFER_COLS];
-
-protected:
-    int8_t resetPin = -1;
-    Spi spi = Spi(GPIO_TFT_DATA_CONTROL);
-    ST7789 st7789;
-
-    bool fullRendering = false;
-    void fullRender()
-    {
-        uint16_t pixels[SCREEN_BUFFER_COLS];
-        for (int i = 0; i < styles.screen.h; i++) {
-            for (int j = 0; j < styles.screen.w; j++) {
-                Color color = screenBuffer[i][j];
-                pixels[j] = st7789.colorToU16(color);
-            }
-            st7789.drawRow(0, i, styles.screen.w, pixels);
-        }
-        fullRendering = false;
-    }
-
-public:
-    DrawWithST7789(Styles& styles)
-        : Draw(styles)
-        , st7789([&](uint8_t cmd, uint8_t* data, uint32_t len) { spi.sendCmd(cmd, data, len); })
-    {
-    }
-
-    void init() override
-    {
-        logDebug("Initializing ST7789");
-
-        initGpio();
-        gpioSetMode(GPIO_TFT_DATA_CONTROL, 0x01); // Data/Control pin to output (0x01)
-        spi.init();
-
-        if (resetPin != -1) {
-            // resetPin = 2;
-            logDebug("Resetting ST7789 on pin %d", resetPin);
-            gpioSetMode(resetPin, 1);
-            gpioWrite(resetPin, 1);
-            usleep(120 * 1000);
-            gpioWrite(resetPin, 0);
-            usleep(120 * 1000);
-            gpioWrite(resetPin, 1);
-            usleep(120 * 1000);
-        }
-
-// Do the initialization with a veradiusY low SPI bus speed, so that it will succeed even if the bus speed chosen by the user is too high.
-#ifdef USE_SPI_DEV_MEM
-        spi.setSpeed(34);
-#else
-        spi.setSpeed(20000);
-#endif
-
-        logDebug("ST7789 init with screen.w=%d, screen.h=%d", styles.screen.w, styles.screen.h);
-        st7789.init(styles.screen.w, styles.screen.h);
-        usleep(10 * 1000); // Delay a bit before restoring CLK, or otherwise this has been observed to cause the display not init if done back to back after the clear operation above.
-
-#ifdef USE_SPI_DEV_MEM
-        spi.setSpeed(20);
-#else
-        spi.setSpeed(16000000); // 16 MHz
-#endif
-        clear();
-
-        logDebug("ST7789 initialized with dimensions w=%d, h=%d", styles.screen.w, styles.screen.h);
-    }
-
-    void render() override
-    {
-        if (fullRendering) {
-            fullRender();
-            return;
-        }
-
-        // DEBUG: Draw red border around screen edges to verify dimensions
-        static bool debugBorderDrawn = false;
-        if (!debugBorderDrawn) {
-            Color red = { 255, 0, 0, 255 };
-            for (int x = 0; x < styles.screen.w; x++) {
-                screenBuffer[0][x] = red;                      // Top edge
-                screenBuffer[styles.screen.h - 1][x] = red;    // Bottom edge
-            }
-            for (int y = 0; y < styles.screen.h; y++) {
-                screenBuffer[y][0] = red;                      // Left edge
-                screenBuffer[y][styles.screen.w - 1] = red;    // Right edge
-            }
-            logDebug("DEBUG: Drew red border at screen edges w=%d h=%d", styles.screen.w, styles.screen.h);
-            debugBorderDrawn = true;
-        }
-
-        uint16_t pixels[SCREEN_BUFFER_COLS];
-        for (int i = 0; i < styles.screen.h; i++) {
-            // To not make uneccessaradiusY calls to the display
-            // only send the row of pixels that have changed
-            bool changed = false;
-            for (int j = 0; j < styles.screen.w; j++) {
-                Color color = screenBuffer[i][j];
-                uint16_t rgbU16 = st7789.colorToU16(color);
-                pixels[j] = rgbU16;
-                if (cacheBuffer[i][j] != rgbU16) {
-                    changed = true;
-                }
-                cacheBuffer[i][j] = rgbU16;
-            }
-            if (changed) {
-                st7789.drawRow(0, i, styles.screen.w, pixels);
-            }
-        }
-    }
-
-    void clear() override
-    {
-        // Init buffer with background color
-        // Only clear the actual screen area, not the full 4096x4096 buffer
-        // Buffer is [row][col] = [y][x], so iterate height then width
-        uint16_t bgColor16 = st7789.colorToU16(styles.colors.background);
-        for (int y = 0; y < styles.screen.h; y++) {
-            for (int x = 0; x < styles.screen.w; x++) {
-                screenBuffer[y][x] = styles.colors.background;
-                cacheBuffer[y][x] = bgColor16;
-            }
-        }
-        fullRendering = true;
-    }
-
-    void config(nlohmann::json& config) override
-    {
-        try {
-            if (config.contains("st7789")) {
-                st7789.madctl = config["st7789"].value("madctl", st7789.madctl);
-                st7789.displayInverted = config["st7789"].value("inverted", st7789.displayInverted);
-                resetPin = config["st7789"].value("resetPin", resetPin);
-            }
-            Draw::config(config);
-        } catch (const std::exception& e) {
-            logError("screen config: %s", e.what());
-        }
-    }
-};
+/** Description:
+This software component serves as a specialized driver for an ST7789 type color display, commonly used in embedded projects. Its main function is to translate abstract drawing instructions into the specific electronic signals the screen hardware understands.
+
+The communication backbone is the high-speed Serial Peripheral Interface (SPI) protocol. The component manages specific General Purpose Input/Output (GPIO) pins on the host system (like a Raspberry Pi) to control the display, for instance, designating one pin to switch between sending system commands and actual image data (pixels).
+
+A core feature is its optimized rendering process. The class holds the desired image content in a buffer split in tiles, each marked as dirty when one of its pixels changes. When updating the display, the system only sends the dirty tiles, the runs of tiles stacked in the same columns merged into rectangles, each sent as a single window in one transfer, skipping everything identical to the previous frame. The frames are sent by a dedicated thread, double buffered, so the interface prepares the next frame while the previous one is still going out on the bus, resulting in extremely fast updates and minimal use of the communication bandwidth.
+
+During startup, the driver initializes the required hardware pins, establishes the SPI connection—sometimes adjusting the low-level communication method based on system permissions—and configures the ST7789 display controller with the correct speed and orientation settings. The system also supports dynamic configuration, allowing users to adjust display behavior (like color inversion or reset pin assignment) after the program has started.
+
+sha: 5a503593a6cbc69cb8f99fea43eaf870523966d54f596160c73abaf2c4baed77 
+*/
+#pragma once
+
+#include "helpers/gpio.h"
+#include "helpers/st7789.h"
+#include "plugins/components/utils/color.h"
+
+// #define USE_SPI_DEV_MEM
+#ifdef USE_SPI_DEV_MEM
+// sudo apt-get install libraspberradiusYpi-dev raspberradiusYpi-kernel-headers
+// sudo chown 0:0 test2
+// sudo chmod u+s test2
+// see:
+// https://raspberradiusYpi.stackexchange.com/questions/40105/access-gpio-pins-without-root-no-access-to-dev-mem-tradiusY-running-as-root
+#include "helpers/SpiDevMem.h"
+#else
+#include "helpers/SpiDevSpi.h"
+#endif
+
+#include "draw.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Old one
+// #define GPIO_TFT_DATA_CONTROL 17
+// new one
+#define GPIO_TFT_DATA_CONTROL 3
+
+// BLK go to pin 13 (should be optional or can be connected directly to 3.3v)
+// #define GPIO_TFT_BACKLIGHT 27
+
+class DrawWithST7789 : public Draw {
+protected:
+    int8_t resetPin = -1;
+    Spi spi = Spi(GPIO_TFT_DATA_CONTROL);
+    ST7789 st7789;
+
+    bool fullRendering = false;
+
+    // Frames converted by the UI thread and sent by the display thread, so the UI prepares the next frame while the
+    // previous one is still going out on the SPI bus. Each frame is the rectangles of tiles changed, with their pixels.
+    struct Rect {
+        uint16_t x, y, w, h;
+        size_t offset;
+    };
+    struct Frame {
+        std::vector<Rect> rects;
+        std::vector<uint16_t> pixels;
+    };
+    Frame frames[2];
+    // Index of the frame waiting to be sent, and of the one being sent, -1 for none
+    int pendingFrame = -1;
+    int sendingFrame = -1;
+    bool displayRunning = true;
+    std::mutex displayMtx;
+    std::condition_variable displayCv;
+    std::thread displayThread;
+
+    void displayLoop()
+    {
+        std::unique_lock<std::mutex> lock(displayMtx);
+        while (true) {
+            displayCv.wait(lock, [&] { return !displayRunning || pendingFrame != -1; });
+            if (pendingFrame == -1) {
+                break;
+            }
+            sendingFrame = pendingFrame;
+            pendingFrame = -1;
+            displayCv.notify_all();
+            lock.unlock();
+            Frame& frame = frames[sendingFrame];
+            for (Rect& rect : frame.rects) {
+                st7789.drawRect(rect.x, rect.y, rect.w, rect.h, frame.pixels.data() + rect.offset);
+            }
+            lock.lock();
+            sendingFrame = -1;
+            displayCv.notify_all();
+        }
+    }
+
+    void addRect(Frame& frame, int x, int y, int w, int h)
+    {
+        // The runs of tiles of the same columns on consecutive rows of tiles are sent as one rectangle
+        for (auto rect = frame.rects.rbegin(); rect != frame.rects.rend() && rect->y + rect->h >= y; rect++) {
+            if (rect->x == x && rect->w == w && rect->y + rect->h == y) {
+                rect->h += h;
+                return;
+            }
+        }
+        frame.rects.push_back({ (uint16_t)x, (uint16_t)y, (uint16_t)w, (uint16_t)h, 0 });
+    }
+
+    // Converted once the rectangles are merged, row by row in each of them as the display fills its window
+    void convert(Frame& frame)
+    {
+        size_t size = 0;
+        for (Rect& rect : frame.rects) {
+            rect.offset = size;
+            size += rect.w * rect.h;
+        }
+        frame.pixels.resize(size);
+        for (Rect& rect : frame.rects) {
+            uint16_t* pixels = frame.pixels.data() + rect.offset;
+            for (int i = rect.y; i < rect.y + rect.h; i++) {
+                for (int j = rect.x; j < rect.x + rect.w; j++) {
+                    *pixels++ = st7789.colorToU16(screenBuffer[i][j]);
+                }
+            }
+        }
+    }
+
+    void send(Frame& frame, int index)
+    {
+        std::lock_guard<std::mutex> guard(displayMtx);
+        pendingFrame = index;
+        if (!displayThread.joinable()) {
+            displayThread = std::thread([this] { displayLoop(); });
+            pthread_setname_np(displayThread.native_handle(), "st7789");
+        }
+        displayCv.notify_all();
+    }
+
+public:
+    DrawWithST7789(Styles& styles)
+        : Draw(styles)
+        , st7789([&](uint8_t cmd, uint8_t* data, uint32_t len) { spi.sendCmd(cmd, data, len); })
+    {
+    }
+
+    ~DrawWithST7789()
+    {
+        {
+            std::lock_guard<std::mutex> guard(displayMtx);
+            displayRunning = false;
+        }
+        displayCv.notify_all();
+        // The frame pending is sent before leaving
+        if (displayThread.joinable()) {
+            displayThread.join();
+        }
+    }
+
+    void init() override
+    {
+        logDebug("Initializing ST7789");
+
+        initGpio();
+        gpioSetMode(GPIO_TFT_DATA_CONTROL, 0x01); // Data/Control pin to output (0x01)
+        spi.init();
+
+        if (resetPin != -1) {
+            // resetPin = 2;
+            logDebug("Resetting ST7789 on pin %d", resetPin);
+            gpioSetMode(resetPin, 1);
+            gpioWrite(resetPin, 1);
+            usleep(120 * 1000);
+            gpioWrite(resetPin, 0);
+            usleep(120 * 1000);
+            gpioWrite(resetPin, 1);
+            usleep(120 * 1000);
+        }
+
+// Do the initialization with a veradiusY low SPI bus speed, so that it will succeed even if the bus speed chosen by the user is too high.
+#ifdef USE_SPI_DEV_MEM
+        spi.setSpeed(34);
+#else
+        spi.setSpeed(20000);
+#endif
+
+        logDebug("ST7789 init with screen.w=%d, screen.h=%d", styles.screen.w, styles.screen.h);
+        st7789.init(styles.screen.w, styles.screen.h);
+        usleep(10 * 1000); // Delay a bit before restoring CLK, or otherwise this has been observed to cause the display not init if done back to back after the clear operation above.
+
+#ifdef USE_SPI_DEV_MEM
+        spi.setSpeed(20);
+#else
+        spi.setSpeed(16000000); // 16 MHz
+#endif
+        clear();
+
+        logDebug("ST7789 initialized with dimensions w=%d, h=%d", styles.screen.w, styles.screen.h);
+    }
+
+    void render() override
+    {
+        // DEBUG: Draw red border around screen edges to verify dimensions
+        static bool debugBorderDrawn = false;
+        if (!debugBorderDrawn) {
+            Color red = { 255, 0, 0, 255 };
+            for (int x = 0; x < styles.screen.w; x++) {
+                screenBuffer[0][x] = red;                      // Top edge
+                screenBuffer[styles.screen.h - 1][x] = red;    // Bottom edge
+            }
+            for (int y = 0; y < styles.screen.h; y++) {
+                screenBuffer[y][0] = red;                      // Left edge
+                screenBuffer[y][styles.screen.w - 1] = red;    // Right edge
+            }
+            logDebug("DEBUG: Drew red border at screen edges w=%d h=%d", styles.screen.w, styles.screen.h);
+            debugBorderDrawn = true;
+            markDirty({ 0, 0 }, styles.screen);
+        }
+
+        // Wait for a free frame: only when a frame is already waiting behind the one being sent
+        int index;
+        {
+            std::unique_lock<std::mutex> lock(displayMtx);
+            displayCv.wait(lock, [&] { return pendingFrame == -1; });
+            index = sendingFrame == 0 ? 1 : 0;
+        }
+        Frame& frame = frames[index];
+        frame.rects.clear();
+        if (fullRendering) {
+            flushDirty([](int x, int y, int w, int h) { });
+            frame.rects.push_back({ 0, 0, (uint16_t)styles.screen.w, (uint16_t)styles.screen.h, 0 });
+            fullRendering = false;
+        } else {
+            // To not make unnecessary calls to the display, only the tiles that changed are sent
+            flushDirty([&](int x, int y, int w, int h) { addRect(frame, x, y, w, h); });
+        }
+        if (frame.rects.empty()) {
+            return;
+        }
+        convert(frame);
+        send(frame, index);
+    }
+
+    void clear() override
+    {
+        // Only the actual screen area, not the full 4096x4096 buffer, then sent whole
+        Draw::clear();
+        fullRendering = true;
+    }
+
+    void config(nlohmann::json& config) override
+    {
+        try {
+            if (config.contains("st7789")) {
+                st7789.madctl = config["st7789"].value("madctl", st7789.madctl);
+                st7789.displayInverted = config["st7789"].value("inverted", st7789.displayInverted);
+                resetPin = config["st7789"].value("resetPin", resetPin);
+            }
+            Draw::config(config);
+        } catch (const std::exception& e) {
+            logError("screen config: %s", e.what());
+        }
+    }
+};
@@ -0,0 +1,201 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "Font.h"
+#include "helpers/processSingleton.h"
+#include "log.h"
+
+// Fonts of a font pack, a single file mapped read only, instead of being compiled in the binary: the pages of the
+// glyphs are shared with the page cache, only loaded once drawn, and the fonts can be changed without building again.
+//
+// The glyphs are stored as in the compiled fonts, `width, marginTop, rows` followed by their `width * rows` alpha
+// values, so a font of the pack is a table of pointers in the mapping, like `X_data` of a compiled font, and the glyph
+// cache reads it the same way. Loading the pack only checks it and builds these tables, without copying a glyph.
+//
+// The pack is written by `draw/fonts/fontpack.cpp`, from the compiled fonts, see `make fonts` in the root makefile.
+class FontPack {
+public:
+    static const uint32_t MAGIC = 0x5a50464e; // ZPFN
+    static const uint32_t VERSION = 1;
+    static const int FIRST_CHAR = ' ';
+    static const int CHAR_COUNT = '~' - ' ' + 1;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint32_t fontCount;
+        uint32_t reserved;
+    };
+
+    struct Entry {
+        char name[32];
+        uint8_t height;
+        uint8_t reserved[3];
+        // Offset of each glyph from the start of the file
+        uint32_t glyphs[CHAR_COUNT];
+    };
+
+protected:
+    struct Loaded {
+        std::string name;
+        const uint8_t* table[1 + CHAR_COUNT];
+        Font font;
+    };
+
+    void* map = NULL;
+    size_t size = 0;
+    bool opened = false;
+    std::vector<Loaded> fonts;
+
+    void close()
+    {
+        fonts.clear();
+        if (map) {
+            munmap(map, size);
+            map = NULL;
+            size = 0;
+        }
+    }
+
+    bool check(const uint8_t* data)
+    {
+        Header header;
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != MAGIC || header.version != VERSION || header.fontCount > (size - sizeof(Header)) / sizeof(Entry)) {
+            return false;
+        }
+        const Entry* entries = (const Entry*)(data + sizeof(Header));
+        for (uint32_t i = 0; i < header.fontCount; i++) {
+            for (int c = 0; c < CHAR_COUNT; c++) {
+                uint32_t offset = entries[i].glyphs[c];
+                if ((size_t)offset + 3 > size || (size_t)offset + 3 + (size_t)data[offset] * data[offset + 2] > size) {
+                    return false;
+                }
+            }
+        }
+        // The tables point in `fonts`, so it must not grow once they are built
+        fonts.resize(header.fontCount);
+        for (uint32_t i = 0; i < header.fontCount; i++) {
+            const Entry& entry = entries[i];
+            Loaded& font = fonts[i];
+            font.name = std::string(entry.name, strnlen(entry.name, sizeof(entry.name)));
+            font.table[0] = &entry.height;
+            for (int c = 0; c < CHAR_COUNT; c++) {
+                font.table[1 + c] = data + entry.glyphs[c];
+            }
+            font.font = { (void*)font.table };
+        }
+        return true;
+    }
+
+    // `FONT_PACK` if set, else `fonts.zfp` next to the executable
+    static std::string defaultPath()
+    {
+        if (getenv("FONT_PACK") && getenv("FONT_PACK")[0] != '\0') {
+            return getenv("FONT_PACK");
+        }
+        char exe[4096];
+        ssize_t len = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+        if (len <= 0) {
+            return "fonts.zfp";
+        }
+        std::string path(exe, len);
+        return path.substr(0, path.find_last_of('/') + 1) + "fonts.zfp";
+    }
+
+public:
+    static FontPack& get()
+    {
+        return processSingleton<FontPack>();
+    }
+
+    ~FontPack()
+    {
+        close();
+    }
+
+    // Replace the fonts by the ones of the pack at `path`, false if it can't be used, e.g. missing or truncated.
+    // Before any font is looked up, as the fonts of the previous pack are gone.
+    bool open(const std::string& path)
+    {
+        close();
+        opened = true;
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header)) {
+            ::close(fd);
+            logWarn("Font pack %s is not valid", path.c_str());
+            return false;
+        }
+        size = info.st_size;
+        map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            map = NULL;
+            size = 0;
+            return false;
+        }
+        if (!check((const uint8_t*)map)) {
+            logWarn("Font pack %s is not valid", path.c_str());
+            close();
+            return false;
+        }
+        logDebug("Font pack %s: %d fonts", path.c_str(), (int)fonts.size());
+        return true;
+    }
+
+    // Font `name` of the pack, the default pack being opened by the first lookup. NULL if there is none.
+    Font* find(const std::string& name)
+    {
+        if (!opened) {
+            open(defaultPath());
+        }
+        for (Loaded& font : fonts) {
+            if (font.name == name) {
+                return &font.font;
+            }
+        }
+        return NULL;
+    }
+
+    // The pack of `fonts`, each given by its name and the table of a compiled font
+    static std::string write(const std::vector<std::pair<std::string, const uint8_t**>>& fonts)
+    {
+        Header header = { MAGIC, VERSION, (uint32_t)fonts.size(), 0 };
+        std::vector<Entry> entries(fonts.size());
+        std::string glyphs;
+        size_t glyphsStart = sizeof(Header) + fonts.size() * sizeof(Entry);
+        for (size_t i = 0; i < fonts.size(); i++) {
+            Entry& entry = entries[i];
+            memset(&entry, 0, sizeof(entry));
+            strncpy(entry.name, fonts[i].first.c_str(), sizeof(entry.name) - 1);
+            const uint8_t** table = fonts[i].second;
+            entry.height = *table[0];
+            for (int c = 0; c < CHAR_COUNT; c++) {
+                const uint8_t* glyph = table[1 + c];
+                // The compiled glyphs have `height` rows of alpha, whatever `rows` says
+                uint8_t rows = glyph[2] < entry.height ? glyph[2] : entry.height;
+                entry.glyphs[c] = glyphsStart + glyphs.size();
+                glyphs += (char)glyph[0];
+                glyphs += (char)glyph[1];
+                glyphs += (char)rows;
+                glyphs.append((const char*)glyph + 3, (size_t)glyph[0] * rows);
+            }
+        }
+        std::string data((const char*)&header, sizeof(header));
+        data.append((const char*)entries.data(), entries.size() * sizeof(Entry));
+        data.append(glyphs);
+        return data;
+    }
+};
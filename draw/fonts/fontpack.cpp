@@ -0,0 +1,59 @@
+// Write the font pack of the compiled fonts, mapped by the app instead of compiling them in, see FontPack.h
+// g++ -std=c++17 -I../.. fontpack.cpp -o fontpack && ./fontpack fonts.zfp
+
+#include <cstdio>
+#include <fstream>
+#include <string>
+#include <utility>
+#include <vector>
+
+#include "DejaVuSans_12.h"
+#include "DejaVuSans_16.h"
+#include "DejaVuSans_24.h"
+#include "DejaVuSans_8.h"
+#include "FontPack.h"
+#include "PoppinsLight_12.h"
+#include "PoppinsLight_16.h"
+#include "PoppinsLight_24.h"
+#include "PoppinsLight_6.h"
+#include "PoppinsLight_8.h"
+#include "RobotoThin_12.h"
+#include "RobotoThin_16.h"
+#include "RobotoThin_24.h"
+#include "RobotoThin_8.h"
+
+#define PACK_FONT(name) { #name, (const uint8_t**)name.data }
+
+int main(int argc, char* argv[])
+{
+    if (argc < 2) {
+        fprintf(stderr, "Usage: %s <output_pack_path>\n", argv[0]);
+        return 1;
+    }
+
+    std::vector<std::pair<std::string, const uint8_t**>> fonts = {
+        PACK_FONT(RobotoThin_8),
+        PACK_FONT(RobotoThin_12),
+        PACK_FONT(RobotoThin_16),
+        PACK_FONT(RobotoThin_24),
+        PACK_FONT(PoppinsLight_6),
+        PACK_FONT(PoppinsLight_8),
+        PACK_FONT(PoppinsLight_12),
+        PACK_FONT(PoppinsLight_16),
+        PACK_FONT(PoppinsLight_24),
+        PACK_FONT(DejaVuSans_8),
+        PACK_FONT(DejaVuSans_12),
+        PACK_FONT(DejaVuSans_16),
+        PACK_FONT(DejaVuSans_24),
+    };
+
+    std::string data = FontPack::write(fonts);
+    std::ofstream file(argv[1], std::ios::binary);
+    if (!file.is_open() || !file.write(data.data(), data.size())) {
+        fprintf(stderr, "Could not write font pack: %s\n", argv[1]);
+        return 1;
+    }
+
+    printf("Font pack generated successfully: %s (%d fonts, %d bytes)\n", argv[1], (int)fonts.size(), (int)data.size());
+    return 0;
+}
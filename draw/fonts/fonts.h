@@ -11,10 +11,15 @@ The core of this system is a dedicated function that finds the requested font. W
 
 This design allows the application to utilize both permanently embedded fonts and flexible fonts loaded directly from files, all through one standardized request process.
 
+Before any of these, the font is looked up in the font pack, a single file mapped in memory holding the same fixed fonts (see `FontPack.h`). Built with `NO_COMPILED_FONTS`, the fixed fonts are not embedded at all and only come from the pack.
+
 sha: 12cef6cc306519d238f187d4351caa4fa041cad063d5b8a0f6c772b2e165f88f 
 */
 #pragma once
 
+#include "FontPack.h"
+
+#ifndef NO_COMPILED_FONTS
 // #include "MusicNote.h"
 #include "DejaVuSans_12.h"
 #include "DejaVuSans_16.h"
@@ -29,6 +34,7 @@ sha: 12cef6cc306519d238f187d4351caa4fa041cad063d5b8a0f6c772b2e165f88f
 #include "RobotoThin_16.h"
 #include "RobotoThin_24.h"
 #include "RobotoThin_8.h"
+#endif
 
 #ifdef FT_FREETYPE_H
 #include "TtfFont.h"
@@ -38,17 +44,54 @@ sha: 12cef6cc306519d238f187d4351caa4fa041cad063d5b8a0f6c772b2e165f88f
 #include <string.h>
 
 #define DEFAULT_FONT_SIZE 12
-#define DEFAULT_FONT PoppinsLight_12
+#define DEFAULT_FONT_NAME "PoppinsLight_12"
 
 #ifdef FT_FREETYPE_H
 std::set<TtfFont*> ttfFonts;
 #endif
 
+// Drawn when there is no font at all, e.g. built without the compiled fonts and the pack is missing: every
+// character is an empty glyph
+Font* getEmptyFont()
+{
+    static const uint8_t height = 1;
+    static const uint8_t glyph[] = { 0, 0, 0 };
+    static const uint8_t* data[1 + FontPack::CHAR_COUNT] = { &height };
+    static Font font = { (void*)data };
+    for (int c = 0; c < FontPack::CHAR_COUNT; c++) {
+        data[1 + c] = glyph;
+    }
+    return &font;
+}
+
+void* getCompiledFontPtr(const std::string& name);
+
+Font* getDefaultFont()
+{
+    static Font* font = NULL;
+    if (!font) {
+        font = FontPack::get().find(DEFAULT_FONT_NAME);
+        if (!font) {
+            font = (Font*)getCompiledFontPtr(DEFAULT_FONT_NAME);
+        }
+        if (!font) {
+            logError("No font %s: neither in the font pack nor compiled", DEFAULT_FONT_NAME);
+            font = getEmptyFont();
+        }
+    }
+    return font;
+}
+
 void* getFontPtr(std::string& name)
 {
     // if (name == nullptr || strcmp(name, "default") == 0) {
     if (name.empty() || name == "default") {
-        return &DEFAULT_FONT;
+        return getDefaultFont();
+    }
+
+    Font* packed = FontPack::get().find(name);
+    if (packed) {
+        return packed;
     }
 
 #ifdef FT_FREETYPE_H
@@ -67,6 +110,12 @@ void* getFontPtr(std::string& name)
     }
 #endif
 
+    return getCompiledFontPtr(name);
+}
+
+void* getCompiledFontPtr(const std::string& name)
+{
+#ifndef NO_COMPILED_FONTS
     if (name == "RobotoThin_8") {
         return &RobotoThin_8;
     } else if (name == "RobotoThin_12") {
@@ -94,6 +143,7 @@ void* getFontPtr(std::string& name)
     } else if (name == "DejaVuSans_24") {
         return &DejaVuSans_24;
     }
+#endif
 
     return nullptr;
 }
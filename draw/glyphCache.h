@@ -0,0 +1,96 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+// Glyphs of the compiled fonts rasterized once per font and size, so drawing a character only blends its pixels.
+//
+// A compiled glyph is `width, marginTop, rows` followed by its `width * rows` alpha values, most of them 0. Scaled to
+// the size the text is drawn at, each glyph is kept as its spans of consecutive non-transparent pixels on a row, with
+// their coverage, the position of each pixel already scaled.
+class GlyphCache {
+public:
+    static const int FIRST_CHAR = ' ';
+    static const int CHAR_COUNT = '~' - ' ' + 1;
+
+    struct Span {
+        int16_t x;
+        int16_t y;
+        uint16_t len;
+        uint32_t offset;
+    };
+
+    struct Glyph {
+        // Width of the glyph once scaled, and as added to the position for the next character
+        float width = 0;
+        int advance = 0;
+        std::vector<Span> spans;
+        // Alpha of the compiled glyph doubled, from 0 to 510, applied to the alpha of the color
+        std::vector<uint16_t> coverage;
+    };
+
+protected:
+    struct Face {
+        Glyph glyphs[CHAR_COUNT];
+    };
+
+    std::unordered_map<uint64_t, std::unique_ptr<Face>> faces;
+    const uint8_t** lastFont = NULL;
+    uint32_t lastSize = 0;
+    Face* lastFace = NULL;
+
+    static void rasterize(Glyph& glyph, const uint8_t* charPtr, float scale)
+    {
+        uint8_t width = charPtr[0];
+        int marginTop = charPtr[1] * scale;
+        uint8_t rows = charPtr[2];
+        const uint8_t* alpha = charPtr + 3;
+        glyph.width = width * scale;
+        glyph.advance = glyph.width;
+        for (int row = 0; row < rows; row++) {
+            int y = row * scale + marginTop;
+            Span* span = NULL;
+            for (int col = 0; col < width; col++) {
+                uint8_t a = alpha[col + row * width];
+                if (!a) {
+                    span = NULL;
+                    continue;
+                }
+                int x = col * scale;
+                // Scaled up, the pixels of a row are apart, scaled down, several land on the same pixel
+                if (!span || span->x + span->len != x) {
+                    glyph.spans.push_back({ (int16_t)x, (int16_t)y, 0, (uint32_t)glyph.coverage.size() });
+                    span = &glyph.spans.back();
+                }
+                span->len++;
+                glyph.coverage.push_back(a * 2);
+            }
+        }
+    }
+
+public:
+    // Glyph of `c` in `font` drawn at `size`, the characters out of the font being drawn as a space
+    Glyph& get(const uint8_t** font, uint32_t size, char c)
+    {
+        if (font != lastFont || size != lastSize) {
+            uint64_t key = ((uint64_t)(uintptr_t)font << 16) ^ size;
+            std::unique_ptr<Face>& face = faces[key];
+            if (!face) {
+                face.reset(new Face);
+                uint8_t height = *font[0];
+                float scale = size / (float)height;
+                scale = scale == 0 ? 1 : scale;
+                for (int i = 0; i < CHAR_COUNT; i++) {
+                    rasterize(face->glyphs[i], font[1 + i], scale);
+                }
+            }
+            lastFont = font;
+            lastSize = size;
+            lastFace = face.get();
+        }
+        int index = (uint8_t)c - FIRST_CHAR;
+        return lastFace->glyphs[index >= 0 && index < CHAR_COUNT ? index : 0];
+    }
+};
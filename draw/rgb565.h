@@ -0,0 +1,54 @@
+#pragma once
+
+#include <cstdint>
+
+#include "plugins/components/baseInterface.h"
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define RGB565_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define RGB565_NEON
+#endif
+
+inline uint16_t toRgb565(const Color& color)
+{
+    return ((color.r & 0xF8) << 8) | ((color.g & 0xFC) << 3) | (color.b >> 3);
+}
+
+// Convert `count` colors to RGB565, 8 at a time where SIMD is available
+inline void toRgb565(const Color* colors, uint16_t* out, int count)
+{
+    int i = 0;
+#if defined(RGB565_SSE)
+    // Each color is a 32 bits lane `r | g << 8 | b << 16 | a << 24`, converted in its low 16 bits
+    const __m128i maskR = _mm_set1_epi32(0xF8);
+    const __m128i maskG = _mm_set1_epi32(0xFC00);
+    const __m128i maskB = _mm_set1_epi32(0xF80000);
+    auto convert = [&](__m128i v) {
+        __m128i rgb = _mm_or_si128(_mm_or_si128(_mm_slli_epi32(_mm_and_si128(v, maskR), 8),
+                                       _mm_srli_epi32(_mm_and_si128(v, maskG), 5)),
+            _mm_srli_epi32(_mm_and_si128(v, maskB), 19));
+        // Sign extended, so packing with signed saturation keeps the 16 bits as they are
+        return _mm_srai_epi32(_mm_slli_epi32(rgb, 16), 16);
+    };
+    for (; i + 8 <= count; i += 8) {
+        __m128i low = convert(_mm_loadu_si128((const __m128i*)(colors + i)));
+        __m128i high = convert(_mm_loadu_si128((const __m128i*)(colors + i + 4)));
+        _mm_storeu_si128((__m128i*)(out + i), _mm_packs_epi32(low, high));
+    }
+#elif defined(RGB565_NEON)
+    for (; i + 8 <= count; i += 8) {
+        // De-interleaved in a register per channel
+        uint8x8x4_t v = vld4_u8((const uint8_t*)(colors + i));
+        uint16x8_t r = vshll_n_u8(vand_u8(v.val[0], vdup_n_u8(0xF8)), 8);
+        uint16x8_t g = vshll_n_u8(vand_u8(v.val[1], vdup_n_u8(0xFC)), 3);
+        uint16x8_t b = vmovl_u8(vshr_n_u8(v.val[2], 3));
+        vst1q_u16(out + i, vorrq_u16(vorrq_u16(r, g), b));
+    }
+#endif
+    for (; i < count; i++) {
+        out[i] = toRgb565(colors[i]);
+    }
+}
@@ -0,0 +1,278 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <list>
+#include <unordered_map>
+#include <vector>
+
+// Arcs, pies and circles rasterized once per geometry, so drawing one only blends its pixels, e.g. the arc of a knob
+// redrawn on each value change.
+//
+// A shape is kept as its spans of consecutive pixels on a row, relative to its center, with the coverage of each
+// pixel from the anti-aliasing of the edges, 256 being fully covered. The least recently drawn shapes are dropped
+// once there are MAX_SHAPES of them.
+//
+// Besides these, the masks are shapes recorded from what was drawn, e.g. an icon, see Draw::drawMask().
+class ShapeCache {
+public:
+    static const size_t MAX_SHAPES = 256;
+
+    struct Span {
+        int16_t x;
+        int16_t y;
+        uint16_t len;
+        uint32_t offset;
+    };
+
+    struct Shape {
+        std::vector<Span> spans;
+        std::vector<uint16_t> coverage;
+    };
+
+protected:
+    enum Type : uint8_t {
+        FILLED_PIE,
+        ARC,
+        FILLED_CIRCLE,
+        MASK,
+    };
+
+    struct Entry {
+        uint64_t key;
+        Shape shape;
+    };
+    // Most recently drawn first
+    std::list<Entry> entries;
+    std::unordered_map<uint64_t, std::list<Entry>::iterator> index;
+
+    // Rasterized around a center far enough from 0 for all the coordinates to be positive, the same way they are
+    // rounded on screen
+    struct Recorder {
+        Shape& shape;
+        int center;
+
+        void operator()(int x, int y, double coverage)
+        {
+            uint16_t value = coverage >= 1.0 ? 256 : (uint16_t)(coverage * 256);
+            if (!value) {
+                return;
+            }
+            int16_t dx = x - center;
+            int16_t dy = y - center;
+            Span* span = shape.spans.empty() ? NULL : &shape.spans.back();
+            if (!span || span->y != dy || span->x + span->len != dx) {
+                shape.spans.push_back({ dx, dy, 0, (uint32_t)shape.coverage.size() });
+                span = &shape.spans.back();
+            }
+            span->len++;
+            shape.coverage.push_back(value);
+        }
+    };
+
+    static bool inAngle(int x, int y, int cx, int cy, double startRad, double endRad, bool wrapAround)
+    {
+        double angle = atan2(y - cy, x - cx);
+        if (angle < 0)
+            angle += 2 * M_PI; // Normalize to [0, 2π]
+        return (wrapAround && (angle >= startRad || angle <= endRad)) || (!wrapAround && angle >= startRad && angle <= endRad);
+    }
+
+    // Anti-aliased edge pixels of a disc of `radius` on the row `yi`, from `xi` going in `direction`
+    template <typename Plot>
+    static void edge(int cx, int cy, double radius, int xi, int yi, double y, int direction, Plot plot)
+    {
+        double s = 8 * radius * radius;
+        double dy = fabs(y - cy) - 1.0;
+        while (1) {
+            double dx = direction < 0 ? (cx - xi - 1) : (xi - cx);
+            double v = s - 4 * (dx - dy) * (dx - dy);
+            if (v < 0)
+                break;
+            v = (sqrt(v) - 2 * (dx + dy)) / 4;
+            if (v < 0)
+                break;
+            if (v > 1.0)
+                v = 1.0;
+            plot(xi, v);
+            xi += direction;
+        }
+    }
+
+    // Rows of a disc of `radius`, `inner` being called for the pixels fully inside and `outer` for the ones on the edge
+    // with their coverage
+    template <typename Inner, typename Outer>
+    static void disc(int cx, int cy, double radius, Inner inner, Outer outer)
+    {
+        int n = radius + 1;
+        for (int yi = cy - n - 1; yi <= cy + n + 1; yi++) {
+            double y = yi < (cy - 0.5) ? yi : yi + 1;
+            double s = (y - cy) / radius;
+            s = s * s;
+            double x = 0.5;
+            if (s < 1.0) {
+                x = radius * sqrt(1.0 - s);
+                if (x >= 0.5) {
+                    for (int xi = (int)(cx - x + 1); xi <= (int)(cx + x - 1); xi++) {
+                        inner(xi, yi);
+                    }
+                }
+            }
+            edge(cx, cy, radius, cx - x, yi, y, -1, [&](int xi, double v) { outer(xi, yi, v); }); // left
+            edge(cx, cy, radius, cx + x, yi, y, 1, [&](int xi, double v) { outer(xi, yi, v); }); // right
+        }
+    }
+
+    static void rasterizeFilledPie(Recorder plot, int radius, int startAngle, int endAngle)
+    {
+        int c = plot.center;
+        double startRad = startAngle * M_PI / 180.0;
+        double endRad = endAngle * M_PI / 180.0;
+        bool wrapAround = (endRad < startRad);
+        disc(
+            c, c, radius,
+            [&](int xi, int yi) {
+                if (inAngle(xi, yi, c, c, startRad, endRad, wrapAround)) {
+                    plot(xi, yi, 1.0);
+                }
+            },
+            [&](int xi, int yi, double v) {
+                if (inAngle(xi, yi, c, c, startRad, endRad, wrapAround)) {
+                    plot(xi, yi, v);
+                }
+            });
+    }
+
+    static void rasterizeArc(Recorder plot, int radius, int thickness, int startAngle, int endAngle)
+    {
+        int c = plot.center;
+        double startRad = startAngle * M_PI / 180.0;
+        double endRad = endAngle * M_PI / 180.0;
+        bool wrapAround = (endRad < startRad);
+        double innerRadius = radius - thickness / 2.0;
+        double outerRadius = radius + thickness / 2.0;
+        // Anti-aliasing based on distance to inner and outer radii
+        auto ring = [&](int xi, int yi) {
+            double dx = xi - c;
+            double dy = yi - c;
+            double distance = sqrt(dx * dx + dy * dy);
+            if (distance < innerRadius || distance > outerRadius || !inAngle(xi, yi, c, c, startRad, endRad, wrapAround)) {
+                return 0.0;
+            }
+            if (distance < innerRadius + 1.0) {
+                return distance - innerRadius;
+            } else if (distance > outerRadius - 1.0) {
+                return outerRadius - distance;
+            }
+            return 1.0;
+        };
+        disc(
+            c, c, outerRadius,
+            [&](int xi, int yi) {
+                double alpha = ring(xi, yi);
+                if (alpha > 0) {
+                    plot(xi, yi, alpha);
+                }
+            },
+            [&](int xi, int yi, double v) {
+                double alpha = ring(xi, yi);
+                if (alpha > 0) {
+                    plot(xi, yi, v * alpha);
+                }
+            });
+    }
+
+    static void rasterizeFilledCircle(Recorder plot, int radius)
+    {
+        disc(
+            plot.center, plot.center, radius,
+            [&](int xi, int yi) { plot(xi, yi, 1.0); },
+            [&](int xi, int yi, double v) { plot(xi, yi, v); });
+    }
+
+    Shape* find(uint64_t key)
+    {
+        auto it = index.find(key);
+        if (it == index.end()) {
+            return NULL;
+        }
+        entries.splice(entries.begin(), entries, it->second);
+        return &it->second->shape;
+    }
+
+    Shape& add(uint64_t key)
+    {
+        if (entries.size() >= MAX_SHAPES) {
+            index.erase(entries.back().key);
+            entries.pop_back();
+        }
+        entries.push_front({ key, Shape() });
+        index[key] = entries.begin();
+        return entries.front().shape;
+    }
+
+    // Type, radius, thickness and angles, the angles being normalized to [0, 360)
+    static uint64_t key(Type type, int radius, int thickness, int startAngle, int endAngle)
+    {
+        return ((uint64_t)type << 56) | ((uint64_t)(radius & 0xffff) << 40) | ((uint64_t)(thickness & 0xffff) << 24)
+            | ((uint64_t)startAngle << 12) | (uint64_t)endAngle;
+    }
+
+public:
+    // Mask of `id`, only its 56 lowest bits being kept, NULL if it wasn't recorded yet
+    Shape* findMask(uint64_t id)
+    {
+        return find(((uint64_t)MASK << 56) | (id & 0x00ffffffffffffff));
+    }
+
+    // Empty mask of `id`, to be recorded
+    Shape& addMask(uint64_t id)
+    {
+        return add(((uint64_t)MASK << 56) | (id & 0x00ffffffffffffff));
+    }
+
+    void clearMasks()
+    {
+        for (auto it = entries.begin(); it != entries.end();) {
+            if ((it->key >> 56) == MASK) {
+                index.erase(it->key);
+                it = entries.erase(it);
+            } else {
+                it++;
+            }
+        }
+    }
+
+    Shape& filledPie(int radius, int startAngle, int endAngle)
+    {
+        uint64_t k = key(FILLED_PIE, radius, 0, startAngle, endAngle);
+        Shape* shape = find(k);
+        if (!shape) {
+            shape = &add(k);
+            rasterizeFilledPie({ *shape, radius + 4 }, radius, startAngle, endAngle);
+        }
+        return *shape;
+    }
+
+    Shape& arc(int radius, int thickness, int startAngle, int endAngle)
+    {
+        uint64_t k = key(ARC, radius, thickness, startAngle, endAngle);
+        Shape* shape = find(k);
+        if (!shape) {
+            shape = &add(k);
+            rasterizeArc({ *shape, radius + thickness + 4 }, radius, thickness, startAngle, endAngle);
+        }
+        return *shape;
+    }
+
+    Shape& filledCircle(int radius)
+    {
+        uint64_t k = key(FILLED_CIRCLE, radius, 0, 0, 0);
+        Shape* shape = find(k);
+        if (!shape) {
+            shape = &add(k);
+            rasterizeFilledCircle({ *shape, radius + 4 }, radius);
+        }
+        return *shape;
+    }
+};
@@ -0,0 +1,178 @@
+#pragma once
+
+#include <cstdint>
+
+#include "plugins/components/baseInterface.h"
+
+#if defined(__SSE2__) || defined(__x86_64__)
+#include <emmintrin.h>
+#define SPAN_SSE
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define SPAN_NEON
+#endif
+
+// Blending of whole spans of a row of the buffer, 4 pixels at a time with SSE2, 8 with NEON. Each function returns
+// how many pixels actually changed, so the caller only marks the tiles it changed. The blended pixels are opaque,
+// `(alpha * color + (255 - alpha) * current) / 255` being computed in integers, so the SIMD and the scalar paths
+// give the same pixels.
+
+// Exact `x / 255` for x up to 65534
+inline uint32_t div255(uint32_t x)
+{
+    return (x + 1 + (x >> 8)) >> 8;
+}
+
+inline Color blendPixel(Color current, Color color, uint8_t alpha)
+{
+    uint32_t inverse = 255 - alpha;
+    return {
+        (uint8_t)div255(color.r * alpha + current.r * inverse),
+        (uint8_t)div255(color.g * alpha + current.g * inverse),
+        (uint8_t)div255(color.b * alpha + current.b * inverse),
+        255,
+    };
+}
+
+inline bool samePixel(const Color& a, const Color& b)
+{
+    return a.r == b.r && a.g == b.g && a.b == b.b && a.a == b.a;
+}
+
+#if defined(SPAN_SSE)
+// Blend the 4 pixels of `current`, 2 per register of 16 bits lanes, `alphaLow` and `alphaHigh` holding the alpha of
+// each pixel in its 4 lanes
+inline __m128i blend4(__m128i current, __m128i color16, __m128i alphaLow, __m128i alphaHigh)
+{
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i full = _mm_set1_epi16(255);
+    const __m128i one = _mm_set1_epi16(1);
+    auto blend = [&](__m128i pixels, __m128i alpha) {
+        __m128i x = _mm_add_epi16(_mm_mullo_epi16(color16, alpha), _mm_mullo_epi16(pixels, _mm_sub_epi16(full, alpha)));
+        return _mm_srli_epi16(_mm_add_epi16(_mm_add_epi16(x, one), _mm_srli_epi16(x, 8)), 8);
+    };
+    __m128i low = blend(_mm_unpacklo_epi8(current, zero), alphaLow);
+    __m128i high = blend(_mm_unpackhi_epi8(current, zero), alphaHigh);
+    return _mm_or_si128(_mm_packus_epi16(low, high), _mm_set1_epi32(0xFF000000));
+}
+
+// Store the 4 pixels, returning how many changed
+inline int store4(Color* row, __m128i current, __m128i pixels)
+{
+    _mm_storeu_si128((__m128i*)row, pixels);
+    return 4 - __builtin_popcount(_mm_movemask_ps(_mm_castsi128_ps(_mm_cmpeq_epi32(current, pixels))));
+}
+
+inline __m128i colorVector(Color color)
+{
+    return _mm_set1_epi32(color.r | color.g << 8 | color.b << 16 | (uint32_t)color.a << 24);
+}
+#elif defined(SPAN_NEON)
+// Store the 8 pixels, returning how many changed
+inline int store8(Color* row, uint8x8x4_t current, uint8x8x4_t pixels)
+{
+    vst4_u8((uint8_t*)row, pixels);
+    uint8x8_t same = vand_u8(vand_u8(vceq_u8(current.val[0], pixels.val[0]), vceq_u8(current.val[1], pixels.val[1])),
+        vand_u8(vceq_u8(current.val[2], pixels.val[2]), vceq_u8(current.val[3], pixels.val[3])));
+    return 8 - __builtin_popcountll(vget_lane_u64(vreinterpret_u64_u8(same), 0)) / 8;
+}
+
+inline uint8x8_t blend8(uint8x8_t current, uint8x8_t color, uint8x8_t alpha)
+{
+    uint16x8_t x = vmlal_u8(vmull_u8(color, alpha), current, vmvn_u8(alpha));
+    return vshrn_n_u16(vaddq_u16(vaddq_u16(x, vdupq_n_u16(1)), vshrq_n_u16(x, 8)), 8);
+}
+#endif
+
+// Write the opaque `color` over `count` pixels
+inline int fillSpan(Color* row, int count, Color color)
+{
+    int changed = 0;
+    int i = 0;
+#if defined(SPAN_SSE)
+    const __m128i pixels = colorVector(color);
+    for (; i + 4 <= count; i += 4) {
+        changed += store4(row + i, _mm_loadu_si128((const __m128i*)(row + i)), pixels);
+    }
+#elif defined(SPAN_NEON)
+    uint8x8x4_t pixels = { { vdup_n_u8(color.r), vdup_n_u8(color.g), vdup_n_u8(color.b), vdup_n_u8(color.a) } };
+    for (; i + 8 <= count; i += 8) {
+        changed += store8(row + i, vld4_u8((const uint8_t*)(row + i)), pixels);
+    }
+#endif
+    for (; i < count; i++) {
+        if (!samePixel(row[i], color)) {
+            row[i] = color;
+            changed++;
+        }
+    }
+    return changed;
+}
+
+// Blend `color` over `count` pixels with its own alpha
+inline int blendSpan(Color* row, int count, Color color)
+{
+    int changed = 0;
+    int i = 0;
+#if defined(SPAN_SSE)
+    const __m128i color16 = _mm_unpacklo_epi8(colorVector(color), _mm_setzero_si128());
+    const __m128i alpha = _mm_set1_epi16(color.a);
+    for (; i + 4 <= count; i += 4) {
+        __m128i current = _mm_loadu_si128((const __m128i*)(row + i));
+        changed += store4(row + i, current, blend4(current, color16, alpha, alpha));
+    }
+#elif defined(SPAN_NEON)
+    const uint8x8_t alpha = vdup_n_u8(color.a);
+    const uint8x8_t r = vdup_n_u8(color.r), g = vdup_n_u8(color.g), b = vdup_n_u8(color.b);
+    for (; i + 8 <= count; i += 8) {
+        uint8x8x4_t current = vld4_u8((const uint8_t*)(row + i));
+        uint8x8x4_t pixels = { { blend8(current.val[0], r, alpha), blend8(current.val[1], g, alpha),
+            blend8(current.val[2], b, alpha), vdup_n_u8(255) } };
+        changed += store8(row + i, current, pixels);
+    }
+#endif
+    for (; i < count; i++) {
+        Color pixel = blendPixel(row[i], color, color.a);
+        if (!samePixel(row[i], pixel)) {
+            row[i] = pixel;
+            changed++;
+        }
+    }
+    return changed;
+}
+
+// Blend `color` over `count` pixels, each with the alpha of the mask, e.g. the coverage of a glyph
+inline int blitAlphaMask(Color* row, const uint8_t* alphas, int count, Color color)
+{
+    int changed = 0;
+    int i = 0;
+#if defined(SPAN_SSE)
+    const __m128i zero = _mm_setzero_si128();
+    const __m128i color16 = _mm_unpacklo_epi8(colorVector(color), zero);
+    for (; i + 4 <= count; i += 4) {
+        // The alpha of each pixel repeated in its 4 bytes, then widened to 16 bits
+        __m128i alpha = _mm_cvtsi32_si128(alphas[i] | alphas[i + 1] << 8 | alphas[i + 2] << 16 | (uint32_t)alphas[i + 3] << 24);
+        alpha = _mm_unpacklo_epi8(alpha, alpha);
+        alpha = _mm_unpacklo_epi8(alpha, alpha);
+        __m128i current = _mm_loadu_si128((const __m128i*)(row + i));
+        changed += store4(row + i, current, blend4(current, color16, _mm_unpacklo_epi8(alpha, zero), _mm_unpackhi_epi8(alpha, zero)));
+    }
+#elif defined(SPAN_NEON)
+    const uint8x8_t r = vdup_n_u8(color.r), g = vdup_n_u8(color.g), b = vdup_n_u8(color.b);
+    for (; i + 8 <= count; i += 8) {
+        uint8x8_t alpha = vld1_u8(alphas + i);
+        uint8x8x4_t current = vld4_u8((const uint8_t*)(row + i));
+        uint8x8x4_t pixels = { { blend8(current.val[0], r, alpha), blend8(current.val[1], g, alpha),
+            blend8(current.val[2], b, alpha), vdup_n_u8(255) } };
+        changed += store8(row + i, current, pixels);
+    }
+#endif
+    for (; i < count; i++) {
+        Color pixel = blendPixel(row[i], color, alphas[i]);
+        if (!samePixel(row[i], pixel)) {
+            row[i] = pixel;
+            changed++;
+        }
+    }
+    return changed;
+}
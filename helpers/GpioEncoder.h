@@ -4,11 +4,11 @@ This code defines a specialized software component, the `GpioEncoder` class, des
 The purpose of this component is to manage a collection of these encoders attached to the system's physical input pins (GPIOs).
 
 **How it works:**
-The system runs its monitoring logic continuously in a separate, dedicated background process (a thread). This allows the application to respond immediately without interrupting other tasks.
+Where the kernel provides the GPIO character device, the system is told about each change of the signal pins through edge events with their precise timestamp (see `GpioLineEvents`), so no change is missed however fast the encoder is turned, and nothing runs while it is idle. Otherwise it runs its monitoring logic continuously in a separate, dedicated background process (a thread). This allows the application to respond immediately without interrupting other tasks.
 
 For each encoder, the system constantly checks the electrical state of its two signal pins. Rotary encoders produce a unique pattern of pulses on these two pins when they are turned. By analyzing the precise sequence in which these pins change their state, the software reliably determines the direction of rotation (e.g., clockwise or counter-clockwise).
 
-When movement is detected, the system uses a special notification mechanism (a "callback function") to inform the rest of the application, specifying which encoder was moved and the detected direction of rotation.
+When movement is detected, the system uses a special notification mechanism (a "callback function") to inform the rest of the application, specifying which encoder was moved, the detected direction of rotation and when it happened.
 
 In summary, this class provides a robust, real-time interface for physical rotary inputs, translating hardware signals into usable directional data for the application.
 
@@ -16,7 +16,9 @@ sha: 2569497eaa4c916d3c3b05dcadca36c1b00aa790f7d0bd29f07e395ff48bd967
 */
 #pragma once
 
+#include "helpers/GpioLineEvents.h"
 #include "helpers/gpio.h"
+#include "helpers/getTicks.h"
 
 #include <functional>
 #include <stdio.h>
@@ -40,6 +42,8 @@ public:
         int levelA = 0;
         int levelB = 0;
         int lastGpio = -1;
+        // Time of the last step in ms, as `getTicks()`
+        uint64_t tick = 0;
     };
     std::vector<Encoder> encoders;
 
@@ -47,6 +51,55 @@ protected:
     std::thread loopThread;
     bool loopRunning = true;
     std::function<void(Encoder, int8_t)> onEncoder;
+    // Edges reported by the GPIO character device, else the pins are polled
+    bool lineEvents = false;
+
+    // A step is counted when both pins are high, the direction being given by the last pin that changed
+    void change(Encoder& encoder, uint8_t gpio, int level, uint64_t tick)
+    {
+        if (gpio == encoder.gpioA && level != encoder.levelA) {
+            encoder.levelA = level;
+            if (encoder.lastGpio != encoder.gpioA) {
+                encoder.lastGpio = encoder.gpioA;
+                if (level && encoder.levelB) {
+                    encoder.tick = tick;
+                    onEncoder(encoder, -1);
+                }
+            }
+        } else if (gpio == encoder.gpioB && level != encoder.levelB) {
+            encoder.levelB = level;
+            if (encoder.lastGpio != encoder.gpioB) {
+                encoder.lastGpio = encoder.gpioB;
+                if (level && encoder.levelA) {
+                    encoder.tick = tick;
+                    onEncoder(encoder, 1);
+                }
+            }
+        }
+    }
+
+    bool initLineEvents()
+    {
+        std::vector<uint8_t> gpios;
+        for (auto& encoder : encoders) {
+            gpios.push_back(encoder.gpioA);
+            gpios.push_back(encoder.gpioB);
+        }
+        std::vector<uint8_t> levels;
+        // Not debounced, a bounce being a change of the same pin, ignored until the other pin changes
+        if (!GpioLineEvents::get().request(gpios, 0, levels, [this](uint8_t gpio, uint8_t level, uint64_t tick) {
+                for (auto& encoder : encoders) {
+                    change(encoder, gpio, level, tick);
+                }
+            })) {
+            return false;
+        }
+        for (size_t i = 0; i < encoders.size(); i++) {
+            encoders[i].levelA = levels[i * 2];
+            encoders[i].levelB = levels[i * 2 + 1];
+        }
+        return true;
+    }
 
 public:
     GpioEncoder(std::vector<Encoder> encoders, std::function<void(Encoder, int8_t)> onEncoder)
@@ -57,6 +110,9 @@ public:
 
     void startThread()
     {
+        if (lineEvents) {
+            return;
+        }
         loopThread = std::thread(&GpioEncoder::loop, this);
         pthread_setname_np(loopThread.native_handle(), "gpioEncoder");
     }
@@ -80,6 +136,10 @@ public:
 
     int init()
     {
+        lineEvents = initLineEvents();
+        if (lineEvents) {
+            return 0;
+        }
         if (initGpio() == -1) {
             return -1;
         }
@@ -97,27 +157,10 @@ public:
 
     void handler()
     {
+        uint64_t tick = getTicks();
         for (auto& encoder : encoders) {
-            int levelA = gpioRead(encoder.gpioA);
-            if (levelA != encoder.levelA) {
-                encoder.levelA = levelA;
-                if (encoder.lastGpio != encoder.gpioA) {
-                    encoder.lastGpio = encoder.gpioA;
-                    if (levelA && encoder.levelB) {
-                        onEncoder(encoder, -1);
-                    }
-                }
-            }
-            int levelB = gpioRead(encoder.gpioB);
-            if (levelB != encoder.levelB) {
-                encoder.levelB = levelB;
-                if (encoder.lastGpio != encoder.gpioB) {
-                    encoder.lastGpio = encoder.gpioB;
-                    if (levelB && encoder.levelA) {
-                        onEncoder(encoder, 1);
-                    }
-                }
-            }
+            change(encoder, encoder.gpioA, gpioRead(encoder.gpioA), tick);
+            change(encoder, encoder.gpioB, gpioRead(encoder.gpioB), tick);
             LOG_GPIO_ENCODER("[%d %d %d %d] ", encoder.id, encoder.gpioA, encoder.gpioB, encoder.lastGpio);
         }
     }
@@ -7,7 +7,7 @@ The main component is the `GpioKey` class, which acts as a dedicated hardware in
 
 1.  **Setup and Initialization:** The module is configured with a list of specific pins (GPIOs) that correspond to buttons. During startup, it sets up these pins to reliably read external input.
 
-2.  **Continuous Monitoring:** It launches a dedicated, small background process (a thread) that runs continuously. This process repeatedly checks the physical state of every registered button, performing a scan approximately every 10 milliseconds.
+2.  **Continuous Monitoring:** Where the kernel provides the GPIO character device, the buttons are watched through its edge events (see `GpioLineEvents`), debounced by the kernel, nothing running while no button changes. Otherwise it launches a dedicated, small background process (a thread) that repeatedly checks the physical state of every registered button, performing a scan approximately every 10 milliseconds.
 
 3.  **State Change Notification:** If the background process detects that a button's state has changed—meaning it was either pressed down or released—it immediately triggers a custom notification mechanism. This instantly alerts the main program, providing the key's unique identifier and its new state.
 
@@ -21,6 +21,7 @@ sha: d0fe95b1242ccf45324d65c7f4e898f70ded1ae5f81989e3e681b638dba95352
 #define _HELPER_GPIO_KEY_H_
 
 #include "helpers/controller.h"
+#include "helpers/GpioLineEvents.h"
 #include "helpers/gpio.h"
 
 #include <functional>
@@ -44,11 +45,38 @@ public:
         uint8_t lastState = 0;
     };
     std::vector<Key> keys;
+    // Debounce of the edges, when reported by the GPIO character device
+    uint32_t debounceUs = 5000;
 
 protected:
     std::thread loopThread;
     bool loopRunning = true;
     std::function<void(Key, uint8_t)> onKey;
+    // Edges reported by the GPIO character device, else the pins are polled
+    bool lineEvents = false;
+
+    bool initLineEvents()
+    {
+        std::vector<uint8_t> gpios;
+        for (auto& key : keys) {
+            gpios.push_back(key.gpio);
+        }
+        std::vector<uint8_t> levels;
+        if (!GpioLineEvents::get().request(gpios, debounceUs, levels, [this](uint8_t gpio, uint8_t level, uint64_t tick) {
+                for (auto& key : keys) {
+                    if (key.gpio == gpio && key.lastState != level) {
+                        key.lastState = level;
+                        onKey(key, level);
+                    }
+                }
+            })) {
+            return false;
+        }
+        for (size_t i = 0; i < keys.size(); i++) {
+            keys[i].lastState = levels[i];
+        }
+        return true;
+    }
 
 public:
     GpioKey(std::vector<Key> keys, std::function<void(Key, uint8_t)> onKey)
@@ -59,6 +87,9 @@ public:
 
     void startThread()
     {
+        if (lineEvents) {
+            return;
+        }
         loopThread = std::thread(&GpioKey::loop, this);
         pthread_setname_np(loopThread.native_handle(), "gpioKey");
     }
@@ -78,6 +109,10 @@ public:
 
     int init()
     {
+        lineEvents = initLineEvents();
+        if (lineEvents) {
+            return 0;
+        }
         if (initGpio() == -1) {
             return -1;
         }
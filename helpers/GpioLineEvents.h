@@ -0,0 +1,164 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <functional>
+#include <list>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/ioctl.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#if __has_include(<linux/gpio.h>)
+#include <linux/gpio.h>
+#endif
+
+#include "helpers/processSingleton.h"
+#include "log.h"
+
+// GPIO inputs from the edge events of the Linux GPIO character device, instead of polling the pins: the kernel
+// reports each edge with its timestamp, and can debounce them, so no edge is missed between two polls and nothing
+// wakes up while the pins are idle. All the lines are handled by a single epoll thread.
+//
+// Needs the v2 uAPI of the GPIO character device (Linux 5.10), `request()` returning false without it, so the
+// caller can fall back to polling.
+class GpioLineEvents {
+public:
+    // Level of the pin after the edge, and time of the edge in ms, from the same clock as `getTicks()`
+    using Handler = std::function<void(uint8_t gpio, uint8_t level, uint64_t tick)>;
+
+protected:
+    struct Request {
+        int fd;
+        Handler handler;
+    };
+    // Never erased, the epoll thread holding pointers to them
+    std::list<Request> requests;
+    std::mutex mtx;
+    int chipFd = -1;
+    int epollFd = -1;
+    bool running = false;
+
+    // Chip of the pins of the header, e.g. `pinctrl-bcm2711` or `pinctrl-rp1`, else the first one
+    int openChip()
+    {
+#ifdef GPIO_V2_GET_LINE_IOCTL
+        int first = -1;
+        for (int i = 0; i < 16; i++) {
+            int fd = open(("/dev/gpiochip" + std::to_string(i)).c_str(), O_RDWR | O_CLOEXEC);
+            if (fd < 0) {
+                continue;
+            }
+            struct gpiochip_info info = {};
+            if (ioctl(fd, GPIO_GET_CHIPINFO_IOCTL, &info) == 0 && strncmp(info.label, "pinctrl-", 8) == 0) {
+                if (first >= 0) {
+                    close(first);
+                }
+                return fd;
+            }
+            if (first < 0) {
+                first = fd;
+            } else {
+                close(fd);
+            }
+        }
+        return first;
+#else
+        return -1;
+#endif
+    }
+
+    void loop()
+    {
+#ifdef GPIO_V2_GET_LINE_IOCTL
+        struct epoll_event events[8];
+        struct gpio_v2_line_event lineEvents[16];
+        while (true) {
+            int count = epoll_wait(epollFd, events, 8, -1);
+            for (int i = 0; i < count; i++) {
+                Request* request = (Request*)events[i].data.ptr;
+                ssize_t len = read(request->fd, lineEvents, sizeof(lineEvents));
+                for (int e = 0; e < len / (ssize_t)sizeof(struct gpio_v2_line_event); e++) {
+                    struct gpio_v2_line_event& event = lineEvents[e];
+                    request->handler(event.offset, event.id == GPIO_V2_LINE_EVENT_RISING_EDGE, event.timestamp_ns / 1000000);
+                }
+            }
+        }
+#endif
+    }
+
+public:
+    static GpioLineEvents& get()
+    {
+        // Never destroyed, the thread still waiting on its lines when the app exits
+        return leakedProcessSingleton<GpioLineEvents>();
+    }
+
+    // Request `gpios` as inputs with a pull-up, reporting both edges, debounced by the kernel if `debounceUs` is set.
+    // `levels` are set to the current level of each pin. The handler is called from the GPIO thread.
+    bool request(const std::vector<uint8_t>& gpios, uint32_t debounceUs, std::vector<uint8_t>& levels, Handler handler)
+    {
+#ifdef GPIO_V2_GET_LINE_IOCTL
+        if (gpios.empty() || gpios.size() > GPIO_V2_LINES_MAX) {
+            return false;
+        }
+        std::lock_guard<std::mutex> guard(mtx);
+        if (chipFd < 0 && (chipFd = openChip()) < 0) {
+            return false;
+        }
+
+        uint64_t mask = gpios.size() == 64 ? ~0ull : (1ull << gpios.size()) - 1;
+        struct gpio_v2_line_request req = {};
+        for (size_t i = 0; i < gpios.size(); i++) {
+            req.offsets[i] = gpios[i];
+        }
+        req.num_lines = gpios.size();
+        strncpy(req.consumer, "zic", sizeof(req.consumer) - 1);
+        req.config.flags = GPIO_V2_LINE_FLAG_INPUT | GPIO_V2_LINE_FLAG_EDGE_RISING | GPIO_V2_LINE_FLAG_EDGE_FALLING
+            | GPIO_V2_LINE_FLAG_BIAS_PULL_UP;
+        if (debounceUs) {
+            req.config.num_attrs = 1;
+            req.config.attrs[0].attr.id = GPIO_V2_LINE_ATTR_ID_DEBOUNCE;
+            req.config.attrs[0].attr.debounce_period_us = debounceUs;
+            req.config.attrs[0].mask = mask;
+        }
+        if (ioctl(chipFd, GPIO_V2_GET_LINE_IOCTL, &req) < 0) {
+            logWarn("GPIO line request failed: %s", strerror(errno));
+            return false;
+        }
+
+        struct gpio_v2_line_values values = {};
+        values.mask = mask;
+        ioctl(req.fd, GPIO_V2_LINE_GET_VALUES_IOCTL, &values);
+        levels.resize(gpios.size());
+        for (size_t i = 0; i < gpios.size(); i++) {
+            levels[i] = (values.bits >> i) & 1;
+        }
+
+        if (epollFd < 0) {
+            epollFd = epoll_create1(EPOLL_CLOEXEC);
+        }
+        requests.push_back({ req.fd, handler });
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.ptr = &requests.back();
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, req.fd, &event);
+        if (!running) {
+            running = true;
+            std::thread thread([this] { loop(); });
+            pthread_setname_np(thread.native_handle(), "gpioEvents");
+            // Lives as long as the app, blocked in epoll_wait
+            thread.detach();
+        }
+        return true;
+#else
+        return false;
+#endif
+    }
+};
@@ -0,0 +1,99 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+
+// LED colors as a frame: the colors set by the app, from any thread, are kept in a shadow buffer, and the thread
+// driving the device sends only the LEDs that differ from what the device shows, once per frame.
+//
+// The changed LEDs are coalesced in runs of consecutive LEDs, an unchanged LED between two changed ones being sent
+// again rather than starting a new transfer, each run being at most `maxRun` LEDs.
+template <uint16_t SIZE>
+class LedFrame {
+public:
+    struct Color {
+        uint8_t r, g, b;
+    };
+
+protected:
+    std::mutex mtx;
+    Color shadow[SIZE] = {};
+    bool changed = false;
+
+    Color shown[SIZE] = {};
+    // Nothing is known about what the device shows until it was sent once
+    bool known[SIZE] = {};
+
+public:
+    void set(uint16_t index, uint8_t r, uint8_t g, uint8_t b)
+    {
+        if (index >= SIZE) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(mtx);
+        shadow[index] = { r, g, b };
+        changed = true;
+    }
+
+    // Send the runs of changed LEDs with `write(start, count, colors)`, returning false if the transfer failed, those
+    // LEDs being sent again next frame. Returns true if anything was sent, the frame must then be shown.
+    bool flush(uint16_t maxRun, std::function<bool(uint16_t start, uint16_t count, const Color* colors)> write)
+    {
+        Color frame[SIZE];
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            if (!changed) {
+                return false;
+            }
+            memcpy(frame, shadow, sizeof(frame));
+            changed = false;
+        }
+
+        bool sent = false;
+        bool failed = false;
+        uint16_t i = 0;
+        while (i < SIZE) {
+            if (known[i] && memcmp(&frame[i], &shown[i], sizeof(Color)) == 0) {
+                i++;
+                continue;
+            }
+            uint16_t start = i;
+            uint16_t end = i + 1; // Past the last changed LED of the run
+            for (uint16_t j = end; j < SIZE && j - start < maxRun; j++) {
+                if (!known[j] || memcmp(&frame[j], &shown[j], sizeof(Color)) != 0) {
+                    end = j + 1;
+                } else if (j + 1 < SIZE && j + 1 - start < maxRun
+                    && known[j + 1] && memcmp(&frame[j + 1], &shown[j + 1], sizeof(Color)) == 0) {
+                    // Two unchanged LEDs in a row cost more than a new transfer
+                    break;
+                }
+            }
+            if (write(start, end - start, frame + start)) {
+                for (uint16_t j = start; j < end; j++) {
+                    shown[j] = frame[j];
+                    known[j] = true;
+                }
+                sent = true;
+            } else {
+                failed = true;
+            }
+            i = end;
+        }
+
+        if (failed) {
+            std::lock_guard<std::mutex> guard(mtx);
+            changed = true;
+        }
+        return sent;
+    }
+
+    // The device lost its colors, e.g. after a reset, all of them are sent again
+    void invalidate()
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        memset(known, 0, sizeof(known));
+        changed = true;
+    }
+};
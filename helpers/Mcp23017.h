@@ -14,6 +14,7 @@ The entire system relies on a standard method of communication called I2C. The s
 3.  **Input Configuration:** Functions are included to activate special internal circuits called pull-up resistors, which ensure reliable readings when connecting mechanical switches.
 4.  **Reading Status:** It can quickly read the status of all eight pins on either channel simultaneously.
 5.  **Pin Check:** Specific functions are available to check if a single individual pin is currently active or "High."
+6.  **Interrupts:** The chip can signal on its INTA/INTB outputs that an input changed, so the pins only need to be read when told so. The pins that changed, their state when it happened and their current state are then all read in a single transfer.
 
 In essence, this software makes complex hardware control accessible through simple, reliable function calls.
 
@@ -26,13 +27,25 @@ sha: ed79f688bac310ffc0e74ee7f30b42a20c1410840b5183defa4d775fd8027dff
 
 #define MCP23017_IODIRA 0x00 // I/O direction register for channel A
 #define MCP23017_IODIRB 0x01 // I/O direction register for channel B
+#define MCP23017_GPINTENA 0x04 // Interrupt-on-change enable register for channel A
+#define MCP23017_GPINTENB 0x05 // Interrupt-on-change enable register for channel B
+#define MCP23017_INTCONA 0x08 // Interrupt control register for channel A, 0 comparing to the previous value
+#define MCP23017_INTCONB 0x09 // Interrupt control register for channel B
+#define MCP23017_IOCON 0x0A // Configuration register, shared by both channels
 #define MCP23017_GPPUA 0x0C // Pull-up resistor register for channel A
 #define MCP23017_GPPUB 0x0D // Pull-up resistor register for channel B
+#define MCP23017_INTFA 0x0E // Interrupt flag register for channel A, the pins that triggered the interrupt
+#define MCP23017_INTFB 0x0F // Interrupt flag register for channel B
+#define MCP23017_INTCAPA 0x10 // Interrupt captured value for channel A, the pins when the interrupt occurred
+#define MCP23017_INTCAPB 0x11 // Interrupt captured value for channel B
 #define MCP23017_GPIOA 0x12 // GPIO register for channel A
 #define MCP23017_GPIOB 0x13 // GPIO register for channel B
 #define MCP23017_OLATA 0x14    // Output latch register for channel A
 #define MCP23017_OLATB 0x15    // Output latch register for channel B
 
+#define MCP23017_IOCON_MIRROR 0x40 // INTA and INTB both signal the changes of either channel
+#define MCP23017_IOCON_ODR 0x04 // Open-drain interrupt outputs, active low with a pull-up on the host pin
+
 class Mcp23017 {
 protected:
     I2c i2c;
@@ -116,6 +129,37 @@ public:
         return readChannel(MCP23017_GPIOB);
     }
 
+    // Interrupt on any change of the inputs of both channels, on either of INTA and INTB, cleared by reading the
+    // captured values or the pins
+    bool enableInterrupts()
+    {
+        if (i2c.writeReg(MCP23017_IOCON, MCP23017_IOCON_MIRROR | MCP23017_IOCON_ODR) != 0
+            || i2c.writeReg(MCP23017_INTCONA, 0x00) != 0 || i2c.writeReg(MCP23017_INTCONB, 0x00) != 0
+            || i2c.writeReg(MCP23017_GPINTENA, 0xFF) != 0 || i2c.writeReg(MCP23017_GPINTENB, 0xFF) != 0) {
+            logError("Failed to enable interrupts");
+            return false;
+        }
+        return true;
+    }
+
+    struct Interrupt {
+        uint8_t flagA;
+        uint8_t flagB;
+        uint8_t captureA;
+        uint8_t captureB;
+        uint8_t channelA;
+        uint8_t channelB;
+    };
+    // INTF, INTCAP and GPIO of both channels, being consecutive registers, in a single transfer
+    bool readInterrupt(Interrupt& interrupt)
+    {
+        if (i2c.readRegs(MCP23017_INTFA, (uint8_t*)&interrupt, sizeof(Interrupt)) != 0) {
+            logError("Failed to read interrupt");
+            return false;
+        }
+        return true;
+    }
+
     bool isChannelPinHigh(uint8_t channelValue, uint8_t pin) {
         return (channelValue >> pin) & 0x01;
     }
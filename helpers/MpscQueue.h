@@ -0,0 +1,72 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+
+// Bounded lock-free queue with multiple producers and a single consumer, allocation free.
+//
+// Each cell carries a sequence number telling whether it is free to write for a given position or
+// ready to be read (bounded MPMC queue from D. Vyukov, consumer side simplified as there is only one).
+template <typename T, uint32_t SIZE>
+class MpscQueue {
+protected:
+    static_assert((SIZE & (SIZE - 1)) == 0, "MpscQueue size must be a power of 2");
+    static const uint32_t MASK = SIZE - 1;
+
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        T value;
+    };
+
+    Cell cells[SIZE];
+    std::atomic<uint32_t> tail = 0;
+    uint32_t head = 0;
+
+public:
+    MpscQueue()
+    {
+        for (uint32_t i = 0; i < SIZE; i++) {
+            cells[i].sequence.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    // Return false if the queue is full
+    bool push(const T& value)
+    {
+        uint32_t pos = tail.load(std::memory_order_relaxed);
+        Cell* cell;
+        while (true) {
+            cell = &cells[pos & MASK];
+            int32_t diff = (int32_t)(cell->sequence.load(std::memory_order_acquire) - pos);
+            if (diff == 0) {
+                if (tail.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    break;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = tail.load(std::memory_order_relaxed);
+            }
+        }
+        cell->value = value;
+        cell->sequence.store(pos + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Next value to be consumed, or NULL if the queue is empty. Consumer only.
+    T* front()
+    {
+        Cell* cell = &cells[head & MASK];
+        if (cell->sequence.load(std::memory_order_acquire) != head + 1) {
+            return NULL;
+        }
+        return &cell->value;
+    }
+
+    // Release the value returned by `front()`. Consumer only.
+    void pop()
+    {
+        cells[head & MASK].sequence.store(head + SIZE, std::memory_order_release);
+        head++;
+    }
+};
@@ -9,7 +9,7 @@ Data transfer relies on specialized functions (like `writeReg` and `read`) which
 
 To handle continuous user input, the code starts a dedicated background process (a "thread") that constantly monitors the keypad for key presses or releases. When a key event is detected, the system notifies the main program using a "callback" function specified by the user.
 
-The class also provides methods to easily manage the NeoPixel illumination. Users can set the color for each of the 16 buttons, and a final command instructs the hardware to display the updated colors immediately.
+The class also provides methods to easily manage the NeoPixel illumination. Users can set the color for each of the 16 buttons at any time, the colors being kept as a frame (see `LedFrame`): the background process only sends the buttons whose color differs from what the device shows, grouped in as few transfers as possible, at most 60 times per second, followed by a single command instructing the hardware to display them. Lighting the pads during playback then keeps the bus free for reading the keys.
 
 sha: 67b2fe79e25884a2a8ed1a974973397052d5f5169919df05ef781db87f202e46 
 */
@@ -19,6 +19,9 @@ sha: 67b2fe79e25884a2a8ed1a974973397052d5f5169919df05ef781db87f202e46
 #include <fcntl.h>
 #include <functional>
 #include <iostream>
+
+#include "helpers/LedFrame.h"
+#include "helpers/getTicks.h"
 #include <linux/i2c-dev.h>
 #include <linux/i2c.h> // Required for i2c_msg and i2c_rdwr_ioctl_data structures
 #include <sys/ioctl.h>
@@ -29,12 +32,19 @@ sha: 67b2fe79e25884a2a8ed1a974973397052d5f5169919df05ef781db87f202e46
 #define NEO_TRELLIS_NUM_KEYS 16
 #define NEO_TRELLIS_KEY(x) (((x) / 4) * 8 + ((x) % 4))
 #define NEO_TRELLIS_SEESAW_KEY(x) (((x) / 8) * 4 + ((x) % 8))
+// Minimum time between 2 frames of LED colors, about 60 frames per second
+#define NEO_TRELLIS_LED_FRAME_MS 16
+// Pixels per NeoPixel buffer write, the seesaw receiving at most 32 bytes: 2 for the register, 2 for the offset
+#define NEO_TRELLIS_LED_RUN 9
 
 class NeoTrellis {
 protected:
     std::thread loopThread;
     bool loopRunning = true;
 
+    LedFrame<NEO_TRELLIS_NUM_KEYS> leds;
+    uint64_t lastFrame = 0;
+
 public:
     enum {
         SEESAW_STATUS_BASE = 0x00,
@@ -132,7 +142,6 @@ public:
         buffer.push_back(regLow); // Seesaw function address
         buffer.insert(buffer.end(), buf, buf + num);
 
-        std::this_thread::sleep_for(std::chrono::milliseconds(5));
         return writeBuffer(buffer);
     }
 
@@ -175,6 +184,8 @@ public:
             std::cerr << "Failed to send software reset: " << e.what() << std::endl;
             throw; // Re-throw to indicate critical failure
         }
+        // Time for the seesaw to restart before taking commands
+        std::this_thread::sleep_for(std::chrono::milliseconds(10));
 
         // Enable the keypad interruptNEO_TRELLIS_SEESAW_KEY
         this->write8(SEESAW_KEYPAD_BASE, SEESAW_KEYPAD_INTENSET, 0x01);
@@ -201,18 +212,16 @@ public:
     void loop()
     {
         while (loopRunning) {
-            // loop in color array
-            bool updated = false;
-            for (int i = 0; i < NEO_TRELLIS_NUM_KEYS; i++) {
-                if (colors[i].sendCount < 3) {
-                    colors[i].sendCount++;
-                    setPixelColor(i, colors[i].color);
-                    updated = true;
+            uint64_t now = getTicks();
+            if (now - lastFrame >= NEO_TRELLIS_LED_FRAME_MS) {
+                bool sent = leds.flush(NEO_TRELLIS_LED_RUN, [this](uint16_t start, uint16_t count, const LedFrame<NEO_TRELLIS_NUM_KEYS>::Color* colors) {
+                    return setPixelColors(start, count, colors);
+                });
+                if (sent) {
+                    show();
+                    lastFrame = now;
                 }
             }
-            if (updated) {
-                show();
-            }
 
             read();
             std::this_thread::sleep_for(std::chrono::milliseconds(20));
@@ -275,12 +284,8 @@ public:
         }
     };
 
-    struct ColorGrid {
-        Color color;
-        uint8_t sendCount;
-    } colors[NEO_TRELLIS_NUM_KEYS] = { 0 };
-
-    void updateColorArray(uint8_t pixel, const Color& color) { colors[pixel] = { color, 0 }; }
+    // Can be called from any thread, sent with the next frame if it differs from what the device shows
+    void updateColorArray(uint8_t pixel, const Color& color) { leds.set(pixel, color.r, color.g, color.b); }
 
     void setPixelColor(uint8_t pixel, const Color& color)
     {
@@ -291,6 +296,21 @@ public:
         this->writeReg(SEESAW_NEOPIXEL_BASE, SEESAW_NEOPIXEL_BUF, writeBuf, 5);
     }
 
+    // Consecutive pixels in a single buffer write, at most NEO_TRELLIS_LED_RUN
+    bool setPixelColors(uint16_t start, uint16_t count, const LedFrame<NEO_TRELLIS_NUM_KEYS>::Color* colors)
+    {
+        if (start + count > NEO_TRELLIS_NUM_KEYS || count > NEO_TRELLIS_LED_RUN)
+            return false;
+
+        uint8_t writeBuf[2 + NEO_TRELLIS_LED_RUN * 3] = { 0x00, (uint8_t)(start * 3) };
+        for (uint16_t i = 0; i < count; i++) {
+            writeBuf[2 + i * 3] = colors[i].g;
+            writeBuf[3 + i * 3] = colors[i].r;
+            writeBuf[4 + i * 3] = colors[i].b;
+        }
+        return this->writeReg(SEESAW_NEOPIXEL_BASE, SEESAW_NEOPIXEL_BUF, writeBuf, 2 + count * 3);
+    }
+
     void show()
     {
         this->writeReg(SEESAW_NEOPIXEL_BASE, SEESAW_NEOPIXEL_SHOW, NULL, 0);
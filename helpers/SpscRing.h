@@ -0,0 +1,83 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+
+// Bounded lock-free ring with a single producer and a single consumer, allocation free, for a stream of values
+// written and read in blocks (e.g. audio samples between the audio thread and a disk thread).
+//
+// Positions grow forever and are masked on access, so the ring can be filled completely.
+template <typename T, uint32_t SIZE>
+class SpscRing {
+protected:
+    static_assert((SIZE & (SIZE - 1)) == 0, "SpscRing size must be a power of 2");
+    static const uint32_t MASK = SIZE - 1;
+
+    T data[SIZE];
+    // Written by the producer only
+    alignas(64) std::atomic<uint32_t> writePos = 0;
+    // Written by the consumer only
+    alignas(64) std::atomic<uint32_t> readPos = 0;
+
+public:
+    // Values waiting to be read
+    uint32_t available() const
+    {
+        return writePos.load(std::memory_order_acquire) - readPos.load(std::memory_order_acquire);
+    }
+
+    // Values that can be written. Producer only.
+    uint32_t space() const
+    {
+        return SIZE - (writePos.load(std::memory_order_relaxed) - readPos.load(std::memory_order_acquire));
+    }
+
+    // Write up to `count` values, return how many fit. Producer only.
+    uint32_t write(const T* values, uint32_t count)
+    {
+        uint32_t pos = writePos.load(std::memory_order_relaxed);
+        count = std::min(count, SIZE - (pos - readPos.load(std::memory_order_acquire)));
+        uint32_t first = std::min(count, SIZE - (pos & MASK));
+        memcpy(data + (pos & MASK), values, first * sizeof(T));
+        memcpy(data, values + first, (count - first) * sizeof(T));
+        writePos.store(pos + count, std::memory_order_release);
+        return count;
+    }
+
+    // Write up to `count` values, `stride` apart in `values` (e.g. a track of an interleaved block), return how
+    // many fit. Producer only.
+    uint32_t write(const T* values, uint32_t stride, uint32_t count)
+    {
+        if (stride == 1) {
+            return write(values, count);
+        }
+        uint32_t pos = writePos.load(std::memory_order_relaxed);
+        count = std::min(count, SIZE - (pos - readPos.load(std::memory_order_acquire)));
+        for (uint32_t i = 0; i < count; i++) {
+            data[(pos + i) & MASK] = values[i * stride];
+        }
+        writePos.store(pos + count, std::memory_order_release);
+        return count;
+    }
+
+    // Read up to `count` values, return how many were read. Consumer only.
+    uint32_t read(T* values, uint32_t count)
+    {
+        uint32_t pos = readPos.load(std::memory_order_relaxed);
+        count = std::min(count, writePos.load(std::memory_order_acquire) - pos);
+        uint32_t first = std::min(count, SIZE - (pos & MASK));
+        memcpy(values, data + (pos & MASK), first * sizeof(T));
+        memcpy(values + first, data, (count - first) * sizeof(T));
+        readPos.store(pos + count, std::memory_order_release);
+        return count;
+    }
+
+    // Empty the ring, while neither side is using it
+    void reset()
+    {
+        writePos.store(0, std::memory_order_relaxed);
+        readPos.store(0, std::memory_order_relaxed);
+    }
+};
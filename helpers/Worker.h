@@ -0,0 +1,74 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <mutex>
+#include <pthread.h>
+#include <thread>
+
+// Background thread of a service, usually a process singleton (see processSingleton.h): started by the first request,
+// so a process never using the service doesn't spawn it, then stopped and joined when the service is destroyed.
+//
+// The mutex belongs to the service. It guards the state of the service, and the loop holds it while waiting on `cv`.
+// The loop must return once `isRunning()` is false. Declare the worker after the state its loop reads, so it is joined
+// before that state is destroyed, or call `stop()` first thing in the destructor of the service.
+class Worker {
+protected:
+    std::mutex& mtx;
+    const char* name;
+    std::function<void()> loop;
+    std::thread thread;
+    // Only cleared with the lock held, so a wait on `cv` checking it never misses it
+    std::atomic<bool> running = true;
+
+public:
+    std::condition_variable cv;
+
+    Worker(std::mutex& mtx, const char* name, std::function<void()> loop)
+        : mtx(mtx)
+        , name(name)
+        , loop(loop)
+    {
+    }
+
+    ~Worker()
+    {
+        stop();
+    }
+
+    // From any thread, e.g. by the loop to give up a long task without the lock
+    bool isRunning()
+    {
+        return running;
+    }
+
+    // Start the thread if not started yet. Must be called with the lock held.
+    void start()
+    {
+        if (running && !thread.joinable()) {
+            thread = std::thread(loop);
+            pthread_setname_np(thread.native_handle(), name);
+        }
+    }
+
+    // Start the thread if needed and wake it up. Must be called with the lock held.
+    void wake()
+    {
+        start();
+        cv.notify_one();
+    }
+
+    // Let the loop return and wait for it. Must be called without the lock.
+    void stop()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            running = false;
+        }
+        cv.notify_all();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+};
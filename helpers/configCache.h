@@ -0,0 +1,296 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <sstream>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "libs/nlohmann/json.hpp"
+#include "log.h"
+#include "plugins/audio/utils/FileWriter.h"
+
+// Config compiled once into a binary cache next to the JSON file, so starting the app doesn't parse a large JSON.
+//
+// The JSON file stays the source of truth: the cache holds the hash of the JSON it was compiled from, and is
+// compiled again as soon as the JSON changes. The cache is a flat array of nodes in depth first order, each object
+// key and string being an index in a table of interned strings. Loading it maps the file and builds the config in
+// a single pass, without tokenizing nor unescaping anything.
+//
+// The cache is a hidden file, `.config.json.cache` for `config.json`, saved in the background.
+class ConfigCache {
+protected:
+    static const uint32_t MAGIC = 0x5a504346; // ZPCF
+    static const uint32_t VERSION = 1;
+
+    enum Type : uint8_t {
+        TYPE_NULL,
+        TYPE_FALSE,
+        TYPE_TRUE,
+        TYPE_INT,
+        TYPE_UINT,
+        TYPE_FLOAT,
+        TYPE_STRING,
+        TYPE_ARRAY,
+        TYPE_OBJECT,
+    };
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t hash;
+        uint32_t stringCount;
+        uint32_t stringBytes;
+        uint32_t nodeCount;
+        uint32_t reserved;
+    };
+
+    struct Node {
+        Type type;
+        uint8_t reserved[3];
+        // Index of the key in the string table, for the members of an object
+        uint32_t key;
+        union {
+            int64_t i;
+            uint64_t u;
+            double f;
+            // Index in the string table for a string, count of children for an array or an object
+            uint32_t index;
+        };
+    };
+
+    struct Compiler {
+        std::vector<Node> nodes;
+        std::vector<std::string> strings;
+        std::unordered_map<std::string, uint32_t> stringIds;
+
+        uint32_t intern(const std::string& value)
+        {
+            auto it = stringIds.find(value);
+            if (it != stringIds.end()) {
+                return it->second;
+            }
+            strings.push_back(value);
+            stringIds[value] = strings.size() - 1;
+            return strings.size() - 1;
+        }
+
+        void add(const nlohmann::json& json, uint32_t key)
+        {
+            Node node = {};
+            node.key = key;
+            switch (json.type()) {
+            case nlohmann::json::value_t::boolean:
+                node.type = json.get<bool>() ? TYPE_TRUE : TYPE_FALSE;
+                break;
+            case nlohmann::json::value_t::number_integer:
+                node.type = TYPE_INT;
+                node.i = json.get<int64_t>();
+                break;
+            case nlohmann::json::value_t::number_unsigned:
+                node.type = TYPE_UINT;
+                node.u = json.get<uint64_t>();
+                break;
+            case nlohmann::json::value_t::number_float:
+                node.type = TYPE_FLOAT;
+                node.f = json.get<double>();
+                break;
+            case nlohmann::json::value_t::string:
+                node.type = TYPE_STRING;
+                node.index = intern(json.get_ref<const std::string&>());
+                break;
+            case nlohmann::json::value_t::array:
+                node.type = TYPE_ARRAY;
+                node.index = json.size();
+                break;
+            case nlohmann::json::value_t::object:
+                node.type = TYPE_OBJECT;
+                node.index = json.size();
+                break;
+            default:
+                node.type = TYPE_NULL;
+                break;
+            }
+            nodes.push_back(node);
+            if (json.is_array()) {
+                for (auto& child : json) {
+                    add(child, 0);
+                }
+            } else if (json.is_object()) {
+                for (auto it = json.begin(); it != json.end(); ++it) {
+                    add(it.value(), intern(it.key()));
+                }
+            }
+        }
+    };
+
+    struct Reader {
+        const Node* nodes;
+        uint32_t nodeCount;
+        const uint32_t* offsets;
+        const char* chars;
+        uint32_t stringCount;
+        uint32_t pos = 0;
+        bool ok = true;
+
+        std::string string(uint32_t index)
+        {
+            if (index >= stringCount) {
+                ok = false;
+                return "";
+            }
+            return std::string(chars + offsets[index], offsets[index + 1] - offsets[index]);
+        }
+
+        nlohmann::json read()
+        {
+            if (!ok || pos >= nodeCount) {
+                ok = false;
+                return nullptr;
+            }
+            const Node& node = nodes[pos++];
+            switch (node.type) {
+            case TYPE_FALSE:
+                return false;
+            case TYPE_TRUE:
+                return true;
+            case TYPE_INT:
+                return node.i;
+            case TYPE_UINT:
+                return node.u;
+            case TYPE_FLOAT:
+                return node.f;
+            case TYPE_STRING:
+                return string(node.index);
+            case TYPE_ARRAY: {
+                nlohmann::json json = nlohmann::json::array();
+                json.get_ref<nlohmann::json::array_t&>().reserve(node.index);
+                for (uint32_t i = 0; ok && i < node.index; i++) {
+                    json.push_back(read());
+                }
+                return json;
+            }
+            case TYPE_OBJECT: {
+                nlohmann::json json = nlohmann::json::object();
+                auto& object = json.get_ref<nlohmann::json::object_t&>();
+                for (uint32_t i = 0; ok && i < node.index; i++) {
+                    std::string key = pos < nodeCount ? string(nodes[pos].key) : "";
+                    // Compiled in the order of the keys, each one is inserted at the end
+                    object.emplace_hint(object.end(), std::move(key), read());
+                }
+                return json;
+            }
+            default:
+                return nullptr;
+            }
+        }
+    };
+
+    static std::string cachePath(const std::string& path)
+    {
+        size_t slash = path.find_last_of('/');
+        size_t name = slash == std::string::npos ? 0 : slash + 1;
+        return path.substr(0, name) + "." + path.substr(name) + ".cache";
+    }
+
+public:
+    // Binary form of the config, compiled from the JSON of hash `hash`
+    static std::string compile(const nlohmann::json& json, uint64_t hash)
+    {
+        Compiler compiler;
+        compiler.add(json, 0);
+
+        std::vector<uint32_t> offsets = { 0 };
+        for (auto& value : compiler.strings) {
+            offsets.push_back(offsets.back() + value.size());
+        }
+        Header header = { MAGIC, VERSION, hash, (uint32_t)compiler.strings.size(), offsets.back(), (uint32_t)compiler.nodes.size(), 0 };
+
+        std::string data;
+        data.append((const char*)&header, sizeof(header));
+        data.append((const char*)compiler.nodes.data(), compiler.nodes.size() * sizeof(Node));
+        data.append((const char*)offsets.data(), offsets.size() * sizeof(uint32_t));
+        for (auto& value : compiler.strings) {
+            data.append(value);
+        }
+        return data;
+    }
+
+    // Config from the cache at `path`, if it was compiled from the JSON of hash `hash`
+    static bool loadCache(const std::string& path, uint64_t hash, nlohmann::json& json)
+    {
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header)) {
+            close(fd);
+            return false;
+        }
+        size_t size = info.st_size;
+        void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        close(fd);
+        if (map == MAP_FAILED) {
+            return false;
+        }
+
+        const char* data = (const char*)map;
+        Header header;
+        memcpy(&header, data, sizeof(header));
+        size_t nodesSize = (size_t)header.nodeCount * sizeof(Node);
+        size_t offsetsSize = ((size_t)header.stringCount + 1) * sizeof(uint32_t);
+        bool ok = header.magic == MAGIC && header.version == VERSION && header.hash == hash
+            && sizeof(Header) + nodesSize + offsetsSize + header.stringBytes == size;
+        if (ok) {
+            Reader reader = { (const Node*)(data + sizeof(Header)), header.nodeCount,
+                (const uint32_t*)(data + sizeof(Header) + nodesSize),
+                data + sizeof(Header) + nodesSize + offsetsSize, header.stringCount };
+            ok = reader.offsets[header.stringCount] == header.stringBytes;
+            for (uint32_t i = 0; ok && i < header.stringCount; i++) {
+                ok = reader.offsets[i] <= reader.offsets[i + 1];
+            }
+            if (ok) {
+                json = reader.read();
+                ok = reader.ok && reader.pos == header.nodeCount;
+            }
+        }
+        munmap(map, size);
+        return ok;
+    }
+
+    // Config of the JSON file at `path`, from its cache when it is up to date, else parsing the JSON and compiling
+    // the cache again. Throws like `nlohmann::json::parse` when the JSON is not valid.
+    static nlohmann::json load(const std::string& path)
+    {
+        std::ifstream file(path, std::ios::binary);
+        if (!file.is_open()) {
+            throw std::runtime_error("unable to open " + path);
+        }
+        std::stringstream buffer;
+        buffer << file.rdbuf();
+        std::string content = buffer.str();
+        uint64_t hash = std::hash<std::string>()(content);
+
+        nlohmann::json json;
+        if (loadCache(cachePath(path), hash, json)) {
+            logDebug("Config loaded from cache: %s", cachePath(path).c_str());
+            return json;
+        }
+
+        json = nlohmann::json::parse(content);
+        if (!json.is_object()) {
+            throw std::runtime_error("the config must be a JSON object: " + path);
+        }
+        // The folder might be read only, the app then parses the JSON each time
+        FileWriter::get().write(cachePath(path), compile(json, hash));
+        return json;
+    }
+};
@@ -33,7 +33,8 @@ sha: 2307d1c1c5a960871b59f98e951665bb986eb2ad096fa9459daf50b7b0927e85
 struct ConfigWatcherParams {
     std::string configFilepath;
     bool* running;
-    std::function<void()> callback;
+    // Return true if the change was applied, else the app is stopped to be restarted
+    std::function<bool()> callback;
 };
 
 void* watchConfig(void* params)
@@ -85,8 +86,12 @@ void* watchConfig(void* params)
 
             if (event->len > 0 && configFilename == event->name) {
                 if (event->mask & (IN_MODIFY | IN_CLOSE_WRITE | IN_ATTRIB | IN_MOVED_TO)) {
-                    logInfo("Config file changed: " + p->configFilepath + ", exiting app.");
-                    p->callback();
+                    logInfo("Config file changed: " + p->configFilepath);
+                    if (p->callback()) {
+                        ptr += sizeof(struct inotify_event) + event->len;
+                        continue;
+                    }
+                    logInfo("Exiting app.");
                     *(p->running) = false;
                     close(wd);
                     close(fd);
@@ -103,7 +108,7 @@ void* watchConfig(void* params)
     return nullptr;
 }
 
-pthread_t configWatcher(const std::string& filepath, bool* running, std::function<void()> callback)
+pthread_t configWatcher(const std::string& filepath, bool* running, std::function<bool()> callback)
 {
     pthread_t watcherTid;
     const char* watchEnv = std::getenv("WATCH");
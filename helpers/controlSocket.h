@@ -0,0 +1,276 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <fcntl.h>
+#include <fstream>
+#include <functional>
+#include <limits.h>
+#include <pthread.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/inotify.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+
+#include "log.h"
+
+// Control endpoint for external scripts and tooling, handled by a single epoll thread:
+// - a Unix socket accepting newline-delimited commands, each answered with a line, e.g. `echo "get Volume -1 VOLUME" |
+//   nc -U /tmp/zic.sock`. A path starting with `@` is in the abstract namespace, without any file.
+// - a file watched with inotify, for the scripts without a socket client: each line is a command, the file being
+//   deleted once read. Nothing is polled, the filesystem is only touched when the file is written.
+class ControlSocket {
+public:
+    // Answer of the command, without the trailing newline
+    using Handler = std::function<std::string(const std::string& command)>;
+
+protected:
+    Handler handler;
+    std::string path;
+    int listenFd = -1;
+
+    Handler fileHandler;
+    std::string fileDir;
+    std::string fileName;
+    int inotifyFd = -1;
+
+    int epollFd = -1;
+    int stopFd = -1;
+    std::thread thread;
+
+    // Bytes received from each client, until a newline completes the command
+    std::unordered_map<int, std::string> clients;
+
+    void add(int fd)
+    {
+        struct epoll_event event = {};
+        event.events = EPOLLIN;
+        event.data.fd = fd;
+        epoll_ctl(epollFd, EPOLL_CTL_ADD, fd, &event);
+    }
+
+    void closeClient(int fd)
+    {
+        epoll_ctl(epollFd, EPOLL_CTL_DEL, fd, NULL);
+        close(fd);
+        clients.erase(fd);
+    }
+
+    void receive(int fd)
+    {
+        char buffer[512];
+        while (true) {
+            ssize_t len = read(fd, buffer, sizeof(buffer));
+            if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+                return;
+            }
+            if (len <= 0) {
+                closeClient(fd);
+                return;
+            }
+            std::string& pending = clients[fd];
+            pending.append(buffer, len);
+            size_t end;
+            while ((end = pending.find('\n')) != std::string::npos) {
+                std::string command = pending.substr(0, end);
+                pending.erase(0, end + 1);
+                if (!command.empty() && command.back() == '\r') {
+                    command.pop_back();
+                }
+                if (command.empty()) {
+                    continue;
+                }
+                std::string answer = handler(command) + "\n";
+                send(fd, answer.c_str(), answer.size(), MSG_NOSIGNAL);
+            }
+            // A client never sending a newline would grow it forever
+            if (pending.size() > 4096) {
+                closeClient(fd);
+                return;
+            }
+        }
+    }
+
+    void readFile()
+    {
+        std::string filepath = fileDir + "/" + fileName;
+        std::ifstream file(filepath);
+        if (!file) {
+            return;
+        }
+        std::string line;
+        while (std::getline(file, line)) {
+            if (!line.empty()) {
+                fileHandler(line);
+            }
+        }
+        file.close();
+        if (std::remove(filepath.c_str()) != 0) {
+            logWarn("Failed to delete control file %s", filepath.c_str());
+        }
+    }
+
+    void loop()
+    {
+        struct epoll_event events[8];
+        while (true) {
+            int count = epoll_wait(epollFd, events, 8, -1);
+            for (int i = 0; i < count; i++) {
+                int fd = events[i].data.fd;
+                if (fd == stopFd) {
+                    return;
+                }
+                if (fd == listenFd) {
+                    int client;
+                    while ((client = accept4(listenFd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC)) >= 0) {
+                        clients[client] = "";
+                        add(client);
+                    }
+                } else if (fd == inotifyFd) {
+                    alignas(struct inotify_event) char buffer[4096];
+                    bool written = false;
+                    ssize_t len;
+                    while ((len = read(inotifyFd, buffer, sizeof(buffer))) > 0) {
+                        for (char* ptr = buffer; ptr < buffer + len;) {
+                            struct inotify_event* event = (struct inotify_event*)ptr;
+                            written = written || (event->len && fileName == event->name);
+                            ptr += sizeof(struct inotify_event) + event->len;
+                        }
+                    }
+                    if (written) {
+                        readFile();
+                    }
+                } else {
+                    receive(fd);
+                }
+            }
+        }
+    }
+
+    bool listenOn(const std::string& value)
+    {
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        bool abstract = value[0] == '@';
+        if (value.size() >= sizeof(addr.sun_path)) {
+            logWarn("Control socket path too long: %s", value.c_str());
+            return false;
+        }
+        socklen_t len;
+        if (abstract) {
+            // Leading null byte, the name is not null terminated
+            memcpy(addr.sun_path + 1, value.c_str() + 1, value.size() - 1);
+            len = offsetof(struct sockaddr_un, sun_path) + value.size();
+        } else {
+            strcpy(addr.sun_path, value.c_str());
+            len = sizeof(addr);
+            // Left by a previous run
+            unlink(value.c_str());
+        }
+        listenFd = socket(AF_UNIX, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        if (listenFd < 0 || bind(listenFd, (struct sockaddr*)&addr, len) < 0 || listen(listenFd, 4) < 0) {
+            logWarn("Control socket %s: %s", value.c_str(), strerror(errno));
+            if (listenFd >= 0) {
+                close(listenFd);
+                listenFd = -1;
+            }
+            return false;
+        }
+        path = abstract ? "" : value;
+        add(listenFd);
+        return true;
+    }
+
+    bool watchOn(const std::string& filepath)
+    {
+        size_t lastSlash = filepath.find_last_of('/');
+        fileDir = lastSlash != std::string::npos ? filepath.substr(0, lastSlash) : ".";
+        fileName = lastSlash != std::string::npos ? filepath.substr(lastSlash + 1) : filepath;
+        inotifyFd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+        if (inotifyFd < 0 || inotify_add_watch(inotifyFd, fileDir.c_str(), IN_CLOSE_WRITE | IN_MOVED_TO) < 0) {
+            logWarn("Control file %s: %s", filepath.c_str(), strerror(errno));
+            if (inotifyFd >= 0) {
+                close(inotifyFd);
+                inotifyFd = -1;
+            }
+            return false;
+        }
+        add(inotifyFd);
+        return true;
+    }
+
+public:
+    ~ControlSocket()
+    {
+        stop();
+    }
+
+    bool running()
+    {
+        return thread.joinable();
+    }
+
+    // Listen on the socket `socketPath` and watch `filepath`, one of them being optional if empty. Commands are handled
+    // on the control thread, `onCommand` answering the socket clients, `onFileCommand` the lines of the file.
+    bool start(const std::string& socketPath, Handler onCommand, const std::string& filepath = "", Handler onFileCommand = NULL)
+    {
+        if (running()) {
+            return false;
+        }
+        handler = onCommand;
+        fileHandler = onFileCommand ? onFileCommand : onCommand;
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        if (epollFd < 0 || stopFd < 0) {
+            logWarn("Control socket: %s", strerror(errno));
+            return false;
+        }
+        add(stopFd);
+        bool listening = !socketPath.empty() && listenOn(socketPath);
+        bool watching = !filepath.empty() && watchOn(filepath);
+        if (!listening && !watching) {
+            return false;
+        }
+        if (watching) {
+            // Written before the app was started
+            readFile();
+        }
+        thread = std::thread([this] { loop(); });
+        pthread_setname_np(thread.native_handle(), "control");
+        return true;
+    }
+
+    void stop()
+    {
+        if (thread.joinable()) {
+            uint64_t value = 1;
+            if (write(stopFd, &value, sizeof(value)) == sizeof(value)) {
+                thread.join();
+            } else {
+                thread.detach();
+            }
+        }
+        for (auto& client : clients) {
+            close(client.first);
+        }
+        clients.clear();
+        for (int* fd : { &listenFd, &inotifyFd, &stopFd, &epollFd }) {
+            if (*fd >= 0) {
+                close(*fd);
+                *fd = -1;
+            }
+        }
+        if (!path.empty()) {
+            unlink(path.c_str());
+            path = "";
+        }
+    }
+};
@@ -13,15 +13,53 @@ The core idea is to measure the speed of the input:
 
 Finally, the original intended direction is multiplied by this adjusted speed factor. The result is a scaled movement value. This makes the input feel dynamic: a slow turn results in small, precise steps, while a fast turn results in large steps, allowing the user to traverse a range quickly.
 
+The `EncoderCurve` structure makes this configurable: how the speed factor grows with the speed (not at all, linearly or quadratically), the time between two steps under which acceleration starts, and its maximum.
+
 sha: 64eeef851c0b13fb1a2c71ffdc50cc6deaa550af1b15a2de3673eebb3f3d04fd 
 */
 #pragma once
 
 #include <cmath>
 #include <cstdint>
+#include <string>
 
 #include "helpers/clamp.h"
 
+// Speed factor of an encoder step from the time since the previous one, `slowMs` and more being 1x
+struct EncoderCurve {
+    enum Type {
+        NONE,
+        LINEAR,
+        QUADRATIC,
+    };
+    Type type = LINEAR;
+    float slowMs = 200.0f;
+    float maxFactor = 10.0f;
+
+    float factor(uint64_t delta) const
+    {
+        if (type == NONE) {
+            return 1.0f;
+        }
+        float speed = slowMs / (delta ? delta : 1);
+        if (type == QUADRATIC) {
+            speed *= speed;
+        }
+        return CLAMP(speed, 1.0f, maxFactor);
+    }
+
+    static Type getType(const std::string& name)
+    {
+        if (name == "none") {
+            return NONE;
+        }
+        if (name == "quadratic") {
+            return QUADRATIC;
+        }
+        return LINEAR;
+    }
+};
+
 int encGetScaledDirection(int8_t direction, uint32_t tick, uint32_t lastTick)
 {
     // Calculate time difference between ticks
@@ -0,0 +1,83 @@
+#pragma once
+
+#include <cerrno>
+#include <fcntl.h>
+#include <poll.h>
+#include <spawn.h>
+#include <string>
+#include <sys/wait.h>
+#include <unistd.h>
+
+extern char** environ;
+
+// Run a shell command and return what it printed on stdout. The process is started with posix_spawn(), sharing the
+// memory of the UI until the exec (vfork), instead of duplicating its mappings like a fork() would on every call.
+// - `err`: the stderr of the command, else stderr is merged in the output, like `2>&1`
+// - `status`: its exit code, -1 if it could not run or was killed
+// Blocking: meant for the workers of the task executor (see taskExecutor.h), never the UI thread.
+inline std::string execCmd(const std::string& cmd, std::string* err = NULL, int* status = NULL)
+{
+    if (status) {
+        *status = -1;
+    }
+    int out[2];
+    int errFds[2] = { -1, -1 };
+    if (pipe2(out, O_CLOEXEC) != 0) {
+        return "";
+    }
+    if (err && pipe2(errFds, O_CLOEXEC) != 0) {
+        close(out[0]);
+        close(out[1]);
+        return "";
+    }
+
+    posix_spawn_file_actions_t actions;
+    posix_spawn_file_actions_init(&actions);
+    posix_spawn_file_actions_adddup2(&actions, out[1], STDOUT_FILENO);
+    posix_spawn_file_actions_adddup2(&actions, err ? errFds[1] : out[1], STDERR_FILENO);
+    const char* argv[] = { "sh", "-c", cmd.c_str(), NULL };
+    pid_t pid;
+    int spawned = posix_spawn(&pid, "/bin/sh", &actions, NULL, (char* const*)argv, environ);
+    posix_spawn_file_actions_destroy(&actions);
+    close(out[1]);
+    if (err) {
+        close(errFds[1]);
+    }
+
+    std::string result;
+    if (spawned == 0) {
+        // Both pipes are read together, a command filling one of them would otherwise wait forever
+        struct pollfd fds[2] = { { out[0], POLLIN, 0 }, { err ? errFds[0] : -1, POLLIN, 0 } };
+        char buffer[512];
+        while (fds[0].fd >= 0 || fds[1].fd >= 0) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                break;
+            }
+            for (int i = 0; i < 2; i++) {
+                if (fds[i].fd < 0 || !fds[i].revents) {
+                    continue;
+                }
+                ssize_t n = read(fds[i].fd, buffer, sizeof(buffer));
+                if (n > 0) {
+                    (i == 0 ? result : *err).append(buffer, n);
+                } else if (n == 0 || errno != EINTR) {
+                    fds[i].fd = -1;
+                }
+            }
+        }
+        int wstatus = 0;
+        while (waitpid(pid, &wstatus, 0) < 0 && errno == EINTR) {
+        }
+        if (status && WIFEXITED(wstatus)) {
+            *status = WEXITSTATUS(wstatus);
+        }
+    }
+    close(out[0]);
+    if (err) {
+        close(errFds[0]);
+    }
+    return result;
+}
@@ -0,0 +1,103 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+
+#include "helpers/processSingleton.h"
+
+// Paces the frames of the UI thread: instead of rendering at a fixed interval, the UI thread sleeps until a frame is
+// actually needed:
+// - `wake()` when a component was queued for rendering, the frame is rendered right away, at most `maxFps` per second
+// - `interact()` on user input, the following frames being rendered at `maxFps` for a short while, so the encoders
+//   feel snappy
+// - `animate()` while components with a rendering job are visible, these polling their state on each frame, the next
+//   frame is rendered after `1000 / animationFps` ms
+// Without any of these, the UI thread sleeps until the next one.
+class FrameScheduler {
+protected:
+    using Clock = std::chrono::steady_clock;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool woken = false;
+    bool animating = false;
+    Clock::time_point lastFrame = Clock::now();
+    Clock::time_point lastInteraction = Clock::time_point();
+
+    // How long after an input the frames are still rendered at the maximum rate
+    static constexpr std::chrono::milliseconds INTERACTION_TIME = std::chrono::milliseconds(500);
+
+public:
+    int maxFps = 60;
+    int animationFps = 12;
+
+    static FrameScheduler& get()
+    {
+        return processSingleton<FrameScheduler>();
+    }
+
+    void wake()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            if (woken) {
+                return;
+            }
+            woken = true;
+        }
+        cv.notify_one();
+    }
+
+    void interact()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            lastInteraction = Clock::now();
+            woken = true;
+        }
+        cv.notify_one();
+    }
+
+    // Called while rendering a frame, the next frame being due at the animation rate
+    void animate()
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        animating = true;
+    }
+
+    // Sleep until the next frame is due, waiting at most `maxWaitMs` if set, e.g. when the events must be polled.
+    // Return true if a frame should be rendered.
+    bool wait(int maxWaitMs = -1)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        Clock::time_point animationDeadline = animating
+            ? lastFrame + std::chrono::milliseconds(1000 / std::max(animationFps, 1))
+            : Clock::time_point::max();
+        Clock::time_point deadline = animationDeadline;
+        if (maxWaitMs >= 0) {
+            deadline = std::min(deadline, Clock::now() + std::chrono::milliseconds(maxWaitMs));
+        }
+        if (deadline == Clock::time_point::max()) {
+            cv.wait(lock, [&] { return woken; });
+        } else {
+            cv.wait_until(lock, deadline, [&] { return woken || Clock::now() >= deadline; });
+        }
+        if (!woken && Clock::now() < animationDeadline) {
+            return false;
+        }
+        // Keep the frame rate under the maximum, a burst of wakes is a single frame
+        Clock::time_point next = lastFrame + std::chrono::microseconds(1000000 / std::max(maxFps, 1));
+        if (Clock::now() < next) {
+            lock.unlock();
+            std::this_thread::sleep_until(next);
+            lock.lock();
+        }
+        woken = Clock::now() - lastInteraction < INTERACTION_TIME;
+        animating = false;
+        lastFrame = Clock::now();
+        return true;
+    }
+};
@@ -0,0 +1,662 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <sstream>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "draw/rgb565.h"
+#include "helpers/getTicks.h"
+#include "log.h"
+
+#define FRAME_STREAM_MAX_CLIENTS 4
+// A client with more than this waiting to be sent is too slow for the stream, it is dropped
+#define FRAME_STREAM_MAX_BACKLOG (4 * 1024 * 1024)
+#define FRAME_STREAM_MAX_REQUEST 8192
+
+// Remote view of the UI in a web browser, e.g. to debug a headless unit or show the screen to a class, served over
+// HTTP and a WebSocket by a single epoll thread: `GET /` answers the page, which connects to `/ws`.
+//
+// The UI thread calls `capture()` after each frame: the tiles the renderer flushed are compared to the last frame
+// streamed, and the ones that changed are copied. At most `fps` times per second, once the clients received the
+// previous frame, the network thread sends them the changed tiles as a binary message, little endian:
+// - uint16 width, height, tile size, tile count
+// - for each tile: uint16 column, row, then the pixels of the tile clipped to the screen, row by row, as runs of
+//   uint8 length - 1 and uint16 RGB565 color
+// Without client, `capture()` returns right away and the renderers don't keep the tiles.
+//
+// The page sends back text messages, handled as the controllers' input:
+// - `key <scancode> <state>`, the keys of the browser mapped to the SDL scancodes, as the desktop renderers
+// - `wheel <x> <y> <direction>`, the mouse wheel turning the encoder at this position of the screen
+class FrameStreamServer {
+public:
+    struct Handlers {
+        std::function<void(uint16_t id, int key, int8_t state)> key;
+        std::function<void(int x, int y, int8_t direction)> wheel;
+        // A client connected, the UI should render a frame so it gets the whole screen
+        std::function<void()> wake;
+    };
+
+    static const int TILE = 16;
+
+protected:
+    struct Client {
+        int fd;
+        bool upgraded = false;
+        bool closing = false;
+        std::string in;
+        std::string out;
+    };
+
+    Handlers handlers;
+    int fd = -1;
+    int epollFd = -1;
+    int stopFd = -1;
+    std::thread thread;
+    uint32_t frameMs = 50;
+    uint64_t lastFrame = 0;
+    std::vector<Client> clients;
+
+    // Clients the frames are streamed to, read by the UI thread
+    std::atomic<uint32_t> viewers = 0;
+    std::atomic<bool> fullFrame = false;
+
+    // Last frame captured, written by the UI thread and encoded by the network thread
+    std::mutex frameMtx;
+    int width = 0;
+    int height = 0;
+    int tileCols = 0;
+    int tileRows = 0;
+    std::vector<uint16_t> shadow;
+    std::vector<uint8_t> changed;
+    bool hasChanges = false;
+    std::vector<uint16_t> row;
+    std::vector<uint8_t> frame;
+
+    static const char* page()
+    {
+        return R"(<!DOCTYPE html>
+<html><head><meta charset="utf-8"><title>zic</title>
+<style>body{margin:0;background:#111;display:flex;height:100vh;align-items:center;justify-content:center}
+canvas{image-rendering:pixelated;max-width:100vw;max-height:100vh;width:100vw;object-fit:contain;outline:none}</style>
+</head><body><canvas id="c" tabindex="0"></canvas><script>
+const c = document.getElementById("c"), g = c.getContext("2d");
+const named = { Enter: 40, Escape: 41, Backspace: 42, Tab: 43, Space: 44, Minus: 45, Equal: 46, BracketLeft: 47,
+  BracketRight: 48, Backslash: 49, Semicolon: 51, Quote: 52, Backquote: 53, Comma: 54, Period: 55, Slash: 56,
+  ArrowRight: 79, ArrowLeft: 80, ArrowDown: 81, ArrowUp: 82, ShiftLeft: 225, ShiftRight: 229, ControlLeft: 224 };
+function scancode(code) {
+  let m = code.match(/^Key([A-Z])$/);
+  if (m) return m[1].charCodeAt(0) - 61;
+  m = code.match(/^Digit([0-9])$/);
+  if (m) return m[1] == "0" ? 39 : 29 + Number(m[1]);
+  m = code.match(/^F([0-9]+)$/);
+  if (m && m[1] <= 12) return 57 + Number(m[1]);
+  return named[code];
+}
+let img = null, ws = null;
+function connect() {
+  ws = new WebSocket((location.protocol == "https:" ? "wss://" : "ws://") + location.host + "/ws");
+  ws.binaryType = "arraybuffer";
+  ws.onmessage = (e) => {
+    const d = new DataView(e.data);
+    const w = d.getUint16(0, true), h = d.getUint16(2, true), t = d.getUint16(4, true), n = d.getUint16(6, true);
+    if (!img || img.width != w || img.height != h) {
+      c.width = w; c.height = h; img = g.createImageData(w, h);
+    }
+    const px = img.data;
+    let o = 8;
+    for (let i = 0; i < n; i++) {
+      const tx = d.getUint16(o, true) * t, ty = d.getUint16(o + 2, true) * t;
+      o += 4;
+      const tw = Math.min(t, w - tx), count = tw * Math.min(t, h - ty);
+      for (let p = 0; p < count;) {
+        const k = d.getUint8(o) + 1, v = d.getUint16(o + 1, true);
+        o += 3;
+        const r = (v >> 8) & 0xf8, gr = (v >> 3) & 0xfc, b = (v << 3) & 0xf8;
+        for (let j = 0; j < k; j++, p++) {
+          const q = ((ty + ((p / tw) | 0)) * w + tx + (p % tw)) * 4;
+          px[q] = r | (r >> 5); px[q + 1] = gr | (gr >> 6); px[q + 2] = b | (b >> 5); px[q + 3] = 255;
+        }
+      }
+    }
+    g.putImageData(img, 0, 0);
+  };
+  ws.onclose = () => setTimeout(connect, 1000);
+}
+function key(e, state) {
+  const k = scancode(e.code);
+  if (k === undefined || e.repeat || ws.readyState != 1) return;
+  ws.send("key " + k + " " + state);
+  e.preventDefault();
+}
+onkeydown = (e) => key(e, 1);
+onkeyup = (e) => key(e, 0);
+c.onwheel = (e) => {
+  const r = c.getBoundingClientRect(), scale = Math.min(r.width / c.width, r.height / c.height);
+  const x = (e.clientX - r.left - (r.width - c.width * scale) / 2) / scale;
+  const y = (e.clientY - r.top - (r.height - c.height * scale) / 2) / scale;
+  if (ws.readyState == 1) ws.send("wheel " + (x | 0) + " " + (y | 0) + " " + (e.deltaY < 0 ? 1 : -1));
+  e.preventDefault();
+};
+connect();
+c.focus();
+</script></body></html>
+)";
+    }
+
+    static void sha1(const std::string& input, uint8_t digest[20])
+    {
+        uint32_t h[5] = { 0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0 };
+        std::string data = input;
+        uint64_t bits = (uint64_t)input.size() * 8;
+        data += (char)0x80;
+        while (data.size() % 64 != 56) {
+            data += (char)0;
+        }
+        for (int i = 7; i >= 0; i--) {
+            data += (char)(bits >> (i * 8));
+        }
+        auto rotate = [](uint32_t value, int count) { return (value << count) | (value >> (32 - count)); };
+        for (size_t chunk = 0; chunk < data.size(); chunk += 64) {
+            uint32_t w[80];
+            for (int i = 0; i < 16; i++) {
+                const uint8_t* p = (const uint8_t*)data.data() + chunk + i * 4;
+                w[i] = ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+            }
+            for (int i = 16; i < 80; i++) {
+                w[i] = rotate(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+            }
+            uint32_t a = h[0], b = h[1], c = h[2], d = h[3], e = h[4];
+            for (int i = 0; i < 80; i++) {
+                uint32_t f, k;
+                if (i < 20) {
+                    f = (b & c) | (~b & d);
+                    k = 0x5A827999;
+                } else if (i < 40) {
+                    f = b ^ c ^ d;
+                    k = 0x6ED9EBA1;
+                } else if (i < 60) {
+                    f = (b & c) | (b & d) | (c & d);
+                    k = 0x8F1BBCDC;
+                } else {
+                    f = b ^ c ^ d;
+                    k = 0xCA62C1D6;
+                }
+                uint32_t temp = rotate(a, 5) + f + e + k + w[i];
+                e = d;
+                d = c;
+                c = rotate(b, 30);
+                b = a;
+                a = temp;
+            }
+            h[0] += a;
+            h[1] += b;
+            h[2] += c;
+            h[3] += d;
+            h[4] += e;
+        }
+        for (int i = 0; i < 5; i++) {
+            for (int j = 0; j < 4; j++) {
+                digest[i * 4 + j] = h[i] >> (24 - j * 8);
+            }
+        }
+    }
+
+    static std::string base64(const uint8_t* data, size_t size)
+    {
+        static const char* chars = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+        std::string out;
+        for (size_t i = 0; i < size; i += 3) {
+            uint32_t value = data[i] << 16 | (i + 1 < size ? data[i + 1] << 8 : 0) | (i + 2 < size ? data[i + 2] : 0);
+            out += chars[(value >> 18) & 63];
+            out += chars[(value >> 12) & 63];
+            out += i + 1 < size ? chars[(value >> 6) & 63] : '=';
+            out += i + 2 < size ? chars[value & 63] : '=';
+        }
+        return out;
+    }
+
+    // Value of the `name` header, lower case, of the request
+    static std::string header(const std::string& request, const std::string& name)
+    {
+        std::string lower = request;
+        for (char& ch : lower) {
+            ch = tolower(ch);
+        }
+        size_t start = lower.find("\r\n" + name + ":");
+        if (start == std::string::npos) {
+            return "";
+        }
+        start += name.size() + 3;
+        size_t end = request.find("\r\n", start);
+        std::string value = request.substr(start, end - start);
+        size_t first = value.find_first_not_of(" \t");
+        size_t last = value.find_last_not_of(" \t");
+        return first == std::string::npos ? "" : value.substr(first, last - first + 1);
+    }
+
+    static void wsFrame(std::string& out, uint8_t opcode, const uint8_t* data, size_t size)
+    {
+        out += (char)(0x80 | opcode);
+        if (size < 126) {
+            out += (char)size;
+        } else if (size < 65536) {
+            out += (char)126;
+            out += (char)(size >> 8);
+            out += (char)size;
+        } else {
+            out += (char)127;
+            for (int i = 7; i >= 0; i--) {
+                out += (char)((uint64_t)size >> (i * 8));
+            }
+        }
+        out.append((const char*)data, size);
+    }
+
+    void handleRequest(Client& client)
+    {
+        size_t end = client.in.find("\r\n\r\n");
+        if (end == std::string::npos) {
+            client.closing = client.in.size() > FRAME_STREAM_MAX_REQUEST;
+            return;
+        }
+        std::string request = client.in.substr(0, end + 2);
+        client.in.erase(0, end + 4);
+        std::istringstream line(request);
+        std::string method, path;
+        line >> method >> path;
+
+        std::string key = header(request, "sec-websocket-key");
+        if (method == "GET" && path == "/ws" && !key.empty()) {
+            uint8_t digest[20];
+            sha1(key + "258EAFA5-E914-47DA-95CA-C5AB0DC85B11", digest);
+            client.out += "HTTP/1.1 101 Switching Protocols\r\nUpgrade: websocket\r\nConnection: Upgrade\r\n"
+                          "Sec-WebSocket-Accept: "
+                + base64(digest, 20) + "\r\n\r\n";
+            client.upgraded = true;
+            viewers++;
+            fullFrame = true;
+            if (handlers.wake) {
+                handlers.wake();
+            }
+            logInfo("Remote UI client connected");
+            return;
+        }
+        bool found = method == "GET" && path == "/";
+        std::string body = found ? page() : "Not found\n";
+        client.out += std::string(found ? "HTTP/1.1 200 OK\r\nContent-Type: text/html\r\n" : "HTTP/1.1 404 Not Found\r\n")
+            + "Content-Length: " + std::to_string(body.size()) + "\r\nConnection: close\r\n\r\n" + body;
+        client.closing = true;
+    }
+
+    void handleText(const std::string& text)
+    {
+        std::istringstream stream(text);
+        std::string action;
+        int a, b, c;
+        if (!(stream >> action >> a >> b)) {
+            return;
+        }
+        if (action == "key" && handlers.key) {
+            handlers.key(0, a, b ? 1 : 0);
+        } else if (action == "wheel" && (stream >> c) && handlers.wheel) {
+            handlers.wheel(a, b, c > 0 ? 1 : -1);
+        }
+    }
+
+    // Client messages are masked, and small: fragmented ones are not expected
+    void handleMessages(Client& client)
+    {
+        while (client.in.size() >= 2) {
+            const uint8_t* p = (const uint8_t*)client.in.data();
+            uint8_t opcode = p[0] & 0x0f;
+            uint64_t size = p[1] & 0x7f;
+            size_t offset = 2;
+            if (size == 126) {
+                if (client.in.size() < 4) {
+                    return;
+                }
+                size = (p[2] << 8) | p[3];
+                offset = 4;
+            } else if (size == 127) {
+                client.closing = true;
+                return;
+            }
+            if (!(p[1] & 0x80)) {
+                client.closing = true;
+                return;
+            }
+            if (client.in.size() < offset + 4 + size) {
+                return;
+            }
+            const uint8_t* mask = p + offset;
+            std::string payload = client.in.substr(offset + 4, size);
+            for (size_t i = 0; i < payload.size(); i++) {
+                payload[i] ^= mask[i % 4];
+            }
+            client.in.erase(0, offset + 4 + size);
+            if (opcode == 0x1) {
+                handleText(payload);
+            } else if (opcode == 0x8) {
+                wsFrame(client.out, 0x8, NULL, 0);
+                client.closing = true;
+                return;
+            } else if (opcode == 0x9) {
+                wsFrame(client.out, 0xA, (const uint8_t*)payload.data(), payload.size());
+            }
+        }
+    }
+
+    void watch(int watched, uint32_t events, int op)
+    {
+        struct epoll_event event = {};
+        event.events = events;
+        event.data.fd = watched;
+        epoll_ctl(epollFd, op, watched, &event);
+    }
+
+    void flush(Client& client)
+    {
+        while (!client.out.empty()) {
+            ssize_t sent = send(client.fd, client.out.data(), client.out.size(), MSG_NOSIGNAL);
+            if (sent < 0) {
+                if (errno != EAGAIN && errno != EWOULDBLOCK) {
+                    client.out.clear();
+                    client.closing = true;
+                }
+                break;
+            }
+            client.out.erase(0, sent);
+        }
+        watch(client.fd, EPOLLIN | (client.out.empty() ? 0 : EPOLLOUT), EPOLL_CTL_MOD);
+        if (client.out.size() > FRAME_STREAM_MAX_BACKLOG) {
+            logWarn("Remote UI client too slow, disconnected");
+            client.out.clear();
+            client.closing = true;
+        }
+    }
+
+    void receive(Client& client)
+    {
+        char buffer[4096];
+        while (true) {
+            ssize_t size = recv(client.fd, buffer, sizeof(buffer), 0);
+            if (size == 0 || (size < 0 && errno != EAGAIN && errno != EWOULDBLOCK)) {
+                client.out.clear();
+                client.closing = true;
+                return;
+            }
+            if (size < 0) {
+                break;
+            }
+            client.in.append(buffer, size);
+        }
+        if (client.upgraded) {
+            handleMessages(client);
+        } else {
+            handleRequest(client);
+        }
+    }
+
+    void accept()
+    {
+        while (true) {
+            int clientFd = accept4(fd, NULL, NULL, SOCK_NONBLOCK | SOCK_CLOEXEC);
+            if (clientFd < 0) {
+                return;
+            }
+            if (clients.size() >= FRAME_STREAM_MAX_CLIENTS) {
+                close(clientFd);
+                continue;
+            }
+            int one = 1;
+            setsockopt(clientFd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one));
+            clients.push_back({ clientFd });
+            watch(clientFd, EPOLLIN, EPOLL_CTL_ADD);
+        }
+    }
+
+    // Encode the tiles changed since the last frame, false if none did
+    bool encodeFrame()
+    {
+        std::lock_guard<std::mutex> guard(frameMtx);
+        if (!hasChanges) {
+            return false;
+        }
+        frame.resize(8);
+        uint16_t count = 0;
+        auto put16 = [&](uint16_t value) {
+            frame.push_back(value);
+            frame.push_back(value >> 8);
+        };
+        for (int tileY = 0; tileY < tileRows; tileY++) {
+            for (int tileX = 0; tileX < tileCols && count < UINT16_MAX; tileX++) {
+                if (!changed[tileY * tileCols + tileX]) {
+                    continue;
+                }
+                changed[tileY * tileCols + tileX] = 0;
+                count++;
+                put16(tileX);
+                put16(tileY);
+                int x = tileX * TILE, y = tileY * TILE;
+                int w = std::min(TILE, width - x), h = std::min(TILE, height - y);
+                uint16_t color = shadow[y * width + x];
+                int run = 0;
+                for (int r = 0; r < h; r++) {
+                    const uint16_t* pixels = &shadow[(y + r) * width + x];
+                    for (int i = 0; i < w; i++) {
+                        if (pixels[i] == color && run < 256) {
+                            run++;
+                            continue;
+                        }
+                        frame.push_back(run - 1);
+                        put16(color);
+                        color = pixels[i];
+                        run = 1;
+                    }
+                }
+                frame.push_back(run - 1);
+                put16(color);
+            }
+        }
+        hasChanges = false;
+        uint16_t header[4] = { (uint16_t)width, (uint16_t)height, (uint16_t)TILE, count };
+        for (int i = 0; i < 4; i++) {
+            frame[i * 2] = header[i];
+            frame[i * 2 + 1] = header[i] >> 8;
+        }
+        return count > 0;
+    }
+
+    void streamFrame()
+    {
+        for (Client& client : clients) {
+            if (client.upgraded && !client.out.empty()) {
+                // Wait for every client to get the previous frame, the tiles changed meanwhile are merged
+                return;
+            }
+        }
+        if (!encodeFrame()) {
+            return;
+        }
+        std::string message;
+        wsFrame(message, 0x2, frame.data(), frame.size());
+        for (Client& client : clients) {
+            if (client.upgraded && !client.closing) {
+                client.out += message;
+                flush(client);
+            }
+        }
+    }
+
+    void loop()
+    {
+        struct epoll_event events[8];
+        while (true) {
+            int timeout = -1;
+            if (viewers) {
+                uint64_t elapsed = getTicks() - lastFrame;
+                timeout = elapsed >= frameMs ? 0 : frameMs - elapsed;
+            }
+            int count = epoll_wait(epollFd, events, 8, timeout);
+            for (int i = 0; i < count; i++) {
+                int eventFd = events[i].data.fd;
+                if (eventFd == stopFd) {
+                    return;
+                }
+                if (eventFd == fd) {
+                    accept();
+                    continue;
+                }
+                for (Client& client : clients) {
+                    if (client.fd == eventFd) {
+                        if (events[i].events & (EPOLLIN | EPOLLHUP | EPOLLERR)) {
+                            receive(client);
+                        }
+                        flush(client);
+                    }
+                }
+            }
+            uint64_t now = getTicks();
+            if (viewers && now - lastFrame >= frameMs) {
+                lastFrame = now;
+                streamFrame();
+            }
+            for (size_t i = clients.size(); i-- > 0;) {
+                if (clients[i].closing && clients[i].out.empty()) {
+                    if (clients[i].upgraded) {
+                        viewers--;
+                        logInfo("Remote UI client disconnected");
+                    }
+                    close(clients[i].fd);
+                    clients.erase(clients.begin() + i);
+                }
+            }
+        }
+    }
+
+public:
+    ~FrameStreamServer()
+    {
+        stop();
+    }
+
+    bool running()
+    {
+        return thread.joinable();
+    }
+
+    // Serve the page on TCP `port` of all the interfaces, streaming at most `fps` frames per second
+    bool start(uint16_t port, Handlers onInput, uint32_t fps = 20)
+    {
+        if (running()) {
+            return false;
+        }
+        handlers = onInput;
+        frameMs = 1000 / (fps ? fps : 1);
+        fd = socket(AF_INET6, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int off = 0;
+        int one = 1;
+        // IPv4 clients as well, as mapped addresses
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+        struct sockaddr_in6 addr = {};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(port);
+        if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0 || listen(fd, 4) < 0) {
+            logWarn("Remote UI on port %d: %s", port, strerror(errno));
+            stop();
+            return false;
+        }
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        watch(fd, EPOLLIN, EPOLL_CTL_ADD);
+        watch(stopFd, EPOLLIN, EPOLL_CTL_ADD);
+        thread = std::thread([this] { loop(); });
+        pthread_setname_np(thread.native_handle(), "frameStream");
+        logInfo("Remote UI served on http://<host>:%d/", port);
+        return true;
+    }
+
+    void stop()
+    {
+        if (thread.joinable()) {
+            uint64_t value = 1;
+            if (write(stopFd, &value, sizeof(value)) == sizeof(value)) {
+                thread.join();
+            } else {
+                thread.detach();
+            }
+        }
+        for (Client& client : clients) {
+            close(client.fd);
+        }
+        clients.clear();
+        viewers = 0;
+        for (int* watched : { &fd, &stopFd, &epollFd }) {
+            if (*watched >= 0) {
+                close(*watched);
+                *watched = -1;
+            }
+        }
+    }
+
+    // UI thread, after each frame: copy the tiles changed since the last capture, see `Draw::forEachStreamTile()`
+    template <typename D>
+    void capture(D& draw)
+    {
+        bool streaming = viewers.load(std::memory_order_relaxed) > 0;
+        draw.keepStreamTiles = streaming;
+        if (!streaming) {
+            return;
+        }
+        bool full = fullFrame.exchange(false);
+        Size size = draw.getScreenSize();
+        std::lock_guard<std::mutex> guard(frameMtx);
+        if (size.w != width || size.h != height) {
+            width = size.w;
+            height = size.h;
+            tileCols = (width + TILE - 1) / TILE;
+            tileRows = (height + TILE - 1) / TILE;
+            shadow.assign(width * height, 0);
+            changed.assign(tileCols * tileRows, 0);
+            row.resize(TILE);
+            full = true;
+        }
+        draw.forEachStreamTile(full, [&](int x, int y, int w, int h) {
+            for (int tileY = y / TILE; tileY * TILE < y + h && tileY < tileRows; tileY++) {
+                for (int tileX = x / TILE; tileX * TILE < x + w && tileX < tileCols; tileX++) {
+                    int left = tileX * TILE, top = tileY * TILE;
+                    int tileW = std::min(TILE, width - left), tileH = std::min(TILE, height - top);
+                    bool differs = full;
+                    for (int r = 0; r < tileH; r++) {
+                        uint16_t* pixels = &shadow[(top + r) * width + left];
+                        toRgb565(&draw.screenBuffer[top + r][left], row.data(), tileW);
+                        if (memcmp(pixels, row.data(), tileW * sizeof(uint16_t))) {
+                            memcpy(pixels, row.data(), tileW * sizeof(uint16_t));
+                            differs = true;
+                        }
+                    }
+                    if (differs) {
+                        changed[tileY * tileCols + tileX] = 1;
+                        hasChanges = true;
+                    }
+                }
+            }
+        });
+    }
+};
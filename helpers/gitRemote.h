@@ -0,0 +1,27 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+
+// URL of a remote of the git repository in `dir`, read from its `.git/config` instead of running `git remote
+// get-url`, so it is cheap enough for a component to check it while rendering. Empty if there is none.
+inline std::string gitRemoteUrl(const std::string& dir, const std::string& remote = "origin")
+{
+    std::ifstream file(dir + "/.git/config");
+    std::string line;
+    std::string section = "[remote \"" + remote + "\"]";
+    bool inSection = false;
+    while (std::getline(file, line)) {
+        line.erase(0, line.find_first_not_of(" \t"));
+        line.erase(line.find_last_not_of(" \t\r") + 1);
+        if (!line.empty() && line[0] == '[') {
+            inSection = line == section;
+        } else if (inSection && line.rfind("url", 0) == 0) {
+            size_t value = line.find_first_not_of(" \t=", 3);
+            if (value != std::string::npos && line.find('=') < value) {
+                return line.substr(value);
+            }
+        }
+    }
+    return "";
+}
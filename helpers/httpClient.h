@@ -0,0 +1,213 @@
+#pragma once
+
+/* HTTP implementation: 1 = httplib (needs OpenSSL for https), 0 = wget */
+#ifndef USE_HTTPLIB
+#define USE_HTTPLIB 0
+#endif
+
+#if USE_HTTPLIB
+#define CPPHTTPLIB_OPENSSL_SUPPORT
+#include "libs/httplib/httplib.h"
+#include <memory>
+#endif
+
+#include <cstdlib>
+#include <list>
+#include <mutex>
+#include <string>
+#include <strings.h>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include "helpers/execCmd.h"
+#include "log.h"
+
+// HTTP requests of the UI components, shared by all of them through the task executor (see taskExecutor.h):
+// - the connection to each host is kept open between the requests (httplib only, wget exiting after each of them)
+// - the answers to GET requests are kept with their ETag, the next request for the same URL being conditional: a
+//   `304 Not Modified` reuses the kept body, e.g. the GitHub API then not counting it in the rate limit
+// Blocking: called by the workers of the executor.
+class HttpClient {
+public:
+    typedef std::vector<std::pair<std::string, std::string>> Headers;
+
+    struct Response {
+        // 0 if the request could not be sent
+        int status = 0;
+        std::string body;
+        // Answered with the body of a previous request, the server telling it didn't change
+        bool cached = false;
+    };
+
+    // Answers kept for the conditional requests, the oldest ones being dropped
+    size_t maxCached = 16;
+
+protected:
+    struct Cached {
+        std::string key;
+        std::string etag;
+        std::string body;
+    };
+    std::list<Cached> cache;
+    std::mutex cacheMtx;
+
+#if USE_HTTPLIB
+    // A client is not meant to be used by 2 threads at once, so each host has its own lock
+    struct Connection {
+        std::mutex mtx;
+        std::unique_ptr<httplib::Client> client;
+    };
+    std::unordered_map<std::string, std::unique_ptr<Connection>> connections;
+    std::mutex connectionsMtx;
+
+    Connection& connection(const std::string& host)
+    {
+        std::lock_guard<std::mutex> guard(connectionsMtx);
+        std::unique_ptr<Connection>& connection = connections[host];
+        if (!connection) {
+            connection = std::make_unique<Connection>();
+            connection->client = std::make_unique<httplib::Client>(host);
+            connection->client->set_connection_timeout(5, 0);
+            connection->client->set_read_timeout(5, 0);
+            connection->client->set_keep_alive(true);
+        }
+        return *connection;
+    }
+#endif
+
+    // The credentials are part of the key, another user getting another answer
+    static std::string cacheKey(const std::string& url, const Headers& headers)
+    {
+        std::string key = url;
+        for (auto& header : headers) {
+            if (header.first == "Authorization") {
+                key += "\n" + header.second;
+            }
+        }
+        return key;
+    }
+
+    std::string etagOf(const std::string& key)
+    {
+        std::lock_guard<std::mutex> guard(cacheMtx);
+        for (Cached& cached : cache) {
+            if (cached.key == key) {
+                return cached.etag;
+            }
+        }
+        return "";
+    }
+
+    bool cachedBody(const std::string& key, std::string& body)
+    {
+        std::lock_guard<std::mutex> guard(cacheMtx);
+        for (auto it = cache.begin(); it != cache.end(); it++) {
+            if (it->key == key) {
+                body = it->body;
+                // Most recently used first
+                cache.splice(cache.begin(), cache, it);
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void keep(const std::string& key, const std::string& etag, const std::string& body)
+    {
+        std::lock_guard<std::mutex> guard(cacheMtx);
+        cache.remove_if([&](const Cached& cached) { return cached.key == key; });
+        if (etag.empty()) {
+            return;
+        }
+        cache.push_front({ key, etag, body });
+        while (cache.size() > maxCached) {
+            cache.pop_back();
+        }
+    }
+
+    Response send(const std::string& url, const std::string& postData, const Headers& headers, std::string& etag)
+    {
+        Response response;
+#if USE_HTTPLIB
+        size_t pathStart = url.find('/', 8);
+        std::string host = url.substr(0, pathStart);
+        std::string path = pathStart == std::string::npos ? "/" : url.substr(pathStart);
+        httplib::Headers hdrs;
+        for (auto& h : headers) {
+            hdrs.insert(h);
+        }
+        Connection& conn = connection(host);
+        std::lock_guard<std::mutex> guard(conn.mtx);
+        try {
+            httplib::Result res = postData.empty()
+                ? conn.client->Get(path.c_str(), hdrs)
+                : conn.client->Post(path.c_str(), hdrs, postData, "application/x-www-form-urlencoded");
+            if (res) {
+                response.status = res->status;
+                response.body = res->body;
+                etag = res->get_header_value("ETag");
+            }
+        } catch (const std::exception& ex) {
+            logError("HTTP request failed: %s", ex.what());
+        }
+#else
+        // The headers of the answer are printed on stderr by `--server-response`
+        std::string cmd = "wget --quiet --server-response --output-document=- ";
+        for (auto& h : headers) {
+            // An ETag is quoted
+            std::string value;
+            for (char c : h.second) {
+                value += c == '"' ? "\\\"" : std::string(1, c);
+            }
+            cmd += "--header=\"" + h.first + ": " + value + "\" ";
+        }
+        if (!postData.empty()) {
+            cmd += "--post-data=\"" + postData + "\" ";
+        }
+        cmd += "\"" + url + "\"";
+        std::string responseHeaders;
+        response.body = execCmd(cmd, &responseHeaders);
+        size_t start = 0;
+        while (start < responseHeaders.size()) {
+            size_t end = responseHeaders.find('\n', start);
+            std::string line = responseHeaders.substr(start, end == std::string::npos ? std::string::npos : end - start);
+            start = end == std::string::npos ? responseHeaders.size() : end + 1;
+            line.erase(0, line.find_first_not_of(" \t"));
+            line.erase(line.find_last_not_of(" \r") + 1);
+            // The last status line wins, after the redirections
+            if (line.rfind("HTTP/", 0) == 0 && line.find(' ') != std::string::npos) {
+                response.status = atoi(line.c_str() + line.find(' ') + 1);
+            } else if (line.size() > 5 && strncasecmp(line.c_str(), "etag:", 5) == 0) {
+                etag = line.substr(line.find_first_not_of(" ", 5));
+            }
+        }
+#endif
+        return response;
+    }
+
+public:
+    Response get(const std::string& url, Headers headers = {})
+    {
+        std::string key = cacheKey(url, headers);
+        std::string etag = etagOf(key);
+        if (!etag.empty()) {
+            headers.push_back({ "If-None-Match", etag });
+        }
+        std::string nextEtag;
+        Response response = send(url, "", headers, nextEtag);
+        if (response.status == 304 && cachedBody(key, response.body)) {
+            response.status = 200;
+            response.cached = true;
+        } else if (response.status == 200) {
+            keep(key, nextEtag, response.body);
+        }
+        return response;
+    }
+
+    Response post(const std::string& url, const std::string& postData, const Headers& headers = {})
+    {
+        std::string etag;
+        return send(url, postData, headers, etag);
+    }
+};
@@ -7,7 +7,7 @@ I2C is a standard communication method used by microcontrollers to communicate w
 
 1.  **Connection Setup (`init`):** The program first calls the `init` function, which acts like plugging in the hardware. It opens the specific I2C digital channel (bus) on the system and assigns the unique address of the target device. This ensures the computer is ready to speak only to that specific peripheral.
 2.  **Writing Data (`writeReg`):** To change a setting or send a command, the `writeReg` function is used. This sends a desired value to a specific internal memory location (called a register) within the external device.
-3.  **Reading Data (`readReg`):** To check the status or retrieve sensor information, `readReg` first tells the device which register to look at, and then reads the value sent back from that location.
+3.  **Reading Data (`readReg`/`readRegs`):** To check the status or retrieve sensor information, `readReg` first tells the device which register to look at, and then reads the value sent back from that location. `readRegs` reads several consecutive registers in a single bus transaction.
 4.  **General Transfer (`send`/`pull`):** These functions handle sending or receiving larger chunks of data, often used for quickly updating displays.
 5.  **Shutdown (`end`):** When communication is complete, the `end` function safely closes the communication channel, ensuring system resources are released.
 
@@ -20,6 +20,7 @@ sha: 0824118cb813dbae589a75414b04c6ff6287d47dcecd7f46185e397b2225e1a6
 #include <string>
 #include <fcntl.h>
 #include <linux/i2c-dev.h>
+#include <linux/i2c.h>
 #include <sys/ioctl.h>
 #include <unistd.h>
 #include <cstdint>
@@ -28,6 +29,7 @@ sha: 0824118cb813dbae589a75414b04c6ff6287d47dcecd7f46185e397b2225e1a6
 class I2c {
 public:
     int file = 0;
+    int address = 0;
 
     bool init(int i2c, int dev_addr)
     {
@@ -44,6 +46,7 @@ public:
                 file = 0;
                 return false;
             }
+            address = dev_addr;
             return true;
         }
         // assume done init already
@@ -86,6 +89,24 @@ public:
         return 0;
     }
 
+    // Register address then `len` values, as a single transaction with a repeated start, the device incrementing
+    // the register after each byte
+    uint8_t readRegs(uint8_t reg, uint8_t* values, uint16_t len)
+    {
+        if (file == 0 || values == nullptr || len == 0)
+            return 1;
+
+        struct i2c_msg msgs[2] = {
+            { (uint16_t)address, 0, 1, &reg },
+            { (uint16_t)address, I2C_M_RD, len, values },
+        };
+        struct i2c_rdwr_ioctl_data data = { msgs, 2 };
+        if (ioctl(file, I2C_RDWR, &data) != 2)
+            return 1;
+
+        return 0;
+    }
+
     // For ssd1306, not used at the moment (might be deprecated at some point)
     uint8_t send(uint8_t* ptr, int16_t len)
     {
@@ -0,0 +1,285 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <mutex>
+#include <new>
+#include <pthread.h>
+#include <sched.h>
+#include <string>
+#include <sys/syscall.h>
+#include <thread>
+#include <tuple>
+#include <type_traits>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+// Messages of log.h, formatted and printed by a background thread, so a slow console or serial line never blocks the
+// thread logging, e.g. the audio thread on an xrun.
+//
+// Each thread pushes its messages, without formatting them, in its own ring: the format, the arguments, and a copy of
+// the C strings they point to. When its ring is full, a real-time thread drops the message and counts it, the drop
+// being reported by the writer, while the other threads wait for the writer, e.g. for the burst of logs at startup. The
+// messages of all the threads are printed in the order they were logged, and what is left is printed when the app
+// exits.
+//
+// Used by the host library, the app and the plugins: like StaticLibs, the class keeps the default visibility so the
+// static build shares a single writer.
+class __attribute__((visibility("default"))) LogQueue {
+public:
+    static const uint32_t SLOTS = 64;
+    static const uint32_t PAYLOAD = 480;
+    static const uint32_t LINE_SIZE = 1024;
+
+    template <typename T>
+    static constexpr bool isString = std::is_same<T, const char*>::value || std::is_same<T, char*>::value;
+
+    struct Message {
+        uint64_t seq;
+        void (*format)(Message& message, char* out, size_t size);
+        // String literal, else the format is copied in the payload at `formatOffset`
+        const char* fmt;
+        uint16_t formatOffset;
+        uint16_t used;
+        uint8_t level;
+        // Arguments, followed by the strings they point to
+        alignas(16) uint8_t payload[PAYLOAD];
+    };
+
+protected:
+    // Written by a single thread, read by the writer
+    struct Ring {
+        Message slots[SLOTS];
+        alignas(64) std::atomic<uint32_t> writePos = 0;
+        alignas(64) std::atomic<uint32_t> readPos = 0;
+        std::atomic<uint32_t> dropped = 0;
+        long tid;
+    };
+
+    template <typename T>
+    using Stored = typename std::conditional<isString<T>, uint16_t, T>::type;
+    static const uint16_t NO_STRING = 0xffff;
+
+    std::mutex mtx;
+    std::vector<Ring*> rings;
+    std::atomic<uint64_t> seq = 0;
+    std::thread writer;
+    std::atomic<bool> exiting = false;
+
+    static inline thread_local Ring* current = NULL;
+
+    static uint16_t copyString(Message& message, const char* string)
+    {
+        if (!string) {
+            return NO_STRING;
+        }
+        // The last byte of the payload stays 0, for the strings that don't fit
+        uint16_t offset = message.used;
+        if (offset >= PAYLOAD - 1) {
+            return PAYLOAD - 1;
+        }
+        size_t length = strnlen(string, PAYLOAD - 1 - offset - 1);
+        memcpy(message.payload + offset, string, length);
+        message.payload[offset + length] = '\0';
+        message.used += length + 1;
+        return offset;
+    }
+
+    template <typename T>
+    static Stored<T> store(Message& message, T value)
+    {
+        if constexpr (isString<T>) {
+            return copyString(message, value);
+        } else {
+            return value;
+        }
+    }
+
+    template <typename T>
+    static auto load(Message& message, Stored<T> value)
+    {
+        if constexpr (isString<T>) {
+            return value == NO_STRING ? "(null)" : (const char*)message.payload + value;
+        } else {
+            return value;
+        }
+    }
+
+    template <typename... Args, size_t... I>
+    static void formatArgs(Message& message, char* out, size_t size, std::index_sequence<I...>)
+    {
+        const char* fmt = message.fmt ? message.fmt : (const char*)message.payload + message.formatOffset;
+        if constexpr (sizeof...(Args) == 0) {
+            snprintf(out, size, "%s", fmt);
+        } else {
+            std::tuple<Stored<Args>...>& args = *reinterpret_cast<std::tuple<Stored<Args>...>*>(message.payload);
+            snprintf(out, size, fmt, load<Args>(message, std::get<I>(args))...);
+        }
+    }
+
+    template <typename... Args>
+    static void format(Message& message, char* out, size_t size)
+    {
+        formatArgs<Args...>(message, out, size, std::index_sequence_for<Args...> {});
+    }
+
+    static void print(uint8_t level, const char* line)
+    {
+        static const char* prefixes[] = { "", "\033[35m[trace]\033[0m", "\033[32m[debug]\033[0m",
+            "\033[34m[info]\033[0m", "\033[33m[warn]\033[0m", "\033[31m[error]\033[0m" };
+        printf("%s %s\n", prefixes[level < 6 ? level : 0], line);
+    }
+
+    // Registered once per thread. The ring of a thread that exited is given to the next thread, once emptied.
+    Ring* ring()
+    {
+        if (!current) {
+            std::lock_guard<std::mutex> guard(mtx);
+            for (Ring* r : rings) {
+                if (r->readPos.load() == r->writePos.load()
+                    && access(("/proc/self/task/" + std::to_string(r->tid)).c_str(), F_OK) != 0) {
+                    current = r;
+                    break;
+                }
+            }
+            if (!current) {
+                current = new Ring();
+                rings.push_back(current);
+            }
+            current->tid = syscall(SYS_gettid);
+            if (!writer.joinable()) {
+                writer = std::thread([this] { writerLoop(); });
+                pthread_setname_np(writer.native_handle(), "log");
+                atexit([] { get().stop(); });
+            }
+        }
+        return current;
+    }
+
+    // Print the messages of all the rings in the order they were logged, return false if there were none
+    bool drain()
+    {
+        std::vector<Ring*> list;
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            list = rings;
+        }
+        char line[LINE_SIZE];
+        bool printed = false;
+        while (true) {
+            Ring* next = NULL;
+            uint64_t nextSeq = UINT64_MAX;
+            for (Ring* r : list) {
+                uint32_t pos = r->readPos.load(std::memory_order_relaxed);
+                if (pos != r->writePos.load(std::memory_order_acquire) && r->slots[pos % SLOTS].seq < nextSeq) {
+                    next = r;
+                    nextSeq = r->slots[pos % SLOTS].seq;
+                }
+            }
+            if (!next) {
+                break;
+            }
+            uint32_t pos = next->readPos.load(std::memory_order_relaxed);
+            Message& message = next->slots[pos % SLOTS];
+            message.format(message, line, sizeof(line));
+            print(message.level, line);
+            next->readPos.store(pos + 1, std::memory_order_release);
+            printed = true;
+        }
+        for (Ring* r : list) {
+            uint32_t dropped = r->dropped.exchange(0, std::memory_order_relaxed);
+            if (dropped > 0) {
+                snprintf(line, sizeof(line), "%u log messages dropped by thread %ld, its queue was full", dropped, r->tid);
+                print(4, line);
+                printed = true;
+            }
+        }
+        if (printed) {
+            fflush(stdout);
+        }
+        return printed;
+    }
+
+    // Wait for the writer to make room, unless the thread has a real-time priority
+    bool waitForSpace(Ring* r, uint32_t pos)
+    {
+        int policy;
+        struct sched_param param;
+        if (pthread_getschedparam(pthread_self(), &policy, &param) != 0 || policy == SCHED_FIFO || policy == SCHED_RR) {
+            return false;
+        }
+        for (int i = 0; i < 100 && pos - r->readPos.load(std::memory_order_acquire) >= SLOTS; i++) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return pos - r->readPos.load(std::memory_order_acquire) < SLOTS;
+    }
+
+    void writerLoop()
+    {
+        while (!exiting) {
+            if (!drain()) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(10));
+            }
+        }
+    }
+
+    // At exit, the messages left are printed, and the ones logged afterwards are printed right away
+    void stop()
+    {
+        exiting = true;
+        if (writer.joinable()) {
+            writer.join();
+        }
+        drain();
+    }
+
+public:
+    // Never destroyed, for the messages logged by the destructors at exit
+    static LogQueue& get()
+    {
+        static LogQueue* instance = new LogQueue();
+        return *instance;
+    }
+
+    // Queue a message, `fmt` being kept as is when it is a string literal, else copied
+    template <typename... Args>
+    void push(uint8_t level, const char* fmt, bool copyFormat, Args... args)
+    {
+        static_assert((std::is_trivially_copyable<Args>::value && ...), "Log arguments must be numbers, pointers or C strings");
+        static_assert(sizeof(std::tuple<Stored<Args>...>) <= PAYLOAD / 2, "Too many log arguments");
+        if (exiting) {
+            char line[LINE_SIZE];
+            if constexpr (sizeof...(Args) == 0) {
+                snprintf(line, sizeof(line), "%s", fmt);
+            } else {
+                snprintf(line, sizeof(line), fmt, args...);
+            }
+            print(level, line);
+            fflush(stdout);
+            return;
+        }
+        Ring* r = ring();
+        uint32_t pos = r->writePos.load(std::memory_order_relaxed);
+        if (pos - r->readPos.load(std::memory_order_acquire) >= SLOTS && !waitForSpace(r, pos)) {
+            r->dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        Message& message = r->slots[pos % SLOTS];
+        message.seq = seq.fetch_add(1, std::memory_order_relaxed);
+        message.level = level;
+        message.used = sizeof(std::tuple<Stored<Args>...>);
+        message.payload[PAYLOAD - 1] = '\0';
+        message.fmt = copyFormat ? NULL : fmt;
+        if (copyFormat) {
+            message.formatOffset = copyString(message, fmt);
+        }
+        new (message.payload) std::tuple<Stored<Args>...>(store<Args>(message, args)...);
+        message.format = format<Args...>;
+        r->writePos.store(pos + 1, std::memory_order_release);
+    }
+};
@@ -0,0 +1,480 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <string>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <unordered_map>
+#include <vector>
+
+#include "helpers/getTicks.h"
+#include "log.h"
+#include "plugins/audio/valueInterface.h"
+
+#define OSC_MAX_DATAGRAM 1472 // Fits in a single ethernet frame
+#define OSC_CLIENT_TIMEOUT_MS 60000
+
+// OSC control surface over UDP, for tablets and computers on the network, handled by a single epoll thread:
+// - `/value/<plugin>/<track>/<key> f` sets a value, the same address without argument answers its value.
+// - `/subscribe s...` streams the given value addresses back to the client, only the values that changed, at
+//   most `rate` times per second, as a single bundle. `/unsubscribe s...` stops them, all of them without argument.
+// - `/encoder ii` (id, direction) and `/key iii` (id, key, state) are handled as the controllers' ones.
+// - `/ping` answers `/pong`. A client that didn't send anything for OSC_CLIENT_TIMEOUT_MS is unsubscribed.
+//
+// Bundles are handled right away, ignoring their time tag: a bundle of values changes them all at once. Values are
+// looked up once per address, setting them from this thread goes through their parameter queue, like any other
+// thread than the audio one.
+class OscServer {
+public:
+    struct Handlers {
+        // NULL if the value doesn't exist
+        std::function<ValueInterface*(const std::string& plugin, int16_t track, const std::string& key)> value;
+        std::function<void(int8_t id, int8_t direction, uint64_t tick)> encoder;
+        std::function<void(uint16_t id, int key, int8_t state)> key;
+    };
+
+protected:
+    struct Arg {
+        char type;
+        float number = 0.0f;
+        std::string text;
+    };
+
+    struct Client {
+        struct sockaddr_storage addr;
+        socklen_t len;
+        uint64_t lastSeen;
+    };
+
+    struct Subscription {
+        std::string address;
+        ValueInterface* value;
+        size_t client;
+        float sent;
+        bool known;
+    };
+
+    Handlers handlers;
+    int fd = -1;
+    int epollFd = -1;
+    int stopFd = -1;
+    std::thread thread;
+    uint32_t streamMs = 33;
+    uint64_t lastStream = 0;
+
+    std::vector<Client> clients;
+    std::vector<Subscription> subscriptions;
+    std::unordered_map<std::string, ValueInterface*> values;
+    // Set from another thread when the plugins were reloaded, the addresses being looked up again
+    std::atomic<bool> stale = false;
+
+    std::vector<uint8_t> buffer = std::vector<uint8_t>(65536);
+    std::vector<uint8_t> out;
+
+    static uint32_t readInt(const uint8_t* p)
+    {
+        return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3];
+    }
+
+    static float readFloat(const uint8_t* p)
+    {
+        uint32_t bits = readInt(p);
+        float value;
+        memcpy(&value, &bits, sizeof(value));
+        return value;
+    }
+
+    // Null terminated, padded to 4 bytes
+    static bool readString(const uint8_t*& p, const uint8_t* end, std::string& value)
+    {
+        const uint8_t* nul = (const uint8_t*)memchr(p, 0, end - p);
+        if (!nul) {
+            return false;
+        }
+        value.assign((const char*)p, nul - p);
+        p += (value.size() / 4 + 1) * 4;
+        return p <= end;
+    }
+
+    static void writeInt(std::vector<uint8_t>& data, uint32_t value)
+    {
+        uint8_t bytes[4] = { (uint8_t)(value >> 24), (uint8_t)(value >> 16), (uint8_t)(value >> 8), (uint8_t)value };
+        data.insert(data.end(), bytes, bytes + 4);
+    }
+
+    static void writeString(std::vector<uint8_t>& data, const std::string& value)
+    {
+        data.insert(data.end(), value.begin(), value.end());
+        data.resize(data.size() + 4 - value.size() % 4, 0);
+    }
+
+    static void writeMessage(std::vector<uint8_t>& data, const std::string& address, const char* types, float value = 0.0f)
+    {
+        writeString(data, address);
+        writeString(data, types);
+        if (types[1] == 'f') {
+            uint32_t bits;
+            memcpy(&bits, &value, sizeof(bits));
+            writeInt(data, bits);
+        }
+    }
+
+    static void startBundle(std::vector<uint8_t>& data)
+    {
+        data.clear();
+        writeString(data, "#bundle");
+        // Immediately
+        writeInt(data, 0);
+        writeInt(data, 1);
+    }
+
+    void sendTo(const Client& client, const std::vector<uint8_t>& data)
+    {
+        sendto(fd, data.data(), data.size(), 0, (const struct sockaddr*)&client.addr, client.len);
+    }
+
+    size_t clientIndex(const struct sockaddr_storage& addr, socklen_t len, uint64_t now)
+    {
+        for (size_t i = 0; i < clients.size(); i++) {
+            if (clients[i].len == len && memcmp(&clients[i].addr, &addr, len) == 0) {
+                clients[i].lastSeen = now;
+                return i;
+            }
+        }
+        clients.push_back({ addr, len, now });
+        return clients.size() - 1;
+    }
+
+    // `/value/<plugin>/<track>/<key>`
+    ValueInterface* value(const std::string& address)
+    {
+        auto it = values.find(address);
+        if (it != values.end()) {
+            return it->second;
+        }
+        ValueInterface* val = NULL;
+        size_t pluginStart = sizeof("/value/") - 1;
+        size_t trackStart = address.find('/', pluginStart);
+        size_t keyStart = trackStart == std::string::npos ? trackStart : address.find('/', trackStart + 1);
+        if (address.rfind("/value/", 0) == 0 && keyStart != std::string::npos) {
+            std::string track = address.substr(trackStart + 1, keyStart - trackStart - 1);
+            val = handlers.value(address.substr(pluginStart, trackStart - pluginStart), atoi(track.c_str()),
+                address.substr(keyStart + 1));
+        }
+        // Unknown addresses as well, so a misconfigured client doesn't look them up on each message
+        values[address] = val;
+        return val;
+    }
+
+    void subscribe(size_t client, const std::string& address)
+    {
+        for (auto& subscription : subscriptions) {
+            if (subscription.client == client && subscription.address == address) {
+                subscription.known = false;
+                return;
+            }
+        }
+        ValueInterface* val = value(address);
+        if (!val) {
+            logWarn("OSC unknown value %s", address.c_str());
+            return;
+        }
+        subscriptions.push_back({ address, val, client, 0.0f, false });
+    }
+
+    void unsubscribe(size_t client, const std::string& address)
+    {
+        for (size_t i = subscriptions.size(); i-- > 0;) {
+            if (subscriptions[i].client == client && (address.empty() || subscriptions[i].address == address)) {
+                subscriptions.erase(subscriptions.begin() + i);
+            }
+        }
+    }
+
+    void handleMessage(const std::string& address, std::vector<Arg>& args, size_t client)
+    {
+        if (address.rfind("/value/", 0) == 0) {
+            ValueInterface* val = value(address);
+            if (!val) {
+                return;
+            }
+            if (args.size() && args[0].type != 's') {
+                val->set(args[0].number);
+            } else {
+                out.clear();
+                writeMessage(out, address, ",f", val->get());
+                sendTo(clients[client], out);
+            }
+        } else if (address == "/subscribe" || address == "/unsubscribe") {
+            for (auto& arg : args) {
+                if (arg.type == 's') {
+                    address == "/subscribe" ? subscribe(client, arg.text) : unsubscribe(client, arg.text);
+                }
+            }
+            if (args.empty() && address == "/unsubscribe") {
+                unsubscribe(client, "");
+            }
+        } else if (address == "/encoder" && args.size() >= 2 && handlers.encoder) {
+            // The tick of the sender is from another clock
+            handlers.encoder(args[0].number, args[1].number, getTicks());
+        } else if (address == "/key" && args.size() >= 3 && handlers.key) {
+            handlers.key(args[0].number, args[1].number, args[2].number);
+        } else if (address == "/ping") {
+            out.clear();
+            writeMessage(out, "/pong", ",");
+            sendTo(clients[client], out);
+        }
+    }
+
+    // A message or a bundle of them, bundles possibly nested
+    bool handlePacket(const uint8_t* p, const uint8_t* end, size_t client, int depth = 0)
+    {
+        if (end - p >= 16 && memcmp(p, "#bundle", 8) == 0) {
+            if (depth > 4) {
+                return false;
+            }
+            p += 16; // Time tag ignored
+            while (end - p >= 4) {
+                uint32_t size = readInt(p);
+                p += 4;
+                if (size > (uint32_t)(end - p) || !handlePacket(p, p + size, client, depth + 1)) {
+                    return false;
+                }
+                p += size;
+            }
+            return true;
+        }
+
+        std::string address, types;
+        if (!readString(p, end, address) || address.empty() || address[0] != '/') {
+            return false;
+        }
+        // Type tags are optional in the oldest implementations
+        if (p < end && !readString(p, end, types)) {
+            return false;
+        }
+        std::vector<Arg> args;
+        for (size_t i = 1; i < types.size(); i++) {
+            Arg arg = { types[i] };
+            switch (arg.type) {
+            case 'i':
+            case 'f':
+                if (end - p < 4) {
+                    return false;
+                }
+                arg.number = arg.type == 'i' ? (float)(int32_t)readInt(p) : readFloat(p);
+                p += 4;
+                break;
+            case 'h':
+            case 'd':
+            case 't': {
+                if (end - p < 8) {
+                    return false;
+                }
+                uint64_t bits = ((uint64_t)readInt(p) << 32) | readInt(p + 4);
+                double number;
+                memcpy(&number, &bits, sizeof(number));
+                arg.number = arg.type == 'd' ? (float)number : (float)(int64_t)bits;
+                p += 8;
+                break;
+            }
+            case 's':
+            case 'S':
+                if (!readString(p, end, arg.text)) {
+                    return false;
+                }
+                arg.type = 's';
+                break;
+            case 'T':
+                arg.number = 1.0f;
+                break;
+            case 'F':
+            case 'N':
+            case 'I':
+                break;
+            default:
+                // Size unknown, the following arguments can't be read
+                logWarn("OSC unsupported type %c in %s", arg.type, address.c_str());
+                return false;
+            }
+            args.push_back(arg);
+        }
+        handleMessage(address, args, client);
+        return true;
+    }
+
+    void receive()
+    {
+        uint64_t now = getTicks();
+        while (true) {
+            struct sockaddr_storage addr;
+            socklen_t len = sizeof(addr);
+            ssize_t size = recvfrom(fd, buffer.data(), buffer.size(), 0, (struct sockaddr*)&addr, &len);
+            if (size < 0) {
+                return;
+            }
+            size_t client = clientIndex(addr, len, now);
+            if (!handlePacket(buffer.data(), buffer.data() + size, client)) {
+                logDebug("OSC malformed packet of %d bytes", (int)size);
+            }
+        }
+    }
+
+    void stream(uint64_t now)
+    {
+        for (size_t client = clients.size(); client-- > 0;) {
+            if (now - clients[client].lastSeen > OSC_CLIENT_TIMEOUT_MS) {
+                unsubscribe(client, "");
+                clients.erase(clients.begin() + client);
+                for (auto& subscription : subscriptions) {
+                    if (subscription.client > client) {
+                        subscription.client--;
+                    }
+                }
+            }
+        }
+
+        for (size_t client = 0; client < clients.size(); client++) {
+            startBundle(out);
+            size_t empty = out.size();
+            for (auto& subscription : subscriptions) {
+                if (subscription.client != client) {
+                    continue;
+                }
+                float current = subscription.value->get();
+                if (subscription.known && current == subscription.sent) {
+                    continue;
+                }
+                std::vector<uint8_t> message;
+                writeMessage(message, subscription.address, ",f", current);
+                if (out.size() + 4 + message.size() > OSC_MAX_DATAGRAM && out.size() > empty) {
+                    sendTo(clients[client], out);
+                    startBundle(out);
+                }
+                writeInt(out, message.size());
+                out.insert(out.end(), message.begin(), message.end());
+                subscription.sent = current;
+                subscription.known = true;
+            }
+            if (out.size() > empty) {
+                sendTo(clients[client], out);
+            }
+        }
+    }
+
+    void loop()
+    {
+        struct epoll_event events[4];
+        while (true) {
+            int timeout = -1;
+            if (!subscriptions.empty()) {
+                uint64_t elapsed = getTicks() - lastStream;
+                timeout = elapsed >= streamMs ? 0 : streamMs - elapsed;
+            }
+            int count = epoll_wait(epollFd, events, 4, timeout);
+            if (stale.exchange(false)) {
+                values.clear();
+                for (size_t i = subscriptions.size(); i-- > 0;) {
+                    subscriptions[i].value = value(subscriptions[i].address);
+                    subscriptions[i].known = false;
+                    if (!subscriptions[i].value) {
+                        subscriptions.erase(subscriptions.begin() + i);
+                    }
+                }
+            }
+            for (int i = 0; i < count; i++) {
+                if (events[i].data.fd == stopFd) {
+                    return;
+                }
+                receive();
+            }
+            uint64_t now = getTicks();
+            if (!subscriptions.empty() && now - lastStream >= streamMs) {
+                stream(now);
+                lastStream = now;
+            }
+        }
+    }
+
+public:
+    ~OscServer()
+    {
+        stop();
+    }
+
+    bool running()
+    {
+        return thread.joinable();
+    }
+
+    // Listen on UDP `port` of all the interfaces, streaming the subscribed values at most `rate` times per second
+    bool start(uint16_t port, Handlers onMessages, uint32_t rate = 30)
+    {
+        if (running()) {
+            return false;
+        }
+        handlers = onMessages;
+        streamMs = 1000 / (rate ? rate : 1);
+        fd = socket(AF_INET6, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int off = 0;
+        // IPv4 clients as well, as mapped addresses
+        setsockopt(fd, IPPROTO_IPV6, IPV6_V6ONLY, &off, sizeof(off));
+        struct sockaddr_in6 addr = {};
+        addr.sin6_family = AF_INET6;
+        addr.sin6_addr = in6addr_any;
+        addr.sin6_port = htons(port);
+        if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            logWarn("OSC server on port %d: %s", port, strerror(errno));
+            stop();
+            return false;
+        }
+        epollFd = epoll_create1(EPOLL_CLOEXEC);
+        stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        for (int watched : { fd, stopFd }) {
+            struct epoll_event event = {};
+            event.events = EPOLLIN;
+            event.data.fd = watched;
+            epoll_ctl(epollFd, EPOLL_CTL_ADD, watched, &event);
+        }
+        thread = std::thread([this] { loop(); });
+        pthread_setname_np(thread.native_handle(), "osc");
+        logInfo("OSC server listening on UDP port %d", port);
+        return true;
+    }
+
+    // The plugins were reloaded, the values of the addresses are looked up again before the next message or stream
+    void invalidate()
+    {
+        stale = true;
+    }
+
+    void stop()
+    {
+        if (thread.joinable()) {
+            uint64_t value = 1;
+            if (write(stopFd, &value, sizeof(value)) == sizeof(value)) {
+                thread.join();
+            } else {
+                thread.detach();
+            }
+        }
+        for (int* watched : { &fd, &stopFd, &epollFd }) {
+            if (*watched >= 0) {
+                close(*watched);
+                *watched = -1;
+            }
+        }
+        clients.clear();
+        subscriptions.clear();
+        values.clear();
+    }
+};
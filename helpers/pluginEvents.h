@@ -0,0 +1,133 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "helpers/MpscQueue.h"
+#include "helpers/frameScheduler.h"
+#include "helpers/processSingleton.h"
+
+// Events sent by the audio plugins to the UI, instead of the components polling the state of the plugins on each
+// frame, e.g. the step played by a sequencer:
+// - a plugin publishes an event at the end of a block, only when its state changed since the block before, and only
+//   if a component listens to this plugin. The event is pushed in a lock-free ring and the UI thread is woken.
+// - before each frame, `dispatch()` hands the events to the listeners of their plugin, by the UI thread.
+// - the components listen to the events of the plugins they show when their view is activated, see
+//   Container::activate(), the ViewManager clearing all the listeners before. In between, nothing is published,
+//   a component reads the state of the plugin once when its view is shown.
+class PluginEvents {
+public:
+    enum Type : uint8_t {
+        // Step played by a sequencer, -1 when stopped
+        STEP,
+        // Position of the sample played, from 0 to POSITION_RANGE - 1, -1 when none is playing
+        POSITION,
+    };
+
+    static const int32_t POSITION_RANGE = 1024;
+
+    struct Event {
+        void* source;
+        Type type;
+        int32_t value;
+    };
+
+    typedef std::function<void(int32_t value)> Listener;
+
+    // Publisher side of the POSITION events, a position only being sent when it moved of 1 / POSITION_RANGE
+    struct Position {
+        int32_t last = -1;
+
+        void publish(void* source, float index, uint64_t count)
+        {
+            int32_t position = count && index >= 0.0f && index < count ? (int32_t)(index * POSITION_RANGE / count) : -1;
+            if (position != last) {
+                last = position;
+                PluginEvents::get().publish(source, POSITION, position);
+            }
+        }
+    };
+
+protected:
+    MpscQueue<Event, 1024> queue;
+    std::atomic<bool> pending = false;
+    // Bit of each plugin listened to, by hash of its pointer, so the plugins nobody listens to do not wake the UI
+    std::atomic<uint64_t> listened = 0;
+    std::atomic<uint32_t> dropped = 0;
+
+    struct Subscription {
+        void* source;
+        Type type;
+        void* owner;
+        Listener listener;
+    };
+    // Only touched by the UI thread
+    std::vector<Subscription> subscriptions;
+
+    static uint64_t sourceBit(void* source)
+    {
+        return (uint64_t)1 << (((uintptr_t)source >> 4) & 63);
+    }
+
+public:
+    static PluginEvents& get()
+    {
+        return processSingleton<PluginEvents>();
+    }
+
+    // Any thread, e.g. the audio thread at the end of a block
+    void publish(void* source, Type type, int32_t value)
+    {
+        if (!(listened.load(std::memory_order_relaxed) & sourceBit(source))) {
+            return;
+        }
+        if (!queue.push({ source, type, value })) {
+            dropped.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        if (!pending.exchange(true, std::memory_order_acq_rel)) {
+            FrameScheduler::get().wake();
+        }
+    }
+
+    // UI thread
+    void subscribe(void* source, Type type, void* owner, Listener listener)
+    {
+        subscriptions.push_back({ source, type, owner, listener });
+        listened.fetch_or(sourceBit(source), std::memory_order_relaxed);
+    }
+
+    // UI thread, e.g. before another view is activated. The events still queued are dropped by the next dispatch.
+    void clear()
+    {
+        subscriptions.clear();
+        listened.store(0, std::memory_order_relaxed);
+    }
+
+    // Events lost as the ring was full, the UI thread not keeping up
+    uint32_t droppedCount() { return dropped.load(std::memory_order_relaxed); }
+
+    // UI thread, before the next frame. Return true if an event was handed to a listener.
+    bool dispatch()
+    {
+        if (!pending.exchange(false, std::memory_order_acq_rel)) {
+            return false;
+        }
+        bool handled = false;
+        for (Event* event = queue.front(); event != NULL; event = queue.front()) {
+            Event e = *event;
+            queue.pop();
+            // A listener may switch view, clearing the subscriptions
+            for (size_t i = 0; i < subscriptions.size(); i++) {
+                if (subscriptions[i].source == e.source && subscriptions[i].type == e.type) {
+                    Listener listener = subscriptions[i].listener;
+                    listener(e.value);
+                    handled = true;
+                }
+            }
+        }
+        return handled;
+    }
+};
@@ -0,0 +1,25 @@
+#pragma once
+
+// Single instance of `T` for the whole process, shared by the host and every plugin library, e.g. the caches and the
+// background workers that must not be duplicated per plugin.
+//
+// Each plugin library is built with its own copy of this function, as it is inline. The static of a function template
+// instance is emitted as a unique global symbol (STB_GNU_UNIQUE), so the dynamic linker binds the copies of all the
+// loaded libraries to a single one, even when they are opened with RTLD_LOCAL. This only holds as long as `T` and
+// this function keep the default visibility.
+//
+// A class with a protected constructor must befriend `processSingleton<T>`.
+template <typename T>
+T& processSingleton()
+{
+    static T instance;
+    return instance;
+}
+
+// Same, but never destroyed, e.g. when a thread of the instance may still be running while the process exits
+template <typename T>
+T& leakedProcessSingleton()
+{
+    static T* instance = new T();
+    return *instance;
+}
@@ -0,0 +1,16 @@
+#pragma once
+
+class ComponentInterface;
+
+// Called by the containers around the rendering of each component, e.g. by the UI benchmark (see uibench.cpp) to time
+// them. Unset in the app, so it only costs a check per component rendered.
+struct RenderProbe {
+    void (*begin)(ComponentInterface* component) = NULL;
+    void (*end)(ComponentInterface* component) = NULL;
+
+    static RenderProbe& get()
+    {
+        static RenderProbe probe;
+        return probe;
+    }
+};
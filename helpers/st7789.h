@@ -138,6 +138,14 @@ public:
         sendCmd(DISPLAY_WRITE_PIXELS, (uint8_t*)pixels, w * BYTESPERPIXEL);
     }
 
+    // Window of `w` x `h` pixels, filled row by row in a single transfer
+    void drawRect(uint16_t x, uint16_t y, uint16_t w, uint16_t h, uint16_t* pixels)
+    {
+        sendAddr(DISPLAY_SET_CURSOR_X, x, x + w - 1);
+        sendAddr(DISPLAY_SET_CURSOR_Y, y + yRamMargin, y + h - 1 + yRamMargin);
+        sendCmd(DISPLAY_WRITE_PIXELS, (uint8_t*)pixels, w * h * BYTESPERPIXEL);
+    }
+
     void init(uint16_t w, uint16_t h)
     {
         width = w;
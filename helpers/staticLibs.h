@@ -0,0 +1,41 @@
+#pragma once
+
+#include <map>
+#include <string>
+
+// Libraries linked in the binary instead of being opened at runtime, see `make static`: each plugin object built with
+// `PLUGIN_STATIC` registers its allocator under its kind and name (e.g. `audio` / `Tempo`, `component` / `Text`) when
+// the binary starts, and the loaders look it up before opening the library of the plugin.
+//
+// The objects of the static build have their own symbols made local, like they are in their library, so the registry
+// keeps the default visibility to be the same instance for all of them.
+class __attribute__((visibility("default"))) StaticLibs {
+protected:
+    std::map<std::string, void*> allocators;
+
+public:
+    static StaticLibs& get()
+    {
+        static StaticLibs instance;
+        return instance;
+    }
+
+    // Only called before `main()`, the registry being read-only once the binary started
+    void add(const std::string& kind, const std::string& name, void* allocator)
+    {
+        allocators[kind + "/" + name] = allocator;
+    }
+
+    void* find(const std::string& kind, const std::string& name)
+    {
+        auto it = allocators.find(kind + "/" + name);
+        return it != allocators.end() ? it->second : NULL;
+    }
+
+    struct Register {
+        Register(const char* kind, const std::string& name, void* allocator)
+        {
+            StaticLibs::get().add(kind, name, allocator);
+        }
+    };
+};
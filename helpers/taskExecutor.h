@@ -0,0 +1,199 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "helpers/frameScheduler.h"
+#include "helpers/httpClient.h"
+#include "log.h"
+
+// Background tasks of the UI components (network scans, HTTP requests, git...), run by a few workers instead of a
+// thread each, owned by the ViewManager and given to the components through their props:
+// - a task runs on a worker and returns its completion, run by the UI thread with the UI events before the next
+//   frame, see ViewManager::handleEvents(). So the task only works on its own copies, and the completion sets the
+//   state of the component, never both threads touching it.
+// - the queue is bounded, `post()` returning false when it is full, and the most urgent tasks run first, then the
+//   oldest. A task can be delayed, e.g. to poll a server, or hide a message, without holding a worker meanwhile.
+// - a cancelled token drops the tasks not started yet and their completions, a running task checking it if it
+//   takes long, e.g. a new scan replacing the previous one.
+// The workers are started by the first task, so a device without these components doesn't have them.
+class TaskExecutor {
+public:
+    enum Priority : uint8_t {
+        HIGH,
+        NORMAL,
+        LOW,
+    };
+
+    typedef std::shared_ptr<std::atomic<bool>> Token;
+    typedef std::function<void()> Completion;
+    typedef std::function<Completion()> Task;
+
+    static Token token()
+    {
+        return std::make_shared<std::atomic<bool>>(false);
+    }
+
+    static void cancel(const Token& token)
+    {
+        if (token) {
+            *token = true;
+        }
+    }
+
+    static bool isCancelled(const Token& token)
+    {
+        return token && token->load(std::memory_order_relaxed);
+    }
+
+    // Connections and conditional requests shared by the components, see httpClient.h
+    HttpClient http;
+
+protected:
+    using Clock = std::chrono::steady_clock;
+
+    struct Job {
+        Task task;
+        Token token;
+        Priority priority;
+        Clock::time_point due;
+        uint64_t order;
+    };
+
+    uint8_t threads;
+    size_t maxPending;
+    std::vector<std::thread> workers;
+    std::vector<Job> jobs;
+    uint64_t order = 0;
+    bool stopping = false;
+    std::mutex mtx;
+    std::condition_variable cv;
+
+    std::vector<std::pair<Token, Completion>> completions;
+    std::mutex completionsMtx;
+
+    // Index of the next job to run, -1 if none is due, `next` being when the first one will be
+    int nextJob(Clock::time_point now, Clock::time_point& next)
+    {
+        int best = -1;
+        next = Clock::time_point::max();
+        for (size_t i = 0; i < jobs.size(); i++) {
+            Job& job = jobs[i];
+            if (job.due > now) {
+                next = std::min(next, job.due);
+            } else if (best < 0 || job.priority < jobs[best].priority
+                || (job.priority == jobs[best].priority && job.order < jobs[best].order)) {
+                best = i;
+            }
+        }
+        return best;
+    }
+
+    void work()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stopping) {
+            // Cancelled jobs leave the queue without running
+            for (size_t i = 0; i < jobs.size();) {
+                if (isCancelled(jobs[i].token)) {
+                    jobs.erase(jobs.begin() + i);
+                } else {
+                    i++;
+                }
+            }
+            Clock::time_point next;
+            int index = nextJob(Clock::now(), next);
+            if (index < 0) {
+                if (next == Clock::time_point::max()) {
+                    cv.wait(lock);
+                } else {
+                    cv.wait_until(lock, next);
+                }
+                continue;
+            }
+            Job job = std::move(jobs[index]);
+            jobs.erase(jobs.begin() + index);
+            lock.unlock();
+
+            Completion completion;
+            try {
+                completion = job.task();
+            } catch (const std::exception& e) {
+                logError("Background task failed: %s", e.what());
+            }
+            if (completion && !isCancelled(job.token)) {
+                {
+                    std::lock_guard<std::mutex> guard(completionsMtx);
+                    completions.push_back({ job.token, completion });
+                }
+                FrameScheduler::get().wake();
+            }
+            lock.lock();
+        }
+    }
+
+public:
+    TaskExecutor(uint8_t threads = 2, size_t maxPending = 32)
+        : threads(threads)
+        , maxPending(maxPending)
+    {
+    }
+
+    ~TaskExecutor()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (std::thread& worker : workers) {
+            worker.join();
+        }
+    }
+
+    // From any thread, return false if too many tasks are pending, the task being dropped
+    bool post(Task task, Priority priority = NORMAL, Token token = NULL, uint32_t delayMs = 0)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            if (jobs.size() >= maxPending) {
+                logWarn("Background task queue full, task dropped");
+                return false;
+            }
+            jobs.push_back({ task, token, priority, Clock::now() + std::chrono::milliseconds(delayMs), order++ });
+            while (workers.size() < threads) {
+                workers.emplace_back([this] { work(); });
+            }
+        }
+        cv.notify_one();
+        return true;
+    }
+
+    // Run `completion` on the UI thread in `delayMs`, e.g. to hide a message
+    bool after(uint32_t delayMs, Completion completion, Token token = NULL)
+    {
+        return post([completion] { return completion; }, HIGH, token, delayMs);
+    }
+
+    // UI thread, see ViewManager::handleEvents(). Return true if a completion ran.
+    bool runCompletions()
+    {
+        std::vector<std::pair<Token, Completion>> ready;
+        {
+            std::lock_guard<std::mutex> guard(completionsMtx);
+            ready.swap(completions);
+        }
+        for (auto& [token, completion] : ready) {
+            if (!isCancelled(token)) {
+                completion();
+            }
+        }
+        return !ready.empty();
+    }
+};
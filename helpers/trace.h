@@ -0,0 +1,286 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <sys/syscall.h>
+#include <thread>
+#include <time.h>
+#include <unistd.h>
+#include <vector>
+
+#include "libs/nlohmann/json.hpp"
+#include "log.h"
+
+/*#md
+### Tracing
+
+`"trace": { "events": 16384, "file": "trace.json" }` record the blocks of the host, the processing of each track and
+plugin, the UI frames, the rendering of each component, the display flushes, the sample loads and the autosaves, with
+their start and end time. The trace is written on `kill -USR1 <pid>`, or with the `trace [file]` command of the
+control socket, as Chrome trace JSON, opened by `chrome://tracing` or [Perfetto](https://ui.perfetto.dev).
+
+- `"events": 16384` events kept per thread, the oldest being overwritten, so the trace covers the last moments before it is written (default 16384, about 2 seconds of blocks for a track with 8 plugins).
+- `"file": "trace.json"` file written on `SIGUSR1` (default `trace.json`).
+
+Each thread records in its own ring: tracing never takes a lock or allocates while playing, and costs a single check
+when disabled. The host reads `trace` from the `audio` config and the UI from the top of the config, so the UI
+process attached to a standalone host (see [Shared host](#shared-host)) traces its frames on its own.
+*/
+// Used by the host library, the app and the plugins: like StaticLibs, the class keeps the default visibility so the
+// static build shares a single tracer.
+class __attribute__((visibility("default"))) Trace {
+public:
+    struct Event {
+        uint64_t ns;
+        char name[23];
+        // `B` begin, `E` end, `i` instant
+        char phase;
+    };
+
+protected:
+    // Written by a single thread, read when dumping: the window read is checked again once copied, the events
+    // overwritten meanwhile being dropped.
+    struct Ring {
+        std::vector<Event> events;
+        std::atomic<uint64_t> written = 0;
+        long tid;
+        char threadName[16] = {};
+    };
+
+    std::mutex mtx;
+    std::vector<Ring*> rings;
+    uint32_t capacity = 16384;
+    std::string file = "trace.json";
+    bool dumping = false;
+    std::atomic<bool> dumpRequested = false;
+
+    static inline thread_local Ring* current = NULL;
+
+    static void onSignal(int)
+    {
+        get().dumpRequested.store(true, std::memory_order_relaxed);
+    }
+
+    // Registered once per thread, the capacity being rounded up to a power of 2 for the ring index. The ring of a
+    // thread that exited (e.g. a track thread before the tracks were reloaded) is given to the next thread.
+    Ring* ring()
+    {
+        if (!current) {
+            std::lock_guard<std::mutex> guard(mtx);
+            Ring* ring = NULL;
+            for (Ring* r : rings) {
+                if (access(("/proc/self/task/" + std::to_string(r->tid)).c_str(), F_OK) != 0) {
+                    ring = r;
+                    ring->written.store(0, std::memory_order_release);
+                    break;
+                }
+            }
+            if (!ring) {
+                ring = new Ring();
+                uint32_t size = 1;
+                while (size < capacity) {
+                    size <<= 1;
+                }
+                ring->events.resize(size);
+                rings.push_back(ring);
+            }
+            ring->tid = syscall(SYS_gettid);
+            pthread_getname_np(pthread_self(), ring->threadName, sizeof(ring->threadName));
+            current = ring;
+        }
+        return current;
+    }
+
+    void record(const char* name, char phase)
+    {
+        Ring* r = ring();
+        uint64_t index = r->written.load(std::memory_order_relaxed);
+        Event& event = r->events[index & (r->events.size() - 1)];
+        event.ns = now();
+        strncpy(event.name, name, sizeof(event.name) - 1);
+        event.name[sizeof(event.name) - 1] = '\0';
+        event.phase = phase;
+        r->written.store(index + 1, std::memory_order_release);
+    }
+
+    static void writeName(FILE* out, const char* name)
+    {
+        for (; *name; name++) {
+            if (*name == '"' || *name == '\\') {
+                fputc('\\', out);
+            }
+            fputc((unsigned char)*name < 0x20 ? ' ' : *name, out);
+        }
+    }
+
+    void startDumper()
+    {
+        if (dumping) {
+            return;
+        }
+        dumping = true;
+        struct sigaction action = {};
+        action.sa_handler = onSignal;
+        sigemptyset(&action.sa_mask);
+        action.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &action, NULL);
+        // Files can't be written from the signal handler
+        std::thread dumper([this] {
+            while (true) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                if (dumpRequested.exchange(false)) {
+                    dump(file);
+                }
+            }
+        });
+        pthread_setname_np(dumper.native_handle(), "trace");
+        dumper.detach();
+    }
+
+public:
+    std::atomic<bool> enabled = false;
+
+    static Trace& get()
+    {
+        static Trace instance;
+        return instance;
+    }
+
+    static bool on()
+    {
+        return get().enabled.load(std::memory_order_relaxed);
+    }
+
+    static uint64_t now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    void config(nlohmann::json& config)
+    {
+        if (config.is_boolean() && !config.get<bool>()) {
+            return;
+        }
+        if (config.is_object()) {
+            capacity = std::clamp(config.value("events", capacity), (uint32_t)64, (uint32_t)1 << 22);
+            file = config.value("file", file);
+        }
+        enabled = true;
+        startDumper();
+    }
+
+    // Register the calling thread, so its ring is not allocated by its first event, e.g. for the audio threads
+    void thread()
+    {
+        if (on()) {
+            ring();
+        }
+    }
+
+    void begin(const char* name)
+    {
+        record(name, 'B');
+    }
+
+    void end()
+    {
+        record("", 'E');
+    }
+
+    void instant(const char* name)
+    {
+        if (on()) {
+            record(name, 'i');
+        }
+    }
+
+    // Write the events of all the threads as Chrome trace JSON, return the number of events written or -1 on error
+    int dump(std::string path)
+    {
+        if (path.empty()) {
+            path = file;
+        }
+        std::vector<Ring*> list;
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            list = rings;
+        }
+        FILE* out = fopen(path.c_str(), "w");
+        if (!out) {
+            logWarn("Trace: could not write %s", path.c_str());
+            return -1;
+        }
+        fprintf(out, "{\"traceEvents\":[\n");
+        int count = 0;
+        pid_t pid = getpid();
+        std::vector<Event> events;
+        for (Ring* r : list) {
+            uint64_t size = r->events.size();
+            uint64_t end = r->written.load(std::memory_order_acquire);
+            uint64_t start = end > size ? end - size : 0;
+            events.clear();
+            for (uint64_t i = start; i < end; i++) {
+                events.push_back(r->events[i & (size - 1)]);
+            }
+            uint64_t after = r->written.load(std::memory_order_acquire);
+            uint64_t overwritten = after > size ? after - size : 0;
+            size_t skip = overwritten > start ? std::min<uint64_t>(overwritten - start, events.size()) : 0;
+
+            fprintf(out, "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":%d,\"tid\":%ld,\"args\":{\"name\":\"",
+                count ? ",\n" : "", pid, r->tid);
+            writeName(out, r->threadName);
+            fprintf(out, "\"}}");
+            count++;
+            // The window may start in the middle of a span, its end is dropped
+            int depth = 0;
+            for (size_t i = skip; i < events.size(); i++) {
+                Event& event = events[i];
+                if (event.phase == 'E' && depth == 0) {
+                    continue;
+                }
+                depth += event.phase == 'B' ? 1 : event.phase == 'E' ? -1 : 0;
+                fprintf(out, ",\n{\"name\":\"");
+                writeName(out, event.name);
+                fprintf(out, "\",\"ph\":\"%c\",\"ts\":%.3f,\"pid\":%d,\"tid\":%ld%s}", event.phase, event.ns / 1000.0,
+                    pid, r->tid, event.phase == 'i' ? ",\"s\":\"t\"" : "");
+                count++;
+            }
+        }
+        fprintf(out, "\n]}\n");
+        fclose(out);
+        logInfo("Trace: %d events written to %s", count, path.c_str());
+        return count;
+    }
+};
+
+// Span recorded from its creation to the end of its scope, when tracing is enabled
+class TraceSpan {
+protected:
+    bool active;
+
+public:
+    TraceSpan(const char* name)
+        : active(Trace::on())
+    {
+        if (active) {
+            Trace::get().begin(name);
+        }
+    }
+
+    ~TraceSpan()
+    {
+        if (active) {
+            Trace::get().end();
+        }
+    }
+};
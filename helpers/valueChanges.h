@@ -0,0 +1,113 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <functional>
+#include <vector>
+
+#include "helpers/frameScheduler.h"
+#include "helpers/processSingleton.h"
+#include "plugins/audio/valueInterface.h"
+
+// Changes of the values shown by the UI, dispatched once per frame by the UI thread:
+// - a value gets a slot once something subscribes to it, and from then on, each change only sets the bit of its
+//   slot, from whatever thread applied it (e.g. the audio thread, draining the parameter queue). Nothing else runs
+//   there, so a stream of changes (MIDI CC, automation) costs an atomic or per change.
+// - before each frame, `dispatch()` calls the subscribers of each value changed since the previous one, once per
+//   value however many times it changed meanwhile.
+// - any number of subscribers per value, e.g. 2 containers of the same view, the views subscribing their
+//   components when they are activated, see Container::activate(), and the ViewManager clearing them all before.
+class ValueChanges {
+public:
+    static const uint16_t MAX_VALUES = 4096;
+
+    typedef std::function<void(ValueInterface* value)> Subscriber;
+
+protected:
+    std::atomic<uint64_t> dirty[MAX_VALUES / 64] = {};
+    std::atomic<bool> pending = false;
+
+    struct Observed {
+        ValueInterface* value;
+        std::vector<std::pair<void*, Subscriber>> subscribers;
+    };
+    // By slot, only touched by the UI thread
+    std::vector<Observed> observed;
+
+public:
+    static ValueChanges& get()
+    {
+        return processSingleton<ValueChanges>();
+    }
+
+    // Any thread
+    void mark(uint16_t slot)
+    {
+        dirty[slot >> 6].fetch_or((uint64_t)1 << (slot & 63), std::memory_order_relaxed);
+        if (!pending.exchange(true, std::memory_order_acq_rel)) {
+            FrameScheduler::get().wake();
+        }
+    }
+
+    // UI thread, false once all the slots are taken
+    bool subscribe(ValueInterface* value, void* owner, Subscriber subscriber)
+    {
+        int32_t slot = value->changeSlot.load(std::memory_order_relaxed);
+        if (slot < 0) {
+            if (observed.size() >= MAX_VALUES) {
+                return false;
+            }
+            slot = observed.size();
+            observed.push_back({ value });
+            value->changeSlot.store(slot, std::memory_order_relaxed);
+        }
+        observed[slot].subscribers.push_back({ owner, subscriber });
+        return true;
+    }
+
+    // UI thread
+    void unsubscribe(void* owner)
+    {
+        for (Observed& o : observed) {
+            for (size_t i = 0; i < o.subscribers.size();) {
+                if (o.subscribers[i].first == owner) {
+                    o.subscribers.erase(o.subscribers.begin() + i);
+                } else {
+                    i++;
+                }
+            }
+        }
+    }
+
+    // UI thread, e.g. before another view is activated
+    void clear()
+    {
+        for (Observed& o : observed) {
+            o.subscribers.clear();
+        }
+    }
+
+    // UI thread, before the next frame. Return true if a value changed.
+    bool dispatch()
+    {
+        if (!pending.exchange(false, std::memory_order_acq_rel)) {
+            return false;
+        }
+        for (uint16_t word = 0; word < MAX_VALUES / 64; word++) {
+            uint64_t bits = dirty[word].exchange(0, std::memory_order_relaxed);
+            for (; bits; bits &= bits - 1) {
+                uint16_t slot = word * 64 + __builtin_ctzll(bits);
+                if (slot >= observed.size()) {
+                    continue;
+                }
+                Observed& o = observed[slot];
+                // A subscriber may subscribe others, e.g. by switching view
+                for (size_t i = 0; i < o.subscribers.size(); i++) {
+                    Subscriber subscriber = o.subscribers[i].second;
+                    subscriber(o.value);
+                }
+            }
+        }
+        return true;
+    }
+};
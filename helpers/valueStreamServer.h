@@ -0,0 +1,306 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <deque>
+#include <mutex>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libs/httplib/httplib.h"
+#include "libs/nlohmann/json.hpp"
+#include "log.h"
+#include "plugins/audio/audioPlugin.h"
+
+// Values of all the plugins over HTTP, for dashboards and scripts:
+// - `GET /values` answers `{ "version": 1, "values": [ { "id": 0, "track": 1, "plugin": "Drum", "key": "VOLUME",
+//   "value": 50 }, ... ] }`, `id` being the index of the value in the table of this version.
+// - `GET /values/stream` is a Server-Sent-Events stream: a `version` event `{ "version": 1 }` when the stream starts
+//   and each time the tracks were reloaded, the IDs then being listed again by `/values`, followed by the changes
+//   `{ "<id>": <value>, ... }`, coalesced and sent at most `rate` times per second.
+//
+// A single sampler thread reads the values, only while a stream is open, from the snapshot the plugins publish after
+// each block (see `AudioPlugin::readValues()`), so neither the audio nor the UI thread do anything for it. Each round
+// of changes is formatted once, from keys formatted when the table is built, and kept in a short log the streams
+// read from their own HTTP thread.
+class ValueStreamServer {
+protected:
+    struct Entry {
+        AudioPlugin* plugin;
+        int index;
+        // `"<id>":`
+        std::string key;
+    };
+
+    // Changes round, `sequence` increasing by one each
+    struct Event {
+        uint64_t sequence;
+        std::string text;
+    };
+    static const size_t LOG_SIZE = 64;
+
+    AudioPluginHandlerInterface* handler = NULL;
+    httplib::Server server;
+    std::thread serverThread;
+    std::thread samplerThread;
+    uint32_t periodMs = 100;
+    std::atomic<bool> stopping = false;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    uint32_t streams = 0;
+    std::deque<Event> log;
+    uint64_t sequence = 0;
+    uint32_t version = 0;
+
+    // Table of the values of the current plugins list, built by the first of the sampler thread or `/values` to see
+    // the list changed
+    std::mutex tableMtx;
+    const std::vector<AudioPlugin*>* plugins = NULL;
+    std::vector<Entry> table;
+    uint32_t announcedVersion = 0;
+    std::vector<float> sent;
+    std::vector<float> current;
+    std::vector<float> readBuffer;
+
+    static void appendNumber(std::string& out, float value)
+    {
+        if (!std::isfinite(value)) {
+            out += "null";
+            return;
+        }
+        char buffer[24];
+        int size = snprintf(buffer, sizeof(buffer), "%.7g", value);
+        out.append(buffer, size);
+    }
+
+    // Called with `tableMtx` held
+    void buildTable(const std::vector<AudioPlugin*>* list)
+    {
+        plugins = list;
+        table.clear();
+        for (AudioPlugin* plugin : *plugins) {
+            for (int i = 0; i < plugin->getValueCount(); i++) {
+                table.push_back({ plugin, i, "\"" + std::to_string(table.size()) + "\":" });
+            }
+        }
+        version++;
+        sent.assign(table.size(), NAN);
+        current.resize(table.size());
+    }
+
+    // Values of the table, from the snapshots where the plugins keep one
+    void readCurrent()
+    {
+        size_t i = 0;
+        while (i < table.size()) {
+            AudioPlugin* plugin = table[i].plugin;
+            bool snapshot = plugin->readValues(readBuffer);
+            for (; i < table.size() && table[i].plugin == plugin; i++) {
+                int index = table[i].index;
+                current[i] = snapshot && index < (int)readBuffer.size() ? readBuffer[index] : plugin->getValue(index)->get();
+            }
+        }
+    }
+
+    void pushEvent(std::string text)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        log.push_back({ ++sequence, std::move(text) });
+        if (log.size() > LOG_SIZE) {
+            log.pop_front();
+        }
+        cv.notify_all();
+    }
+
+    void sample()
+    {
+        const std::vector<AudioPlugin*>* list = handler->getPlugins();
+        if (!list) {
+            return;
+        }
+        std::string versionEvent;
+        std::string text = "data: {";
+        size_t empty = text.size();
+        {
+            std::lock_guard<std::mutex> guard(tableMtx);
+            if (list != plugins) {
+                buildTable(list);
+            }
+            if (announcedVersion != version) {
+                announcedVersion = version;
+                versionEvent = "event: version\ndata: {\"version\":" + std::to_string(version) + "}\n\n";
+            }
+            readCurrent();
+            for (size_t i = 0; i < table.size(); i++) {
+                // NaN never equals itself, so the first round sends everything
+                if (current[i] == sent[i]) {
+                    continue;
+                }
+                sent[i] = current[i];
+                if (text.size() > empty) {
+                    text += ',';
+                }
+                text += table[i].key;
+                appendNumber(text, current[i]);
+            }
+        }
+        if (!versionEvent.empty()) {
+            pushEvent(std::move(versionEvent));
+        }
+        if (text.size() > empty) {
+            text += "}\n\n";
+            pushEvent(std::move(text));
+        }
+    }
+
+    void samplerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (!stopping) {
+            if (!streams) {
+                cv.wait(lock, [&] { return streams || stopping; });
+                continue;
+            }
+            lock.unlock();
+            sample();
+            lock.lock();
+            cv.wait_for(lock, std::chrono::milliseconds(periodMs), [&] { return stopping.load(); });
+        }
+    }
+
+    void values(httplib::Response& res)
+    {
+        const std::vector<AudioPlugin*>* list = handler->getPlugins();
+        nlohmann::json values = nlohmann::json::array();
+        uint32_t tableVersion;
+        {
+            std::lock_guard<std::mutex> guard(tableMtx);
+            if (list && list != plugins) {
+                // No stream open yet, the sampler didn't build the table of this version
+                buildTable(list);
+            }
+            for (size_t i = 0; i < table.size(); i++) {
+                Entry& entry = table[i];
+                ValueInterface* value = entry.plugin->getValue(entry.index);
+                values.push_back({ { "id", i }, { "track", entry.plugin->track }, { "plugin", entry.plugin->name },
+                    { "key", value->key() }, { "value", value->get() } });
+            }
+            tableVersion = version;
+        }
+        nlohmann::json json = { { "version", tableVersion }, { "values", values } };
+        res.set_content(json.dump(), "application/json");
+    }
+
+    void stream(httplib::Response& res)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            streams++;
+            cv.notify_all();
+        }
+        // Resend the current values, the IDs of the version being listed by `/values`
+        uint64_t next = 0;
+        bool started = false;
+        res.set_chunked_content_provider(
+            "text/event-stream",
+            [this, next, started](size_t, httplib::DataSink& sink) mutable {
+                std::string out;
+                {
+                    std::unique_lock<std::mutex> lock(mtx);
+                    if (!started) {
+                        started = true;
+                        next = sequence + 1;
+                        // The sampler sends everything again on its next round
+                        lock.unlock();
+                        {
+                            std::lock_guard<std::mutex> guard(tableMtx);
+                            sent.assign(sent.size(), NAN);
+                            out = "event: version\ndata: {\"version\":" + std::to_string(version) + "}\n\n";
+                        }
+                        return sink.write(out.data(), out.size());
+                    }
+                    cv.wait_for(lock, std::chrono::seconds(15), [&] { return sequence >= next || stopping; });
+                    if (stopping) {
+                        return false;
+                    }
+                    if (!log.empty() && log.front().sequence > next) {
+                        // Too slow, the changes missed are lost: start over from the current values
+                        next = sequence + 1;
+                        out = "event: version\ndata: {\"version\":" + std::to_string(version) + "}\n\n";
+                        lock.unlock();
+                        std::lock_guard<std::mutex> guard(tableMtx);
+                        sent.assign(sent.size(), NAN);
+                        return sink.write(out.data(), out.size());
+                    }
+                    for (Event& event : log) {
+                        if (event.sequence >= next) {
+                            out += event.text;
+                        }
+                    }
+                    next = sequence + 1;
+                }
+                if (out.empty()) {
+                    // Keep the connection alive through proxies
+                    out = ":\n\n";
+                }
+                return sink.write(out.data(), out.size());
+            },
+            [this](bool) {
+                std::lock_guard<std::mutex> guard(mtx);
+                streams--;
+            });
+    }
+
+public:
+    ~ValueStreamServer()
+    {
+        stop();
+    }
+
+    bool running()
+    {
+        return serverThread.joinable();
+    }
+
+    // Serve the values on TCP `port` of all the interfaces, the changes being streamed at most `rate` times per second
+    bool start(AudioPluginHandlerInterface* pluginHandler, uint16_t port, uint32_t rate = 10)
+    {
+        if (running() || !pluginHandler) {
+            return false;
+        }
+        handler = pluginHandler;
+        periodMs = 1000 / (rate ? rate : 1);
+        server.set_default_headers({ { "Access-Control-Allow-Origin", "*" }, { "Cache-Control", "no-cache" } });
+        server.Get("/values", [this](const httplib::Request&, httplib::Response& res) { values(res); });
+        server.Get("/values/stream", [this](const httplib::Request&, httplib::Response& res) { stream(res); });
+        if (!server.bind_to_port("0.0.0.0", port)) {
+            logWarn("Value stream on port %d: %s", port, strerror(errno));
+            return false;
+        }
+        stopping = false;
+        serverThread = std::thread([this] { server.listen_after_bind(); });
+        pthread_setname_np(serverThread.native_handle(), "valueHttp");
+        samplerThread = std::thread([this] { samplerLoop(); });
+        pthread_setname_np(samplerThread.native_handle(), "valueStream");
+        logInfo("Values served on http://<host>:%d/values", port);
+        return true;
+    }
+
+    void stop()
+    {
+        if (!running()) {
+            return;
+        }
+        stopping = true;
+        cv.notify_all();
+        server.stop();
+        serverThread.join();
+        samplerThread.join();
+    }
+};
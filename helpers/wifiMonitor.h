@@ -0,0 +1,307 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <chrono>
+#include <cstdlib>
+#include <functional>
+#include <mutex>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "helpers/wpaCtrl.h"
+#include "helpers/processSingleton.h"
+#include "log.h"
+
+// State of the Wi-Fi, from the control interface of wpa_supplicant (see wpaCtrl.h), itself driving the driver
+// through nl80211: the networks of the last scan with their signal, and the current connection.
+// - Event driven: a thread waits for the events of wpa_supplicant, and only asks for the scan results once they are
+//   ready, or the status once connected or disconnected. While connected, the signal is polled every `pollMs`.
+// - The state is kept for the whole process, so a view showing the Wi-Fi again has it right away, without scanning.
+// - The listeners are called by the thread of the monitor on each change, e.g. to hand the new state to the UI
+//   thread through the task executor.
+// The requests (`scan()`, `connect()`) are answered within a few ms, but still block: call them from a worker.
+class WifiMonitor {
+public:
+    struct Network {
+        std::string ssid;
+        // dBm
+        int signal;
+        bool secured;
+    };
+
+    struct Status {
+        bool connected = false;
+        std::string ssid;
+        // dBm, 0 if unknown
+        int signal = 0;
+        // e.g. COMPLETED, SCANNING, DISCONNECTED
+        std::string state;
+    };
+
+    uint32_t pollMs = 5000;
+
+protected:
+    std::string path;
+    WpaCtrl ctrl;
+    WpaCtrl events;
+    // Guards `ctrl`, used by the monitor thread and the workers
+    std::mutex ctrlMtx;
+
+    std::mutex stateMtx;
+    std::vector<Network> networks;
+    Status status;
+    std::atomic<uint32_t> scanVersion = 0;
+    std::vector<std::function<void()>> listeners;
+
+    std::thread thread;
+    bool started = false;
+
+    bool request(const std::string& command, std::string& reply)
+    {
+        std::lock_guard<std::mutex> guard(ctrlMtx);
+        return ctrl.request(command, reply);
+    }
+
+    bool requestOk(const std::string& command)
+    {
+        std::lock_guard<std::mutex> guard(ctrlMtx);
+        return ctrl.requestOk(command);
+    }
+
+    void notify()
+    {
+        std::vector<std::function<void()>> current;
+        {
+            std::lock_guard<std::mutex> guard(stateMtx);
+            current = listeners;
+        }
+        for (auto& listener : current) {
+            listener();
+        }
+    }
+
+    // `bssid / frequency / signal level / flags / ssid`, one line per access point, tab separated
+    void refreshScan()
+    {
+        std::string reply;
+        if (!request("SCAN_RESULTS", reply)) {
+            return;
+        }
+        std::vector<Network> found;
+        std::istringstream lines(reply);
+        std::string line;
+        std::getline(lines, line); // header
+        while (std::getline(lines, line)) {
+            std::vector<std::string> fields;
+            std::istringstream columns(line);
+            std::string field;
+            while (std::getline(columns, field, '\t')) {
+                fields.push_back(field);
+            }
+            if (fields.size() < 5 || fields[4].empty()) {
+                continue;
+            }
+            Network network = { fields[4], atoi(fields[2].c_str()), fields[3].find("WPA") != std::string::npos || fields[3].find("WEP") != std::string::npos };
+            // The access points of the same network are shown once, with the best signal
+            auto same = std::find_if(found.begin(), found.end(), [&](Network& n) { return n.ssid == network.ssid; });
+            if (same == found.end()) {
+                found.push_back(network);
+            } else if (same->signal < network.signal) {
+                same->signal = network.signal;
+            }
+        }
+        std::sort(found.begin(), found.end(), [](const Network& a, const Network& b) { return a.signal > b.signal; });
+        {
+            std::lock_guard<std::mutex> guard(stateMtx);
+            networks = found;
+        }
+        scanVersion++;
+        notify();
+    }
+
+    // `key=value` lines
+    static std::string field(const std::string& reply, const std::string& key)
+    {
+        std::istringstream lines(reply);
+        std::string line;
+        while (std::getline(lines, line)) {
+            if (line.size() > key.size() && line[key.size()] == '=' && line.compare(0, key.size(), key) == 0) {
+                return line.substr(key.size() + 1);
+            }
+        }
+        return "";
+    }
+
+    void refreshStatus()
+    {
+        std::string reply;
+        if (!request("STATUS", reply)) {
+            return;
+        }
+        Status next;
+        next.state = field(reply, "wpa_state");
+        next.connected = next.state == "COMPLETED";
+        next.ssid = next.connected ? field(reply, "ssid") : "";
+        if (next.connected && request("SIGNAL_POLL", reply)) {
+            next.signal = atoi(field(reply, "RSSI").c_str());
+        }
+        bool changed;
+        {
+            std::lock_guard<std::mutex> guard(stateMtx);
+            changed = next.connected != status.connected || next.ssid != status.ssid || next.signal != status.signal || next.state != status.state;
+            status = next;
+        }
+        if (changed) {
+            notify();
+        }
+    }
+
+    bool reconnect()
+    {
+        std::lock_guard<std::mutex> guard(ctrlMtx);
+        return ctrl.open(path) && events.open(path) && events.requestOk("ATTACH");
+    }
+
+    void loop()
+    {
+        std::string event;
+        while (true) {
+            if (!events.isOpen() && !reconnect()) {
+                // wpa_supplicant restarting, e.g. after a new network was configured by hand
+                std::this_thread::sleep_for(std::chrono::seconds(1));
+                continue;
+            }
+            if (!events.receive(event, pollMs)) {
+                if (!events.isOpen() || !requestOk("PING")) {
+                    events.close();
+                    continue;
+                }
+                bool connected;
+                {
+                    std::lock_guard<std::mutex> guard(stateMtx);
+                    connected = status.connected;
+                }
+                if (connected) {
+                    refreshStatus();
+                }
+                continue;
+            }
+            if (event.find("CTRL-EVENT-SCAN-RESULTS") != std::string::npos) {
+                refreshScan();
+            } else if (event.find("CTRL-EVENT-CONNECTED") != std::string::npos || event.find("CTRL-EVENT-DISCONNECTED") != std::string::npos
+                || event.find("CTRL-EVENT-SSID-TEMP-DISABLED") != std::string::npos) {
+                refreshStatus();
+            } else if (event.find("CTRL-EVENT-TERMINATING") != std::string::npos) {
+                events.close();
+            }
+        }
+    }
+
+    static std::string hex(const std::string& value)
+    {
+        static const char* digits = "0123456789abcdef";
+        std::string out;
+        for (unsigned char c : value) {
+            out += digits[c >> 4];
+            out += digits[c & 0xF];
+        }
+        return out;
+    }
+
+public:
+    static WifiMonitor& get()
+    {
+        return processSingleton<WifiMonitor>();
+    }
+
+    // Return false if wpa_supplicant has no control interface for `iface` in `dir`, e.g. not running
+    bool start(const std::string& iface, const std::string& dir = "/var/run/wpa_supplicant")
+    {
+        if (started) {
+            return true;
+        }
+        path = dir + "/" + iface;
+        if (!reconnect()) {
+            return false;
+        }
+        started = true;
+        refreshStatus();
+        refreshScan();
+        thread = std::thread([this] { loop(); });
+        thread.detach();
+        logDebug("Wi-Fi monitor on %s", path.c_str());
+        return true;
+    }
+
+    // `listener` is called by the thread of the monitor
+    void listen(std::function<void()> listener)
+    {
+        std::lock_guard<std::mutex> guard(stateMtx);
+        listeners.push_back(listener);
+    }
+
+    void snapshot(std::vector<Network>& outNetworks, Status& outStatus)
+    {
+        std::lock_guard<std::mutex> guard(stateMtx);
+        outNetworks = networks;
+        outStatus = status;
+    }
+
+    // Incremented by each scan result, e.g. to know that the scan asked for is done
+    uint32_t scans()
+    {
+        return scanVersion.load();
+    }
+
+    // The results come with the `CTRL-EVENT-SCAN-RESULTS` event
+    bool scan()
+    {
+        std::string reply;
+        // Already scanning is fine, the results come anyway
+        return request("SCAN", reply) && (reply.rfind("OK", 0) == 0 || reply.rfind("FAIL-BUSY", 0) == 0);
+    }
+
+    // Select the network, added to the configuration if it is not there yet, and saved if wpa_supplicant is allowed
+    // to (`update_config=1`). The connection comes with the `CTRL-EVENT-CONNECTED` event.
+    bool connect(const std::string& ssid, const std::string& password)
+    {
+        std::string reply;
+        std::string id;
+        if (request("LIST_NETWORKS", reply)) {
+            // `network id / ssid / bssid / flags`
+            std::istringstream lines(reply);
+            std::string line;
+            std::getline(lines, line);
+            while (std::getline(lines, line)) {
+                size_t tab = line.find('\t');
+                if (tab != std::string::npos && line.substr(tab + 1, line.find('\t', tab + 1) - tab - 1) == ssid) {
+                    id = line.substr(0, tab);
+                    break;
+                }
+            }
+        }
+        if (id.empty()) {
+            if (!request("ADD_NETWORK", reply) || reply.empty() || !isdigit(reply[0])) {
+                return false;
+            }
+            id = reply.substr(0, reply.find('\n'));
+        }
+        // The SSID in hexadecimal, so any character goes through
+        if (!requestOk("SET_NETWORK " + id + " ssid " + hex(ssid))) {
+            return false;
+        }
+        bool secured = password.empty() ? requestOk("SET_NETWORK " + id + " key_mgmt NONE")
+                                         : requestOk("SET_NETWORK " + id + " psk \"" + password + "\"");
+        if (!secured || !requestOk("SELECT_NETWORK " + id)) {
+            return false;
+        }
+        if (!requestOk("SAVE_CONFIG")) {
+            logDebug("wpa_supplicant could not save the network, update_config=1 missing?");
+        }
+        return true;
+    }
+};
@@ -0,0 +1,102 @@
+#pragma once
+
+#include <atomic>
+#include <cerrno>
+#include <cstdio>
+#include <poll.h>
+#include <string>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+// Client of the control interface of wpa_supplicant: a Unix datagram socket in its `ctrl_interface` directory, one
+// per network interface, e.g. `/var/run/wpa_supplicant/wlan0`. Each request is a datagram answered by another one,
+// and once `ATTACH`ed, the socket also receives the events, e.g. `<3>CTRL-EVENT-SCAN-RESULTS`.
+// Same protocol as the `wpa_ctrl` library of wpa_supplicant, without depending on it.
+class WpaCtrl {
+protected:
+    int fd = -1;
+    std::string localPath;
+
+public:
+    ~WpaCtrl()
+    {
+        close();
+    }
+
+    bool open(const std::string& path)
+    {
+        close();
+        fd = socket(AF_UNIX, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            return false;
+        }
+        // The answers are sent to the address of the client, so it must have one
+        static std::atomic<uint32_t> counter = 0;
+        localPath = "/tmp/zic_wpa_" + std::to_string(getpid()) + "_" + std::to_string(counter++);
+        unlink(localPath.c_str());
+        struct sockaddr_un local = {};
+        local.sun_family = AF_UNIX;
+        snprintf(local.sun_path, sizeof(local.sun_path), "%s", localPath.c_str());
+        struct sockaddr_un dest = {};
+        dest.sun_family = AF_UNIX;
+        snprintf(dest.sun_path, sizeof(dest.sun_path), "%s", path.c_str());
+        if (bind(fd, (struct sockaddr*)&local, sizeof(local)) != 0 || connect(fd, (struct sockaddr*)&dest, sizeof(dest)) != 0) {
+            close();
+            return false;
+        }
+        return true;
+    }
+
+    void close()
+    {
+        if (fd >= 0) {
+            ::close(fd);
+            fd = -1;
+            unlink(localPath.c_str());
+        }
+    }
+
+    bool isOpen()
+    {
+        return fd >= 0;
+    }
+
+    // Next datagram, false on timeout or if the socket failed, e.g. wpa_supplicant restarted
+    bool receive(std::string& message, int timeoutMs)
+    {
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        int ready = poll(&pfd, 1, timeoutMs);
+        if (ready <= 0 || (pfd.revents & (POLLERR | POLLHUP))) {
+            return false;
+        }
+        char buffer[4096];
+        ssize_t n = recv(fd, buffer, sizeof(buffer), 0);
+        if (n < 0) {
+            return false;
+        }
+        message.assign(buffer, n);
+        return true;
+    }
+
+    // Answer of `command`, e.g. `OK\n`, or false if it didn't come within `timeoutMs`
+    bool request(const std::string& command, std::string& reply, int timeoutMs = 2000)
+    {
+        if (fd < 0 || send(fd, command.c_str(), command.size(), 0) < 0) {
+            return false;
+        }
+        while (receive(reply, timeoutMs)) {
+            // An event received by an attached socket before the answer
+            if (reply.empty() || reply[0] != '<') {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    bool requestOk(const std::string& command)
+    {
+        std::string reply;
+        return request(command, reply) && reply.rfind("OK", 0) == 0;
+    }
+};
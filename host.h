@@ -8,8 +8,23 @@
 #include "log.h"
 #include "plugins/audio/audioPlugin.h"
 #include "helpers/getExecutableDirectory.h"
+#include "host/SharedHost.h"
 
+// With `ZIC_HOST_SHM=<name>`, the UI attaches to `zicHost --shm <name>` running in its own process, see SharedHost.h
+SharedHost* getSharedHost()
+{
+    static SharedHost* sharedHost = NULL;
+    const char* name = getenv("ZIC_HOST_SHM");
+    if (!sharedHost && name && name[0] != '\0') {
+        sharedHost = new SharedHost(name);
+    }
+    return sharedHost;
+}
+
+// The static build (see `make static`) links the host in zic instead of opening libzicHost.so
+#ifndef ZIC_STATIC
 #define USE_HOST_SO
+#endif
 #ifdef USE_HOST_SO
 
 struct Host {
@@ -29,6 +44,11 @@ void hostConfig(nlohmann::json& config)
     }
 }
 
+bool hostReloadTracks(nlohmann::json& config)
+{
+    return host && host->audioPluginHandler->reloadTracks(config);
+}
+
 void sendAudioEvent(AudioEventType event, int16_t track = -1)
 {
     host->audioPluginHandler->sendEvent(event, track);
@@ -44,7 +64,7 @@ void* hostThread(void* = NULL)
 
 AudioPluginHandlerInterface* getAudioPluginHandler()
 {
-    return host->audioPluginHandler;
+    return host ? host->audioPluginHandler : NULL;
 }
 
 void loadHostPlugin()
@@ -54,6 +74,12 @@ void loadHostPlugin()
         return;
     }
 
+    if (getSharedHost()) {
+        host = new Host();
+        host->audioPluginHandler = getSharedHost();
+        return;
+    }
+
     void* handle = dlopen((getExecutableDirectory() + "/libs/libzicHost.so").c_str(), RTLD_LAZY);
     if (!handle) {
         logError("Cannot open host library libzicHost: %s", dlerror());
@@ -76,20 +102,38 @@ void loadHostPlugin()
 #include "host/AudioPluginHandler.h"
 #include "plugins/audio/valueInterface.h"
 
+AudioPluginHandlerInterface* getAudioPluginHandler()
+{
+    if (getSharedHost()) {
+        return getSharedHost();
+    }
+    return &AudioPluginHandler::get();
+}
+
 void* hostThread(void* = NULL)
 {
-    AudioPluginHandler::get().loop();
+    getAudioPluginHandler()->loop();
     return NULL;
 }
 
 AudioPlugin& getPlugin(std::string name, int16_t track = -1)
 {
-    return AudioPluginHandler::get().getPlugin(name, track);
+    return getAudioPluginHandler()->getPlugin(name, track);
+}
+
+void sendAudioEvent(AudioEventType event, int16_t track = -1)
+{
+    getAudioPluginHandler()->sendEvent(event, track);
+}
+
+void hostConfig(nlohmann::json& config)
+{
+    getAudioPluginHandler()->config(config);
 }
 
-void sendAudioEvent(AudioEventType event)
+bool hostReloadTracks(nlohmann::json& config)
 {
-    AudioPluginHandler::get().sendEvent(event);
+    return getAudioPluginHandler()->reloadTracks(config);
 }
 
 void loadHostPlugin()
@@ -2,23 +2,44 @@
 
 using namespace std;
 
+#include <algorithm>
 #include <fstream>
 #include <functional>
+#include <map>
+#include <memory>
 #include <stdexcept>
 #include <string>
 #include <thread>
+#include <unordered_map>
 
 #include <alsa/asoundlib.h>
-
+#include <chrono>
+#include <poll.h>
+
+#include "Denormals.h"
+#include "DspLoad.h"
+#include "MeterTap.h"
+#include "MidiParser.h"
+#include "OfflineRender.h"
+#include "PowerManager.h"
+#include "QualityGovernor.h"
+#include "Realtime.h"
+#include "SharedSegment.h"
 #include "Track.h"
+#include "TrackScheduler.h"
+#include "XrunLog.h"
 #include "def.h"
 #include "helpers/clamp.h"
 #include "helpers/getExecutableDirectory.h"
+#include "helpers/staticLibs.h"
+#include "helpers/trace.h"
 #include "helpers/trim.h"
 #include "log.h"
 #include "midiMapping.h"
 #include "plugins/audio/audioPlugin.h"
+#include "plugins/audio/utils/MemoryBudget.h"
 #include "audio/lookupTable.h"
+#include "audio/utils/SimdDispatch.h"
 
 /*#md
 ## Global and generic config
@@ -32,28 +53,36 @@ class AudioPluginHandler : public AudioPluginHandlerInterface {
 protected:
     LookupTable lookupTable;
 
-    AudioPlugin::Props pluginProps = { SAMPLE_RATE, AUDIO_CHANNELS, this, MAX_TRACKS, &lookupTable };
-
-    std::vector<MidiMapping> midiMapping;
+    // Whether each track only output silence during the current block
+    bool silentTracks[TOTAL_TRACKS] = {};
+    // Whether each track outputs stereo, when the buffer is stereo
+    bool stereoTracks[TOTAL_TRACKS] = {};
+    // Large DSP buffers of the plugins, when `arenaSize` is configured
+    PluginArena arena;
+    // Clock ticks of the current block, listed by the tempo plugin
+    ClockEvents clockEvents;
+    // LFOs, MIDI CC and followers shared by the modulation routes of the plugins
+    ModulationSources modulation;
+    // Set while a workspace is hydrated, see `reloadWorkspace()`
+    std::atomic<bool> holdChanges = false;
+    AudioPlugin::Props pluginProps = { SAMPLE_RATE, AUDIO_CHANNELS, this, MAX_TRACKS, &lookupTable, TOTAL_TRACKS, 1, DEFAULT_BLOCK_SIZE, silentTracks };
+
+    // Each track lane is cache-line aligned in planar layout
+    static const uint32_t BUFFER_ALIGNMENT = 64;
+
+    MidiMappingTable midiMapping;
 
     // When reached the maximum, there might be a tempo issue
     // However, to reach it, it is almost impossible...
     uint64_t clockCounter = 0;
     bool playing = false;
 
-    struct MidiNoteEvent {
-        uint8_t channel;
-        NoteTarget target;
-    };
-    std::vector<MidiNoteEvent> midiNoteEvents;
+    // Plugins assigned to each MIDI channel, see `assignPluginToMidiChannel()`
+    std::vector<NoteTarget> midiChannelTargets[16];
 
     std::thread autoSaveThread;
 
     static AudioPluginHandler* instance;
-    AudioPluginHandler()
-    {
-        listMidiDevices();
-    }
 
     std::vector<uint8_t> getTrackIds()
     {
@@ -70,7 +99,7 @@ protected:
 
     Track* createTrack(uint8_t id, float* buffer, std::condition_variable& masterCv)
     {
-        Track* track = new Track(id, buffer, masterCv, MAX_TRACKS);
+        Track* track = new Track(id, buffer, masterCv, pluginProps);
         for (AudioPlugin* plugin : plugins) {
             if (plugin->track == id && plugin->getType() != AudioPlugin::Type::TEMPO) {
                 track->plugins.push_back(plugin);
@@ -129,7 +158,7 @@ protected:
         std::vector<Track*> sortedTracks;
         // First push tracks without dependencies
         for (Track* track : tracks) {
-            if (!track->hasDependencies()) {
+            if (track->getInputs().empty()) {
                 sortedTracks.push_back(track);
                 trackIds.insert(track->id);
             }
@@ -139,7 +168,7 @@ protected:
             for (Track* track : tracks) {
                 // Check that track is not already in the sortedTracks
                 if (trackIds.find(track->id) == trackIds.end()) {
-                    std::set<uint8_t> dependencies = track->getDependencies();
+                    std::set<uint8_t> dependencies = track->getInputs();
                     uint8_t missing = countMissingTracks(dependencies, trackIds, originTrackIds);
                     // printf("----> Track %d dependencies %ld missing %d\n", track->id, dependencies.size(), missing);
                     // now check that all dependencies are in the sortedTracks
@@ -154,6 +183,26 @@ protected:
     }
 
 public:
+    // The plugins only reach their host through `props.audioPluginHandler`, so several hosts can run in the same
+    // process, see ProjectGroup
+    AudioPluginHandler()
+    {
+        pluginProps.clockEvents = &clockEvents;
+        pluginProps.stereoTracks = stereoTracks;
+        pluginProps.modulation = &modulation;
+        pluginProps.holdChanges = &holdChanges;
+        listMidiDevices();
+    }
+
+    ~AudioPluginHandler()
+    {
+        midiOutputRunning = false;
+        if (midiOutputThread.joinable()) {
+            midiOutputThread.join();
+        }
+    }
+
+    // Host of the standalone process
     static AudioPluginHandler& get()
     {
         if (!instance) {
@@ -164,6 +213,28 @@ public:
 
     AudioPlugin* getPluginPtr(std::string name, int16_t track = -1) override
     {
+        // While a track is instantiated, its plugins can only find the ones of the same track already loaded
+        if (loadingTrack && track == loadingTrack->id) {
+            for (AudioPlugin* plugin : loadingTrack->plugins) {
+                if (plugin->name == name) {
+                    return plugin;
+                }
+            }
+            return NULL;
+        }
+        PluginIndex* index = pluginIndex.load();
+        if (index) {
+            auto it = index->find(name);
+            if (it == index->end()) {
+                return NULL;
+            }
+            for (AudioPlugin* plugin : it->second) {
+                if (track == -1 || plugin->track == track) {
+                    return plugin;
+                }
+            }
+            return NULL;
+        }
         for (AudioPlugin* plugin : plugins) {
             if (plugin->name == name && (track == -1 || plugin->track == track)) {
                 return plugin;
@@ -185,15 +256,114 @@ public:
         return *plugin;
     }
 
+    // Tracks processed by the audio thread. The other threads (MIDI input, events) go through `trackSnapshot`.
     std::vector<Track*> tracks;
-    void loop()
+
+protected:
+    // Tracks list for the threads other than the audio thread, replaced when tracks are reloaded. Like the plugins
+    // list, a replaced list is never deleted, and neither are the tracks it holds, see Reload.
+    std::atomic<std::vector<Track*>*> trackSnapshot = NULL;
+
+    void publishTracks()
+    {
+        trackSnapshot = new std::vector<Track*>(tracks);
+    }
+
+    // Plugins by name, in the plugins list order, so looking up a plugin does not scan the whole list
+    typedef std::unordered_map<std::string, std::vector<AudioPlugin*>> PluginIndex;
+    // Like the plugins list, a replaced index is never deleted, lookups might still be running on it
+    std::atomic<PluginIndex*> pluginIndex = NULL;
+
+    static PluginIndex* indexPlugins(std::vector<AudioPlugin*>& list)
+    {
+        PluginIndex* index = new PluginIndex();
+        for (AudioPlugin* plugin : list) {
+            (*index)[plugin->name].push_back(plugin);
+        }
+        return index;
+    }
+
+    // Plugins a note sent to a track, or to all the tracks, is routed to: all but the tempo, the ones found to
+    // ignore notes (see `AudioPlugin::ignoresNotes`) being skipped. Like the index, a replaced one is never deleted.
+    struct NoteRoutes {
+        std::vector<AudioPlugin*> tracks[MAX_TRACKS];
+        std::vector<AudioPlugin*> all;
+    };
+    std::atomic<NoteRoutes*> noteRoutes = NULL;
+
+    static NoteRoutes* routeNotes(std::vector<AudioPlugin*>& list)
+    {
+        NoteRoutes* routes = new NoteRoutes();
+        for (AudioPlugin* plugin : list) {
+            if (plugin->getType() == AudioPlugin::Type::TEMPO) {
+                continue;
+            }
+            routes->all.push_back(plugin);
+            if (plugin->track >= 0 && plugin->track < MAX_TRACKS) {
+                routes->tracks[plugin->track].push_back(plugin);
+            }
+        }
+        return routes;
+    }
+
+    std::vector<AudioPlugin*>* getNoteRoute(int16_t track)
     {
-        int bufferSize = 128 * TOTAL_TRACKS;
-        float buffer[128 * TOTAL_TRACKS] = { 0.0f };
+        NoteRoutes* routes = noteRoutes.load();
+        if (!routes) {
+            return NULL;
+        }
+        if (track == -1) {
+            return &routes->all;
+        }
+        return track >= 0 && track < MAX_TRACKS ? &routes->tracks[track] : NULL;
+    }
 
-        std::mutex masterMtx;
-        std::condition_variable masterCv;
+public:
+    void loop()
+    {
         std::unique_lock<std::mutex> lock = std::unique_lock(masterMtx);
+        if (!startLoop()) {
+            return;
+        }
+        if (loopPlugin) {
+            // The render thread belongs to the audio server, it takes the lock for each block.
+            // The server may render several blocks per period, so it reports its own xruns instead.
+            lateNs = 0;
+            lock.unlock();
+            loopPlugin->runAudioLoop([this]() {
+                static thread_local bool threadReady = false;
+                if (!threadReady) {
+                    threadReady = true;
+                    Denormals::flushToZero();
+                    Trace::get().thread();
+                }
+                std::unique_lock<std::mutex> blockLock(masterMtx);
+                return renderBlock(blockLock);
+            });
+            lock.lock();
+        } else {
+            Trace::get().thread();
+            while (isRunning) {
+                if (clockPlugin) {
+                    clockPlugin->waitForNextBlock(pluginProps.blockSize);
+                }
+                renderBlock(lock);
+            }
+        }
+        stopLoop();
+    }
+
+    // Create and start the tracks, the calling thread becoming the host thread. Return false if the audio loop
+    // cannot start.
+    bool startLoop()
+    {
+        // Interleaved: blockSize frames of TOTAL_TRACKS floats
+        // Planar: TOTAL_TRACKS lanes of blockSize floats, the last lane being the clock track
+        // Stereo: the right channels of all the tracks follow the left ones, in each frame or as more lanes
+        const uint32_t blockSize = pluginProps.blockSize;
+        bufferSize = blockSize * TOTAL_TRACKS * (pluginProps.rightOffset ? 2 : 1);
+        buffer = (float*)aligned_alloc(BUFFER_ALIGNMENT, bufferSize * sizeof(float));
+        memset(buffer, 0, bufferSize * sizeof(float));
 
         // Create tracks
         // Sorting the tracks would not be mandatory if plugins are instanciated in the right order in the config file
@@ -202,6 +372,7 @@ public:
         // at all because track 0 would design at first position but also be used for audio output, meaning the that the
         // buffer would be cleaned up even before the audio output being consumed...
         tracks = sortTracksByDependencies(createTracks(buffer, masterCv));
+        publishTracks();
         // std::vector<Track*> tracks = createTracks(buffer, masterCv);
 
         if (initActiveMidiTrack > -1) {
@@ -209,101 +380,873 @@ public:
             setActiveMidiTrack(initActiveMidiTrack, true);
         }
 
-        Track* threadTracks[TOTAL_TRACKS];
-        Track* hostTracks[TOTAL_TRACKS];
-        int threadCount = 0;
-        int hostCount = 0;
+        tempoPlugin = getTempoPlugin();
 
-        AudioPlugin* tempoPlugin = getTempoPlugin();
+        if (xrunLogEnabled || quality.watchesTemperature()) {
+            xrunLog.startMonitor();
+        }
+        power.start();
+        if (quality.enabled) {
+            quality.start(pluginProps.sampleRate, blockSize);
+            qualityDeadlineNs = (uint64_t)blockSize * 1000000000ULL / pluginProps.sampleRate;
+        }
+        // A block starting more than half a block later than the previous one missed its deadline
+        lateNs = (int64_t)blockSize * 1500000000LL / pluginProps.sampleRate;
+        lastBlockTime = 0;
+
+        if (dspLoadEnabled) {
+            // Kept until the host is destroyed, the UI holding a pointer to it
+            if (!dspLoad) {
+                dspLoad = std::make_unique<DspLoad>(pluginProps.sampleRate, blockSize);
+            }
+            dspLoad->countDenormals = countDenormals;
+            dspLoad->countPerf = countPerf;
+            dspLoad->tracks.reserve(TOTAL_TRACKS);
+            if (dspLoadLogInterval > 0) {
+                startDspLoadLog(dspLoadLogInterval);
+            }
+        }
+
+        // The host thread runs the master track and waits for all the other ones
+        Denormals::flushToZero();
+        realtime.applyHost(pthread_self());
+        if (realtime.shouldPrefaultStack()) {
+            Realtime::prefaultStack();
+        }
 
         // Init tracks
+        if (sharedScheduling) {
+            useTrackScheduler = true;
+        }
+        initTracks();
+        realtime.isolate();
+
+        if (!tempoPlugin) {
+            // Should we allow to start without tempo?? then would need if statement around the loops..
+            logError("No tempo plugin loaded. There should be at one to start audio loop.");
+            free(buffer);
+            return false;
+        }
+
+        // When an audio device is the clock, wait for it to be ready before processing each block,
+        // instead of blocking on the write to the device from the master track.
+        // When an audio server drives the loop, its process callback renders the blocks instead (pull model).
+        clockPlugin = NULL;
+        loopPlugin = NULL;
+        for (AudioPlugin* plugin : plugins) {
+            if (!loopPlugin && plugin->drivesAudioLoop()) {
+                loopPlugin = plugin;
+                logInfo("Audio loop driven by %s", plugin->name.c_str());
+            } else if (!clockPlugin && plugin->isClockSource()) {
+                clockPlugin = plugin;
+                logInfo("Audio loop clocked by %s", plugin->name.c_str());
+            }
+        }
+
+        midiClockDataId = tempoPlugin->getDataId("MIDI_CLOCK");
+        midiClockTarget = tempoPlugin;
+
+        tracksReady = true;
+        startEventWorker();
+        return true;
+    }
+
+    // Stop and release the tracks, once the last block was rendered
+    void stopLoop()
+    {
+        tracksReady = false;
+        stopEventWorker();
+        if (dspLoadLogThread.joinable()) {
+            dspLoadLogThread.join();
+        }
+        releaseTracks();
+    }
+
+    // Process one block of the audio loop, `lock` holding `masterMtx`. Return false once the host is stopping.
+    // Called by `loop()`, or by the process callback of the plugin driving the audio loop.
+    bool renderBlock(std::unique_lock<std::mutex>& lock)
+    {
+        if (!isRunning) {
+            return false;
+        }
+        TraceSpan span("block");
+        auto ms = std::chrono::milliseconds(10);
+        beginBlock();
+
+        if (useTrackScheduler) {
+            scheduler->run();
+        } else if (threadCount > 0) {
+            for (int t = 0; t < threadCount; t++) {
+                Track* track = threadTracks[t];
+                track->block = blockFrame;
+                track->processing = true;
+                track->cv.notify_one();
+            }
+
+            masterCv.wait_for(lock, ms, [&] {
+                for (int t = 0; t < threadCount; t++) {
+                    Track* track = threadTracks[t];
+                    if (track->processing) {
+                        return false;
+                    }
+                }
+                return true;
+            });
+        }
+        endBlock();
+        return true;
+    }
+
+    // Start a block: apply the pending events and run the tempo, before the tracks are processed
+    void beginBlock()
+    {
+        const uint32_t blockSize = pluginProps.blockSize;
+        applyEvents();
+        blockTime = nowNs();
+        if (xrunLogEnabled && lateNs > 0 && lastBlockTime > 0 && blockTime - lastBlockTime > lateNs) {
+            addXrun(XrunLog::DEADLINE, (blockTime - lastBlockTime) / 1000);
+        }
+        lastBlockTime = blockTime;
+        blockStart = dspLoad || quality.enabled ? DspLoad::now() : 0;
+        tempoPlugin->sampleBlock(buffer, blockSize);
+        if (dspLoad) {
+            dspLoad->tempo.add(DspLoad::now() - blockStart, dspLoad->deadlineNs);
+        }
+    }
+
+    // End a block, once the tracks are processed: run the host tracks, then clear the buffer for the next block
+    void endBlock()
+    {
+        const uint32_t blockSize = pluginProps.blockSize;
+        // The host tracks are measured in CPU time, as the audio output they hold waits for the sound card
+        uint64_t parallelNs = quality.enabled ? DspLoad::now() - blockStart : 0;
+        uint64_t hostStart = quality.enabled ? QualityGovernor::threadNs() : 0;
+        // NOTE: why multiple tracks here? one should be enough...
+        for (int t = 0; t < hostCount; t++) {
+            hostTracks[t]->processBlock(blockSize);
+        }
+
+        if (dspLoad) {
+            dspLoad->block.add(DspLoad::now() - blockStart, dspLoad->deadlineNs);
+        }
+        if (quality.enabled) {
+            float load = (parallelNs + QualityGovernor::threadNs() - hostStart) * 100.0f / qualityDeadlineNs;
+            if (quality.update(load, xrunLog.milliCelsius)) {
+                logInfo("Quality level %d, load %.0f%%", quality.level, load);
+                applyQualityLevel();
+            }
+        }
+
+        if (sharedSegment) {
+            publishPeaks();
+        }
+
+        // The followers read the output of the block before it is cleared
+        modulation.update(buffer, pluginProps.trackStride, pluginProps.frameStride, blockSize, pluginProps.sampleRate);
+        // cleanup buffer
+        memset(buffer, 0, bufferSize * sizeof(float));
+        blockFrame += blockSize;
+
+        // Tracks reloaded from the config are swapped in between two blocks
+        Reload* reload = pendingReload.exchange(NULL);
+        if (reload) {
+            applyReload(reload);
+        }
+    }
+
+    // Let a ProjectGroup schedule the tracks, with the ones of the other projects, instead of a scheduler of
+    // its own, see `getSchedulerTracks()`. Must be set before the loop starts.
+    void setSharedScheduling()
+    {
+        sharedScheduling = true;
+    }
+
+    // Tracks to schedule in the shared pool, sorted by dependencies
+    std::vector<Track*>& getSchedulerTracks()
+    {
+        schedulerTracksChanged = false;
+        return schedulerTracks;
+    }
+
+    // True when the tracks to schedule changed since they were last read, e.g. after a reload
+    bool schedulerTracksHaveChanged() { return schedulerTracksChanged; }
+
+    // Start the workers of the scheduler, as many as `trackSchedulerWorkers`, with the realtime settings of this host
+    void startSchedulerWorkers(TrackScheduler& trackScheduler)
+    {
+        // The host thread is taking part in the work, so one core is already used
+        int workers = schedulerWorkers;
+        if (workers < 0) {
+            workers = std::thread::hardware_concurrency() - 1;
+        }
+        trackScheduler.startWorkers(CLAMP(workers, 0, MAX_TRACKS), realtime.shouldPrefaultStack());
+        int i = 0;
+        for (std::thread& worker : trackScheduler.getWorkers()) {
+            realtime.applyTrack(worker.native_handle(), -1, "worker_" + std::to_string(i++));
+        }
+    }
+
+    uint32_t getBlockSize() { return pluginProps.blockSize; }
+
+    // Plugin of the device clocking the loop, NULL if none, once the loop started
+    AudioPlugin* getClockPlugin() { return clockPlugin; }
+
+    // Plugin of the audio server driving the loop, NULL if none, once the loop started
+    AudioPlugin* getLoopPlugin() { return loopPlugin; }
+
+    /*#md
+    ### Offline render
+
+    The standalone host can render the tracks to a WAV file as fast as the CPU allows, instead of playing them in real
+    time, e.g. to bounce a whole workspace or to compare the sound output between two versions:
+
+    `zicHost config.json --render out.wav --bars 16 --workspace myWorkspace --stems`
+
+    - `--render out.wav` file to write the master track (track 0) to.
+    - `--seconds 30`, `--bars 16` (4 beats at the tempo BPM) or `--loops 2` (sequencer loops of `--loopTrack 1`, by
+    default the first track to loop) length of the render. When several are given, the shortest one is used.
+    - `--stems` also write each track in its own file, e.g. `out_track1.wav`.
+    - `--workspace myWorkspace` load the workspace before rendering, it becomes the current workspace.
+
+    The audio input and output plugins are not loaded, autosave is disabled and the tracks are processed by the
+    `pool` track scheduler, so independent tracks are rendered in parallel.
+    */
+    // Requires `setRender()` to be called before loading the config. Return false if nothing could be rendered.
+    bool render()
+    {
+        const uint32_t blockSize = pluginProps.blockSize;
+        bufferSize = blockSize * TOTAL_TRACKS * (pluginProps.rightOffset ? 2 : 1);
+        buffer = (float*)aligned_alloc(BUFFER_ALIGNMENT, bufferSize * sizeof(float));
+        memset(buffer, 0, bufferSize * sizeof(float));
+
+        tracks = sortTracksByDependencies(createTracks(buffer, masterCv));
+        publishTracks();
+        tempoPlugin = getTempoPlugin();
+        if (!tempoPlugin || !renderOptions) {
+            logError(!tempoPlugin ? "No tempo plugin loaded, nothing to render." : "Render options are not set.");
+            releaseTracks();
+            return false;
+        }
+        // Independent tracks are processed in parallel by the scheduler workers
+        Denormals::flushToZero();
+        initTracks();
+
+        uint64_t totalFrames = renderOptions->seconds * pluginProps.sampleRate;
+        if (renderOptions->bars > 0.0f) {
+            ValueInterface* bpm = tempoPlugin->getValue("BPM");
+            uint64_t barFrames = renderOptions->bars * 4 * 60 * pluginProps.sampleRate / (bpm ? bpm->get() : 120.0f);
+            if (totalFrames == 0 || barFrames < totalFrames) {
+                totalFrames = barFrames;
+            }
+        }
+        if (totalFrames == 0 && renderOptions->loops == 0) {
+            logError("Offline render needs a length: seconds, bars or loops.");
+            releaseTracks();
+            return false;
+        }
+
+        std::vector<RenderSink*> sinks;
+        // Like the audio outputs, the master mix is the lane of track 0
+        sinks.push_back(new RenderSink(renderOptions->file, 0, pluginProps.channels, pluginProps.sampleRate, blockSize));
+        if (renderOptions->stems) {
+            for (Track* track : tracks) {
+                if (track->id != 0) {
+                    sinks.push_back(new RenderSink(renderOptions->stemFile(track->id), track->id, pluginProps.channels, pluginProps.sampleRate, blockSize));
+                }
+            }
+        }
+
+        if (!renderOptions->workspace.empty()) {
+            loadWorkspace(renderOptions->workspace);
+        }
+
+        renderLoops = 0;
+        sendEvent(AudioEventType::START);
+        tracksReady = true;
+        startEventWorker();
+        uint64_t frames = 0;
+        auto start = std::chrono::steady_clock::now();
+        while (isRunning
+            && (totalFrames == 0 || frames < totalFrames)
+            && (renderOptions->loops == 0 || renderLoops < renderOptions->loops)) {
+            applyEvents();
+            blockTime = nowNs();
+            tempoPlugin->sampleBlock(buffer, blockSize);
+            if (scheduler) {
+                scheduler->run();
+            }
+            for (int t = 0; t < hostCount; t++) {
+                hostTracks[t]->processBlock(blockSize);
+            }
+
+            uint32_t count = totalFrames > 0 && totalFrames - frames < blockSize ? totalFrames - frames : blockSize;
+            for (RenderSink* sink : sinks) {
+                if (sink->isOpen()) {
+                    float* lane = buffer + sink->track * pluginProps.trackStride;
+                    sink->write(lane, stereoTracks[sink->track] ? lane + pluginProps.rightOffset : lane, pluginProps.frameStride, count);
+                }
+            }
+
+            modulation.update(buffer, pluginProps.trackStride, pluginProps.frameStride, blockSize, pluginProps.sampleRate);
+            memset(buffer, 0, bufferSize * sizeof(float));
+            blockFrame += blockSize;
+            frames += count;
+        }
+        tracksReady = false;
+        stopEventWorker();
+        sendEvent(AudioEventType::STOP);
+
+        float renderSeconds = std::chrono::duration<float>(std::chrono::steady_clock::now() - start).count();
+        float audioSeconds = (float)frames / pluginProps.sampleRate;
+        logInfo("Rendered %.1fs of audio in %.1fs (%.1fx realtime) to %s",
+            audioSeconds, renderSeconds, renderSeconds > 0.0f ? audioSeconds / renderSeconds : 0.0f, renderOptions->file.c_str());
+        for (RenderSink* sink : sinks) {
+            if (sink != sinks[0] && sink->isOpen()) {
+                logInfo("- stem of track %d: %s", sink->track, sink->path.c_str());
+            }
+            delete sink;
+        }
+        releaseTracks();
+        return true;
+    }
+
+    // Switch to offline render: audio devices are not loaded and the loop is replaced by `render()`
+    void setRender(RenderOptions& options)
+    {
+        renderOptions = &options;
+        useTrackScheduler = true;
+    }
+
+protected:
+    RenderOptions* renderOptions = NULL;
+    std::atomic<uint32_t> renderLoops = 0;
+    int16_t renderLoopTrack = -1;
+
+    // Let the SerializeTrack plugins switch to the given workspace
+    void loadWorkspace(std::string workspace)
+    {
+        for (auto& [id, trackConfig] : trackConfigs) {
+            for (nlohmann::json& pluginConfig : trackConfig) {
+                if (pluginConfig.value("plugin", "") != "SerializeTrack") {
+                    continue;
+                }
+                AudioPlugin* plugin = getPluginPtr(pluginConfig.value("alias", ""), id);
+                if (plugin) {
+                    logInfo("Render workspace %s", workspace.c_str());
+                    // Changing the workspace of one of them reloads all of them
+                    plugin->data(plugin->getDataId("LOAD_WORKSPACE"), &workspace);
+                    return;
+                }
+            }
+        }
+        logWarn("No SerializeTrack plugin to load workspace %s", workspace.c_str());
+    }
+
+    void releaseTracks()
+    {
+        midiClockTarget = NULL;
+        activeMidiTrack = NULL;
+        trackSnapshot = NULL;
+        if (scheduler) {
+            delete scheduler;
+            scheduler = NULL;
+        }
         for (Track* track : tracks) {
-            // For the moment, let's assume that last track is always master track
-            bool isMaster = track->id == tracks.back()->id;
-            track->init(tracks, isMaster);
+            if (track->thread.joinable()) {
+                track->thread.join();
+            }
+        }
+        for (Track* track : tracks) {
+            delete track;
+        }
+        tracks.clear();
+        free(buffer);
+        buffer = NULL;
+    }
+
+    float* buffer = NULL;
+    std::mutex masterMtx;
+    std::condition_variable masterCv;
+
+    // State of the audio loop, shared between `startLoop()`, `beginBlock()` and `endBlock()`
+    int bufferSize = 0;
+    AudioPlugin* tempoPlugin = NULL;
+    int64_t lateNs = 0;
+    int64_t lastBlockTime = 0;
+    uint64_t blockStart = 0;
+    AudioPlugin* clockPlugin = NULL;
+    AudioPlugin* loopPlugin = NULL;
+    Track* threadTracks[TOTAL_TRACKS];
+    Track* hostTracks[TOTAL_TRACKS];
+    int threadCount = 0;
+    int hostCount = 0;
+    // With the scheduler, every track but the master is a node of its graph
+    TrackScheduler* scheduler = NULL;
+    // With a ProjectGroup, the nodes are run by the scheduler of the group instead
+    bool sharedScheduling = false;
+    std::vector<Track*> schedulerTracks;
+    bool schedulerTracksChanged = false;
+
+    // Dispatch the tracks between their own thread, the track scheduler and the host thread.
+    // Tracks already initialized (kept by a reload) keep running as they are.
+    void initTracks()
+    {
+        threadCount = 0;
+        hostCount = 0;
+        schedulerTracks.clear();
+        // For the moment, let's assume that last track is always master track
+        Track* master = tracks.size() > 0 ? tracks.back() : NULL;
+        for (Track* track : tracks) {
+            bool isMaster = track == master;
+            if (!track->initialized) {
+                track->prefaultStack = realtime.shouldPrefaultStack();
+                track->init(tracks, isMaster, !useTrackScheduler);
+                if (track->thread.joinable()) {
+                    realtime.applyTrack(track->thread.native_handle(), track->id, "track_" + std::to_string(track->id));
+                }
+            }
             if (track->thread.joinable()) {
                 threadTracks[threadCount++] = track;
+            } else if (useTrackScheduler && !isMaster) {
+                schedulerTracks.push_back(track);
             } else {
                 hostTracks[hostCount++] = track;
             }
         }
 
-        if (!tempoPlugin) {
-            // Should we allow to start without tempo?? then would need if statement around the loops..
-            logError("No tempo plugin loaded. There should be at one to start audio loop.");
-            return;
+        if (sharedScheduling) {
+            schedulerTracksChanged = true;
+        } else if (useTrackScheduler) {
+            if (scheduler) {
+                delete scheduler;
+            }
+            scheduler = new TrackScheduler(pluginProps.blockSize);
+            scheduler->setGraphs({ schedulerTracks });
+            startSchedulerWorkers(*scheduler);
         }
 
-        if (threadCount == 0) {
-            while (isRunning) {
-                float buffer[TOTAL_TRACKS] = { 0.0f };
-                tempoPlugin->sample(buffer);
-                for (int i = 0; i < hostCount; i++) {
-                    hostTracks[i]->process(buffer);
-                }
+        if (voiceWorkers > 0 && !voicePool) {
+            voicePool = new VoicePool();
+            voicePool->init(CLAMP(voiceWorkers, 0, VoicePool::MAX_GROUPS - 1), realtime.shouldPrefaultStack());
+            int i = 0;
+            for (std::thread& worker : voicePool->getWorkers()) {
+                realtime.applyTrack(worker.native_handle(), -1, "voices_" + std::to_string(i++));
             }
-        } else {
-            auto ms = std::chrono::milliseconds(10);
+        }
+        for (Track* track : tracks) {
+            if (track->voicePool != voicePool) {
+                track->setVoicePool(voicePool);
+            }
+        }
 
-            while (isRunning) {
-                for (uint8_t i = 0; i < 128; i++) {
-                    tempoPlugin->sample(buffer + i * CLOCK_TRACK);
+        compensateLatency();
+
+        for (Track* track : tracks) {
+            auto meter = meters.find(track->id);
+            track->meter = meter != meters.end() ? meter->second : NULL;
+        }
+
+        if (dspLoad) {
+            // Capacity is reserved, so the UI never reads a reallocated list
+            dspLoad->tracks.clear();
+            dspLoad->tracks.resize(tracks.size());
+            for (int i = 0; i < tracks.size(); i++) {
+                tracks[i]->setDspLoad(dspLoad.get(), &dspLoad->tracks[i]);
+            }
+        }
+    }
+
+    //#md Latency compensation: plugins reporting a latency (e.g. lookahead) delay their track. The other inputs of the tracks mixing it are automatically delayed by the difference, so they stay aligned. When a track is the input of several tracks needing a different delay, the biggest one is applied and a warning is logged.
+    void compensateLatency()
+    {
+        std::map<uint8_t, Track*> byId;
+        for (Track* track : tracks) {
+            byId[track->id] = track;
+        }
+        // Tracks are sorted by dependencies: the latency of the inputs of a track is known before reaching it
+        std::map<uint8_t, uint32_t> outputLatency;
+        std::map<uint8_t, uint32_t> delays;
+        std::map<uint8_t, uint32_t> inputLatencies;
+        for (Track* track : tracks) {
+            uint32_t inputLatency = 0;
+            for (uint8_t id : track->getDependencies()) {
+                if (byId.count(id) && outputLatency[id] > inputLatency) {
+                    inputLatency = outputLatency[id];
                 }
+            }
+            for (uint8_t id : track->getDependencies()) {
+                if (byId.count(id)) {
+                    uint32_t delay = inputLatency - outputLatency[id];
+                    if (delays.count(id) && delays[id] != delay) {
+                        logWarn("Track %d feeds tracks with different latencies, it cannot be aligned with all of them", id);
+                    }
+                    delays[id] = delays.count(id) && delays[id] > delay ? delays[id] : delay;
+                }
+            }
+            outputLatency[track->id] = inputLatency + track->pluginsLatency();
+        }
 
-                for (int t = 0; t < threadCount; t++) {
-                    Track* track = threadTracks[t];
-                    track->processing = true;
-                    track->cv.notify_one();
+        for (Track* track : tracks) {
+            uint32_t delay = delays[track->id];
+            if (delay != track->compensation.size()) {
+                track->setCompensation(delay);
+            }
+            track->latency = outputLatency[track->id] + delay;
+            if (delay > 0) {
+                logInfo("Track %d delayed by %d frames to compensate the latency of the other inputs", track->id, delay);
+            }
+        }
+        if (tracks.size() > 0 && tracks.back()->latency > 0) {
+            logInfo("Audio graph latency: %d frames", tracks.back()->latency);
+        }
+    }
+
+    /*#md
+    ### Hot reload
+
+    When the config file is watched (`WATCH=1`) and only the plugins of some tracks changed, those tracks are reloaded
+    without restarting the app: the new plugins are loaded in the background and swapped in between two audio blocks,
+    while the other tracks keep running with their current state. Within a reloaded track, plugins with an unchanged
+    config keep their state. Tracks holding the tempo or the audio clock plugin always need a restart.
+    */
+    struct Reload {
+        std::set<uint8_t> trackIds;
+        std::vector<AudioPlugin*> plugins;
+        // Replaced plugins are never deleted: UI components, midi mappings or other plugins might still point to them
+        std::vector<AudioPlugin*> retired;
+        // Replaced tracks are stopped but never deleted either: the MIDI thread might still be queueing notes to them
+        std::vector<Track*> retiredTracks;
+        PluginIndex* index = NULL;
+        NoteRoutes* routes = NULL;
+        std::vector<AudioPlugin*>* snapshot = NULL;
+    };
+    std::atomic<Reload*> pendingReload = NULL;
+    std::vector<Reload*> appliedReloads;
+    // Plugins config of each track, as loaded
+    std::map<uint8_t, nlohmann::json> trackConfigs;
+
+    std::map<uint8_t, nlohmann::json> getTrackConfigs(nlohmann::json& config)
+    {
+        std::map<uint8_t, nlohmann::json> configs;
+        if (config.contains("tracks") && config["tracks"].is_array()) {
+            for (nlohmann::json& track : config["tracks"]) {
+                uint8_t trackId = CLAMP(track["id"].get<uint8_t>(), 0, MAX_TRACKS - 1);
+                if (track.contains("plugins") && track["plugins"].is_array()) {
+                    for (nlohmann::json& plugin : track["plugins"]) {
+                        configs[trackId].push_back(plugin);
+                    }
                 }
+            }
+        }
+        return configs;
+    }
+
+    nlohmann::json* findPluginConfig(nlohmann::json& trackConfig, std::string alias)
+    {
+        for (nlohmann::json& plugin : trackConfig) {
+            if (plugin.value("alias", "") == alias) {
+                return &plugin;
+            }
+        }
+        return NULL;
+    }
+
+    void applyReload(Reload* reload)
+    {
+        std::vector<Track*> keptTracks;
+        for (Track* track : tracks) {
+            if (reload->trackIds.find(track->id) != reload->trackIds.end()) {
+                track->stop();
+                reload->retiredTracks.push_back(track);
+            } else {
+                keptTracks.push_back(track);
+            }
+        }
+        // Other threads might still be iterating over the previous list: keep it alive in the reload
+        plugins.swap(reload->plugins);
+        reload->index = pluginIndex.exchange(reload->index);
+        reload->routes = noteRoutes.exchange(reload->routes);
+        pluginSnapshot = reload->snapshot;
+        for (uint8_t id : reload->trackIds) {
+            Track* track = createTrack(id, buffer, masterCv);
+            if (track->plugins.size() > 0) {
+                keptTracks.push_back(track);
+            } else {
+                delete track;
+            }
+        }
+        tracks = sortTracksByDependencies(keptTracks);
+        publishTracks();
+        Track* midiTrack = activeMidiTrack;
+        if (midiTrack && std::find(reload->retiredTracks.begin(), reload->retiredTracks.end(), midiTrack) != reload->retiredTracks.end()) {
+            activeMidiTrack = findTrack(midiTrack->id);
+        }
+        initTracks();
+        if (quality.level > 0) {
+            applyQualityLevel();
+        }
+        appliedReloads.push_back(reload);
+        logInfo("Reloaded %d track(s)", (int)reload->trackIds.size());
+    }
 
-                masterCv.wait_for(lock, ms, [&] {
-                    for (int t = 0; t < threadCount; t++) {
-                        Track* track = threadTracks[t];
-                        if (track->processing) {
-                            return false;
+public:
+    // Reload the tracks which plugins changed in the given audio config. Return false if a restart is needed.
+    bool reloadTracks(nlohmann::json& config) override
+    {
+        if (!tracksReady || pendingReload.load() != NULL) {
+            return false;
+        }
+
+        std::map<uint8_t, nlohmann::json> configs = getTrackConfigs(config);
+        std::set<uint8_t> changed;
+        for (auto& [id, trackConfig] : configs) {
+            if (trackConfigs.find(id) == trackConfigs.end() || trackConfigs[id] != trackConfig) {
+                changed.insert(id);
+            }
+        }
+        for (auto& [id, trackConfig] : trackConfigs) {
+            if (configs.find(id) == configs.end()) {
+                changed.insert(id);
+            }
+        }
+        if (changed.size() == 0) {
+            return true;
+        }
+
+        Reload* reload = new Reload();
+        reload->trackIds = changed;
+        for (AudioPlugin* plugin : plugins) {
+            if (changed.find(plugin->track) == changed.end()) {
+                reload->plugins.push_back(plugin);
+            } else if (plugin->getType() == AudioPlugin::Type::TEMPO || plugin->isClockSource()) {
+                logWarn("Track %d holds %s, it cannot be reloaded.", plugin->track, plugin->name.c_str());
+                delete reload;
+                return false;
+            } else {
+                reload->retired.push_back(plugin);
+            }
+        }
+
+        for (uint8_t id : changed) {
+            if (configs.find(id) == configs.end()) {
+                continue;
+            }
+            logInfo("*** Reload plugins for track %d", id);
+            LoadingTrack loading = { id };
+            loadingTrack = &loading;
+            for (nlohmann::json& pluginConfig : configs[id]) {
+                AudioPlugin* instance = createPlugin(pluginConfig, id);
+                if (!instance) {
+                    continue;
+                }
+                if (instance->getType() == AudioPlugin::Type::TEMPO || instance->isClockSource()) {
+                    logWarn("Track %d now holds %s, it cannot be reloaded.", id, instance->name.c_str());
+                    loadingTrack = NULL;
+                    delete instance;
+                    delete reload;
+                    return false;
+                }
+                loading.plugins.push_back(instance);
+                // A plugin with the same config keeps its state
+                nlohmann::json* previousConfig = trackConfigs.find(id) != trackConfigs.end() ? findPluginConfig(trackConfigs[id], instance->name) : NULL;
+                if (previousConfig && *previousConfig == pluginConfig) {
+                    for (AudioPlugin* previous : reload->retired) {
+                        if (previous->track == id && previous->name == instance->name) {
+                            nlohmann::json state;
+                            previous->serializeJson(state);
+                            instance->hydrateJson(state);
+                            break;
                         }
                     }
-                    return true;
-                });
+                }
+                reload->plugins.push_back(instance);
+            }
+            loadingTrack = NULL;
+        }
 
-                // NOTE: why multiple tracks here? one should be enough...
-                for (int t = 0; t < hostCount; t++) {
-                    for (uint8_t i = 0; i < 128; i++) {
-                        hostTracks[t]->process(i);
-                    }
+        reload->index = indexPlugins(reload->plugins);
+        reload->routes = routeNotes(reload->plugins);
+        reload->snapshot = new std::vector<AudioPlugin*>(reload->plugins);
+        trackConfigs = configs;
+        pendingReload = reload;
+        // Wait for the new tracks to be swapped in, so the caller can bind to the new plugins
+        while (pendingReload.load() != NULL && tracksReady) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(1));
+        }
+        return true;
+    }
+
+    std::unique_ptr<DspLoad> dspLoad;
+    std::thread dspLoadLogThread;
+
+    // Meter of each metered track, never deleted: the UI keeps pointers to them
+    std::map<uint8_t, MeterTap*> meters;
+
+    XrunLog xrunLog;
+    bool xrunLogEnabled = true;
+
+    QualityGovernor quality;
+    uint64_t qualityDeadlineNs = 0;
+
+    PowerManager power;
+
+    // Segment shared with a UI process, see host/SharedHostServer.h
+    SharedSegment* sharedSegment = NULL;
+
+    // Keep the highest peak of each track until the UI reads it
+    void publishPeaks()
+    {
+        const uint32_t blockSize = pluginProps.blockSize;
+        for (uint8_t id = 0; id < TOTAL_TRACKS; id++) {
+            if (silentTracks[id]) {
+                continue;
+            }
+            float* lane = buffer + id * pluginProps.trackStride;
+            float peak = 0.0f;
+            for (uint32_t f = 0; f < blockSize; f++) {
+                peak = std::max(peak, std::fabs(lane[f * pluginProps.frameStride]));
+                if (pluginProps.rightOffset) {
+                    peak = std::max(peak, std::fabs(lane[f * pluginProps.frameStride + pluginProps.rightOffset]));
                 }
+            }
+            std::atomic<float>& shared = sharedSegment->peaks[id];
+            if (peak > shared.load(std::memory_order_relaxed)) {
+                shared.store(peak, std::memory_order_relaxed);
+            }
+        }
+    }
 
-                // cleanup buffer
-                for (int i = 0; i < bufferSize; i++) {
-                    buffer[i] = 0.0f;
+    // Between two blocks, the tracks being idle
+    void applyQualityLevel()
+    {
+        for (AudioPlugin* plugin : plugins) {
+            plugin->setQualityLevel(quality.level);
+        }
+    }
+
+    void addXrun(XrunLog::Type type, uint32_t value)
+    {
+        Trace::get().instant("xrun");
+        xrunLog.add(type, value, [&](XrunLog::Entry& entry) {
+            if (!dspLoad) {
+                return;
+            }
+            for (DspLoad::TrackLoad& track : dspLoad->tracks) {
+                if (entry.trackCount < TOTAL_TRACKS) {
+                    entry.trackIds[entry.trackCount] = track.id;
+                    entry.trackUs[entry.trackCount] = track.total.lastNs / 1000;
+                    entry.trackCount++;
                 }
             }
-            // Wait for to finish
-            for (Track* track : tracks) {
-                if (track->thread.joinable()) {
-                    track->thread.join();
+        });
+    }
+
+    void reportXrun(uint8_t type, uint32_t value = 0) override
+    {
+        if (xrunLogEnabled) {
+            addXrun((XrunLog::Type)type, value);
+        }
+    }
+
+    void startDspLoadLog(uint32_t msInterval)
+    {
+        dspLoadLogThread = std::thread([this, msInterval]() {
+            while (isRunning) {
+                std::this_thread::sleep_for(std::chrono::milliseconds(msInterval));
+                logInfo("DSP load: block avg %.1f%% max %.1f%% p99 %.0f%%, tempo avg %.1f%%",
+                    dspLoad->block.stats.avg, dspLoad->block.stats.max, dspLoad->block.stats.p99, dspLoad->tempo.stats.avg);
+                for (DspLoad::TrackLoad& track : dspLoad->tracks) {
+                    std::string plugins;
+                    for (int i = 0; i < track.plugins.size(); i++) {
+                        plugins += " " + track.pluginNames[i] + " " + std::to_string((int)track.plugins[i].stats.avg) + "%";
+                        if (dspLoad->countDenormals && track.denormals[i] > 0) {
+                            plugins += " (" + std::to_string(track.denormals[i]) + " denormals)";
+                        }
+                        if (dspLoad->countPerf && track.counters[i].frames > 0) {
+                            plugins += " (" + track.counters[i].toString() + ")";
+                        }
+                    }
+                    logInfo("- track %d avg %.1f%% max %.1f%% p99 %.0f%%:%s",
+                        track.id, track.total.stats.avg, track.total.stats.max, track.total.stats.p99, plugins.c_str());
                 }
             }
+        });
+        pthread_setname_np(dspLoadLogThread.native_handle(), "dspLoadLog");
+    }
+
+    // Publish the peaks of the tracks in the segment of `zicHost --shm`, before the audio loop starts
+    void share(SharedSegment* segment)
+    {
+        sharedSegment = segment;
+    }
+
+    // Host data, e.g. `DSP_LOAD` returning the DspLoad stats (NULL if not enabled), `XRUN_LOG` returning the
+    // XrunLog (NULL if not enabled), `METER` returning the MeterTap of the track pointed by `userdata` (a `uint8_t`,
+    // NULL if the track is not metered), `MEMORY` returning the MemoryBudget of the caches
+    uint8_t getDataId(std::string name) override
+    {
+        if (name == "DSP_LOAD") {
+            return 0;
+        }
+        if (name == "XRUN_LOG") {
+            return 1;
+        }
+        if (name == "METER") {
+            return 2;
+        }
+        if (name == "MEMORY") {
+            return 3;
         }
+        return 255;
+    }
 
-        // Delete tracks
-        for (Track* track : tracks) {
-            delete track;
+    void* data(int id, void* userdata = NULL) override
+    {
+        if (id == 0) {
+            return dspLoad.get();
         }
+        if (id == 1) {
+            return xrunLogEnabled ? &xrunLog : NULL;
+        }
+        if (id == 2 && userdata) {
+            auto meter = meters.find(*(uint8_t*)userdata);
+            return meter != meters.end() ? meter->second : NULL;
+        }
+        if (id == 3) {
+            return &MemoryBudget::get();
+        }
+        return NULL;
     }
 
     void loadPlugin(nlohmann::json& config, uint8_t trackId)
     {
-        std::string path = config["plugin"]; // plugin name or path
-        if (path.substr(path.length() - 3) != ".so") {
-            path = getExecutableDirectory() + "/libs/audio/libzic_" + path + ".so";
+        AudioPlugin* instance = createPlugin(config, trackId);
+        if (instance) {
+            plugins.push_back(instance);
+            pluginIndex = indexPlugins(plugins);
+            noteRoutes = routeNotes(plugins);
+            pluginSnapshot = new std::vector<AudioPlugin*>(plugins);
+        }
+    }
+
+    // Allocator of each plugin library, so each library is only opened once
+    std::map<std::string, void*> allocators;
+    // Plugins can be instantiated in parallel: guard what they share while loading
+    std::mutex loadMtx;
+
+    void* getAllocator(std::string path)
+    {
+        std::lock_guard<std::mutex> guard(loadMtx);
+        auto it = allocators.find(path);
+        if (it != allocators.end()) {
+            return it->second;
         }
 
         void* handle = dlopen(path.c_str(), RTLD_LAZY);
 
         if (!handle) {
             logWarn("Cannot open audio library %s: %s", path.c_str(), dlerror());
-            return;
+            return NULL;
         }
         dlerror();
         void* allocator = (AudioPlugin*)dlsym(handle, "allocator");
@@ -311,17 +1254,169 @@ public:
         if (dlsym_error) {
             logWarn("Cannot load symbol: %s", dlsym_error);
             dlclose(handle);
+            return NULL;
+        }
+        allocators[path] = allocator;
+        return allocator;
+    }
+
+    void logArenaUsage()
+    {
+        if (!pluginProps.arena) {
             return;
         }
+        size_t arenaTotal = 0;
+        size_t heapTotal = 0;
+        for (auto& [owner, usage] : arena.usage()) {
+            logDebug("- %s: %.1f MB in arena, %.1f MB on heap", owner.c_str(), usage.arena / 1048576.0f, usage.heap / 1048576.0f);
+            arenaTotal += usage.arena;
+            heapTotal += usage.heap;
+        }
+        logInfo("Plugin buffers: %.1f MB of %.1f MB arena used, %.1f MB on heap", arenaTotal / 1048576.0f, arena.size() / 1048576.0f, heapTotal / 1048576.0f);
+        if (heapTotal > 0) {
+            logWarn("Plugin arena is full, increase `arenaSize` to avoid page faults while playing");
+        }
+    }
+
+    AudioPlugin* createPlugin(nlohmann::json& config, uint8_t trackId)
+    {
+        std::string path = config["plugin"]; // plugin name or path
+        // The offline render writes to file, the sound card is not used
+        if (renderOptions && (path.find("AudioOutput") != std::string::npos || path.find("AudioInput") != std::string::npos
+                || path.find("AudioJack") != std::string::npos)) {
+            logInfo("Offline render, skip %s", path.c_str());
+            return NULL;
+        }
+        // Linked in the binary by the static build, else opened from its library
+        void* allocator = StaticLibs::get().find("audio", path);
+        if (!allocator) {
+            if (path.substr(path.length() - 3) != ".so") {
+                path = getExecutableDirectory() + "/libs/audio/libzic_" + path + ".so";
+            }
+            allocator = getAllocator(path);
+        }
+        if (!allocator) {
+            return NULL;
+        }
 
         std::string name = config["alias"];
         AudioPlugin::Config pluginConfig = { name, config, trackId };
+        PluginArena::Owner owner(pluginProps.arena, name + " (track " + std::to_string(trackId) + ")");
         AudioPlugin* instance = ((AudioPlugin * (*)(AudioPlugin::Props & props, AudioPlugin::Config & config)) allocator)(pluginProps, pluginConfig);
+        instance->indexValues();
+        instance->mapMidiCmds(config);
+        instance->mapModulation(config);
         logTrace("- audio plugin loaded: %s", instance->name.c_str());
-        plugins.push_back(instance);
+        return instance;
+    }
+
+    // Track being instantiated by the current thread, with its plugins loaded so far
+    struct LoadingTrack {
+        uint8_t id;
+        std::vector<AudioPlugin*> plugins;
+        std::vector<float> loadMs;
+    };
+    inline static thread_local LoadingTrack* loadingTrack = NULL;
+    uint8_t startupWorkers = 0;
+
+    // Instantiate the plugins of all the tracks. Tracks are loaded in parallel by a pool of workers, but the plugins
+    // of a track are loaded one after the other, in order, as they might look for each other.
+    void loadTracks(nlohmann::json& tracksConfig)
+    {
+        std::vector<LoadingTrack> jobs;
+        std::vector<std::vector<nlohmann::json*>> jobConfigs;
+        for (nlohmann::json& track : tracksConfig) {
+            uint8_t trackId = CLAMP(track["id"].get<uint8_t>(), 0, MAX_TRACKS - 1);
+            if (!track.contains("plugins") || !track["plugins"].is_array()) {
+                continue;
+            }
+            int job = 0;
+            while (job < jobs.size() && jobs[job].id != trackId) {
+                job++;
+            }
+            if (job == jobs.size()) {
+                jobs.push_back({ trackId });
+                jobConfigs.push_back({});
+            }
+            for (nlohmann::json& plugin : track["plugins"]) {
+                jobConfigs[job].push_back(&plugin);
+            }
+        }
+
+        std::atomic<int> nextJob = 0;
+        std::exception_ptr error = NULL;
+        std::mutex errorMtx;
+        auto worker = [&]() {
+            int job;
+            while ((job = nextJob++) < jobs.size()) {
+                loadingTrack = &jobs[job];
+                try {
+                    for (nlohmann::json* pluginConfig : jobConfigs[job]) {
+                        auto start = std::chrono::steady_clock::now();
+                        AudioPlugin* instance = createPlugin(*pluginConfig, jobs[job].id);
+                        if (instance) {
+                            jobs[job].plugins.push_back(instance);
+                            jobs[job].loadMs.push_back(std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count());
+                        }
+                    }
+                } catch (...) {
+                    std::lock_guard<std::mutex> guard(errorMtx);
+                    if (!error) {
+                        error = std::current_exception();
+                    }
+                }
+                loadingTrack = NULL;
+            }
+        };
+
+        int workers = startupWorkers > 0 ? startupWorkers : std::thread::hardware_concurrency();
+        workers = CLAMP(workers, 1, (int)jobs.size());
+        auto start = std::chrono::steady_clock::now();
+        // The calling thread takes part in the work
+        std::vector<std::thread> pool;
+        for (int i = 1; i < workers; i++) {
+            pool.push_back(std::thread(worker));
+        }
+        worker();
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+        float totalMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        // Plugins are added in the config order, whatever the order they were loaded in
+        int count = 0;
+        for (LoadingTrack& job : jobs) {
+            logInfo("*** Init plugins for track %d", job.id);
+            for (int i = 0; i < job.plugins.size(); i++) {
+                logInfo("- %s loaded in %.1fms", job.plugins[i]->name.c_str(), job.loadMs[i]);
+                plugins.push_back(job.plugins[i]);
+                count++;
+            }
+        }
+        logInfo("%d plugins loaded in %.1fms with %d worker(s)", count, totalMs, workers);
+        // Each plugin picks the same variants, from the same CPU features
+        logInfo("CPU: %s, kernels: %s", CpuFeatures::get().describe().c_str(), SimdDispatch::describe().c_str());
+        logArenaUsage();
+        pluginIndex = indexPlugins(plugins);
+        noteRoutes = routeNotes(plugins);
+        pluginSnapshot = new std::vector<AudioPlugin*>(plugins);
+
+        if (error) {
+            std::rethrow_exception(error);
+        }
     }
 
     int8_t initActiveMidiTrack = -1;
+    Realtime realtime;
+    bool useTrackScheduler = false;
+    int schedulerWorkers = -1;
+    int voiceWorkers = 0;
+    VoicePool* voicePool = NULL;
+    bool dspLoadEnabled = false;
+    bool countDenormals = false;
+    bool countPerf = false;
+    uint32_t dspLoadLogInterval = 0;
+    float freezeSeconds = 30.0f;
 
     AudioPluginHandler& config(nlohmann::json& config) override
     {
@@ -329,23 +1424,140 @@ public:
             loadMidiInput(config["midiInput"].get<std::string>());
         }
         if (config.contains("midiOutput")) {
+            //#md `"midiOutputLatency": 0` delay in ms of the MIDI output, e.g. the latency of the audio output, so the notes sent to external synths leave with the audio
+            midiOutputLatencyNs = config.value("midiOutputLatency", 0.0f) * 1000000;
             loadMidiOutput(config["midiOutput"].get<std::string>());
         }
         debugMidi = config.value("debugMidi", debugMidi);
-        if (config.contains("tracks") && config["tracks"].is_array()) {
-            for (nlohmann::json& track : config["tracks"]) {
-                uint8_t trackId = CLAMP(track["id"].get<uint8_t>(), 0, MAX_TRACKS - 1);
-                logInfo("*** Init plugins for track %d", trackId);
-                if (track.contains("plugins") && track["plugins"].is_array()) {
-                    for (nlohmann::json& plugin : track["plugins"]) {
-                        loadPlugin(plugin, trackId);
-                    }
+
+        //#md `"blockSize": 128` number of frames processed per block, from 32 to 1024 (default 128), rounded up to a multiple of 16 for the SIMD paths. Smaller blocks reduce the latency, larger blocks reduce the overhead per block for dense patches. Must be set before the tracks, as plugins get it when they are instantiated.
+        if (config.contains("blockSize")) {
+            uint32_t blockSize = CLAMP(config["blockSize"].get<uint32_t>(), MIN_BLOCK_SIZE, MAX_BLOCK_SIZE);
+            pluginProps.blockSize = (blockSize + BLOCK_SIZE_MULTIPLE - 1) / BLOCK_SIZE_MULTIPLE * BLOCK_SIZE_MULTIPLE;
+            if (pluginProps.blockSize != blockSize) {
+                logWarn("Block size %d is not a multiple of %d, rounded up to %d", blockSize, BLOCK_SIZE_MULTIPLE, pluginProps.blockSize);
+            }
+            if (pluginProps.trackStride != 1) {
+                pluginProps.trackStride = pluginProps.blockSize;
+            }
+            logInfo("Use audio block size of %d frames", pluginProps.blockSize);
+        }
+        //#md `"sampleRate": 48000` sample rate of the engine, from 8000 to 192000 (default 48000), e.g. 96000 on desktop for the engines prone to aliasing or 32000 on an overloaded Pi. The audio devices are opened at this rate. Must be set before the tracks, as plugins get it when they are instantiated.
+        if (config.contains("sampleRate")) {
+            pluginProps.sampleRate = CLAMP(config["sampleRate"].get<uint32_t>(), MIN_SAMPLE_RATE, MAX_SAMPLE_RATE);
+            logInfo("Use sample rate of %d Hz", pluginProps.sampleRate);
+        }
+        //#md `"arenaSize": 64` memory in MB reserved at startup for the large buffers of the plugins (delays, reverbs, samples), pre-faulted and locked in RAM, so they never page fault while playing (default 0, buffers allocated on the heap). Buffers not fitting in the arena fall back to the heap. The memory used by each plugin is logged once the tracks are loaded. Must be set before the tracks.
+        if (config.contains("arenaSize") && !pluginProps.arena) {
+            size_t size = config["arenaSize"].get<size_t>() * 1024 * 1024;
+            if (size > 0 && arena.init(size)) {
+                pluginProps.arena = &arena;
+                logInfo("Plugin arena of %zu MB%s", arena.size() / (1024 * 1024), arena.locked ? " locked in RAM" : ", could not lock it in RAM");
+            } else if (size > 0) {
+                logWarn("Could not map a plugin arena of %zu MB, buffers are allocated on the heap", size / (1024 * 1024));
+            }
+        }
+        //#md `"controlRate": 32` number of frames between two control rate ticks, used by plugins to update their modulations (e.g. filter cutoff from an envelope) at a lower rate than the audio (default 32, from 1 to the block size). Must be set before the tracks.
+        if (config.contains("controlRate")) {
+            pluginProps.controlFrames = CLAMP(config["controlRate"].get<uint32_t>(), 1, MAX_BLOCK_SIZE);
+        }
+        //#md `"bufferLayout": "planar"` store each track of the audio block in its own contiguous, cache-line aligned lane, instead of interleaving all the tracks frame by frame (default `"interleaved"`). Must be set before the tracks, as plugins get the layout when they are instantiated.
+        if (config.value("bufferLayout", "interleaved") == "planar") {
+            pluginProps.frameStride = 1;
+            pluginProps.trackStride = pluginProps.blockSize;
+            logInfo("Use planar audio buffer layout");
+        }
+        //#md `"stereo": true` give each track a right channel on top of its mono signal, for the stereo plugins (e.g. `Mixer` with pan) and the audio outputs (default false). Mono plugins placed before the first stereo plugin of a track still run once, the track copying their output to both channels. Must be set before the tracks.
+        if (config.value("stereo", pluginProps.rightOffset != 0)) {
+            if (pluginProps.trackStride != 1) {
+                pluginProps.rightOffset = TOTAL_TRACKS * pluginProps.trackStride;
+            } else {
+                pluginProps.rightOffset = TOTAL_TRACKS;
+                pluginProps.frameStride = 2 * TOTAL_TRACKS;
+            }
+        }
+        //#md `"realtime": { "priority": 70 }` run the audio threads with real-time scheduling, see [Realtime](#realtime).
+        if (config.contains("realtime") && config["realtime"].is_object()) {
+            realtime.config(config["realtime"]);
+        }
+        //#md `"powerManagement": { "playing": "performance" }` keep the CPU clock of the audio cores up while playing, see [Power management](#power-management). After `realtime`, to manage its audio cores.
+        if (config.contains("powerManagement") && config["powerManagement"].is_object()) {
+            power.config(config["powerManagement"], realtime.getAudioCores());
+        }
+        //#md `"qualityGovernor": { "raise": 85 }` lower the quality of the plugins when the CPU can't keep up, see [Quality governor](#quality-governor).
+        if (config.contains("qualityGovernor") && config["qualityGovernor"].is_object()) {
+            quality.config(config["qualityGovernor"]);
+        }
+        //#md `"trackScheduler": "pool"` process the tracks with a fixed pool of workers, running each track as soon as all its input tracks are done, instead of starting one thread per track without dependencies and running all the others on the host thread (default `"thread"`). The master track is always processed on the host thread.
+        useTrackScheduler = config.value("trackScheduler", useTrackScheduler ? "pool" : "thread") == "pool";
+        //#md `"trackSchedulerWorkers": 3` number of workers used by the `pool` track scheduler, on top of the host thread (default -1, number of cores minus one).
+        schedulerWorkers = config.value("trackSchedulerWorkers", schedulerWorkers);
+        //#md `"voiceWorkers": 2` number of workers rendering in parallel the voices of the heavily polyphonic plugins supporting it (e.g. `SynthSample` with `voiceGroupThreshold`), the track rendering one group itself (default 0, disabled).
+        voiceWorkers = config.value("voiceWorkers", voiceWorkers);
+        //#md `"dspLoad": true` measure the time spent in each track and plugin, as a percentage of the block deadline. The stats can be displayed with the `DspLoad` component. Note that the plugin writing to the sound card, also includes the time waiting for the sound card.
+        dspLoadEnabled = config.value("dspLoad", dspLoadEnabled);
+        //#md `"meters": [1, 2, 8]` reduce the output of the given tracks at the end of each block, for the `Meter` component: levels of the block and waveform of the last second, published without the UI ever reading the audio (default none, `true` for all the tracks). Must be set after `sampleRate`.
+        //#md `"meterWindowMs": 1000` span of the waveform of the meters, in milliseconds (default 1000).
+        if (config.contains("meters")) {
+            float windowMs = config.value("meterWindowMs", 1000.0f);
+            std::vector<uint8_t> ids;
+            if (config["meters"].is_array()) {
+                ids = config["meters"].get<std::vector<uint8_t>>();
+            } else if (config["meters"].is_boolean() && config["meters"].get<bool>()) {
+                for (uint8_t id = 0; id < MAX_TRACKS; id++) {
+                    ids.push_back(id);
+                }
+            }
+            for (uint8_t id : ids) {
+                if (id < MAX_TRACKS && meters.find(id) == meters.end()) {
+                    meters[id] = new MeterTap(pluginProps.sampleRate, windowMs);
+                }
+            }
+        }
+        //#md `"dspLoadLog": 10000` log the DSP load stats every given milliseconds (default 0, disabled). Requires `"dspLoad": true`.
+        dspLoadLogInterval = config.value("dspLoadLog", dspLoadLogInterval);
+        //#md `"flushDenormals": true` flush subnormal floats to zero in hardware (FTZ/DAZ) on all the audio threads, to avoid the CPU spikes of decaying filters, reverbs and delays when the sound fades out (default true).
+        Denormals::flush = config.value("flushDenormals", Denormals::flush);
+        //#md `"xrunLog": true` record the xruns and partial writes of the audio output, and the blocks starting more than half a block late, with the processing time of each track (when `dspLoad` is enabled) and the CPU frequency and temperature. The counters and the last entries can be displayed with the `XrunLog` component (default true).
+        xrunLogEnabled = config.value("xrunLog", xrunLogEnabled);
+        //#md `"dspLoadDenormals": true` count the subnormal samples output by each plugin, logged with `dspLoadLog`. Requires `"dspLoad": true`, and `"flushDenormals": false` to find the plugins that still need an explicit denormal guard.
+        countDenormals = config.value("dspLoadDenormals", countDenormals);
+        //#md `"dspLoadCounters": true` read the hardware counters of the CPU around each plugin (cycles, instructions, L1D misses and branch misses, through `perf_event_open`), and log the instructions per cycle and the misses per sample with `dspLoadLog`, e.g. to find the plugins thrashing the caches on the Pi. Requires `"dspLoad": true`, and `kernel.perf_event_paranoid` at 2 or less. Reading the counters costs a system call per plugin and per block, that is included in the load measured.
+        countPerf = config.value("dspLoadCounters", countPerf);
+        //#md `"freezeSeconds": 30` longest clip loop a track can be frozen with, in seconds, see [Freezing a track](#freezing-a-track) (default 30). The capture is allocated when the track is frozen, e.g. 11 MB for a stereo track at 48kHz.
+        freezeSeconds = config.value("freezeSeconds", freezeSeconds);
+        //#md `"memoryBudgetMb": 512` memory the caches can take together (decoded samples, rendered drum hits, generator tables, frozen tracks), in MB. Over it, the least valuable are evicted first: drum hits and unused freeze captures, then samples not playing. By default half of the RAM, or the env variable `MEMORY_BUDGET_MB`. The usage of each cache can be displayed with the `Memory` component.
+        if (config.contains("memoryBudgetMb")) {
+            MemoryBudget::get().setBudget(config["memoryBudgetMb"].get<size_t>() * 1024 * 1024);
+        }
+        //#md `"memoryReserveMb": 64` also evict the caches when the memory available to the whole system falls below it, in MB (default 64, or the env variable `MEMORY_RESERVE_MB`, 0 to disable).
+        if (config.contains("memoryReserveMb")) {
+            MemoryBudget::get().setReserve(config["memoryReserveMb"].get<size_t>() * 1024 * 1024);
+        }
+        //#md `"trace": { "events": 16384 }` record the blocks, tracks and plugins with their timing, written as Chrome trace JSON on `SIGUSR1`, see [Tracing](#tracing).
+        if (config.contains("trace")) {
+            Trace::get().config(config["trace"]);
+        }
+        //#md `"modulationSources": [{"name": "LFO_1", "type": "lfo", "shape": "sine", "rate": 0.5}]` sources shared by the `modulation` routes of the plugins, computed once per block whatever the number of tracks following them. `type` is `lfo` (`shape` of `sine`, `triangle`, `saw`, `square` or `random`, `rate` in Hz, optional start `phase` from 0 to 1), `cc` (`cc` number, optional `channel` from 1 to 16, all of them by default), `follower` (envelope of the output of `track`, with `attack` and `release` in ms, one block behind) or `published` (written by a plugin). Must be set before the tracks.
+        if (config.contains("modulationSources") && config["modulationSources"].is_array()) {
+            for (nlohmann::json& source : config["modulationSources"]) {
+                if (modulation.add(source) < 0) {
+                    logWarn("Invalid modulation source: %s", source.dump().c_str());
                 }
             }
         }
+        //#md `"startupWorkers": 4` number of threads instantiating the plugins of the different tracks in parallel at startup (default 0, number of cores). Set to 1 to load them one after the other.
+        startupWorkers = config.value("startupWorkers", startupWorkers);
+        if (config.contains("tracks") && config["tracks"].is_array()) {
+            trackConfigs = getTrackConfigs(config);
+            loadTracks(config["tracks"]);
+        }
         if (config.contains("autoSave")) {
             uint32_t msInterval = config["autoSave"].get<uint32_t>();
-            if (msInterval > 0) {
+            if (renderOptions) {
+                // Only load the saved state, the offline render must not overwrite it
+                sendEvent(AudioEventType::AUTOSAVE);
+            } else if (msInterval > 0) {
                 startAutoSave(msInterval);
             }
         } else {
@@ -364,7 +1576,10 @@ public:
                 if (midiDevices.size() > 0) {
                     logDebug("Load first midi device: %s", midiDevices[0].name.c_str());
                     loadMidiInput(midiDevices[0].name);
-                    loadMidiOutput(midiDevices[0].name);
+                    // Unless `midiOutput` already opened one
+                    if (!midiOuthandle) {
+                        loadMidiOutput(midiDevices[0].name);
+                    }
                 }
             }
         }
@@ -374,12 +1589,15 @@ public:
 
     void noteOn(uint8_t note, float velocity, NoteTarget target) override
     {
+        noteReceived(target);
         if (target.plugin) {
             target.plugin->noteOn(note, velocity, NULL);
-        } else {
-            for (AudioPlugin* plugin : plugins) {
-                if (target.track == -1 || target.track == plugin->track) {
-                    // printf("pluginHandler noteOn %d %f %d\n", note, velocity, plugin->track);
+            return;
+        }
+        std::vector<AudioPlugin*>* route = getNoteRoute(target.track);
+        if (route) {
+            for (AudioPlugin* plugin : *route) {
+                if (!plugin->ignoresNotes.load(std::memory_order_relaxed)) {
                     plugin->noteOn(note, velocity, NULL);
                 }
             }
@@ -388,46 +1606,58 @@ public:
 
     void noteOff(uint8_t note, float velocity, NoteTarget target) override
     {
+        noteReceived(target);
         if (target.plugin) {
             target.plugin->noteOff(note, velocity, NULL);
-        } else {
-            for (AudioPlugin* plugin : plugins) {
-                if (target.track == -1 || target.track == plugin->track) {
+            return;
+        }
+        std::vector<AudioPlugin*>* route = getNoteRoute(target.track);
+        if (route) {
+            for (AudioPlugin* plugin : *route) {
+                if (!plugin->ignoresNotes.load(std::memory_order_relaxed)) {
                     plugin->noteOff(note, velocity, NULL);
                 }
             }
         }
     }
 
-    bool midi(std::vector<unsigned char>* message)
+    // A note played straight to the plugins of a frozen track unfreezes it, see `Track::noteReceived()`
+    void noteReceived(NoteTarget& target)
     {
-        for (MidiMapping& mapping : midiMapping) {
-            if (mapping.handle(message)) {
-                return true;
-            }
+        Track* track = findTrack(target.plugin ? target.plugin->track : target.track);
+        if (track) {
+            track->noteReceived();
         }
-        return false;
     }
 
-    // `b0 4c xx` assign a midi command to a given plugin value.
-    void mapMidiCmd(AudioPlugin* plugin, int valueIndex, const std::string& cmd) override
+    // From any thread
+    Track* findTrack(int16_t trackId)
     {
-        std::istringstream stream(cmd);
-        std::string msg0, msg1, msg2;
-        stream >> msg0 >> msg1 >> msg2;
-
-        try {
-            auto msg0Int = static_cast<uint8_t>(std::stoi(msg0, nullptr, 16));
-            auto msg1Int = static_cast<uint8_t>(std::stoi(msg1, nullptr, 16));
+        std::vector<Track*>* snapshot = trackSnapshot.load();
+        if (tracksReady && trackId >= 0 && snapshot) {
+            for (Track* track : *snapshot) {
+                if (track->id == trackId) {
+                    return track;
+                }
+            }
+        }
+        return NULL;
+    }
 
-            uint8_t size = msg2.empty() ? 2 : 3;
-            uint8_t valuePosition = (msg1 == "xx") ? 2 : 3;
+    bool midi(const uint8_t* message, uint8_t size)
+    {
+        return midiMapping.handle(message, size);
+    }
 
-            midiMapping.push_back({ plugin, valueIndex, size, valuePosition, msg0Int, msg1Int });
-            logInfo("Assign MIDI command %s to plugin %s value %s", cmd.c_str(), plugin->name, plugin->getValue(valueIndex)->key().c_str());
-        } catch (...) {
+    // `b0 4c xx` assign a midi command to a given plugin value, see MidiMappingTable for the commands.
+    void mapMidiCmd(AudioPlugin* plugin, int valueIndex, const std::string& cmd, const std::string& curve) override
+    {
+        std::lock_guard<std::mutex> guard(loadMtx);
+        if (!midiMapping.map(plugin, valueIndex, cmd, MidiMappingTable::getCurve(curve))) {
             logError("Invalid MIDI mapping " + cmd);
+            return;
         }
+        logInfo("Assign MIDI command %s to plugin %s value %s", cmd.c_str(), plugin->name.c_str(), plugin->getValue(valueIndex)->key().c_str());
     }
 
     void assignPluginToMidiChannel(uint8_t channel, AudioPlugin* plugin) override
@@ -436,34 +1666,64 @@ public:
             logInfo("Invalid midi note channel, set to 1");
             channel = 1;
         }
-        midiNoteEvents.push_back({ (uint8_t)(channel - 1), { .plugin = plugin } });
-        logInfo("Assign %s to midi channel %d", plugin->name, channel);
+        std::lock_guard<std::mutex> guard(loadMtx);
+        midiChannelTargets[channel - 1].push_back({ .plugin = plugin });
+        logInfo("Assign %s to midi channel %d", plugin->name.c_str(), channel);
     }
 
-    void midiNoteOn(uint8_t channel, uint8_t note, float velocity)
+    void midiNoteOn(uint8_t channel, uint8_t note, float velocity, uint64_t frame = 0)
     {
         if (velocity == 0) {
-            midiNoteOff(channel, note, velocity);
+            midiNoteOff(channel, note, velocity, frame);
+            return;
         }
 
         // printf("-------------- noteOn %d %d %f\n", channel, note, velocity);
-        for (MidiNoteEvent& target : midiNoteEvents) {
-            if (target.channel == channel) {
-                noteOn(note, velocity, target.target);
-            }
+        for (NoteTarget& target : midiChannelTargets[channel & 0x0f]) {
+            queueNote(true, note, velocity, target, frame);
         }
     }
 
-    void midiNoteOff(uint8_t channel, uint8_t note, float velocity)
+    void midiNoteOff(uint8_t channel, uint8_t note, float velocity, uint64_t frame = 0)
     {
         // printf("------------- noteOff %d %d %f\n", channel, note, velocity);
-        for (MidiNoteEvent& target : midiNoteEvents) {
-            if (target.channel == channel) {
-                noteOn(note, velocity, target.target);
+        for (NoteTarget& target : midiChannelTargets[channel & 0x0f]) {
+            queueNote(false, note, velocity, target, frame);
+        }
+    }
+
+    // Hand over the note to the track of the target plugin, or to the target track, so it is played by the audio
+    // thread at the given frame. When the target is not part of a running track, the note is played right away.
+    void queueNote(bool on, uint8_t note, float velocity, NoteTarget target, uint64_t frame) override
+    {
+        Track* track = findTrack(target.plugin ? target.plugin->track : target.track);
+        if (track && track->queueNote(on, note, velocity, target.plugin, frame)) {
+            return;
+        }
+        if (on) {
+            noteOn(note, velocity, target);
+        } else {
+            noteOff(note, velocity, target);
+        }
+    }
+
+    void queueNote(Track* track, bool on, uint8_t note, float velocity, uint64_t frame)
+    {
+        if (!track->queueNote(on, note, velocity, NULL, frame)) {
+            if (on) {
+                track->noteOn(note, velocity);
+            } else {
+                track->noteOff(note, velocity);
             }
         }
     }
 
+    bool queueLaunch(AudioPlugin* plugin, uint32_t ticks) override
+    {
+        Track* track = findTrack(plugin->track);
+        return track && track->queueLaunch(plugin, ticks);
+    }
+
     bool isPlaying()
     {
         return playing;
@@ -474,12 +1734,178 @@ public:
         return !playing && clockCounter == 0;
     }
 
+    /*#md
+    ### Events
+
+    Events changing the playing state (e.g. `START`, `STOP`, `PAUSE`, `SEQ_LOOP`) are queued and applied by the audio
+    host between two blocks, whatever the thread sending them. Events doing I/O (`AUTOSAVE`, `SAVE_CLIP`,
+    `RELOAD_CLIP`, `RELOAD_WORKSPACE`) are handled by a background worker, so saving to disk never delays the audio,
+    and the same event sent several times before being handled is only handled once. Until the audio loop runs, events
+    are applied right away. `RELOAD_WORKSPACE` reads the clips of all the tracks in parallel while the previous
+    workspace keeps playing, and the new one starts on a single block, on all the tracks at once.
+
+    ### Freezing a track
+
+    `FREEZE_TRACK` renders a track once and then plays the audio instead of running its plugins, e.g. to free the CPU
+    taken by a heavy synth or reverb, with `event FREEZE_TRACK 2` on the control socket or the keypad action
+    `audioEvent:FREEZE_TRACK:2`. The track output is captured for one loop of its clip, from its next `SEQ_LOOP`, and
+    the capture is then played back locked to the clock: only the plugins following the clock (e.g. the sequencer)
+    still run. The track is unfrozen, fading back to its plugins over one block, by `UNFREEZE_TRACK`, or as soon as
+    something would make it sound different: a value or the steps of one of its plugins changed, a note played from
+    outside the track (keyboard, MIDI), the tempo changed, start, stop or pause, or the clip or workspace reloaded.
+    Tracks mixing other tracks (e.g. the master) can't be frozen, and the clip loop must fit in `freezeSeconds`. Note
+    that steps with a probability, or motion, vary from a loop to the other, and are frozen as they played once.
+
+    ### Automation
+
+    `RECORD_AUTOMATION` (e.g. `audioEvent:RECORD_AUTOMATION:2`) records the knob movements of the plugins of a track,
+    or of all the tracks without track, into the automation of the clip: at the end of each loop of the track, the
+    movements replace the automation they overlap, simplified to the points needed to draw them, and play back from
+    the next loop. `STOP_AUTOMATION` stops recording, `CLEAR_AUTOMATION` removes the automation. The automation is
+    saved with the clip, and only changes what the plugin plays: the values shown and saved stay the ones set by hand.
+    */
     void sendEvent(AudioEventType event, int16_t track = -1)
     {
         if (event == AudioEventType::SET_ACTIVE_TRACK) {
             setActiveMidiTrack(track);
             return;
         }
+        if (!tracksReady) {
+            dispatchEvent(event, track, plugins);
+        } else if (isBackgroundEvent(event)) {
+            queueBackgroundEvent(event, track);
+        } else if (!events.push({ event, track })) {
+            logWarn("Event queue full, drop event %d", event);
+        }
+    }
+
+protected:
+    struct PendingEvent {
+        AudioEventType event;
+        int16_t track;
+    };
+    MpscQueue<PendingEvent, 256> events;
+
+    std::vector<PendingEvent> backgroundEvents;
+    std::mutex backgroundMtx;
+    std::condition_variable backgroundCv;
+    std::thread eventWorker;
+    // Plugins list for the event worker and `getPlugins()`, replaced when tracks are reloaded. Replaced lists are
+    // never deleted.
+    std::atomic<std::vector<AudioPlugin*>*> pluginSnapshot = NULL;
+
+    static bool isBackgroundEvent(AudioEventType event)
+    {
+        return event == AudioEventType::AUTOSAVE || event == AudioEventType::SAVE_CLIP
+            || event == AudioEventType::RELOAD_CLIP || event == AudioEventType::RELOAD_WORKSPACE
+            || event == AudioEventType::FREEZE_TRACK;
+    }
+
+    void queueBackgroundEvent(AudioEventType event, int16_t track)
+    {
+        std::lock_guard<std::mutex> guard(backgroundMtx);
+        for (PendingEvent& pending : backgroundEvents) {
+            if (pending.event == event && pending.track == track) {
+                return;
+            }
+        }
+        backgroundEvents.push_back({ event, track });
+        backgroundCv.notify_one();
+    }
+
+    void startEventWorker()
+    {
+        eventWorker = std::thread([this]() {
+            std::unique_lock<std::mutex> lock(backgroundMtx);
+            while (isRunning && tracksReady) {
+                backgroundCv.wait_for(lock, std::chrono::milliseconds(100), [&] { return backgroundEvents.size() > 0; });
+                while (backgroundEvents.size() > 0) {
+                    PendingEvent pending = backgroundEvents.front();
+                    backgroundEvents.erase(backgroundEvents.begin());
+                    // Events sent meanwhile can be queued, or merged if already pending
+                    lock.unlock();
+                    std::vector<AudioPlugin*>* snapshot = pluginSnapshot.load();
+                    if (snapshot) {
+                        TraceSpan span(pending.event == AudioEventType::AUTOSAVE ? "autosave" : "backgroundEvent");
+                        if (pending.event == AudioEventType::RELOAD_WORKSPACE) {
+                            reloadWorkspace(pending.track, *snapshot);
+                        } else {
+                            dispatchEvent(pending.event, pending.track, *snapshot);
+                        }
+                    }
+                    lock.lock();
+                }
+            }
+        });
+        pthread_setname_np(eventWorker.native_handle(), "events");
+    }
+
+    // Switching workspace as a pipeline: the plugins first read and parse their files, and prefetch their samples,
+    // all in parallel (see AudioPlugin::prepareEvent()), while the current workspace keeps playing. Then they are
+    // hydrated, the value changes being held in the parameter queues until all of them are, so the new workspace
+    // starts at a single block boundary.
+    void reloadWorkspace(int16_t track, std::vector<AudioPlugin*>& list)
+    {
+        auto start = std::chrono::steady_clock::now();
+        std::vector<AudioPlugin*> preparing;
+        for (AudioPlugin* plugin : list) {
+            if (track == -1 || plugin->track == track) {
+                preparing.push_back(plugin);
+            }
+        }
+        std::atomic<size_t> next = 0;
+        auto worker = [&]() {
+            size_t i;
+            while ((i = next++) < preparing.size()) {
+                preparing[i]->prepareEvent(AudioEventType::RELOAD_WORKSPACE);
+            }
+        };
+        int workers = startupWorkers > 0 ? startupWorkers : std::thread::hardware_concurrency();
+        workers = CLAMP(workers, 1, std::max((int)preparing.size(), 1));
+        // The calling thread takes part in the work
+        std::vector<std::thread> pool;
+        for (int i = 1; i < workers; i++) {
+            pool.push_back(std::thread(worker));
+        }
+        worker();
+        for (std::thread& thread : pool) {
+            thread.join();
+        }
+        float preparedMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+
+        holdChanges = true;
+        dispatchEvent(AudioEventType::RELOAD_WORKSPACE, track, list);
+        holdChanges = false;
+        float totalMs = std::chrono::duration<float, std::milli>(std::chrono::steady_clock::now() - start).count();
+        logInfo("Workspace reloaded in %.1fms (%.1fms to read it with %d worker(s))", totalMs, preparedMs, workers);
+    }
+
+    // Must be called once the audio loop is done: events left are applied right away
+    void stopEventWorker()
+    {
+        backgroundCv.notify_one();
+        if (eventWorker.joinable()) {
+            eventWorker.join();
+        }
+        for (PendingEvent& pending : backgroundEvents) {
+            dispatchEvent(pending.event, pending.track, plugins);
+        }
+        backgroundEvents.clear();
+        applyEvents();
+    }
+
+    // Apply the queued events, between two blocks
+    void applyEvents()
+    {
+        PendingEvent* pending;
+        while ((pending = events.front()) != NULL) {
+            dispatchEvent(pending->event, pending->track, plugins);
+            events.pop();
+        }
+    }
+
+    void dispatchEvent(AudioEventType event, int16_t track, std::vector<AudioPlugin*>& list)
+    {
         if (track == -1) { // there is no point to check those events if it is a specific track event
             switch (event) {
             case AudioEventType::START:
@@ -501,25 +1927,71 @@ public:
                 event = playing ? AudioEventType::START : AudioEventType::PAUSE;
                 break;
             }
+            power.setPlaying(playing);
+        }
+        if (event == AudioEventType::FREEZE_TRACK) {
+            freezeTrack(findTrack(track));
+            return;
+        }
+        if (event == AudioEventType::UNFREEZE_TRACK || event == AudioEventType::START || event == AudioEventType::STOP
+            || event == AudioEventType::PAUSE || event == AudioEventType::RELOAD_CLIP
+            || event == AudioEventType::RELOAD_WORKSPACE) {
+            for (Track* t : tracks) {
+                if ((track == -1 || t->id == track) && t->freeze.active()) {
+                    t->unfreezeRequest = true;
+                }
+            }
+            if (event == AudioEventType::UNFREEZE_TRACK) {
+                return;
+            }
+        }
+        if (event == AudioEventType::SEQ_LOOP) {
+            Track* loopTrack = findTrack(track);
+            if (loopTrack) {
+                loopTrack->onLoop();
+            }
+        }
+        if (event == AudioEventType::SEQ_LOOP && renderOptions) {
+            if (renderLoopTrack == -1) {
+                renderLoopTrack = renderOptions->loopTrack != -1 ? renderOptions->loopTrack : track;
+            }
+            if (track == renderLoopTrack) {
+                renderLoops++;
+            }
         }
         // if (event != AUTOSAVE) printf(">>> AudioPluginHandler::sendEvent %d\n", event);
-        for (AudioPlugin* plugin : plugins) {
+        for (AudioPlugin* plugin : list) {
             if (track == -1 || plugin->track == track) {
+                plugin->automationEvent(event);
                 plugin->onEvent(event, playing);
             }
         }
     }
 
-    Track* activeMidiTrack = NULL;
+    // From the event worker, the capture being allocated while the track is not frozen
+    void freezeTrack(Track* track)
+    {
+        if (!track) {
+            logWarn("Freeze: no such track");
+        } else if (track->hasDependencies()) {
+            logWarn("Freeze: track %d mixes other tracks, it can't be frozen", track->id);
+        } else if (!track->getKeyTracks().empty()) {
+            logWarn("Freeze: track %d is keyed by other tracks, it can't be frozen", track->id);
+        } else if (track->freeze.arm(freezeSeconds * pluginProps.sampleRate, track->stereoOutput ? 2 : 1)) {
+            logInfo("Freeze track %d on its next loop", track->id);
+        }
+    }
+
+public:
+    // Read by the MIDI thread, re-pointed when its track is reloaded
+    std::atomic<Track*> activeMidiTrack = NULL;
     void setActiveMidiTrack(int16_t trackId, bool force = false)
     {
         // logDebug("setActiveMidiTrack %d", trackId);
         if (trackId != -1 && (activeMidiTrack != NULL || force)) {
-            for (Track* track : tracks) {
-                if (track->id == trackId) {
-                    activeMidiTrack = track;
-                    break;
-                }
+            Track* track = findTrack(trackId);
+            if (track) {
+                activeMidiTrack = track;
             }
         }
     }
@@ -611,6 +2083,29 @@ public:
         return nullptr;
     }
 
+    // Set once the tracks are created, so the midi input can hand over events to them
+    std::atomic<bool> tracksReady = false;
+    // First frame of the block being processed, and when its processing started (steady clock, ns)
+    std::atomic<uint64_t> blockFrame = 0;
+    std::atomic<int64_t> blockTime = 0;
+    // When the last note-on was read, see getMidiNoteOnTime()
+    std::atomic<int64_t> midiNoteOnTime = 0;
+
+    static int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    // Frame at which an event received now should be played: one block later than the one being processed,
+    // at the same offset as its arrival in the current block, so the timing between events is preserved.
+    uint64_t eventFrame()
+    {
+        int64_t elapsed = nowNs() - blockTime;
+        uint64_t offset = elapsed > 0 ? elapsed * pluginProps.sampleRate / 1000000000 : 0;
+        uint32_t blockSize = pluginProps.blockSize;
+        return blockFrame + blockSize + (offset < blockSize ? offset : blockSize - 1);
+    }
+
     std::thread midiInputThread;
     bool loadMidiInput(std::string name)
     {
@@ -633,47 +2128,40 @@ public:
         return true;
     }
 
+    std::atomic<AudioPlugin*> midiClockTarget = NULL;
+    uint8_t midiClockDataId = 0;
+
     bool debugMidi = false;
     void midiInHandler(snd_rawmidi_t* handle)
     {
-        while (1) {
-            unsigned char buffer[3];
-            int n = snd_rawmidi_read(handle, buffer, sizeof(buffer));
-            if (n > 0) {
-                if (buffer[0] == 0xf8) {
-                    // FIXME
-                    // clockTick();
-                    printf("midi clock tick to be implemented\n");
-                } else if (buffer[0] == AudioEventType::START) {
-                    sendEvent(AudioEventType::START); // Should we instead use midi number.. ?
-                } else if (buffer[0] == AudioEventType::PAUSE) {
-                    sendEvent(AudioEventType::PAUSE);
-                } else if (buffer[0] == AudioEventType::STOP) {
-                    sendEvent(AudioEventType::STOP);
-                } else if (buffer[0] == 0xfe) {
-                    // ignore active sensing
-                } else if (buffer[0] >= 0x90 && buffer[0] < 0xa0) {
-                    uint8_t channel = buffer[0] - 0x90;
-                    if (activeMidiTrack != NULL) {
-                        activeMidiTrack->noteOn(buffer[1], buffer[2] / 127.0);
-                    } else {
-                        midiNoteOn(channel, buffer[1], buffer[2] / 127.0);
-                    }
-                } else if (buffer[0] >= 0x80 && buffer[0] < 0x90) {
-                    uint8_t channel = buffer[0] - 0x80;
-                    if (activeMidiTrack != NULL) {
-                        activeMidiTrack->noteOff(buffer[1], buffer[2] / 127.0);
-                    } else {
-                        midiNoteOff(channel, buffer[1], buffer[2] / 127.0);
-                    }
-                } else {
-                    std::vector<unsigned char>* message = new std::vector<unsigned char>(buffer, buffer + n);
-                    if (!midi(message) && debugMidi) {
-                        logDebug("Midi input message: ");
-                        unsigned int nBytes = message->size();
-                        for (unsigned int i = 0; i < nBytes; i++) {
-                            logDebug("%02x ", (int)buffer[i]);
-                        }
+        // Sleep in poll() until some bytes are available, instead of spinning on the non blocking read
+        int fdCount = snd_rawmidi_poll_descriptors_count(handle);
+        std::vector<struct pollfd> fds(fdCount);
+        snd_rawmidi_poll_descriptors(handle, fds.data(), fdCount);
+
+        MidiParser parser;
+        unsigned char buffer[256];
+        while (isRunning) {
+            // Timeout to be able to exit when the app stops
+            if (poll(fds.data(), fdCount, 200) <= 0) {
+                continue;
+            }
+            unsigned short revents;
+            snd_rawmidi_poll_descriptors_revents(handle, fds.data(), fdCount, &revents);
+            if (revents & (POLLERR | POLLHUP)) {
+                logWarn("Midi input device disconnected");
+                break;
+            }
+            if (!(revents & POLLIN)) {
+                continue;
+            }
+
+            int n;
+            while ((n = snd_rawmidi_read(handle, buffer, sizeof(buffer))) > 0) {
+                uint64_t frame = eventFrame();
+                for (int i = 0; i < n; i++) {
+                    if (parser.parse(buffer[i])) {
+                        midiMessage(parser.message, parser.size, frame);
                     }
                 }
             }
@@ -681,6 +2169,50 @@ public:
         snd_rawmidi_close(handle);
     }
 
+    void midiMessage(const uint8_t* message, uint8_t size, uint64_t frame)
+    {
+        if (message[0] == 0xf8) {
+            // The tempo plugin follows it when its clock is set to midi
+            AudioPlugin* tempo = midiClockTarget;
+            if (tempo) {
+                tempo->data(midiClockDataId, &frame);
+            }
+        } else if (message[0] == AudioEventType::START) {
+            sendEvent(AudioEventType::START); // Should we instead use midi number.. ?
+        } else if (message[0] == AudioEventType::PAUSE) {
+            sendEvent(AudioEventType::PAUSE);
+        } else if (message[0] == AudioEventType::STOP) {
+            sendEvent(AudioEventType::STOP);
+        } else if (message[0] == 0xfe) {
+            // ignore active sensing
+        } else if (message[0] >= 0x90 && message[0] < 0xa0 && size == 3) {
+            uint8_t channel = message[0] - 0x90;
+            if (message[2] > 0) {
+                midiNoteOnTime = nowNs();
+            }
+            Track* track = activeMidiTrack;
+            if (track != NULL) {
+                // Note on with velocity 0 is a note off
+                queueNote(track, message[2] > 0, message[1], message[2] / 127.0, frame);
+            } else {
+                midiNoteOn(channel, message[1], message[2] / 127.0, frame);
+            }
+        } else if (message[0] >= 0x80 && message[0] < 0x90 && size == 3) {
+            uint8_t channel = message[0] - 0x80;
+            Track* track = activeMidiTrack;
+            if (track != NULL) {
+                queueNote(track, false, message[1], message[2] / 127.0, frame);
+            } else {
+                midiNoteOff(channel, message[1], message[2] / 127.0, frame);
+            }
+        } else if (!(modulation.midi(message, size) | midi(message, size)) && debugMidi) {
+            logDebug("Midi input message: ");
+            for (uint8_t i = 0; i < size; i++) {
+                logDebug("%02x ", (int)message[i]);
+            }
+        }
+    }
+
     snd_rawmidi_t* midiOuthandle = NULL;
     bool loadMidiOutput(std::string name)
     {
@@ -696,17 +2228,119 @@ public:
         }
 
         logInfo("MIDI output device %s [%s] opened", device->name.c_str(), device->id.c_str());
+        // A single thread sends the messages, whatever the number of times the output is loaded
+        if (!midiOutputThread.joinable()) {
+            midiOutputThread = std::thread([this] { midiOutputLoop(); });
+            pthread_setname_np(midiOutputThread.native_handle(), "midi_out");
+        }
 
         return true;
     }
 
-    void sendMidi(std::vector<unsigned char>* message)
+    // MIDI output: the messages are queued by any thread, e.g. the audio thread, and sent by a single thread, each
+    // one at the time its frame is played. Writing to the device blocks about 1ms per note at 31.25 kbaud, so it is
+    // never done by the threads sending the messages.
+    struct MidiOutMessage {
+        uint64_t frame;
+        uint8_t size;
+        uint8_t bytes[3];
+    };
+    MpscQueue<MidiOutMessage, 1024> midiOutQueue;
+    std::thread midiOutputThread;
+    std::atomic<bool> midiOutputRunning = true;
+    // Delay of the MIDI output, so the notes leave with the audio of their frame, see `midiOutputLatency`
+    int64_t midiOutputLatencyNs = 0;
+
+    // Queue a message of up to 3 bytes to be sent at `frame`, 0 for as soon as possible. Safe to call from the audio thread.
+    void sendMidi(const uint8_t* message, uint8_t size, uint64_t frame) override
+    {
+        if (midiOuthandle && size > 0 && size <= 3) {
+            MidiOutMessage out = { frame, size };
+            memcpy(out.bytes, message, size);
+            if (!midiOutQueue.push(out)) {
+                logWarn("MIDI output queue full, message dropped");
+            }
+        }
+    }
+
+    void sendMidiRealtime(uint8_t status, uint64_t frame) override
     {
-        if (midiOuthandle) {
-            snd_rawmidi_write(midiOuthandle, message->data(), message->size());
-            snd_rawmidi_drain(midiOuthandle);
+        sendMidi(&status, 1, frame);
+    }
+
+    int64_t midiDelayNs(uint64_t frame)
+    {
+        if (frame == 0) {
+            return 0;
+        }
+        return ((int64_t)frame - (int64_t)blockFrame) * 1000000000 / pluginProps.sampleRate - (nowNs() - blockTime) + midiOutputLatencyNs;
+    }
+
+    // Send the queued messages when their frame is played. The messages are moved from the queue to a list sorted
+    // by frame, so a message due later never holds back the others, then all the messages due are written at once,
+    // with running status: a channel message with the same status as the previous one is sent without it.
+    void midiOutputLoop()
+    {
+        std::vector<MidiOutMessage> pending;
+        pending.reserve(1024);
+        std::vector<uint8_t> batch;
+        batch.reserve(1024 * 3);
+        uint8_t runningStatus = 0;
+        while (isRunning && midiOutputRunning) {
+            MidiOutMessage* message;
+            while ((message = midiOutQueue.front()) != NULL) {
+                auto it = std::upper_bound(pending.begin(), pending.end(), message->frame,
+                    [](uint64_t frame, const MidiOutMessage& other) { return frame < other.frame; });
+                pending.insert(it, *message);
+                midiOutQueue.pop();
+            }
+
+            size_t due = 0;
+            for (; due < pending.size() && midiDelayNs(pending[due].frame) <= 0; due++) {
+                MidiOutMessage& out = pending[due];
+                uint8_t status = out.bytes[0];
+                if (status >= 0xf8) {
+                    // Realtime messages don't cancel the running status
+                    batch.push_back(status);
+                    continue;
+                }
+                if (status >= 0xf0) {
+                    runningStatus = 0;
+                    batch.push_back(status);
+                } else if (status != runningStatus) {
+                    runningStatus = status;
+                    batch.push_back(status);
+                }
+                batch.insert(batch.end(), out.bytes + 1, out.bytes + out.size);
+            }
+            pending.erase(pending.begin(), pending.begin() + due);
+            if (!batch.empty()) {
+                if (snd_rawmidi_write(midiOuthandle, batch.data(), batch.size()) < 0) {
+                    // The device might have lost a part of the batch, the status is sent again
+                    runningStatus = 0;
+                }
+                batch.clear();
+            }
+
+            int64_t delayNs = pending.empty() ? 1000000 : std::min(midiDelayNs(pending[0].frame), (int64_t)1000000);
+            std::this_thread::sleep_for(std::chrono::nanoseconds(delayNs > 0 ? delayNs : 0));
         }
     }
+
+    uint64_t getBlockFrame() override
+    {
+        return blockFrame;
+    }
+
+    int64_t getMidiNoteOnTime() override
+    {
+        return midiNoteOnTime;
+    }
+
+    const std::vector<AudioPlugin*>* getPlugins() override
+    {
+        return pluginSnapshot.load();
+    }
 };
 
 AudioPluginHandler* AudioPluginHandler::instance = NULL;
@@ -0,0 +1,52 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <xmmintrin.h>
+#endif
+
+// Decaying feedback paths (filters, reverbs, delays) end up in subnormal floats once the sound fades out, which are
+// many times slower to process on most CPUs. The audio threads flush them to zero in hardware instead.
+// The flags are per thread, so this must be called by each thread processing audio, before processing.
+class Denormals {
+public:
+    // Set from the host config `flushDenormals`
+    inline static bool flush = true;
+
+    static void flushToZero()
+    {
+        if (!flush) {
+            return;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        // FTZ (bit 15) and DAZ (bit 6) of MXCSR
+        _mm_setcsr(_mm_getcsr() | 0x8040);
+#elif defined(__aarch64__)
+        // FZ (bit 24) of FPCR, also applies to the inputs
+        uint64_t fpcr;
+        asm volatile("mrs %0, fpcr" : "=r"(fpcr));
+        asm volatile("msr fpcr, %0" : : "r"(fpcr | (1ULL << 24)));
+#elif defined(__arm__) && defined(__ARM_PCS_VFP)
+        // FZ (bit 24) of FPSCR
+        uint32_t fpscr;
+        asm volatile("vmrs %0, fpscr" : "=r"(fpscr));
+        asm volatile("vmsr fpscr, %0" : : "r"(fpscr | (1U << 24)));
+#endif
+    }
+
+    // Number of subnormal samples in a lane. Check the bits, as float comparisons see them as 0 once DAZ is set.
+    static uint32_t count(float* lane, uint32_t stride, uint32_t frames)
+    {
+        uint32_t count = 0;
+        for (uint32_t f = 0; f < frames; f++) {
+            uint32_t bits;
+            memcpy(&bits, lane + f * stride, sizeof(bits));
+            if ((bits & 0x7f800000) == 0 && (bits & 0x007fffff) != 0) {
+                count++;
+            }
+        }
+        return count;
+    }
+};
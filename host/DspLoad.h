@@ -0,0 +1,116 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <time.h>
+#include <vector>
+
+#include "PerfCounters.h"
+
+// Measure how much of the block deadline is spent in each track and plugin.
+//
+// Each meter is only written by the thread processing it, accumulating the cost of every block during a
+// window of WINDOW_BLOCKS blocks. At the end of the window, the meter publishes its stats (average, max and
+// p99 as a percentage of the deadline), that the UI can read at any time.
+class DspLoad {
+public:
+    static const uint32_t WINDOW_BLOCKS = 1024; // ~3 seconds at 128 frames per block
+    static const uint16_t HISTOGRAM_SIZE = 200; // 1% buckets, up to 200% of the deadline
+
+    struct Stats {
+        float avg = 0.0f;
+        float max = 0.0f;
+        float p99 = 0.0f;
+    };
+
+    struct Meter {
+        Stats stats;
+
+        uint64_t sum = 0;
+        uint64_t maxNs = 0;
+        uint32_t count = 0;
+        uint16_t histogram[HISTOGRAM_SIZE] = {};
+        // Cost of the block being processed, when it is measured in several parts
+        uint64_t blockNs = 0;
+        // Cost of the last block, e.g. for the xrun log
+        uint64_t lastNs = 0;
+
+        void add(uint64_t ns, uint64_t deadlineNs)
+        {
+            lastNs = ns;
+            sum += ns;
+            if (ns > maxNs) {
+                maxNs = ns;
+            }
+            uint32_t bucket = ns * 100 / deadlineNs;
+            histogram[bucket < HISTOGRAM_SIZE ? bucket : HISTOGRAM_SIZE - 1]++;
+            if (++count >= WINDOW_BLOCKS) {
+                publish(deadlineNs);
+            }
+        }
+
+        void endBlock(uint64_t deadlineNs)
+        {
+            add(blockNs, deadlineNs);
+            blockNs = 0;
+        }
+
+        void publish(uint64_t deadlineNs)
+        {
+            uint32_t p99Count = count - count / 100;
+            uint32_t total = 0;
+            uint16_t p99 = HISTOGRAM_SIZE - 1;
+            for (uint16_t i = 0; i < HISTOGRAM_SIZE; i++) {
+                total += histogram[i];
+                if (total >= p99Count) {
+                    p99 = i;
+                    break;
+                }
+            }
+            stats.avg = sum * 100.0f / count / deadlineNs;
+            stats.max = maxNs * 100.0f / deadlineNs;
+            stats.p99 = p99 + 1;
+
+            sum = 0;
+            maxNs = 0;
+            count = 0;
+            for (uint16_t i = 0; i < HISTOGRAM_SIZE; i++) {
+                histogram[i] = 0;
+            }
+        }
+    };
+
+    struct TrackLoad {
+        int16_t id;
+        Meter total;
+        std::vector<std::string> pluginNames;
+        std::vector<Meter> plugins;
+        // Subnormal samples output by each plugin since the start, when `countDenormals` is set
+        std::vector<uint32_t> denormals;
+        // Hardware counters of each plugin since the start, when `countPerf` is set
+        std::vector<PerfCounters::Counts> counters;
+    };
+
+    uint64_t deadlineNs;
+    // Count the subnormal samples output by each plugin, to find the ones needing a denormal guard
+    bool countDenormals = false;
+    // Read the hardware counters around each plugin, see PerfCounters
+    bool countPerf = false;
+    // Tempo plugin, processed by the host thread before all the tracks
+    Meter tempo;
+    // Whole block: tempo, all the tracks and waiting for them
+    Meter block;
+    std::vector<TrackLoad> tracks;
+
+    DspLoad(uint64_t sampleRate, uint32_t frames)
+        : deadlineNs(frames * 1000000000ULL / sampleRate)
+    {
+    }
+
+    static uint64_t now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+};
@@ -0,0 +1,162 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <cstring>
+
+#include "plugins/audio/utils/StateSnapshot.h"
+
+// Levels and waveform of a track output, reduced by the track itself at the end of each block, for the meters and
+// scopes of the UI, so they draw from a few values instead of scanning the audio while it is written.
+//
+// Each block, the track publishes in a triple buffer (see StateSnapshot) the min, max and RMS of the block, and a
+// waveform of WIDTH columns spanning the last `windowMs`, each column being the min and max of its frames. The
+// ballistics (decay, peak hold) are computed by the UI, see `MeterTap::Ballistics`, at its own frame rate.
+class MeterTap {
+public:
+    static const uint16_t WIDTH = 64;
+
+    struct Snapshot {
+        // Of the last block
+        float min = 0.0f;
+        float max = 0.0f;
+        float rms = 0.0f;
+        // Min and max of each column of the waveform, the oldest first, the last one being filled
+        float waveMin[WIDTH] = {};
+        float waveMax[WIDTH] = {};
+        uint32_t columnFrames = 1;
+        // Frames reduced since the tap started
+        uint64_t frames = 0;
+
+        // Highest absolute level of the waveform over the last `frames`, at least the last column
+        float peakOver(uint64_t frames) const
+        {
+            uint32_t columns = std::clamp<uint64_t>(frames / columnFrames + 1, 1, WIDTH);
+            float peak = 0.0f;
+            for (uint32_t i = WIDTH - columns; i < WIDTH; i++) {
+                peak = std::max(peak, std::max(-waveMin[i], waveMax[i]));
+            }
+            return peak;
+        }
+    };
+
+    // Level of a meter as displayed: falling at `decayDbPerSecond`, the peak held `holdMs` before falling too. The
+    // level rises to the highest one since the previous update, so the peaks between 2 frames of the UI are not lost.
+    struct Ballistics {
+        float decayDbPerSecond = 24.0f;
+        unsigned long holdMs = 1500;
+
+        float level = 0.0f;
+        float peak = 0.0f;
+        unsigned long peakTime = 0;
+        unsigned long lastTime = 0;
+        uint64_t lastFrames = 0;
+
+        void update(const Snapshot& snapshot, unsigned long now)
+        {
+            float elapsed = lastTime ? (now - lastTime) / 1000.0f : 0.0f;
+            lastTime = now;
+            float fall = powf(10.0f, -decayDbPerSecond * elapsed / 20.0f);
+            float current = snapshot.peakOver(snapshot.frames - std::min(lastFrames, snapshot.frames));
+            lastFrames = snapshot.frames;
+
+            level = std::max(current, level * fall);
+            if (current >= peak) {
+                peak = current;
+                peakTime = now;
+            } else if (now - peakTime > holdMs) {
+                peak = std::max(level, peak * fall);
+            }
+        }
+    };
+
+protected:
+    StateSnapshot<Snapshot> snapshots;
+    uint64_t frames = 0;
+
+    float columnMin[WIDTH] = {};
+    float columnMax[WIDTH] = {};
+    // Column being filled, and its frames so far
+    uint16_t column = 0;
+    uint32_t columnPos = 0;
+    uint32_t columnFrames;
+
+    void nextColumn()
+    {
+        column = column + 1 < WIDTH ? column + 1 : 0;
+        columnMin[column] = 0.0f;
+        columnMax[column] = 0.0f;
+        columnPos = 0;
+    }
+
+public:
+    MeterTap(float sampleRate, float windowMs = 1000.0f)
+        : columnFrames(std::max<uint32_t>(sampleRate * windowMs / 1000.0f / WIDTH, 1))
+    {
+        snapshots.init([&](Snapshot& snapshot) { snapshot.columnFrames = columnFrames; });
+    }
+
+    // Reduce the block of the lane, and of its right lane when `right` is set. Called by the track only.
+    void process(const float* lane, const float* right, uint32_t stride, uint32_t count, bool silent)
+    {
+        Snapshot& snapshot = snapshots.back();
+        float min = 0.0f;
+        float max = 0.0f;
+        float sum = 0.0f;
+        if (silent) {
+            // Only the columns to move on, without reading the lanes
+            uint32_t remaining = count;
+            while (remaining > 0) {
+                uint32_t count = std::min(remaining, columnFrames - columnPos);
+                columnPos += count;
+                remaining -= count;
+                if (columnPos >= columnFrames) {
+                    nextColumn();
+                }
+            }
+        } else {
+            for (uint32_t f = 0; f < count; f++) {
+                float value = lane[f * stride];
+                float low = value;
+                float high = value;
+                sum += value * value;
+                if (right) {
+                    float r = right[f * stride];
+                    low = std::min(low, r);
+                    high = std::max(high, r);
+                    sum += r * r;
+                }
+                min = std::min(min, low);
+                max = std::max(max, high);
+                columnMin[column] = std::min(columnMin[column], low);
+                columnMax[column] = std::max(columnMax[column], high);
+                if (++columnPos >= columnFrames) {
+                    nextColumn();
+                }
+            }
+        }
+
+        snapshot.min = min;
+        snapshot.max = max;
+        snapshot.rms = count ? sqrtf(sum / (count * (right ? 2 : 1))) : 0.0f;
+        // Oldest first: the columns after the one being filled, then the ones up to it
+        uint16_t oldest = column + 1 < WIDTH ? column + 1 : 0;
+        uint16_t tail = WIDTH - oldest;
+        memcpy(snapshot.waveMin, columnMin + oldest, tail * sizeof(float));
+        memcpy(snapshot.waveMin + tail, columnMin, oldest * sizeof(float));
+        memcpy(snapshot.waveMax, columnMax + oldest, tail * sizeof(float));
+        memcpy(snapshot.waveMax + tail, columnMax, oldest * sizeof(float));
+        frames += count;
+        snapshot.frames = frames;
+        snapshots.publish();
+    }
+
+    // Copy of the last published snapshot, for any number of readers, e.g. several components drawing the track
+    Snapshot read()
+    {
+        Snapshot copy;
+        snapshots.read([&](Snapshot& snapshot) { copy = snapshot; });
+        return copy;
+    }
+};
@@ -0,0 +1,100 @@
+#pragma once
+
+#include <cstdint>
+
+// Turn the raw midi byte stream into complete messages, whatever the way bytes are split between reads.
+//
+// Support running status (data bytes following a channel message re-use its status byte), real-time
+// messages interleaved in the middle of another message, and skip sysex.
+class MidiParser {
+protected:
+    uint8_t runningStatus = 0;
+    uint8_t pending[3];
+    uint8_t expected = 0;
+    uint8_t count = 0;
+    bool inSysex = false;
+
+    static uint8_t messageSize(uint8_t status)
+    {
+        if (status < 0xf0) {
+            uint8_t type = status & 0xf0;
+            return type == 0xc0 || type == 0xd0 ? 2 : 3;
+        }
+        switch (status) {
+        case 0xf1: // MTC quarter frame
+        case 0xf3: // Song select
+            return 2;
+        case 0xf2: // Song position pointer
+            return 3;
+        default:
+            return 1;
+        }
+    }
+
+public:
+    uint8_t message[3];
+    uint8_t size = 0;
+
+    // Return true when `byte` completes a message, available in `message` and `size`
+    bool parse(uint8_t byte)
+    {
+        if (byte >= 0xf8) {
+            // Real-time messages can come at any time, without interrupting the current message
+            message[0] = byte;
+            size = 1;
+            return true;
+        }
+
+        if (byte & 0x80) {
+            inSysex = byte == 0xf0;
+            if (byte >= 0xf0) {
+                // System common messages cancel the running status
+                runningStatus = 0;
+                if (inSysex || byte == 0xf7) {
+                    count = 0;
+                    return false;
+                }
+                pending[0] = byte;
+                expected = messageSize(byte);
+                count = 1;
+                if (expected == 1) {
+                    message[0] = byte;
+                    size = 1;
+                    count = 0;
+                    return true;
+                }
+                return false;
+            }
+            runningStatus = byte;
+            pending[0] = byte;
+            expected = messageSize(byte);
+            count = 1;
+            return false;
+        }
+
+        if (inSysex) {
+            return false;
+        }
+
+        if (count == 0) {
+            // Data byte without status, re-use the running status if there is one
+            if (runningStatus == 0) {
+                return false;
+            }
+            pending[0] = runningStatus;
+            expected = messageSize(runningStatus);
+            count = 1;
+        }
+
+        pending[count++] = byte;
+        if (count == expected) {
+            for (uint8_t i = 0; i < count; i++) {
+                message[i] = pending[i];
+            }
+            size = count;
+            count = 0;
+            return true;
+        }
+        return false;
+    }
+};
@@ -0,0 +1,85 @@
+#pragma once
+
+#include <cstdint>
+#include <sndfile.h>
+#include <string>
+#include <vector>
+
+#include "log.h"
+
+// Options of the offline render, see `zicHost --render`
+struct RenderOptions {
+    std::string file = "render.wav";
+    // Length of the render: in seconds, in bars (4 beats at the tempo BPM) or in sequencer loops.
+    // When several are set, the render stops at the first one reached.
+    float seconds = 0.0f;
+    float bars = 0.0f;
+    uint32_t loops = 0;
+    // Track which sequencer loops are counted, -1 for the first track to loop
+    int16_t loopTrack = -1;
+    // Also write each track to its own file
+    bool stems = false;
+    // Workspace to load before rendering, empty to keep the current one
+    std::string workspace;
+
+    // Path of the stem file of a given track, e.g. `render.wav` -> `render_track3.wav`
+    std::string stemFile(int16_t track)
+    {
+        size_t dot = file.find_last_of('.');
+        std::string base = dot == std::string::npos ? file : file.substr(0, dot);
+        std::string ext = dot == std::string::npos ? ".wav" : file.substr(dot);
+        return base + "_track" + std::to_string(track) + ext;
+    }
+};
+
+// Write one track lane of the audio buffer in a float WAV file, mono tracks being copied to every channel
+// like the audio outputs do. Stereo tracks write their right lane to the second channel.
+class RenderSink {
+protected:
+    SNDFILE* sndfile = NULL;
+    uint8_t channels;
+    std::vector<float> frames;
+
+public:
+    int16_t track;
+    std::string path;
+
+    RenderSink(std::string path, int16_t track, uint8_t channels, uint32_t sampleRate, uint32_t blockSize)
+        : channels(channels)
+        , frames(blockSize * channels)
+        , track(track)
+        , path(path)
+    {
+        SF_INFO sfinfo = {};
+        sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
+        sfinfo.channels = channels;
+        sfinfo.samplerate = sampleRate;
+        sndfile = sf_open(path.c_str(), SFM_WRITE, &sfinfo);
+        if (!sndfile) {
+            logError("Could not open render file %s: %s", path.c_str(), sf_strerror(NULL));
+        }
+    }
+
+    ~RenderSink()
+    {
+        if (sndfile) {
+            sf_close(sndfile);
+        }
+    }
+
+    bool isOpen()
+    {
+        return sndfile != NULL;
+    }
+
+    void write(float* lane, float* right, uint32_t stride, uint32_t count)
+    {
+        float* out = frames.data();
+        for (uint32_t i = 0; i < count; i++) {
+            for (uint8_t c = 0; c < channels; c++) {
+                *out++ = c == 1 ? right[i * stride] : lane[i * stride];
+            }
+        }
+        sf_writef_float(sndfile, frames.data(), count);
+    }
+};
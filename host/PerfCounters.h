@@ -0,0 +1,162 @@
+#pragma once
+
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <linux/perf_event.h>
+#include <string>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Hardware counters of the calling thread, through `perf_event_open`: cycles, instructions, L1D read misses and
+// branch misses, counted in user space only, so `kernel.perf_event_paranoid` up to 2 is enough.
+//
+// The counters are opened as a group, read all at once with a single `read()`: each plugin measured costs a system
+// call per block. A counter not supported by the CPU (e.g. in a VM) reads 0, the others still work.
+class PerfCounters {
+public:
+    enum Counter {
+        CYCLES,
+        INSTRUCTIONS,
+        L1D_MISSES,
+        BRANCH_MISSES,
+        COUNTER_COUNT,
+    };
+
+    // Counters accumulated over `frames`, e.g. by a plugin
+    struct Counts {
+        uint64_t values[COUNTER_COUNT] = {};
+        uint64_t frames = 0;
+
+        void add(const uint64_t* from, const uint64_t* to, uint32_t frameCount)
+        {
+            for (int c = 0; c < COUNTER_COUNT; c++) {
+                values[c] += to[c] - from[c];
+            }
+            frames += frameCount;
+        }
+
+        float ipc() const
+        {
+            return values[CYCLES] ? (float)values[INSTRUCTIONS] / values[CYCLES] : 0.0f;
+        }
+
+        float perSample(Counter counter) const
+        {
+            return frames ? (float)values[counter] / frames : 0.0f;
+        }
+
+        // e.g. `IPC 1.62, 0.41 L1D misses, 0.02 branch misses per sample`
+        std::string toString() const
+        {
+            char text[96];
+            snprintf(text, sizeof(text), "IPC %.2f, %.2f L1D misses, %.2f branch misses per sample", ipc(),
+                perSample(L1D_MISSES), perSample(BRANCH_MISSES));
+            return text;
+        }
+    };
+
+protected:
+    int fds[COUNTER_COUNT] = { -1, -1, -1, -1 };
+    uint64_t ids[COUNTER_COUNT] = {};
+    int leader = -1;
+    bool tried = false;
+
+    static int openCounter(uint32_t type, uint64_t config, int group)
+    {
+        struct perf_event_attr attr;
+        memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = type;
+        attr.config = config;
+        attr.disabled = group == -1;
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP | PERF_FORMAT_ID;
+        return syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+    }
+
+public:
+    ~PerfCounters()
+    {
+        close();
+    }
+
+    // Open the counters of the calling thread, false if the CPU or the kernel doesn't give access to them
+    bool open()
+    {
+        if (tried) {
+            return leader != -1;
+        }
+        tried = true;
+        const struct {
+            uint32_t type;
+            uint64_t config;
+        } events[COUNTER_COUNT] = {
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS },
+            { PERF_TYPE_HW_CACHE, PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) | (PERF_COUNT_HW_CACHE_RESULT_MISS << 16) },
+            { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES },
+        };
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            fds[c] = openCounter(events[c].type, events[c].config, leader);
+            if (fds[c] == -1) {
+                if (c == CYCLES) {
+                    return false;
+                }
+                continue;
+            }
+            if (leader == -1) {
+                leader = fds[c];
+            }
+            ioctl(fds[c], PERF_EVENT_IOC_ID, &ids[c]);
+        }
+        ioctl(leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+        return true;
+    }
+
+    void close()
+    {
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            if (fds[c] != -1) {
+                ::close(fds[c]);
+                fds[c] = -1;
+            }
+        }
+        leader = -1;
+    }
+
+    // Current value of the counters, since they were opened
+    bool read(uint64_t* values)
+    {
+        struct {
+            uint64_t nr;
+            struct {
+                uint64_t value;
+                uint64_t id;
+            } counters[COUNTER_COUNT];
+        } group;
+        if (leader == -1 || ::read(leader, &group, sizeof(group)) <= 0) {
+            return false;
+        }
+        for (int c = 0; c < COUNTER_COUNT; c++) {
+            values[c] = 0;
+            for (uint64_t i = 0; i < group.nr && i < COUNTER_COUNT; i++) {
+                if (fds[c] != -1 && group.counters[i].id == ids[c]) {
+                    values[c] = group.counters[i].value;
+                }
+            }
+        }
+        return true;
+    }
+
+    // Counters of the calling thread, opened on first use
+    static PerfCounters* forThread()
+    {
+        static thread_local PerfCounters counters;
+        return counters.open() ? &counters : NULL;
+    }
+};
@@ -0,0 +1,241 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "libs/nlohmann/json.hpp"
+#include "log.h"
+
+/*#md
+### Power management
+
+`"powerManagement": { ... }` keep the CPU clock up while the sequencer is playing, instead of letting the
+`ondemand`/`schedutil` governor lower it between the blocks and take time to raise it back when a dense bar comes,
+and relax it once stopped, e.g. on a rig running on battery. The governor of the audio cores is switched through
+sysfs by a thread of its own, never by the audio thread, and the governors found at startup are restored on exit.
+
+- `"playing": "performance"` governor of the audio cores while playing (default `performance`).
+- `"stopped": "powersave"` governor of the audio cores once stopped (default `powersave`, use `schedutil` or `ondemand` to keep some headroom for the UI).
+- `"pinMinFrequency": true` instead of switching the governor, raise the minimum frequency of the audio cores to their maximum while playing, and restore it once stopped, e.g. when the `performance` governor is not available (default false).
+- `"cores": [1, 2, 3]` cores to manage (default the audio cores of [Realtime](#realtime) when it is configured, else all the cores).
+- `"thermalMs": 1000` interval at which the thermal zone is checked, a warning being logged when the CPU crosses a trip point or when its clock is capped under the maximum while playing, and once it recovered (default 1000, 0 to disable).
+
+Writing to sysfs requires root, else a warning is logged and the governor is left as it is.
+*/
+class PowerManager {
+protected:
+    bool enabled = false;
+    std::string playingGovernor = "performance";
+    std::string stoppedGovernor = "powersave";
+    bool pinMinFrequency = false;
+    std::vector<int> cores;
+    uint32_t thermalMs = 1000;
+
+    // Governor and minimum frequency of each core found at startup
+    std::vector<std::string> initialGovernors;
+    std::vector<std::string> initialMinFrequencies;
+
+    // Set by the audio thread, applied by the power thread
+    std::atomic<bool> playing = false;
+    bool applied = false;
+    bool started = false;
+
+    std::thread thread;
+    std::atomic<bool> running = false;
+
+    bool throttled = false;
+    bool aboveTrip = false;
+
+    static constexpr uint32_t POLL_MS = 20;
+
+    static std::string cpufreqPath(int core, const char* file)
+    {
+        return "/sys/devices/system/cpu/cpu" + std::to_string(core) + "/cpufreq/" + file;
+    }
+
+    static std::string readSysfs(const std::string& path)
+    {
+        std::ifstream file(path);
+        std::string value;
+        file >> value;
+        return value;
+    }
+
+    static int64_t readSysfsInt(const std::string& path)
+    {
+        std::string value = readSysfs(path);
+        return value.empty() ? -1 : atoll(value.c_str());
+    }
+
+    static bool writeSysfs(const std::string& path, const std::string& value)
+    {
+        std::ofstream file(path);
+        file << value;
+        file.flush();
+        return file.good();
+    }
+
+    void setGovernor(int core, const std::string& governor)
+    {
+        if (governor.empty()) {
+            return;
+        }
+        if (!writeSysfs(cpufreqPath(core, "scaling_governor"), governor)) {
+            logWarn("PowerManager: could not set the governor of core %d to %s", core, governor.c_str());
+        }
+    }
+
+    void setMinFrequency(int core, const std::string& kHz)
+    {
+        if (kHz.empty()) {
+            return;
+        }
+        if (!writeSysfs(cpufreqPath(core, "scaling_min_freq"), kHz)) {
+            logWarn("PowerManager: could not set the minimum frequency of core %d to %s kHz", core, kHz.c_str());
+        }
+    }
+
+    void apply(bool play)
+    {
+        for (size_t i = 0; i < cores.size(); i++) {
+            int core = cores[i];
+            if (pinMinFrequency) {
+                setMinFrequency(core, play ? readSysfs(cpufreqPath(core, "cpuinfo_max_freq")) : initialMinFrequencies[i]);
+            } else {
+                setGovernor(core, play ? playingGovernor : stoppedGovernor);
+            }
+        }
+        logInfo("PowerManager: %s", play ? "playing, clock kept up" : "stopped, clock relaxed");
+    }
+
+    // Log when the CPU crosses the first trip point of its thermal zone, or its clock is capped while playing
+    void checkThermal()
+    {
+        int64_t milliCelsius = readSysfsInt("/sys/class/thermal/thermal_zone0/temp");
+        int64_t trip = readSysfsInt("/sys/class/thermal/thermal_zone0/trip_point_0_temp");
+        if (milliCelsius >= 0 && trip > 0 && (milliCelsius >= trip) != aboveTrip) {
+            aboveTrip = milliCelsius >= trip;
+            if (aboveTrip) {
+                logWarn("PowerManager: CPU at %.1f°C, above the trip point at %.1f°C", milliCelsius / 1000.0f, trip / 1000.0f);
+            } else {
+                logInfo("PowerManager: CPU back to %.1f°C", milliCelsius / 1000.0f);
+            }
+        }
+        if (cores.empty() || !applied) {
+            return;
+        }
+        int64_t current = readSysfsInt(cpufreqPath(cores[0], "scaling_cur_freq"));
+        int64_t max = readSysfsInt(cpufreqPath(cores[0], "cpuinfo_max_freq"));
+        if (current <= 0 || max <= 0 || (current < max) == throttled) {
+            return;
+        }
+        throttled = current < max;
+        if (throttled) {
+            logWarn("PowerManager: CPU throttled to %lld MHz of %lld MHz at %.1f°C", (long long)current / 1000,
+                (long long)max / 1000, milliCelsius / 1000.0f);
+        } else {
+            logInfo("PowerManager: CPU back to %lld MHz", (long long)current / 1000);
+        }
+    }
+
+    void loop()
+    {
+        uint32_t sinceThermal = 0;
+        while (running) {
+            bool play = playing.load(std::memory_order_relaxed);
+            if (play != applied || !started) {
+                apply(play);
+                applied = play;
+                started = true;
+                throttled = false;
+            }
+            sinceThermal += POLL_MS;
+            if (thermalMs > 0 && sinceThermal >= thermalMs) {
+                sinceThermal = 0;
+                checkThermal();
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(POLL_MS));
+        }
+    }
+
+public:
+    ~PowerManager()
+    {
+        stop();
+    }
+
+    // `audioCores` being the cores of the audio threads, if they are pinned
+    void config(nlohmann::json& config, const std::vector<int>& audioCores)
+    {
+        enabled = true;
+        playingGovernor = config.value("playing", playingGovernor);
+        stoppedGovernor = config.value("stopped", stoppedGovernor);
+        pinMinFrequency = config.value("pinMinFrequency", pinMinFrequency);
+        thermalMs = config.value("thermalMs", thermalMs);
+
+        int count = std::thread::hardware_concurrency();
+        cores.clear();
+        if (config.contains("cores") && config["cores"].is_array()) {
+            for (auto& core : config["cores"]) {
+                if (core.get<int>() >= 0 && core.get<int>() < count) {
+                    cores.push_back(core.get<int>());
+                } else {
+                    logWarn("PowerManager: ignore invalid core %d", core.get<int>());
+                }
+            }
+        } else if (!audioCores.empty()) {
+            cores = audioCores;
+        } else {
+            for (int core = 0; core < count; core++) {
+                cores.push_back(core);
+            }
+        }
+    }
+
+    // Start the power thread, relaxing the clock until the sequencer plays
+    void start()
+    {
+        if (!enabled || running) {
+            return;
+        }
+        initialGovernors.clear();
+        initialMinFrequencies.clear();
+        for (int core : cores) {
+            initialGovernors.push_back(readSysfs(cpufreqPath(core, "scaling_governor")));
+            initialMinFrequencies.push_back(readSysfs(cpufreqPath(core, "scaling_min_freq")));
+        }
+        started = false;
+        running = true;
+        thread = std::thread([this]() { loop(); });
+        pthread_setname_np(thread.native_handle(), "power");
+    }
+
+    // Stop the power thread and restore the governors found at startup
+    void stop()
+    {
+        if (!running) {
+            return;
+        }
+        running = false;
+        if (thread.joinable()) {
+            thread.join();
+        }
+        for (size_t i = 0; i < cores.size(); i++) {
+            if (pinMinFrequency) {
+                setMinFrequency(cores[i], initialMinFrequencies[i]);
+            } else {
+                setGovernor(cores[i], initialGovernors[i]);
+            }
+        }
+    }
+
+    // Audio thread, when the playing state changes. Never waits.
+    void setPlaying(bool play)
+    {
+        playing.store(play, std::memory_order_relaxed);
+    }
+};
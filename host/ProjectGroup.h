@@ -0,0 +1,162 @@
+#pragma once
+
+#include <fstream>
+#include <string>
+#include <vector>
+
+#include "AudioPluginHandler.h"
+#include "TrackScheduler.h"
+#include "helpers/trace.h"
+#include "libs/nlohmann/json.hpp"
+#include "log.h"
+
+/*#md
+### Project group
+
+Several projects can run in the same zicHost process, e.g. one per room of an installation, instead of one process
+per project, each with its own threads fighting for the cores:
+
+```json
+{ "projects": ["room1.json", "room2.json", { "plugins": [ ... ] }] }
+```
+
+`"projects"` lists the config of each project, inline or as the path of its file. Each project is a host of its own,
+with its own tracks, tempo, outputs and MIDI mapping, but the tracks of all the projects are processed by a single
+`pool` track scheduler, in the same block: the workers pick the next ready track of any project, so a project
+waiting on a long track lets the others use the cores.
+
+- The block size and the sample rate must be the same for all the projects.
+- The first project leads: its `realtime` and `trackSchedulerWorkers` settings apply to the shared workers.
+- Each block starts once every audio device clocking a project (see `deviceClock`) has room for it, so the devices
+should share the same clock, e.g. the outputs of a single card.
+- Audio servers driving the loop (JACK, remote tracks) are not supported in a group.
+*/
+class ProjectGroup {
+protected:
+    std::vector<AudioPluginHandler*> projects;
+    TrackScheduler* scheduler = NULL;
+
+    static bool loadConfig(nlohmann::json& entry, nlohmann::json& config)
+    {
+        if (!entry.is_string()) {
+            config = entry;
+        } else {
+            std::ifstream file(entry.get<std::string>());
+            if (!file) {
+                logError("ProjectGroup: unable to open %s", entry.get<std::string>().c_str());
+                return false;
+            }
+            try {
+                file >> config;
+            } catch (const nlohmann::json::parse_error& e) {
+                logError("ProjectGroup: JSON parse error in %s: %s", entry.get<std::string>().c_str(), e.what());
+                return false;
+            }
+        }
+        // The config of zic can be given as well
+        if (config.contains("audio") && config["audio"].is_object()) {
+            config = nlohmann::json(config["audio"]);
+        }
+        return true;
+    }
+
+    // Gather the graphs of the projects, if one of them changed since the previous block
+    void updateGraphs()
+    {
+        bool changed = false;
+        for (AudioPluginHandler* project : projects) {
+            changed = changed || project->schedulerTracksHaveChanged();
+        }
+        if (!changed) {
+            return;
+        }
+        std::vector<std::vector<Track*>> graphs;
+        for (AudioPluginHandler* project : projects) {
+            graphs.push_back(project->getSchedulerTracks());
+        }
+        scheduler->setGraphs(graphs);
+    }
+
+public:
+    ~ProjectGroup()
+    {
+        if (scheduler) {
+            delete scheduler;
+        }
+    }
+
+    // Create a host for each project of the config. Return false if one of them could not be loaded.
+    bool config(nlohmann::json& config)
+    {
+        for (nlohmann::json& entry : config["projects"]) {
+            nlohmann::json projectConfig;
+            if (!loadConfig(entry, projectConfig)) {
+                return false;
+            }
+            AudioPluginHandler* project = new AudioPluginHandler();
+            project->setSharedScheduling();
+            project->config(projectConfig);
+            projects.push_back(project);
+        }
+        if (projects.empty()) {
+            logError("ProjectGroup: no project to run");
+            return false;
+        }
+        logInfo("ProjectGroup: %d projects", (int)projects.size());
+        return true;
+    }
+
+    void loop()
+    {
+        std::vector<AudioPlugin*> clockPlugins;
+        uint32_t blockSize = projects[0]->getBlockSize();
+        size_t started = 0;
+        for (; started < projects.size() && isRunning; started++) {
+            AudioPluginHandler* project = projects[started];
+            if (project->getBlockSize() != blockSize) {
+                logError("ProjectGroup: project %d has a block size of %d instead of %d", (int)started, project->getBlockSize(), blockSize);
+                break;
+            }
+            if (!project->startLoop()) {
+                logError("ProjectGroup: project %d could not start", (int)started);
+                break;
+            }
+            if (project->getLoopPlugin()) {
+                logWarn("ProjectGroup: %s cannot drive the loop of project %d, the group is clocked by its devices", project->getLoopPlugin()->name.c_str(), (int)started);
+            }
+            if (project->getClockPlugin()) {
+                clockPlugins.push_back(project->getClockPlugin());
+            }
+        }
+
+        if (started == projects.size()) {
+            scheduler = new TrackScheduler(blockSize);
+            updateGraphs();
+            projects[0]->startSchedulerWorkers(*scheduler);
+
+            Trace::get().thread();
+            while (isRunning) {
+                for (AudioPlugin* clockPlugin : clockPlugins) {
+                    clockPlugin->waitForNextBlock(blockSize);
+                }
+                TraceSpan span("block");
+                for (AudioPluginHandler* project : projects) {
+                    project->beginBlock();
+                }
+                // A project reloaded at the end of the previous block changed its graph
+                updateGraphs();
+                scheduler->run();
+                for (AudioPluginHandler* project : projects) {
+                    project->endBlock();
+                }
+            }
+
+            // The tracks are released once no worker can run them anymore
+            delete scheduler;
+            scheduler = NULL;
+        }
+        for (size_t i = 0; i < started; i++) {
+            projects[i]->stopLoop();
+        }
+    }
+};
@@ -0,0 +1,117 @@
+#pragma once
+
+#include <cstdint>
+#include <time.h>
+
+#include "libs/nlohmann/json.hpp"
+#include "plugins/audio/audioPlugin.h"
+
+/*#md
+### Quality governor
+
+`"qualityGovernor": { ... }` lower the quality of the plugins supporting it when the CPU can't keep up, instead of
+running into xruns, and restore it once the load went down (see `AudioPlugin::setQualityLevel()`): e.g. `SynthSample`
+plays fewer voices, `EffectGrain` fewer grains, `EffectDistortion2` and `EffectVolumeClipping` oversample less and
+`EffectFilterMultiModeMoog` uses the classic filter instead of the ZDF ladder. Each level lowers the quality a bit
+more, up to level 2.
+
+- `"raise": 85` load of the blocks, in % of the block deadline, above which the quality is lowered by one level (default 85). A block missing its deadline lowers it right away.
+- `"lower": 60` load below which the quality is raised back by one level, once it stayed there for `recoverMs` (default 60).
+- `"holdMs": 500` time a level is kept before lowering the quality further, so the load reflects the change (default 500).
+- `"recoverMs": 3000` time the load must stay below `lower` before raising the quality by one level (default 3000).
+- `"temperature": 80` CPU temperature in °C, from `/sys/class/thermal`, above which the quality is kept at level 1 at least, before the CPU gets throttled, until it cooled down by 5°C (default 0, disabled).
+
+The load is the time spent rendering the tracks, not counting the time the audio output waits for the sound card.
+*/
+class QualityGovernor {
+protected:
+    float raise = 85.0f;
+    float lower = 60.0f;
+    uint32_t holdMs = 500;
+    uint32_t recoverMs = 3000;
+    int32_t thresholdMilliCelsius = 0;
+
+    uint32_t holdBlocks = 0;
+    uint32_t recoverBlocks = 0;
+    // Load smoothed over a few blocks, so a single slow block under `raise` doesn't change anything
+    float load = 0.0f;
+    uint32_t hold = 0;
+    uint32_t calm = 0;
+    bool hot = false;
+
+    static constexpr float SMOOTHING = 0.125f;
+    static const int32_t COOLING_MILLI_CELSIUS = 5000;
+
+public:
+    bool enabled = false;
+    uint8_t level = 0;
+
+    void config(nlohmann::json& config)
+    {
+        enabled = true;
+        raise = config.value("raise", raise);
+        lower = config.value("lower", lower);
+        holdMs = config.value("holdMs", holdMs);
+        recoverMs = config.value("recoverMs", recoverMs);
+        thresholdMilliCelsius = config.value("temperature", 0.0f) * 1000;
+    }
+
+    bool watchesTemperature()
+    {
+        return enabled && thresholdMilliCelsius > 0;
+    }
+
+    void start(uint32_t sampleRate, uint32_t blockSize)
+    {
+        holdBlocks = (uint64_t)holdMs * sampleRate / 1000 / blockSize;
+        recoverBlocks = (uint64_t)recoverMs * sampleRate / 1000 / blockSize;
+        level = 0;
+        load = 0.0f;
+        hold = 0;
+        calm = 0;
+        hot = false;
+    }
+
+    // Load of the block that was just rendered, in % of the deadline, and the current CPU temperature. Return true
+    // when the level changed.
+    bool update(float blockLoad, int32_t milliCelsius)
+    {
+        load += (blockLoad - load) * SMOOTHING;
+        if (thresholdMilliCelsius > 0) {
+            if (milliCelsius >= thresholdMilliCelsius) {
+                hot = true;
+            } else if (milliCelsius < thresholdMilliCelsius - COOLING_MILLI_CELSIUS) {
+                hot = false;
+            }
+        }
+        uint8_t minimum = hot ? 1 : 0;
+        calm = load < lower ? calm + 1 : 0;
+        if (hold > 0) {
+            hold--;
+        }
+
+        uint8_t next = level;
+        if (level < minimum) {
+            next = minimum;
+        } else if ((load > raise || blockLoad >= 100.0f) && hold == 0 && level < AudioPlugin::QUALITY_LOWEST) {
+            next = level + 1;
+        } else if (level > minimum && calm >= recoverBlocks) {
+            next = level - 1;
+        }
+        if (next == level) {
+            return false;
+        }
+        level = next;
+        hold = holdBlocks;
+        calm = 0;
+        return true;
+    }
+
+    // CPU time of the calling thread, not counting the time it waits, e.g. for the sound card
+    static uint64_t threadNs()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+};
@@ -0,0 +1,256 @@
+#pragma once
+
+#include <dirent.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "constants.h"
+#include "libs/nlohmann/json.hpp"
+#include "log.h"
+
+/*#md
+### Realtime
+
+`"realtime": { ... }` run the audio threads (host and tracks) with a real-time scheduling policy, pinned to dedicated cores, and lock the memory to avoid page faults in the audio path:
+
+- `"priority": 70` SCHED_FIFO priority of the audio threads, from 1 to 99 (default 70, 0 to keep the default scheduling).
+- `"audioCores": [1, 2, 3]` cores reserved for the audio threads (default all the cores but the first one). Tracks are assigned to them in turn.
+- `"trackCores": { "1": 2, "5": 3 }` pin specific tracks to a given core, instead of the automatic assignment.
+- `"isolateOtherThreads": true` keep the other threads (UI, controllers, autosave...) off the audio cores (default true).
+- `"mlock": true` lock the memory of the process and pre-fault the stack of the audio threads (default true).
+
+Real-time scheduling and memory locking require the right permissions (root, or `rtprio` and `memlock` limits), else a warning is logged and the setting is ignored.
+*/
+class Realtime {
+protected:
+    bool enabled = false;
+    int priority = 70;
+    std::vector<int> audioCores;
+    int8_t trackCores[MAX_TRACKS];
+    bool isolateOtherThreads = true;
+    bool lockMemory = true;
+    uint8_t nextCore = 0;
+
+    static const size_t STACK_PREFAULT_SIZE = 256 * 1024;
+
+    void setCpuSet(cpu_set_t& set, std::vector<int>& cores)
+    {
+        CPU_ZERO(&set);
+        for (int core : cores) {
+            CPU_SET(core, &set);
+        }
+    }
+
+    std::vector<int> otherCores()
+    {
+        std::vector<int> cores;
+        int count = std::thread::hardware_concurrency();
+        for (int core = 0; core < count; core++) {
+            bool isAudio = false;
+            for (int audioCore : audioCores) {
+                isAudio = isAudio || audioCore == core;
+            }
+            if (!isAudio) {
+                cores.push_back(core);
+            }
+        }
+        return cores;
+    }
+
+    void pin(pthread_t thread, int core, std::string name)
+    {
+        cpu_set_t set;
+        CPU_ZERO(&set);
+        CPU_SET(core, &set);
+        int err = pthread_setaffinity_np(thread, sizeof(set), &set);
+        if (err) {
+            logWarn("Realtime: could not pin %s to core %d: %s", name.c_str(), core, strerror(err));
+        } else {
+            logInfo("Realtime: %s pinned to core %d", name.c_str(), core);
+        }
+    }
+
+    void setPriority(pthread_t thread, std::string name)
+    {
+        if (priority <= 0) {
+            return;
+        }
+        struct sched_param param = { .sched_priority = priority };
+        int err = pthread_setschedparam(thread, SCHED_FIFO, &param);
+        if (err) {
+            logWarn("Realtime: could not set SCHED_FIFO priority %d for %s: %s", priority, name.c_str(), strerror(err));
+        } else {
+            logInfo("Realtime: %s running with SCHED_FIFO priority %d", name.c_str(), priority);
+        }
+    }
+
+public:
+    Realtime()
+    {
+        for (int i = 0; i < MAX_TRACKS; i++) {
+            trackCores[i] = -1;
+        }
+    }
+
+    void config(nlohmann::json& config)
+    {
+        enabled = true;
+        priority = config.value("priority", priority);
+        if (priority > 99) {
+            priority = 99;
+        }
+        isolateOtherThreads = config.value("isolateOtherThreads", isolateOtherThreads);
+        lockMemory = config.value("mlock", lockMemory);
+
+        int count = std::thread::hardware_concurrency();
+        audioCores.clear();
+        if (config.contains("audioCores") && config["audioCores"].is_array()) {
+            for (auto& core : config["audioCores"]) {
+                if (core.get<int>() >= 0 && core.get<int>() < count) {
+                    audioCores.push_back(core.get<int>());
+                } else {
+                    logWarn("Realtime: ignore invalid audio core %d", core.get<int>());
+                }
+            }
+        } else {
+            for (int core = count > 1 ? 1 : 0; core < count; core++) {
+                audioCores.push_back(core);
+            }
+        }
+        if (config.contains("trackCores") && config["trackCores"].is_object()) {
+            for (auto& [track, core] : config["trackCores"].items()) {
+                int trackId = atoi(track.c_str());
+                if (trackId >= 0 && trackId < MAX_TRACKS && core.get<int>() >= 0 && core.get<int>() < count) {
+                    trackCores[trackId] = core.get<int>();
+                } else {
+                    logWarn("Realtime: ignore invalid track core %s: %d", track.c_str(), core.get<int>());
+                }
+            }
+        }
+
+        if (lockMemory) {
+            if (mlockall(MCL_CURRENT | MCL_FUTURE) == 0) {
+                logInfo("Realtime: memory locked");
+            } else {
+                logWarn("Realtime: could not lock memory: %s", strerror(errno));
+            }
+        }
+
+        // Threads created from now on by the calling thread (e.g. UI) inherit this affinity
+        if (isolateOtherThreads) {
+            std::vector<int> cores = otherCores();
+            if (cores.size() > 0) {
+                cpu_set_t set;
+                setCpuSet(set, cores);
+                if (sched_setaffinity(0, sizeof(set), &set) != 0) {
+                    logWarn("Realtime: could not move the calling thread off the audio cores: %s", strerror(errno));
+                }
+            }
+        }
+    }
+
+    // Touch the stack, so its pages are already mapped (and locked) when the audio processing needs them
+    static void prefaultStack()
+    {
+        // One volatile write per page, a memset of a buffer never read being removed by the compiler
+        char stack[STACK_PREFAULT_SIZE];
+        volatile char* page = stack;
+        for (size_t i = 0; i < sizeof(stack); i += 4096) {
+            page[i] = 0;
+        }
+    }
+
+    // Cores reserved for the audio threads, none if the audio threads are not pinned
+    std::vector<int> getAudioCores()
+    {
+        return enabled ? audioCores : std::vector<int>();
+    }
+
+    bool shouldPrefaultStack()
+    {
+        return enabled && lockMemory;
+    }
+
+    void applyHost(pthread_t thread)
+    {
+        if (!enabled) {
+            return;
+        }
+        setPriority(thread, "host");
+        if (audioCores.size() > 0) {
+            pin(thread, audioCores[nextCore++ % audioCores.size()], "host");
+        }
+    }
+
+    void applyTrack(pthread_t thread, int16_t trackId, std::string name)
+    {
+        if (!enabled) {
+            return;
+        }
+        setPriority(thread, name);
+        if (trackId >= 0 && trackId < MAX_TRACKS && trackCores[trackId] != -1) {
+            pin(thread, trackCores[trackId], name);
+        } else if (audioCores.size() > 0) {
+            pin(thread, audioCores[nextCore++ % audioCores.size()], name);
+        }
+    }
+
+    // Whether the thread was set up as an audio thread: real-time policy or only allowed on audio cores
+    bool isAudioThread(pid_t tid)
+    {
+        if (sched_getscheduler(tid) == SCHED_FIFO) {
+            return true;
+        }
+        cpu_set_t set;
+        if (sched_getaffinity(tid, sizeof(set), &set) != 0) {
+            return false;
+        }
+        for (int core : otherCores()) {
+            if (CPU_ISSET(core, &set)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Move all the threads already running, that are not audio threads, off the audio cores.
+    // Must be called once the audio threads are set up.
+    void isolate()
+    {
+        if (!enabled || !isolateOtherThreads) {
+            return;
+        }
+        std::vector<int> cores = otherCores();
+        if (cores.size() == 0) {
+            logWarn("Realtime: no core left for the non audio threads");
+            return;
+        }
+        cpu_set_t set;
+        setCpuSet(set, cores);
+
+        DIR* dir = opendir("/proc/self/task");
+        if (!dir) {
+            return;
+        }
+        int moved = 0;
+        struct dirent* entry;
+        while ((entry = readdir(dir)) != NULL) {
+            pid_t tid = atoi(entry->d_name);
+            if (tid <= 0) {
+                continue;
+            }
+            if (!isAudioThread(tid) && sched_setaffinity(tid, sizeof(set), &set) == 0) {
+                moved++;
+            }
+        }
+        closedir(dir);
+        logInfo("Realtime: %d other threads moved off the audio cores", moved);
+    }
+};
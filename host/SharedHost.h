@@ -0,0 +1,370 @@
+#pragma once
+
+#include <chrono>
+#include <map>
+#include <stdexcept>
+#include <string>
+#include <thread>
+#include <tuple>
+#include <vector>
+
+#include "SharedSegment.h"
+#include "log.h"
+#include "plugins/audio/audioPlugin.h"
+#include "plugins/audio/mapping.h"
+
+class SharedHost;
+
+// Value of a plugin of the host process, as seen by the UI: changes are sent to the host and applied locally right
+// away, the value then following the host.
+class SharedValue : public Val {
+protected:
+    SharedHost& host;
+
+public:
+    int index = -1;
+    // Value sent to the host, the host value being ignored until it is applied or for a few polls
+    float sent = 0.0f;
+    uint8_t pendingPolls = 0;
+
+    SharedValue(SharedHost& host, SharedSegment::Value& entry)
+        : Val(entry.value, entry.key, { entry.label, entry.type, entry.min, entry.max, entry.step, entry.floatingPoint, entry.unit, entry.incType })
+        , host(host)
+    {
+    }
+
+    void set(float value, void* data = NULL) override;
+
+    // Value or string changed by the host
+    void update(float value)
+    {
+        setFloat(value);
+        notifyChange();
+    }
+
+    void updateString(const char* string)
+    {
+        setString(string);
+        notifyChange();
+    }
+};
+
+// Plugin of the host process: only its values are shared, its data (e.g. the steps of a sequencer) is not.
+class SharedPlugin : public Mapping {
+public:
+    SharedPlugin(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : Mapping(props, config)
+    {
+    }
+
+    void sample(float* buf) override { }
+
+    // Views reading data the UI process doesn't have get zeroes (e.g. an empty vector), instead of a NULL pointer
+    void* data(int id, void* userdata = NULL) override
+    {
+        alignas(64) static uint8_t empty[4096] = {};
+        return empty;
+    }
+};
+
+/*#md
+### Shared host
+
+The UI can run in its own process, attached to a standalone host over shared memory, so a slow or crashing UI never
+disturbs the audio, and can be restarted while the audio keeps playing:
+
+```sh
+./zicHost config.json --shm zic &
+ZIC_HOST_SHM=zic ./zic config.json
+```
+
+The host process loads the `audio` part of the config and shares its values, the transport, and the peak level of
+each track (as the `TRACK_PEAKS` host data, a float per track). The UI process sees the plugins of the host with
+their values: changing a value, playing a note or sending an event from the UI is forwarded to the host. The data of
+the plugins (e.g. the steps of a sequencer or a sample waveform) is not shared, the views needing it stay empty. MIDI
+is handled by the host process. When the host restarts, the UI attaches to it again.
+*/
+class SharedHost : public AudioPluginHandlerInterface {
+protected:
+    std::string name;
+    SharedSegment* segment = NULL;
+    uint32_t generation = 0;
+    std::vector<SharedValue*> values;
+    // Plugins created so far, only touched by the thread following the host, and the list the UI reads
+    std::vector<AudioPlugin*> proxies;
+    std::atomic<std::vector<AudioPlugin*>*> pluginList = NULL;
+    nlohmann::json emptyConfig = nlohmann::json::object();
+    AudioPlugin::Props pluginProps;
+    float peaks[TOTAL_TRACKS] = {};
+    bool running = true;
+
+    uint64_t lastFrame = 0;
+    std::chrono::steady_clock::time_point lastProgress;
+
+    static constexpr auto HOST_TIMEOUT = std::chrono::seconds(2);
+
+    SharedPlugin* findPlugin(int16_t track, const std::string& pluginName)
+    {
+        for (AudioPlugin* plugin : proxies) {
+            if (plugin->track == track && plugin->name == pluginName) {
+                return (SharedPlugin*)plugin;
+            }
+        }
+        return NULL;
+    }
+
+    // Match the values to the table of the host, by track, plugin and key, creating the plugins and values not known
+    // yet. Return false if the table is being rebuilt.
+    bool mapValues()
+    {
+        uint32_t current = segment->generation.load(std::memory_order_acquire);
+        if (current & 1 || current == 0) {
+            return false;
+        }
+        std::map<std::tuple<int16_t, std::string, std::string>, SharedValue*> known;
+        for (AudioPlugin* plugin : proxies) {
+            for (int i = 0; i < plugin->getValueCount(); i++) {
+                SharedValue* value = (SharedValue*)plugin->getValue(i);
+                known[{ plugin->track, plugin->name, value->key() }] = value;
+                value->index = -1;
+            }
+        }
+        bool added = false;
+        uint16_t count = segment->valueCount.load();
+        values.assign(count, NULL);
+        for (uint16_t i = 0; i < count; i++) {
+            SharedSegment::Value& entry = segment->values[i];
+            auto it = known.find({ entry.track, entry.plugin, entry.key });
+            SharedValue* value = it != known.end() ? it->second : NULL;
+            if (!value) {
+                SharedPlugin* plugin = findPlugin(entry.track, entry.plugin);
+                if (!plugin) {
+                    AudioPlugin::Config config = { entry.plugin, emptyConfig, (uint8_t)entry.track };
+                    plugin = new SharedPlugin(pluginProps, config);
+                    proxies.push_back(plugin);
+                }
+                value = new SharedValue(*this, entry);
+                char string[sizeof(entry.string)];
+                if (value->hasType(VALUE_STRING) && segment->readString(i, string, sizeof(string))) {
+                    value->setString(string);
+                }
+                plugin->val(value);
+                plugin->indexValues();
+                added = true;
+            }
+            value->index = i;
+            values[i] = value;
+        }
+        if (segment->generation.load(std::memory_order_acquire) != current) {
+            return false;
+        }
+        generation = current;
+        if (added || !pluginList.load()) {
+            // Like the host, a replaced list is never freed
+            pluginList = new std::vector<AudioPlugin*>(proxies);
+        }
+        return true;
+    }
+
+    bool connect(bool wait)
+    {
+        for (int attempt = 0; !segment; attempt++) {
+            segment = SharedSegment::attach(name);
+            if (!segment) {
+                if (!wait || attempt == 100) {
+                    return false;
+                }
+                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+            }
+        }
+        for (int attempt = 0; !mapValues(); attempt++) {
+            if (!wait || attempt == 100) {
+                return false;
+            }
+            std::this_thread::sleep_for(std::chrono::milliseconds(100));
+        }
+        lastFrame = segment->frame;
+        lastProgress = std::chrono::steady_clock::now();
+        logInfo("UI attached to host segment %s, %d values", SharedSegment::shmName(name).c_str(), (int)values.size());
+        return true;
+    }
+
+    // The host stopped rendering: wait for it to restart, on a new segment
+    void reconnect()
+    {
+        if (segment) {
+            logWarn("Host segment %s stalled, waiting for the host", SharedSegment::shmName(name).c_str());
+            SharedSegment::detach(segment);
+            segment = NULL;
+        }
+        while (running && !connect(false)) {
+            std::this_thread::sleep_for(std::chrono::milliseconds(500));
+        }
+    }
+
+    void poll()
+    {
+        if (segment->generation.load(std::memory_order_acquire) != generation) {
+            mapValues();
+        }
+        char string[sizeof(SharedSegment::Value::string)];
+        for (SharedValue* value : values) {
+            if (!value) {
+                continue;
+            }
+            float hostValue = segment->values[value->index].value.load(std::memory_order_relaxed);
+            if (value->pendingPolls > 0) {
+                value->pendingPolls = hostValue == value->sent ? 0 : value->pendingPolls - 1;
+            } else if (hostValue != value->get()) {
+                value->update(hostValue);
+            }
+            if (value->hasType(VALUE_STRING) && segment->readString(value->index, string, sizeof(string))
+                && value->string() != string) {
+                value->updateString(string);
+            }
+        }
+        SharedSegment::Event event;
+        while (segment->events.read(&event, 1)) {
+            for (AudioPlugin* plugin : proxies) {
+                plugin->onEvent((AudioEventType)event.type, segment->playing);
+            }
+        }
+    }
+
+public:
+    SharedHost(std::string name)
+        : name(name)
+    {
+        pluginProps.audioPluginHandler = this;
+    }
+
+    // The tracks are loaded by the host process from its own config
+    SharedHost& config(nlohmann::json& config) override
+    {
+        if (!segment && !connect(true)) {
+            logError("No host on segment %s, start `zicHost --shm %s`", SharedSegment::shmName(name).c_str(), name.c_str());
+        }
+        return *this;
+    }
+
+    // Follow the host until the app stops, called from the host thread
+    void loop() override
+    {
+        while (running) {
+            if (!segment) {
+                reconnect();
+                continue;
+            }
+            uint64_t frame = segment->frame.load(std::memory_order_relaxed);
+            auto now = std::chrono::steady_clock::now();
+            if (frame != lastFrame) {
+                lastFrame = frame;
+                lastProgress = now;
+            } else if (now - lastProgress > HOST_TIMEOUT) {
+                reconnect();
+                continue;
+            }
+            poll();
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+    }
+
+    // Send a command to the host, false if there is none or its queue is full
+    bool send(SharedSegment::Command command)
+    {
+        if (!segment) {
+            return false;
+        }
+        command.generation = generation;
+        return segment->commands.push(command);
+    }
+
+    AudioPlugin* getPluginPtr(std::string pluginName, int16_t track = -1) override
+    {
+        std::vector<AudioPlugin*>* list = pluginList.load();
+        if (!list) {
+            return NULL;
+        }
+        for (AudioPlugin* plugin : *list) {
+            if (plugin->name == pluginName && (track == -1 || plugin->track == track)) {
+                return plugin;
+            }
+        }
+        return NULL;
+    }
+
+    AudioPlugin& getPlugin(std::string pluginName, int16_t track = -1) override
+    {
+        AudioPlugin* plugin = getPluginPtr(pluginName, track);
+        if (!plugin) {
+            throw std::runtime_error("Could not find plugin " + pluginName + " on track " + std::to_string(track));
+        }
+        return *plugin;
+    }
+
+    const std::vector<AudioPlugin*>* getPlugins() override
+    {
+        return pluginList;
+    }
+
+    void sendEvent(AudioEventType event, int16_t track = -1) override
+    {
+        send({ SharedSegment::Command::EVENT, 0, track, 0, 0, (float)event });
+    }
+
+    void noteOn(uint8_t note, float velocity, NoteTarget target) override
+    {
+        send({ SharedSegment::Command::NOTE_ON, note, target.plugin ? target.plugin->track : target.track, 0, 0, velocity });
+    }
+
+    void noteOff(uint8_t note, float velocity, NoteTarget target) override
+    {
+        send({ SharedSegment::Command::NOTE_OFF, note, target.plugin ? target.plugin->track : target.track, 0, 0, velocity });
+    }
+
+    // MIDI is handled by the host process
+    void assignPluginToMidiChannel(uint8_t channel, AudioPlugin* plugin) override { }
+    void mapMidiCmd(AudioPlugin* plugin, int valueIndex, const std::string& cmd, const std::string& curve = "linear") override { }
+
+    bool isPlaying() override
+    {
+        return segment && segment->playing;
+    }
+
+    bool isStopped() override
+    {
+        return !segment || segment->stopped;
+    }
+
+    uint64_t getBlockFrame() override
+    {
+        return segment ? segment->frame.load(std::memory_order_relaxed) : 0;
+    }
+
+    uint8_t getDataId(std::string dataName) override
+    {
+        return dataName == "TRACK_PEAKS" ? 0 : 255;
+    }
+
+    // `TRACK_PEAKS`: peak of each track since the last call
+    void* data(int id, void* userdata = NULL) override
+    {
+        if (id != 0 || !segment) {
+            return NULL;
+        }
+        for (uint8_t t = 0; t < TOTAL_TRACKS; t++) {
+            peaks[t] = segment->peaks[t].exchange(0.0f, std::memory_order_relaxed);
+        }
+        return peaks;
+    }
+};
+
+inline void SharedValue::set(float value, void* data)
+{
+    setFloat(value);
+    sent = get();
+    if (index >= 0 && host.send({ SharedSegment::Command::SET_VALUE, 0, 0, (uint16_t)index, 0, sent })) {
+        pendingPolls = 20;
+    }
+    notifyChange();
+}
@@ -0,0 +1,203 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <pthread.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "SharedSegment.h"
+#include "log.h"
+#include "plugins/audio/audioPlugin.h"
+
+// Host side of the shared segment (see SharedSegment.h): a single thread publishes the values of the plugins, read
+// from the snapshot they keep (see `AudioPlugin::readValues()`), their strings and the transport, `rate` times per
+// second, and applies the commands sent by the UI. The audio thread only writes the peaks of the tracks, see
+// `AudioPluginHandler::publishPeaks()`.
+class SharedHostServer {
+protected:
+    AudioPluginHandlerInterface* handler = NULL;
+    SharedSegment* segment = NULL;
+    std::thread thread;
+    std::atomic<bool> stopping = false;
+    uint32_t periodMs = 10;
+
+    const std::vector<AudioPlugin*>* plugins = NULL;
+    struct Entry {
+        AudioPlugin* plugin;
+        int index;
+        ValueInterface* value;
+    };
+    std::vector<Entry> table;
+    std::vector<std::string> strings;
+    std::vector<float> readBuffer;
+    bool playing = false;
+    bool stopped = true;
+
+    static void copy(char* out, size_t size, const std::string& in)
+    {
+        strncpy(out, in.c_str(), size - 1);
+        out[size - 1] = '\0';
+    }
+
+    void buildTable(const std::vector<AudioPlugin*>* list)
+    {
+        plugins = list;
+        segment->generation.fetch_add(1, std::memory_order_acq_rel);
+        table.clear();
+        for (AudioPlugin* plugin : *plugins) {
+            for (int i = 0; i < plugin->getValueCount() && table.size() < SharedSegment::MAX_VALUES; i++) {
+                ValueInterface* value = plugin->getValue(i);
+                ValueInterface::Props& props = value->props();
+                SharedSegment::Value& entry = segment->values[table.size()];
+                entry.track = plugin->track;
+                copy(entry.plugin, sizeof(entry.plugin), plugin->name);
+                copy(entry.key, sizeof(entry.key), value->key());
+                copy(entry.label, sizeof(entry.label), props.label);
+                copy(entry.unit, sizeof(entry.unit), props.unit);
+                entry.type = props.type;
+                entry.floatingPoint = props.floatingPoint;
+                entry.incType = props.incType;
+                entry.min = props.min;
+                entry.max = props.max;
+                entry.step = props.step;
+                entry.value = value->get();
+                table.push_back({ plugin, i, value });
+            }
+        }
+        if (table.size() == SharedSegment::MAX_VALUES) {
+            logWarn("Shared segment: only the first %d values are shared", SharedSegment::MAX_VALUES);
+        }
+        strings.assign(table.size(), "");
+        for (size_t i = 0; i < table.size(); i++) {
+            publishString(i);
+        }
+        segment->valueCount = table.size();
+        segment->generation.fetch_add(1, std::memory_order_release);
+    }
+
+    void publishString(size_t i)
+    {
+        if (!table[i].value->hasType(VALUE_STRING)) {
+            return;
+        }
+        std::string string = table[i].value->string();
+        if (string != strings[i]) {
+            strings[i] = string;
+            segment->writeString(i, string);
+        }
+    }
+
+    void publishValues()
+    {
+        size_t i = 0;
+        while (i < table.size()) {
+            AudioPlugin* plugin = table[i].plugin;
+            bool snapshot = plugin->readValues(readBuffer);
+            for (; i < table.size() && table[i].plugin == plugin; i++) {
+                int index = table[i].index;
+                float value = snapshot && index < (int)readBuffer.size() ? readBuffer[index] : table[i].value->get();
+                segment->values[i].value.store(value, std::memory_order_relaxed);
+                publishString(i);
+            }
+        }
+    }
+
+    void publishTransport()
+    {
+        bool nowPlaying = handler->isPlaying();
+        bool nowStopped = handler->isStopped();
+        if (nowPlaying != playing || nowStopped != stopped) {
+            playing = nowPlaying;
+            stopped = nowStopped;
+            segment->playing = playing;
+            segment->stopped = stopped;
+            SharedSegment::Event event = { (uint8_t)(playing ? AudioEventType::START : stopped ? AudioEventType::STOP : AudioEventType::PAUSE), -1 };
+            // A UI not reading the events only misses transport changes, the state being in the segment
+            segment->events.write(&event, 1);
+        }
+        segment->frame.store(handler->getBlockFrame(), std::memory_order_relaxed);
+    }
+
+    void applyCommands()
+    {
+        uint32_t generation = segment->generation.load(std::memory_order_relaxed);
+        SharedSegment::Command* command;
+        while ((command = segment->commands.front()) != NULL) {
+            switch (command->type) {
+            case SharedSegment::Command::SET_VALUE:
+                // Changes sent for a previous table are dropped, the value might have moved
+                if (command->generation == generation && command->index < table.size()) {
+                    table[command->index].value->set(command->value);
+                }
+                break;
+            case SharedSegment::Command::NOTE_ON:
+                handler->noteOn(command->note, command->value, { command->track });
+                break;
+            case SharedSegment::Command::NOTE_OFF:
+                handler->noteOff(command->note, command->value, { command->track });
+                break;
+            case SharedSegment::Command::EVENT:
+                handler->sendEvent((AudioEventType)command->value, command->track);
+                break;
+            }
+            segment->commands.pop();
+        }
+    }
+
+    void run()
+    {
+        while (!stopping) {
+            const std::vector<AudioPlugin*>* list = handler->getPlugins();
+            if (list) {
+                if (list != plugins) {
+                    buildTable(list);
+                }
+                applyCommands();
+                publishValues();
+            }
+            publishTransport();
+            std::this_thread::sleep_for(std::chrono::milliseconds(periodMs));
+        }
+    }
+
+public:
+    ~SharedHostServer()
+    {
+        stop();
+    }
+
+    SharedSegment* getSegment()
+    {
+        return segment;
+    }
+
+    // Create the segment `name` and start sharing the host, the values being published `rate` times per second
+    bool start(AudioPluginHandlerInterface* pluginHandler, std::string name, uint32_t rate = 100)
+    {
+        if (segment || !pluginHandler) {
+            return false;
+        }
+        segment = SharedSegment::create(name);
+        if (!segment) {
+            return false;
+        }
+        handler = pluginHandler;
+        periodMs = 1000 / (rate ? rate : 1);
+        stopping = false;
+        thread = std::thread([this] { run(); });
+        pthread_setname_np(thread.native_handle(), "sharedHost");
+        logInfo("Host shared on segment %s", SharedSegment::shmName(name).c_str());
+        return true;
+    }
+
+    void stop()
+    {
+        if (!thread.joinable()) {
+            return;
+        }
+        stopping = true;
+        thread.join();
+    }
+};
@@ -0,0 +1,176 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <new>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "helpers/MpscQueue.h"
+#include "helpers/SpscRing.h"
+#include "host/constants.h"
+#include "log.h"
+
+// Memory shared by `zicHost --shm <name>` and the UI process attached to it (see `ZIC_HOST_SHM`), so the UI runs in
+// its own process: a slow or crashing UI never shares an allocator lock or a page fault with the audio threads, and
+// can restart while the audio keeps playing.
+//
+// The host publishes the table of the values of all its plugins, their current value and string, the transport and
+// the peak level of each track. The UI sends value changes, notes and events through a lock-free queue, and reads the
+// transport changes from a ring. Everything in the segment is plain data or lock-free atomics, so it can be mapped at
+// a different address in each process. The host creates the segment, the UI only attaches to it: a host restarting
+// creates a new one, that the UI attaches to again once it sees the previous one stalled.
+struct SharedSegment {
+    static const uint32_t MAGIC = 0x5a494353; // ZICS
+    static const uint32_t VERSION = 1;
+    static const uint16_t MAX_VALUES = 4096;
+
+    struct Value {
+        int16_t track;
+        char plugin[32];
+        char key[32];
+        char label[32];
+        char unit[16];
+        uint8_t type;
+        uint8_t floatingPoint;
+        uint8_t incType;
+        float min;
+        float max;
+        float step;
+        std::atomic<float> value;
+        // Odd while `string` is being written
+        std::atomic<uint32_t> stringVersion;
+        char string[64];
+    };
+
+    struct Command {
+        enum Type : uint8_t {
+            SET_VALUE,
+            NOTE_ON,
+            NOTE_OFF,
+            EVENT,
+        };
+        Type type;
+        uint8_t note;
+        int16_t track;
+        // Value index, in the table of `generation`
+        uint16_t index;
+        uint32_t generation;
+        // Value, note velocity or AudioEventType
+        float value;
+    };
+
+    struct Event {
+        // AudioEventType
+        uint8_t type;
+        int16_t track;
+    };
+
+    uint32_t magic;
+    uint32_t version;
+    // Version of the values table, odd while it is being rebuilt, e.g. when tracks are reloaded
+    std::atomic<uint32_t> generation;
+    std::atomic<uint16_t> valueCount;
+    // Frames rendered since the host started, the UI considering the host gone when it stops moving
+    std::atomic<uint64_t> frame;
+    std::atomic<bool> playing;
+    std::atomic<bool> stopped;
+    // Peak of each track since the UI last read it
+    std::atomic<float> peaks[TOTAL_TRACKS];
+
+    Value values[MAX_VALUES];
+    MpscQueue<Command, 512> commands;
+    SpscRing<Event, 64> events;
+
+    // Copy `string` of `value`, seqlock style, false if it is being written
+    bool readString(uint16_t index, char* out, size_t size)
+    {
+        Value& entry = values[index];
+        uint32_t before = entry.stringVersion.load(std::memory_order_acquire);
+        if (before & 1) {
+            return false;
+        }
+        strncpy(out, entry.string, size - 1);
+        out[size - 1] = '\0';
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return entry.stringVersion.load(std::memory_order_relaxed) == before;
+    }
+
+    // Host only
+    void writeString(uint16_t index, const std::string& string)
+    {
+        Value& entry = values[index];
+        entry.stringVersion.fetch_add(1, std::memory_order_acq_rel);
+        strncpy(entry.string, string.c_str(), sizeof(entry.string) - 1);
+        entry.string[sizeof(entry.string) - 1] = '\0';
+        entry.stringVersion.fetch_add(1, std::memory_order_release);
+    }
+
+    static std::string shmName(std::string name)
+    {
+        return name[0] == '/' ? name : "/" + name;
+    }
+
+    // Host only: replace any previous segment of the same name
+    static SharedSegment* create(std::string name)
+    {
+        std::string path = shmName(name);
+        shm_unlink(path.c_str());
+        int fd = shm_open(path.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0) {
+            logWarn("Shared segment %s: %s", path.c_str(), strerror(errno));
+            return NULL;
+        }
+        if (ftruncate(fd, sizeof(SharedSegment)) != 0) {
+            logWarn("Shared segment %s: %s", path.c_str(), strerror(errno));
+            close(fd);
+            return NULL;
+        }
+        void* memory = mmap(NULL, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) {
+            logWarn("Shared segment %s: %s", path.c_str(), strerror(errno));
+            return NULL;
+        }
+        SharedSegment* segment = new (memory) SharedSegment();
+        segment->version = VERSION;
+        // Last, the UI only attaching to a complete segment
+        std::atomic_thread_fence(std::memory_order_release);
+        segment->magic = MAGIC;
+        return segment;
+    }
+
+    // UI only, NULL if there is no host or it runs another version
+    static SharedSegment* attach(std::string name)
+    {
+        int fd = shm_open(shmName(name).c_str(), O_RDWR, 0);
+        if (fd < 0) {
+            return NULL;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < (off_t)sizeof(SharedSegment)) {
+            close(fd);
+            return NULL;
+        }
+        void* memory = mmap(NULL, sizeof(SharedSegment), PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+        if (memory == MAP_FAILED) {
+            return NULL;
+        }
+        SharedSegment* segment = (SharedSegment*)memory;
+        if (segment->magic != MAGIC || segment->version != VERSION) {
+            munmap(memory, sizeof(SharedSegment));
+            return NULL;
+        }
+        return segment;
+    }
+
+    static void detach(SharedSegment* segment)
+    {
+        munmap(segment, sizeof(SharedSegment));
+    }
+};
@@ -1,14 +1,27 @@
 #pragma once
 
+#include <algorithm>
 #include <atomic>
+#include <chrono>
 #include <condition_variable>
 #include <cstdint>
 #include <mutex>
 #include <set>
 #include <thread>
+#include <type_traits>
+#include <typeinfo>
 #include <vector>
 
+#include "Denormals.h"
 #include "def.h"
+#include "helpers/MpscQueue.h"
+#include "DspLoad.h"
+#include "MeterTap.h"
+#include "Realtime.h"
+#include "TrackFreeze.h"
+#include "VoicePool.h"
+#include "helpers/staticLibs.h"
+#include "helpers/trace.h"
 #include "log.h"
 #include "plugins/audio/audioPlugin.h"
 
@@ -22,16 +35,117 @@ public:
     std::condition_variable cv;
     // bool processing = false;
     std::atomic<bool> processing = false;
-    int16_t maxTracks;
+    // Set to false to stop the track thread, e.g. when the track is reloaded
+    std::atomic<bool> running = true;
+    bool initialized = false;
+    uint32_t frameStride;
+    uint32_t trackStride;
+    uint32_t blockSize;
+    // Silence detection, see AudioPlugin::tailFrames(): number of frames the input of each plugin has been silent,
+    // and whether the track lane was silent for the whole block, shared with the tracks depending on it.
+    std::vector<uint64_t> silentFrames;
+    bool* silentTracks;
+    std::atomic<bool>* holdChanges;
+    // Frames processed since the track started, used to apply the queued value changes in time
+    uint64_t frame = 0;
+    // Latency of the track output: the one of its plugins, on top of the one of its inputs, including the
+    // compensation delay. See AudioPlugin::latencyFrames().
+    uint32_t latency = 0;
+    // Delay line aligning the track output with the other inputs of the tracks depending on it
+    std::vector<float> compensation;
+    uint32_t compensationPos = 0;
+    // Plugins called on every control tick, see AudioPlugin::controlTick()
+    std::vector<AudioPlugin*> controlPlugins;
+    uint32_t controlFrames;
+    // Clock ticks of the block, to split it on each tick when a plugin follows the clock
+    ClockEvents* clockEvents;
+    bool followsClock = false;
+    // Stereo buffer: offset of the right lane, and what the track does before each plugin (UPMIX or DOWNMIX)
+    uint32_t rightOffset;
+    bool* stereoTracks;
+    enum ChannelStep : uint8_t {
+        KEEP,
+        UPMIX,
+        DOWNMIX,
+    };
+    std::vector<ChannelStep> channelSteps;
+    bool stereoOutput = false;
+    std::vector<float> compensationRight;
+    // When set, the voice groups of the plugins are rendered in parallel, see AudioPlugin::voiceGroups()
+    VoicePool* voicePool = NULL;
+    VoicePool::Batch voiceBatch;
+    std::vector<float> voiceBuffers;
+    // Touch the thread stack before processing, when memory is locked
+    bool prefaultStack = false;
+    // When set, the cost of each plugin is measured
+    DspLoad* dspLoad = NULL;
+    DspLoad::TrackLoad* load = NULL;
+    // When set, the output of the track is reduced for the meters of the UI, see MeterTap
+    MeterTap* meter = NULL;
+    // Renders the chain when the types of its plugins are the ones of a TrackChain linked in the binary
+    typedef bool (*ChainRenderer)(Track& track, float* buf, uint32_t frames);
+    ChainRenderer chainRenderer = NULL;
+    // Loop of the track output played in place of the chain, see TrackFreeze. The values and the state of the
+    // plugins as of the start of the capture, any change unfreezing the track.
+    TrackFreeze freeze;
+    std::atomic<bool> unfreezeRequest = false;
+    std::vector<ValueInterface*> frozenValues;
+    std::vector<float> frozenSnapshot;
+    std::vector<uint32_t> frozenVersions;
+    // Frozen output of the block the track is unfrozen on, faded into the chain output
+    std::vector<float> unfreezeBuffer;
+    // Clock of the last tick of the previous block
+    uint32_t lastClock = 0;
+    // Track processed by the current thread, the notes it plays itself being part of the frozen loop
+    static inline thread_local Track* renderingTrack = NULL;
 
     std::condition_variable& masterCv;
 
-    Track(uint8_t id, float* buffer, std::condition_variable& masterCv, int16_t maxTracks)
+    // Sidechain key tracks, see AudioPlugin::keyTracks(). With a thread of its own, the track waits for them to be
+    // done with the block, the block being the frame the host gave it before waking it up.
+    std::vector<Track*> keys;
+    uint64_t block = 0;
+    std::atomic<uint64_t> doneBlock = UINT64_MAX;
+
+    struct NoteEvent {
+        // When NULL, the note is sent to all the plugins of the track
+        AudioPlugin* plugin;
+        uint64_t frame;
+        uint8_t note;
+        float velocity;
+        bool on;
+    };
+    // Notes coming from other threads (e.g. midi input), applied at their frame within the block
+    MpscQueue<NoteEvent, 256> noteEvents;
+
+    struct LaunchEvent {
+        AudioPlugin* plugin;
+        // Launched on the first clock tick multiple of it, at the start of the next block when 0
+        uint32_t ticks;
+    };
+    // Launches queued by the plugins of the track, see AudioPluginHandlerInterface::queueLaunch(). Only one is
+    // pending at a time, the last one queued replacing it.
+    MpscQueue<LaunchEvent, 16> launchEvents;
+    LaunchEvent pendingLaunch = { NULL, 0 };
+    static const uint32_t NO_LAUNCH = UINT32_MAX;
+    // Name of the track spans, see Trace
+    char traceName[12];
+
+    Track(uint8_t id, float* buffer, std::condition_variable& masterCv, AudioPlugin::Props& props)
         : id(id)
         , buffer(buffer)
+        , frameStride(props.frameStride)
+        , trackStride(props.trackStride)
+        , blockSize(props.blockSize)
+        , controlFrames(props.controlFrames)
+        , clockEvents(props.clockEvents)
+        , rightOffset(props.rightOffset)
+        , stereoTracks(props.stereoTracks)
+        , silentTracks(props.silentTracks)
+        , holdChanges(props.holdChanges)
         , masterCv(masterCv)
-        , maxTracks(maxTracks)
     {
+        snprintf(traceName, sizeof(traceName), "track_%d", id);
     }
 
     std::set<uint8_t> getDependencies()
@@ -56,14 +170,92 @@ public:
         return false;
     }
 
-    void init(std::vector<Track*> tracks, bool isMaster)
+    std::set<uint8_t> getKeyTracks()
+    {
+        std::set<uint8_t> keyTracks;
+        for (AudioPlugin* plugin : plugins) {
+            std::set<uint8_t> pluginKeys = plugin->keyTracks();
+            keyTracks.insert(pluginKeys.begin(), pluginKeys.end());
+        }
+        return keyTracks;
+    }
+
+    // Tracks to process before this one: the ones it mixes and its sidechain keys
+    std::set<uint8_t> getInputs()
+    {
+        std::set<uint8_t> inputs = getDependencies();
+        std::set<uint8_t> keyTracks = getKeyTracks();
+        inputs.insert(keyTracks.begin(), keyTracks.end());
+        return inputs;
+    }
+
+    // When `startThread` is false, the track is processed by the caller (e.g. the track scheduler)
+    void init(std::vector<Track*> tracks, bool isMaster, bool startThread = true)
     {
+        initialized = true;
         pluginsSize = plugins.size();
+        // The plugins following one taking over the chain are rendered by it, e.g. on another unit: they keep their
+        // values, but are neither processed nor sent notes
+        for (int i = 0; i + 1 < pluginsSize; i++) {
+            std::vector<AudioPlugin*> following(plugins.begin() + i + 1, plugins.end());
+            if (plugins[i]->takeOverChain(following)) {
+                for (AudioPlugin* plugin : following) {
+                    plugin->ignoresNotes.store(true, std::memory_order_relaxed);
+                }
+                pluginsSize = i + 1;
+                break;
+            }
+        }
+        silentFrames = std::vector<uint64_t>(pluginsSize, 0);
+        controlPlugins.clear();
+        followsClock = false;
+        for (int i = 0; i < (int)plugins.size(); i++) {
+            AudioPlugin* plugin = plugins[i];
+            plugin->paramQueue.activate();
+            if (i >= pluginsSize) {
+                continue;
+            }
+            if (plugin->hasControlTick()) {
+                controlPlugins.push_back(plugin);
+            }
+            followsClock = followsClock || plugin->followsClock();
+        }
+        initChannels();
+        freeze.stop();
+        unfreezeBuffer.assign(blockSize * 2, 0.0f);
+        frozenValues.clear();
+        for (int i = 0; i < pluginsSize; i++) {
+            for (int v = 0; v < plugins[i]->getValueCount(); v++) {
+                frozenValues.push_back(plugins[i]->getValue(v));
+            }
+        }
+        frozenSnapshot.assign(frozenValues.size(), 0.0f);
+        frozenVersions.assign(pluginsSize, 0);
+        std::vector<const std::type_info*> types;
+        for (int i = 0; i < pluginsSize; i++) {
+            types.push_back(&typeid(*plugins[i]));
+        }
+        chainRenderer = (ChainRenderer)StaticLibs::get().find("chain", chainKey(types));
+        if (chainRenderer) {
+            logDebug("Track %d rendered by a fixed chain", id);
+        }
+        // A track keyed by a track running on the host thread runs after it, on the host thread as well
+        keys.clear();
+        bool keysThreaded = true;
+        for (uint8_t keyId : getKeyTracks()) {
+            for (Track* key : tracks) {
+                if (key->id == keyId && key != this) {
+                    keys.push_back(key);
+                    keysThreaded = keysThreaded && key != tracks.back() && !key->hasDependencies() && key->getKeyTracks().empty();
+                }
+            }
+        }
+
         // Only start a thread if track doesn't have any dependency on another tracks
         // All mixing and master track will be done in the main loop
         //
         // Master track should never start in a thread, else it would cause some glitching noise in audio output
-        if (!hasDependencies() && !isMaster) {
+        if (startThread && !hasDependencies() && !isMaster && keysThreaded) {
             logDebug(">>> Track %d has no dependency, start a thread", id);
             // There is no dependency, start a thread
             thread = std::thread([this] { loop(); });
@@ -76,31 +268,514 @@ public:
         // }
     }
 
+    // With a stereo buffer, the track becomes stereo at its first stereo plugin. A mono plugin after a stereo one
+    // would only process the left channel, so the track is downmixed before it (and a warning logged).
+    void initChannels()
+    {
+        channelSteps.assign(pluginsSize, KEEP);
+        stereoOutput = false;
+        if (rightOffset) {
+            for (int i = 0; i < pluginsSize; i++) {
+                if (plugins[i]->isStereo() && !stereoOutput) {
+                    channelSteps[i] = UPMIX;
+                    stereoOutput = true;
+                } else if (!plugins[i]->isStereo() && stereoOutput) {
+                    channelSteps[i] = DOWNMIX;
+                    stereoOutput = false;
+                    logWarn("Track %d: mono plugin %s after a stereo plugin, the track is downmixed to mono", id, plugins[i]->name.c_str());
+                }
+            }
+        }
+        if (stereoTracks) {
+            stereoTracks[id] = stereoOutput;
+        }
+    }
+
     void loop()
     {
+        Denormals::flushToZero();
+        Trace::get().thread();
+        if (prefaultStack) {
+            Realtime::prefaultStack();
+        }
         std::mutex mtx;
         std::unique_lock lock(mtx);
 
-        while (isRunning) {
-            cv.wait(lock, [&] { return processing == true; });
-            // process();
-            for (uint8_t i = 0; i < 128; i++) {
-                process(i);
+        // Wake up regularly, so the thread can be stopped even if a notification is missed
+        auto timeout = std::chrono::milliseconds(10);
+        while (isRunning && running) {
+            if (!cv.wait_for(lock, timeout, [&] { return processing == true || !running; }) || !running) {
+                continue;
             }
+            waitForKeys();
+            processBlock(blockSize);
+            doneBlock.store(block, std::memory_order_release);
             processing = false;
             masterCv.notify_one();
         }
     }
 
+    // The key tracks are short compared to a block, so their thread is waited for by yielding. Bounded like the
+    // wait of the host: a key track missing the block leaves its lane as it is.
+    void waitForKeys()
+    {
+        if (keys.empty()) {
+            return;
+        }
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::milliseconds(10);
+        for (Track* key : keys) {
+            while (key->doneBlock.load(std::memory_order_acquire) != block && running
+                && std::chrono::steady_clock::now() < deadline) {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    // Stop the track thread, if it has one
+    void stop()
+    {
+        running = false;
+        cv.notify_one();
+        if (thread.joinable()) {
+            thread.join();
+        }
+    }
+
     void process(uint8_t index)
     {
-        process(buffer + index * maxTracks);
+        process(buffer + index * frameStride);
+    }
+
+    // Run the whole chain once per block: each plugin processes all the frames
+    // before handing the buffer to the next one, instead of one virtual call per sample.
+    void processBlock(uint32_t frames)
+    {
+        TraceSpan span(traceName);
+        uint64_t nextFrame = frame + frames;
+        renderingTrack = this;
+        // Including the plugins taken over, their values being followed by the plugin rendering them
+        if (!holdChanges || !holdChanges->load(std::memory_order_acquire)) {
+            for (AudioPlugin* plugin : plugins) {
+                plugin->paramQueue.drain(frame, nextFrame);
+            }
+        }
+        bool unfreezing = false;
+        if (freeze.active() && (unfreezeRequest.exchange(false) || frozenChanged())) {
+            unfreezing = freeze.frozen();
+            if (!unfreezing) {
+                freeze.stop();
+            }
+        }
+        frozen = freeze.frozen() && !unfreezing;
+
+        // Split the block where notes are due, so they start at the right frame, and where a launch is due
+        uint32_t offset = 0;
+        bool silent = true;
+        uint32_t launchAt = launchOffset();
+        NoteEvent* event;
+        while ((event = noteEvents.front()) != NULL && event->frame < nextFrame) {
+            uint32_t eventOffset = event->frame > frame ? event->frame - frame : 0;
+            if (launchAt <= eventOffset) {
+                // Before the notes of the same frame, so they play what was launched
+                if (launchAt > offset) {
+                    silent = processFrames(offset, launchAt) && silent;
+                    offset = launchAt;
+                }
+                launch();
+                launchAt = NO_LAUNCH;
+            }
+            if (eventOffset > offset) {
+                silent = processFrames(offset, eventOffset) && silent;
+                offset = eventOffset;
+            }
+            applyNote(*event);
+            noteEvents.pop();
+        }
+        if (launchAt < frames) {
+            if (launchAt > offset) {
+                silent = processFrames(offset, launchAt) && silent;
+                offset = launchAt;
+            }
+            launch();
+        }
+        if (offset < frames) {
+            silent = processFrames(offset, frames) && silent;
+        }
+        if (freeze.active()) {
+            silent = processFreeze(frames, unfreezing);
+        }
+        if (clockEvents && clockEvents->count > 0) {
+            lastClock = clockEvents->ticks[clockEvents->count - 1].clock;
+        }
+        renderingTrack = NULL;
+        frame = nextFrame;
+        for (int i = 0; i < pluginsSize; i++) {
+            plugins[i]->publishState();
+        }
+        if (compensation.size() > 0) {
+            compensate(frames);
+            silent = isSilent(buffer, frames);
+        }
+        if (silentTracks) {
+            silentTracks[id] = silent;
+        }
+        if (meter) {
+            float* lane = buffer + id * trackStride;
+            meter->process(lane, stereoOutput ? lane + rightOffset : NULL, frameStride, frames, silent);
+        }
+
+        if (load) {
+            for (int i = 0; i < pluginsSize; i++) {
+                load->total.blockNs += load->plugins[i].blockNs;
+                load->plugins[i].endBlock(dspLoad->deadlineNs);
+            }
+            load->total.endBlock(dspLoad->deadlineNs);
+        }
+    }
+
+    // Return true if the track lane is silent at the end of the chain.
+    // With control rate plugins, the frames are split on the control ticks, counted from the track start.
+    // With plugins following the clock, the frames are also split on the clock ticks.
+    bool processFrames(uint32_t start, uint32_t end)
+    {
+        bool splitClock = followsClock && clockEvents && clockEvents->count > 0;
+        if (controlPlugins.empty() && !splitClock) {
+            return processChain(start, end);
+        }
+        bool silent = true;
+        while (start < end) {
+            uint32_t next = end;
+            if (!controlPlugins.empty()) {
+                uint32_t phase = (frame + start) % controlFrames;
+                if (phase == 0) {
+                    for (AudioPlugin* plugin : controlPlugins) {
+                        plugin->controlTick(start);
+                    }
+                }
+                next = std::min(next, start + controlFrames - phase);
+            }
+            if (splitClock) {
+                next = clockEvents->next(start, next);
+            }
+            silent = processChain(start, next) && silent;
+            start = next;
+        }
+        return silent;
+    }
+
+    bool processChain(uint32_t start, uint32_t end)
+    {
+        float* buf = buffer + start * frameStride;
+        uint32_t frames = end - start;
+        // The plugins are measured one by one, through the generic loop
+        if (chainRenderer && !load && !frozen) {
+            return chainRenderer(*this, buf, frames);
+        }
+        bool silent = isSilent(buf, frames);
+        uint64_t t = load ? DspLoad::now() : 0;
+        // The counters of the thread running the track, read before and after each plugin
+        PerfCounters* perf = load && dspLoad->countPerf ? PerfCounters::forThread() : NULL;
+        uint64_t counters[2][PerfCounters::COUNTER_COUNT];
+        uint8_t current = 0;
+        if (perf && !perf->read(counters[current])) {
+            perf = NULL;
+        }
+        for (int i = 0; i < pluginsSize; i++) {
+            // Frozen, the plugins following the clock still run, e.g. for the sequencer to send its loops
+            if (frozen && !plugins[i]->followsClock()) {
+                continue;
+            }
+            silent = processPlugin<AudioPlugin>(i, buf, frames, silent);
+            if (load && dspLoad->countDenormals) {
+                load->denormals[i] += Denormals::count(buf + id * trackStride, frameStride, frames);
+            }
+            if (perf && perf->read(counters[current ^ 1])) {
+                load->counters[i].add(counters[current], counters[current ^ 1], frames);
+                current ^= 1;
+            }
+            if (load) {
+                uint64_t next = DspLoad::now();
+                load->plugins[i].blockNs += next - t;
+                t = next;
+            }
+        }
+        return silent;
+    }
+
+    // Process the plugin `i` of the chain, `silent` telling if its input is silent, and return if its output is.
+    // When `P` is the type of the plugin, see TrackChain, the calls are resolved at compile time.
+    template <typename P>
+    bool processPlugin(int i, float* buf, uint32_t frames, bool silent)
+    {
+        constexpr bool known = !std::is_same<P, AudioPlugin>::value;
+        P* plugin = static_cast<P*>(plugins[i]);
+        TraceSpan span(plugin->name.c_str());
+        known ? plugin->P::smoothBlock(frames) : plugin->smoothBlock(frames);
+        if (channelSteps[i] != KEEP) {
+            convertChannels(buf, frames, channelSteps[i]);
+        }
+        if (silent) {
+            // Input is silent and the plugin has nothing left to play: the lane stays silent
+            if (plugin->isIdle(silentFrames[i])) {
+                silentFrames[i] += frames;
+                return true;
+            }
+            silentFrames[i] += frames;
+        } else {
+            silentFrames[i] = 0;
+        }
+        uint8_t groups = voicePool ? (known ? plugin->P::voiceGroups() : plugin->voiceGroups()) : 1;
+        if (groups > 1) {
+            sampleVoiceGroups(plugin, groups, buf, frames);
+        } else {
+            known ? plugin->P::sampleBlock(buf, frames) : plugin->sampleBlock(buf, frames);
+        }
+        return isSilent(buf, frames);
+    }
+
+    bool frozen = false;
+
+    // Capture the block output or play the frozen loop, return if the track lane is silent. On the block the track is
+    // unfrozen, the loop is faded out into the output of the chain.
+    bool processFreeze(uint32_t frames, bool unfreezing)
+    {
+        float* lane = buffer + id * trackStride;
+        float* right = stereoOutput ? lane + rightOffset : NULL;
+        if (freeze.state == TrackFreeze::CAPTURING) {
+            freeze.capture(lane, right, frameStride, frames, clockEvents);
+        } else if (unfreezing) {
+            freeze.play(unfreezeBuffer.data(), unfreezeBuffer.data() + blockSize, 1, frames, clockEvents);
+            freeze.stop();
+            for (uint32_t f = 0; f < frames; f++) {
+                float fade = (float)f / frames;
+                lane[f * frameStride] = fade * lane[f * frameStride] + (1.0f - fade) * unfreezeBuffer[f];
+                if (right) {
+                    right[f * frameStride] = fade * right[f * frameStride] + (1.0f - fade) * unfreezeBuffer[blockSize + f];
+                }
+            }
+        } else if (freeze.frozen() && !freeze.play(lane, right, frameStride, frames, clockEvents)) {
+            // The tempo changed
+            unfreezeRequest = true;
+        }
+        return isSilent(buffer, frames);
+    }
+
+    // Whether a value or the state of a plugin changed since the capture started
+    bool frozenChanged()
+    {
+        if (freeze.state == TrackFreeze::ARMED) {
+            return false;
+        }
+        for (size_t i = 0; i < frozenValues.size(); i++) {
+            if (frozenValues[i]->get() != frozenSnapshot[i]) {
+                return true;
+            }
+        }
+        for (int i = 0; i < pluginsSize; i++) {
+            if (plugins[i]->stateVersion() != frozenVersions[i]) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Called between two blocks when the sequencer of the track loops, see TrackFreeze::loop()
+    void onLoop()
+    {
+        if (freeze.loop(lastClock)) {
+            for (size_t i = 0; i < frozenValues.size(); i++) {
+                frozenSnapshot[i] = frozenValues[i]->get();
+            }
+            for (int i = 0; i < pluginsSize; i++) {
+                frozenVersions[i] = plugins[i]->stateVersion();
+            }
+        }
+    }
+
+    // Notes played by the chain itself (e.g. its sequencer) are part of the frozen loop, any other unfreezes it
+    void noteReceived()
+    {
+        if (renderingTrack != this && freeze.active()) {
+            unfreezeRequest = true;
+        }
+    }
+
+    // Name of a chain of plugins in the StaticLibs registry, from the types of its plugins
+    static std::string chainKey(const std::vector<const std::type_info*>& types)
+    {
+        std::string key;
+        for (const std::type_info* type : types) {
+            key += type->name();
+            key += ',';
+        }
+        return key;
+    }
+
+    void setVoicePool(VoicePool* pool)
+    {
+        voiceBuffers.assign(pool ? VoicePool::MAX_GROUPS * blockSize : 0, 0.0f);
+        voicePool = pool;
+    }
+
+    void sampleVoiceGroups(AudioPlugin* plugin, uint8_t groups, float* buf, uint32_t frames)
+    {
+        if (groups > VoicePool::MAX_GROUPS) {
+            groups = VoicePool::MAX_GROUPS;
+        }
+        voiceBatch.plugin = plugin;
+        voiceBatch.groups = groups;
+        voiceBatch.frames = frames;
+        for (uint8_t g = 0; g < groups; g++) {
+            voiceBatch.outputs[g] = voiceBuffers.data() + g * blockSize;
+        }
+        voicePool->run(id, voiceBatch);
+
+        float* lane = buf + id * trackStride;
+        for (uint32_t f = 0; f < frames; f++) {
+            float sum = 0.0f;
+            for (uint8_t g = 0; g < groups; g++) {
+                sum += voiceBatch.outputs[g][f];
+            }
+            lane[f * frameStride] = sum;
+        }
+    }
+
+    void convertChannels(float* buf, uint32_t frames, ChannelStep step)
+    {
+        float* left = buf + id * trackStride;
+        float* right = left + rightOffset;
+        for (uint32_t f = 0; f < frames; f++) {
+            if (step == UPMIX) {
+                right[f * frameStride] = left[f * frameStride];
+            } else {
+                left[f * frameStride] = (left[f * frameStride] + right[f * frameStride]) * 0.5f;
+            }
+        }
+    }
+
+    uint32_t pluginsLatency()
+    {
+        uint32_t frames = 0;
+        for (AudioPlugin* plugin : plugins) {
+            frames += plugin->latencyFrames();
+        }
+        return frames;
+    }
+
+    void setCompensation(uint32_t frames)
+    {
+        compensation.assign(frames, 0.0f);
+        compensationRight.assign(stereoOutput ? frames : 0, 0.0f);
+        compensationPos = 0;
+    }
+
+    void compensate(uint32_t frames)
+    {
+        float* lane = buffer + id * trackStride;
+        uint32_t size = compensation.size();
+        for (uint32_t f = 0; f < frames; f++) {
+            float in = lane[f * frameStride];
+            lane[f * frameStride] = compensation[compensationPos];
+            compensation[compensationPos] = in;
+            if (stereoOutput) {
+                in = lane[f * frameStride + rightOffset];
+                lane[f * frameStride + rightOffset] = compensationRight[compensationPos];
+                compensationRight[compensationPos] = in;
+            }
+            compensationPos = compensationPos + 1 < size ? compensationPos + 1 : 0;
+        }
+    }
+
+    // Only exact silence is considered: plugins skipped on silence must output 0 for a 0 input
+    bool isSilent(float* buf, uint32_t frames)
+    {
+        float* lane = buf + id * trackStride;
+        for (uint32_t f = 0; f < frames; f++) {
+            if (lane[f * frameStride] != 0.0f || (stereoOutput && lane[f * frameStride + rightOffset] != 0.0f)) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Start measuring the cost of each plugin of the track
+    void setDspLoad(DspLoad* dspLoad, DspLoad::TrackLoad* trackLoad)
+    {
+        this->dspLoad = dspLoad;
+        trackLoad->id = id;
+        for (AudioPlugin* plugin : plugins) {
+            trackLoad->pluginNames.push_back(plugin->name);
+        }
+        trackLoad->plugins = std::vector<DspLoad::Meter>(plugins.size());
+        trackLoad->denormals = std::vector<uint32_t>(plugins.size(), 0);
+        trackLoad->counters = std::vector<PerfCounters::Counts>(plugins.size());
+        load = trackLoad;
+    }
+
+    // Queue a note to be played by the audio thread at the given frame (0 for as soon as possible).
+    // Return false if the queue is full.
+    bool queueNote(bool on, uint8_t note, float velocity, AudioPlugin* plugin = NULL, uint64_t at = 0)
+    {
+        noteReceived();
+        return noteEvents.push({ plugin, at, note, velocity, on });
+    }
+
+    // Queue a launch, see AudioPluginHandlerInterface::queueLaunch(). Return false if the queue is full.
+    bool queueLaunch(AudioPlugin* plugin, uint32_t ticks)
+    {
+        return launchEvents.push({ plugin, ticks });
+    }
+
+    // Offset within the block of the launch pending, from the clock ticks of the block, NO_LAUNCH if it is not due
+    uint32_t launchOffset()
+    {
+        LaunchEvent* event;
+        while ((event = launchEvents.front()) != NULL) {
+            pendingLaunch = *event;
+            launchEvents.pop();
+        }
+        if (!pendingLaunch.plugin) {
+            return NO_LAUNCH;
+        }
+        if (pendingLaunch.ticks == 0) {
+            return 0;
+        }
+        if (clockEvents) {
+            for (uint32_t i = 0; i < clockEvents->count; i++) {
+                if (clockEvents->ticks[i].clock % pendingLaunch.ticks == 0) {
+                    return clockEvents->ticks[i].offset;
+                }
+            }
+        }
+        return NO_LAUNCH;
+    }
+
+    void launch()
+    {
+        AudioPlugin* plugin = pendingLaunch.plugin;
+        pendingLaunch.plugin = NULL;
+        plugin->launch();
+    }
+
+    void applyNote(NoteEvent& event)
+    {
+        if (event.plugin) {
+            if (event.on) {
+                event.plugin->noteOn(event.note, event.velocity, NULL);
+            } else {
+                event.plugin->noteOff(event.note, event.velocity, NULL);
+            }
+        } else if (event.on) {
+            noteOn(event.note, event.velocity);
+        } else {
+            noteOff(event.note, event.velocity);
+        }
     }
     // void process(uint8_t index)
     // {
     //     for (int i = 0; i < pluginsSize; i++) {
     //         AudioPlugin* plugin = plugins[i];
-    //         plugin->sample(buffer + index * maxTracks);
+    //         plugin->sample(buffer + index * frameStride);
     //     }
     // }
 
@@ -130,15 +805,21 @@ public:
 
     void noteOn(uint8_t note, float velocity)
     {
+        noteReceived();
         for (AudioPlugin* plugin : plugins) {
-            plugin->noteOn(note, velocity, NULL);
+            if (!plugin->ignoresNotes.load(std::memory_order_relaxed)) {
+                plugin->noteOn(note, velocity, NULL);
+            }
         }
     }
 
     void noteOff(uint8_t note, float velocity)
     {
+        noteReceived();
         for (AudioPlugin* plugin : plugins) {
-            plugin->noteOff(note, velocity, NULL);
+            if (!plugin->ignoresNotes.load(std::memory_order_relaxed)) {
+                plugin->noteOff(note, velocity, NULL);
+            }
         }
     }
 };
@@ -0,0 +1,28 @@
+#pragma once
+
+#include <typeinfo>
+
+#include "Track.h"
+#include "helpers/staticLibs.h"
+
+// Fixed chain of plugins rendered without virtual calls, for the static build (see `make static` and
+// plugins/audio/staticChains.cpp). A chain is declared once for the binary, e.g.
+// `TrackChain<SynthDrum23, EffectFilterMultiMode, EffectVolumeDrive, EffectGainVolume> drumChain;`, and a track whose
+// plugins are exactly of these types, in this order, renders each block with `render()`: the calls to the plugins are
+// resolved at compile time, so the compiler can inline the whole block instead of going through the vtable.
+template <typename... Plugins>
+class TrackChain {
+public:
+    TrackChain()
+    {
+        StaticLibs::get().add("chain", Track::chainKey({ &typeid(Plugins)... }), (void*)&render);
+    }
+
+    static bool render(Track& track, float* buf, uint32_t frames)
+    {
+        bool silent = track.isSilent(buf, frames);
+        int i = 0;
+        ((silent = track.processPlugin<Plugins>(i++, buf, frames, silent)), ...);
+        return silent;
+    }
+};
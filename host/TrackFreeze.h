@@ -0,0 +1,216 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+#include <mutex>
+#include <vector>
+
+#include "plugins/audio/utils/ClockEvents.h"
+#include "plugins/audio/utils/MemoryBudget.h"
+
+// Frozen track: one clip loop of the track output, captured while it plays, then played back in place of the chain,
+// locked to the clock ticks, until something changes.
+//
+// The capture starts on a loop of the track (SEQ_LOOP) and lasts for the number of clock ticks between two loops.
+// The position of each tick within the capture is kept, so the playback follows the clock: on each tick, it jumps to
+// the frame of the same tick in the loop. A tick far from where the playback is means the tempo changed, and the
+// track is unfrozen.
+//
+// `arm()` allocates the capture, from a background thread, while the track is not frozen, and the capture is kept for
+// the next freeze until the memory budget needs it back, see `release()`. Everything else is called by the audio
+// thread of the track.
+class TrackFreeze {
+public:
+    enum State : uint8_t {
+        OFF,
+        // Waiting for the first loop of the track
+        ARMED,
+        // Capturing, the number of ticks of a loop not being known before the next loop
+        CAPTURING,
+        FROZEN,
+    };
+    std::atomic<State> state = OFF;
+
+protected:
+    // Guards the allocation of the capture, against `release()` from the memory budget
+    std::mutex mtx;
+    std::atomic<size_t> memory = 0;
+    int budgetId = -1;
+    uint8_t channels = 1;
+    std::vector<float> audio;
+    uint32_t capacity = 0;
+    uint32_t length = 0;
+    // Frame of each tick of the loop in the capture, from `firstClock`
+    std::vector<uint32_t> tickFrames;
+    uint32_t tickCount = 0;
+    uint32_t loopTicks = 0;
+    uint32_t firstClock = 0;
+    bool hasFirstTick = false;
+    uint32_t loopClock = 0;
+    // Frame the loop ends in the capture, the same as the frame of `firstClock`
+    uint32_t endFrame = 0;
+    // Playback frame, set on each tick and advanced by one each frame between ticks
+    uint32_t position = 0;
+    // Ticks fall on whole frames, so a steady tempo stays within a frame or two of the capture
+    static constexpr uint32_t MAX_DRIFT = 2;
+
+    // The loop being the capture from the first tick to `endFrame`
+    void wrap()
+    {
+        if (position >= endFrame) {
+            position = tickFrames[0] + (position - endFrame);
+        }
+    }
+
+public:
+    TrackFreeze()
+    {
+        budgetId = MemoryBudget::get().add("frozen tracks", MemoryBudget::LOW, [this] { return memory.load(); }, [this](size_t) { return release(); });
+    }
+
+    ~TrackFreeze()
+    {
+        MemoryBudget::get().remove(budgetId);
+    }
+
+    // Reserve `frames` of capture and wait for the next loop, return false if the track is already frozen or capturing
+    bool arm(uint32_t frames, uint8_t channelCount)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        State current = state.load();
+        if (current != OFF) {
+            return false;
+        }
+        channels = channelCount;
+        if (audio.size() < frames * channels) {
+            audio.assign(frames * channels, 0.0f);
+        }
+        capacity = frames;
+        // A tick every 64 frames at least, e.g. 24 PPQN at 1800 BPM at 48kHz
+        if (tickFrames.size() < frames / 64) {
+            tickFrames.assign(frames / 64, 0);
+        }
+        memory = audio.capacity() * sizeof(float) + tickFrames.capacity() * sizeof(uint32_t);
+        state = ARMED;
+        MemoryBudget::get().changed();
+        return true;
+    }
+
+    // Free the capture while the track is not frozen, return the bytes freed. The audio thread only leaves OFF
+    // through `arm()`, so it can't start using the capture meanwhile.
+    size_t release()
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        if (state.load() != OFF) {
+            return 0;
+        }
+        std::vector<float>().swap(audio);
+        std::vector<uint32_t>().swap(tickFrames);
+        capacity = 0;
+        return memory.exchange(0);
+    }
+
+    void stop()
+    {
+        state = OFF;
+    }
+
+    bool frozen()
+    {
+        return state.load(std::memory_order_relaxed) == FROZEN;
+    }
+
+    bool active()
+    {
+        return state.load(std::memory_order_relaxed) != OFF;
+    }
+
+    // A loop of the track just ended, `lastClock` being the clock of the last tick of the block it ended in.
+    // Return true when the capture starts.
+    bool loop(uint32_t lastClock)
+    {
+        State current = state.load(std::memory_order_relaxed);
+        if (current == ARMED) {
+            loopClock = lastClock;
+            loopTicks = 0;
+            length = 0;
+            tickCount = 0;
+            endFrame = 0;
+            hasFirstTick = false;
+            state = CAPTURING;
+            return true;
+        }
+        if (current == CAPTURING && loopTicks == 0) {
+            loopTicks = lastClock - loopClock;
+            if (loopTicks == 0 || loopTicks > tickFrames.size()) {
+                state = OFF;
+            }
+        }
+        return false;
+    }
+
+    // Append the block output, return false if the capture doesn't fit and was dropped. Once the capture covers a
+    // whole loop, the track is frozen from the next block.
+    bool capture(float* lane, float* right, uint32_t stride, uint32_t frames, ClockEvents* clock)
+    {
+        if (length + frames > capacity) {
+            state = OFF;
+            return false;
+        }
+        for (uint32_t i = 0; clock && i < clock->count; i++) {
+            ClockEvents::Tick& tick = clock->ticks[i];
+            if (!hasFirstTick) {
+                hasFirstTick = true;
+                firstClock = tick.clock;
+            }
+            uint32_t index = tick.clock - firstClock;
+            if (loopTicks && index == loopTicks) {
+                endFrame = length + tick.offset;
+            } else if (index < tickFrames.size() && (!loopTicks || index < loopTicks)) {
+                tickFrames[index] = length + tick.offset;
+                tickCount = index + 1;
+            }
+        }
+        float* out = audio.data() + length * channels;
+        for (uint32_t f = 0; f < frames; f++) {
+            out[f * channels] = lane[f * stride];
+            if (channels == 2) {
+                out[f * channels + 1] = right[f * stride];
+            }
+        }
+        length += frames;
+        if (loopTicks && endFrame && tickCount == loopTicks) {
+            position = tickFrames[0] + (length - endFrame);
+            wrap();
+            state = FROZEN;
+        }
+        return true;
+    }
+
+    // Write the loop in the track lane, return false if the clock drifted away from it
+    bool play(float* lane, float* right, uint32_t stride, uint32_t frames, ClockEvents* clock)
+    {
+        bool synced = true;
+        uint32_t next = 0;
+        for (uint32_t f = 0; f < frames; f++) {
+            while (clock && next < clock->count && clock->ticks[next].offset == f) {
+                uint32_t expected = tickFrames[(clock->ticks[next].clock - firstClock) % loopTicks];
+                uint32_t drift = expected > position ? expected - position : position - expected;
+                if (drift > MAX_DRIFT) {
+                    synced = false;
+                }
+                position = expected;
+                next++;
+            }
+            const float* in = audio.data() + position * channels;
+            lane[f * stride] = in[0];
+            if (right && right != lane) {
+                right[f * stride] = channels == 2 ? in[1] : in[0];
+            }
+            position++;
+            wrap();
+        }
+        return synced;
+    }
+};
@@ -0,0 +1,255 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Denormals.h"
+#include "Realtime.h"
+#include "Track.h"
+#include "def.h"
+#include "log.h"
+
+// Run the track graph on a fixed pool of workers instead of one thread per track.
+//
+// Each track is a node of the graph, with an atomic counter of the inputs it is still waiting for.
+// When a node is done, it decrements the counter of the tracks depending on it. The worker keeps the
+// first track becoming ready for itself and pushes the others in a lock-free ready ring, where any idle
+// worker can pick them up. The host thread takes part in the work, so `run()` only returns once every
+// node of the block has been processed.
+//
+// Workers spin a little while waiting for the next node, then park on a condition variable: at 128
+// frames per block, most of the time a node is available before the spin is over.
+//
+// Several graphs can share the pool, e.g. the projects of a ProjectGroup, their nodes running in the same block.
+class TrackScheduler {
+public:
+    // Nodes of all the graphs
+    static const uint16_t MAX_NODES = 1024;
+
+protected:
+    struct Node {
+        Track* track;
+        uint8_t dependencyCount = 0;
+        std::atomic<uint8_t> pending = 0;
+        std::vector<uint16_t> dependents;
+    };
+
+    std::vector<Node> nodes;
+    std::vector<uint16_t> roots;
+
+    // The ring slots are tagged with the position they were pushed at, so a slot can only be popped once
+    // it has been fully written. Positions keep increasing from one block to the next, so there is no need
+    // to reset the ring between blocks.
+    std::vector<std::atomic<uint64_t>> ring;
+    std::atomic<uint64_t> head = 0;
+    std::atomic<uint64_t> tail = 0;
+    std::atomic<uint16_t> remaining = 0;
+
+    std::vector<std::thread> workers;
+    std::mutex parkMtx;
+    std::condition_variable parkCv;
+    std::atomic<uint8_t> parked = 0;
+    std::atomic<bool> stopped = false;
+
+    static const uint32_t SPIN_COUNT = 2000;
+
+    uint32_t frames;
+
+    void push(uint16_t index)
+    {
+        uint64_t pos = tail.fetch_add(1);
+        ring[pos % ring.size()].store((pos << 16) | index, std::memory_order_release);
+        if (parked.load() > 0) {
+            std::unique_lock<std::mutex> lock(parkMtx);
+            parkCv.notify_one();
+        }
+    }
+
+    bool pop(uint16_t& index)
+    {
+        uint64_t pos = head.load(std::memory_order_acquire);
+        while (true) {
+            uint64_t slot = ring[pos % ring.size()].load(std::memory_order_acquire);
+            if ((slot >> 16) != pos) {
+                return false;
+            }
+            if (head.compare_exchange_weak(pos, pos + 1)) {
+                index = slot & 0xFFFF;
+                return true;
+            }
+        }
+    }
+
+    bool hasWork()
+    {
+        return head.load() < tail.load();
+    }
+
+    // Process the node and follow the chain of tracks it makes ready
+    void runNode(uint16_t index)
+    {
+        while (true) {
+            Node& node = nodes[index];
+            node.track->processBlock(frames);
+
+            int next = -1;
+            for (uint16_t dependent : node.dependents) {
+                if (nodes[dependent].pending.fetch_sub(1, std::memory_order_acq_rel) == 1) {
+                    if (next == -1) {
+                        next = dependent;
+                    } else {
+                        push(dependent);
+                    }
+                }
+            }
+            remaining.fetch_sub(1, std::memory_order_acq_rel);
+            if (next == -1) {
+                return;
+            }
+            index = next;
+        }
+    }
+
+    void workerLoop(bool prefaultStack)
+    {
+        Denormals::flushToZero();
+        Trace::get().thread();
+        if (prefaultStack) {
+            Realtime::prefaultStack();
+        }
+        uint32_t spin = 0;
+        uint16_t index;
+        while (!stopped) {
+            if (pop(index)) {
+                runNode(index);
+                spin = 0;
+            } else if (++spin < SPIN_COUNT) {
+                std::this_thread::yield();
+            } else {
+                std::unique_lock<std::mutex> lock(parkMtx);
+                parked++;
+                parkCv.wait(lock, [&] { return stopped || hasWork(); });
+                parked--;
+                spin = 0;
+            }
+        }
+    }
+
+public:
+    // The ring is sized once for all the nodes, as the idle workers keep reading it while the graphs change
+    TrackScheduler(uint32_t frames)
+        : ring(MAX_NODES)
+        , frames(frames)
+    {
+        for (std::atomic<uint64_t>& slot : ring) {
+            slot = 0;
+        }
+        // Position 0 must not look like a written slot
+        ring[0] = UINT64_MAX;
+    }
+
+    ~TrackScheduler()
+    {
+        stop();
+    }
+
+    // Replace the graphs run by `run()`, each one being the tracks of a project sorted by dependencies, the track ids
+    // only being resolved within their graph. Dependencies on tracks that are not part of the graph are ignored.
+    // Only between two blocks.
+    void setGraphs(const std::vector<std::vector<Track*>>& graphs)
+    {
+        size_t count = 0;
+        for (const std::vector<Track*>& tracks : graphs) {
+            count += tracks.size();
+        }
+        if (count > MAX_NODES) {
+            logError("Track scheduler: %zu tracks, only %d can be scheduled", count, MAX_NODES);
+            count = 0;
+        }
+        nodes = std::vector<Node>(count);
+        roots.clear();
+        uint16_t first = 0;
+        for (const std::vector<Track*>& tracks : graphs) {
+            if (first + tracks.size() > count) {
+                break;
+            }
+            int16_t indexes[TOTAL_TRACKS];
+            for (int i = 0; i < TOTAL_TRACKS; i++) {
+                indexes[i] = -1;
+            }
+            for (uint16_t i = 0; i < tracks.size(); i++) {
+                nodes[first + i].track = tracks[i];
+                indexes[tracks[i]->id] = first + i;
+            }
+            for (uint16_t i = first; i < first + tracks.size(); i++) {
+                for (uint8_t dependency : nodes[i].track->getInputs()) {
+                    if (dependency < TOTAL_TRACKS && indexes[dependency] != -1) {
+                        nodes[indexes[dependency]].dependents.push_back(i);
+                        nodes[i].dependencyCount++;
+                    }
+                }
+                if (nodes[i].dependencyCount == 0) {
+                    roots.push_back(i);
+                }
+            }
+            first += tracks.size();
+        }
+        logDebug("Track scheduler: %d graphs, %d tracks, %d roots", (int)graphs.size(), (int)nodes.size(), (int)roots.size());
+    }
+
+    void startWorkers(uint8_t workerCount, bool prefaultStack = false)
+    {
+        for (uint8_t i = 0; i < workerCount; i++) {
+            workers.push_back(std::thread([this, prefaultStack] { workerLoop(prefaultStack); }));
+            pthread_setname_np(workers.back().native_handle(), ("worker_" + std::to_string(i)).c_str());
+        }
+        logDebug("Track scheduler: %d workers", workerCount);
+    }
+
+    // Process all the tracks for one block, the calling thread taking part in the work
+    void run()
+    {
+        if (nodes.size() == 0) {
+            return;
+        }
+        for (Node& node : nodes) {
+            node.pending.store(node.dependencyCount, std::memory_order_relaxed);
+        }
+        remaining.store(nodes.size(), std::memory_order_release);
+        for (uint16_t root : roots) {
+            push(root);
+        }
+
+        uint16_t index;
+        while (remaining.load(std::memory_order_acquire) > 0) {
+            if (pop(index)) {
+                runNode(index);
+            }
+        }
+    }
+
+    std::vector<std::thread>& getWorkers()
+    {
+        return workers;
+    }
+
+    void stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(parkMtx);
+            stopped = true;
+            parkCv.notify_all();
+        }
+        for (std::thread& worker : workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        workers.clear();
+    }
+};
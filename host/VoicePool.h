@@ -0,0 +1,149 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "Denormals.h"
+#include "Realtime.h"
+#include "def.h"
+#include "log.h"
+#include "plugins/audio/audioPlugin.h"
+
+// Workers rendering the voice groups of heavily polyphonic plugins in parallel, see AudioPlugin::voiceGroups().
+//
+// A track submits a batch with one job per voice group and takes part in the work: it only waits for the
+// groups already started by a worker. Several tracks can submit at the same time, each batch having its own
+// slot. Like the track scheduler, workers spin a little before parking on a condition variable.
+class VoicePool {
+public:
+    static const uint8_t MAX_GROUPS = 8;
+
+    struct Batch {
+        AudioPlugin* plugin;
+        uint8_t groups;
+        float* outputs[MAX_GROUPS];
+        uint32_t frames;
+        std::atomic<uint8_t> next = 0;
+        std::atomic<uint8_t> done = 0;
+    };
+
+protected:
+    std::atomic<Batch*> slots[TOTAL_TRACKS] = {};
+    std::vector<std::thread> workers;
+    std::mutex parkMtx;
+    std::condition_variable parkCv;
+    std::atomic<uint8_t> parked = 0;
+    std::atomic<uint32_t> pending = 0;
+    std::atomic<bool> stopped = false;
+
+    static const uint32_t SPIN_COUNT = 2000;
+
+    // Run one job of the batch, return false if all its jobs are taken
+    static bool runJob(Batch* batch)
+    {
+        uint8_t group = batch->next.fetch_add(1, std::memory_order_acq_rel);
+        if (group >= batch->groups) {
+            return false;
+        }
+        batch->plugin->sampleVoiceGroup(group, batch->groups, batch->outputs[group], batch->frames);
+        batch->done.fetch_add(1, std::memory_order_acq_rel);
+        return true;
+    }
+
+    bool runAny()
+    {
+        for (std::atomic<Batch*>& slot : slots) {
+            Batch* batch = slot.load(std::memory_order_acquire);
+            if (batch && runJob(batch)) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop(bool prefaultStack)
+    {
+        Denormals::flushToZero();
+        if (prefaultStack) {
+            Realtime::prefaultStack();
+        }
+        uint32_t spin = 0;
+        while (!stopped) {
+            if (pending.load(std::memory_order_acquire) > 0 && runAny()) {
+                spin = 0;
+            } else if (++spin < SPIN_COUNT) {
+                std::this_thread::yield();
+            } else {
+                std::unique_lock<std::mutex> lock(parkMtx);
+                parked++;
+                parkCv.wait(lock, [&] { return stopped || pending.load() > 0; });
+                parked--;
+                spin = 0;
+            }
+        }
+    }
+
+public:
+    ~VoicePool()
+    {
+        stop();
+    }
+
+    void init(uint8_t workerCount, bool prefaultStack = false)
+    {
+        for (uint8_t i = 0; i < workerCount; i++) {
+            workers.push_back(std::thread([this, prefaultStack] { workerLoop(prefaultStack); }));
+            pthread_setname_np(workers.back().native_handle(), ("voices_" + std::to_string(i)).c_str());
+        }
+        logDebug("Voice pool: %d workers", workerCount);
+    }
+
+    std::vector<std::thread>& getWorkers()
+    {
+        return workers;
+    }
+
+    uint8_t size()
+    {
+        return workers.size();
+    }
+
+    // Render all the groups of the batch, returning once they are all done. `slot` is the track id.
+    void run(uint8_t slot, Batch& batch)
+    {
+        batch.next.store(0, std::memory_order_release);
+        batch.done.store(0, std::memory_order_release);
+        slots[slot].store(&batch, std::memory_order_release);
+        pending.fetch_add(1, std::memory_order_acq_rel);
+        if (parked.load() > 0) {
+            std::unique_lock<std::mutex> lock(parkMtx);
+            parkCv.notify_all();
+        }
+        while (runJob(&batch)) {
+        }
+        pending.fetch_sub(1, std::memory_order_acq_rel);
+        slots[slot].store(NULL, std::memory_order_release);
+        while (batch.done.load(std::memory_order_acquire) < batch.groups) {
+        }
+    }
+
+    void stop()
+    {
+        {
+            std::unique_lock<std::mutex> lock(parkMtx);
+            stopped = true;
+            parkCv.notify_all();
+        }
+        for (std::thread& worker : workers) {
+            if (worker.joinable()) {
+                worker.join();
+            }
+        }
+        workers.clear();
+    }
+};
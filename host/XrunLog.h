@@ -0,0 +1,154 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <fstream>
+#include <string>
+#include <thread>
+#include <time.h>
+
+#include "constants.h"
+
+// Dropouts of the audio output (xruns, partial writes) and blocks missing their deadline, kept in a fixed size
+// lock-free ring, to correlate them with what the device was doing.
+//
+// Each entry has the time, the processing time of each track during the last measured block (when the DSP load
+// is measured) and the CPU frequency and temperature. Reading sysfs is too slow for the audio threads, so the
+// device state is sampled by a monitor thread, and only copied in the entries.
+// Any thread can add an entry. Readers copy an entry and check its sequence to skip the ones being rewritten.
+class XrunLog {
+public:
+    static const uint32_t SIZE = 64;
+
+    enum Type : uint8_t {
+        XRUN,
+        PARTIAL_WRITE,
+        DEADLINE,
+    };
+
+    struct Entry {
+        uint64_t timeNs = 0;
+        Type type = XRUN;
+        // Frames written for a partial write, processing time in us for a missed deadline
+        uint32_t value = 0;
+        uint32_t cpuKHz = 0;
+        int32_t milliCelsius = 0;
+        uint8_t trackCount = 0;
+        int16_t trackIds[TOTAL_TRACKS];
+        uint32_t trackUs[TOTAL_TRACKS];
+    };
+
+    std::atomic<uint32_t> xruns = 0;
+    std::atomic<uint32_t> partialWrites = 0;
+    std::atomic<uint32_t> deadlineMisses = 0;
+    std::atomic<uint32_t> cpuKHz = 0;
+    std::atomic<int32_t> milliCelsius = 0;
+
+protected:
+    Entry entries[SIZE];
+    // Even when the entry is readable, odd while it is written
+    std::atomic<uint64_t> sequences[SIZE] = {};
+    std::atomic<uint64_t> writeCount = 0;
+
+    std::thread monitorThread;
+    std::atomic<bool> monitoring = false;
+
+    static int64_t readSysfs(const char* path)
+    {
+        std::ifstream file(path);
+        int64_t value = 0;
+        file >> value;
+        return value;
+    }
+
+public:
+    static uint64_t now()
+    {
+        struct timespec ts;
+        clock_gettime(CLOCK_REALTIME, &ts);
+        return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+    }
+
+    ~XrunLog()
+    {
+        stopMonitor();
+    }
+
+    // Sample the CPU frequency and temperature every `msInterval`
+    void startMonitor(uint32_t msInterval = 500)
+    {
+        if (monitoring) {
+            return;
+        }
+        monitoring = true;
+        monitorThread = std::thread([this, msInterval]() {
+            while (monitoring) {
+                cpuKHz = readSysfs("/sys/devices/system/cpu/cpu0/cpufreq/scaling_cur_freq");
+                milliCelsius = readSysfs("/sys/class/thermal/thermal_zone0/temp");
+                std::this_thread::sleep_for(std::chrono::milliseconds(msInterval));
+            }
+        });
+        pthread_setname_np(monitorThread.native_handle(), "xrunMonitor");
+    }
+
+    void stopMonitor()
+    {
+        monitoring = false;
+        if (monitorThread.joinable()) {
+            monitorThread.join();
+        }
+    }
+
+    // Add an entry, `fillTracks(entry)` setting the processing time of the tracks. Never waits.
+    template <typename F>
+    void add(Type type, uint32_t value, F fillTracks)
+    {
+        if (type == XRUN) {
+            xruns++;
+        } else if (type == PARTIAL_WRITE) {
+            partialWrites++;
+        } else {
+            deadlineMisses++;
+        }
+        uint64_t index = writeCount.fetch_add(1);
+        uint32_t slot = index % SIZE;
+        sequences[slot].store(index * 2 + 1, std::memory_order_release);
+        Entry& entry = entries[slot];
+        entry.timeNs = now();
+        entry.type = type;
+        entry.value = value;
+        entry.cpuKHz = cpuKHz;
+        entry.milliCelsius = milliCelsius;
+        entry.trackCount = 0;
+        fillTracks(entry);
+        sequences[slot].store(index * 2 + 2, std::memory_order_release);
+    }
+
+    uint64_t count()
+    {
+        return writeCount.load();
+    }
+
+    // Copy the `n`th last entry (0 being the most recent), return false if not available
+    bool get(uint32_t n, Entry& out)
+    {
+        uint64_t total = writeCount.load(std::memory_order_acquire);
+        if (n >= total || n >= SIZE) {
+            return false;
+        }
+        uint64_t index = total - 1 - n;
+        uint32_t slot = index % SIZE;
+        if (sequences[slot].load(std::memory_order_acquire) != index * 2 + 2) {
+            return false;
+        }
+        out = entries[slot];
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return sequences[slot].load(std::memory_order_relaxed) == index * 2 + 2;
+    }
+
+    static const char* typeName(Type type)
+    {
+        return type == XRUN ? "xrun" : type == PARTIAL_WRITE ? "partial write" : "deadline";
+    }
+};
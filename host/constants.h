@@ -1,5 +1,6 @@
 #pragma once
 
+// Default sample rate, can be changed with the host config `sampleRate`
 #ifndef SAMPLE_RATE
 // #define SAMPLE_RATE 44100
 #define SAMPLE_RATE 48000
@@ -22,7 +23,33 @@
 #endif
 
 #ifndef TOTAL_TRACKS
-#define TOTAL_TRACKS MAX_TRACKS+1
+#define TOTAL_TRACKS (MAX_TRACKS + 1)
+#endif
+
+// Number of frames processed per block, can be changed with the host config `blockSize`
+#ifndef DEFAULT_BLOCK_SIZE
+#define DEFAULT_BLOCK_SIZE 128
+#endif
+
+#ifndef MIN_BLOCK_SIZE
+#define MIN_BLOCK_SIZE 32
+#endif
+
+#ifndef MAX_BLOCK_SIZE
+#define MAX_BLOCK_SIZE 1024
+#endif
+
+// The block size is a multiple of it, so the SIMD paths never have a scalar tail to process
+#ifndef BLOCK_SIZE_MULTIPLE
+#define BLOCK_SIZE_MULTIPLE 16
+#endif
+
+#ifndef MIN_SAMPLE_RATE
+#define MIN_SAMPLE_RATE 8000
+#endif
+
+#ifndef MAX_SAMPLE_RATE
+#define MAX_SAMPLE_RATE 192000
 #endif
 
 // To be deprecated?
@@ -1,64 +1,162 @@
 #pragma once
 
 #include "plugins/audio/audioPlugin.h"
+#include <cmath>
+#include <cstdint>
+#include <sstream>
+#include <string>
+#include <unordered_map>
 #include <vector>
 
-class MidiMapping {
+// MIDI commands mapped to plugin values, compiled at config time in tables indexed by the message itself, so an
+// incoming message finds its values in O(1) however many mappings there are. The values are set through their
+// parameter queue, applied by the audio thread before the next block.
+//
+// Commands, `xx` being the value:
+// - `b0 4c xx` a 3 bytes message, the value in the third byte, e.g. a control change
+// - `d0 xx` a 2 bytes message, the value in the second byte, e.g. the channel pressure
+// - `e0 xx xx` a 3 bytes message with a 14 bits value, least significant byte first, e.g. the pitch bend
+// - `nrpn b0 01 02` the NRPN 0x0102 (MSB 01, LSB 02) of the channel of `b0`, with a 14 bits value
+class MidiMappingTable {
+public:
+    enum Curve {
+        LINEAR,
+        // Finer at the bottom of the range, e.g. for a cutoff or a time
+        EXP,
+        // Finer at the top of the range
+        LOG,
+    };
+
 protected:
-    AudioPlugin* plugin;
-    int valueIndex;
-    bool (MidiMapping::*handlePtr)(std::vector<unsigned char>* message);
-    uint8_t size;
-    uint8_t msg[2];
+    struct Target {
+        AudioPlugin* plugin;
+        int valueIndex;
+        Curve curve;
+    };
+
+    // 3 bytes messages with a 7 bits value, by status and first data byte
+    std::vector<Target> byData[128][128];
+    // 2 bytes messages with a 7 bits value, and 3 bytes messages with a 14 bits value, by status
+    std::vector<Target> byStatus[128];
+    bool wide[128] = {};
+    // NRPN by channel and parameter number
+    std::unordered_map<uint32_t, std::vector<Target>> nrpn;
+
+    // NRPN parameter selected on each channel, and its value so far
+    struct NrpnState {
+        uint16_t parameter = 0x3fff;
+        uint8_t valueMsb = 0;
+    };
+    NrpnState nrpnState[16];
 
-    bool handleUint8Position1(std::vector<unsigned char>* message)
+    static uint32_t nrpnKey(uint8_t channel, uint16_t parameter)
     {
-        plugin->getValue(valueIndex)->setPct(message->at(1) / 128.0f);
-        return true;
+        return (channel << 14) | parameter;
     }
 
-    bool handleUint8Position2(std::vector<unsigned char>* message)
+    static bool apply(std::vector<Target>& targets, float pct)
     {
-        if (msg[1] == message->at(1)) {
-            plugin->getValue(valueIndex)->setPct(message->at(2) / 128.0f);
-            return true;
+        for (Target& target : targets) {
+            float value = target.curve == EXP ? pct * pct : (target.curve == LOG ? sqrtf(pct) : pct);
+            ValueInterface* val = target.plugin->getValue(target.valueIndex);
+            if (val) {
+                val->setPct(value);
+            }
         }
-        return false;
+        return !targets.empty();
     }
 
-    bool handleUint16(std::vector<unsigned char>* message)
+    bool controlChange(uint8_t channel, uint8_t controller, uint8_t value)
     {
-        plugin->getValue(valueIndex)->setPct(((message->at(2) << 7) + message->at(1)) / 16383.0f);
-        return true;
+        NrpnState& state = nrpnState[channel];
+        if (controller == 99) {
+            state.parameter = (value << 7) | (state.parameter & 0x7f);
+        } else if (controller == 98) {
+            state.parameter = (state.parameter & (0x7f << 7)) | value;
+        } else if (controller == 6 || controller == 38) {
+            // Data entry, the MSB first, then the LSB completing it
+            if (controller == 6) {
+                state.valueMsb = value;
+            }
+            auto it = nrpn.find(nrpnKey(channel, state.parameter));
+            if (it != nrpn.end()) {
+                return apply(it->second, ((state.valueMsb << 7) | (controller == 38 ? value : 0)) / 16383.0f);
+            }
+        }
+        return false;
     }
 
 public:
-    MidiMapping(AudioPlugin* plugin, int valueIndex, uint8_t _size, uint8_t valuePosition, uint8_t _msg0, uint8_t _msg1)
-        : plugin(plugin)
-        , valueIndex(valueIndex)
-        , size(_size)
+    static Curve getCurve(const std::string& name)
     {
-        msg[0] = _msg0;
-        msg[1] = _msg1;
-        if (valuePosition == _size) {
-            if (size == 2) {
-                handlePtr = &MidiMapping::handleUint8Position1;
-            } else if (size == 3) {
-                handlePtr = &MidiMapping::handleUint8Position2;
+        if (name == "exp") {
+            return EXP;
+        }
+        if (name == "log") {
+            return LOG;
+        }
+        return LINEAR;
+    }
+
+    // Return false if the command is not valid
+    bool map(AudioPlugin* plugin, int valueIndex, const std::string& cmd, Curve curve = LINEAR)
+    {
+        std::istringstream stream(cmd);
+        std::vector<std::string> parts;
+        std::string part;
+        while (stream >> part) {
+            parts.push_back(part);
+        }
+        Target target = { plugin, valueIndex, curve };
+        try {
+            if (parts.size() == 4 && parts[0] == "nrpn") {
+                uint8_t status = std::stoi(parts[1], nullptr, 16);
+                uint16_t parameter = (std::stoi(parts[2], nullptr, 16) << 7) | std::stoi(parts[3], nullptr, 16);
+                nrpn[nrpnKey(status & 0x0f, parameter & 0x3fff)].push_back(target);
+                return status >= 0xb0 && status < 0xc0;
+            }
+            if (parts.size() < 2 || parts.size() > 3) {
+                return false;
+            }
+            uint8_t status = std::stoi(parts[0], nullptr, 16);
+            if (status < 0x80) {
+                return false;
+            }
+            if (parts[1] == "xx") {
+                wide[status & 0x7f] = parts.size() == 3;
+                byStatus[status & 0x7f].push_back(target);
+                return true;
             }
-        } else {
-            handlePtr = &MidiMapping::handleUint16;
+            if (parts.size() == 3 && parts[2] == "xx") {
+                byData[status & 0x7f][std::stoi(parts[1], nullptr, 16) & 0x7f].push_back(target);
+                return true;
+            }
+        } catch (...) {
         }
+        return false;
     }
 
-    bool handle(std::vector<unsigned char>* message)
+    // Return true if the message was mapped to a value
+    bool handle(const uint8_t* message, uint8_t size)
     {
-        if (message->size() != size) {
+        uint8_t status = message[0];
+        if (status < 0x80 || size < 2) {
             return false;
         }
-        if (msg[0] != message->at(0)) {
-            return false;
+        bool handled = false;
+        if (size == 3 && status >= 0xb0 && status < 0xc0) {
+            handled = controlChange(status & 0x0f, message[1], message[2]);
+        }
+        std::vector<Target>& targets = byStatus[status & 0x7f];
+        if (!targets.empty()) {
+            if (wide[status & 0x7f]) {
+                return (size == 3 && apply(targets, ((message[2] << 7) | message[1]) / 16383.0f)) || handled;
+            }
+            return (size == 2 && apply(targets, message[1] / 127.0f)) || handled;
+        }
+        if (size == 3) {
+            handled = apply(byData[status & 0x7f][message[1] & 0x7f], message[2] / 127.0f) || handled;
         }
-        return (this->*handlePtr)(message);
+        return handled;
     }
 };
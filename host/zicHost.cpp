@@ -1,4 +1,6 @@
 #include "AudioPluginHandler.h"
+#include "ProjectGroup.h"
+#include "SharedHostServer.h"
 #include "def.h"
 
 #include <iostream>
@@ -11,11 +13,44 @@ extern "C" AudioPluginHandlerInterface* load()
     return &AudioPluginHandler::get();
 }
 
-int main() {
+int main(int argc, char* argv[])
+{
+    std::string configFile = "config.json";
+    RenderOptions render;
+    bool offline = false;
+    std::string shm;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--render" && hasValue) {
+            offline = true;
+            render.file = argv[++i];
+        } else if (arg == "--seconds" && hasValue) {
+            render.seconds = atof(argv[++i]);
+        } else if (arg == "--bars" && hasValue) {
+            render.bars = atof(argv[++i]);
+        } else if (arg == "--loops" && hasValue) {
+            render.loops = atoi(argv[++i]);
+        } else if (arg == "--loopTrack" && hasValue) {
+            render.loopTrack = atoi(argv[++i]);
+        } else if (arg == "--workspace" && hasValue) {
+            render.workspace = argv[++i];
+        } else if (arg == "--stems") {
+            render.stems = true;
+        } else if (arg == "--shm" && hasValue) {
+            shm = argv[++i];
+        } else if (arg[0] != '-') {
+            configFile = arg;
+        } else {
+            std::cerr << "Unknown argument: " << arg << '\n';
+            return 1;
+        }
+    }
+
     // Open and read the config.json file
-    std::ifstream file("config.json");
+    std::ifstream file(configFile);
     if (!file) {
-        std::cerr << "Error: Unable to open config.json\n";
+        std::cerr << "Error: Unable to open " << configFile << '\n';
         return 1;
     }
 
@@ -28,7 +63,37 @@ int main() {
         return 1;
     }
 
+    // The config of zic can be given as well, e.g. when the UI runs in its own process
+    if (config.contains("audio") && config["audio"].is_object()) {
+        config = config["audio"];
+    }
+
+    // Several projects sharing the worker pool, see ProjectGroup
+    if (config.contains("projects") && config["projects"].is_array()) {
+        ProjectGroup group;
+        if (!group.config(config)) {
+            return 1;
+        }
+        group.loop();
+        return 0;
+    }
+
+    if (offline) {
+        // Must be set before the tracks get loaded
+        AudioPluginHandler::get().setRender(render);
+        return AudioPluginHandler::get().config(config).render() ? 0 : 1;
+    }
+
+    // The UI process attaches to the segment, see `ZIC_HOST_SHM`
+    SharedHostServer sharedHost;
+    if (!shm.empty()) {
+        if (!sharedHost.start(&AudioPluginHandler::get(), shm)) {
+            return 1;
+        }
+        AudioPluginHandler::get().share(sharedHost.getSegment());
+    }
+
     // Pass the config to AudioPluginHandler and start the loop
     AudioPluginHandler::get().config(config).loop();
     return 0;
-}
\ No newline at end of file
+}
@@ -30,6 +30,9 @@ sha: 9c0d03c88d3979c402f3efc12a7eb851d209726dd6ee3a313e67ab3c5c959faa
 
 #include <stdarg.h>
 #include <string>
+#include <type_traits>
+
+#include "helpers/logQueue.h"
 
 #define ZIC_LOG_TRACE 1
 #define ZIC_LOG_DEBUG 2
@@ -55,109 +58,53 @@ void showLogLevel()
         printf("\033[34m[info]\033[0m log level \033[31mERROR\033[0m\n");
 }
 
-void logTrace(std::string message)
-{
-#if ZIC_LOG_LEVEL <= ZIC_LOG_TRACE
-    printf("\033[35m[trace]\033[0m %s\n", message.c_str());
-    fflush(stdout);
-#endif
-}
+// Messages are queued and printed by a background thread, see helpers/logQueue.h. The format is kept as is when it
+// is a string literal, else it is copied with the message. The levels below ZIC_LOG_LEVEL are compiled out, their
+// arguments not even being evaluated.
+#define ZIC_LOG_FUNCTIONS(name, level)                                                         \
+    template <size_t N, typename... Args>                                                      \
+    void name(const char(&message)[N], Args... args)                                           \
+    {                                                                                          \
+        LogQueue::get().push(level, message, false, args...);                                  \
+    }                                                                                          \
+    template <typename T, typename... Args, typename = std::enable_if_t<LogQueue::isString<T>>> \
+    void name(T message, Args... args)                                                         \
+    {                                                                                          \
+        LogQueue::get().push(level, message, true, args...);                                   \
+    }                                                                                          \
+    inline void name(const std::string& message)                                               \
+    {                                                                                          \
+        LogQueue::get().push(level, "%s", false, message.c_str());                             \
+    }
 
-void logTrace(const char* message, ...)
-{
 #if ZIC_LOG_LEVEL <= ZIC_LOG_TRACE
-    va_list args;
-    va_start(args, message);
-    printf("\033[35m[trace]\033[0m ");
-    vprintf(message, args);
-    printf("\n");
-    va_end(args);
-    fflush(stdout);
-#endif
-}
-
-void logDebug(std::string message)
-{
-#if ZIC_LOG_LEVEL <= ZIC_LOG_DEBUG
-    printf("\033[32m[debug]\033[0m %s\n", message.c_str());
-    fflush(stdout);
+ZIC_LOG_FUNCTIONS(logTrace, ZIC_LOG_TRACE)
+#else
+#define logTrace(...) ((void)0)
 #endif
-}
 
-void logDebug(const char* message, ...)
-{
 #if ZIC_LOG_LEVEL <= ZIC_LOG_DEBUG
-    va_list args;
-    va_start(args, message);
-    printf("\033[32m[debug]\033[0m ");
-    vprintf(message, args);
-    printf("\n");
-    va_end(args);
-    fflush(stdout);
+ZIC_LOG_FUNCTIONS(logDebug, ZIC_LOG_DEBUG)
+#else
+#define logDebug(...) ((void)0)
 #endif
-}
 
-void logInfo(std::string message)
-{
 #if ZIC_LOG_LEVEL <= ZIC_LOG_INFO
-    printf("\033[34m[info]\033[0m %s\n", message.c_str());
-    fflush(stdout);
+ZIC_LOG_FUNCTIONS(logInfo, ZIC_LOG_INFO)
+#else
+#define logInfo(...) ((void)0)
 #endif
-}
 
-void logInfo(const char* message, ...)
-{
-#if ZIC_LOG_LEVEL <= ZIC_LOG_INFO
-    va_list args;
-    va_start(args, message);
-    printf("\033[34m[info]\033[0m ");
-    vprintf(message, args);
-    printf("\n");
-    va_end(args);
-    fflush(stdout);
-#endif
-}
-
-void logWarn(std::string message)
-{
 #if ZIC_LOG_LEVEL <= ZIC_LOG_WARN
-    printf("\033[33m[warn]\033[0m %s\n", message.c_str());
-    fflush(stdout);
+ZIC_LOG_FUNCTIONS(logWarn, ZIC_LOG_WARN)
+#else
+#define logWarn(...) ((void)0)
 #endif
-}
 
-void logWarn(const char* message, ...)
-{
-#if ZIC_LOG_LEVEL <= ZIC_LOG_WARN
-    va_list args;
-    va_start(args, message);
-    printf("\033[33m[warn]\033[0m ");
-    vprintf(message, args);
-    printf("\n");
-    va_end(args);
-    fflush(stdout);
-#endif
-}
-
-void logError(std::string message)
-{
-#if ZIC_LOG_LEVEL <= ZIC_LOG_ERROR
-    printf("\033[31m[error]\033[0m %s\n", message.c_str());
-    fflush(stdout);
-#endif
-}
-
-void logError(const char* message, ...)
-{
 #if ZIC_LOG_LEVEL <= ZIC_LOG_ERROR
-    va_list args;
-    va_start(args, message);
-    printf("\033[31m[error]\033[0m ");
-    vprintf(message, args);
-    printf("\n");
-    va_end(args);
-    fflush(stdout);
+ZIC_LOG_FUNCTIONS(logError, ZIC_LOG_ERROR)
+#else
+#define logError(...) ((void)0)
 #endif
-}
 
 #endif
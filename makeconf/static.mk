@@ -0,0 +1,17 @@
+# Plugins and components linked in zic by `make static`, see helpers/staticLibs.h. The others are still opened from
+# their library when the config uses them. The chains rendered without virtual calls are in plugins/audio/staticChains.cpp.
+STATIC_PLUGINS ?= SynthMultiEngine Sequencer SerializeTrack SynthMultiSample Mixer8 EffectGainVolume AudioOutputAlsa_int16 Tempo\
+	SynthFM2 EffectFilter EffectVolumeDrive
+
+STATIC_COMPONENTS ?= RectComponent KnobValueComponent TextComponent StringValComponent ValueComponent GraphValueComponent\
+	ClipsComponent HiddenValueComponent SequencerValueComponent SequencerCardComponent NoteGridComponent\
+	SeqRecordStatusComponent KnobActionComponent SavePresetComponent PresetComponent SampleComponent\
+	WorkspaceKnobComponent PixelsComponent GhRepoComponent GitHubComponent WifiComponent
+
+# Each object of the static build has its symbols made local, like they are in its library, so two plugins with their
+# own version of a helper class don't clash: its inline functions are neither merged with the ones of the other
+# objects (no COMDAT groups, no unique symbols) nor visible to them. Optimized, for the chains to be inlined.
+STATIC_CFLAGS = -O2 -fvisibility=hidden -fvisibility-inlines-hidden -fno-gnu-unique -DPLUGIN_STATIC
+STATIC_LOCALIZE = --localize-hidden --remove-section=.group
+STATIC_LIBS = `$(PKG_CONFIG) --cflags --libs alsa sndfile` -lssl -lcrypto
+OBJCOPY := $(patsubst %g++,%objcopy,$(CC))
@@ -30,12 +30,12 @@ sha: 74e4532d3d04563b2e2605ba26d5d8f8bddce8d3dda413dfcd8cff11dcb1b293
 #include <string>
 #include <vector>
 
+#include "audio/utils/Resampler.h"
+#include "host/XrunLog.h"
 #include "host/constants.h"
 #include "audioPlugin.h"
 #include "log.h"
 
-static constexpr uint32_t AUDIO_CHUNK_FRAMES = 128; // frames per ALSA write
-
 class AudioAlsa : public AudioPlugin {
 protected:
     AudioPlugin::Props& props;
@@ -44,9 +44,12 @@ protected:
 
     std::string deviceName = "default";
     unsigned int channels = 1;
+    // Channels of the PCM when set, else mono or stereo as the engine
+    unsigned int deviceChannels = 0;
     unsigned int sampleRate = 48000;
 
-    const snd_pcm_uframes_t chunkFrames = AUDIO_CHUNK_FRAMES;
+    // frames per ALSA write, one host block
+    const snd_pcm_uframes_t chunkFrames;
     uint32_t sampleIndex = 0; // index into interleaved buffer (in samples)
 
     // interleaved buffer (samples = frames * channels)
@@ -55,11 +58,26 @@ protected:
     // unsigned int latencyUs = 150000;
     unsigned int latencyUs = 200000;
 
+    // When set, hw params are explicitly set with this period size instead of using `latencyUs`
+    snd_pcm_uframes_t periodFrames = 0;
+    unsigned int periodCount = 2;
+    // Drive the host audio loop from the device period wakeups
+    bool deviceClock = false;
+    // Write straight into the device ring buffer instead of copying through `buffer`
+    bool useMmap = false;
+
+    // Quality of the built-in resampling when the card does not run at the engine rate, -1 to let alsa-lib resample
+    int resampleQuality = -1;
+    bool resampling = false;
+    Resampler resampler;
+    std::vector<float> resampled[2];
+
 public:
     AudioAlsa(AudioPlugin::Props& props, AudioPlugin::Config& config, snd_pcm_stream_t stream)
         : AudioPlugin(props, config)
         , props(props)
         , stream(stream)
+        , chunkFrames(props.blockSize)
     {
         auto& json = config.json;
         if (json.contains("device")) {
@@ -68,7 +86,21 @@ public:
             search();
         }
 
+        /*md - `latency` is the latency in microseconds, when period size is not set. Default is 200000 (200ms). */
         latencyUs = json.value("latency", latencyUs);
+        /*md - `periodSize` is the size of the ALSA period in frames, e.g. 128. When set, the hardware params are set explicitly from `periodSize` and `periodCount`, instead of using `latency`. */
+        periodFrames = json.value("periodSize", periodFrames);
+        /*md - `periodCount` is the number of periods in the ALSA buffer. Default is 2. */
+        periodCount = json.value("periodCount", periodCount);
+        /*md - `deviceClock` if true, the audio loop waits for the sound card to be ready for the next period before processing it, instead of blocking when writing to the sound card. Best used with `periodSize` to get a low and deterministic latency. */
+        deviceClock = json.value("deviceClock", deviceClock);
+        /*md - `mmap` if true, samples are written (and converted) directly into the sound card buffer, instead of being copied through an intermediate buffer. Not all devices support it. */
+        useMmap = json.value("mmap", useMmap);
+        /*md - `resample` is how the audio is converted when the sound card does not support the engine sample rate: `alsa` (default) lets the ALSA plug layer resample, `low`, `medium` or `high` use the built-in polyphase resampler with 8, 16 or 32 taps, the card then running at its own rate. Playback only. */
+        std::string resample = json.value("resample", "alsa");
+        if (resample != "alsa" && stream == SND_PCM_STREAM_PLAYBACK) {
+            resampleQuality = Resampler::getQuality(resample);
+        }
     }
 
     virtual ~AudioAlsa()
@@ -80,7 +112,52 @@ public:
 
     virtual bool isSink() { return true; }
 
+    bool isClockSource() override
+    {
+        return deviceClock && handle && stream == SND_PCM_STREAM_PLAYBACK;
+    }
+
+    // Wait until the device has room for the next block, so writing it will not block
+    void waitForNextBlock(uint32_t frames) override
+    {
+        if (resampling) {
+            frames = ((uint64_t)frames * sampleRate + props.sampleRate - 1) / props.sampleRate;
+        }
+        while (handle) {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+            if (avail < 0) {
+                if (snd_pcm_recover(handle, avail, 1) < 0) {
+                    logError("snd_pcm_recover failed: %s", snd_strerror(avail));
+                    return;
+                }
+                logDebug("Recovered from XRUN while waiting for device");
+                reportXrun(XrunLog::XRUN);
+                prefill();
+                continue;
+            }
+            if ((snd_pcm_uframes_t)avail >= frames) {
+                return;
+            }
+            int err = snd_pcm_wait(handle, 1000);
+            if (err == 0) {
+                logWarn("Timeout waiting for ALSA device %s", deviceName.c_str());
+                return;
+            }
+            if (err < 0 && snd_pcm_recover(handle, err, 1) < 0) {
+                logError("snd_pcm_wait failed: %s", snd_strerror(err));
+                return;
+            }
+        }
+    }
+
 protected:
+    void reportXrun(XrunLog::Type type, uint32_t value = 0)
+    {
+        if (props.audioPluginHandler) {
+            props.audioPluginHandler->reportXrun(type, value);
+        }
+    }
+
     void open(snd_pcm_format_t format = SND_PCM_FORMAT_FLOAT)
     {
         if (handle) {
@@ -88,7 +165,7 @@ protected:
             handle = nullptr;
         }
 
-        channels = std::min<unsigned int>(props.channels, CHANNEL_STEREO);
+        channels = deviceChannels ? deviceChannels : std::min<unsigned int>(props.channels, CHANNEL_STEREO);
         sampleRate = props.sampleRate;
 
         logDebug("AudioAlsa::open %s (rate %u, channels %u)", deviceName.c_str(), sampleRate, channels);
@@ -103,13 +180,20 @@ protected:
             }
         }
 
-        if ((err = snd_pcm_set_params(handle,
-                 format,
-                 SND_PCM_ACCESS_RW_INTERLEAVED,
-                 channels,
-                 sampleRate,
-                 1, // soft_resample
-                 latencyUs))
+        // The built-in resampler needs the rate the card actually runs at, only set by the explicit hw params
+        if (periodFrames > 0 || resampleQuality >= 0) {
+            if ((err = setHwParams(format)) < 0) {
+                snd_pcm_close(handle);
+                handle = nullptr;
+                return;
+            }
+        } else if ((err = snd_pcm_set_params(handle,
+                        format,
+                        access(),
+                        channels,
+                        sampleRate,
+                        1, // soft_resample
+                        latencyUs))
             < 0) {
             logError("snd_pcm_set_params failed: %s", snd_strerror(err));
             snd_pcm_close(handle);
@@ -128,6 +212,172 @@ protected:
 
         sampleIndex = 0;
         resizeBuffer();
+
+        resampling = resampleQuality >= 0 && sampleRate != props.sampleRate;
+        if (resampling) {
+            resampler.set(props.sampleRate, sampleRate, (Resampler::Quality)resampleQuality);
+            resampler.reserve(chunkFrames);
+            resampled[0].resize(resampler.maxOutputFrames(chunkFrames));
+            resampled[1].resize(resampler.maxOutputFrames(chunkFrames));
+            logInfo("ALSA %s: resampling from %u to %u", deviceName.c_str(), (unsigned int)props.sampleRate, sampleRate);
+        }
+
+        if (deviceClock && stream == SND_PCM_STREAM_PLAYBACK) {
+            prefill();
+        }
+    }
+
+    int setHwParams(snd_pcm_format_t format)
+    {
+        snd_pcm_hw_params_t* hwParams;
+        snd_pcm_hw_params_alloca(&hwParams);
+        int err;
+        if ((err = snd_pcm_hw_params_any(handle, hwParams)) < 0
+            || (err = snd_pcm_hw_params_set_access(handle, hwParams, access())) < 0
+            || (err = snd_pcm_hw_params_set_format(handle, hwParams, format)) < 0
+            || (err = snd_pcm_hw_params_set_channels(handle, hwParams, channels)) < 0
+            || (err = snd_pcm_hw_params_set_rate_resample(handle, hwParams, resampleQuality < 0)) < 0
+            || (err = snd_pcm_hw_params_set_rate_near(handle, hwParams, &sampleRate, 0)) < 0) {
+            logError("ALSA hw params failed: %s", snd_strerror(err));
+            return err;
+        }
+
+        // Without an explicit period size, the periods share the latency
+        snd_pcm_uframes_t period = periodFrames ? periodFrames : (uint64_t)latencyUs * sampleRate / 1000000 / periodCount;
+        snd_pcm_uframes_t bufferFrames = period * periodCount;
+        if ((err = snd_pcm_hw_params_set_period_size_near(handle, hwParams, &period, 0)) < 0
+            || (err = snd_pcm_hw_params_set_buffer_size_near(handle, hwParams, &bufferFrames)) < 0
+            || (err = snd_pcm_hw_params(handle, hwParams)) < 0) {
+            logError("ALSA period/buffer size failed: %s", snd_strerror(err));
+            return err;
+        }
+        if (periodFrames && period != periodFrames) {
+            logWarn("ALSA period size %lu not supported, using %lu", (unsigned long)periodFrames, (unsigned long)period);
+        }
+        if (sampleRate != props.sampleRate) {
+            logWarn("ALSA sample rate %u not supported, using %u", (unsigned int)props.sampleRate, sampleRate);
+        }
+
+        // Wake up once a period is free and only start once the buffer is full
+        snd_pcm_sw_params_t* swParams;
+        snd_pcm_sw_params_alloca(&swParams);
+        if ((err = snd_pcm_sw_params_current(handle, swParams)) < 0
+            || (err = snd_pcm_sw_params_set_avail_min(handle, swParams, period)) < 0
+            || (err = snd_pcm_sw_params_set_start_threshold(handle, swParams, bufferFrames)) < 0
+            || (err = snd_pcm_sw_params(handle, swParams)) < 0) {
+            logError("ALSA sw params failed: %s", snd_strerror(err));
+            return err;
+        }
+
+        logInfo("ALSA %s: period %lu frames, buffer %lu frames (%.1f ms)", deviceName.c_str(),
+            (unsigned long)period, (unsigned long)bufferFrames, bufferFrames * 1000.0f / sampleRate);
+        return 0;
+    }
+
+    // Fill the device buffer with silence but one block, so the stream starts as soon as the first block is written
+    void prefill()
+    {
+        snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+        if (avail <= (snd_pcm_sframes_t)chunkFrames) {
+            return;
+        }
+        snd_pcm_uframes_t frames = avail - chunkFrames;
+        if (useMmap) {
+            while (frames > 0) {
+                snd_pcm_uframes_t offset, n = frames;
+                void* out = mmapBegin(n, offset);
+                if (!out) {
+                    return;
+                }
+                memset(out, 0, snd_pcm_frames_to_bytes(handle, n));
+                mmapCommit(offset, n);
+                frames -= n;
+            }
+            return;
+        }
+        std::vector<char> silence(snd_pcm_frames_to_bytes(handle, frames), 0);
+        snd_pcm_writei(handle, silence.data(), frames);
+    }
+
+    snd_pcm_access_t access()
+    {
+        return useMmap ? SND_PCM_ACCESS_MMAP_INTERLEAVED : SND_PCM_ACCESS_RW_INTERLEAVED;
+    }
+
+    // Get the next contiguous area of the device ring buffer, waiting for the device if it is full.
+    // `frames` is the number of frames wanted, updated with the number of frames available in the area.
+    void* mmapBegin(snd_pcm_uframes_t& frames, snd_pcm_uframes_t& offset)
+    {
+        while (handle) {
+            snd_pcm_sframes_t avail = snd_pcm_avail_update(handle);
+            if (avail < 0) {
+                if (snd_pcm_recover(handle, avail, 1) < 0) {
+                    logError("snd_pcm_recover failed: %s", snd_strerror(avail));
+                    return NULL;
+                }
+                logDebug("Recovered from XRUN/suspend");
+                reportXrun(XrunLog::XRUN);
+                continue;
+            }
+            if (avail == 0) {
+                if (snd_pcm_wait(handle, 1000) <= 0) {
+                    return NULL;
+                }
+                continue;
+            }
+
+            const snd_pcm_channel_area_t* areas;
+            int err = snd_pcm_mmap_begin(handle, &areas, &offset, &frames);
+            if (err < 0) {
+                if (snd_pcm_recover(handle, err, 1) < 0) {
+                    logError("snd_pcm_mmap_begin failed: %s", snd_strerror(err));
+                    return NULL;
+                }
+                continue;
+            }
+            // Interleaved: all channels share the same area, `step` being the size of a frame in bits
+            return (char*)areas[0].addr + areas[0].first / 8 + offset * (areas[0].step / 8);
+        }
+        return NULL;
+    }
+
+    void mmapCommit(snd_pcm_uframes_t offset, snd_pcm_uframes_t frames)
+    {
+        snd_pcm_sframes_t ret = snd_pcm_mmap_commit(handle, offset, frames);
+        if (ret < 0 || (snd_pcm_uframes_t)ret != frames) {
+            snd_pcm_recover(handle, ret >= 0 ? -EPIPE : ret, 1);
+            logDebug("Recovered from XRUN on mmap commit");
+            reportXrun(XrunLog::XRUN);
+        }
+    }
+
+    // Convert the block to the card rate when resampling, `lane`, `right` and `stride` then pointing to the
+    // converted frames. Return the number of frames to write.
+    uint32_t resampleBlock(float*& lane, float*& right, uint32_t& stride, uint32_t frames)
+    {
+        if (!resampling) {
+            return frames;
+        }
+        const float* in[2] = { lane, right };
+        float* out[2] = { resampled[0].data(), resampled[1].data() };
+        bool mono = lane == right;
+        uint32_t count = resampler.process(in, stride, std::min<uint32_t>(frames, chunkFrames), out, mono ? 1 : 2);
+        lane = out[0];
+        right = mono ? out[0] : out[1];
+        stride = 1;
+        return count;
+    }
+
+    // Frames written to the device and not played yet, at the engine rate: the next frame written is heard after them
+    snd_pcm_sframes_t queuedFrames()
+    {
+        snd_pcm_sframes_t delay = 0;
+        if (!handle || snd_pcm_delay(handle, &delay) < 0) {
+            return 0;
+        }
+        // Plus the ones still in the intermediate buffer, not flushed yet
+        delay += useMmap ? 0 : sampleIndex / channels;
+        return resampling ? (int64_t)delay * props.sampleRate / sampleRate : delay;
     }
 
     // must be implemented by derived class to set buffer type/size
@@ -148,6 +398,7 @@ protected:
                 return;
             } else {
                 logDebug("Recovered from XRUN/suspend");
+                reportXrun(XrunLog::XRUN);
                 sampleIndex = 0;
                 return;
             }
@@ -169,6 +420,7 @@ protected:
                 sampleIndex = 0;
             }
             logWarn("Partial ALSA write: wrote %zu/%zu frames", framesWritten, frameCount);
+            reportXrun(XrunLog::PARTIAL_WRITE, framesWritten);
         } else {
             sampleIndex = 0; // all good
         }
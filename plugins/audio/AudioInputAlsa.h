@@ -19,32 +19,109 @@ sha: e75cfb5f45d978026d823869374a0c56aa409f331a6ad00633c380cf90b3ae98
 /*md
 ## AudioInputAlsa
 
-AudioInputAlsa plugin is used to read audio input from ALSA.
+AudioInputAlsa plugin is used to read audio input from ALSA. The input replaces the audio of the plugin track, the
+right channel going to the right lane of a stereo track.
 
 **Value**:
 - `DEVICE: name` to set input device name. If not defined, default device will be used.
+
+In duplex mode, the capture stream is linked to the playback stream of an `AudioOutputAlsa` plugin with
+`snd_pcm_link`: both start together and run from the same period clock, so the input of each block is captured at
+the same block index as the playback, without drift. Use the same device, `periodSize` and `periodCount` on both
+plugins, and `deviceClock` on the output, to get a low and deterministic latency for live input and sample aligned
+recordings.
 */
 class AudioInputAlsa : public AudioAlsa {
+protected:
+    // Name of the output plugin to link to
+    std::string duplexOutput;
+    bool linked = false;
+
+    // Link the capture to the playback stream, once both are prepared and before any of them starts
+    void link()
+    {
+        linked = true;
+        AudioPlugin* output = props.audioPluginHandler ? props.audioPluginHandler->getPluginPtr(duplexOutput) : NULL;
+        snd_pcm_t* playback = output ? (snd_pcm_t*)output->data(output->getDataId("PCM")) : NULL;
+        if (!playback) {
+            logWarn("Duplex output %s not found, input is not linked", duplexOutput.c_str());
+            return;
+        }
+        snd_pcm_uframes_t captureBuffer, capturePeriod, playbackBuffer, playbackPeriod;
+        if (snd_pcm_get_params(handle, &captureBuffer, &capturePeriod) == 0
+            && snd_pcm_get_params(playback, &playbackBuffer, &playbackPeriod) == 0
+            && (captureBuffer != playbackBuffer || capturePeriod != playbackPeriod)) {
+            logWarn("Duplex capture (period %lu, buffer %lu) and playback (period %lu, buffer %lu) differ",
+                (unsigned long)capturePeriod, (unsigned long)captureBuffer, (unsigned long)playbackPeriod, (unsigned long)playbackBuffer);
+        }
+        int err = snd_pcm_link(handle, playback);
+        if (err < 0) {
+            logError("snd_pcm_link failed: %s", snd_strerror(err));
+            return;
+        }
+        logInfo("ALSA capture %s linked to %s", deviceName.c_str(), duplexOutput.c_str());
+    }
+
+    void read(float* lane, float* right, uint32_t stride, uint32_t frames)
+    {
+        float* in = reinterpret_cast<float*>(buffer.data());
+        uint32_t f = 0;
+        while (handle && f < frames) {
+            uint32_t count = std::min<uint32_t>(frames - f, chunkFrames);
+            snd_pcm_sframes_t ret = snd_pcm_readi(handle, in, count);
+            if (ret < 0) {
+                if (snd_pcm_recover(handle, ret, 1) < 0) {
+                    logError("A problem occurred while reading from the audio card: %s", snd_strerror(ret));
+                    break;
+                }
+                logDebug("Recovered from XRUN on capture");
+                reportXrun(XrunLog::XRUN);
+                continue;
+            }
+            for (snd_pcm_sframes_t i = 0; i < ret; i++, f++) {
+                lane[f * stride] = in[i * channels];
+                if (right != lane) {
+                    right[f * stride] = in[i * channels + channels - 1];
+                }
+            }
+        }
+        for (; f < frames; f++) {
+            lane[f * stride] = 0.0f;
+            right[f * stride] = 0.0f;
+        }
+    }
+
+    void resizeBuffer() override
+    {
+        buffer.resize(chunkFrames * channels * sizeof(float));
+    }
+
 public:
     AudioInputAlsa(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : AudioAlsa(props, config, SND_PCM_STREAM_CAPTURE)
     {
+        /*md - `duplex` is the name of the `AudioOutputAlsa` plugin to link the capture stream to, e.g. `"duplex": "AudioOutputAlsa"`. */
+        duplexOutput = config.json.value("duplex", duplexOutput);
         open();
     }
 
-    void sample(float* buf)
+    bool isStereo() override
     {
-        if (bufferIndex >= bufferSize) {
-            bufferIndex = 0;
-            int err;
-            if (handle && (err = snd_pcm_readi(handle, buffer, audioChunk)) < 0) {
-                logError("A problem occurred while reading from the audio card: %s", snd_strerror(err));
-                return;
-            }
-        }
-        buf[track] = buffer[bufferIndex++];
-        if (props.channels == CHANNEL_STEREO) {
-            bufferIndex++; // skip stereo
+        return hasStereoBuffer();
+    }
+
+    void sample(float* buf) override
+    {
+        float* lane = buf + track;
+        read(lane, lane, 1, 1);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        // Reading the first block of a prepared capture starts it, and the linked playback with it
+        if (!linked && !duplexOutput.empty()) {
+            link();
         }
+        read(trackLane(buf, track), rightLane(buf, track), props.frameStride, frames);
     }
 };
@@ -0,0 +1,426 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "audioPlugin.h"
+#include "helpers/SpscRing.h"
+#include "log.h"
+#include "utils/NetAudio.h"
+
+/*md
+## AudioInputNetwork
+
+AudioInputNetwork plugin is used to play on its track the audio streamed by `AudioOutputNetwork`, e.g. from another
+unit, so several units can be mixed on one of them, or a remote monitoring feed provided. Use one plugin per stream,
+each on its own port.
+
+The packets are decoded by the receiver thread into a jitter buffer, the audio thread starting to play once it holds
+enough frames to ride out the interarrival jitter measured on the stream (3 times the RFC 3550 estimate, plus a
+packet). Running out of frames raises the buffering, which then slowly decays. The clocks of the two units never run
+exactly at the same rate, so the playback rate is nudged by at most 0.5% to keep the buffer at its target.
+
+Lost packets are concealed, by Opus itself or with silence, packets arriving after the following ones are dropped.
+
+```json
+{ "plugin": "AudioInputNetwork", "port": 5004 }
+```
+*/
+class AudioInputNetwork : public AudioPlugin {
+protected:
+    // About 340ms of stereo frames at 48kHz
+    static constexpr uint32_t RING_SIZE = 1 << 15;
+    SpscRing<float, RING_SIZE> ring;
+
+    uint8_t channels = 1;
+    int fd = -1;
+    int stopFd = -1;
+    std::thread receiverThread;
+
+    uint32_t minFrames = 0;
+    uint32_t maxFrames = 0;
+    // Set by the receiver from the jitter of the stream
+    std::atomic<uint32_t> targetFrames = 0;
+    std::atomic<uint32_t> packetFrames = 128;
+
+    NetAudio::AtomicStats stats;
+    NetAudio::Stats statsCopy;
+
+    // Receiver thread
+    bool synced = false;
+    uint32_t ssrc = 0;
+    uint16_t nextSequence = 0;
+    int64_t lastPacketUs = 0;
+    bool hasTransit = false;
+    int32_t lastTransit = 0;
+    double jitter = 0.0;
+    uint32_t lastPacketFrames = 0;
+#ifdef NET_AUDIO_OPUS
+    OpusDecoder* decoder = NULL;
+#endif
+
+    // Audio thread
+    bool buffering = true;
+    float underrunFrames = 0.0f;
+    double averageFill = 0.0;
+    double phase = 0.0;
+    float last[2] = { 0.0f, 0.0f };
+    std::vector<float> input;
+
+    // Up to 4 packets of a burst of losses are concealed, longer gaps catch up right away
+    static constexpr uint32_t MAX_CONCEAL = 4;
+    // Opus packets last up to 120ms
+    static constexpr uint32_t MAX_PACKET_FRAMES = 5760;
+
+    static int64_t nowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    void push(const float* frames, uint32_t count)
+    {
+        if (ring.space() >= count * channels) {
+            ring.write(frames, count * channels);
+        } else {
+            stats.dropped.fetch_add(count, std::memory_order_relaxed);
+        }
+    }
+
+    void receive(uint8_t* packet, ssize_t len, float* frames)
+    {
+        NetAudio::Header* header = (NetAudio::Header*)packet;
+        NetAudio::Format format;
+        uint8_t streamChannels;
+        if (len < (ssize_t)NetAudio::HEADER_SIZE || (header->flags & 0xc0) != 0x80
+            || !NetAudio::parsePayloadType(header->payloadType, format, streamChannels)) {
+            return;
+        }
+        ssize_t offset = NetAudio::HEADER_SIZE + (header->flags & 0x0f) * 4;
+        if ((header->flags & 0x10) && offset + 4 <= len) {
+            uint16_t words;
+            memcpy(&words, packet + offset + 2, 2);
+            offset += 4 + ntohs(words) * 4;
+        }
+        if (header->flags & 0x20) {
+            len -= packet[len - 1];
+        }
+        if (offset >= len) {
+            return;
+        }
+
+        int64_t now = nowUs();
+        uint32_t packetSsrc = ntohl(header->ssrc);
+        uint16_t sequence = ntohs(header->sequence);
+        if (!synced || (packetSsrc != ssrc && now - lastPacketUs > 1000000)) {
+            // New stream, or the sender restarted
+            synced = true;
+            ssrc = packetSsrc;
+            nextSequence = sequence;
+            hasTransit = false;
+            jitter = 0.0;
+#ifdef NET_AUDIO_OPUS
+            if (decoder) {
+                opus_decoder_ctl(decoder, OPUS_RESET_STATE);
+            }
+#endif
+        } else if (packetSsrc != ssrc) {
+            return;
+        }
+        lastPacketUs = now;
+
+        int16_t gap = sequence - nextSequence;
+        if (gap < 0) {
+            stats.late.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        nextSequence = sequence + 1;
+        stats.packets.fetch_add(1, std::memory_order_relaxed);
+        if (gap > 0) {
+            stats.lost.fetch_add(gap, std::memory_order_relaxed);
+            for (uint32_t i = 0; i < std::min<uint32_t>(gap, MAX_CONCEAL) && lastPacketFrames; i++) {
+#ifdef NET_AUDIO_OPUS
+                if (format == NetAudio::OPUS && decoder) {
+                    int count = opus_decode_float(decoder, NULL, 0, frames, lastPacketFrames, 0);
+                    if (count > 0) {
+                        push(frames, count);
+                    }
+                    continue;
+                }
+#endif
+                memset(frames, 0, lastPacketFrames * channels * sizeof(float));
+                push(frames, lastPacketFrames);
+            }
+        }
+
+        uint32_t count = 0;
+        if (format == NetAudio::OPUS) {
+#ifdef NET_AUDIO_OPUS
+            int decoded = decoder ? opus_decode_float(decoder, packet + offset, len - offset, frames, MAX_PACKET_FRAMES, 0) : -1;
+            count = decoded > 0 ? decoded : 0;
+#endif
+        } else {
+            count = std::min<uint32_t>((len - offset) / (streamChannels * NetAudio::sampleSize(format)), MAX_PACKET_FRAMES);
+            NetAudio::decode(format, packet + offset, count, streamChannels, frames, channels);
+        }
+        if (!count) {
+            return;
+        }
+        push(frames, count);
+        lastPacketFrames = count;
+        packetFrames.store(count, std::memory_order_relaxed);
+
+        // Interarrival jitter as in RFC 3550, in frames
+        int32_t transit = (int32_t)(uint32_t)(now * props.sampleRate / 1000000) - (int32_t)ntohl(header->timestamp);
+        if (hasTransit) {
+            jitter += (std::abs((double)(transit - lastTransit)) - jitter) / 16.0;
+        }
+        lastTransit = transit;
+        hasTransit = true;
+        uint32_t target = count + 3 * jitter;
+        targetFrames.store(std::max(minFrames, std::min(maxFrames, target)), std::memory_order_relaxed);
+        stats.jitterMs.store(jitter * 1000.0 / props.sampleRate, std::memory_order_relaxed);
+    }
+
+    void receiverLoop()
+    {
+        uint8_t packet[2048];
+        std::vector<float> frames(MAX_PACKET_FRAMES * channels);
+        struct pollfd fds[2] = { { fd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
+        while (true) {
+            if (poll(fds, 2, -1) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                logError("AudioInputNetwork: poll failed: %s", strerror(errno));
+                return;
+            }
+            if (fds[1].revents) {
+                return;
+            }
+            ssize_t len;
+            while ((len = recv(fd, packet, sizeof(packet), 0)) > 0) {
+                receive(packet, len, frames.data());
+            }
+        }
+    }
+
+    void silence(float* out, float* right, uint32_t stride, uint32_t frames)
+    {
+        for (uint32_t f = 0; f < frames; f++) {
+            out[f * stride] = 0.0f;
+            right[f * stride] = 0.0f;
+        }
+    }
+
+    // Consume the frames of the ring beyond `keep`
+    void skip(uint32_t fill, uint32_t keep)
+    {
+        while (fill > keep) {
+            uint32_t count = std::min<uint32_t>(fill - keep, input.size() / channels);
+            ring.read(input.data(), count * channels);
+            fill -= count;
+        }
+    }
+
+    void play(float* out, float* right, uint32_t stride, uint32_t frames)
+    {
+        uint32_t fill = ring.available() / channels;
+        uint32_t packet = packetFrames.load(std::memory_order_relaxed);
+        uint32_t target = std::max<uint32_t>(targetFrames.load(std::memory_order_relaxed), underrunFrames);
+        underrunFrames = std::max(0.0f, underrunFrames - frames * 0.001f);
+
+        if (buffering) {
+            if (fill < target + frames) {
+                silence(out, right, stride, frames);
+                return;
+            }
+            buffering = false;
+            skip(fill, target + frames);
+            fill = target + frames;
+            averageFill = fill;
+            phase = 0.0;
+            last[0] = last[1] = 0.0f;
+        } else if (fill > maxFrames + packet + frames) {
+            // A burst after the sender stalled, catch up instead of keeping the latency
+            skip(fill, target + frames);
+            fill = target + frames;
+            averageFill = fill;
+        }
+        averageFill += (fill - averageFill) * 0.005;
+        stats.latencyMs.store(averageFill * 1000.0 / props.sampleRate, std::memory_order_relaxed);
+
+        // The buffer error is caught up over about 2 seconds
+        double correction = (averageFill - (target + frames)) / (2.0 * props.sampleRate);
+        double ratio = 1.0 + std::max(-0.005, std::min(0.005, correction));
+        double end = phase + frames * ratio;
+        uint32_t needed = end;
+        if (needed > fill) {
+            stats.underruns.fetch_add(1, std::memory_order_relaxed);
+            underrunFrames = std::min<float>(maxFrames, target + packet);
+            buffering = true;
+            silence(out, right, stride, frames);
+            return;
+        }
+        ring.read(input.data(), needed * channels);
+
+        // Linear interpolation between the frames read, `last` being the frame before the first one
+        bool stereo = isStereo();
+        for (uint32_t f = 0; f < frames; f++) {
+            double position = phase + f * ratio;
+            uint32_t index = position;
+            float frac = position - index;
+            float values[2];
+            for (uint8_t c = 0; c < channels; c++) {
+                float a = index == 0 ? last[c] : input[(index - 1) * channels + c];
+                float b = index < needed ? input[index * channels + c] : a;
+                values[c] = a + (b - a) * frac;
+            }
+            if (channels == 1) {
+                out[f * stride] = values[0];
+            } else if (stereo) {
+                out[f * stride] = values[0];
+                right[f * stride] = values[1];
+            } else {
+                out[f * stride] = (values[0] + values[1]) * 0.5f;
+            }
+        }
+        if (needed) {
+            for (uint8_t c = 0; c < channels; c++) {
+                last[c] = input[(needed - 1) * channels + c];
+            }
+        }
+        phase = end - needed;
+    }
+
+public:
+    AudioInputNetwork(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : AudioPlugin(props, config)
+    {
+        auto& json = config.json;
+        /*md - `port` is the UDP port the stream is received on. Default is 5004. */
+        uint16_t port = json.value("port", NetAudio::DEFAULT_PORT);
+        /*md - `group` is the multicast group to join, when the sender streams to one. */
+        std::string group = json.value("group", "");
+        /*md - `channels` is 1 or 2, a stereo stream being mixed down on a mono track. Default is 2 when the host buffer is stereo. */
+        channels = json.value("channels", hasStereoBuffer() ? 2 : 1) == 2 ? 2 : 1;
+        /*md - `minLatencyMs` is the least audio buffered before playing. Default is 2ms. */
+        minFrames = json.value("minLatencyMs", 2.0f) * props.sampleRate / 1000;
+        /*md - `maxLatencyMs` is the most audio buffered to ride out the jitter. Default is 100ms. */
+        maxFrames = std::min<uint32_t>(json.value("maxLatencyMs", 100.0f) * props.sampleRate / 1000, RING_SIZE / channels / 2);
+        targetFrames = minFrames;
+
+        uint32_t blockFrames = props.blockSize + props.blockSize / 64 + 2;
+        input.resize(std::max(blockFrames, maxFrames) * channels);
+
+#ifdef NET_AUDIO_OPUS
+        int error;
+        decoder = opus_decoder_create(props.sampleRate, channels, &error);
+        if (!decoder) {
+            logWarn("AudioInputNetwork: Opus decoder failed: %s", opus_strerror(error));
+        }
+#endif
+
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+        // Room for a burst of packets while the receiver thread is not scheduled
+        int bufferSize = 256 * 1024;
+        setsockopt(fd, SOL_SOCKET, SO_RCVBUF, &bufferSize, sizeof(bufferSize));
+        struct sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_port = htons(port);
+        addr.sin_addr.s_addr = htonl(INADDR_ANY);
+        if (fd < 0 || bind(fd, (struct sockaddr*)&addr, sizeof(addr)) < 0) {
+            logError("AudioInputNetwork: cannot listen on port %d: %s", port, strerror(errno));
+            return;
+        }
+        if (!group.empty()) {
+            struct ip_mreq mreq = {};
+            mreq.imr_interface.s_addr = htonl(INADDR_ANY);
+            if (inet_pton(AF_INET, group.c_str(), &mreq.imr_multiaddr) != 1
+                || setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &mreq, sizeof(mreq)) < 0) {
+                logWarn("AudioInputNetwork: cannot join %s: %s", group.c_str(), strerror(errno));
+            }
+        }
+
+        stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        receiverThread = std::thread([this] { receiverLoop(); });
+        pthread_setname_np(receiverThread.native_handle(), "netAudioIn");
+        logInfo("AudioInputNetwork: receiving track %d on port %d", track, port);
+    }
+
+    ~AudioInputNetwork()
+    {
+        if (receiverThread.joinable()) {
+            uint64_t one = 1;
+            if (write(stopFd, &one, sizeof(one)) == sizeof(one)) {
+                receiverThread.join();
+            } else {
+                receiverThread.detach();
+            }
+        }
+        for (int* watched : { &fd, &stopFd }) {
+            if (*watched >= 0) {
+                close(*watched);
+            }
+        }
+#ifdef NET_AUDIO_OPUS
+        if (decoder) {
+            opus_decoder_destroy(decoder);
+        }
+#endif
+    }
+
+    bool isStereo() override
+    {
+        return channels == 2 && hasStereoBuffer();
+    }
+
+    void sample(float* buf) override
+    {
+        sampleBlock(buf, 1);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* out = trackLane(buf, track);
+        float* right = rightLane(buf, track);
+        while (frames) {
+            uint32_t count = std::min(frames, props.blockSize);
+            play(out, right, stride, count);
+            out += count * stride;
+            right += count * stride;
+            frames -= count;
+        }
+    }
+
+    enum DATA_ID {
+        STATS,
+    };
+
+    /*md **Data ID**: */
+    uint8_t getDataId(std::string name) override
+    {
+        /*md - `STATS` return the stream statistics, see `NetAudio::Stats` */
+        if (name == "STATS")
+            return STATS;
+        return atoi(name.c_str());
+    }
+
+    void* data(int id, void* userdata = NULL) override
+    {
+        if (id == STATS) {
+            stats.copy(statsCopy);
+            return &statsCopy;
+        }
+        return NULL;
+    }
+};
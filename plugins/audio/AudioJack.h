@@ -0,0 +1,305 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <cstring>
+#include <jack/jack.h>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "host/XrunLog.h"
+#include "host/constants.h"
+#include "audioPlugin.h"
+#include "log.h"
+
+/*md
+## AudioJack
+
+AudioJack plugin is used to run ZicBox as a JACK client (PipeWire provides the JACK API as well). Instead of the host
+pushing the audio through a blocking write, the JACK process callback drives the audio loop: each callback renders
+the blocks it needs, so ZicBox runs next to a DAW with the server buffer size (e.g. 64 frames).
+
+Each track listed in `outputs` gets its own output port (a left and right port for stereo tracks), so the tracks can
+be recorded as stems. The capture ports replace the audio of the plugin track, after its output port got it.
+
+Use a host `blockSize` equal to the JACK buffer size to avoid any extra latency: with a different size, the blocks
+are queued to fill each period.
+*/
+class AudioJack : public AudioPlugin {
+protected:
+    jack_client_t* client = NULL;
+    std::string clientName = "zic";
+    bool autoConnect = true;
+
+    struct Output {
+        uint8_t track;
+        jack_port_t* left;
+        jack_port_t* right;
+        std::vector<float> fifo[2];
+    };
+    std::vector<Output> outputs;
+    std::vector<jack_port_t*> inputs;
+    std::vector<float> inputFifo[2];
+
+    // Frames queued in the fifos, the outputs being rendered ahead when the period is not a multiple of the block
+    uint32_t outputFrames = 0;
+    uint32_t inputFrames = 0;
+    uint32_t fifoSize = 0;
+
+    std::function<bool()> render;
+    std::mutex stopMtx;
+    std::condition_variable stopCv;
+    std::atomic<bool> stopped = false;
+
+    static int processCallback(jack_nframes_t nframes, void* arg)
+    {
+        return ((AudioJack*)arg)->process(nframes);
+    }
+
+    static int bufferSizeCallback(jack_nframes_t nframes, void* arg)
+    {
+        ((AudioJack*)arg)->resizeFifos(nframes);
+        return 0;
+    }
+
+    static int xrunCallback(void* arg)
+    {
+        AudioJack* plugin = (AudioJack*)arg;
+        if (plugin->props.audioPluginHandler) {
+            plugin->props.audioPluginHandler->reportXrun(XrunLog::XRUN);
+        }
+        return 0;
+    }
+
+    static void shutdownCallback(void* arg)
+    {
+        logWarn("JACK server shut down");
+        ((AudioJack*)arg)->stop();
+    }
+
+    void stop()
+    {
+        std::lock_guard<std::mutex> guard(stopMtx);
+        stopped = true;
+        stopCv.notify_all();
+    }
+
+    // Not called while the process callback runs
+    void resizeFifos(jack_nframes_t nframes)
+    {
+        fifoSize = nframes + props.blockSize;
+        for (Output& output : outputs) {
+            output.fifo[0].assign(fifoSize, 0.0f);
+            output.fifo[1].assign(fifoSize, 0.0f);
+        }
+        inputFifo[0].assign(fifoSize, 0.0f);
+        inputFifo[1].assign(fifoSize, 0.0f);
+        outputFrames = 0;
+        inputFrames = 0;
+        logDebug("JACK buffer size %u frames, host block %u frames", nframes, props.blockSize);
+    }
+
+    int process(jack_nframes_t nframes)
+    {
+        if (nframes > fifoSize) {
+            return 0;
+        }
+        if (inputFrames + nframes > fifoSize) {
+            // More input queued than rendered, drop it to catch up
+            inputFrames = 0;
+        }
+        for (size_t i = 0; i < inputs.size(); i++) {
+            float* in = (float*)jack_port_get_buffer(inputs[i], nframes);
+            memcpy(inputFifo[i].data() + inputFrames, in, nframes * sizeof(float));
+        }
+        inputFrames = inputs.size() ? inputFrames + nframes : 0;
+
+        // Each rendered block reaches `sampleBlock()`, queuing the outputs and consuming the inputs
+        while (outputFrames < nframes) {
+            if (stopped || !render()) {
+                stop();
+                for (Output& output : outputs) {
+                    memset(jack_port_get_buffer(output.left, nframes), 0, nframes * sizeof(float));
+                    if (output.right) {
+                        memset(jack_port_get_buffer(output.right, nframes), 0, nframes * sizeof(float));
+                    }
+                }
+                return 0;
+            }
+        }
+
+        for (Output& output : outputs) {
+            jack_port_t* ports[2] = { output.left, output.right };
+            for (int c = 0; c < 2 && ports[c]; c++) {
+                std::vector<float>& fifo = output.fifo[c];
+                memcpy(jack_port_get_buffer(ports[c], nframes), fifo.data(), nframes * sizeof(float));
+                memmove(fifo.data(), fifo.data() + nframes, (outputFrames - nframes) * sizeof(float));
+            }
+        }
+        outputFrames -= nframes;
+        return 0;
+    }
+
+    // Connect the first output to the playback ports of the sound card and the inputs to its capture ports
+    void connectPhysicalPorts()
+    {
+        const char** playback = jack_get_ports(client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsInput);
+        if (playback && !outputs.empty()) {
+            Output& master = outputs[0];
+            for (int c = 0; c < 2 && playback[c]; c++) {
+                jack_port_t* port = c == 1 && master.right ? master.right : master.left;
+                jack_connect(client, jack_port_name(port), playback[c]);
+            }
+        }
+        jack_free(playback);
+
+        const char** capture = jack_get_ports(client, NULL, JACK_DEFAULT_AUDIO_TYPE, JackPortIsPhysical | JackPortIsOutput);
+        if (capture) {
+            for (size_t i = 0; i < inputs.size() && capture[i]; i++) {
+                jack_connect(client, capture[i], jack_port_name(inputs[i]));
+            }
+        }
+        jack_free(capture);
+    }
+
+    jack_port_t* registerPort(std::string name, unsigned long flags)
+    {
+        jack_port_t* port = jack_port_register(client, name.c_str(), JACK_DEFAULT_AUDIO_TYPE, flags, 0);
+        if (!port) {
+            logError("Failed to register JACK port %s", name.c_str());
+        }
+        return port;
+    }
+
+public:
+    AudioJack(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : AudioPlugin(props, config)
+    {
+        auto& json = config.json;
+        /*md - `client` is the name of the JACK client. Default is `zic`. */
+        clientName = json.value("client", clientName);
+        /*md - `outputs` is the list of tracks having an output port, e.g. `[0, 1, 2]`. Default is the plugin track. */
+        std::vector<uint8_t> outputTracks = json.value("outputs", std::vector<uint8_t> { (uint8_t)track });
+        /*md - `inputs` is the number of capture ports, 0, 1 or 2 (left and right of a stereo track). Default is 0. */
+        uint8_t inputCount = std::min(json.value("inputs", 0), 2);
+        /*md - `autoConnect` if true, the first output and the inputs are connected to the sound card ports. Default is true. */
+        autoConnect = json.value("autoConnect", autoConnect);
+
+        jack_status_t status;
+        client = jack_client_open(clientName.c_str(), JackNoStartServer, &status);
+        if (!client) {
+            logError("Failed to connect to the JACK server (status 0x%x)", status);
+            return;
+        }
+        if (jack_get_sample_rate(client) != props.sampleRate) {
+            logWarn("JACK sample rate %u differs from host sample rate %u", jack_get_sample_rate(client), props.sampleRate);
+        }
+
+        for (uint8_t id : outputTracks) {
+            std::string name = "track" + std::to_string(id);
+            bool stereo = hasStereoBuffer() && (id == track || isStereoTrack(id));
+            outputs.push_back({ id,
+                registerPort(stereo ? name + "_left" : name, JackPortIsOutput),
+                stereo ? registerPort(name + "_right", JackPortIsOutput) : NULL });
+        }
+        for (uint8_t i = 0; i < inputCount; i++) {
+            inputs.push_back(registerPort("input" + std::to_string(i + 1), JackPortIsInput));
+        }
+        resizeFifos(jack_get_buffer_size(client));
+
+        jack_set_process_callback(client, processCallback, this);
+        jack_set_buffer_size_callback(client, bufferSizeCallback, this);
+        jack_set_xrun_callback(client, xrunCallback, this);
+        jack_on_shutdown(client, shutdownCallback, this);
+    }
+
+    ~AudioJack()
+    {
+        if (client) {
+            jack_client_close(client);
+        }
+    }
+
+    virtual bool isSink() { return true; }
+
+    bool isStereo() override
+    {
+        return hasStereoBuffer();
+    }
+
+    std::set<uint8_t> trackDependencies() override
+    {
+        std::set<uint8_t> dependencies = {};
+        for (Output& output : outputs) {
+            if (output.track != track) {
+                dependencies.insert(output.track);
+            }
+        }
+        return dependencies;
+    }
+
+    bool drivesAudioLoop() override
+    {
+        return client != NULL;
+    }
+
+    void runAudioLoop(std::function<bool()> renderBlock) override
+    {
+        render = renderBlock;
+        if (jack_activate(client)) {
+            logError("Failed to activate JACK client %s", clientName.c_str());
+            return;
+        }
+        if (autoConnect) {
+            connectPhysicalPorts();
+        }
+        std::unique_lock<std::mutex> lock(stopMtx);
+        stopCv.wait(lock, [&] { return stopped.load(); });
+        lock.unlock();
+        jack_deactivate(client);
+    }
+
+    void sample(float* buf) override
+    {
+        sampleBlock(buf, 1);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        uint32_t count = std::min(frames, fifoSize - outputFrames);
+        for (Output& output : outputs) {
+            float* lanes[2] = { trackLane(buf, output.track), rightLane(buf, output.track) };
+            for (int c = 0; c < 2 && (c == 0 || output.right); c++) {
+                float* fifo = output.fifo[c].data() + outputFrames;
+                for (uint32_t f = 0; f < count; f++) {
+                    fifo[f] = lanes[c][f * stride];
+                }
+            }
+        }
+        outputFrames += count;
+
+        if (inputs.empty()) {
+            return;
+        }
+        float* out = trackLane(buf, track);
+        float* right = rightLane(buf, track);
+        uint32_t available = std::min(frames, inputFrames);
+        for (uint32_t f = 0; f < frames; f++) {
+            float left = f < available ? inputFifo[0][f] : 0.0f;
+            float second = inputs.size() > 1 && f < available ? inputFifo[1][f] : left;
+            if (right == out) {
+                out[f * stride] = (left + second) * 0.5f;
+            } else {
+                out[f * stride] = left;
+                right[f * stride] = second;
+            }
+        }
+        for (size_t i = 0; i < inputs.size(); i++) {
+            memmove(inputFifo[i].data(), inputFifo[i].data() + available, (inputFrames - available) * sizeof(float));
+        }
+        inputFrames -= available;
+    }
+};
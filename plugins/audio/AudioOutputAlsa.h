@@ -23,25 +23,93 @@ public:
     }
 
     void sample(float* buf) override
+    {
+        float* lane = buf;
+        float* right = lane;
+        uint32_t stride = 1;
+        write(lane, right, stride, resampleBlock(lane, right, stride, 1));
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        float* lane = trackLane(buf, 0);
+        float* right = rightLane(buf, 0);
+        uint32_t stride = props.frameStride;
+        frames = resampleBlock(lane, right, stride, frames);
+        write(lane, right, stride, frames);
+    }
+
+    // Write the right lane of the track to the second channel, when the buffer is stereo
+    bool isStereo() override
+    {
+        return hasStereoBuffer();
+    }
+
+    uint8_t getDataId(std::string name) override
+    {
+        if (name == "PCM") {
+            return 0;
+        }
+        if (name == "DELAY") {
+            return 1;
+        }
+        return atoi(name.c_str());
+    }
+
+    // The playback PCM, for AudioInputAlsa to link its capture stream to, see `duplex`, and the frames queued in the
+    // device, for LatencyProbe
+    void* data(int id, void* userdata = NULL) override
+    {
+        if (id == 0) {
+            return handle;
+        }
+        if (id == 1) {
+            delay = queuedFrames();
+            return &delay;
+        }
+        return NULL;
+    }
+
+protected:
+    snd_pcm_sframes_t delay = 0;
+
+    void write(float* lane, float* right, uint32_t stride, uint32_t frames)
     {
         if (!handle)
             return;
 
-        // append one sample
-        float v = *buf;
-        reinterpret_cast<float*>(buffer.data())[sampleIndex++] = v;
-
-        if (channels == CHANNEL_STEREO) {
-            reinterpret_cast<float*>(buffer.data())[sampleIndex++] = v;
+        if (useMmap) {
+            uint32_t f = 0;
+            while (f < frames) {
+                snd_pcm_uframes_t offset, n = frames - f;
+                float* out = (float*)mmapBegin(n, offset);
+                if (!out) {
+                    return;
+                }
+                for (uint32_t i = 0; i < n; i++, f++) {
+                    *out++ = lane[f * stride];
+                    if (channels == CHANNEL_STEREO) {
+                        *out++ = right[f * stride];
+                    }
+                }
+                mmapCommit(offset, n);
+            }
+            return;
         }
 
+        float* out = reinterpret_cast<float*>(buffer.data());
         const uint32_t samplesPerChunk = chunkFrames * channels;
-        if (sampleIndex >= samplesPerChunk) {
-            flushBuffer(buffer.data(), chunkFrames);
+        for (uint32_t f = 0; f < frames; f++) {
+            out[sampleIndex++] = lane[f * stride];
+            if (channels == CHANNEL_STEREO) {
+                out[sampleIndex++] = right[f * stride];
+            }
+            if (sampleIndex >= samplesPerChunk) {
+                flushBuffer(buffer.data(), chunkFrames);
+            }
         }
     }
 
-protected:
     void resizeBuffer() override
     {
         buffer.resize(chunkFrames * channels * sizeof(float));
@@ -0,0 +1,161 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "AudioAlsa.h"
+#include "audio/utils/float4.h"
+
+/*md
+## AudioOutputAlsaMulti
+
+AudioOutputAlsaMulti audio plugin plays several tracks on the outputs of a multi-channel sound card, through a
+single PCM, instead of one `AudioOutputAlsa` per pair of outputs, each with its own PCM, its own buffer and its own
+blocking write. Each block, the lanes of the tracks are interleaved once in the frames of the card, 4 channels at a
+time with SSE2 or NEON, written straight into the buffer of the card with `mmap`. Place it on the master track, the
+tracks it plays being computed before.
+
+```json
+{ "plugin": "AudioOutputAlsaMulti", "device": "hw:1,0", "channelMap": [0, "0R", 1, 2, "3", "3R"] }
+```
+*/
+class AudioOutputAlsaMulti : public AudioAlsa {
+protected:
+    struct Output {
+        int16_t track = -1;
+        bool right = false;
+    };
+    // Source of each channel of the card, -1 for silence
+    std::vector<Output> outputs;
+    // First sample of the source of each channel for the current block, next ones `props.frameStride` apart
+    std::vector<float*> lanes;
+    std::vector<float> silence;
+
+    // Interleave `frames` frames of the lanes, from `from`, in `out`, a frame being `channels` floats
+    void interleave(float* out, uint32_t from, uint32_t frames)
+    {
+        const uint32_t stride = props.frameStride;
+        uint32_t c = 0;
+        for (; c + 4 <= channels; c += 4) {
+            const float* a = lanes[c] + from * stride;
+            const float* b = lanes[c + 1] + from * stride;
+            const float* d = lanes[c + 2] + from * stride;
+            const float* e = lanes[c + 3] + from * stride;
+            uint32_t f = 0;
+            for (; f + float4::WIDTH <= frames; f += float4::WIDTH) {
+                uint32_t i = f * stride;
+                float4::interleave(float4::load(a + i, stride), float4::load(b + i, stride), float4::load(d + i, stride),
+                    float4::load(e + i, stride), out + f * channels + c, channels);
+            }
+            for (; f < frames; f++) {
+                float* frame = out + f * channels + c;
+                uint32_t i = f * stride;
+                frame[0] = a[i];
+                frame[1] = b[i];
+                frame[2] = d[i];
+                frame[3] = e[i];
+            }
+        }
+        for (; c < channels; c++) {
+            const float* lane = lanes[c] + from * stride;
+            for (uint32_t f = 0; f < frames; f++) {
+                out[f * channels + c] = lane[f * stride];
+            }
+        }
+    }
+
+public:
+    AudioOutputAlsaMulti(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : AudioAlsa(props, config, SND_PCM_STREAM_PLAYBACK)
+    {
+        auto& json = config.json;
+        //md **Config**:
+        //md - `"channelMap": [0, "0R", 1, 2]` the source of each channel of the card, in order: a track plays its left lane, or its mono signal, `"0R"` the right lane of track 0, and -1 leaves the channel silent. The PCM is opened with as many channels. Default is the tracks 0 and 1, on 2 channels.
+        if (json.contains("channelMap") && json["channelMap"].is_array()) {
+            for (auto& entry : json["channelMap"]) {
+                Output output;
+                if (entry.is_string()) {
+                    std::string name = entry.get<std::string>();
+                    output.track = atoi(name.c_str());
+                    output.right = !name.empty() && (name.back() == 'R' || name.back() == 'r');
+                } else {
+                    output.track = entry.get<int>();
+                }
+                if (output.track >= (int)props.maxTracks) {
+                    logWarn("AudioOutputAlsaMulti: track %d out of range, channel %zu left silent", output.track, outputs.size());
+                    output.track = -1;
+                }
+                outputs.push_back(output);
+            }
+        } else {
+            outputs = { { 0, false }, { 1, false } };
+        }
+        //md - `"mmap": true` write straight into the buffer of the card. Default is true, set it to false for the devices not supporting it.
+        useMmap = json.value("mmap", true);
+        //md - The other settings are the ones of `AudioOutputAlsa`: `device`, `latency`, `periodSize`, `periodCount` and `deviceClock`. The card must run at the engine sample rate, `resample` is not supported.
+        if (resampleQuality >= 0) {
+            logWarn("AudioOutputAlsaMulti: built-in resampling not supported, letting ALSA resample");
+            resampleQuality = -1;
+        }
+
+        deviceChannels = outputs.size();
+        lanes.resize(outputs.size());
+        silence.resize(chunkFrames * props.frameStride, 0.0f);
+        open(SND_PCM_FORMAT_FLOAT);
+    }
+
+    std::set<uint8_t> trackDependencies() override
+    {
+        std::set<uint8_t> tracks;
+        for (Output& output : outputs) {
+            if (output.track >= 0 && output.track != track) {
+                tracks.insert(output.track);
+            }
+        }
+        return tracks;
+    }
+
+    // Only the block path is supported, the card being written once per block
+    void sample(float* buf) override
+    {
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (!handle) {
+            return;
+        }
+        frames = std::min<uint32_t>(frames, chunkFrames);
+        for (size_t c = 0; c < outputs.size(); c++) {
+            Output& output = outputs[c];
+            lanes[c] = output.track < 0 ? silence.data()
+                : output.right          ? rightLane(buf, output.track)
+                                        : trackLane(buf, output.track);
+        }
+
+        if (useMmap) {
+            uint32_t f = 0;
+            while (f < frames) {
+                snd_pcm_uframes_t offset, n = frames - f;
+                float* out = (float*)mmapBegin(n, offset);
+                if (!out) {
+                    return;
+                }
+                interleave(out, f, n);
+                mmapCommit(offset, n);
+                f += n;
+            }
+            return;
+        }
+        interleave((float*)buffer.data(), 0, frames);
+        flushBuffer(buffer.data(), frames);
+        // The rest of a partial write is dropped, the next block being already due
+        sampleIndex = 0;
+    }
+
+protected:
+    void resizeBuffer() override
+    {
+        buffer.resize(chunkFrames * channels * sizeof(float));
+    }
+};
@@ -7,9 +7,9 @@ This component is dedicated to handling digital audio playback in a very specifi
 
 1.  **Setup for Playback:** Upon initialization, it configures the underlying ALSA system for audio output (playback) and sets the exact data type the sound card should expect—a 16-bit integer format, which corresponds to standard CD-quality audio.
 
-2.  **Sample Conversion:** Audio processing systems typically use high-resolution floating-point numbers (like -1.0 to 1.0) to represent volume. When the component receives a new audio sample (via the `sample` method), it performs a critical conversion:
+2.  **Sample Conversion:** Audio processing systems typically use high-resolution floating-point numbers (like -1.0 to 1.0) to represent volume. Each block is converted in a single vectorized pass:
     *   It first ensures the volume level is safe (clamping), preventing distortion or errors.
-    *   It then converts the floating-point value into a discrete 16-bit integer. This conversion is necessary because sound cards understand integers, not floats.
+    *   It then adds a small dither noise (optionally noise shaped) and converts the floating-point value into a discrete 16-bit integer. This conversion is necessary because sound cards understand integers, not floats, and the dither keeps quiet sounds from turning into distortion.
 
 3.  **Buffering and Delivery:** The newly converted 16-bit sample is immediately stored in an internal memory area (a buffer). If the audio is stereo, the sample is duplicated for the second channel. Once this buffer is completely filled, the entire batch of sound data is efficiently "flushed" (sent) to the ALSA driver, ensuring a continuous and smooth flow of sound to the speakers.
 
@@ -19,37 +19,103 @@ sha: a509cc11338ca7c8073dbfaf862f23156dcdcb367dfa3deaf77fda05252c6b79
 */
 #pragma once
 #include "AudioAlsa.h"
-#include "helpers/clamp.h"
+#include "audio/utils/Int16Converter.h"
 
 class AudioOutputAlsa_int16 : public AudioAlsa {
 public:
     AudioOutputAlsa_int16(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : AudioAlsa(props, config, SND_PCM_STREAM_PLAYBACK)
     {
+        /*md - `dither` is how the samples are rounded to 16 bits: `tpdf` (default) adds a triangular dither of 1 LSB, `shaped` also shapes its noise toward the high frequencies, `none` only rounds. */
+        converter.setDither(Int16Converter::getDither(config.json.value("dither", "tpdf")));
         open(SND_PCM_FORMAT_S16_LE);
     }
 
     void sample(float* buf) override
+    {
+        float* lane = buf + track;
+        float* right = lane;
+        uint32_t stride = 1;
+        write(lane, right, stride, resampleBlock(lane, right, stride, 1));
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        float* lane = trackLane(buf, track);
+        float* right = rightLane(buf, track);
+        uint32_t stride = props.frameStride;
+        frames = resampleBlock(lane, right, stride, frames);
+        write(lane, right, stride, frames);
+    }
+
+    // Write the right lane of the track to the second channel, when the buffer is stereo
+    bool isStereo() override
+    {
+        return hasStereoBuffer();
+    }
+
+    uint8_t getDataId(std::string name) override
+    {
+        if (name == "PCM") {
+            return 0;
+        }
+        if (name == "DELAY") {
+            return 1;
+        }
+        return atoi(name.c_str());
+    }
+
+    // Like AudioOutputAlsa: the playback PCM for a duplex AudioInputAlsa, and the frames queued in the device
+    void* data(int id, void* userdata = NULL) override
+    {
+        if (id == 0) {
+            return handle;
+        }
+        if (id == 1) {
+            delay = queuedFrames();
+            return &delay;
+        }
+        return NULL;
+    }
+
+protected:
+    Int16Converter converter;
+    snd_pcm_sframes_t delay = 0;
+
+    void write(float* lane, float* right, uint32_t stride, uint32_t frames)
     {
         if (!handle)
             return;
 
-        // clamp and convert float → int16
-        float v = CLAMP(buf[track], -1.0f, 1.0f);
-        int16_t v16 = static_cast<int16_t>(v * 32767.0f);
-        reinterpret_cast<int16_t*>(buffer.data())[sampleIndex++] = v16;
-
-        if (channels == CHANNEL_STEREO) {
-            reinterpret_cast<int16_t*>(buffer.data())[sampleIndex++] = v16;
+        if (useMmap) {
+            uint32_t f = 0;
+            while (f < frames) {
+                snd_pcm_uframes_t offset, n = frames - f;
+                int16_t* out = (int16_t*)mmapBegin(n, offset);
+                if (!out) {
+                    return;
+                }
+                converter.process(lane + f * stride, right + f * stride, stride, n, out, channels);
+                f += n;
+                mmapCommit(offset, n);
+            }
+            return;
         }
 
+        int16_t* out = reinterpret_cast<int16_t*>(buffer.data());
         const uint32_t samplesPerChunk = chunkFrames * channels;
-        if (sampleIndex >= samplesPerChunk) {
-            flushBuffer(buffer.data(), chunkFrames);
+        uint32_t f = 0;
+        while (f < frames) {
+            uint32_t n = std::min<uint32_t>(frames - f, (samplesPerChunk - sampleIndex) / channels);
+            converter.process(lane + f * stride, right + f * stride, stride, n, out + sampleIndex, channels);
+            sampleIndex += n * channels;
+            f += n;
+            if (sampleIndex >= samplesPerChunk) {
+                flushBuffer(buffer.data(), chunkFrames);
+            }
         }
     }
 
-protected:
     void resizeBuffer() override
     {
         buffer.resize(chunkFrames * channels * sizeof(int16_t));
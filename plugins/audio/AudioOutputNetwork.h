@@ -0,0 +1,273 @@
+#pragma once
+
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "audioPlugin.h"
+#include "helpers/SpscRing.h"
+#include "log.h"
+#include "utils/NetAudio.h"
+
+/*md
+## AudioOutputNetwork
+
+AudioOutputNetwork plugin is used to stream the audio of its track over the network as RTP/UDP, e.g. to a front of
+house computer, or to `AudioInputNetwork` on another unit. Any RTP receiver handling L16 can play the `int16` format,
+e.g. `ffplay` with an SDP file.
+
+```json
+{ "plugin": "AudioOutputNetwork", "host": "192.168.1.20", "port": 5004, "format": "int16" }
+```
+*/
+class AudioOutputNetwork : public AudioPlugin {
+protected:
+    // About 170ms of stereo frames at 48kHz
+    typedef SpscRing<float, 1 << 14> Ring;
+    Ring ring;
+    std::vector<float> block;
+
+    NetAudio::Format format = NetAudio::FLOAT32;
+    uint8_t channels = 1;
+    uint32_t packetFrames = 128;
+    uint32_t sinceWake = 0;
+
+    int fd = -1;
+    int wakeFd = -1;
+    struct sockaddr_storage destination = {};
+    socklen_t destinationLen = 0;
+    std::thread senderThread;
+    std::atomic<bool> running = false;
+
+    NetAudio::AtomicStats stats;
+    NetAudio::Stats statsCopy;
+
+#ifdef NET_AUDIO_OPUS
+    OpusEncoder* encoder = NULL;
+#endif
+
+    bool resolve(std::string host, uint16_t port)
+    {
+        struct addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo* result = NULL;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+            return false;
+        }
+        memcpy(&destination, result->ai_addr, result->ai_addrlen);
+        destinationLen = result->ai_addrlen;
+        freeaddrinfo(result);
+        return true;
+    }
+
+    void wakeSender()
+    {
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(one)) < 0) {
+            // Counter saturated, the sender is awake anyway
+        }
+    }
+
+    void senderLoop()
+    {
+        uint8_t packet[NetAudio::HEADER_SIZE + NetAudio::MAX_PAYLOAD];
+        NetAudio::Header* header = (NetAudio::Header*)packet;
+        header->flags = 0x80;
+        header->payloadType = NetAudio::payloadType(format, channels);
+        header->ssrc = htonl((uint32_t)rand());
+        uint16_t sequence = rand();
+        uint32_t timestamp = rand();
+
+        std::vector<float> frames(packetFrames * channels);
+        struct pollfd pfd = { wakeFd, POLLIN, 0 };
+        while (running) {
+            if (ring.available() < frames.size()) {
+                if (poll(&pfd, 1, 100) > 0) {
+                    uint64_t count;
+                    if (read(wakeFd, &count, sizeof(count)) < 0) {
+                        // Nothing to read, the ring is checked anyway
+                    }
+                }
+                continue;
+            }
+            ring.read(frames.data(), frames.size());
+
+            uint32_t payloadSize = packetFrames * channels * NetAudio::sampleSize(format);
+#ifdef NET_AUDIO_OPUS
+            if (format == NetAudio::OPUS) {
+                int size = opus_encode_float(encoder, frames.data(), packetFrames, packet + NetAudio::HEADER_SIZE, NetAudio::MAX_PAYLOAD);
+                if (size < 0) {
+                    stats.dropped.fetch_add(packetFrames, std::memory_order_relaxed);
+                    continue;
+                }
+                payloadSize = size;
+            } else
+#endif
+            {
+                NetAudio::encode(format, frames.data(), frames.size(), packet + NetAudio::HEADER_SIZE);
+            }
+            header->sequence = htons(sequence++);
+            header->timestamp = htonl(timestamp);
+            timestamp += packetFrames;
+            if (sendto(fd, packet, NetAudio::HEADER_SIZE + payloadSize, 0, (struct sockaddr*)&destination, destinationLen) >= 0) {
+                stats.packets.fetch_add(1, std::memory_order_relaxed);
+            } else {
+                stats.dropped.fetch_add(packetFrames, std::memory_order_relaxed);
+            }
+        }
+    }
+
+public:
+    AudioOutputNetwork(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : AudioPlugin(props, config)
+    {
+        auto& json = config.json;
+        /*md - `host` is the address the packets are sent to, a unicast or multicast IPv4 address, or a host name. Default is `127.0.0.1`. */
+        std::string host = json.value("host", "127.0.0.1");
+        /*md - `port` is the UDP port. Default is 5004. */
+        uint16_t port = json.value("port", NetAudio::DEFAULT_PORT);
+        /*md - `format` is `float`, `int16` (half the bandwidth) or `opus` (compressed, when built with libopus). Default is `float`. */
+        format = NetAudio::getFormat(json.value("format", "float"));
+        /*md - `channels` is 1 or 2, the right lane being sent as the second channel. Default is 2 when the host buffer is stereo. */
+        channels = json.value("channels", hasStereoBuffer() ? 2 : 1) == 2 ? 2 : 1;
+        /*md - `frames` is the number of frames per packet, the smaller the lower the latency. Default is 128, or 240 with Opus. With Opus it is rounded down to 2.5, 5, 10 or 20ms. */
+        packetFrames = json.value("frames", format == NetAudio::OPUS ? 240 : 128);
+        if (format != NetAudio::OPUS) {
+            uint32_t maxFrames = NetAudio::MAX_PAYLOAD / (channels * NetAudio::sampleSize(format));
+            packetFrames = std::max(16u, std::min(packetFrames, maxFrames));
+        }
+
+#ifdef NET_AUDIO_OPUS
+        if (format == NetAudio::OPUS) {
+            uint32_t opusFrames = props.sampleRate / 50;
+            while (opusFrames > props.sampleRate / 400 && opusFrames > packetFrames) {
+                opusFrames /= 2;
+            }
+            packetFrames = opusFrames;
+            int error;
+            encoder = opus_encoder_create(props.sampleRate, channels, OPUS_APPLICATION_RESTRICTED_LOWDELAY, &error);
+            if (!encoder) {
+                logError("AudioOutputNetwork: Opus encoder failed: %s", opus_strerror(error));
+                return;
+            }
+            /*md - `bitrate` is the Opus bitrate in bits per second. Default is 128000. */
+            opus_encoder_ctl(encoder, OPUS_SET_BITRATE(json.value("bitrate", 128000)));
+        }
+#endif
+
+        if (!resolve(host, port)) {
+            logError("AudioOutputNetwork: cannot resolve %s", host.c_str());
+            return;
+        }
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            logError("AudioOutputNetwork: socket failed: %s", strerror(errno));
+            return;
+        }
+        // Low latency traffic, see DSCP EF
+        int tos = 0xb8;
+        setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+        if (IN_MULTICAST(ntohl(((struct sockaddr_in*)&destination)->sin_addr.s_addr))) {
+            /*md - `ttl` is the number of routers a multicast stream can cross. Default is 1, the local network. */
+            unsigned char ttl = json.value("ttl", 1);
+            setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+        }
+
+        block.resize(props.blockSize * channels);
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        running = true;
+        senderThread = std::thread([this] { senderLoop(); });
+        pthread_setname_np(senderThread.native_handle(), "netAudioOut");
+        logInfo("AudioOutputNetwork: streaming track %d to %s:%d, %d frames per packet", track, host.c_str(), port, packetFrames);
+    }
+
+    ~AudioOutputNetwork()
+    {
+        if (running) {
+            running = false;
+            wakeSender();
+            senderThread.join();
+        }
+        for (int* watched : { &fd, &wakeFd }) {
+            if (*watched >= 0) {
+                close(*watched);
+            }
+        }
+#ifdef NET_AUDIO_OPUS
+        if (encoder) {
+            opus_encoder_destroy(encoder);
+        }
+#endif
+    }
+
+    bool isStereo() override
+    {
+        return channels == 2 && hasStereoBuffer();
+    }
+
+    void sample(float* buf) override
+    {
+        sampleBlock(buf, 1);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (!running) {
+            return;
+        }
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        float* right = rightLane(buf, track);
+        while (frames) {
+            uint32_t count = std::min<uint32_t>(frames, block.size() / channels);
+            for (uint32_t f = 0; f < count; f++) {
+                block[f * channels] = lane[f * stride];
+                if (channels == 2) {
+                    block[f * 2 + 1] = right[f * stride];
+                }
+            }
+            // Whole frames only, the sender reading packets of interleaved channels
+            if (ring.space() >= count * channels) {
+                ring.write(block.data(), count * channels);
+                sinceWake += count;
+            } else {
+                stats.dropped.fetch_add(count, std::memory_order_relaxed);
+            }
+            lane += count * stride;
+            right += count * stride;
+            frames -= count;
+        }
+        if (sinceWake >= packetFrames) {
+            sinceWake = 0;
+            wakeSender();
+        }
+    }
+
+    enum DATA_ID {
+        STATS,
+    };
+
+    /*md **Data ID**: */
+    uint8_t getDataId(std::string name) override
+    {
+        /*md - `STATS` return the stream statistics, see `NetAudio::Stats` */
+        if (name == "STATS")
+            return STATS;
+        return atoi(name.c_str());
+    }
+
+    void* data(int id, void* userdata = NULL) override
+    {
+        if (id == STATS) {
+            stats.copy(statsCopy);
+            return &statsCopy;
+        }
+        return NULL;
+    }
+};
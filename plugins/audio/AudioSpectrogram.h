@@ -1,53 +1,206 @@
 #pragma once
 
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <complex>
+#include <thread>
+#include <vector>
+
 #include "audioPlugin.h"
+#include "audio/utils/fft.h"
+#include "utils/StateSnapshot.h"
 
 /*md
 ## AudioSpectrogram
 
-AudioSpectrogram plugin is used to keep track of audio buffer.
+AudioSpectrogram plugin is used to keep track of audio buffer, and to analyse its spectrum.
 
+The audio thread only copies the track in a lock-free ring, the spectrum being computed by a worker thread, so the
+analysis never delays the audio. Each frame is published with the last samples in a triple buffer, the UI always
+getting a whole frame.
 */
 class AudioSpectrogram : public AudioPlugin {
+public:
+    struct Spectrum {
+        // Bins from 0 to the Nyquist frequency, `binHz` apart
+        uint32_t bins = 0;
+        float binHz = 0.0f;
+        // Magnitude of each bin, 1.0 for a full scale sine
+        const float* magnitudes = NULL;
+        // Incremented on each new frame
+        uint64_t frame = 0;
+    };
+
 protected:
-    float buffer[1024];
-    int bufferIndex = 0;
+    static const uint32_t BUFFER_SIZE = 1024;
+
+    RealFft fft;
+    uint32_t hop;
+    std::vector<float> window;
+    float windowGain = 1.0f;
+
+    // Written by the audio thread only
+    std::vector<float> ring;
+    uint64_t ringMask;
+    std::atomic<uint64_t> written = 0;
+
+    // Worker state
+    std::vector<float> frameSamples;
+    std::vector<std::complex<float>> bins;
+    uint64_t analysed = 0;
+    std::thread worker;
+    std::atomic<bool> running = true;
+
+    struct Frame {
+        std::vector<float> magnitudes;
+        Spectrum spectrum;
+        float buffer[BUFFER_SIZE] = {};
+    };
+    // Written by the worker, acquired by the UI
+    StateSnapshot<Frame> frames;
+
+    // Frame of the `size` samples before `end`
+    void analyse(uint64_t end)
+    {
+        uint32_t size = fft.size();
+        uint64_t start = end - size;
+        for (uint32_t n = 0; n < size; n++) {
+            frameSamples[n] = ring[(start + n) & ringMask] * window[n];
+        }
+        Frame& frame = frames.back();
+        for (uint32_t n = 0; n < BUFFER_SIZE; n++) {
+            frame.buffer[n] = end >= BUFFER_SIZE - n ? ring[(end - BUFFER_SIZE + n) & ringMask] : 0.0f;
+        }
+        // Skipped if the audio thread overwrote the samples while they were copied
+        uint64_t oldest = end - std::min(end, (uint64_t)std::max(size, BUFFER_SIZE));
+        if (written.load(std::memory_order_acquire) - oldest > ring.size()) {
+            return;
+        }
+        fft.forward(frameSamples.data(), bins.data());
+
+        float* out = frame.magnitudes.data();
+        for (uint32_t k = 0; k < fft.bins(); k++) {
+            out[k] = std::abs(bins[k]) * windowGain;
+        }
+        frame.spectrum.frame = end / hop;
+        frames.publish();
+    }
+
+    void workerLoop()
+    {
+        uint32_t size = fft.size();
+        auto interval = std::chrono::microseconds(std::max((uint64_t)1000, (uint64_t)hop * 1000000 / props.sampleRate));
+        while (running.load(std::memory_order_relaxed)) {
+            uint64_t end = written.load(std::memory_order_acquire);
+            // Too late for the frames already overwritten, skip to the most recent ones
+            if (end - analysed > ring.size() - hop) {
+                analysed = end - (end % hop);
+                if (analysed >= size) {
+                    analyse(analysed);
+                }
+            }
+            while (analysed + hop <= end) {
+                analysed += hop;
+                if (analysed >= size) {
+                    analyse(analysed);
+                }
+            }
+            std::this_thread::sleep_for(interval);
+        }
+    }
 
 public:
     AudioSpectrogram(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : AudioPlugin(props, config)
+        //md **Config**:
+        //md - `"size": 1024` samples of each analysed frame, a power of two from 64 to 8192.
+        , fft(std::clamp(config.json.value("size", 1024), 64, (int)RealFft::MAX_SIZE))
     {
+        //md - `"overlap": 4` frames analysed per frame size, from 1 to 8, e.g. 4 for a new frame every quarter of the size.
+        uint32_t overlap = std::clamp(config.json.value("overlap", 4), 1, 8);
+        uint32_t size = fft.size();
+        hop = std::max(size / overlap, (uint32_t)1);
+
+        window.resize(size);
+        float sum = 0.0f;
+        for (uint32_t n = 0; n < size; n++) {
+            window[n] = 0.5f - 0.5f * cosf(2.0f * M_PI * n / size);
+            sum += window[n];
+        }
+        windowGain = 2.0f / sum;
+
+        uint64_t ringSize = 1;
+        while (ringSize < 4 * std::max(size, BUFFER_SIZE)) {
+            ringSize <<= 1;
+        }
+        ring.assign(ringSize, 0.0f);
+        ringMask = ringSize - 1;
+
+        frameSamples.resize(size);
+        bins.resize(fft.bins());
+        frames.init([&](Frame& frame) {
+            frame.magnitudes.assign(fft.bins(), 0.0f);
+            frame.spectrum.bins = fft.bins();
+            frame.spectrum.binHz = props.sampleRate / (float)size;
+            frame.spectrum.magnitudes = frame.magnitudes.data();
+        });
+
+        worker = std::thread([this] { workerLoop(); });
+        pthread_setname_np(worker.native_handle(), "spectrogram");
+    }
+
+    ~AudioSpectrogram()
+    {
+        running = false;
+        if (worker.joinable()) {
+            worker.join();
+        }
     }
 
     void sample(float* buf)
     {
-        if (bufferIndex >= 1024) {
-            bufferIndex = 0;
+        uint64_t w = written.load(std::memory_order_relaxed);
+        ring[w & ringMask] = buf[track];
+        written.store(w + 1, std::memory_order_release);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        uint64_t w = written.load(std::memory_order_relaxed);
+        for (uint32_t f = 0; f < frames; f++) {
+            ring[(w + f) & ringMask] = lane[f * stride];
         }
-        buffer[bufferIndex++] = buf[track];
+        written.store(w + frames, std::memory_order_release);
     }
 
     enum DATA_ID {
         BUFFER,
+        SPECTRUM,
     };
 
-    /*md **Data ID**: */
+    /*md **Data ID**, the data being valid until the next call: */
     uint8_t getDataId(std::string name) override
     {
-        /*md - `BUFFER` return a representation of the current audio track */
+        /*md - `BUFFER` return the last 1024 samples of the track, the oldest first */
         if (name == "BUFFER")
             return BUFFER;
+        /*md - `SPECTRUM` return the last magnitude frame, see `AudioSpectrogram::Spectrum` */
+        if (name == "SPECTRUM")
+            return SPECTRUM;
         return atoi(name.c_str());
     }
 
     void* data(int id, void* userdata = NULL) override
     {
         switch (id) {
-        case BUFFER: {
-            // cut the buffer to the current index
-            // and move the index to the end
-            return &buffer;
-        }
+        case BUFFER:
+            return (void*)frames.acquire().buffer;
+        case SPECTRUM:
+            return (void*)&frames.acquire().spectrum;
         }
         return NULL;
     }
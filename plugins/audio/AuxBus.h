@@ -0,0 +1,105 @@
+#pragma once
+
+#include <vector>
+
+#include "audio/utils/mixLane.h"
+#include "audioPlugin.h"
+#include "mapping.h"
+
+/*md
+## AuxBus
+
+AuxBus audio plugin is the send of an effect bus: placed first on a track of its own, it sums the tracks sent to
+the bus, each scaled by its send level, and the effects following it on the bus track process them once for all the
+tracks, instead of one reverb or delay per track. The bus track is then mixed into the master like any other track,
+as the return of the bus, e.g. with a `Mixer10` on the master track for the tracks 1 to 8 and two buses on 9 and 10.
+The bus track depends on the tracks sent to it, so it is always rendered after them.
+
+The sends are taken at the end of the chain of each track, before the master mixer (pre-fader). Send level changes are
+ramped over one block, so they don't click. With the `stereo` host config, the bus is stereo.
+
+```json
+{ "id": 9, "plugins": [
+    { "plugin": "AuxBus", "alias": "ReverbSend", "tracks": [1, 2, 3, 4, 5, 6] },
+    { "plugin": "EffectReverb", "alias": "Reverb" }
+] }
+```
+*/
+class AuxBus : public Mapping {
+protected:
+    std::vector<uint8_t> tracks;
+    std::vector<Val*> sends;
+    // Gain applied to each send at the end of the last block, the next block ramping from it
+    std::vector<float> gains;
+
+public:
+    AuxBus(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : Mapping(props, config)
+    {
+        //md **Config**:
+        auto& json = config.json;
+        //md - `"tracks": [1, 2, 3]` the tracks sent to the bus. Default is tracks 1 to 8.
+        tracks = json.value("tracks", std::vector<uint8_t> { 1, 2, 3, 4, 5, 6, 7, 8 });
+        //md - `"send": 20` the initial send level of the tracks, in %. Default is 0.
+        float send = json.value("send", 0.0f);
+
+        /*md **Value**: */
+        for (uint8_t id : tracks) {
+            /*md - `SEND_1` to set the send level of track 1, min = 0.0, max = 100. */
+            /*md - ... */
+            sends.push_back(&val(send, "SEND_" + std::to_string(id), { "Send " + std::to_string(id), .unit = "%" }));
+        }
+        gains.assign(tracks.size(), 0.0f);
+    }
+
+    bool isStereo() override
+    {
+        return hasStereoBuffer();
+    }
+
+    std::set<uint8_t> trackDependencies() override
+    {
+        return std::set<uint8_t>(tracks.begin(), tracks.end());
+    }
+
+    void sample(float* buf) override
+    {
+        float out = 0.0f;
+        for (size_t i = 0; i < tracks.size(); i++) {
+            out += sends[i]->pct() * buf[tracks[i]];
+        }
+        buf[track] = out;
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        bool stereo = hasStereoBuffer();
+        float* out = trackLane(buf, track);
+        float* outRight = stereo ? rightLane(buf, track) : NULL;
+        bool written = false;
+        for (size_t i = 0; i < tracks.size(); i++) {
+            float target = sends[i]->pct();
+            float gain = gains[i];
+            gains[i] = target;
+            // Tracks not sent, or silent, would only add zeros
+            if ((gain == 0.0f && target == 0.0f) || isSilentTrack(tracks[i])) {
+                continue;
+            }
+            float step = (target - gain) / frames;
+            mixLane(out, trackLane(buf, tracks[i]), stride, frames, gain, step, !written);
+            if (stereo) {
+                mixLane(outRight, rightLane(buf, tracks[i]), stride, frames, gain, step, !written);
+            }
+            written = true;
+        }
+        if (!written) {
+            for (uint32_t f = 0; f < frames; f++) {
+                out[f * stride] = 0.0f;
+                if (stereo) {
+                    outRight[f * stride] = 0.0f;
+                }
+            }
+        }
+    }
+};
@@ -2,13 +2,13 @@
 This component, the `ClipSequencer`, functions as a sophisticated timing and scheduling manager within a larger audio system. Think of it as a conductor following a pre-written score, ensuring all musical events occur exactly when they should.
 
 **Core Functionality:**
-The Sequencer relies on an internal "Timeline," which is a list detailing scheduled actions tied to specific musical steps (like beats or subdivisions). It uses the system’s musical clock to count these steps.
+The Sequencer relies on an internal "Timeline," which is a list detailing scheduled actions tied to specific musical steps (like beats or subdivisions). It uses the system’s musical clock to count these steps. The Timeline is compiled in the background into a flat stream of the events of the next steps, the loops back unrolled, compiled again whenever the Timeline is edited or the stream runs short, so playing it is only walking a cursor.
 
 **How it Works:**
 1.  **Step Tracking:** As the clock advances, the Sequencer increments its step counter.
-2.  **Event Triggering:** At every new step, it checks the Timeline. If an action is scheduled, it is executed immediately.
-3.  **Main Action:** The primary action is usually triggering a "Load Clip" command. This sends specific pattern data (the "clip") to an assigned audio component (the "Target Plugin").
-4.  **Looping:** It can also handle complex flow control, such as automatically jumping back to an earlier step in the Timeline to create seamless loops or repeating sections.
+2.  **Event Triggering:** At every new step, it checks the compiled stream. If an action is scheduled, it is executed immediately.
+3.  **Main Action:** The primary action is usually triggering a "Load Clip" command. This sends specific pattern data (the "clip") to an assigned audio component (the "Target Plugin"). A bar before, the clip coming next, read ahead in the stream, is preloaded by the Target Plugin in the background, so the switch doesn't wait on the disk.
+4.  **Looping:** It can also handle complex flow control, such as automatically jumping back to an earlier step in the Timeline to create seamless loops or repeating sections. The loops are resolved when compiling, and stopping rewinds to the start.
 
 **Setup and Control:**
 The Sequencer must be configured with the name of the "Target Plugin" it needs to communicate with. Once configured, it manages the automatic switching of clips in that target plugin according to its Timeline. It responds to standard musical controls (like Start and Stop) and offers internal control interfaces for viewing or manually triggering specific events.
@@ -23,6 +23,7 @@ sha: eae9252e401870dedff227558ee4976c19a5904f1758ba8d09bced0eddf9ce4e
 #include "log.h"
 #include "mapping.h"
 #include "plugins/audio/utils/Timeline.h"
+#include "plugins/audio/utils/TimelineStream.h"
 #include "stepInterface.h"
 
 /*md
@@ -37,35 +38,81 @@ protected:
     uint8_t setClipDataId = 0;
 
     uint32_t stepCounter = -1;
+    // Steps played since the start, the first step being 0
+    uint32_t playedSteps = -1;
     bool isPlaying = false;
 
-    uint16_t currentEvent = 0;
+    TimelineStream::Slot stream = TimelineStream::Slot(1024);
+    // Next event of the stream, and whether the stream follows the playhead, not anymore once rewound
+    size_t streamCursor = 0;
+    bool streamValid = false;
+
+    void swapStream()
+    {
+        if (stream.swap(playedSteps)) {
+            streamCursor = 0;
+            streamValid = true;
+        } else if (!streamValid && stream.compileNow()) {
+            streamCursor = 0;
+            streamValid = true;
+        }
+    }
+
+    // The clip coming next is preloaded, so the switch at the clip boundary doesn't read the disk
+    int preloadDataId = -1;
+    uint32_t preloadSteps = 16;
+    int32_t preloadedClip = -1;
+
+    void preloadUpcomingClip()
+    {
+        if (!targetPlugin || preloadDataId < 0) {
+            return;
+        }
+        TimelineStream::Stream* compiled = stream.get();
+        int32_t clip = -1;
+        for (size_t i = streamCursor; streamValid && i < compiled->events.size() && compiled->events[i].played - playedSteps <= preloadSteps; i++) {
+            if (compiled->events[i].type == Timeline::EventType::LOAD_CLIP) {
+                clip = compiled->events[i].value;
+                break;
+            }
+        }
+        if (clip >= 0 && clip != preloadedClip) {
+            preloadedClip = clip;
+            int16_t id = clip;
+            targetPlugin->data(preloadDataId, &id);
+        }
+    }
 
     void onStep() override
     {
+        swapStream();
         stepCounter++;
+        playedSteps++;
 
-        // Handle all events for this step
-        while (currentEvent < timeline.events.size() && timeline.events[currentEvent].step == stepCounter) {
-            Timeline::Event& event = timeline.events[currentEvent];
+        // Handle all events for this step, loops back included, as compiled
+        TimelineStream::Stream* compiled = stream.get();
+        while (streamValid && streamCursor < compiled->events.size() && compiled->events[streamCursor].played <= playedSteps) {
+            TimelineStream::Event& event = compiled->events[streamCursor++];
 
             if (event.type == Timeline::EventType::LOOP_BACK) {
                 logDebug("Event on step %d loop back to step %d", stepCounter, event.value);
                 stepCounter = event.value;
-
-                // find event for the new stepCounter
-                currentEvent = 0;
-                while (currentEvent < timeline.events.size() && timeline.events[currentEvent].step < stepCounter) {
-                    currentEvent++;
-                }
             } else if (event.type == Timeline::EventType::LOAD_CLIP) {
                 logDebug("Event on step %d clip %d", stepCounter, event.value);
                 if (targetPlugin) {
-                    targetPlugin->data(setClipDataId, &event.value);
+                    int id = event.value;
+                    targetPlugin->data(setClipDataId, &id);
                 }
-                currentEvent++;
+                // Preloaded for a single switch
+                preloadedClip = -1;
             }
         }
+        stream.setPlayhead(playedSteps, stepCounter);
+        if (streamValid && compiled->until - (playedSteps + 1) < stream.stepsAhead() / 2) {
+            stream.extend();
+        }
+
+        preloadUpcomingClip();
     }
 
 public:
@@ -77,11 +124,25 @@ public:
 
         timeline.config(json);
 
+        //md - `"compileSteps": 1024` how many steps of the timeline are compiled ahead of the playhead.
+        stream.setStepsAhead(json.value("compileSteps", stream.stepsAhead()));
+        stream.changed(timeline, true);
+        streamValid = true;
+
+        //md - `"preloadSteps": 16` how many steps before a clip plays it is preloaded. Default is a bar, 16 steps.
+        preloadSteps = json.value("preloadSteps", preloadSteps);
+
         //md - `"target": "pluginName"` the plugin to set clips (serializer...)
         if (json.contains("target")) {
             targetPlugin = &props.audioPluginHandler->getPlugin(json["target"].get<std::string>(), track);
             if (targetPlugin) {
                 setClipDataId = targetPlugin->getDataId(json.value("loadClipDataId", "LOAD_CLIP"));
+
+                //md - `"preloadClipDataId": "PRELOAD_CLIP"` the data function of the target reading a clip in the background, before it is loaded.
+                std::string preloadName = json.value("preloadClipDataId", "PRELOAD_CLIP");
+                uint8_t id = targetPlugin->getDataId(preloadName);
+                // Unknown names give the data ID 0
+                preloadDataId = id != 0 || preloadName == "0" ? id : -1;
             } else {
                 logError("Unable to find target plugin: %s", json["target"].get<std::string>().c_str());
             }
@@ -95,20 +156,38 @@ public:
         UseClock::sample(buf);
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        clockBlock(props, buf, frames);
+    }
+
+    bool followsClock() override
+    {
+        return true;
+    }
+
     void onEvent(AudioEventType event, bool playing) override
     {
         isPlaying = playing;
         if (event == AudioEventType::STOP) {
-            stepCounter = 0;
+            // Rewind, the first step being step 0
+            stepCounter = -1;
+            playedSteps = -1;
+            preloadedClip = -1;
+            // Compiled again from the start, before the next step
+            stream.setPlayhead(playedSteps, stepCounter);
+            stream.extend();
+            streamValid = false;
         } else if (event == AudioEventType::RELOAD_WORKSPACE) {
             timeline.reloadWorkspace();
+            stream.changed(timeline);
         }
     }
 
     void hydrateJson(nlohmann::json& json) override { } // Do not hydrate this plugin
     void serializeJson(nlohmann::json& json) override { }
 
-    DataFn dataFunctions[2] = {
+    DataFn dataFunctions[3] = {
         { "TIMELINE", [this](void* userdata) {
              return &timeline;
          } },
@@ -119,6 +198,11 @@ public:
              }
              return nullptr;
          } },
+        // To call once the timeline was edited, from the thread editing it
+        { "TIMELINE_CHANGED", [this](void* userdata) {
+             stream.changed(timeline);
+             return nullptr;
+         } },
     };
     DEFINE_GETDATAID_AND_DATA
 };
@@ -63,7 +63,7 @@ public:
 
     EffectBandIsolatorFx(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
         , bandEq(props.sampleRate)
     {
         initValues();
@@ -0,0 +1,180 @@
+#pragma once
+
+#include "audioPlugin.h"
+#include "log.h"
+#include "mapping.h"
+#include "audio/Convolver.h"
+#include "audio/fileBrowser.h"
+#include "audio/utils/Resampler.h"
+
+#include <condition_variable>
+#include <mutex>
+#include <sndfile.h>
+#include <string>
+#include <thread>
+#include <vector>
+
+/*md
+## EffectConvolution
+
+EffectConvolution plugin is used to apply an impulse response to the track, e.g. the reverb of a room or a speaker
+cabinet.
+
+The head of the impulse response is convolved in the audio thread without latency, the long tail by background
+threads, see `audio/Convolver.h`. Impulse response files are read from `data/audio/ir`, mixed down to mono and
+converted to the engine sample rate.
+*/
+class EffectConvolution : public Mapping {
+protected:
+    Convolver convolver;
+    FileBrowser fileBrowser = FileBrowser(AUDIO_FOLDER + "/ir");
+    bool normalize = true;
+
+    // Files are loaded by a background thread, the kernel being swapped once it is ready
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::string pendingPath;
+    bool running = true;
+    std::thread loader;
+
+    void loadIr(std::string path)
+    {
+        SF_INFO sfinfo;
+        SNDFILE* file = sf_open(path.c_str(), SFM_READ, &sfinfo);
+        if (!file) {
+            logWarn("Could not open impulse response %s [%s]", path.c_str(), sf_strerror(file));
+            return;
+        }
+        uint8_t channels = std::max(sfinfo.channels, 1);
+        std::vector<float> data(sfinfo.frames * channels);
+        uint64_t frames = sf_readf_float(file, data.data(), sfinfo.frames);
+        sf_close(file);
+
+        for (uint64_t f = 0; f < frames; f++) {
+            float sum = 0.0f;
+            for (uint8_t c = 0; c < channels; c++) {
+                sum += data[f * channels + c];
+            }
+            data[f] = sum / channels;
+        }
+        uint64_t capacity = frames * props.sampleRate / std::max(sfinfo.samplerate, 1) + 1;
+        data.resize(std::max(frames, capacity));
+        frames = Resampler::convert(data.data(), frames, 1, sfinfo.samplerate, props.sampleRate, capacity);
+
+        uint32_t length = std::min(frames, (uint64_t)convolver.maxLength);
+        // Unity gain on a white noise, so switching between responses keeps about the same level
+        if (normalize) {
+            double energy = 0.0;
+            for (uint32_t i = 0; i < length; i++) {
+                energy += data[i] * data[i];
+            }
+            if (energy > 0.0) {
+                float gain = 1.0f / sqrt(energy);
+                for (uint32_t i = 0; i < length; i++) {
+                    data[i] *= gain;
+                }
+            }
+        }
+        logDebug("Impulse response %s: %d samples", path.c_str(), length);
+        convolver.setKernel(convolver.buildKernel(data.data(), length));
+    }
+
+    void loaderLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [&] { return !running || !pendingPath.empty(); });
+            if (!running) {
+                return;
+            }
+            std::string path = pendingPath;
+            pendingPath.clear();
+            lock.unlock();
+            loadIr(path);
+            lock.lock();
+        }
+    }
+
+    void open(std::string path)
+    {
+        std::lock_guard<std::mutex> lock(mtx);
+        pendingPath = path;
+        cv.notify_one();
+    }
+
+public:
+    /*md **Values**: */
+    /*md - `IR` select the impulse response file. */
+    Val& ir = val(1.0f, "IR", { "IR", VALUE_STRING, .min = 1.0f, .max = (float)fileBrowser.count }, [&](auto p) {
+        p.val.setFloat(p.value);
+        int position = p.val.get();
+        if (position != fileBrowser.position) {
+            p.val.setString(fileBrowser.getFile(position));
+            open(fileBrowser.getFilePath(position));
+        }
+    });
+
+    /*md - `MIX` set the convolved signal vs the original signal. */
+    Val& mix = val(30.0f, "MIX", { "Mix", .unit = "%" });
+
+    EffectConvolution(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : Mapping(props, config)
+        //md **Config**:
+        //md - `"maxLength": 5` seconds of impulse response at most, from 0.1 to 10, longer files being cut.
+        , convolver(props.sampleRate, props.sampleRate * std::clamp(config.json.value("maxLength", 5.0f), 0.1f, 10.0f))
+    {
+        //md - `"normalize": true` scale the impulse responses to the same energy.
+        normalize = config.json.value("normalize", normalize);
+        loader = std::thread([this] { loaderLoop(); });
+        pthread_setname_np(loader.native_handle(), "convolver_load");
+        initValues();
+    }
+
+    ~EffectConvolution()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            running = false;
+        }
+        cv.notify_one();
+        // A kernel being swapped waits for the audio thread, that is not called anymore
+        convolver.stop();
+        if (loader.joinable()) {
+            loader.join();
+        }
+    }
+
+    void sample(float* buf)
+    {
+        float in = buf[track];
+        buf[track] = in + (convolver.process(in) - in) * mix.pct();
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        float mixAmount = mix.pct();
+        for (uint32_t f = 0; f < frames; f++) {
+            float in = lane[f * stride];
+            lane[f * stride] = in + (convolver.process(in) - in) * mixAmount;
+        }
+    }
+
+    void serializeJson(nlohmann::json& json) override
+    {
+        Mapping::serializeJson(json);
+        json["irFile"] = fileBrowser.getFile(ir.get());
+    }
+
+    void hydrateJson(nlohmann::json& json) override
+    {
+        Mapping::hydrateJson(json);
+        if (json.contains("irFile")) {
+            int position = fileBrowser.find(json["irFile"]);
+            if (position != 0) {
+                ir.set(position);
+            }
+        }
+    }
+};
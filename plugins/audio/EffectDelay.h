@@ -2,7 +2,7 @@
 This code defines a sophisticated audio processor called `EffectDelay`, which is used to generate time-based effects, primarily delays and reverb.
 
 **Core Mechanism:**
-The system works by continually storing the incoming sound in a temporary memory bank, like a short audio loop. To create an echo, it reads back a portion of the sound that was recorded moments ago and mixes it with the current sound. The key element that determines the sound is the "feedback," where the delayed sound is itself re-recorded back into the memory bank, creating continuous, decaying echoes.
+The system works by continually storing the incoming sound in a temporary memory bank, like a short audio loop. To create an echo, it reads back a portion of the sound that was recorded moments ago and mixes it with the current sound. The key element that determines the sound is the "feedback," where the delayed sound is itself re-recorded back into the memory bank, creating continuous, decaying echoes. The memory is read and written by chunks of samples, and when a delay time changes the read position glides to the new time with a smooth (cubic) interpolation between the stored samples, so the echo bends in pitch instead of clicking.
 
 **Multi-Voice Architecture:**
 This effect is highly flexible because it operates using up to eight independent "Delay Voices." Each voice is essentially a separate echo line. This allows the user to build complex soundscapes where different echoes occur at different times, volumes, and decay rates, making it suitable for both simple echoes and rich, realistic reverb.
@@ -25,6 +25,10 @@ sha: 16d3da3e6809a835a98e33ec8f489245e89e274ee0e07ec9f4f3a4822511eda9
 #include "audioBuffer.h"
 #include "audioPlugin.h"
 #include "mapping.h"
+#include "audio/utils/float4.h"
+
+#include <algorithm>
+#include <cmath>
 
 #define MAX_DELAY_VOICES 8
 
@@ -40,35 +44,129 @@ EffectDelay plugin is used to apply delay or reverb effect on audio buffer.
 class EffectDelay : public Mapping {
 protected:
     uint64_t sampleRate;
-    AudioBuffer<> buffer;
+    // 5 seconds of delay, whatever the sample rate
+    AudioBuffer<> buffer = AudioBuffer<>(props.arena, 5 * props.sampleRate);
+
+    // Frames processed at once, less when a delay is shorter than the chunk
+    static const uint32_t CHUNK = 64;
+    // The cubic interpolation reads 2 samples after the read position, that must already be written
+    static constexpr float MIN_DELAY = 4.0f;
+    // Delay time changes glide over about 50ms, so the read head never jumps
+    float glide = 1.0f;
 
-    float sample(float in)
+    // 4 point Hermite interpolation of the buffer at `pos` samples before the write index
+    float read(float pos)
     {
-        buffer.addSample(in);
+        const int64_t size = buffer.size;
+        float floored = floorf(pos);
+        float t = pos - floored;
+        int64_t i = (int64_t)buffer.index + (int64_t)floored;
+        if (i < 1) {
+            i += size;
+        }
+        const float* s = buffer.samples;
+        float xm1, x0, x1, x2;
+        if (i >= 1 && i + 2 < size) {
+            xm1 = s[i - 1];
+            x0 = s[i];
+            x1 = s[i + 1];
+            x2 = s[i + 2];
+        } else {
+            xm1 = s[(i - 1 + size) % size];
+            x0 = s[i % size];
+            x1 = s[(i + 1) % size];
+            x2 = s[(i + 2) % size];
+        }
+        float c1 = 0.5f * (x1 - xm1);
+        float c2 = xm1 - 2.5f * x0 + 2.0f * x1 - 0.5f * x2;
+        float c3 = 0.5f * (x2 - xm1) + 1.5f * (x0 - x1);
+        return ((c3 * t + c2) * t + c1) * t + x0;
+    }
 
-        float delay = 0.0f;
-        for (uint8_t i = 0; i < MAX_DELAY_VOICES; i++) {
-            DelayVoice& voice = voices[i];
-            if (voice.index++ >= buffer.size) {
-                voice.index = 0;
+    // Write `count` frames at the write index, split in the contiguous spans before and after the end of the ring
+    void write(const float* in, const float* feedback, uint32_t count)
+    {
+        uint32_t done = 0;
+        while (done < count) {
+            uint32_t span = std::min((uint64_t)(count - done), buffer.size - buffer.index);
+            float* dst = buffer.samples + buffer.index;
+            for (uint32_t f = 0; f < span; f++) {
+                dst[f] = in[done + f] + feedback[done + f];
             }
-            if (masterAmplitude.pct() && voice.amplitude.pct() > 0.0f) {
-                delay += buffer.samples[voice.index] * voice.amplitude.pct() * masterAmplitude.pct();
-                if (voice.feedback.pct() > 0.0f) {
-                    buffer.samples[buffer.index] += delay * voice.feedback.pct();
+            done += span;
+            buffer.index = (buffer.index + span) % buffer.size;
+        }
+    }
+
+    void process(float* lane, uint32_t stride, uint32_t frames)
+    {
+        float in[CHUNK];
+        float wet[CHUNK];
+        float feedback[CHUNK];
+        float voiceOut[CHUNK];
+        float master = masterAmplitude.pct();
+        uint32_t start = 0;
+        while (start < frames) {
+            // A chunk must only read samples written before it
+            float shortest = buffer.size;
+            for (uint8_t i = 0; i < MAX_DELAY_VOICES; i++) {
+                if (voices[i].amplitude.pct() > 0.0f) {
+                    shortest = std::min({ shortest, voices[i].delay, voices[i].target });
+                }
+            }
+            uint32_t count = std::min({ CHUNK, frames - start, (uint32_t)std::max(shortest - 3.0f, 1.0f) });
+            float* chunk = lane + start * stride;
+            for (uint32_t f = 0; f < count; f++) {
+                in[f] = chunk[f * stride];
+            }
+            std::fill(wet, wet + count, 0.0f);
+            std::fill(feedback, feedback + count, 0.0f);
+
+            float chunkGlide = 1.0f - powf(1.0f - glide, count);
+            for (uint8_t i = 0; i < MAX_DELAY_VOICES; i++) {
+                DelayVoice& voice = voices[i];
+                float from = voice.delay;
+                voice.delay += (voice.target - voice.delay) * chunkGlide;
+                float amp = voice.amplitude.pct() * master;
+                if (amp <= 0.0f) {
+                    continue;
+                }
+                float step = (voice.delay - from) / count;
+                for (uint32_t f = 0; f < count; f++) {
+                    voiceOut[f] = read(f - (from + step * (f + 1)));
+                }
+                float fb = amp * voice.feedback.pct();
+                uint32_t f = 0;
+#if defined(FLOAT4)
+                using namespace float4;
+                for (; f + 4 <= count; f += 4) {
+                    v4 y = load(voiceOut + f);
+                    store(wet + f, add(load(wet + f), mul(y, set(amp))));
+                    store(feedback + f, add(load(feedback + f), mul(y, set(fb))));
+                }
+#endif
+                for (; f < count; f++) {
+                    wet[f] += voiceOut[f] * amp;
+                    feedback[f] += voiceOut[f] * fb;
                 }
             }
-        }
 
-        return in + filter.process(delay);
+            write(in, feedback, count);
+            for (uint32_t f = 0; f < count; f++) {
+                chunk[f * stride] = in[f] + filter.process(wet[f]);
+            }
+            start += count;
+        }
     }
 
     /*md **Values**: */
     struct DelayVoice {
-        uint64_t index;
+        // Current delay, in samples, gliding to `target`
+        float delay;
         Val amplitude;
         Val feedback;
         Val sec;
+        float target = MIN_DELAY;
     } voices[MAX_DELAY_VOICES] = {
         { 0,
             /*md - Delay has 8 voices */
@@ -119,6 +217,7 @@ protected:
     void initVoice(uint8_t voiceIndex, float sec, float amplitude, float feedback)
     {
         setSec(&voices[voiceIndex], sec);
+        voices[voiceIndex].delay = voices[voiceIndex].target;
         voices[voiceIndex].amplitude.setFloat(amplitude);
         voices[voiceIndex].feedback.setFloat(feedback);
     }
@@ -157,6 +256,7 @@ public:
         , sampleRate(props.sampleRate)
         , filter(props, config)
     {
+        glide = 1.0f - expf(-1.0f / (0.05f * props.sampleRate));
         /*md - `CUTOFF` to set cutoff on delay buffer.*/
         val(&filter.filterCutoff);
         /*md - `RESONANCE` to set resonance on delay buffer.*/
@@ -188,7 +288,36 @@ public:
 
     void sample(float* buf)
     {
-        buf[track] = sample(buf[track]);
+        process(buf + track, 1, 1);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        process(trackLane(buf, track), props.frameStride, frames);
+    }
+
+    // Echoes last until the feedback loop fades out, then the buffer still holds the last seconds of sound
+    uint32_t tailFrames() override
+    {
+        float amplitude = 0.0f;
+        float feedback = 0.0f;
+        uint64_t delayFrames = 0;
+        for (uint8_t i = 0; i < MAX_DELAY_VOICES; i++) {
+            DelayVoice& voice = voices[i];
+            if (voice.amplitude.pct() > 0.0f) {
+                amplitude += voice.amplitude.pct() * masterAmplitude.pct();
+                feedback += voice.feedback.pct();
+                uint64_t frames = std::max(voice.delay, voice.target);
+                delayFrames = frames > delayFrames ? frames : delayFrames;
+            }
+        }
+        float loopGain = amplitude * feedback;
+        if (loopGain >= 1.0f) {
+            return TAIL_INFINITE;
+        }
+        uint64_t repeats = loopGain > 0.0f ? ceilf(logf(0.0001f) / logf(loopGain)) : 1;
+        uint64_t tail = buffer.size + repeats * delayFrames;
+        return tail < TAIL_INFINITE ? tail : TAIL_INFINITE;
     }
 
     void setVoiceEdit(float value)
@@ -207,7 +336,11 @@ public:
     {
         voice->sec.setFloat(sec);
         // percentage of 1 seconds => 0ms to 1000ms, in percentage is same as 1 seconds
-        voice->index = (buffer.index + buffer.size - (uint64_t)(sampleRate * voice->sec.pct() * timeRatio.pct())) % buffer.size;
+        voice->target = std::clamp(sampleRate * voice->sec.pct() * timeRatio.pct(), MIN_DELAY, (float)buffer.size - 4.0f);
+        // Nothing was played yet, no need to glide
+        if (voice->delay == 0.0f) {
+            voice->delay = voice->target;
+        }
     }
 
     void setTimeRatio(float ratio)
@@ -7,6 +7,7 @@
 #include "audio/effects/applyDrive.h"
 #include "audio/effects/applyWaveshape.h"
 #include "audio/effects/applySoftClipping.h"
+#include "audio/utils/Oversampler.h"
 #include "audio/effects/applyCompression.h"
 
 #include <math.h>
@@ -34,10 +35,15 @@ public:
     float prevInput1 = 0.0f, prevOutput1 = 0.0f; // State for pass 1
     // float prevInput2 = 0.0f, prevOutput2 = 0.0f; // State for pass 2
 
+    Oversampler oversampler;
+
     EffectDistortion2(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
     {
         initValues();
+
+        //md - `"oversampling": 4` run the distortion at 2, 4 or 8 times the sample rate to reduce aliasing, delaying the track by a few frames. Default is `1`, disabled.
+        oversampler.setFactor(config.json.value("oversampling", 1));
     }
 
     void sample(float* buf)
@@ -63,6 +69,71 @@ public:
         }
     }
 
+    // Silent input is passed through untouched
+    uint32_t tailFrames() override
+    {
+        return oversampler.latencyFrames();
+    }
+
+    uint32_t latencyFrames() override
+    {
+        return oversampler.latencyFrames();
+    }
+
+    // Half the oversampling for each level, the latency staying the same
+    void setQualityLevel(uint8_t level) override
+    {
+        oversampler.limitFactor(oversampler.getFactor() >> level);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        // Parameters are read once per block instead of once per sample
+        float levelAmount = level.pct();
+        float driveAmount = drive.pct();
+        float compressAmount = compress.pct() * 2 - 1.0f;
+        float bassBoostAmount = bass.pct();
+        float waveshapeAmount = waveshape.pct() * 2 - 1.0f;
+        LookupTable* lookupTable = props.lookupTable;
+
+        float* lane = trackLane(buf, track);
+        if (oversampler.getFactor() > 1) {
+            // The bass boost is a filter tuned for the engine rate, so it is applied before oversampling, the
+            // dry signal of the level blend being the boosted one
+            applyBoostBlock(lane, props.frameStride, frames, bassBoostAmount, prevInput1, prevOutput1);
+            oversampler.process(lane, props.frameStride, frames, [&](float* samples, uint32_t count) {
+                for (uint32_t f = 0; f < count; f++) {
+                    float input = samples[f];
+                    float output = input;
+                    output = applyDrive(output, driveAmount, lookupTable);
+                    output = applyCompression(output, compressAmount);
+                    output = applyWaveshape(output, waveshapeAmount, lookupTable);
+                    output = blend(input, output, levelAmount);
+                    samples[f] = applySoftClipping(output, lookupTable);
+                }
+            });
+            for (uint32_t f = 0; f < frames; f++) {
+                float& sample = lane[f * props.frameStride];
+                sample = CLAMP(sample, -1.0f, 1.0f);
+            }
+            return;
+        }
+        for (uint32_t f = 0; f < frames; f++) {
+            float& input = lane[f * props.frameStride];
+            if (input != 0.0f) {
+                float output = input;
+                output = applyBoost(output, bassBoostAmount, prevInput1, prevOutput1);
+                output = applyDrive(output, driveAmount, lookupTable);
+                output = applyCompression(output, compressAmount);
+                output = applyWaveshape(output, waveshapeAmount, lookupTable);
+                output = blend(input, output, levelAmount);
+                output = applySoftClipping(output, lookupTable);
+
+                input = CLAMP(output, -1.0f, 1.0f);
+            }
+        }
+    }
+
 protected:
     float blend(float originalInput, float processedInput, float levelAmount)
     {
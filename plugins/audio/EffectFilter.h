@@ -93,4 +93,24 @@ public:
     {
         buf[track] = process(buf[track]);
     }
+
+    // Silent input is passed through untouched
+    uint32_t tailFrames() override
+    {
+        return 0;
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (filterType.get() == EffectFilter::FilterType::FILTER_OFF) {
+            return;
+        }
+        float* lane = trackLane(buf, track);
+        for (uint32_t f = 0; f < frames; f++) {
+            float& input = lane[f * props.frameStride];
+            if (input != 0) {
+                input = filter.process(input);
+            }
+        }
+    }
 };
@@ -19,7 +19,7 @@ sha: 326d7d4bbf0756e8a77aefc4083c53fc3bd59a4f141be4f78e537d1526f458a5
 #pragma once
 
 #include "helpers/clamp.h"
-#include "audio/filter.h"
+#include "audio/filterBank.h"
 #include "mapping.h"
 
 /*md
@@ -30,8 +30,10 @@ Cutoff frequency mixing from low pass filter to high pass filter.
 */
 class EffectFilterMultiModeMix : public Mapping {
 protected:
-    EffectFilterData hpf;
-    EffectFilterData lpf;
+    // Lane 0 is the low pass filter, lane 1 the high pass filter, both getting the same input
+    EffectFilterBank<4> filters;
+    float lpCutoff = 0.0f;
+    float hpCutoff = 0.0f;
 
     std::string valueFmt = "%d%% LP|HP %d%%";
 
@@ -45,6 +47,8 @@ public:
     EffectFilterMultiModeMix(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
     {
+        filters.setType(0, EffectFilterData::LP);
+        filters.setType(1, EffectFilterData::HP);
         initValues();
         valueFmt = config.json.value("cutoffStringFormat", valueFmt);
     };
@@ -55,10 +59,12 @@ public:
             return inputValue;
         }
 
-        hpf.setSampleData(inputValue);
-        lpf.setSampleData(inputValue);
+        float lp = inputValue;
+        float hp = inputValue;
+        float* lanes[4] = { &lp, &hp, NULL, NULL };
+        filters.process(lanes, 1, 1);
 
-        return lpf.lp * (1.0 - mix.pct()) + hpf.hp * mix.pct();
+        return lp * (1.0 - mix.pct()) + hp * mix.pct();
     }
 
     void sample(float* buf)
@@ -66,12 +72,37 @@ public:
         buf[track] = sample(buf[track]);
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        float mixValue = mix.pct();
+
+        const uint32_t CHUNK = 64;
+        float lp[CHUNK];
+        float hp[CHUNK];
+        float* lanes[4] = { lp, hp, NULL, NULL };
+        for (uint32_t start = 0; start < frames; start += CHUNK) {
+            uint32_t count = std::min(CHUNK, frames - start);
+            float* chunk = lane + start * stride;
+            for (uint32_t f = 0; f < count; f++) {
+                lp[f] = hp[f] = chunk[f * stride];
+            }
+            filters.process(lanes, 1, count);
+            for (uint32_t f = 0; f < count; f++) {
+                chunk[f * stride] = lp[f] * (1.0 - mixValue) + hp[f] * mixValue;
+            }
+        }
+    }
+
     void setCutoff(float value)
     {
         mix.setFloat(value);
         float mixValue = mix.pct();
-        hpf.setRawCutoff((0.20 * mixValue) + 0.00707);
-        lpf.setRawCutoff(0.85 * mixValue + 0.1);
+        hpCutoff = (0.20 * mixValue) + 0.00707;
+        lpCutoff = 0.85 * mixValue + 0.1;
+        filters.setRawCutoff(0, lpCutoff, resonance.pct());
+        filters.setRawCutoff(1, hpCutoff, resonance.pct());
         char strBuf[128];
         sprintf(strBuf, valueFmt.c_str(), (int)((1 - mixValue) * 100), (int)(mixValue * 100));
         mix.setString(strBuf);
@@ -81,7 +112,7 @@ public:
     {
         resonance.setFloat(value);
         // printf("setResonance %f >> %f\n", value, resonance.pct());
-        lpf.setResonance(resonance.pct());
-        hpf.setResonance(resonance.pct());
+        filters.setRawCutoff(0, lpCutoff, resonance.pct());
+        filters.setRawCutoff(1, hpCutoff, resonance.pct());
     };
 };
@@ -17,12 +17,15 @@ The component acts as a versatile filter, capable of sculpting the frequency con
 
 The effect achieves its sound by cycling each incoming audio sample through four mathematical delay and mixing stages. It uses internal variables that model the physics of the original analog circuit, calculating factors like frequency response (`p`, `f`) and the amount of feedback (`q`). A key detail is the inclusion of slight non-linear processing (soft clipping) in the signal path, which mimics how analog circuits naturally distort, adding warmth and richness to the filtered sound.
 
+A **MODEL** control switches to a zero delay feedback ladder, with saturating stages solved per sample and the cutoff moved smoothly over each block, so both models can be compared on the same material.
+
 sha: 614ccb550074a16345cebf4313883dc6ce46a57df937680c79d997b650ad52b2 
 */
 #pragma once
 
 #include "helpers/clamp.h"
 #include "audio/filter.h"
+#include "audio/LadderFilter.h"
 #include "mapping.h"
 
 // #include <math.h>
@@ -35,6 +38,8 @@ sha: 614ccb550074a16345cebf4313883dc6ce46a57df937680c79d997b650ad52b2
 
 EffectFilterMultiModeMoog plugin is used to apply a simulation of the Moog filter on audio buffer.
 Cutoff frequency will switch from low pass filter to high pass filter when reaching 50%.
+
+The `MODEL` value select between the classic filter and a zero delay feedback ladder, see `audio/LadderFilter.h`.
 */
 class EffectFilterMultiModeMoog : public Mapping {
 protected:
@@ -43,6 +48,15 @@ protected:
     float b0, b1, b2, b3, b4 = 0.0;
     float t1, t2 = 0.0;
 
+    LadderFilter ladder;
+    // The classic filter replaces the ladder from quality level 1, see `setQualityLevel()`
+    bool cheapModel = false;
+
+    bool useLadder()
+    {
+        return model.get() != 0 && !cheapModel;
+    }
+
     void calculateVar(float _cutoff, float _resonance)
     {
         q = 1.0f - _cutoff;
@@ -58,9 +72,16 @@ public:
     Val& mix = val(50.0, "CUTOFF", { "LPF | HPF", .type = VALUE_CENTERED }, [&](auto p) { setCutoff(p.value); });
     /*md - `RESONANCE` to set resonance. */
     Val& resonance = val(0.0, "RESONANCE", { "Resonance" }, [&](auto p) { setResonance(p.value); });
+    /*md - `MODEL` select the classic filter or the zero delay feedback ladder. */
+    Val& model = val(0.0f, "MODEL", { "Model", VALUE_STRING, .max = 1 }, [&](auto p) {
+        p.val.setFloat(p.value);
+        p.val.setString(p.val.get() == 0 ? "Classic" : "ZDF ladder");
+        ladder.reset();
+    });
 
     EffectFilterMultiModeMoog(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
+        , ladder(props.sampleRate)
     {
         initValues();
     };
@@ -98,7 +119,24 @@ public:
 
     void sample(float* buf)
     {
-        buf[track] = sample(buf[track]);
+        if (!useLadder()) {
+            buf[track] = sample(buf[track]);
+        } else {
+            ladder.processBlock(buf + track, 0, 1, mix.pct());
+        }
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        if (!useLadder()) {
+            for (uint32_t f = 0; f < frames; f++) {
+                lane[f * stride] = sample(lane[f * stride]);
+            }
+            return;
+        }
+        ladder.processBlock(lane, stride, frames, mix.pct());
     }
 
     EffectFilterMultiModeMoog& setCutoff(float value)
@@ -110,13 +148,25 @@ public:
             cutoff = mix.pct() + 0.05; // LPF should not be 0.0
         }
         calculateVar(cutoff, resonance.pct());
+        // 20Hz to 20kHz
+        ladder.setCutoff(20.0f * powf(1000.0f, CLAMP(cutoff, 0.0f, 1.0f)));
         return *this;
     }
 
+    // The ladder solving its saturating stages per sample, the classic filter is much cheaper
+    void setQualityLevel(uint8_t level) override
+    {
+        if (cheapModel && level == 0) {
+            ladder.reset();
+        }
+        cheapModel = level > 0;
+    }
+
     EffectFilterMultiModeMoog& setResonance(float value)
     {
         resonance.setFloat(value);
         calculateVar(cutoff, resonance.pct());
+        ladder.setResonance(resonance.pct());
         return *this;
     };
 };
@@ -65,7 +65,7 @@ public:
 
     EffectFilteredMultiFx(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
     {
         initValues();
     }
@@ -85,4 +85,32 @@ public:
 
         buf[track] = out;
     }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        float mixAmount = mix.pct();
+        float feedbackAmount = feedback.pct();
+        float amount = fxAmount.pct();
+
+        // The filter output goes through the effect by chunks, the dry signal being kept aside
+        const uint32_t CHUNK = 64;
+        float dry[CHUNK];
+        float wet[CHUNK];
+        for (uint32_t start = 0; start < frames; start += CHUNK) {
+            uint32_t count = std::min(CHUNK, frames - start);
+            float* chunk = lane + start * stride;
+            for (uint32_t f = 0; f < count; f++) {
+                dry[f] = chunk[f * stride];
+                wet[f] = filter.process(dry[f]);
+                // Feedback is taken before the effect, it is added back to the dry part
+                dry[f] = dry[f] * (1 - mixAmount) + wet[f] * feedbackAmount;
+            }
+            multiFx.applyBlock(wet, 1, count, amount);
+            for (uint32_t f = 0; f < count; f++) {
+                chunk[f * stride] = dry[f] + wet[f] * mixAmount;
+            }
+        }
+    }
 };
@@ -37,6 +37,9 @@ public:
         : Mapping(props, config)
     {
         initValues();
+        // Encoder sweeps would zipper
+        smooth(volume, SMOOTH_ONE_POLE, 10.0f);
+        smooth(gain, SMOOTH_EXP, 10.0f);
     }
 
     void sample(float* buf)
@@ -44,6 +47,29 @@ public:
         buf[track] = buf[track] * volumeWithGain;
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* out = trackLane(buf, track);
+        if (!volume.isSmoothing() && !gain.isSmoothing()) {
+            for (uint32_t f = 0; f < frames; f++) {
+                out[f * stride] *= volumeWithGain;
+            }
+            return;
+        }
+        float start = (1.0 + gain.smoothStartValue()) * volume.pctOf(volume.smoothStartValue());
+        float end = (1.0 + gain.smoothValue()) * volume.pctOf(volume.smoothValue());
+        float step = (end - start) / frames;
+        for (uint32_t f = 0; f < frames; f++) {
+            out[f * stride] *= start + f * step;
+        }
+    }
+
+    uint32_t tailFrames() override
+    {
+        return 0;
+    }
+
     EffectGainVolume& setVolumeWithGain(float vol, float _gain)
     {
         gain.setFloat(_gain);
@@ -5,10 +5,10 @@ The core idea is to continuously record a small segment of the incoming audio si
 
 The plugin offers several controls to shape this unique sound:
 
-1.  **Length and Density:** Controls determine the duration of each audio grain and the total number of grains playing simultaneously (up to 16).
+1.  **Length and Density:** Controls determine the duration of each audio grain and the total number of grains playing simultaneously (up to 64).
 2.  **Timing:** The Density Delay sets the spacing between the start of each individual grain. Randomization features allow the timing and pitch to vary slightly, creating a scattered, diffused sound texture.
 3.  **Pitch and Direction:** The Pitch control modulates the playback speed of the grains, fundamentally changing the frequency. The Direction control determines if the grains play forward or backward through the recorded audio buffer.
-4.  **Envelopes:** Internal smoothers, called envelopes, ensure the effect fades in and out gradually when a MIDI note is pressed or released. Additionally, each tiny grain has its own envelope to prevent audible clicks when it starts and stops playback.
+4.  **Envelopes:** Internal smoothers, called envelopes, ensure the effect fades in and out gradually when a MIDI note is pressed or released. Additionally, each tiny grain fades in and out to prevent audible clicks when it starts and stops playback. Grains are rendered by block from a shared grain pool, restarting on the exact frame where they end.
 
 In summary, the `EffectGrain` takes live audio input and transforms it into a highly customizable sound cloud, where the characteristics of the texture are dictated by the manipulation of many tiny, overlapping sound fragments.
 
@@ -20,9 +20,11 @@ sha: e38a9fe1afa2f04bb293cbf9594d2e6c9e7ec1526c84c0e826f9b77493140722
 #include "audioPlugin.h"
 #include "mapping.h"
 #include "audio/AsrEnvelop.h"
-#include "audio/EnvelopRelative.h"
+#include "audio/GrainPool.h"
 
-#define MAX_GRAINS 16
+#include <algorithm>
+
+#define MAX_GRAINS 64
 
 /*md
 ## EffectGrain
@@ -32,7 +34,7 @@ EffectGrain plugin is used to apply granular effect to a buffer audio.
 // TODO envelop between to apply and release the effect smoothly
 class EffectGrain : public Mapping {
 protected:
-    AudioBuffer<> buffer;
+    AudioBuffer<> buffer = AudioBuffer<>(props.arena, 5 * props.sampleRate);
 
     float velocity = 0.0f;
     uint64_t grainDelay = 0;
@@ -45,20 +47,68 @@ protected:
     float envSteps = 0.00001f;
     AsrEnvelop env = { &envSteps, &envSteps, NULL };
 
-    struct Grain {
-        uint64_t index = 0;
-        float position = 0.0f;
-        float positionIncrement = 1.0f;
-        EnvelopRelative env = EnvelopRelative({ { 0.0f, 0.0f }, { 1.0f, 0.0f }, { 1.0f, 0.0f }, { 0.0f, 1.0f } });
-    } grains[MAX_GRAINS];
+    GrainPool<MAX_GRAINS> pool;
+    // Half the grains are played for each level, see `setQualityLevel()`
+    uint8_t qualityLevel = 0;
+
+    // `writeIndex` is the buffer index at the frame where the grain starts
+    void initGrain(uint8_t densityIndex, uint64_t writeIndex)
+    {
+        float position = writeIndex + densityIndex * grainDelay + grainDelay * getRand() * delayRandomize.pct();
+        while (position >= buffer.size) {
+            position -= buffer.size;
+        }
+        float increment = positionIncrement * direction.get() + positionIncrement * getRand() * pitchRandomize.pct();
+        pool.start(densityIndex, position, increment, grainDuration, velocity);
+    }
+
+    // Frames processed at once: the input is recorded then the grains are rendered over the chunk
+    static const uint32_t CHUNK = 64;
 
-    void initGrain(uint8_t densityIndex)
+    void process(float* lane, uint32_t stride, uint32_t frames)
     {
-        Grain& grain = grains[densityIndex];
-        grain.index = 0;
-        grain.position = buffer.index + densityIndex * grainDelay + grainDelay * getRand() * delayRandomize.pct();
-        grain.positionIncrement = positionIncrement * direction.get() + positionIncrement * getRand() * pitchRandomize.pct();
-        grain.env.reset(grainDuration);
+        float mainEnv[CHUNK];
+        float out[CHUNK];
+        for (uint32_t start = 0; start < frames; start += CHUNK) {
+            uint32_t count = std::min(CHUNK, frames - start);
+            float* chunk = lane + start * stride;
+            uint64_t startIndex = buffer.index;
+            for (uint32_t f = 0; f < count; f++) {
+                buffer.addSample(chunk[f * stride]);
+            }
+
+            // Grains only move while the effect is applied
+            bool active = false;
+            env.render(mainEnv, count);
+            for (uint32_t f = 0; f < count; f++) {
+                active = active || mainEnv[f] > 0.0f;
+            }
+            if (!active) {
+                continue;
+            }
+
+            std::fill(out, out + count, 0.0f);
+            uint8_t grainCount = std::max((int)density.get() >> qualityLevel, 1);
+            for (uint8_t i = 0; i < grainCount; i++) {
+                uint32_t done = 0;
+                while (done < count) {
+                    done += pool.render(i, out + done, count - done, buffer.samples, buffer.size, true);
+                    if (done < count) {
+                        initGrain(i, (startIndex + done) % buffer.size);
+                        if (grainDuration == 0) {
+                            break;
+                        }
+                    }
+                }
+            }
+
+            float divider = 1.0f / grainCount;
+            for (uint32_t f = 0; f < count; f++) {
+                if (mainEnv[f] > 0.0f) {
+                    chunk[f * stride] = chunk[f * stride] * (1.0f - mainEnv[f]) + out[f] * divider * mainEnv[f];
+                }
+            }
+        }
     }
 
     float getRand()
@@ -94,11 +144,7 @@ public:
     void setEnvelop(float value)
     {
         envelop.setFloat(value);
-        for (uint8_t i = 0; i < MAX_GRAINS; i++) {
-            grains[i].env.data[1].time = envelop.pct() * 0.5f;
-            grains[i].env.data[2].time = 1.0f - envelop.pct() * 0.5f;
-            // printf("%f %f\n", grains[i].env.data[0].time, grains[i].env.data[1].time);
-        }
+        pool.setFade(envelop.pct() * 0.5f);
     }
 
     void setDensityDelay(float value)
@@ -115,32 +161,18 @@ public:
 
     void sample(float* buf)
     {
-        buffer.addSample(buf[track]);
-
-        float mainEnv = env.next();
-        if (mainEnv > 0.0f) {
-            // if (mainEnv < 1) printf("env %f\n", mainEnv);
-            float out = 0.0f;
-            for (uint8_t i = 0; i < density.get(); i++) {
-                Grain& grain = grains[i];
-                if (grain.index++ < grainDuration) {
-                    grain.position += grain.positionIncrement;
-                    while (grain.position >= buffer.size) {
-                        grain.position -= buffer.size;
-                    }
-                    while (grain.position < 0) {
-                        grain.position += buffer.size;
-                    }
-                } else {
-                    initGrain(i);
-                }
-                float grainEnv = grain.env.next();
-                // printf("time %f env %f\n", grain.index / (float)grainDuration, env);
-                out += buffer.samples[(int)grain.position] * velocity * grainEnv;
-            }
-            out = out / density.get();
-            buf[track] = buf[track] * (1.0f - mainEnv) + out * mainEnv;
-        }
+        process(buf + track, 1, 1);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        process(trackLane(buf, track), props.frameStride, frames);
+    }
+
+    // The grains are averaged, so playing fewer of them keeps the level
+    void setQualityLevel(uint8_t level) override
+    {
+        qualityLevel = level;
     }
 
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
@@ -153,7 +185,7 @@ public:
         velocity = _velocity;
         positionIncrement = pow(2, ((note - baseNote + pitch.get()) / 12.0));
         for (uint8_t i = 0; i < density.get(); i++) {
-            initGrain(i);
+            initGrain(i, buffer.index);
         }
     }
 
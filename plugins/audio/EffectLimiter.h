@@ -0,0 +1,91 @@
+#pragma once
+
+#include "audioPlugin.h"
+#include "mapping.h"
+#include "audio/Limiter.h"
+
+#include <string>
+
+/*md
+## EffectLimiter
+
+EffectLimiter plugin is a lookahead compressor / limiter, meant to be the last plugin of the master track so the
+output never clips.
+
+The signal is delayed by the lookahead, so the gain is already lowered when a peak reaches the output, see
+`audio/Limiter.h`. The delay is reported to the host, that delays the other tracks by the same amount.
+*/
+class EffectLimiter : public Mapping {
+protected:
+    Limiter limiter;
+    bool stereo = true;
+    float inputGain = 1.0f;
+
+public:
+    /*md **Values**: */
+    /*md - `THRESHOLD` set the level the output must not go over. */
+    Val& threshold = val(-1.0f, "THRESHOLD", { "Threshold", .min = -30.0f, .max = 0.0f, .step = 0.1f, .floatingPoint = 1, .unit = "dB" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        limiter.setThreshold(p.val.get());
+    });
+
+    /*md - `RATIO` set the compression ratio, the maximum being a limiter. */
+    Val& ratio = val(20.0f, "RATIO", { "Ratio", VALUE_STRING, .min = 1.0f, .max = 20.0f, .step = 0.5f }, [&](auto p) {
+        p.val.setFloat(p.value);
+        if (p.val.get() >= p.val.props().max) {
+            limiter.setRatio(INFINITY);
+            p.val.setString("Limit");
+        } else {
+            limiter.setRatio(p.val.get());
+            p.val.setNumber((int)p.val.get(), 0, ":1");
+        }
+    });
+
+    /*md - `RELEASE` set the time for the gain to come back after a peak. */
+    Val& release = val(100.0f, "RELEASE", { "Release", .min = 10.0f, .max = 1000.0f, .step = 10.0f, .unit = "ms" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        limiter.setRelease(p.val.get() * 0.001f);
+    });
+
+    /*md - `GAIN` set the gain applied before the limiter. */
+    Val& gain = val(0.0f, "GAIN", { "Gain", .min = 0.0f, .max = 24.0f, .step = 0.5f, .floatingPoint = 1, .unit = "dB" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        inputGain = powf(10.0f, p.val.get() / 20.0f);
+    });
+
+    EffectLimiter(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : Mapping(props, config)
+        //md **Config**:
+        //md - `"lookahead": 5` milliseconds the signal is delayed by, from 0 to 20.
+        , limiter(props.sampleRate, props.sampleRate * std::clamp(config.json.value("lookahead", 5.0f), 0.0f, 20.0f) * 0.001f)
+    {
+        //md - `"stereo": true` limit both channels with the same gain, when the host buffer is stereo.
+        stereo = config.json.value("stereo", stereo);
+        initValues();
+    }
+
+    bool isStereo() override
+    {
+        return stereo && hasStereoBuffer();
+    }
+
+    void sample(float* buf)
+    {
+        limiter.process(buf + track, NULL, 1, 1, inputGain);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        limiter.process(trackLane(buf, track), isStereo() ? rightLane(buf, track) : NULL, props.frameStride, frames, inputGain);
+    }
+
+    uint32_t latencyFrames() override
+    {
+        return limiter.latency();
+    }
+
+    uint32_t tailFrames() override
+    {
+        return limiter.latency();
+    }
+};
@@ -0,0 +1,118 @@
+#pragma once
+
+#include "audioPlugin.h"
+#include "mapping.h"
+#include "audio/Biquad.h"
+
+/*md
+## EffectParametricEq
+
+EffectParametricEq plugin is a 6 band parametric equalizer: low cut, low shelf, 2 peaks, high shelf and high cut,
+typically used on the master track.
+
+The bands are the sections of a biquad cascade processed by block, see `audio/Biquad.h`. Changing a value only
+marks the filters to be designed again before the next block, so sweeping a knob costs a single design per block.
+*/
+class EffectParametricEq : public Mapping {
+protected:
+    enum Section {
+        LOW_CUT_SECTION,
+        LOW_SHELF_SECTION,
+        PEAK1_SECTION,
+        PEAK2_SECTION,
+        HIGH_SHELF_SECTION,
+        HIGH_CUT_SECTION,
+        SECTION_COUNT
+    };
+
+    BiquadCascade<SECTION_COUNT> left;
+    BiquadCascade<SECTION_COUNT> right;
+    bool stereo = true;
+    bool dirty = true;
+
+    void setDirty(Val::CallbackProps p)
+    {
+        p.val.setFloat(p.value);
+        dirty = true;
+    }
+
+    void updateSection(uint8_t i, const BiquadCoeffs& c)
+    {
+        left.setSection(i, c);
+        right.setSection(i, c);
+    }
+
+    void updateCoeffs()
+    {
+        dirty = false;
+        float sr = props.sampleRate;
+        // Cuts are off at the end of their range
+        updateSection(LOW_CUT_SECTION, lowCut.get() <= lowCut.props().min ? BiquadCoeffs() : BiquadCoeffs::highpass(lowCut.get(), BiquadCoeffs::BUTTERWORTH_Q, sr));
+        updateSection(LOW_SHELF_SECTION, BiquadCoeffs::lowShelf(lowFreq.get(), lowGain.get(), sr));
+        updateSection(PEAK1_SECTION, BiquadCoeffs::peak(mid1Freq.get(), mid1Q.get(), mid1Gain.get(), sr));
+        updateSection(PEAK2_SECTION, BiquadCoeffs::peak(mid2Freq.get(), mid2Q.get(), mid2Gain.get(), sr));
+        updateSection(HIGH_SHELF_SECTION, BiquadCoeffs::highShelf(highFreq.get(), highGain.get(), sr));
+        updateSection(HIGH_CUT_SECTION, highCut.get() >= highCut.props().max ? BiquadCoeffs() : BiquadCoeffs::lowpass(highCut.get(), BiquadCoeffs::BUTTERWORTH_Q, sr));
+    }
+
+public:
+    /*md **Values**: */
+    /*md - `LOW_CUT` set the frequency of the 12dB/octave low cut, off at 20Hz. */
+    Val& lowCut = val(20.0f, "LOW_CUT", { "Low cut", .min = 20.0f, .max = 1000.0f, .step = 5.0f, .unit = "Hz" }, [&](auto p) { setDirty(p); });
+    /*md - `LOW_FREQ` set the frequency of the low shelf. */
+    Val& lowFreq = val(100.0f, "LOW_FREQ", { "Low freq.", .min = 20.0f, .max = 1000.0f, .step = 5.0f, .unit = "Hz" }, [&](auto p) { setDirty(p); });
+    /*md - `LOW_GAIN` set the gain of the low shelf. */
+    Val& lowGain = val(0.0f, "LOW_GAIN", { "Low gain", .type = VALUE_CENTERED, .min = -18.0f, .max = 18.0f, .step = 0.5f, .floatingPoint = 1, .unit = "dB" }, [&](auto p) { setDirty(p); });
+    /*md - `MID1_FREQ` set the frequency of the first peak. */
+    Val& mid1Freq = val(500.0f, "MID1_FREQ", { "Mid 1 freq.", .min = 50.0f, .max = 10000.0f, .step = 10.0f, .unit = "Hz" }, [&](auto p) { setDirty(p); });
+    /*md - `MID1_GAIN` set the gain of the first peak. */
+    Val& mid1Gain = val(0.0f, "MID1_GAIN", { "Mid 1 gain", .type = VALUE_CENTERED, .min = -18.0f, .max = 18.0f, .step = 0.5f, .floatingPoint = 1, .unit = "dB" }, [&](auto p) { setDirty(p); });
+    /*md - `MID1_Q` set the width of the first peak, higher is narrower. */
+    Val& mid1Q = val(1.0f, "MID1_Q", { "Mid 1 Q", .min = 0.1f, .max = 10.0f, .step = 0.1f, .floatingPoint = 1 }, [&](auto p) { setDirty(p); });
+    /*md - `MID2_FREQ` set the frequency of the second peak. */
+    Val& mid2Freq = val(3000.0f, "MID2_FREQ", { "Mid 2 freq.", .min = 200.0f, .max = 16000.0f, .step = 10.0f, .unit = "Hz" }, [&](auto p) { setDirty(p); });
+    /*md - `MID2_GAIN` set the gain of the second peak. */
+    Val& mid2Gain = val(0.0f, "MID2_GAIN", { "Mid 2 gain", .type = VALUE_CENTERED, .min = -18.0f, .max = 18.0f, .step = 0.5f, .floatingPoint = 1, .unit = "dB" }, [&](auto p) { setDirty(p); });
+    /*md - `MID2_Q` set the width of the second peak, higher is narrower. */
+    Val& mid2Q = val(1.0f, "MID2_Q", { "Mid 2 Q", .min = 0.1f, .max = 10.0f, .step = 0.1f, .floatingPoint = 1 }, [&](auto p) { setDirty(p); });
+    /*md - `HIGH_FREQ` set the frequency of the high shelf. */
+    Val& highFreq = val(8000.0f, "HIGH_FREQ", { "High freq.", .min = 1000.0f, .max = 16000.0f, .step = 50.0f, .unit = "Hz" }, [&](auto p) { setDirty(p); });
+    /*md - `HIGH_GAIN` set the gain of the high shelf. */
+    Val& highGain = val(0.0f, "HIGH_GAIN", { "High gain", .type = VALUE_CENTERED, .min = -18.0f, .max = 18.0f, .step = 0.5f, .floatingPoint = 1, .unit = "dB" }, [&](auto p) { setDirty(p); });
+    /*md - `HIGH_CUT` set the frequency of the 12dB/octave high cut, off at 20kHz. */
+    Val& highCut = val(20000.0f, "HIGH_CUT", { "High cut", .min = 1000.0f, .max = 20000.0f, .step = 100.0f, .unit = "Hz" }, [&](auto p) { setDirty(p); });
+
+    EffectParametricEq(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : Mapping(props, config)
+    {
+        //md **Config**:
+        //md - `"stereo": true` equalize both channels, when the host buffer is stereo.
+        stereo = config.json.value("stereo", stereo);
+        initValues();
+        updateCoeffs();
+    }
+
+    bool isStereo() override
+    {
+        return stereo && hasStereoBuffer();
+    }
+
+    void sample(float* buf)
+    {
+        if (dirty) {
+            updateCoeffs();
+        }
+        buf[track] = left.process(buf[track]);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (dirty) {
+            updateCoeffs();
+        }
+        left.processBlock(trackLane(buf, track), props.frameStride, frames);
+        if (isStereo()) {
+            right.processBlock(rightLane(buf, track), props.frameStride, frames);
+        }
+    }
+};
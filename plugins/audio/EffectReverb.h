@@ -0,0 +1,95 @@
+#pragma once
+
+#include "audioPlugin.h"
+#include "mapping.h"
+#include "audio/FdnReverb.h"
+
+/*md
+## EffectReverb
+
+EffectReverb plugin is a feedback delay network reverb, see `audio/FdnReverb.h`.
+
+Its delay lines are taken from a pool shared by all the plugins while the mix is above 0, so a reverb that is not
+used doesn't hold any memory.
+*/
+class EffectReverb : public Mapping {
+protected:
+    FdnReverb reverb;
+    bool stereo = true;
+
+public:
+    /*md **Values**: */
+    /*md - `DECAY` set the time for the tail to decay by 60dB. */
+    Val& decay = val(2.0f, "DECAY", { "Decay", .min = 0.1f, .max = 10.0f, .step = 0.1f, .floatingPoint = 1, .unit = "s" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        reverb.setDecay(p.val.get());
+    });
+
+    /*md - `DAMPING` set how fast the high frequencies fade out. */
+    Val& damping = val(30.0f, "DAMPING", { "Damping", .unit = "%" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        reverb.setDamping(p.val.pct());
+    });
+
+    /*md - `SIZE` set the size of the room. */
+    Val& size = val(100.0f, "SIZE", { "Size", .min = 10.0f, .unit = "%" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        reverb.setSize(p.val.get() * 0.01f);
+    });
+
+    /*md - `MIX` set the reverb vs the original signal. */
+    Val& mix = val(30.0f, "MIX", { "Mix", .unit = "%" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        if (p.val.get() > 0.0f) {
+            reverb.activate();
+        } else {
+            reverb.deactivate();
+        }
+    });
+
+    EffectReverb(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : Mapping(props, config)
+        , reverb(props.sampleRate)
+    {
+        //md **Config**:
+        //md - `"stereo": true` mono input, stereo output, when the host buffer is stereo.
+        stereo = config.json.value("stereo", stereo);
+        initValues();
+    }
+
+    bool isStereo() override
+    {
+        return stereo && hasStereoBuffer();
+    }
+
+    void sample(float* buf)
+    {
+        float in = buf[track];
+        buf[track] = in + (reverb.process(in) - in) * mix.pct();
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        float mixAmount = mix.pct();
+        if (!reverb.isActive()) {
+            return;
+        }
+        if (isStereo()) {
+            float* right = rightLane(buf, track);
+            for (uint32_t f = 0; f < frames; f++) {
+                float in = lane[f * stride];
+                float l, r;
+                reverb.process(in, l, r);
+                lane[f * stride] = in + (l - in) * mixAmount;
+                right[f * stride] = in + (r - in) * mixAmount;
+            }
+            return;
+        }
+        for (uint32_t f = 0; f < frames; f++) {
+            float in = lane[f * stride];
+            lane[f * stride] = in + (reverb.process(in) - in) * mixAmount;
+        }
+    }
+};
@@ -20,6 +20,7 @@ sha: ea3260f81654dbab5d43d9009be948ddd78a2a235a772a4af5c33625be9634d9
 #include "log.h"
 #include "mapping.h"
 #include "audio/effects/applyRingMod.h"
+#include "audio/filter.h"
 #include "audio/effects/applySampleReducer.h"
 #include "audio/effects/applyDecimator.h"
 #include "audio/effects/applyBitcrusher.h"
@@ -137,10 +138,7 @@ protected:
     float cutoff = 0.05f; // 0..1
     inline void setSampleData(float inputValue, float& _buf, float& _hp, float& _bp, float& _lp)
     {
-        _hp = inputValue - _buf;
-        _bp = _buf - _lp;
-        _buf = _buf + cutoff * _hp;
-        _lp = _lp + cutoff * (_buf - _lp);
+        EffectFilterData::svf(inputValue, cutoff, 0.0f, _buf, _hp, _bp, _lp);
     }
     // Low-pass FX
     float fxLowPass(float input, float amount)
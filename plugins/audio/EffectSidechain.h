@@ -0,0 +1,155 @@
+#pragma once
+
+#include "audio/utils/dbTable.h"
+#include "audioPlugin.h"
+#include "mapping.h"
+
+#include <cmath>
+#include <string>
+
+/*md
+## EffectSidechain
+
+EffectSidechain plugin ducks its track under another one, the key track, e.g. the bass under the kick. The lane of
+the key track is read in place, during the block it is rendered in, without copying it nor mixing it.
+
+The key track is declared as a sidechain key (see `AudioPlugin::keyTracks()`), not as a track dependency: the track
+keeps running in parallel with the others, only waiting for the key track to be done with the block. Each block, an
+envelope follower on the peak of the key and a gain computer give the gain at the end of the block, the gain ramping
+to it over the block, so it doesn't click.
+
+```json
+{ "id": 2, "plugins": [
+    { "plugin": "SynthBass" },
+    { "plugin": "EffectSidechain", "keyTrack": 1 }
+] }
+```
+*/
+class EffectSidechain : public Mapping {
+protected:
+    DbTable& db = DbTable::get();
+    int16_t keyTrack = -1;
+    float envelope = 0.0f;
+    // Gain at the end of the last block, the next block ramping from it
+    float gain = 1.0f;
+    float slope = 0.0f;
+    float attackMs = 1.0f;
+    float releaseMs = 150.0f;
+
+    // One pole coefficient for `frames` frames, `ms` being the time constant
+    float coef(float ms, uint32_t frames)
+    {
+        return expf(-(float)frames / (ms * props.sampleRate * 0.001f));
+    }
+
+    // Follow the peak of the key over `frames`, returning the gain to reach at their end
+    float follow(float peak, uint32_t frames)
+    {
+        float c = coef(peak > envelope ? attackMs : releaseMs, frames);
+        envelope = peak + (envelope - peak) * c;
+        float over = db.toDb(envelope) - threshold.get();
+        if (over <= 0.0f) {
+            return 1.0f;
+        }
+        return db.toGain(-std::min(over * slope, range.get()));
+    }
+
+public:
+    /*md **Values**: */
+    /*md - `THRESHOLD` set the level of the key above which the track is ducked. */
+    Val& threshold = val(-30.0f, "THRESHOLD", { "Threshold", .min = -60.0f, .max = 0.0f, .step = 0.5f, .floatingPoint = 1, .unit = "dB" });
+
+    /*md - `RATIO` set how much the track is ducked for the level of the key over the threshold. */
+    Val& ratio = val(8.0f, "RATIO", { "Ratio", VALUE_STRING, .min = 1.0f, .max = 20.0f, .step = 0.5f }, [&](auto p) {
+        p.val.setFloat(p.value);
+        slope = 1.0f - 1.0f / p.val.get();
+        p.val.setNumber(p.val.get(), 1, ":1");
+    });
+
+    /*md - `ATTACK` set the time for the ducking to follow a hit of the key. Below the length of a block, the track is ducked within the block of the hit. */
+    Val& attack = val(1.0f, "ATTACK", { "Attack", .min = 0.1f, .max = 50.0f, .step = 0.1f, .floatingPoint = 1, .unit = "ms" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        attackMs = p.val.get();
+    });
+
+    /*md - `RELEASE` set the time for the track to come back once the key is under the threshold. */
+    Val& release = val(150.0f, "RELEASE", { "Release", .min = 10.0f, .max = 1000.0f, .step = 10.0f, .unit = "ms" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        releaseMs = p.val.get();
+    });
+
+    /*md - `RANGE` set the maximum the track is ducked by. */
+    Val& range = val(24.0f, "RANGE", { "Range", .min = 0.0f, .max = 60.0f, .step = 0.5f, .floatingPoint = 1, .unit = "dB" });
+
+    EffectSidechain(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : Mapping(props, config)
+    {
+        //md **Config**:
+        //md - `"keyTrack": 1` the track ducking this one.
+        keyTrack = config.json.value("keyTrack", keyTrack);
+        if (keyTrack < 0 || keyTrack >= (int16_t)props.maxTracks) {
+            logWarn("EffectSidechain: no valid keyTrack, the track is not ducked");
+            keyTrack = -1;
+        }
+        initValues();
+    }
+
+    bool isStereo() override
+    {
+        return hasStereoBuffer();
+    }
+
+    std::set<uint8_t> keyTracks() override
+    {
+        if (keyTrack < 0 || keyTrack == track) {
+            return {};
+        }
+        return { (uint8_t)keyTrack };
+    }
+
+    void sample(float* buf) override
+    {
+        if (keyTrack < 0) {
+            return;
+        }
+        gain = follow(fabsf(buf[keyTrack]), 1);
+        buf[track] *= gain;
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (keyTrack < 0 || keyTrack == track) {
+            return;
+        }
+        const uint32_t stride = props.frameStride;
+        float peak = 0.0f;
+        if (!isSilentTrack(keyTrack)) {
+            bool keyStereo = isStereoTrack(keyTrack);
+            const float* key = trackLane(buf, keyTrack);
+            const float* keyRight = rightLane(buf, keyTrack);
+            for (uint32_t f = 0; f < frames; f++) {
+                peak = std::max(peak, fabsf(key[f * stride]));
+                if (keyStereo) {
+                    peak = std::max(peak, fabsf(keyRight[f * stride]));
+                }
+            }
+        }
+
+        float start = gain;
+        gain = follow(peak, frames);
+        if (start == 1.0f && gain == 1.0f) {
+            return;
+        }
+        float step = (gain - start) / frames;
+        float* out = trackLane(buf, track);
+        float* outRight = isStereo() ? rightLane(buf, track) : NULL;
+        float g = start;
+        for (uint32_t f = 0; f < frames; f++) {
+            g += step;
+            out[f * stride] *= g;
+            if (outRight) {
+                outRight[f * stride] *= g;
+            }
+        }
+    }
+};
@@ -18,6 +18,7 @@ sha: 019872813e3ec8e88e50a7b8a5594f02e60ccb0ef458b2fd55f3aacb33da9d30
 #include "audio/effects/applyClipping.h"
 #include "audio/effects/applyDrive.h"
 #include "audio/effects/applyWaveshape.h"
+#include "audio/utils/Oversampler.h"
 
 /*md
 ## EffectVolumeClipping
@@ -25,6 +26,9 @@ sha: 019872813e3ec8e88e50a7b8a5594f02e60ccb0ef458b2fd55f3aacb33da9d30
 EffectVolumeClipping plugin is used to clipping and volume on audio buffer.
 */
 class EffectVolumeClipping : public Mapping {
+protected:
+    Oversampler oversampler;
+
 public:
     /*md **Values**: */
     /*md - `VOLUME` to set volume. Till 100, it is the volume percentage, after 100 it is the gain. */
@@ -52,12 +56,12 @@ public:
             driveAmount = (p.val.get() - 100.0f) / 100.0f;
             waveshapeAmount = 0.0f;
             p.val.props().label = "Drive";
-            p.val.setString(std::to_string((int)(driveAmount * 100)) + "%");
+            p.val.setNumber((int)(driveAmount * 100), 0, "%");
         } else {
             driveAmount = 0.0f;
             waveshapeAmount = (100.0f - p.val.get()) / 100.0f;
             p.val.props().label = "Waveshape";
-            p.val.setString(std::to_string((int)(waveshapeAmount * 100)) + "%");
+            p.val.setNumber((int)(waveshapeAmount * 100), 0, "%");
         }
     });
 
@@ -65,6 +69,9 @@ public:
         : Mapping(props, config)
     {
         initValues();
+
+        //md - `"oversampling": 4` run the waveshaper, drive and clipping at 2, 4 or 8 times the sample rate to reduce aliasing, delaying the track by a few frames. Default is `1`, disabled.
+        oversampler.setFactor(config.json.value("oversampling", 1));
     }
 
     void sample(float* buf)
@@ -76,4 +83,31 @@ public:
 
         buf[track] = output * volume.pct();
     }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        LookupTable* lookupTable = props.lookupTable;
+        oversampler.process(lane, stride, frames, [&](float* samples, uint32_t count) {
+            applyWaveshapeBlock(samples, 1, count, waveshapeAmount, lookupTable);
+            applyDriveBlock(samples, 1, count, driveAmount, lookupTable);
+            applyClippingBlock(samples, 1, count, scaledClipping);
+        });
+        float gain = volume.pct();
+        for (uint32_t f = 0; f < frames; f++) {
+            lane[f * stride] *= gain;
+        }
+    }
+
+    uint32_t latencyFrames() override
+    {
+        return oversampler.latencyFrames();
+    }
+
+    // Half the oversampling for each level, the latency staying the same
+    void setQualityLevel(uint8_t level) override
+    {
+        oversampler.limitFactor(oversampler.getFactor() >> level);
+    }
 };
@@ -48,7 +48,7 @@ public:
         if (p.val.get() <= 100.0f) {
             volumeWithGain = 100.0f / p.val.get();
             p.val.props().label = "Volume";
-            p.val.setString(std::to_string((int)p.val.get()) + "%");
+            p.val.setNumber((int)p.val.get(), 0, "%");
         } else {
             // take difference between 100 and 200
             // then multiply by 0.20 to get a max value of 20.0f
@@ -75,12 +75,12 @@ public:
             driveAmount = (p.val.get() - 100.0f) / 100.0f;
             compressAmount = 0.0f;
             p.val.props().label = "Drive";
-            p.val.setString(std::to_string((int)(driveAmount * 100)) + "%");
+            p.val.setNumber((int)(driveAmount * 100), 0, "%");
         } else {
             driveAmount = 0.0f;
             compressAmount = (100.0f - p.val.get()) / 100.0f;
             p.val.props().label = "Compressor";
-            p.val.setString(std::to_string((int)(compressAmount * 100)) + "%");
+            p.val.setNumber((int)(compressAmount * 100), 0, "%");
         }
     });
 
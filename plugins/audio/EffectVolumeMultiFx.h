@@ -47,7 +47,7 @@ public:
 
     EffectVolumeMultiFx(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
     {
         initValues();
     }
@@ -58,6 +58,16 @@ public:
         buf[track] = out * volumeWithGain;
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        multiFx.applyBlock(lane, stride, frames, fxAmount.pct());
+        for (uint32_t f = 0; f < frames; f++) {
+            lane[f * stride] *= volumeWithGain;
+        }
+    }
+
     EffectVolumeMultiFx& setVolumeWithGain(float vol, float _gain)
     {
         gain.setFloat(_gain);
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <string>
+#include <vector>
+
+#include "audioPlugin.h"
+#include "log.h"
+
+/*md
+## LatencyProbe
+
+LatencyProbe audio plugin measures the latency of the whole chain, to tune `latency`, `periodSize` and the scheduler
+with measurements. Each measurement is a trial, and every `trials` trials, their distribution is logged:
+`LatencyProbe loopback: 100 trials, min 10.67 ms, median 10.67 ms, p99 10.69 ms, mean 10.67 ms, jitter 0.01 ms, 0 missed`,
+the jitter being the standard deviation. A diagnostic plugin, not meant to stay in a project.
+
+In `loopback` mode, the output of the sound card is connected to its input with a cable. The probe, placed on a
+track of its own routed to the output like any other track, plays an impulse every `interval` and detects it on the
+track of an `AudioInputAlsa` reading the input. The round trip goes through the whole graph, the output and the input
+buffers, the converters and the cable.
+
+```json
+{ "id": 1, "plugins": [{ "plugin": "AudioInputAlsa", "duplex": "AudioOutputAlsa" }] },
+{ "id": 2, "plugins": [{ "plugin": "LatencyProbe", "mode": "loopback", "input": 1 }] }
+```
+
+In `midi` mode, the probe is placed after a synth and measures the time between a note-on read on the MIDI input and
+the moment the sound of the synth leaves the sound card: the first frame of the track above `threshold` after the
+note-on, delayed by the frames queued in front of it in the output. Play short notes, separated by silence.
+
+```json
+{ "id": 1, "plugins": [{ "plugin": "SynthFM2" }, { "plugin": "LatencyProbe", "mode": "midi" }] }
+```
+*/
+class LatencyProbe : public AudioPlugin {
+protected:
+    AudioPlugin::Props& props;
+
+    enum Mode {
+        LOOPBACK,
+        MIDI,
+    } mode = LOOPBACK;
+
+    uint16_t inputTrack = 0;
+    float threshold = 0.1f;
+    float level = 0.9f;
+    uint32_t intervalFrames = 0;
+    uint32_t timeoutFrames = 0;
+    std::string outputName = "AudioOutputAlsa";
+    AudioPlugin* output = NULL;
+    bool outputSearched = false;
+    uint8_t delayDataId = 0;
+
+    // Latency of each trial of the series, in ms, allocated once as the trials are measured by the audio thread
+    std::vector<float> trials;
+    std::vector<float> sorted;
+    uint32_t trialCount = 0;
+    uint32_t missed = 0;
+
+    // Loopback: frame of the impulse waiting to be detected, 0 when none
+    uint64_t impulseFrame = 0;
+    uint64_t nextImpulseFrame = 0;
+
+    // Midi: time of the note-on waiting for its sound, 0 when none
+    int64_t lastNoteOnTime = 0;
+    int64_t noteOnTime = 0;
+
+    static int64_t nowNs()
+    {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    uint64_t blockFrame()
+    {
+        return props.audioPluginHandler ? props.audioPluginHandler->getBlockFrame() : 0;
+    }
+
+    // First frame of the lane above the threshold, `frames` if none
+    uint32_t onset(float* lane, uint32_t frames)
+    {
+        const uint32_t stride = props.frameStride;
+        for (uint32_t f = 0; f < frames; f++) {
+            if (std::fabs(lane[f * stride]) >= threshold) {
+                return f;
+            }
+        }
+        return frames;
+    }
+
+    void addTrial(float ms)
+    {
+        trials[trialCount++] = ms;
+        if (trialCount == trials.size()) {
+            report();
+        }
+    }
+
+    // Log the distribution of the series and start the next one. Sorting is done in place in the preallocated copy,
+    // once per series.
+    void report()
+    {
+        std::copy(trials.begin(), trials.begin() + trialCount, sorted.begin());
+        std::sort(sorted.begin(), sorted.begin() + trialCount);
+        double sum = 0.0;
+        for (uint32_t i = 0; i < trialCount; i++) {
+            sum += sorted[i];
+        }
+        double mean = sum / trialCount;
+        double variance = 0.0;
+        for (uint32_t i = 0; i < trialCount; i++) {
+            variance += (sorted[i] - mean) * (sorted[i] - mean);
+        }
+        float p99 = sorted[std::min<uint32_t>(trialCount - 1, (uint32_t)std::ceil(trialCount * 0.99f) - 1)];
+        logInfo("LatencyProbe %s: %u trials, min %.2f ms, median %.2f ms, p99 %.2f ms, mean %.2f ms, jitter %.2f ms, %u missed",
+            mode == MIDI ? "midi" : "loopback", trialCount, sorted[0], sorted[trialCount / 2], p99, mean,
+            std::sqrt(variance / trialCount), missed);
+        trialCount = 0;
+        missed = 0;
+    }
+
+    void loopback(float* buf, uint32_t frames)
+    {
+        uint64_t frame = blockFrame();
+        // The input of this block was read before the probe, the impulse can be in it from the next block on
+        if (impulseFrame && frame > impulseFrame) {
+            uint32_t f = onset(trackLane(buf, inputTrack), frames);
+            if (f < frames) {
+                addTrial((frame + f - impulseFrame) * 1000.0f / props.sampleRate);
+                impulseFrame = 0;
+            } else if (frame + frames - impulseFrame > timeoutFrames) {
+                missed++;
+                impulseFrame = 0;
+            }
+        }
+
+        float* lane = trackLane(buf, track);
+        const uint32_t stride = props.frameStride;
+        for (uint32_t f = 0; f < frames; f++) {
+            lane[f * stride] = 0.0f;
+        }
+        // Only one impulse in flight, so a late one is not taken for the next
+        if (!impulseFrame && frame >= nextImpulseFrame) {
+            lane[0] = level;
+            impulseFrame = frame;
+            nextImpulseFrame = frame + intervalFrames;
+        }
+    }
+
+    void midi(float* buf, uint32_t frames)
+    {
+        if (!noteOnTime) {
+            return;
+        }
+        uint32_t f = onset(trackLane(buf, track), frames);
+        int64_t now = nowNs();
+        if (f < frames) {
+            int64_t queued = 0;
+            if (output) {
+                // snd_pcm_sframes_t
+                long* delay = (long*)output->data(delayDataId);
+                queued = delay ? *delay : 0;
+            }
+            // The frame is heard once the frames queued in the output, and the ones before it in the block, are played
+            int64_t leaveTime = now + (queued + f) * 1000000000LL / props.sampleRate;
+            addTrial((leaveTime - noteOnTime) / 1000000.0f);
+            noteOnTime = 0;
+        } else if (now - noteOnTime > (int64_t)timeoutFrames * 1000000000LL / props.sampleRate) {
+            missed++;
+            noteOnTime = 0;
+        }
+    }
+
+public:
+    LatencyProbe(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : AudioPlugin(props, config)
+        , props(props)
+    {
+        //md **Config**:
+        auto& json = config.json;
+        //md - `"mode": "loopback"` to measure the round trip through a loopback cable, or `"midi"` from the MIDI input to the sound. Default is `loopback`.
+        mode = json.value("mode", "loopback") == "midi" ? MIDI : LOOPBACK;
+        //md - `"input": 1` the track of the `AudioInputAlsa` reading the loopback cable.
+        inputTrack = json.value("input", inputTrack);
+        //md - `"threshold": 0.1` the level above which the impulse, or the sound of the note, is detected. Default is 0.1.
+        threshold = json.value("threshold", threshold);
+        //md - `"level": 0.9` the level of the impulse. Default is 0.9.
+        level = json.value("level", level);
+        //md - `"interval": 500` the time between two impulses in ms, and the time after which an impulse or a note not detected is missed. Default is 500.
+        intervalFrames = json.value("interval", 500) * props.sampleRate / 1000;
+        timeoutFrames = intervalFrames;
+        //md - `"trials": 100` the number of trials of each series logged. Default is 100.
+        uint32_t count = std::max(json.value("trials", 100), 1);
+        trials.resize(count);
+        sorted.resize(count);
+        //md - `"output": "AudioOutputAlsa"` the name of the output plugin, to know the frames queued in front of the sound in `midi` mode.
+        outputName = json.value("output", outputName);
+    }
+
+    std::set<uint8_t> trackDependencies() override
+    {
+        if (mode == LOOPBACK) {
+            return { (uint8_t)inputTrack };
+        }
+        return {};
+    }
+
+    void noteOn(uint8_t note, float velocity, void* userdata = NULL) override
+    {
+        // Only the notes coming from the MIDI input are measured, not the ones of the sequencers
+        int64_t time = props.audioPluginHandler ? props.audioPluginHandler->getMidiNoteOnTime() : 0;
+        if (mode == MIDI && time != lastNoteOnTime) {
+            lastNoteOnTime = time;
+            noteOnTime = time;
+        }
+    }
+
+    // The onsets are found within the blocks, see sampleBlock()
+    void sample(float* buf) override
+    {
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (mode == LOOPBACK) {
+            loopback(buf, frames);
+            return;
+        }
+        // Once all the plugins are loaded
+        if (!outputSearched && props.audioPluginHandler) {
+            outputSearched = true;
+            output = props.audioPluginHandler->getPluginPtr(outputName);
+            if (output) {
+                delayDataId = output->getDataId("DELAY");
+            } else {
+                logWarn("LatencyProbe output %s not found, the frames queued in the output are not counted", outputName.c_str());
+            }
+        }
+        midi(buf, frames);
+    }
+};
@@ -23,15 +23,17 @@ sha: 502ad9db2a3f2743f5e07ca30feaa662c04943e7573251b01a7846607e47568b
 
 #include "audioPlugin.h"
 #include "mapping.h"
+#include "audio/utils/mixLane.h"
 
 /*md
 ## Mixer
 
 Mixer audio plugin is used to mix tracks together.
 
-- `Mixer4` is a 4-track mixer.
-- `Mixer8` is a 8-track mixer.
-- `Mixer12` is a 12-track mixer.
+- `Mixer2`, `Mixer4`, `Mixer5`, `Mixer6`, `Mixer8`, `Mixer10` and `Mixer12`, mixing 2 to 12 tracks.
+
+Volume and mute changes are ramped over one block, so they don't click.
+With the `stereo` host config, the mixer outputs stereo and each track can be panned.
 
 */
 template <uint8_t TRACK_COUNT>
@@ -39,9 +41,13 @@ class Mixer : public Mapping {
 public:
     Val* mix[TRACK_COUNT];
     Val* mutes[TRACK_COUNT];
+    Val* pans[TRACK_COUNT] = {};
 
     uint8_t tracks[TRACK_COUNT];
     float divider = 1.0f / (float)TRACK_COUNT;
+    // Gain applied to each input at the end of the last block, the next block ramping from it
+    float gains[TRACK_COUNT] = {};
+    float rightGains[TRACK_COUNT] = {};
 
     Mixer(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
@@ -70,9 +76,19 @@ public:
             /*md - `MUTE_2` to mute track 2.*/
             /*md - ...*/
             mutes[i] = &val(0.0f, "MUTE_" + std::to_string(i + 1), { "Mute " + std::to_string(i + 1), .max = 1.0f });
+            if (hasStereoBuffer()) {
+                /*md - `PAN_1` to pan track 1, from -100 (left) to 100 (right), only with a stereo buffer.*/
+                /*md - ...*/
+                pans[i] = &val(0.0f, "PAN_" + std::to_string(i + 1), { "Pan " + std::to_string(i + 1), .min = -100.0f, .max = 100.0f, .unit = "%" });
+            }
         }
     }
 
+    bool isStereo() override
+    {
+        return hasStereoBuffer();
+    }
+
     std::set<uint8_t> trackDependencies() override
     {
         std::set<uint8_t> dependencies = {};
@@ -93,4 +109,73 @@ public:
         }
         buf[track] = out;
     }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (hasStereoBuffer()) {
+            sampleStereoBlock(buf, frames);
+            return;
+        }
+        const uint32_t stride = props.frameStride;
+        float* out = trackLane(buf, track);
+        bool written = false;
+        // Resolve gains and mutes once for the whole block, ramping from the previous block gains.
+        // Accumulate input by input, so in planar layout each one is a contiguous read.
+        for (uint16_t i = 0; i < TRACK_COUNT; i++) {
+            float target = mutes[i]->get() ? 0.0f : mix[i]->pct() * divider;
+            float gain = gains[i];
+            gains[i] = target;
+            // Silent inputs would only add zeros
+            if ((gain == 0.0f && target == 0.0f) || isSilentTrack(tracks[i])) {
+                continue;
+            }
+            mixLane(out, trackLane(buf, tracks[i]), stride, frames, gain, (target - gain) / frames, !written);
+            written = true;
+        }
+        if (!written) {
+            for (uint32_t f = 0; f < frames; f++) {
+                out[f * stride] = 0;
+            }
+        }
+    }
+
+    // Balance pan: the centered tracks keep their volume on both channels, panning only attenuates the other side
+    void sampleStereoBlock(float* buf, uint32_t frames)
+    {
+        const uint32_t stride = props.frameStride;
+        float* out = trackLane(buf, track);
+        float* outRight = rightLane(buf, track);
+        bool written = false;
+        for (uint16_t i = 0; i < TRACK_COUNT; i++) {
+            float target = mutes[i]->get() ? 0.0f : mix[i]->pct() * divider;
+            float pan = pans[i]->get() * 0.01f;
+            float targetLeft = target * (pan > 0.0f ? 1.0f - pan : 1.0f);
+            float targetRight = target * (pan < 0.0f ? 1.0f + pan : 1.0f);
+            float gain = gains[i];
+            float gainRight = rightGains[i];
+            gains[i] = targetLeft;
+            rightGains[i] = targetRight;
+            if ((gain == 0.0f && targetLeft == 0.0f && gainRight == 0.0f && targetRight == 0.0f) || isSilentTrack(tracks[i])) {
+                continue;
+            }
+            mixLane(out, trackLane(buf, tracks[i]), stride, frames, gain, (targetLeft - gain) / frames, !written);
+            mixLane(outRight, rightLane(buf, tracks[i]), stride, frames, gainRight, (targetRight - gainRight) / frames, !written);
+            written = true;
+        }
+        if (!written) {
+            for (uint32_t f = 0; f < frames; f++) {
+                out[f * stride] = 0;
+                outRight[f * stride] = 0;
+            }
+        }
+    }
 };
+
+// One plugin per track count, see `Mixer%` in the makefile
+using Mixer2 = Mixer<2>;
+using Mixer4 = Mixer<4>;
+using Mixer5 = Mixer<5>;
+using Mixer6 = Mixer<6>;
+using Mixer8 = Mixer<8>;
+using Mixer10 = Mixer<10>;
+using Mixer12 = Mixer<12>;
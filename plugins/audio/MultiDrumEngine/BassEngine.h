@@ -149,6 +149,11 @@ public:
         buf[track] = applyReverb(buf[track], reverb.pct(), buffer, reverbIndex);
     }
 
+    bool isDeterministic() override
+    {
+        return true;
+    }
+
     // Higher base note is, lower pitch will be
     //
     // Usualy our base note is 60
@@ -67,6 +67,11 @@ public:
         initValues();
     }
 
+    bool isDeterministic() override
+    {
+        return true;
+    }
+
     void noteOn(uint8_t, float _velocity, void* = nullptr) override
     {
         DrumEngine::noteOn(0, _velocity);
@@ -16,6 +16,7 @@ sha: 0636e7c0f12f7a68f27a4c4e89cc45a10feef5fa6706714a0cbc074ccf2417d7
 
 #include "plugins/audio/audioPlugin.h"
 #include "plugins/audio/mapping.h"
+#include "audio/EnvelopChunk.h"
 #include "audio/EnvelopDrumAmp.h"
 #include "plugins/audio/MultiEngine.h"
 
@@ -24,6 +25,8 @@ typedef std::function<void(std::string, float)> SetValFn;
 class DrumEngine : public MultiEngine {
 public:
     EnvelopDrumAmp envelopAmp;
+    // Rendered 32 samples ahead, see EnvelopChunk
+    EnvelopChunk<EnvelopDrumAmp> envelopAmpChunk = EnvelopChunk<EnvelopDrumAmp>(envelopAmp);
 
     Val& duration = val(500.0f, "DURATION", { .label = "Duration", .min = 50.0, .max = 3000.0, .step = 10.0, .unit = "ms" });
 
@@ -43,7 +46,7 @@ public:
     void sample(float* buf) override
     {
         if (i < totalSamples) {
-            float envAmp = envelopAmp.next();
+            float envAmp = envelopAmpChunk.next();
             sampleOn(buf, envAmp, i, totalSamples);
             i++;
         } else {
@@ -56,9 +59,16 @@ public:
         const float sampleRate = props.sampleRate;
         totalSamples = static_cast<int>(sampleRate * (duration.get() / 1000.0f));
         envelopAmp.reset(totalSamples);
+        envelopAmpChunk.reset();
         i = 0;
     }
 
+    // Whether a hit only depends on the values, the note and the velocity, so it can be rendered once and played
+    // back from the hit cache of SynthMultiDrum
+    virtual bool isDeterministic() { return false; }
+
     virtual void sampleOn(float* buf, float envAmp, int sampleCounter, int totalSamples) = 0;
     virtual void sampleOff(float* buf) { }
+    // Called before each block, e.g. to swap in the tables rebuilt in the background
+    virtual void startBlock() { }
 };
@@ -3,7 +3,7 @@ This code defines the **Er1PcmEngine**, a specialized component designed for gen
 
 ### How the Engine Works
 
-1.  **Sample Management:** The engine acts as a sophisticated sampler. It loads a chosen audio file (waveform) into a large internal memory buffer (up to 3 seconds). A built-in file browser manages selecting the sample from a designated audio folder.
+1.  **Sample Management:** The engine acts as a sophisticated sampler. Its waveforms (up to 3 seconds each) are the audio files of a designated folder, packed into a single memory-mapped ROM shared by every instance, so selecting one only points the engine at it.
 2.  **Playback Core:** When a drum hit is triggered, the engine plays back the loaded sample. The *Pitch* control adjusts the playback speed, shifting the fundamental frequency of the sound.
 3.  **Dynamic Modulation:** This is the sound's most complex feature. The **Modulation System** allows the pitch to be automatically and dynamically altered while the sample plays. Users select a *Mod Type* (such as Sine, Sawtooth, Square wave, or various decay Envelopes) to define the contour of this pitch change. This is essential for creating classic synth drum sounds like falling kicks or oscillating tones. *Mod Depth* controls the intensity, and *Mod Speed* controls the rate of the change.
 4.  **Attack Shaping:** A separate tool called the **Transient Generator** can be blended in to add a sharp, initial “click” or punch to the sound’s attack phase, giving the drum hit extra clarity regardless of the underlying sample.
@@ -16,29 +16,29 @@ sha: 8a5bc3a5ff4e2c4d094563c1513b47796dfaed92f04ce27e53fbd46a123d4eaa
 #pragma once
 
 #include <math.h>
-#include <sndfile.h>
 
 #include "host/constants.h"
 #include "plugins/audio/MultiDrumEngine/DrumEngine.h"
 #include "audio/MultiFx.h"
 #include "audio/TransientGenerator.h"
-#include "audio/fileBrowser.h"
-#include "audio/utils/applySampleGain.h"
 #include "audio/utils/getStepMultiplier.h"
+#include "plugins/audio/utils/PcmRom.h"
 
 class Er1PcmEngine : public DrumEngine {
     float velocity = 1.0f;
 
     static const uint64_t bufferSize = 48000 * 3; // max 3 seconds
-    float sampleData[bufferSize];
+
+    // Waves shared by all the instances, switching wave only points to another one
+    PcmRom& rom = PcmRom::get(AUDIO_FOLDER + "/er1", bufferSize);
+    uint16_t romPosition = 0;
 
     struct SampleBuffer {
         uint64_t count = 0;
-        float* data = nullptr;
+        const float* data = nullptr;
     } sampleBuffer;
 
     float pitch = 1.0f;
-    FileBrowser fileBrowser = FileBrowser(AUDIO_FOLDER + "/er1");
 
     MultiFx multiFx;
     MultiFx multiFx2;
@@ -67,8 +67,8 @@ public:
         pitch = pow(2, p.value / 12.0f);
     });
 
-    GraphPointFn waveGraph = [&](float index) { int idx = index * sampleBuffer.count; return sampleBuffer.data[idx]; };
-    Val& waveform = val(1.0f, "WAVEFORM", { .label = "Waveform", VALUE_STRING, .min = 1.0f, .max = (float)fileBrowser.count, .graph = waveGraph }, [&](auto p) {
+    GraphPointFn waveGraph = [&](float index) { int idx = index * sampleBuffer.count; return sampleBuffer.data ? sampleBuffer.data[idx] : 0.0f; };
+    Val& waveform = val(1.0f, "WAVEFORM", { .label = "Waveform", VALUE_STRING, .min = 1.0f, .max = (float)rom.count(), .graph = waveGraph }, [&](auto p) {
         open(p.value);
     });
 
@@ -179,7 +179,7 @@ public:
     Val& transientMorph = val(100.0, "TRANSIENT", { .label = "Transient", .type = VALUE_STRING, .step = 0.1f, .floatingPoint = 1, .graph = transientGraph }, [&](auto p) {
         p.val.setFloat(p.value);
         transient.morphType(p.val.pct());
-        p.val.setString(std::to_string((int)(transient.getMorph() * 100)) + "%");
+        p.val.setNumber((int)(transient.getMorph() * 100), 0, "%");
         p.val.props().unit = transient.getTypeName();
     });
 
@@ -193,8 +193,8 @@ public:
 
     Er1PcmEngine(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : DrumEngine(props, config, "ER-1")
-        , multiFx(props.sampleRate, props.lookupTable)
-        , multiFx2(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , multiFx2(props.sampleRate, props.lookupTable, props.arena)
         , transient(props.sampleRate, 50)
     {
         // open(waveform.get(), true);
@@ -236,6 +236,11 @@ public:
         buf[track] = out;
     }
 
+    void startBlock() override
+    {
+        transient.update();
+    }
+
     void sampleOff(float* buf) override
     {
         float out = buf[track];
@@ -257,45 +262,30 @@ public:
     {
         waveform.setFloat(value);
         int position = waveform.get();
-        if (force || position != fileBrowser.position) {
-            waveform.setString(fileBrowser.getFile(position));
-            std::string filepath = fileBrowser.getFilePath(position);
-            logTrace("SAMPLE_SELECTOR: %f %s", value, filepath.c_str());
-            open(filepath);
+        const PcmRom::Wave* wave = rom.get(position);
+        if (wave && (force || position != romPosition)) {
+            romPosition = position;
+            waveform.setString(wave->name);
+            logTrace("SAMPLE_SELECTOR: %f %s", value, wave->name.c_str());
+            sampleBuffer.count = wave->count;
+            sampleBuffer.data = wave->data;
+            stepMultiplier = getStepMultiplierMonoTrack(wave->channels, props.channels);
+            index = sampleBuffer.count;
         }
     }
 
-    void open(std::string filename)
-    {
-        SF_INFO sfinfo;
-        SNDFILE* file = sf_open(filename.c_str(), SFM_READ, &sfinfo);
-        if (!file) {
-            logDebug("Error: could not open file %s [%s]\n", filename.c_str(), sf_strerror(file));
-            return;
-        }
-        logTrace("Audio file %s sampleCount %ld sampleRate %d\n", filename, (long)sfinfo.frames, sfinfo.samplerate);
-        // printf(".................Audio file chan %d vs prop chan %d\n", sfinfo.channels, props.channels);
-
-        sampleBuffer.count = sf_read_float(file, sampleData, bufferSize);
-        sampleBuffer.data = sampleData;
-
-        sf_close(file);
-
-        stepMultiplier = getStepMultiplierMonoTrack(sfinfo.channels, props.channels);
-        
-        index = sampleBuffer.count;
-        applySampleGain(sampleBuffer.data, sampleBuffer.count);
-    }
-
     void serializeJson(nlohmann::json& json) override
     {
-        json["sampleFile"] = fileBrowser.getFile(waveform.get());
+        const PcmRom::Wave* wave = rom.get(waveform.get());
+        if (wave) {
+            json["sampleFile"] = wave->name;
+        }
     }
 
     void hydrateJson(nlohmann::json& json) override
     {
         if (json.contains("sampleFile")) {
-            int position = fileBrowser.find(json["sampleFile"]);
+            int position = rom.find(json["sampleFile"]);
             if (position != 0) {
                 // waveform.set(position);
                 open(position, true);
@@ -101,7 +101,7 @@ public:
         : DrumEngine(p, c, "FM")
         , carrier(p.lookupTable, p.sampleRate)
         , mod(p.lookupTable, p.sampleRate)
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
     {
         carrier.setType(WavetableGenerator::Type::Sine);
         mod.setType(WavetableGenerator::Type::Sine);
@@ -141,6 +141,11 @@ public:
         buf[track] = out;
     }
 
+    bool isDeterministic() override
+    {
+        return true;
+    }
+
     void noteOn(uint8_t note, float _velocity, void* = nullptr) override
     {
         DrumEngine::noteOn(note, _velocity);
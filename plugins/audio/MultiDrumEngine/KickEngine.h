@@ -58,7 +58,7 @@ public:
         }
         int morph = p.val.get() - newWave * 100;
         waveform.setMorph(morph / 100.0f);
-        p.val.setString(std::to_string(morph) + "%");
+        p.val.setNumber(morph, 0, "%");
     });
 
     Val& pitch = val(0, "PITCH", { .label = "Pitch", .type = VALUE_CENTERED, .min = -24, .max = 24, .incType = INC_ONE_BY_ONE });
@@ -85,8 +85,8 @@ public:
 
     KickEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : DrumEngine(p, c, "Kick")
-        , multiFx(props.sampleRate, props.lookupTable)
-        , multiFx2(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , multiFx2(props.sampleRate, props.lookupTable, props.arena)
         , waveform(props.lookupTable, props.sampleRate)
     {
         initValues();
@@ -116,6 +116,12 @@ public:
         buf[track] = out * velocity;
     }
 
+    void startBlock() override
+    {
+        kickEnv.update();
+        transient.update();
+    }
+
     void sampleOff(float* buf) override
     {
         float out = buf[track];
@@ -123,6 +129,11 @@ public:
         buf[track] = out;
     }
 
+    bool isDeterministic() override
+    {
+        return true;
+    }
+
     // Higher base note is, lower pitch will be
     //
     // Usualy our base note is 60
@@ -150,6 +150,12 @@ public:
     }
 
     uint8_t baseNote = 60;
+
+    bool isDeterministic() override
+    {
+        return true;
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
         DrumEngine::noteOn(note, _velocity);
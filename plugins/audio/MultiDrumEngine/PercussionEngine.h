@@ -126,6 +126,11 @@ public:
         buf[track] = applyReverb(buf[track], reverb.pct(), buffer, rIdx);
     }
 
+    bool isDeterministic() override
+    {
+        return true;
+    }
+
     void noteOn(uint8_t note, float _velocity, void* = nullptr) override
     {
         DrumEngine::noteOn(note, _velocity);
@@ -1,7 +1,7 @@
 /** Description:
 This C++ blueprint, known as the `StringDrumEngine`, is a specialized virtual instrument designed to generate realistic or stylized drum and percussion sounds. It uses a technique called physical modeling to simulate a vibrating string or membrane, like a guitar string or drum head.
 
-The core of the simulation relies on a constant, circulating loop of sound samples. When a note is triggered, the system first calculates the precise length of this loop needed to achieve the desired musical pitch. It then initializes the loop with a starting sound, simulating the initial "pluck" or "hit." The character of this excitation can be adjusted using controls like "Pluck Noise" and "Excitation Type."
+The core of the simulation relies on a constant, circulating loop of sound samples. When a note is triggered, the system first calculates the precise length of this loop needed to achieve the desired musical pitch, a fractional part of the length keeping the note exactly in tune. It then initializes the loop with a starting sound, simulating the initial "pluck" or "hit." The character of this excitation can be adjusted using controls like "Pluck Noise" and "Excitation Type."
 
 During every moment of audio processing, a central function constantly repeats. This function extracts sound from the circulating loop, applies subtle internal filtering and damping (controlled by "Tone" and "Damping"), and feeds the modified sound back into the beginning of the loop. This continuous feedback sustains the tone, and the "Decay" parameter controls how quickly the sound fades out.
 
@@ -20,62 +20,40 @@ sha: 8094b2e95d42729aea579f982d8ef5abd417bc1a32e8fc3a8f63633f74682b72
 #include "plugins/audio/MultiDrumEngine/DrumEngine.h"
 #include "audio/MMfilter.h"
 #include "audio/MultiFx.h"
+#include "audio/Waveguide.h"
 #include "plugins/audio/utils/valMMfilterCutoff.h"
 
 #include <cmath>
-#include <vector>
 
 class StringDrumEngine : public DrumEngine {
 protected:
     MMfilter filter;
     MultiFx multiFx;
 
-    std::vector<float> delayLine;
-    uint32_t delayLen = 0;
-    uint32_t writePos = 0;
-    float onePoleState = 0.0f;
+    Waveguide<1> resonator;
 
     float velocity = 1.0f;
-    static constexpr uint32_t MAX_DELAY = 1 << 16; // 65536
 
     inline float noteToFreq(int note) const
     {
         return 440.0f * powf(2.0f, (note - 69) / 12.0f);
     }
 
-    float resonatorTick()
+    void setLoss(Val::CallbackProps p)
     {
-        if (delayLen == 0)
-            return 0.0f;
-
-        uint32_t rp = writePos % delayLen;
-        uint32_t rp1 = (rp + 1) % delayLen;
-        float s0 = delayLine[rp];
-        float s1 = delayLine[rp1];
-        float out = 0.5f * (s0 + s1);
-
-        // one-pole lowpass
-        float cutoff = std::max(0.001f, tone.pct() * (1.05f - damping.pct()));
-        onePoleState += cutoff * (out - onePoleState);
-        float filtered = onePoleState;
-
-        // feedback
-        float fb = decay.get();
-        delayLine[writePos % delayLen] = filtered * fb;
-
-        writePos = (writePos + 1) % delayLen;
-        return filtered;
+        p.val.setFloat(p.value);
+        resonator.setLoss(0, std::max(0.001f, tone.pct() * (1.05f - damping.pct())), decay.get());
     }
 
 public:
     // Parameters
     Val& pitch = val(0.0f, "PITCH", { .label = "Pitch", .type = VALUE_CENTERED, .min = -24, .max = 24 });
-    Val& decay = val(0.98f, "DECAY", { .label = "Decay", .min = 0.80f, .max = 0.99f, .step = 0.01f, .floatingPoint = 2 });
-    Val& tone = val(50.0f, "TONE", { .label = "Tone", .unit = "%" });
+    Val& decay = val(0.98f, "DECAY", { .label = "Decay", .min = 0.80f, .max = 0.99f, .step = 0.01f, .floatingPoint = 2 }, [&](auto p) { setLoss(p); });
+    Val& tone = val(50.0f, "TONE", { .label = "Tone", .unit = "%" }, [&](auto p) { setLoss(p); });
     Val& pluckNoise = val(50.0f, "PLUCK_NOISE", { .label = "Pluck Noise", .unit = "%" });
 
     Val& exciteType = val(0.0f, "EXCITE_TYPE", { .label = "Excitation Type", .min = 0.0f, .max = 2.0f });
-    Val& damping = val(0.5f, "DAMPING", { .label = "Damping", .unit = "%" });
+    Val& damping = val(0.5f, "DAMPING", { .label = "Damping", .unit = "%" }, [&](auto p) { setLoss(p); });
 
     Val& cutoff = val(0.0, "CUTOFF", { .label = "LPF | HPF", .type = VALUE_CENTERED | VALUE_STRING, .min = -100.0, .max = 100.0 }, [&](auto p) {
         valMMfilterCutoff(p, filter);
@@ -90,16 +68,15 @@ public:
     // Constructor
     StringDrumEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : DrumEngine(p, c, "String")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , resonator(props.sampleRate)
     {
-        delayLen = (uint32_t)std::min<uint64_t>((uint64_t)(props.sampleRate * 0.02f), (uint64_t)MAX_DELAY);
-        delayLine.assign(delayLen + 4, 0.0f);
         initValues();
     }
 
     void sampleOn(float* buf, float envAmpVal, int, int) override
     {
-        float out = resonatorTick() * velocity * envAmpVal;
+        float out = resonator.process() * velocity * envAmpVal;
         out = multiFx.apply(out, fxAmount.pct());
         buf[track] = out;
     }
@@ -115,36 +92,23 @@ public:
     {
         DrumEngine::noteOn(note, _velocity);
         velocity = _velocity;
-        float freq = noteToFreq(note + (int)pitch.get() - 24); // Let's remove 2 octaves
-        if (freq < 20.0f)
-            freq = 20.0f;
-        if (freq > props.sampleRate * 0.45f)
-            freq = props.sampleRate * 0.45f;
-
-        delayLen = std::min<uint32_t>(MAX_DELAY, std::max<uint32_t>(2, (uint32_t)std::round(props.sampleRate / freq)));
-        delayLine.assign(delayLen + 4, 0.0f);
-
-        if (exciteType.get() == 0.0f) {
-            // White noise
-            for (uint32_t i = 0; i < delayLen; ++i) {
-                float n = (rand() / (float)RAND_MAX) * 2.0f - 1.0f;
-                delayLine[i] = filter.process(n) * velocity * pluckNoise.pct();
-            }
-        } else if (exciteType.get() == 1.0f) {
-            // Square burst
-            for (uint32_t i = 0; i < delayLen; ++i) {
-                float n = sinf(2.0f * M_PI * i / delayLen) > 0.5f ? 1.0f : 0.0f;
-                delayLine[i] = filter.process(n) * velocity * pluckNoise.pct();
+        resonator.setFrequency(0, std::max(20.0f, noteToFreq(note + (int)pitch.get() - 24))); // Let's remove 2 octaves
+
+        float type = exciteType.get();
+        float level = velocity * pluckNoise.pct();
+        resonator.excite(0, [&](uint32_t i, uint32_t len) {
+            float n;
+            if (type == 0.0f) {
+                // White noise
+                n = (rand() / (float)RAND_MAX) * 2.0f - 1.0f;
+            } else if (type == 1.0f) {
+                // Square burst
+                n = sinf(2.0f * M_PI * i / len) > 0.5f ? 1.0f : 0.0f;
+            } else {
+                // Sine burst
+                n = sinf(2.0f * M_PI * i / len);
             }
-        } else {
-            // Sine burst
-            for (uint32_t i = 0; i < delayLen; ++i) {
-                float n = sinf(2.0f * M_PI * i / delayLen);
-                delayLine[i] = filter.process(n) * velocity * pluckNoise.pct();
-            }
-        }
-
-        writePos = 0;
-        onePoleState = 0.0f;
+            return filter.process(n) * level;
+        });
     }
 };
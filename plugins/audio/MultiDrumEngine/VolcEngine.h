@@ -112,7 +112,7 @@ public:
         }
         int morph = p.val.get() - newWave * 100;
         layerA.osc.setMorph(morph / 100.0f);
-        p.val.setString(std::to_string(morph) + "%");
+        p.val.setNumber(morph, 0, "%");
     });
     Val& layerAMod = val(0.0f, "LAYER_A_MOD", { .label = "A Mod", .unit = "%" }, [&](auto p) {
         p.val.setFloat(p.value);
@@ -137,7 +137,7 @@ public:
         }
         int morph = p.val.get() - newWave * 100;
         layerB.osc.setMorph(morph / 100.0f);
-        p.val.setString(std::to_string(morph) + "%");
+        p.val.setNumber(morph, 0, "%");
     });
     Val& layerBMod = val(0.0f, "LAYER_B_MOD", { .label = "B Mod", .unit = "%" }, [&](auto p) {
         p.val.setFloat(p.value);
@@ -182,6 +182,11 @@ public:
         }
     }
 
+    bool isDeterministic() override
+    {
+        return true;
+    }
+
     void noteOn(uint8_t note, float _velocity, void* = nullptr) override
     {
         DrumEngine::noteOn(note, _velocity);
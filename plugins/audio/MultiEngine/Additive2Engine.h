@@ -29,6 +29,7 @@ sha: ccbf7151730fc3c13c1e77bbcf4effbd0a46775ebcf5ef4b1edb461172442708
 
 #include "plugins/audio/MultiEngine/Engine.h"
 #include "audio/MMfilter.h"
+#include "audio/AdditiveOscillatorBank.h"
 #include "audio/MultiFx.h"
 #include "audio/WavetableGenerator2.h"
 #include "plugins/audio/utils/valMMfilterCutoff.h"
@@ -41,10 +42,8 @@ protected:
     MMfilter filter;
 
     float velocity = 1.0f;
-    float phase1 = 0.0f;
-    float phase2 = 0.0f;
-    float phase3 = 0.0f;
-    float phase4 = 0.0f;
+    // The fundamental and its 3 harmonics, in one group of SIMD lanes
+    AdditiveOscillatorBank<4> harmonics;
 
     // params
     float harm1Level = 0.0f;
@@ -101,11 +100,22 @@ public:
     // --- constructor ---
     Additive2Engine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "Aditiv2")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , harmonics(props.sampleRate)
     {
         initValues();
     }
 
+    // Levels follow the parameters at control rate, sliding over the next control frames
+    void controlTick(uint32_t frameOffset) override
+    {
+        harmonics.setPartial(0, baseFreq, 1.0f - brightness);
+        harmonics.setPartial(1, baseFreq * 2.0f, harm1Level);
+        harmonics.setPartial(2, baseFreq * 3.0f, harm2Level);
+        harmonics.setPartial(3, baseFreq * 4.0f, harm3Level * brightness);
+        harmonics.ramp(props.controlFrames);
+    }
+
     void sample(float* buf, float envAmpVal) override
     {
         if (envAmpVal == 0.0f) {
@@ -115,38 +125,7 @@ public:
             return;
         }
 
-        // Base frequency
-        float freq = baseFreq;
-
-        // harmonic frequencies
-        float f1 = freq;
-        float f2 = freq * 2.0f;
-        float f3 = freq * 3.0f;
-        float f4 = freq * 4.0f;
-
-        // step per sample
-        float step1 = f1 / props.sampleRate;
-        float step2 = f2 / props.sampleRate;
-        float step3 = f3 / props.sampleRate;
-        float step4 = f4 / props.sampleRate;
-
-        // advance phases
-        phase1 = fmodf(phase1 + step1, 1.0f);
-        phase2 = fmodf(phase2 + step2, 1.0f);
-        phase3 = fmodf(phase3 + step3, 1.0f);
-        phase4 = fmodf(phase4 + step4, 1.0f);
-
-        // sine waves
-        float s1 = sinf(phase1 * 2.0f * M_PI);
-        float s2 = sinf(phase2 * 2.0f * M_PI);
-        float s3 = sinf(phase3 * 2.0f * M_PI);
-        float s4 = sinf(phase4 * 2.0f * M_PI);
-
-        // combine with levels
-        float harmonicMix = s1 * (1.0f - brightness)
-            + s2 * harm1Level
-            + s3 * harm2Level
-            + s4 * harm3Level * brightness;
+        float harmonicMix = harmonics.next();
 
         // noise
         float n = props.lookupTable->getNoise();
@@ -164,10 +143,9 @@ public:
         Engine::noteOn(note, _velocity);
         velocity = _velocity;
         // Random phase initialization to avoid click transients
-        phase1 = (float)rand() / RAND_MAX;
-        phase2 = (float)rand() / RAND_MAX;
-        phase3 = (float)rand() / RAND_MAX;
-        phase4 = (float)rand() / RAND_MAX;
+        for (int i = 0; i < 4; i++) {
+            harmonics.setPhase(i, (float)rand() / RAND_MAX);
+        }
         setBaseFreq(body.get(), note);
     }
 };
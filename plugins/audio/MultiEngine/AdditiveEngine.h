@@ -3,7 +3,7 @@ This code defines an `AdditiveEngine`, a specialized digital sound generator (or
 
 The engine uses **Additive Synthesis**, a method where sound is created by combining multiple synchronized simple sine waves, known as "partials," to build a complex tone. This approach is highly effective for synthesizing bell-like sounds or organ-style timbres.
 
-The engine can generate up to eight simultaneous partials. Its core behavior is controlled by ten parameters that the user can adjust:
+The engine can generate up to 64 simultaneous partials, computed 4 at a time by a bank of quadrature oscillators; the partials above the Nyquist frequency are dropped. Its core behavior is controlled by ten parameters that the user can adjust:
 
 1.  **Tone & Timbre Controls:** Parameters like "Harmonics" determine how many partials are active, affecting the richness of the sound. "Harmonic Decay" controls how quickly the higher, brighter partials fade out. The "Odd/Even" control biases the volume toward specific partials to dramatically alter the tonal quality.
 2.  **Fine Tuning:** "Spread" and "Inharm" introduce subtle detuning and pitch variations among the partials, resulting in a thicker, less sterile sound. "Body" adjusts the fundamental pitch.
@@ -18,19 +18,22 @@ sha: 6d16ecb74b71ad6c5bfe2f836f199366b3a6bbfc3c682cc979bcff716b33647c
 
 #include "helpers/math.h"
 #include "plugins/audio/MultiEngine/Engine.h"
+#include "audio/AdditiveOscillatorBank.h"
 #include "audio/MultiFx.h"
 
+#include <algorithm>
 #include <cstdlib>
 
 class AdditiveEngine : public Engine {
 protected:
-    static constexpr int MAX_PARTIALS = 8;
+    static constexpr int MAX_PARTIALS = 64;
     MultiFx multiFx;
 
     float velocity = 1.0f;
     float harmonicDecay = 1.0f;
 
-    float phases[MAX_PARTIALS] = { 0.0f };
+    AdditiveOscillatorBank<MAX_PARTIALS> partials;
+    int numPartials = 1;
 
     // LFO state
     float lfoPhase = 0.0f;
@@ -72,43 +75,42 @@ public:
     // --- constructor ---
     AdditiveEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "Aditiv")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , partials(props.sampleRate)
     {
         initValues();
     }
 
-    void sample(float* buf, float envAmpVal) override
+    // Partials follow the parameters at control rate, their amplitudes sliding over the next control frames
+    void controlTick(uint32_t frameOffset) override
     {
-        if (envAmpVal == 0.0f) {
-            float out = buf[track];
-            out = multiFx.apply(out, fxAmount.pct());
-            buf[track] = out;
-            return;
-        }
-
-        int numPartials = 1 + int(harmonics.pct() * (MAX_PARTIALS - 1));
-        float spreadAmt = spread.pct() * 0.1f;
+        numPartials = 1 + int(harmonics.pct() * (MAX_PARTIALS - 1));
+        // Spread of 8 partials at most, so the lowest partials never go below 0Hz
+        float spreadAmt = spread.pct() * 0.1f * std::min(1.0f, 8.0f / numPartials);
         float inharmAmt = inharm.pct() * 0.5f;
-
-        float sampleSum = 0.0f;
-        for (int i = 0; i < numPartials; i++) {
+        for (int i = 0; i < MAX_PARTIALS; i++) {
             float freq = baseFreq * (i + 1 + inharmAmt * i);
             freq *= (1.0f + (i - numPartials / 2) * spreadAmt);
 
-            float phaseInc = 2.0f * M_PI * freq / props.sampleRate;
-            phases[i] += phaseInc;
-            if (phases[i] > 2.0f * M_PI)
-                phases[i] -= 2.0f * M_PI;
-
             // --- Odd/Even bias ---
             bool isOdd = ((i + 1) % 2 == 1);
             float biasAmp = isOdd ? oddEvenBias : (1.0f - oddEvenBias);
+            float amp = i < numPartials ? powf(1.0f / (i + 1), harmonicDecay) * biasAmp : 0.0f;
+            partials.setPartial(i, freq, amp);
+        }
+        partials.ramp(props.controlFrames);
+    }
 
-            float amp = powf(1.0f / (i + 1), harmonicDecay) * biasAmp;
-            sampleSum += fastSin2(phases[i]) * amp;
+    void sample(float* buf, float envAmpVal) override
+    {
+        if (envAmpVal == 0.0f) {
+            float out = buf[track];
+            out = multiFx.apply(out, fxAmount.pct());
+            buf[track] = out;
+            return;
         }
 
-        float out = sampleSum / numPartials;
+        float out = partials.next() / numPartials;
 
         // --- Apply LFO (tremolo) ---
         if (lfoRate.get() > 0.0f) {
@@ -132,7 +134,7 @@ public:
         setBaseFreq(body.get(), note);
         // Random phase initialization to avoid click transients
         for (int i = 0; i < MAX_PARTIALS; i++) {
-            phases[i] = ((float)rand() / RAND_MAX) * 2.0f * M_PI;
+            partials.setPhase(i, (float)rand() / RAND_MAX);
         }
         lfoPhase = 0.0f;
     }
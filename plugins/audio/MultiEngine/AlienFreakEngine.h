@@ -104,7 +104,7 @@ public:
     // --- constructor ---
     AlienFreakEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "AlienFreak")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
     {
         initValues();
     }
@@ -35,6 +35,7 @@ sha: 111784e1c59546619c5390295288ca27c57b90907228ed46cde9e237eb4cf2ac
 #include "plugins/audio/MultiEngine/Engine.h"
 #include "audio/MultiFx.h"
 #include "audio/WavetableGenerator2.h"
+#include "audio/BlepOscillatorBank.h"
 #include "audio/filterArray.h"
 
 class BassEngine : public Engine {
@@ -48,6 +49,9 @@ protected:
 
     WavetableInterface* wave = nullptr;
     WavetableGenerator waveform;
+    // Band-limited square, the wavetable one aliasing on high notes
+    BlepOscillatorBank<1> square;
+    bool blepSquare = false;
 #define BASS_WAVEFORMS_COUNT 6
     struct WaveformType {
         std::string name;
@@ -96,11 +100,14 @@ public:
         p.val.setString(type.name);
         wave = type.wave;
         waveform.setType((WavetableGenerator::Type)type.indexType);
+        blepSquare = type.indexType == (uint8_t)WavetableGenerator::Type::Square;
         // shape.set(waveform.modulation * 1000.0f);
     });
     Val& shape = val(0.0f, "SHAPE", { .label = "Shape", .unit = "%" }, [&](auto p) {
         p.val.setFloat(p.value);
         waveform.setMorph(p.val.pct());
+        // Same pulse width as the wavetable square
+        square.setPulseWidth(0.5f - p.val.pct() * 0.49f);
     });
 
     Val& cutoff = val(50.0, "CUTOFF", { .label = "Cutoff", .unit = "%" }, [&](auto p) {
@@ -126,13 +133,20 @@ public:
     // --- constructor ---
     BassEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "Bass")
-        , multiFx(props.sampleRate, props.lookupTable)
-        , multiFx2(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , multiFx2(props.sampleRate, props.lookupTable, props.arena)
         , waveform(props.lookupTable, props.sampleRate)
+        , square(props.sampleRate, BlepOscillatorBank<1>::SQUARE)
     {
         initValues();
     }
 
+    // Filter follows the envelope at control rate
+    void controlTick(uint32_t frameOffset) override
+    {
+        filter.setCutoff(0.85 * cutoff.pct() * envelopAmp.get() + 0.1);
+    }
+
     void sample(float* buf, float envAmpVal) override
     {
         if (envAmpVal == 0.0f) {
@@ -144,10 +158,16 @@ public:
         }
 
         float bendedFreq = freq * (1.f - bend.pct() * envAmpVal);
-        float out = wave->sample(&sampleIndex, bendedFreq);
+        float out;
+        if (blepSquare) {
+            // Frequency as a ratio to 110Hz, like the wavetable
+            square.setFrequency(0, 110.0f * bendedFreq);
+            out = square.next();
+        } else {
+            out = wave->sample(&sampleIndex, bendedFreq);
+        }
         out = out * velocity * envAmpVal;
 
-        filter.setCutoff(0.85 * cutoff.pct() * envAmpVal + 0.1);
         filter.setSampleData(out, 0);
         filter.setSampleData(filter.lp[0], 1);
         out = filter.lp[1];
@@ -22,6 +22,7 @@
 #include "plugins/audio/MultiEngine/Engine.h"
 #include "plugins/audio/utils/valMMfilterCutoff.h"
 #include "audio/WavetableGenerator2.h"
+#include "audio/BlepOscillatorBank.h"
 #include "audio/MMfilter.h"
 #include "audio/MultiFx.h"
 
@@ -34,6 +35,9 @@ protected:
     WavetableGenerator* wavegens[VOICES] = {nullptr, nullptr, nullptr, nullptr};
     MMfilter filter;
     MultiFx multiFx;
+    // Band-limited square for all the voices at once, the wavetable square aliasing on high chords
+    BlepOscillatorBank<VOICES> squares;
+    bool blepSquare = false;
 
     float phases[VOICES] = {0.0f};
     float currentFreq[VOICES] = {0.0f};
@@ -83,6 +87,7 @@ public:
         for (int i = 0; i < VOICES; ++i) {
             if (wavegens[i]) wavegens[i]->setType((WavetableGenerator::Type)idx);
         }
+        blepSquare = idx == (int)WavetableGenerator::Type::Square;
         static const char* waveNames[] = {"Sine", "Saw", "Square", "Tri", "Pulse", "FM", "FMSq"};
         if (idx >= 0 && idx < (int)WavetableGenerator::Type::COUNT) {
             p.val.setString(std::string(waveNames[idx]));
@@ -95,12 +100,17 @@ public:
         for (int i = 0; i < VOICES; ++i) {
             if (wavegens[i]) wavegens[i]->setMorph(m);
         }
+        // Same pulse width as the wavetable square
+        squares.setPulseWidth(0.5f - m * 0.49f);
     });
 
     // Voices & Detune
     Val& voicesVal = val(4, "VOICES", { .label = "Voices", .min = 1, .max = 4, .step = 1.0f }, [&](auto p) {
         p.val.setFloat(p.value);
         cachedNumVoices = (int)p.val.get();
+        for (int i = 0; i < VOICES; ++i) {
+            squares.setGain(i, i < cachedNumVoices ? 1.0f : 0.0f);
+        }
     });
 
     Val& detune = val(0.0f, "DETUNE", { .label = "Detune", .unit = "%" }, [&](auto p) { 
@@ -132,7 +142,8 @@ public:
 
     ChordEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "Chord")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , squares(props.sampleRate, BlepOscillatorBank<VOICES>::SQUARE)
     {
         for (int i = 0; i < VOICES; ++i) {
             wavegens[i] = new WavetableGenerator(p.lookupTable, p.sampleRate);
@@ -177,10 +188,17 @@ public:
             float detuneMultiplier = 1.0f + voicePos * detuneAmt;
             float finalFreq = currentFreq[i] * detuneMultiplier;
 
+            if (blepSquare) {
+                squares.setFrequency(i, finalFreq);
+                continue;
+            }
             // WavetableGenerator expects freq as ratio to 110Hz
             float freqRatio = finalFreq * (1.0f / 110.0f);
             mix += wavegens[i]->sample(&phases[i], freqRatio);
         }
+        if (blepSquare) {
+            mix = squares.next();
+        }
 
         // Scale by voice count
         float scale = cachedNumVoices > 0 ? 1.0f / (float)cachedNumVoices : 1.0f;
@@ -226,6 +244,7 @@ public:
                 if (!shouldGlide || currentFreq[v] == 0.0f) {
                     currentFreq[v] = target;
                     phases[v] = ((float)rand() / RAND_MAX);
+                    squares.setPhase(v, phases[v]);
                 }
             }
         }
@@ -97,7 +97,7 @@ public:
         : Engine(p, c, "FM")
         , carrier(p.lookupTable, p.sampleRate)
         , mod(p.lookupTable, p.sampleRate)
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
     {
         carrier.setType(WavetableGenerator::Type::Sine);
         mod.setType(WavetableGenerator::Type::Sine);
@@ -94,7 +94,7 @@ public:
     // --- constructor ---
     SpaceShipEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "Space")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
     {
         initValues();
     }
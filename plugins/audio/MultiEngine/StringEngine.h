@@ -3,7 +3,7 @@ This C++ header defines a specialized audio synthesis module named `StringEngine
 
 ### Core Mechanism: The Resonator
 
-The engine simulates a vibrating string using a continuous feedback loop known as a resonator. A dedicated memory buffer, called a delay line, stores the audio signal. The length of this delay line determines the fundamental pitch of the note being played.
+The engine simulates a vibrating string using a continuous feedback loop known as a resonator. A dedicated memory buffer, called a delay line, stores the audio signal. The length of this delay line determines the fundamental pitch of the note being played. The loop is the shared waveguide of `audio/Waveguide.h`, its fractional length keeping the note exactly in tune.
 
 When a note is triggered, the engine initializes this loop. The sound then travels around the loop, is slightly damped (filtered to simulate energy loss), and is fed back in. The parameters for "Decay" and "Tone" control how quickly this vibration fades and how bright or muffled the tone becomes.
 
@@ -28,9 +28,9 @@ sha: 401bff579eda424d97c81c92a808efdd7f2c05f6ecb80edfe89f5379c78fbb73
 #include "audio/MultiFx.h"
 #include "plugins/audio/utils/valMMfilterCutoff.h"
 #include "audio/MMfilter.h"
+#include "audio/Waveguide.h"
 
 #include <cmath>
-#include <vector>
 
 class StringEngine : public Engine {
 protected:
@@ -39,48 +39,19 @@ protected:
     MMfilter filter;
 
     // Resonator
-    std::vector<float> delayLine;
-    uint32_t delayLen = 0;
-    uint32_t writePos = 0;
-    float onePoleState = 0.0f;
-    bool resonatorActive = false;
+    Waveguide<1> resonator;
+    float vibRatioApplied = 1.0f;
 
     float velocity = 1.0f;
 
     // Vibrato
     float vibratoPhase = 0.0f; // 0–1
 
-    static constexpr uint32_t MAX_DELAY = 1 << 16; // 65536
-
-    // --- Resonator tick with vibrato ---
-    float resonatorTick(float driver, float vibRatio)
+    void setLoss(Val::CallbackProps p)
     {
-        if (!resonatorActive || delayLen == 0)
-            return 0.0f;
-
-        // fractional read position with vibrato applied
-        float rp = fmodf((float)writePos * vibRatio, (float)delayLen);
-        uint32_t i0 = (uint32_t)rp;
-        uint32_t i1 = (i0 + 1) % delayLen;
-        float frac = rp - i0;
-
-        float s0 = delayLine[i0];
-        float s1 = delayLine[i1];
-        float out = s0 + frac * (s1 - s0); // linear interp
-
-        // one-pole lowpass
-        float cutoff = std::max(0.005f, tone.pct());
-        onePoleState += cutoff * (out - onePoleState);
-        float filtered = onePoleState;
-
-        // feedback + external driving
-        float fb = decay.get();
-        delayLine[writePos % delayLen] = filtered * fb + driver;
-
-        // advance write pointer
-        writePos = (writePos + 1) % delayLen;
-
-        return filtered;
+        p.val.setFloat(p.value);
+        // no averaging in the loop, only the tone lowpass
+        resonator.setLoss(0, std::max(0.005f, tone.pct()), decay.get(), 0.0f);
     }
 
 public:
@@ -90,8 +61,8 @@ public:
         setBaseFreq((int)p.val.get());
     });
 
-    Val& decay = val(0.98f, "DECAY", { .label = "Decay", .min = 0.80f, .max = 0.99f, .step = 0.01f, .floatingPoint = 2 });
-    Val& tone = val(50.0f, "TONE", { .label = "Tone", .unit = "%" });
+    Val& decay = val(0.98f, "DECAY", { .label = "Decay", .min = 0.80f, .max = 0.99f, .step = 0.01f, .floatingPoint = 2 }, [&](auto p) { setLoss(p); });
+    Val& tone = val(50.0f, "TONE", { .label = "Tone", .unit = "%" }, [&](auto p) { setLoss(p); });
     Val& sustainExcite = val(50.0f, "SUSTAIN_EXCITE", { .label = "Sustain Excite", .unit = "%" });
 
     // Vibrato parameters
@@ -117,11 +88,10 @@ public:
     // --- constructor ---
     StringEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "String")
-        , multiFx(props.sampleRate, props.lookupTable)
-        , multiFx2(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , multiFx2(props.sampleRate, props.lookupTable, props.arena)
+        , resonator(props.sampleRate)
     {
-        delayLen = (uint32_t)std::min<uint64_t>((uint64_t)(props.sampleRate * 0.02f), (uint64_t)MAX_DELAY);
-        delayLine.assign(delayLen + 4, 0.0f);
         initValues();
     }
 
@@ -132,23 +102,8 @@ public:
         velocity = _velocity;
         setBaseFreq(pitch.get(), note - 24); // remove 2 octaves
 
-        float freq = baseFreq;
-        if (freq < 20.0f)
-            freq = 20.0f;
-        if (freq > props.sampleRate * 0.45f)
-            freq = props.sampleRate * 0.45f;
-
-        uint32_t len = (uint32_t)std::max<int>(2, (int)std::round(props.sampleRate / freq));
-        len = std::min<uint32_t>(len, MAX_DELAY);
-
-        if (len != delayLen) {
-            delayLen = len;
-            delayLine.assign(delayLen + 4, 0.0f);
-        }
-
-        writePos = 0;
-        onePoleState = 0.0f;
-        resonatorActive = true;
+        resonator.setFrequency(0, std::max(20.0f, baseFreq));
+        vibRatioApplied = 1.0f;
         driverEnv = 1.0f;
         isNoteHeld = true;
     }
@@ -212,7 +167,11 @@ public:
             driver = n * sustainExcite.pct() * velocity * driverEnv;
         }
 
-        float out = resonatorTick(driver, vibRatio);
+        if (vibRatio != vibRatioApplied) {
+            resonator.detune(0, vibRatio);
+            vibRatioApplied = vibRatio;
+        }
+        float out = resonator.process(driver);
         out *= velocity * envAmpVal;
 
         out = multiFx.apply(out, fxAmount.pct());
@@ -5,7 +5,7 @@ This code defines the structure and behavior for a specialized sound generator n
 
 The fundamental purpose is audio synthesis, carried out by layering multiple sawtooth waves. The process involves:
 
-1.  **Layered Generation:** The engine generates up to seven individual sawtooth waveforms simultaneously using band-limited wavetable oscillators.
+1.  **Layered Generation:** The engine generates up to seven individual sawtooth waveforms simultaneously using a bank of PolyBLEP band-limited oscillators, rendered together in SIMD lanes.
 2.  **Detuning:** It slightly detunes these layers from one another (the "detune" parameter is crucial here) to create a wide, swirling sound.
 3.  **Mixing and Noise:** The layered waves are summed together, and an optional noise component can be mixed in.
 4.  **Filtering:** The combined signal passes through a specialized audio filter (`MMfilter`) controlled by user settings for cutoff frequency and resonance, shaping the overall timbre.
@@ -28,7 +28,7 @@ sha: 19d228c7ac4b4016a0d03a06c98fc8951a357f6a97c6716c18a725e29fd85948
 #include "plugins/audio/MultiEngine/Engine.h"
 #include "audio/MMfilter.h"
 #include "audio/MultiFx.h"
-#include "audio/WavetableGenerator2.h"
+#include "audio/BlepOscillatorBank.h"
 #include "plugins/audio/utils/valMMfilterCutoff.h"
 #include <cmath>
 
@@ -41,9 +41,28 @@ protected:
 
     float velocity = 1.0f;
 
-    // Use wavetable generators for anti-aliased saws
-    WavetableGenerator osc[MAX_VOICES];
-    float sampleIndices[MAX_VOICES] = { 0.0f };
+    // Band-limited saws, one lane per voice, the unused lanes being muted
+    BlepOscillatorBank<MAX_VOICES + 1> osc;
+
+    // Settings of the lanes, only updated when they change
+    int oscVoices = 0;
+    float oscDetune = -1.0f;
+    float oscBaseFreq = 0.0f;
+    void updateOsc(int numVoices, float detuneAmt)
+    {
+        if (numVoices == oscVoices && detuneAmt == oscDetune && baseFreq == oscBaseFreq) {
+            return;
+        }
+        oscVoices = numVoices;
+        oscDetune = detuneAmt;
+        oscBaseFreq = baseFreq;
+        for (int i = 0; i < MAX_VOICES + 1; ++i) {
+            // Spread voices evenly around center, with center voice undetuned
+            float voicePos = (numVoices > 1) ? ((float)i / (numVoices - 1) - 0.5f) * 2.0f : 0.0f;
+            osc.setFrequency(i, baseFreq * (1.0f + voicePos * detuneAmt));
+            osc.setGain(i, i < numVoices ? 1.0f / numVoices : 0.0f);
+        }
+    }
 
 public:
     // --- 10 parameters ---
@@ -78,22 +97,10 @@ public:
     // --- constructor ---
     SuperSawEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "SuperSaw")
-        , multiFx(props.sampleRate, props.lookupTable)
-        , multiFx2(props.sampleRate, props.lookupTable)
-        , osc {
-            WavetableGenerator(props.lookupTable, props.sampleRate),
-            WavetableGenerator(props.lookupTable, props.sampleRate),
-            WavetableGenerator(props.lookupTable, props.sampleRate),
-            WavetableGenerator(props.lookupTable, props.sampleRate),
-            WavetableGenerator(props.lookupTable, props.sampleRate),
-            WavetableGenerator(props.lookupTable, props.sampleRate),
-            WavetableGenerator(props.lookupTable, props.sampleRate)
-        }
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , multiFx2(props.sampleRate, props.lookupTable, props.arena)
+        , osc(props.sampleRate, BlepOscillatorBank<MAX_VOICES + 1>::SAWTOOTH)
     {
-        // Set all oscillators to Saw waveform
-        for (int i = 0; i < MAX_VOICES; ++i) {
-            osc[i].setType(WavetableGenerator::Type::Saw);
-        }
         initValues();
     }
 
@@ -109,20 +116,8 @@ public:
         int numVoices = voices.get();
         float detuneAmt = detune.pct() * 0.03f; // Max 3% detune (gentler than before)
 
-        float sampleSum = 0.0f;
-        for (int i = 0; i < numVoices; ++i) {
-            // Spread voices evenly around center, with center voice undetuned
-            float voicePos = (numVoices > 1) ? ((float)i / (numVoices - 1) - 0.5f) * 2.0f : 0.0f;
-            float det = voicePos * detuneAmt;
-            
-            // Calculate frequency and convert to ratio for wavetable (divide by 110)
-            float freq = (baseFreq * (1.0f + det)) / 110.0f;
-
-            // Use wavetable oscillator for anti-aliased saw
-            sampleSum += osc[i].sample(&sampleIndices[i], freq);
-        }
-
-        float out = sampleSum / numVoices;
+        updateOsc(numVoices, detuneAmt);
+        float out = osc.next();
 
         // noise
         float n = props.lookupTable->getNoise();
@@ -144,7 +139,7 @@ public:
         
         // Randomize starting phases to avoid harsh transient click
         for (int i = 0; i < MAX_VOICES; ++i) {
-            sampleIndices[i] = (float)rand() / RAND_MAX;
+            osc.setPhase(i, (float)rand() / RAND_MAX);
         }
     }
 };
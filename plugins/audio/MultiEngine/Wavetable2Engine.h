@@ -128,10 +128,32 @@ public:
     // --- constructor ---
     Wavetable2Engine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "Wavtabl2")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
         , lfo(props.sampleRate)
     {
         initValues();
+        // Same as SynthWavetable `preloadWavetables`
+        if (c.json.value("preloadWavetables", false)) {
+            wavetable.preload();
+        }
+    }
+
+    void controlTick(uint32_t frameOffset) override
+    {
+        // Envelope-to-filter modulation at control rate: filter tracks envelope
+        float envFilterAmount = envFilterMod.pct();
+        if (envFilterAmount > 0.01f && cutoff.get() != 0.0f) {
+            float envMod = envelopAmp.get() * envFilterAmount;
+            float modCutoff;
+            if (cutoff.get() > 0.0f) {
+                // LPF mode: increase cutoff with envelope
+                modCutoff = baseCutoff + (1.0f - baseCutoff) * envMod;
+            } else {
+                // HPF mode: decrease cutoff intensity with envelope
+                modCutoff = baseCutoff * (1.0f - envMod * 0.5f);
+            }
+            filter.setCutoff(modCutoff);
+        }
     }
 
     void sample(float* buf, float envAmpVal) override
@@ -161,21 +183,6 @@ public:
         // Apply pitch-tracking anti-alias filter first (always on, reduces harshness)
         out = antiAliasFilter.process(out);
 
-        // Envelope-to-filter modulation: filter tracks envelope
-        float envFilterAmount = envFilterMod.pct();
-        if (envFilterAmount > 0.01f && cutoff.get() != 0.0f) {
-            float envMod = envAmpVal * envFilterAmount;
-            float modCutoff;
-            if (cutoff.get() > 0.0f) {
-                // LPF mode: increase cutoff with envelope
-                modCutoff = baseCutoff + (1.0f - baseCutoff) * envMod;
-            } else {
-                // HPF mode: decrease cutoff intensity with envelope
-                modCutoff = baseCutoff * (1.0f - envMod * 0.5f);
-            }
-            filter.setCutoff(modCutoff);
-        }
-
         out = filter.process(out);
         out = out * envAmpVal * velocity;
         out = multiFx.apply(out, fxAmount.pct());
@@ -126,10 +126,35 @@ public:
     // --- constructor ---
     WavetableEngine(AudioPlugin::Props& p, AudioPlugin::Config& c)
         : Engine(p, c, "Wavtabl")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
         , lfo(props.sampleRate)
     {
         initValues();
+        // Same as SynthWavetable `preloadWavetables`
+        if (c.json.value("preloadWavetables", false)) {
+            wavetable.preload();
+        }
+    }
+
+    void controlTick(uint32_t frameOffset) override
+    {
+        // Envelope-to-filter modulation at control rate: filter tracks envelope
+        // Works with both LPF (positive cutoff) and HPF (negative cutoff)
+        float envFilterAmount = envFilterMod.pct();
+        if (envFilterAmount > 0.01f && cutoff.get() != 0.0f) {
+            // For LPF: filter opens (higher cutoff) on attack
+            // For HPF: filter opens (lower cutoff = less filtering) on attack
+            float envMod = envelopAmp.get() * envFilterAmount;
+            float modCutoff;
+            if (cutoff.get() > 0.0f) {
+                // LPF mode: increase cutoff with envelope
+                modCutoff = baseCutoff + (1.0f - baseCutoff) * envMod;
+            } else {
+                // HPF mode: decrease cutoff intensity with envelope (let more through)
+                modCutoff = baseCutoff * (1.0f - envMod * 0.5f);
+            }
+            filter.setCutoff(modCutoff);
+        }
     }
 
     void sample(float* buf, float envAmpVal) override
@@ -159,24 +184,6 @@ public:
         // Apply pitch-tracking anti-alias filter first (always on, reduces harshness)
         out = antiAliasFilter.process(out);
 
-        // Envelope-to-filter modulation: filter tracks envelope
-        // Works with both LPF (positive cutoff) and HPF (negative cutoff)
-        float envFilterAmount = envFilterMod.pct();
-        if (envFilterAmount > 0.01f && cutoff.get() != 0.0f) {
-            // For LPF: filter opens (higher cutoff) on attack
-            // For HPF: filter opens (lower cutoff = less filtering) on attack
-            float envMod = envAmpVal * envFilterAmount;
-            float modCutoff;
-            if (cutoff.get() > 0.0f) {
-                // LPF mode: increase cutoff with envelope
-                modCutoff = baseCutoff + (1.0f - baseCutoff) * envMod;
-            } else {
-                // HPF mode: decrease cutoff intensity with envelope (let more through)
-                modCutoff = baseCutoff * (1.0f - envMod * 0.5f);
-            }
-            filter.setCutoff(modCutoff);
-        }
-
         out = filter.process(out);
         out = out * envAmpVal * velocity;
         out = multiFx.apply(out, fxAmount.pct());
@@ -74,7 +74,7 @@ protected:
 public:
     AmEngine(AudioPlugin::Props& props, AudioPlugin::Config& config, SampleBuffer& sampleBuffer, float& index, float& stepMultiplier)
         : LoopedEngine(props, config, sampleBuffer, index, stepMultiplier, "AM")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
     {
     }
 
@@ -97,7 +97,7 @@ public:
         if (modPhase > 2.0f * (float)M_PI)
             modPhase -= 2.0f * (float)M_PI;
 
-        return sampleBuffer.data[(int)index] * (1.0f + modValue * depthFactor) * 0.5f;
+        return interpolation.at(sampleBuffer.data, sampleBuffer.count, sampleBuffer.channels, index) * (1.0f + modValue * depthFactor) * 0.5f;
     }
 
     void postProcess(float* buf) override
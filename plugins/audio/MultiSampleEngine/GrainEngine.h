@@ -41,11 +41,6 @@ protected:
         });
     }
 
-    float getDataSample(uint64_t idx)
-    {
-        return sampleBuffer.data[idx];
-    }
-
 public:
     Val& length = val(100.0f, "GRAIN_LENGTH", { "Grain Length", .min = 5.0, .max = 500.0, .unit = "ms" }, [&](auto p) {
         p.val.setFloat(p.value);
@@ -91,8 +86,8 @@ public:
 
     GrainEngine(AudioPlugin::Props& props, AudioPlugin::Config& config, SampleBuffer& sampleBuffer, float& index, float& stepMultiplier)
         : LoopedEngine(props, config, sampleBuffer, index, stepMultiplier, "Grain", GetValExtra { this })
-        , multiFx(props.sampleRate, props.lookupTable)
-        , grains(props.lookupTable, [this](uint64_t idx) -> float { return getDataSample(idx); })
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , grains(props.lookupTable, [this]() -> const float* { return this->sampleBuffer.data; })
     {
     }
 
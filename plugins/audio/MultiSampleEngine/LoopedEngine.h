@@ -21,9 +21,11 @@ sha: 034d17d3e8172ccf7b9da0e811e90992e36faf101fbace65a06bfce879815868
 #pragma once
 
 #include "plugins/audio/MultiSampleEngine/SampleEngine.h"
+#include "plugins/audio/utils/SampleInterpolation.h"
 
 class LoopedEngine : public SampleEngine {
 protected:
+    SampleInterpolation interpolation;
     uint64_t indexStart = 0;
     uint64_t indexEnd = 0;
     uint64_t loopStart = 0;
@@ -34,6 +36,8 @@ protected:
 
     float velocity = 1.0;
     uint8_t sustainedNote = 0;
+    // Each note plays a slice of the sample, see SliceAnalyzer
+    bool sliceNotes = false;
 
     uint8_t baseNote = 60;
     float getSampleStep(uint8_t note)
@@ -130,11 +134,15 @@ public:
             }
         }))
     {
+        // `"interpolation": "linear"` of the plugin config, see SampleInterpolation
+        interpolation.setKernel(SampleInterpolation::getKernel(config.json.value("interpolation", "linear")));
+        // `"sliceNotes": true` of the plugin config, see SynthMultiSample
+        sliceNotes = config.json.value("sliceNotes", false);
     }
 
     virtual float getSample(float stepIncrement)
     {
-        return sampleBuffer.data[(int)index];
+        return interpolation.at(sampleBuffer.data, sampleBuffer.count, sampleBuffer.channels, index);
     }
 
     void sample(float* buf) override
@@ -161,11 +169,30 @@ public:
 
     virtual void postProcess(float* buf) { }
 
+    // Play the slice of the note once, at the pitch of the sample, the base note playing the first slice
+    void sliceNoteOn(uint8_t note)
+    {
+        const SliceAnalyzer::SliceMap* slices = sampleBuffer.slices;
+        int count = slices->count();
+        size_t slice = (((int)note - baseNote) % count + count) % count;
+        index = std::min(slices->start(slice, sampleBuffer.rate, sampleBuffer.channels), sampleBuffer.count);
+        indexEnd = std::min(slices->end(slice, sampleBuffer.rate, sampleBuffer.channels), sampleBuffer.count);
+        stepIncrement = stepMultiplier;
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
+        if (sliceNotes && sampleBuffer.slices) {
+            sliceNoteOn(note);
+            interpolation.setStep(stepIncrement / sampleBuffer.channels);
+            velocity = _velocity;
+            engineNoteOn(note, _velocity);
+            return;
+        }
         index = indexStart;
         indexEnd = end.pct() * sampleBuffer.count;
         stepIncrement = getSampleStep(note);
+        interpolation.setStep(stepIncrement / sampleBuffer.channels);
         velocity = _velocity;
         if (sustainLength.get() > 0.0f) {
             sustainedNote = note;
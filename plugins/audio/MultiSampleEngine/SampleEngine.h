@@ -19,6 +19,7 @@ sha: 0843993c48116370b36488fc7496b9d52cf19a35c17f3070c4aa123e6b256fd5
 
 #include "plugins/audio/audioPlugin.h"
 #include "plugins/audio/mapping.h"
+#include "plugins/audio/utils/SliceAnalyzer.h"
 
 class SampleEngine : public Mapping {
 public:
@@ -29,6 +30,14 @@ public:
     struct SampleBuffer {
         uint64_t count = 0;
         float* data;
+        // File of the samples, and incremented each time another file is loaded
+        std::string path;
+        uint8_t channels = 1;
+        uint32_t version = 0;
+        // Sample rate of the file, the samples being read as they are
+        uint32_t rate = 0;
+        // Slices of the file, NULL until they are found
+        const SliceAnalyzer::SliceMap* slices = NULL;
     };
     SampleBuffer& sampleBuffer;
 
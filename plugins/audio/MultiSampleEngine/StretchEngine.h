@@ -49,7 +49,7 @@ public:
     StretchEngine(AudioPlugin::Props& props, AudioPlugin::Config& config,
         SampleBuffer& sampleBuffer, float& index, float& stepMultiplier)
         : LoopedEngine(props, config, sampleBuffer, index, stepMultiplier, "Stretch")
-        , multiFx(props.sampleRate, props.lookupTable)
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
     {
     }
 
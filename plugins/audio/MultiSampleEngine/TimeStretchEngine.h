@@ -0,0 +1,320 @@
+#pragma once
+
+#include "plugins/audio/MultiSampleEngine/LoopedEngine.h"
+#include "audio/MMfilter.h"
+#include "audio/MultiFx.h"
+#include "audio/StretchAnalysisBank.h"
+#include "plugins/audio/utils/valMMfilterCutoff.h"
+
+#include <algorithm>
+#include <cstring>
+
+// Time stretching without changing the pitch, from the analysis built in the background when the sample is
+// loaded: WSOLA overlaps grains aligned on the period of the waveform, keeping the onsets sharp, and the phase
+// vocoder resynthesizes the spectrum, keeping sustained sounds smooth. The note still changes the pitch.
+class TimeStretchEngine : public LoopedEngine {
+protected:
+    static const uint32_t N = StretchAnalysis::FFT_SIZE;
+    static const uint32_t BINS = StretchAnalysis::BINS;
+    // Hann windows overlapping by half for WSOLA, by 3/4 for the phase vocoder
+    static const uint32_t WSOLA_HOP = N / 2;
+    static const uint32_t VOCODER_HOP = StretchAnalysis::HOP;
+
+    enum Mode {
+        AUTO,
+        WSOLA,
+        VOCODER,
+    };
+
+    MMfilter filter;
+    MultiFx multiFx;
+
+    std::atomic<const StretchAnalysis*> analysis { NULL };
+    uint32_t requestedVersion = 0;
+    const StretchAnalysis* playing = NULL;
+    bool useVocoder = false;
+
+    float window[N];
+    // Output being overlap-added, one hop being played while the next frames are still summed
+    float ola[N] = {};
+    uint32_t hop = WSOLA_HOP;
+    uint32_t hopPos = 0;
+    bool active = false;
+    // Hops left to play the tail of the last frame
+    uint32_t tail = 0;
+
+    // Position in the played channel, in samples
+    float position = 0.0f;
+    float pitch = 1.0f;
+    uint32_t channelStride = 1;
+
+    // WSOLA state
+    float grainStart = 0.0f;
+    bool firstGrain = true;
+    bool jumped = false;
+    uint32_t lastTransient = 0;
+
+    // Phase vocoder state, the phases being the ones of the analysis bins before the pitch change
+    RealFft fft = RealFft(N);
+    std::complex<float> spectrum[BINS];
+    float resynthesis[N];
+    float synthPhases[BINS] = {};
+    float magnitudes[BINS] = {};
+    uint32_t peaks[BINS];
+    bool resetPhases = true;
+
+    Val& stretch = val(1.0f, "STRETCH", { "Stretch", .min = 0.25f, .max = 8.0f, .step = 0.05f, .floatingPoint = 2, .unit = "x" });
+    Val& mode = val(0, "MODE", { "Mode", VALUE_STRING, .max = 2 }, [&](auto p) {
+        p.val.setFloat(p.value);
+        p.val.setString(p.val.get() == WSOLA ? "WSOLA" : p.val.get() == VOCODER ? "Vocoder" : "Auto");
+    });
+
+    Val& cutoff = val(0.0, "CUTOFF", { "LPF | HPF", VALUE_CENTERED | VALUE_STRING, .min = -100.0, .max = 100.0 }, [&](auto p) {
+        valMMfilterCutoff(p, filter);
+    });
+    Val& resonance = val(0.0, "RESONANCE", { "Resonance", .unit = "%" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        filter.setResonance(p.val.pct());
+    });
+
+    Val& fxType = val(0, "FX_TYPE", { "FX type", VALUE_STRING, .max = MultiFx::FXType::FX_COUNT - 1 }, multiFx.setFxType);
+    Val& fxAmount = val(0, "FX_AMOUNT", { "FX amount", .unit = "%" });
+
+    void requestAnalysis()
+    {
+        requestedVersion = sampleBuffer.version;
+        channelStride = std::max((int)stepMultiplier, 1);
+        if (sampleBuffer.count > 0) {
+            StretchAnalysisBank::get().request(sampleBuffer.path, sampleBuffer.count, channelStride, &analysis);
+        }
+    }
+
+    uint32_t length()
+    {
+        return sampleBuffer.count / channelStride;
+    }
+
+    float read(float pos)
+    {
+        if (pos < 0.0f || pos + 1.0f >= length()) {
+            return 0.0f;
+        }
+        uint32_t i = pos;
+        float a = sampleBuffer.data[i * channelStride];
+        float b = sampleBuffer.data[(i + 1) * channelStride];
+        return a + (b - a) * (pos - i);
+    }
+
+    // Start of the next grain: its natural continuation moved by whole periods toward the played position, so the
+    // waveforms overlap in phase. Onsets are started right on time and never played twice.
+    float nextGrainStart()
+    {
+        float continuation = grainStart + hop * pitch;
+        if (!playing || firstGrain || jumped) {
+            return position;
+        }
+        uint32_t transient = playing->nextTransient(lastTransient);
+        if (transient <= position + hop * stretchSpeed() && transient > grainStart) {
+            lastTransient = transient;
+            return std::max((float)transient - N / 8, 0.0f);
+        }
+        float period = playing->period(position);
+        if (period <= 0.0f) {
+            return position;
+        }
+        float start = continuation + roundf((position - continuation) / period) * period;
+        // Starting before the last onset would repeat it
+        while (start < lastTransient && lastTransient <= position) {
+            start += period;
+        }
+        return start;
+    }
+
+    void addGrain()
+    {
+        grainStart = nextGrainStart();
+        for (uint32_t n = 0; n < N; n++) {
+            // Nothing overlaps the first half of the first grain
+            float w = firstGrain && n < N / 2 ? 1.0f : window[n];
+            ola[n] += read(grainStart + n * pitch) * w;
+        }
+        firstGrain = false;
+        jumped = false;
+    }
+
+    static float wrap(float phase)
+    {
+        return phase - 2.0f * M_PI * roundf(phase * (0.5f / M_PI));
+    }
+
+    void addSpectrum()
+    {
+        const uint32_t H = StretchAnalysis::HOP;
+        float frame = position / H;
+        uint32_t f = frame;
+        float frac = frame - f;
+        const float* m0 = playing->magnitude(f);
+        const float* m1 = playing->magnitude(f + 1);
+        const float* p0 = playing->phase(f);
+        const float* p1 = playing->phase(f + 1);
+        // Onsets reset the phases, so they are not smeared
+        uint32_t transient = playing->nextTransient(lastTransient);
+        if (transient <= position) {
+            lastTransient = transient;
+            resetPhases = true;
+        }
+
+        uint32_t peakCount = 0;
+        for (uint32_t j = 0; j < BINS; j++) {
+            magnitudes[j] = m0[j] + (m1[j] - m0[j]) * frac;
+            if (j > 1 && magnitudes[j - 1] > magnitudes[j - 2] && magnitudes[j - 1] >= magnitudes[j]) {
+                peaks[peakCount++] = j - 1;
+            }
+        }
+
+        if (resetPhases || peakCount == 0) {
+            std::copy(p0, p0 + BINS, synthPhases);
+        } else {
+            // Only the peaks move at their own frequency, the bins around them keep the phase relation they have
+            // in the analysis, so the partials stay coherent from one bin to the next
+            for (uint32_t p = 0; p < peakCount; p++) {
+                uint32_t j = peaks[p];
+                float expected = 2.0f * M_PI * j * H / N;
+                float omega = (expected + wrap(p1[j] - p0[j] - expected)) / H;
+                synthPhases[j] = wrap(synthPhases[j] + omega * pitch * hop);
+            }
+            uint32_t p = 0;
+            for (uint32_t j = 0; j < BINS; j++) {
+                if (p + 1 < peakCount && j * 2 > peaks[p] + peaks[p + 1]) {
+                    p++;
+                }
+                uint32_t peak = peaks[p];
+                if (j != peak) {
+                    synthPhases[j] = wrap(synthPhases[peak] + p0[j] - p0[peak]);
+                }
+            }
+        }
+        resetPhases = false;
+
+        float invPitch = 1.0f / pitch;
+        for (uint32_t k = 0; k < BINS; k++) {
+            uint32_t j = k * invPitch + 0.5f;
+            spectrum[k] = j < BINS ? std::polar(magnitudes[j], synthPhases[j]) : 0.0f;
+        }
+        fft.inverse(spectrum, resynthesis);
+        // The squared Hann windows sum to 1.5 when overlapping by 3/4
+        float gain = 1.0f / (N * 1.5f);
+        for (uint32_t n = 0; n < N; n++) {
+            ola[n] += resynthesis[n] * window[n] * gain;
+        }
+    }
+
+    float stretchSpeed()
+    {
+        return 1.0f / stretch.get();
+    }
+
+    void nextHop()
+    {
+        memmove(ola, ola + hop, (N - hop) * sizeof(float));
+        std::fill(ola + N - hop, ola + N, 0.0f);
+        hopPos = 0;
+        if (tail > 0) {
+            if (--tail == 0) {
+                active = false;
+            }
+            return;
+        }
+
+        float end = indexEnd / channelStride;
+        float loopEndPos = loopEnd / channelStride;
+        if (position >= loopEndPos && (sustainedNote || nbOfLoopBeforeRelease > 0)) {
+            position = loopStart / channelStride + (position - loopEndPos);
+            nbOfLoopBeforeRelease--;
+            jumped = true;
+            lastTransient = position;
+        }
+        if (position >= end) {
+            // Play what is left of the frames already added
+            tail = N / hop - 1;
+            index = sampleBuffer.count;
+            return;
+        }
+
+        if (useVocoder) {
+            addSpectrum();
+        } else {
+            addGrain();
+        }
+        position += hop * stretchSpeed();
+        index = position * channelStride;
+    }
+
+public:
+    TimeStretchEngine(AudioPlugin::Props& props, AudioPlugin::Config& config,
+        SampleBuffer& sampleBuffer, float& index, float& stepMultiplier)
+        : LoopedEngine(props, config, sampleBuffer, index, stepMultiplier, "Time Stretch")
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+    {
+        for (uint32_t n = 0; n < N; n++) {
+            window[n] = 0.5f - 0.5f * cosf(2.0f * M_PI * n / N);
+        }
+        requestAnalysis();
+    }
+
+    ~TimeStretchEngine()
+    {
+        StretchAnalysisBank::get().cancel(&analysis);
+    }
+
+    void opened() override
+    {
+        requestAnalysis();
+        LoopedEngine::opened();
+    }
+
+    void sample(float* buf) override
+    {
+        float out = 0.0f;
+        if (active) {
+            if (hopPos >= hop) {
+                nextHop();
+            }
+            out = ola[hopPos++] * velocity;
+        }
+        buf[track] = out;
+        postProcess(buf);
+    }
+
+    void postProcess(float* buf) override
+    {
+        float out = buf[track];
+        out = filter.process(out);
+        out = multiFx.apply(out, fxAmount.pct());
+        buf[track] = out;
+    }
+
+    void engineNoteOn(uint8_t note, float _velocity) override
+    {
+        // The sample was changed while another engine was selected
+        if (requestedVersion != sampleBuffer.version) {
+            requestAnalysis();
+        }
+        playing = analysis.load(std::memory_order_acquire);
+        // Until the analysis is ready, WSOLA plays without alignment
+        useVocoder = playing && (mode.get() == VOCODER || (mode.get() == AUTO && playing->tonal));
+        hop = useVocoder ? VOCODER_HOP : WSOLA_HOP;
+
+        std::fill(ola, ola + N, 0.0f);
+        pitch = stepIncrement / stepMultiplier;
+        position = indexStart / channelStride;
+        firstGrain = true;
+        jumped = false;
+        resetPhases = true;
+        lastTransient = position;
+        tail = 0;
+        active = sampleBuffer.count > 0;
+        // The first hop is computed on the first sample
+        hopPos = hop;
+    }
+};
@@ -0,0 +1,469 @@
+#pragma once
+
+#include <chrono>
+#include <cmath>
+#include <netdb.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "audioPlugin.h"
+#include "helpers/MpscQueue.h"
+#include "log.h"
+#include "utils/NetAudio.h"
+#include "utils/RemoteTrackPacket.h"
+
+/*md
+## RemoteTrack
+
+RemoteTrack plugin is used to have its track rendered by another unit on the network, running `RemoteTrackServer`,
+e.g. to offload a heavy synth from a small device to a computer. The plugins following RemoteTrack on the track are
+mirrors of the ones on the other unit, with the same aliases: they keep their values and views, but are no longer
+rendered. Instead, each block, RemoteTrack sends to the other unit the notes played on the track, the values changed
+on the mirrors, the clock ticks and the transport, then plays the audio the other unit rendered for it.
+
+The other unit renders the block right away, so the round trip is the network latency plus one block. The audio of a
+block is played `latencyMs` after it was sent, and the plugin reports this latency to the host, so the other tracks
+are delayed to stay aligned (see `compensateLatency`). A block missing when it should be played is silenced.
+
+Each packet also repeats the events of the previous block, so a single lost packet loses no note. The data of the
+mirrors (e.g. the steps of a sequencer) is not sent, only their values: keep such plugins before RemoteTrack, their
+notes being forwarded.
+
+```json
+{ "plugin": "RemoteTrack", "host": "192.168.1.20" },
+{ "plugin": "SynthHeavy", "alias": "Heavy" }
+```
+*/
+class RemoteTrack : public AudioPlugin {
+protected:
+    typedef RemoteTrackPacket Packet;
+
+    // Blocks of audio received ahead of their playback, a slot per block
+    static constexpr uint32_t SLOTS = 64;
+    struct Slot {
+        std::atomic<uint64_t> frame = UINT64_MAX;
+        std::atomic<uint32_t> received = 0;
+        std::atomic<int64_t> sentUs = 0;
+    };
+    Slot slots[SLOTS];
+    std::vector<float> slotSamples;
+
+    struct OutPacket {
+        uint16_t size;
+        uint8_t data[Packet::MAX_SIZE];
+    };
+    MpscQueue<OutPacket, 16> outPackets;
+    MpscQueue<Packet::Note, 64> notes;
+
+    uint8_t channels = 1;
+    uint32_t latencyBlocks = 1;
+    int fd = -1;
+    int wakeFd = -1;
+    int stopFd = -1;
+    std::thread networkThread;
+
+    std::vector<AudioPlugin*> mirrors;
+    struct Entry {
+        uint8_t plugin;
+        uint8_t index;
+    };
+    std::vector<Entry> entries;
+
+    NetAudio::AtomicStats stats;
+    NetAudio::Stats statsCopy;
+
+    // Audio thread
+    std::atomic<uint32_t> blockOffset = 0;
+    uint64_t blockFrame = 0;
+    uint32_t sequence = 0;
+    std::vector<float> sentValues;
+    uint32_t refreshCursor = 0;
+    uint8_t sections[2][Packet::MAX_SECTION];
+    uint32_t sectionSizes[2] = { 0, 0 };
+    uint8_t current = 0;
+    std::atomic<uint64_t> lastSentFrame = 0;
+    std::atomic<uint64_t> playedFrame = 0;
+
+    static int64_t nowUs()
+    {
+        return std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+    }
+
+    static void wake(int eventFd)
+    {
+        uint64_t one = 1;
+        if (write(eventFd, &one, sizeof(one)) < 0) {
+            // Counter saturated, the thread is awake anyway
+        }
+    }
+
+    bool connectTo(std::string host, uint16_t port)
+    {
+        struct addrinfo hints = {};
+        hints.ai_family = AF_INET;
+        hints.ai_socktype = SOCK_DGRAM;
+        struct addrinfo* result = NULL;
+        if (getaddrinfo(host.c_str(), std::to_string(port).c_str(), &hints, &result) != 0 || !result) {
+            return false;
+        }
+        // Connected, so only the replies of the other unit are received
+        bool connected = connect(fd, result->ai_addr, result->ai_addrlen) == 0;
+        freeaddrinfo(result);
+        return connected;
+    }
+
+    // Events of the block just rendered, sent with the ones of the previous block
+    void sendBlock()
+    {
+        uint8_t* section = sections[current];
+        uint32_t size = sizeof(Packet::Section);
+        Packet::Section header;
+        header.sequence = sequence++;
+        header.frames = props.blockSize;
+        header.transport = props.audioPluginHandler->isPlaying() ? Packet::PLAYING
+            : (props.audioPluginHandler->isStopped() ? Packet::STOPPED : 0);
+        header.frame = blockFrame;
+
+        header.tickCount = 0;
+        if (props.clockEvents) {
+            for (uint32_t i = 0; i < props.clockEvents->count && header.tickCount < Packet::MAX_TICKS; i++) {
+                Packet::Tick tick;
+                tick.offset = props.clockEvents->ticks[i].offset;
+                tick.clock = props.clockEvents->ticks[i].clock;
+                memcpy(section + size, &tick, sizeof(tick));
+                size += sizeof(tick);
+                header.tickCount++;
+            }
+        }
+
+        header.noteCount = 0;
+        while (Packet::Note* note = notes.front()) {
+            if (header.noteCount == Packet::MAX_NOTES) {
+                // Played with the next block
+                break;
+            }
+            memcpy(section + size, note, sizeof(*note));
+            size += sizeof(*note);
+            header.noteCount++;
+            notes.pop();
+        }
+
+        // Changed values, plus a couple of unchanged ones in turn, so a restarted server catches up
+        header.valueCount = 0;
+        uint32_t refresh = 2;
+        for (uint32_t n = 0; n < entries.size() && header.valueCount < Packet::MAX_VALUES; n++) {
+            uint32_t i = (refreshCursor + n) % entries.size();
+            float value = mirrors[entries[i].plugin]->getValue(entries[i].index)->get();
+            if (value == sentValues[i]) {
+                if (!refresh) {
+                    continue;
+                }
+                refresh--;
+            }
+            Packet::Value entry;
+            entry.plugin = entries[i].plugin;
+            entry.index = entries[i].index;
+            entry.value = value;
+            memcpy(section + size, &entry, sizeof(entry));
+            size += sizeof(entry);
+            sentValues[i] = value;
+            header.valueCount++;
+        }
+        if (!entries.empty()) {
+            refreshCursor = (refreshCursor + 2) % entries.size();
+        }
+        memcpy(section, &header, sizeof(header));
+        sectionSizes[current] = size;
+
+        OutPacket packet;
+        Packet::Header packetHeader;
+        packetHeader.type = Packet::BLOCK;
+        packetHeader.sections = 1;
+        packet.size = sizeof(packetHeader);
+        uint8_t previous = current ^ 1;
+        if (sectionSizes[previous] && sizeof(packetHeader) + sectionSizes[previous] + size <= Packet::MAX_SIZE) {
+            memcpy(packet.data + packet.size, sections[previous], sectionSizes[previous]);
+            packet.size += sectionSizes[previous];
+            packetHeader.sections = 2;
+        }
+        memcpy(packet.data + packet.size, section, size);
+        packet.size += size;
+        memcpy(packet.data, &packetHeader, sizeof(packetHeader));
+        current = previous;
+
+        Slot& slot = slots[(blockFrame / props.blockSize) % SLOTS];
+        slot.sentUs.store(nowUs(), std::memory_order_relaxed);
+        lastSentFrame.store(blockFrame, std::memory_order_release);
+        if (outPackets.push(packet)) {
+            wake(wakeFd);
+        } else {
+            stats.dropped.fetch_add(props.blockSize, std::memory_order_relaxed);
+        }
+    }
+
+    void sendNames()
+    {
+        uint8_t packet[Packet::MAX_SIZE];
+        Packet::Header header;
+        header.type = Packet::NAMES;
+        header.sections = mirrors.size();
+        memcpy(packet, &header, sizeof(header));
+        uint32_t size = sizeof(header);
+        for (AudioPlugin* mirror : mirrors) {
+            uint32_t length = mirror->name.size() + 1;
+            if (size + length > Packet::MAX_SIZE) {
+                break;
+            }
+            memcpy(packet + size, mirror->name.c_str(), length);
+            size += length;
+        }
+        if (send(fd, packet, size, 0) < 0) {
+            // Not reachable yet, sent again in a second
+        }
+    }
+
+    void receive(uint8_t* data, ssize_t len)
+    {
+        NetAudio::Header* header = (NetAudio::Header*)data;
+        NetAudio::Format format;
+        uint8_t streamChannels;
+        if (len <= (ssize_t)NetAudio::HEADER_SIZE || (header->flags & 0xc0) != 0x80
+            || !NetAudio::parsePayloadType(header->payloadType, format, streamChannels) || format == NetAudio::OPUS) {
+            return;
+        }
+        // The timestamp holds the low bits of the frame the audio belongs to
+        uint64_t sent = lastSentFrame.load(std::memory_order_acquire);
+        uint64_t frame = sent - (int32_t)((uint32_t)sent - ntohl(header->timestamp));
+        uint32_t offset = frame % props.blockSize;
+        uint64_t start = frame - offset;
+        uint32_t count = std::min<uint32_t>((len - NetAudio::HEADER_SIZE) / (streamChannels * NetAudio::sampleSize(format)),
+            props.blockSize - offset);
+        if (start < playedFrame.load(std::memory_order_relaxed) || start > sent) {
+            stats.late.fetch_add(1, std::memory_order_relaxed);
+            return;
+        }
+        stats.packets.fetch_add(1, std::memory_order_relaxed);
+
+        uint32_t index = (start / props.blockSize) % SLOTS;
+        Slot& slot = slots[index];
+        if (slot.frame.load(std::memory_order_relaxed) != start) {
+            slot.received.store(0, std::memory_order_release);
+            slot.frame.store(start, std::memory_order_release);
+        }
+        float* samples = slotSamples.data() + (index * props.blockSize + offset) * channels;
+        NetAudio::decode(format, data + NetAudio::HEADER_SIZE, count, streamChannels, samples, channels);
+        if (slot.received.fetch_add(count, std::memory_order_release) + count >= props.blockSize) {
+            float roundTrip = (nowUs() - slot.sentUs.load(std::memory_order_relaxed)) / 1000.0f;
+            float average = stats.latencyMs.load(std::memory_order_relaxed);
+            stats.latencyMs.store(average ? average + (roundTrip - average) / 16.0f : roundTrip, std::memory_order_relaxed);
+        }
+    }
+
+    void networkLoop()
+    {
+        uint8_t packet[2048];
+        struct pollfd fds[3] = { { fd, POLLIN, 0 }, { wakeFd, POLLIN, 0 }, { stopFd, POLLIN, 0 } };
+        int64_t namesUs = 0;
+        while (true) {
+            int64_t now = nowUs();
+            if (now - namesUs >= 1000000) {
+                namesUs = now;
+                sendNames();
+            }
+            if (poll(fds, 3, 1000) < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                logError("RemoteTrack: poll failed: %s", strerror(errno));
+                return;
+            }
+            if (fds[2].revents) {
+                return;
+            }
+            if (fds[1].revents) {
+                uint64_t count;
+                if (read(wakeFd, &count, sizeof(count)) < 0) {
+                    // Nothing to read, the queue is checked anyway
+                }
+            }
+            while (OutPacket* out = outPackets.front()) {
+                if (send(fd, out->data, out->size, 0) < 0) {
+                    stats.dropped.fetch_add(props.blockSize, std::memory_order_relaxed);
+                }
+                outPackets.pop();
+            }
+            if (fds[0].revents & POLLIN) {
+                ssize_t len;
+                while ((len = recv(fd, packet, sizeof(packet), MSG_DONTWAIT)) > 0) {
+                    receive(packet, len);
+                }
+            }
+        }
+    }
+
+public:
+    RemoteTrack(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : AudioPlugin(props, config)
+    {
+        auto& json = config.json;
+        /*md - `host` is the address of the unit running `RemoteTrackServer`. Default is `127.0.0.1`. */
+        std::string host = json.value("host", "127.0.0.1");
+        /*md - `port` is the UDP port of `RemoteTrackServer`. Default is 5010. */
+        uint16_t port = json.value("port", Packet::DEFAULT_PORT);
+        /*md - `latencyMs` is the delay between sending a block and playing its audio, rounded up to whole blocks. It must cover the network round trip and the rendering of a block on the other unit. Default is 10. */
+        float latencyMs = json.value("latencyMs", 10.0f);
+        latencyBlocks = std::max(1u, (uint32_t)std::ceil(latencyMs * props.sampleRate / 1000.0f / props.blockSize));
+        latencyBlocks = std::min(latencyBlocks, SLOTS / 2);
+        /*md - `channels` is 1 or 2. Default is 2 when the host buffer is stereo. */
+        channels = json.value("channels", hasStereoBuffer() ? 2 : 1) == 2 ? 2 : 1;
+        slotSamples.resize(SLOTS * props.blockSize * channels);
+
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            logError("RemoteTrack: socket failed: %s", strerror(errno));
+            return;
+        }
+        if (!connectTo(host, port)) {
+            logError("RemoteTrack: cannot reach %s", host.c_str());
+            close(fd);
+            fd = -1;
+            return;
+        }
+        // Low latency traffic, see DSCP EF
+        int tos = 0xb8;
+        setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+        networkThread = std::thread([this] { networkLoop(); });
+        pthread_setname_np(networkThread.native_handle(), "remoteTrack");
+        logInfo("RemoteTrack: track %d rendered by %s:%d, %d blocks of latency", track, host.c_str(), port, latencyBlocks);
+    }
+
+    ~RemoteTrack()
+    {
+        if (networkThread.joinable()) {
+            wake(stopFd);
+            networkThread.join();
+        }
+        for (int* watched : { &fd, &wakeFd, &stopFd }) {
+            if (*watched >= 0) {
+                close(*watched);
+            }
+        }
+    }
+
+    bool takeOverChain(std::vector<AudioPlugin*>& following) override
+    {
+        for (AudioPlugin* plugin : following) {
+            if (mirrors.size() == UINT8_MAX) {
+                logWarn("RemoteTrack: only the first %d plugins of track %d are mirrored", UINT8_MAX, track);
+                break;
+            }
+            uint8_t index = mirrors.size();
+            mirrors.push_back(plugin);
+            for (int i = 0; i < plugin->getValueCount() && i <= UINT8_MAX; i++) {
+                entries.push_back({ index, (uint8_t)i });
+            }
+        }
+        sentValues.assign(entries.size(), NAN);
+        return true;
+    }
+
+    uint32_t latencyFrames() override
+    {
+        return latencyBlocks * props.blockSize;
+    }
+
+    bool isStereo() override
+    {
+        return channels == 2 && hasStereoBuffer();
+    }
+
+    void noteOn(uint8_t note, float velocity, void* userdata = NULL) override
+    {
+        notes.push({ (uint16_t)blockOffset.load(std::memory_order_relaxed), note, 1, velocity });
+    }
+
+    void noteOff(uint8_t note, float velocity, void* userdata = NULL) override
+    {
+        notes.push({ (uint16_t)blockOffset.load(std::memory_order_relaxed), note, 0, velocity });
+    }
+
+    void sample(float* buf) override
+    {
+        sampleBlock(buf, 1);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (fd < 0) {
+            return;
+        }
+        const uint32_t stride = props.frameStride;
+        uint32_t offset = blockOffset.load(std::memory_order_relaxed);
+        if (offset == 0) {
+            blockFrame = props.audioPluginHandler->getBlockFrame();
+        }
+
+        // Audio the other unit rendered for the block sent `latencyBlocks` earlier
+        uint64_t playFrame = blockFrame - latencyBlocks * props.blockSize;
+        uint32_t index = (playFrame / props.blockSize) % SLOTS;
+        Slot& slot = slots[index];
+        // The receiver clears the count before taking the slot for another block
+        bool started = blockFrame >= latencyBlocks * props.blockSize;
+        bool ready = started
+            && slot.frame.load(std::memory_order_acquire) == playFrame
+            && slot.received.load(std::memory_order_acquire) >= props.blockSize;
+        float* lane = trackLane(buf, track);
+        float* right = rightLane(buf, track);
+        const float* samples = slotSamples.data() + (index * props.blockSize + offset) * channels;
+        for (uint32_t f = 0; f < frames; f++) {
+            lane[f * stride] = ready ? samples[f * channels] : 0.0f;
+            if (channels == 2) {
+                right[f * stride] = ready ? samples[f * 2 + 1] : 0.0f;
+            }
+        }
+
+        offset += frames;
+        if (offset < props.blockSize) {
+            blockOffset.store(offset, std::memory_order_relaxed);
+            return;
+        }
+        blockOffset.store(0, std::memory_order_relaxed);
+        if (started) {
+            if (!ready) {
+                stats.underruns.fetch_add(1, std::memory_order_relaxed);
+            }
+            playedFrame.store(playFrame + props.blockSize, std::memory_order_relaxed);
+        }
+        sendBlock();
+    }
+
+    enum DATA_ID {
+        STATS,
+    };
+
+    /*md **Data ID**: */
+    uint8_t getDataId(std::string name) override
+    {
+        /*md - `STATS` return the stream statistics, see `NetAudio::Stats`: `underruns` counts the blocks missing when played, `late` the audio received after, `latencyMs` is the round trip of a block. */
+        if (name == "STATS")
+            return STATS;
+        return atoi(name.c_str());
+    }
+
+    void* data(int id, void* userdata = NULL) override
+    {
+        if (id == STATS) {
+            stats.copy(statsCopy);
+            return &statsCopy;
+        }
+        return NULL;
+    }
+};
@@ -0,0 +1,358 @@
+#pragma once
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+#include <vector>
+
+#include "audioPlugin.h"
+#include "log.h"
+#include "utils/ClockEvents.h"
+#include "utils/NetAudio.h"
+#include "utils/RemoteTrackPacket.h"
+
+/*md
+## RemoteTrackServer
+
+RemoteTrackServer plugin is used to render a track for another unit running `RemoteTrack`. It drives the audio loop
+of its unit: each block received from the other unit is rendered right away, with its notes, values, clock ticks and
+transport, and the audio of the served track is sent back. Without any block for 100ms, the unit renders on its own
+again, e.g. for its UI.
+
+The served track holds the same plugins, with the same aliases, as the ones following `RemoteTrack` on the other unit.
+To offload several tracks, mix them on the served track of this unit, or run one instance of the host per track.
+
+Both units must run at the same sample rate and block size.
+
+```json
+{ "plugin": "RemoteTrackServer", "track": 1 }
+```
+*/
+class RemoteTrackServer : public AudioPlugin {
+protected:
+    typedef RemoteTrackPacket Packet;
+
+    int fd = -1;
+    struct sockaddr_storage client = {};
+    socklen_t clientLen = 0;
+    bool hasClient = false;
+
+    uint8_t servedTrack = 0;
+    uint8_t channels = 1;
+    std::string tempoName;
+    AudioPlugin* tempo = NULL;
+    uint8_t ticksId = 0;
+    ClockEvents ticks;
+    std::vector<AudioPlugin*> mirrors;
+
+    bool synced = false;
+    uint32_t nextSequence = 0;
+    bool warnedBlockSize = false;
+
+    // Frame of the block being rendered on the other unit, when rendering one
+    bool rendering = false;
+    uint64_t remoteFrame = 0;
+    std::vector<float> block;
+    uint32_t blockFrames = 0;
+    uint16_t rtpSequence = 0;
+    uint32_t ssrc = 0;
+
+    NetAudio::AtomicStats stats;
+    NetAudio::Stats statsCopy;
+
+    void readNames(const uint8_t* data, uint32_t size)
+    {
+        std::vector<AudioPlugin*> plugins;
+        uint32_t offset = sizeof(Packet::Header);
+        while (offset < size) {
+            const char* name = (const char*)data + offset;
+            uint32_t length = strnlen(name, size - offset);
+            AudioPlugin* plugin = props.audioPluginHandler->getPluginPtr(std::string(name, length), servedTrack);
+            if (!plugin && mirrors.size() <= plugins.size()) {
+                logWarn("RemoteTrackServer: no plugin %.*s on track %d", length, name, servedTrack);
+            }
+            plugins.push_back(plugin);
+            offset += length + 1;
+        }
+        mirrors = plugins;
+    }
+
+    void applyTransport(uint8_t transport)
+    {
+        AudioPluginHandlerInterface* handler = props.audioPluginHandler;
+        if (transport == Packet::PLAYING && !handler->isPlaying()) {
+            handler->sendEvent(AudioEventType::START);
+        } else if (transport == Packet::STOPPED && !handler->isStopped()) {
+            handler->sendEvent(AudioEventType::STOP);
+        } else if (transport == 0 && handler->isPlaying()) {
+            handler->sendEvent(AudioEventType::PAUSE);
+        }
+    }
+
+    // Apply the events of a block and render it, return false once the host is stopping
+    bool renderSection(const uint8_t* data, std::function<bool()>& render)
+    {
+        Packet::Section section;
+        memcpy(&section, data, sizeof(section));
+        uint32_t offset = sizeof(section);
+        applyTransport(section.transport);
+
+        ticks.count = 0;
+        for (uint8_t i = 0; i < section.tickCount; i++) {
+            Packet::Tick tick;
+            memcpy(&tick, data + offset, sizeof(tick));
+            offset += sizeof(tick);
+            ticks.add(tick.offset, tick.clock);
+        }
+        if (tempo) {
+            tempo->data(ticksId, &ticks);
+        }
+
+        uint64_t frame = props.audioPluginHandler->getBlockFrame();
+        for (uint8_t i = 0; i < section.noteCount; i++) {
+            Packet::Note note;
+            memcpy(&note, data + offset, sizeof(note));
+            offset += sizeof(note);
+            props.audioPluginHandler->queueNote(note.on, note.note, note.velocity, { servedTrack }, frame + note.offset);
+        }
+
+        for (uint8_t i = 0; i < section.valueCount; i++) {
+            Packet::Value entry;
+            memcpy(&entry, data + offset, sizeof(entry));
+            offset += sizeof(entry);
+            AudioPlugin* mirror = entry.plugin < mirrors.size() ? mirrors[entry.plugin] : NULL;
+            ValueInterface* value = mirror ? mirror->getValue(entry.index) : NULL;
+            if (value && value->get() != entry.value) {
+                value->set(entry.value);
+            }
+        }
+
+        rendering = true;
+        remoteFrame = section.frame;
+        blockFrames = 0;
+        bool running = render();
+        rendering = false;
+        return running;
+    }
+
+    // Return false once the host is stopping
+    bool receive(const uint8_t* data, ssize_t len, std::function<bool()>& render)
+    {
+        Packet::Header header;
+        if (len < (ssize_t)sizeof(header)) {
+            return true;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != Packet::MAGIC) {
+            return true;
+        }
+        if (header.type == Packet::NAMES) {
+            readNames(data, len);
+            return true;
+        }
+
+        uint32_t offset = sizeof(header);
+        for (uint8_t s = 0; s < header.sections; s++) {
+            uint32_t size = Packet::sectionSize(data + offset, len - offset);
+            if (!size) {
+                return true;
+            }
+            Packet::Section section;
+            memcpy(&section, data + offset, sizeof(section));
+            if (section.frames != props.blockSize) {
+                if (!warnedBlockSize) {
+                    warnedBlockSize = true;
+                    logWarn("RemoteTrackServer: blocks of %d frames received, %d expected", section.frames, props.blockSize);
+                }
+                return true;
+            }
+            int32_t gap = section.sequence - nextSequence;
+            if (!synced || gap >= 0) {
+                if (synced && gap > 0) {
+                    stats.lost.fetch_add(gap, std::memory_order_relaxed);
+                }
+                synced = true;
+                nextSequence = section.sequence + 1;
+                stats.packets.fetch_add(1, std::memory_order_relaxed);
+                if (!renderSection(data + offset, render)) {
+                    return false;
+                }
+            } else if (s == header.sections - 1) {
+                stats.late.fetch_add(1, std::memory_order_relaxed);
+            }
+            offset += size;
+        }
+        return true;
+    }
+
+    void sendBlock()
+    {
+        uint8_t packet[NetAudio::HEADER_SIZE + NetAudio::MAX_PAYLOAD];
+        NetAudio::Header* header = (NetAudio::Header*)packet;
+        header->flags = 0x80;
+        header->payloadType = NetAudio::payloadType(NetAudio::FLOAT32, channels);
+        header->ssrc = htonl(ssrc);
+        uint32_t packetFrames = NetAudio::MAX_PAYLOAD / (channels * sizeof(float));
+        for (uint32_t start = 0; start < props.blockSize; start += packetFrames) {
+            uint32_t count = std::min(packetFrames, props.blockSize - start);
+            header->sequence = htons(rtpSequence++);
+            header->timestamp = htonl((uint32_t)(remoteFrame + start));
+            NetAudio::encode(NetAudio::FLOAT32, block.data() + start * channels, count * channels, packet + NetAudio::HEADER_SIZE);
+            if (sendto(fd, packet, NetAudio::HEADER_SIZE + count * channels * sizeof(float), 0, (struct sockaddr*)&client, clientLen) < 0) {
+                stats.dropped.fetch_add(count, std::memory_order_relaxed);
+            }
+        }
+    }
+
+public:
+    RemoteTrackServer(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : AudioPlugin(props, config)
+    {
+        auto& json = config.json;
+        /*md - `port` is the UDP port `RemoteTrack` sends its blocks to. Default is 5010. */
+        uint16_t port = json.value("port", Packet::DEFAULT_PORT);
+        /*md - `track` is the track rendered for the other unit. Default is 1. */
+        servedTrack = json.value("track", 1);
+        /*md - `channels` is 1 or 2. Default is 2 when the host buffer is stereo. */
+        channels = json.value("channels", hasStereoBuffer() ? 2 : 1) == 2 ? 2 : 1;
+        /*md - `tempo` is the alias of the Tempo plugin following the clock of the other unit. Default is `Tempo`. */
+        tempoName = json.value("tempo", "Tempo");
+        block.resize(props.blockSize * channels);
+        ssrc = rand();
+
+        fd = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+        if (fd < 0) {
+            logError("RemoteTrackServer: socket failed: %s", strerror(errno));
+            return;
+        }
+        struct sockaddr_in address = {};
+        address.sin_family = AF_INET;
+        address.sin_addr.s_addr = htonl(INADDR_ANY);
+        address.sin_port = htons(port);
+        if (bind(fd, (struct sockaddr*)&address, sizeof(address)) < 0) {
+            logError("RemoteTrackServer: cannot bind port %d: %s", port, strerror(errno));
+            close(fd);
+            fd = -1;
+            return;
+        }
+        // Low latency traffic, see DSCP EF
+        int tos = 0xb8;
+        setsockopt(fd, IPPROTO_IP, IP_TOS, &tos, sizeof(tos));
+        logInfo("RemoteTrackServer: rendering track %d for port %d", servedTrack, port);
+    }
+
+    ~RemoteTrackServer()
+    {
+        if (fd >= 0) {
+            close(fd);
+        }
+    }
+
+    std::set<uint8_t> trackDependencies() override
+    {
+        return { servedTrack };
+    }
+
+    bool drivesAudioLoop() override
+    {
+        return fd >= 0;
+    }
+
+    void runAudioLoop(std::function<bool()> render) override
+    {
+        tempo = props.audioPluginHandler->getPluginPtr(tempoName);
+        if (tempo) {
+            ticksId = tempo->getDataId("REMOTE_TICKS");
+        } else {
+            logWarn("RemoteTrackServer: no plugin %s, the clock of the other unit is not followed", tempoName.c_str());
+        }
+
+        uint8_t packet[2048];
+        struct pollfd pfd = { fd, POLLIN, 0 };
+        while (true) {
+            int ready = poll(&pfd, 1, 100);
+            if (ready < 0 && errno != EINTR) {
+                logError("RemoteTrackServer: poll failed: %s", strerror(errno));
+                return;
+            }
+            if (ready <= 0) {
+                // No block from the other unit, render on our own
+                if (!render()) {
+                    return;
+                }
+                continue;
+            }
+            struct sockaddr_storage from;
+            socklen_t fromLen = sizeof(from);
+            ssize_t len;
+            while ((len = recvfrom(fd, packet, sizeof(packet), MSG_DONTWAIT, (struct sockaddr*)&from, &fromLen)) > 0) {
+                if (!hasClient || fromLen != clientLen || memcmp(&from, &client, fromLen)) {
+                    // New client, or the same one restarted on another port
+                    hasClient = true;
+                    memcpy(&client, &from, fromLen);
+                    clientLen = fromLen;
+                    synced = false;
+                    mirrors.clear();
+                    logInfo("RemoteTrackServer: rendering track %d for a new client", servedTrack);
+                }
+                if (!receive(packet, len, render)) {
+                    return;
+                }
+                fromLen = sizeof(from);
+            }
+        }
+    }
+
+    bool isStereo() override
+    {
+        return channels == 2 && hasStereoBuffer();
+    }
+
+    void sample(float* buf) override
+    {
+        sampleBlock(buf, 1);
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (!rendering) {
+            return;
+        }
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, servedTrack);
+        float* right = rightLane(buf, servedTrack);
+        uint32_t count = std::min(frames, props.blockSize - blockFrames);
+        for (uint32_t f = 0; f < count; f++) {
+            block[(blockFrames + f) * channels] = lane[f * stride];
+            if (channels == 2) {
+                block[(blockFrames + f) * 2 + 1] = right[f * stride];
+            }
+        }
+        blockFrames += count;
+        if (blockFrames == props.blockSize) {
+            sendBlock();
+        }
+    }
+
+    enum DATA_ID {
+        STATS,
+    };
+
+    /*md **Data ID**: */
+    uint8_t getDataId(std::string name) override
+    {
+        /*md - `STATS` return the statistics of the blocks received, see `NetAudio::Stats`. */
+        if (name == "STATS")
+            return STATS;
+        return atoi(name.c_str());
+    }
+
+    void* data(int id, void* userdata = NULL) override
+    {
+        if (id == STATS) {
+            stats.copy(statsCopy);
+            return &statsCopy;
+        }
+        return NULL;
+    }
+};
@@ -0,0 +1,188 @@
+#pragma once
+
+#include <atomic>
+#include <string>
+
+#include "audio/fileBrowser.h"
+#include "audioPlugin.h"
+#include "host/constants.h"
+#include "mapping.h"
+#include "plugins/audio/utils/SampleIndex.h"
+#include "plugins/audio/utils/SampleStreamer.h"
+
+/*md
+## SamplePreview
+
+SamplePreview plugin auditions the samples while browsing them, without loading them in a sample plugin. The
+highlighted file is streamed from the disk (see `SampleStreamer`), only a few milliseconds of it being read before
+it starts, and played once on the track of the plugin, added to what the plugins before it rendered. The sample
+loaded by the other plugins, e.g. SynthSample, is never touched, until the previewed one is loaded on purpose with
+`LOAD`.
+
+Scrolling quickly through the files only reads the last one highlighted: a file not opened yet is replaced by the
+next one, and the one being played stops as soon as the next one is ready.
+
+```json
+{ "id": 8, "plugins": [
+    { "plugin": "SamplePreview", "target": "SynthSample", "targetTrack": 1 }
+] }
+```
+*/
+class SamplePreview : public Mapping {
+protected:
+    FileBrowser fileBrowser = SampleIndex::get().browser(AUDIO_FOLDER + "/samples");
+    SampleStreamer::Stream stream;
+
+    std::string targetName;
+    int16_t targetTrack = -1;
+    AudioPlugin* target = NULL;
+
+    bool playing = false;
+    // Gain at the end of the last block, ramping to the volume or to 0, so starting and stopping doesn't click
+    float gain = 0.0f;
+    std::atomic<bool> stopRequest = false;
+
+    void preview(uint16_t position)
+    {
+        if (position == 0) {
+            stream.open("");
+            stopRequest = true;
+            return;
+        }
+        stream.open(fileBrowser.getFilePath(position));
+    }
+
+    void stop()
+    {
+        file.set(0.0f);
+    }
+
+    // Next frame of the preview, stopping once the file is played
+    float previewFrame()
+    {
+        float out = stream.next();
+        if (stream.ended()) {
+            playing = false;
+        }
+        return out;
+    }
+
+    // Take the file opened last, or the stop, at the start of the block
+    void swapPreview()
+    {
+        if (stopRequest.exchange(false)) {
+            playing = false;
+        }
+        if (stream.swap() && stream.frames()) {
+            stream.play(0, 0, stream.frames(), false);
+            playing = true;
+        }
+    }
+
+public:
+    /*md **Values**: */
+    /*md - `FILE` the file to preview, starting to play it once highlighted. `Off` stops the preview. */
+    Val& file = val(0.0f, "FILE", { "Preview", VALUE_STRING, .min = 0.0f, .max = (float)fileBrowser.count }, [&](auto p) {
+        p.val.setFloat(p.value);
+        uint16_t position = p.val.get();
+        p.val.setString(position ? fileBrowser.getFile(position) : "Off");
+        preview(position);
+    });
+
+    /*md - `VOLUME` set the volume of the preview. */
+    Val& volume = val(80.0f, "VOLUME", { "Volume", .unit = "%" });
+
+    SamplePreview(AudioPlugin::Props& props, AudioPlugin::Config& config)
+        : Mapping(props, config)
+        , stream(props.sampleRate, 50)
+    {
+        auto& json = config.json;
+        //md **Config**:
+        //md - `"samplesFolder": "samples"` set the folder of the files to preview.
+        if (json.contains("samplesFolder")) {
+            fileBrowser = SampleIndex::get().browser(json["samplesFolder"].get<std::string>());
+            file.props().max = fileBrowser.count;
+        }
+        //md - `"headMs": 50` set the milliseconds of each file read before playing it. Default is 50.
+        stream.setHeadMs(json.value("headMs", 50));
+        //md - `"target": "SynthSample"` set the plugin loading the previewed file with `LOAD`, its `BROWSER` value being set to it. It must browse the same folder.
+        targetName = json.value("target", "");
+        //md - `"targetTrack": 1` set the track of the target plugin. Default is the track of the preview.
+        targetTrack = json.value("targetTrack", (int16_t)track);
+        initValues();
+    }
+
+    void hydrateJson(nlohmann::json& json) override
+    {
+        // Restoring a project doesn't start a preview
+        setHydratedValue(json, "FILE", 0.0f);
+        Mapping::hydrateJson(json);
+    }
+
+    void sample(float* buf) override
+    {
+        swapPreview();
+        float level = playing ? volume.pct() : 0.0f;
+        if (gain == 0.0f && level == 0.0f) {
+            return;
+        }
+        gain = level;
+        buf[track] += previewFrame() * gain;
+    }
+
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        swapPreview();
+        float start = gain;
+        gain = playing ? volume.pct() : 0.0f;
+        if (start == 0.0f && gain == 0.0f) {
+            return;
+        }
+        float step = (gain - start) / frames;
+        float g = start;
+        float* out = trackLane(buf, track);
+        for (uint32_t f = 0; f < frames; f++) {
+            g += step;
+            out[f * props.frameStride] += previewFrame() * g;
+        }
+    }
+
+    enum DATA_ID {
+        LOAD,
+        STOP,
+    };
+
+    /*md **Data ID**: */
+    uint8_t getDataId(std::string name) override
+    {
+        /*md - `LOAD` load the previewed file in the target plugin and stop the preview */
+        if (name == "LOAD")
+            return DATA_ID::LOAD;
+        /*md - `STOP` stop the preview */
+        if (name == "STOP")
+            return DATA_ID::STOP;
+        return atoi(name.c_str());
+    }
+
+    void* data(int id, void* userdata = NULL)
+    {
+        switch (id) {
+        case DATA_ID::LOAD: {
+            uint16_t position = file.get();
+            if (!target && !targetName.empty()) {
+                target = props.audioPluginHandler->getPluginPtr(targetName, targetTrack);
+            }
+            ValueInterface* browser = target ? target->getValue("BROWSER") : NULL;
+            if (position && browser) {
+                browser->set(position);
+            }
+            stop();
+            return NULL;
+        }
+        case DATA_ID::STOP:
+            stop();
+            return NULL;
+        }
+        return NULL;
+    }
+};
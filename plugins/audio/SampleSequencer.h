@@ -9,13 +9,17 @@ Users can finely control the behavior of the sequence:
 3.  **Operation Status:** The sequencer can be configured to be actively playing, muted, or set to start playback only upon the next sequence loop, allowing for synchronized transitions.
 4.  **Persistence:** All settings, including the status and individual parameters for every rhythmic step, can be saved and restored, ensuring that complex patterns are remembered between user sessions.
 
+The samples of the steps are decoded in the background through the shared sample pool, each step switching to its new sample on the audio thread once ready. The samples of a clip coming next are prefetched while it is preloaded, so switching to it takes them right away.
+
 sha: bccf10b0130e45570bc4f7bba6195e6e78ed36e8d2c26bc3cb7160884a8210d6 
 */
 #pragma once
 
 #include <limits>
-#include <sndfile.h>
+#include <memory>
+#include <mutex>
 #include <string>
+#include <vector>
 
 #include "Tempo.h"
 #include "audioPlugin.h"
@@ -25,12 +29,30 @@ sha: bccf10b0130e45570bc4f7bba6195e6e78ed36e8d2c26bc3cb7160884a8210d6
 #include "plugins/audio/SampleStep.h"
 #include "stepInterface.h"
 #include "audio/fileBrowser.h"
+#include "plugins/audio/utils/SampleIndex.h"
+#include "plugins/audio/utils/SampleLoader.h"
 
 class SampleSequencer : public Mapping, public UseClock {
 protected:
     AudioPlugin::Props& props;
 
     SampleStep steps[DEFAULT_MAX_STEPS];
+    std::unique_ptr<SampleLoader::Slot> stepSlots[DEFAULT_MAX_STEPS];
+
+    // Samples of the clip coming next, decoded while it is preloaded and held until the next one, by file
+    std::mutex prefetchMtx;
+    std::vector<std::pair<std::string, SamplePool::Ref>> prefetched;
+
+    SamplePool::Ref prefetchedBuffer(const std::string& filename)
+    {
+        std::lock_guard<std::mutex> guard(prefetchMtx);
+        for (auto& buffer : prefetched) {
+            if (buffer.first == filename) {
+                return buffer.second;
+            }
+        }
+        return NULL;
+    }
     SampleStep* activeStep = NULL;
     SampleStep* selectedStepPtr = &steps[0];
 
@@ -41,7 +63,7 @@ protected:
 
     AudioPlugin* targetPlugin = NULL;
 
-    FileBrowser fileBrowser = FileBrowser("./samples");
+    FileBrowser fileBrowser = SampleIndex::get().browser("./samples");
 
     enum Status {
         MUTED = 0,
@@ -51,6 +73,11 @@ protected:
 
     void onStep() override
     {
+        // The samples loaded meanwhile
+        for (auto& step : steps) {
+            step.swap();
+        }
+
         stepCounter++;
         uint8_t state = status.get();
         // If we reach the end of the sequence, we reset the step counter
@@ -66,7 +93,7 @@ protected:
         }
         if (state == Status::ON) {
             SampleStep* step = &steps[stepCounter];
-            if (step->file && step->enabled && step->velocity > 0.0f) {
+            if (step->buffer && step->enabled && step->velocity > 0.0f) {
                 setActiveStep(step);
             }
         }
@@ -107,13 +134,13 @@ public:
         int position = p.val.get();
         if (position == 0) {
             p.val.setString("---");
-            selectedStepPtr->setFilename("---", props.channels);
+            selectedStepPtr->setFilename("---", props.sampleRate);
         } else {
             p.val.setString(fileBrowser.getFile(position));
             std::string filepath = fileBrowser.getFilePath(position);
 
-            if (filepath != selectedStepPtr->filename || selectedStepPtr->file == NULL) {
-                selectedStepPtr->setFilename(filepath, props.channels);
+            if (filepath != selectedStepPtr->filename || selectedStepPtr->buffer == NULL) {
+                selectedStepPtr->setFilename(filepath, props.sampleRate);
             }
         }
     });
@@ -150,6 +177,12 @@ public:
     {
         initValues();
 
+        for (uint8_t i = 0; i < DEFAULT_MAX_STEPS; i++) {
+            // Not normalized, the steps play the files as they are
+            stepSlots[i] = std::make_unique<SampleLoader::Slot>(props.sampleRate, SampleStep::MAX_SAMPLES, false);
+            steps[i].slot = stepSlots[i].get();
+        }
+
         if (config.json.contains("target")) {
             targetPlugin = &props.audioPluginHandler->getPlugin(config.json["target"].get<std::string>(), track);
         }
@@ -183,26 +216,18 @@ public:
         }
     }
 
-#define CHUNK_SIZE 256
-    float sampleIndex = 0.0f;
-    float chunkBuffer[CHUNK_SIZE];
-    size_t chunkPosition = CHUNK_SIZE; // Start at CHUNK_SIZE to trigger initial load
+    uint64_t sampleIndex = 0;
+    bool followsClock() override
+    {
+        return true;
+    }
+
     void sample(float* buf) override
     {
         UseClock::sample(buf);
-        if (activeStep && activeStep->file && sampleIndex < activeStep->end) {
-            if (chunkPosition >= CHUNK_SIZE) {
-                sf_seek(activeStep->file, (int)sampleIndex, SEEK_SET);
-                size_t samplesRead = sf_read_float(activeStep->file, chunkBuffer, CHUNK_SIZE);
-
-                for (size_t i = samplesRead; i < CHUNK_SIZE; i++) {
-                    chunkBuffer[i] = 0.0f;
-                }
-                chunkPosition = 0;
-            }
-            buf[track] = chunkBuffer[chunkPosition];
-            chunkPosition++;
-            sampleIndex += activeStep->stepIncrement;
+        if (activeStep && activeStep->buffer && sampleIndex < activeStep->end) {
+            buf[track] = activeStep->get(sampleIndex);
+            sampleIndex++;
         }
     }
 
@@ -224,9 +249,31 @@ public:
         }
         if (json.contains("STEPS")) {
             for (size_t i = 0; i < json["STEPS"].size() && i < DEFAULT_MAX_STEPS; i++) {
-                steps[i].hydrate(json["STEPS"][i], props.channels);
+                std::string value = json["STEPS"][i];
+                steps[i].hydrate(value, props.sampleRate, prefetchedBuffer(SampleStep::filenameOf(value)));
+            }
+        }
+    }
+
+    void prefetchState(ClipState::Plugin& state) override
+    {
+        if (!state.extra.contains("STEPS")) {
+            return;
+        }
+        std::vector<std::pair<std::string, SamplePool::Ref>> buffers;
+        for (auto& value : state.extra["STEPS"]) {
+            std::string filename = value.is_string() ? SampleStep::filenameOf(value.get<std::string>()) : "---";
+            bool known = filename == "---" || std::any_of(buffers.begin(), buffers.end(), [&](auto& buffer) { return buffer.first == filename; });
+            if (!known) {
+                SamplePool::Ref buffer = SamplePool::get().acquire(filename, props.sampleRate, SampleStep::MAX_SAMPLES, false);
+                if (buffer) {
+                    buffers.push_back({ filename, buffer });
+                }
             }
         }
+        // The previous ones are released outside of the lock
+        std::lock_guard<std::mutex> guard(prefetchMtx);
+        std::swap(prefetched, buffers);
     }
 
     DataFn dataFunctions[4] = {
@@ -238,14 +285,14 @@ public:
              uint8_t* index = (uint8_t*)userdata;
              SampleStep* step = &steps[*index >= DEFAULT_MAX_STEPS ? 0 : *index];
              uint16_t pos = fileBrowser.next(step->filename);
-             step->setFilename(fileBrowser.getFilePath(pos), props.channels);
+             step->setFilename(fileBrowser.getFilePath(pos), props.sampleRate);
              return (void*)NULL;
          } },
         { "PREVIOUS_FILE", [this](void* userdata) {
              uint8_t* index = (uint8_t*)userdata;
              SampleStep* step = &steps[*index >= DEFAULT_MAX_STEPS ? 0 : *index];
              uint16_t pos = fileBrowser.next(step->filename, -1);
-             step->setFilename(fileBrowser.getFilePath(pos), props.channels);
+             step->setFilename(fileBrowser.getFilePath(pos), props.sampleRate);
              return (void*)NULL;
          } },
         { "PLAY_STEP", [this](void* userdata) {
@@ -6,7 +6,7 @@ This code defines a core structure named `SampleStep`, acting as a blueprint for
 The `SampleStep` class stores crucial information about the sound event:
 1.  **Control:** A simple toggle (`enabled`) determines if the step is active.
 2.  **Playback Volume:** The `velocity` setting controls the loudness, ensuring it stays within a valid range (0.0 to 1.0).
-3.  **Source:** It tracks the path to the actual audio file (`filename`) and maintains a connection (`file`) to the sound library for reading the data.
+3.  **Source:** It tracks the path to the actual audio file (`filename`) and holds its decoded audio (`buffer`), shared through the sample pool with any other step or plugin using the same file.
 4.  **Timing:** It defines which portion of the sound file to play, specifying the `start` and `end` points. These points are tracked both as percentages (for user settings) and as precise sample counts (for internal playback).
 
 ### Core Functionality
@@ -14,7 +14,7 @@ The `SampleStep` class stores crucial information about the sound event:
 The class includes several protective functions to maintain integrity:
 
 *   **Input Validation:** Functions like `setVelocity`, `setStart`, and `setEnd` automatically limit the input values to sensible boundaries. For example, the start point cannot be after the end point.
-*   **File Loading (`setFilename`):** This is the key action. When a filename is provided, the step opens the audio file, reads its properties (like total length), and calculates how it should be played back. It also adjusts an internal increment value if the sound file has more or fewer audio channels than the system expects, ensuring smooth integration.
+*   **File Loading (`setFilename`):** This is the key action. When a filename is provided, the step gets the file from the sample pool, decoded and converted to the engine rate the first time only, and computes its length. Given a loader slot, the file is decoded in the background instead, or taken right away when it was prefetched, and the audio thread switches to it with `swap`. Playback reads its first channel.
 *   **Saving and Loading State:** The step can convert all its settings (velocity, enabled status, timing, and filename) into a single text string (`serialize`). This string can then be read back later (`hydrate`) to completely restore the step’s configuration, essential for saving and loading projects.
 
 sha: 5d877d5919ec30a0affd80f00dea8e62fdd91889a7b8f942c551bb85bbca6821 
@@ -23,15 +23,19 @@ sha: 5d877d5919ec30a0affd80f00dea8e62fdd91889a7b8f942c551bb85bbca6821
 
 #include <cstdint>
 #include <string>
-#include <sndfile.h>
 #include <string.h>
 
 #include "helpers/clamp.h"
 #include "helpers/format.h"
 #include "log.h"
+#include "plugins/audio/utils/SampleLoader.h"
+#include "plugins/audio/utils/SamplePool.h"
 
 class SampleStep {
 public:
+    // 30sec at 48000Hz in stereo
+    static const uint64_t MAX_SAMPLES = 48000 * 30 * 2;
+
     bool enabled = false;
     float velocity = 0.8f;
     uint64_t sampleCount = 0;
@@ -40,8 +44,10 @@ public:
     uint64_t start = 0;
     float fStart = 0.0f;
     std::string filename = "---";
-    SNDFILE* file = NULL;
-    float stepIncrement = 1.0f;
+    // Shared with the other steps and plugins using the same file
+    SamplePool::Ref buffer;
+    // When set, the files are loaded in the background and `buffer` is only changed by `swap()`, on the audio thread
+    SampleLoader::Slot* slot = NULL;
 
     void setVelocity(float velocity)
     {
@@ -61,36 +67,56 @@ public:
         start = fStart * sampleCount;
     }
 
-    void setFilename(std::string filename, uint8_t channels)
+    void setBuffer(SamplePool::Ref value)
+    {
+        buffer = value;
+        sampleCount = buffer ? buffer->count / buffer->channels : 0;
+        setStart(fStart);
+        setEnd(fEnd);
+    }
+
+    // `prefetched` is the buffer of the file if it was decoded beforehand
+    void setFilename(std::string filename, float sampleRate, SamplePool::Ref prefetched = NULL)
     {
-        // Let's keep it easy for the moment each step has his own instance of SNDFILE
-        // We gonna try to optimize later only if necessary by reusing the same SNDFILE
-        if (file != NULL) {
-            sf_close(file);
-            file = NULL;
-        }
         this->filename = filename;
+        if (slot) {
+            if (filename == "---" || prefetched) {
+                slot->set(prefetched);
+            } else {
+                // Not normalized, the steps play the file as it is
+                slot->load(filename);
+            }
+            return;
+        }
+        buffer = NULL;
         if (filename != "---") {
-            SF_INFO sfinfo;
-            // printf("Load filename %s\n", filename.c_str());
-            file = sf_open(filename.c_str(), SFM_READ, &sfinfo);
-            if (file) {
-                sampleCount = sfinfo.frames;
-                if (sfinfo.channels < channels) {
-                    stepIncrement = 0.5f;
-                } else if (sfinfo.channels > channels) {
-                    stepIncrement = 2.0f;
-                } else {
-                    stepIncrement = 1.0f;
-                }
+            // Not normalized, the steps play the file as it is
+            buffer = SamplePool::get().acquire(filename, sampleRate, MAX_SAMPLES, false);
+            if (buffer) {
+                sampleCount = buffer->count / buffer->channels;
                 setStart(fStart);
                 setEnd(fEnd);
             } else {
-                logWarn("SampleSequencer: Could not open step file %s [%s]", filename.c_str(), sf_strerror(file));
+                logWarn("SampleSequencer: Could not open step file %s", filename.c_str());
             }
         }
     }
 
+    // Switch to the file loaded in the background, if any. Audio thread only.
+    void swap()
+    {
+        if (slot && slot->swap()) {
+            SampleLoader::Sample* loaded = slot->get();
+            setBuffer(loaded ? loaded->buffer : NULL);
+        }
+    }
+
+    // Sample of the first channel at `frame`
+    float get(uint64_t frame)
+    {
+        return buffer->samples[frame * buffer->channels];
+    }
+
     // need to be changed to JSON!!
     std::string serialize()
     {
@@ -101,14 +127,28 @@ public:
             + filename;
     }
 
+    // File of a serialized step
+    static std::string filenameOf(std::string value)
+    {
+        size_t pos = 0;
+        for (int field = 0; field < 4 && pos != std::string::npos; field++) {
+            pos = value.find(' ', value.find_first_not_of(' ', pos));
+        }
+        if (pos == std::string::npos || value.find_first_not_of(' ', pos) == std::string::npos) {
+            return "---";
+        }
+        pos = value.find_first_not_of(' ', pos);
+        return value.substr(pos, value.find(' ', pos) - pos);
+    }
+
     // need to be changed to JSON!!
-    void hydrate(std::string value, uint8_t channels)
+    void hydrate(std::string value, float sampleRate, SamplePool::Ref prefetched = NULL)
     {
         // printf("hydrate %s\n", value.c_str());
         enabled = strtok((char*)value.c_str(), " ")[0] == '1';
         velocity = atof(strtok(NULL, " "));
         fStart = atof(strtok(NULL, " "));
         fEnd = atof(strtok(NULL, " "));
-        setFilename(strtok(NULL, " "), channels);
+        setFilename(strtok(NULL, " "), sampleRate, prefetched);
     }
 };
@@ -7,7 +7,11 @@ The Sequencer operates like a highly customizable, tempo-synced drum machine. It
 **Timing and Conditions:**
 The sequence can run up to 32 steps (or more, depending on configuration). For each step, the user can define a note, its intensity (velocity), and how long it lasts. Crucially, each step also has a **trigger condition** that determines if it actually plays. These conditions go beyond simple playback, including:
 1.  **Rhythmic Patterns:** Playing only on odd steps, every fourth step, or every eighth step.
-2.  **Probability:** Introducing controlled randomness, such as a 5%, 50%, or 99% chance of the note being triggered.
+2.  **Probability:** Introducing controlled randomness, such as a 5%, 50%, or 99% chance of the note being triggered. Each sequencer draws its own seeded random numbers, once per loop for the conditions, so a pattern plays the same each time from the start.
+
+The steps are indexed by position, so each step of the clock only looks at the steps starting on it and the notes being played, however long and dense the pattern is.
+
+**Swing and Micro Timing:** A global swing delays every second step, and each step can be played up to half a step early or late. Such steps are scheduled a step ahead, at their exact frame measured from the clock ticks, and handed over to the track which plays them at that frame within the block.
 
 **Key Controls and Features:**
 *   **Detune:** A control to globally shift the pitch of all playing notes.
@@ -22,17 +26,20 @@ sha: acf6be1fba5ded7c3bf3eaa94d22d0ad0d13635ac50eb2d80ee0ca74452157c1
 #pragma once
 
 #include <algorithm>
+#include <atomic>
+#include <ctime>
 #include <map>
 #include <string>
-#include <unordered_map>
 #include <vector>
 
 #include "Tempo.h"
 #include "audioPlugin.h"
 #include "helpers/midiNote.h"
+#include "helpers/pluginEvents.h"
 #include "log.h"
 #include "mapping.h"
 #include "stepInterface.h"
+#include "utils/CowArray.h"
 
 /*md
 ## Sequencer
@@ -68,11 +75,239 @@ protected:
 
     uint16_t stepCount = DEFAULT_MAX_STEPS;
     std::vector<Step> steps;
-    std::vector<Step> stepsPreview;
-    std::vector<Step>* playingSteps = &steps;
+    // Double buffered, a preview is built in the one not playing, then published by swapping `playingSteps`
+    std::vector<Step> stepsPreview[2];
+    std::atomic<std::vector<Step>*> playingSteps = &steps;
+
+    // Steps as of the end of the last block they changed, read by serializeJson. Memory is reserved
+    // for the common patterns, so publishing them does not allocate on the audio thread.
+    static const uint16_t SNAPSHOT_STEPS = 512;
+    StateSnapshot<std::vector<Step>> stepsSnapshot;
+    std::vector<Step> publishedSteps;
+    uint32_t stepsVersion = 0;
+
+    // Steps restored by the undo history, swapped with `steps` by the next block when `restoring` is set
+    std::vector<Step> restoredSteps;
+    std::atomic<bool> restoring = false;
+
+    bool stepsChanged()
+    {
+        std::vector<Step>& list = *playingSteps;
+        if (list.size() != publishedSteps.size()) {
+            return true;
+        }
+        for (int i = 0; i < publishedSteps.size(); i++) {
+            if (!list[i].equal(publishedSteps[i])) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Steps by position, as an offset table: the steps starting at `position` are the indexes in `*playingSteps`
+    // from `stepsByPosition[stepsAt[position]]` to `stepsByPosition[stepsAt[position + 1]]`, so a step tick only
+    // looks at the steps starting on it. Rebuilt once the steps changed, without allocating for the common patterns.
+    std::vector<uint16_t> stepsAt;
+    std::vector<uint16_t> stepsByPosition;
+    std::atomic<bool> stepsIndexDirty = true;
+
+    void indexSteps()
+    {
+        stepsIndexDirty = false;
+        std::vector<Step>& list = *playingSteps;
+        uint16_t positions = 0;
+        for (auto& step : list) {
+            if (step.enabled && step.len) {
+                positions = std::max(positions, (uint16_t)(step.position + 1));
+            }
+        }
+        stepsAt.assign(positions + 1, 0);
+        for (auto& step : list) {
+            if (step.enabled && step.len) {
+                stepsAt[step.position + 1]++;
+            }
+        }
+        for (uint16_t p = 0; p < positions; p++) {
+            stepsAt[p + 1] += stepsAt[p];
+        }
+        stepsByPosition.resize(stepsAt[positions]);
+        // Each start moves to the next position as its steps are placed, then they are shifted back
+        for (uint16_t i = 0; i < list.size(); i++) {
+            if (list[i].enabled && list[i].len) {
+                stepsByPosition[stepsAt[list[i].position]++] = i;
+            }
+        }
+        for (uint16_t p = positions; p > 0; p--) {
+            stepsAt[p] = stepsAt[p - 1];
+        }
+        stepsAt[0] = 0;
+        rolledLoop = -1;
+    }
+
+    // Own random numbers, so a track never shares them with the other track threads, seeded again on stop for the
+    // probabilities and random motions to play the same each time from the start, e.g. when rendering offline
+    StepRandom random;
+    uint32_t randomSeed = 0;
+
+    // Whether the condition of each step of `*playingSteps` is met in the loop `rolledLoop`, drawn once per loop
+    std::vector<uint64_t> conditionBits;
+    int32_t rolledLoop = -1;
+
+    void rollConditions()
+    {
+        rolledLoop = loopCounter;
+        std::vector<Step>& list = *playingSteps;
+        conditionBits.assign((list.size() + 63) / 64, 0);
+        for (uint16_t i = 0; i < list.size(); i++) {
+            if (list[i].enabled && list[i].len && stepConditions[list[i].condition].conditionMet(loopCounter, random)) {
+                conditionBits[i / 64] |= (uint64_t)1 << (i % 64);
+            }
+        }
+    }
+
+    // Steps whose note is on, with the note sent, so the note off matches even if the step was edited meanwhile.
+    // A step played off the tick, by `offset` frames, is followed until its note off is scheduled.
+    struct PlayingStep {
+        uint16_t index;
+        uint8_t note;
+        uint16_t remaining;
+        int32_t offset;
+    };
+    std::vector<PlayingStep> playingNotes;
+
+    // Notes played off the tick (swing and micro timing), sorted by frame. Each block, the ones due in the next
+    // block are handed over to the track, which plays them at their frame.
+    struct ScheduledNote {
+        uint64_t frame;
+        uint8_t note;
+        float velocity;
+        bool on;
+        bool queued;
+        // Locks of the step of a note on, applied as it is queued
+        uint8_t lockCount;
+        ParamLock locks[Step::MAX_LOCKS];
+    };
+    std::vector<ScheduledNote> scheduledNotes;
+
+    // Position whose steps off the tick were already scheduled, on the step before it
+    int32_t scheduledPosition = -1;
+    uint16_t scheduledLoop = 0;
+
+    // MIDI channel, from 0, of the notes also sent on the MIDI output, -1 for none
+    int8_t midiOutChannel = -1;
+
+    void sendMidiNote(bool on, uint8_t note, float velocity, uint64_t frame)
+    {
+        if (midiOutChannel >= 0) {
+            uint8_t message[3] = { (uint8_t)((on ? 0x90 : 0x80) | midiOutChannel), note, (uint8_t)(on ? std::max(1.0f, velocity * 127.0f) : 0) };
+            props.audioPluginHandler->sendMidi(message, 3, frame);
+        }
+    }
+
+    void scheduleNote(uint64_t frame, uint8_t note, float velocity, bool on, Step* step = NULL)
+    {
+        auto it = std::upper_bound(scheduledNotes.begin(), scheduledNotes.end(), frame,
+            [](uint64_t frame, const ScheduledNote& scheduled) { return frame < scheduled.frame; });
+        ScheduledNote scheduled = { frame, note, velocity, on, false, 0 };
+        if (step) {
+            scheduled.lockCount = step->lockCount;
+            std::copy(step->locks, step->locks + step->lockCount, scheduled.locks);
+        }
+        scheduledNotes.insert(it, scheduled);
+    }
+
+    // Parameters locked by the steps, added the first time their key is used and never removed: the steps only keep
+    // the index of the parameter, its value being resolved once here, so playing a step costs a pointer per lock,
+    // without looking up any key nor allocating. Written by the UI or the hydration, read by the audio thread up to
+    // `lockParamCount`, set once the parameter is complete.
+    static const uint8_t MAX_LOCK_PARAMS = 64;
+    struct LockParam {
+        std::string key;
+        ValueInterface* value;
+    };
+    LockParam lockParams[MAX_LOCK_PARAMS];
+    std::atomic<uint8_t> lockParamCount = 0;
+    // A bit per parameter: locked by the last steps played, and by the steps of the position being played
+    uint64_t lockedParams = 0;
+    uint64_t positionLocks = 0;
+
+    ValueInterface* findLockValue(std::string key)
+    {
+        if (targetPlugin) {
+            return targetPlugin->getValue(key);
+        }
+        // Without target, the first plugin of the track having the value, after the sequencer
+        bool after = false;
+        for (AudioPlugin* plugin : props.audioPluginHandler->plugins) {
+            if (plugin == this) {
+                after = true;
+            } else if (after && plugin->track == track && plugin->getValueIndex(key) >= 0) {
+                return plugin->getValue(key);
+            }
+        }
+        return NULL;
+    }
+
+    // Locks of a step starting to play, on the thread of the track, the sequenced plugin being processed after it
+    void applyLocks(const ParamLock* locks, uint8_t count)
+    {
+        uint8_t params = lockParamCount.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < count; i++) {
+            if (locks[i].param < params) {
+                lockParams[locks[i].param].value->lock(locks[i].value);
+                positionLocks |= 1ull << locks[i].param;
+            }
+        }
+    }
+
+    // Once the steps of a position are played, the parameters they don't lock are back to their value
+    void releaseLocks()
+    {
+        uint64_t released = lockedParams & ~positionLocks;
+        for (uint8_t p = 0; released; p++, released >>= 1) {
+            if (released & 1) {
+                lockParams[p].value->unlock();
+            }
+        }
+        lockedParams = positionLocks;
+        positionLocks = 0;
+    }
+
+    void queueScheduledNotes()
+    {
+        // The notes queued in the previous block were played at the start of this block
+        scheduledNotes.erase(std::remove_if(scheduledNotes.begin(), scheduledNotes.end(), [](ScheduledNote& scheduled) { return scheduled.queued; }),
+            scheduledNotes.end());
+        uint64_t nextBlockEnd = props.audioPluginHandler->getBlockFrame() + 2 * props.blockSize;
+        for (auto& scheduled : scheduledNotes) {
+            if (scheduled.frame >= nextBlockEnd) {
+                break;
+            }
+            // The locks are applied from the next block, the one of the note, a few frames before it
+            if (scheduled.on && scheduled.lockCount) {
+                applyLocks(scheduled.locks, scheduled.lockCount);
+                releaseLocks();
+            }
+            props.audioPluginHandler->queueNote(scheduled.on, scheduled.note, scheduled.velocity, { track, targetPlugin }, scheduled.frame);
+            sendMidiNote(scheduled.on, scheduled.note, scheduled.velocity, scheduled.frame);
+            scheduled.queued = true;
+        }
+    }
+
+    // Frames the step is played off the tick: late on the odd positions for the swing, plus its micro timing
+    int32_t stepOffset(Step& step, uint16_t position, uint32_t stepFrames)
+    {
+        float offset = step.offset * 0.01f;
+        if (position % 2 == 1) {
+            offset += (swing.get() - 50.0f) * 0.02f;
+        }
+        return offset * stepFrames;
+    }
 
     uint16_t stepCounter = 0;
     bool isPlaying = false;
+    // Step last published to the UI, -1 when stopped
+    int32_t publishedStep = -1;
     uint16_t loopCounter = 0;
     int8_t octaveShift = 0;
 
@@ -84,19 +319,23 @@ protected:
         NEXT = 2
     };
 
-    bool conditionMet(Step& step)
+    bool conditionMet(uint16_t index, Step& step, uint16_t loop)
     {
-        return stepConditions[step.condition].conditionMet(loopCounter);
+        if (loop != rolledLoop) {
+            // Step of the next loop, scheduled ahead
+            return stepConditions[step.condition].conditionMet(loop, random);
+        }
+        return (conditionBits[index / 64] >> (index % 64)) & 1;
     }
 
-    uint8_t motion(Step& step)
+    uint8_t motion(Step& step, uint16_t loop)
     {
-        return stepMotions[step.motion].get(loopCounter);
+        return stepMotions[step.motion].get(loop, random);
     }
 
-    uint8_t getNote(Step& step)
+    uint8_t getNote(Step& step, uint16_t loop)
     {
-        return step.note + motion(step);
+        return step.note + motion(step, loop);
     }
 
     std::vector<std::function<void(bool)>> eventCallbacks;
@@ -126,21 +365,115 @@ protected:
             }
         }
 
-        for (auto& step : *playingSteps) {
-            if (step.counter) {
-                step.counter--;
-                if (step.counter == 0) {
-                    props.audioPluginHandler->noteOff(getNote(step), 0, { track, targetPlugin });
+        std::vector<Step>& list = *playingSteps;
+        // Frames of a step, 0 until measured, the steps then being played on the tick
+        uint32_t stepFrames = tickFrames * 6;
+        uint64_t nextStepFrame = tickFrame + stepFrames;
+        // Only the notes on, and not every step
+        for (size_t i = 0; i < playingNotes.size();) {
+            PlayingStep& playing = playingNotes[i];
+            playing.remaining--;
+            if (playing.index < list.size()) {
+                list[playing.index].counter = playing.remaining;
+            }
+            if (playing.offset == 0 && playing.remaining == 0) {
+                props.audioPluginHandler->noteOff(playing.note, 0, { track, targetPlugin });
+                sendMidiNote(false, playing.note, 0, tickFrame);
+            } else if (playing.offset != 0 && playing.remaining <= 1) {
+                // Off the tick, the note off is as early or late as the note on
+                scheduleNote((playing.remaining ? nextStepFrame : tickFrame) + playing.offset, playing.note, 0, false);
+            } else {
+                i++;
+                continue;
+            }
+            playing = playingNotes.back();
+            playingNotes.pop_back();
+        }
+
+        // here might want to check for state == Status::ON
+        if (state != Status::ON || noteRepeat != -1) {
+            return;
+        }
+        if (stepsIndexDirty) {
+            indexSteps();
+        }
+        if (rolledLoop != loopCounter) {
+            rollConditions();
+        }
+        bool scheduled = scheduledPosition == stepCounter && scheduledLoop == loopCounter;
+        playSteps(stepCounter, loopCounter, stepFrames, scheduled);
+        if (stepFrames) {
+            // The steps off the tick of the next position are scheduled a step ahead, to be played up to half a step early
+            uint16_t nextPosition = stepCounter + 1 < stepCount ? stepCounter + 1 : 0;
+            uint16_t nextLoop = nextPosition ? loopCounter : loopCounter + 1;
+            playSteps(nextPosition, nextLoop, stepFrames, false, nextStepFrame);
+            scheduledPosition = nextPosition;
+            scheduledLoop = nextLoop;
+        }
+    }
+
+    // Play the steps starting on `position`, checked again as they might have been edited in this block: on the tick,
+    // or for the steps off the tick, scheduled from `aheadFrame`, the frame of the position when scheduled ahead.
+    // The steps off the tick already scheduled ahead are skipped when `scheduled` is set.
+    void playSteps(uint16_t position, uint16_t loop, uint32_t stepFrames, bool scheduled, uint64_t aheadFrame = 0)
+    {
+        std::vector<Step>& list = *playingSteps;
+        if (position + 1 >= stepsAt.size()) {
+            return;
+        }
+        bool played = false;
+        for (uint16_t s = stepsAt[position]; s < stepsAt[position + 1]; s++) {
+            uint16_t index = stepsByPosition[s];
+            if (index >= list.size() || index / 64 >= conditionBits.size()) {
+                continue;
+            }
+            Step& step = list[index];
+            if (!step.enabled || !step.len || step.position != position || step.velocity <= 0.0f) {
+                continue;
+            }
+            int32_t offset = stepFrames ? stepOffset(step, position, stepFrames) : 0;
+            uint16_t remaining = step.len;
+            uint64_t frame = aheadFrame + offset;
+            if (aheadFrame) {
+                if (offset == 0) {
+                    continue;
+                }
+                // Counted from the tick before its position
+                remaining++;
+            } else if (offset != 0) {
+                if (scheduled) {
+                    continue;
                 }
+                // Too late to play it early
+                offset = std::max(offset, 0);
+                frame = tickFrame + offset;
             }
-            // here might want to check for state == Status::ON
-            if (state == Status::ON && step.enabled
-                && step.len && stepCounter == step.position
-                && conditionMet(step) && step.velocity > 0.0f && noteRepeat == -1) {
-                step.counter = step.len;
-                props.audioPluginHandler->noteOn(getNote(step), step.velocity, { track, targetPlugin });
-                // printf("should trigger note on %d track %d len %d velocity %.2f\n", step.note, track, step.len, step.velocity);
+            if (!conditionMet(index, step, loop)) {
+                continue;
             }
+            step.counter = step.len;
+            uint8_t note = getNote(step, loop);
+            // A step still on is retriggered
+            auto playing = std::find_if(playingNotes.begin(), playingNotes.end(), [&](PlayingStep& p) { return p.index == index; });
+            if (playing != playingNotes.end()) {
+                playing->remaining = remaining;
+                playing->offset = offset;
+            } else {
+                playingNotes.push_back({ index, note, remaining, offset });
+            }
+            if (offset == 0) {
+                applyLocks(step.locks, step.lockCount);
+                played = true;
+                props.audioPluginHandler->noteOn(note, step.velocity, { track, targetPlugin });
+                sendMidiNote(true, note, step.velocity, tickFrame);
+            } else {
+                scheduleNote(frame, note, step.velocity, true, &step);
+            }
+            // printf("should trigger note on %d track %d len %d velocity %.2f\n", step.note, track, step.len, step.velocity);
+        }
+        // Like on the hardware sequencers, the locks hold until the next step played
+        if (played) {
+            releaseLocks();
         }
     }
 
@@ -171,6 +504,9 @@ public:
     Play/Stop will answer to global event. However, you may want to the sequencer to not listen to those events or to only start to play on the next sequence iteration. */
     Val& status = val(1.0f, "STATUS", { "Status", VALUE_STRING, .max = 2 }, [&](auto p) { setStatus(p.value); });
 
+    /*md - `SWING` delay of the odd steps, from 50% (straight) to 75% (a step played half a step late) */
+    Val& swing = val(50.0f, "SWING", { "Swing", .min = 50.0f, .max = 75.0f, .unit = "%" });
+
     Val& stepCountVal = val(DEFAULT_MAX_STEPS, "STEP_COUNT", { "Step Count", VALUE_BASIC, .min = 4, .max = 64, .step = 4.0f }, [&](auto p) { 
         p.val.setFloat(p.value);
         stepCount = p.val.get();
@@ -214,23 +550,27 @@ public:
     Val& playingLoops = val(0.0f, "PLAYING_LOOPS", { "Loop", VALUE_STRING, 0.0f, .max = 10.0f, .incType = INC_ONE_BY_ONE }, [&](auto p) {
         p.val.setFloat(p.value);
         allOff();
+        stepsIndexDirty = true;
         if (p.val.get() == 0.0f) {
             p.val.setString("Current");
             playingSteps = &steps;
         } else {
-            stepsPreview.clear();
+            // Built in the buffer not playing
+            std::vector<Step>& preview = playingSteps == &stepsPreview[0] ? stepsPreview[1] : stepsPreview[0];
+            preview.clear();
             // int index = playingLoops.get() - 1; // oldest in first position
-            int index = (recordedLoops.size() - 1) - (playingLoops.get() - 1); // newest in first position
-            if (index < recordedLoops.size()) {
+            int index = (recordedLoopCount - 1) - (playingLoops.get() - 1); // newest in first position
+            if (index >= 0 && index < recordedLoopCount) {
                 // In overdub mode (0), start with existing steps; in replace mode (1), start fresh
                 if (recordMode.get() == 0) {
-                    copySteps(steps, stepsPreview);
+                    copySteps(steps, preview);
                 }
 
                 // Copy new recorded loop
-                std::vector<RecordedNote>& loop = recordedLoops[index];
-                for (auto& step : loop) {
-                    stepsPreview.push_back({
+                RecordedLoop& loop = recordedLoop(index);
+                for (uint16_t i = 0; i < loop.count; i++) {
+                    RecordedNote& step = loop.notes[i];
+                    preview.push_back({
                         .enabled = true,
                         .velocity = step.velocity,
                         .position = step.startStep,
@@ -239,10 +579,11 @@ public:
                     });
                 }
             }
-            playingSteps = &stepsPreview;
-            p.val.setString(playingSteps->size() > 0 ? "Rec " + std::to_string((int)p.val.get()) : "Empty");
+            playingSteps = &preview;
+            p.val.setString(preview.size() > 0 ? "Rec " + std::to_string((int)p.val.get()) : "Empty");
         }
-        p.val.props().unit = playingSteps->size() > 0 ? std::to_string((int)playingSteps->size()) + " steps" : "";
+        std::vector<Step>& playing = *playingSteps;
+        p.val.props().unit = playing.size() > 0 ? std::to_string((int)playing.size()) + " steps" : "";
     });
 
     /*md - `QUANTIZE_RECORD` enable/disable quantization when recording. When enabled, note start positions will snap to the nearest step. */
@@ -275,18 +616,102 @@ public:
             targetPlugin = &props.audioPluginHandler->getPlugin(config.json["target"].get<std::string>(), track);
         }
 
+        //md - `"locks"` steps can lock the parameters of the sequenced plugin, e.g. `"locks": [{ "parameter": "CUTOFF", "value": 40 }]`
+        //md   in a step of `STEPS`: the step plays with this value, kept until the next step played. Without `target`,
+        //md   the parameter is the one of the first plugin of the track after the sequencer having it. Up to 4 locks per
+        //md   step, and 64 parameters per sequencer.
+
         //md - `"defaultStepCount": 32` set the number of steps
         uint16_t configStepCount = config.json.value("defaultStepCount", DEFAULT_MAX_STEPS);
         logDebug("Sequencer track %d: setting stepCount to %d (from config defaultStepCount)", track, configStepCount);
         stepCountVal.set(configStepCount);  // Use set() to trigger the callback that updates stepCount
         logDebug("Sequencer track %d: after set, stepCount=%d stepCountVal=%d", track, stepCount, (int)stepCountVal.get());
 
+        //md - `"midiOutChannel": 1` also send the notes on this channel of the MIDI output (see the host `midiOutput`), e.g. to play an external synth
+        midiOutChannel = config.json.value("midiOutChannel", 0) - 1;
+        midiOutChannel = CLAMP(midiOutChannel, -1, 15);
+
         //md - `"recordingEnabled": true` if true, noteOn/noteOff will be recorded
         recordingEnabled = config.json.value("recordingEnabled", recordingEnabled);
 
         //md - `"maxRecordLoops": 10` maximum number of loops to record
         maxRecordLoops = config.json.value("maxRecordLoops", maxRecordLoops);
         playingLoops.props().max = maxRecordLoops;
+        recordedLoops.resize(maxRecordLoops);
+
+        //md - `"seed": 1` seed of the random numbers of the probabilities and random motions, set again on stop so
+        //md   the pattern plays the same each time. By default, each track has its own seed. With 0, it is seeded from
+        //md   the time, and plays differently each time.
+        randomSeed = config.json.value("seed", 1 + track);
+        random.seed(randomSeed ? randomSeed : time(NULL) + track);
+
+        publishedSteps.reserve(SNAPSHOT_STEPS);
+        stepsAt.reserve(SNAPSHOT_STEPS + 1);
+        stepsByPosition.reserve(SNAPSHOT_STEPS);
+        playingNotes.reserve(SNAPSHOT_STEPS);
+        scheduledNotes.reserve(SNAPSHOT_STEPS);
+        conditionBits.reserve((SNAPSHOT_STEPS + MAX_RECORDED_NOTES) / 64 + 1);
+        for (auto& preview : stepsPreview) {
+            preview.reserve(SNAPSHOT_STEPS + MAX_RECORDED_NOTES);
+        }
+        stepsSnapshot.init([](std::vector<Step>& snapshot) { snapshot.reserve(SNAPSHOT_STEPS); });
+    }
+
+    void publishState() override
+    {
+        Mapping::publishState();
+        queueScheduledNotes();
+        if (restoring.load(std::memory_order_acquire)) {
+            // The previous steps are freed by the next restore, not by the audio thread
+            steps.swap(restoredSteps);
+            stepsIndexDirty = true;
+            restoring.store(false, std::memory_order_release);
+        }
+        if (!stepsSnapshot.published || stepsChanged()) {
+            // Edited through the STEPS pointer, the steps are indexed again for the next ticks
+            indexSteps();
+            publishedSteps = *playingSteps;
+            stepsSnapshot.back() = publishedSteps;
+            stepsSnapshot.publish();
+            stepsVersion++;
+        }
+    }
+
+    uint32_t stateVersion() override
+    {
+        return stepsVersion;
+    }
+
+    typedef CowArray<Step> UndoSteps;
+
+    std::shared_ptr<const void> snapshotState(const std::shared_ptr<const void>& previous, size_t& bytes) override
+    {
+        if (!stepsSnapshot.published) {
+            return previous;
+        }
+        std::vector<Step> copy;
+        stepsSnapshot.read([&](std::vector<Step>& snapshot) { copy = snapshot; });
+        for (Step& step : copy) {
+            // Only the cache of `serializeJson()`
+            step.json = nullptr;
+        }
+        const UndoSteps* before = (const UndoSteps*)previous.get();
+        auto steps = std::make_shared<const UndoSteps>(copy, before, [](const Step& a, const Step& b) { return const_cast<Step&>(a).equal(const_cast<Step&>(b)); });
+        if (before && steps->same(*before)) {
+            return previous;
+        }
+        bytes = steps->bytesNotIn(before);
+        return steps;
+    }
+
+    void restoreState(const std::shared_ptr<const void>& state) override
+    {
+        if (restoring.load(std::memory_order_acquire)) {
+            // Still not picked up by the audio thread, the last restore wins
+            return;
+        }
+        ((const UndoSteps*)state.get())->copyTo(restoredSteps);
+        restoring.store(true, std::memory_order_release);
     }
 
     void sample(float* buf) override
@@ -294,6 +719,21 @@ public:
         UseClock::sample(buf);
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        clockBlock(props, buf, frames);
+        int32_t step = isPlaying ? stepCounter : -1;
+        if (step != publishedStep) {
+            publishedStep = step;
+            PluginEvents::get().publish(this, PluginEvents::STEP, step);
+        }
+    }
+
+    bool followsClock() override
+    {
+        return true;
+    }
+
     // -----------------------
     // RECORDING DATA STRUCTS
     // -----------------------
@@ -306,7 +746,7 @@ public:
     };
 
     struct ActiveNote {
-        uint8_t note;
+        bool active = false;
         uint16_t startLoop; // absolute loopCounter when note started
         uint16_t startStep; // stepCounter when note started (0..stepCount-1)
         float velocity;
@@ -315,11 +755,27 @@ public:
     bool recordingEnabled = true; // if true, noteOn/noteOff without userdata will be recorded
     uint16_t maxRecordLoops = 10; // maximum number of loops to record (circular buffer)
 
-    // recordedLoops[i] = notes recorded for loop index (loopCounter % maxRecordLoops == i)
-    std::vector<std::vector<RecordedNote>> recordedLoops;
+    // Recording never allocates on the track thread: the loops are a ring allocated with the plugin, each with a
+    // fixed number of notes, the notes over it being dropped
+    static const uint16_t MAX_RECORDED_NOTES = 256;
+    struct RecordedLoop {
+        uint16_t loop; // loopCounter of the recorded loop
+        uint16_t count = 0;
+        RecordedNote notes[MAX_RECORDED_NOTES];
+    };
+    std::vector<RecordedLoop> recordedLoops;
+    // Oldest loop in the ring, and how many loops are recorded
+    uint16_t recordedLoopStart = 0;
+    uint16_t recordedLoopCount = 0;
+
+    // Recorded loop `index`, the oldest first
+    RecordedLoop& recordedLoop(uint16_t index)
+    {
+        return recordedLoops[(recordedLoopStart + index) % recordedLoops.size()];
+    }
 
-    // Active notes keyed by MIDI note number (only for recording path)
-    std::unordered_map<uint8_t, ActiveNote> activeNotes;
+    // Active notes indexed by MIDI note number (only for recording path)
+    ActiveNote activeNotes[128];
 
     // -----------------------
     // End recording structs
@@ -336,8 +792,7 @@ public:
             bool record = (bool)userdata;
             if (record) {
                 // Avoid duplicate active note entry (re-trigger) — if already active, we return.
-                auto it = activeNotes.find(note);
-                if (it != activeNotes.end()) {
+                if (note >= 128 || activeNotes[note].active) {
                     return;
                 }
 
@@ -350,12 +805,11 @@ public:
                     quantizedStep = stepCounter;
                 }
 
-                ActiveNote an;
-                an.note = note;
+                ActiveNote& an = activeNotes[note];
+                an.active = true;
                 an.startLoop = loopCounter;
                 an.startStep = quantizedStep;
                 an.velocity = velocity;
-                activeNotes[note] = an;
             }
         }
     }
@@ -370,11 +824,11 @@ public:
 
             bool record = (bool)userdata;
             if (record) {
-                auto it = activeNotes.find(note);
-                if (it == activeNotes.end())
+                if (note >= 128 || !activeNotes[note].active)
                     return;
 
-                ActiveNote& an = it->second;
+                ActiveNote& an = activeNotes[note];
+                an.active = false;
 
                 // Determine duration in steps.
                 uint16_t len = 1;
@@ -388,28 +842,33 @@ public:
                 // the note will play for ever
                 len = std::clamp(len, (uint16_t)1, (uint16_t)(stepCount + 1));
 
-                int indexToPush = -1;
-                for (int i = 0; i < recordedLoops.size(); i++) {
-                    if (recordedLoops[i][0].loop == an.startLoop) {
-                        indexToPush = i;
+                if (recordedLoops.empty())
+                    return;
+
+                RecordedLoop* loop = NULL;
+                for (uint16_t i = 0; i < recordedLoopCount; i++) {
+                    if (recordedLoop(i).loop == an.startLoop) {
+                        loop = &recordedLoop(i);
                         break;
                     }
                 }
 
-                if (indexToPush == -1) {
-                    recordedLoops.emplace_back();
-                    // if we exceed the max number of loops, remove the first one
-                    if (recordedLoops.size() > maxRecordLoops) {
-                        recordedLoops.erase(recordedLoops.begin());
+                if (!loop) {
+                    // if we exceed the max number of loops, the oldest one is replaced
+                    if (recordedLoopCount == recordedLoops.size()) {
+                        recordedLoopStart = (recordedLoopStart + 1) % recordedLoops.size();
+                        recordedLoopCount--;
                     }
-                    indexToPush = recordedLoops.size() - 1;
+                    loop = &recordedLoop(recordedLoopCount++);
+                    loop->loop = an.startLoop;
+                    loop->count = 0;
                 }
 
-                recordedLoops[indexToPush].push_back({ an.startLoop, an.note, an.startStep, len, an.velocity });
-
-                // logDebug("Record step: loop %d, note %d, startStep %d, len %d", an.startLoop, an.note, an.startStep, len);
+                if (loop->count < MAX_RECORDED_NOTES) {
+                    loop->notes[loop->count++] = { an.startLoop, note, an.startStep, len, an.velocity };
+                }
 
-                activeNotes.erase(it);
+                // logDebug("Record step: loop %d, note %d, startStep %d, len %d", an.startLoop, note, an.startStep, len);
             }
         }
     }
@@ -428,17 +887,35 @@ public:
 
     void allOff()
     {
-        for (auto& step : *playingSteps) {
-            if (step.counter) {
-                props.audioPluginHandler->noteOff(getNote(step), 0, { track, targetPlugin });
+        std::vector<Step>& list = *playingSteps;
+        for (auto& playing : playingNotes) {
+            props.audioPluginHandler->noteOff(playing.note, 0, { track, targetPlugin });
+            sendMidiNote(false, playing.note, 0, 0);
+            if (playing.index < list.size()) {
+                list[playing.index].counter = 0;
+            }
+        }
+        playingNotes.clear();
+        // The notes off the tick not played yet are dropped, a note on already queued is followed by its note off
+        for (auto& scheduled : scheduledNotes) {
+            if (!scheduled.on && !scheduled.queued) {
+                props.audioPluginHandler->noteOff(scheduled.note, 0, { track, targetPlugin });
+                sendMidiNote(false, scheduled.note, 0, 0);
+            } else if (scheduled.on && scheduled.queued && scheduled.frame >= props.audioPluginHandler->getBlockFrame()) {
+                props.audioPluginHandler->queueNote(false, scheduled.note, 0, { track, targetPlugin }, scheduled.frame);
+                sendMidiNote(false, scheduled.note, 0, scheduled.frame);
             }
-            step.counter = 0;
         }
+        scheduledNotes.clear();
+        scheduledPosition = -1;
+        releaseLocks();
         // Also all off for recording active notes
-        for (auto& kv : activeNotes) {
-            props.audioPluginHandler->noteOff(kv.first, 0, { track, targetPlugin });
+        for (uint8_t note = 0; note < 128; note++) {
+            if (activeNotes[note].active) {
+                props.audioPluginHandler->noteOff(note, 0, { track, targetPlugin });
+                activeNotes[note].active = false;
+            }
         }
-        activeNotes.clear();
     }
 
     void onEvent(AudioEventType event, bool playing) override
@@ -448,6 +925,10 @@ public:
         if (event == AudioEventType::STOP) {
             logTrace("in sequencer event STOP");
             stepCounter = 0;
+            if (randomSeed) {
+                random.seed(randomSeed);
+            }
+            rolledLoop = -1;
             callEventCallbacks();
             allOff();
         } else if (event == AudioEventType::PAUSE) {
@@ -484,13 +965,16 @@ public:
             newNote = std::max(0, std::min(127, newNote));
             s.note = (uint8_t)newNote;
         }
-        for (auto& s : stepsPreview) {
-            int newNote = (int)s.note + semitones;
-            newNote = std::max(0, std::min(127, newNote));
-            s.note = (uint8_t)newNote;
+        for (auto& preview : stepsPreview) {
+            for (auto& s : preview) {
+                int newNote = (int)s.note + semitones;
+                newNote = std::max(0, std::min(127, newNote));
+                s.note = (uint8_t)newNote;
+            }
         }
         for (auto& loop : recordedLoops) {
-            for (auto& n : loop) {
+            for (uint16_t i = 0; i < loop.count; i++) {
+                RecordedNote& n = loop.notes[i];
                 int newNote = (int)n.note + semitones;
                 newNote = std::max(0, std::min(127, newNote));
                 n.note = (uint8_t)newNote;
@@ -498,7 +982,28 @@ public:
         }
     }
 
-    DataFn dataFunctions[14] = {
+    // Index of the parameter `key` to lock, see Step::setLock(), -1 if the sequenced plugin has no such value or
+    // there is no room left. Not for the audio thread.
+    int lockParam(std::string key)
+    {
+        uint8_t count = lockParamCount.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < count; i++) {
+            if (lockParams[i].key == key) {
+                return i;
+            }
+        }
+        ValueInterface* value = count < MAX_LOCK_PARAMS ? findLockValue(key) : NULL;
+        if (!value) {
+            return -1;
+        }
+        lockParams[count] = { key, value };
+        lockParamCount.store(count + 1, std::memory_order_release);
+        return count;
+    }
+
+    int lockParamIndex = -1;
+
+    DataFn dataFunctions[16] = {
         { "STEPS", [this](void* userdata) {
              return &steps;
          } },
@@ -521,13 +1026,15 @@ public:
          } },
         { "SAVE_RECORD", [this](void* userdata) {
              if (playingLoops.get() > 0) {
-                 copySteps(stepsPreview, steps);
+                 copySteps(*playingSteps, steps);
                  playingLoops.set(0);
+                 stepsIndexDirty = true;
              }
              return (void*)NULL;
          } },
         { "CLEAR_STEPS", [this](void* userdata) {
              steps.clear();
+             stepsIndexDirty = true;
              logDebug("Cleared steps");
              return (void*)NULL;
          } },
@@ -535,7 +1042,7 @@ public:
              return &loopCounter;
          } },
         { "RECORDED_LOOPS_COUNT", [this](void* userdata) {
-             recordedLoopsCount = recordedLoops.size();
+             recordedLoopsCount = recordedLoopCount;
              return &recordedLoopsCount;
          } },
         { "RECORDING_ENABLED", [this](void* userdata) {
@@ -554,38 +1061,110 @@ public:
         } },
         { "OCTAVE_SHIFT", [this](void* userdata) {
             return &octaveShift;
+        } },
+        { "LOCK_PARAM", [this](void* userdata) {
+            // userdata is the key (std::string*) of the value to lock, returns its index (int*) for Step::setLock()
+            lockParamIndex = userdata ? lockParam(*static_cast<std::string*>(userdata)) : -1;
+            return &lockParamIndex;
+        } },
+        { "LOCK_PARAM_KEY", [this](void* userdata) {
+            // userdata is the index (uint8_t*) of a locked parameter, returns its key (std::string*) or NULL
+            uint8_t index = userdata ? *static_cast<uint8_t*>(userdata) : MAX_LOCK_PARAMS;
+            return index < lockParamCount.load(std::memory_order_acquire) ? (void*)&lockParams[index].key : (void*)NULL;
         } }
     };
     DEFINE_GETDATAID_AND_DATA
 
+    nlohmann::json& serializeStep(Step& step)
+    {
+        nlohmann::json& json = step.serializeJson();
+        json.erase("locks");
+        uint8_t params = lockParamCount.load(std::memory_order_acquire);
+        for (uint8_t i = 0; i < step.lockCount; i++) {
+            if (step.locks[i].param < params) {
+                json["locks"].push_back({ { "parameter", lockParams[step.locks[i].param].key }, { "value", step.locks[i].value } });
+            }
+        }
+        return json;
+    }
+
     void serializeJson(nlohmann::json& json) override
     {
         json["STATUS"] = status.get();
 
         nlohmann::json stepsJson;
-        for (auto& step : *playingSteps) {
-            stepsJson.push_back(step.serializeJson());
+        if (stepsSnapshot.published) {
+            stepsSnapshot.read([&](std::vector<Step>& snapshot) {
+                for (auto& step : snapshot) {
+                    stepsJson.push_back(serializeStep(step));
+                }
+            });
+        } else {
+            for (auto& step : *playingSteps) {
+                stepsJson.push_back(serializeStep(step));
+            }
         }
         json["STEPS"] = stepsJson;
         json["STEP_COUNT"] = stepCountVal.get();
     }
 
+    void hydrateSteps(nlohmann::json& json, std::vector<Step>& list)
+    {
+        list.clear();
+        for (nlohmann::json& stepJson : json) {
+            Step step;
+            step.hydrateJson(stepJson);
+            if (stepJson.contains("locks")) {
+                for (nlohmann::json& lock : stepJson["locks"]) {
+                    int param = lockParam(lock.value("parameter", ""));
+                    if (param >= 0) {
+                        step.setLock(param, lock.value("value", 0.0f));
+                    }
+                }
+            }
+            // Only hydrate steps that are enabled
+            // else get rid of them (remove garbage)
+            if (step.enabled && step.len > 0) {
+                list.push_back(step);
+            }
+        }
+    }
+
+    // Steps of the clip launched, built when it is staged, and swapped with `steps` by the audio thread when it is
+    // committed. The previous steps are freed by the next staging, not by the audio thread.
+    std::vector<Step> launchSteps;
+    bool launchStepsStaged = false;
+    bool committingSteps = false;
+
+    void stageState(ClipState::Plugin& state) override
+    {
+        launchStepsStaged = state.extra.contains("STEPS");
+        if (launchStepsStaged) {
+            hydrateSteps(state.extra["STEPS"], launchSteps);
+        }
+        Mapping::stageState(state);
+    }
+
+    void commitState() override
+    {
+        committingSteps = stagedState && launchStepsStaged;
+        if (committingSteps) {
+            steps.swap(launchSteps);
+            stepsIndexDirty = true;
+        }
+        Mapping::commitState();
+        committingSteps = false;
+    }
+
     void hydrateJson(nlohmann::json& json) override
     {
         if (json.contains("STATUS")) {
             status.setFloat(json["STATUS"]);
         }
-        if (json.contains("STEPS")) {
-            steps.clear();
-            for (nlohmann::json& stepJson : json["STEPS"]) {
-                Step step;
-                step.hydrateJson(stepJson);
-                // Only hydrate steps that are enabled
-                // else get rid of them (remove garbage)
-                if (step.enabled && step.len > 0) {
-                    steps.push_back(step);
-                }
-            }
+        // Already swapped in when committing a launch
+        if (json.contains("STEPS") && !committingSteps) {
+            hydrateSteps(json["STEPS"], steps);
+            stepsIndexDirty = true;
         }
         if (json.contains("STEP_COUNT")) {
             stepCountVal.set(json["STEP_COUNT"]);
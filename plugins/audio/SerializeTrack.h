@@ -7,8 +7,8 @@ This component, named `SerializeTrack`, functions as a specialized configuration
 
 The primary role of `SerializeTrack` is to capture the entire state of an audio track and save it to persistent storage, effectively creating a "snapshot" or a "Clip."
 
-*   **Saving (Serialization):** It scans all relevant plugins on the track and converts their current operational settings and parameters into a structured data format (like a configuration file).
-*   **Loading (Hydration):** It reads a previously saved configuration file and applies those settings back to the corresponding plugins, instantly restoring the track to a saved state.
+*   **Saving (Serialization):** It scans all relevant plugins on the track and converts their current operational settings and parameters into a structured data format (a compact binary file, plus a JSON export). The files are only written when the settings changed since the last save.
+*   **Loading (Hydration):** It applies a previously saved configuration back to the corresponding plugins, instantly restoring the track to a saved state. The configuration is kept parsed, so the plugins only get their values set, without reading nor parsing a file.
 
 ### 2. Key Features (Clips and Control)
 
@@ -27,15 +27,18 @@ Since saving and loading files are complex operations, the component ensures dat
 
 ### 4. External Access
 
-The component offers several structured commands (data functions) that allow other parts of the application to interrogate or control the saving process, such as manually checking if a specific Clip number exists, retrieving a Clip’s file path, or explicitly triggering a save or load operation.
+The component offers several structured commands (data functions) that allow other parts of the application to interrogate or control the saving process, such as manually checking if a specific Clip number exists, retrieving a Clip’s file path, or explicitly triggering a save or load operation. A clip coming next can be preloaded: it is read by a worker thread beforehand, and the plugins prefetch what it needs (e.g. samples), so switching to it doesn't read the disk.
 
 sha: bcac1e338ba4016c92e7d6c830ed120597f97693af274231bf3576a2a6dec613 
 */
 #pragma once
 
+#include <atomic>
+#include <condition_variable>
 #include <iostream>
 #include <mutex>
 #include <sstream>
+#include <thread>
 
 #include "audioPlugin.h"
 #include "helpers/trim.h"
@@ -43,12 +46,18 @@ sha: bcac1e338ba4016c92e7d6c830ed120597f97693af274231bf3576a2a6dec613
 #include "log.h"
 #include "mapping.h"
 #include "plugins/audio/utils/Clip.h"
+#include "plugins/audio/utils/UndoHistory.h"
+#include "plugins/audio/utils/WorkspaceMirror.h"
 
 /*md
 ## SerializeTrack
 
 SerializeTrack plugin is used to serialize track on disk. It will scan all the plugins on the given track and save them on disk.
 
+Clips are launched with `LAUNCH_CLIP`, quantized by `QUANTIZE`. As soon as the launch is requested, the clip is read
+and staged by a worker thread: the plugins build their state aside (e.g. the steps of the sequencer), and prefetch
+what it needs. The track then swaps it in at the frame of the clock tick the launch is quantized to, in the middle
+of the block if needed, so the launch lands on the beat whatever the size of the clip.
 */
 class SerializeTrack : public Mapping {
 protected:
@@ -71,6 +80,211 @@ protected:
         hydrate();
     }
 
+    // The next clip is read by a worker thread before it is played, so switching to it only swaps the state. The same
+    // worker keeps the undo history, when enabled.
+    std::thread preloadWorker;
+    std::mutex preloadMtx;
+    std::condition_variable preloadCv;
+    int16_t preloadId = -1;
+    bool preloadRunning = true;
+
+    UndoHistory undo;
+    bool undoEnabled = true;
+    std::vector<AudioPlugin*> undoPlugins;
+    const std::vector<AudioPlugin*>* undoPluginsFrom = NULL;
+    bool undoDone = false;
+
+    void undoTick()
+    {
+        const std::vector<AudioPlugin*>* plugins = props.audioPluginHandler->getPlugins();
+        if (!plugins) {
+            return;
+        }
+        if (plugins != undoPluginsFrom) {
+            // Loaded or reloaded, the history of the previous plugins is dropped
+            undoPluginsFrom = plugins;
+            undoPlugins.clear();
+            for (AudioPlugin* plugin : *plugins) {
+                if ((track == -1 || track == plugin->track) && plugin->serializable && plugin != this) {
+                    undoPlugins.push_back(plugin);
+                }
+            }
+            undo.clear();
+        }
+        undo.tick(undoPlugins);
+    }
+
+    void startWorker()
+    {
+        if (!preloadWorker.joinable()) {
+            preloadWorker = std::thread([this] { preloadLoop(); });
+            pthread_setname_np(preloadWorker.native_handle(), "clip_preload");
+        }
+    }
+
+    void preloadLoop()
+    {
+        std::unique_lock<std::mutex> lock(preloadMtx);
+        while (true) {
+            preloadCv.wait_for(lock, std::chrono::milliseconds(100), [&] { return !preloadRunning || preloadId >= 0 || launchRequestId >= 0; });
+            if (!preloadRunning) {
+                break;
+            }
+            if (launchRequestId >= 0) {
+                int16_t id = launchRequestId;
+                uint32_t ticks = launchRequestTicks;
+                launchRequestId = -1;
+                lock.unlock();
+                stageLaunch(id, ticks);
+                lock.lock();
+                continue;
+            }
+            if (preloadId < 0) {
+                lock.unlock();
+                finishLaunch();
+                if (undoEnabled) {
+                    undoTick();
+                }
+                lock.lock();
+                continue;
+            }
+            int16_t id = preloadId;
+            preloadId = -1;
+            lock.unlock();
+
+            ClipState state;
+            m.lock();
+            bool needed = clip.needsPreload(id);
+            std::string jsonPath = clip.getFilepath(id);
+            std::string binaryPath = clip.getBinaryFilepath(id);
+            bool inMemory = !needed && clip.copyState(id, state);
+            m.unlock();
+            // Read without holding the lock, the clips being switched meanwhile
+            if (needed && Clip::read(jsonPath, binaryPath, state)) {
+                prefetch(state);
+                m.lock();
+                clip.setPreloaded(id, state);
+                m.unlock();
+            } else if (inMemory) {
+                prefetch(state);
+            }
+            lock.lock();
+        }
+    }
+
+    // The plugins get what the clip needs from disk (e.g. the samples of its steps) before it is played
+    void prefetch(ClipState& state)
+    {
+        for (ClipState::Plugin& pluginState : state.plugins) {
+            AudioPlugin* plugin = props.audioPluginHandler->getPluginPtr(pluginState.name, track);
+            if (plugin && plugin->serializable) {
+                plugin->prefetchState(pluginState);
+            }
+        }
+    }
+
+    // Launch, see `LAUNCH_CLIP`: staged by the worker, then committed by the audio thread of the track
+    enum LaunchState {
+        LAUNCH_IDLE,
+        LAUNCH_ARMED,
+        LAUNCH_COMMITTING,
+        LAUNCH_DONE,
+    };
+    std::atomic<int> launchState = LAUNCH_IDLE;
+    int16_t launchRequestId = -1;
+    uint32_t launchRequestTicks = 0;
+    int16_t launchId = -1;
+    // Shadow of the state of the track, for the clip being launched
+    ClipState launchClipState;
+    std::vector<AudioPlugin*> launchPlugins;
+
+    // Clock ticks of each `QUANTIZE` option, 0 for the next loop of the sequencer
+    uint32_t quantizeTicks()
+    {
+        static const uint32_t ticks[] = { 0, 0, 24, 96, 192, 384 };
+        return ticks[(int)quantize.get()];
+    }
+
+    // The launch armed is taken back, waiting for the track if it is committing it. Never from the audio thread.
+    void disarmLaunch()
+    {
+        int state = LAUNCH_ARMED;
+        while (!launchState.compare_exchange_weak(state, LAUNCH_IDLE) && state == LAUNCH_COMMITTING) {
+            std::this_thread::yield();
+            state = LAUNCH_ARMED;
+        }
+    }
+
+    // From the worker: read the clip, let the plugins build their state aside, and queue the launch to the track
+    void stageLaunch(int16_t id, uint32_t ticks)
+    {
+        disarmLaunch();
+        finishLaunch();
+        for (AudioPlugin* plugin : launchPlugins) {
+            plugin->stagedState = NULL;
+        }
+
+        ClipState state;
+        m.lock();
+        if (saveBeforeChangingClip) {
+            serialize(false);
+        }
+        bool needed = clip.needsPreload(id);
+        std::string jsonPath = clip.getFilepath(id);
+        std::string binaryPath = clip.getBinaryFilepath(id);
+        bool inMemory = !needed && clip.copyState(id, state);
+        m.unlock();
+        if (needed && Clip::read(jsonPath, binaryPath, state)) {
+            // Kept by the clip as well, for the next time it is loaded
+            m.lock();
+            clip.setPreloaded(id, state);
+            clip.copyState(id, state);
+            m.unlock();
+        } else if (!inMemory) {
+            logWarn("Cannot launch clip %d", id);
+            nextClipToPlay = -1;
+            return;
+        }
+        prefetch(state);
+
+        launchClipState = std::move(state);
+        launchPlugins.clear();
+        for (ClipState::Plugin& pluginState : launchClipState.plugins) {
+            AudioPlugin* plugin = props.audioPluginHandler->getPluginPtr(pluginState.name, track);
+            if (plugin && plugin->serializable && plugin != this) {
+                plugin->stageState(pluginState);
+                launchPlugins.push_back(plugin);
+            }
+        }
+        launchId = id;
+        launchState = LAUNCH_ARMED;
+        if (!props.audioPluginHandler->queueLaunch(this, props.audioPluginHandler->isPlaying() ? ticks : 0)) {
+            launch();
+            finishLaunch();
+        }
+    }
+
+    // From the worker, once the track committed the launch: the clip launched becomes the current one
+    void finishLaunch()
+    {
+        if (launchState != LAUNCH_DONE) {
+            return;
+        }
+        m.lock();
+        clip.setCurrent(launchId);
+        undo.clear();
+        m.unlock();
+        launchState = LAUNCH_IDLE;
+    }
+
+    void preload(int16_t id)
+    {
+        std::lock_guard<std::mutex> guard(preloadMtx);
+        preloadId = id;
+        startWorker();
+        preloadCv.notify_one();
+    }
+
     void setClip(float value)
     {
         // logDebug("set clip %f", value);
@@ -90,6 +304,13 @@ public:
     /*md - `CLIP` switch between different track serialization clips (clip). */
     Val& clipVal = val(0.0f, "CLIP", { "Clip", .max = 1000.0f }, [&](auto p) { setClip(p.value); });
 
+    /*md - `QUANTIZE` when the clips launched with `LAUNCH_CLIP` start: on the next loop of the sequencer, right away, on the next beat, bar, 2 bars or 4 bars. */
+    Val& quantize = val(0.0f, "QUANTIZE", { "Quantize", VALUE_STRING, .max = 5.0f }, [&](auto p) {
+        static const char* names[] = { "Loop", "Off", "Beat", "Bar", "2 Bars", "4 Bars" };
+        p.val.setFloat(p.value);
+        p.val.setString(names[(int)p.val.get()]);
+    });
+
     SerializeTrack(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
     {
@@ -99,8 +320,32 @@ public:
         //md - `"saveBeforeChangingClip": true` toggle to enable clip edit mode. If set to false clip will be read only. If set to true, every changes will be save before to switch to the next clipVal. Default is false`.
         saveBeforeChangingClip = json.value("saveBeforeChangingClip", saveBeforeChangingClip);
 
+        //md - `"saveJson": true` to also save the clips as JSON, next to their binary file. Default is true, so they can be read and versioned.
         clip.config(json);
         clipVal.props().max = clip.getMaxClips() - 1;
+
+        //md - `"undoMemory": 1048576` memory in bytes kept for the undo history of the track, see the `UNDO` and `REDO` data functions. The history only stores what changed from one entry to the next, so it goes far back, the oldest entries being dropped once it is full. 0 disables undo.
+        undo.maxBytes = json.value("undoMemory", undo.maxBytes);
+        undoEnabled = undo.maxBytes > 0;
+
+        //md - `"quantize": 3` the default `QUANTIZE` of the launches, 3 being the next bar. Default is 0, the next loop.
+        quantize.set(json.value("quantize", quantize.get()));
+        if (undoEnabled) {
+            std::lock_guard<std::mutex> guard(preloadMtx);
+            startWorker();
+        }
+    }
+
+    ~SerializeTrack()
+    {
+        {
+            std::lock_guard<std::mutex> guard(preloadMtx);
+            preloadRunning = false;
+        }
+        preloadCv.notify_all();
+        if (preloadWorker.joinable()) {
+            preloadWorker.join();
+        }
     }
 
     void sample(float* buf)
@@ -108,10 +353,12 @@ public:
     }
 
     int nextClipToPlay = -1;
+    // Whether `nextClipToPlay` starts on the next loop, or is launched by the track, see `QUANTIZE`
+    bool nextOnLoop = true;
     void onEvent(AudioEventType event, bool isPlaying) override
     {
         if (event == AudioEventType::SEQ_LOOP) {
-            if (nextClipToPlay != -1) {
+            if (nextClipToPlay != -1 && nextOnLoop) {
                 setClip(nextClipToPlay);
                 nextClipToPlay = -1;
             }
@@ -128,8 +375,14 @@ public:
             }
         } else if (event == AudioEventType::RELOAD_WORKSPACE) {
             m.lock();
-            clip.init();
-            hydrate(true); // load new workspace
+            if (workspacePrepared) {
+                // Read by prepareEvent()
+                hydrate();
+                workspacePrepared = false;
+            } else {
+                clip.init();
+                hydrate(true); // load new workspace
+            }
             m.unlock();
         } else if (event == AudioEventType::RELOAD_CLIP) {
             m.lock();
@@ -139,15 +392,70 @@ public:
             m.lock();
             saveClip(clipVal.get());
             m.unlock();
+        } else if (event == AudioEventType::STOP) {
+            // The take is over, good time to write the workspace back to the card
+            WorkspaceMirror::get().requestSync();
+            // Without clock, the launch pending is not waiting for a tick anymore
+            if (launchState == LAUNCH_ARMED) {
+                props.audioPluginHandler->queueLaunch(this, 0);
+            }
         }
     }
 
+    // From the audio thread of the track, at the frame of the launch: the staged states are swapped in
+    void launch() override
+    {
+        int state = LAUNCH_ARMED;
+        if (!launchState.compare_exchange_strong(state, LAUNCH_COMMITTING)) {
+            return;
+        }
+        for (AudioPlugin* plugin : launchPlugins) {
+            plugin->commitState();
+        }
+        clipVal.setFloat(launchId);
+        if (nextClipToPlay == launchId) {
+            nextClipToPlay = -1;
+        }
+        launchState = LAUNCH_DONE;
+    }
+
+    bool workspacePrepared = false;
+
+    // The clip of the new workspace is read and parsed, and the plugins prefetch what it needs, in parallel with the
+    // other tracks, the hydration in `onEvent()` only setting the state
+    void prepareEvent(AudioEventType event) override
+    {
+        if (event != AudioEventType::RELOAD_WORKSPACE) {
+            return;
+        }
+        m.lock();
+        clip.init();
+        int16_t id = clip.getIdFromFilepath(clip.current);
+        bool needed = clip.needsPreload(id);
+        std::string jsonPath = clip.getFilepath(id);
+        std::string binaryPath = clip.getBinaryFilepath(id);
+        ClipState state;
+        bool inMemory = !needed && clip.copyState(id, state);
+        m.unlock();
+        if (needed && Clip::read(jsonPath, binaryPath, state)) {
+            prefetch(state);
+            m.lock();
+            clip.setPreloaded(id, state);
+            m.unlock();
+        } else if (inMemory) {
+            prefetch(state);
+        }
+        // Also without a clip file, the workspace is initialized
+        workspacePrepared = true;
+    }
+
     void serialize(bool toFile = true)
     {
         nlohmann::json json;
         for (AudioPlugin* plugin : props.audioPluginHandler->plugins) {
             if ((track == -1 || track == plugin->track) && plugin->serializable) {
                 plugin->serializeJson(json[plugin->name]);
+                plugin->serializeAutomation(json[plugin->name]);
             }
         }
         clip.serialize(json, toFile);
@@ -156,20 +464,22 @@ public:
     void hydrate(bool reload = false)
     {
         try {
-            nlohmann::json json = clip.hydrate(reload);
+            // Parsed once, so switching clips only sets the values
+            ClipState& state = clip.state(reload);
+            // The clip loaded starts a new history
+            undo.clear();
 
-            // loop through keys
-            for (auto it = json.begin(); it != json.end(); ++it) {
-                AudioPlugin* plugin = props.audioPluginHandler->getPluginPtr(it.key(), track);
+            for (ClipState::Plugin& pluginState : state.plugins) {
+                AudioPlugin* plugin = props.audioPluginHandler->getPluginPtr(pluginState.name, track);
                 if (plugin) {
                     if (plugin->serializable) {
                         logDebug("Hydrating plugin: %s on track %d", plugin->name.c_str(), plugin->track);
-                        plugin->hydrateJson(it.value());
+                        plugin->hydrateState(pluginState);
                     } else {
                         logWarn("Cannot hydrate plugin: %s (not serializable)\n", plugin->name.c_str());
                     }
                 } else {
-                    logWarn("Cannot hydrate plugin: %s (not found)\n", it.key().c_str());
+                    logWarn("Cannot hydrate plugin: %s (not found)\n", pluginState.name.c_str());
                 }
             }
         } catch (const std::exception& e) {
@@ -193,7 +503,7 @@ public:
 
     std::vector<int> clipExists = std::vector<int>(1000, -1);
     std::string dataStr;
-    DataFn dataFunctions[13] = {
+    DataFn dataFunctions[17] = {
         { "SERIALIZE", [this](void* userdata) {
              data(0, userdata);
              m.lock();
@@ -212,7 +522,7 @@ public:
              if (userdata) {
                  int id = *(int16_t*)userdata;
                  if (clipExists[id] == -1) {
-                     bool fileExists = std::filesystem::exists(clip.getFilepath(id));
+                     bool fileExists = std::filesystem::exists(clip.getFilepath(id)) || std::filesystem::exists(clip.getBinaryFilepath(id));
                      clipExists[id] = fileExists ? 1 : 0;
                  }
                  //  return (void*)&clipExists[id];
@@ -242,6 +552,7 @@ public:
         { "LOAD_CLIP", [this](void* userdata) {
              if (userdata) {
                  nextClipToPlay = -1;
+                 disarmLaunch();
                  int id = *(int16_t*)userdata;
                  // m.lock();
                  // loadClip(id);
@@ -253,13 +564,37 @@ public:
         { "LOAD_CLIP_NEXT", [this](void* userdata) {
              if (userdata) {
                  nextClipToPlay = *(int16_t*)userdata;
+                 nextOnLoop = true;
+                 preload(nextClipToPlay);
+             }
+             return (void*)&nextClipToPlay;
+         } },
+        // Launch a clip, quantized by `QUANTIZE`, returns the clip pending like LOAD_CLIP_NEXT
+        { "LAUNCH_CLIP", [this](void* userdata) {
+             if (userdata) {
+                 int16_t id = *(int16_t*)userdata;
+                 uint32_t ticks = quantizeTicks();
+                 nextClipToPlay = id;
+                 nextOnLoop = ticks == 0 && quantize.get() == 0.0f;
+                 if (nextOnLoop) {
+                     preload(id);
+                 } else {
+                     std::lock_guard<std::mutex> guard(preloadMtx);
+                     launchRequestId = id;
+                     launchRequestTicks = ticks;
+                     startWorker();
+                     preloadCv.notify_one();
+                 }
              }
              return (void*)&nextClipToPlay;
          } },
         { "DELETE_CLIP", [this](void* userdata) {
              if (userdata) {
                  int id = *(int16_t*)userdata;
+                 FileWriter::get().cancel(clip.getFilepath(id));
+                 FileWriter::get().cancel(clip.getBinaryFilepath(id));
                  std::filesystem::remove(clip.getFilepath(id));
+                 std::filesystem::remove(clip.getBinaryFilepath(id));
                  clipExists[id] = 0;
              }
              return (void*)NULL;
@@ -299,6 +634,22 @@ public:
         { "WORKSPACE_FOLDER", [this](void* userdata) {
              return (void*)&clip.workspace.folder;
          } },
+        // Read the clip in the background, before it is loaded with LOAD_CLIP
+        { "PRELOAD_CLIP", [this](void* userdata) {
+             if (userdata) {
+                 preload(*(int16_t*)userdata);
+             }
+             return (void*)NULL;
+         } },
+        // Back to the previous state of the plugins of the track, returns a bool* false if there is nothing to undo
+        { "UNDO", [this](void* userdata) {
+             undoDone = undo.undo();
+             return (void*)&undoDone;
+         } },
+        { "REDO", [this](void* userdata) {
+             undoDone = undo.redo();
+             return (void*)&undoDone;
+         } },
     };
 
     DEFINE_GETDATAID_AND_DATA
@@ -156,7 +156,7 @@ public:
             // printf("val: %f, direction: %d, value: %d\n", p.value, direction, value);
             p.val.setFloat(value);
             waveform.setShape(p.val.pct());
-            p.val.setString(std::to_string((int)(p.val.get() * 0.1)) + "%");
+            p.val.setNumber((int)(p.val.get() * 0.1), 0, "%");
         } else {
             int value = CLAMP(p.value, 1.0f, wavetable.fileBrowser.count);
             p.val.setFloat(value);
@@ -175,7 +175,7 @@ public:
         if (waveformType.get() != 0.0f) {
             p.val.setFloat(p.value);
             waveform.setMacro(p.val.pct());
-            p.val.setString(std::to_string((int)p.val.get()) + "%");
+            p.val.setNumber((int)p.val.get(), 0, "%");
         } else {
             float value = CLAMP(p.value, 1.0f, ZIC_WAVETABLE_WAVEFORMS_COUNT);
             p.val.setFloat(value);
@@ -198,6 +198,13 @@ public:
 
     float scaledClipping = 0.0f;
     float freq = 1.0f;
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        // Play the table built in the background since the last block, see TableGenerator
+        waveform.update();
+        Mapping::sampleBlock(buf, frames);
+    }
+
     void sample(float* buf)
     {
         if (sampleIndex < sampleCountDuration) {
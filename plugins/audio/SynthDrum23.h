@@ -184,7 +184,7 @@ public:
             // printf("val: %f, direction: %d, value: %d\n", p.value, direction, value);
             p.val.setFloat(value);
             waveform.setShape(p.val.pct());
-            p.val.setString(std::to_string((int)(p.val.get() * 0.1)) + "%");
+            p.val.setNumber((int)(p.val.get() * 0.1), 0, "%");
         } else {
             int value = CLAMP(p.value, 1.0f, wavetable.fileBrowser.count);
             p.val.setFloat(value);
@@ -203,7 +203,7 @@ public:
         if (waveformType.get() != 0.0f) {
             p.val.setFloat(p.value);
             waveform.setMacro(p.val.pct());
-            p.val.setString(std::to_string((int)p.val.get()) + "%");
+            p.val.setNumber((int)p.val.get(), 0, "%");
         } else {
             float value = CLAMP(p.value, 1.0f, ZIC_WAVETABLE_WAVEFORMS_COUNT);
             p.val.setFloat(value);
@@ -311,6 +311,25 @@ public:
         }
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        // Nothing is playing, skip the whole block
+        if (sampleDurationCounter >= sampleCountDuration) {
+            return;
+        }
+        AudioPlugin::sampleBlock(buf, frames);
+    }
+
+    uint32_t tailFrames() override
+    {
+        return 0;
+    }
+
+    bool isActive() override
+    {
+        return sampleDurationCounter < sampleCountDuration;
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
         boostTime = 0.0f;
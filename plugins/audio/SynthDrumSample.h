@@ -3,9 +3,9 @@ This file defines the structure for an audio plugin called `SynthDrumSample`, wh
 
 **How the Plugin Works:**
 
-The plugin is designed for responsiveness and efficiency. It reserves a fixed, large memory space (up to 30 seconds of audio) to store the entire sound file once it is loaded. This allows for quick playback without delays.
+The plugin is designed for responsiveness and efficiency. The entire sound file (up to 30 seconds of audio) is decoded in the background and kept in memory, so neither loading nor playback causes delays.
 
-1.  **Loading and Browsing:** It includes an internal file browser that allows the user to navigate and select sound files from a specific sample folder. The chosen file is read using standard audio libraries and loaded into the reserved memory buffer.
+1.  **Loading and Browsing:** It includes an internal file browser that allows the user to navigate and select sound files from a specific sample folder. The chosen file is read using standard audio libraries and swapped in between two audio blocks.
 2.  **Triggering:** When the plugin receives a "Note On" command (like pressing a key on a keyboard or sequence trigger), it immediately starts playing the sample.
 3.  **Pitch Control:** A sophisticated calculation adjusts the playback speed based on the note being triggered. If a higher note is played, the sample is sped up (higher pitch); a lower note slows it down (lower pitch), acting like a classic sampler.
 
@@ -28,6 +28,7 @@ sha: 23664925bd0d792a289d912bef1d67c34846616e7deb03a674f550d487691723
 
 #include "audioPlugin.h"
 #include "audio/fileBrowser.h"
+#include "plugins/audio/utils/SampleIndex.h"
 #include "mapping.h"
 
 #include "helpers/random.h"
@@ -35,7 +36,9 @@ sha: 23664925bd0d792a289d912bef1d67c34846616e7deb03a674f550d487691723
 #include "plugins/audio/utils/ValSerializeSndFile.h"
 #include "host/constants.h"
 #include "audio/utils/getStepMultiplier.h"
-#include "audio/utils/applySampleGain.h"
+#include "plugins/audio/utils/SampleLoader.h"
+#include "plugins/audio/utils/SampleInterpolation.h"
+#include "plugins/audio/utils/SampleView.h"
 
 #ifndef MAX_SAMPLE_VOICES
 #define MAX_SAMPLE_VOICES 4
@@ -54,13 +57,12 @@ class SynthDrumSample : public Mapping {
 protected:
     // Hardcoded to 48000, no matter the sample rate
     static const uint64_t bufferSize = 48000 * 30; // 30sec at 48000Hz, 32sec at 44100Hz...
-    float sampleData[bufferSize];
-    struct SampleBuffer {
-        uint64_t count = 0;
-        float* data;
-    } sampleBuffer;
+    // Files are decoded in the background, the audio thread switching to the new one at a block boundary
+    SampleLoader::Slot sampleSlot = SampleLoader::Slot(props.sampleRate, bufferSize, true, SamplePool::AUTO);
+    SampleView sampleBuffer;
+    SampleInterpolation interpolation;
 
-    FileBrowser fileBrowser = FileBrowser(AUDIO_FOLDER + "/samples");
+    FileBrowser fileBrowser = SampleIndex::get().browser(AUDIO_FOLDER + "/samples");
     float index = 0;
     uint64_t indexStart = 0;
     uint64_t indexEnd = 0;
@@ -116,13 +118,22 @@ public:
             browser.props().max = fileBrowser.count;
             open(0.0, true);
         }
+
+        //md - `"compactSamples": true` store the samples as 16 bits integers, half the memory, converted while playing. Default is to store them as float until the sample pool goes over `SAMPLE_POOL_COMPACT_MB`.
+        if (json.contains("compactSamples")) {
+            sampleSlot.setStorage(json["compactSamples"].get<bool>() ? SamplePool::COMPACT : SamplePool::FLOAT);
+            open(browser.get(), true);
+        }
+
+        //md - `"interpolation": "linear"` how the sample is read between its frames when pitched: `nearest`, `linear`, `cubic` or `sinc`, the sinc also avoiding aliasing when pitched up. Default is `linear`.
+        interpolation.setKernel(SampleInterpolation::getKernel(json.value("interpolation", "linear")));
     }
 
     void sample(float* buf) override
     {
         float out = 0.0f;
         if (index < indexEnd) {
-            out = sampleBuffer.data[(int)index] * velocity;
+            out = interpolation.at(sampleBuffer, sampleBuffer.count, sampleBuffer.channels, index) * velocity;
             index += stepIncrement;
         } else if (index != sampleBuffer.count) {
             index = sampleBuffer.count;
@@ -130,36 +141,58 @@ public:
         buf[track] = out;
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        swapSample();
+        // The whole block at once while the sample doesn't end in it
+        if (index + stepIncrement * frames < indexEnd) {
+            index = interpolation.render(sampleBuffer, sampleBuffer.count, sampleBuffer.channels, index, stepIncrement, velocity, trackLane(buf, track), props.frameStride, frames);
+            return;
+        }
+        Mapping::sampleBlock(buf, frames);
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
         // printf("[%d] drum sample noteOn: %d %f\n", track, note, _velocity);
         logTrace("drum sample noteOn: %d %f", note, velocity);
+        swapSample();
         index = indexStart;
         stepIncrement = getSampleStep(note);
+        interpolation.setStep(stepIncrement / sampleBuffer.channels);
         velocity = _velocity;
     }
 
     void open(std::string filename)
     {
-        SF_INFO sfinfo;
-        SNDFILE* file = sf_open(filename.c_str(), SFM_READ, &sfinfo);
-        if (!file) {
-            logDebug("Error: could not open file %s [%s]\n", filename.c_str(), sf_strerror(file));
+        if (paramQueue.isConsumerThread()) {
+            sampleSlot.load(filename);
             return;
         }
-        logTrace("Audio file %s sampleCount %ld sampleRate %d\n", filename, (long)sfinfo.frames, sfinfo.samplerate);
-        // printf(".................Audio file chan %d vs prop chan %d\n", sfinfo.channels, props.channels);
-
-        sampleBuffer.count = sf_read_float(file, sampleData, bufferSize);
-        sampleBuffer.data = sampleData;
+        sampleSlot.load(filename, true);
+        useLoadedSample();
+    }
 
-        sf_close(file);
+    // Switch to the sample decoded in the background, if any, before rendering or starting a note
+    void swapSample()
+    {
+        if (sampleSlot.swap()) {
+            useLoadedSample();
+        }
+    }
 
-        stepMultiplier = getStepMultiplierMonoTrack(sfinfo.channels, props.channels);
+    void useLoadedSample()
+    {
+        SampleLoader::Sample* loaded = sampleSlot.get();
+        if (!loaded) {
+            return;
+        }
+        sampleBuffer.set(loaded);
+        stepMultiplier = getStepMultiplierMonoTrack(loaded->channels, props.channels);
 
         index = sampleBuffer.count;
+        indexStart = start.pct() * sampleBuffer.count;
         indexEnd = end.pct() * sampleBuffer.count;
-        applySampleGain(sampleBuffer.data, sampleBuffer.count);
     }
 
     void open(float value, bool force = false)
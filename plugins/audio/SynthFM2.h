@@ -12,7 +12,7 @@ The engine is built around four independent sound generators, called *operators*
 
 The key to FM synthesis here is the **Algorithm**. This array acts as the internal wiring diagram, defining precisely which of the four operators modulates which others. The code offers 12 distinct preset algorithms, allowing for vastly different sound characteristics.
 
-When a musical note is triggered, all four operators are activated. The system then generates the final audio signal sample by sample, following the chosen Algorithm map. The output of the modulator operators changes the frequencies of the carrier operators, and the final sound is a mixture of the carriers, all shaped by their individual envelopes and control settings. All sound parameters are designed to be easily adjustable through an external user interface.
+When a musical note is triggered, all four operators are activated. The system then generates the final audio signal block by block, following the chosen Algorithm map. The output of the modulator operators changes the frequencies of the carrier operators, and the final sound is a mixture of the carriers, all shaped by their individual envelopes and control settings. All sound parameters are designed to be easily adjustable through an external user interface.
 
 sha: c9032bbbd9e34bb94bb11257073780efd0469fa912db5733435e6869d833348f 
 */
@@ -22,6 +22,7 @@ sha: c9032bbbd9e34bb94bb11257073780efd0469fa912db5733435e6869d833348f
 #include "helpers/clamp.h"
 #include "mapping.h"
 #include "audio/AdsrEnvelop.h"
+#include "audio/FmKernel.h"
 
 #define ZIC_FM_OPS_COUNT 4
 
@@ -43,10 +44,6 @@ protected:
         Val feedback;
         AdsrEnvelop envelop;
         float pitchedFreq = 0.0f;
-        float stepIncrement = 0.0f;
-        float index = 0.0f;
-        float mod = 0.0f;
-        float feedbackMod = 0.0f;
     } operators[ZIC_FM_OPS_COUNT] = {
         {
             { 50.0f, "ATTACK_0", { "Attack 1", .min = 1.0, .max = 5000.0, .step = 20, .unit = "ms" }, [&](auto p) { setAttack(p.value, 0); } },
@@ -117,10 +114,14 @@ protected:
     // notePitchRatio is the pitch of the current playing note;
     float notePitchRatio = 1.0f;
 
+    // Phases of the operators, rendered by FmKernel one chunk at a time
+    FmKernel::Operator phases[ZIC_FM_OPS_COUNT];
+    FmKernel::Chunk chunk;
+
     void updateOperatorFrequency(FMoperator& op)
     {
         op.pitchedFreq = mainFreq.get() * op.ratio.get() * notePitchRatio;
-        op.stepIncrement = props.lookupTable->size * op.pitchedFreq / props.sampleRate;
+        phases[&op - operators].step = props.lookupTable->size * op.pitchedFreq / props.sampleRate;
     }
 
     void triggerOperator(FMoperator& op)
@@ -128,33 +129,34 @@ protected:
         // Safe legato: only reset envelope/phase if the operator is silent (finished)
         if (op.envelop.isSilent()) {
             op.envelop.reset();
-            op.index = 0.0f;
+            phases[&op - operators].index = 0.0f;
         }
         updateOperatorFrequency(op);
     }
 
+    // Up to `FmKernel::CHUNK` frames, the envelopes first, then the operators one after the other
+    void renderChunk(float* out, uint32_t stride, uint32_t frames)
+    {
+        for (int i = 0; i < ZIC_FM_OPS_COUNT; i++) {
+            operators[i].envelop.render(chunk.env[i], frames);
+        }
+        float mixed[FmKernel::CHUNK];
+        FmKernel::getRender(algo.get() - 1)(phases, chunk, props.lookupTable->sine, props.lookupTable->size, mixed, frames);
+        for (uint32_t f = 0; f < frames; f++) {
+            out[f * stride] = mixed[f] * velocity;
+        }
+    }
+
     void releaseOperator(FMoperator& op)
     {
         op.envelop.release();
     }
 
 public:
-    bool algorithm[12][ZIC_FM_OPS_COUNT - 1][ZIC_FM_OPS_COUNT - 1] = {
-        { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
-        { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 1 } },
-        { { 0, 0, 1 }, { 0, 1, 0 }, { 0, 0, 1 } },
-        { { 1, 1, 0 }, { 0, 0, 1 }, { 0, 0, 1 } },
-        { { 1, 0, 0 }, { 0, 1, 1 }, { 0, 0, 0 } },
-        { { 1, 0, 0 }, { 0, 1, 0 }, { 0, 0, 0 } },
-        { { 0, 0, 1 }, { 0, 0, 1 }, { 0, 0, 1 } },
-        { { 1, 0, 0 }, { 0, 0, 0 }, { 0, 0, 1 } },
-        { { 1, 1, 1 }, { 0, 0, 0 }, { 0, 0, 0 } },
-        { { 1, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } },
-        { { 0, 0, 0 }, { 0, 0, 0 }, { 0, 0, 0 } },
-        { { 0, 1, 0 }, { 0, 1, 0 }, { 0, 0, 0 } },
-    };
+    // Operator i modulates operator j + 1, see FmKernel::ALGORITHMS
+    const bool (*algorithm)[ZIC_FM_OPS_COUNT - 1][ZIC_FM_OPS_COUNT - 1] = FmKernel::ALGORITHMS;
 
-    Val& algo = val(1, "ALGO", { "Algorithm", .min = 1, .max = sizeof(algorithm) / sizeof(algorithm[0]) });
+    Val& algo = val(1, "ALGO", { "Algorithm", .min = 1, .max = FmKernel::ALGORITHM_COUNT });
     Val& mainFreq = val(440.0f, "FREQUENCY", { "Frequency", .min = 20.0, .max = 5000.0, .step = 10.0, .unit = "Hz" },
         [&](auto p) { 
             mainFreq.setFloat(p.value);
@@ -198,67 +200,15 @@ public:
 
     void sample(float* buf) override
     {
-        uint8_t outDivider = 0;
-        float out = 0.0f;
-
-        for (int i = 0; i < ZIC_FM_OPS_COUNT; i++) {
-            operators[i].mod = 0.0f;
-            operators[i].feedbackMod = 0.0f; // clear feedback modulation each frame
-        }
+        renderChunk(buf + track, 1, 1);
+    }
 
-        for (int i = 0; i < ZIC_FM_OPS_COUNT; i++) {
-            FMoperator& op = operators[i];
-            float env = op.envelop.next();
-            if (env > 0.0f) {
-                if (op.mod == 0.0f && op.feedbackMod == 0.0f) {
-                    op.index += op.stepIncrement;
-                } else {
-                    // compute modulated frequency properly (do not double-add base increment)
-                    float freq = op.pitchedFreq * (1.0f + op.mod + op.feedbackMod);
-                    float inc = props.lookupTable->size * freq / props.sampleRate; // increment for modulated frequency
-                    op.index += inc;
-                }
-                while (op.index >= props.lookupTable->size) {
-                    op.index -= props.lookupTable->size;
-                }
-                // linear interpolation on the wavetable to reduce quantization artifacts
-                int idx = (int)op.index;
-                float frac = op.index - (float)idx;
-                int nextIdx = idx + 1;
-                if (nextIdx >= (int)props.lookupTable->size)
-                    nextIdx -= props.lookupTable->size;
-                float a = props.lookupTable->sine[idx];
-                float b = props.lookupTable->sine[nextIdx];
-                float val = a * (1.0f - frac) + b * frac;
-                float s = val * env;
-
-                if (op.feedback.get() > 0.0f) {
-                    op.feedbackMod = s * op.feedback.pct();
-                }
-
-                if (i == ZIC_FM_OPS_COUNT - 1) { // Last operator can only be the carrier
-                    outDivider++;
-                    out += s;
-                    out = out / outDivider;
-                } else {
-                    bool isMod = false;
-                    for (int j = 0; j < ZIC_FM_OPS_COUNT - 1; j++) {
-                        if (algorithm[(uint8_t)(algo.get() - 1)][i][j]) {
-                            isMod = true;
-                            // j + 1 because the first operator doesnt receive modulation
-                            // accumulate modulation additively (safer, avoids multiplicative collapse)
-                            operators[j + 1].mod += s;
-                        }
-                    }
-                    if (!isMod) {
-                        outDivider++;
-                        out += s;
-                    }
-                }
-            }
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        float* out = trackLane(buf, track);
+        for (uint32_t f = 0; f < frames; f += FmKernel::CHUNK) {
+            renderChunk(out + f * props.frameStride, props.frameStride, std::min(FmKernel::CHUNK, frames - f));
         }
-
-        buf[track] = out * velocity;
     }
 
     enum DATA_ID {
@@ -278,8 +228,7 @@ public:
     {
         switch (id) {
         case ALGO:
-            bool(*ret)[3] = algorithm[(uint8_t)(algo.get() - 1)];
-            return ret;
+            return (void*)algorithm[(uint8_t)(algo.get() - 1)];
         }
         return NULL;
     }
@@ -33,6 +33,7 @@ sha: 6c1c24835a41a83bec4f60544bb5efade0a49bbf07b0d6cfb09cbd8e1fe36aa0
 #include "../../audio/WavetableGenerator.h"
 #include "audioPlugin.h"
 #include "mapping.h"
+#include "audio/EnvelopChunk.h"
 #include "audio/EnvelopDrumAmp.h"
 #include "audio/EnvelopDrumTransient.h"
 #include "audio/EnvelopRelative.h"
@@ -148,6 +149,9 @@ protected:
              }
          } },
     });
+    // Both rendered 32 samples ahead, see EnvelopChunk
+    EnvelopChunk<EnvelopDrumAmp> envelopAmpChunk = EnvelopChunk<EnvelopDrumAmp>(envelopAmp);
+    EnvelopChunk<EnvelopRelative> envelopFreqChunk = EnvelopChunk<EnvelopRelative>(envelopFreq);
 
     float addSecondLayer(float out)
     {
@@ -212,7 +216,7 @@ public:
         p.val.setFloat(p.value);
         if (waveformType.get() != 0.0f) {
             waveform.setShape(p.val.pct());
-            p.val.setString(std::to_string((int)(p.val.get())) + "%");
+            p.val.setNumber((int)p.val.get(), 0, "%");
         } else {
             int position = p.val.get();
             wavetable.open(position, false);
@@ -228,7 +232,7 @@ public:
         if (waveformType.get() != 0.0f) {
             p.val.setFloat(p.value);
             waveform.setMacro(p.val.pct());
-            p.val.setString(std::to_string((int)p.val.get()) + "%");
+            p.val.setNumber((int)p.val.get(), 0, "%");
         } else {
             float value = CLAMP(p.value, 1.0f, ZIC_WAVETABLE_WAVEFORMS_COUNT);
             p.val.setFloat(value);
@@ -339,11 +343,18 @@ public:
         initValues();
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        // Play the table built in the background since the last block, see TableGenerator
+        waveform.update();
+        Mapping::sampleBlock(buf, frames);
+    }
+
     void sample(float* buf)
     {
         if (sampleDurationCounter < sampleCountDuration) {
-            float envAmp = envelopAmp.next();
-            float envFreq = envelopFreq.next();
+            float envAmp = envelopAmpChunk.next();
+            float envFreq = envelopFreqChunk.next();
 
             float freq = envFreq + noteMult;
             float out = wave->sample(&wavetable.sampleIndex, freq) * envAmp;
@@ -364,6 +375,8 @@ public:
         sampleDurationCounter = 0;
         envelopAmp.reset(sampleCountDuration);
         envelopFreq.reset(sampleCountDuration);
+        envelopAmpChunk.reset();
+        envelopFreqChunk.reset();
         envelopAmpLayer2.reset(sampleCountDuration * layer2duration.pct());
         velocity = CLAMP(_velocity, 0.0f, 1.0f);
 
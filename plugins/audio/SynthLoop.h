@@ -1,7 +1,7 @@
 /** Description:
 This code defines the structure for an advanced audio processing module called "SynthLoop," designed to load, loop, and heavily manipulate sound samples using various effects. It functions much like a specialized digital instrument or effect plugin.
 
-The core functionality involves reading an audio file into a large, dedicated memory space (a buffer) and providing a file browser to easily switch between samples. Users can define custom start and end points for the loop playback within the loaded sample.
+The core functionality involves reading an audio file into a buffer, decoded in the background and switched between two audio blocks, and providing a file browser to easily switch between samples. Users can define custom start and end points for the loop playback within the loaded sample. Files too big to fit in memory, like stems of several minutes, are instead played from the disk: only their start stays in memory and a background thread reads ahead of the playhead, the granular part being then bypassed.
 
 The sound is processed through a sophisticated chain:
 
@@ -19,17 +19,22 @@ sha: 1827a408d6bccd472c8204212201f2256e9a4c09de3dcd813c26368655b88b36
 
 #include <math.h>
 #include <sndfile.h>
+#include <sys/stat.h>
 #include <time.h>
 
 #include "audio/fileBrowser.h"
+#include "plugins/audio/utils/SampleIndex.h"
 #include "audioPlugin.h"
 #include "mapping.h"
 
 #include "audio/utils/getStepMultiplier.h"
 #include "host/constants.h"
+#include "helpers/pluginEvents.h"
 #include "log.h"
 #include "plugins/audio/utils/ValSerializeSndFile.h"
-#include "audio/utils/applySampleGain.h"
+#include "plugins/audio/utils/SampleLoader.h"
+#include "plugins/audio/utils/SampleStreamer.h"
+#include "plugins/audio/utils/SliceAnalyzer.h"
 
 #include "audio/BandEq.h"
 #include "audio/Grains.h"
@@ -50,16 +55,43 @@ protected:
 
     // Hardcoded to 48000, no matter the sample rate
     static const uint64_t bufferSize = 48000 * 30; // 30sec at 48000Hz, 32sec at 44100Hz...
-    float sampleData[bufferSize];
-    float eqSampleData[bufferSize];
+    // Files are decoded in the background, the audio thread switching to the new one at a block boundary
+    SampleLoader::Slot sampleSlot = SampleLoader::Slot(props.sampleRate, bufferSize);
+    ArenaArray<float> eqSampleData = ArenaArray<float>(props.arena, bufferSize);
     struct SampleBuffer {
         uint64_t count = 0;
-        float* data;
+        const float* data = NULL;
     } sampleBuffer;
+    const WaveformOverview* overview = NULL;
+    uint8_t channels = 1;
+
+    // Slices of the sample, found in the background once it is loaded, NULL until then
+    SliceAnalyzer::Slot sliceSlot;
+    const SliceAnalyzer::SliceMap* slices = NULL;
+    // End of the slice played from a note, see SLICES
+    uint64_t sliceEnd = 0;
+
+    // Files too big to be loaded in memory are played from the disk, the sample buffer being then only their start
+    SampleStreamer::Stream stream = SampleStreamer::Stream(props.sampleRate);
+    uint64_t streamAbove = 16 * 1024 * 1024;
+    bool wantStream = false;
+    bool streaming = false;
+
+    uint64_t streamStart()
+    {
+        return start.pct() * stream.frames();
+    }
+
+    uint64_t streamEnd()
+    {
+        return end.pct() * stream.frames();
+    }
 
-    FileBrowser fileBrowser = FileBrowser(AUDIO_FOLDER + "/samples");
+    FileBrowser fileBrowser = SampleIndex::get().browser(AUDIO_FOLDER + "/samples");
     float indexGrain = 0;
     float indexMain = 0;
+    // Position of the sample last published to the UI
+    PluginEvents::Position position;
     uint64_t indexStart = 0;
     uint64_t indexEnd = 0;
     float stepIncrement = 1.0;
@@ -92,7 +124,7 @@ protected:
     float getEqSample(uint64_t sampleIndex)
     {
         if (eqSampleData[sampleIndex] == resetValue) {
-            eqSampleData[sampleIndex] = bandEq.process(sampleData[sampleIndex]);
+            eqSampleData[sampleIndex] = bandEq.process(sampleBuffer.data[sampleIndex]);
         }
         return eqSampleData[sampleIndex];
     }
@@ -104,6 +136,9 @@ public:
         if (p.value < end.get()) {
             p.val.setFloat(p.value);
             indexStart = p.val.pct() * sampleBuffer.count;
+            if (streaming) {
+                stream.play(stream.position(), streamStart(), streamEnd());
+            }
         }
     });
     /*md - `END` set the end position of the sample */
@@ -111,6 +146,9 @@ public:
         if (p.value > start.get()) {
             p.val.setFloat(p.value);
             indexEnd = p.val.pct() * sampleBuffer.count;
+            if (streaming) {
+                stream.play(stream.position(), streamStart(), streamEnd());
+            }
         }
     });
     /*md - `BROWSER` to browse between samples to play. */
@@ -232,19 +270,30 @@ public:
     /*md - `MIX` set the effect mix vs the original signal.*/
     Val& mix = val(50.0f, "MIX", { "Mix", .unit = "%" });
 
+    /*md - `SLICES` play a slice of the loop on each note, instead of looping it while the sequencer plays: the base note (C4) plays the first slice, each next note the next slice. The slices are found in the background when the sample is loaded, see `SLICES` data. Not available on the files played from the disk.*/
+    Val& sliceNotes = val(0.0f, "SLICES", { "Slices", VALUE_STRING, .max = 1 }, [&](auto p) {
+        p.val.setFloat(p.value);
+        p.val.setString(p.val.get() > 0.0f ? "Notes" : "Off");
+    });
+
     SynthLoop(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
         , bandEq(props.sampleRate)
         , grainBandEq(props.sampleRate)
-        , multiFx(props.sampleRate, props.lookupTable)
-        , grains(props.lookupTable, [this](uint64_t idx) -> float { return sampleData[idx]; })
+        , multiFx(props.sampleRate, props.lookupTable, props.arena)
+        , grains(props.lookupTable, [this]() -> const float* { return sampleBuffer.data; })
     {
-        open(browser.get(), true);
-        initValues();
-
         //md **Config**:
         auto& json = config.json;
 
+        //md - `"streamAboveMb": 16` files bigger than this are played from the disk instead of being loaded in memory, e.g. stems of several minutes. Grains and chunks are not available on them.
+        streamAbove = json.value("streamAboveMb", 16) * 1024ull * 1024ull;
+        //md - `"streamHeadMs": 500` start of the streamed files kept in memory, so they start playing right away.
+        stream.setHeadMs(json.value("streamHeadMs", 500));
+
+        open(browser.get(), true);
+        initValues();
+
         //md - `"samplesFolder": "samples"` set samples folder path.
         if (json.contains("samplesFolder")) {
             fileBrowser.openFolder(json["samplesFolder"].get<std::string>());
@@ -273,10 +322,24 @@ public:
         chunkEnd = chunkStart + chunkSize;
     }
 #endif
+    bool slicing()
+    {
+        return sliceNotes.get() > 0.0f && !streaming;
+    }
+
     void sample(float* buf) override
     {
-        if (!isPlaying)
+        bool sliced = slicing();
+        if (sliced ? indexMain >= sliceEnd : !isPlaying)
+            return;
+
+        if (streaming) {
+            // Read once, no random access for the grains
+            buf[track] = bandEq.process(stream.next(stepIncrement)) * velocity;
+            uint64_t position = stream.position();
+            indexMain = position < sampleBuffer.count ? position : sampleBuffer.count;
             return;
+        }
 
         float mainOut = getEqSample(indexMain);
 
@@ -284,22 +347,27 @@ public:
         grainOut = grains.getGrainSample(stepIncrement, indexGrain, sampleBuffer.count);
 
         indexMain += stepIncrement;
-        if (indexMain >= indexEnd) {
-            indexMain = indexStart;
-        }
+        if (sliced) {
+            // Played once, up to the next slice
+            indexGrain = indexMain;
+        } else {
+            if (indexMain >= indexEnd) {
+                indexMain = indexStart;
+            }
 
 #ifdef ENABLE_CHUNCK_FEATURE
-        indexGrain += stepIncrement;
-        if (chunkCount.get() == 1) {
-            indexGrain = indexMain;
-        } else if (indexGrain >= chunkEnd) {
-            currentChunk = rand() % (uint8_t)chunkCount.get();
-            indexGrain = indexStart + currentChunk * chunkSize;
-            updateChunkBoundaries();
-        }
+            indexGrain += stepIncrement;
+            if (chunkCount.get() == 1) {
+                indexGrain = indexMain;
+            } else if (indexGrain >= chunkEnd) {
+                currentChunk = rand() % (uint8_t)chunkCount.get();
+                indexGrain = indexStart + currentChunk * chunkSize;
+                updateChunkBoundaries();
+            }
 #else
-        indexGrain = indexMain;
+            indexGrain = indexMain;
 #endif
+        }
 
         grainOut = grainBandEq.process(grainOut);
         grainOut = multiFx.apply(grainOut, fxAmount.pct());
@@ -307,8 +375,40 @@ public:
         buf[track] = (mainOut * (1.0f - mix.pct()) + grainOut * mix.pct()) * velocity;
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        swapSample();
+        swapSlices();
+        Mapping::sampleBlock(buf, frames);
+        bool audible = slicing() ? indexMain < sliceEnd : isPlaying;
+        position.publish(this, audible ? indexMain : sampleBuffer.count, sampleBuffer.count);
+    }
+
+    // Take the slices once they are found, only for the sample being played, the analysis possibly ending before
+    // the sample is decoded
+    void swapSlices()
+    {
+        const SliceAnalyzer::SliceMap* map = sliceSlot.get();
+        if (map == slices) {
+            return;
+        }
+        SampleLoader::Sample* loaded = sampleSlot.get();
+        if (!map || (loaded && loaded->buffer && loaded->buffer->path == map->path)) {
+            slices = map;
+        }
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
+        if (slicing() && slices) {
+            int count = slices->count();
+            size_t slice = (((int)note - baseNote) % count + count) % count;
+            indexMain = std::min(slices->start(slice, props.sampleRate, channels), sampleBuffer.count);
+            indexGrain = indexMain;
+            sliceEnd = std::min(slices->end(slice, props.sampleRate, channels), sampleBuffer.count);
+            velocity = _velocity;
+            return;
+        }
         // printf("[%d] drum sample noteOn: %d %f\n", track, note, _velocity);
         // logTrace("drum sample noteOn: %d %f", note, velocity);
         // index = indexStart;
@@ -322,26 +422,64 @@ public:
 
     void open(std::string filename)
     {
-        SF_INFO sfinfo;
-        SNDFILE* file = sf_open(filename.c_str(), SFM_READ, &sfinfo);
-        if (!file) {
-            logDebug("Error: could not open file %s [%s]\n", filename.c_str(), sf_strerror(file));
+        struct stat info;
+        wantStream = stat(filename.c_str(), &info) == 0 && (uint64_t)info.st_size > streamAbove;
+        sliceSlot.analyze(filename);
+        if (wantStream) {
+            stream.open(filename);
             return;
         }
-        logTrace("Audio file %s sampleCount %ld sampleRate %d\n", filename, (long)sfinfo.frames, sfinfo.samplerate);
-        // printf(".................Audio file chan %d vs prop chan %d\n", sfinfo.channels, props.channels);
+        if (paramQueue.isConsumerThread()) {
+            sampleSlot.load(filename);
+            return;
+        }
+        sampleSlot.load(filename, true);
+        useLoadedSample();
+    }
 
-        sampleBuffer.count = sf_read_float(file, sampleData, bufferSize);
-        sampleBuffer.data = sampleData;
+    // Switch to the sample decoded in the background, if any, before rendering or starting a note
+    void swapSample()
+    {
+        // Only the kind of file opened last is used, the other one possibly finishing to load later
+        if (sampleSlot.swap() && !wantStream) {
+            useLoadedSample();
+        }
+        if (stream.swap() && wantStream) {
+            useStream();
+        }
+    }
 
-        sf_close(file);
+    void useStream()
+    {
+        streaming = true;
+        overview = NULL;
+        const std::vector<float>* head = stream.head();
+        sampleBuffer.count = head->size();
+        sampleBuffer.data = head->data();
+        indexStart = start.pct() * sampleBuffer.count;
+        indexEnd = end.pct() * sampleBuffer.count;
+        stream.play(streamStart(), streamStart(), streamEnd());
+    }
 
-        stepMultiplier = getStepMultiplierMonoTrack(sfinfo.channels, props.channels);
+    void useLoadedSample()
+    {
+        SampleLoader::Sample* loaded = sampleSlot.get();
+        if (!loaded) {
+            return;
+        }
+        streaming = false;
+        sampleBuffer.count = loaded->count;
+        sampleBuffer.data = loaded->data;
+        overview = loaded->overview;
+        channels = loaded->channels;
+        sliceEnd = 0;
+        stepMultiplier = getStepMultiplierMonoTrack(loaded->channels, props.channels);
 
         indexMain = sampleBuffer.count;
         indexGrain = sampleBuffer.count;
+        indexStart = start.pct() * sampleBuffer.count;
         indexEnd = end.pct() * sampleBuffer.count;
-        applySampleGain(sampleBuffer.data, sampleBuffer.count);
+        resetEqSampleData();
     }
 
     void open(float value, bool force = false)
@@ -377,6 +515,8 @@ public:
     enum DATA_ID {
         SAMPLE_BUFFER,
         SAMPLE_INDEX,
+        SAMPLE_OVERVIEW,
+        SLICES,
     };
 
     /*md **Data ID**: */
@@ -388,6 +528,12 @@ public:
         /*md - `SAMPLE_INDEX` return the current index of the playing sample */
         if (name == "SAMPLE_INDEX")
             return DATA_ID::SAMPLE_INDEX;
+        /*md - `SAMPLE_OVERVIEW` return the peaks of the current sample, to draw it without reading the samples */
+        if (name == "SAMPLE_OVERVIEW")
+            return DATA_ID::SAMPLE_OVERVIEW;
+        /*md - `SLICES` return the slices of the current sample and its tempo (`SliceAnalyzer::SliceMap`), NULL until they are found */
+        if (name == "SLICES")
+            return DATA_ID::SLICES;
         return atoi(name.c_str());
     }
 
@@ -398,6 +544,10 @@ public:
             return &sampleBuffer;
         case DATA_ID::SAMPLE_INDEX:
             return &indexMain;
+        case DATA_ID::SAMPLE_OVERVIEW:
+            return &overview;
+        case DATA_ID::SLICES:
+            return &slices;
         }
         return NULL;
     }
@@ -34,6 +34,7 @@ sha: 051a8220316eb3c504a36148657aa43d503d507da9d2d3638d9bcba3d4f2d4bd
 #include "audioPlugin.h"
 #include "mapping.h"
 #include "audio/utils/linearInterpolation.h"
+#include "audio/MetalOscillatorBank.h"
 
 /*md
 ## SynthMetalic
@@ -60,9 +61,7 @@ protected:
 
     float tanhLookup(float x)
     {
-        x = CLAMP(x, -1.0f, 1.0f);
-        int index = static_cast<int>((x + 1.0f) * 0.5f * (props.lookupTable->size - 1));
-        return props.lookupTable->tanh[index];
+        return props.lookupTable->getTanh(x);
     }
 
     float sineLookupInterpolated(float x)
@@ -95,8 +94,10 @@ protected:
         return input;
     }
 
+    MetalOscillatorBank metal = MetalOscillatorBank(props.sampleRate);
+
     static constexpr int REVERB_BUFFER_SIZE = 48000; // 1 second buffer at 48kHz
-    float reverbBuffer[REVERB_BUFFER_SIZE] = { 0.0f };
+    ArenaArray<float> reverbBuffer = ArenaArray<float>(props.arena, REVERB_BUFFER_SIZE);
     int reverbIndex = 0;
     float applyReverb(float signal)
     {
@@ -145,6 +146,14 @@ public:
     /*md - ENV_SHAPE controls the shape of the envelope. */
     // Val& envShape = val(0.5f, "ENV_SHAPE", { "Env. Shape", .min = 1 });
     Val& envShape = val(0.5f, "ENV_SHAPE", { "Env. Shape", .min = 0.1, .max = 5.0, .step = 0.1, .floatingPoint = 1 });
+    /*md - METAL mix of the inharmonic squares, the hi-hat and cymbal source, with the tone. */
+    Val& metalMix = val(0.0f, "METAL", { "Metal", .unit = "%" });
+    /*md - METAL_TONE balance of the squares from the body band to the sizzle band. */
+    Val& metalTone = val(50.0f, "METAL_TONE", { "Metal Tone", .unit = "%" }, [&](auto p) {
+        p.val.setFloat(p.value);
+        metal.setBands(p.val.pct(), 0.3f);
+        metal.setTone(p.val.pct());
+    });
 
     SynthMetalic(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
@@ -196,6 +205,10 @@ public:
                 tone *= (1.0f - timbre.pct()) + timbre.pct() * sinf(2.0f * M_PI * freq * 0.5f * t);
             }
 
+            if (metalMix.pct() > 0.0f) {
+                tone += metalMix.pct() * (metal.next() - tone);
+            }
+
             float output = applyBoost(tone, env) * env;
             output = applyReverb(output);
             buf[track] = output;
@@ -219,5 +232,8 @@ public:
         resonatorState = 0.0f;
         noteFreq = baseFreq.get() * powf(2.0f, (note - baseNote) / 12.0f);
         i = 0;
+        // The default base frequency gives the 205.3Hz of the TR-808 lowest square
+        metal.setFrequency(noteFreq * 2.053f);
+        metal.reset();
     }
 };
@@ -7,13 +7,17 @@
 #include "audioPlugin.h"
 #include "mapping.h"
 #include "audio/fileBrowser.h"
+#include "plugins/audio/utils/SampleIndex.h"
 
+#include "helpers/pluginEvents.h"
 #include "helpers/random.h"
 #include "log.h"
 #include "plugins/audio/utils/ValSerializeSndFile.h"
 #include "host/constants.h"
 #include "audio/utils/getStepMultiplier.h"
-#include "audio/utils/applySampleGain.h"
+#include "plugins/audio/utils/SampleLoader.h"
+#include "plugins/audio/utils/SampleInterpolation.h"
+#include "plugins/audio/utils/SampleView.h"
 
 #ifndef MAX_SAMPLE_VOICES
 #define MAX_SAMPLE_VOICES 4
@@ -32,14 +36,16 @@ class SynthMonoSample : public Mapping {
 protected:
     // Hardcoded to 48000, no matter the sample rate
     static const uint64_t bufferSize = 48000 * 30; // 30sec at 48000Hz, 32sec at 44100Hz...
-    float sampleData[bufferSize];
-    struct SampleBuffer {
-        uint64_t count = 0;
-        float* data;
-    } sampleBuffer;
+    // Files are decoded in the background, the audio thread switching to the new one at a block boundary
+    SampleLoader::Slot sampleSlot = SampleLoader::Slot(props.sampleRate, bufferSize, true, SamplePool::AUTO);
+    SampleView sampleBuffer;
+    SampleInterpolation interpolation;
+    const WaveformOverview* overview = NULL;
 
-    FileBrowser fileBrowser = FileBrowser(AUDIO_FOLDER + "/samples");
+    FileBrowser fileBrowser = SampleIndex::get().browser(AUDIO_FOLDER + "/samples");
     float index = 0;
+    // Position of the sample last published to the UI
+    PluginEvents::Position position;
     uint64_t indexStart = 0;
     uint64_t indexEnd = 0;
     uint64_t loopStart = 0;
@@ -160,6 +166,15 @@ public:
 
         //md - `"showLoopSustainInUnit": false` show the calculated number of loop before to finish release (default: true)
         showNumberOfLoopsInUnit = json.value("showLoopSustainInUnit", showNumberOfLoopsInUnit);
+
+        //md - `"interpolation": "linear"` how the sample is read between its frames when pitched: `nearest`, `linear`, `cubic` or `sinc`, the sinc also avoiding aliasing when pitched up. Default is `linear`.
+        interpolation.setKernel(SampleInterpolation::getKernel(json.value("interpolation", "linear")));
+
+        //md - `"compactSamples": true` store the samples as 16 bits integers, half the memory, converted while playing. Default is to store them as float until the sample pool goes over `SAMPLE_POOL_COMPACT_MB`.
+        if (json.contains("compactSamples")) {
+            sampleSlot.setStorage(json["compactSamples"].get<bool>() ? SamplePool::COMPACT : SamplePool::FLOAT);
+            open(browser.get(), true);
+        }
     }
 
     void sample(float* buf) override
@@ -178,7 +193,7 @@ public:
         float out = 0.0f;
         if (sustainedNote || nbOfLoopBeforeRelease > 0) {
             // out = sampleBuffer.data[(int)index] * velocity * envFactor;
-            out = sampleBuffer.data[(int)index] * velocity;
+            out = interpolation.at(sampleBuffer, sampleBuffer.count, sampleBuffer.channels, index) * velocity;
             index += stepIncrement;
             if (index >= loopEnd) {
                 index = loopStart;
@@ -186,7 +201,7 @@ public:
             }
         } else if (index < indexEnd) {
             // out = sampleBuffer.data[(int)index] * velocity * envFactor;
-            out = sampleBuffer.data[(int)index] * velocity;
+            out = interpolation.at(sampleBuffer, sampleBuffer.count, sampleBuffer.channels, index) * velocity;
             index += stepIncrement;
         } else if (index != sampleBuffer.count) {
             index = sampleBuffer.count;
@@ -194,12 +209,27 @@ public:
         buf[track] = out;
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        swapSample();
+        // The whole block at once while it doesn't reach the end of the sample or of the loop
+        bool looping = sustainedNote || nbOfLoopBeforeRelease > 0;
+        if (index + stepIncrement * frames < (looping ? loopEnd : indexEnd)) {
+            index = interpolation.render(sampleBuffer, sampleBuffer.count, sampleBuffer.channels, index, stepIncrement, velocity, trackLane(buf, track), props.frameStride, frames);
+        } else {
+            Mapping::sampleBlock(buf, frames);
+        }
+        position.publish(this, index, sampleBuffer.count);
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
         // printf("[%d] drum sample noteOn: %d %f\n", track, note, _velocity);
         logTrace("drum sample noteOn: %d %f", note, velocity);
+        swapSample();
         index = indexStart;
         stepIncrement = getSampleStep(note);
+        interpolation.setStep(stepIncrement / sampleBuffer.channels);
         velocity = _velocity;
         if (sustainLength.get() > 0.0f) {
             sustainedNote = note;
@@ -217,25 +247,37 @@ public:
 
     void open(std::string filename)
     {
-        SF_INFO sfinfo;
-        SNDFILE* file = sf_open(filename.c_str(), SFM_READ, &sfinfo);
-        if (!file) {
-            logDebug("Error: could not open file %s [%s]\n", filename.c_str(), sf_strerror(file));
+        if (paramQueue.isConsumerThread()) {
+            sampleSlot.load(filename);
             return;
         }
-        logTrace("Audio file %s sampleCount %ld sampleRate %d\n", filename, (long)sfinfo.frames, sfinfo.samplerate);
-        // printf(".................Audio file chan %d vs prop chan %d\n", sfinfo.channels, props.channels);
-
-        sampleBuffer.count = sf_read_float(file, sampleData, bufferSize);
-        sampleBuffer.data = sampleData;
+        sampleSlot.load(filename, true);
+        useLoadedSample();
+    }
 
-        sf_close(file);
+    // Switch to the sample decoded in the background, if any, before rendering or starting a note
+    void swapSample()
+    {
+        if (sampleSlot.swap()) {
+            useLoadedSample();
+        }
+    }
 
-        stepMultiplier = getStepMultiplierMonoTrack(sfinfo.channels, props.channels);
+    void useLoadedSample()
+    {
+        SampleLoader::Sample* loaded = sampleSlot.get();
+        if (!loaded) {
+            return;
+        }
+        sampleBuffer.set(loaded);
+        overview = loaded->overview;
+        stepMultiplier = getStepMultiplierMonoTrack(loaded->channels, props.channels);
 
         index = sampleBuffer.count;
-        indexEnd = end.pct() * sampleBuffer.count;
-        applySampleGain(sampleBuffer.data, sampleBuffer.count);
+        sustainedNote = 0;
+        nbOfLoopBeforeRelease = 0;
+        // Positions and loop points follow the new length
+        initValues();
     }
 
     void open(float value, bool force = false)
@@ -271,6 +313,7 @@ public:
     enum DATA_ID {
         SAMPLE_BUFFER,
         SAMPLE_INDEX,
+        SAMPLE_OVERVIEW,
     };
 
     /*md **Data ID**: */
@@ -282,6 +325,9 @@ public:
         /*md - `SAMPLE_INDEX` return the current index of the playing sample */
         if (name == "SAMPLE_INDEX")
             return DATA_ID::SAMPLE_INDEX;
+        /*md - `SAMPLE_OVERVIEW` return the peaks of the current sample, to draw it without reading the samples */
+        if (name == "SAMPLE_OVERVIEW")
+            return DATA_ID::SAMPLE_OVERVIEW;
         return atoi(name.c_str());
     }
 
@@ -292,6 +338,8 @@ public:
             return &sampleBuffer;
         case DATA_ID::SAMPLE_INDEX:
             return &index;
+        case DATA_ID::SAMPLE_OVERVIEW:
+            return &overview;
         }
         return NULL;
     }
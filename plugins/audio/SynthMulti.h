@@ -137,6 +137,13 @@ public:
         selectedEngine->sample(buf);
     }
 
+    bool hasControlTick() override { return true; }
+
+    void controlTick(uint32_t frameOffset) override
+    {
+        selectedEngine->controlTick(frameOffset);
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
         selectedEngine->noteOn(note, _velocity);
@@ -17,6 +17,7 @@ sha: 183db38d9bc8c270456d82421014fab85502b00a04b2c44f44e23365758ec1e4
 */
 #pragma once
 
+#include "audio/TableBuilder.h"
 #include "plugins/audio/MultiDrumEngine/BassEngine.h"
 #include "plugins/audio/MultiDrumEngine/ClapEngine.h"
 #include "plugins/audio/MultiDrumEngine/Er1PcmEngine.h"
@@ -26,42 +27,188 @@ sha: 183db38d9bc8c270456d82421014fab85502b00a04b2c44f44e23365758ec1e4
 #include "plugins/audio/MultiDrumEngine/PercussionEngine.h"
 #include "plugins/audio/MultiDrumEngine/StringEngine.h"
 #include "plugins/audio/MultiDrumEngine/VolcEngine.h"
+#include "plugins/audio/utils/EngineCache.h"
+#include "plugins/audio/utils/HitCache.h"
+
+#include <memory>
 
 /*md
 ## SynthMultiDrum
 
 Synth engine to generate multiple kind of drum sounds.
+
+Engines are only created when selected, the last used ones being kept alive to switch back to them instantly.
+
+With the hit cache enabled, the hits of the deterministic engines are rendered once in the background and played
+back as samples, as long as the values are not being modulated. Hits not rendered yet, or played while a value is
+changing, are synthesized live.
 */
 
 class SynthMultiDrum : public Mapping {
 protected:
-    MetalicDrumEngine metalDrumEngine;
-    PercussionEngine percEngine;
-    DrumBassEngine bassEngine;
-    ClapEngine clapEngine;
-    KickEngine kickEngine;
-    Er1PcmEngine er1PcmEngine;
-    VolcEngine volcanEngine;
-    FmDrumEngine fmEngine;
-    StringDrumEngine stringEngine;
-
     static const int ENGINES_COUNT = 9;
-    DrumEngine* drumEngines[ENGINES_COUNT] = {
-        &metalDrumEngine,
-        &percEngine,
-        &bassEngine,
-        &clapEngine,
-        &kickEngine,
-        &er1PcmEngine,
-        &volcanEngine,
-        &fmEngine,
-        &stringEngine,
-    };
-    DrumEngine* drumEngine = drumEngines[0];
+
+    // Engines are created after the plugin, so they get their own copy of the config
+    nlohmann::json engineJson;
+    AudioPlugin::Config engineConfig;
+
+    template <typename T>
+    EngineCache<DrumEngine>::Factory factory(std::string name)
+    {
+        return { name, [this] { return new T(props, engineConfig); } };
+    }
+
+    //md **Config**:
+    //md - `"engineCache": 3` number of engines kept alive, to switch back to them instantly. Other engines are created when selected.
+    EngineCache<DrumEngine> drumEngines;
+    DrumEngine* drumEngine = NULL;
+    int engineIndex = 0;
+    // Engine selected from the audio thread while it was not created yet
+    int pendingEngine = -1;
+
+    // The audio thread never waits for an engine to be created: it keeps playing the current one until the
+    // new one is built in the background.
+    void selectEngine(int index)
+    {
+        DrumEngine* next = paramQueue.isConsumerThread() ? drumEngines.tryGet(index) : drumEngines.acquire(index);
+        if (!next) {
+            pendingEngine = index;
+            return;
+        }
+        pendingEngine = -1;
+        drumEngine = next;
+        engineIndex = index;
+        lastChange = frame;
+        drumEngine->initValues();
+
+        // loop through values and update their type
+        copyValues();
+    }
+
+    static const uint8_t VELOCITY_BUCKETS = 8;
+
+    // Engine rendering the hits, only used by the hit cache worker thread
+    std::unique_ptr<DrumEngine> renderEngine;
+    int renderEngineIndex = -1;
+
+    // Declared after the render engine, so its worker is stopped first
+    std::unique_ptr<HitCache> hitCache;
+    HitCache::Head heads[HitCache::HEADS];
+    uint64_t frame = 0;
+    uint64_t lastChange = 0;
+    uint32_t stableFrames = 0;
+    uint32_t tailFrames = 0;
+    // Frames the live engine still has to be rendered for, its output being silent afterward
+    uint32_t liveFrames = 0;
+
+    void renderHit(const HitCache::Request& request, HitCache::Hit& hit)
+    {
+        if (renderEngineIndex != request.engine) {
+            renderEngine.reset(drumEngines.build(request.engine));
+            renderEngine->setValFn = nullptr;
+            renderEngine->initValues();
+            renderEngineIndex = request.engine;
+        }
+        for (int i = 0; i < request.valueCount && i < renderEngine->mapping.size(); i++) {
+            renderEngine->mapping[i]->set(request.values[i]);
+        }
+        // Tables of the new values are built in the background, and swapped in by the first `startBlock()`
+        TableBuilder::get().wait();
+        std::vector<float> frameBuf(renderEngine->track + 1, 0.0f);
+        float& out = frameBuf[renderEngine->track];
+
+        renderEngine->noteOn(request.note, request.velocity);
+        uint32_t hitFrames = renderEngine->totalSamples;
+        uint32_t maxFrames = hitFrames + tailFrames;
+        uint32_t silentFrames = props.sampleRate * 0.1f;
+        uint32_t silent = 0;
+        hit.data.reserve(maxFrames);
+        for (uint32_t f = 0; f < maxFrames && silent < silentFrames; f++) {
+            if (f % 64 == 0) {
+                renderEngine->startBlock();
+            }
+            out = 0.0f;
+            renderEngine->sample(frameBuf.data());
+            hit.data.push_back(out);
+            silent = f >= hitFrames && fabsf(out) < 1e-4f ? silent + 1 : 0;
+        }
+        // Let the tail of the engine die out, so it doesn't leak into the next render
+        for (uint32_t f = 0; f < silentFrames; f++) {
+            out = 0.0f;
+            renderEngine->sample(frameBuf.data());
+        }
+        hit.data.resize(hit.data.size() - silent);
+        hit.hitFrames = hitFrames;
+    }
+
+    HitCache::Request hitRequest(uint8_t note, uint8_t bucket)
+    {
+        HitCache::Request request;
+        request.engine = engineIndex;
+        request.valueCount = std::min(drumEngine->mapping.size(), (size_t)HitCache::MAX_VALUES);
+        for (int i = 0; i < request.valueCount; i++) {
+            request.values[i] = drumEngine->mapping[i]->get();
+        }
+        request.note = note;
+        request.velocity = (bucket + 1) / (float)VELOCITY_BUCKETS;
+        float seed[3] = { (float)request.engine, (float)note, (float)bucket };
+        request.key = HitCache::hash(request.values, request.valueCount, HitCache::hash(seed, 3));
+        return request;
+    }
+
+    // Cut the hits still playing, like a live engine retriggered, but keep their tail (e.g. reverb) ringing.
+    // Return the head to play the next hit on.
+    uint8_t retriggerHeads()
+    {
+        uint8_t next = 0;
+        for (uint8_t h = 0; h < HitCache::HEADS; h++) {
+            if (heads[h].hit && heads[h].position < heads[h].hit->hitFrames) {
+                hitCache->stop(h, heads[h]);
+            }
+            if (!heads[h].hit) {
+                next = h;
+            } else if (heads[next].hit && heads[h].position > heads[next].position) {
+                next = h;
+            }
+        }
+        return next;
+    }
+
+    // Try to play the hit from the cache, else ask for it to be rendered for the next time
+    bool playCachedHit(uint8_t note, float velocity)
+    {
+        if (!drumEngine->isDeterministic() || frame - lastChange < stableFrames) {
+            return false;
+        }
+        uint8_t bucket = std::min((int)(velocity * VELOCITY_BUCKETS), VELOCITY_BUCKETS - 1);
+        HitCache::Request request = hitRequest(note, bucket);
+        uint8_t h = retriggerHeads();
+        if (hitCache->play(request.key, h, heads[h], velocity / request.velocity)) {
+            return true;
+        }
+        hitCache->request(request);
+        return false;
+    }
+
+    float playHeads()
+    {
+        float out = 0.0f;
+        for (uint8_t h = 0; h < HitCache::HEADS; h++) {
+            HitCache::Head& head = heads[h];
+            if (head.hit) {
+                out += head.hit->data[head.position++] * head.gain;
+                if (head.position >= head.hit->data.size()) {
+                    hitCache->stop(h, head);
+                }
+            }
+        }
+        return out;
+    }
 
     void setEngineVal(Val::CallbackProps p, int index)
     {
         p.val.setFloat(p.value);
+        lastChange = frame;
         if (index >= drumEngine->mapping.size())
             return;
         // logDebug("setEngineVal (%d) %s %f", index, p.val.key().c_str(), p.val.get());
@@ -100,12 +247,8 @@ public:
     Val& engine = val(0, "ENGINE", { "Engine", VALUE_STRING, .min = 0, .max = SynthMultiDrum::ENGINES_COUNT - 1, .incType = INC_ONE_BY_ONE }, [&](auto p) {
         p.val.setFloat(p.value);
         int index = (int)p.val.get();
-        drumEngine = drumEngines[index];
-        p.val.setString(drumEngine->name);
-        drumEngine->initValues();
-
-        // loop through values and update their type
-        copyValues();
+        p.val.setString(drumEngines.name(index));
+        selectEngine(index);
     });
 
     struct ValueMap {
@@ -128,31 +271,69 @@ public:
 
     SynthMultiDrum(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
-        , metalDrumEngine(props, config)
-        , percEngine(props, config)
-        , bassEngine(props, config)
-        , clapEngine(props, config)
-        , kickEngine(props, config)
-        , er1PcmEngine(props, config)
-        , volcanEngine(props, config)
-        , fmEngine(props, config)
-        , stringEngine(props, config)
+        , engineJson(config.json)
+        , engineConfig({ config.name, engineJson, config.trackId })
+        , drumEngines({
+                          factory<MetalicDrumEngine>("Metalic"),
+                          factory<PercussionEngine>("Perc"),
+                          factory<DrumBassEngine>("Bass"),
+                          factory<ClapEngine>("Clap"),
+                          factory<KickEngine>("Kick"),
+                          factory<Er1PcmEngine>("ER-1"),
+                          factory<VolcEngine>("Volc"),
+                          factory<FmDrumEngine>("FM"),
+                          factory<StringDrumEngine>("String"),
+                      },
+              config.json.value("engineCache", 3), [this](DrumEngine* engine) { engine->setValFn = setVal; })
     {
+        //md - `"hitCache": 0` number of hits kept rendered, to play the deterministic engines as samples. 0 disables the hit cache.
+        int hitCacheSize = config.json.value("hitCache", 0);
+        if (hitCacheSize > 0) {
+            //md - `"hitCacheStable": 250` milliseconds the values must not change for the hits to come from the cache.
+            stableFrames = props.sampleRate * config.json.value("hitCacheStable", 250.0f) * 0.001f;
+            // Reverb and effects ringing after the hit
+            tailFrames = props.sampleRate * 2;
+            hitCache = std::make_unique<HitCache>(hitCacheSize, [this](const HitCache::Request& request, HitCache::Hit& hit) { renderHit(request, hit); });
+        }
+        drumEngine = drumEngines.acquire(0);
         initValues({ &engine });
+    }
 
-        for (int i = 0; i < 10; i++) {
-            drumEngines[i]->setValFn = setVal;
+    void sample(float* buf) override
+    {
+        if (!hitCache) {
+            drumEngine->sample(buf);
+            return;
         }
-        // bassEngine.setValFn = setVal;
+        frame++;
+        if (liveFrames > 0) {
+            drumEngine->sample(buf);
+            liveFrames--;
+        } else {
+            buf[track] = 0.0f;
+        }
+        buf[track] += playHeads();
     }
 
-    void sample(float* buf) override
+    void sampleBlock(float* buf, uint32_t frames) override
     {
-        drumEngine->sample(buf);
+        if (pendingEngine != -1) {
+            selectEngine(pendingEngine);
+        }
+        drumEngine->startBlock();
+        Mapping::sampleBlock(buf, frames);
+        drumEngines.endBlock();
     }
 
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
+        if (hitCache) {
+            if (playCachedHit(note, _velocity)) {
+                return;
+            }
+            retriggerHeads();
+            liveFrames = props.sampleRate * (drumEngine->duration.get() / 1000.0f) + tailFrames;
+        }
         drumEngine->noteOn(note, _velocity);
     }
 
@@ -164,8 +345,11 @@ public:
 
     void hydrateJson(nlohmann::json& json) override
     {
+        // Built on the hydrating thread, so it is ready when the audio thread selects it
+        int index = hydratedValue(json, engine.key(), engine.get());
+        DrumEngine* hydratedEngine = drumEngines.acquire(CLAMP(index, 0, ENGINES_COUNT - 1), false);
         Mapping::hydrateJson(json);
-        drumEngine->hydrateJson(json);
+        hydratedEngine->hydrateJson(json);
 
         // After hydration copy back value in case something changed
         copyValues();
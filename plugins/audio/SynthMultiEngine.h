@@ -23,6 +23,7 @@ sha: bc9a9247921a8db2cec18e43d82ce4598ba18d41834a0c2eb78112ec76b762cd
 
 #include "plugins/audio/MultiEngine.h"
 #include "helpers/getTicks.h"  // For timing measurement
+#include "plugins/audio/utils/EngineCache.h"
 
 // Synth
 #include "plugins/audio/MultiEngine/Additive2Engine.h"
@@ -55,37 +56,13 @@ sha: bc9a9247921a8db2cec18e43d82ce4598ba18d41834a0c2eb78112ec76b762cd
 ## SynthMultiEngine
 
 Synth engine to generate multiple kind of sounds, from drums, to sample, to synth.
+
+Engines are only created when selected, the last used ones being kept alive to switch back to them instantly. Switching
+engine crossfades from the previous one over a block, so browsing the engines while playing doesn't click.
 */
 
 class SynthMultiEngine : public Mapping {
 protected:
-    // Drum
-    MetalicDrumEngine metalDrumEngine;
-    PercussionEngine percDrumEngine;
-    DrumBassEngine bassDrumEngine;
-    ClapEngine clapDrumEngine;
-    KickEngine kickDrumEngine;
-    VolcEngine volcanDrumEngine;
-    FmDrumEngine fmDrumEngine;
-    StringDrumEngine stringDrumEngine;
-#ifndef SKIP_SNDFILE
-    Er1PcmEngine er1DrumEngine;
-#endif
-
-    // Synth
-    FmEngine fmEngine;
-    AdditiveEngine additiveEngine;
-    Additive2Engine additive2Engine;
-    SuperSawEngine superSawEngine;
-    SpaceShipEngine spaceShipEngine;
-    BassEngine bassEngine;
-    StringEngine stringEngine;
-    ChordEngine chordEngine;
-#ifndef SKIP_SNDFILE
-    WavetableEngine wavetableEngine;
-    Wavetable2Engine wavetable2Engine;
-#endif
-
     static const int VALUE_COUNT = 12;
 #ifndef SKIP_SNDFILE
     static const int DRUMS_ENGINES_COUNT = 9;
@@ -95,35 +72,53 @@ protected:
     static const int SYNTH_ENGINES_COUNT = 8;
 #endif
     static const int ENGINES_COUNT = DRUMS_ENGINES_COUNT + SYNTH_ENGINES_COUNT;
-    MultiEngine* engines[ENGINES_COUNT] = {
-        // Drum
-        &metalDrumEngine,
-        &percDrumEngine,
-        &bassDrumEngine,
-        &clapDrumEngine,
-        &kickDrumEngine,
-        &volcanDrumEngine,
-        &fmDrumEngine,
-        &stringDrumEngine,
-#ifndef SKIP_SNDFILE
-        &er1DrumEngine,
-#endif
 
-        // Synth
-        &fmEngine,
-        &additiveEngine,
-        &additive2Engine,
-        &superSawEngine,
-        &spaceShipEngine,
-        &bassEngine,
-        &stringEngine,
-        &chordEngine,
-    #ifndef SKIP_SNDFILE
-        &wavetableEngine,
-        &wavetable2Engine,
-    #endif
-    };
-    MultiEngine* selectedEngine = engines[0];
+    // Engines are created after the plugin, so they get their own copy of the config
+    nlohmann::json engineJson;
+    AudioPlugin::Config engineConfig;
+
+    template <typename T>
+    EngineCache<MultiEngine>::Factory factory(std::string name)
+    {
+        return { name, [this] { return new T(props, engineConfig); } };
+    }
+
+    //md **Config**:
+    //md - `"engineCache": 3` number of engines kept alive, to switch back to them instantly. Other engines are created when selected.
+    EngineCache<MultiEngine> engines;
+    MultiEngine* selectedEngine = NULL;
+    // Engine selected from the audio thread while it was not created yet, see selectEngine()
+    int pendingEngine = -1;
+
+    // Select an engine, creating it if needed. The audio thread never waits for an engine to be created:
+    // it keeps playing the current one until the new one is built in the background.
+    //
+    // Engines initialize their values when created and keep their state while cached, so switching to one only
+    // points the proxy values to it, and crossfades from the previous one during the next block.
+    void selectEngine(int index)
+    {
+        MultiEngine* next = paramQueue.isConsumerThread() ? engines.tryGet(index) : engines.acquire(index);
+        if (!next) {
+            pendingEngine = index;
+            return;
+        }
+        pendingEngine = -1;
+        if (next == selectedEngine) {
+            return;
+        }
+        unsigned long t0 = getTicks();
+        // Still alive during the next block, even if evicted by this switch, see EngineCache::endBlock(). Switching
+        // again before it, the fade starts from the engine heard last.
+        if (paramQueue.isConsumerThread() && !fadingEngine) {
+            fadingEngine = selectedEngine;
+        }
+        selectedEngine = next;
+
+        engine.props().unit = index < DRUMS_ENGINES_COUNT ? "Drum" : "Synth";
+
+        copyValues();
+        logDebug("Engine switch: copyValues=%lums", getTicks() - t0);
+    }
 
     void setEngineVal(Val::CallbackProps p, int index)
     {
@@ -141,54 +136,70 @@ protected:
         p.val.props().floatingPoint = engineVal->props().floatingPoint;
     }
 
+    // Proxy value `i` is the value `i` of the engine: the string of each value is only formatted once read
     void copyValues()
     {
         for (int i = 0; i < VALUE_COUNT && i < selectedEngine->mapping.size(); i++) {
-            ValueInterface* val = selectedEngine->mapping[i];
-            values[i].val->copy(val);
-            values[i].key = val->key();
+            values[i].val->copy(selectedEngine->mapping[i]);
         }
     }
 
-    SetValFn setVal = [&](std::string key, float value) {
-        for (int i = 0; i < VALUE_COUNT && i < selectedEngine->mapping.size(); i++) {
-            if (values[i].key == key) {
-                values[i].val->set(value);
+    // Bound to each engine when created: only the selected engine reflects its changes on the proxy values, the
+    // slot of each key being looked up once
+    void bindEngine(MultiEngine* target)
+    {
+        std::vector<std::string> keys;
+        for (int i = 0; i < VALUE_COUNT && i < target->mapping.size(); i++) {
+            keys.push_back(target->mapping[i]->key());
+        }
+        target->setValFn = [this, target, keys](std::string key, float value) {
+            if (target != selectedEngine) {
                 return;
             }
+            for (size_t i = 0; i < keys.size(); i++) {
+                if (keys[i] == key) {
+                    values[i].val->set(value);
+                    return;
+                }
+            }
+        };
+    }
+
+    // Engine switched from, rendered once more to crossfade to the new one
+    MultiEngine* fadingEngine = NULL;
+    std::vector<float> fadeInput;
+    std::vector<float> fadeOutput;
+
+    void crossfade(float* buf, uint32_t frames)
+    {
+        const uint32_t stride = props.frameStride;
+        float* lane = trackLane(buf, track);
+        uint32_t count = std::min<uint32_t>(frames, fadeInput.size());
+        // The engines process their input when no voice is playing, so both get the same one
+        for (uint32_t f = 0; f < count; f++) {
+            fadeInput[f] = lane[f * stride];
         }
-        // logDebug("in nulti setVal not found %s", key.c_str());
-        // for (int i = 0; i < VALUE_COUNT; i++) {
-        //     logDebug("%s", values[i].key.c_str());
-        // }
-    };
+        fadingEngine->sampleBlock(buf, count);
+        for (uint32_t f = 0; f < count; f++) {
+            fadeOutput[f] = lane[f * stride];
+            lane[f * stride] = fadeInput[f];
+        }
+        selectedEngine->sampleBlock(buf, frames);
+        for (uint32_t f = 0; f < count; f++) {
+            float g = (float)(f + 1) / count;
+            lane[f * stride] = lane[f * stride] * g + fadeOutput[f] * (1.0f - g);
+        }
+    }
 
 public:
     /*md **Values**: */
 
     /*md - `ENGINE` select the drum engine. */
     Val& engine = val(0, "ENGINE", { .label = "Engine", .type = VALUE_STRING, .min = 0, .max = SynthMultiEngine::ENGINES_COUNT - 1, .unit = "Drum", .incType = INC_ONE_BY_ONE }, [&](auto p) {
-        unsigned long t0 = getTicks();
         p.val.setFloat(p.value);
         int index = (int)p.val.get();
-        if (selectedEngine == engines[index]) {
-            // Engine unchanged, skip expensive re-initialization
-            return;
-        }
-        selectedEngine = engines[index];
-        unsigned long t1 = getTicks();
-        p.val.setString(selectedEngine->name);
-        selectedEngine->initValues();
-        unsigned long t2 = getTicks();
-
-        p.val.props().unit = p.val.get() < DRUMS_ENGINES_COUNT ? "Drum" : "Synth";
-
-        // loop through values and update their type
-        copyValues();
-        unsigned long t3 = getTicks();
-        printf("[TIMING] Engine switch: select=%lums initValues=%lums copyValues=%lums total=%lums\n", 
-               t1-t0, t2-t1, t3-t2, t3-t0);
-        fflush(stdout);
+        p.val.setString(engines.name(index));
+        selectEngine(index);
     });
 
     struct ValueMap {
@@ -211,42 +222,42 @@ public:
 
     SynthMultiEngine(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
-        // Drum
-        , metalDrumEngine(props, config)
-        , percDrumEngine(props, config)
-        , bassDrumEngine(props, config)
-        , clapDrumEngine(props, config)
-        , kickDrumEngine(props, config)
-        , volcanDrumEngine(props, config)
-        , fmDrumEngine(props, config)
-        , stringDrumEngine(props, config)
+        , engineJson(config.json)
+        , engineConfig({ config.name, engineJson, config.trackId })
+        , engines({
+              // Drum
+              factory<MetalicDrumEngine>("Metalic"),
+              factory<PercussionEngine>("Perc"),
+              factory<DrumBassEngine>("Bass"),
+              factory<ClapEngine>("Clap"),
+              factory<KickEngine>("Kick"),
+              factory<VolcEngine>("Volc"),
+              factory<FmDrumEngine>("FM"),
+              factory<StringDrumEngine>("String"),
 #ifndef SKIP_SNDFILE
-        , er1DrumEngine(props, config)
+              factory<Er1PcmEngine>("ER-1"),
 #endif
-        // Synth
-        , fmEngine(props, config)
-        , additiveEngine(props, config)
-        , additive2Engine(props, config)
-        , superSawEngine(props, config)
-        , spaceShipEngine(props, config)
-        , bassEngine(props, config)
-        , stringEngine(props, config)
-        , chordEngine(props, config)
+              // Synth
+              factory<FmEngine>("FM"),
+              factory<AdditiveEngine>("Aditiv"),
+              factory<Additive2Engine>("Aditiv2"),
+              factory<SuperSawEngine>("SuperSaw"),
+              factory<SpaceShipEngine>("Space"),
+              factory<BassEngine>("Bass"),
+              factory<StringEngine>("String"),
+              factory<ChordEngine>("Chord"),
 #ifndef SKIP_SNDFILE
-        , wavetableEngine(props, config)
-        , wavetable2Engine(props, config)
+              factory<WavetableEngine>("Wavtabl"),
+              factory<Wavetable2Engine>("Wavtabl2"),
 #endif
+          },
+              config.json.value("engineCache", 3), [this](MultiEngine* engine) { bindEngine(engine); })
+        , fadeInput(props.blockSize)
+        , fadeOutput(props.blockSize)
     {
+        selectedEngine = engines.acquire(0);
         initValues({ &engine });
 
-        // Ensure each engine knows how to update the shared VAL_x values
-        // (use ENGINES_COUNT, not VALUE_COUNT). VALUE_COUNT is how many
-        // UI values we expose, whereas ENGINES_COUNT is how many engines
-        // we have.
-        for (int i = 0; i < ENGINES_COUNT; i++) {
-            engines[i]->setValFn = setVal;
-        }
-
         // Initialize the engine Val so UI components have the engine
         // name visible immediately when the plugin is created.
         // We intentionally skipped the engine in initValues earlier;
@@ -263,9 +274,31 @@ public:
 
     void sample(float* buf) override
     {
+        fadingEngine = NULL;
         selectedEngine->sample(buf);
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (pendingEngine != -1) {
+            selectEngine(pendingEngine);
+        }
+        if (fadingEngine && fadingEngine != selectedEngine) {
+            crossfade(buf, frames);
+        } else {
+            selectedEngine->sampleBlock(buf, frames);
+        }
+        fadingEngine = NULL;
+        engines.endBlock();
+    }
+
+    bool hasControlTick() override { return true; }
+
+    void controlTick(uint32_t frameOffset) override
+    {
+        selectedEngine->controlTick(frameOffset);
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
         selectedEngine->noteOn(note, _velocity);
@@ -286,29 +319,20 @@ public:
 
     void hydrateJson(nlohmann::json& json) override
     {
+        MultiEngine* hydratedEngine = selectedEngine;
         if (json.contains("engine") && json.contains("engineType")) {
             std::string engineName = json["engine"];
             std::string engineType = json["engineType"];
-            int indexStart = engineType == "Drum" ? 0 : DRUMS_ENGINES_COUNT;
-            for (int i = 0; i < ENGINES_COUNT; i++) {
-                if (engines[i]->name == engineName && i >= indexStart) {
-                    selectedEngine = engines[i];
-                    // Set the value in JSON, so it doesn't get loaded with a different ID.
-                    if (json.contains("values")) {
-                        auto& values = json["values"];
-                        for (int ii = 0; ii < values.size(); ii++) {
-                            std::string key = values[ii]["key"];
-                            if (key == engine.key()) {
-                                values[ii]["value"] = i;
-                            }
-                        }
-                    }
-                    break;
-                }
+            int i = engines.find(engineName, engineType == "Drum" ? 0 : DRUMS_ENGINES_COUNT);
+            if (i != -1) {
+                // Built on the hydrating thread, so it is ready when the audio thread selects it
+                hydratedEngine = engines.acquire(i, false);
+                // Set the value in JSON, so it doesn't get loaded with a different ID.
+                setHydratedValue(json, engine.key(), i);
             }
         }
         Mapping::hydrateJson(json);
-        selectedEngine->hydrateJson(json);
+        hydratedEngine->hydrateJson(json);
 
         // After hydration copy back value in case something changed
         copyValues();
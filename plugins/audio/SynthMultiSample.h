@@ -3,13 +3,13 @@ This component acts as a highly versatile digital sound generator, specifically
 
 ### How It Works
 
-The system manages a collection of four specialized internal processing methods, known as "Engines." These engines include standard playback (Mono), granular synthesis (Grain), amplitude modulation (AM), and time stretching (Stretch). Only one engine is active at a time, allowing the user to select the perfect tool for the desired sound effect.
+The system manages a collection of five specialized internal processing methods, known as "Engines." These engines include standard playback (Mono), granular synthesis (Grain), amplitude modulation (AM), and time stretching (Stretch, and Time Stretch using WSOLA or a phase vocoder). Only one engine is active at a time, allowing the user to select the perfect tool for the desired sound effect.
 
 The component contains a large internal memory buffer capable of holding about 30 seconds of audio data. A built-in file browser allows users to navigate and load external sound files (samples) into this buffer. When a sample is loaded, its properties are analyzed to ensure correct pitch and playback timing.
 
 ### User Interaction and Control
 
-1.  **Engine Selection:** A primary control allows the user to switch instantly between the four different processing engines.
+1.  **Engine Selection:** A primary control allows the user to switch instantly between the five different processing engines.
 2.  **Sample Loading:** Another main control functions as a file selector, letting the user browse and load available samples.
 3.  **Parameter Mapping:** A series of supplementary controls are dynamically assigned. Their exact function changes depending on which Engine is currently active. For instance, if the granular engine is selected, these controls might adjust the size or density of the audio grains.
 4.  **Audio Output:** When a musical note is received (Note On), the currently selected engine processes the sample data based on its specific rules and parameter settings, generating the final audio output heard by the user.
@@ -22,13 +22,17 @@ sha: bcc12e4b4fe0bcf559fcdef577024c4a98e726003cc4b26e49c3a8169179d794
 
 #include "audio/EnvelopDrumAmp.h"
 #include "audio/fileBrowser.h"
+#include "plugins/audio/utils/SampleIndex.h"
 #include "audio/utils/applySampleGain.h"
 #include "host/constants.h"
 #include "plugins/audio/MultiSampleEngine/AmEngine.h"
 #include "plugins/audio/MultiSampleEngine/GrainEngine.h"
 #include "plugins/audio/MultiSampleEngine/MonoEngine.h"
 #include "plugins/audio/MultiSampleEngine/StretchEngine.h"
+#include "plugins/audio/MultiSampleEngine/TimeStretchEngine.h"
 #include "audio/utils/getStepMultiplier.h"
+#include "plugins/audio/utils/EngineCache.h"
+#include "helpers/pluginEvents.h"
 
 #include <sndfile.h>
 
@@ -36,32 +40,63 @@ sha: bcc12e4b4fe0bcf559fcdef577024c4a98e726003cc4b26e49c3a8169179d794
 ## SynthMultiSample
 
 Multiple engines to play with samples.
+
+Engines are only created when selected, the last used ones being kept alive to switch back to them instantly.
+
+The slices of each sample are found in the background when it is loaded, see `SLICES` data, so a loop can be played
+slice by slice from the notes.
 */
 
 class SynthMultiSample : public Mapping {
 protected:
-    MonoEngine monoEngine;
-    GrainEngine grainEngine;
-    AmEngine amEngine;
-    StretchEngine stretchEngine;
-
-    static const int ENGINES_COUNT = 4;
-    SampleEngine* engines[ENGINES_COUNT] = {
-        &monoEngine,
-        &grainEngine,
-        &amEngine,
-        &stretchEngine,
-    };
-    SampleEngine* engine = engines[0];
+    static const int ENGINES_COUNT = 5;
 
     // Hardcoded to 48000, no matter the sample rate
     static const uint64_t bufferSize = 48000 * 30; // 30sec at 48000Hz, 32sec at 44100Hz...
-    float sampleData[bufferSize];
+    ArenaArray<float> sampleData = ArenaArray<float>(props.arena, bufferSize);
     SampleEngine::SampleBuffer sampleBuffer;
     float index = 0.0f;
+    // Position of the sample last published to the UI
+    PluginEvents::Position position;
     float stepMultiplier = 1.0;
 
-    FileBrowser fileBrowser = FileBrowser(AUDIO_FOLDER + "/samples");
+    // Engines are created after the plugin, so they get their own copy of the config
+    nlohmann::json engineJson;
+    AudioPlugin::Config engineConfig;
+
+    template <typename T>
+    EngineCache<SampleEngine>::Factory factory(std::string name)
+    {
+        return { name, [this] { return new T(props, engineConfig, sampleBuffer, index, stepMultiplier); } };
+    }
+
+    //md **Config**:
+    //md - `"engineCache": 2` number of engines kept alive, to switch back to them instantly. Other engines are created when selected.
+    //md - `"sliceNotes": true` each note plays a slice of the sample once, instead of the sample from `START`: the base note (C4) plays the first slice, each next note the next slice. Default is false.
+    EngineCache<SampleEngine> engines;
+    SampleEngine* engine = NULL;
+    // Engine selected from the audio thread while it was not created yet
+    int pendingEngine = -1;
+
+    // The audio thread never waits for an engine to be created: it keeps playing the current one until the
+    // new one is built in the background.
+    void selectEngine(int index)
+    {
+        SampleEngine* next = paramQueue.isConsumerThread() ? engines.tryGet(index) : engines.acquire(index);
+        if (!next) {
+            pendingEngine = index;
+            return;
+        }
+        pendingEngine = -1;
+        engine = next;
+        engine->initValues();
+
+        // loop through values and update their type
+        copyValues();
+    }
+
+    FileBrowser fileBrowser = SampleIndex::get().browser(AUDIO_FOLDER + "/samples");
+    SliceAnalyzer::Slot sliceSlot;
 
     void open(std::string filename)
     {
@@ -76,6 +111,12 @@ protected:
 
         sampleBuffer.count = sf_read_float(file, sampleData, bufferSize);
         sampleBuffer.data = sampleData;
+        sampleBuffer.path = filename;
+        sampleBuffer.channels = std::max(sfinfo.channels, 1);
+        sampleBuffer.rate = sfinfo.samplerate;
+        sampleBuffer.slices = NULL;
+        sampleBuffer.version++;
+        sliceSlot.analyze(filename);
 
         sf_close(file);
 
@@ -126,12 +167,8 @@ public:
     Val& engineVal = val(0, "ENGINE", { "Engine", VALUE_STRING, .min = 0, .max = SynthMultiSample::ENGINES_COUNT - 1, .incType = INC_ONE_BY_ONE }, [&](auto p) {
         p.val.setFloat(p.value);
         int index = (int)p.val.get();
-        engine = engines[index];
-        p.val.setString(engine->name);
-        engine->initValues();
-
-        // loop through values and update their type
-        copyValues();
+        p.val.setString(engines.name(index));
+        selectEngine(index);
     });
 
     /*md - `VAL_1` to browse between samples to play. */
@@ -163,11 +200,18 @@ public:
 
     SynthMultiSample(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
-        , monoEngine(props, config, sampleBuffer, index, stepMultiplier)
-        , grainEngine(props, config, sampleBuffer, index, stepMultiplier)
-        , amEngine(props, config, sampleBuffer, index, stepMultiplier)
-        , stretchEngine(props, config, sampleBuffer, index, stepMultiplier)
+        , engineJson(config.json)
+        , engineConfig({ config.name, engineJson, config.trackId })
+        , engines({
+                      factory<MonoEngine>("Mono"),
+                      factory<GrainEngine>("Grain"),
+                      factory<AmEngine>("AM"),
+                      factory<StretchEngine>("Stretch"),
+                      factory<TimeStretchEngine>("Time Stretch"),
+                  },
+              config.json.value("engineCache", 2))
     {
+        engine = engines.acquire(0);
         initValues({ &engineVal });
     }
 
@@ -176,6 +220,21 @@ public:
         engine->sample(buf);
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (pendingEngine != -1) {
+            selectEngine(pendingEngine);
+        }
+        // Only the slices of the sample being played, the analysis of the previous one possibly ending after
+        const SliceAnalyzer::SliceMap* slices = sliceSlot.get();
+        if (slices != sampleBuffer.slices && (!slices || slices->path == sampleBuffer.path)) {
+            sampleBuffer.slices = slices;
+        }
+        Mapping::sampleBlock(buf, frames);
+        engines.endBlock();
+        position.publish(this, index, sampleBuffer.count);
+    }
+
     void noteOn(uint8_t note, float _velocity, void* userdata = NULL) override
     {
         engine->noteOn(note, _velocity);
@@ -195,6 +254,9 @@ public:
 
     void hydrateJson(nlohmann::json& json) override
     {
+        // Built on the hydrating thread, so it is ready when the audio thread selects it
+        int engineIndex = hydratedValue(json, engineVal.key(), engineVal.get());
+        SampleEngine* hydratedEngine = engines.acquire(CLAMP(engineIndex, 0, ENGINES_COUNT - 1), false);
         Mapping::hydrateJson(json);
         if (json.contains("sampleFile")) {
             int position = fileBrowser.find(json["sampleFile"]);
@@ -203,7 +265,7 @@ public:
             }
         }
 
-        engine->hydrateJson(json);
+        hydratedEngine->hydrateJson(json);
         // After hydration copy back value in case something changed
         copyValues();
     }
@@ -211,6 +273,7 @@ public:
     enum DATA_ID {
         SAMPLE_BUFFER,
         SAMPLE_INDEX,
+        SLICES,
     };
 
     /*md **Data ID**: */
@@ -222,6 +285,9 @@ public:
         /*md - `SAMPLE_INDEX` return the current index of the playing sample */
         if (name == "SAMPLE_INDEX")
             return DATA_ID::SAMPLE_INDEX;
+        /*md - `SLICES` return the slices of the current sample and its tempo (`SliceAnalyzer::SliceMap`), NULL until they are found */
+        if (name == "SLICES")
+            return DATA_ID::SLICES;
         return atoi(name.c_str());
     }
 
@@ -232,6 +298,8 @@ public:
             return &sampleBuffer;
         case DATA_ID::SAMPLE_INDEX:
             return &index;
+        case DATA_ID::SLICES:
+            return &sampleBuffer.slices;
         }
         return NULL;
     }
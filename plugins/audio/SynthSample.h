@@ -3,13 +3,13 @@ This C++ header file defines a digital musical instrument engine called `SynthSa
 
 **Core Functionality:**
 
-1.  **Audio File Management:** The engine loads a single audio file (the "sample") selected via an internal file browser. It reserves a large memory space (up to 30 seconds of audio) and normalizes the audio volume to ensure consistent playback levels.
+1.  **Audio File Management:** The engine loads a single audio file (the "sample") selected via an internal file browser. The file (up to 30 seconds of audio) is decoded in the background and its volume normalized to ensure consistent playback levels, the engine switching to it between two audio blocks so browsing never interrupts playback.
 
 2.  **Playback Definition:** Users can precisely control how the sample is played back using percentage-based controls:
     *   **Start and End:** Define the exact segment of the audio file to be used.
     *   **Sustain Looping:** Set a specific loop section (position and length) that repeats continuously while a key is held down (Note On). When the key is released (Note Off), the loop stops after an adjustable delay, allowing the sound to decay naturally.
 
-3.  **Multi-Voice Architecture:** The system supports playing the same sample on up to four independent "voices" simultaneously. This allows multiple notes to be held or layered at the same time.
+3.  **Multi-Voice Architecture:** The system supports playing the same sample on up to four independent "voices" simultaneously. This allows multiple notes to be held or layered at the same time. Only the playing voices are rendered, and when all of them are busy the oldest one is stolen.
 
 4.  **Density Effect (Sub-Voices):** This is a key sound design feature. Each primary voice can be split into up to 12 internal "sub-voices." These sub-voices are triggered sequentially with minute, adjustable, and randomized delays. This "Density" process creates thick, layered, and textural sound effects from a single initial sound event.
 
@@ -27,11 +27,17 @@ sha: 0d9d3cc961a654c792000dbc4b05914fe9e9a985da5d856a41d0c7677c7d5ad7
 
 #include "audioPlugin.h"
 #include "audio/fileBrowser.h"
+#include "plugins/audio/utils/SampleIndex.h"
 #include "mapping.h"
 
 #include "helpers/random.h"
 #include "log.h"
 #include "plugins/audio/utils/ValSerializeSndFile.h"
+#include "plugins/audio/utils/SampleLoader.h"
+#include "plugins/audio/utils/SampleInterpolation.h"
+#include "plugins/audio/utils/SampleView.h"
+#include "plugins/audio/utils/StateSnapshot.h"
+#include "plugins/audio/utils/VoiceAllocator.h"
 #include "host/constants.h"
 #include "audio/utils/getStepMultiplier.h"
 
@@ -52,44 +58,25 @@ class SynthSample : public Mapping {
 protected:
     // Hardcoded to 48000, no matter the sample rate
     static const uint64_t bufferSize = 48000 * 30; // 30sec at 48000Hz, 32sec at 44100Hz...
-    float sampleData[bufferSize];
-    struct SampleBuffer {
-        uint64_t count = 0;
-        float* data;
-    } sampleBuffer;
+    // Files are decoded in the background, the audio thread switching to the new one at a block boundary
+    SampleLoader::Slot sampleSlot = SampleLoader::Slot(props.sampleRate, bufferSize, true, SamplePool::AUTO);
+    SampleView sampleBuffer;
+    SampleInterpolation interpolation;
+    const WaveformOverview* overview = NULL;
 
-    FileBrowser fileBrowser = FileBrowser(AUDIO_FOLDER + "/samples");
+    FileBrowser fileBrowser = SampleIndex::get().browser(AUDIO_FOLDER + "/samples");
 
     // Use to restore sustain in case it was move by another parameter
     float sustainPositionOrigin = 0.0f;
     float sustainLengthOrigin = -1.0f;
     bool skipOrigin = false; // Used as point to skip set origin
 
-    int densityDelaySampleCount = 48000 * 0.1; // 100ms at 48000Hz
+    int densityDelaySampleCount = props.sampleRate * 0.1; // 100ms
 
     Random random;
 
-    void applyGain()
-    {
-        // TODO use utils --> applyGain(sampleBuffer.data, sampleBuffer.count);
-        float max = 0.0;
-        for (uint64_t i = 0; i < sampleBuffer.count; i++) {
-            if (sampleBuffer.data[i] > max) {
-                max = sampleBuffer.data[i];
-            } else if (-sampleBuffer.data[i] > max) {
-                max = -sampleBuffer.data[i];
-            }
-        }
-        float gain = 1.0 / max;
-        // printf("max sample: %f gain: %f\n", max, gain);
-        for (uint64_t i = 0; i < sampleBuffer.count; i++) {
-            sampleBuffer.data[i] = sampleBuffer.data[i] * gain;
-        }
-    }
-
     struct Voice {
         int8_t note = -1;
-        uint64_t index = 0;
         bool release = false;
         float velocity = 1.0f;
         int sustainReleaseLoopCount = 0;
@@ -100,9 +87,23 @@ protected:
             int delay = 0;
         } sub[MAX_SAMPLE_DENSITY];
     } voices[MAX_SAMPLE_VOICES];
-    uint64_t voiceIndexCounter = 0;
+    // Only the playing voices are rendered, a voice that finished being given back on the next block
+    VoiceAllocator<MAX_SAMPLE_VOICES> allocator;
     bool voiceAllowSameNote = true;
 
+    void releaseFinishedVoices()
+    {
+        for (int i = allocator.count() - 1; i >= 0; i--) {
+            uint8_t v = allocator.get(i);
+            if (voices[v].note == -1) {
+                allocator.release(v);
+            }
+        }
+    }
+
+    // Active voices from which the voices are rendered in parallel groups, 0 to never split them
+    uint8_t voiceGroupThreshold = 0;
+
     void voiceStart(Voice& voice)
     {
         voice.release = false;
@@ -178,7 +179,7 @@ protected:
 
         if (sub.position < sampleProps.end) {
             if (sub.position >= sampleProps.start) {
-                out = sampleBuffer.data[(uint64_t)sub.position] * voice.velocity;
+                out = interpolation.at(sampleBuffer, sampleBuffer.count, sampleBuffer.channels, sub.position) * voice.velocity;
             }
             voice.finished = false;
             sub.position += voice.step;
@@ -203,31 +204,8 @@ protected:
 
     Voice& getNextVoice(uint8_t note)
     {
-        if (!voiceAllowSameNote) {
-            // First, we should look if the voice is not already running, due to the envelopRelease
-            for (uint8_t v = 0; v < MAX_SAMPLE_VOICES; v++) {
-                Voice& voice = voices[v];
-                if (voice.note == note) {
-                    logDebug("getNextVoice: voice already running %d\n", note);
-                    return voice;
-                }
-            }
-        }
-
-        // Else, we should look for a free voice
-        uint8_t voiceToSteal = 0;
-        for (uint8_t v = 0; v < MAX_SAMPLE_VOICES; v++) {
-            Voice& voice = voices[v];
-            if (voice.note == -1) {
-                return voice;
-            }
-            if (voice.index < voices[voiceToSteal].index) {
-                voiceToSteal = v;
-            }
-        }
-
-        logDebug("getNextVoice: no voice available. Steal voice %d.\n", voiceToSteal);
-        return voices[voiceToSteal];
+        releaseFinishedVoices();
+        return voices[allocator.allocate(note)];
     }
 
     uint8_t baseNote = 60;
@@ -286,33 +264,112 @@ public:
 
         //md - `"voiceAllowSameNote": false` toggle voice playing the same note. If true, same note can be played at the same time on different voices. Default is `true`.
         voiceAllowSameNote = json.value("voiceAllowSameNote", voiceAllowSameNote);
+        allocator.setPolicy(voiceAllowSameNote ? VoiceAllocator<MAX_SAMPLE_VOICES>::STEAL_OLDEST : VoiceAllocator<MAX_SAMPLE_VOICES>::STEAL_SAME_NOTE);
 
         //md - `"baseNote": 52` set the base note. The base note is used to determine how many semitone must be added compare to the original sample. Default is `60` (middle C).
         baseNote = json.value("baseNote", baseNote);
+
+        //md - `"voiceGroupThreshold": 3` when at least this number of voices are playing, render them in parallel on the host voice workers (see `voiceWorkers` host config). Default is `0`, disabled.
+        voiceGroupThreshold = json.value("voiceGroupThreshold", voiceGroupThreshold);
+
+        //md - `"interpolation": "linear"` how the sample is read between its frames when pitched: `nearest`, `linear`, `cubic` or `sinc`, the sinc also avoiding aliasing when pitched up (its cutoff follows the last note played). Default is `linear`.
+        interpolation.setKernel(SampleInterpolation::getKernel(json.value("interpolation", "linear")));
+
+        //md - `"compactSamples": true` store the samples as 16 bits integers, half the memory, converted while playing. Default is to store them as float until the sample pool goes over `SAMPLE_POOL_COMPACT_MB`.
+        if (json.contains("compactSamples")) {
+            sampleSlot.setStorage(json["compactSamples"].get<bool>() ? SamplePool::COMPACT : SamplePool::FLOAT);
+            open(browser.get(), true);
+        }
+
+        sampleStates.init([](std::vector<SampleState>& states) { states.reserve(MAX_SAMPLE_VOICES * MAX_SAMPLE_DENSITY); });
+    }
+
+    // Half the voices for each level
+    void setQualityLevel(uint8_t level) override
+    {
+        allocator.setLimit(MAX_SAMPLE_VOICES >> level);
+    }
+
+    // One group per playing voice, the `i`th playing voice being rendered by group `i % groups`
+    uint8_t voiceGroups() override
+    {
+        swapSample();
+        if (voiceGroupThreshold == 0) {
+            return 1;
+        }
+        releaseFinishedVoices();
+        uint8_t active = allocator.count();
+        return active >= voiceGroupThreshold ? active : 1;
+    }
+
+    void sampleVoiceGroup(uint8_t group, uint8_t groups, float* out, uint32_t frames) override
+    {
+        for (uint32_t f = 0; f < frames; f++) {
+            out[f] = 0.0f;
+        }
+        // The playing voices don't change while the groups are rendered, finished ones being released on the next block
+        for (uint8_t i = group; i < allocator.count(); i += groups) {
+            Voice& voice = voices[allocator.get(i)];
+            for (uint32_t f = 0; f < frames && voice.note != -1; f++) {
+                out[f] += sample(voice);
+            }
+        }
     }
 
     void sample(float* buf)
     {
         float out = 0.0f;
-        for (uint8_t v = 0; v < MAX_SAMPLE_VOICES; v++) {
-            Voice& voice = voices[v];
-            if (voice.note != -1) {
-                out += sample(voice);
+        for (int i = allocator.count() - 1; i >= 0; i--) {
+            uint8_t v = allocator.get(i);
+            if (voices[v].note != -1) {
+                out += sample(voices[v]);
+            }
+            if (voices[v].note == -1) {
+                allocator.release(v);
             }
         }
         buf[track] = out;
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        swapSample();
+        Mapping::sampleBlock(buf, frames);
+    }
+
+    // After each block, whether it was rendered by `sampleBlock()` or by the voice groups
+    void publishState() override
+    {
+        Mapping::publishState();
+        publishSampleStates();
+    }
+
+    uint32_t tailFrames() override
+    {
+        return 0;
+    }
+
+    bool isActive() override
+    {
+        for (uint8_t i = 0; i < allocator.count(); i++) {
+            if (voices[allocator.get(i)].note != -1) {
+                return true;
+            }
+        }
+        return false;
+    }
+
     void noteOn(uint8_t note, float velocity, void* userdata = NULL) override
     {
         logTrace("should play noteOn: %d %d\n", note, velocity);
         if (velocity == 0) {
             return noteOff(note, velocity);
         }
+        swapSample();
         Voice& voice = getNextVoice(note);
-        voice.index = voiceIndexCounter++;
         voice.note = note;
         voice.step = getSampleStep(note);
+        interpolation.setStep(voice.step / sampleBuffer.channels);
         voice.velocity = velocity;
         voiceStart(voice);
         // TODO attack softly if start after beginning of file
@@ -321,8 +378,8 @@ public:
 
     void noteOff(uint8_t note, float velocity, void* userdata = NULL) override
     {
-        for (uint8_t v = 0; v < MAX_SAMPLE_VOICES; v++) {
-            Voice& voice = voices[v];
+        for (uint8_t i = 0; i < allocator.count(); i++) {
+            Voice& voice = voices[allocator.get(i)];
             if (voice.note == note) {
                 voice.release = true;
                 voice.sustainReleaseLoopCount = 0;
@@ -347,27 +404,42 @@ public:
 
     void open(std::string filename)
     {
-        SF_INFO sfinfo;
-        SNDFILE* file = sf_open(filename.c_str(), SFM_READ, &sfinfo);
-        if (!file) {
-            logDebug("Error: could not open file %s [%s]\n", filename.c_str(), sf_strerror(file));
+        if (paramQueue.isConsumerThread()) {
+            sampleSlot.load(filename);
             return;
         }
-        logTrace("Audio file %s sampleCount %ld sampleRate %d\n", filename, (long)sfinfo.frames, sfinfo.samplerate);
-        // printf(".................Audio file chan %d vs prop chan %d\n", sfinfo.channels, props.channels);
+        sampleSlot.load(filename, true);
+        useLoadedSample();
+    }
 
-        sampleBuffer.count = sf_read_float(file, sampleData, bufferSize);
-        sampleBuffer.data = sampleData;
+    // Switch to the sample decoded in the background, if any, before rendering or starting a note
+    void swapSample()
+    {
+        if (sampleSlot.swap()) {
+            useLoadedSample();
+        }
+    }
 
-        sf_close(file);
+    void useLoadedSample()
+    {
+        SampleLoader::Sample* loaded = sampleSlot.get();
+        if (!loaded) {
+            return;
+        }
+        // The voices were playing the previous sample
+        for (Voice& voice : voices) {
+            voice.note = -1;
+        }
+        allocator.releaseAll();
 
-        stepMultiplier = getStepMultiplierMonoTrack(sfinfo.channels, props.channels);
+        sampleBuffer.set(loaded);
+        overview = loaded->overview;
+        stepMultiplier = getStepMultiplierMonoTrack(loaded->channels, props.channels);
 
         // FIXME
         // ValSerializeSndFile serialize(mapping);
         // serialize.loadSetting(filename);
 
-        applyGain();
         setSampleProps();
     }
 
@@ -480,9 +552,43 @@ protected:
         int index = 0;
         float release = 1.0f;
     };
-    std::vector<SampleState> sampleStates;
+    // Published by the audio thread at the end of each block, acquired by the UI
+    StateSnapshot<std::vector<SampleState>> sampleStates;
+
+    void publishSampleStates()
+    {
+        std::vector<SampleState>& states = sampleStates.back();
+        // Reserved for all the sub voices, so it never allocates
+        states.clear();
+        uint8_t densityUint8 = density.get();
+        for (uint8_t v = 0; v < MAX_SAMPLE_VOICES; v++) {
+            Voice& voice = voices[v];
+            if (voice.note != -1) {
+                for (uint8_t d = 0; d < densityUint8; d++) {
+                    SampleState sampleState;
+                    sampleState.index = v * densityUint8 + d;
+                    sampleState.position = CLAMP(voice.sub[d].position / sampleProps.end, 0.0f, 1.0f);
+                    sampleState.release = voice.release ? 1 - voice.sub[d].position / sampleProps.end : 1.0f;
+                    states.push_back(sampleState);
+                }
+            }
+        }
+        sampleStates.publish();
+    }
 
 public:
+    /*md **Data ID**: */
+    uint8_t getDataId(std::string name) override
+    {
+        /*md - `SAMPLE_BUFFER` return a representation of the current sample loaded in buffer */
+        if (name == "SAMPLE_BUFFER")
+            return 0;
+        /*md - `SAMPLE_OVERVIEW` return the peaks of the current sample, to draw it without reading the samples */
+        if (name == "SAMPLE_OVERVIEW")
+            return 3;
+        return atoi(name.c_str());
+    }
+
     void* data(int id, void* userdata = NULL)
     {
         switch (id) {
@@ -497,23 +603,11 @@ public:
             }
             return NULL;
         }
-        case 2: {
-            sampleStates.clear();
-            for (uint8_t v = 0; v < MAX_SAMPLE_VOICES; v++) {
-                Voice& voice = voices[v];
-                if (voice.note != -1) {
-                    uint8_t densityUint8 = density.get();
-                    for (uint8_t d = 0; d < densityUint8; d++) {
-                        SampleState sampleState;
-                        sampleState.index = v * densityUint8 + d;
-                        sampleState.position = CLAMP(voice.sub[d].position / sampleProps.end, 0.0f, 1.0f);
-                        sampleState.release = voice.release ? 1 - voice.sub[d].position / sampleProps.end : 1.0f;
-                        sampleStates.push_back(sampleState);
-                    }
-                }
-            }
-            return &sampleStates;
-        }
+        case 2:
+            // Valid until the next call
+            return (void*)&sampleStates.acquire();
+        case 3:
+            return &overview;
         }
         return NULL;
     }
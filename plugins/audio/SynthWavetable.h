@@ -213,6 +213,11 @@ public:
     {
         wave.props().max = wavetable.fileBrowser.count - 1;
         initValues();
+
+        //md - `"preloadWavetables": true` load all the wavetables in the background when the plugin is created, so browsing them is instant. They are shared by all the plugins. Default is `false`.
+        if (config.json.value("preloadWavetables", false)) {
+            wavetable.preload();
+        }
     }
 
     float lastInvEnv = -111.0f;
@@ -3,13 +3,15 @@ This code defines an advanced audio component called `TapeRecording`. This plugi
 
 ### How It Works
 
-1.  **Recording Process:** When recording begins, the audio data from the chosen track is collected into an internal memory buffer. To ensure the main audio performance isn't disrupted, the plugin uses a dedicated, separate background operation (a "writer thread"). This background process constantly monitors the memory buffer, takes chunks of recorded audio, and safely writes them to a temporary standard WAV file on the disk. This writing process limits the recording size to a configurable maximum, typically 200MB.
+1.  **Recording Process:** When recording begins, the audio data from the chosen track is pushed into a fixed-size lock-free ring, so the audio thread never allocates nor waits. To ensure the main audio performance isn't disrupted, the plugin uses a dedicated, separate background operation (a "writer thread"), woken each time a large chunk is ready. It writes the chunks to a temporary standard WAV file on the disk, preallocated ahead of the writes and flushed regularly, so a long recording takes a constant amount of memory. This writing process limits the recording size to a configurable maximum, typically 200MB.
 
-2.  **Playback and Control:** The plugin monitors global audio events (like Start, Stop, or Pause). When instructed to play, it opens the temporary recording file and streams the captured audio data back into the system, routing it to a specified output track.
+2.  **Playback and Control:** The plugin monitors global audio events (like Start, Stop, or Pause). When instructed to play, it streams the temporary recording file back into the system, routing it to a specified output track. The file is read ahead of the playhead by the sample streamer thread, so the audio thread never touches the disk, and jumping to another position crossfades between two streams.
 
-3.  **Configuration:** Users can configure various parameters, including the specific track number being recorded, the storage folder path for files, and the maximum allowable recording size.
+3.  **Stems:** Instead of a single track, the plugin can record several tracks, or all of them, in one pass: one memory copy per block and per track on the audio thread, a single writer thread, and either one multi-channel file or one file per track.
 
-4.  **Saving:** The plugin provides a utility to save segments of the temporary recording permanently. Users can specify a starting and ending point, and the system will copy only that portion into a new, final WAV file with a desired name.
+4.  **Configuration:** Users can configure various parameters, including the specific track number being recorded, the stems, the storage folder path for files, and the maximum allowable recording size.
+
+5.  **Saving:** The plugin provides a utility to save segments of the temporary recording permanently. Users can specify a starting and ending point, and the system will copy only that portion into a new, final WAV file with a desired name.
 
 In essence, `TapeRecording` acts as a seamless loop recorder and editor for a single track's audio history.
 
@@ -21,18 +23,25 @@ sha: 1d1d3364a9c096cea13fc833ca7ef7a2a09f5c6a2a905950573342c8b66f040d
 #include "log.h"
 #include "mapping.h"
 #include "audio/audioFile.h"
+#include "helpers/SpscRing.h"
+#include "plugins/audio/utils/SampleStreamer.h"
 
+#include <atomic>
+#include <chrono>
+#include <fcntl.h>
 #include <filesystem>
-#include <mutex>
+#include <memory>
+#include <poll.h>
 #include <sndfile.h>
-#include <stdexcept>
+#include <sys/eventfd.h>
 #include <thread>
+#include <unistd.h>
 #include <vector>
 
 /*md
 ## TapeRecording
 
-TapeRecording plugin is used to record audio buffer for a given track.
+TapeRecording plugin is used to record audio buffer for a given track, or several tracks at once as stems.
 */
 
 // TODO provide a way to start recording at the next bar
@@ -41,20 +50,38 @@ class TapeRecording : public Mapping {
 protected:
     std::string folder = "samples";
     std::string filename = "track";
-    SNDFILE* sndfile = nullptr;
-    SNDFILE* playSndfile = nullptr;
     std::thread writerThread;
-    bool loopRunning = true;
+    std::atomic<bool> loopRunning = false;
     uint8_t trackPlayback = 0;
     int fileUpdateState = 0;
 
-    std::vector<float> buffer;
+    // Written in chunks of 64KB, preallocated 16MB ahead and flushed every second
+    static const uint32_t WRITE_CHUNK = 16384;
+    static const off_t PREALLOCATE = 16 * 1024 * 1024;
+    static constexpr std::chrono::seconds SYNC_INTERVAL = std::chrono::seconds(1);
+
+    // More than 5 seconds at 48kHz, for the writes stalled by the SD card
+    typedef SpscRing<float, 1 << 18> Ring;
+    // One per recorded track: the track of `TRACK`, or each stem
+    std::vector<std::unique_ptr<Ring>> rings;
+    // Tracks recorded in stem mode, empty when recording the track of `TRACK`
+    std::vector<uint8_t> stems;
+    // One file per stem instead of a single file with a channel per stem
+    bool stemFiles = false;
+    // Wakes the writer each time a chunk is ready
+    int wakeFd = -1;
+    uint32_t sinceWake = 0;
+    // Samples lost because the ring was full, logged by the writer
+    std::atomic<uint32_t> dropped = 0;
 
     size_t maxSamples = (200 * 1024 * 1024) / sizeof(float); // 200MB
 
+    // Empty for `tape_tmp` in the folder
+    std::string tmpFolder;
+
     std::string getTmpFolder()
     {
-        return folder + "/tape_tmp/";
+        return tmpFolder.empty() ? folder + "/tape_tmp/" : tmpFolder + "/";
     }
 
     std::string getTmpFilePath()
@@ -62,39 +89,243 @@ protected:
         return getTmpFolder() + filename + ".wav";
     }
 
-    void writerLoop()
+    // Temporary files of the recording: one, or one per stem
+    std::vector<std::string> getTmpFilePaths()
     {
-        std::string filepath = getTmpFilePath();
+        if (stems.empty()) {
+            return { getTmpFilePath() };
+        }
+        if (!stemFiles) {
+            return { getTmpFolder() + filename + "_stems.wav" };
+        }
+        std::vector<std::string> paths;
+        for (uint8_t stem : stems) {
+            paths.push_back(getTmpFolder() + filename + "_" + std::to_string(stem) + ".wav");
+        }
+        return paths;
+    }
 
-        std::filesystem::create_directories(getTmpFolder());
+    struct Output {
+        int fd = -1;
+        SNDFILE* file = NULL;
+        off_t written = 0;
+        off_t allocated = 0;
+    };
 
+    bool openOutput(Output& output, std::string path, int channels)
+    {
+        output.fd = open(path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
         SF_INFO sfinfo;
         sfinfo.format = SF_FORMAT_WAV | SF_FORMAT_FLOAT;
-        sfinfo.channels = props.channels;
+        sfinfo.channels = channels;
         sfinfo.samplerate = props.sampleRate;
-        sndfile = sf_open(filepath.c_str(), SFM_WRITE, &sfinfo);
-        if (!sndfile) {
-            throw std::runtime_error("Failed to open audio file for writing");
-        }
-
-        size_t sampleCount = 0;
-        while (loopRunning && sampleCount < maxSamples) {
-            if (buffer.size() > 1024) {
-                sf_write_float(sndfile, buffer.data(), 1024);
-                buffer.erase(buffer.begin(), buffer.begin() + 1024);
-                sampleCount += 1024;
-                fileUpdateState++;
+        output.file = output.fd < 0 ? NULL : sf_open_fd(output.fd, SFM_WRITE, &sfinfo, SF_TRUE);
+        if (!output.file) {
+            logError("TapeRecording: failed to open %s for writing", path.c_str());
+            if (output.fd >= 0) {
+                close(output.fd);
+            }
+            return false;
+        }
+        return true;
+    }
+
+    void writeOutput(Output& output, const float* data, uint32_t count)
+    {
+        // Keep the file size so the header stays right, the blocks being only reserved
+        output.written += count * sizeof(float);
+        if (output.written > output.allocated) {
+            if (fallocate(output.fd, FALLOC_FL_KEEP_SIZE, output.allocated, PREALLOCATE) == 0) {
+                output.allocated += PREALLOCATE;
+            } else {
+                output.allocated = (off_t)maxSamples * sizeof(float);
+            }
+        }
+        sf_write_float(output.file, data, count);
+    }
+
+    void wakeWriter()
+    {
+        uint64_t one = 1;
+        if (write(wakeFd, &one, sizeof(one)) < 0) {
+            // Counter saturated, the writer is awake anyway
+        }
+    }
+
+    void writerLoop()
+    {
+        std::filesystem::create_directories(getTmpFolder());
+
+        std::vector<std::string> paths = getTmpFilePaths();
+        // Stems in a single file, a channel each
+        uint32_t lanes = paths.size() < rings.size() ? rings.size() : 1;
+        std::vector<Output> outputs(paths.size());
+        for (size_t i = 0; i < paths.size(); i++) {
+            if (!openOutput(outputs[i], paths[i], lanes)) {
+                for (size_t j = 0; j < i; j++) {
+                    sf_close(outputs[j].file);
+                }
+                loopRunning = false;
+                return;
+            }
+        }
+
+        std::vector<float> chunk(WRITE_CHUNK * lanes);
+        std::vector<float> lane(lanes > 1 ? WRITE_CHUNK : 0);
+        // Frames of each ring, the size cap being per file
+        size_t frameCount = 0;
+        size_t maxFrames = maxSamples / lanes;
+        auto lastSync = std::chrono::steady_clock::now();
+        struct pollfd pfd = { wakeFd, POLLIN, 0 };
+        while (frameCount < maxFrames) {
+            bool running = loopRunning;
+            uint32_t available = UINT32_MAX;
+            for (auto& ring : rings) {
+                available = std::min(available, ring->available());
+            }
+            // Full chunks while recording, the rest once stopped
+            if (available < WRITE_CHUNK && running) {
+                if (poll(&pfd, 1, 100) > 0) {
+                    uint64_t count;
+                    if (read(wakeFd, &count, sizeof(count)) < 0) {
+                        // Nothing to read, the ring is checked anyway
+                    }
+                }
+                continue;
+            }
+            uint32_t count = std::min<size_t>(std::min(available, WRITE_CHUNK), maxFrames - frameCount);
+            if (count == 0) {
+                break;
+            }
+
+            if (lanes > 1) {
+                for (uint32_t r = 0; r < lanes; r++) {
+                    rings[r]->read(lane.data(), count);
+                    for (uint32_t f = 0; f < count; f++) {
+                        chunk[f * lanes + r] = lane[f];
+                    }
+                }
+                writeOutput(outputs[0], chunk.data(), count * lanes);
             } else {
-                // sleep for 100ms
-                std::this_thread::sleep_for(std::chrono::milliseconds(100));
+                for (size_t r = 0; r < rings.size(); r++) {
+                    rings[r]->read(chunk.data(), count);
+                    writeOutput(outputs[r], chunk.data(), count);
+                }
             }
+            frameCount += count;
+            fileUpdateState++;
+
+            auto now = std::chrono::steady_clock::now();
+            if (now - lastSync >= SYNC_INTERVAL) {
+                for (Output& output : outputs) {
+                    fdatasync(output.fd);
+                }
+                lastSync = now;
+            }
+            uint32_t lost = dropped.exchange(0);
+            if (lost) {
+                logWarn("TapeRecording: %d samples dropped, the disk is too slow", lost);
+            }
+        }
+
+        // Closes the file descriptors as well
+        for (Output& output : outputs) {
+            sf_close(output.file);
+        }
+        openPlayback();
+    }
+
+    // Playback of the recording, two streams so a jump crossfades from the previous position
+    SampleStreamer::Stream playStreams[2] = { { props.sampleRate }, { props.sampleRate } };
+    int8_t activeStream = -1;
+    int8_t fadingStream = -1;
+    uint32_t fadeFrames = props.sampleRate * 0.01f;
+    uint32_t fadePos = 0;
+    std::atomic<bool> playing = false;
+
+    // Play or stop request of the UI, taken by the audio thread at the next block
+    std::atomic<uint32_t> playRequest = 0;
+    uint32_t playHandled = 0;
+    std::atomic<bool> requestPlay = false;
+    std::atomic<int64_t> requestStart = 0;
+    std::atomic<int64_t> requestEnd = 0;
+
+    // Read the head of the recording in the background, both streams opening the same file
+    void openPlayback()
+    {
+        if (stems.empty() && std::filesystem::exists(getTmpFilePath())) {
+            for (auto& stream : playStreams) {
+                stream.open(getTmpFilePath());
+            }
+        }
+    }
+
+    void startPlayback(uint64_t start, uint64_t end)
+    {
+        int8_t next = activeStream == 0 ? 1 : 0;
+        SampleStreamer::Stream& stream = playStreams[next];
+        if (stream.frames() == 0) {
+            playing = activeStream >= 0;
+            return;
+        }
+        stream.play(start, start, end ? end : stream.frames(), false);
+        if (activeStream >= 0) {
+            fadingStream = activeStream;
+            fadePos = fadeFrames;
         }
+        activeStream = next;
+        playing = true;
+    }
 
-        if (buffer.empty() && sampleCount < maxSamples) {
-            sf_write_float(sndfile, buffer.data(), buffer.size());
+    void stopPlayback()
+    {
+        if (activeStream >= 0) {
+            fadingStream = activeStream;
+            fadePos = fadeFrames;
         }
+        activeStream = -1;
+        playing = false;
+    }
 
-        sf_close(sndfile);
+    // Next frame of the playback, fading out the previous stream after a jump or a stop
+    float playbackFrame()
+    {
+        float out = 0.0f;
+        float gain = 1.0f;
+        if (fadePos) {
+            float fade = (float)fadePos-- / fadeFrames;
+            out = playStreams[fadingStream].next() * fade;
+            gain = 1.0f - fade;
+        }
+        if (activeStream >= 0) {
+            SampleStreamer::Stream& stream = playStreams[activeStream];
+            out += stream.next() * gain;
+            if (stream.ended()) {
+                activeStream = -1;
+                playing = false;
+            }
+        }
+        return out;
+    }
+
+    // Copy the block of each stem to its ring, one memory copy each in planar layout. All the stems or none, so
+    // they stay aligned.
+    void recordStems(float* buf, uint32_t frames)
+    {
+        for (auto& ring : rings) {
+            if (ring->space() < frames) {
+                dropped += frames * rings.size();
+                return;
+            }
+        }
+        for (size_t i = 0; i < stems.size(); i++) {
+            rings[i]->write(trackLane(buf, stems[i]), props.frameStride, frames);
+        }
+        sinceWake += frames;
+        if (sinceWake >= WRITE_CHUNK) {
+            sinceWake = 0;
+            wakeWriter();
+        }
     }
 
 public:
@@ -108,6 +339,7 @@ public:
     TapeRecording(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
     {
+        wakeFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
         trackNum.props().max = props.maxTracks - 1;
         initValues();
 
@@ -122,6 +354,9 @@ public:
         //md - `"folder": "tape"` to set samples folder path.
         folder = json.value("folder", folder);
 
+        //md - `"tmpFolder": "/dev/shm/tape"` to record the temporary files somewhere else than `tape_tmp` in the folder, e.g. in RAM so the recording doesn't write to the SD card. The size of the recording is limited by `maxFileSize`.
+        tmpFolder = json.value("tmpFolder", tmpFolder);
+
         //md - `"filename": "track"` to set filename. By default it is `track`.
         filename = json.value("filename", filename);
 
@@ -134,65 +369,95 @@ public:
         if (json.contains("maxTrack")) {
             trackNum.props().max = json["maxTrack"].get<float>();
         }
+
+        //md - `"stems": [1, 2, 5]` to record these tracks together instead of `TRACK`, or `"stems": "all"` for all the tracks, master included. The playback only works with a single track.
+        if (json.contains("stems")) {
+            if (json["stems"].is_string() && json["stems"].get<std::string>() == "all") {
+                for (uint16_t t = 0; t < props.maxTracks; t++) {
+                    stems.push_back(t);
+                }
+            } else if (json["stems"].is_array()) {
+                for (auto& stem : json["stems"]) {
+                    if (stem.get<int>() >= 0 && stem.get<int>() < props.maxTracks) {
+                        stems.push_back(stem.get<int>());
+                    }
+                }
+            }
+        }
+
+        //md - `"stemFiles": true` to write one file per stem, `<filename>_<track>.wav`. By default the stems are the channels of a single file, `<filename>_stems.wav`.
+        stemFiles = json.value("stemFiles", stemFiles);
+
+        for (size_t i = 0; i < std::max<size_t>(stems.size(), 1); i++) {
+            rings.push_back(std::make_unique<Ring>());
+        }
+        openPlayback();
     }
 
     ~TapeRecording()
     {
         loopRunning = false;
         if (writerThread.joinable()) {
+            wakeWriter();
             writerThread.join();
         }
+        if (wakeFd >= 0) {
+            close(wakeFd);
+        }
     }
 
-    sf_count_t playSampleCount = 0;
-    void play(sf_count_t start, sf_count_t end)
+    std::set<uint8_t> trackDependencies() override
     {
-        std::string filepath = getTmpFilePath();
-        SF_INFO sfinfo;
-        if (playSndfile) {
-            stop();
-        }
-        SNDFILE* file = sf_open(filepath.c_str(), SFM_READ, &sfinfo);
-        if (!file) {
-            return;
+        std::set<uint8_t> dependencies = {};
+        for (uint8_t stem : stems) {
+            if (stem != track) {
+                dependencies.insert(stem);
+            }
         }
-        sf_seek(file, start, SEEK_SET);
-        playSampleCount = (end ? end : sfinfo.frames) - start;
-        playSndfile = file;
+        return dependencies;
     }
 
-    void stop()
+    void sample(float* buf)
     {
-        sf_close(playSndfile);
-        playSndfile = NULL;
+        if (loopRunning && stems.empty()) {
+            if (!rings[0]->write(&buf[track], 1)) {
+                dropped++;
+            }
+            if (++sinceWake >= WRITE_CHUNK) {
+                sinceWake = 0;
+                wakeWriter();
+            }
+        }
     }
 
-    static const size_t CHUNK_SIZE = 1024;
-    float readBuffer[CHUNK_SIZE];
-    size_t currentSampleIndex = CHUNK_SIZE;
-
-    void sample(float* buf)
+    void sampleBlock(float* buf, uint32_t frames) override
     {
-        if (loopRunning) { // we could even check for buffer size...
-            buffer.push_back(buf[track]);
+        if (loopRunning && !stems.empty()) {
+            recordStems(buf, frames);
         }
-        if (playSndfile) {
-            if (playSampleCount) {
-                if (currentSampleIndex >= CHUNK_SIZE) {
-                    sf_count_t count = sf_read_float(playSndfile, readBuffer, CHUNK_SIZE);
-
-                    if (count == 0) {
-                        stop();
-                        return;
-                    }
-                    currentSampleIndex = 0; // Reset index for the new chunk
-                }
-                float tmpBuf = readBuffer[currentSampleIndex++];
-                playSampleCount--;
-
-                buf[trackPlayback] = tmpBuf;
+        Mapping::sampleBlock(buf, frames);
+
+        for (int8_t i = 0; i < 2; i++) {
+            // A new recording, the playhead of the previous one is lost
+            if (playStreams[i].swap() && (activeStream == i || fadingStream == i)) {
+                activeStream = -1;
+                fadePos = 0;
+                playing = false;
+            }
+        }
+        uint32_t request = playRequest.load(std::memory_order_acquire);
+        if (request != playHandled) {
+            playHandled = request;
+            if (requestPlay) {
+                startPlayback(std::max<int64_t>(requestStart, 0), std::max<int64_t>(requestEnd, 0));
             } else {
-                stop();
+                stopPlayback();
+            }
+        }
+        if (activeStream >= 0 || fadePos) {
+            float* out = trackLane(buf, trackPlayback);
+            for (uint32_t f = 0; f < frames; f++) {
+                out[f * props.frameStride] = playbackFrame();
             }
         }
     }
@@ -200,12 +465,20 @@ public:
     void onEvent(AudioEventType event, bool playing) override
     {
         if (event == AudioEventType::STOP || event == AudioEventType::PAUSE) {
-            loopRunning = false;
+            if (loopRunning) {
+                loopRunning = false;
+                wakeWriter();
+            }
         } else if (event == AudioEventType::START) {
             if (writerThread.joinable()) {
+                loopRunning = false;
+                wakeWriter();
                 writerThread.join();
             }
-            buffer.clear();
+            for (auto& ring : rings) {
+                ring->reset();
+            }
+            sinceWake = 0;
             loopRunning = true;
             writerThread = std::thread(&TapeRecording::writerLoop, this);
             pthread_setname_np(writerThread.native_handle(), "tapeWriter");
@@ -242,13 +515,14 @@ public:
     {
         switch (id) {
         case DATA_ID::PLAY_STOP: {
-            if (playSndfile) {
-                stop();
-            } else {
-                play(playData.start, playData.end);
-                return playSndfile;
-            }
-            return NULL;
+            // Handled by the audio thread, never waiting for the disk
+            bool start = !playing;
+            requestStart = playData.start;
+            requestEnd = playData.end;
+            requestPlay = start;
+            playRequest.fetch_add(1, std::memory_order_release);
+            playing = start;
+            return start ? &playData : NULL;
         }
         case DATA_ID::SYNC: {
             if (userdata != NULL) {
@@ -260,9 +534,12 @@ public:
         case DATA_ID::SAVE: {
             if (userdata) {
                 std::string name = *(std::string*)userdata;
-                std::string dest = folder + "/" + name + ".wav";
-
-                copyPartialAudioFile(getTmpFilePath(), dest, playData.start, playData.end);
+                // Each temporary file keeps its suffix, e.g. `_stems.wav` or `_3.wav`
+                size_t prefix = getTmpFolder().size() + filename.size();
+                for (std::string& path : getTmpFilePaths()) {
+                    std::string dest = folder + "/" + name + path.substr(prefix);
+                    copyPartialAudioFile(path, dest, playData.start, playData.end);
+                }
             }
             return NULL;
         }
@@ -8,6 +8,12 @@ The `Tempo` module acts as the central conductor. Its main function is to genera
 **How it works:**
 The module converts the user-defined BPM (typically 60 to 240) into a continuous stream of highly precise timing pulses (or “ticks”). These ticks are standardized to ensure consistent timing across different tempos and are responsible for moving sequencers or other synchronized effects forward.
 
+**Network sync:**
+Several units on the same local network can share their tempo and transport (see `NetSync`): each block, the clock follows the beat of the shared session, nudging its tick duration to catch up small phase errors smoothly and jumping only when far off, so beats, bars, start and stop stay aligned across the units.
+
+**Remote rendering:**
+On a unit rendering a track for another one (see `RemoteTrackServer`), the ticks of each block are the ones sent by the other unit for that block, so the remote sequencers play exactly on its clock.
+
 **Communication:**
 Instead of sending these pulses through a separate message system, the `Tempo` module embeds the clock signal directly into a specific channel (or "track") of the processed audio data buffer. Any other synchronized plugin can then easily read this designated track to get the current timing information. The module also handles configuration, allowing the initial BPM and the specific communication track index to be set via configuration files.
 
@@ -23,6 +29,9 @@ sha: 73b3583649737198629fc4fb05a6c7a0f76765f94cc9f9f6b8586b53f437f3e1
 #pragma once
 
 #include "audio/Clock.h"
+#include "audio/ClockSync.h"
+#include "audio/NetSync.h"
+#include "helpers/MpscQueue.h"
 #include "audioPlugin.h"
 #include "host/constants.h"
 #include "log.h"
@@ -34,14 +43,39 @@ sha: 73b3583649737198629fc4fb05a6c7a0f76765f94cc9f9f6b8586b53f437f3e1
 Tempo audio module is responsible for clocking events. The main purpose is to send clock events to other plugins.
 A good example is the sequencer.
 
-> [!NOTE]
-> - `TODO` select between internal vs midi clock
+The clock is either generated internally from the BPM, or follows an external MIDI clock (0xF8, 24 pulses per
+quarter note) from the MIDI input. The external clock is filtered with a delay locked loop, to smooth the MIDI
+jitter while following the tempo changes.
+
+With `netSync`, the units of a local network share their tempo and transport: changing the tempo, starting or
+stopping one of them applies to all of them, their beats staying phase-locked.
 */
 class Tempo : public Mapping {
 protected:
     Clock clock;
     uint16_t clockTrack = CLOCK_TRACK;
 
+    // External clock: ticks received by the midi thread, applied by the audio thread
+    bool externalClock = false;
+    ClockSync clockSync;
+    MpscQueue<uint64_t, 64> externalTicks;
+    // Index of the next external tick to emit, counted like `clockSync.received`
+    uint32_t nextTick = 0;
+
+    bool midiClockOutput = false;
+
+    // Session shared with the other units of the network, NULL if not enabled
+    NetSync* netSync = NULL;
+    // Time of the current block, filtered as the blocks are processed by bursts, and frames of the previous one
+    int64_t blockUs = 0;
+    uint32_t lastBlockFrames = 0;
+    // Time added to the session beat, to compensate for an output latency different from the other units
+    int64_t netSyncOffsetUs = 0;
+    double syncedBpm = 0.0;
+
+    // Ticks of the next block, when the plugin driving the audio loop follows the clock of another unit
+    ClockEvents* remoteTicks = NULL;
+
 public:
     int16_t getType() override
     {
@@ -55,6 +89,7 @@ public:
     Tempo(AudioPlugin::Props& props, AudioPlugin::Config& config)
         : Mapping(props, config)
         , clock(props.sampleRate)
+        , clockSync(props.sampleRate)
     {
         initValues();
 
@@ -66,6 +101,37 @@ public:
 
         //md - `"clockTrack": 32` set the track for clock
         clockTrack = config.json.value("clockTrack", clockTrack);
+        //md - `"clock": "midi"` follow the MIDI clock of the MIDI input instead of the internal one (default `"internal"`)
+        externalClock = config.json.value("clock", "internal") == "midi";
+        //md - `"clockSyncBandwidth": 1.0` bandwidth in Hz of the loop filtering the MIDI clock: lower values reject more jitter, higher values follow tempo changes faster
+        clockSync.setBandwidth(config.json.value("clockSyncBandwidth", 1.0f));
+        //md - `"midiClockOutput": true` send the clock, start and stop on the MIDI output (default false)
+        midiClockOutput = config.json.value("midiClockOutput", midiClockOutput);
+
+        //md - `"netSync": true` share the tempo and transport with the other units of the local network, or
+        //md   `"netSync": { "group": "239.255.77.77", "port": 20809, "offsetMs": 0.0 }`, `offsetMs` being
+        //md   added to the beat of this unit, e.g. to compensate for a longer output latency than the others
+        if (config.json.contains("netSync") && config.json["netSync"] != false) {
+            nlohmann::json netConfig = config.json["netSync"].is_object() ? config.json["netSync"] : nlohmann::json::object();
+            if (externalClock) {
+                logWarn("Tempo: netSync is ignored when following the MIDI clock");
+            } else {
+                netSyncOffsetUs = netConfig.value("offsetMs", 0.0f) * 1000;
+                netSync = new NetSync();
+                if (!netSync->start(bpm.get(), netConfig.value("group", "239.255.77.77"), netConfig.value("port", 20809),
+                        [this](NetSync::Transport transport) { onSessionTransport(transport); })) {
+                    delete netSync;
+                    netSync = NULL;
+                }
+            }
+        }
+    }
+
+    ~Tempo()
+    {
+        if (netSync) {
+            delete netSync;
+        }
     }
 
     // Clock events are sent at a rate of 24 pulses per quarter note
@@ -75,6 +141,9 @@ public:
     {
         bpm.setFloat(_bpm);
         clock.setBpm(bpm.get());
+        if (netSync && bpm.get() != syncedBpm) {
+            netSync->change({ bpm.get(), NetSync::STOPPED, 0.0, NetSync::nowUs() });
+        }
         logDebug("Tempo: %d bpm (sample rate: %d)", (int)bpm.get(), props.sampleRate);
     }
 
@@ -89,11 +158,171 @@ public:
         }
     }
 
+    void sampleBlock(float* buf, uint32_t frames) override
+    {
+        if (props.clockEvents) {
+            props.clockEvents->begin(buf);
+        }
+        if (remoteTicks) {
+            float* lane = trackLane(buf, clockTrack);
+            for (uint32_t i = 0; i < remoteTicks->count; i++) {
+                if (remoteTicks->ticks[i].offset < frames) {
+                    lane[remoteTicks->ticks[i].offset * props.frameStride] = remoteTicks->ticks[i].clock;
+                    addTick(remoteTicks->ticks[i].offset, remoteTicks->ticks[i].clock);
+                }
+            }
+            remoteTicks = NULL;
+            return;
+        }
+        if (netSync) {
+            syncBlock(frames);
+        }
+        if (externalClock) {
+            sampleExternal(buf, frames);
+        } else if (props.audioPluginHandler->isPlaying()) {
+            float* lane = trackLane(buf, clockTrack);
+            if (midiClockOutput) {
+                uint64_t start = props.audioPluginHandler->getBlockFrame();
+                for (uint32_t f = 0; f < frames; f++) {
+                    uint32_t value = clock.getClock();
+                    lane[f * props.frameStride] = value;
+                    if (value) {
+                        addTick(f, value);
+                        props.audioPluginHandler->sendMidiRealtime(0xf8, start + f);
+                    }
+                }
+            } else {
+                clock.getClockBlock(lane, props.frameStride, frames);
+                if (props.clockEvents) {
+                    for (uint32_t f = 0; f < frames; f++) {
+                        if (lane[f * props.frameStride] != 0.0f) {
+                            props.clockEvents->add(f, (uint32_t)lane[f * props.frameStride]);
+                        }
+                    }
+                }
+            }
+        }
+    }
+
+    // Follow the session: its tempo, and its beat once playing
+    void syncBlock(uint32_t frames)
+    {
+        int64_t now = NetSync::nowUs();
+        int64_t predicted = blockUs + (int64_t)lastBlockFrames * 1000000 / props.sampleRate;
+        blockUs = blockUs == 0 || llabs(now - predicted) > 20000 ? now : predicted + (now - predicted) / 16;
+        lastBlockFrames = frames;
+
+        const NetSync::Session& session = netSync->session();
+        if (!session.valid) {
+            return;
+        }
+        if (session.bpm != syncedBpm) {
+            syncedBpm = session.bpm;
+            bpm.setFloat(session.bpm);
+        }
+        double tickFrames = props.sampleRate * 60.0 / (session.bpm * 24.0);
+        if (session.transport == NetSync::PLAYING && props.audioPluginHandler->isPlaying()) {
+            double target = (session.beat(blockUs + netSyncOffsetUs) - session.startBeat) * 24.0;
+            double error = target - clock.position();
+            if (fabs(error) > 2.0) {
+                clock.setPosition(target);
+            } else {
+                // Caught up in about half a second, the tempo never changing by more than 5%
+                double ticksPerSecond = props.sampleRate / tickFrames;
+                tickFrames /= 1.0 + CLAMP(error / (ticksPerSecond * 0.5), -0.05, 0.05);
+            }
+        }
+        clock.setTickFrames(tickFrames);
+    }
+
+    // Network thread: another unit started or stopped the session
+    void onSessionTransport(NetSync::Transport transport)
+    {
+        if (transport == NetSync::PLAYING && !props.audioPluginHandler->isPlaying()) {
+            props.audioPluginHandler->sendEvent(AudioEventType::START);
+        } else if (transport == NetSync::PAUSED && props.audioPluginHandler->isPlaying()) {
+            props.audioPluginHandler->sendEvent(AudioEventType::PAUSE);
+        } else if (transport == NetSync::STOPPED && !props.audioPluginHandler->isStopped()) {
+            props.audioPluginHandler->sendEvent(AudioEventType::STOP);
+        }
+    }
+
+    void addTick(uint32_t offset, uint32_t value)
+    {
+        if (props.clockEvents) {
+            props.clockEvents->add(offset, value);
+        }
+    }
+
+    // Emit the external ticks at the frame predicted by the loop, rather than when they were received
+    void sampleExternal(float* buf, uint32_t frames)
+    {
+        uint64_t* tick;
+        while ((tick = externalTicks.front()) != NULL) {
+            bool locked = clockSync.isLocked();
+            clockSync.tick(*tick);
+            externalTicks.pop();
+            if (!locked && clockSync.isLocked()) {
+                // Start from the tick that completed the lock
+                nextTick = clockSync.received - 1;
+            }
+        }
+
+        uint64_t start = props.audioPluginHandler->getBlockFrame();
+        if (!props.audioPluginHandler->isPlaying() || !clockSync.isLocked() || clockSync.isLost(start)) {
+            nextTick = clockSync.received;
+            return;
+        }
+
+        float* lane = trackLane(buf, clockTrack);
+        for (uint32_t f = 0; f < frames; f++) {
+            // Never more than one tick ahead of the external clock: when it stops, the clock holds
+            if (nextTick <= clockSync.received && start + f >= clockSync.tickFrame(nextTick)) {
+                uint32_t value = clock.tick();
+                lane[f * props.frameStride] = value;
+                addTick(f, value);
+                nextTick++;
+                if (midiClockOutput) {
+                    props.audioPluginHandler->sendMidiRealtime(0xf8, start + f);
+                }
+                // Show the external tempo, once per beat
+                if (value % 24 == 0) {
+                    bpm.setFloat(clockSync.getBpm());
+                }
+            } else {
+                lane[f * props.frameStride] = 0.0f;
+            }
+        }
+    }
+
     void onEvent(AudioEventType event, bool playing) override
     {
         if (event == AudioEventType::STOP) {
             clock.reset();
         }
+        if (netSync && (event == AudioEventType::START || event == AudioEventType::STOP || event == AudioEventType::PAUSE)) {
+            NetSync::Transport transport = event == AudioEventType::START ? NetSync::PLAYING
+                : event == AudioEventType::STOP                          ? NetSync::STOPPED
+                                                                         : NetSync::PAUSED;
+            // Not sent back when following the session
+            if (netSync->session().transport != transport) {
+                netSync->change({ 0.0, transport, clock.position() / 24.0, blockUs ? blockUs : NetSync::nowUs() });
+            }
+        }
+        if (midiClockOutput && (event == AudioEventType::START || event == AudioEventType::STOP || event == AudioEventType::PAUSE)) {
+            props.audioPluginHandler->sendMidiRealtime((uint8_t)event, props.audioPluginHandler->getBlockFrame());
+        }
+    }
+
+    uint8_t getDataId(std::string name) override
+    {
+        if (name == "MIDI_CLOCK") {
+            return 1;
+        }
+        if (name == "REMOTE_TICKS") {
+            return 2;
+        }
+        return atoi(name.c_str());
     }
 
     // TODO should this be removed?
@@ -111,6 +340,15 @@ public:
             }
             return &playingState;
         }
+        // Called by the midi thread on each incoming clock tick, with its frame
+        if (id == 1 && externalClock) {
+            externalTicks.push(*(uint64_t*)userdata);
+        }
+        // Called by the plugin driving the audio loop, before each block, with the ticks of another unit for the
+        // block, see RemoteTrackServer
+        if (id == 2) {
+            remoteTicks = (ClockEvents*)userdata;
+        }
         return NULL;
     }
 };
@@ -118,6 +356,10 @@ public:
 class UseClock {
 public:
     uint32_t clockCounter = 0;
+    // Frame of the last tick, and frames between the last two ticks, 0 until measured. Only known from the clock
+    // events, e.g. for a plugin to place its notes between two ticks.
+    uint64_t tickFrame = 0;
+    uint32_t tickFrames = 0;
 
     void sample(float* buf)
     {
@@ -128,14 +370,42 @@ public:
         // that is ok ...
         uint32_t clockValue = (uint32_t)buf[CLOCK_TRACK];
         if (clockValue != 0) {
-            clockCounter = clockValue;
-            if (clockValue % 6 == 0) {
-                onStep();
+            onTick(clockValue);
+        }
+    }
+
+    // Block version of `sample()`: iterate the clock ticks of the block instead of polling the clock lane.
+    // Without clock events (no host), the clock lane is polled.
+    void clockBlock(AudioPlugin::Props& props, float* buf, uint32_t frames)
+    {
+        if (props.clockEvents) {
+            uint64_t blockFrame = props.audioPluginHandler->getBlockFrame();
+            props.clockEvents->forEach(buf, props.frameStride, frames, [&](ClockEvents::Tick& tick, uint32_t) {
+                uint64_t frame = blockFrame + tick.offset;
+                tickFrames = tick.clock == clockCounter + 1 && frame > tickFrame ? frame - tickFrame : 0;
+                tickFrame = frame;
+                onTick(tick.clock);
+            });
+            return;
+        }
+        float* lane = buf + CLOCK_TRACK * props.trackStride;
+        for (uint32_t f = 0; f < frames; f++) {
+            uint32_t clockValue = (uint32_t)lane[f * props.frameStride];
+            if (clockValue != 0) {
+                onTick(clockValue);
             }
-            onClock();
         }
     }
 
+    void onTick(uint32_t clockValue)
+    {
+        clockCounter = clockValue;
+        if (clockValue % 6 == 0) {
+            onStep();
+        }
+        onClock();
+    }
+
     virtual void onClock() { }
     virtual void onStep() { }
 };
@@ -15,24 +15,26 @@ sha: d95de664b8da60b2f4eb0af9e32d487650912edd034222649b66b271c302993b
 
 #include <stdint.h>
 
+#include "utils/PluginArena.h"
+
 #ifndef AUDIO_BUFFER_SIZE
 #define AUDIO_BUFFER_SIZE 5 * 48000
 #endif
 
+// Ring of the last samples, `SIZE` by default, or sized at runtime from the sample rate,
+// e.g. `AudioBuffer<>(props.arena, 5 * props.sampleRate)` to keep 5 seconds.
 template <uint64_t SIZE = AUDIO_BUFFER_SIZE>
 class AudioBuffer {
 public:
-    const uint64_t size = SIZE;
+    const uint64_t size;
 
-    // keep in memory 5 seconds of samples
-    float samples[SIZE];
+    ArenaArray<float> samples;
     uint64_t index = 0;
 
-    AudioBuffer()
+    AudioBuffer(PluginArena* arena = NULL, uint64_t size = SIZE)
+        : size(size)
+        , samples(arena, size)
     {
-        for (uint64_t i = 0; i < size; i++) {
-            samples[i] = 0.0;
-        }
     }
 
     void addSample(float sample)
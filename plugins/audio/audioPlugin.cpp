@@ -22,6 +22,21 @@ sha: 53fb604ceaab4933c4a764fd9852cec58a3e2d399f7d865f3828e88be0326589
 
 #include PLUGIN_INCLUDE
 
+#ifdef PLUGIN_STATIC
+// Linked in the binary, see `make static`: registered by name instead of being found by `dlsym()`
+#include "helpers/staticLibs.h"
+
+#define PLUGIN_STRING(name) #name
+#define PLUGIN_NAME_STRING(name) PLUGIN_STRING(name)
+
+namespace {
+AudioPlugin* allocator(AudioPlugin::Props& props, AudioPlugin::Config& config)
+{
+	return new PLUGIN_NAME(props, config);
+}
+StaticLibs::Register registration("audio", PLUGIN_NAME_STRING(PLUGIN_NAME), (void*)&allocator);
+}
+#else
 extern "C"
 {
 	PLUGIN_NAME *allocator(AudioPlugin::Props& props, AudioPlugin::Config& config)
@@ -34,3 +49,4 @@ extern "C"
 		delete ptr;
 	}
 }
+#endif
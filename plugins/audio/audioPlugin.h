@@ -16,13 +16,22 @@ sha: 93dfdc2043f0d2843ff90977dd31d892ea08da963ef6873a5819f5a773b42655
 #pragma once
 
 #include "libs/nlohmann/json.hpp"
+#include <atomic>
 #include <cstdlib>
+#include <functional>
+#include <memory>
 #include <set>
 #include <stdint.h>
 #include <string.h>
 #include <vector>
 
 #include "audio/lookupTable.h"
+#include "host/constants.h"
+#include "paramQueue.h"
+#include "utils/ClipState.h"
+#include "utils/ClockEvents.h"
+#include "utils/ModulationSources.h"
+#include "utils/PluginArena.h"
 #include "valueInterface.h"
 
 class AudioPlugin;
@@ -35,6 +44,13 @@ enum AudioEventType {
     SET_ACTIVE_TRACK,
     RELOAD_CLIP,
     SAVE_CLIP,
+    // Render the plugin chain of the track as a loop, played back until it changes, see TrackFreeze
+    FREEZE_TRACK,
+    UNFREEZE_TRACK,
+    // Record the changes of the values of the track as automation, see utils/Automation.h
+    RECORD_AUTOMATION,
+    STOP_AUTOMATION,
+    CLEAR_AUTOMATION,
     START = 0xfa,
     PAUSE = 0xfb,
     STOP = 0xfc,
@@ -63,6 +79,16 @@ AudioEventType getEventTypeFromName(std::string name)
         return AudioEventType::RELOAD_CLIP;
     } else if (name == "SAVE_CLIP") {
         return AudioEventType::SAVE_CLIP;
+    } else if (name == "FREEZE_TRACK") {
+        return AudioEventType::FREEZE_TRACK;
+    } else if (name == "UNFREEZE_TRACK") {
+        return AudioEventType::UNFREEZE_TRACK;
+    } else if (name == "RECORD_AUTOMATION") {
+        return AudioEventType::RECORD_AUTOMATION;
+    } else if (name == "STOP_AUTOMATION") {
+        return AudioEventType::STOP_AUTOMATION;
+    } else if (name == "CLEAR_AUTOMATION") {
+        return AudioEventType::CLEAR_AUTOMATION;
     }
     return AudioEventType::UNKNOWN;
 }
@@ -81,14 +107,70 @@ public:
     };
     virtual void noteOn(uint8_t note, float velocity, NoteTarget target) = 0;
     virtual void noteOff(uint8_t note, float velocity, NoteTarget target) = 0;
+    // Hand over a note to the track of the target, to be played at the given frame within the block. Notes must be
+    // queued at the latest in the block before their frame. Without tracks, the note is played right away.
+    virtual void queueNote(bool on, uint8_t note, float velocity, NoteTarget target, uint64_t frame)
+    {
+        if (on) {
+            noteOn(note, velocity, target);
+        } else {
+            noteOff(note, velocity, target);
+        }
+    }
+    // Call `plugin->launch()` from the audio thread processing its track, right before the frame of the first clock
+    // tick multiple of `ticks` (24 ticks per beat, e.g. 96 for the next bar), or at the start of the next block when
+    // `ticks` is 0. A launch queued replaces the one pending on the track. Return false if the plugin is not part of
+    // a running track, the caller then launching it itself.
+    virtual bool queueLaunch(AudioPlugin* plugin, uint32_t ticks)
+    {
+        return false;
+    }
     virtual void assignPluginToMidiChannel(uint8_t channel, AudioPlugin* plugin) = 0;
-    virtual void mapMidiCmd(AudioPlugin* plugin, int valueIndex, const std::string& cmd) = 0;
+    virtual void mapMidiCmd(AudioPlugin* plugin, int valueIndex, const std::string& cmd, const std::string& curve = "linear") = 0;
     virtual AudioPluginHandlerInterface& config(nlohmann::json& config) = 0;
+    // Reload the tracks which plugins changed, return false if not supported and the app must restart
+    virtual bool reloadTracks(nlohmann::json& config)
+    {
+        return false;
+    }
 
     virtual bool isPlaying() = 0;
     virtual bool isStopped() = 0;
 
     virtual void loop() = 0;
+
+    // First frame of the block being processed, counted since the audio loop started
+    virtual uint64_t getBlockFrame() { return 0; }
+
+    // Steady clock time in ns at which the last note-on was read from the MIDI input, 0 if none, e.g. for
+    // LatencyProbe to measure the latency from MIDI to sound
+    virtual int64_t getMidiNoteOnTime() { return 0; }
+
+    // Plugins of all the tracks, from any thread, NULL before they are loaded. Reloading tracks replaces the list,
+    // the previous ones are never freed.
+    virtual const std::vector<AudioPlugin*>* getPlugins() { return NULL; }
+
+    // Queue a MIDI message of up to 3 bytes (note, control change...) to be sent on the MIDI output at the given
+    // frame, 0 for as soon as possible. Safe to call from the audio thread.
+    virtual void sendMidi(const uint8_t* message, uint8_t size, uint64_t frame) { }
+
+    // Queue a MIDI realtime message (clock, start, stop...) to be sent on the MIDI output at the given frame.
+    // Safe to call from the audio thread.
+    virtual void sendMidiRealtime(uint8_t status, uint64_t frame) { }
+
+    // Record a dropout of the audio output, `type` being a XrunLog::Type (see host/XrunLog.h) and `value` the
+    // frames written for a partial write. Safe to call from the audio thread.
+    virtual void reportXrun(uint8_t type, uint32_t value = 0) { }
+
+    virtual uint8_t getDataId(std::string name)
+    {
+        return atoi(name.c_str());
+    }
+
+    virtual void* data(int id, void* userdata = NULL)
+    {
+        return NULL;
+    }
 };
 
 class AudioPlugin {
@@ -110,6 +192,41 @@ public:
         AudioPluginHandlerInterface* audioPluginHandler;
         int16_t maxTracks;
         LookupTable* lookupTable;
+
+        // Layout of the block buffer passed to `sampleBlock()`:
+        // sample `n` of track `t` is `buf[t * trackStride + n * frameStride]`.
+        // - interleaved (default): trackStride = 1, frameStride = maxTracks + 1 (clock track included)
+        // - planar: trackStride = lane size, frameStride = 1, each track owning a contiguous lane
+        uint32_t frameStride = 0;
+        uint32_t trackStride = 1;
+
+        // Number of frames processed per block, set by the host config
+        uint32_t blockSize = 128;
+
+        // Set by the host for each track once processed: true if the track only output silence during the block
+        bool* silentTracks = NULL;
+
+        // Frames between two `controlTick()`, set by the host config
+        uint32_t controlFrames = 32;
+
+        // Memory for the large DSP buffers, see utils/PluginArena.h. NULL to allocate them on the heap.
+        PluginArena* arena = NULL;
+
+        // Clock ticks of the current block, listed by the Tempo plugin, see utils/ClockEvents.h. NULL without host.
+        ClockEvents* clockEvents = NULL;
+
+        // Offset from a sample of a track to the same sample of its right channel, 0 when the buffer is mono.
+        // See the `stereo` host config.
+        uint32_t rightOffset = 0;
+        // Set by the host for each track: true if its right lane holds a right channel, see `isStereo()`
+        bool* stereoTracks = NULL;
+
+        // Sources shared by the tracks for the modulation routes, see utils/ModulationSources.h. NULL without host.
+        ModulationSources* modulation = NULL;
+
+        // While set, e.g. hydrating a workspace, the tracks keep the value changes in the parameter queues, so the
+        // new state of all the plugins is applied at the same block boundary. NULL without host.
+        std::atomic<bool>* holdChanges = NULL;
     };
 
     struct Config {
@@ -126,11 +243,18 @@ public:
     int16_t track = 0;
     bool serializable = true;
 
+    // Value changes coming from other threads, applied by the track before processing the next block
+    ParamQueue paramQueue;
+
     AudioPlugin(Props& props, Config& config)
         : props(props)
         , name(config.name)
         , track(config.trackId)
     {
+        if (this->props.frameStride == 0) {
+            this->props.frameStride = this->props.maxTracks + 1;
+        }
+
         auto& json = config.json;
         serializable = json.value("serializable", serializable);
 
@@ -138,22 +262,142 @@ public:
         if (json.contains("midiChannel")) {
             props.audioPluginHandler->assignPluginToMidiChannel(json["midiChannel"].get<uint8_t>(), this);
         }
+    }
 
-        //#md `{ "midiCmd": [{"parameter": "VOLUME", "cmd": "b0 4c xx"}] }` assign a midi command to a given plugin value. `xx` is the position of the value changing in the target parameter.
-        if (json.contains("b0 4c xx") && json["midiCmd"].is_array()) {
+    // Map the MIDI commands of the config to the values, called by the host once the plugin is instantiated, as the
+    // values are only known then
+    void mapMidiCmds(nlohmann::json& json)
+    {
+        //#md `{ "midiCmd": [{"parameter": "VOLUME", "cmd": "b0 4c xx", "curve": "linear"}] }` assign a midi command to a given plugin value. `xx` is the position of the value changing in the target parameter: `b0 4c xx` for a control change, `d0 xx` for a 2 bytes message, `e0 xx xx` for a 14 bits value (e.g. the pitch bend), `nrpn b0 01 02` for the 14 bits NRPN 0x0102 of the channel of `b0`. The optional curve is `linear`, `exp` (finer at the bottom of the range) or `log` (finer at the top).
+        if (json.contains("midiCmd") && json["midiCmd"].is_array()) {
             for (nlohmann::json& cmd : json["midiCmd"]) {
                 if (cmd.contains("parameter") && cmd.contains("cmd")) {
                     int valueIndex = getValueIndex(cmd["parameter"].get<std::string>());
                     if (valueIndex >= 0) {
-                        props.audioPluginHandler->mapMidiCmd(this, valueIndex, cmd["cmd"].get<std::string>());
+                        props.audioPluginHandler->mapMidiCmd(this, valueIndex, cmd["cmd"].get<std::string>(), cmd.value("curve", "linear"));
                     }
                 }
             }
         }
     }
 
+    // Route the modulation sources to the values, from the `modulation` config, see Mapping::mapModulation()
+    virtual void mapModulation(nlohmann::json& json) { }
+
     virtual void sample(float* buf) = 0;
 
+    // Process `frames` consecutive frames in a single call. `buf` is the block buffer described by
+    // `props.frameStride` and `props.trackStride`, use `trackLane()` to access a given track.
+    // By default it falls back to `sample()` for each frame, but hot plugins should override it to
+    // hoist their parameters and keep their state in registers across the whole block.
+    virtual void sampleBlock(float* buf, uint32_t frames)
+    {
+        if (!isPlanar()) {
+            for (uint32_t i = 0; i < frames; i++) {
+                sample(buf + i * props.frameStride);
+            }
+            return;
+        }
+        samplePlanarFallback(buf, frames);
+    }
+
+    static const uint32_t TAIL_INFINITE = UINT32_MAX;
+
+    // Silence detection: when the input of a plugin has been silent long enough, the track skips it, as long as
+    // the plugin would only output silence. By default plugins have an infinite tail and are always processed.
+    // - synths return a tail of 0, and report in `isActive()` whether a voice is still playing
+    // - effects return the number of frames their output lasts once the input is silent, e.g. the delay time
+    virtual uint32_t tailFrames() { return TAIL_INFINITE; }
+    // Number of frames the output of the plugin is late compared to its input, e.g. lookahead or block based DSP.
+    // The host delays the tracks with less latency, so the inputs of the tracks mixing them stay aligned.
+    virtual uint32_t latencyFrames() { return 0; }
+    virtual bool isActive() { return false; }
+
+    // Whether processing the plugin would only output silence, when its input is silent since `silentFrames`
+    bool isIdle(uint64_t silentFrames)
+    {
+        uint32_t tail = tailFrames();
+        return tail != TAIL_INFINITE && silentFrames >= tail && !isActive();
+    }
+
+    // Whether track `id` only output silence during the current block. Only reliable for the track dependencies.
+    inline bool isSilentTrack(uint16_t id)
+    {
+        return props.silentTracks && props.silentTracks[id];
+    }
+
+    // First sample of track `id` in the block buffer, next samples being `props.frameStride` apart.
+    inline float* trackLane(float* buf, uint16_t id)
+    {
+        return buf + id * props.trackStride;
+    }
+
+    inline bool isPlanar()
+    {
+        return props.trackStride != 1;
+    }
+
+    // Stereo plugins process the right lane of their track on top of the left one, when the buffer is stereo.
+    // The track copies its mono signal to the right lane before the first stereo plugin, so mono plugins placed
+    // before it only run once.
+    virtual bool isStereo() { return false; }
+
+    inline bool hasStereoBuffer()
+    {
+        return props.rightOffset != 0;
+    }
+
+    // Whether track `id` outputs stereo. Only reliable for the track dependencies.
+    inline bool isStereoTrack(uint16_t id)
+    {
+        return props.stereoTracks && props.stereoTracks[id];
+    }
+
+    // Right channel of track `id`, the left one when the track is mono
+    inline float* rightLane(float* buf, uint16_t id)
+    {
+        bool stereo = props.rightOffset && (id == track ? isStereo() : isStereoTrack(id));
+        return trackLane(buf, id) + (stereo ? props.rightOffset : 0);
+    }
+
+protected:
+    // Plugins without a block implementation still expect a frame with one float per track.
+    // In planar layout, such frame is rebuilt from the lanes the plugin can read (its own track,
+    // the clock track, its track dependencies and its key tracks), and its own track is written back to its lane.
+    std::vector<uint16_t> planarInputs;
+    std::vector<float> planarFrame;
+    void samplePlanarFallback(float* buf, uint32_t frames)
+    {
+        if (planarFrame.size() == 0) {
+            planarFrame.resize(props.maxTracks + 1, 0.0f);
+            planarInputs.push_back(props.maxTracks); // clock track
+            for (uint8_t dependency : trackDependencies()) {
+                if (dependency < props.maxTracks) {
+                    planarInputs.push_back(dependency);
+                }
+            }
+            for (uint8_t key : keyTracks()) {
+                if (key < props.maxTracks) {
+                    planarInputs.push_back(key);
+                }
+            }
+        }
+
+        float* frame = planarFrame.data();
+        uint16_t trackId = track; // some plugins (e.g. TapeRecording) can change their track
+        float* out = trackLane(buf, trackId);
+        for (uint32_t i = 0; i < frames; i++) {
+            for (uint16_t id : planarInputs) {
+                frame[id] = buf[id * props.trackStride + i];
+            }
+            frame[trackId] = out[i];
+            sample(frame);
+            out[i] = frame[trackId];
+        }
+    }
+
+public:
+
     virtual ValueInterface* getValue(int valueIndex)
     {
         return NULL;
@@ -174,8 +418,86 @@ public:
         return -1;
     }
 
+    // Build the lookup tables of the values, called by the host once the plugin is instantiated
+    virtual void indexValues()
+    {
+    }
+
+    // Called by the track on the audio thread after each block. Plugins keeping a state snapshot
+    // (see utils/StateSnapshot.h) publish it there, for serializeJson to read a consistent copy.
+    virtual void publishState()
+    {
+    }
+
+    // Copy of the values as last published by `publishState()`, from any thread but the audio one, false if the
+    // plugin keeps no snapshot of them
+    virtual bool readValues(std::vector<float>& values)
+    {
+        return false;
+    }
+
+    // Changed each time the state of the plugin not held by its values changes, e.g. the steps of a sequencer. A
+    // frozen track is unfrozen when it changes, see host/TrackFreeze.h.
+    virtual uint32_t stateVersion()
+    {
+        return 0;
+    }
+
+    // Undo, see utils/UndoHistory.h: copy of the state not held by the values (e.g. the steps of a sequencer), as
+    // last published, made from `previous` and sharing what didn't change, or `previous` itself if nothing changed.
+    // `bytes` is the memory not shared with `previous`. NULL when the plugin has no such state.
+    virtual std::shared_ptr<const void> snapshotState(const std::shared_ptr<const void>& previous, size_t& bytes)
+    {
+        return NULL;
+    }
+
+    // Restore a state returned by `snapshotState()`, applied by the next block
+    virtual void restoreState(const std::shared_ptr<const void>& state)
+    {
+    }
+
+    // Quality asked by the host, lowered when the CPU can't keep up (see host/QualityGovernor.h): 0 is the full
+    // quality, each level up to `QUALITY_LOWEST` trading a bit more of the sound for less CPU, e.g. fewer voices.
+    // Called by the audio thread between two blocks, so it must not allocate, and must not change the latency.
+    static const uint8_t QUALITY_LOWEST = 2;
+    virtual void setQualityLevel(uint8_t level) { }
+
+    // Called by the track before each `sampleBlock()`, even when the plugin is idle, to advance the smoothed
+    // values by `frames` (see Val::smooth()).
+    virtual void smoothBlock(uint32_t frames)
+    {
+    }
+
+    // Control rate (k-rate) modulation: when `hasControlTick()` is true, the track calls `controlTick()` every
+    // `props.controlFrames` frames, before processing them. Plugins update there what doesn't need to follow
+    // the audio rate, e.g. filter coefficients from an envelope, instead of on every sample.
+    // `frameOffset` is the position of the tick within the block.
+    virtual bool hasControlTick() { return false; }
+
+    // Plugins reacting to the clock ticks (e.g. sequencers) return true, so the track splits the block on each
+    // tick: notes they send to the following plugins of the track then start on the frame of the tick.
+    virtual bool followsClock() { return false; }
+
+    // Voice parallelism, opt-in for heavily polyphonic plugins: when `voiceGroups()` returns more than 1 and the
+    // host has voice workers, the track renders the block with `sampleVoiceGroup()` instead of `sampleBlock()`,
+    // each group on its own worker, and sums their output in the track lane. The groups are called concurrently,
+    // so each must only touch the state of its own voices.
+    virtual uint8_t voiceGroups() { return 1; }
+    // Render the voices of `group` among `groups`, writing `frames` samples to `out`, a contiguous mono buffer.
+    virtual void sampleVoiceGroup(uint8_t group, uint8_t groups, float* out, uint32_t frames)
+    {
+    }
+    virtual void controlTick(uint32_t frameOffset)
+    {
+    }
+
+    // Set by the default `noteOn()`: the plugin doesn't play notes (effects, mixers...), so the host and the tracks
+    // stop sending notes to it
+    std::atomic<bool> ignoresNotes = false;
+
     virtual void noteOn(uint8_t note, float velocity, void* userdata = NULL)
     {
+        ignoresNotes.store(true, std::memory_order_relaxed);
     }
 
     virtual void noteOff(uint8_t note, float velocity, void* userdata = NULL)
@@ -208,21 +530,100 @@ public:
     {
     }
 
+    // Heavy part of a background event, e.g. reading and parsing the files of `RELOAD_WORKSPACE`, called for all the
+    // plugins in parallel by a pool of workers, before the event is dispatched to them with `onEvent()`
+    virtual void prepareEvent(AudioEventType event)
+    {
+    }
+
+    // Called by the host with each event, before `onEvent()`, so the automation follows the loops of the track
+    // whatever the plugin does with the events, see Mapping::automationEvent()
+    virtual void automationEvent(AudioEventType event)
+    {
+    }
+
     virtual std::set<uint8_t> trackDependencies() { return {}; }
 
+    // Sidechain: tracks whose lane the plugin reads during the block, e.g. to duck under a kick, without mixing them.
+    // Unlike the track dependencies, the track keeps its own thread: it only waits for its key tracks to be done with
+    // the block, and the pool track scheduler only orders the key tracks before it.
+    virtual std::set<uint8_t> keyTracks() { return {}; }
+
+    // A plugin bound to an audio device (e.g. sound card output) can be the clock of the audio loop: the host
+    // then calls `waitForNextBlock()` before processing each block, returning once the device is ready for it.
+    virtual bool isClockSource() { return false; }
+    virtual void waitForNextBlock(uint32_t frames) { }
+
+    // A plugin bound to a callback driven audio server (e.g. JACK) can drive the audio loop: the host then calls
+    // `runAudioLoop()` instead of looping itself, and the server process callback calls `render()` for each block
+    // it needs. `render()` returns false once the host is stopping, `runAudioLoop()` must then return.
+    virtual bool drivesAudioLoop() { return false; }
+    virtual void runAudioLoop(std::function<bool()> render) { }
+
+    // A plugin can take over the plugins following it on its track, e.g. to have them rendered by another unit
+    // (see RemoteTrack). When it returns true, the track no longer processes them nor sends them notes, their
+    // values still being set as usual. Called once the track is initialized.
+    virtual bool takeOverChain(std::vector<AudioPlugin*>& following) { return false; }
+
     virtual void serializeJson(nlohmann::json& json)
     {
     }
 
+    // Add the automation lanes to the serialized plugin, see utils/Automation.h
+    virtual void serializeAutomation(nlohmann::json& json)
+    {
+    }
+
     virtual void hydrateJson(nlohmann::json& json)
     {
     }
+
+    // Hydrate the plugin from a clip state parsed beforehand, see utils/ClipState.h. By default the JSON of the
+    // plugin is rebuilt from it.
+    virtual void hydrateState(ClipState::Plugin& state)
+    {
+        nlohmann::json json = ClipState::toJson(state);
+        hydrateJson(json);
+    }
+
+    // Get ready for a clip state about to be hydrated, e.g. decoding its samples, called by a worker thread
+    // while the plugin is playing
+    virtual void prefetchState(ClipState::Plugin& state)
+    {
+    }
+
+    // Clip launch, see SerializeTrack: the state of the clip launched is staged by a worker thread ahead of the
+    // launch, then committed by the audio thread at the frame of the launch. What takes time (parsing, building the
+    // steps...) must be done when staging, the state staged being kept by the caller until it is committed. By
+    // default, the state is hydrated on commit.
+    ClipState::Plugin* stagedState = NULL;
+
+    virtual void stageState(ClipState::Plugin& state)
+    {
+        stagedState = &state;
+    }
+
+    virtual void commitState()
+    {
+        if (stagedState) {
+            hydrateState(*stagedState);
+            stagedState = NULL;
+        }
+    }
+
+    // Called by the track at the frame of a launch queued with AudioPluginHandlerInterface::queueLaunch()
+    virtual void launch()
+    {
+    }
 };
 
 AudioPlugin::Props defaultAudioProps = {
-    .sampleRate = 44100,
+    .sampleRate = SAMPLE_RATE,
     .channels = 2,
     .audioPluginHandler = nullptr,
     .maxTracks = 16,
     .lookupTable = nullptr,
+    .frameStride = 17,
+    .trackStride = 1,
+    .blockSize = 128,
 };
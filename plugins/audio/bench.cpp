@@ -0,0 +1,303 @@
+// Headless benchmark of the audio plugins, see `make bench`.
+//
+// Each plugin library is loaded like the host does, hydrated with a few presets, clocked and played with a note
+// pattern, then processed for a given duration of audio. For each plugin and preset, one JSON line is written:
+// {"plugin":"SynthFM2","preset":"default","blockSize":128,"seconds":10,"nsPerSample":41.2,"cpuPct":0.198,"allocations":0,"allocatedBytes":0}
+//
+// When the hardware counters are available (see host/PerfCounters.h), the line also has the instructions per cycle,
+// and the cycles, L1D misses and branch misses per sample: "ipc":1.62,"cyclesPerSample":98.4,"l1dMissesPerSample":0.41,...
+//
+// ./zicBench [--libs build/x86/libs/audio] [--seconds 10] [--blockSize 128] [--sampleRate 48000] [--config bench.json] [--output bench.jsonl] Plugin1 Plugin2 ...
+
+#include "audio/Clock.h"
+#include "audio/lookupTable.h"
+#include "helpers/clamp.h"
+#include "host/PerfCounters.h"
+#include "host/constants.h"
+#include "plugins/audio/audioPlugin.h"
+#include "plugins/audio/valueInterface.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <dlfcn.h>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <stdexcept>
+#include <string>
+#include <time.h>
+#include <vector>
+
+// Count the allocations made while a plugin is processing. Plugin libraries resolve `operator new` to this one,
+// as the executable is linked with `-rdynamic`. Direct calls to malloc are not counted.
+std::atomic<bool> countAllocations = false;
+std::atomic<uint64_t> allocations = 0;
+std::atomic<uint64_t> allocatedBytes = 0;
+
+void* operator new(size_t size)
+{
+    if (countAllocations) {
+        allocations++;
+        allocatedBytes += size;
+    }
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+// Plugins are benchmarked alone: there is no other plugin to find and the host is always playing
+class BenchHandler : public AudioPluginHandlerInterface {
+public:
+    AudioPlugin* getPluginPtr(std::string name, int16_t track = -1) override { return NULL; }
+    AudioPlugin& getPlugin(std::string name, int16_t track = -1) override
+    {
+        throw std::runtime_error("Plugin " + name + " not available in bench");
+    }
+    void sendEvent(AudioEventType event, int16_t track = -1) override { }
+    void noteOn(uint8_t note, float velocity, NoteTarget target) override { }
+    void noteOff(uint8_t note, float velocity, NoteTarget target) override { }
+    void assignPluginToMidiChannel(uint8_t channel, AudioPlugin* plugin) override { }
+    void mapMidiCmd(AudioPlugin* plugin, int valueIndex, const std::string& cmd, const std::string& curve) override { }
+    AudioPluginHandlerInterface& config(nlohmann::json& config) override { return *this; }
+    bool isPlaying() override { return true; }
+    bool isStopped() override { return false; }
+    void loop() override { }
+};
+
+struct Preset {
+    std::string name;
+    // Either explicit values { "KEY": value }, or every value set to a seeded random position
+    nlohmann::json values;
+    bool random = false;
+};
+
+uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+void applyPreset(AudioPlugin* plugin, Preset& preset)
+{
+    if (preset.random) {
+        uint32_t seed = 1234;
+        for (int i = 0; i < plugin->getValueCount(); i++) {
+            seed = seed * 1664525 + 1013904223;
+            plugin->getValue(i)->setPct((seed >> 8) / 16777216.0f);
+        }
+        return;
+    }
+    for (auto& [key, value] : preset.values.items()) {
+        ValueInterface* val = plugin->getValue(key);
+        if (val) {
+            val->set(value.get<float>());
+        }
+    }
+}
+
+int main(int argc, char* argv[])
+{
+    std::string libs = "../../build/x86/libs/audio";
+    float seconds = 10.0f;
+    uint32_t blockSize = DEFAULT_BLOCK_SIZE;
+    uint32_t sampleRate = SAMPLE_RATE;
+    std::string configFile;
+    std::string outputFile;
+    std::vector<std::string> pluginNames;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--libs" && hasValue) {
+            libs = argv[++i];
+        } else if (arg == "--seconds" && hasValue) {
+            seconds = atof(argv[++i]);
+        } else if (arg == "--blockSize" && hasValue) {
+            blockSize = CLAMP(atoi(argv[++i]), MIN_BLOCK_SIZE, MAX_BLOCK_SIZE);
+        } else if (arg == "--sampleRate" && hasValue) {
+            sampleRate = CLAMP(atoi(argv[++i]), MIN_SAMPLE_RATE, MAX_SAMPLE_RATE);
+        } else if (arg == "--config" && hasValue) {
+            configFile = argv[++i];
+        } else if (arg == "--output" && hasValue) {
+            outputFile = argv[++i];
+        } else {
+            pluginNames.push_back(arg);
+        }
+    }
+
+    // Per plugin config and presets: { "SynthFM2": { "config": {...}, "presets": { "bell": { "ALGO": 6 } } } }
+    nlohmann::json benchConfig = nlohmann::json::object();
+    if (!configFile.empty()) {
+        std::ifstream file(configFile);
+        if (!file) {
+            std::cerr << "Error: Unable to open " << configFile << '\n';
+            return 1;
+        }
+        file >> benchConfig;
+    }
+
+    std::ofstream outputStream;
+    if (!outputFile.empty()) {
+        outputStream.open(outputFile);
+    }
+    std::ostream& output = outputFile.empty() ? std::cout : outputStream;
+
+    LookupTable lookupTable;
+    BenchHandler handler;
+    bool silentTracks[TOTAL_TRACKS] = {};
+    AudioPlugin::Props props = { sampleRate, AUDIO_CHANNELS, &handler, MAX_TRACKS, &lookupTable, TOTAL_TRACKS, 1, blockSize, silentTracks };
+
+    const uint8_t trackId = 1;
+    std::vector<float> buffer(blockSize * TOTAL_TRACKS);
+    // Input signal fed to every track, e.g. for effects and mixers
+    std::vector<float> input(sampleRate);
+    for (size_t i = 0; i < input.size(); i++) {
+        input[i] = lookupTable.getNoise() * 0.5f;
+    }
+
+    const uint8_t notes[] = { 48, 55, 60, 63, 67, 72 };
+    // 120 BPM: a note every beat, released half a beat later
+    const uint64_t beatFrames = sampleRate / 2;
+    const uint64_t totalFrames = seconds * sampleRate;
+    const uint64_t warmupFrames = sampleRate / 2;
+
+    PerfCounters* perf = PerfCounters::forThread();
+    if (!perf) {
+        std::cerr << "Hardware counters not available: " << strerror(errno) << ", see kernel.perf_event_paranoid\n";
+    }
+
+    int failures = 0;
+    for (std::string& pluginName : pluginNames) {
+        nlohmann::json entry = benchConfig.value(pluginName, nlohmann::json::object());
+        std::vector<Preset> presets = { { "default" }, { "random", {}, true } };
+        if (entry.contains("presets")) {
+            for (auto& [name, values] : entry["presets"].items()) {
+                presets.push_back({ name, values });
+            }
+        }
+
+        std::string path = libs + "/libzic_" + pluginName + ".so";
+        void* handle = dlopen(path.c_str(), RTLD_LAZY);
+        void* allocator = handle ? dlsym(handle, "allocator") : NULL;
+        void* deleter = handle ? dlsym(handle, "deleter") : NULL;
+        if (!allocator || !deleter) {
+            output << nlohmann::json({ { "plugin", pluginName }, { "error", handle ? "no allocator" : dlerror() } }).dump() << std::endl;
+            failures++;
+            continue;
+        }
+
+        for (Preset& preset : presets) {
+            nlohmann::json result = { { "plugin", pluginName }, { "preset", preset.name } };
+            try {
+                nlohmann::json json = entry.value("config", nlohmann::json::object());
+                AudioPlugin::Config config = { pluginName, json, trackId };
+                AudioPlugin* plugin = ((AudioPlugin * (*)(AudioPlugin::Props & props, AudioPlugin::Config & config)) allocator)(props, config);
+                applyPreset(plugin, preset);
+
+                Clock clock(sampleRate);
+                clock.setBpm(120);
+                uint64_t processNs = 0;
+                PerfCounters::Counts counts;
+                uint64_t before[PerfCounters::COUNTER_COUNT];
+                uint64_t after[PerfCounters::COUNTER_COUNT];
+                uint64_t frame = 0;
+                int8_t playingNote = -1;
+                uint32_t noteIndex = 0;
+                while (frame < warmupFrames + totalFrames) {
+                    bool measure = frame >= warmupFrames;
+                    for (uint32_t f = 0; f < blockSize; f++) {
+                        float* frameBuf = buffer.data() + f * props.frameStride;
+                        float in = input[(frame + f) % input.size()];
+                        for (uint16_t t = 0; t < MAX_TRACKS; t++) {
+                            frameBuf[t * props.trackStride] = in;
+                        }
+                        frameBuf[CLOCK_TRACK * props.trackStride] = clock.getClock();
+                    }
+
+                    if (playingNote == -1 && frame % beatFrames < blockSize) {
+                        playingNote = notes[noteIndex++ % sizeof(notes)];
+                        plugin->noteOn(playingNote, 1.0f);
+                    } else if (playingNote != -1 && frame % beatFrames >= beatFrames / 2) {
+                        plugin->noteOff(playingNote, 0.0f);
+                        playingNote = -1;
+                    }
+
+                    countAllocations = measure;
+                    bool counted = measure && perf && perf->read(before);
+                    uint64_t start = nowNs();
+                    if (plugin->hasControlTick()) {
+                        // Like the track does, see Track::processFrames()
+                        for (uint32_t f = 0; f < blockSize; f += props.controlFrames) {
+                            plugin->controlTick(f);
+                            plugin->smoothBlock(std::min(props.controlFrames, blockSize - f));
+                            plugin->sampleBlock(buffer.data() + f * props.frameStride, std::min(props.controlFrames, blockSize - f));
+                        }
+                    } else {
+                        plugin->smoothBlock(blockSize);
+                        plugin->sampleBlock(buffer.data(), blockSize);
+                    }
+                    uint64_t ns = nowNs() - start;
+                    if (counted && perf->read(after)) {
+                        counts.add(before, after, blockSize);
+                    }
+                    countAllocations = false;
+                    if (measure) {
+                        processNs += ns;
+                    }
+                    frame += blockSize;
+                }
+                ((void (*)(AudioPlugin*))deleter)(plugin);
+
+                uint64_t measuredFrames = frame - warmupFrames;
+                float nsPerSample = (float)processNs / measuredFrames;
+                result["blockSize"] = blockSize;
+                result["sampleRate"] = sampleRate;
+                result["seconds"] = (float)measuredFrames / sampleRate;
+                result["nsPerSample"] = nsPerSample;
+                result["cpuPct"] = nsPerSample * sampleRate / 1e7f;
+                result["allocations"] = allocations.exchange(0);
+                result["allocatedBytes"] = allocatedBytes.exchange(0);
+                if (counts.frames > 0) {
+                    result["ipc"] = counts.ipc();
+                    result["cyclesPerSample"] = counts.perSample(PerfCounters::CYCLES);
+                    result["l1dMissesPerSample"] = counts.perSample(PerfCounters::L1D_MISSES);
+                    result["branchMissesPerSample"] = counts.perSample(PerfCounters::BRANCH_MISSES);
+                }
+            } catch (const std::exception& e) {
+                countAllocations = false;
+                result["error"] = e.what();
+                failures++;
+            }
+            output << result.dump() << std::endl;
+        }
+    }
+    return failures > 0 ? 1 : 0;
+}
@@ -11,13 +11,22 @@ sha: fe55ee0b2f1a7ff0b9b7402ce1643a275f87dd6911073b5c323546602d8b605b
 */
 #pragma once
 
+#include <algorithm>
+#include <atomic>
 #include <functional>
 #include <math.h>
 #include <stdint.h>
+#include <unordered_map>
 #include <vector>
 
 #include "audioPlugin.h"
+#include "utils/Automation.h"
+#include "utils/InlineFn.h"
+#include "utils/ModulationSources.h"
+#include "utils/StateSnapshot.h"
 #include "helpers/clamp.h"
+#include "helpers/valueChanges.h"
+#include "utils/internKey.h"
 #include "log.h"
 
 struct DataFn {
@@ -29,10 +38,17 @@ struct DataFn {
     static const int DATA_COUNT = sizeof(dataFunctions) / sizeof(dataFunctions[0]); \
     uint8_t getDataId(std::string name) override                                    \
     {                                                                               \
-        for (size_t i = 0; i < DATA_COUNT; ++i) {                                   \
-            if (name == dataFunctions[i].name) {                                    \
-                return static_cast<uint8_t>(i);                                     \
+        /* Names are the same for all the instances, index them once per class */   \
+        static const std::unordered_map<std::string, uint8_t> ids = [this]() {      \
+            std::unordered_map<std::string, uint8_t> ids;                           \
+            for (size_t i = 0; i < DATA_COUNT; ++i) {                               \
+                ids.emplace(dataFunctions[i].name, static_cast<uint8_t>(i));        \
             }                                                                       \
+            return ids;                                                             \
+        }();                                                                        \
+        auto it = ids.find(name);                                                   \
+        if (it != ids.end()) {                                                      \
+            return it->second;                                                      \
         }                                                                           \
         return static_cast<uint8_t>(atoi(name.c_str()));                            \
     }                                                                               \
@@ -45,17 +61,96 @@ struct DataFn {
     }
 
 
+// Curve followed by a smoothed value towards its target, see Val::smooth()
+enum SmoothCurve {
+    // Constant speed, the whole range in the smoothing time
+    SMOOTH_LINEAR,
+    // Exponential decay of the distance to the target, the smoothing time being the time constant
+    SMOOTH_ONE_POLE,
+    // One pole on the log of the value, for frequencies and gains, needs a strictly positive range
+    SMOOTH_EXP,
+};
+
 class Val : public ValueInterface {
 protected:
     float value_f;
     float value_pct;
     std::string value_s;
 
-    std::function<void(float, void*)> onUpdateFn = [](float, void* data) { };
-    void* onUpdateData = NULL;
+    // Number shown for the value, only formatted into `value_s` when read, see `setNumber()`
+    struct Display {
+        float number = 0.0f;
+        uint8_t decimals = 0;
+        const char* unit = "";
+        const char* prefix = "";
+        bool pending = false;
+
+        bool operator==(const Display& other) const
+        {
+            return number == other.number && decimals == other.decimals && unit == other.unit && prefix == other.prefix;
+        }
+    } display;
 
     ValueInterface::Props _props;
 
+    // When set, changes coming from another thread than the audio one are queued, so the callback
+    // updating the DSP state only runs on the audio thread, between 2 blocks.
+    ParamQueue* queue = NULL;
+    std::atomic<uint8_t> queuedCount = 0;
+    std::atomic<float> queuedValue = 0.0f;
+    // Set when the queue was full: the latest change waits in `queuedValue`, the next ones being coalesced into it,
+    // until the audio thread applies it once the queue is drained, see `applyOverflow()`
+    std::atomic<bool> overflowed = false;
+
+    static void applyQueued(void* target, float value)
+    {
+        Val* val = (Val*)target;
+        val->queuedCount--;
+        val->apply(value);
+    }
+
+    // Value the plugin will have once all the queued changes are applied
+    float target()
+    {
+        return queuedCount > 0 ? queuedValue.load() : get();
+    }
+
+    // The UI is told once per frame, see helpers/valueChanges.h
+    void notifyChange()
+    {
+        int32_t slot = changeSlot.load(std::memory_order_relaxed);
+        if (slot >= 0) {
+            ValueChanges::get().mark(slot);
+        }
+    }
+
+    void apply(float value, void* data = NULL)
+    {
+        // The callback replaced the modulated DSP state, the next block applies the modulation again
+        modulationApplied = NAN;
+        if (callback) {
+            callback({ value, data, *this });
+        } else {
+            setFloat(value);
+        }
+        notifyChange();
+        // A lock or a modulation applies on top of the new value right away
+        if (!smoothed && (!std::isnan(locked) || modulation != 0.0f)) {
+            applyModulation();
+        }
+    }
+
+    bool smoothed = false;
+    SmoothCurve smoothCurve = SMOOTH_LINEAR;
+    float smoothFrames = 0.0f;
+    float smoothStart;
+    float smoothEnd;
+
+    // Last value passed to the callback by `applyModulation()`, NAN once the callback ran for another value
+    float modulationApplied = NAN;
+    // Value of a parameter lock, NAN when not locked, see `lock()`
+    float locked = NAN;
+
 public:
     struct CallbackProps {
         float value;
@@ -63,22 +158,21 @@ public:
         Val& val;
     };
 
-    std::string _key;
+    // Shared by all the values with the same key, see internKey()
+    const std::string& _key;
 
-    typedef std::function<void(CallbackProps)> CallbackFn;
+    // Without callback, the value is only stored
+    typedef InlineFn<void(CallbackProps)> CallbackFn;
     CallbackFn callback;
 
     Val(float initValue, std::string _key, ValueInterface::Props props = {}, CallbackFn _callback = NULL)
         : _props(props)
-        , _key(_key)
+        , _key(internKey(_key))
         , callback(_callback)
     {
         if (_props.label == "") {
             _props.label = _key;
         }
-        if (callback == NULL) {
-            callback = [this](auto p) { setFloat(p.value); };
-        }
         setFloat(initValue);
     }
 
@@ -86,7 +180,14 @@ public:
     {
         value_f = val->get();
         value_pct = val->pct();
-        value_s = val->string();
+        // The number of another Val is only formatted once this one is read
+        Val* source = dynamic_cast<Val*>(val);
+        if (source) {
+            value_s = source->value_s;
+            display = source->display;
+        } else {
+            setString(val->string());
+        }
         _props = val->props();
     }
 
@@ -95,7 +196,7 @@ public:
         return _props;
     }
 
-    std::string key()
+    const std::string& key()
     {
         return _key;
     }
@@ -113,21 +214,21 @@ public:
     void increment(int8_t steps)
     {
         if (_props.incType & INC_SCALED) {
-            int magnitude = get();
+            int magnitude = target();
             if (magnitude >= 10000) {
-                set(get() + (steps > 0 ? 1000 : -1000));
+                set(target() + (steps > 0 ? 1000 : -1000));
             } else if (magnitude >= 1000) {
-                set(get() + (steps > 0 ? 100 : -100));
+                set(target() + (steps > 0 ? 100 : -100));
             } else if (magnitude >= 100) {
-                set(get() + (steps > 0 ? 10 : -10));
+                set(target() + (steps > 0 ? 10 : -10));
             } else if (magnitude <= -10000) {
-                set(get() - (steps > 0 ? 1000 : -1000));
+                set(target() - (steps > 0 ? 1000 : -1000));
             } else if (magnitude <= -1000) {
-                set(get() - (steps > 0 ? 100 : -100));
+                set(target() - (steps > 0 ? 100 : -100));
             } else if (magnitude <= -100) {
-                set(get() - (steps > 0 ? 10 : -10));
+                set(target() - (steps > 0 ? 10 : -10));
             } else {
-                set(get() + steps);
+                set(target() + steps);
             }
             return;
         }
@@ -138,7 +239,7 @@ public:
         if (_props.incType & INC_EXP) {
             // use _props.step for base
             float base = _props.step == 1.0f ? 2.0f : _props.step;
-            float incVal = log(get()) / log(base);
+            float incVal = log(target()) / log(base);
             incVal += steps;
             set(pow(base, incVal));
             return;
@@ -146,23 +247,42 @@ public:
         if (_props.incType & INC_MULT) {
             float mult = (_props.step == 1.0f ? 1.1f : _props.step) * abs(steps);
             if (steps < 0) {
-                set(get() / mult);
+                set(target() / mult);
             } else {
-                set(get() * mult);
+                set(target() * mult);
             }
             return;
         }
-        set(get() + ((float)steps * _props.step));
+        set(target() + ((float)steps * _props.step));
     }
 
     std::string string()
     {
+        if (display.pending) {
+            char buffer[64];
+            snprintf(buffer, sizeof(buffer), "%s%.*f%s", display.prefix, display.decimals, display.number, display.unit);
+            value_s = buffer;
+            display.pending = false;
+        }
         return value_s;
     }
 
     void setString(std::string value)
     {
         value_s = value;
+        display.pending = false;
+    }
+
+    // Display a number, e.g. `setNumber(morph, 0, "%")`, formatted only once read by `string()`, so the callbacks
+    // don't build a string for each change. `unit` and `prefix` must be static strings, e.g. literals.
+    void setNumber(float number, uint8_t decimals = 0, const char* unit = "", const char* prefix = "")
+    {
+        Display next = { number, decimals, unit, prefix, true };
+        if (!display.pending && next == display) {
+            // Already formatted
+            return;
+        }
+        display = next;
     }
 
     void setFloat(float value)
@@ -173,8 +293,34 @@ public:
 
     void set(float value, void* data = NULL)
     {
-        callback({ value, data, *this });
-        onUpdateFn(value, onUpdateData);
+        // `data` is only valid during the call, so such changes cannot be deferred
+        if (queue && data == NULL && queue->shouldQueue()) {
+            queuedValue = value;
+            if (overflowed) {
+                return;
+            }
+            queuedCount++;
+            if (!queue->push(applyQueued, this, value)) {
+                overflowed = true;
+                queue->overflow();
+            }
+            return;
+        }
+        apply(value, data);
+    }
+
+    // From the audio thread, once the queue is drained
+    void applyOverflow()
+    {
+        if (overflowed.exchange(false)) {
+            queuedCount--;
+            apply(queuedValue.load());
+        }
+    }
+
+    void setQueue(ParamQueue* paramQueue)
+    {
+        queue = paramQueue;
     }
 
     void setPct(float pct)
@@ -183,18 +329,138 @@ public:
         set(value);
     }
 
-    void setOnUpdateCallback(std::function<void(float, void*)> callback, void* data)
+    float pct()
     {
-        onUpdateFn = callback;
-        onUpdateData = data;
+        return value_pct;
     }
 
-    float pct()
+    // Percentage of any value within the range of this one
+    float pctOf(float value)
     {
-        return value_pct;
+        return (value - _props.min) / (_props.max - _props.min);
     }
 
     void checkForUpdate() { }
+
+    // Opt-in smoothing: instead of jumping, the value read by the DSP follows `get()` with the given curve,
+    // advanced once per block by the audio thread (see Mapping::smooth()). Blocks read the value at their start
+    // and at their end, ramping between both with `smoothStep()`.
+    void smooth(SmoothCurve curve, float ms, uint64_t sampleRate)
+    {
+        smoothed = true;
+        smoothCurve = curve == SMOOTH_EXP && _props.min <= 0.0f ? SMOOTH_ONE_POLE : curve;
+        smoothFrames = ms * sampleRate / 1000.0f;
+        smoothStart = smoothEnd = value_f;
+    }
+
+    bool isSmoothed()
+    {
+        return smoothed;
+    }
+
+    // Move the smoothed value towards the current one, for a block of `frames`
+    void smoothBlock(uint32_t frames)
+    {
+        smoothStart = smoothEnd;
+        float target = modulatedValue();
+        if (smoothStart == target) {
+            return;
+        }
+        if (smoothFrames < 1.0f) {
+            smoothEnd = target;
+            return;
+        }
+        float range = _props.max - _props.min;
+        if (smoothCurve == SMOOTH_LINEAR) {
+            float delta = range * frames / smoothFrames;
+            smoothEnd = smoothStart < target ? std::min(smoothStart + delta, target) : std::max(smoothStart - delta, target);
+            return;
+        }
+        float decay = expf(-(float)frames / smoothFrames);
+        if (smoothCurve == SMOOTH_EXP) {
+            smoothEnd = target * powf(smoothStart / target, decay);
+        } else {
+            smoothEnd = target + (smoothStart - target) * decay;
+        }
+        // Close enough, stop ramping
+        if (fabsf(smoothEnd - target) < range * 0.00001f) {
+            smoothEnd = target;
+        }
+    }
+
+    // Smoothed value at the start of the current block
+    inline float smoothStartValue()
+    {
+        return smoothed ? smoothStart : value_f;
+    }
+
+    // Smoothed value at the end of the current block, the value to use for plugins processing sample by sample
+    inline float smoothValue()
+    {
+        return smoothed ? smoothEnd : value_f;
+    }
+
+    // Increment per frame to ramp linearly from the start to the end of a block of `frames`
+    inline float smoothStep(uint32_t frames)
+    {
+        return smoothed ? (smoothEnd - smoothStart) / frames : 0.0f;
+    }
+
+    inline bool isSmoothing()
+    {
+        return smoothed && smoothStart != smoothEnd;
+    }
+
+    // Offset added to the value by the modulation routes, see Mapping::mapModulation()
+    float modulation = 0.0f;
+
+    inline float modulatedValue()
+    {
+        float base = std::isnan(locked) ? value_f : locked;
+        return modulation == 0.0f ? base : CLAMP(base + modulation, _props.min, _props.max);
+    }
+
+    // Parameter lock, e.g. of a sequencer step: the DSP follows `value` instead of the value set by the user, kept for
+    // the UI and the saved state, until `unlock()`. Called on the audio thread of the plugin, the callback running
+    // right away, or for a smoothed value, ramping from the next block.
+    void lock(float value) override
+    {
+        locked = CLAMP(value, _props.min, _props.max);
+        if (!smoothed) {
+            applyModulation();
+        }
+    }
+
+    void unlock() override
+    {
+        if (std::isnan(locked)) {
+            return;
+        }
+        locked = NAN;
+        if (!smoothed) {
+            applyModulation();
+        }
+    }
+
+    // For the values that are not smoothed, the modulated value goes through the callback, once per block when it
+    // changes, the value itself keeping the one set by the user, e.g. for the UI and the saved state
+    void applyModulation()
+    {
+        float value = modulatedValue();
+        if (value == modulationApplied) {
+            return;
+        }
+        float base = value_f;
+        // Swapped, not copied, the block not allocating for it
+        std::string label;
+        label.swap(value_s);
+        Display shown = display;
+        callback({ value, NULL, *this });
+        setFloat(base);
+        value_s.swap(label);
+        display = shown;
+        modulationApplied = value;
+    }
 };
 
 class Mapping : public AudioPlugin {
@@ -202,9 +468,122 @@ public:
     std::vector<ValueInterface*> mapping;
 
 protected:
+    // Index of each value key, built once all the values are declared (see indexValues)
+    std::unordered_map<std::string, int> valueIndexes;
+    size_t indexedCount = 0;
+
+    // Values as of the end of the last block they changed, read by serializeJson
+    StateSnapshot<std::vector<float>> valuesSnapshot;
+    std::vector<float> publishedValues;
+
+    std::vector<Val*> smoothedValues;
+    // Values changed through the parameter queue
+    std::vector<Val*> queuedValues;
+
+    // Changes kept by the values while the parameter queue was full, applied once it is drained
+    static void applyOverflow(void* data)
+    {
+        for (Val* value : ((Mapping*)data)->queuedValues) {
+            value->applyOverflow();
+        }
+    }
+
+    enum ModulationCurve {
+        MODULATION_LINEAR,
+        // Finer around 0
+        MODULATION_EXP,
+        // Finer around the extremes
+        MODULATION_LOG,
+    };
+    struct ModulationRoute {
+        uint8_t source;
+        Val* val;
+        // Part of the range of the value, negative to invert the source
+        float depth;
+        ModulationCurve curve;
+    };
+    std::vector<ModulationRoute> modulationRoutes;
+    // Each value modulated, once, however many routes it has
+    std::vector<Val*> modulatedValues;
+
+    // Sum the routes of each value, from the sources of the current block
+    void modulate()
+    {
+        if (modulationRoutes.empty()) {
+            return;
+        }
+        for (Val* value : modulatedValues) {
+            value->modulation = 0.0f;
+        }
+        for (ModulationRoute& route : modulationRoutes) {
+            float source = props.modulation->get(route.source);
+            float amount = route.curve == MODULATION_EXP ? source * fabsf(source)
+                : route.curve == MODULATION_LOG          ? copysignf(sqrtf(fabsf(source)), source)
+                                                         : source;
+            ValueInterface::Props& range = route.val->props();
+            route.val->modulation += amount * route.depth * (range.max - range.min);
+        }
+        for (Val* value : modulatedValues) {
+            if (!value->isSmoothed()) {
+                value->applyModulation();
+            }
+        }
+    }
+
+    Automation automation;
+
+    // Changes drained from the parameter queue while recording the automation, at their frame in the block
+    static void recordQueued(void* data, void* target, float value, uint64_t frame)
+    {
+        Mapping* plugin = (Mapping*)data;
+        uint64_t blockFrame = plugin->paramQueue.now();
+        plugin->automation.record((Val*)target, frame > blockFrame ? frame - blockFrame : 0, value);
+    }
+
+    // Clip state being hydrated by `hydrateState()`, its values replacing `json["values"]` in `hydrateJson()`
+    ClipState::Plugin* hydrating = NULL;
+
+    // Resolve the value IDs of a clip state, only the first time
+    void resolveValues(ClipState::Plugin& state)
+    {
+        if (state.resolvedFor != this || state.ids.size() != state.keys.size()) {
+            state.ids.resize(state.keys.size());
+            for (size_t i = 0; i < state.keys.size(); i++) {
+                state.ids[i] = getValueIndex(state.keys[i]);
+            }
+            state.resolvedFor = this;
+        }
+    }
+
+    // Set the values of a clip state by value ID
+    void hydrateValues(ClipState::Plugin& state)
+    {
+        resolveValues(state);
+        for (size_t i = 0; i < state.ids.size(); i++) {
+            if (state.ids[i] >= 0) {
+                mapping[state.ids[i]]->set(state.values[i]);
+            }
+        }
+    }
+
+    // Smooth the changes of a value, e.g. `smooth(cutoff, SMOOTH_EXP, 20.0f)`, see Val::smooth()
+    Val& smooth(Val& value, SmoothCurve curve, float ms)
+    {
+        if (!value.isSmoothed()) {
+            smoothedValues.push_back(&value);
+        }
+        value.smooth(curve, ms, props.sampleRate);
+        return value;
+    }
+
     Val& val(float initValue, std::string _key, ValueInterface::Props props = {}, Val::CallbackFn _callback = NULL)
     {
         Val* v = new Val(initValue, _key, props, _callback);
+        // Values without callback only store the value, there is no DSP state to protect
+        if (_callback != NULL) {
+            v->setQueue(&paramQueue);
+            queuedValues.push_back(v);
+        }
         mapping.push_back(v);
         // debug("-------- Mapping: %s\n", v->key());
         return *v;
@@ -215,6 +594,7 @@ public:
         : AudioPlugin(props, config)
         , mapping(mapping)
     {
+        paramQueue.setOverflowHandler(applyOverflow, this);
     }
 
     void val(ValueInterface* value)
@@ -241,8 +621,97 @@ public:
         }
     }
 
+    void mapModulation(nlohmann::json& json) override
+    {
+        //#md `{ "modulation": [{"source": "LFO_1", "parameter": "CUTOFF", "depth": 0.2, "curve": "linear"}] }` route a modulation source, see `modulationSources` in the host config, to a given plugin value. `depth` is the part of the range of the value added at the peak of the source, negative to invert it (default 0.5). The optional curve is `linear`, `exp` (finer around 0) or `log`. The routes are evaluated once per block: the smoothed values (e.g. `VOLUME` of EffectGainVolume) ramp to their modulated value, the others get it through their callback, the value shown and saved staying the one set by the user.
+        if (!json.contains("modulation") || !json["modulation"].is_array()) {
+            return;
+        }
+        if (!props.modulation) {
+            logWarn("No modulation sources, the modulation of %s is ignored", name.c_str());
+            return;
+        }
+        for (nlohmann::json& route : json["modulation"]) {
+            int source = props.modulation->find(route.value("source", ""));
+            int index = getValueIndex(route.value("parameter", ""));
+            if (source < 0 || index < 0) {
+                logWarn("Invalid modulation route for %s: %s", name.c_str(), route.dump().c_str());
+                continue;
+            }
+            Val* val = (Val*)mapping[index];
+            std::string curve = route.value("curve", "linear");
+            modulationRoutes.push_back({ (uint8_t)source, val, route.value("depth", 0.5f),
+                curve == "exp" ? MODULATION_EXP : curve == "log" ? MODULATION_LOG : MODULATION_LINEAR });
+            if (std::find(modulatedValues.begin(), modulatedValues.end(), val) == modulatedValues.end()) {
+                modulatedValues.push_back(val);
+            }
+        }
+    }
+
+    void indexValues() override
+    {
+        valueIndexes.clear();
+        for (int i = 0; i < mapping.size(); i++) {
+            // Keep the first value when a key is used twice, like the linear lookup
+            valueIndexes.emplace(mapping[i]->key(), i);
+        }
+        indexedCount = mapping.size();
+
+        publishedValues.resize(mapping.size());
+        for (int i = 0; i < mapping.size(); i++) {
+            publishedValues[i] = mapping[i]->get();
+        }
+        valuesSnapshot.init([&](std::vector<float>& values) { values = publishedValues; });
+    }
+
+    void smoothBlock(uint32_t frames) override
+    {
+        automation.process(frames);
+        modulate();
+        for (Val* value : smoothedValues) {
+            value->smoothBlock(frames);
+        }
+    }
+
+    void publishState() override
+    {
+        bool dirty = !valuesSnapshot.published;
+        // Values added since they were indexed: the copies grow once, each buffer allocating the next time it is
+        // written, then the copies are the same size again
+        if (publishedValues.size() != mapping.size()) {
+            publishedValues.resize(mapping.size(), NAN);
+            dirty = true;
+        }
+        for (int i = 0; i < mapping.size(); i++) {
+            float value = mapping[i]->get();
+            if (value != publishedValues[i]) {
+                publishedValues[i] = value;
+                dirty = true;
+            }
+        }
+        if (dirty) {
+            // Same size, apart from the values added, so the copy does not allocate
+            valuesSnapshot.back() = publishedValues;
+            valuesSnapshot.publish();
+        }
+    }
+
+    bool readValues(std::vector<float>& values) override
+    {
+        if (!valuesSnapshot.published) {
+            return false;
+        }
+        valuesSnapshot.read([&](std::vector<float>& snapshot) { values = snapshot; });
+        return true;
+    }
+
     int getValueIndex(std::string key) override
     {
+        if (indexedCount == mapping.size()) {
+            auto it = valueIndexes.find(key);
+            return it != valueIndexes.end() ? it->second : -1;
+        }
+        // Values declared after the index was built, fall back to the scan
         for (int i = 0; i < mapping.size(); i++) {
             if (mapping[i]->key() == key) {
                 return i;
@@ -265,10 +734,9 @@ public:
 
     ValueInterface* getValue(std::string key) override
     {
-        for (int i = 0; i < mapping.size(); i++) {
-            if (mapping[i]->key() == key) {
-                return mapping[i];
-            }
+        int valueIndex = getValueIndex(key);
+        if (valueIndex != -1) {
+            return mapping[valueIndex];
         }
         printf("!!!!!!!! getValue not found: %s\n", key.c_str());
         // for (int i = 0; i < mapping.size(); i++) {
@@ -277,18 +745,113 @@ public:
         return NULL;
     }
 
+    void automationEvent(AudioEventType event) override
+    {
+        if (event == AudioEventType::SEQ_LOOP) {
+            automation.loop();
+        } else if (event == AudioEventType::STOP) {
+            automation.stop();
+        } else if (event == AudioEventType::RECORD_AUTOMATION) {
+            automation.arm(true);
+            paramQueue.setRecorder(recordQueued, this);
+        } else if (event == AudioEventType::STOP_AUTOMATION) {
+            paramQueue.setRecorder(NULL, NULL);
+            automation.arm(false);
+        } else if (event == AudioEventType::CLEAR_AUTOMATION) {
+            automation.clear();
+        }
+    }
+
+    void serializeAutomation(nlohmann::json& json) override
+    {
+        automation.serialize(json);
+    }
+
     void serializeJson(nlohmann::json& json) override
     {
         // Use array because order matter
         nlohmann::json values = nlohmann::json::array();
-        for (ValueInterface* val : mapping) {
-            values.push_back({ { "key", val->key() }, { "value", val->get() } });
+        if (valuesSnapshot.published) {
+            valuesSnapshot.read([&](std::vector<float>& snapshot) {
+                for (int i = 0; i < snapshot.size(); i++) {
+                    values.push_back({ { "key", mapping[i]->key() }, { "value", snapshot[i] } });
+                }
+            });
+        } else {
+            for (ValueInterface* val : mapping) {
+                values.push_back({ { "key", val->key() }, { "value", val->get() } });
+            }
         }
         json["values"] = values;
     }
 
+    // Value `key` as saved in a serialized state, `fallback` if not there
+    float hydratedValue(nlohmann::json& json, std::string key, float fallback)
+    {
+        if (hydrating) {
+            for (size_t i = 0; i < hydrating->keys.size(); i++) {
+                if (hydrating->keys[i] == key) {
+                    return hydrating->values[i];
+                }
+            }
+            return fallback;
+        }
+        if (json.contains("values")) {
+            for (auto& value : json["values"]) {
+                if (value.value("key", "") == key && value.contains("value")) {
+                    return value["value"];
+                }
+            }
+        }
+        return fallback;
+    }
+
+    // Replace the value `key` of a serialized state before hydrating it, e.g. an ID depending on the other fields
+    void setHydratedValue(nlohmann::json& json, std::string key, float value)
+    {
+        if (hydrating) {
+            for (size_t i = 0; i < hydrating->keys.size(); i++) {
+                if (hydrating->keys[i] == key) {
+                    hydrating->values[i] = value;
+                }
+            }
+            return;
+        }
+        if (json.contains("values")) {
+            for (auto& item : json["values"]) {
+                if (item.value("key", "") == key) {
+                    item["value"] = value;
+                }
+            }
+        }
+    }
+
+    // The values come from the clip state, the rest of the state being in `json`, so the plugins hydrating more
+    // than their values get it the same way as with `hydrateJson()`
+    void hydrateState(ClipState::Plugin& state) override
+    {
+        hydrating = &state;
+        hydrateJson(state.extra);
+        hydrating = NULL;
+        automation.hydrate(state.extra, [&](std::string key) {
+            int index = getValueIndex(key);
+            return index >= 0 ? mapping[index] : NULL;
+        });
+    }
+
+    // The value IDs are resolved when staging, so the commit only sets the values
+    void stageState(ClipState::Plugin& state) override
+    {
+        resolveValues(state);
+        AudioPlugin::stageState(state);
+    }
+
     void hydrateJson(nlohmann::json& json) override
     {
+        if (hydrating) {
+            hydrateValues(*hydrating);
+            return;
+        }
         if (json.contains("values")) {
             auto& values = json["values"];
             for (int i = 0; i < values.size(); i++) {
@@ -0,0 +1,123 @@
+#pragma once
+
+#include <atomic>
+#include <stdint.h>
+#include <thread>
+
+#include "helpers/MpscQueue.h"
+
+// Queue of parameter changes, filled by any thread (UI, encoders, midi...) and drained by the audio
+// thread processing the plugin, right before it processes a block.
+class ParamQueue {
+public:
+    typedef void (*ApplyFn)(void* target, float value);
+    // Called with each change drained, and its frame, e.g. to record the automation, see Mapping::recordQueued()
+    typedef void (*RecordFn)(void* data, void* target, float value, uint64_t frame);
+    // Called once the queue is drained, after changes could not be queued, see `overflow()`
+    typedef void (*OverflowFn)(void* data);
+
+    struct Entry {
+        ApplyFn apply;
+        void* target;
+        float value;
+        // Frame at which the change must be applied, 0 meaning as soon as possible
+        uint64_t frame;
+    };
+
+protected:
+    MpscQueue<Entry, 128> queue;
+
+    std::atomic<bool> active = false;
+    std::atomic<std::thread::id> consumer;
+    std::atomic<uint64_t> currentFrame = 0;
+    RecordFn record = NULL;
+    void* recordData = NULL;
+    std::atomic<uint32_t> applied = 0;
+    std::atomic<bool> overflowed = false;
+    OverflowFn onOverflow = NULL;
+    void* overflowData = NULL;
+
+public:
+    // Only once activated, the changes are queued. Before, e.g. while loading the config, there is no audio
+    // thread processing the plugin, so changes can be applied right away.
+    void activate()
+    {
+        active = true;
+    }
+
+    // Whether a change coming from the current thread must go through the queue. Changes made by the
+    // audio thread itself (e.g. from inside sample()) are applied right away.
+    bool shouldQueue()
+    {
+        return active.load(std::memory_order_relaxed) && consumer.load(std::memory_order_relaxed) != std::this_thread::get_id();
+    }
+
+    // Whether the current thread is the audio thread processing the plugin, which must never wait
+    bool isConsumerThread()
+    {
+        return active.load(std::memory_order_relaxed) && consumer.load(std::memory_order_relaxed) == std::this_thread::get_id();
+    }
+
+    // First frame of the block currently processed, to compute the timestamp of a change
+    uint64_t now()
+    {
+        return currentFrame.load(std::memory_order_relaxed);
+    }
+
+    // Changes applied so far, e.g. for the undo history to notice a change, see UndoHistory.h
+    uint32_t changes()
+    {
+        return applied.load(std::memory_order_relaxed);
+    }
+
+    // Set between two blocks, NULL to stop recording
+    void setRecorder(RecordFn fn, void* data)
+    {
+        recordData = data;
+        record = fn;
+    }
+
+    // Set before the queue is activated
+    void setOverflowHandler(OverflowFn fn, void* data)
+    {
+        overflowData = data;
+        onOverflow = fn;
+    }
+
+    // Return false if the queue is full. The change must then never be applied by the calling thread: the caller
+    // keeps it, calls `overflow()`, and applies it from the overflow handler, on the audio thread.
+    bool push(ApplyFn apply, void* target, float value, uint64_t frame = 0)
+    {
+        return queue.push({ apply, target, value, frame });
+    }
+
+    void overflow()
+    {
+        overflowed = true;
+    }
+
+    // Apply all the changes due before `untilFrame`, the end of the block about to be processed.
+    // Must only be called by the audio thread processing the plugin.
+    void drain(uint64_t blockFrame, uint64_t untilFrame)
+    {
+        consumer.store(std::this_thread::get_id(), std::memory_order_relaxed);
+        currentFrame.store(blockFrame, std::memory_order_relaxed);
+        Entry* entry;
+        while ((entry = queue.front()) != NULL) {
+            if (entry->frame >= untilFrame) {
+                // Changes are expected in chronological order, so the next ones are not due either
+                return;
+            }
+            if (record) {
+                record(recordData, entry->target, entry->value, entry->frame ? entry->frame : blockFrame);
+            }
+            entry->apply(entry->target, entry->value);
+            queue.pop();
+            applied.store(applied.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+        }
+        // Only once the queue is empty, the changes kept by the callers being the latest ones
+        if (onOverflow && overflowed.exchange(false)) {
+            onOverflow(overflowData);
+        }
+    }
+};
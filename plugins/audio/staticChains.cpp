@@ -0,0 +1,26 @@
+// Chains of plugins rendered without virtual calls by the static build, see host/TrackChain.h. Each chain is only
+// used for the tracks made of exactly these plugins, in this order, so it is worth declaring the common ones, e.g.
+// the tracks of the default configs. All the plugins of a chain must be part of STATIC_PLUGINS, and their headers must
+// build together: e.g. SynthBass and SynthMultiEngine use two different `WavetableGenerator`.
+#include "host/TrackChain.h"
+
+#include "AudioOutputAlsa_int16.h"
+#include "EffectFilter.h"
+#include "EffectGainVolume.h"
+#include "EffectVolumeDrive.h"
+#include "Mixer.h"
+#include "Sequencer.h"
+#include "SerializeTrack.h"
+#include "SynthFM2.h"
+#include "SynthMultiEngine.h"
+#include "SynthMultiSample.h"
+#include "Tempo.h"
+
+namespace {
+// Synth, filter, drive and volume
+TrackChain<SynthFM2, EffectFilter, EffectVolumeDrive, EffectGainVolume> fmChain;
+// Tracks and master of the Pixel config
+TrackChain<SynthMultiEngine, Sequencer, SerializeTrack> engineChain;
+TrackChain<SynthMultiSample, Sequencer, SerializeTrack> sampleChain;
+TrackChain<Mixer8, EffectGainVolume, AudioOutputAlsa_int16, SerializeTrack, Tempo> masterChain;
+}
@@ -3,10 +3,10 @@ This C++ header file establishes the core logic for a sophisticated sequencing o
 
 The file defines two major arrays of dynamic rules that give the system its flexibility:
 
-1.  **Step Conditions:** These are predefined criteria that dictate *if* an action should occur. They include fixed timing rules (e.g., "only run on every 4th beat") and probability-based rules (e.g., "run with a 10% chance"), making use of a custom randomization function.
-2.  **Step Motions:** These are dynamic patterns that determine *how* a specific value, typically a musical pitch shift (measured in semitones), should change over time. Patterns can be simple oscillations (e.g., 0 then 1, repeating) or entirely random offsets.
+1.  **Step Conditions:** These are predefined criteria that dictate *if* an action should occur. They include fixed timing rules (e.g., "only run on every 4th beat") and probability-based rules (e.g., "run with a 10% chance"), drawn from a xorshift random generator owned by each sequencer, so a seeded pattern plays the same each time.
+2.  **Step Motions:** These are dynamic patterns that determine *how* a specific value, typically a musical pitch shift (measured in semitones), should change over time. Patterns can be simple oscillations (e.g., 0 then 1, repeating) or entirely random offsets. Both lists are plain data tables, evaluated without any indirect call.
 
-Central to the system is the **Step Class**. This class represents a single, programmable event within the sequence. It stores all necessary properties, such as whether it is active, its musical pitch, volume (velocity), duration, and current position. Crucially, each step selects one rule from the Conditions list and one pattern from the Motions list, allowing the event to respond dynamically as the sequence loops.
+Central to the system is the **Step Class**. This class represents a single, programmable event within the sequence. It stores all necessary properties, such as whether it is active, its musical pitch, volume (velocity), duration, current position, and a micro timing offset playing it slightly early or late. Crucially, each step selects one rule from the Conditions list and one pattern from the Motions list, allowing the event to respond dynamically as the sequence loops.
 
 The class ensures data integrity by using safety mechanisms (called clamping) to prevent parameters like velocity or note pitch from exceeding realistic ranges. It also provides essential methods for comparing steps and for saving/loading all configuration data efficiently using the structured JSON format.
 
@@ -15,11 +15,9 @@ sha: c827a99d7663e1ccd4aeb3e27ac736559ffee0f0739eebef3e7bddc1e3be37db
 #pragma once
 
 #include <cstring>
-#include <functional>
 #include <math.h>
 #include <stdint.h>
 #include <string>
-#include <time.h>
 
 // #include "helpers/midiNote.h"
 #include "helpers/format.h"
@@ -28,121 +26,174 @@ sha: c827a99d7663e1ccd4aeb3e27ac736559ffee0f0739eebef3e7bddc1e3be37db
 
 #include "libs/nlohmann/json.hpp"
 
-int randCounter = 0;
-int getRand()
-{
-    srand(time(NULL) + randCounter++);
-    return rand();
-}
+// Xorshift random numbers, owned by a sequencer, so each track draws its own stream without sharing any state with
+// the other track threads. Seeded the same, it draws the same numbers, for patterns rendered the same each time.
+class StepRandom {
+protected:
+    uint32_t state = 2463534242u;
 
+public:
+    void seed(uint32_t value)
+    {
+        state = value ? value : 2463534242u;
+    }
+
+    inline uint32_t next()
+    {
+        state ^= state << 13;
+        state ^= state >> 17;
+        state ^= state << 5;
+        return state;
+    }
+};
+
+// Plain table, evaluated without any indirect call: a condition is met on the loops `every` apart starting from
+// `remainder`, then with a probability of `percent`.
 struct StepCondition {
     const char* name;
-    bool (*conditionMet)(uint8_t loopCounter);
-} stepConditions[] = {
-    { "---", [](uint8_t loopCounter) { return true; } },
-    { "Pair", [](uint8_t loopCounter) { return loopCounter % 2 == 0; } },
-    { "4th", [](uint8_t loopCounter) { return loopCounter % 4 == 0; } },
-    { "6th", [](uint8_t loopCounter) { return loopCounter % 6 == 0; } },
-    { "8th", [](uint8_t loopCounter) { return loopCounter % 8 == 0; } },
-    { "Impair", [](uint8_t loopCounter) { return loopCounter % 2 == 1; } },
-    { "1%", [](uint8_t loopCounter) { return (getRand() % 100) == 0; } },
-    { "2%", [](uint8_t loopCounter) { return (getRand() % 100) < 2; } },
-    { "5%", [](uint8_t loopCounter) { return (getRand() % 100) < 5; } },
-    { "10%", [](uint8_t loopCounter) { return (getRand() % 100) < 10; } },
-    { "20%", [](uint8_t loopCounter) { return (getRand() % 100) < 20; } },
-    { "30%", [](uint8_t loopCounter) { return (getRand() % 100) < 30; } },
-    { "40%", [](uint8_t loopCounter) { return (getRand() % 100) < 40; } },
-    { "50%", [](uint8_t loopCounter) { return (getRand() % 100) < 50; } },
-    { "60%", [](uint8_t loopCounter) { return (getRand() % 100) < 60; } },
-    { "70%", [](uint8_t loopCounter) { return (getRand() % 100) < 70; } },
-    { "80%", [](uint8_t loopCounter) { return (getRand() % 100) < 80; } },
-    { "90%", [](uint8_t loopCounter) { return (getRand() % 100) < 90; } },
-    { "95%", [](uint8_t loopCounter) { return (getRand() % 100) < 95; } },
-    { "98%", [](uint8_t loopCounter) { return (getRand() % 100) < 98; } },
-    { "99%", [](uint8_t loopCounter) { return (getRand() % 100) < 99; } },
+    uint8_t every;
+    uint8_t remainder;
+    uint8_t percent;
+
+    bool conditionMet(uint16_t loopCounter, StepRandom& random) const
+    {
+        return loopCounter % every == remainder && (percent >= 100 || random.next() % 100 < percent);
+    }
 };
 
+const StepCondition stepConditions[] = {
+    { "---", 1, 0, 100 },
+    { "Pair", 2, 0, 100 },
+    { "4th", 4, 0, 100 },
+    { "6th", 6, 0, 100 },
+    { "8th", 8, 0, 100 },
+    { "Impair", 2, 1, 100 },
+    { "1%", 1, 0, 1 },
+    { "2%", 1, 0, 2 },
+    { "5%", 1, 0, 5 },
+    { "10%", 1, 0, 10 },
+    { "20%", 1, 0, 20 },
+    { "30%", 1, 0, 30 },
+    { "40%", 1, 0, 40 },
+    { "50%", 1, 0, 50 },
+    { "60%", 1, 0, 60 },
+    { "70%", 1, 0, 70 },
+    { "80%", 1, 0, 80 },
+    { "90%", 1, 0, 90 },
+    { "95%", 1, 0, 95 },
+    { "98%", 1, 0, 98 },
+    { "99%", 1, 0, 99 },
+};
+
+// A motion shifts the note by the semitones of its pattern, one per loop, else by a random number of semitones:
+// from 0 to `random` - 1, or either 0 or `randomJump`.
 struct StepMotion {
     const char* name;
-    std::function<int8_t(uint8_t loopCounter)> get;
-} stepMotions[] = {
-    { "---", [](uint8_t loopCounter) { return 0; } },
-    { "0,1", [](uint8_t loopCounter) { uint8_t semitone[2] = { 0, 1 }; return semitone[loopCounter % 2]; } },
-    { "1,0", [](uint8_t loopCounter) { uint8_t semitone[2] = { 1, 0 }; return semitone[loopCounter % 2]; } },
-    { "0,2", [](uint8_t loopCounter) { uint8_t semitone[2] = { 0, 2 }; return semitone[loopCounter % 2]; } },
-    { "2,0", [](uint8_t loopCounter) { uint8_t semitone[2] = { 2, 0 }; return semitone[loopCounter % 2]; } },
-    { "0,3", [](uint8_t loopCounter) { uint8_t semitone[2] = { 0, 3 }; return semitone[loopCounter % 2]; } },
-    { "3,0", [](uint8_t loopCounter) { uint8_t semitone[2] = { 3, 0 }; return semitone[loopCounter % 2]; } },
-    { "0,4", [](uint8_t loopCounter) { uint8_t semitone[2] = { 0, 4 }; return semitone[loopCounter % 2]; } },
-    { "4,0", [](uint8_t loopCounter) { uint8_t semitone[2] = { 4, 0 }; return semitone[loopCounter % 2]; } },
-    { "0,5", [](uint8_t loopCounter) { uint8_t semitone[2] = { 0, 5 }; return semitone[loopCounter % 2]; } },
-    { "5,0", [](uint8_t loopCounter) { uint8_t semitone[2] = { 5, 0 }; return semitone[loopCounter % 2]; } },
-    { "0,6", [](uint8_t loopCounter) { uint8_t semitone[2] = { 0, 6 }; return semitone[loopCounter % 2]; } },
-    { "6,0", [](uint8_t loopCounter) { uint8_t semitone[2] = { 6, 0 }; return semitone[loopCounter % 2]; } },
-    { "0,12", [](uint8_t loopCounter) { uint8_t semitone[2] = { 0, 12 }; return semitone[loopCounter % 2]; } },
-    { "12,0", [](uint8_t loopCounter) { uint8_t semitone[2] = { 12, 0 }; return semitone[loopCounter % 2]; } },
-    { "0,1,2", [](uint8_t loopCounter) { uint8_t semitone[3] = { 0, 1, 2 }; return semitone[loopCounter % 3]; } },
-    { "2,1,0", [](uint8_t loopCounter) { uint8_t semitone[3] = { 2, 1, 0 }; return semitone[loopCounter % 3]; } },
-    { "0,2,4", [](uint8_t loopCounter) { uint8_t semitone[3] = { 0, 2, 4 }; return semitone[loopCounter % 3]; } },
-    { "4,2,0", [](uint8_t loopCounter) { uint8_t semitone[3] = { 4, 2, 0 }; return semitone[loopCounter % 3]; } },
-    { "0,3,6", [](uint8_t loopCounter) { uint8_t semitone[3] = { 0, 3, 6 }; return semitone[loopCounter % 3]; } },
-    { "6,3,0", [](uint8_t loopCounter) { uint8_t semitone[3] = { 6, 3, 0 }; return semitone[loopCounter % 3]; } },
-    { "0,4,8", [](uint8_t loopCounter) { uint8_t semitone[3] = { 0, 4, 8 }; return semitone[loopCounter % 3]; } },
-    { "8,4,0", [](uint8_t loopCounter) { uint8_t semitone[3] = { 8, 4, 0 }; return semitone[loopCounter % 3]; } },
-    { "0,6,12", [](uint8_t loopCounter) { uint8_t semitone[3] = { 0, 6, 12 }; return semitone[loopCounter % 3]; } },
-    { "12,6,0", [](uint8_t loopCounter) { uint8_t semitone[3] = { 12, 6, 0 }; return semitone[loopCounter % 3]; } },
-    { "0,12,24", [](uint8_t loopCounter) { uint8_t semitone[3] = { 0, 12, 24 }; return semitone[loopCounter % 3]; } },
-    { "24,12,0", [](uint8_t loopCounter) { uint8_t semitone[3] = { 24, 12, 0 }; return semitone[loopCounter % 3]; } },
-    { "0,1,2,3", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 1, 2, 3 }; return semitone[loopCounter % 4]; } },
-    { "3,2,1,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 3, 2, 1, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,2,4,6", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 2, 4, 6 }; return semitone[loopCounter % 4]; } },
-    { "6,4,2,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 6, 4, 2, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,3,6,9", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 3, 6, 9 }; return semitone[loopCounter % 4]; } },
-    { "9,6,3,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 9, 6, 3, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,4,8,12", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 4, 8, 12 }; return semitone[loopCounter % 4]; } },
-    { "12,8,4,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 12, 8, 4, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,6,12,18", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 6, 12, 18 }; return semitone[loopCounter % 4]; } },
-    { "18,12,6,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 18, 12, 6, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,2,1,3", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 2, 1, 3 }; return semitone[loopCounter % 4]; } },
-    { "3,1,2,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 3, 1, 2, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,4,2,6", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 4, 2, 6 }; return semitone[loopCounter % 4]; } },
-    { "6,2,4,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 6, 2, 4, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,6,3,9", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 6, 3, 9 }; return semitone[loopCounter % 4]; } },
-    { "9,3,6,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 9, 3, 6, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,8,4,12", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 8, 4, 12 }; return semitone[loopCounter % 4]; } },
-    { "12,4,8,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 12, 4, 8, 0 }; return semitone[loopCounter % 4]; } },
-    { "0,12,6,18", [](uint8_t loopCounter) { uint8_t semitone[4] = { 0, 12, 6, 18 }; return semitone[loopCounter % 4]; } },
-    { "18,6,12,0", [](uint8_t loopCounter) { uint8_t semitone[4] = { 18, 6, 12, 0 }; return semitone[loopCounter % 4]; } },
-    { "rand2", [](uint8_t) { return getRand() % 2; } },
-    { "rand3", [](uint8_t) { return getRand() % 3; } },
-    { "rand4", [](uint8_t) { return getRand() % 4; } },
-    { "rand5", [](uint8_t) { return getRand() % 5; } },
-    { "rand6", [](uint8_t) { return getRand() % 6; } },
-    { "rand7", [](uint8_t) { return getRand() % 7; } },
-    { "rand8", [](uint8_t) { return getRand() % 8; } },
-    { "rand9", [](uint8_t) { return getRand() % 9; } },
-    { "rand10", [](uint8_t) { return getRand() % 10; } },
-    { "rand11", [](uint8_t) { return getRand() % 11; } },
-    { "rand12", [](uint8_t) { return getRand() % 12; } },
-    { "rand13", [](uint8_t) { return getRand() % 13; } },
-    { "rand14", [](uint8_t) { return getRand() % 14; } },
-    { "rand15", [](uint8_t) { return getRand() % 15; } },
-    { "rand16", [](uint8_t) { return getRand() % 16; } },
-    { "rand17", [](uint8_t) { return getRand() % 17; } },
-    { "rand18", [](uint8_t) { return getRand() % 18; } },
-    { "rand0_2", [](uint8_t) { return getRand() % 2 == 0 ? 0 : 2; } },
-    { "rand0_3", [](uint8_t) { return getRand() % 2 == 0 ? 0 : 3; } },
-    { "rand0_4", [](uint8_t) { return getRand() % 2 == 0 ? 0 : 4; } },
-    { "rand0_5", [](uint8_t) { return getRand() % 2 == 0 ? 0 : 5; } },
-    { "rand0_6", [](uint8_t) { return getRand() % 2 == 0 ? 0 : 6; } },
-    { "rand0_12", [](uint8_t) { return getRand() % 2 == 0 ? 0 : 12; } },
+    uint8_t length;
+    int8_t semitones[4];
+    uint8_t random = 0;
+    uint8_t randomJump = 0;
+
+    int8_t get(uint16_t loopCounter, StepRandom& rand) const
+    {
+        if (length) {
+            return semitones[loopCounter % length];
+        }
+        if (random) {
+            return rand.next() % random;
+        }
+        return rand.next() % 2 == 0 ? 0 : randomJump;
+    }
+};
+
+const StepMotion stepMotions[] = {
+    { "---", 1, { 0 } },
+    { "0,1", 2, { 0, 1 } },
+    { "1,0", 2, { 1, 0 } },
+    { "0,2", 2, { 0, 2 } },
+    { "2,0", 2, { 2, 0 } },
+    { "0,3", 2, { 0, 3 } },
+    { "3,0", 2, { 3, 0 } },
+    { "0,4", 2, { 0, 4 } },
+    { "4,0", 2, { 4, 0 } },
+    { "0,5", 2, { 0, 5 } },
+    { "5,0", 2, { 5, 0 } },
+    { "0,6", 2, { 0, 6 } },
+    { "6,0", 2, { 6, 0 } },
+    { "0,12", 2, { 0, 12 } },
+    { "12,0", 2, { 12, 0 } },
+    { "0,1,2", 3, { 0, 1, 2 } },
+    { "2,1,0", 3, { 2, 1, 0 } },
+    { "0,2,4", 3, { 0, 2, 4 } },
+    { "4,2,0", 3, { 4, 2, 0 } },
+    { "0,3,6", 3, { 0, 3, 6 } },
+    { "6,3,0", 3, { 6, 3, 0 } },
+    { "0,4,8", 3, { 0, 4, 8 } },
+    { "8,4,0", 3, { 8, 4, 0 } },
+    { "0,6,12", 3, { 0, 6, 12 } },
+    { "12,6,0", 3, { 12, 6, 0 } },
+    { "0,12,24", 3, { 0, 12, 24 } },
+    { "24,12,0", 3, { 24, 12, 0 } },
+    { "0,1,2,3", 4, { 0, 1, 2, 3 } },
+    { "3,2,1,0", 4, { 3, 2, 1, 0 } },
+    { "0,2,4,6", 4, { 0, 2, 4, 6 } },
+    { "6,4,2,0", 4, { 6, 4, 2, 0 } },
+    { "0,3,6,9", 4, { 0, 3, 6, 9 } },
+    { "9,6,3,0", 4, { 9, 6, 3, 0 } },
+    { "0,4,8,12", 4, { 0, 4, 8, 12 } },
+    { "12,8,4,0", 4, { 12, 8, 4, 0 } },
+    { "0,6,12,18", 4, { 0, 6, 12, 18 } },
+    { "18,12,6,0", 4, { 18, 12, 6, 0 } },
+    { "0,2,1,3", 4, { 0, 2, 1, 3 } },
+    { "3,1,2,0", 4, { 3, 1, 2, 0 } },
+    { "0,4,2,6", 4, { 0, 4, 2, 6 } },
+    { "6,2,4,0", 4, { 6, 2, 4, 0 } },
+    { "0,6,3,9", 4, { 0, 6, 3, 9 } },
+    { "9,3,6,0", 4, { 9, 3, 6, 0 } },
+    { "0,8,4,12", 4, { 0, 8, 4, 12 } },
+    { "12,4,8,0", 4, { 12, 4, 8, 0 } },
+    { "0,12,6,18", 4, { 0, 12, 6, 18 } },
+    { "18,6,12,0", 4, { 18, 6, 12, 0 } },
+    { "rand2", 0, {}, 2 },
+    { "rand3", 0, {}, 3 },
+    { "rand4", 0, {}, 4 },
+    { "rand5", 0, {}, 5 },
+    { "rand6", 0, {}, 6 },
+    { "rand7", 0, {}, 7 },
+    { "rand8", 0, {}, 8 },
+    { "rand9", 0, {}, 9 },
+    { "rand10", 0, {}, 10 },
+    { "rand11", 0, {}, 11 },
+    { "rand12", 0, {}, 12 },
+    { "rand13", 0, {}, 13 },
+    { "rand14", 0, {}, 14 },
+    { "rand15", 0, {}, 15 },
+    { "rand16", 0, {}, 16 },
+    { "rand17", 0, {}, 17 },
+    { "rand18", 0, {}, 18 },
+    { "rand0_2", 0, {}, 0, 2 },
+    { "rand0_3", 0, {}, 0, 3 },
+    { "rand0_4", 0, {}, 0, 4 },
+    { "rand0_5", 0, {}, 0, 5 },
+    { "rand0_6", 0, {}, 0, 6 },
+    { "rand0_12", 0, {}, 0, 12 },
 };
 
 uint8_t STEP_CONDITIONS_COUNT = sizeof(stepConditions) / sizeof(stepConditions[0]);
 uint8_t STEP_MOTIONS_COUNT = sizeof(stepMotions) / sizeof(stepMotions[0]);
 
+// Parameter locked by a step: while the step plays, the value `param` of the sequenced plugin follows `value`,
+// `param` being the index of the parameter in the table of its sequencer (see Sequencer::lockParam())
+struct ParamLock {
+    uint8_t param;
+    float value;
+};
+
 class Step {
 public:
+    // Locks of a step, inline so the steps are copied to the previews and the snapshots without allocating
+    static const uint8_t MAX_LOCKS = 4;
+
     bool enabled = false;
     float velocity = 0.8f;
     uint8_t condition = 0;
@@ -151,6 +202,10 @@ public:
     uint8_t counter = 0;
     uint8_t note = 60;
     uint8_t motion = 0;
+    // Micro timing, in percent of a step: played up to half a step early (-50) or late (50)
+    int8_t offset = 0;
+    uint8_t lockCount = 0;
+    ParamLock locks[MAX_LOCKS] = {};
 
     void reset()
     {
@@ -162,6 +217,8 @@ public:
         counter = 0;
         note = 60;
         motion = 0;
+        offset = 0;
+        lockCount = 0;
     }
 
     bool equal(Step& other)
@@ -172,7 +229,48 @@ public:
             && motion == other.motion
             && position == other.position
             && len == other.len
-            && note == other.note;
+            && note == other.note
+            && offset == other.offset
+            && locksEqual(other);
+    }
+
+    bool locksEqual(Step& other)
+    {
+        if (lockCount != other.lockCount) {
+            return false;
+        }
+        for (uint8_t i = 0; i < lockCount; i++) {
+            if (locks[i].param != other.locks[i].param || locks[i].value != other.locks[i].value) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Lock the parameter to `value`, return false when the step has no lock left
+    bool setLock(uint8_t param, float value)
+    {
+        for (uint8_t i = 0; i < lockCount; i++) {
+            if (locks[i].param == param) {
+                locks[i].value = value;
+                return true;
+            }
+        }
+        if (lockCount >= MAX_LOCKS) {
+            return false;
+        }
+        locks[lockCount++] = { param, value };
+        return true;
+    }
+
+    void removeLock(uint8_t param)
+    {
+        for (uint8_t i = 0; i < lockCount; i++) {
+            if (locks[i].param == param) {
+                locks[i] = locks[--lockCount];
+                return;
+            }
+        }
     }
 
     void setCondition(int condition)
@@ -200,6 +298,11 @@ public:
         this->len = CLAMP(len, 0, 4096);
     }
 
+    void setOffset(int offset)
+    {
+        this->offset = CLAMP(offset, -50, 50);
+    }
+
     void setPosition(int position)
     {
         this->position = CLAMP(position, 0, 4096);
@@ -226,6 +329,7 @@ public:
         json["velocity"] = velocity;
         json["condition"] = stepConditions[condition].name;
         json["motion"] = stepMotions[motion].name;
+        json["offset"] = offset;
         return json;
     }
 
@@ -237,6 +341,7 @@ public:
             enabled = json["enabled"];
             note = json["note"];
             velocity = json["velocity"];
+            setOffset(json.value("offset", 0));
             std::string conditionName = json["condition"];
             for (int i = 0; i < STEP_CONDITIONS_COUNT; i++) {
                 if (stepConditions[i].name == conditionName) {
@@ -0,0 +1,340 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "libs/nlohmann/json.hpp"
+#include "plugins/audio/valueInterface.h"
+
+// Automation lanes of a plugin: the movements of its values, recorded over a loop of the track (from one `SEQ_LOOP`
+// to the next), and played back on the next loops.
+//
+// - Recording: the changes drained from the parameter queue, with their frame, are kept in a buffer reserved when
+//   recording is armed. At the end of the loop, they replace the part of the lane they cover, simplified with
+//   Ramer-Douglas-Peucker: the points the lane can be linearly interpolated without are dropped, within `tolerance`
+//   of the range of the value. A lane being recorded is not played back until the next loop.
+// - Playback: once per block, the value of each lane at the start of the block is applied as a lock of the value
+//   (see Val::lock()), so the smoothed values ramp to it, and the value shown and saved stays the one of the user.
+//   Each lane knows until which frame its value holds, so the blocks where no lane changes only compare 2 frames.
+// - Storage: `"AUTOMATION": [{ "key": "CUTOFF", "points": [delta, value, delta, value...] }]` in the state of the
+//   plugin, the frames being the deltas from the previous point, so the CBOR of the binary clip keeps them small.
+//
+// `process()` runs on the thread of the track, `loop()`, `stop()`, `arm()` and `clear()` between two blocks, and
+// `serialize()` and `hydrate()` from any thread, the lanes being swapped on the next block.
+class Automation {
+public:
+    static const uint32_t MAX_RECORDED = 4096;
+
+    struct Point {
+        // From the start of the loop
+        uint32_t frame;
+        float value;
+    };
+
+    struct Lane {
+        std::string key;
+        ValueInterface* value = NULL;
+        std::vector<Point> points;
+
+        uint32_t cursor = 0;
+        // Frame until which the value of the lane doesn't change
+        uint32_t stableUntil = 0;
+        // Recorded in this loop, not played back
+        bool touched = false;
+        bool locked = false;
+    };
+
+    typedef std::function<ValueInterface*(std::string key)> ResolveFn;
+
+    // Error allowed by the simplification, in part of the range of the value
+    float tolerance = 0.005f;
+
+protected:
+    struct Recorded {
+        ValueInterface* value;
+        uint32_t frame;
+        float value_f;
+    };
+    std::vector<Recorded> recorded;
+    bool recording = false;
+
+    std::vector<Lane> lanes;
+    // Lanes hydrated from a clip, swapped with `lanes` by the next block
+    std::vector<Lane> hydrated;
+    std::atomic<bool> hasHydrated = false;
+    std::mutex m;
+
+    uint32_t position = 0;
+    uint32_t idleUntil = 0;
+
+    void unlock(Lane& lane)
+    {
+        if (lane.locked) {
+            lane.value->unlock();
+            lane.locked = false;
+        }
+    }
+
+    void apply(Lane& lane)
+    {
+        std::vector<Point>& points = lane.points;
+        if (points.empty()) {
+            lane.stableUntil = UINT32_MAX;
+            return;
+        }
+        if (position < points[0].frame) {
+            unlock(lane);
+            lane.stableUntil = points[0].frame;
+            return;
+        }
+        while (lane.cursor + 1 < points.size() && points[lane.cursor + 1].frame <= position) {
+            lane.cursor++;
+        }
+        Point& a = points[lane.cursor];
+        float value = a.value;
+        if (lane.cursor + 1 == points.size()) {
+            lane.stableUntil = UINT32_MAX;
+        } else {
+            Point& b = points[lane.cursor + 1];
+            if (a.value == b.value) {
+                lane.stableUntil = b.frame;
+            } else {
+                value += (b.value - a.value) * (position - a.frame) / (b.frame - a.frame);
+                lane.stableUntil = position + 1;
+            }
+        }
+        lane.value->lock(value);
+        lane.locked = true;
+    }
+
+    void rewind()
+    {
+        position = 0;
+        idleUntil = 0;
+        for (Lane& lane : lanes) {
+            lane.cursor = 0;
+            lane.stableUntil = 0;
+            lane.touched = false;
+        }
+    }
+
+    // Keep the points the lane can't be interpolated without, within `epsilon`
+    static void simplify(std::vector<Point>& points, float epsilon)
+    {
+        if (points.size() < 3) {
+            return;
+        }
+        std::vector<bool> keep(points.size(), false);
+        keep.front() = keep.back() = true;
+        std::vector<std::pair<size_t, size_t>> stack = { { 0, points.size() - 1 } };
+        while (!stack.empty()) {
+            auto [first, last] = stack.back();
+            stack.pop_back();
+            float maxError = 0.0f;
+            size_t farthest = first;
+            for (size_t i = first + 1; i < last; i++) {
+                float t = (float)(points[i].frame - points[first].frame) / (points[last].frame - points[first].frame);
+                float error = fabsf(points[first].value + t * (points[last].value - points[first].value) - points[i].value);
+                if (error > maxError) {
+                    maxError = error;
+                    farthest = i;
+                }
+            }
+            if (maxError > epsilon) {
+                keep[farthest] = true;
+                stack.push_back({ first, farthest });
+                stack.push_back({ farthest, last });
+            }
+        }
+        size_t n = 0;
+        for (size_t i = 0; i < points.size(); i++) {
+            if (keep[i]) {
+                points[n++] = points[i];
+            }
+        }
+        points.resize(n);
+    }
+
+    Lane& lane(ValueInterface* value)
+    {
+        for (Lane& lane : lanes) {
+            if (lane.value == value) {
+                return lane;
+            }
+        }
+        lanes.push_back({ value->key(), value });
+        return lanes.back();
+    }
+
+    // The recorded changes replace the points of the lanes between their first and last frame
+    void commit()
+    {
+        if (recorded.empty() || !m.try_lock()) {
+            // Kept for the next loop, the frames being from the start of the loop
+            return;
+        }
+        std::stable_sort(recorded.begin(), recorded.end(), [](const Recorded& a, const Recorded& b) { return a.value < b.value; });
+        for (size_t start = 0; start < recorded.size();) {
+            size_t end = start;
+            std::vector<Point> points;
+            while (end < recorded.size() && recorded[end].value == recorded[start].value) {
+                points.push_back({ recorded[end].frame, recorded[end].value_f });
+                end++;
+            }
+            std::stable_sort(points.begin(), points.end(), [](const Point& a, const Point& b) { return a.frame < b.frame; });
+            Lane& l = lane(recorded[start].value);
+            uint32_t from = points.front().frame, to = points.back().frame;
+            l.points.erase(std::remove_if(l.points.begin(), l.points.end(), [&](Point& p) { return p.frame >= from && p.frame <= to; }),
+                l.points.end());
+            l.points.insert(std::upper_bound(l.points.begin(), l.points.end(), from, [](uint32_t frame, const Point& p) { return frame < p.frame; }),
+                points.begin(), points.end());
+            ValueInterface::Props& range = l.value->props();
+            simplify(l.points, tolerance * (range.max - range.min));
+            start = end;
+        }
+        recorded.clear();
+        m.unlock();
+    }
+
+public:
+    // Each block, before the values are smoothed and the block is processed
+    void process(uint32_t frames)
+    {
+        if (hasHydrated.load(std::memory_order_acquire) && m.try_lock()) {
+            for (Lane& lane : lanes) {
+                unlock(lane);
+            }
+            // The previous lanes are freed by the next hydration, not by the audio thread
+            lanes.swap(hydrated);
+            hasHydrated = false;
+            m.unlock();
+            rewind();
+        }
+        if (position >= idleUntil) {
+            idleUntil = UINT32_MAX;
+            for (Lane& lane : lanes) {
+                if (!lane.touched) {
+                    if (lane.stableUntil <= position) {
+                        apply(lane);
+                    }
+                    idleUntil = std::min(idleUntil, lane.stableUntil);
+                }
+            }
+        }
+        position += frames;
+    }
+
+    // A change of `value` at `offset` frames from the block being processed, the frame of the parameter queue
+    void record(ValueInterface* value, uint32_t offset, float value_f)
+    {
+        if (!recording || recorded.size() >= recorded.capacity()) {
+            return;
+        }
+        recorded.push_back({ value, position + offset, value_f });
+        for (Lane& lane : lanes) {
+            if (lane.value == value) {
+                // The value follows the hand of the user until the end of the loop
+                lane.touched = true;
+                unlock(lane);
+            }
+        }
+    }
+
+    void arm(bool record)
+    {
+        if (record && recorded.capacity() < MAX_RECORDED) {
+            recorded.reserve(MAX_RECORDED);
+        }
+        if (!record) {
+            commit();
+        }
+        recording = record;
+    }
+
+    bool isRecording()
+    {
+        return recording;
+    }
+
+    void loop()
+    {
+        commit();
+        rewind();
+    }
+
+    // The values are back to the ones of the user until playing again
+    void stop()
+    {
+        commit();
+        for (Lane& lane : lanes) {
+            unlock(lane);
+        }
+        rewind();
+    }
+
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(m);
+        for (Lane& lane : lanes) {
+            unlock(lane);
+        }
+        lanes.clear();
+        recorded.clear();
+        rewind();
+    }
+
+    void serialize(nlohmann::json& json)
+    {
+        std::lock_guard<std::mutex> guard(m);
+        std::vector<Lane>& source = hasHydrated ? hydrated : lanes;
+        if (source.empty()) {
+            return;
+        }
+        nlohmann::json& lanesJson = json["AUTOMATION"] = nlohmann::json::array();
+        for (Lane& lane : source) {
+            nlohmann::json points = nlohmann::json::array();
+            uint32_t frame = 0;
+            for (Point& point : lane.points) {
+                points.push_back(point.frame - frame);
+                points.push_back(point.value);
+                frame = point.frame;
+            }
+            lanesJson.push_back({ { "key", lane.key }, { "points", points } });
+        }
+    }
+
+    // A state without `AUTOMATION` clears the lanes, e.g. switching to a clip without automation
+    void hydrate(nlohmann::json& json, ResolveFn resolve)
+    {
+        std::vector<Lane> next;
+        if (json.contains("AUTOMATION") && json["AUTOMATION"].is_array()) {
+            for (nlohmann::json& laneJson : json["AUTOMATION"]) {
+                Lane lane;
+                lane.key = laneJson.value("key", "");
+                lane.value = resolve(lane.key);
+                if (!lane.value || !laneJson.contains("points")) {
+                    continue;
+                }
+                nlohmann::json& points = laneJson["points"];
+                uint32_t frame = 0;
+                for (size_t i = 0; i + 1 < points.size(); i += 2) {
+                    frame += points[i].get<uint32_t>();
+                    lane.points.push_back({ frame, points[i + 1].get<float>() });
+                }
+                next.push_back(lane);
+            }
+        }
+        std::lock_guard<std::mutex> guard(m);
+        if (next.empty() && lanes.empty() && !hasHydrated) {
+            return;
+        }
+        hydrated.swap(next);
+        hasHydrated = true;
+    }
+};
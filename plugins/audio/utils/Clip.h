@@ -11,9 +11,10 @@ The manager’s primary function is to handle the complex relationship between t
 2.  **Current Clip Tracking:** A key function is remembering the currently active clip. It uses a small, dedicated configuration file (`current.cfg`) to persistently store the name of the last used clip file, allowing the application to resume seamlessly.
     *   `setCurrent` writes the new active clip name to this tracking file.
     *   `loadCurrent` reads the active clip name when the program starts.
-3.  **Data Persistence (JSON):** The clip settings themselves are stored using the standard JSON format, which is ideal for structured data.
-    *   The `serialize` function saves (writes) complex settings from the program into the designated clip file on disk.
-    *   The `hydrate` function loads (reads) and parses those settings back into the program for immediate use.
+3.  **Data Persistence:** The clip settings are kept parsed in memory (`ClipState`) and stored in a compact binary file next to a JSON export, the standard format being ideal for humans and git.
+    *   The `serialize` function saves (writes) complex settings from the program into the designated clip files on disk, only when they changed since the last save. The files are written in the background by the `FileWriter`, so a save never waits on the disk and a power cut never corrupts a clip.
+    *   The `state` function returns the parsed settings for immediate use, so switching clips never parses a file. The `hydrate` function returns them as JSON. A JSON file edited by hand, newer than the binary one, is the one loaded.
+    *   The `read` and `setPreloaded` functions let a worker thread read the next clip before it is played, so the switch doesn't read the disk.
 
 In summary, this class provides robust mechanisms for managing where clip data lives, ensuring the correct clip is always loaded, and saving all configuration details accurately.
 
@@ -23,8 +24,11 @@ sha: 7bf4a1008bfdbe59bfa669502ee5602e6651b5b21e92a57ffdb0e14b0a9cc275
 
 #include "libs/nlohmann/json.hpp"
 #include <string>
+#include <sys/stat.h>
 
 #include "log.h"
+#include "plugins/audio/utils/ClipState.h"
+#include "plugins/audio/utils/FileWriter.h"
 #include "plugins/audio/utils/Workspace.h"
 
 class Clip {
@@ -37,13 +41,62 @@ protected:
     std::string currentPath = workspace.getCurrentPath() + "/" + clipFolder + "/current.cfg";
 
     bool inMemory = false;
-    std::vector<std::string> rawClips;
+    // Also write the JSON of the clips, by default, for humans and git
+    bool saveJson = true;
+    // Last state loaded or saved of each clip, to only save the clips that changed
+    std::vector<ClipState> states;
+    std::vector<bool> loaded;
+    // Whether the state in memory is the one on disk, a clip kept in memory only being saved later
+    std::vector<bool> saved;
+    // Read in the background before the clip is played, so the next `state()` doesn't read it again
+    std::vector<bool> preloaded;
+    ClipState emptyState;
 
     uint16_t MAX_CLIPS = 1000;
 
+    static int64_t modifiedTime(const std::string& path)
+    {
+        struct stat info;
+        return stat(path.c_str(), &info) == 0 ? (int64_t)info.st_mtim.tv_sec * 1000000000 + info.st_mtim.tv_nsec : -1;
+    }
+
+    bool loadState(int16_t id, ClipState& state)
+    {
+        return read(getFilepath(id), getBinaryFilepath(id), state);
+    }
+
+    bool isValidId(int16_t id)
+    {
+        return id >= 0 && id < (int)states.size();
+    }
+
 public:
     std::string current = "0.json";
 
+    // The binary file, unless the JSON file is newer (e.g. edited by hand or checked out). Doesn't use the clips
+    // in memory, so it can be called from a worker thread.
+    static bool read(std::string jsonPath, std::string binaryPath, ClipState& state)
+    {
+        FileWriter::get().flush(jsonPath);
+        FileWriter::get().flush(binaryPath);
+        int64_t jsonTime = modifiedTime(jsonPath);
+        int64_t binaryTime = modifiedTime(binaryPath);
+        if (binaryTime >= 0 && binaryTime >= jsonTime && state.load(binaryPath)) {
+            return true;
+        }
+        if (jsonTime < 0) {
+            state = ClipState();
+            return false;
+        }
+        std::ifstream file(jsonPath);
+        if (ClipState::parse(file, state)) {
+            return true;
+        }
+        logWarn("Invalid JSON in clip: %s", jsonPath.c_str());
+        state = ClipState();
+        return false;
+    }
+
     std::string getFilename(int16_t id)
     {
         return std::to_string(id) + ".json";
@@ -59,6 +112,11 @@ public:
         return getFilepath(getFilename(id));
     }
 
+    std::string getBinaryFilepath(int16_t id)
+    {
+        return getFilepath(std::to_string(id) + ".clip");
+    }
+
     int16_t getIdFromFilepath(std::string path)
     {
         std::string filename = path.substr(path.find_last_of("/") + 1);
@@ -68,16 +126,13 @@ public:
     void setCurrent(int16_t id)
     {
         // logDebug("set current clip %d in %s", id, currentPath.c_str());
-        std::ofstream file(currentPath);
-        if (file.is_open()) {
-            current = getFilename(id);
-            file << current;
-            file.close();
-        }
+        current = getFilename(id);
+        FileWriter::get().write(currentPath, current);
     }
 
     void loadCurrent()
     {
+        FileWriter::get().flush(currentPath);
         std::ifstream file(currentPath);
         if (file.is_open()) {
             file >> current;
@@ -91,26 +146,10 @@ public:
 
     void loadAllInMemory()
     {
-        rawClips.clear();
-        rawClips.reserve(MAX_CLIPS);
-
         for (int i = 0; i < MAX_CLIPS; i++) {
-            std::string path = getFilepath(i);
-            // logDebug("loading clip in memory %s", path.c_str());
-            std::ifstream file(path);
-            if (file.is_open()) {
-                try {
-                    nlohmann::json json;
-                    file >> json;
-                    file.close();
-                    std::string minified = json.dump();
-                    rawClips.emplace_back(std::move(minified));
-                    continue;
-                } catch (const std::exception& e) {
-                    logWarn("Invalid JSON in clip: %s (%s)", path.c_str(), e.what());
-                }
-            }
-            rawClips.emplace_back("");
+            loadState(i, states[i]);
+            loaded[i] = true;
+            saved[i] = true;
         }
     }
 
@@ -125,6 +164,8 @@ public:
 
         MAX_CLIPS = json.value("maxClips", MAX_CLIPS);
 
+        saveJson = json.value("saveJson", saveJson);
+
         init();
     }
 
@@ -132,57 +173,97 @@ public:
     {
         workspace.init();
         currentPath = workspace.getCurrentPath() + "/" + clipFolder + "/current.cfg";
+        states.assign(MAX_CLIPS, ClipState());
+        loaded.assign(MAX_CLIPS, false);
+        saved.assign(MAX_CLIPS, false);
+        preloaded.assign(MAX_CLIPS, false);
         if (inMemory) {
             loadAllInMemory();
         }
         loadCurrent();
     }
 
+    // Save the clip, only when it changed since it was last loaded or saved
     void serialize(nlohmann::json& json, std::string filename, bool toFile = true)
     {
-        if (toFile) {
+        int16_t id = getIdFromFilepath(filename);
+        if (!isValidId(id)) {
+            return;
+        }
+        ClipState state = ClipState::fromJson(json);
+        bool changed = !loaded[id] || !(state == states[id]);
+        if (!toFile) {
+            saved[id] = saved[id] && !changed;
+        } else if (!changed && saved[id]) {
+            return;
+        } else {
             std::string path = getFilepath(filename);
-            std::ofstream file(path);
-            if (file.is_open()) {
-                logDebug("Saving clip: %s", path.c_str());
-                file << json.dump(4);
-                file.close();
+            logDebug("Saving clip: %s", path.c_str());
+            // Written in the background, the JSON first so it is not newer and the binary one is loaded
+            if (saveJson) {
+                FileWriter::get().write(path, json.dump(4));
             }
+            FileWriter::get().write(getBinaryFilepath(id), state.toBinary());
+            saved[id] = true;
         }
-        if (inMemory) {
-            int16_t id = getIdFromFilepath(filename);
-            rawClips[id] = json.dump();
-        }
+        states[id] = state;
+        loaded[id] = true;
     }
     void serialize(nlohmann::json& json, bool toFile = true) { serialize(json, current, toFile); }
 
-    nlohmann::json hydrate(std::string filename, bool reload = false)
+    // Parsed state of the clip, from memory unless `reload` is set or the clips are not kept in memory
+    ClipState& state(std::string filename, bool reload = false)
     {
-        if (!reload && inMemory) {
-            int16_t id = getIdFromFilepath(filename);
-            logDebug(">>> Hydrating clip %d from memory: %s", id, filename.c_str());
-            std::string minified = rawClips[id];
-            if (minified != "") {
-                return nlohmann::json::parse(minified);
+        int16_t id = getIdFromFilepath(filename);
+        if (!isValidId(id)) {
+            return emptyState;
+        }
+        if (reload || (!inMemory && !preloaded[id]) || !loaded[id]) {
+            if (!loadState(id, states[id])) {
+                logWarn("Unable to open clip file: %s", getFilepath(filename).c_str());
             }
-            return nlohmann::json();
+            loaded[id] = true;
+            saved[id] = true;
         }
-        // logDebug(">>> Hydrating clip: %s", filename.c_str());
-        std::string path = getFilepath(filename);
-        std::ifstream file(path);
-        if (file.is_open()) {
-            // logDebug("Loading clip: %s", path.c_str());
-            nlohmann::json json;
-            file >> json;
-            file.close();
-            return json;
+        preloaded[id] = false;
+        return states[id];
+    }
+    ClipState& state(bool reload = false) { return state(current, reload); }
+
+    // Whether `state()` would read the clip from disk, and it has no changes only in memory to keep
+    bool needsPreload(int16_t id)
+    {
+        return isValidId(id) && !preloaded[id] && (!loaded[id] || (!inMemory && saved[id]));
+    }
+
+    // Take the state read in the background with `read()`, for the next `state()` of the clip
+    void setPreloaded(int16_t id, ClipState& state)
+    {
+        if (needsPreload(id)) {
+            std::swap(states[id], state);
+            loaded[id] = true;
+            saved[id] = true;
+            preloaded[id] = true;
         }
-        logWarn("Unable to open clip file: %s", path.c_str());
-        return nlohmann::json();
+    }
+
+    // Copy of the state of the clip already in memory, e.g. to prefetch what it needs, false if not loaded
+    bool copyState(int16_t id, ClipState& state)
+    {
+        if (!isValidId(id) || !loaded[id]) {
+            return false;
+        }
+        state = states[id];
+        return true;
+    }
+
+    nlohmann::json hydrate(std::string filename, bool reload = false)
+    {
+        ClipState& clipState = state(filename, reload);
+        return clipState.empty() ? nlohmann::json() : clipState.toJson();
     }
     nlohmann::json hydrate(bool reload = false)
     {
-        // logDebug(">>> Hydrating current clip: %s", current.c_str());
         return hydrate(current, reload);
     }
 };
@@ -0,0 +1,390 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstdio>
+#include <istream>
+#include <string>
+#include <vector>
+
+#include "libs/nlohmann/json.hpp"
+
+// Serialized state of the plugins of a track, parsed once so switching clips doesn't parse JSON anymore.
+//
+// The values of each plugin are kept as arrays: the keys once, and the values as floats. The plugin resolves each
+// key to its value ID (its index in the mapping) the first time it is hydrated from the state, the next times only
+// setting the values by ID. Everything else the plugin serializes (steps, sample files...) stays a parsed JSON.
+//
+// The state is saved in a compact binary file: the arrays, and the rest of each plugin in CBOR. The JSON of the clip
+// can still be exported from it, for humans and git, see `Clip`. Reading that JSON back (`parse()`) builds the state
+// while the text is read, without the JSON of the whole clip: the values, most of the nodes, go straight to their
+// arrays, and only the rest of each plugin is built as JSON, in place.
+struct ClipState {
+    struct Plugin {
+        std::string name;
+        std::vector<std::string> keys;
+        std::vector<float> values;
+        // Rest of the serialized plugin, without its values
+        nlohmann::json extra = nlohmann::json::object();
+
+        // Value ID of each key, -1 when the plugin has no such value, resolved for the plugin `resolvedFor`
+        std::vector<int16_t> ids;
+        const void* resolvedFor = NULL;
+
+        bool operator==(const Plugin& other) const
+        {
+            return name == other.name && keys == other.keys && values == other.values && extra == other.extra;
+        }
+    };
+
+    std::vector<Plugin> plugins;
+
+    bool operator==(const ClipState& other) const
+    {
+        return plugins == other.plugins;
+    }
+
+    bool empty() const
+    {
+        return plugins.empty();
+    }
+
+    // From the JSON of a clip, one key per plugin
+    static ClipState fromJson(nlohmann::json& json)
+    {
+        ClipState state;
+        if (!json.is_object()) {
+            return state;
+        }
+        for (auto it = json.begin(); it != json.end(); ++it) {
+            state.plugins.push_back(pluginFromJson(it.key(), it.value()));
+        }
+        return state;
+    }
+
+    // From the JSON serialized by a plugin, e.g. a preset
+    static Plugin pluginFromJson(const std::string& name, nlohmann::json& json)
+    {
+        Plugin plugin;
+        plugin.name = name;
+        if (!json.is_object()) {
+            return plugin;
+        }
+        for (auto field = json.begin(); field != json.end(); ++field) {
+            if (field.key() != "values" || !field.value().is_array()) {
+                plugin.extra[field.key()] = field.value();
+                continue;
+            }
+            for (auto& value : field.value()) {
+                if (value.contains("key") && value.contains("value") && value["value"].is_number()) {
+                    plugin.keys.push_back(value["key"].get<std::string>());
+                    plugin.values.push_back(value["value"].get<float>());
+                }
+            }
+        }
+        return plugin;
+    }
+
+    static nlohmann::json toJson(const Plugin& plugin)
+    {
+        nlohmann::json json = plugin.extra;
+        if (plugin.keys.empty()) {
+            return json;
+        }
+        nlohmann::json values = nlohmann::json::array();
+        for (size_t i = 0; i < plugin.keys.size(); i++) {
+            values.push_back({ { "key", plugin.keys[i] }, { "value", plugin.values[i] } });
+        }
+        json["values"] = values;
+        return json;
+    }
+
+    nlohmann::json toJson() const
+    {
+        nlohmann::json json = nlohmann::json::object();
+        for (const Plugin& plugin : plugins) {
+            json[plugin.name] = toJson(plugin);
+        }
+        return json;
+    }
+
+protected:
+    static const uint32_t MAGIC = 0x5a50434c; // ZPCL
+    static const uint32_t VERSION = 1;
+
+    // SAX handler of `parse()`. `depth` counts the containers open, the fields of a plugin being at `pluginDepth`:
+    // 2 in a clip, under the name of the plugin, 1 for a single plugin, e.g. a preset.
+    class JsonReader : public nlohmann::json_sax<nlohmann::json> {
+    protected:
+        ClipState& state;
+        std::string name;
+        int pluginDepth;
+        int depth = 0;
+        // Containers deeper than this one are not part of the state, e.g. a clip that is not an object
+        int skipDepth = 0;
+
+        Plugin* plugin = NULL;
+        std::string field;
+        // In the values of the plugin, each entry being read into `entryKey` and `entryValue`
+        bool inValues = false;
+        std::string entryField;
+        std::string entryKey;
+        float entryValue = 0.0f;
+        bool hasKey = false;
+        bool hasValue = false;
+
+        // Field of the plugin being built as JSON, from the field itself to the innermost container open
+        std::vector<nlohmann::json*> building;
+        std::string buildingKey;
+
+        nlohmann::json* place(nlohmann::json&& value)
+        {
+            if (building.empty()) {
+                nlohmann::json& slot = plugin->extra[field];
+                slot = std::move(value);
+                return &slot;
+            }
+            nlohmann::json* parent = building.back();
+            if (parent->is_array()) {
+                parent->push_back(std::move(value));
+                return &parent->back();
+            }
+            nlohmann::json& slot = (*parent)[buildingKey];
+            slot = std::move(value);
+            return &slot;
+        }
+
+        bool scalar(nlohmann::json&& value)
+        {
+            if (skipDepth) {
+                return true;
+            }
+            if (!building.empty() || (plugin && depth == pluginDepth)) {
+                place(std::move(value));
+            } else if (pluginDepth == 2 && depth == 1) {
+                // Not an object, the plugin has no state
+                state.plugins.push_back(Plugin { name });
+            } else if (inValues && depth == pluginDepth + 2) {
+                if (entryField == "key" && value.is_string()) {
+                    entryKey = value.get_ref<std::string&>();
+                    hasKey = true;
+                } else if (entryField == "value" && value.is_number()) {
+                    entryValue = value.get<float>();
+                    hasValue = true;
+                }
+            }
+            return true;
+        }
+
+        bool open(bool object)
+        {
+            depth++;
+            if (skipDepth) {
+                return true;
+            }
+            if (!building.empty() || (plugin && depth == pluginDepth + 1 && (object || field != "values"))) {
+                building.push_back(place(object ? nlohmann::json::object() : nlohmann::json::array()));
+            } else if (plugin && depth == pluginDepth + 1) {
+                // Like a JSON object, the last field wins
+                inValues = true;
+                plugin->keys.clear();
+                plugin->values.clear();
+            } else if (object && depth == pluginDepth && (pluginDepth == 1 || plugin == NULL)) {
+                state.plugins.push_back(Plugin { name });
+                plugin = &state.plugins.back();
+            } else if (object && inValues && depth == pluginDepth + 2) {
+                hasKey = false;
+                hasValue = false;
+            } else if (!(object && pluginDepth == 2 && depth == 1)) {
+                if (pluginDepth == 2 && depth == 2) {
+                    state.plugins.push_back(Plugin { name });
+                }
+                skipDepth = depth;
+            }
+            return true;
+        }
+
+        bool close()
+        {
+            if (skipDepth) {
+                skipDepth = depth == skipDepth ? 0 : skipDepth;
+            } else if (!building.empty()) {
+                building.pop_back();
+            } else if (inValues && depth == pluginDepth + 2) {
+                if (hasKey && hasValue) {
+                    plugin->keys.push_back(entryKey);
+                    plugin->values.push_back(entryValue);
+                }
+            } else if (inValues && depth == pluginDepth + 1) {
+                inValues = false;
+            } else if (depth == pluginDepth) {
+                plugin = NULL;
+            }
+            depth--;
+            return true;
+        }
+
+    public:
+        JsonReader(ClipState& state, std::string name, int pluginDepth)
+            : state(state)
+            , name(name)
+            , pluginDepth(pluginDepth)
+        {
+        }
+
+        bool null() override { return scalar(nullptr); }
+        bool boolean(bool val) override { return scalar(val); }
+        bool number_integer(number_integer_t val) override { return scalar(val); }
+        bool number_unsigned(number_unsigned_t val) override { return scalar(val); }
+        bool number_float(number_float_t val, const string_t&) override { return scalar(val); }
+        bool string(string_t& val) override { return scalar(std::move(val)); }
+        bool binary(binary_t& val) override { return scalar(nlohmann::json::binary(std::move(val))); }
+        bool start_object(std::size_t) override { return open(true); }
+        bool end_object() override { return close(); }
+        bool start_array(std::size_t) override { return open(false); }
+        bool end_array() override { return close(); }
+
+        bool key(string_t& val) override
+        {
+            if (skipDepth) {
+                return true;
+            }
+            if (!building.empty()) {
+                buildingKey = val;
+            } else if (pluginDepth == 2 && depth == 1) {
+                name = val;
+            } else if (plugin && depth == pluginDepth) {
+                field = val;
+            } else if (inValues && depth == pluginDepth + 2) {
+                entryField = val;
+            }
+            return true;
+        }
+
+        bool parse_error(std::size_t, const std::string&, const nlohmann::detail::exception&) override
+        {
+            return false;
+        }
+    };
+
+    static void append(std::string& data, const void* value, size_t size)
+    {
+        data.append((const char*)value, size);
+    }
+
+    static void appendString(std::string& data, const std::string& value)
+    {
+        uint16_t length = value.size();
+        append(data, &length, sizeof(length));
+        data.append(value, 0, length);
+    }
+
+    static bool readString(FILE* file, std::string& value)
+    {
+        uint16_t length;
+        if (fread(&length, sizeof(length), 1, file) != 1) {
+            return false;
+        }
+        value.resize(length);
+        return fread(value.data(), 1, length, file) == length;
+    }
+
+public:
+    // From the JSON text of a clip, same as `fromJson()`, false if it is not valid JSON
+    static bool parse(std::istream& input, ClipState& state)
+    {
+        ClipState parsed;
+        JsonReader reader(parsed, "", 2);
+        if (!nlohmann::json::sax_parse(input, &reader)) {
+            return false;
+        }
+        // In the order of a JSON object, the last plugin of a name winning
+        std::stable_sort(parsed.plugins.begin(), parsed.plugins.end(), [](const Plugin& a, const Plugin& b) { return a.name < b.name; });
+        std::vector<Plugin> plugins;
+        for (Plugin& plugin : parsed.plugins) {
+            if (!plugins.empty() && plugins.back().name == plugin.name) {
+                plugins.pop_back();
+            }
+            plugins.push_back(std::move(plugin));
+        }
+        state.plugins = std::move(plugins);
+        return true;
+    }
+
+    // From the JSON text serialized by a plugin, same as `pluginFromJson()`, false if it is not valid JSON
+    static bool parsePlugin(std::istream& input, const std::string& name, Plugin& plugin)
+    {
+        ClipState parsed;
+        JsonReader reader(parsed, name, 1);
+        if (!nlohmann::json::sax_parse(input, &reader)) {
+            return false;
+        }
+        plugin = parsed.plugins.empty() ? Plugin { name } : std::move(parsed.plugins[0]);
+        return true;
+    }
+
+    // Content of the binary file, to be saved with `FileWriter`
+    std::string toBinary() const
+    {
+        std::string data;
+        uint32_t header[3] = { MAGIC, VERSION, (uint32_t)plugins.size() };
+        append(data, header, sizeof(header));
+        for (const Plugin& plugin : plugins) {
+            uint32_t count = plugin.keys.size();
+            std::vector<uint8_t> extra = nlohmann::json::to_cbor(plugin.extra);
+            uint32_t extraSize = extra.size();
+            appendString(data, plugin.name);
+            append(data, &count, sizeof(count));
+            for (uint32_t i = 0; i < count; i++) {
+                appendString(data, plugin.keys[i]);
+            }
+            append(data, plugin.values.data(), count * sizeof(float));
+            append(data, &extraSize, sizeof(extraSize));
+            append(data, extra.data(), extraSize);
+        }
+        return data;
+    }
+
+    // Return false if the file doesn't exist or is not a clip of this version
+    bool load(std::string path)
+    {
+        FILE* file = fopen(path.c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        uint32_t header[3];
+        bool ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == MAGIC && header[1] == VERSION;
+        std::vector<Plugin> loaded;
+        for (uint32_t p = 0; ok && p < header[2]; p++) {
+            Plugin plugin;
+            uint32_t count;
+            ok = readString(file, plugin.name) && fread(&count, sizeof(count), 1, file) == 1 && count < 0x10000;
+            if (ok) {
+                plugin.keys.reserve(count);
+            }
+            for (uint32_t i = 0; ok && i < count; i++) {
+                plugin.keys.emplace_back();
+                ok = readString(file, plugin.keys.back());
+            }
+            uint32_t extraSize = 0;
+            if (ok) {
+                plugin.values.resize(count);
+                ok = fread(plugin.values.data(), sizeof(float), count, file) == count
+                    && fread(&extraSize, sizeof(extraSize), 1, file) == 1 && extraSize < (1 << 28);
+            }
+            if (ok) {
+                std::vector<uint8_t> extra(extraSize);
+                ok = fread(extra.data(), 1, extraSize, file) == extraSize;
+                plugin.extra = nlohmann::json::from_cbor(extra, true, false);
+                ok = ok && !plugin.extra.is_discarded();
+            }
+            loaded.push_back(plugin);
+        }
+        fclose(file);
+        if (!ok) {
+            return false;
+        }
+        plugins = loaded;
+        return true;
+    }
+};
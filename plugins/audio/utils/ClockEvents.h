@@ -0,0 +1,64 @@
+#pragma once
+
+#include <cstdint>
+
+// Clock ticks of the block being processed, listed by the Tempo plugin before the tracks are processed, so the
+// plugins following the clock iterate them instead of polling the clock lane on every sample.
+// Written by the host thread only, read by the tracks while they process the block.
+class ClockEvents {
+public:
+    // 24 pulses per quarter note at 240 BPM is ~1 tick every 460 frames at 44.1kHz, far less than one per frame
+    static const uint32_t MAX_TICKS = 64;
+
+    struct Tick {
+        // Frame within the block
+        uint32_t offset;
+        // Clock counter, as written in the clock lane
+        uint32_t clock;
+    };
+
+    Tick ticks[MAX_TICKS];
+    uint32_t count = 0;
+    // Block buffer the offsets are relative to
+    float* block = NULL;
+
+    void begin(float* buf)
+    {
+        block = buf;
+        count = 0;
+    }
+
+    void add(uint32_t offset, uint32_t clock)
+    {
+        if (count < MAX_TICKS) {
+            ticks[count++] = { offset, clock };
+        }
+    }
+
+    // First tick strictly after `offset`, or `end` if there is none before
+    uint32_t next(uint32_t offset, uint32_t end)
+    {
+        for (uint32_t i = 0; i < count; i++) {
+            if (ticks[i].offset > offset) {
+                return ticks[i].offset < end ? ticks[i].offset : end;
+            }
+        }
+        return end;
+    }
+
+    // Call `fn(tick, frame)` for the ticks within `frames` of `buf`, a part of the block as passed to
+    // `sampleBlock()`, `frame` being relative to `buf`.
+    template <typename F>
+    void forEach(float* buf, uint32_t frameStride, uint32_t frames, F fn)
+    {
+        if (count == 0 || !block) {
+            return;
+        }
+        uint32_t start = (buf - block) / frameStride;
+        for (uint32_t i = 0; i < count; i++) {
+            if (ticks[i].offset >= start && ticks[i].offset < start + frames) {
+                fn(ticks[i], ticks[i].offset - start);
+            }
+        }
+    }
+};
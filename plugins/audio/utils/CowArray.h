@@ -0,0 +1,76 @@
+#pragma once
+
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+// Immutable copy of an array, split in chunks shared between the copies: a copy made from the previous one only
+// allocates the chunks that changed, e.g. for the undo history (see UndoHistory.h), a tweak of a single step of a
+// long pattern storing one chunk of steps and not the whole pattern again.
+template <typename T, size_t CHUNK = 32>
+class CowArray {
+public:
+    typedef std::vector<T> Chunk;
+
+protected:
+    std::vector<std::shared_ptr<const Chunk>> chunks;
+    size_t count = 0;
+
+public:
+    CowArray() = default;
+
+    // Copy of `items`, sharing the chunks of `previous` that are equal, `equal(a, b)` comparing two items
+    template <typename Equal>
+    CowArray(const std::vector<T>& items, const CowArray* previous, Equal equal)
+        : count(items.size())
+    {
+        for (size_t begin = 0; begin < items.size(); begin += CHUNK) {
+            size_t end = std::min(begin + CHUNK, items.size());
+            size_t c = begin / CHUNK;
+            if (previous && c < previous->chunks.size() && previous->chunks[c]->size() == end - begin) {
+                const Chunk& shared = *previous->chunks[c];
+                bool same = true;
+                for (size_t i = begin; i < end && same; i++) {
+                    same = equal(items[i], shared[i - begin]);
+                }
+                if (same) {
+                    chunks.push_back(previous->chunks[c]);
+                    continue;
+                }
+            }
+            chunks.push_back(std::make_shared<const Chunk>(items.begin() + begin, items.begin() + end));
+        }
+    }
+
+    size_t size() const
+    {
+        return count;
+    }
+
+    void copyTo(std::vector<T>& out) const
+    {
+        out.clear();
+        out.reserve(count);
+        for (auto& chunk : chunks) {
+            out.insert(out.end(), chunk->begin(), chunk->end());
+        }
+    }
+
+    // Same content, as made from each other without any change
+    bool same(const CowArray& other) const
+    {
+        return count == other.count && chunks == other.chunks;
+    }
+
+    // Memory of the chunks not shared with `other`
+    size_t bytesNotIn(const CowArray* other) const
+    {
+        size_t bytes = 0;
+        for (size_t c = 0; c < chunks.size(); c++) {
+            if (!other || c >= other->chunks.size() || other->chunks[c] != chunks[c]) {
+                bytes += chunks[c]->size() * sizeof(T) + sizeof(Chunk);
+            }
+        }
+        return bytes;
+    }
+};
@@ -0,0 +1,277 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+
+// Thread building the engines requested by the audio thread, shared by the engine caches of all the plugins instead
+// of each cache running its own.
+class EngineCacheWorker {
+public:
+    class Client {
+    public:
+        // Build the engine requested, if any, and delete the retired ones. Called by the worker, without its lock.
+        virtual void serve() = 0;
+    };
+
+protected:
+    std::mutex mtx;
+    std::vector<Client*> clients;
+    Client* serving = NULL;
+    // Signaled each time a cache was served, for `remove()` to wait on the one being served
+    std::condition_variable doneCv;
+    Worker worker { mtx, "engine_cache", [this] { workerLoop(); } };
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            // The audio thread notifies without the lock, so a request might be missed: the caches are also polled
+            worker.cv.wait_for(lock, std::chrono::milliseconds(100));
+            // The list might change while unlocked, a cache skipped is served on the next round
+            for (size_t i = 0; i < clients.size() && worker.isRunning(); i++) {
+                serving = clients[i];
+                lock.unlock();
+                serving->serve();
+                lock.lock();
+                serving = NULL;
+                doneCv.notify_all();
+            }
+        }
+    }
+
+public:
+    static EngineCacheWorker& get()
+    {
+        return processSingleton<EngineCacheWorker>();
+    }
+
+    void add(Client* client)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        clients.push_back(client);
+        worker.start();
+    }
+
+    // Forget the cache and wait for it to be served if it is being served, before it is destroyed
+    void remove(Client* client)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        clients.erase(std::remove(clients.begin(), clients.end(), client), clients.end());
+        doneCv.wait(lock, [&] { return serving != client; });
+    }
+
+    // Never waits, for the audio thread
+    void notify()
+    {
+        worker.cv.notify_one();
+    }
+};
+
+// Engines of a multi engine plugin, created on demand instead of all being members of the plugin.
+//
+// The last `capacity` used engines are kept alive, so switching back and forth between them stays instant.
+// - `acquire()` builds the engine on the calling thread if needed, for the threads allowed to wait (loading,
+//   hydration).
+// - `tryGet()` never waits, for the audio thread: a missing engine is built by the EngineCacheWorker, and
+//   available to a later `tryGet()`.
+// Evicted engines may still be used by the audio thread for the block being processed, so they are only deleted
+// once the audio thread started a new block, see `endBlock()`.
+template <typename E>
+class EngineCache : protected EngineCacheWorker::Client {
+public:
+    struct Factory {
+        std::string name;
+        std::function<E*()> create;
+    };
+
+protected:
+    std::vector<Factory> factories;
+    std::function<void(E*)> onCreate;
+    size_t capacity;
+
+    std::mutex mtx;
+    std::vector<E*> instances;
+    std::vector<uint64_t> lastUse;
+    uint64_t useCounter = 0;
+    // Engine used by the plugin, never evicted
+    E* selected = NULL;
+
+    struct Retired {
+        E* engine;
+        uint64_t block;
+    };
+    std::vector<Retired> retired;
+    std::atomic<uint64_t> blocks = 0;
+
+    std::atomic<int> requested = -1;
+
+    // Must be called with the lock held
+    void touch(int index, bool select)
+    {
+        lastUse[index] = ++useCounter;
+        if (select) {
+            selected = instances[index];
+        }
+    }
+
+    // Must be called with the lock held
+    void evict()
+    {
+        size_t count = 0;
+        for (E* engine : instances) {
+            count += engine != NULL;
+        }
+        while (count > capacity) {
+            int oldest = -1;
+            for (int i = 0; i < instances.size(); i++) {
+                if (instances[i] && instances[i] != selected && (oldest == -1 || lastUse[i] < lastUse[oldest])) {
+                    oldest = i;
+                }
+            }
+            if (oldest == -1) {
+                return;
+            }
+            retired.push_back({ instances[oldest], blocks });
+            instances[oldest] = NULL;
+            count--;
+        }
+        purge();
+    }
+
+    // Delete the retired engines the audio thread can't be using anymore. Must be called with the lock held.
+    void purge()
+    {
+        uint64_t now = blocks;
+        for (size_t i = 0; i < retired.size();) {
+            // No block processed yet: the audio thread is not running
+            if (now == 0 || now > retired[i].block + 1) {
+                delete retired[i].engine;
+                retired.erase(retired.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    void serve() override
+    {
+        int index = requested.exchange(-1);
+        if (index != -1) {
+            acquire(index, false);
+        }
+        std::lock_guard<std::mutex> guard(mtx);
+        purge();
+    }
+
+public:
+    EngineCache(std::vector<Factory> factories, size_t capacity, std::function<void(E*)> onCreate = nullptr)
+        : factories(factories)
+        , onCreate(onCreate)
+        , capacity(capacity < 1 ? 1 : capacity)
+        , instances(factories.size(), NULL)
+        , lastUse(factories.size(), 0)
+    {
+        EngineCacheWorker::get().add(this);
+    }
+
+    ~EngineCache()
+    {
+        EngineCacheWorker::get().remove(this);
+        for (E* engine : instances) {
+            delete engine;
+        }
+        for (Retired& entry : retired) {
+            delete entry.engine;
+        }
+    }
+
+    size_t size()
+    {
+        return factories.size();
+    }
+
+    // Name of an engine, without building it
+    const std::string& name(int index)
+    {
+        return factories[index].name;
+    }
+
+    // Index of an engine by name, from `start`, -1 if not found
+    int find(std::string name, int start = 0)
+    {
+        for (int i = start; i < factories.size(); i++) {
+            if (factories[i].name == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    // Return the engine, building it on the calling thread if needed. When `select` is set, the engine becomes
+    // the one used by the plugin.
+    E* acquire(int index, bool select = true)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            if (instances[index]) {
+                touch(index, select);
+                return instances[index];
+            }
+        }
+        // Built without the lock, so the audio thread can still switch between the other engines
+        E* engine = factories[index].create();
+        if (onCreate) {
+            onCreate(engine);
+        }
+        std::lock_guard<std::mutex> guard(mtx);
+        if (instances[index]) {
+            // Built by another thread in the meantime
+            retired.push_back({ engine, blocks });
+        } else {
+            instances[index] = engine;
+        }
+        touch(index, select);
+        evict();
+        return instances[index];
+    }
+
+    // New engine, not cached, owned by the caller, e.g. to render in the background
+    E* build(int index)
+    {
+        E* engine = factories[index].create();
+        if (onCreate) {
+            onCreate(engine);
+        }
+        return engine;
+    }
+
+    // Return the engine if it is available right away, else NULL and it is built in the background.
+    // Never waits, for the audio thread.
+    E* tryGet(int index)
+    {
+        std::unique_lock<std::mutex> lock(mtx, std::try_to_lock);
+        if (lock.owns_lock() && instances[index]) {
+            touch(index, true);
+            return instances[index];
+        }
+        requested = index;
+        EngineCacheWorker::get().notify();
+        return NULL;
+    }
+
+    // Called by the audio thread at the end of each block
+    void endBlock()
+    {
+        blocks.fetch_add(1, std::memory_order_relaxed);
+    }
+};
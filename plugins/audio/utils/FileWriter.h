@@ -0,0 +1,178 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdlib>
+#include <deque>
+#include <fcntl.h>
+#include <mutex>
+#include <string>
+#include <unistd.h>
+
+#include "log.h"
+
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+
+// Files saved by a single background thread, so the latency of the SD card never lands on the thread saving (the
+// UI, or the events of the audio plugins), and a power cut while saving never leaves a half written file.
+//
+// `write()` queues the whole content of the file and returns right away. Writing a file still pending replaces its
+// content, so only the last version is written. Each file is written to a temporary file, synced, then renamed over
+// the previous one: after a power cut, the file is either the previous version or the new one.
+//
+// To save the SD card from wearing, the pending files are written in batches, at most one batch per interval, set
+// with the environment variable `SAVE_INTERVAL_MS`, 1000 ms by default.
+//
+// Before reading a file possibly saved by it, call `flush()`, else the previous version might be read.
+class FileWriter {
+protected:
+    struct Pending {
+        std::string path;
+        std::string content;
+    };
+
+    std::mutex mtx;
+    // Signaled each time a file is written, for `flush()` and `cancel()` to wait on the one being written
+    std::condition_variable doneCv;
+    std::deque<Pending> queue;
+    std::string writing;
+    int flushRequests = 0;
+    std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+    std::chrono::steady_clock::time_point lastBatch;
+    // Once stopped, the files still pending are written before the loop returns
+    Worker worker { mtx, "file_writer", [this] { workerLoop(); } };
+
+    static bool syncFolder(const std::string& path)
+    {
+        size_t slash = path.find_last_of('/');
+        std::string folder = slash == std::string::npos ? "." : (slash == 0 ? "/" : path.substr(0, slash));
+        int fd = open(folder.c_str(), O_RDONLY | O_DIRECTORY);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = fsync(fd) == 0;
+        close(fd);
+        return ok;
+    }
+
+    bool isPending(const std::string& path)
+    {
+        return writing == path
+            || std::any_of(queue.begin(), queue.end(), [&](const Pending& pending) { return pending.path == path; });
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            worker.cv.wait(lock, [&] { return !worker.isRunning() || !queue.empty(); });
+            if (queue.empty()) {
+                break;
+            }
+            // Other files saved meanwhile are written in the same batch
+            worker.cv.wait_until(lock, lastBatch + interval, [&] { return !worker.isRunning() || flushRequests > 0; });
+            while (!queue.empty()) {
+                Pending pending = std::move(queue.front());
+                queue.pop_front();
+                writing = pending.path;
+                lock.unlock();
+                if (!writeNow(pending.path, pending.content)) {
+                    logWarn("Unable to save file: %s", pending.path.c_str());
+                }
+                lock.lock();
+                writing.clear();
+                doneCv.notify_all();
+            }
+            lastBatch = std::chrono::steady_clock::now();
+        }
+    }
+
+    friend FileWriter& processSingleton<FileWriter>();
+
+    FileWriter()
+    {
+        const char* value = getenv("SAVE_INTERVAL_MS");
+        if (value && value[0] != '\0') {
+            logInfo("Env variable save interval: %s ms", value);
+            interval = std::chrono::milliseconds(atol(value));
+        }
+    }
+
+public:
+    static FileWriter& get()
+    {
+        return processSingleton<FileWriter>();
+    }
+
+    // Write the file right away, on the calling thread: to a temporary file, synced, then renamed over the file
+    static bool writeNow(const std::string& path, const std::string& content)
+    {
+        std::string tmpPath = path + ".tmp";
+        int fd = open(tmpPath.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+        if (fd < 0) {
+            return false;
+        }
+        bool ok = true;
+        for (size_t done = 0; ok && done < content.size();) {
+            ssize_t count = ::write(fd, content.data() + done, content.size() - done);
+            ok = count > 0;
+            done += ok ? count : 0;
+        }
+        ok = fsync(fd) == 0 && ok;
+        ok = close(fd) == 0 && ok;
+        if (!ok || rename(tmpPath.c_str(), path.c_str()) != 0) {
+            unlink(tmpPath.c_str());
+            return false;
+        }
+        // For the rename itself to survive a power cut
+        syncFolder(path);
+        return true;
+    }
+
+    // Queue the content of the file, replacing the content still pending for it
+    void write(std::string path, std::string content)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        auto pending = std::find_if(queue.begin(), queue.end(), [&](const Pending& pending) { return pending.path == path; });
+        if (pending != queue.end()) {
+            pending->content = std::move(content);
+        } else {
+            queue.push_back({ path, std::move(content) });
+        }
+        worker.wake();
+    }
+
+    // Wait until the file is written, if it is pending, without waiting for the interval
+    void flush(std::string path)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        if (!isPending(path)) {
+            return;
+        }
+        flushRequests++;
+        worker.cv.notify_all();
+        doneCv.wait(lock, [&] { return !isPending(path); });
+        flushRequests--;
+    }
+
+    // Wait until all the pending files are written
+    void flush()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        flushRequests++;
+        worker.cv.notify_all();
+        doneCv.wait(lock, [&] { return queue.empty() && writing.empty(); });
+        flushRequests--;
+    }
+
+    // Drop the pending files starting with `prefix`, and wait for the one being written, e.g. before deleting them
+    void cancel(std::string prefix)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        queue.erase(std::remove_if(queue.begin(), queue.end(), [&](const Pending& pending) { return pending.path.rfind(prefix, 0) == 0; }),
+            queue.end());
+        doneCv.wait(lock, [&] { return writing.empty() || writing.rfind(prefix, 0) != 0; });
+    }
+};
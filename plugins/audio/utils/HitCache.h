@@ -0,0 +1,279 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cstdint>
+#include <cstring>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "plugins/audio/utils/MemoryBudget.h"
+
+// Rendered one shots of a deterministic drum engine, played back as samples instead of synthesizing every hit.
+//
+// A hit is identified by a key, the hash of everything its sound depends on (engine, values, note, velocity
+// bucket). The audio thread looks the key up with `play()`, never waiting: on a miss it plays the hit live and asks
+// the worker thread to render it with `request()`, so the next hits with the same key come from the cache.
+//
+// Replaced hits may still be played by the audio thread, so they are only deleted once no playback head points to
+// them, see `Head`. Under memory pressure, the least recently played hits are dropped, see MemoryBudget, and
+// rendered again the next time they are played.
+class HitCache {
+public:
+    static const uint8_t MAX_VALUES = 32;
+    static const uint8_t HEADS = 2;
+
+    struct Request {
+        uint64_t key;
+        int engine;
+        uint8_t valueCount;
+        float values[MAX_VALUES];
+        uint8_t note;
+        float velocity;
+    };
+
+    struct Hit {
+        uint64_t key;
+        // Frames of the hit itself, the following being its tail (e.g. reverb)
+        uint32_t hitFrames;
+        std::vector<float> data;
+    };
+
+    // Render `request` into `hit`, called by the worker thread
+    typedef std::function<void(const Request& request, Hit& hit)> RenderFn;
+
+    // Playback of a hit by the audio thread, see `play()` and `stop()`
+    struct Head {
+        const Hit* hit = NULL;
+        uint32_t position = 0;
+        float gain = 1.0f;
+    };
+
+protected:
+    RenderFn render;
+    std::vector<std::atomic<Hit*>> entries;
+    std::vector<std::atomic<uint64_t>> lastUse;
+    std::atomic<uint64_t> useCounter = 0;
+
+    std::atomic<const Hit*> hazards[HEADS] = {};
+    std::vector<Hit*> retired;
+
+    Request pending;
+    std::atomic<bool> hasPending = false;
+
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::atomic<bool> running = true;
+    std::thread worker;
+    int budgetId = -1;
+
+    bool isUsed(const Hit* hit)
+    {
+        for (uint8_t h = 0; h < HEADS; h++) {
+            if (hazards[h].load() == hit) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void purge()
+    {
+        for (size_t i = 0; i < retired.size();) {
+            if (!isUsed(retired[i])) {
+                delete retired[i];
+                retired.erase(retired.begin() + i);
+            } else {
+                i++;
+            }
+        }
+    }
+
+    void store(Hit* hit)
+    {
+        size_t oldest = 0;
+        for (size_t i = 0; i < entries.size(); i++) {
+            if (!entries[i].load()) {
+                oldest = i;
+                break;
+            }
+            if (lastUse[i] < lastUse[oldest]) {
+                oldest = i;
+            }
+        }
+        lastUse[oldest] = ++useCounter;
+        Hit* old = entries[oldest].exchange(hit);
+        if (old) {
+            retired.push_back(old);
+        }
+    }
+
+    // Must be called with the lock held
+    size_t memory()
+    {
+        size_t bytes = 0;
+        for (auto& entry : entries) {
+            Hit* hit = entry.load();
+            bytes += hit ? hit->data.size() * sizeof(float) : 0;
+        }
+        for (Hit* hit : retired) {
+            bytes += hit->data.size() * sizeof(float);
+        }
+        return bytes;
+    }
+
+    // Drop the least recently played hits until `bytes` are freed, the ones still played being deleted later. Must
+    // be called with the lock held.
+    size_t evict(size_t bytes)
+    {
+        size_t freed = 0;
+        while (freed < bytes) {
+            int oldest = -1;
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (entries[i].load() && (oldest < 0 || lastUse[i] < lastUse[oldest])) {
+                    oldest = i;
+                }
+            }
+            if (oldest < 0) {
+                break;
+            }
+            Hit* hit = entries[oldest].exchange(NULL);
+            freed += hit->data.size() * sizeof(float);
+            retired.push_back(hit);
+        }
+        purge();
+        return freed;
+    }
+
+    bool contains(uint64_t key)
+    {
+        for (auto& entry : entries) {
+            Hit* hit = entry.load();
+            if (hit && hit->key == key) {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (running) {
+            cv.wait_for(lock, std::chrono::milliseconds(100));
+            if (hasPending.load()) {
+                Request request = pending;
+                hasPending = false;
+                // Requested again by the hits played while it was rendered
+                if (contains(request.key)) {
+                    continue;
+                }
+                Hit* hit = new Hit();
+                hit->key = request.key;
+                render(request, *hit);
+                if (!hit->data.empty() && running) {
+                    store(hit);
+                    MemoryBudget::get().changed();
+                } else {
+                    delete hit;
+                }
+            }
+            purge();
+        }
+    }
+
+public:
+    HitCache(size_t capacity, RenderFn render)
+        : render(render)
+        , entries(capacity)
+        , lastUse(capacity)
+    {
+        worker = std::thread([this] { workerLoop(); });
+        pthread_setname_np(worker.native_handle(), "hit_cache");
+        MemoryBudget::UsageFn usage = [this] {
+            std::lock_guard<std::mutex> guard(mtx);
+            return memory();
+        };
+        MemoryBudget::EvictFn evictHits = [this](size_t bytes) {
+            std::lock_guard<std::mutex> guard(mtx);
+            return evict(bytes);
+        };
+        budgetId = MemoryBudget::get().add("drum hits", MemoryBudget::LOW, usage, evictHits);
+    }
+
+    ~HitCache()
+    {
+        MemoryBudget::get().remove(budgetId);
+        running = false;
+        cv.notify_one();
+        if (worker.joinable()) {
+            worker.join();
+        }
+        for (auto& entry : entries) {
+            delete entry.load();
+        }
+        for (Hit* hit : retired) {
+            delete hit;
+        }
+    }
+
+    // Hash of `count` floats, to build the keys
+    static uint64_t hash(const float* values, uint8_t count, uint64_t seed = 14695981039346656037ull)
+    {
+        uint64_t h = seed;
+        for (uint8_t i = 0; i < count; i++) {
+            uint32_t bits;
+            memcpy(&bits, &values[i], sizeof(bits));
+            for (int b = 0; b < 4; b++) {
+                h = (h ^ ((bits >> (b * 8)) & 0xff)) * 1099511628211ull;
+            }
+        }
+        return h;
+    }
+
+    // Start playing the hit of `key` on `head`, return false if it is not rendered yet. Never waits, for the audio
+    // thread, `headIndex` being below HEADS.
+    bool play(uint64_t key, uint8_t headIndex, Head& head, float gain)
+    {
+        for (size_t i = 0; i < entries.size(); i++) {
+            Hit* hit = entries[i].load();
+            if (!hit || hit->key != key) {
+                continue;
+            }
+            hazards[headIndex].store(hit);
+            // Replaced between the load and the hazard: the worker might not have seen it
+            if (entries[i].load() != hit) {
+                hazards[headIndex].store(head.hit);
+                return false;
+            }
+            lastUse[i] = ++useCounter;
+            head.hit = hit;
+            head.position = 0;
+            head.gain = gain;
+            return true;
+        }
+        return false;
+    }
+
+    // Stop the playback of a head, so its hit can be deleted
+    void stop(uint8_t headIndex, Head& head)
+    {
+        head.hit = NULL;
+        hazards[headIndex].store(NULL);
+    }
+
+    // Ask for a hit to be rendered, ignored while the worker is busy with another one. Never waits, for the audio
+    // thread.
+    void request(const Request& request)
+    {
+        if (hasPending.load()) {
+            return;
+        }
+        pending = request;
+        hasPending = true;
+        cv.notify_one();
+    }
+};
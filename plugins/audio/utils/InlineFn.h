@@ -0,0 +1,57 @@
+#pragma once
+
+#include <cstddef>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+// Callable kept in place, e.g. the callback of a value (see Val): the captures of the lambda are stored in the
+// object itself, next to a pointer to the function calling it. Unlike std::function, there is no allocation, nothing
+// to copy or destroy, and a single indirect call. The captures must fit in `SIZE` bytes and be trivially copyable,
+// e.g. `this`, references, pointers or numbers, which the compiler checks.
+template <typename Signature, size_t SIZE = 16>
+class InlineFn;
+
+template <typename R, typename... Args, size_t SIZE>
+class InlineFn<R(Args...), SIZE> {
+protected:
+    typedef R (*Invoker)(void* storage, Args... args);
+
+    alignas(void*) unsigned char storage[SIZE];
+    Invoker invoker = NULL;
+
+public:
+    InlineFn() = default;
+
+    InlineFn(std::nullptr_t) { }
+
+    template <typename F, typename = std::enable_if_t<!std::is_same_v<std::decay_t<F>, InlineFn> && std::is_invocable_v<F&, Args...>>>
+    InlineFn(F fn)
+    {
+        static_assert(sizeof(F) <= SIZE, "InlineFn: the captures of the callable are too large");
+        static_assert(std::is_trivially_copyable_v<F> && std::is_trivially_destructible_v<F>,
+            "InlineFn: the captures of the callable must be trivially copyable, capture pointers instead");
+        new (storage) F(fn);
+        invoker = [](void* storage, Args... args) -> R { return (*(F*)storage)(std::forward<Args>(args)...); };
+    }
+
+    R operator()(Args... args) const
+    {
+        return invoker((void*)storage, std::forward<Args>(args)...);
+    }
+
+    explicit operator bool() const
+    {
+        return invoker != NULL;
+    }
+
+    bool operator==(std::nullptr_t) const
+    {
+        return invoker == NULL;
+    }
+
+    bool operator!=(std::nullptr_t) const
+    {
+        return invoker != NULL;
+    }
+};
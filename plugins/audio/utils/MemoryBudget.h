@@ -0,0 +1,248 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "log.h"
+
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+
+// Memory of the caches of the process (decoded samples, rendered drum hits, generator tables, frozen tracks...) kept
+// under a single budget, so together they never take more than the RAM of the device, and the audio process is not
+// the one killed once it runs out.
+//
+// Each cache registers with `add()`: a name, a priority, a function returning the bytes it takes, and one dropping
+// at least the given bytes of what it holds, least recently used first, returning the bytes freed. A cache without
+// anything it can drop (e.g. tables only alive while used) passes no eviction and is only accounted. Caches call
+// `changed()` when they grow, never waiting: a worker thread then sums their memory and, over the budget, evicts
+// from the caches of the lowest priority first. The caches are never called while another one holds its lock.
+//
+// The budget is set with the host config `"memoryBudgetMb"` or the environment variable `MEMORY_BUDGET_MB`, by
+// default half of the RAM (`MemTotal` in /proc/meminfo). The caches are also evicted when the memory available to
+// the whole system (`MemAvailable`) falls below the reserve, `MEMORY_RESERVE_MB`, 64 MB by default.
+class MemoryBudget {
+public:
+    enum Priority : uint8_t {
+        // Cheap to get back, e.g. rendered drum hits, played live meanwhile
+        LOW,
+        // Read from the disk again, e.g. decoded samples
+        NORMAL,
+        HIGH,
+    };
+
+    typedef std::function<size_t()> UsageFn;
+    typedef std::function<size_t(size_t bytes)> EvictFn;
+
+    // Memory of the caches of a same name, as of the last check
+    struct Usage {
+        std::string name;
+        uint8_t priority;
+        size_t bytes;
+        // Bytes evicted since the start
+        size_t evicted;
+    };
+
+protected:
+    struct Cache {
+        int id;
+        std::string name;
+        uint8_t priority;
+        UsageFn usage;
+        EvictFn evict;
+        size_t bytes = 0;
+        size_t evicted = 0;
+    };
+
+    std::mutex mtx;
+    std::vector<Cache> caches;
+    int nextId = 0;
+    std::atomic<size_t> budget = 0;
+    std::atomic<size_t> reserve = 64 * 1024 * 1024;
+    std::chrono::milliseconds interval = std::chrono::milliseconds(1000);
+    bool overLogged = false;
+
+    std::mutex statsMtx;
+    std::vector<Usage> stats;
+    size_t total = 0;
+
+    std::mutex wakeMtx;
+    bool wake = false;
+    Worker worker { wakeMtx, "memory_budget", [this] { workerLoop(); } };
+
+    // Field of /proc/meminfo in bytes, 0 if it can't be read
+    static size_t meminfo(const char* field)
+    {
+        std::ifstream file("/proc/meminfo");
+        std::string line;
+        size_t length = strlen(field);
+        while (std::getline(file, line)) {
+            if (line.compare(0, length, field) == 0 && line[length] == ':') {
+                return strtoull(line.c_str() + length + 1, NULL, 10) * 1024;
+            }
+        }
+        return 0;
+    }
+
+    // Must be called with the lock held
+    void check()
+    {
+        size_t used = 0;
+        for (Cache& cache : caches) {
+            cache.bytes = cache.usage();
+            used += cache.bytes;
+        }
+        size_t over = used > budget ? used - budget : 0;
+        size_t available = reserve ? meminfo("MemAvailable") : 0;
+        if (available && available < reserve) {
+            over = std::max(over, reserve - available);
+        }
+        if (over) {
+            for (uint8_t priority = LOW; priority <= HIGH && over; priority++) {
+                for (Cache& cache : caches) {
+                    if (cache.priority != priority || !cache.evict || !cache.bytes) {
+                        continue;
+                    }
+                    size_t freed = std::min(cache.evict(over), cache.bytes);
+                    cache.evicted += freed;
+                    cache.bytes -= freed;
+                    used -= freed;
+                    over -= std::min(freed, over);
+                    if (!over) {
+                        break;
+                    }
+                }
+            }
+            // Once per episode, the next check would else log it again
+            if (over && !overLogged) {
+                logWarn("MemoryBudget: %zu MB used, %zu MB over budget with nothing left to evict", used >> 20, over >> 20);
+            }
+            overLogged = over > 0;
+        } else {
+            overLogged = false;
+        }
+
+        std::lock_guard<std::mutex> guard(statsMtx);
+        stats.clear();
+        for (Cache& cache : caches) {
+            auto it = std::find_if(stats.begin(), stats.end(), [&](Usage& usage) { return usage.name == cache.name; });
+            if (it == stats.end()) {
+                stats.push_back({ cache.name, cache.priority, cache.bytes, cache.evicted });
+            } else {
+                it->bytes += cache.bytes;
+                it->evicted += cache.evicted;
+            }
+        }
+        total = used;
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(wakeMtx);
+        while (worker.isRunning()) {
+            worker.cv.wait_for(lock, interval, [&] { return wake || !worker.isRunning(); });
+            wake = false;
+            if (!worker.isRunning()) {
+                break;
+            }
+            lock.unlock();
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                check();
+            }
+            lock.lock();
+        }
+    }
+
+    friend MemoryBudget& processSingleton<MemoryBudget>();
+
+    MemoryBudget()
+    {
+        const char* value = getenv("MEMORY_BUDGET_MB");
+        if (value && value[0] != '\0') {
+            logInfo("Env variable memory budget: %s MB", value);
+            budget = (size_t)atol(value) * 1024 * 1024;
+        } else {
+            budget = meminfo("MemTotal") / 2;
+        }
+        const char* reserveMb = getenv("MEMORY_RESERVE_MB");
+        if (reserveMb && reserveMb[0] != '\0') {
+            logInfo("Env variable memory reserve: %s MB", reserveMb);
+            reserve = (size_t)atol(reserveMb) * 1024 * 1024;
+        }
+        if (!budget) {
+            // Not a Linux system, only the reserve could tell
+            budget = SIZE_MAX;
+        }
+    }
+
+public:
+    static MemoryBudget& get()
+    {
+        return processSingleton<MemoryBudget>();
+    }
+
+    // Register a cache, `evict` being NULL if it can't drop anything. Return the ID to remove it with. Like
+    // `remove()`, never to be called with the lock of a cache held.
+    int add(std::string name, Priority priority, UsageFn usage, EvictFn evict = NULL)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        int id = nextId++;
+        caches.push_back({ id, name, priority, usage, evict });
+        std::lock_guard<std::mutex> wakeGuard(wakeMtx);
+        worker.start();
+        return id;
+    }
+
+    // Unregister a cache before it is destroyed, waiting for the check in progress to be done with it
+    void remove(int id)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        caches.erase(std::remove_if(caches.begin(), caches.end(), [&](Cache& cache) { return cache.id == id; }), caches.end());
+    }
+
+    // A cache grew: the memory is checked soon, by the worker. Never waits long, the caches calling it with their
+    // lock held.
+    void changed()
+    {
+        {
+            std::lock_guard<std::mutex> guard(wakeMtx);
+            wake = true;
+        }
+        worker.cv.notify_one();
+    }
+
+    void setBudget(size_t bytes)
+    {
+        budget = bytes;
+        changed();
+    }
+
+    void setReserve(size_t bytes)
+    {
+        reserve = bytes;
+        changed();
+    }
+
+    size_t getBudget()
+    {
+        return budget;
+    }
+
+    // Memory of the caches as of the last check, grouped by name, and their total, e.g. for the Memory component
+    size_t read(std::vector<Usage>& usage)
+    {
+        std::lock_guard<std::mutex> guard(statsMtx);
+        usage = stats;
+        return total;
+    }
+};
@@ -0,0 +1,192 @@
+#pragma once
+
+#include <atomic>
+#include <cmath>
+#include <cstdint>
+#include <string>
+
+#include "libs/nlohmann/json.hpp"
+
+// Modulation sources shared by all the tracks, computed once per block by the host into one value per block, so any
+// number of plugins, on any track, follow the same LFO in phase for the cost of a single one. The plugins route them
+// to their values with the `modulation` config, see Mapping::mapModulation().
+//
+// - `lfo` low frequency oscillator, from -1 to 1: `sine`, `triangle`, `saw`, `square` or `random` (sample and hold)
+// - `cc` MIDI control change, from 0 to 1
+// - `follower` envelope of the output of a track, from 0 to 1, one block behind since the tracks run in parallel
+// - `published` value written by a plugin with `publish()`, e.g. an envelope or a sequencer lane, from 0 to 1
+//
+// The values are updated by the host thread between two blocks (see `update()`), and only read by the tracks while
+// they process a block. The MIDI thread and the plugins write their input atomically, picked up by the next update.
+class ModulationSources {
+public:
+    static const uint8_t MAX_SOURCES = 32;
+
+    enum Type {
+        LFO,
+        CC,
+        FOLLOWER,
+        PUBLISHED,
+    };
+
+    enum Shape {
+        SINE,
+        TRIANGLE,
+        SAW,
+        SQUARE,
+        RANDOM,
+    };
+
+    struct Source {
+        std::string name;
+        Type type = LFO;
+        // Value for the current block
+        float value = 0.0f;
+
+        // LFO
+        Shape shape = SINE;
+        float rate = 1.0f;
+        float phase = 0.0f;
+        uint32_t seed = 1;
+
+        // CC, the channel being 0 to 15, or 16 for all of them
+        uint8_t controller = 1;
+        uint8_t channel = 16;
+
+        // Follower
+        int16_t track = 0;
+        float attackMs = 5.0f;
+        float releaseMs = 200.0f;
+
+        // Written by the MIDI thread or the plugins, copied to `value` by the next update
+        std::atomic<float> input = 0.0f;
+    };
+
+protected:
+    Source sources[MAX_SOURCES];
+    uint8_t count = 0;
+
+    float lfo(Source& source)
+    {
+        float p = source.phase;
+        switch (source.shape) {
+        case TRIANGLE:
+            return 1.0f - 4.0f * fabsf(p - 0.5f);
+        case SAW:
+            return 2.0f * p - 1.0f;
+        case SQUARE:
+            return p < 0.5f ? 1.0f : -1.0f;
+        case RANDOM:
+            return source.value;
+        default:
+            return sinf(2.0f * (float)M_PI * p);
+        }
+    }
+
+    // Peak of the track lane over the block, followed with the attack and release times
+    void follow(Source& source, float* buf, uint32_t trackStride, uint32_t frameStride, uint32_t frames, uint64_t sampleRate)
+    {
+        if (source.track < 0) {
+            return;
+        }
+        float* lane = buf + source.track * trackStride;
+        float peak = 0.0f;
+        for (uint32_t f = 0; f < frames; f++) {
+            peak = fmaxf(peak, fabsf(lane[f * frameStride]));
+        }
+        float ms = peak > source.value ? source.attackMs : source.releaseMs;
+        float coeff = expf(-(float)frames * 1000.0f / (fmaxf(ms, 0.1f) * sampleRate));
+        source.value = peak + (source.value - peak) * coeff;
+    }
+
+public:
+    static Shape getShape(const std::string& name)
+    {
+        return name == "triangle" ? TRIANGLE : name == "saw" ? SAW : name == "square" ? SQUARE : name == "random" ? RANDOM : SINE;
+    }
+
+    // Add a source from its config, return its index, or -1 when there is no room left or the name is missing
+    int add(nlohmann::json& config)
+    {
+        std::string name = config.value("name", "");
+        int existing = find(name);
+        if (name.empty() || (existing < 0 && count >= MAX_SOURCES)) {
+            return -1;
+        }
+        Source& source = sources[existing >= 0 ? existing : count];
+        source.name = name;
+        std::string type = config.value("type", "lfo");
+        source.type = type == "cc" ? CC : type == "follower" ? FOLLOWER : type == "published" ? PUBLISHED : LFO;
+        source.shape = getShape(config.value("shape", "sine"));
+        source.rate = config.value("rate", source.rate);
+        source.phase = fmodf(config.value("phase", 0.0f), 1.0f);
+        source.controller = config.value("cc", source.controller);
+        source.channel = config.contains("channel") ? (config["channel"].get<uint8_t>() - 1) & 0x0f : 16;
+        source.track = config.value("track", source.track);
+        source.attackMs = config.value("attack", source.attackMs);
+        source.releaseMs = config.value("release", source.releaseMs);
+        source.value = 0.0f;
+        source.input = 0.0f;
+        return existing >= 0 ? existing : count++;
+    }
+
+    int find(const std::string& name)
+    {
+        for (uint8_t i = 0; i < count; i++) {
+            if (sources[i].name == name) {
+                return i;
+            }
+        }
+        return -1;
+    }
+
+    inline float get(uint8_t index)
+    {
+        return sources[index].value;
+    }
+
+    // Write the value of a `published` source, from 0 to 1, heard from the next block
+    void publish(uint8_t index, float value)
+    {
+        sources[index].input.store(value, std::memory_order_relaxed);
+    }
+
+    // Control changes of the `cc` sources, return true if one of them follows the message
+    bool midi(const uint8_t* message, uint8_t size)
+    {
+        if (size != 3 || (message[0] & 0xf0) != 0xb0) {
+            return false;
+        }
+        bool handled = false;
+        for (uint8_t i = 0; i < count; i++) {
+            Source& source = sources[i];
+            if (source.type == CC && source.controller == message[1] && (source.channel == 16 || source.channel == (message[0] & 0x0f))) {
+                source.input.store(message[2] / 127.0f, std::memory_order_relaxed);
+                handled = true;
+            }
+        }
+        return handled;
+    }
+
+    // Compute the values of the next block, once the current one is fully processed: `buf` still holds the output
+    // of the tracks, for the followers
+    void update(float* buf, uint32_t trackStride, uint32_t frameStride, uint32_t frames, uint64_t sampleRate)
+    {
+        for (uint8_t i = 0; i < count; i++) {
+            Source& source = sources[i];
+            if (source.type == LFO) {
+                float phase = source.phase + source.rate * frames / sampleRate;
+                if (source.shape == RANDOM && phase >= 1.0f) {
+                    source.seed = source.seed * 1664525u + 1013904223u;
+                    source.value = (source.seed >> 8) * (2.0f / 16777216.0f) - 1.0f;
+                }
+                source.phase = phase - floorf(phase);
+                source.value = lfo(source);
+            } else if (source.type == FOLLOWER) {
+                follow(source, buf, trackStride, frameStride, frames, sampleRate);
+            } else {
+                source.value = source.input.load(std::memory_order_relaxed);
+            }
+        }
+    }
+};
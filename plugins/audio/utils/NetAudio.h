@@ -0,0 +1,174 @@
+#pragma once
+
+#include <arpa/inet.h>
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <string>
+
+#if __has_include(<opus/opus.h>)
+#include <opus/opus.h>
+#define NET_AUDIO_OPUS
+#endif
+
+// Audio streamed between units as RTP over UDP, see AudioOutputNetwork and AudioInputNetwork.
+//
+// Each packet is a 12 bytes RTP header followed by the frames of the packet, the payload type telling the format and
+// channels, so the receiver needs no config for it:
+// - 96 / 97: float 32 bits, mono / stereo, big endian
+// - 98 / 99: L16, signed 16 bits, mono / stereo, big endian as in RFC 3551
+// - 100: Opus as in RFC 7587, when built with libopus
+// The sample rate is not carried, both ends must use the same.
+class NetAudio {
+public:
+    enum Format : uint8_t {
+        FLOAT32,
+        INT16,
+        OPUS,
+    };
+
+    static constexpr uint8_t PAYLOAD_FLOAT32 = 96;
+    static constexpr uint8_t PAYLOAD_INT16 = 98;
+    static constexpr uint8_t PAYLOAD_OPUS = 100;
+    static constexpr uint16_t DEFAULT_PORT = 5004;
+
+    // Payload kept below the MTU of an ethernet link, with room for the IP, UDP and RTP headers
+    static constexpr uint32_t MAX_PAYLOAD = 1400;
+    static constexpr uint32_t HEADER_SIZE = 12;
+
+    // All the fields in network byte order
+    struct Header {
+        uint8_t flags; // version 2, no padding, extension nor CSRC
+        uint8_t payloadType; // marker bit unused
+        uint16_t sequence;
+        uint32_t timestamp; // first frame of the packet, in frames
+        uint32_t ssrc;
+    };
+    static_assert(sizeof(Header) == HEADER_SIZE, "RTP header must be 12 bytes");
+
+    // Updated by the threads of the plugin, read by the UI through the `STATS` data ID
+    struct Stats {
+        uint32_t packets = 0;
+        // Packets missing from the sequence, concealed by the receiver
+        uint32_t lost = 0;
+        // Packets received after the following ones were played, dropped
+        uint32_t late = 0;
+        // Frames dropped because a ring was full, e.g. the network thread stalled
+        uint32_t dropped = 0;
+        // Times the receiver ran out of frames and buffered again
+        uint32_t underruns = 0;
+        // Receiver only: buffered audio and interarrival jitter
+        float latencyMs = 0.0f;
+        float jitterMs = 0.0f;
+    };
+
+    struct AtomicStats {
+        std::atomic<uint32_t> packets = 0;
+        std::atomic<uint32_t> lost = 0;
+        std::atomic<uint32_t> late = 0;
+        std::atomic<uint32_t> dropped = 0;
+        std::atomic<uint32_t> underruns = 0;
+        std::atomic<float> latencyMs = 0.0f;
+        std::atomic<float> jitterMs = 0.0f;
+
+        void copy(Stats& stats)
+        {
+            stats.packets = packets.load(std::memory_order_relaxed);
+            stats.lost = lost.load(std::memory_order_relaxed);
+            stats.late = late.load(std::memory_order_relaxed);
+            stats.dropped = dropped.load(std::memory_order_relaxed);
+            stats.underruns = underruns.load(std::memory_order_relaxed);
+            stats.latencyMs = latencyMs.load(std::memory_order_relaxed);
+            stats.jitterMs = jitterMs.load(std::memory_order_relaxed);
+        }
+    };
+
+    static Format getFormat(std::string name)
+    {
+        if (name == "int16") {
+            return INT16;
+        }
+#ifdef NET_AUDIO_OPUS
+        if (name == "opus") {
+            return OPUS;
+        }
+#endif
+        return FLOAT32;
+    }
+
+    static uint8_t payloadType(Format format, uint8_t channels)
+    {
+        if (format == OPUS) {
+            return PAYLOAD_OPUS;
+        }
+        return (format == INT16 ? PAYLOAD_INT16 : PAYLOAD_FLOAT32) + (channels == 2 ? 1 : 0);
+    }
+
+    // Format and channels of a payload type, false if it is not one of ours
+    static bool parsePayloadType(uint8_t type, Format& format, uint8_t& channels)
+    {
+        type &= 0x7f;
+        if (type == PAYLOAD_OPUS) {
+            format = OPUS;
+            channels = 2;
+            return true;
+        }
+        if (type >= PAYLOAD_FLOAT32 && type < PAYLOAD_INT16 + 2) {
+            format = type < PAYLOAD_INT16 ? FLOAT32 : INT16;
+            channels = (type - PAYLOAD_FLOAT32) % 2 ? 2 : 1;
+            return true;
+        }
+        return false;
+    }
+
+    static uint32_t sampleSize(Format format)
+    {
+        return format == INT16 ? sizeof(int16_t) : sizeof(float);
+    }
+
+    // Interleaved `samples` to the raw payload
+    static void encode(Format format, const float* samples, uint32_t count, uint8_t* payload)
+    {
+        if (format == INT16) {
+            for (uint32_t i = 0; i < count; i++) {
+                float value = samples[i] < -1.0f ? -1.0f : (samples[i] > 1.0f ? 1.0f : samples[i]);
+                uint16_t bits = htons((uint16_t)(int16_t)(value * 32767.0f));
+                memcpy(payload + i * 2, &bits, 2);
+            }
+            return;
+        }
+        for (uint32_t i = 0; i < count; i++) {
+            uint32_t bits;
+            memcpy(&bits, samples + i, 4);
+            bits = htonl(bits);
+            memcpy(payload + i * 4, &bits, 4);
+        }
+    }
+
+    // Raw payload of `channels` to interleaved samples of `outChannels`, mixing down or copying the mono channel
+    static void decode(Format format, const uint8_t* payload, uint32_t frames, uint8_t channels, float* samples, uint8_t outChannels)
+    {
+        for (uint32_t f = 0; f < frames; f++) {
+            float values[2];
+            for (uint8_t c = 0; c < channels; c++) {
+                uint32_t i = f * channels + c;
+                if (format == INT16) {
+                    uint16_t bits;
+                    memcpy(&bits, payload + i * 2, 2);
+                    values[c] = (int16_t)ntohs(bits) / 32768.0f;
+                } else {
+                    uint32_t bits;
+                    memcpy(&bits, payload + i * 4, 4);
+                    bits = ntohl(bits);
+                    memcpy(values + c, &bits, 4);
+                }
+            }
+            if (outChannels == 1) {
+                samples[f] = channels == 2 ? (values[0] + values[1]) * 0.5f : values[0];
+            } else {
+                samples[f * 2] = values[0];
+                samples[f * 2 + 1] = channels == 2 ? values[1] : values[0];
+            }
+        }
+    }
+};
@@ -0,0 +1,274 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <map>
+#include <memory>
+#include <mutex>
+#ifndef SKIP_SNDFILE
+#include <sndfile.h>
+#endif
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "audio/utils/applySampleGain.h"
+#include "helpers/fs/directoryList.h"
+#include "helpers/processSingleton.h"
+#include "log.h"
+#include "plugins/audio/utils/FileWriter.h"
+#include "plugins/audio/utils/WavFile.h"
+
+// Waves of a folder packed in a single read only file, the ROM, mapped once and shared by all the engines of the
+// process, e.g. the PCM waves of the ER-1 drum engine, so each track using them doesn't keep its own copy, and
+// switching wave is only taking another pointer, without reading a file from the audio thread.
+//
+// The ROM is the hidden file `.pcm.rom` of the folder: a header, the index of the waves (name, offset, samples), then
+// the samples of each wave, float, normalized and starting on a page boundary. It is built from the files of the
+// folder, in the order the file browser lists them, the first time the folder is used and again once one of the
+// files changed. If it can't be written, e.g. a read only folder, the packed waves are kept in memory instead, still
+// shared.
+class PcmRom {
+public:
+    static constexpr uint32_t MAGIC = 0x5a50434d; // ZPCM
+    static constexpr uint32_t VERSION = 1;
+    static constexpr uint64_t PAGE = 4096;
+
+    struct Header {
+        uint32_t magic;
+        uint32_t version;
+        uint64_t hash;
+        uint32_t waveCount;
+        uint32_t reserved;
+    };
+
+    struct Entry {
+        char name[56];
+        uint32_t channels;
+        uint32_t reserved;
+        // From the start of the ROM, in bytes
+        uint64_t offset;
+        // Interleaved samples, not frames
+        uint64_t count;
+    };
+
+    struct Wave {
+        std::string name;
+        const float* data;
+        uint64_t count;
+        uint8_t channels;
+    };
+
+protected:
+    std::string folder;
+    uint64_t maxSamples;
+    std::vector<Wave> waves;
+    void* map = MAP_FAILED;
+    size_t size = 0;
+    // The ROM when it could not be written
+    std::string image;
+
+    std::string romPath()
+    {
+        return folder + "/.pcm.rom";
+    }
+
+    // Of the names, dates and sizes of the files, so the ROM is built again once one of them changed
+    uint64_t hashFiles(const std::vector<std::filesystem::path>& files)
+    {
+        std::string key = std::to_string(VERSION) + "|" + std::to_string(maxSamples);
+        for (auto& file : files) {
+            struct stat info;
+            if (stat(file.c_str(), &info) == 0) {
+                key += "|" + file.filename().string() + ":" + std::to_string((long)info.st_mtime) + ":" + std::to_string((long)info.st_size);
+            }
+        }
+        return std::hash<std::string>()(key);
+    }
+
+    bool decode(const std::string& path, std::vector<float>& samples, uint32_t& channels)
+    {
+        WavFile wav;
+        if (wav.open(path)) {
+            samples.resize(std::min<uint64_t>(wav.count, maxSamples));
+            samples.resize(wav.read(samples.data(), samples.size()));
+            channels = wav.channels;
+            return true;
+        }
+#ifndef SKIP_SNDFILE
+        SF_INFO sfinfo;
+        SNDFILE* file = sf_open(path.c_str(), SFM_READ, &sfinfo);
+        if (file) {
+            samples.resize(std::min<uint64_t>(sfinfo.frames * std::max(sfinfo.channels, 1), maxSamples));
+            samples.resize(sf_read_float(file, samples.data(), samples.size()));
+            channels = sfinfo.channels;
+            sf_close(file);
+            return true;
+        }
+#endif
+        logDebug("PcmRom: could not read %s", path.c_str());
+        return false;
+    }
+
+    std::string build(const std::vector<std::filesystem::path>& files, uint64_t hash)
+    {
+        std::vector<Entry> entries;
+        std::vector<std::vector<float>> samples;
+        for (auto& file : files) {
+            Entry entry;
+            memset(&entry, 0, sizeof(entry));
+            strncpy(entry.name, file.filename().c_str(), sizeof(entry.name) - 1);
+            std::vector<float> wave;
+            if (!decode(file, wave, entry.channels)) {
+                continue;
+            }
+            applySampleGain(wave.data(), wave.size());
+            entry.count = wave.size();
+            entries.push_back(entry);
+            samples.push_back(std::move(wave));
+        }
+
+        Header header = { MAGIC, VERSION, hash, (uint32_t)entries.size(), 0 };
+        uint64_t offset = sizeof(Header) + entries.size() * sizeof(Entry);
+        for (Entry& entry : entries) {
+            entry.offset = (offset + PAGE - 1) / PAGE * PAGE;
+            offset = entry.offset + entry.count * sizeof(float);
+        }
+        std::string data((const char*)&header, sizeof(header));
+        data.append((const char*)entries.data(), entries.size() * sizeof(Entry));
+        for (size_t i = 0; i < entries.size(); i++) {
+            data.resize(entries[i].offset, '\0');
+            data.append((const char*)samples[i].data(), samples[i].size() * sizeof(float));
+        }
+        return data;
+    }
+
+    // Index the waves of the ROM, false if it is not valid or not built from these files
+    bool load(const uint8_t* data, size_t bytes, uint64_t hash)
+    {
+        Header header;
+        if (bytes < sizeof(Header)) {
+            return false;
+        }
+        memcpy(&header, data, sizeof(header));
+        if (header.magic != MAGIC || header.version != VERSION || header.hash != hash
+            || header.waveCount > (bytes - sizeof(Header)) / sizeof(Entry)) {
+            return false;
+        }
+        std::vector<Wave> loaded;
+        for (uint32_t i = 0; i < header.waveCount; i++) {
+            Entry entry;
+            memcpy(&entry, data + sizeof(Header) + i * sizeof(Entry), sizeof(entry));
+            if (entry.offset % sizeof(float) != 0 || entry.offset > bytes || entry.count > (bytes - entry.offset) / sizeof(float)) {
+                return false;
+            }
+            loaded.push_back({ std::string(entry.name, strnlen(entry.name, sizeof(entry.name))),
+                (const float*)(data + entry.offset), entry.count, (uint8_t)std::max<uint32_t>(entry.channels, 1) });
+        }
+        waves = loaded;
+        return true;
+    }
+
+    bool mapRom(uint64_t hash)
+    {
+        int fd = ::open(romPath().c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || (size_t)info.st_size < sizeof(Header)) {
+            ::close(fd);
+            return false;
+        }
+        size = info.st_size;
+        map = mmap(NULL, size, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (map == MAP_FAILED) {
+            return false;
+        }
+        if (!load((const uint8_t*)map, size, hash)) {
+            munmap(map, size);
+            map = MAP_FAILED;
+            return false;
+        }
+        return true;
+    }
+
+    // ROMs of the process, by folder and size
+    struct Roms {
+        std::mutex mtx;
+        std::map<std::string, std::unique_ptr<PcmRom>> byFolder;
+    };
+
+    PcmRom(std::string folder, uint64_t maxSamples)
+        : folder(folder)
+        , maxSamples(maxSamples)
+    {
+        std::vector<std::filesystem::path> files;
+        if (std::filesystem::is_directory(folder)) {
+            files = getDirectoryList(folder, { .skipFolder = true, .skipHidden = true });
+        }
+        uint64_t hash = hashFiles(files);
+        if (mapRom(hash)) {
+            return;
+        }
+        image = build(files, hash);
+        if (FileWriter::writeNow(romPath(), image) && mapRom(hash)) {
+            image = std::string();
+            logDebug("PcmRom: %d waves packed in %s", (int)waves.size(), romPath().c_str());
+            return;
+        }
+        logWarn("PcmRom: could not write %s, the waves are kept in memory", romPath().c_str());
+        load((const uint8_t*)image.data(), image.size(), hash);
+    }
+
+public:
+    ~PcmRom()
+    {
+        if (map != MAP_FAILED) {
+            munmap(map, size);
+        }
+    }
+
+    // Builds the ROM the first time a folder is used, so never call it from the audio thread.
+    static PcmRom& get(std::string folder, uint64_t maxSamples)
+    {
+        Roms& roms = processSingleton<Roms>();
+        std::lock_guard<std::mutex> guard(roms.mtx);
+        std::unique_ptr<PcmRom>& rom = roms.byFolder[folder + "|" + std::to_string(maxSamples)];
+        if (!rom) {
+            rom.reset(new PcmRom(folder, maxSamples));
+        }
+        return *rom;
+    }
+
+    uint16_t count()
+    {
+        return waves.size();
+    }
+
+    // Wave at `position`, starting from 1 like the file browsers, clamped to the waves of the ROM. NULL if empty.
+    const Wave* get(uint16_t position)
+    {
+        if (waves.empty()) {
+            return NULL;
+        }
+        return &waves[std::clamp<uint16_t>(position, 1, waves.size()) - 1];
+    }
+
+    // Position of the wave named `name`, 0 if there is none
+    uint16_t find(std::string name)
+    {
+        name = std::filesystem::path(name).filename();
+        for (size_t i = 0; i < waves.size(); i++) {
+            if (waves[i].name == name) {
+                return i + 1;
+            }
+        }
+        return 0;
+    }
+};
@@ -0,0 +1,238 @@
+#pragma once
+
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <mutex>
+#include <string>
+#include <sys/mman.h>
+#include <thread>
+#include <type_traits>
+#include <unordered_map>
+#include <vector>
+
+// Memory for the large DSP buffers of the plugins (delay lines, reverbs, samples), reserved by the host at startup.
+//
+// The arena is mapped at once, huge page aligned, pre-faulted and locked, so the buffers never page fault on first
+// use during a performance, and the RAM they need is known upfront. Buffers are allocated while the plugins are
+// created, and attributed to the plugin being created by the calling thread, see `Owner`.
+// When the arena is full, buffers are allocated on the heap instead, still pre-faulted and accounted.
+class PluginArena {
+public:
+    static const size_t ALIGN = 64;
+    static const size_t HUGE_PAGE = 2 * 1024 * 1024;
+
+    // Attribute the buffers allocated by the current thread during the lifetime of the scope to a plugin
+    class Owner {
+    protected:
+        PluginArena* arena;
+
+    public:
+        Owner(PluginArena* arena, std::string name)
+            : arena(arena)
+        {
+            if (arena) {
+                std::lock_guard<std::mutex> guard(arena->mtx);
+                arena->owners[std::this_thread::get_id()] = name;
+            }
+        }
+
+        ~Owner()
+        {
+            if (arena) {
+                std::lock_guard<std::mutex> guard(arena->mtx);
+                arena->owners.erase(std::this_thread::get_id());
+            }
+        }
+    };
+
+    struct Usage {
+        size_t arena = 0;
+        size_t heap = 0;
+    };
+
+protected:
+    struct Block {
+        size_t offset;
+        size_t size;
+        bool used;
+        std::string owner;
+    };
+
+    uint8_t* base = NULL;
+    size_t capacity = 0;
+    // Sorted by offset, covering the whole arena
+    std::vector<Block> blocks;
+    // Buffers that didn't fit in the arena
+    std::unordered_map<void*, Block> heapBlocks;
+    std::unordered_map<std::thread::id, std::string> owners;
+    std::mutex mtx;
+
+    std::string currentOwner()
+    {
+        auto it = owners.find(std::this_thread::get_id());
+        return it == owners.end() ? "unknown" : it->second;
+    }
+
+public:
+    bool locked = false;
+
+    ~PluginArena()
+    {
+        if (base) {
+            munmap(base, capacity);
+        }
+    }
+
+    // Zeroed, aligned and pre-faulted heap memory, for buffers without arena
+    static void* heapAllocate(size_t bytes)
+    {
+        size_t size = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+        void* ptr = aligned_alloc(ALIGN, size ? size : ALIGN);
+        if (ptr) {
+            memset(ptr, 0, size);
+        }
+        return ptr;
+    }
+
+    // Map `bytes` of memory (rounded up to huge pages), return false if it couldn't be mapped.
+    // When `lock` is set, the memory is locked in RAM, `locked` telling if it succeeded.
+    bool init(size_t bytes, bool lock = true)
+    {
+        size_t size = (bytes + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE;
+        // Map one more huge page, to trim the mapping to a huge page boundary
+        uint8_t* ptr = (uint8_t*)mmap(NULL, size + HUGE_PAGE, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (ptr == MAP_FAILED) {
+            return false;
+        }
+        uint8_t* aligned = (uint8_t*)(((uintptr_t)ptr + HUGE_PAGE - 1) / HUGE_PAGE * HUGE_PAGE);
+        if (aligned > ptr) {
+            munmap(ptr, aligned - ptr);
+        }
+        munmap(aligned + size, ptr + HUGE_PAGE - aligned);
+#ifdef MADV_HUGEPAGE
+        madvise(aligned, size, MADV_HUGEPAGE);
+#endif
+        // Touch every page now, instead of on the first use by the audio thread
+        for (size_t i = 0; i < size; i += 4096) {
+            aligned[i] = 0;
+        }
+        locked = lock && mlock(aligned, size) == 0;
+
+        std::lock_guard<std::mutex> guard(mtx);
+        base = aligned;
+        capacity = size;
+        blocks = { { 0, size, false, "" } };
+        return true;
+    }
+
+    size_t size()
+    {
+        return capacity;
+    }
+
+    // Zeroed memory, aligned on a cache line. Never NULL unless the heap is exhausted.
+    void* allocate(size_t bytes)
+    {
+        size_t size = (bytes + ALIGN - 1) / ALIGN * ALIGN;
+        std::lock_guard<std::mutex> guard(mtx);
+        for (size_t i = 0; i < blocks.size(); i++) {
+            if (blocks[i].used || blocks[i].size < size) {
+                continue;
+            }
+            if (blocks[i].size > size) {
+                blocks.insert(blocks.begin() + i + 1, { blocks[i].offset + size, blocks[i].size - size, false, "" });
+                blocks[i].size = size;
+            }
+            blocks[i].used = true;
+            blocks[i].owner = currentOwner();
+            void* ptr = base + blocks[i].offset;
+            memset(ptr, 0, size);
+            return ptr;
+        }
+        void* ptr = heapAllocate(size);
+        if (ptr) {
+            heapBlocks[ptr] = { 0, size, true, currentOwner() };
+        }
+        return ptr;
+    }
+
+    void release(void* ptr)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        if (base && ptr >= base && ptr < base + capacity) {
+            size_t offset = (uint8_t*)ptr - base;
+            for (size_t i = 0; i < blocks.size(); i++) {
+                if (blocks[i].offset == offset) {
+                    blocks[i].used = false;
+                    // Merge with the free neighbours
+                    if (i + 1 < blocks.size() && !blocks[i + 1].used) {
+                        blocks[i].size += blocks[i + 1].size;
+                        blocks.erase(blocks.begin() + i + 1);
+                    }
+                    if (i > 0 && !blocks[i - 1].used) {
+                        blocks[i - 1].size += blocks[i].size;
+                        blocks.erase(blocks.begin() + i);
+                    }
+                    return;
+                }
+            }
+        } else if (heapBlocks.erase(ptr)) {
+            free(ptr);
+        }
+    }
+
+    // Memory used by each plugin
+    std::map<std::string, Usage> usage()
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        std::map<std::string, Usage> result;
+        for (Block& block : blocks) {
+            if (block.used) {
+                result[block.owner].arena += block.size;
+            }
+        }
+        for (auto& [ptr, block] : heapBlocks) {
+            result[block.owner].heap += block.size;
+        }
+        return result;
+    }
+};
+
+// Fixed size array allocated in the plugin arena, or on the heap when there is no arena (e.g. tests, bench).
+// Zero initialized, used as a plain `T*`. Meant to be a plugin member, e.g.:
+// `ArenaArray<float> buffer = ArenaArray<float>(props.arena, 48000);`
+template <typename T>
+class ArenaArray {
+    static_assert(std::is_trivially_copyable<T>::value, "ArenaArray only holds plain data");
+
+protected:
+    PluginArena* arena;
+    T* data;
+    size_t count;
+
+public:
+    ArenaArray(PluginArena* arena, size_t count)
+        : arena(arena)
+        , count(count)
+    {
+        data = (T*)(arena ? arena->allocate(count * sizeof(T)) : PluginArena::heapAllocate(count * sizeof(T)));
+    }
+
+    ~ArenaArray()
+    {
+        if (arena) {
+            arena->release(data);
+        } else {
+            free(data);
+        }
+    }
+
+    ArenaArray(const ArenaArray&) = delete;
+    ArenaArray& operator=(const ArenaArray&) = delete;
+
+    operator T*() { return data; }
+
+    size_t size() { return count; }
+};
@@ -0,0 +1,279 @@
+#pragma once
+
+#include <algorithm>
+#include <condition_variable>
+#include <filesystem>
+#include <fstream>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <vector>
+
+#include "libs/nlohmann/json.hpp"
+#include "log.h"
+#include "plugins/audio/audioPlugin.h"
+#include "plugins/audio/utils/ClipState.h"
+#include "plugins/audio/utils/FileWriter.h"
+
+// Presets of a plugin type, one folder per type (e.g. `data/presets/SynthMultiEngine`), so browsing them doesn't
+// open every file to know its category, and selecting one doesn't read nor parse it.
+//
+// The name and the category of each preset are kept in the hidden file `.presets.json` of the folder. Opening the
+// folder only checks the date and size of the files against it, reading the presets added or modified since. The
+// category is the `"category"` field of the preset, else its subfolder, e.g. `Bass/Acid.json`.
+//
+// The presets next to the cursor are read by a background thread, parsed to a `ClipState::Plugin`, and the plugin
+// prefetches what they need (see `AudioPlugin::prefetchState()`), so loading one only sets its values by ID.
+class PresetIndex {
+public:
+    struct Preset {
+        // Relative to the folder
+        std::string file;
+        std::string name;
+        std::string category;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+    };
+
+protected:
+    static constexpr uint32_t VERSION = 1;
+
+    std::string folder;
+    std::vector<Preset> presets;
+
+    // Presets read by the worker, by file, only the ones next to the cursor being kept
+    std::map<std::string, std::shared_ptr<ClipState::Plugin>> cache;
+    std::vector<std::string> wanted;
+    AudioPlugin* plugin = NULL;
+    std::mutex mtx;
+    std::condition_variable cv;
+    std::thread worker;
+    bool running = true;
+
+    std::string indexPath()
+    {
+        return folder + "/.presets.json";
+    }
+
+    static bool stat(const std::filesystem::path& path, int64_t& mtime, uint64_t& size)
+    {
+        struct stat st;
+        if (::stat(path.c_str(), &st) != 0) {
+            return false;
+        }
+        mtime = st.st_mtime;
+        size = st.st_size;
+        return true;
+    }
+
+    static bool readJson(const std::string& path, nlohmann::json& json)
+    {
+        std::ifstream file(path);
+        if (!file.is_open()) {
+            return false;
+        }
+        try {
+            file >> json;
+        } catch (const nlohmann::json::parse_error& e) {
+            logWarn("PresetIndex: JSON parse error in %s: %s", path.c_str(), e.what());
+            return false;
+        }
+        return true;
+    }
+
+    std::map<std::string, Preset> loadIndex()
+    {
+        std::map<std::string, Preset> indexed;
+        nlohmann::json json;
+        if (!readJson(indexPath(), json) || json.value("version", 0u) != VERSION || !json.contains("presets")) {
+            return indexed;
+        }
+        for (auto& entry : json["presets"]) {
+            Preset preset;
+            preset.file = entry.value("file", "");
+            preset.name = entry.value("name", "");
+            preset.category = entry.value("category", "");
+            preset.mtime = entry.value("mtime", (int64_t)0);
+            preset.size = entry.value("size", (uint64_t)0);
+            indexed[preset.file] = preset;
+        }
+        return indexed;
+    }
+
+    void saveIndex()
+    {
+        nlohmann::json entries = nlohmann::json::array();
+        for (Preset& preset : presets) {
+            entries.push_back({ { "file", preset.file }, { "name", preset.name }, { "category", preset.category },
+                { "mtime", preset.mtime }, { "size", preset.size } });
+        }
+        nlohmann::json json = { { "version", VERSION }, { "presets", entries } };
+        FileWriter::get().write(indexPath(), json.dump(2));
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (true) {
+            cv.wait(lock, [&] { return !running || std::any_of(wanted.begin(), wanted.end(), [&](const std::string& file) { return !cache.count(file); }); });
+            if (!running) {
+                break;
+            }
+            std::string file = *std::find_if(wanted.begin(), wanted.end(), [&](const std::string& file) { return !cache.count(file); });
+            AudioPlugin* target = plugin;
+            lock.unlock();
+
+            std::shared_ptr<ClipState::Plugin> state = read(file, target);
+            if (state && target) {
+                target->prefetchState(*state);
+            }
+
+            lock.lock();
+            if (std::find(wanted.begin(), wanted.end(), file) != wanted.end()) {
+                cache[file] = state;
+            }
+        }
+    }
+
+    std::shared_ptr<ClipState::Plugin> read(const std::string& file, AudioPlugin* target)
+    {
+        std::ifstream input(folder + "/" + file);
+        if (!input.is_open()) {
+            return NULL;
+        }
+        std::shared_ptr<ClipState::Plugin> state = std::make_shared<ClipState::Plugin>();
+        if (!ClipState::parsePlugin(input, target ? target->name : "", *state)) {
+            logWarn("PresetIndex: JSON parse error in %s", file.c_str());
+            return NULL;
+        }
+        return state;
+    }
+
+public:
+    ~PresetIndex()
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            running = false;
+        }
+        cv.notify_all();
+        if (worker.joinable()) {
+            worker.join();
+        }
+    }
+
+    // List the presets of the folder, sorted by category then name, only reading the ones changed since indexed
+    void open(std::string _folder)
+    {
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            folder = _folder;
+            cache.clear();
+            wanted.clear();
+        }
+        presets.clear();
+        if (!std::filesystem::is_directory(folder)) {
+            return;
+        }
+
+        std::map<std::string, Preset> indexed = loadIndex();
+        bool changed = false;
+        std::error_code error;
+        for (auto it = std::filesystem::recursive_directory_iterator(folder, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            std::string filename = it->path().filename().string();
+            if (filename[0] == '.') {
+                if (it->is_directory()) {
+                    it.disable_recursion_pending();
+                }
+                continue;
+            }
+            if (it->is_directory() || it->path().extension() != ".json") {
+                continue;
+            }
+            Preset preset;
+            preset.file = std::filesystem::relative(it->path(), folder).string();
+            if (!stat(it->path(), preset.mtime, preset.size)) {
+                continue;
+            }
+            auto known = indexed.find(preset.file);
+            if (known != indexed.end() && known->second.mtime == preset.mtime && known->second.size == preset.size) {
+                presets.push_back(known->second);
+                indexed.erase(known);
+                continue;
+            }
+            nlohmann::json json;
+            readJson(it->path(), json);
+            preset.name = it->path().stem().string();
+            std::string subfolder = it->path().parent_path().lexically_relative(folder).string();
+            preset.category = json.is_object() && json.contains("category") && json["category"].is_string()
+                ? json["category"].get<std::string>()
+                : (subfolder == "." ? "" : subfolder);
+            presets.push_back(preset);
+            changed = true;
+        }
+        // Presets removed since indexed
+        changed = changed || !indexed.empty();
+
+        std::sort(presets.begin(), presets.end(), [](const Preset& a, const Preset& b) {
+            return a.category != b.category ? a.category < b.category : a.name < b.name;
+        });
+        if (changed) {
+            saveIndex();
+            logDebug("PresetIndex: %d presets indexed in %s", (int)presets.size(), folder.c_str());
+        }
+    }
+
+    size_t count()
+    {
+        return presets.size();
+    }
+
+    Preset& get(size_t index)
+    {
+        return presets.at(index);
+    }
+
+    std::string path(size_t index)
+    {
+        return folder + "/" + presets.at(index).file;
+    }
+
+    // Read the presets from `index - before` to `index + after` in the background, the others being dropped
+    void prefetch(size_t index, AudioPlugin* target, size_t before = 1, size_t after = 2)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        plugin = target;
+        wanted.clear();
+        for (size_t i = index > before ? index - before : 0; i <= index + after && i < presets.size(); i++) {
+            wanted.push_back(presets[i].file);
+        }
+        for (auto it = cache.begin(); it != cache.end();) {
+            it = std::find(wanted.begin(), wanted.end(), it->first) == wanted.end() ? cache.erase(it) : std::next(it);
+        }
+        if (!worker.joinable()) {
+            worker = std::thread([this] { workerLoop(); });
+            pthread_setname_np(worker.native_handle(), "preset_prefetch");
+        }
+        cv.notify_one();
+    }
+
+    // State of the preset, read right away when not prefetched yet, NULL if it cannot be read
+    std::shared_ptr<ClipState::Plugin> state(size_t index, AudioPlugin* target)
+    {
+        if (index >= presets.size()) {
+            return NULL;
+        }
+        std::string file = presets[index].file;
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            auto it = cache.find(file);
+            if (it != cache.end() && it->second && target && it->second->name == target->name) {
+                return it->second;
+            }
+        }
+        return read(file, target);
+    }
+};
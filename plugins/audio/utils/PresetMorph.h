@@ -0,0 +1,85 @@
+#pragma once
+
+#include <algorithm>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+#include "plugins/audio/audioPlugin.h"
+#include "plugins/audio/utils/ClipState.h"
+
+// Morph of a plugin between the values of two presets, e.g. with a knob.
+//
+// The values differing between both presets are resolved once, by `prepare()`, to their value and their range, so
+// moving the morph only sets them, without any lookup. The values are set like any change from the UI: queued, and
+// applied between two blocks by the audio thread, the smoothed values (see `Val::smooth()`) ramping to their new
+// value over the next block. Values shown as a string (e.g. a waveform or an engine) jump half way, and everything
+// that is not a value (e.g. sample files, steps) stays the one of the preset loaded first.
+class PresetMorph {
+protected:
+    struct Target {
+        ValueInterface* value;
+        float from;
+        float delta;
+        bool discrete;
+    };
+    std::vector<Target> targets;
+    float amount = 0.0f;
+
+public:
+    // Values of `to` differing from `from`, the plugin having `from` loaded
+    void prepare(AudioPlugin* plugin, const ClipState::Plugin& from, const ClipState::Plugin& to)
+    {
+        targets.clear();
+        amount = 0.0f;
+        std::unordered_map<std::string, float> toValues;
+        for (size_t i = 0; i < to.keys.size(); i++) {
+            toValues.emplace(to.keys[i], to.values[i]);
+        }
+        for (size_t i = 0; i < from.keys.size(); i++) {
+            auto it = toValues.find(from.keys[i]);
+            if (it == toValues.end() || it->second == from.values[i]) {
+                continue;
+            }
+            ValueInterface* value = plugin->getValue(plugin->getValueIndex(from.keys[i]));
+            if (value) {
+                targets.push_back({ value, from.values[i], it->second - from.values[i], (value->props().type & VALUE_STRING) != 0 });
+            }
+        }
+    }
+
+    void clear()
+    {
+        targets.clear();
+        amount = 0.0f;
+    }
+
+    bool active()
+    {
+        return !targets.empty();
+    }
+
+    float get()
+    {
+        return amount;
+    }
+
+    // From 0.0, the first preset, to 1.0, the second one
+    void set(float next)
+    {
+        next = std::clamp(next, 0.0f, 1.0f);
+        if (next == amount) {
+            return;
+        }
+        bool side = next >= 0.5f;
+        bool switched = side != (amount >= 0.5f);
+        amount = next;
+        for (Target& target : targets) {
+            if (!target.discrete) {
+                target.value->set(target.from + target.delta * amount);
+            } else if (switched) {
+                target.value->set(side ? target.from + target.delta : target.from);
+            }
+        }
+    }
+};
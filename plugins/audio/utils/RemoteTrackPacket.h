@@ -0,0 +1,87 @@
+#pragma once
+
+#include <cstdint>
+#include <cstring>
+
+// Events of a track rendered by another unit, see RemoteTrack and RemoteTrackServer, each UDP packet holding the
+// events of one block, in host byte order as both units run the same build.
+//
+// A BLOCK packet also repeats the events of the previous block, so a single lost packet loses no note. A NAMES packet
+// lists the aliases of the plugins the values refer to, by index, repeated every second so a restarted server picks
+// them up. The audio comes back as an RTP stream (see NetAudio), the timestamp being the frame of the block on the
+// sending unit.
+class RemoteTrackPacket {
+public:
+    static constexpr uint32_t MAGIC = 0x4b54525a; // "ZRTK"
+    static constexpr uint32_t MAX_SIZE = 1400;
+    static constexpr uint16_t DEFAULT_PORT = 5010;
+
+    enum Type : uint8_t {
+        BLOCK,
+        NAMES,
+    };
+
+    enum Transport : uint8_t {
+        PLAYING = 1,
+        STOPPED = 2,
+    };
+
+    struct Header {
+        uint32_t magic = MAGIC;
+        Type type;
+        uint8_t sections;
+        uint16_t reserved = 0;
+    };
+
+    // Followed by the ticks, notes and values of the block
+    struct Section {
+        uint32_t sequence;
+        uint16_t frames;
+        uint8_t transport;
+        uint8_t tickCount;
+        uint64_t frame;
+        uint8_t noteCount;
+        uint8_t valueCount;
+        uint16_t reserved = 0;
+    };
+
+    struct Tick {
+        uint16_t offset;
+        uint16_t reserved = 0;
+        uint32_t clock;
+    };
+
+    struct Note {
+        uint16_t offset;
+        uint8_t note;
+        uint8_t on;
+        float velocity;
+    };
+
+    struct Value {
+        uint8_t plugin;
+        uint8_t index;
+        uint16_t reserved = 0;
+        float value;
+    };
+
+    static constexpr uint32_t MAX_TICKS = 32;
+    static constexpr uint32_t MAX_NOTES = 32;
+    static constexpr uint32_t MAX_VALUES = 48;
+    static constexpr uint32_t MAX_SECTION = sizeof(Section) + MAX_TICKS * sizeof(Tick) + MAX_NOTES * sizeof(Note)
+        + MAX_VALUES * sizeof(Value);
+    static_assert(sizeof(Header) + MAX_SECTION <= MAX_SIZE, "A block must fit in a packet");
+
+    // Read the section at `data`, return its size, 0 if it does not fit in `size`
+    static uint32_t sectionSize(const uint8_t* data, uint32_t size)
+    {
+        if (size < sizeof(Section)) {
+            return 0;
+        }
+        Section section;
+        memcpy(&section, data, sizeof(Section));
+        uint32_t total = sizeof(Section) + section.tickCount * sizeof(Tick) + section.noteCount * sizeof(Note)
+            + section.valueCount * sizeof(Value);
+        return total <= size ? total : 0;
+    }
+};
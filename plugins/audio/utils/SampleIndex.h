@@ -0,0 +1,645 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cctype>
+#include <cmath>
+#include <cstdio>
+#include <filesystem>
+#include <map>
+#include <mutex>
+#include <poll.h>
+#include <sndfile.h>
+#include <string>
+#include <sys/inotify.h>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "audio/fileBrowser.h"
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+#include "log.h"
+
+// Index of the sample libraries, so browsing a folder of tens of thousands of files doesn't list it nor open its
+// files to know their length.
+//
+// Each library root has its index saved in the hidden file `.zpindex`, loaded when the root is first browsed. A
+// background thread then compares it with the folder, only probing the files added or modified since the index was
+// saved, and keeps it up to date while running by watching the folders with inotify.
+//
+// Besides the format of each file, the index has its peak level and the tempo and key written in its name (e.g.
+// `Loop_120bpm_Am.wav`), as the samples of the packs are mostly named this way. The files loaded by a plugin slicing
+// them also get their number of slices, and their tempo when their name has none, see SliceAnalyzer.
+class SampleIndex {
+public:
+    struct Entry {
+        // Relative to the library root
+        std::string path;
+        int64_t mtime = 0;
+        uint64_t size = 0;
+        uint32_t frames = 0;
+        uint32_t rate = 0;
+        uint8_t channels = 0;
+        float peak = 0.0f;
+        // 0 when the name doesn't have it
+        float bpm = 0.0f;
+        // 0 to 11 for C to B major, 12 to 23 for C to B minor, -1 when the name doesn't have it
+        int8_t key = -1;
+        // Slices found by SliceAnalyzer, 0 until the file is loaded by a plugin slicing it
+        uint16_t slices = 0;
+    };
+
+    // Unset fields match every file
+    struct Filter {
+        // Folder relative to the root, subfolders included
+        std::string folder;
+        // Start of the file name, case insensitive
+        std::string prefix;
+        uint8_t channels = 0;
+        float minSeconds = 0.0f;
+        float maxSeconds = 0.0f;
+        float minBpm = 0.0f;
+        float maxBpm = 0.0f;
+        int8_t key = -1;
+    };
+
+protected:
+    static const uint32_t MAGIC = 0x5a504958; // ZPIX
+    static const uint32_t VERSION = 2;
+
+    // Saved after the path of each entry
+    struct Record {
+        int64_t mtime;
+        uint64_t size;
+        uint32_t frames;
+        uint32_t rate;
+        float peak;
+        float bpm;
+        uint8_t channels;
+        int8_t key;
+        uint16_t slices;
+    };
+
+    struct Library {
+        std::string root;
+        // Sorted by path, guarded by the mutex of the index
+        std::vector<Entry> entries;
+        // Loaded from the saved index or scanned, until then the folders are listed from the disk
+        bool ready = false;
+        bool scanned = false;
+        bool dirty = false;
+        int inotifyFd = -1;
+        // Watch descriptor to the folder relative to the root
+        std::map<int, std::string> watches;
+    };
+
+    std::mutex mtx;
+    std::vector<Library*> libraries;
+    Worker worker { mtx, "sample_index", [this] { workerLoop(); } };
+
+    static bool isAudioFile(const std::filesystem::path& path)
+    {
+        std::string ext = path.extension().string();
+        std::transform(ext.begin(), ext.end(), ext.begin(), ::tolower);
+        return ext == ".wav" || ext == ".flac" || ext == ".ogg" || ext == ".aif" || ext == ".aiff" || ext == ".mp3";
+    }
+
+    static bool isHidden(const std::filesystem::path& path)
+    {
+        std::string name = path.filename().string();
+        return name.empty() || name[0] == '.';
+    }
+
+    static std::string lower(std::string value)
+    {
+        std::transform(value.begin(), value.end(), value.begin(), ::tolower);
+        return value;
+    }
+
+    static std::string parentOf(const std::string& path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? "" : path.substr(0, slash);
+    }
+
+    static std::string nameOf(const std::string& path)
+    {
+        size_t slash = path.find_last_of('/');
+        return slash == std::string::npos ? path : path.substr(slash + 1);
+    }
+
+    // Whether `path` is in `folder`, directly or in a subfolder when `recursive` is set
+    static bool isIn(const std::string& path, const std::string& folder, bool recursive)
+    {
+        if (!recursive) {
+            return parentOf(path) == folder;
+        }
+        return folder.empty() || (path.size() > folder.size() && path.compare(0, folder.size(), folder) == 0 && path[folder.size()] == '/');
+    }
+
+    static bool isNumber(const std::string& token)
+    {
+        return !token.empty() && std::all_of(token.begin(), token.end(), ::isdigit);
+    }
+
+    // Key of a token like `Am`, `C#min`, `Ebmaj` or `F#`, -1 if it is not one. A single letter is too ambiguous to
+    // be taken for a key, unless the previous token is `key`.
+    static int8_t parseKey(const std::string& token, bool afterKeyword)
+    {
+        static const int8_t notes[7] = { 9, 11, 0, 2, 4, 5, 7 }; // A to G
+        if (token.empty() || token[0] < 'A' || token[0] > 'G') {
+            return -1;
+        }
+        int8_t pitch = notes[token[0] - 'A'];
+        size_t pos = 1;
+        bool accidental = false;
+        if (pos < token.size() && (token[pos] == '#' || token[pos] == 'b')) {
+            pitch += token[pos] == '#' ? 1 : -1;
+            accidental = true;
+            pos++;
+        }
+        std::string mode = lower(token.substr(pos));
+        bool minor = mode == "m" || mode == "min" || mode == "minor";
+        bool major = mode == "maj" || mode == "major";
+        if (pos < token.size() && !minor && !major) {
+            return -1;
+        }
+        if (!accidental && !minor && !major && !afterKeyword) {
+            return -1;
+        }
+        return (pitch + 12) % 12 + (minor ? 12 : 0);
+    }
+
+    // Tempo and key from the tokens of the name: `120bpm`, `120 bpm`, or a bare number in the name of a loop
+    static void parseName(std::string name, float& bpm, int8_t& key)
+    {
+        bpm = 0.0f;
+        key = -1;
+        std::vector<std::string> tokens;
+        std::string token;
+        for (char c : name.substr(0, name.find_last_of('.'))) {
+            if (isalnum((unsigned char)c) || c == '#') {
+                token += c;
+            } else if (!token.empty()) {
+                tokens.push_back(token);
+                token.clear();
+            }
+        }
+        if (!token.empty()) {
+            tokens.push_back(token);
+        }
+
+        bool loop = false;
+        float bareNumber = 0.0f;
+        for (size_t i = 0; i < tokens.size(); i++) {
+            std::string low = lower(tokens[i]);
+            if (low == "loop" || low == "loops") {
+                loop = true;
+            }
+            if (low.size() > 3 && low.compare(low.size() - 3, 3, "bpm") == 0 && isNumber(low.substr(0, low.size() - 3))) {
+                bpm = atof(low.c_str());
+            } else if (low == "bpm" && i > 0 && isNumber(tokens[i - 1])) {
+                bpm = atof(tokens[i - 1].c_str());
+            } else if (isNumber(low) && bareNumber == 0.0f) {
+                float value = atof(low.c_str());
+                if (value >= 60.0f && value <= 200.0f) {
+                    bareNumber = value;
+                }
+            }
+            if (key < 0) {
+                key = parseKey(tokens[i], i > 0 && lower(tokens[i - 1]) == "key");
+            }
+        }
+        if (bpm == 0.0f && loop) {
+            bpm = bareNumber;
+        }
+        if (bpm < 20.0f || bpm > 400.0f) {
+            bpm = 0.0f;
+        }
+    }
+
+    // Read the whole file for its peak level, only done once per file as the index is saved
+    static bool probe(std::string path, Entry& entry)
+    {
+        SF_INFO sfinfo;
+        SNDFILE* file = sf_open(path.c_str(), SFM_READ, &sfinfo);
+        if (!file) {
+            logDebug("Sample index: could not open file %s [%s]\n", path.c_str(), sf_strerror(file));
+            return false;
+        }
+        entry.frames = sfinfo.frames;
+        entry.rate = sfinfo.samplerate;
+        entry.channels = std::max(sfinfo.channels, 1);
+        entry.peak = 0.0f;
+        std::vector<float> chunk(4096 * entry.channels);
+        sf_count_t read;
+        while ((read = sf_read_float(file, chunk.data(), chunk.size())) > 0) {
+            for (sf_count_t i = 0; i < read; i++) {
+                entry.peak = std::max(entry.peak, fabsf(chunk[i]));
+            }
+        }
+        sf_close(file);
+        parseName(nameOf(entry.path), entry.bpm, entry.key);
+        return true;
+    }
+
+    Library* findLibrary(const std::string& folder, std::string& relative)
+    {
+        for (Library* library : libraries) {
+            const std::string& root = library->root;
+            if (folder == root) {
+                relative = "";
+                return library;
+            }
+            if (folder.size() > root.size() && folder.compare(0, root.size(), root) == 0 && folder[root.size()] == '/') {
+                relative = folder.substr(root.size() + 1);
+                return library;
+            }
+        }
+        return NULL;
+    }
+
+    Entry* findEntry(std::vector<Entry>& entries, const std::string& path)
+    {
+        auto it = std::lower_bound(entries.begin(), entries.end(), path, [](const Entry& a, const std::string& b) { return a.path < b; });
+        return it != entries.end() && it->path == path ? &*it : NULL;
+    }
+
+    bool loadIndex(Library* library)
+    {
+        FILE* file = fopen((library->root + "/.zpindex").c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        uint32_t header[3];
+        bool ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == MAGIC && header[1] == VERSION;
+        std::vector<Entry> entries;
+        for (uint32_t i = 0; ok && i < header[2]; i++) {
+            uint16_t length;
+            Record record;
+            Entry entry;
+            ok = fread(&length, sizeof(length), 1, file) == 1;
+            if (ok) {
+                entry.path.resize(length);
+                ok = fread(entry.path.data(), 1, length, file) == length && fread(&record, sizeof(record), 1, file) == 1;
+            }
+            if (ok) {
+                entry.mtime = record.mtime;
+                entry.size = record.size;
+                entry.frames = record.frames;
+                entry.rate = record.rate;
+                entry.peak = record.peak;
+                entry.bpm = record.bpm;
+                entry.channels = record.channels;
+                entry.key = record.key;
+                entry.slices = record.slices;
+                entries.push_back(entry);
+            }
+        }
+        fclose(file);
+        if (!ok) {
+            logDebug("Sample index: ignore invalid index of %s\n", library->root.c_str());
+            return false;
+        }
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+        library->entries = entries;
+        return true;
+    }
+
+    // Written to a temporary file first, so a crash never leaves a truncated index. Skipped if the library is read only.
+    void saveIndex(Library* library)
+    {
+        std::vector<Entry> entries;
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            entries = library->entries;
+            library->dirty = false;
+        }
+        std::string path = library->root + "/.zpindex";
+        FILE* file = fopen((path + ".tmp").c_str(), "wb");
+        if (!file) {
+            return;
+        }
+        uint32_t header[3] = { MAGIC, VERSION, (uint32_t)entries.size() };
+        bool ok = fwrite(header, sizeof(header), 1, file) == 1;
+        for (Entry& entry : entries) {
+            uint16_t length = std::min<size_t>(entry.path.size(), UINT16_MAX);
+            Record record = { entry.mtime, entry.size, entry.frames, entry.rate, entry.peak, entry.bpm, entry.channels, entry.key, entry.slices };
+            ok = ok && fwrite(&length, sizeof(length), 1, file) == 1
+                && fwrite(entry.path.data(), 1, length, file) == length
+                && fwrite(&record, sizeof(record), 1, file) == 1;
+        }
+        ok = fclose(file) == 0 && ok;
+        if (!ok || rename((path + ".tmp").c_str(), path.c_str()) != 0) {
+            remove((path + ".tmp").c_str());
+        }
+    }
+
+    void watchFolder(Library* library, const std::string& relative)
+    {
+        std::string path = relative.empty() ? library->root : library->root + "/" + relative;
+        int wd = inotify_add_watch(library->inotifyFd, path.c_str(),
+            IN_CREATE | IN_DELETE | IN_CLOSE_WRITE | IN_MOVED_FROM | IN_MOVED_TO);
+        if (wd >= 0) {
+            library->watches[wd] = relative;
+        }
+    }
+
+    // Compare the entries of `folder` (and its subfolders when `recursive` is set) with the disk, probing only the
+    // new and modified files. New folders are watched.
+    void update(Library* library, const std::string& folder, bool recursive)
+    {
+        std::vector<Entry> previous;
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            for (Entry& entry : library->entries) {
+                if (isIn(entry.path, folder, recursive)) {
+                    previous.push_back(entry);
+                }
+            }
+        }
+
+        std::vector<Entry> found;
+        std::vector<std::string> pending = { folder };
+        bool changed = false;
+        while (!pending.empty() && worker.isRunning()) {
+            std::string relative = pending.back();
+            pending.pop_back();
+            std::error_code error;
+            std::filesystem::path path = relative.empty() ? library->root : library->root + "/" + relative;
+            for (const auto& item : std::filesystem::directory_iterator(path, error)) {
+                if (isHidden(item.path())) {
+                    continue;
+                }
+                std::string name = relative.empty() ? item.path().filename().string() : relative + "/" + item.path().filename().string();
+                if (item.is_directory(error)) {
+                    if (recursive) {
+                        pending.push_back(name);
+                        if (library->inotifyFd >= 0) {
+                            watchFolder(library, name);
+                        }
+                    }
+                    continue;
+                }
+                struct stat info;
+                if (!isAudioFile(item.path()) || stat(item.path().c_str(), &info) != 0) {
+                    continue;
+                }
+                Entry* known = findEntry(previous, name);
+                if (known && known->mtime == (int64_t)info.st_mtime && known->size == (uint64_t)info.st_size) {
+                    found.push_back(*known);
+                    continue;
+                }
+                Entry entry;
+                entry.path = name;
+                entry.mtime = info.st_mtime;
+                entry.size = info.st_size;
+                if (probe(item.path(), entry)) {
+                    found.push_back(entry);
+                    changed = true;
+                }
+            }
+        }
+        if (!worker.isRunning()) {
+            return;
+        }
+
+        changed = changed || found.size() != previous.size();
+        if (!changed) {
+            return;
+        }
+        std::lock_guard<std::mutex> guard(mtx);
+        std::vector<Entry>& entries = library->entries;
+        entries.erase(std::remove_if(entries.begin(), entries.end(), [&](const Entry& entry) { return isIn(entry.path, folder, recursive); }), entries.end());
+        entries.insert(entries.end(), found.begin(), found.end());
+        std::sort(entries.begin(), entries.end(), [](const Entry& a, const Entry& b) { return a.path < b.path; });
+        library->dirty = true;
+    }
+
+    // Folders to update from the pending inotify events of the library, true if the folder and its subfolders
+    void readEvents(Library* library, std::map<std::string, bool>& folders)
+    {
+        char buffer[4096] __attribute__((aligned(__alignof__(struct inotify_event))));
+        ssize_t length;
+        while ((length = read(library->inotifyFd, buffer, sizeof(buffer))) > 0) {
+            for (char* ptr = buffer; ptr < buffer + length;) {
+                struct inotify_event* event = (struct inotify_event*)ptr;
+                ptr += sizeof(struct inotify_event) + event->len;
+                if (event->mask & IN_Q_OVERFLOW) {
+                    folders[""] = true;
+                    continue;
+                }
+                auto watch = library->watches.find(event->wd);
+                if (watch == library->watches.end()) {
+                    continue;
+                }
+                if (event->mask & IN_IGNORED) {
+                    library->watches.erase(watch);
+                    continue;
+                }
+                if (event->len == 0 || event->name[0] == '.') {
+                    continue;
+                }
+                if (event->mask & IN_ISDIR) {
+                    std::string folder = watch->second.empty() ? event->name : watch->second + "/" + event->name;
+                    folders[folder] = true;
+                } else if (!folders.count(watch->second)) {
+                    folders[watch->second] = false;
+                }
+            }
+        }
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            Library* library = NULL;
+            for (Library* lib : libraries) {
+                if (!lib->scanned) {
+                    library = lib;
+                    break;
+                }
+            }
+            if (library) {
+                lock.unlock();
+                library->inotifyFd = inotify_init1(IN_NONBLOCK);
+                if (library->inotifyFd >= 0) {
+                    watchFolder(library, "");
+                }
+                update(library, "", true);
+                lock.lock();
+                library->scanned = true;
+                library->ready = true;
+                logDebug("Sample index: %s scanned, %ld files\n", library->root.c_str(), (long)library->entries.size());
+                lock.unlock();
+                saveIndex(library);
+                lock.lock();
+                continue;
+            }
+
+            std::vector<Library*> watched = libraries;
+            lock.unlock();
+            std::vector<struct pollfd> fds;
+            for (Library* lib : watched) {
+                fds.push_back({ lib->inotifyFd, POLLIN, 0 });
+            }
+            if (poll(fds.data(), fds.size(), 500) > 0) {
+                // Let a copy of many files end before updating the folders
+                std::this_thread::sleep_for(std::chrono::milliseconds(200));
+                for (size_t i = 0; i < watched.size(); i++) {
+                    if (fds[i].fd < 0 || !(fds[i].revents & POLLIN)) {
+                        continue;
+                    }
+                    std::map<std::string, bool> folders;
+                    readEvents(watched[i], folders);
+                    for (auto& [folder, recursive] : folders) {
+                        update(watched[i], folder, recursive);
+                    }
+                }
+            }
+            // Changed by the events, or by the analysis of the files
+            for (Library* lib : watched) {
+                if (lib->dirty) {
+                    saveIndex(lib);
+                }
+            }
+            lock.lock();
+        }
+    }
+
+public:
+    static SampleIndex& get()
+    {
+        return processSingleton<SampleIndex>();
+    }
+
+    ~SampleIndex()
+    {
+        worker.stop();
+        for (Library* library : libraries) {
+            if (library->inotifyFd >= 0) {
+                close(library->inotifyFd);
+            }
+            delete library;
+        }
+    }
+
+    // Index the library `root`, loading its saved index right away and scanning it in the background
+    void watch(std::string root)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        std::string relative;
+        if (findLibrary(root, relative)) {
+            return;
+        }
+        Library* library = new Library();
+        library->root = root;
+        library->ready = loadIndex(library);
+        libraries.push_back(library);
+        worker.wake();
+    }
+
+    // Audio files directly in `folder`, sorted by name, false if the folder is not in an indexed library yet
+    bool list(std::string folder, std::vector<std::filesystem::path>& files)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        std::string relative;
+        Library* library = findLibrary(folder, relative);
+        if (!library || !library->ready) {
+            return false;
+        }
+        files.clear();
+        for (Entry& entry : library->entries) {
+            if (isIn(entry.path, relative, false)) {
+                files.push_back(library->root + "/" + entry.path);
+            }
+        }
+        return true;
+    }
+
+    // Browser of the files of `folder`, from the index when it is ready, else from the disk
+    FileBrowser browser(std::string folder)
+    {
+        watch(folder);
+        FileBrowser fileBrowser;
+        std::vector<std::filesystem::path> files;
+        if (list(folder, files)) {
+            fileBrowser.setFiles(folder, files);
+        } else {
+            fileBrowser.openFolder(folder);
+        }
+        return fileBrowser;
+    }
+
+    // Entries of the library `root` matching `filter`, sorted by path
+    std::vector<Entry> search(std::string root, Filter filter)
+    {
+        std::vector<Entry> result;
+        std::lock_guard<std::mutex> guard(mtx);
+        std::string relative;
+        Library* library = findLibrary(root, relative);
+        if (!library) {
+            return result;
+        }
+        std::string prefix = lower(filter.prefix);
+        for (Entry& entry : library->entries) {
+            float seconds = entry.rate ? (float)entry.frames / entry.rate : 0.0f;
+            if ((!filter.folder.empty() && !isIn(entry.path, filter.folder, true))
+                || (!prefix.empty() && lower(nameOf(entry.path)).compare(0, prefix.size(), prefix) != 0)
+                || (filter.channels && entry.channels != filter.channels)
+                || (filter.minSeconds > 0.0f && seconds < filter.minSeconds)
+                || (filter.maxSeconds > 0.0f && seconds > filter.maxSeconds)
+                || (filter.minBpm > 0.0f && entry.bpm < filter.minBpm)
+                || (filter.maxBpm > 0.0f && (entry.bpm == 0.0f || entry.bpm > filter.maxBpm))
+                || (filter.key >= 0 && entry.key != filter.key)) {
+                continue;
+            }
+            result.push_back(entry);
+        }
+        return result;
+    }
+
+    // Entry of the file `path`, false if it is not indexed
+    bool info(std::string path, Entry& out)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        std::string relative;
+        Library* library = findLibrary(path, relative);
+        Entry* entry = library ? findEntry(library->entries, relative) : NULL;
+        if (entry) {
+            out = *entry;
+        }
+        return entry != NULL;
+    }
+
+    // Result of the analysis of the file `path` by SliceAnalyzer: its number of slices, and its tempo, kept for the
+    // files without tempo in their name. Saved with the index.
+    void setAnalysis(std::string path, float bpm, uint16_t slices)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        std::string relative;
+        Library* library = findLibrary(path, relative);
+        Entry* entry = library && library->ready ? findEntry(library->entries, relative) : NULL;
+        if (!entry || (entry->slices == slices && (entry->bpm > 0.0f || bpm == 0.0f))) {
+            return;
+        }
+        entry->slices = slices;
+        if (entry->bpm == 0.0f) {
+            entry->bpm = bpm;
+        }
+        library->dirty = true;
+    }
+
+    // Name of a key of the index, e.g. `C#m`, empty when unknown
+    static std::string keyName(int8_t key)
+    {
+        static const char* notes[12] = { "C", "C#", "D", "D#", "E", "F", "F#", "G", "G#", "A", "A#", "B" };
+        if (key < 0 || key > 23) {
+            return "";
+        }
+        return std::string(notes[key % 12]) + (key >= 12 ? "m" : "");
+    }
+};
@@ -0,0 +1,240 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "audio/utils/float4.h"
+
+// Reading a sample between its frames, for the pitched playback of the sample players. The players keep their
+// position in interleaved samples, `stride` being the channels of the file: the kernels read its first channel.
+//
+// - `NEAREST` the sample under the position, like the players did before, the cheapest and the most aliased
+// - `LINEAR` between the 2 closest frames, the default
+// - `CUBIC` Hermite (Catmull-Rom) over 4 frames, much less high frequency loss than linear
+// - `SINC` 8 frames windowed sinc (Blackman), its cutoff following the pitch up to 2 octaves up, so a sample
+//   played higher doesn't alias
+//
+// `at()` reads a single position, `render()` a run of positions for a whole block: 4 frames at once with SSE2 or
+// NEON (see float4.h) for linear and cubic, the 8 taps of the sinc at once. The frames read out of the sample repeat
+// its first or last frame. `Source` is anything indexed by sample, e.g. `const float*` or `SampleView`.
+class SampleInterpolation {
+public:
+    enum Kernel {
+        NEAREST,
+        LINEAR,
+        CUBIC,
+        SINC,
+    };
+
+    static Kernel getKernel(std::string name, Kernel fallback = LINEAR)
+    {
+        return name == "nearest" ? NEAREST : name == "linear" ? LINEAR : name == "cubic" ? CUBIC : name == "sinc" ? SINC : fallback;
+    }
+
+    static const uint32_t SINC_TAPS = 8;
+    static const uint32_t SINC_PHASES = 64;
+    // Quarter of an octave between two cutoffs, up to 2 octaves
+    static const uint32_t SINC_BANDS = 9;
+
+protected:
+    Kernel kernel = LINEAR;
+    // Coefficients of the band used for the current step
+    const float* sinc = NULL;
+
+    // (SINC_PHASES + 1) * SINC_TAPS coefficients per band, each phase summing to 1
+    static const std::vector<float>& sincTables()
+    {
+        static std::vector<float> tables = [] {
+            std::vector<float> t(SINC_BANDS * (SINC_PHASES + 1) * SINC_TAPS);
+            for (uint32_t b = 0; b < SINC_BANDS; b++) {
+                // At the pitch of the file, the taps at a whole frame are 0 but the one under it
+                double cutoff = 1.0 / std::pow(2.0, b / 4.0);
+                for (uint32_t p = 0; p <= SINC_PHASES; p++) {
+                    float* row = &t[(b * (SINC_PHASES + 1) + p) * SINC_TAPS];
+                    double sum = 0.0;
+                    for (uint32_t j = 0; j < SINC_TAPS; j++) {
+                        // Distance from the position to the tap, the taps starting 3 frames before it
+                        double d = (double)j - 3.0 - (double)p / SINC_PHASES;
+                        double x = M_PI * cutoff * d;
+                        double s = d == 0.0 ? 1.0 : std::sin(x) / x;
+                        double w = std::fabs(d) >= SINC_TAPS / 2 ? 0.0
+                                                                 : 0.42 + 0.5 * std::cos(M_PI * d / (SINC_TAPS / 2)) + 0.08 * std::cos(2.0 * M_PI * d / (SINC_TAPS / 2));
+                        row[j] = s * w;
+                        sum += row[j];
+                    }
+                    for (uint32_t j = 0; j < SINC_TAPS; j++) {
+                        row[j] /= sum;
+                    }
+                }
+            }
+            return t;
+        }();
+        return tables;
+    }
+
+    // Frames read before and after the frame under the position
+    uint32_t tapsBefore() const
+    {
+        return kernel == SINC ? 3 : kernel == CUBIC ? 1 : 0;
+    }
+
+    uint32_t tapsAfter() const
+    {
+        return kernel == SINC ? 4 : kernel == CUBIC ? 2 : kernel == LINEAR ? 1 : 0;
+    }
+
+    static float cubic(float x0, float x1, float x2, float x3, float t)
+    {
+        float c1 = 0.5f * (x2 - x0);
+        float c2 = x0 - 2.5f * x1 + 2.0f * x2 - 0.5f * x3;
+        float c3 = 0.5f * (x3 - x0) + 1.5f * (x1 - x2);
+        return ((c3 * t + c2) * t + c1) * t + x1;
+    }
+
+    // Dot product of the taps with the phase under `t`, linearly interpolated with the next phase
+    float sincDot(const float* taps, float t) const
+    {
+        float phase = t * SINC_PHASES;
+        uint32_t p = std::min((uint32_t)phase, SINC_PHASES - 1);
+        float f = phase - p;
+        const float* a = sinc + p * SINC_TAPS;
+        const float* b = a + SINC_TAPS;
+        float4::v4 total = float4::set(0.0f);
+        for (uint32_t j = 0; j < SINC_TAPS; j += float4::WIDTH) {
+            float4::v4 ca = float4::load(a + j);
+            float4::v4 c = float4::add(ca, float4::mul(float4::set(f), float4::sub(float4::load(b + j), ca)));
+            total = float4::add(total, float4::mul(c, float4::load(taps + j)));
+        }
+        return float4::sum(total);
+    }
+
+    template <typename Source>
+    static float frame(const Source& samples, int64_t i, int64_t frames, uint8_t stride)
+    {
+        return samples[std::clamp<int64_t>(i, 0, frames - 1) * stride];
+    }
+
+public:
+    SampleInterpolation()
+    {
+        setStep(1.0f);
+    }
+
+    // The sinc tables are built the first time, so set it from the config, not from the audio thread
+    void setKernel(Kernel value)
+    {
+        kernel = value;
+        if (kernel == SINC) {
+            sincTables();
+        }
+    }
+
+    Kernel getKernel() const
+    {
+        return kernel;
+    }
+
+    // Frames of the sample per output frame, e.g. on note on, for the sinc to cut the frequencies that would alias
+    void setStep(float framesPerOutput)
+    {
+        uint32_t band = framesPerOutput <= 1.0f ? 0 : std::min<uint32_t>(std::ceil(4.0f * std::log2(framesPerOutput)), SINC_BANDS - 1);
+        sinc = sincTables().data() + band * (SINC_PHASES + 1) * SINC_TAPS;
+    }
+
+    // Sample at `position`, in interleaved samples, `count` being the interleaved samples of the file
+    template <typename Source>
+    float at(const Source& samples, uint64_t count, uint8_t stride, float position) const
+    {
+        if (kernel == NEAREST) {
+            return samples[(uint64_t)position];
+        }
+        int64_t frames = count / stride;
+        if (frames == 0) {
+            return 0.0f;
+        }
+        float fp = position / stride;
+        int64_t i = (int64_t)fp;
+        float t = fp - i;
+        if (kernel == LINEAR) {
+            float a = frame(samples, i, frames, stride);
+            return a + t * (frame(samples, i + 1, frames, stride) - a);
+        }
+        if (kernel == CUBIC) {
+            return cubic(frame(samples, i - 1, frames, stride), frame(samples, i, frames, stride),
+                frame(samples, i + 1, frames, stride), frame(samples, i + 2, frames, stride), t);
+        }
+        float taps[SINC_TAPS];
+        for (uint32_t j = 0; j < SINC_TAPS; j++) {
+            taps[j] = frame(samples, i - 3 + j, frames, stride);
+        }
+        return sincDot(taps, t);
+    }
+
+    // Write `frames` samples times `gain` to `out`, every `outStride` floats, starting at `position` and moving by
+    // `step`. Return the position after the last frame, e.g. for the index of the player.
+    template <typename Source>
+    float render(const Source& samples, uint64_t count, uint8_t stride, float position, float step, float gain, float* out, uint32_t outStride, uint32_t frames) const
+    {
+        int64_t firstFrame = (int64_t)(std::min(position, position + step * frames) / stride) - tapsBefore();
+        int64_t lastFrame = (int64_t)(std::max(position, position + step * frames) / stride) + 1 + tapsAfter();
+        uint32_t n = 0;
+        // In the middle of the sample, the taps need no clamping
+        if (kernel != NEAREST && firstFrame >= 0 && lastFrame < (int64_t)(count / stride)) {
+            float invStride = 1.0f / stride;
+            if (kernel == SINC) {
+                float taps[SINC_TAPS];
+                for (; n < frames; n++) {
+                    float fp = (position + step * n) * invStride;
+                    int64_t i = (int64_t)fp;
+                    for (uint32_t j = 0; j < SINC_TAPS; j++) {
+                        taps[j] = samples[(i - 3 + j) * stride];
+                    }
+                    out[n * outStride] = sincDot(taps, fp - i) * gain;
+                }
+            } else {
+                float lanes[float4::WIDTH];
+                for (int k = 0; k < float4::WIDTH; k++) {
+                    lanes[k] = k;
+                }
+                float4::v4 lane = float4::load(lanes);
+                int32_t index[float4::WIDTH];
+                float x0[float4::WIDTH], x1[float4::WIDTH], x2[float4::WIDTH], x3[float4::WIDTH];
+                for (; n + float4::WIDTH <= frames; n += float4::WIDTH) {
+                    float4::v4 fp = float4::mul(float4::add(float4::set(position + step * n), float4::mul(lane, float4::set(step))), float4::set(invStride));
+                    float4::v4 fl = float4::floor(fp);
+                    float4::v4 t = float4::sub(fp, fl);
+                    float4::toIndex(fl, index);
+                    float4::v4 y;
+                    if (kernel == LINEAR) {
+                        for (int k = 0; k < float4::WIDTH; k++) {
+                            x1[k] = samples[(int64_t)index[k] * stride];
+                            x2[k] = samples[((int64_t)index[k] + 1) * stride];
+                        }
+                        float4::v4 a = float4::load(x1);
+                        y = float4::add(a, float4::mul(t, float4::sub(float4::load(x2), a)));
+                    } else {
+                        for (int k = 0; k < float4::WIDTH; k++) {
+                            x0[k] = samples[((int64_t)index[k] - 1) * stride];
+                            x1[k] = samples[(int64_t)index[k] * stride];
+                            x2[k] = samples[((int64_t)index[k] + 1) * stride];
+                            x3[k] = samples[((int64_t)index[k] + 2) * stride];
+                        }
+                        float4::v4 a = float4::load(x0), b = float4::load(x1), c = float4::load(x2), d = float4::load(x3);
+                        float4::v4 c1 = float4::mul(float4::set(0.5f), float4::sub(c, a));
+                        float4::v4 c2 = float4::sub(float4::add(a, float4::mul(float4::set(2.0f), c)), float4::add(float4::mul(float4::set(2.5f), b), float4::mul(float4::set(0.5f), d)));
+                        float4::v4 c3 = float4::add(float4::mul(float4::set(0.5f), float4::sub(d, a)), float4::mul(float4::set(1.5f), float4::sub(b, c)));
+                        y = float4::add(float4::mul(float4::add(float4::mul(float4::add(float4::mul(c3, t), c2), t), c1), t), b);
+                    }
+                    float4::store(out + n * outStride, outStride, float4::mul(y, float4::set(gain)));
+                }
+            }
+        }
+        for (; n < frames; n++) {
+            out[n * outStride] = at(samples, count, stride, position + step * n) * gain;
+        }
+        return position + step * frames;
+    }
+};
@@ -0,0 +1,243 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <vector>
+
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+#include "helpers/trace.h"
+#include "plugins/audio/utils/SamplePool.h"
+
+// Sample files decoded by a background thread, so browsing samples while playing never blocks the thread changing
+// the value, the audio thread once the plugin is active.
+//
+// Each plugin owns a `SampleLoader::Slot`:
+// - `load()` queues the file, the worker getting it from the `SamplePool`, decoding it only the first time
+// - `swap()`, called by the audio thread at a block boundary, switches to the new buffer without waiting
+// - the previous buffer is released by the worker, once the audio thread doesn't use it anymore.
+// A buffer already decoded, e.g. prefetched, is switched to with `set()`, without going through the worker.
+// When called outside of the audio thread (e.g. while the plugin is created), `load()` decodes the file right away.
+class SampleLoader {
+public:
+    // Buffer of the pool played by a slot, deleting it releasing the buffer. Without buffer, the slot plays nothing.
+    struct Sample {
+        SamplePool::Ref buffer;
+        // NULL when the buffer is compact, see SamplePool::Storage
+        const float* data;
+        const int16_t* compact;
+        // Interleaved samples, not frames
+        uint64_t count;
+        uint8_t channels;
+        const WaveformOverview* overview;
+
+        Sample(SamplePool::Ref buffer)
+            : buffer(buffer)
+            , data(buffer ? buffer->samples : NULL)
+            , compact(buffer && !buffer->compact.empty() ? buffer->compact.data() : NULL)
+            , count(buffer ? buffer->count : 0)
+            , channels(buffer ? buffer->channels : 1)
+            , overview(buffer ? &buffer->overview : NULL)
+        {
+        }
+    };
+
+    class Slot {
+    protected:
+        friend class SampleLoader;
+
+        float sampleRate;
+        uint64_t maxSamples;
+        bool normalize;
+        SamplePool::Storage storage;
+
+        // Guarded by the mutex of the loader
+        std::string pendingPath;
+
+        Sample* current = NULL;
+        // Decoded, waiting for the audio thread to take it
+        std::atomic<Sample*> ready = NULL;
+        // Replaced by the audio thread, waiting for the worker to delete it
+        std::atomic<Sample*> retired = NULL;
+        std::chrono::steady_clock::time_point retiredAt;
+
+    public:
+        // `maxSamples` interleaved samples at most are kept, after the conversion to `sampleRate`. A player reading
+        // compact samples (see SampleView) asks for `SamplePool::AUTO` or `SamplePool::COMPACT`.
+        Slot(float sampleRate, uint64_t maxSamples, bool normalize = true, SamplePool::Storage storage = SamplePool::FLOAT)
+            : sampleRate(sampleRate)
+            , maxSamples(maxSamples)
+            , normalize(normalize)
+            , storage(storage)
+        {
+        }
+
+        // For the files loaded from now on, e.g. from the config of the plugin
+        void setStorage(SamplePool::Storage value)
+        {
+            storage = value;
+        }
+
+        ~Slot()
+        {
+            SampleLoader::get().cancel(this);
+            delete current;
+            delete ready.load();
+            delete retired.load();
+        }
+
+        // Load the file in the background, or right away when `now` is set, e.g. when the audio thread is not
+        // running the plugin yet
+        void load(std::string path, bool now = false)
+        {
+            if (now) {
+                Sample* sample = SampleLoader::decode(path, sampleRate, maxSamples, normalize, storage);
+                if (sample) {
+                    delete ready.exchange(NULL);
+                    delete current;
+                    current = sample;
+                }
+                return;
+            }
+            SampleLoader::get().request(this, path);
+        }
+
+        // Switch to a buffer already decoded, or to none when NULL, on the next `swap()`, dropping the file being
+        // loaded if any. Never decodes.
+        void set(SamplePool::Ref buffer)
+        {
+            SampleLoader::get().set(this, buffer);
+        }
+
+        // Switch to the last loaded sample if any, return true when it changed. Never waits, for the audio thread.
+        bool swap()
+        {
+            // The previous one is not deleted yet, switch on a later block
+            if (!ready.load(std::memory_order_acquire) || retired.load(std::memory_order_acquire)) {
+                return false;
+            }
+            Sample* next = ready.exchange(NULL, std::memory_order_acq_rel);
+            retiredAt = std::chrono::steady_clock::now();
+            retired.store(current, std::memory_order_release);
+            current = next;
+            return true;
+        }
+
+        // Sample played by the audio thread, NULL until a file was loaded
+        Sample* get()
+        {
+            return current;
+        }
+    };
+
+protected:
+    std::mutex mtx;
+    // Signaled each time a file is decoded, for `cancel()` to wait on the one being decoded
+    std::condition_variable doneCv;
+    std::deque<Slot*> queue;
+    std::vector<Slot*> slots;
+    Slot* decoding = NULL;
+    Worker worker { mtx, "sample_loader", [this] { workerLoop(); } };
+
+    // Buffers replaced by the audio thread are held a bit longer, the UI drawing the waveform possibly still
+    // reading them
+    static constexpr std::chrono::milliseconds RETIRE_DELAY = std::chrono::milliseconds(200);
+
+    static Sample* decode(std::string path, float sampleRate, uint64_t maxSamples, bool normalize, SamplePool::Storage storage)
+    {
+        TraceSpan span("sampleLoad");
+        SamplePool::Ref buffer = SamplePool::get().acquire(path, sampleRate, maxSamples, normalize, storage);
+        return buffer ? new Sample(buffer) : NULL;
+    }
+
+    void purge()
+    {
+        auto now = std::chrono::steady_clock::now();
+        for (Slot* slot : slots) {
+            Sample* old = slot->retired.load(std::memory_order_acquire);
+            if (old && now - slot->retiredAt >= RETIRE_DELAY) {
+                delete old;
+                slot->retired.store(NULL, std::memory_order_release);
+            }
+        }
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            worker.cv.wait_for(lock, std::chrono::milliseconds(100), [&] { return !worker.isRunning() || !queue.empty(); });
+            purge();
+            if (!worker.isRunning() || queue.empty()) {
+                continue;
+            }
+            Slot* slot = queue.front();
+            queue.pop_front();
+            std::string path = slot->pendingPath;
+            decoding = slot;
+            lock.unlock();
+            Sample* sample = decode(path, slot->sampleRate, slot->maxSamples, slot->normalize, slot->storage);
+            lock.lock();
+            if (sample && slot->pendingPath == path) {
+                // A file decoded earlier but never taken is replaced
+                delete slot->ready.exchange(sample, std::memory_order_acq_rel);
+            } else {
+                // Another buffer was set meanwhile
+                delete sample;
+            }
+            decoding = NULL;
+            doneCv.notify_all();
+        }
+    }
+
+    void request(Slot* slot, std::string path)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        slot->pendingPath = path;
+        // Browsing quickly only decodes the last file
+        if (std::find(queue.begin(), queue.end(), slot) == queue.end()) {
+            queue.push_back(slot);
+        }
+        start(slot);
+        worker.cv.notify_one();
+    }
+
+    void set(Slot* slot, SamplePool::Ref buffer)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        slot->pendingPath.clear();
+        queue.erase(std::remove(queue.begin(), queue.end(), slot), queue.end());
+        // Registered for the worker to release the buffer it replaces
+        start(slot);
+        delete slot->ready.exchange(new Sample(buffer), std::memory_order_acq_rel);
+    }
+
+    // With the lock held
+    void start(Slot* slot)
+    {
+        if (std::find(slots.begin(), slots.end(), slot) == slots.end()) {
+            slots.push_back(slot);
+        }
+        worker.start();
+    }
+
+    // Forget the slot and wait for its file to be decoded if it is being decoded, before the slot is destroyed
+    void cancel(Slot* slot)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        queue.erase(std::remove(queue.begin(), queue.end(), slot), queue.end());
+        slots.erase(std::remove(slots.begin(), slots.end(), slot), slots.end());
+        doneCv.wait(lock, [&] { return decoding != slot; });
+    }
+
+public:
+    static SampleLoader& get()
+    {
+        return processSingleton<SampleLoader>();
+    }
+};
@@ -0,0 +1,345 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdlib>
+#include <functional>
+#include <memory>
+#include <mutex>
+#ifndef SKIP_SNDFILE
+#include <sndfile.h>
+#endif
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "audio/utils/Resampler.h"
+#include "audio/utils/WaveformOverview.h"
+#include "audio/utils/applySampleGain.h"
+#include "helpers/processSingleton.h"
+#include "log.h"
+#include "plugins/audio/utils/MemoryBudget.h"
+#include "plugins/audio/utils/WavFile.h"
+
+// Decoded sample files shared by all the plugins and tracks of the process, so a kit used by several tracks is only
+// read and stored once, and reloading a workspace doesn't decode its samples again.
+//
+// A buffer is identified by the path and modification time of the file, and by how it was converted (engine rate,
+// maximum length, normalization), as it is never modified once decoded. `acquire()` hands out a reference counted
+// buffer, kept alive as long as a plugin holds it. Once the buffers take more than the memory cap, the least
+// recently acquired ones held by no plugin anymore are dropped. The cap is set with the environment variable
+// `SAMPLE_POOL_MB`, 256 MB by default. The same buffers are dropped earlier when the caches of the process take more
+// than their budget, see MemoryBudget.
+//
+// Each buffer comes with its waveform overview, saved in a hidden file next to the sample so it is only computed once.
+//
+// WAV files are read without libsndfile, see WavFile: a float file at the engine rate, not needing any gain to be
+// normalized, is played in place from its memory mapping, shared with the page cache and not counted in the cap. The
+// other WAV files are converted from their mapping, and libsndfile reads the other formats (unless the build has
+// `SKIP_SNDFILE`).
+//
+// A buffer can be stored as 16 bits integers instead of float, half the memory, the players converting each sample
+// they fetch (see SampleView): always for `Storage::COMPACT`, and for `Storage::AUTO` once the pool takes more than the
+// budget set with the environment variable `SAMPLE_POOL_COMPACT_MB` (disabled by default). A buffer played in place
+// from its mapping stays as it is, as it takes no heap memory. Players that can't read compact samples ask for
+// `Storage::FLOAT`, the default, and never share a compact buffer.
+//
+// Decoding reads the whole file, so never acquire a buffer from the audio thread, see `SampleLoader`.
+class SamplePool {
+public:
+    enum Storage {
+        FLOAT,
+        COMPACT,
+        AUTO,
+    };
+
+    struct Buffer {
+        std::string path;
+        // Interleaved samples, in `data` or in the mapping of the file, NULL when stored in `compact`
+        const float* samples = NULL;
+        std::vector<float> data;
+        // Interleaved samples scaled to 16 bits, for the compact storage
+        std::vector<int16_t> compact;
+        // Interleaved samples, not frames
+        uint64_t count = 0;
+        uint8_t channels = 1;
+        // To draw the waveform without reading the samples
+        WaveformOverview overview;
+        void* mapping = NULL;
+        size_t mappingSize = 0;
+
+        ~Buffer()
+        {
+            WavFile::unmap(mapping, mappingSize);
+        }
+    };
+
+    typedef std::shared_ptr<const Buffer> Ref;
+
+protected:
+    struct Entry {
+        std::string key;
+        Ref buffer;
+        uint64_t lastUse;
+    };
+
+    std::mutex mtx;
+    std::vector<Entry> entries;
+    uint64_t useCounter = 0;
+    size_t memory = 0;
+    size_t memoryCap = 256 * 1024 * 1024;
+    // Above it, the buffers asked with `Storage::AUTO` are compact, 0 to disable
+    size_t compactAbove = 0;
+
+    static std::string makeKey(std::string path, float sampleRate, uint64_t maxSamples, bool normalize)
+    {
+        struct stat info;
+        long mtime = stat(path.c_str(), &info) == 0 ? (long)info.st_mtime : 0;
+        return path + "|" + std::to_string(mtime) + "|" + std::to_string((int)sampleRate) + "|"
+            + std::to_string(maxSamples) + "|" + (normalize ? "n" : "r");
+    }
+
+    // Hidden file next to the sample, so the file browsers don't list it
+    static std::string overviewPath(std::string path)
+    {
+        size_t slash = path.find_last_of('/');
+        size_t name = slash == std::string::npos ? 0 : slash + 1;
+        return path.substr(0, name) + "." + path.substr(name) + ".peaks";
+    }
+
+    // Samples a normalization would not change, within 0.01 dB
+    static bool isNormalized(const float* samples, uint64_t count)
+    {
+        float max = 0.0f;
+        for (uint64_t i = 0; i < count; i++) {
+            max = std::max(max, std::fabs(samples[i]));
+        }
+        return std::fabs(max - 1.0f) < 0.001f;
+    }
+
+    static Buffer* newBuffer(std::string path, uint8_t channels, uint64_t samples, uint32_t fileRate, float sampleRate, uint64_t maxSamples, uint64_t& capacity)
+    {
+        Buffer* buffer = new Buffer();
+        buffer->path = path;
+        buffer->channels = std::max<uint8_t>(channels, 1);
+        capacity = std::min<uint64_t>(samples * sampleRate / std::max<uint32_t>(fileRate, 1) + buffer->channels, maxSamples);
+        buffer->data.resize(std::max(samples, capacity));
+        return buffer;
+    }
+
+    // Converted once to the engine rate, so the sample plays at its pitch
+    static void convert(Buffer* buffer, uint32_t fileRate, float sampleRate, uint64_t capacity, bool normalize)
+    {
+        buffer->count = Resampler::convert(buffer->data.data(), buffer->count, buffer->channels, fileRate, sampleRate, capacity);
+        buffer->data.resize(buffer->count);
+        buffer->data.shrink_to_fit();
+        if (normalize) {
+            applySampleGain(buffer->data.data(), buffer->count);
+        }
+        buffer->samples = buffer->data.data();
+    }
+
+    // Rounded to the nearest step, clipped to the 16 bits range
+    static void compact(Buffer* buffer)
+    {
+        buffer->compact.resize(buffer->count);
+        const float* in = buffer->data.data();
+        int16_t* out = buffer->compact.data();
+        for (uint64_t i = 0; i < buffer->count; i++) {
+            float value = std::clamp(in[i], -1.0f, 32767.0f / 32768.0f) * 32768.0f;
+            out[i] = (int16_t)(value + (value < 0.0f ? -0.5f : 0.5f));
+        }
+        buffer->data = std::vector<float>();
+        buffer->samples = NULL;
+    }
+
+    static Buffer* decodeWav(std::string path, float sampleRate, uint64_t maxSamples, bool normalize)
+    {
+        WavFile wav;
+        if (!wav.open(path)) {
+            return NULL;
+        }
+        logTrace("WAV file %s sampleCount %ld sampleRate %d", path.c_str(), (long)(wav.count / wav.channels), wav.sampleRate);
+        uint64_t samples = std::min<uint64_t>(wav.count, maxSamples);
+        const float* floats = wav.floats();
+        if (floats && wav.sampleRate == (uint32_t)sampleRate && (!normalize || isNormalized(floats, samples))) {
+            Buffer* buffer = new Buffer();
+            buffer->path = path;
+            buffer->channels = wav.channels;
+            buffer->samples = floats;
+            buffer->count = samples;
+            buffer->mapping = wav.release(buffer->mappingSize);
+            return buffer;
+        }
+        uint64_t capacity;
+        Buffer* buffer = newBuffer(path, wav.channels, samples, wav.sampleRate, sampleRate, maxSamples, capacity);
+        buffer->count = wav.read(buffer->data.data(), samples);
+        convert(buffer, wav.sampleRate, sampleRate, capacity, normalize);
+        return buffer;
+    }
+
+#ifndef SKIP_SNDFILE
+    static Buffer* decodeSndfile(std::string path, float sampleRate, uint64_t maxSamples, bool normalize)
+    {
+        SF_INFO sfinfo;
+        SNDFILE* file = sf_open(path.c_str(), SFM_READ, &sfinfo);
+        if (!file) {
+            logDebug("Error: could not open file %s [%s]\n", path.c_str(), sf_strerror(file));
+            return NULL;
+        }
+        logTrace("Audio file %s sampleCount %ld sampleRate %d\n", path.c_str(), (long)sfinfo.frames, sfinfo.samplerate);
+        uint64_t samples = std::min<uint64_t>(sfinfo.frames * std::max(sfinfo.channels, 1), maxSamples);
+        uint64_t capacity;
+        Buffer* buffer = newBuffer(path, sfinfo.channels, samples, sfinfo.samplerate, sampleRate, maxSamples, capacity);
+        buffer->count = sf_read_float(file, buffer->data.data(), samples);
+        sf_close(file);
+        convert(buffer, sfinfo.samplerate, sampleRate, capacity, normalize);
+        return buffer;
+    }
+#endif
+
+    static Buffer* decode(std::string path, std::string key, float sampleRate, uint64_t maxSamples, bool normalize, bool compactStorage)
+    {
+        Buffer* buffer = decodeWav(path, sampleRate, maxSamples, normalize);
+#ifndef SKIP_SNDFILE
+        if (!buffer) {
+            buffer = decodeSndfile(path, sampleRate, maxSamples, normalize);
+        }
+#endif
+        if (!buffer) {
+            return NULL;
+        }
+
+        // Saved next to the file, the folder possibly being read only
+        uint64_t hash = std::hash<std::string>()(key);
+        if (!buffer->overview.load(overviewPath(path), hash, buffer->count)) {
+            buffer->overview.build(buffer->samples, buffer->count);
+            buffer->overview.save(overviewPath(path), hash);
+        }
+        if (compactStorage && !buffer->mapping) {
+            compact(buffer);
+        }
+        return buffer;
+    }
+
+    // Heap memory only, the mapped files being in the page cache
+    static size_t bytes(const Ref& buffer)
+    {
+        return buffer->data.size() * sizeof(float) + buffer->compact.size() * sizeof(int16_t);
+    }
+
+    int budgetId = -1;
+
+    // Drop the least recently used buffers nobody holds, until the pool fits in `cap` again, return the bytes freed.
+    // Must be called with the lock held.
+    size_t evict(size_t cap)
+    {
+        size_t before = memory;
+        while (memory > cap) {
+            int oldest = -1;
+            for (size_t i = 0; i < entries.size(); i++) {
+                if (entries[i].buffer.use_count() == 1 && (oldest < 0 || entries[i].lastUse < entries[oldest].lastUse)) {
+                    oldest = i;
+                }
+            }
+            if (oldest < 0) {
+                break;
+            }
+            memory -= bytes(entries[oldest].buffer);
+            entries.erase(entries.begin() + oldest);
+        }
+        return before - memory;
+    }
+
+    // A compact buffer is only given to the players reading compact samples
+    Entry* find(std::string& key, Storage storage)
+    {
+        for (Entry& entry : entries) {
+            if (entry.key == key && (storage != FLOAT || entry.buffer->samples)) {
+                entry.lastUse = ++useCounter;
+                return &entry;
+            }
+        }
+        return NULL;
+    }
+
+    friend SamplePool& processSingleton<SamplePool>();
+
+    SamplePool()
+    {
+        const char* cap = getenv("SAMPLE_POOL_MB");
+        if (cap && cap[0] != '\0') {
+            logInfo("Env variable sample pool: %s MB", cap);
+            memoryCap = (size_t)atol(cap) * 1024 * 1024;
+        }
+        const char* compactMb = getenv("SAMPLE_POOL_COMPACT_MB");
+        if (compactMb && compactMb[0] != '\0') {
+            logInfo("Env variable sample pool compact above: %s MB", compactMb);
+            compactAbove = (size_t)atol(compactMb) * 1024 * 1024;
+        }
+        // Created first so it is destroyed last, the pool unregistering from it
+        budgetId = MemoryBudget::get().add("samples", MemoryBudget::NORMAL, [this] { return getMemory(); }, [this](size_t bytes) {
+            std::lock_guard<std::mutex> guard(mtx);
+            return evict(memory > bytes ? memory - bytes : 0);
+        });
+    }
+
+public:
+    static SamplePool& get()
+    {
+        return processSingleton<SamplePool>();
+    }
+
+    ~SamplePool()
+    {
+        MemoryBudget::get().remove(budgetId);
+    }
+
+    // Buffer of the file converted to `sampleRate`, `maxSamples` interleaved samples at most and normalized if
+    // `normalize` is set, decoding it only if it is not in the pool yet. NULL if the file can not be read.
+    Ref acquire(std::string path, float sampleRate, uint64_t maxSamples, bool normalize = true, Storage storage = FLOAT)
+    {
+        std::string key = makeKey(path, sampleRate, maxSamples, normalize);
+        bool compactStorage = storage == COMPACT;
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            Entry* entry = find(key, storage);
+            if (entry) {
+                return entry->buffer;
+            }
+            compactStorage = compactStorage || (storage == AUTO && compactAbove && memory >= compactAbove);
+        }
+
+        // Decoded without holding the lock, so other files are still served meanwhile
+        Ref buffer = Ref(decode(path, key, sampleRate, maxSamples, normalize, compactStorage));
+        if (!buffer) {
+            return NULL;
+        }
+
+        std::lock_guard<std::mutex> guard(mtx);
+        // Decoded at the same time by another thread, keep the first one
+        Entry* entry = find(key, storage);
+        if (entry) {
+            return entry->buffer;
+        }
+        entries.push_back({ key, buffer, ++useCounter });
+        memory += bytes(buffer);
+        evict(memoryCap);
+        MemoryBudget::get().changed();
+        return buffer;
+    }
+
+    // Memory taken by the decoded buffers, in bytes
+    size_t getMemory()
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        return memory;
+    }
+
+    void setMemoryCap(size_t value)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        memoryCap = value;
+        evict(memoryCap);
+    }
+};
@@ -0,0 +1,526 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <fcntl.h>
+#include <mutex>
+#include <sndfile.h>
+#include <string>
+#include <sys/stat.h>
+#include <unistd.h>
+#include <vector>
+
+#include "audio/utils/Resampler.h"
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+#include "log.h"
+
+// Long files played from the disk instead of being loaded in memory, e.g. stems of several minutes on the SD card.
+//
+// Each plugin owns a `SampleStreamer::Stream`, playing the first channel of the file at the engine rate:
+// - the first milliseconds of the file (the head) stay in memory, so playback starts right away
+// - a background thread reads the following frames ahead of the playhead into a lock-free ring, with large
+//   sequential reads, already looping between the loop points, so the audio thread only pops them.
+// Starting somewhere after the head, the audio thread waits for the ring to be filled, playing silence, and if the
+// disk doesn't keep up the playhead stalls instead of skipping frames. Instead of looping, a stream can also play
+// once up to the end point, e.g. the playback of a recording, see `TapeRecording`.
+//
+// `open()` hands the file to the worker, which reads its head, then `swap()` (audio thread) switches to it and
+// `play()` (audio thread) starts the playhead, see `SynthLoop`.
+class SampleStreamer {
+public:
+    class Stream {
+    protected:
+        friend class SampleStreamer;
+
+        struct File {
+            std::string path;
+            int fd = -1;
+            SNDFILE* sndfile = NULL;
+            uint32_t fileRate;
+            uint8_t channels;
+            float bytesPerFrame;
+            // Length at the engine rate
+            uint64_t frames;
+            // First frames at the engine rate, first channel only
+            std::vector<float> head;
+
+            ~File()
+            {
+                if (sndfile) {
+                    sf_close(sndfile);
+                }
+            }
+        };
+
+        // Frames after the head, in playing order
+        static const uint32_t RING_SIZE = 1 << 17;
+
+        float sampleRate;
+        uint32_t headFrames;
+
+        // Guarded by the mutex of the streamer
+        std::string pendingPath;
+        bool hasPending = false;
+
+        std::vector<float> ring;
+        std::atomic<uint64_t> writePos = 0;
+        std::atomic<uint64_t> readPos = 0;
+
+        File* current = NULL;
+        // Opened by the worker, waiting for the audio thread to take it
+        std::atomic<File*> ready = NULL;
+        // Replaced by the audio thread, waiting for the worker to delete it
+        std::atomic<File*> retired = NULL;
+
+        // Request of the audio thread, a seqlock: the generation is odd while the fields are written
+        std::atomic<uint64_t> requestGen = 0;
+        std::atomic<File*> requestFile = NULL;
+        std::atomic<uint64_t> requestFrom = 0;
+        std::atomic<uint64_t> requestLoopStart = 0;
+        std::atomic<uint64_t> requestLoopEnd = 0;
+        std::atomic<bool> requestLoop = true;
+        // Answer of the worker: the ring frames of the request `servedGen` start at `servedPos`
+        std::atomic<uint64_t> servedGen = 0;
+        std::atomic<uint64_t> servedPos = 0;
+
+        // Worker side
+        uint64_t workerGen = 0;
+        File* workerFile = NULL;
+        uint64_t producePos = 0;
+        uint64_t workerLoopStart = 0;
+        uint64_t workerLoopEnd = 0;
+        bool workerLoop = true;
+        uint64_t preroll = 0;
+        Resampler resampler;
+        std::vector<float> readBuffer;
+        std::vector<float> resampled;
+
+        // Audio thread side
+        uint64_t gen = 0;
+        uint64_t adoptedGen = 0;
+        uint64_t frame = 0;
+        float frac = 0.0f;
+        float value = 0.0f;
+        bool primed = false;
+        uint64_t loopStart = 0;
+        uint64_t loopEnd = 0;
+        bool looping = true;
+        bool reachedEnd = false;
+
+        // Where the ring continues once the head ends or the loop restarts
+        uint64_t ringFrom(uint64_t from, uint64_t headEnd)
+        {
+            return from < headEnd ? headEnd : from;
+        }
+
+        void post(File* file, uint64_t from, uint64_t start, uint64_t end, bool loop = true)
+        {
+            requestGen.store(gen + 1, std::memory_order_relaxed);
+            std::atomic_thread_fence(std::memory_order_release);
+            requestFile.store(file, std::memory_order_relaxed);
+            requestFrom.store(from, std::memory_order_relaxed);
+            requestLoopStart.store(start, std::memory_order_relaxed);
+            requestLoopEnd.store(end, std::memory_order_relaxed);
+            requestLoop.store(loop, std::memory_order_relaxed);
+            gen += 2;
+            requestGen.store(gen, std::memory_order_release);
+        }
+
+        bool adopt()
+        {
+            if (adoptedGen == gen) {
+                return true;
+            }
+            if (servedGen.load(std::memory_order_acquire) != gen) {
+                return false;
+            }
+            readPos.store(servedPos.load(std::memory_order_relaxed), std::memory_order_release);
+            adoptedGen = gen;
+            return true;
+        }
+
+        // Value of frame `f`, the next one in playing order
+        bool fetch(uint64_t f)
+        {
+            if (f < current->head.size()) {
+                value = current->head[f];
+                return true;
+            }
+            if (!adopt()) {
+                return false;
+            }
+            uint64_t pos = readPos.load(std::memory_order_relaxed);
+            if (pos == writePos.load(std::memory_order_acquire)) {
+                return false;
+            }
+            value = ring[pos & (RING_SIZE - 1)];
+            readPos.store(pos + 1, std::memory_order_release);
+            return true;
+        }
+
+    public:
+        // `headMs` milliseconds of the file stay in memory
+        Stream(float sampleRate, uint32_t headMs = 500)
+            : sampleRate(sampleRate)
+            , headFrames(sampleRate * headMs / 1000)
+            , ring(RING_SIZE, 0.0f)
+        {
+        }
+
+        ~Stream()
+        {
+            SampleStreamer::get().cancel(this);
+            delete current;
+            delete ready.load();
+            delete retired.load();
+        }
+
+        // Milliseconds of the files kept in memory, set before opening them
+        void setHeadMs(uint32_t headMs)
+        {
+            headFrames = sampleRate * headMs / 1000;
+        }
+
+        // Open the file in the background, an empty path closing the stream
+        void open(std::string path)
+        {
+            SampleStreamer::get().request(this, path);
+        }
+
+        // Switch to the last opened file if any, return true when it changed. Never waits, for the audio thread.
+        bool swap()
+        {
+            if (!ready.load(std::memory_order_acquire) || retired.load(std::memory_order_acquire)) {
+                return false;
+            }
+            // The worker must not read the previous file anymore, before it deletes it
+            post(NULL, 0, 0, 0);
+            retired.store(current, std::memory_order_release);
+            current = ready.exchange(NULL, std::memory_order_acq_rel);
+            primed = false;
+            return true;
+        }
+
+        // Length of the current file at the engine rate, 0 when none is opened
+        uint64_t frames()
+        {
+            return current ? current->frames : 0;
+        }
+
+        // Resident start of the current file, e.g. to draw it
+        const std::vector<float>* head()
+        {
+            return current ? &current->head : NULL;
+        }
+
+        // Frame played, at the engine rate
+        uint64_t position()
+        {
+            return frame;
+        }
+
+        // Start playing from `from`, looping between `start` and `end`, or stopping at `end` when `loop` is not
+        // set. For the audio thread.
+        void play(uint64_t from, uint64_t start, uint64_t end, bool loop = true)
+        {
+            if (!current || current->frames == 0) {
+                return;
+            }
+            loopEnd = std::clamp<uint64_t>(end, 1, current->frames);
+            loopStart = std::min(start, loopEnd - 1);
+            frame = std::clamp(from, loopStart, loopEnd - 1);
+            frac = 0.0f;
+            primed = false;
+            looping = loop;
+            reachedEnd = false;
+
+            uint64_t headEnd = current->head.size();
+            if (loopEnd <= headEnd) {
+                // The whole loop is in memory
+                return;
+            }
+            post(current, ringFrom(frame, headEnd), loopStart, loopEnd, loop);
+        }
+
+        // Whether a stream playing once reached its end point
+        bool ended()
+        {
+            return reachedEnd;
+        }
+
+        // Next frame, the playhead moving by `step` frames. For the audio thread.
+        float next(float step = 1.0f)
+        {
+            if (!current || current->frames == 0 || reachedEnd) {
+                return 0.0f;
+            }
+            if (!primed) {
+                if (!fetch(frame)) {
+                    return 0.0f;
+                }
+                primed = true;
+            }
+            float out = value;
+            frac += step;
+            while (frac >= 1.0f) {
+                if (!looping && frame + 1 >= loopEnd) {
+                    reachedEnd = true;
+                    break;
+                }
+                uint64_t nextFrame = frame + 1 >= loopEnd ? loopStart : frame + 1;
+                if (!fetch(nextFrame)) {
+                    // Not read yet, stall: the next call tries again without the time of this one
+                    frac -= step;
+                    break;
+                }
+                frame = nextFrame;
+                frac -= 1.0f;
+            }
+            return out;
+        }
+    };
+
+protected:
+    // Frames read from the file at once, at the file rate
+    static const uint32_t CHUNK = 16384;
+    // Frames decoded before the reading position after a seek, dropped
+    static const uint32_t PREROLL = 32;
+
+    std::mutex mtx;
+    std::condition_variable doneCv;
+    std::vector<Stream*> streams;
+    Stream* opening = NULL;
+    Worker worker { mtx, "sample_stream", [this] { workerLoop(); } };
+
+    static Stream::File* openFile(std::string path, float sampleRate, uint32_t headFrames)
+    {
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            logDebug("Error: could not open file %s", path.c_str());
+            return NULL;
+        }
+        // Read ahead by the kernel in large blocks, the file being read from the start to the end
+        posix_fadvise(fd, 0, 0, POSIX_FADV_SEQUENTIAL);
+        struct stat info;
+        fstat(fd, &info);
+
+        SF_INFO sfinfo;
+        SNDFILE* sndfile = sf_open_fd(fd, SFM_READ, &sfinfo, SF_TRUE);
+        if (!sndfile) {
+            logDebug("Error: could not open file %s [%s]", path.c_str(), sf_strerror(sndfile));
+            close(fd);
+            return NULL;
+        }
+        Stream::File* file = new Stream::File();
+        file->path = path;
+        file->fd = fd;
+        file->sndfile = sndfile;
+        file->fileRate = std::max(sfinfo.samplerate, 1);
+        file->channels = std::max(sfinfo.channels, 1);
+        file->bytesPerFrame = sfinfo.frames > 0 ? (float)info.st_size / sfinfo.frames : 0.0f;
+        file->frames = (uint64_t)sfinfo.frames * sampleRate / file->fileRate;
+        logTrace("Streamed audio file %s frames %ld sampleRate %d", path.c_str(), (long)sfinfo.frames, sfinfo.samplerate);
+
+        // Head: first channel, converted to the engine rate, with a few frames more so its end is not filtered
+        // against silence
+        uint64_t headLength = std::min<uint64_t>(headFrames, file->frames);
+        uint64_t fileFrames = std::min<uint64_t>(headLength * file->fileRate / sampleRate + PREROLL, sfinfo.frames);
+        std::vector<float> interleaved(fileFrames * file->channels);
+        fileFrames = sf_readf_float(sndfile, interleaved.data(), fileFrames);
+        file->head.resize(std::max<uint64_t>(fileFrames, headLength + PREROLL));
+        for (uint64_t f = 0; f < fileFrames; f++) {
+            file->head[f] = interleaved[f * file->channels];
+        }
+        uint64_t count = Resampler::convert(file->head.data(), fileFrames, 1, file->fileRate, sampleRate, file->head.size());
+        file->head.resize(std::min(count, headLength));
+        return file;
+    }
+
+    // Move the reading position, `restart` being set when looping in the same file
+    void seek(Stream& s, uint64_t engineFrame, bool restart = false)
+    {
+        Stream::File* file = s.workerFile;
+        if (restart) {
+            s.resampler.reset();
+        } else {
+            s.resampler.set(file->fileRate, s.sampleRate);
+        }
+        // When converting the rate, start a bit earlier and drop the first frames, so the filter is filled with
+        // the frames before instead of silence
+        s.preroll = s.resampler.isBypassed() ? 0 : std::min<uint64_t>(engineFrame, PREROLL);
+        uint64_t fileFrame = (engineFrame - s.preroll) * file->fileRate / s.sampleRate;
+        sf_seek(file->sndfile, fileFrame, SEEK_SET);
+        if (file->bytesPerFrame > 0.0f) {
+            posix_fadvise(file->fd, (off_t)(fileFrame * file->bytesPerFrame), (off_t)(CHUNK * 4 * file->bytesPerFrame), POSIX_FADV_WILLNEED);
+        }
+        s.producePos = engineFrame;
+    }
+
+    // Take the last request of the audio thread, if it changed
+    void takeRequest(Stream& s)
+    {
+        uint64_t g = s.requestGen.load(std::memory_order_acquire);
+        if (g == s.workerGen || (g & 1)) {
+            return;
+        }
+        Stream::File* file = s.requestFile.load(std::memory_order_relaxed);
+        uint64_t from = s.requestFrom.load(std::memory_order_relaxed);
+        uint64_t loopStart = s.requestLoopStart.load(std::memory_order_relaxed);
+        uint64_t loopEnd = s.requestLoopEnd.load(std::memory_order_relaxed);
+        bool loop = s.requestLoop.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (s.requestGen.load(std::memory_order_relaxed) != g) {
+            // Changed while reading it, taken on the next pass
+            return;
+        }
+        s.workerGen = g;
+        s.workerFile = file;
+        s.workerLoopStart = loopStart;
+        s.workerLoopEnd = loopEnd;
+        s.workerLoop = loop;
+        if (file) {
+            seek(s, from);
+        }
+        s.servedPos.store(s.writePos.load(std::memory_order_relaxed), std::memory_order_relaxed);
+        s.servedGen.store(g, std::memory_order_release);
+    }
+
+    // Read the next chunk into the ring, return false when there is nothing to read or no room for it
+    bool fill(Stream& s)
+    {
+        Stream::File* file = s.workerFile;
+        if (!file) {
+            return false;
+        }
+        uint32_t maxOut = s.resampler.maxOutputFrames(CHUNK);
+        uint64_t write = s.writePos.load(std::memory_order_relaxed);
+        if (Stream::RING_SIZE - (write - s.readPos.load(std::memory_order_acquire)) < maxOut) {
+            return false;
+        }
+        s.readBuffer.resize(CHUNK * file->channels);
+        s.resampled.resize(maxOut);
+        uint32_t read = sf_readf_float(file->sndfile, s.readBuffer.data(), CHUNK);
+        uint64_t headEnd = file->head.size();
+        uint64_t restart = s.ringFrom(s.workerLoopStart, headEnd);
+        if (read == 0) {
+            // End of the file before the end of the loop, e.g. length rounded at the engine rate
+            if (!s.workerLoop) {
+                s.workerFile = NULL;
+                return false;
+            }
+            if (s.producePos == restart) {
+                return false;
+            }
+            seek(s, restart, true);
+            return true;
+        }
+        float* out = s.resampled.data();
+        uint32_t count;
+        if (s.resampler.isBypassed()) {
+            for (uint32_t f = 0; f < read; f++) {
+                out[f] = s.readBuffer[f * file->channels];
+            }
+            count = read;
+        } else {
+            const float* in = s.readBuffer.data();
+            count = s.resampler.process(&in, file->channels, read, &out, 1);
+            uint32_t skip = std::min<uint64_t>(s.preroll, count);
+            s.preroll -= skip;
+            out += skip;
+            count -= skip;
+        }
+        bool wrap = s.producePos + count >= s.workerLoopEnd;
+        if (wrap) {
+            count = s.workerLoopEnd - s.producePos;
+        }
+        for (uint32_t f = 0; f < count; f++) {
+            s.ring[(write + f) & (Stream::RING_SIZE - 1)] = out[f];
+        }
+        s.writePos.store(write + count, std::memory_order_release);
+        s.producePos += count;
+        if (wrap && !s.workerLoop) {
+            // Played once, nothing more to read
+            s.workerFile = NULL;
+        } else if (wrap) {
+            seek(s, restart, true);
+        }
+        return true;
+    }
+
+    void purge(Stream& s)
+    {
+        Stream::File* old = s.retired.load(std::memory_order_acquire);
+        if (old) {
+            if (s.workerFile == old) {
+                s.workerFile = NULL;
+            }
+            delete old;
+            s.retired.store(NULL, std::memory_order_release);
+        }
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            for (Stream* s : streams) {
+                if (s->hasPending) {
+                    s->hasPending = false;
+                    std::string path = s->pendingPath;
+                    opening = s;
+                    lock.unlock();
+                    Stream::File* file = path.empty() ? NULL : openFile(path, s->sampleRate, s->headFrames);
+                    lock.lock();
+                    if (file || path.empty()) {
+                        delete s->ready.exchange(file, std::memory_order_acq_rel);
+                    }
+                    opening = NULL;
+                    doneCv.notify_all();
+                    // The list might have changed while unlocked
+                    break;
+                }
+            }
+
+            bool busy = false;
+            for (Stream* s : streams) {
+                purge(*s);
+                takeRequest(*s);
+                // A few chunks each, so all the streams are served
+                for (int i = 0; i < 4 && fill(*s); i++) {
+                    busy = true;
+                }
+            }
+            if (!busy) {
+                worker.cv.wait_for(lock, std::chrono::milliseconds(5));
+            }
+        }
+    }
+
+    void request(Stream* stream, std::string path)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        stream->pendingPath = path;
+        stream->hasPending = true;
+        if (std::find(streams.begin(), streams.end(), stream) == streams.end()) {
+            streams.push_back(stream);
+        }
+        worker.wake();
+    }
+
+    // Forget the stream, waiting for its file to be opened if it is being opened, before the stream is destroyed
+    void cancel(Stream* stream)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        streams.erase(std::remove(streams.begin(), streams.end(), stream), streams.end());
+        doneCv.wait(lock, [&] { return opening != stream; });
+    }
+
+public:
+    static SampleStreamer& get()
+    {
+        return processSingleton<SampleStreamer>();
+    }
+};
@@ -0,0 +1,29 @@
+#pragma once
+
+#include <cstdint>
+
+#include "plugins/audio/utils/SampleLoader.h"
+
+// Samples played by a plugin, stored as float or, for the compact storage of the pool (see SamplePool::Storage), as
+// 16 bits integers converted on each fetch. Starts with the count and the float samples, the layout read by the
+// `SAMPLE_BUFFER` views, `data` being NULL for a compact buffer: the views then draw from the overview.
+struct SampleView {
+    uint64_t count = 0;
+    const float* data = NULL;
+    const int16_t* compact = NULL;
+    uint8_t channels = 1;
+
+    void set(const SampleLoader::Sample* sample)
+    {
+        count = sample->count;
+        data = sample->data;
+        compact = sample->compact;
+        channels = sample->channels;
+    }
+
+    // The branch goes the same way for the whole sample, it costs nearly nothing next to the fetch itself
+    float operator[](uint64_t index) const
+    {
+        return data ? data[index] : compact[index] * (1.0f / 32768.0f);
+    }
+};
@@ -0,0 +1,447 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <cmath>
+#include <complex>
+#include <condition_variable>
+#include <cstdio>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <sndfile.h>
+#include <string>
+#include <sys/stat.h>
+#include <vector>
+
+#include "audio/utils/fft.h"
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+#include "helpers/trace.h"
+#include "log.h"
+#include "plugins/audio/utils/SampleIndex.h"
+
+// Slice points and tempo of the loops, found by a background thread when a file is loaded, so a loop can be played
+// slice by slice from the notes without any analysis on the audio thread.
+//
+// The onsets are the peaks of the spectral flux: the positive change of the log magnitude spectrum from one frame
+// to the next, computed with the shared RealFft, above the mean of their neighbourhood. Each slice then starts at
+// the zero crossing before the attack. The tempo is the period of the flux found by autocorrelation, snapped to a
+// whole number of beats over the loop when close to it.
+//
+// Like the waveform overview, the result is saved in a hidden file next to the sample, `.name.slices`, so a file is
+// only analyzed once, and it is given to the SampleIndex, for the files without tempo in their name.
+//
+// Each plugin owns a `SliceAnalyzer::Slot`: `analyze()` queues the file, and `get()` returns its slices once found.
+// The slice maps are never deleted, so the audio thread can keep one without holding it.
+class SliceAnalyzer {
+public:
+    struct SliceMap {
+        // File analyzed
+        std::string path;
+        uint32_t rate = 0;
+        uint64_t frames = 0;
+        // 0 when no tempo was found
+        float bpm = 0.0f;
+        // First frame of each slice, at the rate of the file, the first one being 0
+        std::vector<uint64_t> starts;
+
+        size_t count() const
+        {
+            return starts.size();
+        }
+
+        // Index of the first sample of `slice` in a buffer of the file converted to `bufferRate`, with `channels`
+        // interleaved channels
+        uint64_t start(size_t slice, float bufferRate, uint8_t channels) const
+        {
+            return (uint64_t)((double)starts[slice] * bufferRate / rate) * channels;
+        }
+
+        // Index of the sample following `slice`, the start of the next one or the end of the file
+        uint64_t end(size_t slice, float bufferRate, uint8_t channels) const
+        {
+            uint64_t frame = slice + 1 < starts.size() ? starts[slice + 1] : frames;
+            return (uint64_t)((double)frame * bufferRate / rate) * channels;
+        }
+    };
+
+    class Slot {
+    protected:
+        friend class SliceAnalyzer;
+
+        // Guarded by the mutex of the analyzer
+        std::string pendingPath;
+        std::atomic<const SliceMap*> map = NULL;
+
+    public:
+        ~Slot()
+        {
+            SliceAnalyzer::get().cancel(this);
+        }
+
+        // Find the slices of the file in the background, `get()` returning NULL until they are found
+        void analyze(std::string path)
+        {
+            SliceAnalyzer::get().request(this, path);
+        }
+
+        // Slices of the file last analyzed, NULL until they are found. Never waits, for the audio thread.
+        const SliceMap* get()
+        {
+            return map.load(std::memory_order_acquire);
+        }
+    };
+
+protected:
+    static const uint32_t MAGIC = 0x5a50534c; // ZPSL
+    static const uint32_t VERSION = 1;
+
+    // Frames of the FFT and hop between them, ~5 ms at 48000Hz
+    static const uint32_t FRAME = 1024;
+    static const uint32_t HOP = 256;
+    // Frames around an onset: it must be the highest of `PEAK_SPAN` on each side, and above `THRESHOLD` times the
+    // mean of `MEAN_SPAN` on each side, plus `FLOOR` of the highest onset, so the noise of the quiet parts is not sliced
+    static const uint32_t PEAK_SPAN = 3;
+    static const uint32_t MEAN_SPAN = 12;
+    static constexpr float THRESHOLD = 1.3f;
+    static constexpr float FLOOR = 0.05f;
+    // Shortest slice
+    static constexpr float MIN_SLICE_SECONDS = 0.05f;
+    static constexpr float MIN_BPM = 60.0f;
+    static constexpr float MAX_BPM = 200.0f;
+    // Only the start of the longer files is analyzed
+    static constexpr float MAX_SECONDS = 120.0f;
+
+    std::mutex mtx;
+    // Signaled each time a file is analyzed, for `cancel()` to wait on the one being analyzed
+    std::condition_variable doneCv;
+    std::deque<Slot*> queue;
+    Slot* analyzing = NULL;
+    Worker worker { mtx, "slice_analyzer", [this] { workerLoop(); } };
+    // By `key()`, never deleted
+    std::map<std::string, SliceMap*> maps;
+
+    // A file modified since it was analyzed is analyzed again
+    static std::string key(std::string path)
+    {
+        struct stat info;
+        if (stat(path.c_str(), &info) != 0) {
+            return "";
+        }
+        return path + "|" + std::to_string((long)info.st_mtime) + "|" + std::to_string((long)info.st_size);
+    }
+
+    // Hidden file next to the sample, so the file browsers don't list it
+    static std::string slicesPath(std::string path)
+    {
+        size_t slash = path.find_last_of('/');
+        size_t name = slash == std::string::npos ? 0 : slash + 1;
+        return path.substr(0, name) + "." + path.substr(name) + ".slices";
+    }
+
+    static bool load(std::string path, uint64_t hash, SliceMap& map)
+    {
+        FILE* file = fopen(slicesPath(path).c_str(), "rb");
+        if (!file) {
+            return false;
+        }
+        uint32_t header[2];
+        uint64_t savedHash;
+        uint64_t count;
+        bool ok = fread(header, sizeof(header), 1, file) == 1 && header[0] == MAGIC && header[1] == VERSION
+            && fread(&savedHash, sizeof(savedHash), 1, file) == 1 && savedHash == hash
+            && fread(&map.rate, sizeof(map.rate), 1, file) == 1
+            && fread(&map.frames, sizeof(map.frames), 1, file) == 1
+            && fread(&map.bpm, sizeof(map.bpm), 1, file) == 1
+            && fread(&count, sizeof(count), 1, file) == 1 && count > 0 && count < (1 << 16);
+        if (ok) {
+            map.starts.resize(count);
+            ok = fread(map.starts.data(), sizeof(uint64_t), count, file) == count;
+        }
+        fclose(file);
+        return ok && map.rate > 0;
+    }
+
+    // The folder of the sample might be read only, the file is then analyzed each time the process starts
+    static void save(std::string path, uint64_t hash, const SliceMap& map)
+    {
+        FILE* file = fopen(slicesPath(path).c_str(), "wb");
+        if (!file) {
+            return;
+        }
+        uint32_t header[2] = { MAGIC, VERSION };
+        uint64_t count = map.starts.size();
+        bool ok = fwrite(header, sizeof(header), 1, file) == 1
+            && fwrite(&hash, sizeof(hash), 1, file) == 1
+            && fwrite(&map.rate, sizeof(map.rate), 1, file) == 1
+            && fwrite(&map.frames, sizeof(map.frames), 1, file) == 1
+            && fwrite(&map.bpm, sizeof(map.bpm), 1, file) == 1
+            && fwrite(&count, sizeof(count), 1, file) == 1
+            && fwrite(map.starts.data(), sizeof(uint64_t), count, file) == count;
+        if (fclose(file) != 0 || !ok) {
+            remove(slicesPath(path).c_str());
+        }
+    }
+
+    // Positive change of the log magnitude of each bin, from one frame to the next
+    static std::vector<float> spectralFlux(const std::vector<float>& mono)
+    {
+        RealFft fft(FRAME);
+        std::vector<float> window(FRAME);
+        std::vector<float> frame(FRAME);
+        std::vector<std::complex<float>> spectrum(fft.bins());
+        std::vector<float> magnitude(fft.bins());
+        std::vector<float> previous(fft.bins(), 0.0f);
+        for (uint32_t i = 0; i < FRAME; i++) {
+            window[i] = 0.5f - 0.5f * cosf(2.0f * M_PI * i / FRAME);
+        }
+        std::vector<float> flux;
+        for (uint64_t position = 0; position + FRAME <= mono.size(); position += HOP) {
+            for (uint32_t i = 0; i < FRAME; i++) {
+                frame[i] = mono[position + i] * window[i];
+            }
+            fft.forward(frame.data(), spectrum.data());
+            for (uint32_t k = 0; k < spectrum.size(); k++) {
+                magnitude[k] = log1pf(100.0f * std::abs(spectrum[k]));
+            }
+            // Against the highest of the neighbour bins in the previous frame, so the noise and the vibrato don't
+            // add up to an onset
+            float sum = 0.0f;
+            for (uint32_t k = 0; k < spectrum.size(); k++) {
+                float before = std::max({ previous[k > 0 ? k - 1 : k], previous[k], previous[std::min<uint32_t>(k + 1, spectrum.size() - 1)] });
+                sum += std::max(magnitude[k] - before, 0.0f);
+            }
+            previous.swap(magnitude);
+            flux.push_back(sum);
+        }
+        return flux;
+    }
+
+    // Where the attack found in the frame at `position` starts: the zero crossing before the first sample reaching a
+    // quarter of the peak of the frame and of the hop following it
+    static uint64_t attack(const std::vector<float>& mono, uint64_t position)
+    {
+        uint64_t to = std::min<uint64_t>(position + FRAME + HOP, mono.size());
+        float peak = 0.0f;
+        for (uint64_t i = position; i < to; i++) {
+            peak = std::max(peak, fabsf(mono[i]));
+        }
+        uint64_t i = position;
+        while (i < to && fabsf(mono[i]) < peak * 0.25f) {
+            i++;
+        }
+        uint64_t limit = i > HOP ? i - HOP : 0;
+        while (i > limit && i > 0 && (mono[i] > 0.0f) == (mono[i - 1] > 0.0f)) {
+            i--;
+        }
+        return i;
+    }
+
+    static void findSlices(const std::vector<float>& mono, const std::vector<float>& flux, SliceMap& map)
+    {
+        map.starts.push_back(0);
+        // The first frame is compared with silence
+        float highest = 0.0f;
+        for (uint64_t i = 1; i < flux.size(); i++) {
+            highest = std::max(highest, flux[i]);
+        }
+        uint64_t minSlice = MIN_SLICE_SECONDS * map.rate;
+        for (uint64_t i = 1; i < flux.size(); i++) {
+            uint64_t from = i > PEAK_SPAN ? i - PEAK_SPAN : 0;
+            uint64_t to = std::min<uint64_t>(i + PEAK_SPAN + 1, flux.size());
+            if (*std::max_element(flux.begin() + from, flux.begin() + to) != flux[i]) {
+                continue;
+            }
+            from = i > MEAN_SPAN ? i - MEAN_SPAN : 0;
+            to = std::min<uint64_t>(i + MEAN_SPAN + 1, flux.size());
+            float mean = 0.0f;
+            for (uint64_t j = from; j < to; j++) {
+                mean += flux[j];
+            }
+            mean /= to - from;
+            if (flux[i] < mean * THRESHOLD + highest * FLOOR) {
+                continue;
+            }
+            // The log magnitude rises as soon as the attack enters the window of the frame
+            uint64_t start = attack(mono, i * HOP);
+            if (start >= map.starts.back() + minSlice && start + minSlice <= map.frames) {
+                map.starts.push_back(start);
+            }
+        }
+    }
+
+    // Period of the flux, weighted towards 120 BPM to not take half or twice the tempo
+    static float findTempo(const std::vector<float>& flux, uint32_t rate, double seconds)
+    {
+        float hopSeconds = (float)HOP / rate;
+        uint64_t minLag = std::max<uint64_t>(60.0f / (MAX_BPM * hopSeconds), 1);
+        uint64_t maxLag = std::min<uint64_t>(60.0f / (MIN_BPM * hopSeconds), flux.size() / 2);
+        if (minLag + 2 > maxLag) {
+            return 0.0f;
+        }
+        float mean = 0.0f;
+        for (float value : flux) {
+            mean += value;
+        }
+        mean /= flux.size();
+        std::vector<float> scores(maxLag + 2, 0.0f);
+        uint64_t best = 0;
+        for (uint64_t lag = minLag - 1; lag <= maxLag + 1; lag++) {
+            double sum = 0.0;
+            for (uint64_t i = 0; i + lag < flux.size(); i++) {
+                sum += (double)(flux[i] - mean) * (flux[i + lag] - mean);
+            }
+            float octaves = log2f(60.0f / (lag * hopSeconds) / 120.0f);
+            scores[lag] = sum / (flux.size() - lag) * expf(-0.5f * octaves * octaves);
+            if (lag >= minLag && lag <= maxLag && (!best || scores[lag] > scores[best])) {
+                best = lag;
+            }
+        }
+        if (scores[best] <= 0.0f) {
+            return 0.0f;
+        }
+        // Between the lags, from the parabola going through the best one and its neighbours
+        float a = scores[best - 1], b = scores[best], c = scores[best + 1];
+        float offset = a - 2.0f * b + c < 0.0f ? 0.5f * (a - c) / (a - 2.0f * b + c) : 0.0f;
+        float bpm = 60.0f / ((best + offset) * hopSeconds);
+
+        // A loop lasts a whole number of beats
+        float beats = seconds * bpm / 60.0f;
+        float whole = roundf(beats);
+        if (whole >= 1.0f && fabsf(beats - whole) < beats * 0.03f) {
+            bpm = whole * 60.0f / seconds;
+        }
+        return bpm;
+    }
+
+    static SliceMap* analyze(std::string path)
+    {
+        TraceSpan span("sliceAnalysis");
+        SF_INFO sfinfo = {};
+        SNDFILE* file = sf_open(path.c_str(), SFM_READ, &sfinfo);
+        if (!file) {
+            logDebug("SliceAnalyzer: could not open file %s [%s]", path.c_str(), sf_strerror(file));
+            return NULL;
+        }
+        SliceMap* map = new SliceMap();
+        map->path = path;
+        map->rate = sfinfo.samplerate;
+        map->frames = sfinfo.frames;
+
+        // Mixed down to mono
+        uint32_t channels = std::max(sfinfo.channels, 1);
+        uint64_t frames = std::min<uint64_t>(sfinfo.frames, MAX_SECONDS * sfinfo.samplerate);
+        std::vector<float> mono;
+        mono.reserve(frames);
+        std::vector<float> chunk(4096 * channels);
+        sf_count_t read;
+        while (mono.size() < frames && (read = sf_readf_float(file, chunk.data(), 4096)) > 0) {
+            for (sf_count_t f = 0; f < read && mono.size() < frames; f++) {
+                float sum = 0.0f;
+                for (uint32_t c = 0; c < channels; c++) {
+                    sum += chunk[f * channels + c];
+                }
+                mono.push_back(sum / channels);
+            }
+        }
+        sf_close(file);
+
+        std::vector<float> flux = spectralFlux(mono);
+        findSlices(mono, flux, *map);
+        map->bpm = findTempo(flux, map->rate, (double)map->frames / map->rate);
+        logDebug("SliceAnalyzer: %s, %d slices, %.1f BPM", path.c_str(), (int)map->count(), map->bpm);
+        return map;
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            worker.cv.wait(lock, [&] { return !worker.isRunning() || !queue.empty(); });
+            if (!worker.isRunning()) {
+                break;
+            }
+            Slot* slot = queue.front();
+            queue.pop_front();
+            std::string path = slot->pendingPath;
+            std::string mapKey = key(path);
+            analyzing = slot;
+            lock.unlock();
+
+            SliceMap* map = NULL;
+            if (!mapKey.empty()) {
+                uint64_t hash = std::hash<std::string>()(mapKey);
+                map = new SliceMap();
+                map->path = path;
+                if (!load(path, hash, *map)) {
+                    delete map;
+                    map = analyze(path);
+                    if (map) {
+                        save(path, hash, *map);
+                    }
+                }
+                if (map) {
+                    SampleIndex::get().setAnalysis(path, map->bpm, map->count());
+                }
+            }
+
+            lock.lock();
+            if (map) {
+                // Analyzed at the same time for another slot, keep the first one
+                auto it = maps.find(mapKey);
+                if (it != maps.end()) {
+                    delete map;
+                    map = it->second;
+                } else {
+                    maps[mapKey] = map;
+                }
+                if (slot->pendingPath == path) {
+                    slot->map.store(map, std::memory_order_release);
+                }
+            }
+            analyzing = NULL;
+            doneCv.notify_all();
+        }
+    }
+
+    void request(Slot* slot, std::string path)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        slot->pendingPath = path;
+        auto it = maps.find(key(path));
+        if (it != maps.end()) {
+            queue.erase(std::remove(queue.begin(), queue.end(), slot), queue.end());
+            slot->map.store(it->second, std::memory_order_release);
+            return;
+        }
+        slot->map.store(NULL, std::memory_order_release);
+        // Browsing quickly only analyzes the last file
+        if (std::find(queue.begin(), queue.end(), slot) == queue.end()) {
+            queue.push_back(slot);
+        }
+        worker.wake();
+    }
+
+    // Forget the slot and wait for its file to be analyzed if it is being analyzed, before the slot is destroyed
+    void cancel(Slot* slot)
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        queue.erase(std::remove(queue.begin(), queue.end(), slot), queue.end());
+        doneCv.wait(lock, [&] { return analyzing != slot; });
+    }
+
+public:
+    static SliceAnalyzer& get()
+    {
+        return processSingleton<SliceAnalyzer>();
+    }
+
+    ~SliceAnalyzer()
+    {
+        worker.stop();
+        for (auto& [mapKey, map] : maps) {
+            delete map;
+        }
+    }
+};
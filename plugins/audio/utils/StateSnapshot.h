@@ -0,0 +1,70 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <mutex>
+
+// Lock-free triple buffer, to read a consistent copy of a state owned by the audio thread from another thread.
+//
+// The audio thread fills `back()` and calls `publish()` at a block boundary, without ever waiting. Readers get the
+// last published copy, either:
+// - with `read()`, readers being serialized between them (e.g. autosave and a track reload), never with the writer
+// - with `acquire()`, for a single reader polling it, e.g. the UI thread rendering a meter or a playhead, wait-free.
+// A snapshot is read one way or the other, never both.
+template <typename T>
+class StateSnapshot {
+protected:
+    static const uint8_t INDEX = 0x3;
+    // Set on the middle buffer when it was published and not read yet
+    static const uint8_t FRESH = 0x4;
+
+    T buffers[3];
+    uint8_t writeIndex = 0;
+    std::atomic<uint8_t> middle = 1;
+    uint8_t readIndex = 2;
+    std::mutex readMtx;
+
+public:
+    std::atomic<bool> published = false;
+
+    // Same initial state in all the buffers, e.g. to reserve the memory they need before the audio thread starts
+    template <typename F>
+    void init(F fn)
+    {
+        for (T& buffer : buffers) {
+            fn(buffer);
+        }
+    }
+
+    // Buffer to fill before publishing it. Writer only.
+    T& back()
+    {
+        return buffers[writeIndex];
+    }
+
+    void publish()
+    {
+        writeIndex = middle.exchange(writeIndex | FRESH) & INDEX;
+        published = true;
+    }
+
+    // Call `fn` with the last published copy
+    template <typename F>
+    void read(F fn)
+    {
+        std::lock_guard<std::mutex> guard(readMtx);
+        if (middle.load() & FRESH) {
+            readIndex = middle.exchange(readIndex) & INDEX;
+        }
+        fn(buffers[readIndex]);
+    }
+
+    // Last published copy, valid until the next `acquire()`, the writer never touching it meanwhile. Single reader.
+    const T& acquire()
+    {
+        if (middle.load() & FRESH) {
+            readIndex = middle.exchange(readIndex) & INDEX;
+        }
+        return buffers[readIndex];
+    }
+};
@@ -11,7 +11,7 @@ This C++ structure defines a core component called `Timeline`, which acts as the
     *   A configuration function sets the initial folder and filename, then triggers the loading process.
     *   A loading function reads the specified JSON file from the disk.
 
-4.  **Processing and Sorting:** Once loaded, the system parses the data. It verifies that every instruction is complete and converts the textual action descriptions into internal codes. Most importantly, it immediately sorts all loaded instructions based on their numerical "step," guaranteeing that they are always processed in chronological order.
+4.  **Processing and Sorting:** Once loaded, the system parses the data. It verifies that every instruction is complete and converts the textual action descriptions into internal codes. Most importantly, it immediately sorts all loaded instructions based on their numerical "step," guaranteeing that they are always processed in chronological order. The steps are also indexed apart, per type of event, so seeking to a step or finding the events visible on screen is a binary search, even on long arrangements.
 
 In essence, the `Timeline` class reads a script describing a series of events and prepares them for execution, ensuring proper file path handling and sequential order.
 
@@ -20,6 +20,7 @@ sha: 69e3eab867ac4d5fa129c0109edea0bdddcd3ad451c39af1156c7470c7f709b8
 #pragma once
 
 #include "libs/nlohmann/json.hpp"
+#include <algorithm>
 #include <string>
 #include <vector>
 
@@ -43,8 +44,39 @@ public:
         void* data = nullptr;
     };
 
+    // Sorted by step
     std::vector<Event> events;
 
+    // Keys of the events apart from them, per type, so seeking and finding the visible events is a binary search
+    // reading only the steps:
+    // - the step of each event
+    std::vector<uint32_t> steps;
+    // - the index in `events` of each clip and each loop, with their steps
+    std::vector<uint16_t> clips;
+    std::vector<uint32_t> clipSteps;
+    std::vector<uint16_t> loops;
+    std::vector<uint32_t> loopSteps;
+
+    // Rebuild the keys, once the events are sorted
+    void buildIndex()
+    {
+        steps.clear();
+        clips.clear();
+        clipSteps.clear();
+        loops.clear();
+        loopSteps.clear();
+        for (uint16_t i = 0; i < events.size(); i++) {
+            steps.push_back(events[i].step);
+            if (events[i].type == LOAD_CLIP) {
+                clips.push_back(i);
+                clipSteps.push_back(events[i].step);
+            } else if (events[i].type == LOOP_BACK) {
+                loops.push_back(i);
+                loopSteps.push_back(events[i].step);
+            }
+        }
+    }
+
     void load(nlohmann::json& json)
     {
         events.clear();
@@ -68,8 +100,53 @@ public:
         }
 
         // Sort timeline by step
-        std::sort(events.begin(), events.end(),
+        std::stable_sort(events.begin(), events.end(),
             [](auto& a, auto& b) { return a.step < b.step; });
+        buildIndex();
+    }
+
+    // Index of the first event on `step` or after, where to play from when seeking
+    uint16_t firstEvent(uint32_t step)
+    {
+        return std::lower_bound(steps.begin(), steps.end(), step) - steps.begin();
+    }
+
+    // Position in `clips` of the first clip on `step` or after
+    size_t firstClip(uint32_t step)
+    {
+        return std::lower_bound(clipSteps.begin(), clipSteps.end(), step) - clipSteps.begin();
+    }
+
+    // Position in `loops` of the first loop on `step` or after
+    size_t firstLoop(uint32_t step)
+    {
+        return std::lower_bound(loopSteps.begin(), loopSteps.end(), step) - loopSteps.begin();
+    }
+
+    Event& clip(size_t position)
+    {
+        return events[clips[position]];
+    }
+
+    Event& loop(size_t position)
+    {
+        return events[loops[position]];
+    }
+
+    // Move the event `index` to `step`, keeping the events sorted, return its new index
+    uint16_t setStep(uint16_t index, uint32_t step)
+    {
+        events[index].step = step;
+        while (index > 0 && events[index - 1].step > step) {
+            std::swap(events[index - 1], events[index]);
+            index--;
+        }
+        while (index + 1 < events.size() && events[index + 1].step < step) {
+            std::swap(events[index + 1], events[index]);
+            index++;
+        }
+        buildIndex();
+        return index;
     }
 
     void config(nlohmann::json& json)
@@ -0,0 +1,244 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <mutex>
+#include <vector>
+
+#include "helpers/Worker.h"
+#include "helpers/processSingleton.h"
+#include "plugins/audio/utils/Timeline.h"
+
+// Timeline compiled into a flat stream of events for playback, the loops back unrolled, covering the next steps from
+// the playhead. The audio thread only walks a cursor in it, never reading the timeline being edited, and looking
+// ahead (e.g. to preload the next clip) is reading the next events.
+//
+// Each clip sequencer owns a `TimelineStream::Slot`:
+// - `changed()` is called once the timeline changed, with a copy of its events compiled in the background
+// - `extend()`, called by the audio thread when the stream runs short, has it compiled again from the playhead
+// - `swap()`, called by the audio thread on a step, switches to the new stream, if it was compiled from the playhead
+//   of this step, else it is compiled again
+// - the previous stream is deleted by the worker.
+class TimelineStream {
+public:
+    struct Event {
+        // Steps played since the start when the event happens, the first step being 0
+        uint32_t played;
+        Timeline::EventType type;
+        uint32_t value;
+    };
+
+    struct Stream {
+        std::vector<Event> events;
+        // Steps covered, from the step after the playhead it was compiled from
+        uint32_t from;
+        uint32_t until;
+    };
+
+    // Events the clip sequencer plays on the steps after `played`, the timeline being on `step`, the same way it
+    // would walk the timeline step by step
+    static Stream* compile(const std::vector<Timeline::Event>& events, uint32_t played, uint32_t step, uint32_t steps)
+    {
+        auto firstEvent = [&](uint32_t step) {
+            return std::lower_bound(events.begin(), events.end(), step, [](const Timeline::Event& event, uint32_t step) { return event.step < step; })
+                - events.begin();
+        };
+        Stream* stream = new Stream;
+        stream->from = played + 1;
+        stream->until = stream->from + steps;
+        // The events of the playhead step were played
+        size_t current = firstEvent(step + 1);
+        for (played = stream->from; played != stream->until; played++) {
+            step++;
+            for (size_t jumps = 0; current < events.size() && events[current].step <= step;) {
+                const Timeline::Event& event = events[current];
+                stream->events.push_back({ played, event.type, event.value });
+                if (event.type != Timeline::EventType::LOOP_BACK) {
+                    current++;
+                    continue;
+                }
+                // Looping back without reaching a new step would never end, the stream stops there
+                if (++jumps > events.size()) {
+                    stream->until = played + 1;
+                    return stream;
+                }
+                step = event.value;
+                current = firstEvent(step);
+            }
+        }
+        return stream;
+    }
+
+    class Slot {
+    protected:
+        friend class TimelineStream;
+
+        uint32_t steps;
+
+        // Guarded by the mutex of the compiler
+        std::vector<Timeline::Event> events;
+
+        // Steps played and step of the timeline, published by the audio thread after each step
+        std::atomic<uint64_t> playhead = (uint64_t)-1;
+        std::atomic<bool> requested = false;
+
+        Stream* current = NULL;
+        // Compiled, waiting for the audio thread to take it
+        std::atomic<Stream*> ready = NULL;
+        // Replaced by the audio thread, waiting for the worker to delete it
+        std::atomic<Stream*> retired = NULL;
+
+        void replace(Stream* stream)
+        {
+            Stream* old = current;
+            current = stream;
+            if (old && retired.load(std::memory_order_acquire)) {
+                delete old;
+            } else if (old) {
+                retired.store(old, std::memory_order_release);
+            }
+        }
+
+    public:
+        // `steps` steps are compiled ahead of the playhead
+        Slot(uint32_t steps)
+            : steps(std::max(steps, (uint32_t)2))
+        {
+        }
+
+        ~Slot()
+        {
+            TimelineStream::get().cancel(this);
+            delete current;
+            delete ready.load();
+            delete retired.load();
+        }
+
+        // The timeline changed, compile it in the background, or right away when `now` is set, e.g. while the
+        // plugin is created
+        void changed(Timeline& timeline, bool now = false)
+        {
+            TimelineStream::get().request(this, timeline.events, now);
+        }
+
+        // Compile again from the playhead, without waiting, for the audio thread
+        void extend()
+        {
+            requested.store(true, std::memory_order_release);
+        }
+
+        // Audio thread only, once the step is played
+        void setPlayhead(uint32_t played, uint32_t step)
+        {
+            playhead.store(((uint64_t)played << 32) | step, std::memory_order_release);
+        }
+
+        // Switch to the last compiled stream if it plays the steps after `played`, return true when it changed.
+        // Never waits, for the audio thread.
+        bool swap(uint32_t played)
+        {
+            if (!ready.load(std::memory_order_acquire) || retired.load(std::memory_order_acquire)) {
+                return false;
+            }
+            Stream* next = ready.exchange(NULL, std::memory_order_acq_rel);
+            if (next->from != played + 1) {
+                // A step was played while compiling it
+                retired.store(next, std::memory_order_release);
+                extend();
+                return false;
+            }
+            replace(next);
+            return true;
+        }
+
+        // Compile from the playhead right away if the compiler is not busy, e.g. when the stream was rewound just
+        // before playing. Allocates, so only for when the audio thread has no stream to play.
+        bool compileNow()
+        {
+            return TimelineStream::get().compileNow(this);
+        }
+
+        // Stream played by the audio thread, NULL until the timeline was compiled
+        Stream* get()
+        {
+            return current;
+        }
+
+        uint32_t stepsAhead()
+        {
+            return steps;
+        }
+
+        // Before the timeline is compiled the first time
+        void setStepsAhead(uint32_t value)
+        {
+            steps = std::max(value, (uint32_t)2);
+        }
+    };
+
+protected:
+    std::mutex mtx;
+    std::vector<Slot*> slots;
+    Worker worker { mtx, "timeline_stream", [this] { workerLoop(); } };
+
+    static Stream* compile(Slot* slot)
+    {
+        uint64_t playhead = slot->playhead.load(std::memory_order_acquire);
+        return compile(slot->events, playhead >> 32, playhead & 0xffffffff, slot->steps);
+    }
+
+    void workerLoop()
+    {
+        std::unique_lock<std::mutex> lock(mtx);
+        while (worker.isRunning()) {
+            // The audio thread doesn't notify, polled often enough for a stream of many steps
+            worker.cv.wait_for(lock, std::chrono::milliseconds(10));
+            for (Slot* slot : slots) {
+                delete slot->retired.exchange(NULL, std::memory_order_acq_rel);
+                if (slot->requested.exchange(false, std::memory_order_acq_rel)) {
+                    // A stream compiled earlier but never taken is replaced
+                    delete slot->ready.exchange(compile(slot), std::memory_order_acq_rel);
+                }
+            }
+        }
+    }
+
+    void request(Slot* slot, const std::vector<Timeline::Event>& events, bool now)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        slot->events = events;
+        if (std::find(slots.begin(), slots.end(), slot) == slots.end()) {
+            slots.push_back(slot);
+        }
+        worker.start();
+        if (now) {
+            slot->replace(compile(slot));
+            return;
+        }
+        slot->requested.store(true, std::memory_order_release);
+        worker.cv.notify_one();
+    }
+
+    bool compileNow(Slot* slot)
+    {
+        std::unique_lock<std::mutex> lock(mtx, std::try_to_lock);
+        if (!lock.owns_lock()) {
+            return false;
+        }
+        slot->replace(compile(slot));
+        return true;
+    }
+
+    void cancel(Slot* slot)
+    {
+        std::lock_guard<std::mutex> guard(mtx);
+        slots.erase(std::remove(slots.begin(), slots.end(), slot), slots.end());
+    }
+
+public:
+    static TimelineStream& get()
+    {
+        return processSingleton<TimelineStream>();
+    }
+};
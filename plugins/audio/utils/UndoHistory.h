@@ -0,0 +1,175 @@
+#pragma once
+
+#include <chrono>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+#include "plugins/audio/audioPlugin.h"
+#include "plugins/audio/utils/CowArray.h"
+
+// Undo history of the plugins of a track: each entry is a copy of their values, and of the rest of their state
+// (e.g. the steps of a sequencer, see AudioPlugin::snapshotState()), made of copy-on-write chunks shared with the
+// previous entry (see CowArray.h), so an entry only costs what changed. The oldest entries are dropped once the
+// history takes more than about `maxBytes`.
+//
+// The states are read from what the plugins published at the end of their last block, never from the audio thread.
+// A change is noticed from the changes drained by the parameter queues and the version of the states, and once
+// they settle for `settleMs`, e.g. the end of a knob turn, a single entry is added, see `tick()`. Undoing sets the
+// values through the parameter queues, and hands the states over to the plugins, each applying it at the start of
+// its next block.
+class UndoHistory {
+public:
+    typedef CowArray<float> Values;
+
+    struct PluginState {
+        AudioPlugin* plugin;
+        Values values;
+        std::shared_ptr<const void> state;
+    };
+
+    struct Entry {
+        std::vector<PluginState> plugins;
+        // Memory not shared with the previous entry
+        size_t bytes = 0;
+    };
+
+    size_t maxBytes = 1 << 20;
+    uint32_t settleMs = 300;
+
+protected:
+    std::mutex m;
+    std::deque<Entry> entries;
+    // Entry matching the current state of the plugins
+    size_t current = 0;
+    size_t bytes = 0;
+
+    uint64_t signature = 0;
+    bool settling = false;
+    std::chrono::steady_clock::time_point changedAt;
+    std::vector<float> values;
+
+    static uint64_t signatureOf(const std::vector<AudioPlugin*>& plugins)
+    {
+        uint64_t sum = 0;
+        for (AudioPlugin* plugin : plugins) {
+            sum = sum * 31 + plugin->paramQueue.changes() + ((uint64_t)plugin->stateVersion() << 32);
+        }
+        return sum;
+    }
+
+    static bool same(const Entry& a, const Entry& b)
+    {
+        if (a.plugins.size() != b.plugins.size()) {
+            return false;
+        }
+        for (size_t i = 0; i < a.plugins.size(); i++) {
+            if (a.plugins[i].plugin != b.plugins[i].plugin || !a.plugins[i].values.same(b.plugins[i].values)
+                || a.plugins[i].state != b.plugins[i].state) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    void capture(const std::vector<AudioPlugin*>& plugins)
+    {
+        Entry* previous = entries.empty() ? NULL : &entries[current];
+        Entry entry;
+        for (size_t p = 0; p < plugins.size(); p++) {
+            AudioPlugin* plugin = plugins[p];
+            const PluginState* before = previous && p < previous->plugins.size() && previous->plugins[p].plugin == plugin ? &previous->plugins[p] : NULL;
+            PluginState state = { plugin };
+            if (plugin->readValues(values)) {
+                state.values = Values(values, before ? &before->values : NULL, [](float a, float b) { return a == b; });
+            }
+            size_t stateBytes = 0;
+            state.state = plugin->snapshotState(before ? before->state : NULL, stateBytes);
+            entry.bytes += state.values.bytesNotIn(before ? &before->values : NULL) + stateBytes + sizeof(PluginState);
+            entry.plugins.push_back(state);
+        }
+        if (previous && same(entry, *previous)) {
+            return;
+        }
+        // A change after an undo drops the redo
+        while (!entries.empty() && entries.size() > current + 1) {
+            bytes -= entries.back().bytes;
+            entries.pop_back();
+        }
+        bytes += entry.bytes;
+        entries.push_back(entry);
+        current = entries.size() - 1;
+        while (bytes > maxBytes && entries.size() > 1) {
+            bytes -= entries.front().bytes;
+            entries.pop_front();
+            current--;
+        }
+    }
+
+    void restore(const Entry& entry)
+    {
+        for (const PluginState& state : entry.plugins) {
+            AudioPlugin* plugin = state.plugin;
+            if (state.values.size() && plugin->readValues(values)) {
+                std::vector<float> restored;
+                state.values.copyTo(restored);
+                for (size_t i = 0; i < restored.size() && i < values.size(); i++) {
+                    if (restored[i] != values[i]) {
+                        plugin->getValue(i)->set(restored[i]);
+                    }
+                }
+            }
+            if (state.state) {
+                plugin->restoreState(state.state);
+            }
+        }
+    }
+
+public:
+    // Called regularly by a worker: add an entry once the changes of the plugins settled
+    void tick(const std::vector<AudioPlugin*>& plugins)
+    {
+        std::lock_guard<std::mutex> guard(m);
+        uint64_t next = signatureOf(plugins);
+        auto now = std::chrono::steady_clock::now();
+        if (next != signature) {
+            signature = next;
+            settling = true;
+            changedAt = now;
+        } else if ((settling || entries.empty()) && now - changedAt >= std::chrono::milliseconds(settleMs)) {
+            settling = false;
+            capture(plugins);
+        }
+    }
+
+    bool undo()
+    {
+        std::lock_guard<std::mutex> guard(m);
+        if (current == 0 || entries.empty()) {
+            return false;
+        }
+        restore(entries[--current]);
+        return true;
+    }
+
+    bool redo()
+    {
+        std::lock_guard<std::mutex> guard(m);
+        if (current + 1 >= entries.size()) {
+            return false;
+        }
+        restore(entries[++current]);
+        return true;
+    }
+
+    // E.g. when another clip is loaded, its state becoming the start of the history
+    void clear()
+    {
+        std::lock_guard<std::mutex> guard(m);
+        entries.clear();
+        current = 0;
+        bytes = 0;
+        settling = false;
+    }
+};
@@ -0,0 +1,170 @@
+#pragma once
+
+#include <cstdint>
+
+// Allocation of `MAX` voices for the synths, the voices themselves being owned by the plugin and referred to by
+// their index.
+//
+// The playing voices are kept in a compact array, so rendering and note off only go through them, and the free ones
+// in a stack, so starting a voice doesn't search for one. Only when all the voices are playing, one is stolen
+// depending on the policy.
+//
+// A playing voice is removed by swapping it with the last one, so when voices can end while rendering, iterate from
+// the last one:
+//     for (int i = allocator.count() - 1; i >= 0; i--) { uint8_t v = allocator.get(i); ... allocator.release(v); }
+template <uint8_t MAX>
+class VoiceAllocator {
+public:
+    enum Steal {
+        // Steal the voice started first
+        STEAL_OLDEST,
+        // Steal the voice with the lowest level, see `allocate()`
+        STEAL_QUIETEST,
+        // Restart the voice already playing the note if any, else steal the oldest one
+        STEAL_SAME_NOTE,
+    };
+
+protected:
+    uint8_t playing[MAX];
+    uint8_t playingCount = 0;
+    // Position of each voice in `playing`, MAX when free
+    uint8_t slot[MAX];
+    uint8_t freeVoices[MAX];
+    uint8_t freeCount = MAX;
+
+    int16_t notes[MAX];
+    uint64_t ages[MAX];
+    uint64_t counter = 0;
+
+    Steal policy;
+    // Voices allowed to start, see `setLimit()`
+    uint8_t limit = MAX;
+
+    void take(uint8_t voice, uint8_t note)
+    {
+        if (slot[voice] == MAX) {
+            slot[voice] = playingCount;
+            playing[playingCount++] = voice;
+        }
+        notes[voice] = note;
+        ages[voice] = counter++;
+    }
+
+    uint8_t oldest()
+    {
+        uint8_t voice = playing[0];
+        for (uint8_t i = 1; i < playingCount; i++) {
+            if (ages[playing[i]] < ages[voice]) {
+                voice = playing[i];
+            }
+        }
+        return voice;
+    }
+
+public:
+    VoiceAllocator(Steal policy = STEAL_OLDEST)
+        : policy(policy)
+    {
+        for (uint8_t v = 0; v < MAX; v++) {
+            // Voice 0 on top of the stack
+            freeVoices[v] = MAX - 1 - v;
+            slot[v] = MAX;
+            notes[v] = -1;
+            ages[v] = 0;
+        }
+    }
+
+    void setPolicy(Steal value)
+    {
+        policy = value;
+    }
+
+    // Cap the polyphony to `value` voices, e.g. to save CPU: the voices already playing above the cap finish
+    // normally, only the next notes steal a voice instead of starting a free one.
+    void setLimit(uint8_t value)
+    {
+        limit = value < 1 ? 1 : value > MAX ? MAX : value;
+    }
+
+    // Voice to play `note`, free or stolen. `level(voice)` is only called to steal the quietest voice.
+    template <typename Level>
+    uint8_t allocate(uint8_t note, Level level)
+    {
+        if (policy == STEAL_SAME_NOTE) {
+            for (uint8_t i = 0; i < playingCount; i++) {
+                if (notes[playing[i]] == note) {
+                    take(playing[i], note);
+                    return playing[i];
+                }
+            }
+        }
+        uint8_t voice;
+        if (freeCount > 0 && playingCount < limit) {
+            voice = freeVoices[--freeCount];
+        } else if (policy == STEAL_QUIETEST) {
+            voice = playing[0];
+            float quietest = level(voice);
+            for (uint8_t i = 1; i < playingCount; i++) {
+                float l = level(playing[i]);
+                if (l < quietest) {
+                    quietest = l;
+                    voice = playing[i];
+                }
+            }
+        } else {
+            voice = oldest();
+        }
+        take(voice, note);
+        return voice;
+    }
+
+    uint8_t allocate(uint8_t note)
+    {
+        return allocate(note, [](uint8_t) { return 0.0f; });
+    }
+
+    // Give back a voice that stopped playing
+    void release(uint8_t voice)
+    {
+        uint8_t i = slot[voice];
+        if (i == MAX) {
+            return;
+        }
+        uint8_t lastVoice = playing[--playingCount];
+        playing[i] = lastVoice;
+        slot[lastVoice] = i;
+        slot[voice] = MAX;
+        notes[voice] = -1;
+        freeVoices[freeCount++] = voice;
+    }
+
+    void releaseAll()
+    {
+        while (playingCount > 0) {
+            release(playing[playingCount - 1]);
+        }
+    }
+
+    // Number of playing voices
+    uint8_t count()
+    {
+        return playingCount;
+    }
+
+    // Index of the `i`th playing voice
+    uint8_t get(uint8_t i)
+    {
+        return playing[i];
+    }
+
+    bool isPlaying(uint8_t voice)
+    {
+        return slot[voice] != MAX;
+    }
+
+    // Note of the voice, -1 when free
+    int16_t getNote(uint8_t voice)
+    {
+        return notes[voice];
+    }
+};
@@ -0,0 +1,200 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <fcntl.h>
+#include <string>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+// WAV file mapped in memory, read without libsndfile: PCM 16, 24 and 32 bits and IEEE float 32 bits, little endian,
+// plain or WAVE_FORMAT_EXTENSIBLE. The samples of a float file can be used in place, straight from the page cache,
+// the other encodings being converted block by block.
+//
+// The mapping is only valid as long as the file is not truncated: a file replaced by another one (written elsewhere
+// and renamed) is fine, the mapping keeping the previous one, but a file rewritten in place while mapped is not.
+class WavFile {
+public:
+    enum Encoding {
+        UNSUPPORTED,
+        PCM16,
+        PCM24,
+        PCM32,
+        FLOAT32,
+    };
+
+    Encoding encoding = UNSUPPORTED;
+    uint16_t channels = 0;
+    uint32_t sampleRate = 0;
+    // Interleaved samples, not frames
+    uint64_t count = 0;
+
+protected:
+    void* mapping = MAP_FAILED;
+    size_t mappingSize = 0;
+    const uint8_t* samples = NULL;
+
+    static const uint16_t FORMAT_PCM = 1;
+    static const uint16_t FORMAT_FLOAT = 3;
+    static const uint16_t FORMAT_EXTENSIBLE = 0xfffe;
+    static const uint32_t BLOCK = 1024;
+
+    static uint16_t u16(const uint8_t* in)
+    {
+        return in[0] | (in[1] << 8);
+    }
+
+    static uint32_t u32(const uint8_t* in)
+    {
+        return in[0] | (in[1] << 8) | (in[2] << 16) | ((uint32_t)in[3] << 24);
+    }
+
+    bool parse()
+    {
+        const uint8_t* file = (const uint8_t*)mapping;
+        if (mappingSize < 12 || memcmp(file, "RIFF", 4) != 0 || memcmp(file + 8, "WAVE", 4) != 0) {
+            return false;
+        }
+        uint16_t format = 0;
+        uint16_t bits = 0;
+        size_t pos = 12;
+        while (pos + 8 <= mappingSize) {
+            const uint8_t* chunk = file + pos;
+            uint32_t size = u32(chunk + 4);
+            if (memcmp(chunk, "fmt ", 4) == 0 && size >= 16 && pos + 8 + size <= mappingSize) {
+                format = u16(chunk + 8);
+                channels = u16(chunk + 10);
+                sampleRate = u32(chunk + 12);
+                bits = u16(chunk + 22);
+                // The actual format is at the start of the sub format GUID
+                if (format == FORMAT_EXTENSIBLE && size >= 40) {
+                    format = u16(chunk + 32);
+                }
+            } else if (memcmp(chunk, "data", 4) == 0) {
+                // Files still being recorded may have a wrong size, only the bytes in the file are read
+                uint64_t bytes = std::min<uint64_t>(size, mappingSize - pos - 8);
+                samples = chunk + 8;
+                if (format == FORMAT_PCM && bits == 16) {
+                    encoding = PCM16;
+                } else if (format == FORMAT_PCM && bits == 24) {
+                    encoding = PCM24;
+                } else if (format == FORMAT_PCM && bits == 32) {
+                    encoding = PCM32;
+                } else if (format == FORMAT_FLOAT && bits == 32) {
+                    encoding = FLOAT32;
+                } else {
+                    return false;
+                }
+                count = bytes / (bits / 8) / std::max<uint16_t>(channels, 1) * channels;
+                return channels > 0 && sampleRate > 0;
+            }
+            // Chunks are padded to an even size
+            pos += 8 + size + (size & 1);
+        }
+        return false;
+    }
+
+public:
+    ~WavFile()
+    {
+        close();
+    }
+
+    // Map and parse the file, false if it is not a WAV file in one of the supported encodings
+    bool open(std::string path)
+    {
+        close();
+        int fd = ::open(path.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return false;
+        }
+        struct stat info;
+        if (fstat(fd, &info) != 0 || info.st_size < 44) {
+            ::close(fd);
+            return false;
+        }
+        mappingSize = info.st_size;
+        mapping = mmap(NULL, mappingSize, PROT_READ, MAP_SHARED, fd, 0);
+        ::close(fd);
+        if (mapping == MAP_FAILED) {
+            return false;
+        }
+        if (!parse()) {
+            close();
+            return false;
+        }
+        madvise(mapping, mappingSize, MADV_WILLNEED);
+        return true;
+    }
+
+    void close()
+    {
+        if (mapping != MAP_FAILED) {
+            munmap(mapping, mappingSize);
+        }
+        mapping = MAP_FAILED;
+        encoding = UNSUPPORTED;
+        samples = NULL;
+        count = 0;
+    }
+
+    // Samples of a float file, used in place, NULL for the other encodings or when they are not aligned
+    const float* floats()
+    {
+        return encoding == FLOAT32 && (uintptr_t)samples % alignof(float) == 0 ? (const float*)samples : NULL;
+    }
+
+    // Hand the mapping over, e.g. to the buffer using `floats()` in place, to be released with `unmap()`
+    void* release(size_t& size)
+    {
+        void* released = mapping;
+        size = mappingSize;
+        mapping = MAP_FAILED;
+        return released;
+    }
+
+    static void unmap(void* memory, size_t size)
+    {
+        if (memory != MAP_FAILED && memory != NULL) {
+            munmap(memory, size);
+        }
+    }
+
+    // Convert up to `max` samples to float, return how many were read. The blocks are copied to aligned buffers
+    // first, the conversion loops being vectorized by the compiler.
+    uint64_t read(float* out, uint64_t max)
+    {
+        uint64_t total = std::min(count, max);
+        if (encoding == FLOAT32) {
+            memcpy(out, samples, total * sizeof(float));
+            return total;
+        }
+        for (uint64_t start = 0; start < total; start += BLOCK) {
+            uint32_t n = std::min<uint64_t>(BLOCK, total - start);
+            float* to = out + start;
+            if (encoding == PCM16) {
+                int16_t block[BLOCK];
+                memcpy(block, samples + start * 2, n * 2);
+                for (uint32_t i = 0; i < n; i++) {
+                    to[i] = block[i] * (1.0f / 32768.0f);
+                }
+            } else if (encoding == PCM32) {
+                int32_t block[BLOCK];
+                memcpy(block, samples + start * 4, n * 4);
+                for (uint32_t i = 0; i < n; i++) {
+                    to[i] = block[i] * (1.0f / 2147483648.0f);
+                }
+            } else if (encoding == PCM24) {
+                const uint8_t* in = samples + start * 3;
+                for (uint32_t i = 0; i < n; i++) {
+                    // Into the top 24 bits, the shift keeping the sign
+                    int32_t value = (int32_t)(((uint32_t)in[i * 3] << 8) | ((uint32_t)in[i * 3 + 1] << 16) | ((uint32_t)in[i * 3 + 2] << 24)) >> 8;
+                    to[i] = value * (1.0f / 8388608.0f);
+                }
+            }
+        }
+        return total;
+    }
+};
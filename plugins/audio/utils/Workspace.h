@@ -11,7 +11,7 @@ The manager designates a specific main folder on the host system where all indiv
 The manager provides controls for manipulating these environments:
 *   **Creation (`create`):** It can quickly set up a new, empty workspace by creating a dedicated folder for it.
 *   **Deletion (`remove`):** It allows the user to completely erase an environment and all its contents from the file system.
-*   **Switching (`setCurrent`):** This is the key function for activating a profile. It first ensures the desired workspace exists, and then it immediately updates the special configuration file, making the selected profile the default for future application launches.
+*   **Switching (`setCurrent`):** This is the key function for activating a profile. It first ensures the desired workspace exists, and then it updates the special configuration file, making the selected profile the default for future application launches. The file is written in the background by the `FileWriter`, and flushed before being read again.
 
 **3. Status and Tracking:**
 The manager maintains simple internal records:
@@ -19,11 +19,16 @@ The manager maintains simple internal records:
 *   It provides a function (`getCurrentPath`) to quickly return the full computer address (path) where the files for the active workspace are located.
 *   A counter tracks internal changes, allowing other parts of the application to know when a new workspace has been added and needs updating.
 
+**4. Storage in RAM:**
+When the `WORKSPACE_RAM` environment variable is set, `init` swaps the folder for its mirror in RAM (see `WorkspaceMirror`), so every read and write stays off the SD card, the changed files being written back in batches.
+
 sha: 8b8f18827fd2c842f47d99dc63544ba0daca6ba10758a2e81b8a925f6c507b48 
 */
 #pragma once
 
 #include "host/constants.h"
+#include "plugins/audio/utils/FileWriter.h"
+#include "plugins/audio/utils/WorkspaceMirror.h"
 
 #include <filesystem>
 #include <fstream>
@@ -46,13 +51,13 @@ public:
     {
         create(workspaceName);
         std::filesystem::create_directories(folder);
-        std::ofstream file(currentCfg);
-        file << workspaceName;
-        file.close();
+        FileWriter::get().write(currentCfg, workspaceName);
     }
 
     void remove(std::string workspaceName)
     {
+        // Else a clip still pending would be written in the deleted folder
+        FileWriter::get().cancel(folder + "/" + workspaceName + "/");
         std::filesystem::remove_all(folder + "/" + workspaceName);
     }
 
@@ -66,8 +71,11 @@ public:
 
     void init()
     {
+        // In RAM when enabled, see WorkspaceMirror
+        folder = WorkspaceMirror::get().open(folder);
         std::filesystem::create_directories(folder);
         currentCfg = folder + "/current.cfg";
+        FileWriter::get().flush(currentCfg);
         if (std::filesystem::exists(currentCfg)) {
             std::ifstream file(currentCfg);
             std::string line;
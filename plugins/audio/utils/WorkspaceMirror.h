@@ -0,0 +1,331 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <csignal>
+#include <cstdlib>
+#include <fcntl.h>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <poll.h>
+#include <sstream>
+#include <string>
+#include <sys/stat.h>
+#include <thread>
+#include <unistd.h>
+#include <vector>
+
+#include "helpers/processSingleton.h"
+#include "log.h"
+#include "plugins/audio/utils/FileWriter.h"
+
+// Workspaces kept in RAM, e.g. in tmpfs, and written back to the SD card in batches, so the autosaves and the clips
+// saved while playing never wait on the card, and the card doesn't wear out on units running all day.
+//
+// Enabled with the environment variable `WORKSPACE_RAM`, the folder in RAM holding the mirrors, e.g. `/dev/shm/zic`.
+// `open()` gives the mirror of a workspace folder, used instead of it for all reads and writes. The files changed in
+// the mirror are written back to the card by a background thread, every `WORKSPACE_SYNC_MS` (10000 ms by default),
+// when the playback stops, and when the process is stopped, by leaving or by SIGTERM, SIGINT or SIGHUP. Each file is
+// written like the FileWriter does (temporary file, synced, renamed over the previous one) and keeps the date of the
+// mirror, so a file is changed when its date or its size differs from the card.
+//
+// On boot, the mirror is empty and is filled from the card. A mirror still there when the process starts is the one
+// of a previous process, possibly one that didn't stop cleanly: both sides are merged, the newest version of each
+// file winning, before the mirror is used again.
+class WorkspaceMirror {
+protected:
+    struct Folder {
+        std::string source;
+        std::string mirror;
+    };
+
+    std::string root;
+    std::chrono::milliseconds interval = std::chrono::milliseconds(10000);
+
+    std::mutex mtx;
+    std::vector<Folder> folders;
+    // Only one write back at a time, from the worker or from `sync()`
+    std::mutex syncMtx;
+    std::thread worker;
+    bool running = true;
+    // Wakes the worker: `s` to write back, `q` from a stop signal
+    int wakeFds[2] = { -1, -1 };
+    static inline std::atomic<int> stopSignal = 0;
+    // The write end of the pipe, for the signal handler
+    static inline std::atomic<int> signalFd = -1;
+
+    static std::string markerPath(const std::string& mirror)
+    {
+        return mirror + "/.mirror";
+    }
+
+    // The files being written by the FileWriter
+    static bool isTemporary(const std::filesystem::path& path)
+    {
+        return path.extension() == ".tmp";
+    }
+
+    static bool stat(const std::filesystem::path& path, struct stat& info)
+    {
+        return ::stat(path.c_str(), &info) == 0;
+    }
+
+    static bool isSame(const struct stat& a, const struct stat& b)
+    {
+        return a.st_size == b.st_size && a.st_mtim.tv_sec == b.st_mtim.tv_sec && a.st_mtim.tv_nsec == b.st_mtim.tv_nsec;
+    }
+
+    static bool isNewer(const struct stat& a, const struct stat& b)
+    {
+        return a.st_mtim.tv_sec != b.st_mtim.tv_sec ? a.st_mtim.tv_sec > b.st_mtim.tv_sec : a.st_mtim.tv_nsec > b.st_mtim.tv_nsec;
+    }
+
+    // Written atomically, with the date of the original, so both are seen as the same afterwards
+    static bool copy(const std::filesystem::path& from, const std::filesystem::path& to, const struct stat& info)
+    {
+        std::ifstream file(from, std::ios::binary);
+        if (!file.is_open()) {
+            return false;
+        }
+        std::stringstream content;
+        content << file.rdbuf();
+        std::error_code error;
+        std::filesystem::create_directories(to.parent_path(), error);
+        if (!FileWriter::writeNow(to, content.str())) {
+            return false;
+        }
+        struct timespec times[2] = { info.st_atim, info.st_mtim };
+        utimensat(AT_FDCWD, to.c_str(), times, 0);
+        return true;
+    }
+
+    // Copy the files of `from` differing from `to`, only the newer ones if `newerOnly` is set. Return the number of
+    // files copied, -1 if one of them could not be.
+    static int copyChanged(const std::string& from, const std::string& to, bool newerOnly)
+    {
+        int copied = 0;
+        std::error_code error;
+        for (auto it = std::filesystem::recursive_directory_iterator(from, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            std::filesystem::path relative = std::filesystem::relative(it->path(), from);
+            if (it->is_directory()) {
+                std::filesystem::create_directories(to / relative, error);
+                continue;
+            }
+            if (isTemporary(it->path()) || relative == ".mirror") {
+                continue;
+            }
+            struct stat source, target;
+            if (!stat(it->path(), source)) {
+                continue;
+            }
+            bool exists = stat(to / relative, target);
+            if (exists && (isSame(source, target) || (newerOnly && !isNewer(source, target)))) {
+                continue;
+            }
+            if (!copy(it->path(), to / relative, source)) {
+                logWarn("WorkspaceMirror: unable to copy %s", it->path().c_str());
+                return -1;
+            }
+            copied++;
+        }
+        return error ? -1 : copied;
+    }
+
+    // Remove from `to` what is not in `from` anymore, e.g. a deleted workspace
+    static int removeMissing(const std::string& from, const std::string& to)
+    {
+        std::vector<std::filesystem::path> missing;
+        std::error_code error;
+        for (auto it = std::filesystem::recursive_directory_iterator(to, error); it != std::filesystem::recursive_directory_iterator(); it.increment(error)) {
+            std::filesystem::path relative = std::filesystem::relative(it->path(), to);
+            if (!isTemporary(it->path()) && !std::filesystem::exists(from / relative)) {
+                missing.push_back(it->path());
+                it.disable_recursion_pending();
+            }
+        }
+        for (auto& path : missing) {
+            std::filesystem::remove_all(path, error);
+        }
+        return missing.size();
+    }
+
+    void writeBack()
+    {
+        // The files still queued are written to the mirror first
+        FileWriter::get().flush();
+        std::vector<Folder> current;
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            current = folders;
+        }
+        std::lock_guard<std::mutex> guard(syncMtx);
+        for (Folder& folder : current) {
+            int copied = copyChanged(folder.mirror, folder.source, false);
+            // Not before everything is copied, a failing card would else lose files
+            int removed = copied < 0 ? 0 : removeMissing(folder.mirror, folder.source);
+            if (copied > 0 || removed > 0) {
+                logDebug("WorkspaceMirror: %d files written back and %d removed in %s", copied, removed, folder.source.c_str());
+            }
+        }
+    }
+
+    static void onSignal(int signal)
+    {
+        stopSignal = signal;
+        if (signalFd >= 0) {
+            char wake = 'q';
+            (void)!::write(signalFd, &wake, 1);
+        }
+    }
+
+    // Only for the signals nobody handles yet
+    void catchSignals()
+    {
+        for (int signal : { SIGTERM, SIGINT, SIGHUP }) {
+            struct sigaction previous;
+            if (sigaction(signal, NULL, &previous) == 0 && previous.sa_handler == SIG_DFL) {
+                struct sigaction action = {};
+                action.sa_handler = onSignal;
+                sigemptyset(&action.sa_mask);
+                action.sa_flags = SA_RESTART;
+                sigaction(signal, &action, NULL);
+            }
+        }
+    }
+
+    void workerLoop()
+    {
+        struct pollfd wake = { wakeFds[0], POLLIN, 0 };
+        while (true) {
+            int ready = poll(&wake, 1, (int)interval.count());
+            bool stop = false;
+            if (ready > 0) {
+                char buffer[16];
+                ssize_t count = ::read(wakeFds[0], buffer, sizeof(buffer));
+                for (ssize_t i = 0; i < count; i++) {
+                    stop = stop || buffer[i] == 'q';
+                }
+            }
+            {
+                std::lock_guard<std::mutex> guard(mtx);
+                if (!running) {
+                    return;
+                }
+            }
+            writeBack();
+            if (stop) {
+                // Stopped like it would have been without the mirror
+                int signal = stopSignal;
+                std::signal(signal, SIG_DFL);
+                raise(signal);
+            }
+        }
+    }
+
+    friend WorkspaceMirror& processSingleton<WorkspaceMirror>();
+
+    WorkspaceMirror()
+    {
+        // Created first so it is destroyed last, the last write back flushing it
+        FileWriter::get();
+        const char* value = getenv("WORKSPACE_RAM");
+        if (value && value[0] != '\0') {
+            logInfo("Env variable workspace in RAM: %s", value);
+            root = value;
+        }
+        const char* sync = getenv("WORKSPACE_SYNC_MS");
+        if (sync && sync[0] != '\0') {
+            logInfo("Env variable workspace sync interval: %s ms", sync);
+            interval = std::chrono::milliseconds(atol(sync));
+        }
+    }
+
+public:
+    static WorkspaceMirror& get()
+    {
+        return processSingleton<WorkspaceMirror>();
+    }
+
+    ~WorkspaceMirror()
+    {
+        if (!worker.joinable()) {
+            return;
+        }
+        {
+            std::lock_guard<std::mutex> guard(mtx);
+            running = false;
+        }
+        char wake = 's';
+        (void)!::write(wakeFds[1], &wake, 1);
+        worker.join();
+        writeBack();
+    }
+
+    // Folder to use for the workspaces of `folder`: its mirror in RAM, filled from it the first time, or `folder`
+    // itself when the mirror is not enabled or could not be filled
+    std::string open(std::string folder)
+    {
+        if (root.empty()) {
+            return folder;
+        }
+        std::lock_guard<std::mutex> guard(mtx);
+        std::error_code error;
+        std::string source = std::filesystem::absolute(folder, error).lexically_normal().string();
+        for (Folder& known : folders) {
+            if (known.source == source || known.mirror == folder) {
+                return known.mirror;
+            }
+        }
+
+        std::string name = source;
+        std::replace(name.begin(), name.end(), '/', '_');
+        std::string mirror = root + "/" + name;
+        std::filesystem::create_directories(source, error);
+        if (std::filesystem::exists(markerPath(mirror))) {
+            // Left by a previous process, maybe with files it could not write back, the newest version of each file wins
+            logInfo("WorkspaceMirror: merging %s with %s", mirror.c_str(), source.c_str());
+            if (copyChanged(mirror, source, true) < 0 || copyChanged(source, mirror, true) < 0) {
+                logWarn("WorkspaceMirror: unable to recover %s, using %s", mirror.c_str(), source.c_str());
+                return folder;
+            }
+        } else {
+            // The marker last, so a mirror half filled is filled again
+            std::filesystem::remove_all(mirror, error);
+            std::filesystem::create_directories(mirror, error);
+            if (error || copyChanged(source, mirror, false) < 0 || !FileWriter::writeNow(markerPath(mirror), source)) {
+                logWarn("WorkspaceMirror: unable to fill %s, using %s", mirror.c_str(), source.c_str());
+                std::filesystem::remove_all(mirror, error);
+                return folder;
+            }
+        }
+        folders.push_back({ source, mirror });
+        logInfo("WorkspaceMirror: %s mirrored in %s", source.c_str(), mirror.c_str());
+
+        if (!worker.joinable() && pipe2(wakeFds, O_CLOEXEC | O_NONBLOCK) == 0) {
+            signalFd = wakeFds[1];
+            catchSignals();
+            worker = std::thread([this] { workerLoop(); });
+            pthread_setname_np(worker.native_handle(), "workspace_sync");
+        }
+        return mirror;
+    }
+
+    // Write the changed files back without waiting for the interval, e.g. when the playback stops. Never waits.
+    void requestSync()
+    {
+        if (wakeFds[1] >= 0) {
+            char wake = 's';
+            (void)!::write(wakeFds[1], &wake, 1);
+        }
+    }
+
+    // Write the changed files back right away, on the calling thread
+    void sync()
+    {
+        if (!folders.empty()) {
+            writeBack();
+        }
+    }
+};
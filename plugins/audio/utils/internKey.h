@@ -0,0 +1,16 @@
+#pragma once
+
+#include <mutex>
+#include <string>
+#include <unordered_set>
+
+// Keys of the values, kept once: all the tracks using the same plugin share them, each value only holding a
+// reference. The plugins are loaded by several workers at once, so the pool is guarded.
+inline const std::string& internKey(const std::string& key)
+{
+    static std::mutex mtx;
+    static std::unordered_set<std::string> keys;
+    std::lock_guard<std::mutex> guard(mtx);
+    // The elements of an unordered_set never move, so the reference stays valid
+    return *keys.insert(key).first;
+}
@@ -27,12 +27,10 @@ void valMMfilterCutoff(Val::CallbackProps& p, MMfilter& filter)
     p.val.setFloat(p.value);
     float amount = p.val.pct() * 2 - 1.0f;
 
-    char strBuf[128];
     filter.setCutoff(amount);
     if (amount > 0.0) {
-        sprintf(strBuf, "HP %d%%", (int)(amount * 100));
+        p.val.setNumber((int)(amount * 100), 0, "%", "HP ");
     } else {
-        sprintf(strBuf, "LP %d%%", (int)((-amount) * 100));
+        p.val.setNumber((int)((-amount) * 100), 0, "%", "LP ");
     }
-    p.val.setString(strBuf);
 }
@@ -18,6 +18,7 @@ sha: b61bf9b51c4f0ce1d0bbc3f39a159b3315eaab7209e9fb12280f3de85f78dca7
 #ifndef _MAPPING_INTERFACE_H_
 #define _MAPPING_INTERFACE_H_
 
+#include <atomic>
 #include <functional>
 #include <stdint.h>
 #include <string>
@@ -52,7 +53,10 @@ public:
         GraphPointFn graph = NULL;
     };
 
-    virtual std::string key() = 0;
+    // Slot of the value in ValueChanges once the UI subscribed to it, -1 before, see helpers/valueChanges.h
+    std::atomic<int32_t> changeSlot = -1;
+
+    virtual const std::string& key() = 0;
     virtual Props& props() = 0;
     virtual std::string label() = 0;
     virtual inline float get() = 0;
@@ -61,9 +65,11 @@ public:
     virtual void setPct(float pct) = 0;
     virtual std::string string() = 0;
     virtual void set(float value, void* data = NULL) = 0;
-    virtual void setOnUpdateCallback(std::function<void(float, void*)> callback, void* data) = 0;
     virtual void checkForUpdate() = 0;
     virtual void copy(ValueInterface* val) { };
+    // Parameter lock, see Val::lock(), ignored by the values not supporting it
+    virtual void lock(float value) { };
+    virtual void unlock() { };
 
     bool hasType(ValueType type)
     {
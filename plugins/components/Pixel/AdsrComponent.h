@@ -81,9 +81,8 @@ public:
         /*md md_config_end */
     }
 
-    std::vector<Point> getPoints() override
+    void getPoints(std::vector<Point>& points) override
     {
-        std::vector<Point> points = {};
         points.push_back({ 0, waveformHeight });
         // int a = encoders[0].value->pct() * size.w * 0.30;
         // 1 - Math.pow(1 - 0.1, 2) // to make lower value larger and higher value smaller 0.1 = 0.19 & 0.9 = 0.99
@@ -96,7 +95,6 @@ public:
         int r = (1 - pow(1 - encoders[3].value->pct(), 10)) * size.w * 0.32;
         points.push_back({ (int)(size.w - r), (int)(waveformHeight - encoders[2].value->pct() * waveformHeight) });
         points.push_back({ size.w, waveformHeight });
-        return points;
     }
 
     void onEncoder(int8_t id, int8_t direction) override
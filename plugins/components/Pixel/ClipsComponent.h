@@ -54,6 +54,7 @@ protected:
     ValueInterface* valClip = NULL;
     uint8_t loadClipDataId = -1;
     uint8_t loadClipNextDataId = -1;
+    uint8_t launchClipDataId = -1;
     uint8_t saveClipDataId = -1;
     uint8_t deleteClipDataId = -1;
     uint8_t clipExistsDataId = -1;
@@ -115,7 +116,8 @@ protected:
                     pluginSerialize->data(loadClipDataId, (void*)&idAndBank);
                     redirect();
                 } else if (valSeqStatus->get() == 1) {
-                    pluginSerialize->data(loadClipNextDataId, (void*)&idAndBank);
+                    // Quantized by the QUANTIZE value of the serializer, on the next loop by default
+                    pluginSerialize->data(launchClipDataId, (void*)&idAndBank);
                 }
             } else {
                 pluginSerialize->data(loadClipDataId, (void*)&idAndBank);
@@ -306,6 +308,7 @@ public:
         deleteClipDataId = pluginSerialize->getDataId("DELETE_CLIP");
         loadClipDataId = pluginSerialize->getDataId("LOAD_CLIP");
         loadClipNextDataId = pluginSerialize->getDataId("LOAD_CLIP_NEXT");
+        launchClipDataId = pluginSerialize->getDataId("LAUNCH_CLIP");
         clipExistsDataId = pluginSerialize->getDataId("CLIP_EXISTS");
         int nextClip = -1;
         nextClipToPlay = (int*)pluginSerialize->data(loadClipNextDataId, &nextClip);
@@ -350,40 +353,81 @@ public:
         logDebug("ClipsComponent::resize() size.w=%d size.h=%d visibleCount=%d clipW=%d", size.w, size.h, visibleCount, clipW);
     }
 
+    // What was drawn in each cell, so only the cells changing are drawn again, e.g. the clip playing
+    struct Cell {
+        std::string label;
+        bool highlighted = false;
+        bool exists = false;
+        // 0 none, 1 playing, 2 playing next
+        uint8_t marker = 0;
+
+        bool operator==(const Cell& other) const
+        {
+            return label == other.label && highlighted == other.highlighted && exists == other.exists && marker == other.marker;
+        }
+    };
+    std::vector<Cell> drawnCells;
+    bool drawnPopup = false;
+
+    Cell getCell(int i, int playingId)
+    {
+        Cell cell;
+        if (bankToggle) {
+            cell.label = std::string(1, 'A' + i + addIndex);
+            cell.highlighted = cell.label == bank;
+            cell.exists = true;
+            return cell;
+        }
+        int id = i + startBankIndex + addIndex;
+        cell.label = bank + std::to_string(i + 1 + addIndex);
+        cell.highlighted = id == playingId;
+        cell.exists = clipExists(id);
+        if (*isPlaying) {
+            if (id == *nextClipToPlay) {
+                cell.marker = 2;
+            } else if (valSeqStatus && id == playingId) {
+                cell.marker = valSeqStatus->get() == 1 ? 1 : (valSeqStatus->get() == 2 ? 2 : 0);
+            }
+        }
+        return cell;
+    }
+
+    void renderCell(int i, Cell& cell)
+    {
+        Point center = { (int)(clipW * 0.5), (int)((size.h - fontSize - 1) * 0.5) };
+        Point pos = { relativePosition.x + i * clipW, relativePosition.y };
+        draw.filledRect(pos, { clipW - 2, size.h }, { cell.highlighted ? playingClipBgColor : clipBgColor });
+        Color& color = cell.exists ? textColor : textMissingColor;
+        draw.textCentered({ pos.x + center.x, pos.y + center.y }, cell.label, fontSize, { color, .maxWidth = clipW });
+        if (cell.marker) {
+            draw.filledRect({ pos.x + 2, pos.y + 2 }, { 3, 3 }, { cell.marker == 1 ? playColor : playNextColor });
+        }
+    }
+
     void render() override
     {
-        draw.filledRect(relativePosition, size, { bgColor });
         int playingId = valClip ? valClip->get() : -1;
 
-        Point center = { (int)(clipW * 0.5), (int)((size.h - fontSize - 1) * 0.5) };
-        if (bankToggle) {
+        // The popup is drawn over the cells, everything is drawn again while it is shown
+        bool popup = popupMessage > 0;
+        if (renderAll || popup || drawnPopup || drawnCells.size() != visibleCount) {
+            renderAll = false;
+            drawnCells.assign(visibleCount, Cell());
+            draw.filledRect(relativePosition, size, { bgColor });
             for (int i = 0; i < visibleCount; i++) {
-                Point pos = { relativePosition.x + i * clipW, relativePosition.y };
-                std::string bankItem = std::string(1, 'A' + i + addIndex);
-                draw.filledRect({ relativePosition.x + i * clipW, relativePosition.y }, { clipW - 2, size.h }, { bankItem == bank ? playingClipBgColor : clipBgColor });
-                draw.textCentered({ pos.x + center.x, pos.y + center.y }, bankItem, fontSize, { textColor, .maxWidth = clipW });
+                drawnCells[i] = getCell(i, playingId);
+                renderCell(i, drawnCells[i]);
             }
         } else {
             for (int i = 0; i < visibleCount; i++) {
-                int id = i + startBankIndex + addIndex;
-                Point pos = { relativePosition.x + i * clipW, relativePosition.y };
-                draw.filledRect({ relativePosition.x + i * clipW, relativePosition.y }, { clipW - 2, size.h }, { id == playingId ? playingClipBgColor : clipBgColor });
-                Color& color = clipExists(id) ? textColor : textMissingColor;
-                draw.textCentered({ pos.x + center.x, pos.y + center.y }, bank + std::to_string(i + 1 + addIndex), fontSize, { color, .maxWidth = clipW });
-
-                if (*isPlaying) {
-                    if (id == *nextClipToPlay) {
-                        draw.filledRect({ pos.x + 2, pos.y + 2 }, { 3, 3 }, { playNextColor });
-                    } else if (valSeqStatus && id == playingId) {
-                        if (valSeqStatus->get() == 1) {
-                            draw.filledRect({ pos.x + 2, pos.y + 2 }, { 3, 3 }, { playColor });
-                        } else if (valSeqStatus->get() == 2) {
-                            draw.filledRect({ pos.x + 2, pos.y + 2 }, { 3, 3 }, { playNextColor });
-                        }
-                    }
+                Cell cell = getCell(i, playingId);
+                if (!(cell == drawnCells[i])) {
+                    drawnCells[i] = cell;
+                    renderCell(i, cell);
                 }
             }
         }
+        drawnPopup = popup;
 
         if (popupMessage > 0) {
             // int h = fontSize < size.h ? fontSize : size.h;
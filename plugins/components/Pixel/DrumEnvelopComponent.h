@@ -75,10 +75,13 @@ protected:
         }
     }
 
+    // Kept between the renderings, so drawing the envelop while it is edited does not allocate
+    std::vector<Point> points;
+
     void renderEnvelop()
     {
         Data data = envData->at(0);
-        std::vector<Point> points;
+        points.clear();
         points.push_back({ envPosition.x, envPosition.y + envelopHeight });
         if (data.modulation != 0.0f) {
             points.push_back({ envPosition.x, (int)(envPosition.y + envelopHeight - envelopHeight * data.modulation) });
@@ -190,17 +193,28 @@ public:
     void render() override
     {
         envPosition = { relativePosition.x, relativePosition.y + 10 };
-        draw.filledRect(relativePosition, size, { bgColor });
-
-        if (envData) {
-            currentstep = *(int8_t*)plugin->data(currentStepDataId);
-            currentMod = *(float*)plugin->data(modDataId);
-            currentTimeMs = *(uint16_t*)plugin->data(timeDataId);
+        if (!envData) {
+            draw.filledRect(relativePosition, size, { bgColor });
+            return;
+        }
 
-            renderEnvelop();
-            renderEditStep();
-            renderTitles();
+        // The envelop is drawn again only when one of its points changed
+        uint32_t version = envData->size();
+        for (Data& data : *envData) {
+            version = version * 31 + std::hash<float>()(data.time);
+            version = version * 31 + std::hash<float>()(data.modulation);
         }
+        renderLayer(version, [&]() {
+            draw.filledRect(relativePosition, size, { bgColor });
+            renderEnvelop();
+        });
+
+        currentstep = *(int8_t*)plugin->data(currentStepDataId);
+        currentMod = *(float*)plugin->data(modDataId);
+        currentTimeMs = *(uint16_t*)plugin->data(timeDataId);
+
+        renderEditStep();
+        renderTitles();
     }
 
     void onEncoder(int8_t id, int8_t direction) override
@@ -0,0 +1,121 @@
+#pragma once
+
+#include "host/DspLoad.h"
+#include "plugins/components/component.h"
+#include "plugins/components/utils/color.h"
+
+#include <string>
+
+/*md
+## DspLoad
+
+DspLoad component is used to display how much of the audio block deadline is spent in each track, as a bar graph. The bar is the average load, the thin line the p99 and the dot the maximum.
+
+Requires the host config `"dspLoad": true`.
+*/
+
+class DspLoadComponent : public Component {
+protected:
+    Color bgColor;
+    Color barColor;
+    Color warningColor;
+    Color p99Color;
+    Color textColor;
+
+    int fontSize = 8;
+    unsigned long refreshMs = 500;
+    unsigned long lastRender = 0;
+
+    DspLoad* dspLoad = NULL;
+
+    void renderBar(int y, int h, std::string label, DspLoad::Stats& stats)
+    {
+        int labelW = 24;
+        int barW = size.w - labelW;
+        int x = relativePosition.x + labelW;
+
+        draw.text({ relativePosition.x, y }, label, fontSize, { textColor });
+        draw.filledRect({ x, y }, { barW, h }, { darken(barColor, 0.7) });
+
+        float avg = stats.avg > 100.0f ? 100.0f : stats.avg;
+        draw.filledRect({ x, y }, { (int)(barW * avg / 100.0f), h }, { stats.p99 >= 90.0f ? warningColor : barColor });
+
+        float p99 = stats.p99 > 100.0f ? 100.0f : stats.p99;
+        int p99X = x + (int)((barW - 1) * p99 / 100.0f);
+        draw.line({ p99X, y }, { p99X, y + h - 1 }, { p99Color });
+
+        float max = stats.max > 100.0f ? 100.0f : stats.max;
+        int maxX = x + (int)((barW - 1) * max / 100.0f);
+        draw.filledRect({ maxX - 1, y + h / 2 - 1 }, { 2, 2 }, { stats.max >= 100.0f ? warningColor : p99Color });
+    }
+
+public:
+    DspLoadComponent(ComponentInterface::Props props)
+        : Component(props)
+        , bgColor(styles.colors.background)
+        , barColor(styles.colors.primary)
+        , warningColor(styles.colors.secondary)
+        , p99Color(styles.colors.white)
+        , textColor(styles.colors.text)
+    {
+        jobRendering = [this](unsigned long now) {
+            if (now - lastRender > refreshMs) {
+                lastRender = now;
+                renderNext();
+            }
+        };
+
+        /*md md_config:DspLoad */
+        nlohmann::json& config = props.config;
+
+        /// The background color.
+        bgColor = draw.getColor(config["bgColor"], bgColor); //eg: "#000000"
+
+        /// The color of the load bars.
+        barColor = draw.getColor(config["barColor"], barColor); //eg: "#4fbfc5"
+
+        /// The color of the bar when the track is close to the deadline.
+        warningColor = draw.getColor(config["warningColor"], warningColor); //eg: "#ff8a94"
+
+        /// The color of the p99 and max markers.
+        p99Color = draw.getColor(config["p99Color"], p99Color); //eg: "#ffffff"
+
+        /// The color of the track labels.
+        textColor = draw.getColor(config["textColor"], textColor); //eg: "#ffffff"
+
+        /// The font size of the track labels.
+        fontSize = config.value("fontSize", fontSize); //eg: 8
+
+        /// The refresh interval in milliseconds.
+        refreshMs = config.value("refreshMs", refreshMs); //eg: 500
+
+        /*md md_config_end */
+    }
+
+    void render() override
+    {
+        draw.filledRect(relativePosition, size, { bgColor });
+
+        // Stats are only available once the audio loop started
+        if (dspLoad == NULL && getAudioPluginHandler != NULL) {
+            AudioPluginHandlerInterface* host = getAudioPluginHandler();
+            dspLoad = (DspLoad*)host->data(host->getDataId("DSP_LOAD"));
+        }
+        if (dspLoad == NULL) {
+            draw.text({ relativePosition.x, relativePosition.y }, "DSP load disabled", fontSize, { textColor });
+            return;
+        }
+
+        int rows = dspLoad->tracks.size() + 1;
+        int h = size.h / rows - 1;
+        if (h < 2) {
+            h = 2;
+        }
+        int y = relativePosition.y;
+        renderBar(y, h, "All", dspLoad->block.stats);
+        for (DspLoad::TrackLoad& track : dspLoad->tracks) {
+            y += h + 1;
+            renderBar(y, h, std::to_string(track.id), track.total.stats);
+        }
+    }
+};
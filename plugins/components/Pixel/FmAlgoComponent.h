@@ -109,10 +109,20 @@ public:
     void render()
     {
         // printf("updated position %d value=%f\n", dataId, value->get());
-        draw.filledRect(relativePosition, size, { background });
-
         bool(*algo)[3] = (bool(*)[3])plugin->data(dataId);
 
+        // Drawn again only when the algorithm changed
+        uint32_t version = 0;
+        for (int i = 0; i < 9; i++) {
+            version |= algo[i / 3][i % 3] << i;
+        }
+        renderLayer(version, [&]() { renderAlgo(algo); });
+    }
+
+    void renderAlgo(bool (*algo)[3])
+    {
+        draw.filledRect(relativePosition, size, { background });
+
         // draw modulation link
         if (algo[0][0]) // 1 to 2
         {
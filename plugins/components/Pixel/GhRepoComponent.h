@@ -3,12 +3,11 @@ This code defines a specialized user interface element, called a "GitHub Reposit
 
 **How it Works:**
 
-This component is designed to be highly dynamic. Instead of relying purely on application settings, it uses underlying system commands (like a terminal or command prompt) to interact with the Git version control system.
+This component is designed to be highly dynamic. Instead of relying purely on application settings, it reads the configuration of the Git version control system in the background, every couple of seconds at most, without blocking the screen.
 
-1.  **System Query:** The component runs a hidden command to ask the operating system: "What is the internet address (remote origin URL) for the files located in the project's `data` folder?"
-2.  **Output Capture:** It captures the response from this command (e.g., the raw GitHub URL).
-3.  **Cleanup:** It then processes this raw address, removing unnecessary technical parts like "github.com," leading slashes, and the standard ".git" ending. This ensures the user only sees a clean, readable repository name (like `username/projectname`).
-4.  **Display:** Finally, the component draws a colored box and displays the detected repository name on the screen.
+1.  **Git Query:** The component reads the internet address (remote origin URL) of the files located in the project's `data` folder from its Git configuration.
+2.  **Cleanup:** It then processes this raw address, removing unnecessary technical parts like "github.com," leading slashes, and the standard ".git" ending. This ensures the user only sees a clean, readable repository name (like `username/projectname`).
+3.  **Display:** Finally, the component draws a colored box and displays the detected repository name on the screen.
 
 The appearance of this display—including background color, text color, font, and text size—is fully customizable through its settings. This component ensures that users always have immediate visual confirmation of which GitHub repository context they are currently working in.
 
@@ -16,11 +15,11 @@ sha: 2a73fe392e1a5dc535d215ffee409aab1b03f02fb364711d9a77f4fe9f2366f1
 */
 #pragma once
 
+#include "helpers/gitRemote.h"
 #include "plugins/components/component.h"
 #include "plugins/components/utils/color.h"
 
-#include <array>
-#include <cstdio>
+#include <chrono>
 #include <cstring>
 #include <memory>
 #include <string>
@@ -40,40 +39,18 @@ class GhRepoComponent : public Component {
 
     std::string repoPath = "No repo";
 
-    // --- Simple helper to run shell commands and capture output ---
-    static std::string execCmd(const char* cmd)
-    {
-        std::array<char, 256> buffer;
-        std::string result;
-
-        FILE* pipe = popen(cmd, "r");
-        if (!pipe)
-            return "";
-        while (fgets(buffer.data(), buffer.size(), pipe) != nullptr) {
-            result += buffer.data();
-        }
-        pclose(pipe);
-
-        // Trim trailing newlines and spaces
-        while (!result.empty() && (result.back() == '\n' || result.back() == '\r' || result.back() == ' '))
-            result.pop_back();
-
-        return result;
-    }
+    // The remote changes when another repo is loaded, so it is checked again from time to time
+    std::chrono::steady_clock::time_point detectedAt;
+    bool detecting = false;
 
-    // --- Extract clean repo name ---
-    void detectRepo()
+    // Normalized to "user/repo"
+    static std::string detectRepo()
     {
-        // Get remote origin URL
-        std::string cmd = "cd data 2>/dev/null && git remote get-url origin 2>/dev/null";
-        std::string url = execCmd(cmd.c_str());
-
+        std::string url = gitRemoteUrl("data");
         if (url.empty()) {
-            repoPath = "No repo";
-            return;
+            return "No repo";
         }
 
-        // Normalize to "user/repo"
         size_t pos = url.find("github.com");
         if (pos != std::string::npos) {
             url = url.substr(pos + strlen("github.com"));
@@ -87,7 +64,27 @@ class GhRepoComponent : public Component {
         if (url.size() > 4 && url.substr(url.size() - 4) == ".git")
             url = url.substr(0, url.size() - 4);
 
-        repoPath = url;
+        return url;
+    }
+
+    void detectRepoAsync()
+    {
+        auto now = std::chrono::steady_clock::now();
+        if (detecting || now - detectedAt < std::chrono::seconds(2)) {
+            return;
+        }
+        detectedAt = now;
+        detecting = executor->post([this]() -> TaskExecutor::Completion {
+            std::string repo = detectRepo();
+            return [this, repo]() {
+                detecting = false;
+                if (repo != repoPath) {
+                    repoPath = repo;
+                    renderNext();
+                }
+            };
+        },
+            TaskExecutor::LOW);
     }
 
 public:
@@ -107,9 +104,14 @@ public:
         }
     }
 
+    bool canRelease() override
+    {
+        return !detecting;
+    }
+
     void render() override
     {
-        detectRepo();
+        detectRepoAsync();
         draw.filledRect(relativePosition, size, { bgColor });
         draw.text({ relativePosition.x, relativePosition.y }, repoPath, fontSize, { color, .font = font });
     }
@@ -14,33 +14,24 @@ Once authenticated, the component can perform several data tasks:
 
 **Technical Structure**
 
-All complex network requests (to GitHub servers) and system operations (like running file management or `git` commands for cloning/pushing) are handled *asynchronously* (in the background). This ensures the application remains responsive and the user interface does not freeze while waiting for slow operations to complete. The component's visual style, including specific colors for background, text, and active elements, is fully customizable.
+All complex network requests (to GitHub servers) and system operations (like running file management or `git` commands for cloning/pushing) are handled *asynchronously*, by the shared background workers of the interface, the requests reusing their connections and the answers that did not change. This ensures the application remains responsive and the user interface does not freeze while waiting for slow operations to complete. The component's visual style, including specific colors for background, text, and active elements, is fully customizable.
 
 sha: 65b0213b4a40abfe49b218da99d1fae81b1faf9b32b8a7864997c327ce6a647f 
 */
 #pragma once
 
-/* Toggle HTTP implementation: 1 = httplib, 0 = wget */
-#define USE_HTTPLIB 0
-
-#if USE_HTTPLIB
-#define CPPHTTPLIB_OPENSSL_SUPPORT
-#include "libs/httplib/httplib.h"
-#endif
-
+#include "helpers/execCmd.h"
+#include "helpers/gitRemote.h"
 #include "helpers/http.h"
 #include "host/constants.h"
 #include "libs/nlohmann/json.hpp"
 #include "plugins/components/component.h"
 #include "plugins/components/utils/color.h"
 
-#include <atomic>
 #include <chrono>
 #include <filesystem>
 #include <fstream>
-#include <future>
 #include <string>
-#include <thread>
 
 /*md
 ## GitHub
@@ -66,9 +57,14 @@ protected:
 
     int boxWidth = 20;
 
+    // Only touched by the UI thread, the background tasks handing their results over to their completion
     std::string userCode = "--------"; // fallback until fetched
     std::chrono::steady_clock::time_point expiryTime;
-    std::atomic<bool> fetching = false;
+    bool fetching = false;
+    bool reposFetching = false;
+    bool busy = false;
+    // Polling of the token, cancelled when asking for another code
+    TaskExecutor::Token pollToken;
 
     std::string deviceCode;
     std::string tokenFile = "../.github_token";
@@ -78,7 +74,7 @@ protected:
         LoadingToken,
         Authenticated,
     };
-    std::atomic<State> state = State::WaitingCode;
+    State state = State::WaitingCode;
 
     std::vector<std::string> repos;
     int currentRepoIndex = 0;
@@ -91,82 +87,50 @@ protected:
         renderNext();
     }
 
+    static constexpr const char* CLIENT_ID = "Ov23liVWLp79r3lJpFK2";
+
+    // Body of the answer, empty if the request failed. Background tasks only.
     std::string fetchData(
         const std::string& url,
         const std::string& postData = "",
-        const std::vector<std::pair<std::string, std::string>>& headers = {})
+        const HttpClient::Headers& headers = {})
     {
-#if USE_HTTPLIB
-        try {
-            httplib::Client cli(url.substr(0, url.find('/', 8))); // extract host
-            cli.set_connection_timeout(5, 0);
-            cli.set_read_timeout(5, 0);
-            // cli.enable_server_certificate_verification(false);
-
-            std::string path = url.substr(url.find('/', 8));
-            httplib::Headers hdrs;
-            for (auto& h : headers)
-                hdrs[h.first] = h.second;
-
-            httplib::Result res;
-            if (postData.empty())
-                res = cli.Get(path.c_str(), hdrs);
-            else
-                res = cli.Post(path.c_str(), hdrs, postData, "application/x-www-form-urlencoded");
-
-            if (!res || res->status != 200)
-                throw std::runtime_error("HTTP request failed");
-
-            return res->body;
-        } catch (const std::exception& ex) {
-            logError("HTTP fetch failed: %s", ex.what());
+        HttpClient::Response res = postData.empty() ? executor->http.get(url, headers) : executor->http.post(url, postData, headers);
+        if (res.status != 200) {
+            logError("HTTP request failed: %d %s", res.status, url.c_str());
             return "";
         }
-#else
-        // Build wget command
-        // std::string cmd = "wget --quiet --output-document=- --no-check-certificate ";
-        std::string cmd = "wget --quiet --output-document=- ";
-        for (auto& h : headers)
-            cmd += "--header=\"" + h.first + ": " + h.second + "\" ";
-        if (!postData.empty())
-            cmd += "--post-data=\"" + postData + "\" ";
-        cmd += url;
-
-        return execCmd(cmd);
-#endif
+        return res.body;
     }
 
     void fetchCodeAsync()
     {
         if (fetching)
             return;
-        fetching = true;
+        TaskExecutor::cancel(pollToken);
         userCode = "--------";
         setState(State::WaitingCode);
 
-        std::thread([this]() {
-            try {
-                std::string body = "client_id=Ov23liVWLp79r3lJpFK2&scope=repo";
-                std::string result = fetchData(
-                    "https://github.com/login/device/code",
-                    body,
-                    { { "Content-Type", "application/x-www-form-urlencoded" } });
-
-                if (result.empty())
-                    throw std::runtime_error("GitHub request failed");
-
-                auto kv = parseFormUrlEncoded(result);
-                this->userCode = kv["user_code"];
-                this->deviceCode = kv["device_code"];
-                int expiresIn = std::stoi(kv["expires_in"]);
-                this->expiryTime = std::chrono::steady_clock::now() + std::chrono::seconds(expiresIn);
-
+        fetching = executor->post([this]() -> TaskExecutor::Completion {
+            std::string result = fetchData(
+                "https://github.com/login/device/code",
+                std::string("client_id=") + CLIENT_ID + "&scope=repo",
+                { { "Content-Type", "application/x-www-form-urlencoded" } });
+            auto kv = parseFormUrlEncoded(result);
+            return [this, kv]() mutable {
+                fetching = false;
+                if (kv["device_code"].empty()) {
+                    logError("GitHub request failed");
+                    // Asked again by the next rendering
+                    expiryTime = std::chrono::steady_clock::now() + std::chrono::seconds(5);
+                    return;
+                }
+                userCode = kv["user_code"];
+                deviceCode = kv["device_code"];
+                expiryTime = std::chrono::steady_clock::now() + std::chrono::seconds(atoi(kv["expires_in"].c_str()));
                 renderNext();
-            } catch (const std::exception& ex) {
-                logError("GitHub request failed: %s", ex.what());
-            }
-            fetching = false;
-        }).detach();
+            };
+        });
     }
 
     void fetchTokenAsync()
@@ -174,107 +138,95 @@ protected:
         if (deviceCode.empty())
             return;
         setState(State::LoadingToken);
+        TaskExecutor::cancel(pollToken);
+        pollToken = TaskExecutor::token();
+        pollTokenAsync(0);
+    }
 
-        std::thread([this]() {
-            try {
-                std::string body = "client_id=Ov23liVWLp79r3lJpFK2"
-                                   "&device_code="
-                    + deviceCode + "&grant_type=urn:ietf:params:oauth:grant-type:device_code";
-
-                for (;;) {
-                    std::string result = fetchData(
-                        "https://github.com/login/oauth/access_token",
-                        body,
-                        { { "Content-Type", "application/x-www-form-urlencoded" },
-                            { "Accept", "application/json" } });
-
-                    if (result.empty())
-                        throw std::runtime_error("GitHub token request failed");
-
-                    auto json = nlohmann::json::parse(result);
-                    if (json.contains("error")) {
-                        std::string err = json["error"];
-                        if (err == "authorization_pending") {
-                            std::this_thread::sleep_for(std::chrono::seconds(5));
-                            continue;
-                        } else {
-                            throw std::runtime_error("GitHub error: " + err);
-                        }
-                    }
-
-                    this->accessToken = json.value("access_token", "");
-                    if (!accessToken.empty()) {
-                        logDebug("GitHub: token=%s", accessToken.c_str());
-                        std::ofstream out(tokenFile);
-                        out << accessToken;
-                        out.close();
-
-                        fetchReposAsync();
-                        setState(State::Authenticated);
-                    }
-                    break;
-                }
-            } catch (const std::exception& ex) {
-                logError("GitHub token fetch failed: %s", ex.what());
-                setState(State::WaitingCode);
+    // While the user didn't authorize the code yet, asked again in 5 seconds, without holding a worker meanwhile
+    void pollTokenAsync(uint32_t delayMs)
+    {
+        std::string body = std::string("client_id=") + CLIENT_ID + "&device_code=" + deviceCode
+            + "&grant_type=urn:ietf:params:oauth:grant-type:device_code";
+        bool posted = executor->post([this, body]() -> TaskExecutor::Completion {
+            std::string result = fetchData(
+                "https://github.com/login/oauth/access_token",
+                body,
+                { { "Content-Type", "application/x-www-form-urlencoded" },
+                    { "Accept", "application/json" } });
+            nlohmann::json json = nlohmann::json::parse(result, nullptr, false);
+            std::string error = json.is_object() ? json.value("error", "") : "request failed";
+            std::string token = json.is_object() ? json.value("access_token", "") : "";
+            if (!token.empty()) {
+                std::ofstream out(tokenFile);
+                out << token;
             }
-        }).detach();
+            return [this, error, token]() {
+                if (error == "authorization_pending" || error == "slow_down") {
+                    pollTokenAsync(5000);
+                    return;
+                }
+                if (token.empty()) {
+                    logError("GitHub token fetch failed: %s", error.c_str());
+                    setState(State::WaitingCode);
+                    return;
+                }
+                logDebug("GitHub: token=%s", token.c_str());
+                accessToken = token;
+                setState(State::Authenticated);
+                fetchReposAsync();
+            };
+        },
+            TaskExecutor::NORMAL, pollToken, delayMs);
+        if (!posted) {
+            setState(State::WaitingCode);
+        }
     }
 
+    // The pages that didn't change are answered from the cache of the client, see HttpClient
     void fetchReposAsync()
     {
-        if (accessToken.empty() || reposLoaded)
+        if (accessToken.empty() || reposLoaded || reposFetching)
             return;
 
-        std::thread([this]() {
-            try {
-                repos.clear();
-
-                currentRepoIndex = 0;
-                std::string activeRepo = getActiveRepo();
-                int page = 1;
-
-                for (int i = 0; i < 20; i++) { // max 20 pages = 2000 repos
-                    std::string url = "https://api.github.com/user/repos?per_page=100&page=" + std::to_string(page);
-
-                    std::string result = fetchData(
-                        url,
-                        "", // GET request → no POST data
-                        {
-                            { "Authorization", "token " + accessToken },
-                            { "User-Agent", "zicbox-client" },
-                            { "Accept", "application/vnd.github+json" } });
-
-                    if (result.empty()) {
-                        throw std::runtime_error("GitHub repos fetch failed");
-                    }
-
-                    auto json = nlohmann::json::parse(result);
-                    if (json.empty())
-                        break;
-
-                    for (auto& repo : json) {
-                        if (repo.contains("full_name")) {
-                            repos.push_back(repo["full_name"]);
-                            if (repo["full_name"] == activeRepo)
-                                currentRepoIndex = repos.size() - 1;
-                        }
+        reposFetching = executor->post([this, token = accessToken]() -> TaskExecutor::Completion {
+            std::vector<std::string> found;
+            for (int page = 1; page <= 20; page++) { // max 20 pages = 2000 repos
+                std::string result = fetchData(
+                    "https://api.github.com/user/repos?per_page=100&page=" + std::to_string(page),
+                    "", // GET request → no POST data
+                    { { "Authorization", "token " + token },
+                        { "User-Agent", "zicbox-client" },
+                        { "Accept", "application/vnd.github+json" } });
+                nlohmann::json json = nlohmann::json::parse(result, nullptr, false);
+                if (!json.is_array()) {
+                    logError("GitHub repos fetch failed");
+                    break;
+                }
+                for (auto& repo : json) {
+                    if (repo.contains("full_name")) {
+                        found.push_back(repo["full_name"]);
                     }
-
-                    if ((int)json.size() < 100)
-                        break; // last page
-                    page++;
                 }
-
+                if ((int)json.size() < 100)
+                    break; // last page
+            }
+            return [this, found]() {
+                reposFetching = false;
+                repos = found;
+                activeRepo = readActiveRepo();
+                currentRepoIndex = 0;
+                for (size_t i = 0; i < repos.size(); i++) {
+                    if (repos[i] == activeRepo)
+                        currentRepoIndex = i;
+                }
                 if (!repos.empty()) {
                     reposLoaded = true;
                     renderNext();
                 }
-
-            } catch (const std::exception& ex) {
-                logError("GitHub repos fetch failed: %s", ex.what());
-            }
-        }).detach();
+            };
+        },
+            TaskExecutor::NORMAL);
     }
 
     void loadSelectedRepoAsync()
@@ -289,88 +241,78 @@ protected:
             showMessage("Invalid repo");
             return;
         }
+        if (busy) {
+            return;
+        }
 
-        std::thread([this, repoName]() {
+        // Cloning takes a while, the other tasks go first
+        busy = executor->post([this, repoName, token = accessToken]() -> TaskExecutor::Completion {
+            std::string message = "Loaded successfully";
             try {
                 namespace fs = std::filesystem;
-                showMessage("Loading repo...");
-
                 std::string tmpDir = "/tmp/github_data_clone_" + std::to_string(getpid());
-                // logDebug("GitHub: tmpDir=%s", tmpDir.c_str());
 
                 // Clean tmp if exists
                 execCmd("rm -rf " + tmpDir);
 
-                // Prepare clone URL with token
-                std::string cloneUrl = "https://x-access-token:" + accessToken + "@github.com/" + repoName + ".git";
-
-                // Clone repo
-                // std::string cloneCmd = "git -c http.sslVerify=false clone " + cloneUrl + " " + tmpDir + " 2>&1";
-                std::string cloneCmd = "git clone " + cloneUrl + " " + tmpDir + " 2>&1";
-                // logDebug("GitHub: cloneCmd=%s", cloneCmd.c_str());
-                std::string output = execCmd(cloneCmd);
+                // Clone repo, with the token in the URL
+                std::string cloneUrl = "https://x-access-token:" + token + "@github.com/" + repoName + ".git";
+                std::string output = execCmd("git clone " + cloneUrl + " " + tmpDir);
 
                 if (output.find("denied") != std::string::npos || output.find("error") != std::string::npos || output.find("fatal") != std::string::npos) {
                     logError("Git clone failed: %s", output.c_str());
-                    showMessage("Permission denied.");
                     execCmd("rm -rf " + tmpDir);
-                    return;
-                }
-
-                // Remove credentials from .git/config to avoid saving token
-                execCmd("git -C " + tmpDir + " remote set-url origin https://github.com/" + repoName + ".git");
-
-                // Prepare data folders
-                fs::path dataDir = "data";
-                fs::path backupDir = "data_backup";
-
-                if (fs::exists(backupDir)) {
-                    execCmd("rm -rf data_backup");
-                }
-
-                if (fs::exists(dataDir)) {
-                    fs::rename(dataDir, backupDir);
+                    message = "Permission denied.";
+                } else {
+                    // Remove credentials from .git/config to avoid saving token
+                    execCmd("git -C " + tmpDir + " remote set-url origin https://github.com/" + repoName + ".git");
+
+                    // Prepare data folders
+                    fs::path dataDir = "data";
+                    fs::path backupDir = "data_backup";
+                    if (fs::exists(backupDir)) {
+                        fs::remove_all(backupDir);
+                    }
+                    if (fs::exists(dataDir)) {
+                        fs::rename(dataDir, backupDir);
+                    }
+                    fs::rename(tmpDir, dataDir);
                 }
-
-                fs::rename(tmpDir, dataDir);
-
-                showMessage("Loaded successfully");
-
-                // Reload active repo
-                fetchReposAsync();
-
             } catch (const std::exception& ex) {
                 logError("Repo load failed: %s", ex.what());
-                showMessage("Load failed");
+                message = "Load failed";
             }
-        }).detach();
-    }
-
-    // --- Helper to execute a shell command and capture stdout/stderr ---
-    static std::string execCmd(const std::string& cmd)
-    {
-        std::array<char, 256> buffer;
-        std::string result;
-        FILE* pipe = popen((cmd + " 2>&1").c_str(), "r");
-        if (!pipe)
-            return "";
-        while (fgets(buffer.data(), buffer.size(), pipe) != nullptr)
-            result += buffer.data();
-        pclose(pipe);
-        return result;
+            return [this, message]() {
+                busy = false;
+                activeRepo = readActiveRepo();
+                showMessage(message);
+            };
+        },
+            TaskExecutor::LOW);
+        if (busy) {
+            showMessage("Loading repo...", 60000);
+        }
     }
 
     std::string lastMessage;
+    uint32_t messageId = 0;
+    // Messages waiting to be hidden
+    uint16_t messageTimers = 0;
     void showMessage(const std::string& msg, int durationMs = 1000)
     {
         lastMessage = msg;
         renderNext(); // show message immediately
 
-        std::thread([this, durationMs]() {
-            std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
-            lastMessage = "";
-            renderNext(); // trigger re-render when duration is over
-        }).detach();
+        uint32_t id = ++messageId;
+        messageTimers++;
+        executor->after(durationMs, [this, id]() {
+            messageTimers--;
+            // Unless replaced by another message meanwhile
+            if (id == messageId) {
+                lastMessage = "";
+                renderNext();
+            }
+        });
     }
 
     std::filesystem::path repoPath = "data";
@@ -380,69 +322,60 @@ protected:
             showMessage("Not authenticated");
             return;
         }
+        if (busy) {
+            return;
+        }
 
-        std::thread([this]() {
-            try {
-                namespace fs = std::filesystem;
-                // Check if it's a git repo
-                if (!fs::exists(repoPath / ".git")) {
-                    showMessage("No git repo found");
-                    return;
-                }
-
-                // Get current remote URL
-                std::string remoteUrl = execCmd("git -C data remote get-url origin");
-                remoteUrl.erase(remoteUrl.find_last_not_of(" \n\r\t") + 1); // trim whitespace/newline
-
-                if (remoteUrl.empty()) {
-                    showMessage("No remote URL");
-                    return;
-                }
-
-                // Convert SSH or HTTPS URL to HTTPS with token
-                if (remoteUrl.rfind("git@", 0) == 0) {
-                    // git@github.com:user/repo.git -> https://github.com/user/repo.git
-                    size_t colon = remoteUrl.find(':');
-                    if (colon == std::string::npos)
-                        throw std::runtime_error("Invalid remote URL");
-                    remoteUrl = "https://github.com/" + remoteUrl.substr(colon + 1);
-                }
-
-                showMessage("Saving to " + remoteUrl.substr(19));
+        std::string remoteUrl = gitRemoteUrl(repoPath.string());
+        if (!std::filesystem::exists(repoPath / ".git")) {
+            showMessage("No git repo found");
+            return;
+        }
+        if (remoteUrl.empty()) {
+            showMessage("No remote URL");
+            return;
+        }
 
-                // Inject token
-                std::string pushUrl = "https://x-access-token:" + accessToken + "@" + remoteUrl.substr(8); // skip https://
+        // Convert SSH or HTTPS URL to HTTPS with token
+        if (remoteUrl.rfind("git@", 0) == 0) {
+            // git@github.com:user/repo.git -> https://github.com/user/repo.git
+            size_t colon = remoteUrl.find(':');
+            if (colon == std::string::npos) {
+                showMessage("Invalid remote URL");
+                return;
+            }
+            remoteUrl = "https://github.com/" + remoteUrl.substr(colon + 1);
+        }
 
-                // Run add, commit, push
-                // std::string cmd = "cd data && git add . && git commit -m 'Sync' --allow-empty && git -c http.sslVerify=false push " + pushUrl + " HEAD 2>&1";
-                std::string cmd = "cd data && git add . && git commit -m 'Sync' --allow-empty && git push " + pushUrl + " HEAD 2>&1";
-                std::string output = execCmd(cmd);
+        busy = executor->post([this, remoteUrl, token = accessToken]() -> TaskExecutor::Completion {
+            // Inject token
+            std::string pushUrl = "https://x-access-token:" + token + "@" + remoteUrl.substr(8); // skip https://
 
-                if (output.find("denied") != std::string::npos || output.find("error") != std::string::npos || output.find("fatal") != std::string::npos) {
-                    logError("Git push failed: %s", output.c_str());
-                    showMessage("Permission denied.");
-                } else {
-                    showMessage("Pushed successfully");
-                }
+            // Run add, commit, push
+            std::string cmd = "cd data && git add . && git commit -m 'Sync' --allow-empty && git push " + pushUrl + " HEAD";
+            std::string output = execCmd(cmd);
 
-            } catch (const std::exception& ex) {
-                logError("Push failed: %s", ex.what());
-                showMessage("Push failed");
+            std::string message = "Pushed successfully";
+            if (output.find("denied") != std::string::npos || output.find("error") != std::string::npos || output.find("fatal") != std::string::npos) {
+                logError("Git push failed: %s", output.c_str());
+                message = "Permission denied.";
             }
-        }).detach();
+            return [this, message]() {
+                busy = false;
+                showMessage(message);
+            };
+        },
+            TaskExecutor::LOW);
+        if (busy) {
+            showMessage("Saving to " + remoteUrl.substr(19), 60000);
+        }
     }
 
-    std::string getActiveRepo()
+    // Repo currently in `data`, read again once another one is loaded
+    std::string activeRepo;
+    std::string readActiveRepo()
     {
-        namespace fs = std::filesystem;
-        if (!fs::exists(repoPath / ".git")) {
-            return "";
-        }
-
-        // Get current remote URL
-        std::string remoteUrl = execCmd("git -C data remote get-url origin");
-        remoteUrl.erase(remoteUrl.find_last_not_of(" \n\r\t") + 1); // trim whitespace/newline
-
+        std::string remoteUrl = gitRemoteUrl(repoPath.string());
         if (remoteUrl.empty()) {
             return "";
         }
@@ -453,11 +386,13 @@ protected:
             if (colon == std::string::npos)
                 return "";
             remoteUrl = remoteUrl.substr(colon + 1);
-        } else {
+        } else if (remoteUrl.size() > 19) {
             remoteUrl = remoteUrl.substr(19);
         }
 
-        return remoteUrl.substr(0, remoteUrl.size() - 4); // - .git
+        if (remoteUrl.size() > 4 && remoteUrl.substr(remoteUrl.size() - 4) == ".git")
+            remoteUrl = remoteUrl.substr(0, remoteUrl.size() - 4);
+        return remoteUrl;
     }
 
     bool isExpired()
@@ -571,6 +506,7 @@ public:
         /*md md_config_end */
 
         // resize();
+        activeRepo = readActiveRepo();
         if (isAuthenticated()) {
             setState(State::Authenticated);
         }
@@ -581,6 +517,12 @@ public:
         boxWidth = size.w / 9;
     }
 
+    // Not while a request or a message timer would call it back
+    bool canRelease() override
+    {
+        return !fetching && !reposFetching && !busy && state != State::LoadingToken && !messageTimers;
+    }
+
     void render()
     {
         draw.filledRect(relativePosition, size, { bgColor });
@@ -600,9 +542,7 @@ public:
                 std::string repoName = repos[currentRepoIndex];
                 draw.text({ relativePosition.x + 4, textY }, repoName, fontSize, { textColor, .font = font });
 
-                std::string currentRepo = getActiveRepo();
-                // logDebug("currentRepo: %s vs repoName: %s", currentRepo.c_str(), repoName.c_str());
-                if (repoName == currentRepo) {
+                if (repoName == activeRepo) {
                     draw.textRight({ relativePosition.x + size.w - 4, textY }, "Active", fontSize, { activeColor, .font = font });
                 }
                 return;
@@ -99,9 +99,8 @@ public:
         /*md md_config_end */
     }
 
-    std::vector<Point> getPoints() override
+    void getPoints(std::vector<Point>& points) override
     {
-        std::vector<Point> points = {};
         if (dataId != -1) {
             float halfHeight = waveformHeight * 0.49;
             points.push_back({ 0, (int)(halfHeight) });
@@ -131,6 +130,5 @@ public:
                 }
             }
         }
-        return points;
     }
 };
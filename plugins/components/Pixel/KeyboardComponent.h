@@ -228,32 +228,48 @@ public:
         "=", "_", ".", "!", "&icon::backspace::filled"
     };
 
+    void renderKey(int k, Point keysPos, bool selected)
+    {
+        Point pos = { keysPos.x + (k % 9) * itemSize.w, keysPos.y + (k / 9) * itemSize.h };
+        draw.filledRect(pos, { itemSize.w - 2, itemSize.h - 2 }, { selected ? selectionColor : itemBackground });
+        Point posText = { pos.x + textPos.x, pos.y + textPos.y };
+        if (!icon.render(keys[k], posText, 6, { textColor }, Icon::CENTER)) {
+            draw.textCentered(posText, keys[k], 8, { textColor, .font = font });
+        }
+    }
+
+    // Back and Done buttons, after the last key
+    void renderButton(int index, Point keysPos, bool selected)
+    {
+        int k = keys.size() - 1;
+        Point pos = { keysPos.x + (k % 9) * itemSize.w + itemSize.w * (1 + index * 2), keysPos.y + (k / 9) * itemSize.h };
+        draw.filledRect(pos, { (itemSize.w * 2) - 2, itemSize.h - 2 }, { selected ? selectionColor : itemBackground });
+        draw.textCentered({ pos.x + ((itemSize.w * 2) - 2) / 2, pos.y + textPos.y }, index == 0 ? "Back" : "Done", 8, { textColor, .font = font });
+    }
+
     void render()
     {
-        draw.filledRect(relativePosition, size, { bgColor });
         int y = relativePosition.y + ((size.h - (itemSize.h * 9) + 10) * 0.5);
         int x = relativePosition.x + ((size.w - (itemSize.w * 9)) * 0.5);
+        Point keysPos = { x, y + itemSize.h + 10 };
+
+        // The keys are drawn once, the selected one is drawn again on top of them
+        renderLayer(0, [&]() {
+            draw.filledRect(relativePosition, size, { bgColor });
+            for (int k = 0; k < keys.size(); k++) {
+                renderKey(k, keysPos, false);
+            }
+            renderButton(0, keysPos, false);
+            renderButton(1, keysPos, false);
+        });
 
         draw.filledRect({ x, y }, { itemSize.w * 9, itemSize.h }, { itemBackground });
         draw.text({ x + 8, y + textPos.y }, value, 8, { textColor, .font = font });
 
-        y += itemSize.h + 10;
-
-        Point pos;
-        for (int k = 0; k < keys.size(); k++) {
-            int row = k / 9;
-            int col = k % 9;
-            pos = { x + col * itemSize.w, y + row * itemSize.h };
-            draw.filledRect(pos, { itemSize.w - 2, itemSize.h - 2 }, { k == selection ? selectionColor : itemBackground });
-            Point posText = { pos.x + textPos.x, pos.y + textPos.y };
-            if (!icon.render(keys[k], posText, 6, { textColor }, Icon::CENTER)) {
-                draw.textCentered(posText, keys[k], 8, { textColor, .font = font });
-            }
+        if (selection < keys.size()) {
+            renderKey(selection, keysPos, true);
+        } else {
+            renderButton(selection - keys.size(), keysPos, true);
         }
-        draw.filledRect({ pos.x + itemSize.w, pos.y }, { (itemSize.w * 2) - 2, itemSize.h - 2 }, { keys.size() == selection ? selectionColor : itemBackground });
-        draw.textCentered({ pos.x + itemSize.w + ((itemSize.w * 2) - 2) / 2, pos.y + textPos.y }, "Back", 8, { textColor, .font = font });
-
-        draw.filledRect({ pos.x + itemSize.w * 3, pos.y }, { (itemSize.w * 2) - 2, itemSize.h - 2 }, { keys.size() + 1 == selection ? selectionColor : itemBackground });
-        draw.textCentered({ pos.x + itemSize.w * 3 + ((itemSize.w * 2) - 2) / 2, pos.y + textPos.y }, "Done", 8, { textColor, .font = font });
     }
 };
@@ -86,10 +86,13 @@ protected:
         envelopHeight = size.h - ((fontSize + margin) * 2);
     }
 
+    // Kept between the renderings, so drawing the envelop while it is edited does not allocate
+    std::vector<Point> points;
+
     void renderEnvelop()
     {
         Data data = envData->at(0);
-        std::vector<Point> points;
+        points.clear();
         points.push_back({ envPosition.x, envPosition.y + envelopHeight });
         if (data.modulation != 0.0f) {
             points.push_back({ envPosition.x, (int)(envPosition.y + envelopHeight - envelopHeight * data.modulation) });
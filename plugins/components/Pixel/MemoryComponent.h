@@ -0,0 +1,116 @@
+#pragma once
+
+#include "plugins/audio/utils/MemoryBudget.h"
+#include "plugins/components/component.h"
+#include "plugins/components/utils/color.h"
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+/*md
+## Memory
+
+Memory component is used to display the memory taken by the caches (decoded samples, rendered drum hits, generator tables, frozen tracks...), as a bar graph of the memory budget. The first bar is the total, each of the next ones a cache, with the memory it takes in MB.
+
+See the host config `"memoryBudgetMb"`.
+*/
+
+class MemoryComponent : public Component {
+protected:
+    Color bgColor;
+    Color barColor;
+    Color warningColor;
+    Color textColor;
+
+    int fontSize = 8;
+    unsigned long refreshMs = 1000;
+    unsigned long lastRender = 0;
+
+    MemoryBudget* memoryBudget = NULL;
+    std::vector<MemoryBudget::Usage> usage;
+
+    void renderBar(int y, int h, std::string label, size_t bytes, size_t scale, bool warning)
+    {
+        int barW = size.w;
+        int x = relativePosition.x;
+        float ratio = scale ? (float)bytes / scale : 0.0f;
+        if (ratio > 1.0f) {
+            ratio = 1.0f;
+        }
+
+        draw.filledRect({ x, y }, { barW, h }, { darken(barColor, 0.7) });
+        draw.filledRect({ x, y }, { (int)(barW * ratio), h }, { warning ? warningColor : barColor });
+        draw.text({ x + 1, y }, label + " " + std::to_string(bytes >> 20) + " MB", fontSize, { textColor });
+    }
+
+public:
+    MemoryComponent(ComponentInterface::Props props)
+        : Component(props)
+        , bgColor(styles.colors.background)
+        , barColor(styles.colors.primary)
+        , warningColor(styles.colors.secondary)
+        , textColor(styles.colors.text)
+    {
+        jobRendering = [this](unsigned long now) {
+            if (now - lastRender > refreshMs) {
+                lastRender = now;
+                renderNext();
+            }
+        };
+
+        /*md md_config:Memory */
+        nlohmann::json& config = props.config;
+
+        /// The background color.
+        bgColor = draw.getColor(config["bgColor"], bgColor); //eg: "#000000"
+
+        /// The color of the memory bars.
+        barColor = draw.getColor(config["barColor"], barColor); //eg: "#4fbfc5"
+
+        /// The color of the total bar when the caches are close to the budget.
+        warningColor = draw.getColor(config["warningColor"], warningColor); //eg: "#ff8a94"
+
+        /// The color of the labels.
+        textColor = draw.getColor(config["textColor"], textColor); //eg: "#ffffff"
+
+        /// The font size of the labels.
+        fontSize = config.value("fontSize", fontSize); //eg: 8
+
+        /// The refresh interval in milliseconds.
+        refreshMs = config.value("refreshMs", refreshMs); //eg: 1000
+
+        /*md md_config_end */
+    }
+
+    void render() override
+    {
+        draw.filledRect(relativePosition, size, { bgColor });
+
+        if (memoryBudget == NULL && getAudioPluginHandler != NULL) {
+            AudioPluginHandlerInterface* host = getAudioPluginHandler();
+            memoryBudget = (MemoryBudget*)host->data(host->getDataId("MEMORY"));
+        }
+        if (memoryBudget == NULL) {
+            draw.text({ relativePosition.x, relativePosition.y }, "No memory budget", fontSize, { textColor });
+            return;
+        }
+
+        size_t total = memoryBudget->read(usage);
+        size_t budget = memoryBudget->getBudget();
+        // Without a budget, e.g. not on Linux, the caches are shown against their total
+        size_t scale = budget == SIZE_MAX ? total : budget;
+
+        int rows = usage.size() + 1;
+        int h = size.h / rows - 1;
+        if (h < 2) {
+            h = 2;
+        }
+        int y = relativePosition.y;
+        renderBar(y, h, "All", total, scale, budget != SIZE_MAX && total >= budget / 10 * 9);
+        for (MemoryBudget::Usage& cache : usage) {
+            y += h + 1;
+            renderBar(y, h, cache.name, cache.bytes, scale, false);
+        }
+    }
+};
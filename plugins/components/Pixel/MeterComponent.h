@@ -0,0 +1,188 @@
+#pragma once
+
+#include "host/MeterTap.h"
+#include "plugins/components/component.h"
+#include "plugins/components/utils/color.h"
+
+#include <algorithm>
+#include <cmath>
+#include <string>
+#include <vector>
+
+/*md
+## Meter
+
+Meter component is used to display the level of tracks, as bars with a peak hold, or the waveform of a track, as
+a scope. It draws from the levels and the waveform reduced by the tracks themselves (see `host/MeterTap.h`), never
+reading the audio.
+
+Requires the host config `"meters"`, with the tracks displayed.
+*/
+
+class MeterComponent : public Component {
+protected:
+    Color bgColor;
+    Color barColor;
+    Color clipColor;
+    Color peakColor;
+    Color textColor;
+
+    int fontSize = 8;
+    bool scope = false;
+    float rangeDb = 60.0f;
+    unsigned long refreshMs = 33;
+    unsigned long lastRender = 0;
+
+    struct Meter {
+        uint8_t track;
+        MeterTap* tap = NULL;
+        MeterTap::Ballistics ballistics;
+    };
+    std::vector<Meter> meters;
+    bool bound = false;
+
+    // Position of a level on the bar, from 0 at -`rangeDb` to 1 at 0 dB
+    float position(float level)
+    {
+        if (level <= 0.0f) {
+            return 0.0f;
+        }
+        float db = 20.0f * log10f(level);
+        return std::clamp((db + rangeDb) / rangeDb, 0.0f, 1.0f);
+    }
+
+    void renderBar(int y, int h, Meter& meter, unsigned long now)
+    {
+        int labelW = 16;
+        int barW = size.w - labelW;
+        int x = relativePosition.x + labelW;
+
+        draw.text({ relativePosition.x, y }, std::to_string(meter.track), fontSize, { textColor });
+        draw.filledRect({ x, y }, { barW, h }, { darken(barColor, 0.7) });
+        if (!meter.tap) {
+            return;
+        }
+        MeterTap::Snapshot snapshot = meter.tap->read();
+        meter.ballistics.update(snapshot, now);
+
+        draw.filledRect({ x, y }, { (int)(barW * position(meter.ballistics.level)), h }, { barColor });
+        float peak = meter.ballistics.peak;
+        int peakX = x + (int)((barW - 1) * position(peak));
+        draw.line({ peakX, y }, { peakX, y + h - 1 }, { peak >= 1.0f ? clipColor : peakColor });
+    }
+
+    void renderScope(Meter& meter)
+    {
+        if (!meter.tap) {
+            return;
+        }
+        MeterTap::Snapshot snapshot = meter.tap->read();
+        int mid = relativePosition.y + size.h / 2;
+        float half = size.h / 2 - 1;
+        for (int x = 0; x < size.w; x++) {
+            int column = x * MeterTap::WIDTH / size.w;
+            float low = std::clamp(snapshot.waveMin[column], -1.0f, 1.0f);
+            float high = std::clamp(snapshot.waveMax[column], -1.0f, 1.0f);
+            bool clip = snapshot.waveMin[column] <= -1.0f || snapshot.waveMax[column] >= 1.0f;
+            draw.line({ relativePosition.x + x, mid - (int)(high * half) }, { relativePosition.x + x, mid - (int)(low * half) }, { clip ? clipColor : barColor });
+        }
+    }
+
+public:
+    MeterComponent(ComponentInterface::Props props)
+        : Component(props)
+        , bgColor(styles.colors.background)
+        , barColor(styles.colors.primary)
+        , clipColor(styles.colors.secondary)
+        , peakColor(styles.colors.white)
+        , textColor(styles.colors.text)
+    {
+        jobRendering = [this](unsigned long now) {
+            if (now - lastRender > refreshMs) {
+                lastRender = now;
+                renderNext();
+            }
+        };
+
+        /*md md_config:Meter */
+        nlohmann::json& config = props.config;
+
+        /// The tracks to display, one bar each. The scope only displays the first one.
+        for (uint8_t track : config.value("tracks", std::vector<uint8_t> { 1 })) { //eg: [1, 2, 3, 4]
+            meters.push_back({ track });
+        }
+
+        /// Display the waveform of the track instead of its level.
+        scope = config.value("scope", scope); //eg: true
+
+        /// The range of the bars in dB, below 0 dB.
+        rangeDb = config.value("rangeDb", rangeDb); //eg: 60
+
+        /// The speed at which the level and the peak fall, in dB per second.
+        float decay = config.value("decay", 24.0f); //eg: 24
+
+        /// The time the peak is held before falling, in milliseconds.
+        unsigned long hold = config.value("holdMs", 1500); //eg: 1500
+
+        for (Meter& meter : meters) {
+            meter.ballistics.decayDbPerSecond = decay;
+            meter.ballistics.holdMs = hold;
+        }
+
+        /// The background color.
+        bgColor = draw.getColor(config["bgColor"], bgColor); //eg: "#000000"
+
+        /// The color of the level bars and of the waveform.
+        barColor = draw.getColor(config["barColor"], barColor); //eg: "#4fbfc5"
+
+        /// The color of the peak and of the waveform when it clips.
+        clipColor = draw.getColor(config["clipColor"], clipColor); //eg: "#ff8a94"
+
+        /// The color of the peak hold.
+        peakColor = draw.getColor(config["peakColor"], peakColor); //eg: "#ffffff"
+
+        /// The color of the track labels.
+        textColor = draw.getColor(config["textColor"], textColor); //eg: "#ffffff"
+
+        /// The font size of the track labels.
+        fontSize = config.value("fontSize", fontSize); //eg: 8
+
+        /// The refresh interval in milliseconds.
+        refreshMs = config.value("refreshMs", refreshMs); //eg: 33
+
+        /*md md_config_end */
+    }
+
+    void render() override
+    {
+        draw.filledRect(relativePosition, size, { bgColor });
+
+        // Meters are only available once the tracks are loaded
+        if (!bound && getAudioPluginHandler != NULL) {
+            AudioPluginHandlerInterface* host = getAudioPluginHandler();
+            uint8_t id = host->getDataId("METER");
+            for (Meter& meter : meters) {
+                meter.tap = (MeterTap*)host->data(id, &meter.track);
+            }
+            bound = true;
+        }
+        if (meters.empty()) {
+            return;
+        }
+        if (scope) {
+            renderScope(meters[0]);
+            return;
+        }
+
+        unsigned long now = lastRender;
+        int h = size.h / meters.size() - 1;
+        if (h < 2) {
+            h = 2;
+        }
+        int y = relativePosition.y;
+        for (Meter& meter : meters) {
+            renderBar(y, h, meter, now);
+            y += h + 1;
+        }
+    }
+};
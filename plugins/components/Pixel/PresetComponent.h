@@ -6,23 +6,30 @@ Its primary function is to provide a user interface for browsing, loading, and p
 **How It Works:**
 
 1.  **Initialization:** When the component starts, it reads its setup instructions, determining which specific audio plugin it controls, defining its visual style (colors and font size), and setting the default folder where presets are stored (e.g., `data/presets`).
-2.  **File Management:** It uses an internal utility to navigate this designated folder, tracking the list of available preset files.
-3.  **Loading Presets:** When a user selects a preset, the component opens the corresponding file, reads the saved settings data, and immediately applies those configurations to the audio plugin, changing its sound.
+2.  **File Management:** It uses the preset index of this folder, a hidden file listing the name and category of each preset, so the folder is listed without opening every preset.
+3.  **Loading Presets:** The presets next to the cursor are read in the background, so selecting one only applies the values already parsed to the audio plugin, changing its sound.
 4.  **Backup Feature:** Before loading any new file, the component automatically creates a temporary "backup" of the plugin's existing configuration. This allows the user to easily restore the original settings if they decide they don't like the new preset.
 5.  **User Control:** The component is designed to react to physical controls, specifically managing an *encoder* (a rotary dial) to scroll through the list of presets displayed on the screen. It also includes functions to briefly "audition" or preview a preset by triggering a small sound before the full settings are loaded.
-6.  **Visuals:** It handles its own appearance, using defined colors for the background, text, and a scroll indicator, ensuring the component fits seamlessly into the larger application interface.
+6.  **Morphing:** Two presets can be morphed with an encoder, the values of the loaded preset moving towards the ones of the selected preset.
+7.  **Visuals:** It handles its own appearance, using defined colors for the background, text, and a scroll indicator, ensuring the component fits seamlessly into the larger application interface.
 
 sha: feb0715ae79c3bd37ff111ad640285402933112705175e87747b14b15f146305
 */
 #pragma once
 
-#include "audio/fileBrowser.h"
+#include "helpers/clamp.h"
+#include "plugins/audio/utils/PresetIndex.h"
+#include "plugins/audio/utils/PresetMorph.h"
 #include "plugins/components/component.h"
 #include "plugins/components/utils/color.h"
 
-#include <fstream>
 #include <string>
 
+/*md
+## Preset
+
+Preset component browses the presets of a plugin, loads them and morphs between two of them.
+*/
 class PresetComponent : public Component {
 protected:
     Color bgColor;
@@ -35,13 +42,20 @@ protected:
     void* font = NULL;
 
     int8_t encoderId = 1;
+    int8_t morphEncoderId = -1;
 
     AudioPlugin* audioPlugin = nullptr;
     std::string folder = "data/presets";
 
-    FileBrowser fileBrowser;
+    PresetIndex presets;
+    int position = 0;
+    int prefetchCount = 2;
 
     int loaded = -1;
+    std::shared_ptr<ClipState::Plugin> loadedState;
+
+    PresetMorph morph;
+    int morphTo = -1;
 
     nlohmann::json backup;
     void load()
@@ -51,18 +65,27 @@ protected:
             audioPlugin->serializeJson(backup);
         }
 
-        std::string filepath = fileBrowser.getFilePath(fileBrowser.position);
-        std::ifstream file(filepath);
-        if (file.is_open()) {
-            nlohmann::json json;
-            file >> json;
-            audioPlugin->hydrateJson(json);
-            file.close();
-            loaded = fileBrowser.position;
+        std::shared_ptr<ClipState::Plugin> state = presets.state(position, audioPlugin);
+        if (state) {
+            audioPlugin->hydrateState(*state);
+            loaded = position;
+            loadedState = state;
+        }
+        morph.clear();
+    }
+
+    // Morph from the loaded preset to the one under the cursor
+    void startMorph()
+    {
+        if (loaded == -1 || position == loaded) {
+            return;
+        }
+        std::shared_ptr<ClipState::Plugin> state = presets.state(position, audioPlugin);
+        if (state && loadedState) {
+            morph.prepare(audioPlugin, *loadedState, *state);
+            morphTo = position;
+            renderNext();
         }
-        //  else {
-        //     logError("Preset file not found: %s", filepath.c_str());
-        // }
     }
 
     void trig(bool isOn)
@@ -83,7 +106,7 @@ public:
 
             if (action == ".loadTrig") {
                 func = [this](KeypadLayout::KeyMap& keymap) {
-                    if (loaded == fileBrowser.position) {
+                    if (loaded == position) {
                         trig(KeypadLayout::isPressed(keymap));
                     } else if (KeypadLayout::isReleased(keymap)) {
                         load();
@@ -91,11 +114,20 @@ public:
                 };
             }
 
+            if (action == ".morph") {
+                func = [this](KeypadLayout::KeyMap& keymap) {
+                    if (KeypadLayout::isReleased(keymap)) {
+                        startMorph();
+                    }
+                };
+            }
+
             if (action == ".restore") {
                 func = [this](KeypadLayout::KeyMap& keymap) {
                     if (KeypadLayout::isReleased(keymap)) {
                         audioPlugin->hydrateJson(backup);
                         loaded = -1;
+                        morph.clear();
                     }
                 };
             }
@@ -103,6 +135,7 @@ public:
             if (action == ".exit") {
                 func = [this](KeypadLayout::KeyMap& keymap) {
                     loaded = -1;
+                    morph.clear();
                 };
             }
 
@@ -131,40 +164,56 @@ public:
         fontSize = config.value("fontSize", fontSize);
 
         encoderId = config.value("encoderId", encoderId);
-
-        fileBrowser.openFolder(folder);
+        /// The encoder morphing from the loaded preset to the one selected with the `.morph` action.
+        morphEncoderId = config.value("morphEncoderId", morphEncoderId); //eg: 2
+        /// The number of presets read in the background after the selected one, 1 before.
+        prefetchCount = config.value("prefetch", prefetchCount); //eg: 2
+
+        presets.open(folder);
+        if (audioPlugin && presets.count() > 0) {
+            presets.prefetch(position, audioPlugin, 1, prefetchCount);
+        }
     }
 
     void render() override
     {
         draw.filledRect(relativePosition, size, { bgColor });
 
-        int sep = 4;
         Point topPos = { relativePosition.x, relativePosition.y };
         Size topSize = { size.w, size.h };
 
         draw.filledRect(topPos, topSize, { foregroundColor });
 
-        if (fileBrowser.count > 1) {
-            int scrollW = size.w * ((float)(fileBrowser.position - 1) / (float)(fileBrowser.count - 1));
+        if (presets.count() > 1) {
+            int scrollW = size.w * ((float)position / (float)(presets.count() - 1));
             draw.filledRect(relativePosition, { scrollW, 2 }, { scrollColor });
         }
+        if (presets.count() == 0) {
+            return;
+        }
 
         int textY = topPos.y + (size.h - fontSize) * 0.5;
-        std::string filename = fileBrowser.getFileWithoutExtension(fileBrowser.position);
-        draw.text({ topPos.x + 4, textY }, filename, fontSize, { textEditColor, .font = font });
+        PresetIndex::Preset& preset = presets.get(position);
+        std::string name = preset.name;
+        if (morph.active() && morphTo >= 0 && morphTo < (int)presets.count()) {
+            name = presets.get(loaded).name + " > " + presets.get(morphTo).name + " " + std::to_string((int)(morph.get() * 100)) + "%";
+            draw.filledRect({ relativePosition.x, relativePosition.y + size.h - 2 }, { (int)(size.w * morph.get()), 2 }, { scrollColor });
+        } else if (!preset.category.empty()) {
+            draw.textRight({ topPos.x + size.w - 4, textY }, preset.category, fontSize, { textColor, .font = font });
+        }
+        draw.text({ topPos.x + 4, textY }, name, fontSize, { textEditColor, .font = font });
     }
 
     void onEncoder(int8_t id, int8_t direction) override
     {
-        if (id == encoderId) {
-            int position = fileBrowser.position + direction;
-            if (position < 1)
-                position = 1;
-            if (position > fileBrowser.count)
-                position = fileBrowser.count;
-
-            fileBrowser.position = position;
+        if (id == encoderId && presets.count() > 0) {
+            position = CLAMP(position + direction, 0, (int)presets.count() - 1);
+            if (audioPlugin) {
+                presets.prefetch(position, audioPlugin, 1, prefetchCount);
+            }
+            renderNext();
+        } else if (id == morphEncoderId && morph.active()) {
+            morph.set(morph.get() + direction * 0.01f);
             renderNext();
         }
     }
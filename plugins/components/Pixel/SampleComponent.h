@@ -16,7 +16,7 @@ The `SampleComponent` connects directly to a specific `AudioPlugin` to retrieve
 It then uses several internal drawing functions to construct the image:
 *   First, it draws the background and the fundamental waveform shape.
 *   Next, it renders the overlays (start, end, and sustain markers) on top, using color settings defined by the user.
-*   Finally, it constantly monitors the audio engine for the current playback location and updates the position of the moving marker, ensuring the visual feedback is instantaneous.
+*   Finally, it is told by the audio engine where the sample is played, at the end of each audio block where the position moved, and updates the moving marker, without checking the engine on every frame.
 
 The appearance and the specific audio controls it links to are highly configurable through external settings, allowing users to customize its colors and behavior.
 
@@ -55,6 +55,8 @@ protected:
     }* sampleBuffer = NULL;
     float* sampleIndex = NULL;
     int sampleIndexX = -1;
+    // Peaks of the sample, when the plugin provides them
+    const WaveformOverview** overview = NULL;
 
     std::string valueKeys[5] = {
         "BROWSER",
@@ -102,9 +104,18 @@ protected:
         }
     }
 
+    void setPosition(int32_t position)
+    {
+        int x = position < 0 ? -1 : relativePosition.x + size.w * position / PluginEvents::POSITION_RANGE;
+        if (sampleIndexX != x) {
+            sampleIndexX = x;
+            renderNext();
+        }
+    }
+
     void renderActiveSamples()
     {
-        if (sampleIndex != NULL && *sampleIndex != sampleBuffer->count) {
+        if (sampleIndexX >= 0) {
             // int y = relativePosition.y + size.h / 2 - 2;
             int y = relativePosition.y + 4;
             draw.filledRect({ sampleIndexX, y }, { 2, 4 }, { sampleColor });
@@ -128,17 +139,6 @@ public:
         , loopEndColor(styles.colors.white)
         , wave(props)
     {
-        jobRendering = [this](unsigned long now) {
-            if (sampleIndex != NULL) {
-                int x = relativePosition.x + size.w * ((*sampleIndex) / sampleBuffer->count);
-                if (sampleIndexX != x) {
-                    // printf("rerender sampleIndexX:%d x:%d\n", sampleIndexX, x);
-                    sampleIndexX = x;
-                    renderNext();
-                }
-            }
-        };
-
         /*md md_config:Rect */
         nlohmann::json& config = props.config;
 
@@ -175,6 +175,15 @@ public:
         if (plugin != NULL) {
             sampleBuffer = (struct SampleBuffer*)plugin->data(plugin->getDataId("SAMPLE_BUFFER"));
             sampleIndex = (float*)plugin->data(plugin->getDataId("SAMPLE_INDEX"));
+            // The plugin tells where the sample is played, instead of its index being checked on each frame
+            listen(plugin, PluginEvents::POSITION, [this](int32_t position) {
+                setPosition(position);
+            });
+            // Unknown data names fall back to the first data id, the sample buffer
+            uint8_t overviewId = plugin->getDataId("SAMPLE_OVERVIEW");
+            if (overviewId != plugin->getDataId("SAMPLE_BUFFER")) {
+                overview = (const WaveformOverview**)plugin->data(overviewId);
+            }
 
             watch(plugin->getValue(valueKeys[0].c_str())); // watch for file change
             startPosition = watch(plugin->getValue(valueKeys[1].c_str()));
@@ -186,6 +195,17 @@ public:
         /*md md_config_end */
     }
 
+    // The positions played while the view was hidden were not published to the component
+    void initView(uint16_t counter) override
+    {
+        Component::initView(counter);
+        if (sampleIndex != NULL && sampleBuffer->count && *sampleIndex < sampleBuffer->count) {
+            setPosition(*sampleIndex * PluginEvents::POSITION_RANGE / sampleBuffer->count);
+        } else {
+            setPosition(-1);
+        }
+    }
+
     void render()
     {
 
@@ -195,7 +215,7 @@ public:
 
             draw.filledRect(relativePosition, size, { background });
             wave.relativePosition.y = relativePosition.y;
-            wave.render(sampleBuffer->data, sampleBuffer->count);
+            wave.render(overview ? *overview : NULL, sampleBuffer->data, sampleBuffer->count);
 
             renderStartOverlay();
             renderEndOverlay();
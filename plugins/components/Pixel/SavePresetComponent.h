@@ -61,8 +61,9 @@ public:
         audioPlugin->serializeJson(json);
         // logDebug("json: %s", json.dump(4).c_str());
 
-        std::filesystem::create_directories(folder);
+        // A name like `Bass/Acid` saves the preset in the category `Bass`, see PresetIndex
         std::string filepath = folder + "/" + inputValue + ".json";
+        std::filesystem::create_directories(std::filesystem::path(filepath).parent_path());
         std::ofstream file(filepath);
         file << json.dump(4);
         file.close();
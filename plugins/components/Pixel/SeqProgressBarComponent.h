@@ -10,7 +10,7 @@ The visualization is presented as a series of small, colored blocks or rectangle
 
 It also includes an optional feature to display the volume level of the track right next to the step indicators.
 
-The component efficiently manages its rendering, automatically refreshing its display only when the current step counter changes, ensuring the visual feedback is immediate and accurate. Furthermore, it incorporates functionality to handle user interactions received through a physical or virtual keypad.
+The component efficiently manages its rendering, refreshing its display only when the sequencer publishes that the step played changed (instead of checking it on every frame), ensuring the visual feedback is immediate and accurate. Furthermore, it incorporates functionality to handle user interactions received through a physical or virtual keypad.
 
 sha: c90cc1bad66e6a157dbb067e5d7d1f5a742c92ff696e06e35eb7020006d734bc 
 */
@@ -62,22 +62,6 @@ public:
             return func;
         })
     {
-        jobRendering = [this](unsigned long now) {
-            if (seqPlayingPtr != NULL) {
-                if (*seqPlayingPtr) {
-                    if (stepCounter != NULL && lastStepCounter != *stepCounter) {
-                        lastStepCounter = *stepCounter;
-                        renderNext();
-                    }
-                } else {
-                    if (lastStepCounter != -1) {
-                        renderNext();
-                    }
-                    lastStepCounter = -1;
-                }
-            }
-        };
-
         /*md md_config:SeqProgressBar */
         nlohmann::json& config = props.config;
 
@@ -87,6 +71,13 @@ public:
         stepCounter = (uint16_t*)seqPlugin->data(seqPlugin->getDataId("STEP_COUNTER"));
         seqPlayingPtr = (bool*)seqPlugin->data(seqPlugin->getDataId("IS_PLAYING"));
         steps = (std::vector<Step>*)seqPlugin->data(seqPlugin->getDataId("STEPS"));
+        // The sequencer tells the step played, instead of its counter being checked on each frame
+        listen(seqPlugin, PluginEvents::STEP, [this](int32_t step) {
+            if (lastStepCounter != step) {
+                lastStepCounter = step;
+                renderNext();
+            }
+        });
 
         if (config.contains("volumePlugin")) { //eg: { "plugin": "Volume", "param": "VOLUME" }
             valVolume = watch(getPlugin(config["volumePlugin"]["plugin"].get<std::string>(), track).getValue(config["volumePlugin"]["param"].get<std::string>().c_str()));
@@ -113,30 +104,62 @@ public:
         /*md md_config_end */
     }
 
-    void render() override
+    // The steps played while the view was hidden were not published to the component
+    void initView(uint16_t counter) override
+    {
+        Component::initView(counter);
+        lastStepCounter = seqPlayingPtr != NULL && *seqPlayingPtr && stepCounter != NULL ? *stepCounter : -1;
+    }
+
+    // What was drawn for each step, so only the steps changing are drawn again, e.g. the playhead moving
+    enum StepState : uint8_t {
+        STEP_NONE,
+        STEP_PLAYING,
+        STEP_ON,
+        STEP_OFF,
+    };
+    std::vector<StepState> drawnSteps;
+    float drawnVolume = -1.0f;
+
+    StepState getStepState(int i)
     {
-        draw.filledRect(relativePosition, size, { background });
+        if (lastStepCounter == i) {
+            return STEP_PLAYING;
+        }
+        return !showSteps || getStep(i) != NULL ? STEP_ON : STEP_OFF;
+    }
 
+    void render() override
+    {
         int stepW = 4;
         int stepH = size.h;
 
-        int textY = (size.h - 8) * 0.5 + relativePosition.y;
-
         int stepsW = stepCount * (stepW + 2 + 0.5); // 2 / 4 adding 2 pixel every 4 steps
         int nameW = size.w - stepsW - 5;
         int x = relativePosition.x + 1;
 
-        if (valVolume != NULL) {
-            draw.filledRect({ x, relativePosition.y }, { nameW, stepH }, { darken(activeColor, 0.5) });
-            draw.filledRect({ x, relativePosition.y }, { (int)(nameW * valVolume->pct()), stepH }, { activeColor });
-            draw.rect({ x, relativePosition.y }, { nameW, stepH - 1 }, { selectionColor });
+        float volume = valVolume != NULL ? valVolume->pct() : 0.0f;
+        if (renderAll || volume != drawnVolume) {
+            renderAll = false;
+            drawnVolume = volume;
+            drawnSteps.assign(stepCount, STEP_NONE);
+            draw.filledRect(relativePosition, size, { background });
+            if (valVolume != NULL) {
+                draw.filledRect({ x, relativePosition.y }, { nameW, stepH }, { darken(activeColor, 0.5) });
+                draw.filledRect({ x, relativePosition.y }, { (int)(nameW * volume), stepH }, { activeColor });
+                draw.rect({ x, relativePosition.y }, { nameW, stepH - 1 }, { selectionColor });
+            }
         }
 
         x += nameW + 4;
 
         for (int i = 0; i < stepCount; i++) {
-            Color color = lastStepCounter == i ? activeColor : (!showSteps || getStep(i) != NULL ? foreground : inactiveStepColor);
-            draw.filledRect({ x, relativePosition.y }, { stepW, stepH }, { color });
+            StepState state = getStepState(i);
+            if (state != drawnSteps[i]) {
+                drawnSteps[i] = state;
+                Color color = state == STEP_PLAYING ? activeColor : (state == STEP_ON ? foreground : inactiveStepColor);
+                draw.filledRect({ x, relativePosition.y }, { stepW, stepH }, { color });
+            }
             x += stepW + 2;
             if (i % 4 == 3) {
                 x += 2;
@@ -32,6 +32,7 @@ sha: e5176abe7c693887b7263e170459a5749b7f7266970020f2575f779fa2cbc2ec
 #include "plugins/components/component.h"
 #include "plugins/components/utils/color.h"
 
+#include <algorithm>
 // #include <string>
 
 /*md
@@ -80,14 +81,19 @@ protected:
 
     bool renderPlayingStep = false;
     int lastPlayingStep = 0;
+    bool playing = false;
     std::function<void(bool)> onPlayStep = [this](bool isPlaying) {
         // renderPlayingStep = true;
         // renderNext();
+        playing = isPlaying;
         if (isPlaying) {
             jobRendering = [this](unsigned long now) {
                 jobLongpress(now);
-                renderPlayingStep = true;
-                renderNext();
+                // Only the playhead is drawn again, when it moved
+                if (*stepCounter != lastPlayingStep) {
+                    renderPlayingStep = true;
+                    Component::renderNext();
+                }
             };
         } else {
             renderNext();
@@ -291,13 +297,15 @@ public:
 
     void render() override
     {
-        if (renderPlayingStep) {
+        if (renderPlayingStep && !renderAll) {
             renderPlayingStep = false;
             renderWhichStepIsPlaying(lastPlayingStep, true);
             lastPlayingStep = (*stepCounter);
             renderWhichStepIsPlaying(lastPlayingStep);
             return;
         }
+        renderAll = false;
+        renderPlayingStep = false;
 
         draw.filledRect(relativePosition, size, { background });
 
@@ -366,6 +374,18 @@ public:
             }
             draw.rect(getStepPosition(selectedStep), { stepSize.w, stepSize.h - 1 /* need to substract 1 for whatever reason ^^, might be due to size */ }, { stepSelectedColor });
         }
+
+        if (playing) {
+            lastPlayingStep = (*stepCounter);
+            renderWhichStepIsPlaying(lastPlayingStep);
+        }
+    }
+
+    // Anything else than the playhead moving draws the whole card again
+    void renderNext() override
+    {
+        renderAll = true;
+        Component::renderNext();
     }
 
     void renderWhichStepIsPlaying(int stepPos, bool reset = false)
@@ -410,6 +430,11 @@ public:
         return Component::onKey(id, key, state, now);
     }
 
+    bool handlesKey(uint16_t id, int key) override
+    {
+        return std::find(gridKeys.begin(), gridKeys.end(), key) != gridKeys.end() || Component::handlesKey(id, key);
+    }
+
     Step* getStepAtPos(int pos)
     {
         if (steps != NULL) {
@@ -246,88 +246,184 @@ public:
         drawNoteStr = stepHeight >= 10;
     }
 
-    void render()
+    // Each cell of the grid covered by a note, where the note starts and ends, as the note is drawn over the
+    // separation lines between its cells
+    enum CellFlag : uint8_t {
+        CELL_NOTE = 1,
+        CELL_START = 2,
+        CELL_END = 4,
+    };
+    std::vector<uint8_t> cells;
+    // What was drawn in each column, so only the columns changing are drawn again
+    std::vector<uint32_t> drawnColumns;
+    int drawnStartNote = -1;
+
+    void updateCells()
     {
-        draw.filledRect(relativePosition, size, { background });
+        cells.assign(numNotes * numSteps, 0);
+        if (steps == NULL) {
+            return;
+        }
+        for (const auto& step : *steps) {
+            if (step.len && step.enabled && step.note >= midiStartNote && step.note < midiStartNote + numNotes) {
+                int row = numNotes - (step.note - midiStartNote) - 1;
+                // Notes going over the last step continue on the first ones
+                for (int l = 0; l < step.len; l++) {
+                    int col = (step.position + l) % numSteps;
+                    uint8_t& cell = cells[row * numSteps + col];
+                    cell |= CELL_NOTE;
+                    if (l == 0 || col == 0) {
+                        cell |= CELL_START;
+                    }
+                    if (l == step.len - 1 || col == numSteps - 1) {
+                        cell |= CELL_END;
+                    }
+                }
+            }
+        }
+    }
 
-        // xStart for steps (margin left)
-        int xStart = drawNoteStr ? size.w - stepWidth * numSteps : 0;
-        if (xStart < 16) {
-            xStart = 0;
+    // Columns the selection is drawn over, it can be wider than a step
+    int selectionSpan()
+    {
+        return stepWidth > 0 ? (3 + 2) / stepWidth + 1 : numSteps;
+    }
+
+    uint32_t columnState(int col)
+    {
+        uint32_t state = 0;
+        for (int row = 0; row < numNotes; row++) {
+            state = state * 31 + cells[row * numSteps + col];
+        }
+        if (abs(selectedStep - col) <= selectionSpan()) {
+            state = state * 31 + (selectedStep - col + 64) * 256 + (selectedNote - midiStartNote) + 1;
         }
+        return state;
+    }
 
-        // Draw Grid with Piano Roll Styling & Note Names
-        for (int i = 0; i < numNotes; ++i) {
-            int y = relativePosition.y + i * stepHeight;
-            int x = relativePosition.x;
-            int midiNote = midiStartNote + numNotes - i - 1;
-            Color color = isBlackKey(midiNote) ? blackKeyColor : whiteKeyColor;
-            draw.filledRect({ x, y }, { size.w, stepHeight }, { color });
-            draw.line({ x, y }, { x + size.w, y }, { rowSeparatorColor });
-
-            if (xStart) {
-                if (midiNote % 12 == 0) {
-                    draw.text({ x, y + 1 }, MIDI_NOTES_STR[midiNote], 8, { textColor, .font = font });
-                } else if (!isBlackKey(midiNote)) {
-                    draw.text({ x, y + 1 }, MIDI_NOTES_STR[midiNote], 8, { text2Color, .font = font });
-                } else {
-                    draw.text({ x, y + 1 }, " #", 8, { text2Color, .font = font });
+    void renderNotes(int xStart)
+    {
+        updateCells();
+        // A full render restored the whole layer, every column is drawn
+        bool all = drawnColumns.size() != numSteps;
+        drawnColumns.resize(numSteps, 0);
+        std::vector<bool> changed(numSteps, all);
+        for (int col = 0; col < numSteps; col++) {
+            uint32_t state = columnState(col);
+            if (state != drawnColumns[col]) {
+                drawnColumns[col] = state;
+                changed[col] = true;
+            }
+        }
+        // The selection is blended on top, so it is drawn again only over columns restored from the layer
+        int span = selectionSpan();
+        for (int col = std::max(selectedStep - span, 0); col <= std::min(selectedStep + span, numSteps - 1); col++) {
+            if (changed[col]) {
+                for (int c = std::max(selectedStep - span, 0); c <= std::min(selectedStep + span, numSteps - 1); c++) {
+                    changed[c] = true;
                 }
+                break;
             }
         }
 
-        // Draw Beat & Bar Separations
-        for (int i = 0; i <= numSteps; ++i) {
-            int x = xStart + relativePosition.x + i * stepWidth;
-            int y = relativePosition.y;
-            Color color;
-            if (i % 16 == 0)
-                color = barColor; // Bar line
-            else if (i % 4 == 0)
-                color = beatColor; // Beat line
-            else
-                color = colSeparatorColor;
-
-            draw.line({ x, y }, { x, y + size.h - toolboxHeight }, { color });
+        int gridH = size.h - toolboxHeight;
+        for (int col = 0; col < numSteps; col++) {
+            if (!changed[col]) {
+                continue;
+            }
+            int x = relativePosition.x + xStart + col * stepWidth;
+            if (!all) {
+                restoreLayer(midiStartNote, { { x, relativePosition.y }, { stepWidth, gridH } });
+            }
+            for (int row = 0; row < numNotes; row++) {
+                uint8_t cell = cells[row * numSteps + col];
+                if (cell & CELL_NOTE) {
+                    int start = cell & CELL_START ? 1 : 0;
+                    int end = cell & CELL_END ? 1 : 0;
+                    draw.filledRect({ x + start, relativePosition.y + row * stepHeight }, { stepWidth - start - end, stepHeight }, { stepColor });
+                }
+            }
         }
 
-        if (steps != NULL) {
-            // Draw MIDI Notes
-            for (const auto& step : *steps) {
-                if (step.len && step.enabled && step.note >= midiStartNote && step.note < midiStartNote + numNotes) {
-                    int x = xStart + step.position * stepWidth + 1;
-                    int y = (numNotes - (step.note - midiStartNote) - 1) * stepHeight;
-
-                    if (step.position + step.len > numSteps) {
-                        int width = (numSteps - step.position) * stepWidth - 2;
-                        draw.filledRect({ x, y }, { width, stepHeight }, { stepColor });
-                        width = (step.len - (numSteps - step.position)) * stepWidth - 2;
-                        draw.filledRect({ xStart + 1, y }, { width, stepHeight }, { stepColor });
-                    } else {
-                        int width = step.len * stepWidth - 2;
-                        draw.filledRect({ x, y }, { width, stepHeight }, { stepColor });
+        if (changed[selectedStep]) {
+            int x = relativePosition.x + xStart + selectedStep * stepWidth + 1;
+            int y = relativePosition.y + (numNotes - (selectedNote - midiStartNote) - 1) * stepHeight;
+            // draw.rect({ x, y }, { stepWidth - 1, stepHeight - 1 }, { selectedColor });
+            draw.filledCircle({ x + stepWidth / 2, y + stepHeight / 2 }, 3, { selectedColor });
+        }
+    }
+
+    void render()
+    {
+        // xStart for steps (margin left)
+        int xStart = drawNoteStr ? size.w - stepWidth * numSteps : 0;
+        if (xStart < 16) {
+            xStart = 0;
+        }
+
+        // Background, piano roll and labels only change when scrolling through the notes. Else only the columns
+        // changing are erased from the layer and drawn again.
+        bool full = renderAll || drawnStartNote != midiStartNote || !restoreLayer(midiStartNote, { relativePosition, { 0, 0 } });
+        if (full) {
+            renderAll = false;
+            drawnStartNote = midiStartNote;
+            drawnColumns.clear();
+            renderLayer(midiStartNote, [&]() {
+                draw.filledRect(relativePosition, size, { background });
+
+                // Draw Grid with Piano Roll Styling & Note Names
+                for (int i = 0; i < numNotes; ++i) {
+                    int y = relativePosition.y + i * stepHeight;
+                    int x = relativePosition.x;
+                    int midiNote = midiStartNote + numNotes - i - 1;
+                    Color color = isBlackKey(midiNote) ? blackKeyColor : whiteKeyColor;
+                    draw.filledRect({ x, y }, { size.w, stepHeight }, { color });
+                    draw.line({ x, y }, { x + size.w, y }, { rowSeparatorColor });
+
+                    if (xStart) {
+                        if (midiNote % 12 == 0) {
+                            draw.text({ x, y + 1 }, MIDI_NOTES_STR[midiNote], 8, { textColor, .font = font });
+                        } else if (!isBlackKey(midiNote)) {
+                            draw.text({ x, y + 1 }, MIDI_NOTES_STR[midiNote], 8, { text2Color, .font = font });
+                        } else {
+                            draw.text({ x, y + 1 }, " #", 8, { text2Color, .font = font });
+                        }
                     }
                 }
-            }
+
+                // Draw Beat & Bar Separations
+                for (int i = 0; i <= numSteps; ++i) {
+                    int x = xStart + relativePosition.x + i * stepWidth;
+                    int y = relativePosition.y;
+                    Color color;
+                    if (i % 16 == 0)
+                        color = barColor; // Bar line
+                    else if (i % 4 == 0)
+                        color = beatColor; // Beat line
+                    else
+                        color = colSeparatorColor;
+
+                    draw.line({ x, y }, { x, y + size.h - toolboxHeight }, { color });
+                }
+
+                // Toolbox
+                int y = relativePosition.y + size.h - toolboxHeight + 1;
+                // "Step Note Len Vel. Cond. Motion"
+                draw.text({ relativePosition.x + 2, y }, "Step", 8, { text2Color, .font = font });
+                draw.text({ relativePosition.x + 32, y }, "Note", 8, { text2Color, .font = font });
+                draw.text({ relativePosition.x + 64, y }, "Len", 8, { text2Color, .font = font });
+                draw.text({ relativePosition.x + 86, y }, "Vel.", 8, { text2Color, .font = font });
+                draw.text({ relativePosition.x + 120, y }, "Cond.", 8, { text2Color, .font = font });
+                draw.text({ relativePosition.x + 160, y }, "Motion", 8, { text2Color, .font = font });
+            });
         }
 
-        // Draw Selection
-        int x = xStart + selectedStep * stepWidth + 1;
-        int y = (numNotes - (selectedNote - midiStartNote) - 1) * stepHeight;
-        // draw.rect({ x, y }, { stepWidth - 1, stepHeight - 1 }, { selectedColor });
-        draw.filledCircle({ x + stepWidth / 2, y + stepHeight / 2 }, 3, { selectedColor });
+        renderNotes(xStart);
 
-        // Toolbox
+        // Toolbox values, on top of the labels of the static layer
         Step* step = getSelectedStep();
-        y = size.h - toolboxHeight + 1;
-        // "Step Note Len Vel. Cond. Motion"
-        draw.text({ relativePosition.x + 2, y }, "Step", 8, { text2Color, .font = font });
-        draw.text({ relativePosition.x + 32, y }, "Note", 8, { text2Color, .font = font });
-        draw.text({ relativePosition.x + 64, y }, "Len", 8, { text2Color, .font = font });
-        draw.text({ relativePosition.x + 86, y }, "Vel.", 8, { text2Color, .font = font });
-        draw.text({ relativePosition.x + 120, y }, "Cond.", 8, { text2Color, .font = font });
-        draw.text({ relativePosition.x + 160, y }, "Motion", 8, { text2Color, .font = font });
-        y += 8;
+        int y = relativePosition.y + size.h - toolboxHeight + 1 + 8;
+        restoreLayer(midiStartNote, { { relativePosition.x, y }, { size.w, relativePosition.y + size.h - y } });
         draw.textRight({ relativePosition.x + 22, y }, std::to_string(step ? step->position + 1 : selectedStep + 1), 8, { textColor, .font = font });
         draw.text({ relativePosition.x + 32, y }, MIDI_NOTES_STR[selectedNote], 8, { stepColor, .font = font });
         draw.textRight({ relativePosition.x + 78, y }, std::to_string(step ? step->len : 0), 8, { textColor, .font = font });
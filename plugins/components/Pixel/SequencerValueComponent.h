@@ -114,7 +114,7 @@ public:
         /*md   encoderId={0} */
         encoderId = config.value("encoderId", encoderId);
 
-        /// Type: "STEP_SELECTION", "STEP_TOGGLE", "STEP_NOTE", "STEP_VELOCITY", "STEP_CONDITION", "STEP_LENGTH"
+        /// Type: "STEP_SELECTION", "STEP_TOGGLE", "STEP_NOTE", "STEP_VELOCITY", "STEP_CONDITION", "STEP_LENGTH", "STEP_OFFSET"
         std::string type = config.value("type", "STEP_SELECTION");
         if (type == "STEP_TOGGLE") {
             renderFn = std::bind(&SequencerValueComponent::renderStepToggle, this);
@@ -134,6 +134,9 @@ public:
         } else if (type == "STEP_MOTION") {
             renderFn = std::bind(&SequencerValueComponent::renderStepMotion, this);
             onEncoderFn = std::bind(&SequencerValueComponent::onEncoderStepMotion, this, std::placeholders::_1);
+        } else if (type == "STEP_OFFSET") {
+            renderFn = std::bind(&SequencerValueComponent::renderStepOffset, this);
+            onEncoderFn = std::bind(&SequencerValueComponent::onEncoderStepOffset, this, std::placeholders::_1);
         } else if (type == "STEP_LENGTH_AND_TOGGLE") {
             renderFn = std::bind(&SequencerValueComponent::renderStepLengthAndToggle, this);
             onEncoderFn = std::bind(&SequencerValueComponent::onEncoderStepLengthAndToggle, this, std::placeholders::_1);
@@ -290,6 +293,30 @@ protected:
         }
     }
 
+    void renderStepOffset()
+    {
+        Step* step = getSelectedStep();
+        int x = relativePosition.x + (size.w) * 0.5;
+        int y = relativePosition.y;
+
+        if (step && step->offset != 0) {
+            draw.textCentered({ x, y }, (step->offset > 0 ? "+" : "") + std::to_string(step->offset) + "%", valueFontSize, { valueColor, .font = fontValue });
+        } else {
+            draw.textCentered({ x, y }, "---", valueFontSize, { labelColor, .font = fontValue });
+        }
+        y += valueFontSize + 2;
+        draw.textCentered({ x, y }, "Offset", labelFontSize, { labelColor, .font = fontLabel });
+    }
+
+    void onEncoderStepOffset(int8_t direction)
+    {
+        Step* step = getSelectedStep();
+        if (step) {
+            step->setOffset(step->offset + direction);
+            renderNext();
+        }
+    }
+
     void renderStepLength()
     {
         Step* step = getSelectedStep();
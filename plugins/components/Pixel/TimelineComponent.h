@@ -14,7 +14,7 @@ The component visualizes a "timeline," which is a sequence of events, mostly inv
     *   **Scrolling/Navigation:** It supports scrolling the timeline view left and right, either using a rotary encoder or by dragging the screen.
     *   **Dragging Clips:** Selected clips can be moved (dragged) along the timeline to change their starting position.
 4.  **Context Sharing:** The component uses a mechanism called "Context" to communicate its current state (like the selected track number or the current view start position) with other components in the application, ensuring a synchronized user experience.
-5.  **Responsiveness:** It automatically adjusts the visible step count when the component's size changes, ensuring optimal usage of screen space.
+5.  **Responsiveness:** It automatically adjusts the visible step count when the component's size changes, ensuring optimal usage of screen space. Only the clips and loops visible in the window are looked at, found by binary search in the indexes of the timeline, so long arrangements render as fast as short ones.
 
 Tags: Timeline Management, Clip Arranging, Graphical Sequencer, Musical Notation Display, Audio Production Interface
 sha: 4868c38015d9916de51a6e5f5fc6d216274c4b4781c8b6fa964b9923616b18b4
@@ -38,6 +38,7 @@ protected:
     AudioPlugin* clipSequencerPlugin = nullptr;
     Timeline* timeline = nullptr;
     uint8_t loadClipDataId = 1;
+    uint8_t timelineChangedDataId = 2;
     Clip clip;
 
     // Viewport
@@ -63,7 +64,6 @@ protected:
     std::string sequencerPlugin = "Sequencer";
     std::string enginePlugin = "Track";
     struct ClipData {
-        int index = 0;
         std::vector<Step> steps;
         uint16_t stepCount = 64;
         std::string engine = "";
@@ -89,13 +89,51 @@ protected:
     int16_t trackMax = 1;
 
     Timeline::Event* selectedClipEvent = nullptr;
-    int clipCount = 0;
+
+    // Interval index of the clips: the furthest end of the clips up to each one, in the order of `timeline->clips`.
+    // Being sorted, the first clip reaching the view is a binary search, so rendering is proportional to what is
+    // visible and not to the length of the arrangement.
+    std::vector<int32_t> clipMaxEnds;
+
+    int32_t clipEnd(Timeline::Event& ev)
+    {
+        return ev.step + (ev.data ? static_cast<ClipData*>(ev.data)->stepCount : 0);
+    }
+
+    void indexClips()
+    {
+        clipMaxEnds.clear();
+        int32_t maxEnd = 0;
+        for (size_t i = 0; i < timeline->clips.size(); i++) {
+            maxEnd = std::max(maxEnd, clipEnd(timeline->clip(i)));
+            clipMaxEnds.push_back(maxEnd);
+        }
+    }
+
+    // Call `fn` with the clips visible from `stepStart` to `stepEnd`, by position in `timeline->clips`
+    template <typename Fn>
+    void forEachVisibleClip(int32_t stepStart, int32_t stepEnd, Fn fn)
+    {
+        size_t first = std::upper_bound(clipMaxEnds.begin(), clipMaxEnds.end(), stepStart) - clipMaxEnds.begin();
+        for (size_t i = first; i < timeline->clips.size() && (int32_t)timeline->clipSteps[i] < stepEnd; i++) {
+            Timeline::Event& ev = timeline->clip(i);
+            if (ev.data && clipEnd(ev) > stepStart) {
+                fn(i, ev);
+            }
+        }
+    }
+
+    // Position of the event in `timeline->clips`
+    size_t clipPosition(Timeline::Event* ev)
+    {
+        uint16_t index = ev - timeline->events.data();
+        return std::lower_bound(timeline->clips.begin(), timeline->clips.end(), index) - timeline->clips.begin();
+    }
 
     void loadClips()
     {
         if (!timeline) return;
 
-        int clipIndex = 0;
         for (auto& event : timeline->events) {
             if (event.type == Timeline::EventType::LOAD_CLIP) {
                 auto json = clip.hydrate(clip.getFilename(event.value));
@@ -120,22 +158,19 @@ protected:
                     data->engine = engineJson.value("engine", "");
                     data->engineType = engineJson.value("engineType", "");
                 }
-                data->index = clipIndex++;
                 event.data = data;
             }
         }
-        clipCount = clipIndex;
+        indexClips();
     }
 
-    Timeline::Event* getClipEvent(int index)
+    // Next clip with data from the clip at `position`, in `direction`
+    Timeline::Event* getClipEvent(size_t position, int8_t direction)
     {
         if (!timeline) return nullptr;
-        for (auto& event : timeline->events) {
-            if (event.type == Timeline::EventType::LOAD_CLIP) {
-                auto* data = static_cast<ClipData*>(event.data);
-                if (data && data->index == index) {
-                    return &event;
-                }
+        for (size_t i = position + direction; i < timeline->clips.size(); i += direction) {
+            if (timeline->clip(i).data) {
+                return &timeline->clip(i);
             }
         }
         return nullptr;
@@ -169,13 +204,8 @@ protected:
     {
         if (!selectedClipEvent) return;
 
-        int currentIndex = static_cast<ClipData*>(selectedClipEvent->data)->index;
-        currentIndex += (direction > 0 ? 1 : -1);
-        currentIndex = std::clamp(currentIndex, 0, clipCount - 1);
-
-        Timeline::Event* nextEvent = getClipEvent(currentIndex);
+        Timeline::Event* nextEvent = getClipEvent(clipPosition(selectedClipEvent), direction > 0 ? 1 : -1);
         if (!nextEvent) return;
-        auto* nextData = static_cast<ClipData*>(nextEvent->data);
         selectedStep = nextEvent->step;
         fitClipOnScreen(nextEvent);
 
@@ -223,60 +253,39 @@ protected:
     Timeline::Event* getClipEventAtCoordinates(int x, int y)
     {
         if (!timeline) return nullptr;
-        // Check every clip event
-        // for (auto& ev : timeline->events) {
-        // Iterate in reverse so top-most clip is found first
-        for (int i = (int)timeline->events.size() - 1; i >= 0; --i) {
-            auto& ev = timeline->events[i];
-            if (ev.type != Timeline::EventType::LOAD_CLIP || !ev.data)
-                continue;
-
-            ClipData* clipData = static_cast<ClipData*>(ev.data);
-            int clipStart = ev.step;
-            int clipEnd = ev.step + clipData->stepCount;
-
+        // Only the visible clips, the last one matching being the top-most one
+        Timeline::Event* found = nullptr;
+        forEachVisibleClip(viewStepStart, viewStepStart + viewStepCount, [&](size_t, Timeline::Event& ev) {
             // Convert clip bounds to screen pixel positions
-            int visibleStart = std::max(clipStart, viewStepStart);
-            int visibleEnd = std::min(clipEnd, viewStepStart + viewStepCount);
-            if (visibleEnd <= visibleStart)
-                continue;
+            int visibleStart = std::max((int32_t)ev.step, viewStepStart);
+            int visibleEnd = std::min(clipEnd(ev), viewStepStart + viewStepCount);
 
             int xA = relativePosition.x + (visibleStart - viewStepStart) * stepPixel;
             int xB = relativePosition.x + (visibleEnd - viewStepStart) * stepPixel;
             int boxWidth = xB - xA;
 
             if (x >= xA && x <= xA + boxWidth) {
-                return &ev;
+                found = &ev;
             }
-        }
-        return nullptr;
+        });
+        return found;
     }
 
     Timeline::Event* getClosestClipToViewStart(bool reverse = false)
     {
         if (!timeline) return nullptr;
+        size_t position = timeline->firstClip(viewStepStart);
         if (reverse) {
-            for (int i = (int)timeline->events.size() - 1; i >= 0; --i) {
-                auto& ev = timeline->events[i];
-                if (ev.type != Timeline::EventType::LOAD_CLIP || !ev.data)
-                    continue;
-
-                if (ev.step <= viewStepStart) {
-                    return &ev;
-                }
-            }
-        } else {
-            for (auto& ev : timeline->events) {
-                if (ev.type != Timeline::EventType::LOAD_CLIP || !ev.data)
-                    continue;
-
-                if (ev.step >= viewStepStart) {
-                    return &ev;
-                }
+            // Last clip on the view start or before
+            if (position < timeline->clips.size() && (int32_t)timeline->clipSteps[position] == viewStepStart && timeline->clip(position).data) {
+                return &timeline->clip(position);
             }
+            return getClipEvent(position, -1);
         }
-
-        return nullptr;
+        if (position < timeline->clips.size() && timeline->clip(position).data) {
+            return &timeline->clip(position);
+        }
+        return getClipEvent(position, 1);
     }
 
     bool isClipVisible(Timeline::Event* ev)
@@ -339,6 +348,7 @@ public:
         if (clipSequencerPlugin) {
             timeline = (Timeline*)clipSequencerPlugin->data(clipSequencerPlugin->getDataId(config.value("timelineDataId", "TIMELINE")));
             loadClipDataId = clipSequencerPlugin->getDataId(config.value("loadClipDataId", "LOAD_CLIP"));
+            timelineChangedDataId = clipSequencerPlugin->getDataId("TIMELINE_CHANGED");
         }
 
         // TODO use workspace config from timeline...
@@ -454,31 +464,31 @@ public:
 
         if (!timeline) return;
 
-        // RENDER EVENTS
-        for (auto& ev : timeline->events) {
-            if (ev.step < viewStepStart && ev.step > viewStepStart + viewStepCount)
-                continue;
-
+        // RENDER EVENTS, only the visible ones, in the order of the timeline
+        int32_t viewEnd = viewStepStart + viewStepCount;
+        forEachVisibleClip(viewStepStart, viewEnd, [&](size_t, Timeline::Event& ev) {
             int x = relativePosition.x + (ev.step - viewStepStart) * stepPixel;
+            ClipData* clipData = static_cast<ClipData*>(ev.data);
 
-            if (ev.type == Timeline::EventType::LOAD_CLIP) {
-                if (ev.data) {
-                    ClipData* clipData = static_cast<ClipData*>(ev.data);
-
-                    draw.filledRect({ x, relativePosition.y }, { 36, laneHeight }, { clipColor });
-                    Point textPos = { x + 2, relativePosition.y + (laneHeight - fontLaneSize) / 2 };
-                    draw.text(textPos, "Clip: " + std::to_string(ev.value), fontLaneSize, { textColor, .font = fontLane });
-                    textPos.x += 38;
-                    draw.text(textPos, clipData->engineType + " " + clipData->engine, fontLaneSize, { textColor, .font = fontLane });
-
-                    renderClipPreview(x, relativePosition.y + laneHeight, ev, clipData);
-                }
-            } else if (ev.type == Timeline::EventType::LOOP_BACK) {
-                // draw.filledCircle({ x + 2, relativePosition.y + laneHeight / 2 }, 4, { loopColor });
-                draw.filledRect({ x, relativePosition.y }, { 36, laneHeight }, { barColor });
-                draw.filledRect({ x, relativePosition.y }, { 2, laneHeight }, { loopColor });
-                draw.text({ x + 5, relativePosition.y + (laneHeight - fontLaneSize) / 2 }, "<- " + std::to_string(ev.value), fontLaneSize, { textColor, .font = fontLane });
-            }
+            draw.filledRect({ x, relativePosition.y }, { 36, laneHeight }, { clipColor });
+            Point textPos = { x + 2, relativePosition.y + (laneHeight - fontLaneSize) / 2 };
+            draw.text(textPos, "Clip: " + std::to_string(ev.value), fontLaneSize, { textColor, .font = fontLane });
+            textPos.x += 38;
+            draw.text(textPos, clipData->engineType + " " + clipData->engine, fontLaneSize, { textColor, .font = fontLane });
+
+            renderClipPreview(x, relativePosition.y + laneHeight, ev, clipData);
+        });
+
+        // The label of a loop starting before the view can still be visible
+        int32_t loopLabelSteps = 36 / stepPixel + 1;
+        for (size_t i = timeline->firstLoop(std::max(0, viewStepStart - loopLabelSteps));
+            i < timeline->loops.size() && (int32_t)timeline->loopSteps[i] <= viewEnd; i++) {
+            Timeline::Event& ev = timeline->loop(i);
+            int x = relativePosition.x + ((int32_t)ev.step - viewStepStart) * stepPixel;
+            // draw.filledCircle({ x + 2, relativePosition.y + laneHeight / 2 }, 4, { loopColor });
+            draw.filledRect({ x, relativePosition.y }, { 36, laneHeight }, { barColor });
+            draw.filledRect({ x, relativePosition.y }, { 2, laneHeight }, { loopColor });
+            draw.text({ x + 5, relativePosition.y + (laneHeight - fontLaneSize) / 2 }, "<- " + std::to_string(ev.value), fontLaneSize, { textColor, .font = fontLane });
         }
     }
 
@@ -600,12 +610,14 @@ public:
             if (selectedClipEvent) {
                 int stepDelta = dx / stepPixel; // drag right = move clip right
                 if (stepDelta != 0) {
-                    selectedClipEvent->step += stepDelta;
-
                     // Prevent negative steps
-                    if (selectedClipEvent->step < 0) {
-                        selectedClipEvent->step = 0;
-                    }
+                    int32_t step = std::max(0, (int32_t)selectedClipEvent->step + stepDelta);
+                    // Kept sorted and indexed, the event possibly moving in the timeline
+                    uint16_t index = timeline->setStep(selectedClipEvent - timeline->events.data(), step);
+                    selectedClipEvent = &timeline->events[index];
+                    indexClips();
+                    // Compiled again for playback
+                    clipSequencerPlugin->data(timelineChangedDataId);
                     selectedStep = selectedClipEvent->step;
 
                     lastDragX = mx; // update last position for next delta
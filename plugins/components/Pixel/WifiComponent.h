@@ -7,12 +7,12 @@ The primary function of the WifiComponent is to provide a user interface for con
 
 1.  **Network Scanning:** It actively searches for nearby Wi-Fi networks (SSIDs) and maintains a list of available options.
 2.  **Password Input:** It provides a mechanism for entering and editing the security password, including visual cues for the cursor position and the option to mask the characters.
-3.  **Connection Management:** It saves the network credentials to the operating system's configuration files and executes the necessary commands to establish and maintain a connection.
-4.  **Status Display:** It shows messages to the user regarding the scanning process, connection attempts, and the final connection status.
+3.  **Connection Management:** It hands the network credentials over to wpa_supplicant through its control interface, which saves them and establishes the connection. Without it, it saves them to the operating system's configuration files and executes the necessary commands itself (`"backend": "shell"`).
+4.  **Status Display:** It shows messages to the user regarding the scanning process, connection attempts, and the final connection status, along with the signal level of the networks. The scan results and connection changes are pushed by wpa_supplicant as they happen, and kept between views.
 
 **How It Works**
 
-The component operates by running essential system commands in the background. When a user requests a network scan or connection, the component launches a separate, dedicated background task. This allows the main application interface to remain responsive while waiting for the operating system to find networks or negotiate a connection.
+The component operates by running essential system commands in the background. When a user requests a network scan or connection, the component hands the job over to the shared background workers of the interface, and applies the result once it is done. This allows the main application interface to remain responsive while waiting for the operating system to find networks or negotiate a connection.
 
 The component is highly interactive, designed to respond to physical input devices called "encoders" (like rotary dials). These encoders allow the user to quickly navigate the list of discovered networks, move the cursor within the password field, and cycle through characters for input.
 
@@ -24,18 +24,15 @@ sha: d654c4e9c099dbce82b3ab5639c7405ea06ef620593bc1d67229b488491f6bd9
 
 /* WifiComponent.h */
 
-#include "helpers/http.h" // for execCmd helper style (we reimplement execCmd below)
+#include "helpers/execCmd.h"
+#include "helpers/wifiMonitor.h"
 #include "plugins/components/component.h"
 #include "plugins/components/utils/color.h"
 
-#include <atomic>
-#include <chrono>
 #include <fstream>
-#include <future>
 #include <regex>
 #include <sstream>
 #include <string>
-#include <thread>
 #include <vector>
 
 class WifiComponent : public Component {
@@ -63,23 +60,26 @@ protected:
 
     std::string charset = "abcdefghijklmnopqrstuvwxyzABCDEFGHIJKLMNOPQRSTUVWXYZ0123456789!@#$%^&*()-_=+[]{};:,.?/<> ";
 
-    std::atomic<bool> scanning { false };
-    std::atomic<bool> connecting { false };
+    // Only touched by the UI thread, the background tasks handing their results over to their completion
+    bool scanning = false;
+    bool connecting = false;
     std::string lastMessage;
-
-    // Helper to execute shell command and capture output
-    static std::string execCmd(const std::string& cmd)
-    {
-        std::array<char, 256> buffer;
-        std::string result;
-        FILE* pipe = popen((cmd + " 2>&1").c_str(), "r");
-        if (!pipe)
-            return "";
-        while (fgets(buffer.data(), buffer.size(), pipe) != nullptr)
-            result += buffer.data();
-        pclose(pipe);
-        return result;
-    }
+    uint32_t messageId = 0;
+    // A new scan replaces the previous one
+    TaskExecutor::Token scanToken;
+
+    // Through the control interface of wpa_supplicant (see helpers/wifiMonitor.h), else with the shell commands
+    bool nativeBackend = true;
+    std::string ctrlDir = "/var/run/wpa_supplicant";
+    bool native = false;
+    // dBm of each network of `ssids`, 0 if unknown
+    std::vector<int> signals;
+    int signal = 0;
+    uint32_t scansBefore = 0;
+    std::string connectingTo;
+    uint32_t connectAttempt = 0;
+    // Once the native backend connected to a network, wpa_supplicant not asking for an address itself
+    std::string dhcpCmd;
 
     // Helper to get Wi-Fi interface name from environment (default: wlan0)
     std::string getInterface() const
@@ -94,90 +94,149 @@ protected:
     {
         lastMessage = msg;
         renderNext();
-        std::thread([this, durationMs]() {
-            std::this_thread::sleep_for(std::chrono::milliseconds(durationMs));
-            lastMessage = "";
-            renderNext();
-        }).detach();
+        uint32_t id = ++messageId;
+        executor->after(durationMs, [this, id]() {
+            // Unless replaced by another message meanwhile
+            if (id == messageId) {
+                lastMessage = "";
+                renderNext();
+            }
+        });
     }
 
-    void scanNetworksAsync()
+    static std::vector<std::string> parseScan(const std::string& output)
     {
-        if (scanning)
-            return;
-        scanning = true;
+        std::vector<std::string> found;
+        std::regex essidRegex("ESSID:\\\"(.*)\\\"");
+        std::istringstream iss(output);
+        std::string line;
+        while (std::getline(iss, line)) {
+            line.erase(0, line.find_first_not_of(" \t\r\n"));
+            line.erase(line.find_last_not_of(" \t\r\n") + 1);
+            if (line.empty())
+                continue;
+
+            if (line.find("SSID:") == 0) {
+                std::string s = line.substr(5);
+                if (!s.empty())
+                    found.push_back(s);
+                continue;
+            }
+
+            std::smatch m;
+            if (std::regex_search(line, m, essidRegex)) {
+                std::string s = m[1];
+                if (!s.empty())
+                    found.push_back(s);
+            }
+        }
+        return found;
+    }
+
+    static std::string readCurrentSSID()
+    {
+        std::string s = execCmd("iwgetid -r 2>/dev/null");
+        s.erase(s.find_last_not_of(" \n\r") + 1);
+        return s;
+    }
+
+    // UI thread, once the monitor changed, the networks it knows being kept between the views
+    void applyMonitor()
+    {
+        std::vector<WifiMonitor::Network> networks;
+        WifiMonitor::Status status;
+        WifiMonitor::get().snapshot(networks, status);
+        currentSSID = status.ssid;
+        signal = status.signal;
+
+        // Keep the network selected by the user
+        std::string selected = ssids.empty() ? currentSSID : ssids[currentNetworkIndex];
         ssids.clear();
-        // showMessage("Scanning...", 500);
-        renderNext();
+        signals.clear();
+        currentNetworkIndex = 0;
+        for (auto& network : networks) {
+            if (network.ssid == selected)
+                currentNetworkIndex = ssids.size();
+            ssids.push_back(network.ssid);
+            signals.push_back(network.signal);
+        }
 
-        std::thread([this]() {
-            try {
-                logDebug("Scanning networks...");
-                std::string output = execCmd("iwlist " + getInterface() + " scan");
-
-                if (!output.empty()) {
-                    std::istringstream iss(output);
-                    std::string line;
-                    while (std::getline(iss, line)) {
-                        line.erase(0, line.find_first_not_of(" \t\r\n"));
-                        line.erase(line.find_last_not_of(" \t\r\n") + 1);
-                        if (line.empty())
-                            continue;
-
-                        if (line.find("SSID:") == 0) {
-                            std::string s = line.substr(5);
-                            if (!s.empty())
-                                ssids.push_back(s);
-                            continue;
-                        }
+        if (scanning && WifiMonitor::get().scans() != scansBefore) {
+            scanning = false;
+            showMessage(ssids.empty() ? "No networks found" : "Found " + std::to_string(ssids.size()) + " networks", 1500);
+        }
+        if (connecting && status.connected && status.ssid == connectingTo) {
+            connecting = false;
+            showMessage("Connected", 1200);
+            if (!dhcpCmd.empty()) {
+                executor->post([cmd = dhcpCmd]() -> TaskExecutor::Completion {
+                    execCmd(cmd);
+                    return NULL;
+                },
+                    TaskExecutor::LOW);
+            }
+        }
+        renderNext();
+    }
 
-                        std::smatch m;
-                        std::regex essidRegex("ESSID:\\\"(.*)\\\"");
-                        if (std::regex_search(line, m, essidRegex)) {
-                            std::string s = m[1];
-                            // logDebug("Found SSID: %s", s.c_str());
-                            if (!s.empty())
-                                ssids.push_back(s);
-                            continue;
-                        }
+    void scanNetworksAsync()
+    {
+        if (scanning)
+            return;
+        if (native) {
+            uint32_t scans = scansBefore = WifiMonitor::get().scans();
+            scanning = executor->post([this]() -> TaskExecutor::Completion {
+                bool requested = WifiMonitor::get().scan();
+                return [this, requested]() {
+                    if (!requested) {
+                        scanning = false;
+                        showMessage("Scan failed", 1000);
                     }
+                };
+            });
+            // The results come with an event of wpa_supplicant, in case it never comes
+            executor->after(10000, [this, scans]() {
+                if (scanning && scansBefore == scans) {
+                    scanning = false;
+                    renderNext();
                 }
+            });
+            renderNext();
+            return;
+        }
+        TaskExecutor::cancel(scanToken);
+        scanToken = TaskExecutor::token();
+        ssids.clear();
+        renderNext();
 
+        scanning = executor->post([this, iface = getInterface()]() -> TaskExecutor::Completion {
+            logDebug("Scanning networks...");
+            std::vector<std::string> found = parseScan(execCmd("iwlist " + iface + " scan"));
+            std::string current = readCurrentSSID();
+            return [this, found, current]() {
+                scanning = false;
+                ssids = found;
+                currentSSID = current;
                 logDebug("Found %d networks", ssids.size());
-
                 if (ssids.empty()) {
                     showMessage("No networks found", 1500);
-                } else {
-                    std::string current = getCurrentSSID();
-                    for (size_t i = 0; i < ssids.size(); i++) {
-                        if (ssids[i] == current) {
-                            currentNetworkIndex = i;
-                            break;
-                        }
+                    return;
+                }
+                currentNetworkIndex = 0;
+                for (size_t i = 0; i < ssids.size(); i++) {
+                    if (ssids[i] == currentSSID) {
+                        currentNetworkIndex = i;
+                        break;
                     }
-                    showMessage("Found " + std::to_string(ssids.size()) + " networks", 1500);
                 }
-            } catch (...) {
-                showMessage("Scan failed", 1000);
-            }
-            scanning = false;
-        }).detach();
+                showMessage("Found " + std::to_string(ssids.size()) + " networks", 1500);
+            };
+        },
+            TaskExecutor::NORMAL, scanToken);
     }
 
+    // Set by the completions of the background tasks, the rendering never running a command
     std::string currentSSID = "";
-    std::string& getCurrentSSID()
-    {
-        if (!currentSSID.empty())
-            return currentSSID;
-
-        std::string s = execCmd("iwgetid -r");
-        if (!s.empty()) {
-            s.erase(s.find_last_not_of(" \n\r") + 1);
-            currentSSID = s;
-            logDebug("Current SSID: %s", currentSSID.c_str());
-        }
-        return currentSSID;
-    }
 
     void saveNetworkToWpaSupplicant(const std::string& ssid, const std::string& pass)
     {
@@ -200,28 +259,59 @@ protected:
     {
         if (connecting)
             return;
-        connecting = true;
-        showMessage("Connecting...", 500);
-
-        std::thread([this, ssid, pass]() {
-            try {
-                std::string iface = getInterface();
-                saveNetworkToWpaSupplicant(ssid, pass); // Step 1
-                execCmd("killall wpa_supplicant 2>/dev/null || true"); // Step 2
-                execCmd("wpa_supplicant -B -i " + iface + " -c /etc/wpa_supplicant.conf"); // Step 3
-                execCmd("udhcpc -i " + iface + " || dhclient " + iface + " || true"); // Step 4
-                std::this_thread::sleep_for(std::chrono::seconds(2));
-                std::string current = getCurrentSSID();
-                if (!current.empty() && current == ssid)
-                    showMessage("Connected", 1200);
-                else
-                    showMessage("Connect failed", 1500);
-            } catch (...) {
-                showMessage("Connect error", 1200);
+        if (native) {
+            connectingTo = ssid;
+            uint32_t attempt = ++connectAttempt;
+            connecting = executor->post([this, ssid, pass]() -> TaskExecutor::Completion {
+                bool selected = WifiMonitor::get().connect(ssid, pass);
+                return [this, selected]() {
+                    if (!selected) {
+                        connecting = false;
+                        showMessage("Connect failed", 1500);
+                    }
+                };
+            },
+                TaskExecutor::HIGH);
+            if (connecting) {
+                // Until the connected event of wpa_supplicant, see applyMonitor()
+                showMessage("Connecting...", 15000);
+                executor->after(15000, [this, attempt]() {
+                    if (connecting && attempt == connectAttempt) {
+                        connecting = false;
+                        showMessage("Connect failed", 1500);
+                    }
+                });
             }
-            connecting = false;
-            renderNext();
-        }).detach();
+            return;
+        }
+        connecting = executor->post([this, ssid, pass, iface = getInterface()]() -> TaskExecutor::Completion {
+            saveNetworkToWpaSupplicant(ssid, pass); // Step 1
+            execCmd("killall wpa_supplicant 2>/dev/null || true"); // Step 2
+            execCmd("wpa_supplicant -B -i " + iface + " -c /etc/wpa_supplicant.conf"); // Step 3
+            execCmd("udhcpc -i " + iface + " || dhclient " + iface + " || true"); // Step 4
+            // Checked once the link had the time to come up, without holding a worker meanwhile
+            return [this, ssid]() {
+                bool posted = executor->post([this, ssid]() -> TaskExecutor::Completion {
+                    std::string current = readCurrentSSID();
+                    return [this, ssid, current]() {
+                        connecting = false;
+                        currentSSID = current;
+                        if (!current.empty() && current == ssid)
+                            showMessage("Connected", 1200);
+                        else
+                            showMessage("Connect failed", 1500);
+                    };
+                },
+                    TaskExecutor::NORMAL, NULL, 2000);
+                if (!posted) {
+                    connecting = false;
+                }
+            };
+        },
+            TaskExecutor::HIGH);
+        if (connecting) {
+            showMessage("Connecting...", 500);
+        }
     }
 
     std::string getSavedPassword()
@@ -324,16 +414,44 @@ public:
         cursorEncoderId = config.value("cursorEncoderId", cursorEncoderId);
         masked = config.value("masked", masked);
 
-        // scanNetworksAsync();
+        // "backend": "shell" runs iwlist and restarts wpa_supplicant, instead of using its control interface
+        nativeBackend = config.value("backend", "wpa_ctrl") != "shell";
+        ctrlDir = config.value("ctrlDir", ctrlDir);
+        dhcpCmd = config.value("dhcpCmd", "");
 
         password = getSavedPassword();
         cursorPos = password.length();
     }
 
+    // Not at startup, which only loads what is needed to play, but once the component is shown
+    void startMonitor()
+    {
+        std::string iface = getInterface();
+        if (nativeBackend) {
+            native = WifiMonitor::get().start(iface, ctrlDir);
+        }
+        if (native) {
+            if (dhcpCmd.empty()) {
+                dhcpCmd = "udhcpc -i " + iface + " -n -q || dhclient " + iface + " || true";
+            }
+            WifiMonitor::get().listen([this]() { executor->after(0, [this]() { applyMonitor(); }); });
+            applyMonitor();
+        }
+    }
+
+    // Once shown, the monitor and the timers call it back
+    bool canRelease() override
+    {
+        return !initialized;
+    }
+
     void render() override
     {
         if (!initialized) {
-            scanNetworksAsync();
+            startMonitor();
+            // The networks found from another view are shown right away
+            if (!native || ssids.empty())
+                scanNetworksAsync();
             initialized = true;
         }
 
@@ -361,9 +479,10 @@ public:
         draw.text({ topPos.x + 4, textY }, ssidText, fontSize, { textColor, .font = font });
 
         if (lastMessage.empty()) {
-            std::string cur = getCurrentSSID();
-            if (!cur.empty() && cur == ssidText)
-                draw.textRight({ topPos.x + topSize.w - 4, textY }, "Connected", fontSize, { activeColor, .font = font });
+            if (!currentSSID.empty() && currentSSID == ssidText)
+                draw.textRight({ topPos.x + topSize.w - 4, textY }, signal ? std::to_string(signal) + "dBm" : "Connected", fontSize, { activeColor, .font = font });
+            else if (native && !scanning && !ssids.empty() && signals[currentNetworkIndex])
+                draw.textRight({ topPos.x + topSize.w - 4, textY }, std::to_string(signals[currentNetworkIndex]) + "dBm", fontSize, { textEditColor, .font = font });
         }
 
         draw.filledRect(botPos, botSize, { foregroundColor });
@@ -0,0 +1,93 @@
+#pragma once
+
+#include "host/XrunLog.h"
+#include "plugins/components/component.h"
+#include "plugins/components/utils/color.h"
+
+#include <string>
+
+/*md
+## XrunLog
+
+XrunLog component is used to display the dropouts of the audio output and the blocks missing their deadline: the counters, followed by the last entries with the CPU frequency and temperature at the time of the dropout.
+
+Requires the host config `"xrunLog": true` (default).
+*/
+
+class XrunLogComponent : public Component {
+protected:
+    Color bgColor;
+    Color textColor;
+    Color warningColor;
+
+    int fontSize = 8;
+    unsigned long refreshMs = 500;
+    unsigned long lastRender = 0;
+    uint64_t lastCount = 0;
+
+    XrunLog* xrunLog = NULL;
+
+public:
+    XrunLogComponent(ComponentInterface::Props props)
+        : Component(props)
+        , bgColor(styles.colors.background)
+        , textColor(styles.colors.text)
+        , warningColor(styles.colors.secondary)
+    {
+        jobRendering = [this](unsigned long now) {
+            if (now - lastRender > refreshMs) {
+                lastRender = now;
+                renderNext();
+            }
+        };
+
+        /*md md_config:XrunLog */
+        nlohmann::json& config = props.config;
+
+        /// The background color.
+        bgColor = draw.getColor(config["bgColor"], bgColor); //eg: "#000000"
+
+        /// The color of the text.
+        textColor = draw.getColor(config["textColor"], textColor); //eg: "#ffffff"
+
+        /// The color of the most recent entry.
+        warningColor = draw.getColor(config["warningColor"], warningColor); //eg: "#ff8a94"
+
+        /// The font size.
+        fontSize = config.value("fontSize", fontSize); //eg: 8
+
+        /// The refresh interval in milliseconds.
+        refreshMs = config.value("refreshMs", refreshMs); //eg: 500
+
+        /*md md_config_end */
+    }
+
+    void render() override
+    {
+        draw.filledRect(relativePosition, size, { bgColor });
+
+        if (xrunLog == NULL && getAudioPluginHandler != NULL) {
+            AudioPluginHandlerInterface* host = getAudioPluginHandler();
+            xrunLog = (XrunLog*)host->data(host->getDataId("XRUN_LOG"));
+        }
+        if (xrunLog == NULL) {
+            draw.text({ relativePosition.x, relativePosition.y }, "Xrun log disabled", fontSize, { textColor });
+            return;
+        }
+
+        int y = relativePosition.y;
+        std::string counters = "xrun " + std::to_string(xrunLog->xruns) + " partial " + std::to_string(xrunLog->partialWrites)
+            + " late " + std::to_string(xrunLog->deadlineMisses);
+        draw.text({ relativePosition.x, y }, counters, fontSize, { textColor });
+
+        uint64_t now = XrunLog::now();
+        XrunLog::Entry entry;
+        for (uint32_t n = 0; y + 2 * (fontSize + 2) <= relativePosition.y + size.h && xrunLog->get(n, entry); n++) {
+            y += fontSize + 2;
+            std::string line = std::string(XrunLog::typeName(entry.type)) + " -" + std::to_string((now - entry.timeNs) / 1000000000ULL) + "s "
+                + std::to_string(entry.cpuKHz / 1000) + "MHz " + std::to_string(entry.milliCelsius / 1000) + "C";
+            draw.text({ relativePosition.x, y }, line, fontSize, { n == 0 && xrunLog->count() != lastCount ? warningColor : textColor });
+        }
+        lastCount = xrunLog->count();
+    }
+};
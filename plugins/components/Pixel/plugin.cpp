@@ -26,6 +26,21 @@ sha: d5fd50a62d2f6b5febb1eb2ad335da3c813f26d5318aea0bc068be38cfcb7c7f
 
 #include PLUGIN_INCLUDE 
 
+#ifdef PLUGIN_STATIC
+// Linked in the binary, see `make static`: registered by name instead of being found by `dlsym()`
+#include "helpers/staticLibs.h"
+
+#define PLUGIN_STRING(name) #name
+#define PLUGIN_NAME_STRING(name) PLUGIN_STRING(name)
+
+namespace {
+ComponentInterface* allocator(PLUGIN_PROPS props)
+{
+	return new PLUGIN_NAME(props);
+}
+StaticLibs::Register registration("component", PLUGIN_NAME_STRING(PLUGIN_NAME), (void*)&allocator);
+}
+#else
 extern "C"
 {
 	PLUGIN_NAME *allocator(PLUGIN_PROPS props)
@@ -38,3 +53,4 @@ extern "C"
 		delete ptr;
 	}
 }
+#endif
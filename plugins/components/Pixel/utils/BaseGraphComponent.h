@@ -8,8 +8,9 @@ This component handles all the visual styling and rendering mechanics, while lea
 1.  **Foundation and Customization:** The component acts as a canvas that manages its appearance. It initializes default colors (background, primary fill, and outline) but allows these to be overridden by external configuration settings. It also controls whether the graph should be displayed as a solid shape (filled) or just the border (outline).
 2.  **Connecting Data:** It establishes a link to a specific `AudioPlugin` source to ensure the graph can visualize data coming from the right place in the audio system.
 3.  **Drawing Process:** When the component is asked to draw itself, it first paints a solid background rectangle. Then, it follows a simple process to draw the graph:
-    *   It requests the raw data (the sequence of points defining the graph's shape) from the specialized class that extends this blueprint.
+    *   It requests the raw data (the sequence of points defining the graph's shape) from the specialized class that extends this blueprint, into a buffer kept between the renderings, only when one of the watched values changed.
     *   It translates these raw points to the correct location on the screen.
+    *   As long as the points did not change, the graph drawn the last time is restored from a layer cached by the renderer.
     *   It draws the resulting shape: first drawing the solid area using the fill color (if enabled), and then drawing the border lines using the outline color (if enabled).
 
 In essence, this class provides the framework and the paintbrush, while relying on derived components to supply the specific picture to be drawn.
@@ -36,24 +37,50 @@ protected:
 
     int waveformHeight = 30;
 
-    void renderGraph()
+    // Points of the graph on the screen, kept between the renderings and only computed again when one of the watched
+    // values changed, or the component moved, `graphVersion` then telling the renderer its cached layer is outdated
+    std::vector<Point> points;
+    std::vector<float> pointsValues;
+    Point pointsPosition = { -1, -1 };
+    Size pointsSize = { -1, -1 };
+    uint32_t graphVersion = 0;
+
+    void updatePoints()
     {
-        std::vector<Point> relativePoints = getPoints();
-        // printf("renderGraph %ld points\n", relativePoints.size());
-        if (relativePoints.size() > 2) {
-            for (auto& point : relativePoints) {
-                point.y += relativePosition.y;
-                point.x += relativePosition.x;
-                // printf("[x %d y %d]\n", point.x, point.y);
+        bool changed = pointsPosition.x != relativePosition.x || pointsPosition.y != relativePosition.y
+            || pointsSize.w != size.w || pointsSize.h != size.h || pointsValues.size() != values.size();
+        pointsValues.resize(values.size());
+        for (size_t i = 0; i < values.size(); i++) {
+            float value = values[i]->get();
+            if (pointsValues[i] != value) {
+                pointsValues[i] = value;
+                changed = true;
             }
-            // printf("draw\n");
+        }
+        if (!changed) {
+            return;
+        }
+        pointsPosition = relativePosition;
+        pointsSize = size;
+        graphVersion++;
+
+        points.clear();
+        getPoints(points);
+        for (auto& point : points) {
+            point.y += relativePosition.y;
+            point.x += relativePosition.x;
+        }
+    }
+
+    void renderGraph()
+    {
+        if (points.size() > 2) {
             if (filled) {
-                draw.filledPolygon(relativePoints, { fillColor });
+                draw.filledPolygon(points, { fillColor });
             }
             if (outline) {
-                draw.lines(relativePoints, { outlineColor });
+                draw.lines(points, { outlineColor });
             }
-            // printf("draw end\n");
         }
     }
 
@@ -76,11 +103,16 @@ public:
         outlineColor = draw.getColor(config["outlineColor"], outlineColor);
     }
 
-    virtual std::vector<Point> getPoints() = 0;
+    // Append the points of the graph to `points`, relative to the component
+    virtual void getPoints(std::vector<Point>& points) = 0;
 
+    // Drawn again only when the points changed, else restored from the layer cached by the renderer
     void render() override
     {
-        draw.filledRect(relativePosition, size, { bgColor });
-        renderGraph();
+        updatePoints();
+        renderLayer(graphVersion, [&]() {
+            draw.filledRect(relativePosition, size, { bgColor });
+            renderGraph();
+        });
     }
 };
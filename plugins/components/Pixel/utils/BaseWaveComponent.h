@@ -7,7 +7,8 @@ This header file defines a specialized graphical building block called the "Base
 2.  **Visualization Process:** When the wave needs to be drawn, the component maps the long sequence of input samples onto the limited width of the screen area. For every pixel column across its width, it selects the appropriate sample value and translates that number into a vertical line height.
 3.  **Centered Drawing:** All vertical lines are drawn centered around a middle horizontal axis of the component, showing positive sample values extending up and negative values extending down.
 4.  **Layered Appearance:** To give the waveform a defined look and depth, the component uses three automatically generated shades of color (a light shade, a middle shade, and a darker outline shade) derived from a single primary color. It draws three nested lines at every point, creating a visually layered effect.
-5.  **Customization:** The component allows external controls to easily feed it new sample data for real-time updates and to change the entire color scheme of the wave representation.
+5.  **Long Samples:** When given the precomputed peaks of the sample (a waveform overview), each column is drawn from the minimum, maximum and average level of the samples it covers, in the same time whatever the length of the sample, instead of picking a single sample.
+6.  **Customization:** The component allows external controls to easily feed it new sample data for real-time updates and to change the entire color scheme of the wave representation.
 
 In essence, this component acts as a high-performance translator, converting complex numerical data into a simple, dynamic, and layered visual wave display.
 
@@ -16,6 +17,7 @@ sha: e85718bcc72ef3d9f81bb3805c49a052410c3bdcf806b5785af81a6f56c69bec
 #ifndef _UI_PIXEL_BASE_COMPONENT_WAVE_H_
 #define _UI_PIXEL_BASE_COMPONENT_WAVE_H_
 
+#include "audio/utils/WaveformOverview.h"
 #include "plugins/components/component.h"
 #include "plugins/components/utils/color.h"
 
@@ -87,6 +89,39 @@ public:
         }
     }
 
+    // Draw from the peaks of the overview, so it takes the same time whatever the number of samples: the full
+    // shade from the min to the max of each pixel, the other ones from the RMS.
+    void render(const WaveformOverview* overview, float* buffer, uint64_t count)
+    {
+        if (!overview || overview->samples() != count || size.w <= 0) {
+            render(buffer, count);
+            return;
+        }
+        int8_t level = overview->levelFor((float)count / size.w);
+        if (level < 0) {
+            render(buffer, count);
+            return;
+        }
+
+        yCenter = relativePosition.y + lineHeight;
+
+        for (int i = 0; i < size.w; i++) {
+            uint64_t from = (i * count) / size.w;
+            uint64_t to = ((i + 1) * count) / size.w;
+            WaveformOverview::Peak peak = overview->range(level, from, to);
+            int top = static_cast<int>(std::min(peak.max, 1.0f) * lineHeight);
+            int bottom = static_cast<int>(std::max(peak.min, -1.0f) * lineHeight);
+            int rms = static_cast<int>(std::min(peak.rms, 1.0f) * lineHeight);
+            if (top != bottom) {
+                draw.line({ i, yCenter - top }, { i, yCenter - bottom }, { colors.wave });
+                draw.line({ i, yCenter - rms }, { i, yCenter + rms }, { colors.waveMiddle });
+                draw.line({ i, (int)(yCenter - rms * 0.5f) }, { i, (int)(yCenter + rms * 0.5f) }, { colors.waveOutline });
+            } else {
+                draw.pixel({ i, yCenter }, { colors.waveOutline });
+            }
+        }
+    }
+
     void render()
     {
         render(bufferSamples, samplesCount);
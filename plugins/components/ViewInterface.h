@@ -42,5 +42,7 @@ public:
     {
     }
 
+    virtual ~ViewInterface() { }
+
     virtual void pushToRenderingQueue(void* component) = 0;
 };
@@ -13,7 +13,7 @@ The system then provides a dedicated function ready to draw that specific image.
 3.  **Color:** The color to be used for rendering.
 4.  **Alignment:** How the icon is positioned relative to the coordinates (left, center, or right justified).
 
-Many icons also feature "filled" variants for solid shapes versus simple outlines. This setup ensures that every part of the user interface can consistently access and display high-quality, standardized graphical assets by name.
+Many icons also feature "filled" variants for solid shapes versus simple outlines. Each icon is rasterized once per size and alignment into a mask, which the drawing engine then only blends in the requested color, so the lines and polygons are not computed again on every frame. This setup ensures that every part of the user interface can consistently access and display high-quality, standardized graphical assets by name.
 
 sha: 4af919b81c6b8104d3ddc218a04a68ce75ac4f33383f207186fc1524be41cb12 
 */
@@ -47,7 +47,25 @@ public:
     {
     }
 
+    // Icon `name`, drawn from its mask, see DrawInterface::drawMask(), except the ones drawn in more than one color
     std::function<void(Point, uint8_t, Color, Align)> get(std::string name)
+    {
+        std::function<void(Point, uint8_t, Color, Align)> func = getRenderer(name);
+        if (!func || name == "&icon::shutdown" || name == "&empty") {
+            return func;
+        }
+        uint64_t id = std::hash<std::string>()(name) << 10;
+        return [this, func, id](Point position, uint8_t size, Color color, Align align) {
+            int s = size;
+            // Aligned right, the widest icons, like the toggle, start twice their size before their position
+            Rect bounds = { { -2 * s - 2, -s - 2 }, { 4 * s + 4, 3 * s + 4 } };
+            draw.drawMask(id ^ (size << 2) ^ align, position, bounds, color, [&](Point origin, Color maskColor) {
+                func(origin, size, maskColor, align);
+            });
+        };
+    }
+
+    std::function<void(Point, uint8_t, Color, Align)> getRenderer(std::string name)
     {
         // if first char is different than & then it's not an icon
         if (name[0] != '&') {
@@ -24,6 +24,7 @@ sha: ffba812f0d75a16bcd7b5ede7c90f64d314ac0bb1436cd8488640be7c29001c9
 #include <stdint.h>
 #include <string.h>
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 #include "helpers/controller.h"
@@ -68,6 +69,37 @@ public:
 
     std::vector<KeyMap> mapping;
 
+    // Bumped each time a key map is added to any layout, so the key routing of the containers is rebuilt
+    static inline uint32_t generation = 0;
+
+protected:
+    // Indexes in `mapping` of the key maps of each controller key, in the order they were added, so a key only
+    // goes through its own key maps instead of all of them. Rebuilt on the first key after key maps were added.
+    std::unordered_map<uint32_t, std::vector<uint16_t>> keyIndex;
+    size_t indexedCount = 0;
+
+    static uint32_t keyIndexId(uint16_t id, uint8_t key)
+    {
+        return ((uint32_t)id << 8) | key;
+    }
+
+    std::vector<uint16_t>* candidates(uint16_t id, int key)
+    {
+        if (key < 0 || key > 255) {
+            return NULL;
+        }
+        if (indexedCount != mapping.size()) {
+            keyIndex.clear();
+            for (size_t i = 0; i < mapping.size(); i++) {
+                keyIndex[keyIndexId(mapping[i].controllerId, mapping[i].key)].push_back(i);
+            }
+            indexedCount = mapping.size();
+        }
+        auto it = keyIndex.find(keyIndexId(id, key));
+        return it == keyIndex.end() ? NULL : &it->second;
+    }
+
+public:
     std::function<std::function<void(KeypadLayout::KeyMap& keymap)>(std::string action)> getCustomAction;
 
     // Publicly available to be eventually overridden
@@ -112,6 +144,7 @@ public:
             props.contextValue,
             props.multipleKeyHandler,
         });
+        generation++;
     };
 
     KeypadLayout(ComponentInterface* component)
@@ -203,12 +236,23 @@ public:
     //     return false;
     // }
 
+    // Whether the layout has a key map for this key, whatever the context
+    bool hasKey(uint16_t id, int key)
+    {
+        return candidates(id, key) != NULL;
+    }
+
     bool onKey(uint16_t id, int key, int8_t state, unsigned long now)
     {
         // printf("keypad id %d key %d state %d mapping.size %ld\n", id, key, state, mapping.size());
-        for (KeyMap& keyMap : mapping) {
-            if (keyMap.controllerId == id && keyMap.key == key
-                && (!keyMap.useContext || component->view->contextVar[keyMap.contextId] == keyMap.contextValue)) {
+        std::vector<uint16_t>* keyMaps = candidates(id, key);
+        if (!keyMaps) {
+            return false;
+        }
+        // The context is checked on the spot: a context var is set right away but its onContext comes later
+        for (uint16_t index : *keyMaps) {
+            KeyMap& keyMap = mapping[index];
+            if (!keyMap.useContext || component->view->contextVar[keyMap.contextId] == keyMap.contextValue) {
                 bool actionDone = false;
                 if (state == 1) {
                     // keyMap.isLongPress = false;
@@ -311,15 +355,23 @@ public:
             };
         }
 
+        // `audioEvent:FREEZE_TRACK:2` sends the event to track 2, to all the tracks without a track
         if (action.rfind("audioEvent:") == 0) {
-            AudioEventType id = getEventTypeFromName(action.substr(11).c_str());
+            std::string name = action.substr(11);
+            int16_t track = -1;
+            size_t separator = name.find(':');
+            if (separator != std::string::npos) {
+                track = atoi(name.substr(separator + 1).c_str());
+                name = name.substr(0, separator);
+            }
+            AudioEventType id = getEventTypeFromName(name.c_str());
             if (id == AudioEventType::UNKNOWN) {
-                logWarn("[Keypad] Unknown audio event: %s", action.substr(11).c_str());
+                logWarn("[Keypad] Unknown audio event: %s", name.c_str());
                 return NULL;
             }
-            return [this, id](KeypadLayout::KeyMap& keymap) {
+            return [this, id, track](KeypadLayout::KeyMap& keymap) {
                 if (isReleased(keymap)) {
-                    component->sendAudioEvent(id, -1);
+                    component->sendAudioEvent(id, track);
                 }
             };
         }
@@ -65,14 +65,45 @@ public:
         return value;
     }
 
+    // Call `listener` with the events of type `type` published by `plugin`, while the view of the component is shown
+    void listen(AudioPlugin* plugin, PluginEvents::Type type, PluginEvents::Listener listener)
+    {
+        if (plugin != NULL) {
+            pluginListeners.push_back({ plugin, type, listener });
+        }
+    }
+
+    // Set when the whole component must be drawn again: when the view is shown, the component becomes visible or
+    // is resized. Components drawing only what changed since their last render start over from scratch then.
+    bool renderAll = true;
+
     virtual void render() override { }
     virtual void initView(uint16_t counter) override
     {
+        renderAll = true;
         if (isVisible()) {
             controllerColor.render();
         }
     }
 
+    // Draw the static parts of the component (background, grid, labels...) with `renderStatic` only when `version`
+    // changed or the component was resized, else restore them from the layer cached by the renderer. The dynamic
+    // parts are drawn after, on top of it.
+    void renderLayer(uint32_t version, std::function<void()> renderStatic)
+    {
+        if (!draw.restoreLayer(this, relativePosition, size, version)) {
+            renderStatic();
+            draw.saveLayer(this, relativePosition, size, version);
+        }
+    }
+
+    // Restore the part `region` of the static layer, e.g. to erase a cell before drawing it again. Return false if
+    // the layer is not up to date, the whole component must then be drawn again.
+    bool restoreLayer(uint32_t version, Rect region)
+    {
+        return draw.restoreLayer(this, relativePosition, size, version, &region);
+    }
+
     virtual void renderNext() override
     {
         if (isVisible()) {
@@ -127,6 +158,11 @@ public:
         return false;
     }
 
+    virtual bool handlesKey(uint16_t id, int key) override
+    {
+        return keypadLayout.hasKey(id, key);
+    }
+
     virtual void resize() override
     {
     }
@@ -134,6 +170,7 @@ public:
     virtual void onContext(uint8_t index, float value) override
     {
         if (visibilityContext.onContext(index, value)) {
+            renderAll = true;
             renderNext();
             if (isVisible()) {
                 controllerColor.render();
@@ -179,6 +216,7 @@ public:
         resizeOriginToRelative(resizeType, xFactor, yFactor, position, sizeOriginal, relativePosition, size);
         relativePosition.x += containerPosistion.x;
         relativePosition.y += containerPosistion.y;
+        renderAll = true;
         renderNext();
         resize();
     }
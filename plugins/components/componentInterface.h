@@ -23,6 +23,8 @@ sha: 9323cf3c4420985e078dcd61bba3b37ef793ee70f8edefe9e68e94278c1e8b2c
 #include "./drawInterface.h"
 #include "./motionInterface.h"
 #include "./valueInterface.h"
+#include "helpers/pluginEvents.h"
+#include "helpers/taskExecutor.h"
 #include "plugins/controllers/controllerInterface.h"
 
 #include "libs/nlohmann/json.hpp"
@@ -42,6 +44,9 @@ public:
         ControllerInterface* (*getController)(const char* name);
         ViewInterface* view;
         std::function<void(uint8_t index, float value)> setContext;
+        AudioPluginHandlerInterface* (*getAudioPluginHandler)() = NULL;
+        // Background tasks, their completion running on the UI thread, see helpers/taskExecutor.h
+        TaskExecutor* executor = NULL;
     };
 
     DrawInterface& draw;
@@ -51,7 +56,16 @@ public:
     ControllerInterface* (*getController)(const char* name);
     void (*sendAudioEvent)(AudioEventType event, int16_t track);
     std::function<void(uint8_t index, float value)> setContext;
+    AudioPluginHandlerInterface* (*getAudioPluginHandler)();
+    TaskExecutor* executor;
     std::vector<ValueInterface*> values;
+    // Events of the audio plugins the component listens to while its view is shown, see helpers/pluginEvents.h
+    struct PluginListener {
+        void* source;
+        PluginEvents::Type type;
+        PluginEvents::Listener listener;
+    };
+    std::vector<PluginListener> pluginListeners;
     Point position;
     Point relativePosition = { 0, 0 };
     Size size;
@@ -70,6 +84,8 @@ public:
         , getController(props.getController)
         , view(props.view)
         , setContext(props.setContext)
+        , getAudioPluginHandler(props.getAudioPluginHandler)
+        , executor(props.executor)
         , position(props.position)
         , relativePosition(props.position)
         , size(props.size)
@@ -79,6 +95,13 @@ public:
         // printf("ComponentInterface: %d x %d\n", props.position.x, props.position.y);
     }
 
+    // Deleted with its view, when the view is released by the ViewManager
+    virtual ~ComponentInterface() { }
+
+    // False while the component can still be called back, e.g. by a background task or a monitor, its view being
+    // kept loaded meanwhile
+    virtual bool canRelease() { return true; }
+
     virtual void clear() = 0;
     virtual void render() = 0;
     virtual void renderNext() = 0;
@@ -89,6 +112,8 @@ public:
     virtual void handleMotionRelease(MotionInterface& motion) = 0; // <--- should this go away?
     virtual void onEncoder(int8_t id, int8_t direction) = 0;
     virtual bool onKey(uint16_t id, int key, int8_t state, unsigned long now) = 0;
+    // Whether the component might handle this key, the containers only routing a key to those that do
+    virtual bool handlesKey(uint16_t id, int key) { return true; }
     virtual void onContext(uint8_t index, float value) = 0;
     virtual void onUpdate(ValueInterface* value) = 0;
     virtual bool isVisible() = 0;
@@ -17,8 +17,14 @@ sha: 1855682992204270d2d58fa606a5179faed4e788c52525488c7f91d0be7bbbcd
 #pragma once
 
 #include "helpers/enc.h"
+#include "helpers/frameScheduler.h"
+#include "helpers/pluginEvents.h"
+#include "helpers/renderProbe.h"
+#include "helpers/trace.h"
+#include "helpers/valueChanges.h"
 #include "log.h"
 #include "plugins/components/ViewInterface.h"
+#include "plugins/components/base/KeypadLayout.h"
 #include "plugins/components/componentInterface.h"
 #include "plugins/components/drawInterface.h"
 #include "plugins/components/utils/VisibilityContext.h"
@@ -26,6 +32,7 @@ sha: 1855682992204270d2d58fa606a5179faed4e788c52525488c7f91d0be7bbbcd
 #include "plugins/components/utils/resize.h"
 
 #include <string>
+#include <unordered_map>
 #include <vector>
 
 class Container {
@@ -42,6 +49,31 @@ protected:
 
     uint16_t initCounter = 0;
 
+    // Components handling each controller key, in their order, so a key doesn't go through all of them, e.g. a
+    // grid of pads. Rebuilt once components or key maps were added.
+    std::unordered_map<uint64_t, std::vector<ComponentInterface*>> keyComponents;
+    uint32_t keyComponentsGeneration = UINT32_MAX;
+
+    std::vector<ComponentInterface*>& getKeyComponents(uint16_t id, int key)
+    {
+        if (keyComponentsGeneration != KeypadLayout::generation) {
+            keyComponents.clear();
+            keyComponentsGeneration = KeypadLayout::generation;
+        }
+        uint64_t keyId = ((uint64_t)id << 32) | (uint32_t)key;
+        auto it = keyComponents.find(keyId);
+        if (it == keyComponents.end()) {
+            std::vector<ComponentInterface*> handlers;
+            for (auto& component : components) {
+                if (component->handlesKey(id, key)) {
+                    handlers.push_back(component);
+                }
+            }
+            it = keyComponents.emplace(keyId, handlers).first;
+        }
+        return it->second;
+    }
+
     void onUpdate(ValueInterface* val)
     {
         for (auto& component : components) {
@@ -115,9 +147,10 @@ public:
             component->initView(initCounter);
             component->renderNext();
             for (auto* value : component->values) {
-                value->setOnUpdateCallback(
-                    [this](float, void* data) { onUpdate((ValueInterface*)data); },
-                    value);
+                ValueChanges::get().subscribe(value, this, [this](ValueInterface* value) { onUpdate(value); });
+            }
+            for (auto& l : component->pluginListeners) {
+                PluginEvents::get().subscribe(l.source, l.type, component, l.listener);
             }
         }
         initCounter++;
@@ -127,6 +160,7 @@ public:
     {
         if (!isVisible()) return;
         componentsToRender.push_back((ComponentInterface*)component);
+        FrameScheduler::get().wake();
     }
 
     bool onContext(uint8_t index, float value)
@@ -143,6 +177,7 @@ public:
     void addComponent(ComponentInterface* component)
     {
         components.push_back(component);
+        keyComponents.clear();
         if (component->jobRendering) {
             componentsJob.push_back(component);
         }
@@ -156,6 +191,8 @@ public:
             for (auto& component : componentsJob) {
                 if (component->isVisible()) {
                     component->jobRendering(now);
+                    // The jobs poll their state, the next frame is due even if nothing is queued
+                    FrameScheduler::get().animate();
                 }
             }
         }
@@ -163,7 +200,15 @@ public:
         if (componentsToRender.size()) {
             for (auto& component : componentsToRender) {
                 if (component->isVisible()) {
-                    component->render();
+                    TraceSpan span(component->nameUID.c_str());
+                    RenderProbe& probe = RenderProbe::get();
+                    if (probe.begin) {
+                        probe.begin(component);
+                        component->render();
+                        probe.end(component);
+                    } else {
+                        component->render();
+                    }
                 }
             }
             componentsToRender.clear();
@@ -174,6 +219,7 @@ public:
     void onMotion(MotionInterface& motion)
     {
         if (!isVisible()) return;
+        FrameScheduler::get().interact();
         for (auto& component : components) {
             if (component->isVisible()) {
                 component->handleMotion(motion);
@@ -194,6 +240,7 @@ public:
     void onEncoder(int8_t id, int8_t direction, uint64_t tick)
     {
         if (!isVisible()) return;
+        FrameScheduler::get().interact();
         for (auto& component : components) {
             if (component->isVisible()) {
                 component->onEncoder(id, direction);
@@ -204,7 +251,8 @@ public:
     void onKey(uint16_t id, int key, int8_t state, unsigned long now)
     {
         if (!isVisible()) return;
-        for (auto& component : components) {
+        FrameScheduler::get().interact();
+        for (auto& component : getKeyComponents(id, key)) {
             if (component->isVisible()) {
                 if (component->onKey(id, key, state, now)) { // exit as soon as action happen, do not support multiple action for different component
                     break;
@@ -19,6 +19,7 @@ sha: 7435e292761230dbbb5f836a6303d8d26e9aaa22fa2f72b138beafe7fa2fd014
 */
 #pragma once
 
+#include <functional>
 #include <stdint.h>
 #include <stdio.h>
 #include <string>
@@ -84,7 +85,8 @@ public:
     virtual void clear() { }
     virtual void clear(uint8_t page) { }
     virtual void line(Point start, Point end, DrawOptions options = {}) { }
-    virtual void lines(std::vector<Point> points, DrawOptions options = {}) { }
+    virtual void lines(const Point* points, int count, DrawOptions options = {}) { }
+    void lines(const std::vector<Point>& points, DrawOptions options = {}) { lines(points.data(), points.size(), options); }
     virtual void pixel(Point position, DrawOptions options = {}) { }
     virtual void filledRect(Point position, Size size, DrawOptions options = {}) { }
     virtual void rect(Point position, Size size, DrawOptions options = {}) { }
@@ -93,7 +95,8 @@ public:
     virtual void filledRect(Point position, Size size, uint8_t radius, DrawOptions options = {}) { }
     virtual void rect(Point position, Size size, uint8_t radius, DrawOptions options = {}) { }
     virtual void filledPie(Point position, int radius, int startAngle, int endAngle, DrawOptions options = {}) { }
-    virtual void filledPolygon(std::vector<Point> points, DrawOptions options = {}) { }
+    virtual void filledPolygon(const Point* points, int count, DrawOptions options = {}) { }
+    void filledPolygon(const std::vector<Point>& points, DrawOptions options = {}) { filledPolygon(points.data(), points.size(), options); }
     virtual void arc(Point position, int radius, int startAngle, int endAngle, DrawOptions options = {}) { }
     virtual void circle(Point position, int radius, DrawOptions options = {}) { }
     virtual void filledCircle(Point position, int radius, DrawOptions options = {}) { }
@@ -103,6 +106,19 @@ public:
     virtual void destroyTexture(void* texture) { }
     virtual void applyTexture(void* texture, Rect dest) { }
 
+    // Pixels of a region cached for `owner`, e.g. the static background of a component: `restoreLayer` draws them
+    // back, or only the part `region` of them, and returns true if they were saved for this region and `version`,
+    // else they must be drawn and saved again
+    virtual bool restoreLayer(void* owner, Point position, Size size, uint32_t version = 0, Rect* region = NULL) { return false; }
+    virtual void saveLayer(void* owner, Point position, Size size, uint32_t version = 0) { }
+    // Forget the pixels cached for `owner`, e.g. a component being deleted
+    virtual void releaseLayer(void* owner) { }
+
+    // Pixels drawn by `render(origin, color)` at `position`, rasterized once for `key` and afterwards only blended in
+    // `color`, e.g. an icon drawn on each frame. `render` must draw in the color it is given only, and within `bounds`,
+    // relative to its origin. Without a cache, it is just drawn.
+    virtual void drawMask(uint64_t key, Point position, Rect bounds, Color color, std::function<void(Point, Color)> render) { render(position, color); }
+
     virtual void* getFont(std::string name = NULL, int size = -1) { return NULL; }
     virtual uint8_t getDefaultFontSize(void* font) { return 0; }
     virtual Color getColor(std::string color, Color defaultColor = { 0xFF, 0xFF, 0xFF }) { return defaultColor; }
@@ -43,6 +43,8 @@ public:
 
     // components
     virtual std::vector<ComponentInterface*>& getComponents() = 0;
+    // Components of all the containers, visible or not
+    virtual std::vector<ComponentInterface*> allComponents() = 0;
     virtual Container* addContainer(std::string& name, Point position, std::string height) = 0;
     virtual void addComponent(ComponentInterface* component, Container *container) = 0;
     virtual void renderComponents(unsigned long now) = 0;
@@ -6,7 +6,7 @@ The class acts as a dedicated display view (the `View` part) designed to host an
 
 **Key Functions**
 1.  **Input Routing:** This component is the central hub for user interaction. It receives input events like key presses, screen touches, and signals from physical rotary knobs (encoders). It then securely passes these events down to the elements inside its managed container.
-2.  **Encoder Scaling:** A unique feature is its handling of rotary knobs. It tracks the speed at which a user turns a knob, allowing the system to scale the input. For instance, a quick turn might adjust a volume setting in large steps, while a slow turn allows for fine, precise adjustments.
+2.  **Encoder Input:** It passes the turns of rotary knobs to its components. The view manager has already scaled them by the speed at which the user turns the knob: a quick turn might adjust a volume setting in large steps, while a slow turn allows for fine, precise adjustments.
 3.  **System Safety:** The component utilizes a "lock" mechanism (`mutex`) during critical operations (like handling user input, resizing the display, or updating its layout). This safety measure ensures that simultaneous actions do not conflict or cause data corruption, leading to a stable and reliable interface.
 4.  **Management:** It manages the life cycle of its contained elements, handling initial setup, rendering updates, and resizing adjustments whenever the application window changes.
 
@@ -29,9 +29,6 @@ protected:
     Container container;
     std::mutex m2;
 
-    // there should be about 4 to 12 encoders, however with 256 we are sure to not be out of bounds
-    uint64_t lastEncoderTick[256] = { 0 };
-
 public:
     ViewMonoContainer(DrawInterface& draw, std::function<void(std::string name)> setView, float* contextVar)
         : View(draw, setView, contextVar)
@@ -50,6 +47,7 @@ public:
     }
 
     std::vector<ComponentInterface*>& getComponents() override { return container.components; }
+    std::vector<ComponentInterface*> allComponents() override { return container.components; }
 
     void pushToRenderingQueue(void* component) override
     {
@@ -86,11 +84,8 @@ public:
 
     void onEncoder(int8_t id, int8_t direction, uint64_t tick) override
     {
+        // Already accelerated by the view manager, coalescing the detents of each frame
         m2.lock();
-        if (tick > 0) {
-            direction = encGetScaledDirection(direction, tick, lastEncoderTick[id]);
-        }
-        lastEncoderTick[id] = tick;
         container.onEncoder(id, direction, tick);
         m2.unlock();
     }
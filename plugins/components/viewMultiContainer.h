@@ -24,9 +24,6 @@ protected:
     std::vector<Container> containers;
     std::mutex m2;
 
-    // there should be about 4 to 12 encoders, however with 256 we are sure to not be out of bounds
-    uint64_t lastEncoderTick[256] = { 0 };
-
 public:
     ViewMultiContainer(DrawInterface& draw,
         std::function<void(std::string)> setView,
@@ -61,6 +58,15 @@ public:
         return merged;
     }
 
+    std::vector<ComponentInterface*> allComponents() override
+    {
+        std::vector<ComponentInterface*> all;
+        for (auto& c : containers) {
+            all.insert(all.end(), c.components.begin(), c.components.end());
+        }
+        return all;
+    }
+
     Container* addContainer(std::string& name, Point position, std::string height) override
     {
         containers.push_back(Container(draw, setView, contextVar, name, position, height));
@@ -121,12 +127,8 @@ public:
 
     void onEncoder(int8_t id, int8_t direction, uint64_t tick) override
     {
+        // Already accelerated by the view manager, coalescing the detents of each frame
         m2.lock();
-        if (tick > 0) {
-            direction = encGetScaledDirection(direction, tick, lastEncoderTick[id]);
-        }
-        lastEncoderTick[id] = tick;
-
         for (auto& c : containers) {
             c.onEncoder(id, direction, tick);
         }
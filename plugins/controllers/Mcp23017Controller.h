@@ -9,16 +9,19 @@ The `Mcp23017Controller` acts as a driver, translating physical button presses o
 
 1.  **Initialization:** When the program starts, the controller is configured with the chip's specific location (address). It sets up all 16 pins to operate as inputs and enables necessary hardware features (pull-up resistors) to ensure stable readings from physical buttons.
 2.  **Mapping:** It reads a configuration file to determine which system action (a specific "key" code) corresponds to each physical pin. For instance, pin A0 might be mapped to the "Mute" function.
-3.  **Background Monitoring:** A dedicated, continuous background task (a thread) is started. This thread’s sole purpose is to constantly check the status of the 16 inputs on the external chip.
-4.  **Event Handling:** The monitoring task quickly scans all pins every few milliseconds. If it detects that a pin’s state has changed—meaning a button was pressed or released—it compares the current state to the last known state. If a change is confirmed, the controller sends the corresponding, mapped key action to the main system for processing.
+3.  **Interrupts:** If the chip's INTA or INTB output is wired to a GPIO pin of the host (`interruptGpio`), the chip is set to signal any change of its inputs on it. The inputs are then only read when that pin goes low, all the needed registers in a single transfer, so idle buttons cost no bus traffic and a press is seen right away.
+4.  **Background Monitoring:** Without the interrupt pin, a dedicated, continuous background task (a thread) is started. This thread’s sole purpose is to constantly check the status of the 16 inputs on the external chip.
+5.  **Event Handling:** The monitoring task quickly scans all pins every few milliseconds. If it detects that a pin’s state has changed—meaning a button was pressed or released—it compares the current state to the last known state. If a change is confirmed, the controller sends the corresponding, mapped key action to the main system for processing.
 
 sha: 4f54d98c4a633c771b3be90658d5a79a2aafccf2b0c3ae0e27af66ecf482c4f3 
 */
 #pragma once
 
+#include <mutex>
 #include <thread>
 
 #include "controllerInterface.h"
+#include "helpers/GpioLineEvents.h"
 #include "helpers/Mcp23017.h"
 #include "helpers/controller.h"
 #include "log.h"
@@ -30,6 +33,8 @@ class Mcp23017Controller : public ControllerInterface {
 protected:
     Mcp23017 mcp;
     int address = 0x20; // Default I2C address of MCP23017
+    int interruptGpio = -1;
+    std::mutex scanMtx;
 
     std::thread loopThread;
     bool loopRunning = true;
@@ -74,6 +79,7 @@ public:
     void config(nlohmann::json& config) override
     {
         address = config.value("address", address);
+        interruptGpio = config.value("interruptGpio", interruptGpio);
 
         if (!mcp.init(address)) {
             logError("Failed to init MCP23017");
@@ -109,9 +115,35 @@ public:
         setMapping(config["B6"], B6);
         setMapping(config["B7"], B7);
 
+        if (interruptGpio >= 0 && initInterrupt()) {
+            return;
+        }
         startThread();
     }
 
+    bool initInterrupt()
+    {
+        if (!mcp.enableInterrupts()) {
+            return false;
+        }
+        // Clear the interrupt pending since the chip was powered
+        interruptHandler();
+        std::vector<uint8_t> levels;
+        if (!GpioLineEvents::get().request({ (uint8_t)interruptGpio }, 0, levels, [this](uint8_t gpio, uint8_t level, uint64_t tick) {
+                if (!level) {
+                    interruptHandler();
+                }
+            })) {
+            logWarn("MCP23017 interrupt on GPIO %d not available, polling instead", interruptGpio);
+            return false;
+        }
+        // Changed before the line was requested, no falling edge would come until it is cleared
+        if (!levels[0]) {
+            interruptHandler();
+        }
+        return true;
+    }
+
     void startThread()
     {
         loopThread = std::thread(&Mcp23017Controller::loop, this);
@@ -137,9 +169,26 @@ public:
 
     void handler()
     {
-        uint8_t channelA = mcp.readChannelA();
-        uint8_t channelB = mcp.readChannelB();
+        checkChannels(mcp.readChannelA(), mcp.readChannelB());
+    }
+
+    void interruptHandler()
+    {
+        std::lock_guard<std::mutex> guard(scanMtx);
+        Mcp23017::Interrupt interrupt;
+        if (!mcp.readInterrupt(interrupt)) {
+            return;
+        }
+        // Released before the pins were read, the state captured by the interrupt is sent first
+        if (interrupt.flagA || interrupt.flagB) {
+            checkChannels(interrupt.flagA ? interrupt.captureA : interrupt.channelA,
+                interrupt.flagB ? interrupt.captureB : interrupt.channelB);
+        }
+        checkChannels(interrupt.channelA, interrupt.channelB);
+    }
 
+    void checkChannels(uint8_t channelA, uint8_t channelB)
+    {
         checkState(A0, channelA, 0);
         checkState(A1, channelA, 1);
         checkState(A2, channelA, 2);
@@ -42,7 +42,7 @@ protected:
     GpioEncoder gpioEncoder = GpioEncoder({},
         [this](GpioEncoder::Encoder enc, int8_t direction) {
             // printf("encoder%d gpioA%d gpioB%d direction %d\n", encoder.id, encoder.gpioA, encoder.gpioB, direction);
-            encoder(enc.id, direction, getTicks());
+            encoder(enc.id, direction, enc.tick);
         });
 
     NeoTrellis trellis1;
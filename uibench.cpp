@@ -0,0 +1,306 @@
+// Headless benchmark of the UI, see `make uibench`.
+//
+// The views of a config (e.g. the one generated from config/pixel) are loaded like the app does, the audio being
+// configured but not started, and drawn by a renderer without display (see draw/drawNull.h). Each view is shown, then
+// rendered for a number of frames, each frame changing a few values of its components and moving the playhead of the
+// sequencers from time to time. For each view, one JSON line is written:
+// {"view":"Main","frames":300,"nsPerFrame":182000,"pixelsPerFrame":2140,"bytesFlushedPerFrame":4280,"flushes":300,"allocations":12,"allocatedBytes":640}
+//
+// followed by a line per component rendered at least once:
+// {"view":"Main","component":"Main_KnobValue_x0_y0","renders":75,"nsPerRender":21000,"pixelsPerRender":310}
+//
+// ./uibench [--config config.json] [--frames 300] [--changes 2] [--stepEvery 4] [--frameMs 16] [--bytesPerPixel 2] [--rasterThreads 3] [--output uibench.jsonl] View1 View2 ...
+
+#define ZIC_LOG_LEVEL ZIC_LOG_WARN
+
+#include "config.h"
+#include "draw/drawNull.h"
+#include "helpers/renderProbe.h"
+#include "host.h"
+#include "plugins/controllers/PixelController.h"
+#include "styles.h"
+#include "viewManager.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <new>
+#include <string>
+#include <time.h>
+#include <unordered_map>
+#include <vector>
+
+// Count the allocations made while rendering. Component libraries resolve `operator new` to this one, as the
+// executable is linked with `-rdynamic`. Direct calls to malloc are not counted.
+std::atomic<bool> countAllocations = false;
+std::atomic<uint64_t> allocations = 0;
+std::atomic<uint64_t> allocatedBytes = 0;
+
+void* operator new(size_t size)
+{
+    if (countAllocations) {
+        allocations++;
+        allocatedBytes += size;
+    }
+    void* ptr = malloc(size ? size : 1);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void* operator new[](size_t size)
+{
+    return operator new(size);
+}
+
+void operator delete(void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr) noexcept
+{
+    free(ptr);
+}
+
+void operator delete(void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+void operator delete[](void* ptr, size_t) noexcept
+{
+    free(ptr);
+}
+
+uint64_t nowNs()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC_RAW, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + ts.tv_nsec;
+}
+
+DrawNull drawNull(styles);
+
+struct ComponentStats {
+    uint32_t renders = 0;
+    uint64_t ns = 0;
+    uint64_t pixels = 0;
+};
+std::unordered_map<ComponentInterface*, ComponentStats> componentStats;
+uint64_t renderStart = 0;
+uint64_t renderPixels = 0;
+
+void beginRender(ComponentInterface* component)
+{
+    renderPixels = drawNull.pixelsChanged;
+    renderStart = nowNs();
+}
+
+void endRender(ComponentInterface* component)
+{
+    uint64_t ns = nowNs() - renderStart;
+    ComponentStats& stats = componentStats[component];
+    stats.renders++;
+    stats.ns += ns;
+    stats.pixels += drawNull.pixelsChanged - renderPixels;
+}
+
+// Playhead of a sequencer, moved by hand as the audio loop is not running
+struct Playhead {
+    uint16_t* stepCounter;
+    uint16_t* stepCount;
+    bool* isPlaying;
+    AudioPlugin* plugin;
+};
+
+std::vector<Playhead> findPlayheads()
+{
+    std::vector<Playhead> playheads;
+    const std::vector<AudioPlugin*>* plugins = getAudioPluginHandler() ? getAudioPluginHandler()->getPlugins() : NULL;
+    if (!plugins) {
+        return playheads;
+    }
+    for (AudioPlugin* plugin : *plugins) {
+        // An unknown name is read as the id 0, so only the plugins knowing both names are sequencers
+        uint8_t counterId = plugin->getDataId("STEP_COUNTER");
+        uint8_t countId = plugin->getDataId("STEP_COUNT");
+        uint8_t playingId = plugin->getDataId("IS_PLAYING");
+        if (!counterId || !countId || !playingId || counterId == countId) {
+            continue;
+        }
+        Playhead playhead = { (uint16_t*)plugin->data(counterId), (uint16_t*)plugin->data(countId), (bool*)plugin->data(playingId), plugin };
+        if (playhead.stepCounter && playhead.stepCount && playhead.isPlaying) {
+            playheads.push_back(playhead);
+        }
+    }
+    return playheads;
+}
+
+int main(int argc, char* argv[])
+{
+    std::string configFile = "config.json";
+    uint32_t frames = 300;
+    uint32_t changes = 2;
+    uint32_t stepEvery = 4;
+    uint32_t frameMs = 16;
+    int rasterThreads = -1;
+    std::string outputFile;
+    std::vector<std::string> viewNames;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        bool hasValue = i + 1 < argc;
+        if (arg == "--config" && hasValue) {
+            configFile = argv[++i];
+        } else if (arg == "--frames" && hasValue) {
+            frames = atoi(argv[++i]);
+        } else if (arg == "--changes" && hasValue) {
+            changes = atoi(argv[++i]);
+        } else if (arg == "--stepEvery" && hasValue) {
+            stepEvery = atoi(argv[++i]);
+        } else if (arg == "--frameMs" && hasValue) {
+            frameMs = atoi(argv[++i]);
+        } else if (arg == "--bytesPerPixel" && hasValue) {
+            drawNull.bytesPerPixel = atoi(argv[++i]);
+        } else if (arg == "--rasterThreads" && hasValue) {
+            rasterThreads = atoi(argv[++i]);
+        } else if (arg == "--output" && hasValue) {
+            outputFile = argv[++i];
+        } else {
+            viewNames.push_back(arg);
+        }
+    }
+
+    std::ofstream outputStream;
+    if (!outputFile.empty()) {
+        outputStream.open(outputFile, std::ios::out | std::ios::trunc);
+    }
+    std::ostream& output = outputFile.empty() ? std::cout : outputStream;
+
+    nlohmann::json config;
+    try {
+        config = ConfigCache::load(configFile);
+    } catch (const std::exception& e) {
+        std::cerr << "Cannot load config " << configFile << ": " << e.what() << std::endl;
+        return 1;
+    }
+    // Drawn in memory, and nothing listening for the outside
+    config.erase("renderer");
+    config["controlSocket"] = "";
+    config.erase("osc");
+    config.erase("remoteUi");
+    config.erase("valueStream");
+    config.erase("trace");
+
+    loadHostPlugin();
+    lastPluginControllerInstance = new PixelController(controllerProps, 0);
+    controllers.push_back({ "Default", lastPluginControllerInstance });
+    if (config.contains("audio")) {
+        hostConfig(config["audio"]);
+    }
+    lastPluginControllerInstance->config(config);
+
+    ViewManager& viewManager = ViewManager::get();
+    // Before the views are loaded, as they keep the renderer they were created with
+    viewManager.draw = &drawNull;
+    viewManager.config(config);
+    // Over the one of the config. With a display list, the pixels are only counted per frame, not per component.
+    if (rasterThreads >= 0) {
+        drawNull.setRasterThreads(rasterThreads);
+    }
+    if (viewManager.getViewNames().empty()) {
+        std::cerr << "No view in " << configFile << std::endl;
+        return 1;
+    }
+    viewManager.init();
+
+    RenderProbe::get().begin = beginRender;
+    RenderProbe::get().end = endRender;
+
+    std::vector<Playhead> playheads = findPlayheads();
+    for (Playhead& playhead : playheads) {
+        *playhead.isPlaying = true;
+    }
+
+    uint32_t seed = 1234;
+    unsigned long now = 0;
+    for (std::string& name : viewManager.getViewNames()) {
+        if (!viewNames.empty() && std::find(viewNames.begin(), viewNames.end(), name) == viewNames.end()) {
+            continue;
+        }
+        // Created on the first use, the ones shown before may be released meanwhile
+        viewManager.setView(name, true);
+        View* view = viewManager.view;
+
+        std::vector<ValueInterface*> values;
+        for (ComponentInterface* component : view->getComponents()) {
+            for (ValueInterface* value : component->values) {
+                values.push_back(value);
+            }
+        }
+
+        // Only the frames following the first rendering of the view are measured
+        componentStats.clear();
+        uint64_t pixelsStart = drawNull.pixelsChanged;
+        uint64_t bytesStart = drawNull.bytesFlushed;
+        uint32_t flushesStart = drawNull.flushes;
+        allocations = 0;
+        allocatedBytes = 0;
+        uint64_t totalNs = 0;
+        for (uint32_t frame = 0; frame < frames; frame++) {
+            now += frameMs;
+            for (uint32_t c = 0; c < changes && !values.empty(); c++) {
+                seed = seed * 1664525 + 1013904223;
+                ValueInterface* value = values[(seed >> 8) % values.size()];
+                seed = seed * 1664525 + 1013904223;
+                value->setPct((seed >> 8) / 16777216.0f);
+            }
+            if (stepEvery && frame % stepEvery == 0) {
+                for (Playhead& playhead : playheads) {
+                    *playhead.stepCounter = *playhead.stepCount ? (*playhead.stepCounter + 1) % *playhead.stepCount : 0;
+                    // Published by the sequencer at the end of its block
+                    PluginEvents::get().publish(playhead.plugin, PluginEvents::STEP, *playhead.stepCounter);
+                }
+            }
+            countAllocations = true;
+            uint64_t start = nowNs();
+            viewManager.renderComponents(now);
+            totalNs += nowNs() - start;
+            countAllocations = false;
+        }
+
+        nlohmann::json line = {
+            { "view", view->name },
+            { "frames", frames },
+            { "nsPerFrame", frames ? totalNs / frames : 0 },
+            { "pixelsPerFrame", frames ? (drawNull.pixelsChanged - pixelsStart) / frames : 0 },
+            { "bytesFlushedPerFrame", frames ? (drawNull.bytesFlushed - bytesStart) / frames : 0 },
+            { "flushes", drawNull.flushes - flushesStart },
+            { "allocations", allocations.load() },
+            { "allocatedBytes", allocatedBytes.load() },
+        };
+        output << line.dump() << std::endl;
+        for (ComponentInterface* component : view->getComponents()) {
+            auto it = componentStats.find(component);
+            if (it == componentStats.end()) {
+                continue;
+            }
+            ComponentStats& stats = it->second;
+            nlohmann::json componentLine = {
+                { "view", view->name },
+                { "component", component->nameUID },
+                { "renders", stats.renders },
+                { "nsPerRender", stats.ns / stats.renders },
+                { "pixelsPerRender", stats.pixels / stats.renders },
+            };
+            output << componentLine.dump() << std::endl;
+        }
+    }
+
+    RenderProbe::get().begin = NULL;
+    RenderProbe::get().end = NULL;
+    return 0;
+}
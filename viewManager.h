@@ -8,8 +8,10 @@ The `ViewManager` manages multiple "Views," which are essentially different scre
 1.  **Centralized Control:** It operates as a globally accessible entity (a Singleton pattern), ensuring that all parts of the application refer to the same instance for managing the display.
 2.  **Dynamic Modularity (Plugins):** A key feature is the ability to load Components dynamically. It uses a plugin architecture to load component code from external files. This means new display elements can be added or updated without needing to recompile the main system.
 3.  **Rendering Abstraction:** The Manager supports multiple drawing backends (like Framebuffer, specialized display drivers like ST7789, or desktop libraries like SDL/SFML). It selects the correct rendering method during initialization to draw the active View and its Components.
-4.  **Navigation and State:** It controls which View is currently active via the `setView` function, handling navigation and even temporary tagging of Views for easy recall. It also maintains a set of "context variables" to pass real-time data (like sensor readings or settings) to the active Components.
-5.  **Configuration:** It reads detailed configurations (usually from a JSON structure) to set up screen parameters, select the appropriate renderer, and define the layout and properties of all Views and their Components upon startup.
+4.  **Navigation and State:** It controls which View is currently active via the `setView` function, handling navigation and even temporary tagging of Views for easy recall. It also maintains a set of "context variables" to pass real-time data (like sensor readings or settings) to the active Components. Input from the controllers and context changes are queued and handed to the active View by the UI thread before each frame, a View only being told about the context slots that changed since it was last shown. External scripts and tools drive it through a control socket: showing a view or a message, setting or reading a value, and sending audio events.
+5.  **Input:** Encoder turns and key presses from every controller thread are queued with their timestamp and handled by the UI thread once per frame, the detents of an encoder turned fast being merged into a single accelerated change, following a configurable curve. Tablets and computers on the network can drive it as well, through OSC over UDP (see `OscServer`), setting values and receiving the ones they subscribed to. A web browser can show the screen and send keys and wheel turns back (see `FrameStreamServer`), the tiles changed by each frame being streamed to it over a WebSocket. Dashboards read all the plugin values and follow their changes over HTTP (see `ValueStreamServer`).
+6.  **Background Tasks:** Scans, HTTP requests and other slow jobs of the Components run on a small pool of workers (see `TaskExecutor`), instead of a thread each, their results being handed back to the Components by the UI thread with the input.
+7.  **Configuration:** It reads detailed configurations (usually from a JSON structure) to set up screen parameters, select the appropriate renderer, and define the layout and properties of all Views and their Components upon startup. A View and its Components are only created the first time it is shown, and the least recently used Views are released again when too many of them are loaded, or they use too much memory.
 
 In essence, the `ViewManager` is responsible for loading the layout, handling screen transitions, feeding data to the visual elements, and executing the actual drawing process on the device screen.
 
@@ -19,18 +21,33 @@ sha: 937ad9bc528b510f4d7a6a6c092adea8eb8d998ba79bf1f3f8142d0f35d3277f
 #pragma once
 
 #include "libs/nlohmann/json.hpp"
+#include <atomic>
+#include <condition_variable>
 #include <dlfcn.h>
+#include <malloc.h>
+#include <memory>
 #include <mutex>
+#include <unordered_map>
 #include <vector>
 
-#include <cstdio> // for std::remove
-#include <fstream> // for std::ifstream
+#include <sstream>
 #include <string>
-#include <unistd.h> // for access()
 
 #include "controllerList.h"
+#include "helpers/MpscQueue.h"
+#include "helpers/controlSocket.h"
+#include "helpers/enc.h"
+#include "helpers/frameScheduler.h"
+#include "helpers/frameStreamServer.h"
 #include "helpers/getExecutableDirectory.h"
 #include "helpers/getTicks.h"
+#include "helpers/oscServer.h"
+#include "helpers/pluginEvents.h"
+#include "helpers/taskExecutor.h"
+#include "helpers/valueChanges.h"
+#include "helpers/staticLibs.h"
+#include "helpers/trace.h"
+#include "helpers/valueStreamServer.h"
 #include "host.h"
 #include "log.h"
 #include "plugins/components/componentInterface.h"
@@ -63,9 +80,26 @@ protected:
         ComponentInterface* component;
     };
 
-    View* previousView = NULL;
+    // Name of the view shown before the current one, see `&previous`
+    std::string previousView;
 
-    std::vector<View*> views;
+    // Views of the config, each created on the first setView() showing it, and released once least recently used
+    // when more than `maxLoadedViews` are loaded or they use more than `maxLoadedBytes`. Only touched by the UI thread.
+    struct ViewEntry {
+        std::string name;
+        nlohmann::json config;
+        View* view = NULL;
+        // Loaded with the config and never released, e.g. a view whose components set contexts used by the others
+        bool keepLoaded = false;
+        uint64_t lastUsed = 0;
+        // Heap allocated while creating the view, 0 when it cannot be measured
+        size_t bytes = 0;
+    };
+    std::vector<ViewEntry> viewEntries;
+    uint64_t viewUses = 0;
+    uint16_t maxLoadedViews = 8;
+    size_t maxLoadedBytes = 0;
+    bool releasePending = false;
 
     std::unordered_map<std::string, std::string> taggedViews;
 
@@ -76,8 +110,8 @@ public:
     {
         logTrace("set view string to %s", value.c_str());
         // logDebug("set view string to %s", value.c_str());
-        if (value == "&previous" && previousView != NULL) {
-            value = previousView->name;
+        if (value == "&previous" && !previousView.empty()) {
+            value = previousView;
         }
         // use # to save a view to a variable a re-use later
         // e.g.: setView("viewName#viewNameVar");
@@ -102,36 +136,353 @@ public:
                 }
             }
         }
-        for (int i = 0; i < views.size(); i++) {
-            if (views[i]->name == value) {
-                if (view != views[i] || force) {
-                    unsigned long t0 = getTicks();
-                    if (view->saveForPrevious && previousView != view) {
-                        previousView = view;
-                    }
-                    view = views[i];
-                    unsigned long t1 = getTicks();
-                    for (int i = 0; i < 256; i++) {
-                        view->onContext(i, contextVar[i]);
-                    }
-                    unsigned long t2 = getTicks();
-                    render();
-                    unsigned long t3 = getTicks();
-                    printf("[TIMING] setView(%s): setup=%lums context256=%lums render=%lums total=%lums\n",
-                           value.c_str(), t1-t0, t2-t1, t3-t2, t3-t0);
-                    fflush(stdout);
+        ViewEntry* entry = findView(value);
+        if (entry == NULL) {
+            logWarn("Unknown view: %s", value.c_str());
+            return;
+        }
+        unsigned long t0 = getTicks();
+        View* newView = loadView(*entry);
+        entry->lastUsed = ++viewUses;
+        if (newView && (view != newView || force)) {
+            unsigned long t1 = getTicks();
+            if (view && view->saveForPrevious && previousView != view->name) {
+                previousView = view->name;
+            }
+            view = newView;
+            if (force) {
+                viewContexts.erase(view);
+            }
+            syncContext();
+            unsigned long t2 = getTicks();
+            render();
+            logTrace("setView(%s): load=%lums context=%lums render=%lums", value.c_str(), t1 - t0, t2 - t1, getTicks() - t2);
+        }
+    }
+
+protected:
+    // Guards the config of the pending views reload, the views themselves are only touched by the UI thread
+    std::mutex reloadMtx;
+
+    ViewEntry* findView(const std::string& name)
+    {
+        for (ViewEntry& entry : viewEntries) {
+            if (entry.name == name) {
+                return &entry;
+            }
+        }
+        return NULL;
+    }
+
+    static size_t heapBytes()
+    {
+#if defined(__GLIBC__) && (__GLIBC__ > 2 || __GLIBC_MINOR__ >= 33)
+        return mallinfo2().uordblks;
+#else
+        return 0;
+#endif
+    }
+
+    // Create the view, its containers and its components, opening the libraries of the components not loaded yet
+    View* loadView(ViewEntry& entry)
+    {
+        if (entry.view) {
+            return entry.view;
+        }
+        unsigned long t0 = getTicks();
+        size_t heap = heapBytes();
+        nlohmann::json& v = entry.config;
+        View* newView = nullptr;
+        if (v.contains("components") && v["components"].is_array())
+            newView = new ViewMonoContainer(*draw, [&](std::string name) { setView(name); }, contextVar);
+        else
+            newView = new ViewMultiContainer(*draw, [&](std::string name) { setView(name); }, contextVar);
+
+        newView->name = entry.name;
+        if (v.contains("noPrevious")) {
+            logDebug("view %s noPrevious", newView->name.c_str());
+            newView->saveForPrevious = !v["noPrevious"];
+        }
+        if (v.contains("components") && v["components"].is_array())
+            componentConfig(v, newView, NULL);
+        else if (v.contains("containers") && v["containers"].is_array()) {
+            for (auto& c : v["containers"]) {
+                if (c.contains("components") && c["components"].is_array()
+                    && c.contains("name") && c.contains("position") && c["position"].is_array() && c["position"].size() == 2) {
+                    std::string name = c["name"].get<std::string>();
+                    Point position = { c["position"][0].get<int>(), c["position"][1].get<int>() };
+                    std::string height = c.value("height", "100%");
+                    Container* container = newView->addContainer(name, position, height);
+                    container->config(c);
+                    componentConfig(c, newView, container);
                 }
+            }
+        }
+        newView->init();
+        entry.view = newView;
+        size_t heapAfter = heapBytes();
+        entry.bytes = heapAfter > heap ? heapAfter - heap : 0;
+        logDebug("Loaded view %s in %lums (%zu bytes)", entry.name.c_str(), getTicks() - t0, entry.bytes);
+        releasePending = true;
+        return newView;
+    }
+
+    // Delete the least recently used views until the loaded ones are within the bounds. Before a frame, so no
+    // component of these views is running, the current one never being released.
+    void releaseViews()
+    {
+        releasePending = false;
+        while (true) {
+            uint16_t loaded = 0;
+            size_t bytes = 0;
+            ViewEntry* oldest = NULL;
+            for (ViewEntry& entry : viewEntries) {
+                if (!entry.view) {
+                    continue;
+                }
+                loaded++;
+                bytes += entry.bytes;
+                if (!entry.keepLoaded && entry.view != view && canRelease(entry.view)
+                    && (!oldest || entry.lastUsed < oldest->lastUsed)) {
+                    oldest = &entry;
+                }
+            }
+            if (!oldest || (loaded <= maxLoadedViews && (!maxLoadedBytes || bytes <= maxLoadedBytes))) {
                 return;
             }
+            releaseView(*oldest);
         }
-        logWarn("Unknown view: %s", value.c_str());
     }
 
-protected:
-    std::mutex m;
+    bool canRelease(View* v)
+    {
+        for (ComponentInterface* component : v->allComponents()) {
+            if (!component->canRelease()) {
+                return false;
+            }
+        }
+        return true;
+    }
 
-    // there should be about 4 to 12 encoders, however with 256 we are sure to not be out of bounds
-    unsigned long lastEncoderTick[256] = { 0 };
+    void releaseView(ViewEntry& entry)
+    {
+        logDebug("Release view %s (%zu bytes)", entry.name.c_str(), entry.bytes);
+        // Not subscribed to the value changes, they are cleared when another view is shown
+        for (ComponentInterface* component : entry.view->allComponents()) {
+            draw->releaseLayer(component);
+            delete component;
+        }
+        viewContexts.erase(entry.view);
+        delete entry.view;
+        entry.view = NULL;
+        entry.bytes = 0;
+    }
+
+    // Input from the controller threads, handled by the UI thread before the next rendering. A controller never waits
+    // for a rendering to finish.
+    struct UiEvent {
+        enum Type : uint8_t {
+            ENCODER,
+            KEY,
+            // Encoder at a position of the screen, `key` being `x << 16 | y`, e.g. the mouse wheel of the remote UI
+            WHEEL,
+        } type;
+        // Direction of the encoder, or state of the key
+        int8_t value;
+        uint16_t id;
+        int key;
+        uint64_t tick;
+    };
+    MpscQueue<UiEvent, 256> uiEvents;
+
+    // Background tasks of the components, their completions handled with the UI events
+    TaskExecutor executor;
+
+    // Detents of an encoder turning the same way, since the last event dispatched, applied as a single increment
+    // accelerated by `encoderCurve` from the time between the detents
+    EncoderCurve encoderCurve;
+    uint64_t lastEncoderTick[256] = {};
+    struct PendingEncoder {
+        int16_t id = -1;
+        float steps = 0.0f;
+    } pendingEncoder;
+
+    void queueEncoder(UiEvent& e)
+    {
+        float steps = e.value;
+        // Without time, e.g. already scaled by the mouse wheel of the desktop renderer
+        if (e.tick) {
+            steps *= encoderCurve.factor(e.tick - lastEncoderTick[e.id & 0xFF]);
+            lastEncoderTick[e.id & 0xFF] = e.tick;
+        }
+        if (pendingEncoder.id != e.id || (pendingEncoder.steps > 0) != (steps > 0)) {
+            dispatchEncoder();
+            pendingEncoder.id = e.id;
+        }
+        pendingEncoder.steps += steps;
+    }
+
+    void dispatchEncoder()
+    {
+        if (pendingEncoder.id < 0) {
+            return;
+        }
+        int steps = CLAMP((int)round(pendingEncoder.steps), -127, 127);
+        if (steps) {
+            // Already accelerated, the views do not scale it again
+            view->onEncoder(pendingEncoder.id, steps, 0);
+        }
+        pendingEncoder = {};
+    }
+
+    // Context slots set since the last rendering, their value being in `contextVar`
+    std::atomic<uint64_t> contextChanged[4] = {};
+
+    // Context values each view was last given, so switching view only calls `onContext` for the slots that changed
+    struct ViewContext {
+        float values[256];
+    };
+    std::unordered_map<View*, ViewContext> viewContexts;
+
+    // Commands of the control socket, checked by the control thread and applied by the UI thread before the next
+    // rendering, e.g. a view to show or a value to set. The plugins being loaded by the UI thread, the commands
+    // reading or setting a value are also answered by it, the control thread waiting for the answer.
+    ControlSocket controlSocket;
+    struct Answer {
+        std::string text;
+        bool done = false;
+    };
+    struct PendingCommand {
+        std::string command;
+        // NULL when the client is answered right away
+        std::shared_ptr<Answer> answer;
+    };
+    std::mutex commandMtx;
+    std::condition_variable answerCv;
+    std::vector<PendingCommand> pendingCommands;
+
+    // Network control surface, setting the values from its own thread, see helpers/oscServer.h
+    OscServer oscServer;
+    // Screen streamed to web browsers, see helpers/frameStreamServer.h
+    FrameStreamServer frameStream;
+    // Plugin values served over HTTP for dashboards, see helpers/valueStreamServer.h
+    ValueStreamServer valueStream;
+    // Shown over the components on the next rendering
+    std::string message;
+    bool handlingEvents = false;
+
+    // Value of `<plugin> <track> <key>` read from the command, or NULL with the error to answer
+    ValueInterface* commandValue(std::istringstream& stream, std::string& error)
+    {
+        std::string pluginName, key;
+        int track;
+        if (!(stream >> pluginName >> track >> key)) {
+            error = "error expected <plugin> <track> <key>";
+            return NULL;
+        }
+        try {
+            ValueInterface* val = getPlugin(pluginName, track).getValue(key);
+            if (!val) {
+                error = "error unknown value " + key;
+            }
+            return val;
+        } catch (const std::exception& e) {
+            error = std::string("error ") + e.what();
+        }
+        return NULL;
+    }
+
+    // Control thread, answering the client: the commands are queued for the UI thread, waiting for the answer of
+    // the ones on a value
+    std::string control(const std::string& command)
+    {
+        std::istringstream stream(command);
+        std::string action;
+        stream >> action;
+        if (action == "get" || action == "set") {
+            std::shared_ptr<Answer> answer = std::make_shared<Answer>();
+            std::unique_lock<std::mutex> lock(commandMtx);
+            pendingCommands.push_back({ command, answer });
+            FrameScheduler::get().wake();
+            if (!answerCv.wait_for(lock, std::chrono::seconds(2), [&] { return answer->done; })) {
+                return "error timeout";
+            }
+            return answer->text;
+        }
+        if (action == "event") {
+            std::string name;
+            if (!(stream >> name) || getEventTypeFromName(name) == AudioEventType::UNKNOWN) {
+                return "error unknown event " + name;
+            }
+        } else if (action == "trace") {
+            // Written right away, from the control thread
+            if (!Trace::on()) {
+                return "error tracing disabled, see the trace config";
+            }
+            std::string path;
+            stream >> path;
+            int count = Trace::get().dump(path);
+            return count < 0 ? "error could not write the trace" : "ok " + std::to_string(count);
+        } else if (action != "setView" && action != "message") {
+            return "error unknown command " + action;
+        }
+        {
+            std::lock_guard<std::mutex> guard(commandMtx);
+            pendingCommands.push_back({ command });
+        }
+        FrameScheduler::get().wake();
+        return "ok";
+    }
+
+    // Lines of the control file, scripts writing `setView:<name>` or a message to show, as well as the commands
+    std::string controlFile(const std::string& line)
+    {
+        if (line.rfind("setView:", 0) == 0) {
+            return control("setView " + line.substr(8));
+        }
+        std::string action = line.substr(0, line.find(' '));
+        if (action == "get" || action == "set" || action == "event" || action == "setView" || action == "message"
+            || action == "trace") {
+            return control(line);
+        }
+        return control("message " + line);
+    }
+
+    // UI thread, returning the answer to the client
+    std::string runCommand(const std::string& command)
+    {
+        std::istringstream stream(command);
+        std::string action;
+        stream >> action;
+        std::string error;
+        if (action == "get") {
+            ValueInterface* val = commandValue(stream, error);
+            return val ? std::to_string(val->get()) : error;
+        }
+        if (action == "set") {
+            ValueInterface* val = commandValue(stream, error);
+            if (!val) {
+                return error;
+            }
+            float value;
+            if (!(stream >> value)) {
+                return "error expected set <plugin> <track> <key> <value>";
+            }
+            val->set(value);
+        } else if (action == "setView") {
+            std::string name;
+            stream >> name;
+            setView(name);
+        } else if (action == "message") {
+            std::getline(stream >> std::ws, message);
+        } else if (action == "event") {
+            std::string name;
+            int track = -1;
+            stream >> name >> track;
+            sendAudioEvent(getEventTypeFromName(name), track);
+        }
+        return "ok";
+    }
 
     static ViewManager* instance;
 
@@ -154,11 +505,102 @@ protected:
     void setContext(uint8_t index, float value)
     {
         contextVar[index] = value;
-        if (view != NULL) {
+        contextChanged[index >> 6].fetch_or((uint64_t)1 << (index & 63));
+        FrameScheduler::get().wake();
+    }
+
+    // Call `onContext` on the current view for the slots it was not given yet
+    void syncContext()
+    {
+        auto it = viewContexts.find(view);
+        bool synced = it != viewContexts.end();
+        ViewContext& context = viewContexts[view];
+        for (int i = 0; i < 256; i++) {
+            if (!synced || context.values[i] != contextVar[i]) {
+                context.values[i] = contextVar[i];
+                view->onContext(i, contextVar[i]);
+            }
+        }
+    }
+
+    void applyContext(uint8_t index)
+    {
+        ViewContext& context = viewContexts[view];
+        float value = contextVar[index];
+        if (context.values[index] != value) {
+            context.values[index] = value;
             view->onContext(index, value);
         }
     }
 
+    // UI thread, the events and context changes queued meanwhile are handled in the same pass
+    void handleEvents()
+    {
+        // A handler switching view renders it, without handling the next events from there
+        if (handlingEvents) {
+            return;
+        }
+        handlingEvents = true;
+        // Handlers queuing more events, e.g. a key setting a context, are bounded so the rendering still happens
+        for (int pass = 0; pass < 8; pass++) {
+            bool handled = false;
+            std::vector<PendingCommand> commands;
+            {
+                std::lock_guard<std::mutex> guard(commandMtx);
+                commands.swap(pendingCommands);
+            }
+            for (PendingCommand& pending : commands) {
+                std::string answer = runCommand(pending.command);
+                if (pending.answer) {
+                    std::lock_guard<std::mutex> guard(commandMtx);
+                    pending.answer->text = answer;
+                    pending.answer->done = true;
+                    answerCv.notify_all();
+                }
+                handled = true;
+            }
+            for (UiEvent* event = uiEvents.front(); event != NULL; event = uiEvents.front()) {
+                UiEvent e = *event;
+                uiEvents.pop();
+                if (e.type == UiEvent::WHEEL) {
+                    int8_t id = view->getEncoderId(e.key >> 16, e.key & 0xFFFF);
+                    if (id >= 0) {
+                        e.id = id;
+                        queueEncoder(e);
+                    }
+                } else if (e.type == UiEvent::ENCODER) {
+                    queueEncoder(e);
+                } else {
+                    // Keep the order of the events, e.g. a shift key held while turning
+                    dispatchEncoder();
+                    view->onKey(e.id, e.key, e.value);
+                }
+                handled = true;
+            }
+            dispatchEncoder();
+            if (executor.runCompletions()) {
+                handled = true;
+            }
+            if (ValueChanges::get().dispatch()) {
+                handled = true;
+            }
+            if (PluginEvents::get().dispatch()) {
+                handled = true;
+            }
+            for (int word = 0; word < 4; word++) {
+                uint64_t bits = contextChanged[word].exchange(0);
+                for (; bits; bits &= bits - 1) {
+                    applyContext(word * 64 + __builtin_ctzll(bits));
+                    handled = true;
+                }
+            }
+            if (!handled) {
+                break;
+            }
+        }
+        handlingEvents = false;
+    }
+
     Plugin& loadPlugin(std::string name, nlohmann::json& config)
     {
         for (auto& plugin : plugins) {
@@ -169,6 +611,15 @@ protected:
 
         Plugin plugin;
         plugin.name = name;
+        // Linked in the binary by the static build, else opened from its library
+        void* allocator = config.contains("pluginPath") ? NULL : StaticLibs::get().find("component", name + "Component");
+        if (allocator) {
+            plugin.allocator = [allocator](ComponentInterface::Props props) {
+                return ((ComponentInterface * (*)(ComponentInterface::Props props)) allocator)(props);
+            };
+            plugins.push_back(plugin);
+            return plugins.back();
+        }
         std::string path = getExecutableDirectory() + "/libs/components/libzic_" + name + "Component.so";
         if (config.contains("pluginPath")) {
             path = config["pluginPath"].get<std::string>();
@@ -180,15 +631,16 @@ protected:
         }
 
         dlerror();
-        plugin.allocator = [handle](ComponentInterface::Props props) {
-            void* allocator = dlsym(handle, "allocator");
-            return ((ComponentInterface * (*)(ComponentInterface::Props props)) allocator)(props);
-        };
+        // Resolve the allocator once, instead of for every component instance
+        allocator = dlsym(handle, "allocator");
         const char* dlsym_error = dlerror();
         if (dlsym_error) {
             dlclose(handle);
             throw std::runtime_error("Cannot load symbol: " + std::string(dlsym_error));
         }
+        plugin.allocator = [allocator](ComponentInterface::Props props) {
+            return ((ComponentInterface * (*)(ComponentInterface::Props props)) allocator)(props);
+        };
         plugins.push_back(plugin);
         return plugins.back();
     }
@@ -214,7 +666,9 @@ protected:
                 sendAudioEvent,
                 getController,
                 targetView,
-                [this](uint8_t index, float value) { setContext(index, value); }
+                [this](uint8_t index, float value) { setContext(index, value); },
+                getAudioPluginHandler,
+                &executor,
             };
             Plugin& plugin = loadPlugin(name, config);
             ComponentInterface* component = plugin.allocator(props);
@@ -245,6 +699,40 @@ public:
         return *instance;
     }
 
+    // From any thread, e.g. a GPIO encoder
+    void pushEncoder(int8_t id, int8_t direction, uint64_t tick)
+    {
+        uiEvents.push({ UiEvent::ENCODER, direction, (uint16_t)id, 0, tick });
+        FrameScheduler::get().interact();
+    }
+
+    // From any thread, e.g. a GPIO key or a MIDI controller
+    void pushKey(uint16_t id, int key, int8_t state)
+    {
+        if (!uiEvents.push({ UiEvent::KEY, state, id, key, 0 })) {
+            logWarn("UI event queue full, key %d dropped", key);
+        }
+        FrameScheduler::get().interact();
+    }
+
+    // From any thread, the encoder under position `x`, `y` of the screen
+    void pushWheel(int x, int y, int8_t direction)
+    {
+        if (x >= 0 && y >= 0 && x < 0x10000 && y < 0x10000) {
+            uiEvents.push({ UiEvent::WHEEL, direction, 0, x << 16 | y, getTicks() });
+            FrameScheduler::get().interact();
+        }
+    }
+
+    std::vector<std::string> getViewNames()
+    {
+        std::vector<std::string> names;
+        for (ViewEntry& entry : viewEntries) {
+            names.push_back(entry.name);
+        }
+        return names;
+    }
+
     void init()
     {
         if (draw == NULL) {
@@ -252,85 +740,60 @@ public:
         }
         draw->init();
 
-        view = views[0];
-        setView(view->name, true);
-
-        for (auto& v : views) {
-            v->init();
+        if (viewEntries.size()) {
+            setView(viewEntries[0].name, true);
         }
     }
 
     bool render()
     {
-        unsigned long r0 = getTicks();
-        m.lock();
-        if (!views.size()) {
+        if (!view) {
             return false;
         }
-        unsigned long r1 = getTicks();
+        unsigned long t0 = getTicks();
         draw->clear(); // <---- was slow, is it still slow with the new fix?
-        unsigned long r2 = getTicks();
-        if (previousView != NULL) {
-            for (auto& component : previousView->getComponents()) {
-                for (auto* value : component->values) {
-                    value->setOnUpdateCallback([](float, void* data) { }, NULL);
-                }
-            }
-        }
-        unsigned long r3 = getTicks();
+        // Only the components of the active view are told about the changes of their values
+        ValueChanges::get().clear();
+        PluginEvents::get().clear();
         view->activate();
-        unsigned long r4 = getTicks();
-        m.unlock();
+        unsigned long t1 = getTicks();
 
         renderComponents();
-        unsigned long r5 = getTicks();
-        drawMessage();
-        unsigned long r6 = getTicks();
-        printf("[TIMING] render(): lock=%lums clear=%lums prevCallbacks=%lums activate=%lums renderComp=%lums drawMsg=%lums\n",
-               r1-r0, r2-r1, r3-r2, r4-r3, r5-r4, r6-r5);
-        fflush(stdout);
+        logTrace("render(): activate=%lums components=%lums", t1 - t0, getTicks() - t1);
         return true;
     }
 
-    void drawMessage()
+    void drawMessage(const std::string& text)
     {
-        if (access("message.txt", F_OK) != 0) {
-            return;
-        }
-
-        std::ifstream infile("message.txt");
-        std::string text;
-        if (infile) {
-            std::getline(infile, text); // reads a single line, no '\n'
-        }
-        infile.close();
-        if (std::remove("message.txt") != 0) {
-            perror("Failed to delete message.txt");
-        }
-
-        if (text.empty()) {
-            return;
-        }
-
-        if (text.rfind("setView:") == 0) {
-            std::string viewName = text.substr(8);
-            setView(viewName);
-            return;
-        }
-
         Color color = styles.colors.white;
         color.a = 220;
         void* font = draw->getFont("PoppinsLight_8");
         draw->filledRect({ 0, 0 }, { (int)(styles.screen.w * 0.5), 10 }, { .color = color });
         draw->text({ 4, 1 }, text, 8, { .color = { 0, 0, 0 }, .font = font });
-        draw->render();
+        // Through triggerRendering(), so the display list, if any, is rasterized before
+        draw->renderNext();
+        draw->triggerRendering();
     }
 
     void renderComponents(unsigned long now = getTicks())
     {
-        m.lock();
+        TraceSpan span("frame");
+        if (viewsReloadPending.exchange(false)) {
+            applyViewsReload();
+        }
+        if (releasePending) {
+            releaseViews();
+        }
+        if (!view) {
+            return;
+        }
+        handleEvents();
         view->renderComponents(now);
-        m.unlock();
+        if (!message.empty()) {
+            drawMessage(message);
+            message.clear();
+        }
+        frameStream.capture(*draw);
     }
 
     void config(nlohmann::json& config)
@@ -346,6 +809,33 @@ public:
         }
 #endif
 
+        // Frames per second rendered at most, while the user interacts
+        if (config.contains("maxFps")) {
+            FrameScheduler::get().maxFps = config["maxFps"].get<int>();
+        }
+        // Frames per second rendered while a component plays an animation, e.g. a progress bar
+        if (config.contains("animationFps")) {
+            FrameScheduler::get().animationFps = config["animationFps"].get<int>();
+        }
+
+        // Acceleration of the encoders turned fast: `curve` is `none`, `linear` or `quadratic`, the steps being
+        // multiplied by up to `maxFactor` when less than `slowMs` apart, e.g. `{ "curve": "quadratic", "slowMs": 100 }`
+        if (config.contains("encoderAcceleration") && config["encoderAcceleration"].is_object()) {
+            nlohmann::json& acceleration = config["encoderAcceleration"];
+            encoderCurve.type = EncoderCurve::getType(acceleration.value("curve", "linear"));
+            encoderCurve.slowMs = acceleration.value("slowMs", encoderCurve.slowMs);
+            encoderCurve.maxFactor = acceleration.value("maxFactor", encoderCurve.maxFactor);
+        }
+
+        // Record the UI frames, the rendering of each component and the display flushes, see Tracing in the host docs
+        if (config.contains("trace")) {
+            Trace::get().config(config["trace"]);
+        }
+
+        if (!deferServices) {
+            startServices(config);
+        }
+
         if (config.contains("taggedViews") && config["taggedViews"].is_object()) {
             taggedViews = config["taggedViews"];
         }
@@ -357,48 +847,135 @@ public:
             logDebug("init screen / draw done.");
         }
 
+        // Bounds of the views kept loaded, e.g. `"viewCache": { "maxViews": 8, "maxKb": 4096 }`, the least recently
+        // used ones being released beyond them. Without `maxKb`, only the number of views is bounded.
+        if (config.contains("viewCache") && config["viewCache"].is_object()) {
+            nlohmann::json& cache = config["viewCache"];
+            maxLoadedViews = std::max(cache.value("maxViews", (int)maxLoadedViews), 1);
+            maxLoadedBytes = cache.value("maxKb", 0) * 1024;
+        }
+
         if (config.contains("views")) {
             logInfo("----------- init views -------------");
-            nlohmann::json& viewsConfig = config["views"];
-            if (viewsConfig.is_array()) {
-                for (auto& v : viewsConfig) {
-                    if (v.contains("name") && (v.contains("components") || v.contains("containers"))) {
-                        logDebug("Loading view %s", v["name"].get<std::string>().c_str());
-
-                        View* newView = nullptr;
-                        if (v.contains("components") && v["components"].is_array())
-                            newView = new ViewMonoContainer(*draw, [&](std::string name) { setView(name); }, contextVar);
-                        else
-                            newView = new ViewMultiContainer(*draw, [&](std::string name) { setView(name); }, contextVar);
-
-                        newView->name = v["name"];
-                        if (v.contains("noPrevious")) {
-                            logDebug("view %s noPrevious", newView->name.c_str());
-                            newView->saveForPrevious = !v["noPrevious"];
-                        }
-                        views.push_back(newView);
-                        if (v.contains("components") && v["components"].is_array())
-                            componentConfig(v, newView, NULL);
-                        else if (v.contains("containers") && v["containers"].is_array()) {
-                            for (auto& c : v["containers"]) {
-                                if (c.contains("components") && c["components"].is_array()
-                                    && c.contains("name") && c.contains("position") && c["position"].is_array() && c["position"].size() == 2) {
-                                    std::string name = c["name"].get<std::string>();
-                                    Point position = { c["position"][0].get<int>(), c["position"][1].get<int>() };
-                                    std::string height = c.value("height", "100%");
-                                    Container* container = newView->addContainer(name, position, height);
-                                    container->config(c);
-                                    componentConfig(c, newView, container);
-                                }
-                            }
-                        }
-                    }
+            loadViews(config["views"], viewEntries);
+            logDebug("init views done.");
+        }
+    }
+
+    // Set before config() to start the control socket and the network servers later, with startServices(), e.g. once
+    // the first frame is shown at startup
+    bool deferServices = false;
+
+    void startServices(nlohmann::json& config)
+    {
+        // Unix socket for the commands of external tools (see helpers/controlSocket.h), `@name` in the abstract
+        // namespace, empty to disable. The lines written in `controlFile` are handled the same way.
+        if (!controlSocket.running()) {
+            std::string socketPath = config.value("controlSocket", "/tmp/zic.sock");
+            std::string filepath = config.value("controlFile", "message.txt");
+            controlSocket.start(
+                socketPath, [this](const std::string& command) { return control(command); },
+                filepath, [this](const std::string& line) { return controlFile(line); });
+        }
+
+        // UDP port of the OSC control surface, e.g. `"osc": { "port": 8888, "rate": 30 }`, `rate` being how many times
+        // per second the values subscribed by the clients are sent back to them when they changed
+        if (config.contains("osc") && config["osc"].is_object() && !oscServer.running()) {
+            nlohmann::json& osc = config["osc"];
+            OscServer::Handlers handlers;
+            handlers.value = [](const std::string& plugin, int16_t track, const std::string& key) -> ValueInterface* {
+                try {
+                    return getPlugin(plugin, track).getValue(key);
+                } catch (const std::exception& e) {
+                    return NULL;
                 }
+            };
+            handlers.encoder = [this](int8_t id, int8_t direction, uint64_t tick) { pushEncoder(id, direction, tick); };
+            handlers.key = [this](uint16_t id, int key, int8_t state) { pushKey(id, key, state); };
+            oscServer.start(osc.value("port", 8888), handlers, osc.value("rate", 30));
+        }
+
+        // TCP port of the page showing the screen in a web browser, e.g. `"remoteUi": { "port": 8080, "fps": 20 }`,
+        // `fps` being how many frames per second are streamed at most
+        if (config.contains("remoteUi") && config["remoteUi"].is_object() && !frameStream.running()) {
+            nlohmann::json& remoteUi = config["remoteUi"];
+            FrameStreamServer::Handlers handlers;
+            handlers.key = [this](uint16_t id, int key, int8_t state) { pushKey(id, key, state); };
+            handlers.wheel = [this](int x, int y, int8_t direction) { pushWheel(x, y, direction); };
+            handlers.wake = []() { FrameScheduler::get().wake(); };
+            frameStream.start(remoteUi.value("port", 8080), handlers, remoteUi.value("fps", 20));
+        }
+
+        // TCP port of the values snapshot and change stream, e.g. `"valueStream": { "port": 8081, "rate": 10 }`, `rate`
+        // being how many times per second the changes are sent at most
+        if (config.contains("valueStream") && config["valueStream"].is_object() && !valueStream.running()) {
+            nlohmann::json& stream = config["valueStream"];
+            valueStream.start(getAudioPluginHandler(), stream.value("port", 8081), stream.value("rate", 10));
+        }
+    }
+
+    // Only the views with `"keepLoaded": true` are created right away, the others on the first setView() showing them
+    void loadViews(nlohmann::json& viewsConfig, std::vector<ViewEntry>& targetViews)
+    {
+        if (!viewsConfig.is_array()) {
+            return;
+        }
+        for (auto& v : viewsConfig) {
+            if (v.contains("name") && (v.contains("components") || v.contains("containers"))) {
+                ViewEntry entry;
+                entry.name = v["name"].get<std::string>();
+                entry.config = v;
+                entry.keepLoaded = v.value("keepLoaded", false);
+                targetViews.push_back(entry);
+            }
+        }
+        for (ViewEntry& entry : targetViews) {
+            if (entry.keepLoaded) {
+                loadView(entry);
             }
-            logDebug("init views done.");
         }
     }
 
+    nlohmann::json viewsReloadConfig;
+    std::atomic<bool> viewsReloadPending = false;
+
+    // Re-create all the views, so components are bound to the plugins currently loaded, e.g. after tracks were reloaded.
+    // Views are rendered by the UI thread, so they are swapped from there, on the next rendering.
+    void reloadViews(nlohmann::json& config)
+    {
+        reloadMtx.lock();
+        viewsReloadConfig = config;
+        reloadMtx.unlock();
+        viewsReloadPending = true;
+        // The tracks were reloaded before the views
+        oscServer.invalidate();
+        FrameScheduler::get().wake();
+    }
+
+    void applyViewsReload()
+    {
+        reloadMtx.lock();
+        nlohmann::json config = viewsReloadConfig;
+        reloadMtx.unlock();
+        if (!config.contains("views")) {
+            return;
+        }
+        std::vector<ViewEntry> newViews;
+        loadViews(config["views"], newViews);
+        if (!newViews.size()) {
+            return;
+        }
+        std::string viewName = view ? view->name : newViews[0].name;
+
+        // Previous views are not deleted, as a component might still hold one of them
+        viewEntries = newViews;
+        previousView.clear();
+        view = NULL;
+        viewContexts.clear();
+
+        setView(findView(viewName) ? viewName : viewEntries[0].name, true);
+    }
+
     void componentConfig(nlohmann::json& config, View* newView, Container* container)
     {
         if (config.contains("components") && config["components"].is_array()) {
@@ -1,11 +1,11 @@
 /** Description:
 This C++ program serves as the core application engine, managing both background processes and the user interface (UI) display. It is structured using multiple threads, allowing different tasks to run simultaneously.
 
-The program starts in the primary function, where it performs initial setup. This includes defining the visual style (like the color palette), loading necessary backend components (controllers), and reading application settings from a configuration file (typically `config.json`). Importantly, it sets up a special monitoring system to watch the configuration file; if the settings change while the program is running, it can automatically detect and handle the update. It then starts a separate "host" thread for background data management.
+The program starts in the primary function, where it performs initial setup. This includes defining the visual style (like the color palette), loading necessary backend components (controllers), and reading application settings from a configuration file (typically `config.json`). Importantly, it sets up a special monitoring system to watch the configuration file; if the settings change while the program is running, it can automatically detect and handle the update. The startup is staged, for the sound to come out as soon as possible: a splash logo is shown, the audio tracks are loaded and a separate "host" thread starts playing them, and only then are the controllers and the views loaded, the network services being started once the first frame is shown.
 
 The visual component is handled by a dedicated UI thread. This thread initializes the drawing system, determines which screen or "view" should be displayed first (sometimes based on system settings), and renders the initial graphics.
 
-The UI thread then enters a continuous loop, which is the heart of the application's responsiveness. In this loop, it constantly redraws the visible components and, if running on a desktop environment, checks for user events like mouse clicks. This loop ensures the screen is updated smoothly at a regular interval (about 80 milliseconds).
+The UI thread then enters a continuous loop, which is the heart of the application's responsiveness. In this loop, it redraws the visible components only when a frame is needed: a component changed, an input arrived, or an animated component is due. The frame rate rises to a configurable maximum while the user interacts and drops to almost nothing when idle. On a desktop environment, it also checks for user events like mouse clicks.
 
 The code is flexible and supports two different rendering modes: one for desktop systems (which handles sophisticated user interaction) and one for embedded systems that draw directly to a screen buffer.
 
@@ -18,6 +18,8 @@ sha: 9b4b75cf72c101ad301595b99115aad5e0f96fa184394c49b5b3610033786736
 #include "config.h"
 #include "draw/draw.h"
 #include "helpers/configWatcher.h"
+#include "helpers/frameScheduler.h"
+#include "helpers/getExecutableDirectory.h"
 #include "helpers/getTicks.h"
 #include "host.h"
 #include "plugins/controllers/PixelController.h"
@@ -25,13 +27,52 @@ sha: 9b4b75cf72c101ad301595b99115aad5e0f96fa184394c49b5b3610033786736
 #include "viewManager.h"
 
 #include <cstdlib>
+#include <filesystem>
 #include <pthread.h>
+#include <spawn.h>
+#include <sys/wait.h>
 
 bool appRunning = true;
 
+// Config as read at startup, the UI thread loading its second stage
+nlohmann::json startupConfig;
+pid_t splashPid = 0;
+uint64_t startTicks = 0;
+
+// Show the logo (see splash.cpp) while the app loads, when the screen is driven by the app itself
+void startSplash(nlohmann::json& config)
+{
+#ifndef DRAW_DESKTOP
+    if (config.value("renderer", "") != "ST7789") {
+        return;
+    }
+    std::string path = getExecutableDirectory() + "/" + config.value("splash", "splash");
+    if (!std::filesystem::exists(path)) {
+        return;
+    }
+    char* argv[] = { (char*)path.c_str(), (char*)"startup", NULL };
+    if (posix_spawn(&splashPid, path.c_str(), NULL, NULL, argv, environ) != 0) {
+        logWarn("Cannot start splash %s", path.c_str());
+        splashPid = 0;
+    }
+#endif
+}
+
+// The splash and the renderer share the display, the renderer only initializes it once the splash is drawn
+void waitSplash()
+{
+    if (splashPid > 0) {
+        waitpid(splashPid, NULL, 0);
+        splashPid = 0;
+    }
+}
+
 void* uiThread(void* = NULL)
 {
     ViewManager& viewManager = ViewManager::get();
+    // Second stage: the audio is already playing while the controllers and the views are loaded
+    loadUiConfig(startupConfig);
+    waitSplash();
     viewManager.init();
 
     if (getenv("START_VIEW") && getenv("START_VIEW")[0] != '\0') {
@@ -45,29 +86,32 @@ void* uiThread(void* = NULL)
         printf("No view were initialized to be rendered.");
         return NULL;
     }
+    logInfo("First frame after %lu ms", (unsigned long)(getTicks() - startTicks));
 
-    // int ms = 50;
-    int ms = 80;
+    // Last stage: what is not needed to play, once the first frame is shown
+    viewManager.startServices(startupConfig);
+
+    // Frames are rendered when a component needs it, see FrameScheduler
+    FrameScheduler& scheduler = FrameScheduler::get();
 #ifdef DRAW_DESKTOP
     logInfo("Rendering with SDL.");
-    unsigned long lastUpdate = getTicks();
+    // The window events are polled, so the UI thread wakes up often enough for them
+    int eventPollMs = 5;
     while (viewManager.draw->handleEvent(viewManager.view) && appRunning) {
-        unsigned long now = getTicks();
-        if (now - lastUpdate > ms) {
-            lastUpdate = now;
+        if (scheduler.wait(eventPollMs)) {
+            unsigned long now = getTicks();
             viewManager.draw->preRender(viewManager.view, now);
             viewManager.renderComponents(now);
         }
-        usleep(1);
     }
     appRunning = false;
 #else
     logDebug("Rendering framebuffer.");
-    int us = ms * 1000;
     while (appRunning) {
-        unsigned long now = getTicks();
-        viewManager.renderComponents(now);
-        usleep(us);
+        // Woken up as well when the app is closing, to not wait for the next frame
+        if (scheduler.wait(100)) {
+            viewManager.renderComponents(getTicks());
+        }
     }
 #endif
 
@@ -77,6 +121,7 @@ void* uiThread(void* = NULL)
 
 int main(int argc, char* argv[])
 {
+    startTicks = getTicks();
     loadHostPlugin();
 
     // styles.colors.primary = { 0x3a, 0x7d, 0x80 }; // #3a7d80
@@ -92,21 +137,30 @@ int main(int argc, char* argv[])
     lastPluginControllerInstance = new PixelController(controllerProps, 0);
     controllers.push_back({ "Default", lastPluginControllerInstance });
 
+    // Staged startup, what matters on stage being the time until the first sound: the splash is shown, the audio
+    // tracks are loaded and started, then the UI thread loads the views and starts the services
     std::string configFilepath = argc >= 2 ? argv[1] : "config.json";
-    loadJsonConfig(configFilepath);
+    startupConfig = readJsonConfig(configFilepath);
+    startSplash(startupConfig);
+    loadAudioConfig(startupConfig);
+    startHostThread();
+    logInfo("Audio started after %lu ms", (unsigned long)(getTicks() - startTicks));
+    ViewManager::get().deferServices = true;
 
-    pthread_t watcherTid = configWatcher(configFilepath, &appRunning, []() {
+    pthread_t watcherTid = configWatcher(configFilepath, &appRunning, [configFilepath]() {
+        if (reloadJsonConfig(configFilepath)) {
+            return true;
+        }
         ViewManager& viewManager = ViewManager::get();
         Point pos = viewManager.draw->getWindowPosition();
         Size size = viewManager.draw->getWindowSize();
         printf("RESTART: %s %d,%d %d,%d\n", viewManager.view->name.c_str(), pos.x, pos.y, size.w, size.h);
         fflush(stdout);
+        return false;
     });
 
     showLogLevel();
 
-    startHostThread();
-
     pthread_t ptid;
     pthread_create(&ptid, NULL, &uiThread, NULL);
     pthread_setname_np(ptid, "ui");